@@ -177,6 +177,32 @@ admin :: wait_until_stable(enum hyperdex_admin_returncode* status)
     }
 }
 
+int64_t
+admin :: wait_until_checkpoint_stable(uint64_t checkpoint,
+                                      enum hyperdex_admin_returncode* status)
+{
+    if (!maintain_coord_connection(status))
+    {
+        return -1;
+    }
+
+    int64_t id = m_next_admin_id;
+    ++m_next_admin_id;
+    e::intrusive_ptr<coord_rpc> op = new coord_rpc_generic(id, status, "wait for checkpoint");
+    int64_t cid = replicant_client_cond_wait(m_coord, "hyperdex", "checkpoint_stable", checkpoint, &op->repl_status, NULL, NULL);
+
+    if (cid >= 0)
+    {
+        m_coord_ops[cid] = op;
+        return op->admin_visible_id();
+    }
+    else
+    {
+        interpret_replicant_returncode(op->repl_status, status, &m_last_error);
+        return -1;
+    }
+}
+
 int64_t
 admin :: fault_tolerance(const char* space, uint64_t ft,
                          hyperdex_admin_returncode* status)
@@ -209,6 +235,62 @@ admin :: fault_tolerance(const char* space, uint64_t ft,
     }
 }
 
+int64_t
+admin :: transfer_rate(uint64_t rate, hyperdex_admin_returncode* status)
+{
+    if (!maintain_coord_connection(status))
+    {
+        return -1;
+    }
+
+    int64_t id = m_next_admin_id;
+    ++m_next_admin_id;
+    e::intrusive_ptr<coord_rpc> op = new coord_rpc_generic(id, status, "set transfer rate");
+    char buf[sizeof(uint64_t)];
+    e::pack64be(rate, buf);
+    int64_t cid = rpc("transfer_rate", buf, sizeof(uint64_t),
+                      &op->repl_status, &op->repl_output, &op->repl_output_sz);
+
+    if (cid >= 0)
+    {
+        m_coord_ops[cid] = op;
+        return op->admin_visible_id();
+    }
+    else
+    {
+        interpret_replicant_returncode(op->repl_status, status, &m_last_error);
+        return -1;
+    }
+}
+
+int64_t
+admin :: split_region(uint64_t rid, hyperdex_admin_returncode* status)
+{
+    if (!maintain_coord_connection(status))
+    {
+        return -1;
+    }
+
+    int64_t id = m_next_admin_id;
+    ++m_next_admin_id;
+    e::intrusive_ptr<coord_rpc> op = new coord_rpc_generic(id, status, "split region");
+    char buf[sizeof(uint64_t)];
+    e::pack64be(rid, buf);
+    int64_t cid = rpc("region_split", buf, sizeof(uint64_t),
+                      &op->repl_status, &op->repl_output, &op->repl_output_sz);
+
+    if (cid >= 0)
+    {
+        m_coord_ops[cid] = op;
+        return op->admin_visible_id();
+    }
+    else
+    {
+        interpret_replicant_returncode(op->repl_status, status, &m_last_error);
+        return -1;
+    }
+}
+
 int
 admin :: validate_space(const char* description,
                         hyperdex_admin_returncode* status)
@@ -343,6 +425,74 @@ admin :: mv_space(const char* source, const char* target,
     }
 }
 
+int64_t
+admin :: immutable_space(const char* name, int immutable,
+                         hyperdex_admin_returncode* status)
+{
+    if (!maintain_coord_connection(status))
+    {
+        return -1;
+    }
+
+    const size_t name_sz = strlen(name);
+    std::vector<char> buf(name_sz + 2);
+    buf[0] = immutable ? 1 : 0;
+    memmove(&buf[1], name, name_sz);
+    buf[name_sz + 1] = '\0';
+    int64_t id = m_next_admin_id;
+    ++m_next_admin_id;
+    e::intrusive_ptr<coord_rpc> op = new coord_rpc_generic(id, status, "immutable space");
+    int64_t cid = rpc("space_immutable", &buf[0], buf.size(),
+                      &op->repl_status, &op->repl_output, &op->repl_output_sz);
+
+    if (cid >= 0)
+    {
+        m_coord_ops[cid] = op;
+        return op->admin_visible_id();
+    }
+    else
+    {
+        interpret_replicant_returncode(op->repl_status, status, &m_last_error);
+        return -1;
+    }
+}
+
+int64_t
+admin :: space_quota(const char* name, uint64_t ops, uint64_t bytes,
+                     uint64_t client_ops,
+                     hyperdex_admin_returncode* status)
+{
+    if (!maintain_coord_connection(status))
+    {
+        return -1;
+    }
+
+    const size_t quota_sz = 3 * sizeof(uint64_t);
+    const size_t name_sz = strlen(name);
+    std::vector<char> buf(quota_sz + name_sz + 1);
+    e::pack64be(ops, &buf[0]);
+    e::pack64be(bytes, &buf[0] + sizeof(uint64_t));
+    e::pack64be(client_ops, &buf[0] + 2 * sizeof(uint64_t));
+    memmove(&buf[quota_sz], name, name_sz);
+    buf[quota_sz + name_sz] = '\0';
+    int64_t id = m_next_admin_id;
+    ++m_next_admin_id;
+    e::intrusive_ptr<coord_rpc> op = new coord_rpc_generic(id, status, "space quota");
+    int64_t cid = rpc("space_quota", &buf[0], buf.size(),
+                      &op->repl_status, &op->repl_output, &op->repl_output_sz);
+
+    if (cid >= 0)
+    {
+        m_coord_ops[cid] = op;
+        return op->admin_visible_id();
+    }
+    else
+    {
+        interpret_replicant_returncode(op->repl_status, status, &m_last_error);
+        return -1;
+    }
+}
+
 int64_t
 admin :: add_index(const char* space, const char* attr,
                    hyperdex_admin_returncode* status)
@@ -443,6 +593,14 @@ admin :: list_spaces(hyperdex_admin_returncode* status,
 int64_t
 admin :: server_register(uint64_t token, const char* address,
                          enum hyperdex_admin_returncode* status)
+{
+    return server_register(token, address, NULL, status);
+}
+
+int64_t
+admin :: server_register(uint64_t token, const char* address,
+                         const char* zone,
+                         enum hyperdex_admin_returncode* status)
 {
     if (!maintain_coord_connection(status))
     {
@@ -461,8 +619,15 @@ admin :: server_register(uint64_t token, const char* address,
     int64_t id = m_next_admin_id;
     ++m_next_admin_id;
     e::intrusive_ptr<coord_rpc> op = new coord_rpc_generic(id, status, "register server");
-    std::auto_ptr<e::buffer> msg(e::buffer::create(sizeof(uint64_t) + pack_size(loc)));
-    msg->pack() << sid << loc;
+    e::slice z(zone ? zone : "", zone ? strlen(zone) : 0);
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sizeof(uint64_t) + pack_size(loc) + pack_size(z)));
+    e::packer pa = msg->pack() << sid << loc;
+
+    if (!z.empty())
+    {
+        pa = pa << z;
+    }
+
     int64_t cid = rpc("server_register", reinterpret_cast<const char*>(msg->data()), msg->size(),
                       &op->repl_status, &op->repl_output, &op->repl_output_sz);
 
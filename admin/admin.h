@@ -65,8 +65,14 @@ class admin
         int64_t read_only(int ro,
                           enum hyperdex_admin_returncode* status);
         int64_t wait_until_stable(enum hyperdex_admin_returncode* status);
+        int64_t wait_until_checkpoint_stable(uint64_t checkpoint,
+                                             enum hyperdex_admin_returncode* status);
+        int64_t transfer_rate(uint64_t rate,
+                              enum hyperdex_admin_returncode* status);
         int64_t fault_tolerance(const char* space, uint64_t ft,
                                 enum hyperdex_admin_returncode* status);
+        int64_t split_region(uint64_t rid,
+                             enum hyperdex_admin_returncode* status);
         // manage spaces
         int validate_space(const char* description,
                            enum hyperdex_admin_returncode* status);
@@ -76,6 +82,11 @@ class admin
                          enum hyperdex_admin_returncode* status);
         int64_t mv_space(const char* source, const char* target,
                          enum hyperdex_admin_returncode* status);
+        int64_t immutable_space(const char* name, int immutable,
+                                enum hyperdex_admin_returncode* status);
+        int64_t space_quota(const char* name, uint64_t ops, uint64_t bytes,
+                            uint64_t client_ops,
+                            enum hyperdex_admin_returncode* status);
         int64_t add_index(const char* space, const char* attr,
                           enum hyperdex_admin_returncode* status);
         int64_t list_indices(const char* space, enum hyperdex_admin_returncode* status,
@@ -90,6 +101,10 @@ class admin
         // manage servers
         int64_t server_register(uint64_t token, const char* address,
                                 enum hyperdex_admin_returncode* status);
+        // "zone" is "zone" or "zone/rack", or NULL if unknown
+        int64_t server_register(uint64_t token, const char* address,
+                                const char* zone,
+                                enum hyperdex_admin_returncode* status);
         int64_t server_online(uint64_t token, enum hyperdex_admin_returncode* status);
         int64_t server_offline(uint64_t token, enum hyperdex_admin_returncode* status);
         int64_t server_forget(uint64_t token, enum hyperdex_admin_returncode* status);
@@ -45,7 +45,9 @@ backup_state_machine :: backup_state_machine(const char* name,
     , m_nested_rc()
     , m_configuration_version(0)
     , m_servers()
-    , m_backup(NULL)
+    , m_daemon_backups()
+    , m_daemon_backups_outstanding(0)
+    , m_daemon_backups_failed(false)
     , m_backups()
     , m_backups_str()
     , m_backups_c_str(backups)
@@ -244,44 +246,104 @@ backup_state_machine :: callback_wait_to_quiesce(admin* adm, int64_t id)
 
     // now figure out the servers to take a backup on
     adm->m_config.get_all_addresses(&m_servers);
-    std::sort(m_servers.rbegin(), m_servers.rend());
-    return callback_daemon_backup(adm, id);
+    std::sort(m_servers.begin(), m_servers.end());
+    start_daemon_backups(adm);
+}
+
+void
+backup_state_machine :: start_daemon_backups(admin* adm)
+{
+    m_state = DAEMON_BACKUP;
+
+    for (size_t i = 0; i < m_servers.size(); ++i)
+    {
+        m_daemon_backups.push_back(daemon_backup(m_servers[i].first, m_servers[i].second));
+        daemon_backup& db(m_daemon_backups.back());
+        db.id = adm->raw_backup(db.sid, m_name.c_str(), &db.rc, &db.path);
+
+        if (db.id < 0)
+        {
+            // the ones already sent still call back; back out after them
+            this->set_status(db.rc);
+            this->set_error(adm->m_last_error);
+            m_daemon_backups_failed = true;
+            break;
+        }
+
+        adm->m_multi_ops[db.id] = this;
+        ++m_daemon_backups_outstanding;
+    }
+
+    if (m_daemon_backups_outstanding == 0)
+    {
+        finish_daemon_backups(adm);
+    }
 }
 
 void
 backup_state_machine :: callback_daemon_backup(admin* adm, int64_t id)
 {
-    if (!common_callback(adm, id))
+    if (m_state == ERROR || m_state == YIELDED)
+    {
+        return;
+    }
+
+    std::list<daemon_backup>::iterator it = m_daemon_backups.begin();
+
+    while (it != m_daemon_backups.end() && it->id != id)
     {
+        ++it;
+    }
+
+    if (it == m_daemon_backups.end())
+    {
+        YIELDING_ERROR(INTERNAL) << "callback had id=" << id
+                                 << " which is not one of the daemon backups";
+        m_state = BACKOUT;
+        backout(adm);
         return;
     }
 
-    if (m_backup)
+    --m_daemon_backups_outstanding;
+
+    if (it->path)
     {
-        m_backups << m_backup << "\n";
-        m_backup = NULL;
+        it->backup = it->path;
+        it->path = NULL;
     }
 
-    if (m_servers.empty())
+    if (it->rc != HYPERDEX_ADMIN_SUCCESS && !m_daemon_backups_failed)
     {
-        std::string path = m_name + ".coordinator.bin";
-        m_nested_id = adm->coord_backup(path.c_str(), &m_nested_rc);
+        this->set_status(it->rc);
+        this->set_error(adm->m_last_error);
+        m_daemon_backups_failed = true;
+    }
 
-        if (!check_nested(adm))
-        {
-            return;
-        }
+    if (m_daemon_backups_outstanding == 0)
+    {
+        finish_daemon_backups(adm);
+    }
+}
 
-        adm->m_multi_ops[m_nested_id] = this;
-        m_state = COORD_BACKUP;
+void
+backup_state_machine :: finish_daemon_backups(admin* adm)
+{
+    if (m_daemon_backups_failed)
+    {
+        m_state = BACKOUT;
+        backout(adm);
         return;
     }
 
-    server_id sid = m_servers.back().first;
-    po6::net::location loc = m_servers.back().second;
-    m_servers.pop_back();
-    m_nested_id = adm->raw_backup(sid, m_name.c_str(), &m_nested_rc, &m_backup);
-    m_backups << sid.get() << " " << loc.address << " ";
+    for (std::list<daemon_backup>::iterator it = m_daemon_backups.begin();
+            it != m_daemon_backups.end(); ++it)
+    {
+        m_backups << it->sid.get() << " " << it->loc.address << " "
+                  << it->backup << "\n";
+    }
+
+    std::string path = m_name + ".coordinator.bin";
+    m_nested_id = adm->coord_backup(path.c_str(), &m_nested_rc);
 
     if (!check_nested(adm))
     {
@@ -289,7 +351,7 @@ backup_state_machine :: callback_daemon_backup(admin* adm, int64_t id)
     }
 
     adm->m_multi_ops[m_nested_id] = this;
-    m_state = DAEMON_BACKUP;
+    m_state = COORD_BACKUP;
 }
 
 void
@@ -29,8 +29,10 @@
 #define hyperdex_admin_backup_h_
 
 // STL
+#include <list>
 #include <memory>
 #include <sstream>
+#include <string>
 
 // e
 #include <e/error.h>
@@ -74,12 +76,31 @@ class backup_state_machine : public multi_yieldable
         void callback_unexpected(admin* adm, int64_t id);
         void callback_set_read_only(admin* adm, int64_t id);
         void callback_wait_to_quiesce(admin* adm, int64_t id);
+        void start_daemon_backups(admin* adm);
         void callback_daemon_backup(admin* adm, int64_t id);
+        void finish_daemon_backups(admin* adm);
         void callback_coord_backup(admin* adm, int64_t id);
         void callback_wait_to_quiesce_again(admin* adm, int64_t id);
         void callback_set_read_write(admin* adm, int64_t id);
         void callback_backout(admin* adm, int64_t id);
 
+    private:
+        // one daemon's backup;  every daemon backs up at once, so the cluster
+        // is read-only for the slowest daemon's backup rather than their sum
+        struct daemon_backup
+        {
+            daemon_backup(const server_id& s, const po6::net::location& l)
+                : sid(s), loc(l), id(-1), rc(), path(NULL), backup() {}
+            server_id sid;
+            po6::net::location loc;
+            int64_t id;
+            hyperdex_admin_returncode rc;
+            // points into the pending_raw_backup, so it is copied to backup
+            // when the daemon replies
+            const char* path;
+            std::string backup;
+        };
+
     private:
         std::string m_name;
         enum { INITIALIZED,
@@ -97,7 +118,11 @@ class backup_state_machine : public multi_yieldable
         hyperdex_admin_returncode m_nested_rc;
         uint64_t m_configuration_version;
         std::vector<std::pair<server_id, po6::net::location> > m_servers;
-        const char* m_backup;
+        // a list so that the rc and path each pending_raw_backup holds
+        // pointers to stay put
+        std::list<daemon_backup> m_daemon_backups;
+        size_t m_daemon_backups_outstanding;
+        bool m_daemon_backups_failed;
         std::ostringstream m_backups;
         std::string m_backups_str;
         const char** m_backups_c_str;
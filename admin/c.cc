@@ -337,6 +337,78 @@ hyperdex_admin_disable_perf_counters(struct hyperdex_admin* _adm)
     return adm->disable_perf_counters();
 }
 
+HYPERDEX_API int64_t
+hyperdex_admin_transfer_rate(struct hyperdex_admin* _adm,
+                             uint64_t rate,
+                             enum hyperdex_admin_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::admin* adm = reinterpret_cast<hyperdex::admin*>(_adm);
+    return adm->transfer_rate(rate, status);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_admin_split_region(struct hyperdex_admin* _adm,
+                            uint64_t rid,
+                            enum hyperdex_admin_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::admin* adm = reinterpret_cast<hyperdex::admin*>(_adm);
+    return adm->split_region(rid, status);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_admin_immutable_space(struct hyperdex_admin* _adm,
+                               const char* name,
+                               int immutable,
+                               enum hyperdex_admin_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::admin* adm = reinterpret_cast<hyperdex::admin*>(_adm);
+    return adm->immutable_space(name, immutable, status);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_admin_space_quota(struct hyperdex_admin* _adm,
+                           const char* name,
+                           uint64_t ops,
+                           uint64_t bytes,
+                           uint64_t client_ops,
+                           enum hyperdex_admin_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::admin* adm = reinterpret_cast<hyperdex::admin*>(_adm);
+    return adm->space_quota(name, ops, bytes, client_ops, status);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_admin_wait_until_checkpoint_stable(struct hyperdex_admin* _adm,
+                                            uint64_t checkpoint,
+                                            enum hyperdex_admin_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::admin* adm = reinterpret_cast<hyperdex::admin*>(_adm);
+    return adm->wait_until_checkpoint_stable(checkpoint, status);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_admin_server_register_in_zone(struct hyperdex_admin* _adm,
+                                       uint64_t token,
+                                       const char* address,
+                                       const char* zone,
+                                       enum hyperdex_admin_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::admin* adm = reinterpret_cast<hyperdex::admin*>(_adm);
+    return adm->server_register(token, address, zone, status);
+    );
+}
+
 HYPERDEX_API int64_t
 hyperdex_admin_loop(struct hyperdex_admin* _adm, int timeout,
                     enum hyperdex_admin_returncode* status)
@@ -34,16 +34,22 @@
 
 // STL
 #include <list>
+#include <sstream>
 #include <string>
 #include <vector>
 
+// e
+#include <e/endian.h>
+
 // HyperDex
 #include <hyperdex/client.h>
 #include <hyperdex/hyperspace_builder.h>
 #include "visibility.h"
 #include "common/attribute.h"
+#include "common/attribute_check.h"
 #include "common/datatype_info.h"
 #include "common/hyperspace.h"
+#include "common/range_searches.h"
 #include "common/schema.h"
 #include "admin/hyperspace_builder_internal.h"
 #include "admin/partition.h"
@@ -106,6 +112,13 @@ class hyperspace
         uint64_t fault_tolerance;
         uint64_t partitions;
         bool authorization;
+        hyperdex::durability_level durability;
+        const char* expiry;
+        bool ordered_key;
+        bool compressed;
+        const char* bucket_attr;
+        const char* bucket_unit;
+        uint64_t bucket_width;
 
     private:
         hyperspace(const hyperspace&);
@@ -124,6 +137,13 @@ hyperspace :: hyperspace()
     , fault_tolerance(1)
     , partitions(64)
     , authorization(false)
+    , durability(hyperdex::DURABILITY_ASYNC)
+    , expiry(NULL)
+    , ordered_key(false)
+    , compressed(false)
+    , bucket_attr(NULL)
+    , bucket_unit(NULL)
+    , bucket_width(0)
 {
     memset(buffer, 0, 1024);
 }
@@ -203,6 +223,279 @@ is_concrete_datatype(hyperdatatype type)
     return hyperdex::datatype_info::lookup(type) != NULL;
 }
 
+// the name hyperspace_parse knows "type" by
+static const char*
+datatype_name(hyperdatatype type)
+{
+    switch (type)
+    {
+        case HYPERDATATYPE_STRING: return "string";
+        case HYPERDATATYPE_INT64: return "int";
+        case HYPERDATATYPE_FLOAT: return "float";
+        case HYPERDATATYPE_DOCUMENT: return "document";
+        case HYPERDATATYPE_TIMESTAMP_SECOND: return "timestamp(second)";
+        case HYPERDATATYPE_TIMESTAMP_MINUTE: return "timestamp(minute)";
+        case HYPERDATATYPE_TIMESTAMP_HOUR: return "timestamp(hour)";
+        case HYPERDATATYPE_TIMESTAMP_DAY: return "timestamp(day)";
+        case HYPERDATATYPE_TIMESTAMP_WEEK: return "timestamp(week)";
+        case HYPERDATATYPE_TIMESTAMP_MONTH: return "timestamp(month)";
+        case HYPERDATATYPE_LIST_STRING: return "list(string)";
+        case HYPERDATATYPE_LIST_INT64: return "list(int)";
+        case HYPERDATATYPE_LIST_FLOAT: return "list(float)";
+        case HYPERDATATYPE_SET_STRING: return "set(string)";
+        case HYPERDATATYPE_SET_INT64: return "set(int)";
+        case HYPERDATATYPE_SET_FLOAT: return "set(float)";
+        case HYPERDATATYPE_MAP_STRING_STRING: return "map(string, string)";
+        case HYPERDATATYPE_MAP_STRING_INT64: return "map(string, int)";
+        case HYPERDATATYPE_MAP_STRING_FLOAT: return "map(string, float)";
+        case HYPERDATATYPE_MAP_INT64_STRING: return "map(int, string)";
+        case HYPERDATATYPE_MAP_INT64_INT64: return "map(int, int)";
+        case HYPERDATATYPE_MAP_INT64_FLOAT: return "map(int, float)";
+        case HYPERDATATYPE_MAP_FLOAT_STRING: return "map(float, string)";
+        case HYPERDATATYPE_MAP_FLOAT_INT64: return "map(float, int)";
+        case HYPERDATATYPE_MAP_FLOAT_FLOAT: return "map(float, float)";
+        default: return NULL;
+    }
+}
+
+// fill "sp" with the space "space" describes, reporting why if it cannot be
+// created; the regions have no servers, as before the coordinator places them
+static enum hyperspace_returncode
+routable_space(hyperspace* space, hyperdex::space* sp)
+{
+    if (space->error)
+    {
+        return HYPERSPACE_GARBAGE;
+    }
+
+    if (!space->name || !space->key.name)
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "cannot route searches through a space without a name and key");
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_GARBAGE;
+    }
+
+    if (!hyperdex::space_to_space(space, sp))
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "cannot route searches through a space that fails validation");
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_GARBAGE;
+    }
+
+    return HYPERSPACE_SUCCESS;
+}
+
+// parse one "<attr> <op> <value>" condition of a search, in the form partial
+// index filters take; values are interpreted according to the attribute's
+// type, and strings may be double-quoted
+static enum hyperspace_returncode
+parse_search_condition(hyperspace* space, const hyperdex::schema& sc,
+                       const std::string& cond, hyperdex::attribute_check* chk,
+                       std::string* value)
+{
+    size_t op = cond.find_first_of("=<>");
+    size_t name_start = cond.find_first_not_of(' ');
+    size_t name_end = op == std::string::npos || op == 0 ? std::string::npos
+                    : cond.find_last_not_of(' ', op - 1);
+
+    if (op == std::string::npos || name_start == std::string::npos ||
+        name_end == std::string::npos || name_start > name_end)
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "\"%s\" is not of the form <attr> <op> <value>", cond.c_str());
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_GARBAGE;
+    }
+
+    std::string name(cond.substr(name_start, name_end - name_start + 1));
+    std::string rest(cond.substr(op));
+    size_t op_sz = 1;
+
+    if (rest.compare(0, 2, "<=") == 0)
+    {
+        chk->predicate = HYPERPREDICATE_LESS_EQUAL;
+        op_sz = 2;
+    }
+    else if (rest.compare(0, 2, ">=") == 0)
+    {
+        chk->predicate = HYPERPREDICATE_GREATER_EQUAL;
+        op_sz = 2;
+    }
+    else if (rest[0] == '<')
+    {
+        chk->predicate = HYPERPREDICATE_LESS_THAN;
+    }
+    else if (rest[0] == '>')
+    {
+        chk->predicate = HYPERPREDICATE_GREATER_THAN;
+    }
+    else
+    {
+        chk->predicate = HYPERPREDICATE_EQUALS;
+        op_sz = rest.compare(0, 2, "==") == 0 ? 2 : 1;
+    }
+
+    size_t val_start = rest.find_first_not_of(' ', op_sz);
+    size_t val_end = rest.find_last_not_of(' ');
+    std::string val(val_start == std::string::npos ? ""
+                    : rest.substr(val_start, val_end - val_start + 1));
+    chk->attr = sc.lookup_attr(name.c_str());
+
+    if (chk->attr >= sc.attrs_sz)
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "cannot search on \"%s\" because there is no attribute by that name", name.c_str());
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_UNKNOWN_ATTR;
+    }
+
+    const hyperdatatype t = sc.attrs[chk->attr].type;
+    chk->datatype = t;
+
+    if (t == HYPERDATATYPE_STRING)
+    {
+        if (val.size() >= 2 && val[0] == '"' && val[val.size() - 1] == '"')
+        {
+            val = val.substr(1, val.size() - 2);
+        }
+
+        *value = val;
+        return HYPERSPACE_SUCCESS;
+    }
+
+    if (t != HYPERDATATYPE_INT64 && t != HYPERDATATYPE_FLOAT &&
+        (CONTAINER_TYPE(t) != HYPERDATATYPE_TIMESTAMP_GENERIC ||
+         t == HYPERDATATYPE_TIMESTAMP_GENERIC))
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "cannot route searches on \"%s\" because it is not a string, int, float or timestamp", name.c_str());
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_INVALID_TYPE;
+    }
+
+    char* end = NULL;
+    value->resize(sizeof(int64_t));
+
+    if (t == HYPERDATATYPE_FLOAT)
+    {
+        double d = strtod(val.c_str(), &end);
+        e::packdoublele(d, &(*value)[0]);
+    }
+    else
+    {
+        int64_t i = strtoll(val.c_str(), &end, 10);
+        e::pack64le(i, &(*value)[0]);
+    }
+
+    if (val.empty() || !end || *end != '\0')
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "\"%s\" is not a valid value for \"%s\"", val.c_str(), name.c_str());
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_INVALID_TYPE;
+    }
+
+    return HYPERSPACE_SUCCESS;
+}
+
+// route "search" through "sp" the way configuration::lookup_search picks
+// servers:  every subspace narrows the search as far as its coordinates
+// allow, and the subspace left with the smallest share of its regions wins,
+// the last with the fewest regions among equals; no region has reported its
+// size before the space exists, so each weighs the same
+static enum hyperspace_returncode
+route_search(hyperspace* space, const hyperdex::space& sp, const char* search,
+             uint64_t* regions, uint64_t* total, int* indexed)
+{
+    std::vector<hyperdex::attribute_check> checks;
+    std::list<std::string> values;
+    const std::string clause(search);
+    const std::string conj(" and ");
+    size_t start = 0;
+
+    while (start <= clause.size())
+    {
+        size_t end = clause.find(conj, start);
+        end = end == std::string::npos ? clause.size() : end;
+        const std::string cond(clause.substr(start, end - start));
+        start = end + conj.size();
+        hyperdex::attribute_check chk;
+        values.push_back(std::string());
+        enum hyperspace_returncode rc;
+        rc = parse_search_condition(space, sp.sc, cond, &chk, &values.back());
+
+        if (rc != HYPERSPACE_SUCCESS)
+        {
+            return rc;
+        }
+
+        chk.value = e::slice(values.back());
+        checks.push_back(chk);
+    }
+
+    std::vector<hyperdex::range> ranges;
+    hyperdex::range_searches(sp.sc, checks, &ranges);
+    *regions = 0;
+    *total = 0;
+    *indexed = 0;
+
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        // the key is always its own index; any other attribute needs one
+        for (size_t j = 0; ranges[i].attr > 0 && j < sp.indices.size(); ++j)
+        {
+            if (sp.indices[j].type == hyperdex::index::NORMAL &&
+                sp.indices[j].attr == ranges[i].attr)
+            {
+                *indexed = 1;
+            }
+        }
+
+        if (ranges[i].attr == 0)
+        {
+            *indexed = 1;
+        }
+
+        // a search that matches nothing contacts nobody
+        if (ranges[i].invalid)
+        {
+            return HYPERSPACE_SUCCESS;
+        }
+    }
+
+    bool initialized = false;
+    double least_work = 0;
+    std::vector<const hyperdex::region*> regs;
+
+    for (size_t i = 0; i < sp.subspaces.size(); ++i)
+    {
+        if (!hyperdex::search_regions(sp, sp.subspaces[i], ranges, &regs))
+        {
+            *regions = 0;
+            *total = 0;
+            return HYPERSPACE_SUCCESS;
+        }
+
+        const double work = sp.subspaces[i].regions.empty() ? 0
+                          : double(regs.size()) / sp.subspaces[i].regions.size();
+
+        if (!initialized ||
+            (!regs.empty() &&
+             (work < least_work ||
+              (work == least_work && regs.size() <= *regions))))
+        {
+            *regions = regs.size();
+            *total = sp.subspaces[i].regions.size();
+            least_work = work;
+            initialized = true;
+        }
+    }
+
+    return HYPERSPACE_SUCCESS;
+}
+
 extern "C"
 {
 
@@ -495,6 +788,289 @@ hyperspace_use_authorization(struct hyperspace* space)
     return HYPERSPACE_SUCCESS;
 }
 
+HYPERDEX_API enum hyperspace_returncode
+hyperspace_set_durability(struct hyperspace* space, const char* level)
+{
+    if (strcmp(level, "async") == 0)
+    {
+        space->durability = hyperdex::DURABILITY_ASYNC;
+    }
+    else if (strcmp(level, "sync") == 0)
+    {
+        space->durability = hyperdex::DURABILITY_SYNC;
+    }
+    else if (strcmp(level, "group") == 0)
+    {
+        space->durability = hyperdex::DURABILITY_GROUP;
+    }
+    else if (strcmp(level, "memory") == 0)
+    {
+        space->durability = hyperdex::DURABILITY_MEMORY;
+    }
+    else
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "unknown durability \"%s\"; expected async, sync, group or memory", level);
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_INVALID_DURABILITY;
+    }
+
+    return HYPERSPACE_SUCCESS;
+}
+
+HYPERDEX_API enum hyperspace_returncode
+hyperspace_set_expiry(struct hyperspace* space, const char* attr)
+{
+    if (strcmp(space->key.name, attr) == 0)
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "cannot expire objects by \"%s\" because it is the key", attr);
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_IS_KEY;
+    }
+
+    if (!space->has_attr(attr))
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "cannot expire objects by \"%s\" because there is no attribute by that name", attr);
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_UNKNOWN_ATTR;
+    }
+
+    if (CONTAINER_TYPE(space->attr_type(attr)) != HYPERDATATYPE_TIMESTAMP_GENERIC)
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "cannot expire objects by \"%s\" because it is not a timestamp", attr);
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_INVALID_EXPIRY;
+    }
+
+    space->expiry = space->internalize(attr);
+    return HYPERSPACE_SUCCESS;
+}
+
+HYPERDEX_API enum hyperspace_returncode
+hyperspace_use_ordered_key(struct hyperspace* space)
+{
+    if (space->key.type != HYPERDATATYPE_STRING &&
+        space->key.type != HYPERDATATYPE_INT64 &&
+        space->key.type != HYPERDATATYPE_FLOAT)
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "cannot order the key because it is not a string, int, or float");
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_INVALID_TYPE;
+    }
+
+    space->ordered_key = true;
+    return HYPERSPACE_SUCCESS;
+}
+
+HYPERDEX_API enum hyperspace_returncode
+hyperspace_use_compression(struct hyperspace* space)
+{
+    space->compressed = true;
+    return HYPERSPACE_SUCCESS;
+}
+
+HYPERDEX_API enum hyperspace_returncode
+hyperspace_set_time_buckets(struct hyperspace* space, const char* attr, const char* unit)
+{
+    if (strcmp(space->key.name, attr) == 0)
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "cannot bucket objects by \"%s\" because it is the key", attr);
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_IS_KEY;
+    }
+
+    if (!space->has_attr(attr))
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "cannot bucket objects by \"%s\" because there is no attribute by that name", attr);
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_UNKNOWN_ATTR;
+    }
+
+    if (CONTAINER_TYPE(space->attr_type(attr)) != HYPERDATATYPE_TIMESTAMP_GENERIC)
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "cannot bucket objects by \"%s\" because it is not a timestamp", attr);
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_INVALID_TYPE;
+    }
+
+    // timestamps count microseconds
+    const uint64_t minute = 60ULL * 1000000ULL;
+
+    if (strcmp(unit, "minute") == 0)
+    {
+        space->bucket_width = minute;
+    }
+    else if (strcmp(unit, "hour") == 0)
+    {
+        space->bucket_width = 60 * minute;
+    }
+    else if (strcmp(unit, "day") == 0)
+    {
+        space->bucket_width = 24 * 60 * minute;
+    }
+    else if (strcmp(unit, "week") == 0)
+    {
+        space->bucket_width = 7 * 24 * 60 * minute;
+    }
+    else
+    {
+        snprintf(space->buffer, BUFFER_SIZE, "unknown bucket \"%s\"; expected minute, hour, day or week", unit);
+        space->buffer[BUFFER_SIZE - 1] = '\0';
+        space->error = space->buffer;
+        return HYPERSPACE_INVALID_TYPE;
+    }
+
+    space->bucket_attr = space->internalize(attr);
+    space->bucket_unit = space->internalize(unit);
+    return HYPERSPACE_SUCCESS;
+}
+
+HYPERDEX_API const char*
+hyperspace_describe(struct hyperspace* space)
+{
+    std::ostringstream ostr;
+    ostr << "space " << (space->name ? space->name : "") << "\n";
+    ostr << "key ";
+
+    if (space->key.name && space->key.type != HYPERDATATYPE_STRING)
+    {
+        ostr << datatype_name(space->key.type) << " ";
+    }
+
+    ostr << (space->key.name ? space->key.name : "") << "\n";
+
+    if (!space->attributes.empty())
+    {
+        ostr << "attributes";
+
+        for (size_t i = 0; i < space->attributes.size(); ++i)
+        {
+            const char* type = datatype_name(space->attributes[i].type);
+            ostr << (i > 0 ? ",\n    " : "\n    ")
+                 << (type ? type : "string") << " " << space->attributes[i].name;
+        }
+
+        ostr << "\n";
+
+        for (size_t i = 0; i < space->subspaces.size(); ++i)
+        {
+            if (space->subspaces[i].attrs.empty())
+            {
+                continue;
+            }
+
+            ostr << "subspace ";
+
+            for (size_t j = 0; j < space->subspaces[i].attrs.size(); ++j)
+            {
+                ostr << (j > 0 ? ", " : "") << space->subspaces[i].attrs[j];
+            }
+
+            ostr << "\n";
+        }
+
+        for (size_t i = 0; i < space->indices.size(); ++i)
+        {
+            ostr << "index " << space->indices[i] << "\n";
+        }
+    }
+
+    ostr << "create " << space->partitions << " partitions\n";
+    ostr << "tolerate " << space->fault_tolerance << " failures\n";
+
+    if (space->authorization)
+    {
+        ostr << "with authorization\n";
+    }
+
+    if (space->durability == hyperdex::DURABILITY_SYNC)
+    {
+        ostr << "with durability sync\n";
+    }
+    else if (space->durability == hyperdex::DURABILITY_GROUP)
+    {
+        ostr << "with durability group\n";
+    }
+    else if (space->durability == hyperdex::DURABILITY_MEMORY)
+    {
+        ostr << "with durability memory\n";
+    }
+
+    if (space->expiry)
+    {
+        ostr << "with expiry " << space->expiry << "\n";
+    }
+
+    if (space->ordered_key)
+    {
+        ostr << "with ordered key\n";
+    }
+
+    if (space->compressed)
+    {
+        ostr << "with compression\n";
+    }
+
+    if (space->bucket_attr)
+    {
+        ostr << "bucket " << space->bucket_attr << " by " << space->bucket_unit << "\n";
+    }
+
+    return space->internalize(ostr.str().c_str());
+}
+
+HYPERDEX_API enum hyperspace_returncode
+hyperspace_route_searches(struct hyperspace* space,
+                          const char* const* searches, size_t searches_sz,
+                          uint64_t* regions, uint64_t* total, int* indexed)
+{
+    hyperdex::space sp;
+    enum hyperspace_returncode rc = routable_space(space, &sp);
+
+    if (rc != HYPERSPACE_SUCCESS)
+    {
+        return rc;
+    }
+
+    for (size_t i = 0; i < searches_sz; ++i)
+    {
+        rc = route_search(space, sp, searches[i], &regions[i], &total[i], &indexed[i]);
+
+        if (rc != HYPERSPACE_SUCCESS)
+        {
+            return rc;
+        }
+    }
+
+    return HYPERSPACE_SUCCESS;
+}
+
+HYPERDEX_API enum hyperspace_returncode
+hyperspace_write_cost(struct hyperspace* space,
+                      uint64_t* copies, uint64_t* index_entries)
+{
+    hyperdex::space sp;
+    enum hyperspace_returncode rc = routable_space(space, &sp);
+
+    if (rc != HYPERSPACE_SUCCESS)
+    {
+        return rc;
+    }
+
+    // each subspace keeps its own chain of replicas, and every replica of
+    // the object maintains an entry in every index
+    *copies = sp.subspaces.size() * (sp.fault_tolerance + 1);
+    *index_entries = *copies * sp.indices.size();
+    return HYPERSPACE_SUCCESS;
+}
+
 char*
 hyperspace_buffer(hyperspace* space)
 {
@@ -535,6 +1111,23 @@ hyperdex :: space_to_space(hyperspace* in, hyperdex::space* out)
     schema sc;
     sc.attrs_sz = attrs.size();
     sc.attrs = &attrs.front();
+    sc.durability = in->durability;
+    sc.ordered_key = in->ordered_key;
+    sc.compressed = in->compressed;
+
+    if (in->expiry)
+    {
+        sc.expiry = sc.lookup_attr(in->expiry);
+        assert(sc.expiry < sc.attrs_sz);
+    }
+
+    if (in->bucket_attr)
+    {
+        sc.bucket_attr = sc.lookup_attr(in->bucket_attr);
+        sc.bucket_width = in->bucket_width;
+        assert(sc.bucket_attr < sc.attrs_sz);
+    }
+
     space sp(in->name, sc);
     sp.subspaces.push_back(subspace());
     sp.subspaces.back().attrs.push_back(0);
@@ -556,6 +1149,23 @@ hyperdex :: space_to_space(hyperspace* in, hyperdex::space* out)
         }
     }
 
+    // buckets narrow searches only through a subspace that has the attribute
+    bool bucketed = sc.bucket_attr == 0;
+
+    for (size_t i = 0; !bucketed && i < sp.subspaces.size(); ++i)
+    {
+        for (size_t j = 0; j < sp.subspaces[i].attrs.size(); ++j)
+        {
+            bucketed = bucketed || sp.subspaces[i].attrs[j] == sc.bucket_attr;
+        }
+    }
+
+    if (!bucketed)
+    {
+        sp.subspaces.push_back(subspace());
+        sp.subspaces.back().attrs.push_back(sc.bucket_attr);
+    }
+
     sp.fault_tolerance = in->fault_tolerance;
 
     if (!sp.validate())
@@ -75,6 +75,12 @@ yyerror(YYLTYPE* yylloc, struct hyperspace* space, void* scanner, const char* ms
 %token INDEX
 %token WITH
 %token AUTHORIZATION
+%token DURABILITY
+%token EXPIRY
+%token ORDERED
+%token COMPRESSION
+%token BUCKET
+%token BY
 
 %token <str> IDENTIFIER
 %token <num> NUMBER
@@ -95,6 +101,7 @@ yyerror(YYLTYPE* yylloc, struct hyperspace* space, void* scanner, const char* ms
 
 %type <type> type
 %type <attr> attribute
+%type <str> bucket_unit
 %type <ret> attribute_list
 
 %union
@@ -144,6 +151,16 @@ options :                { }
 option : TOLERATE NUMBER FAILURES { hyperspace_set_fault_tolerance(space, $2); }
        | CREATE NUMBER PARTITIONS { hyperspace_set_number_of_partitions(space, $2); }
        | WITH AUTHORIZATION { hyperspace_use_authorization(space); }
+       | WITH DURABILITY IDENTIFIER { hyperspace_set_durability(space, $3); free($3); }
+       | WITH EXPIRY IDENTIFIER { hyperspace_set_expiry(space, $3); free($3); }
+       | WITH ORDERED KEY { hyperspace_use_ordered_key(space); }
+       | WITH COMPRESSION { hyperspace_use_compression(space); }
+       | BUCKET IDENTIFIER BY bucket_unit { hyperspace_set_time_buckets(space, $2, $4); free($2); }
+
+bucket_unit : MINUTE { $$ = "minute"; }
+            | HOUR   { $$ = "hour"; }
+            | DAY    { $$ = "day"; }
+            | WEEK   { $$ = "week"; }
 
 type : STRING                        { $$ = HYPERDATATYPE_STRING; }
      | INT64                         { $$ = HYPERDATATYPE_INT64; }
@@ -63,6 +63,7 @@ CLIENT_ENUM = [(8448, 'SUCCESS'),
                (8531, 'CLUSTER_JUMP'),
                (8533, 'OFFLINE'),
                (8534, 'UNAUTHORIZED'),
+               (8535, 'THROTTLED'),
                (0, 'This should never happen.  It indicates a bug'),
                (8573, 'INTERNAL'),
                (8574, 'EXCEPTION'),
@@ -355,7 +356,9 @@ extern "C"
 #endif /* __cplusplus */
 
 struct hyperdex_client;
+struct hyperdex_client_prepared;
 struct hyperdex_client_microtransaction;
+struct hyperdex_ds_arena;
 
 struct hyperdex_client_attribute
 {
@@ -385,6 +388,28 @@ struct hyperdex_client_attribute_check
     enum hyperpredicate predicate;
 };
 
+enum hyperdex_client_aggregate_function
+{
+    HYPERDEX_CLIENT_AGGREGATE_SUM = 1,
+    HYPERDEX_CLIENT_AGGREGATE_MIN = 2,
+    HYPERDEX_CLIENT_AGGREGATE_MAX = 3,
+    HYPERDEX_CLIENT_AGGREGATE_AVG = 4
+};
+
+struct hyperdex_client_aggregate
+{
+    const char* attr; /* NULL-terminated */
+    enum hyperdex_client_aggregate_function function;
+};
+
+struct hyperdex_client_aggregate_group
+{
+    const char* group; /* the group_by value; empty when not grouping */
+    size_t group_sz;
+    uint64_t count;
+    const double* values; /* one per requested aggregate */
+};
+
 /* hyperdex_client_returncode occupies [8448, 8576) */
 enum hyperdex_client_returncode
 {
@@ -397,6 +422,16 @@ struct hyperdex_client*
 hyperdex_client_create(const char* coordinator, uint16_t port);
 struct hyperdex_client*
 hyperdex_client_create_conn_str(const char* conn_str);
+/* A shared client may be used by many threads at once, all of them sharing
+ * its connections and its copy of the configuration.  Any thread may issue
+ * operations; hyperdex_client_loop returns only the operations the calling
+ * thread issued, and hyperdex_client_error_message describes the calling
+ * thread's last call.  The auth context is shared by all threads.
+ */
+struct hyperdex_client*
+hyperdex_client_create_shared(const char* coordinator, uint16_t port);
+struct hyperdex_client*
+hyperdex_client_create_shared_conn_str(const char* conn_str);
 void
 hyperdex_client_destroy(struct hyperdex_client* client);
 
@@ -433,6 +468,201 @@ hyperdex_client_uxact_cond_commit(struct hyperdex_client* _cl,
 '''
 
 CLIENT_HEADER_FOOT = '''
+/* Retrieve num_keys objects in one operation.  Keys are grouped by the server
+ * that leads them, and each group travels in a single message.  When the
+ * operation completes, statuses[i], attrs[i] and attrs_sz[i] hold the result
+ * for keys[i]; each attrs[i] must be freed with hyperdex_client_destroy_attrs.
+ */
+int64_t
+hyperdex_client_get_many(struct hyperdex_client* client,
+                         const char* space,
+                         const char** keys, const size_t* keys_sz, size_t num_keys,
+                         enum hyperdex_client_returncode* status,
+                         enum hyperdex_client_returncode* statuses,
+                         const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* One page of "limit" results of a sorted search.  Pass a NULL cursor for the
+ * first page and the previous page's next_cursor thereafter; servers resume
+ * where the previous page left off instead of re-sorting the earlier pages.
+ * Once the page is done (HYPERDEX_CLIENT_SEARCHDONE), next_cursor points to an
+ * opaque token that is valid until the next call to hyperdex_client_loop, or
+ * is NULL if no results remain.  In a space created "with ordered key", paging
+ * by the key with a range on the key scans the range in key order, asking only
+ * the regions that hold it.
+ */
+int64_t
+hyperdex_client_sorted_search_page(struct hyperdex_client* client,
+                                   const char* space,
+                                   const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                   const char* sort_by,
+                                   uint64_t limit,
+                                   int maxmin,
+                                   const char* cursor, size_t cursor_sz,
+                                   enum hyperdex_client_returncode* status,
+                                   const struct hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                                   const char** next_cursor, size_t* next_cursor_sz);
+
+/* Compute aggregates over the int64, float or timestamp attributes of the
+ * objects that match the checks.  Each server computes partial results next to
+ * its data, so only one row per group crosses the network.  When group_by is
+ * a string attribute, there is one group for each of its distinct values
+ * (at most 1024); when it is NULL, there is exactly one group.  MIN, MAX and
+ * AVG of an empty group are NaN.  Once the operation succeeds, groups must be
+ * freed with hyperdex_client_destroy_aggregate_groups.
+ */
+int64_t
+hyperdex_client_aggregate(struct hyperdex_client* client,
+                          const char* space,
+                          const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                          const struct hyperdex_client_aggregate* aggs, size_t aggs_sz,
+                          const char* group_by,
+                          enum hyperdex_client_returncode* status,
+                          const struct hyperdex_client_aggregate_group** groups, size_t* groups_sz);
+
+/* Estimate how many objects match the checks without visiting them all.
+ * Each server counts matches until it has about 1/(error*error) of them and
+ * then extrapolates from how far through its index they reach, so the result
+ * is typically within "error" of the true count (e.g., 0.05 for 5%).  Regions
+ * with fewer matches, and an error of 0, are counted exactly.
+ */
+int64_t
+hyperdex_client_approximate_count(struct hyperdex_client* client,
+                                  const char* space,
+                                  const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                  double error,
+                                  enum hyperdex_client_returncode* status,
+                                  uint64_t* count);
+
+/* Like hyperdex_client_search, but return at most "limit" objects in no
+ * particular order.  Servers stop searching once they have sent "limit"
+ * objects, and the client stops the rest of them once it has "limit" in all.
+ * A limit of 0 returns every match.
+ */
+int64_t
+hyperdex_client_search_limit(struct hyperdex_client* client,
+                             const char* space,
+                             const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             uint64_t limit,
+                             enum hyperdex_client_returncode* status,
+                             const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* Like hyperdex_client_get, but let any replica of the key serve the read so
+ * gets spread across each chain instead of all landing on its head.  Every
+ * replica returns a committed value; a replica that knows of more than
+ * "staleness" writes to the key it has yet to apply hands the read back, and
+ * the client retries it at the head.  The value returned may be older than one
+ * a previous call returned.
+ */
+int64_t
+hyperdex_client_get_relaxed(struct hyperdex_client* client,
+                            const char* space,
+                            const char* key, size_t key_sz,
+                            uint64_t staleness,
+                            enum hyperdex_client_returncode* status,
+                            const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* Put many objects with one call, as for a bulk load.  Objects are grouped
+ * by the server that leads them and sent in batches.  Each object's outcome
+ * lands in statuses; the call yields once, when every object has settled. */
+int64_t
+hyperdex_client_put_many(struct hyperdex_client* client,
+                         const char* space,
+                         const char** keys, const size_t* keys_sz,
+                         const struct hyperdex_client_attribute* const* attrs, const size_t* attrs_sz,
+                         size_t num_objects,
+                         enum hyperdex_client_returncode* status,
+                         enum hyperdex_client_returncode* statuses);
+
+/* Like hyperdex_client_get, but the object is placed in "arena" rather than
+ * in memory of its own.  It must not be passed to
+ * hyperdex_client_destroy_attrs, and lives until the arena is reset or
+ * destroyed.  One arena may hold the results of many operations.
+ */
+int64_t
+hyperdex_client_get_arena(struct hyperdex_client* client,
+                          const char* space,
+                          const char* key, size_t key_sz,
+                          struct hyperdex_ds_arena* arena,
+                          enum hyperdex_client_returncode* status,
+                          const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* Like hyperdex_client_search_limit, but each object is placed in "arena" as
+ * for hyperdex_client_get_arena.  Resetting the arena between loops keeps a
+ * long search to one allocation.
+ */
+int64_t
+hyperdex_client_search_arena(struct hyperdex_client* client,
+                             const char* space,
+                             const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             uint64_t limit,
+                             struct hyperdex_ds_arena* arena,
+                             enum hyperdex_client_returncode* status,
+                             const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* The changes made to a space since "checkpoint" (0 for every change still
+ * on disk), one per loop, until HYPERDEX_CLIENT_SEARCHDONE says the servers
+ * have no more.  Each change is an object as it was written, or, when
+ * "deleted" is nonzero, just the key of an object that was deleted; the
+ * changes to one key come out in the order they were made.  "resume" always
+ * holds a checkpoint to pass to the next call, which then yields every
+ * change this call has not, and possibly some that it has:  consumers should
+ * ignore a put whose version is not newer than the one they hold.  A
+ * checkpoint the servers have since collected replays each region in full.
+ */
+int64_t
+hyperdex_client_changes(struct hyperdex_client* client,
+                        const char* space,
+                        uint64_t checkpoint,
+                        enum hyperdex_client_returncode* status,
+                        const struct hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                        uint64_t* version, int* deleted,
+                        uint64_t* resume);
+
+/* Like hyperdex_client_get_many, but the results are a snapshot: every key's
+ * result held at one moment, even across regions, without locking the keys.
+ * The keys are read again until two consecutive rounds agree; should they
+ * keep changing, the operation fails with HYPERDEX_CLIENT_CMPFAIL and may be
+ * retried.
+ */
+int64_t
+hyperdex_client_read_transaction(struct hyperdex_client* client,
+                                 const char* space,
+                                 const char** keys, const size_t* keys_sz, size_t num_keys,
+                                 enum hyperdex_client_returncode* status,
+                                 enum hyperdex_client_returncode* statuses,
+                                 const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* The "limit" objects that match the checks and lie nearest the point (x, y),
+ * nearest first, where x_attr and y_attr are int64, float or timestamp
+ * attributes and distance is Euclidean in their units.  A spatial index over
+ * the two attributes (see hyperdex add-index) lets servers examine only the
+ * objects near the point; without one, every matching object is examined.
+ */
+int64_t
+hyperdex_client_nearest_search(struct hyperdex_client* client,
+                               const char* space,
+                               const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                               const char* x_attr, double x,
+                               const char* y_attr, double y,
+                               uint64_t limit,
+                               enum hyperdex_client_returncode* status,
+                               const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* Like hyperdex_client_search, but return a uniform random sample of the
+ * matching objects, each kept with probability "fraction" independently of
+ * the rest.  Servers decide from a hash of the key before reading an object,
+ * so a small sample reads little more than the objects it returns.  Each call
+ * draws a fresh sample.  For roughly N objects, pass N divided by the result
+ * of hyperdex_client_approximate_count for the same checks.
+ */
+int64_t
+hyperdex_client_sample_search(struct hyperdex_client* client,
+                              const char* space,
+                              const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                              double fraction,
+                              enum hyperdex_client_returncode* status,
+                              const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
 int64_t
 hyperdex_client_loop(struct hyperdex_client* client, int timeout,
                      enum hyperdex_client_returncode* status);
@@ -443,6 +673,101 @@ hyperdex_client_poll_fd(struct hyperdex_client* client);
 int
 hyperdex_client_block(struct hyperdex_client* client, int timeout);
 
+/* While corking is on, the client holds puts and other atomic operations
+ * and sends each server's share as one message.  They go out on
+ * hyperdex_client_flush, on hyperdex_client_loop, or once a server's share
+ * grows large.  Callers that wait on hyperdex_client_poll_fd must flush
+ * first.  Turning corking off flushes.
+ */
+void
+hyperdex_client_set_corking(struct hyperdex_client* client, bool enabled);
+
+void
+hyperdex_client_flush(struct hyperdex_client* client);
+
+/* Keep up to budget bytes of objects read with hyperdex_client_get.  A cached
+ * object is returned without contacting a server for fresh_for milliseconds
+ * after a server last confirmed it, and during that window it may miss writes
+ * made by others.  Afterward, the get asks the server to send the object only
+ * if it changed.  A budget of zero turns the cache off.
+ */
+void
+hyperdex_client_set_read_cache(struct hyperdex_client* client,
+                               size_t budget, uint64_t fresh_for);
+
+/* Hedge gets against a slow server.  A get still unanswered after the 95th
+ * percentile of recent get latencies is sent again to another replica, and
+ * the first answer wins.  At most fraction of all gets are hedged; zero turns
+ * hedging off.  The stats count gets, gets hedged, and hedges that answered
+ * first.
+ */
+void
+hyperdex_client_set_hedging(struct hyperdex_client* client, double fraction);
+
+void
+hyperdex_client_hedging_stats(struct hyperdex_client* client,
+                              uint64_t* gets, uint64_t* hedged, uint64_t* won);
+
+/* Record how long replies take by request type and by server, how long loop
+ * blocks waiting for them, disruptions, configuration refreshes and the
+ * operations failed because of either.  Off by default.  The report has one
+ * line for each, of space-separated key=value pairs, and remains valid until
+ * the next call; reset clears what has been recorded.
+ */
+void
+hyperdex_client_set_statistics(struct hyperdex_client* client, int enabled);
+
+const char*
+hyperdex_client_statistics(struct hyperdex_client* client);
+
+void
+hyperdex_client_reset_statistics(struct hyperdex_client* client);
+
+/* Fail each operation issued after this call with HYPERDEX_CLIENT_TIMEOUT
+ * if it has not finished within timeout milliseconds.  The servers are told
+ * how long the operation has left, and give up on work that outlives it.
+ * Zero, the default, sets no limit.
+ */
+void
+hyperdex_client_set_operation_timeout(struct hyperdex_client* client, uint64_t timeout);
+
+/* Start from the configuration last saved within directory, and save each
+ * newer one there.  A new client then routes operations at once instead of
+ * waiting on the coordinator.  A stale file costs the first operations a
+ * HYPERDEX_CLIENT_RECONFIGURE, after which the client waits for the
+ * coordinator's configuration.  NULL turns the cache off.
+ */
+void
+hyperdex_client_set_config_cache(struct hyperdex_client* client, const char* directory);
+
+/* Name the checks and attributes of a key operation once, for operations
+ * issued many times with only their values changing.  method is the name of
+ * the operation as in hyperdex_client_<method>, such as "put", "cond_put" or
+ * "atomic_add"; the values of checks and attrs are ignored.  The space,
+ * attribute names and datatypes are resolved here and again only when the
+ * configuration changes.
+ */
+struct hyperdex_client_prepared*
+hyperdex_client_prepare(struct hyperdex_client* client,
+                        const char* method, const char* space,
+                        const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                        const struct hyperdex_client_attribute* attrs, size_t attrs_sz,
+                        enum hyperdex_client_returncode* status);
+
+/* Issue a prepared operation on key.  values holds one value for each check
+ * and then one for each attribute, in the order they were prepared.
+ */
+int64_t
+hyperdex_client_execute(struct hyperdex_client* client,
+                        struct hyperdex_client_prepared* prepared,
+                        const char* key, size_t key_sz,
+                        const char* const* values, const size_t* values_sz,
+                        enum hyperdex_client_returncode* status);
+
+void
+hyperdex_client_destroy_prepared(struct hyperdex_client* client,
+                                 struct hyperdex_client_prepared* prepared);
+
 enum hyperdatatype
 hyperdex_client_attribute_type(struct hyperdex_client* client,
                                const char* space, const char* name,
@@ -460,6 +785,9 @@ hyperdex_client_returncode_to_string(enum hyperdex_client_returncode);
 void
 hyperdex_client_destroy_attrs(const struct hyperdex_client_attribute* attrs, size_t attrs_sz);
 
+void
+hyperdex_client_destroy_aggregate_groups(const struct hyperdex_client_aggregate_group* groups, size_t groups_sz);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif /* __cplusplus */
@@ -505,6 +833,7 @@ inline void return_void() {}
 #define C_WRAP_EXCEPT(X) \\
     hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl); \\
     SIGNAL_PROTECT; \\
+    hyperdex::client::hold _hold(cl); \\
     try \\
     { \\
         X \\
@@ -568,6 +897,50 @@ hyperdex_client_create_conn_str(const char* conn_str)
     }
 }
 
+HYPERDEX_API hyperdex_client*
+hyperdex_client_create_shared(const char* coordinator, uint16_t port)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_ERR(NULL);
+    try
+    {
+        hyperdex::client* cl = new hyperdex::client(coordinator, port);
+        cl->set_shared();
+        return reinterpret_cast<hyperdex_client*>(cl);
+    }
+    catch (std::bad_alloc& ba)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    catch (...)
+    {
+        return NULL;
+    }
+}
+
+HYPERDEX_API hyperdex_client*
+hyperdex_client_create_shared_conn_str(const char* conn_str)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_ERR(NULL);
+    try
+    {
+        hyperdex::client* cl = new hyperdex::client(conn_str);
+        cl->set_shared();
+        return reinterpret_cast<hyperdex_client*>(cl);
+    }
+    catch (std::bad_alloc& ba)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    catch (...)
+    {
+        return NULL;
+    }
+}
+
 HYPERDEX_API void
 hyperdex_client_destroy(hyperdex_client* client)
 {
@@ -621,6 +994,7 @@ hyperdex_client_returncode_to_string(enum hyperdex_client_returncode stat)
         CSTRINGIFY(HYPERDEX_CLIENT_CLUSTER_JUMP);
         CSTRINGIFY(HYPERDEX_CLIENT_OFFLINE);
         CSTRINGIFY(HYPERDEX_CLIENT_UNAUTHORIZED);
+        CSTRINGIFY(HYPERDEX_CLIENT_THROTTLED);
         CSTRINGIFY(HYPERDEX_CLIENT_INTERNAL);
         CSTRINGIFY(HYPERDEX_CLIENT_EXCEPTION);
         CSTRINGIFY(HYPERDEX_CLIENT_GARBAGE);
@@ -636,6 +1010,7 @@ hyperdex_client_attribute_type(hyperdex_client* _cl,
 {
     SIGNAL_PROTECT_ERR(HYPERDATATYPE_GARBAGE);
     hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl); \\
+    hyperdex::client::hold _hold(cl);
 
     try
     {
@@ -664,12 +1039,21 @@ hyperdex_client_destroy_attrs(const hyperdex_client_attribute* attrs, size_t /*a
     free(const_cast<hyperdex_client_attribute*>(attrs));
 }
 
+HYPERDEX_API void
+hyperdex_client_destroy_aggregate_groups(const hyperdex_client_aggregate_group* groups, size_t /*groups_sz*/)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    free(const_cast<hyperdex_client_aggregate_group*>(groups));
+}
+
 HYPERDEX_API void
 hyperdex_client_clear_auth_context(struct hyperdex_client* _cl)
 {
     FAKE_STATUS;
     SIGNAL_PROTECT_VOID;
     hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
     cl->clear_auth_context();
 }
 
@@ -680,6 +1064,7 @@ hyperdex_client_set_auth_context(struct hyperdex_client* _cl,
     FAKE_STATUS;
     SIGNAL_PROTECT_VOID;
     hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
     cl->set_auth_context(macaroons, macaroons_sz);
 }
 
@@ -691,6 +1076,7 @@ hyperdex_client_uxact_init(struct hyperdex_client* _cl,
 
     SIGNAL_PROTECT_ERR(NULL);
     hyperdex::client *cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
     hyperdex::microtransaction *tx = cl->uxact_init(space, status);
 
     return reinterpret_cast<struct hyperdex_client_microtransaction*>(tx);
@@ -740,6 +1126,187 @@ hyperdex_client_uxact_cond_commit(struct hyperdex_client* _cl,
 '''
 
 CLIENT_WRAPPER_FOOT = '''
+HYPERDEX_API int64_t
+hyperdex_client_get_many(struct hyperdex_client* _cl,
+                         const char* space,
+                         const char** keys, const size_t* keys_sz, size_t num_keys,
+                         enum hyperdex_client_returncode* status,
+                         enum hyperdex_client_returncode* statuses,
+                         const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->get_many(space, keys, keys_sz, num_keys, status, statuses, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_sorted_search_page(struct hyperdex_client* _cl,
+                                   const char* space,
+                                   const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                   const char* sort_by,
+                                   uint64_t limit,
+                                   int maxmin,
+                                   const char* cursor, size_t cursor_sz,
+                                   enum hyperdex_client_returncode* status,
+                                   const struct hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                                   const char** next_cursor, size_t* next_cursor_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->sorted_search_page(space, checks, checks_sz, sort_by, limit, maxmin,
+                                  cursor, cursor_sz, status, attrs, attrs_sz,
+                                  next_cursor, next_cursor_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_aggregate(struct hyperdex_client* _cl,
+                          const char* space,
+                          const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                          const struct hyperdex_client_aggregate* aggs, size_t aggs_sz,
+                          const char* group_by,
+                          enum hyperdex_client_returncode* status,
+                          const struct hyperdex_client_aggregate_group** groups, size_t* groups_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->aggregate(space, checks, checks_sz, aggs, aggs_sz, group_by, status, groups, groups_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_approximate_count(struct hyperdex_client* _cl,
+                                  const char* space,
+                                  const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                  double error,
+                                  enum hyperdex_client_returncode* status,
+                                  uint64_t* count)
+{
+    C_WRAP_EXCEPT(
+    return cl->approximate_count(space, checks, checks_sz, error, status, count);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_search_limit(struct hyperdex_client* _cl,
+                             const char* space,
+                             const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             uint64_t limit,
+                             enum hyperdex_client_returncode* status,
+                             const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->search_limit(space, checks, checks_sz, limit, status, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_get_relaxed(struct hyperdex_client* _cl,
+                            const char* space,
+                            const char* key, size_t key_sz,
+                            uint64_t staleness,
+                            enum hyperdex_client_returncode* status,
+                            const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->get_relaxed(space, key, key_sz, staleness, status, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_put_many(struct hyperdex_client* _cl,
+                         const char* space,
+                         const char** keys, const size_t* keys_sz,
+                         const struct hyperdex_client_attribute* const* attrs, const size_t* attrs_sz,
+                         size_t num_objects,
+                         enum hyperdex_client_returncode* status,
+                         enum hyperdex_client_returncode* statuses)
+{
+    C_WRAP_EXCEPT(
+    return cl->put_many(space, keys, keys_sz, attrs, attrs_sz, num_objects, status, statuses);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_get_arena(struct hyperdex_client* _cl,
+                          const char* space,
+                          const char* key, size_t key_sz,
+                          struct hyperdex_ds_arena* arena,
+                          enum hyperdex_client_returncode* status,
+                          const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->get(space, key, key_sz, arena, status, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_search_arena(struct hyperdex_client* _cl,
+                             const char* space,
+                             const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             uint64_t limit,
+                             struct hyperdex_ds_arena* arena,
+                             enum hyperdex_client_returncode* status,
+                             const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->search_limit(space, checks, checks_sz, limit, arena, status, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_changes(struct hyperdex_client* _cl,
+                        const char* space,
+                        uint64_t checkpoint,
+                        enum hyperdex_client_returncode* status,
+                        const struct hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                        uint64_t* version, int* deleted,
+                        uint64_t* resume)
+{
+    C_WRAP_EXCEPT(
+    return cl->changes(space, checkpoint, status, attrs, attrs_sz, version, deleted, resume);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_read_transaction(struct hyperdex_client* _cl,
+                                 const char* space,
+                                 const char** keys, const size_t* keys_sz, size_t num_keys,
+                                 enum hyperdex_client_returncode* status,
+                                 enum hyperdex_client_returncode* statuses,
+                                 const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->read_transaction(space, keys, keys_sz, num_keys, status, statuses, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_nearest_search(struct hyperdex_client* _cl,
+                               const char* space,
+                               const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                               const char* x_attr, double x,
+                               const char* y_attr, double y,
+                               uint64_t limit,
+                               enum hyperdex_client_returncode* status,
+                               const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->nearest_search(space, checks, checks_sz, x_attr, x, y_attr, y, limit, status, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_sample_search(struct hyperdex_client* _cl,
+                              const char* space,
+                              const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                              double fraction,
+                              enum hyperdex_client_returncode* status,
+                              const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->sample_search(space, checks, checks_sz, fraction, status, attrs, attrs_sz);
+    );
+}
+
 HYPERDEX_API int64_t
 hyperdex_client_loop(hyperdex_client* _cl, int timeout,
                      hyperdex_client_returncode* status)
@@ -767,6 +1334,158 @@ hyperdex_client_block(hyperdex_client* _cl, int timeout)
     );
 }
 
+HYPERDEX_API void
+hyperdex_client_set_corking(hyperdex_client* _cl, bool enabled)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->set_corking(enabled);
+}
+
+HYPERDEX_API void
+hyperdex_client_flush(hyperdex_client* _cl)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->flush();
+}
+
+HYPERDEX_API void
+hyperdex_client_set_read_cache(hyperdex_client* _cl, size_t budget, uint64_t fresh_for)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->set_read_cache(budget, fresh_for);
+}
+
+HYPERDEX_API void
+hyperdex_client_set_hedging(hyperdex_client* _cl, double fraction)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->set_hedging(fraction);
+}
+
+HYPERDEX_API void
+hyperdex_client_hedging_stats(hyperdex_client* _cl,
+                              uint64_t* gets, uint64_t* hedged, uint64_t* won)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->hedging_stats(gets, hedged, won);
+}
+
+HYPERDEX_API void
+hyperdex_client_set_statistics(hyperdex_client* _cl, int enabled)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->set_statistics(enabled != 0);
+}
+
+HYPERDEX_API const char*
+hyperdex_client_statistics(hyperdex_client* _cl)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_ERR(NULL);
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    return cl->statistics();
+}
+
+HYPERDEX_API void
+hyperdex_client_reset_statistics(hyperdex_client* _cl)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->reset_statistics();
+}
+
+HYPERDEX_API void
+hyperdex_client_set_operation_timeout(hyperdex_client* _cl, uint64_t timeout)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->set_operation_timeout(timeout);
+}
+
+HYPERDEX_API void
+hyperdex_client_set_config_cache(hyperdex_client* _cl, const char* directory)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->set_config_cache(directory);
+}
+
+HYPERDEX_API struct hyperdex_client_prepared*
+hyperdex_client_prepare(hyperdex_client* _cl,
+                        const char* method, const char* space,
+                        const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                        const struct hyperdex_client_attribute* attrs, size_t attrs_sz,
+                        enum hyperdex_client_returncode* status)
+{
+    SIGNAL_PROTECT_ERR(NULL);
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+
+    try
+    {
+        return reinterpret_cast<hyperdex_client_prepared*>(
+                cl->prepare(method, space, checks, checks_sz, attrs, attrs_sz, status));
+    }
+    catch (std::bad_alloc& ba)
+    {
+        errno = ENOMEM;
+        *status = HYPERDEX_CLIENT_NOMEM;
+        cl->set_error_message("out of memory");
+        return NULL;
+    }
+    catch (...)
+    {
+        *status = HYPERDEX_CLIENT_EXCEPTION;
+        cl->set_error_message("unhandled exception was thrown");
+        return NULL;
+    }
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_execute(hyperdex_client* _cl,
+                        struct hyperdex_client_prepared* prepared,
+                        const char* key, size_t key_sz,
+                        const char* const* values, const size_t* values_sz,
+                        enum hyperdex_client_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::prepared* p = reinterpret_cast<hyperdex::prepared*>(prepared);
+    return cl->execute(p, key, key_sz, values, values_sz, status);
+    );
+}
+
+HYPERDEX_API void
+hyperdex_client_destroy_prepared(hyperdex_client*,
+                                 struct hyperdex_client_prepared* prepared)
+{
+    delete reinterpret_cast<hyperdex::prepared*>(prepared);
+}
+
 HYPERDEX_API void
 hyperdex_client_set_type_conversion(hyperdex_client* _cl, bool enabled)
 {
@@ -825,6 +1544,49 @@ hyperdex_admin_dump_config(struct hyperdex_admin* admin,
 '''
 
 ADMIN_HEADER_FOOT = '''
+int64_t
+hyperdex_admin_transfer_rate(struct hyperdex_admin* admin,
+                             uint64_t rate,
+                             enum hyperdex_admin_returncode* status);
+
+int64_t
+hyperdex_admin_split_region(struct hyperdex_admin* admin,
+                            uint64_t rid,
+                            enum hyperdex_admin_returncode* status);
+
+/* Writes to an immutable space fail with HYPERDEX_CLIENT_READONLY, and any
+ * replica may serve its reads. */
+int64_t
+hyperdex_admin_immutable_space(struct hyperdex_admin* admin,
+                               const char* name,
+                               int immutable,
+                               enum hyperdex_admin_returncode* status);
+
+/* Each server admits at most "ops" requests and "bytes" bytes of requests per
+ * second to the space, and at most "client_ops" requests per second from any
+ * one client; zero is no limit.  Requests over quota fail with
+ * HYPERDEX_CLIENT_THROTTLED once the client has backed off and retried a few
+ * times. */
+int64_t
+hyperdex_admin_space_quota(struct hyperdex_admin* admin,
+                           const char* name,
+                           uint64_t ops,
+                           uint64_t bytes,
+                           uint64_t client_ops,
+                           enum hyperdex_admin_returncode* status);
+
+int64_t
+hyperdex_admin_wait_until_checkpoint_stable(struct hyperdex_admin* admin,
+                                            uint64_t checkpoint,
+                                            enum hyperdex_admin_returncode* status);
+
+int64_t
+hyperdex_admin_server_register_in_zone(struct hyperdex_admin* admin,
+                                       uint64_t token,
+                                       const char* address,
+                                       const char* zone,
+                                       enum hyperdex_admin_returncode* status);
+
 int64_t
 hyperdex_admin_loop(struct hyperdex_admin* admin, int timeout,
                     enum hyperdex_admin_returncode* status);
@@ -834,6 +1596,47 @@ hyperdex_admin_raw_backup(const char* host, uint16_t port,
                           const char* name,
                           enum hyperdex_admin_returncode* status);
 
+/* on success, *hot_keys is a string the caller must free(), with one line for
+ * each of the keys the daemon's gets and atomics touch most, hottest first */
+int
+hyperdex_admin_raw_hot_keys(const char* host, uint16_t port,
+                            enum hyperdex_admin_returncode* status,
+                            char** hot_keys);
+
+/* on success, *profile is a string the caller must free(), holding the stacks
+ * the daemon's threads were sampled in over the next "seconds", folded one
+ * "outermost;...;innermost count" line apiece for flamegraph.pl */
+int
+hyperdex_admin_raw_profile(const char* host, uint16_t port,
+                           unsigned seconds,
+                           enum hyperdex_admin_returncode* status,
+                           char** profile);
+
+/* export the regions of "space" that the daemon is the point leader for into
+ * the directory "export-<name>" within its data directory, one column file
+ * per attribute for each region, at no more than "rate" bytes per second
+ * (zero for no limit).  On success, *path is a string the caller must free()
+ * naming that directory */
+int
+hyperdex_admin_raw_export(const char* host, uint16_t port,
+                          const char* space, const char* name,
+                          uint64_t rate, int compress,
+                          enum hyperdex_admin_returncode* status,
+                          char** path, uint64_t* objects, uint64_t* bytes);
+
+/* when "set" is nonzero, make the daemon do its heavy maintenance (collecting
+ * checkpoints and building indices) only from "start" to "end", in minutes
+ * past midnight UTC (equal times for always), and spend no more than "budget"
+ * bytes per second on it and on wiping (zero for no limit).  When "region" is
+ * nonzero, also compact that region, which the daemon must hold, in the
+ * background.  On success, *start, *end and *budget hold the daemon's
+ * settings; pass "set" as zero to merely read them */
+int
+hyperdex_admin_raw_maintenance(const char* host, uint16_t port,
+                               int set, uint64_t region,
+                               enum hyperdex_admin_returncode* status,
+                               uint16_t* start, uint16_t* end, uint64_t* budget);
+
 const char*
 hyperdex_admin_error_message(struct hyperdex_admin* admin);
 const char*
@@ -943,6 +1746,78 @@ hyperdex_admin_dump_config(struct hyperdex_admin* _adm,
 '''
 
 ADMIN_WRAPPER_FOOT = '''
+HYPERDEX_API int64_t
+hyperdex_admin_transfer_rate(struct hyperdex_admin* _adm,
+                             uint64_t rate,
+                             enum hyperdex_admin_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::admin* adm = reinterpret_cast<hyperdex::admin*>(_adm);
+    return adm->transfer_rate(rate, status);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_admin_split_region(struct hyperdex_admin* _adm,
+                            uint64_t rid,
+                            enum hyperdex_admin_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::admin* adm = reinterpret_cast<hyperdex::admin*>(_adm);
+    return adm->split_region(rid, status);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_admin_immutable_space(struct hyperdex_admin* _adm,
+                               const char* name,
+                               int immutable,
+                               enum hyperdex_admin_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::admin* adm = reinterpret_cast<hyperdex::admin*>(_adm);
+    return adm->immutable_space(name, immutable, status);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_admin_space_quota(struct hyperdex_admin* _adm,
+                           const char* name,
+                           uint64_t ops,
+                           uint64_t bytes,
+                           uint64_t client_ops,
+                           enum hyperdex_admin_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::admin* adm = reinterpret_cast<hyperdex::admin*>(_adm);
+    return adm->space_quota(name, ops, bytes, client_ops, status);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_admin_wait_until_checkpoint_stable(struct hyperdex_admin* _adm,
+                                            uint64_t checkpoint,
+                                            enum hyperdex_admin_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::admin* adm = reinterpret_cast<hyperdex::admin*>(_adm);
+    return adm->wait_until_checkpoint_stable(checkpoint, status);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_admin_server_register_in_zone(struct hyperdex_admin* _adm,
+                                       uint64_t token,
+                                       const char* address,
+                                       const char* zone,
+                                       enum hyperdex_admin_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::admin* adm = reinterpret_cast<hyperdex::admin*>(_adm);
+    return adm->server_register(token, address, zone, status);
+    );
+}
+
 HYPERDEX_API int64_t
 hyperdex_admin_loop(struct hyperdex_admin* _adm, int timeout,
                     enum hyperdex_admin_returncode* status)
@@ -166,11 +166,8 @@ def generate_worker_asynccall(call, x):
         for p, n in arg.args:
             func += '\tvar c_{0} {1}\n'.format(n, CGoIfy(p))
     stub_args, stub_args_list = generate_stub_args(x, in_prefix='c_', out_prefix='&c_')
-    func += '\tdone := make(chan Error)\n'
-    func += '\tclient.mutex.Lock()\n'
-    func += '\tinner := client.clients[client.counter%uint64(len(client.clients))]\n'
-    func += '\tclient.counter++\n'
-    func += '\tclient.mutex.Unlock()\n'
+    func += '\tdone := make(chan Error, 1)\n'
+    func += '\tinner := client.nextClient()\n'
     func += '\tinner.mutex.Lock()\n'
     func += '\treqid := stub(inner.ptr, {0})\n'.format(stub_args_list)
     func += '\tif reqid >= 0 {\n'
@@ -217,10 +214,7 @@ def generate_worker_iterator(call, x):
         func += '\t\treturn\n\t}\n'
     stub_args, stub_args_list = generate_stub_args(x, in_prefix='c_', out_prefix='&c_iter.')
     func += '\tvar err Error\n'
-    func += '\tclient.mutex.Lock()\n'
-    func += '\tinner := client.clients[client.counter%uint64(len(client.clients))]\n'
-    func += '\tclient.counter++\n'
-    func += '\tclient.mutex.Unlock()\n'
+    func += '\tinner := client.nextClient()\n'
     func += '\tinner.mutex.Lock()\n'
     func += '\treqid := stub(inner.ptr, {0})\n'.format(stub_args_list)
     func += '\tif reqid >= 0 {\n'
@@ -12,6 +12,7 @@ import "reflect"
 import "fmt"
 import "runtime"
 import "sync"
+import "sync/atomic"
 
 const (
 	SUCCESS      = C.HYPERDEX_CLIENT_SUCCESS
@@ -117,11 +118,17 @@ type cIterator struct {
 
 type Client struct {
 	counter uint64
-	mutex   sync.Mutex
 	clients []*innerClient
 	errChan chan Error
 }
 
+// Pick the C client for the next operation.  Operations are spread round
+// robin so that goroutines contend only with those sharing their shard.
+func (client *Client) nextClient() *innerClient {
+	n := atomic.AddUint64(&client.counter, 1) - 1
+	return client.clients[n%uint64(len(client.clients))]
+}
+
 func (client *Client) convertCString(arena *C.struct_hyperdex_ds_arena, s string, cs **C.char) {
 	x := C.CString(s)
 	defer C.free(unsafe.Pointer(x))
@@ -1027,52 +1034,64 @@ func (client *innerClient) runForever(errChan chan Error) {
 		default:
 			C.hyperdex_client_block(client.ptr, 250)
 			var loop_status C.enum_hyperdex_client_returncode
+			var done chan Error
+			var cIter *cIterator
+			var e Error
 			client.mutex.Lock()
 			reqid := int64(C.hyperdex_client_loop(client.ptr, 0, &loop_status))
-			if reqid < 0 && loop_status == TIMEOUT {
-				// pass
-			} else if reqid < 0 && loop_status == NONEPENDING {
-				// pass
-			} else if reqid < 0 {
-				e := Error{Status(loop_status),
+			idle := reqid < 0 && (loop_status == TIMEOUT || loop_status == NONEPENDING)
+			if !idle {
+				e = Error{Status(loop_status),
 					C.GoString(C.hyperdex_client_error_message(client.ptr)),
 					C.GoString(C.hyperdex_client_error_location(client.ptr))}
-				errChan <- e
+			}
+			if reqid < 0 {
+				// pass
 			} else if c, ok := (client.ops)[reqid]; ok {
-				e := Error{Status(loop_status),
-					C.GoString(C.hyperdex_client_error_message(client.ptr)),
-					C.GoString(C.hyperdex_client_error_location(client.ptr))}
-				c <- e
+				done = c
 				delete(client.ops, reqid)
-			} else if cIter, ok := client.searches[reqid]; ok {
+			} else if it, ok := client.searches[reqid]; ok {
+				cIter = it
+				if cIter.status == C.HYPERDEX_CLIENT_SEARCHDONE {
+					delete(client.searches, reqid)
+				} else if cIter.status != C.HYPERDEX_CLIENT_SUCCESS {
+					e.Status = Status(cIter.status)
+				}
+			}
+			client.mutex.Unlock()
+			// Deliver outside the lock, so a slow consumer holds up only its
+			// own operation and not every goroutine sharing this client.
+			// Only this goroutine calls hyperdex_client_loop, so cIter's
+			// attributes cannot change underneath us.
+			if idle {
+				// pass
+			} else if reqid < 0 {
+				errChan <- e
+			} else if done != nil {
+				done <- e
+			} else if cIter != nil {
 				if cIter.status == C.HYPERDEX_CLIENT_SUCCESS {
 					attrs, er := client.buildAttributes(cIter.attrs, cIter.attrs_sz)
+					C.hyperdex_client_destroy_attrs(cIter.attrs, cIter.attrs_sz)
 					if er != nil {
-						e := Error{Status(SERVERERROR), er.Error(), ""}
-						cIter.errChan <- e
+						cIter.errChan <- Error{Status(SERVERERROR), er.Error(), ""}
 					} else {
 						cIter.attrChan <- attrs
 					}
-					C.hyperdex_client_destroy_attrs(cIter.attrs, cIter.attrs_sz)
 				} else if cIter.status == C.HYPERDEX_CLIENT_SEARCHDONE {
 					close(cIter.attrChan)
 					close(cIter.errChan)
-					delete(client.searches, reqid)
 				} else {
-					e := Error{Status(cIter.status),
-						C.GoString(C.hyperdex_client_error_message(client.ptr)),
-						C.GoString(C.hyperdex_client_error_location(client.ptr))}
 					cIter.errChan <- e
 				}
 			}
-			client.mutex.Unlock()
 		}
 	}
 	panic("Should not be reached: end of infinite loop")
 }
 
 func NewClient(host string, port int) (*Client, error, chan Error) {
-	numClients := runtime.NumCPU()
+	numClients := runtime.GOMAXPROCS(0)
 	clients := make([]*innerClient, 0, numClients)
 	for i := 0; i < numClients; i++ {
 		C_client := C.hyperdex_client_create(C.CString(host), C.uint16_t(port))
@@ -1084,7 +1103,7 @@ func NewClient(host string, port int) (*Client, error, chan Error) {
 		clients = append(clients, client)
 	}
 	errChan := make(chan Error, 16)
-	client := &Client{0, sync.Mutex{}, clients, errChan}
+	client := &Client{0, clients, errChan}
 	for i := 0; i < len(clients); i++ {
 		go clients[i].runForever(errChan)
 	}
@@ -1120,11 +1139,8 @@ func (client *Client) AsynccallSpacenameKeyStatusAttributes(stub func(client *C.
 	var c_status C.enum_hyperdex_client_returncode
 	var c_attrs *C.struct_hyperdex_client_attribute
 	var c_attrs_sz C.size_t
-	done := make(chan Error)
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	done := make(chan Error, 1)
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_key, c_key_sz, &c_status, &c_attrs, &c_attrs_sz)
 	if reqid >= 0 {
@@ -1181,11 +1197,8 @@ func (client *Client) AsynccallSpacenameKeyAttributenamesStatusAttributes(stub f
 	var c_status C.enum_hyperdex_client_returncode
 	var c_attrs *C.struct_hyperdex_client_attribute
 	var c_attrs_sz C.size_t
-	done := make(chan Error)
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	done := make(chan Error, 1)
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_key, c_key_sz, c_attrnames, c_attrnames_sz, &c_status, &c_attrs, &c_attrs_sz)
 	if reqid >= 0 {
@@ -1240,11 +1253,8 @@ func (client *Client) AsynccallSpacenameKeyAttributesStatus(stub func(client *C.
 		return
 	}
 	var c_status C.enum_hyperdex_client_returncode
-	done := make(chan Error)
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	done := make(chan Error, 1)
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_key, c_key_sz, c_attrs, c_attrs_sz, &c_status)
 	if reqid >= 0 {
@@ -1298,11 +1308,8 @@ func (client *Client) AsynccallSpacenameKeyPredicatesAttributesStatus(stub func(
 		return
 	}
 	var c_status C.enum_hyperdex_client_returncode
-	done := make(chan Error)
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	done := make(chan Error, 1)
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_key, c_key_sz, c_checks, c_checks_sz, c_attrs, c_attrs_sz, &c_status)
 	if reqid >= 0 {
@@ -1350,11 +1357,8 @@ func (client *Client) AsynccallSpacenamePredicatesAttributesStatusCount(stub fun
 	}
 	var c_status C.enum_hyperdex_client_returncode
 	var c_count C.uint64_t
-	done := make(chan Error)
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	done := make(chan Error, 1)
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_checks, c_checks_sz, c_attrs, c_attrs_sz, &c_status, &c_count)
 	if reqid >= 0 {
@@ -1397,11 +1401,8 @@ func (client *Client) AsynccallSpacenameKeyStatus(stub func(client *C.struct_hyp
 		return
 	}
 	var c_status C.enum_hyperdex_client_returncode
-	done := make(chan Error)
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	done := make(chan Error, 1)
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_key, c_key_sz, &c_status)
 	if reqid >= 0 {
@@ -1448,11 +1449,8 @@ func (client *Client) AsynccallSpacenameKeyPredicatesStatus(stub func(client *C.
 		return
 	}
 	var c_status C.enum_hyperdex_client_returncode
-	done := make(chan Error)
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	done := make(chan Error, 1)
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_key, c_key_sz, c_checks, c_checks_sz, &c_status)
 	if reqid >= 0 {
@@ -1493,11 +1491,8 @@ func (client *Client) AsynccallSpacenamePredicatesStatusCount(stub func(client *
 	}
 	var c_status C.enum_hyperdex_client_returncode
 	var c_count C.uint64_t
-	done := make(chan Error)
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	done := make(chan Error, 1)
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_checks, c_checks_sz, &c_status, &c_count)
 	if reqid >= 0 {
@@ -1547,11 +1542,8 @@ func (client *Client) AsynccallSpacenameKeyMapattributesStatus(stub func(client
 		return
 	}
 	var c_status C.enum_hyperdex_client_returncode
-	done := make(chan Error)
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	done := make(chan Error, 1)
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_key, c_key_sz, c_mapattrs, c_mapattrs_sz, &c_status)
 	if reqid >= 0 {
@@ -1605,11 +1597,8 @@ func (client *Client) AsynccallSpacenameKeyPredicatesMapattributesStatus(stub fu
 		return
 	}
 	var c_status C.enum_hyperdex_client_returncode
-	done := make(chan Error)
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	done := make(chan Error, 1)
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_key, c_key_sz, c_checks, c_checks_sz, c_mapattrs, c_mapattrs_sz, &c_status)
 	if reqid >= 0 {
@@ -1657,11 +1646,8 @@ func (client *Client) AsynccallSpacenamePredicatesMapattributesStatusCount(stub
 	}
 	var c_status C.enum_hyperdex_client_returncode
 	var c_count C.uint64_t
-	done := make(chan Error)
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	done := make(chan Error, 1)
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_checks, c_checks_sz, c_mapattrs, c_mapattrs_sz, &c_status, &c_count)
 	if reqid >= 0 {
@@ -1714,10 +1700,7 @@ func (client *Client) IteratorSpacenamePredicatesStatusAttributes(stub func(clie
 		return
 	}
 	var err Error
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_checks, c_checks_sz, &c_iter.status, &c_iter.attrs, &c_iter.attrs_sz)
 	if reqid >= 0 {
@@ -1755,11 +1738,8 @@ func (client *Client) AsynccallSpacenamePredicatesStatusDescription(stub func(cl
 	}
 	var c_status C.enum_hyperdex_client_returncode
 	var c_description *C.char
-	done := make(chan Error)
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	done := make(chan Error, 1)
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_checks, c_checks_sz, &c_status, &c_description)
 	if reqid >= 0 {
@@ -1839,10 +1819,7 @@ func (client *Client) IteratorSpacenamePredicatesSortbyLimitMaxminStatusAttribut
 		return
 	}
 	var err Error
-	client.mutex.Lock()
-	inner := client.clients[client.counter%uint64(len(client.clients))]
-	client.counter++
-	client.mutex.Unlock()
+	inner := client.nextClient()
 	inner.mutex.Lock()
 	reqid := stub(inner.ptr, c_space, c_checks, c_checks_sz, c_sort_by, c_limit, c_maxmin, &c_iter.status, &c_iter.attrs, &c_iter.attrs_sz)
 	if reqid >= 0 {
@@ -32,6 +32,7 @@ package org.hyperdex.client;
 import java.util.List;
 import java.util.Map;
 import java.util.HashMap;
+import java.util.ArrayList;
 
 public class Client
 {
@@ -107,6 +108,36 @@ public class Client
     {
         ops.remove(l);
     }
+    /* batches: issue one get or put per key with a single call into JNI.
+     * Keys and values may be direct ByteBuffers to skip the byte[] copy. */
+    public native Deferred[] async_get_batch(String spacename, List<?> keys) throws HyperDexClientException;
+    public List<Map<String, Object>> get_batch(String spacename, List<?> keys) throws HyperDexClientException
+    {
+        Deferred[] ds = async_get_batch(spacename, keys);
+        List<Map<String, Object>> results = new ArrayList<Map<String, Object>>(ds.length);
+
+        for (Deferred d : ds)
+        {
+            results.add((Map<String, Object>) d.waitForIt());
+        }
+
+        return results;
+    }
+
+    public native Deferred[] async_put_batch(String spacename, List<?> keys, List<? extends Map<String, Object>> attributes) throws HyperDexClientException;
+    public List<Boolean> put_batch(String spacename, List<?> keys, List<? extends Map<String, Object>> attributes) throws HyperDexClientException
+    {
+        Deferred[] ds = async_put_batch(spacename, keys, attributes);
+        List<Boolean> results = new ArrayList<Boolean>(ds.length);
+
+        for (Deferred d : ds)
+        {
+            results.add((Boolean) d.waitForIt());
+        }
+
+        return results;
+    }
+
     /* operations */
     public native Deferred async_get(String spacename, Object key) throws HyperDexClientException;
     public Map<String, Object> get(String spacename, Object key) throws HyperDexClientException
@@ -59,6 +59,13 @@ static jmethodID _byte_string_init;
 static jmethodID _byte_string_get;
 static jmethodID _byte_string_to_string;
 
+static jclass _byte_buffer;
+static jmethodID _byte_buffer_position;
+static jmethodID _byte_buffer_remaining;
+static jmethodID _byte_buffer_hasArray;
+static jmethodID _byte_buffer_array;
+static jmethodID _byte_buffer_arrayOffset;
+
 static jclass _document;
 static jmethodID _document_init;
 static jmethodID _document_to_string;
@@ -182,6 +189,13 @@ Java_org_hyperdex_client_Client_initialize(JNIEnv* env, jclass client)
     _byte_string_init = (*env)->GetMethodID(env, _byte_string, "<init>", "([B)V");
     _byte_string_get = (*env)->GetMethodID(env, _byte_string, "getBytes", "()[B");
     _byte_string_to_string = (*env)->GetMethodID(env, _byte_string, "toString", "()Ljava/lang/String;");
+    /* cache class ByteBuffer */
+    REF(_byte_buffer, (*env)->FindClass(env, "java/nio/ByteBuffer"));
+    _byte_buffer_position = (*env)->GetMethodID(env, _byte_buffer, "position", "()I");
+    _byte_buffer_remaining = (*env)->GetMethodID(env, _byte_buffer, "remaining", "()I");
+    _byte_buffer_hasArray = (*env)->GetMethodID(env, _byte_buffer, "hasArray", "()Z");
+    _byte_buffer_array = (*env)->GetMethodID(env, _byte_buffer, "array", "()[B");
+    _byte_buffer_arrayOffset = (*env)->GetMethodID(env, _byte_buffer, "arrayOffset", "()I");
     /* cache class Boolean */
     REF(_boolean, (*env)->FindClass(env, "java/lang/Boolean"));
     _boolean_init = (*env)->GetMethodID(env, _boolean, "<init>", "(Z)V");
@@ -284,6 +298,12 @@ Java_org_hyperdex_client_Client_initialize(JNIEnv* env, jclass client)
     CHECK_CACHE(_byte_string_init);
     CHECK_CACHE(_byte_string_get);
     CHECK_CACHE(_byte_string_to_string);
+    CHECK_CACHE(_byte_buffer);
+    CHECK_CACHE(_byte_buffer_position);
+    CHECK_CACHE(_byte_buffer_remaining);
+    CHECK_CACHE(_byte_buffer_hasArray);
+    CHECK_CACHE(_byte_buffer_array);
+    CHECK_CACHE(_byte_buffer_arrayOffset);
     CHECK_CACHE(_boolean);
     CHECK_CACHE(_boolean_init);
     CHECK_CACHE(_long);
@@ -363,6 +383,7 @@ Java_org_hyperdex_client_Client_terminate(JNIEnv* env, jclass client)
     (*env)->DeleteGlobalRef(env, _document);
     (*env)->DeleteGlobalRef(env, _string);
     (*env)->DeleteGlobalRef(env, _byte_string);
+    (*env)->DeleteGlobalRef(env, _byte_buffer);
     (*env)->DeleteGlobalRef(env, _boolean);
     (*env)->DeleteGlobalRef(env, _long);
     (*env)->DeleteGlobalRef(env, _integer);
@@ -751,6 +772,64 @@ hyperdex_java_client_convert_map(JNIEnv* env,
     return 0;
 }
 
+/* Copy the remaining bytes of a ByteBuffer into the arena.  Direct buffers
+ * are read in place and heap buffers straight from their backing array, so
+ * either way the value is copied once, without an intermediate byte[]. */
+static int
+hyperdex_java_client_convert_byte_buffer(JNIEnv* env,
+                                         struct hyperdex_ds_arena* arena,
+                                         jobject x,
+                                         const char** value,
+                                         size_t* value_sz)
+{
+    jint position;
+    jint remaining;
+    jint offset;
+    jobject array;
+    char* base;
+    char* tmp;
+
+    position = (*env)->CallIntMethod(env, x, _byte_buffer_position);
+    ERROR_CHECK(-1);
+    remaining = (*env)->CallIntMethod(env, x, _byte_buffer_remaining);
+    ERROR_CHECK(-1);
+    tmp = hyperdex_ds_malloc(arena, remaining);
+
+    if (!tmp)
+    {
+        hyperdex_java_out_of_memory(env);
+        return -1;
+    }
+
+    base = (*env)->GetDirectBufferAddress(env, x);
+
+    if (base)
+    {
+        memcpy(tmp, base + position, remaining);
+    }
+    else if ((*env)->CallBooleanMethod(env, x, _byte_buffer_hasArray) == JNI_TRUE)
+    {
+        array = (*env)->CallObjectMethod(env, x, _byte_buffer_array);
+        ERROR_CHECK(-1);
+        offset = (*env)->CallIntMethod(env, x, _byte_buffer_arrayOffset);
+        ERROR_CHECK(-1);
+        (*env)->GetByteArrayRegion(env, array, offset + position, remaining, (jbyte*)tmp);
+        (*env)->DeleteLocalRef(env, array);
+        ERROR_CHECK(-1);
+    }
+    else
+    {
+        ERROR_CHECK(-1);
+        hyperdex_java_client_throw_exception(env, HYPERDEX_CLIENT_WRONGTYPE,
+                                             "Cannot convert a read-only heap ByteBuffer");
+        return -1;
+    }
+
+    *value = tmp;
+    *value_sz = remaining;
+    return 0;
+}
+
 static int
 hyperdex_java_client_convert_type(JNIEnv* env,
                                   struct hyperdex_ds_arena* arena,
@@ -838,6 +917,11 @@ hyperdex_java_client_convert_type(JNIEnv* env,
 
         return 0;
     }
+    else if ((*env)->IsInstanceOf(env, x, _byte_buffer) == JNI_TRUE)
+    {
+        *datatype = HYPERDATATYPE_STRING;
+        return hyperdex_java_client_convert_byte_buffer(env, arena, x, value, value_sz);
+    }
     else if ((*env)->IsInstanceOf(env, x, _long) == JNI_TRUE)
     {
         tmp_l = (*env)->CallLongMethod(env, x, _long_longValue);
@@ -2383,4 +2467,123 @@ Java_org_hyperdex_client_Client_inner_1loop(JNIEnv* env, jobject client)
     return y;
 }
 
+/* Issue a get (attributes == NULL) or put for every key in one crossing of
+ * JNI, and hand back the Deferred for each in the order of the keys.  The
+ * space name is converted once for the whole batch. */
+static jobjectArray
+hyperdex_java_client_batch(JNIEnv* env, jobject obj, jstring spacename,
+                           jobject keys, jobject attributes)
+{
+    struct hyperdex_client* client = hyperdex_get_client_ptr(env, obj);
+    struct hyperdex_ds_arena* arena = NULL;
+    struct hyperdex_java_client_deferred* o = NULL;
+    const char* in_space;
+    const char* in_key;
+    size_t in_key_sz;
+    const struct hyperdex_client_attribute* in_attrs;
+    size_t in_attrs_sz;
+    jobjectArray ops = NULL;
+    jobject key;
+    jobject attrs;
+    jobject op;
+    jint keys_sz;
+    jint i;
+
+    keys_sz = (*env)->CallIntMethod(env, keys, _list_size);
+    ERROR_CHECK(0);
+
+    if (attributes &&
+        (*env)->CallIntMethod(env, attributes, _list_size) != keys_sz)
+    {
+        ERROR_CHECK(0);
+        hyperdex_java_client_throw_exception(env, HYPERDEX_CLIENT_WRONGTYPE,
+                                             "Batches need one attribute map per key");
+        return 0;
+    }
+
+    ops = (*env)->NewObjectArray(env, keys_sz, _deferred, NULL);
+    ERROR_CHECK(0);
+    arena = hyperdex_ds_arena_create();
+
+    if (!arena)
+    {
+        hyperdex_java_out_of_memory(env);
+        return 0;
+    }
+
+    if (hyperdex_java_client_convert_spacename(env, obj, arena, spacename, &in_space) < 0)
+    {
+        goto error;
+    }
+
+    for (i = 0; i < keys_sz; ++i)
+    {
+        op = (*env)->NewObject(env, _deferred, _deferred_init, obj);
+        if ((*env)->ExceptionCheck(env) == JNI_TRUE) goto error;
+        o = hyperdex_get_deferred_ptr(env, op);
+        key = (*env)->CallObjectMethod(env, keys, _list_get, i);
+        if ((*env)->ExceptionCheck(env) == JNI_TRUE) goto error;
+
+        if (hyperdex_java_client_convert_key(env, obj, o->arena, key, &in_key, &in_key_sz) < 0)
+        {
+            goto error;
+        }
+
+        (*env)->DeleteLocalRef(env, key);
+
+        if (attributes)
+        {
+            attrs = (*env)->CallObjectMethod(env, attributes, _list_get, i);
+            if ((*env)->ExceptionCheck(env) == JNI_TRUE) goto error;
+
+            if (hyperdex_java_client_convert_attributes(env, obj, o->arena, attrs, &in_attrs, &in_attrs_sz) < 0)
+            {
+                goto error;
+            }
+
+            (*env)->DeleteLocalRef(env, attrs);
+            o->reqid = hyperdex_client_put(client, in_space, in_key, in_key_sz,
+                                           in_attrs, in_attrs_sz, &o->status);
+            o->encode_return = hyperdex_java_client_deferred_encode_status;
+        }
+        else
+        {
+            o->reqid = hyperdex_client_get(client, in_space, in_key, in_key_sz,
+                                           &o->status, &o->attrs, &o->attrs_sz);
+            o->encode_return = hyperdex_java_client_deferred_encode_status_attributes;
+        }
+
+        if (o->reqid < 0)
+        {
+            hyperdex_java_client_throw_exception(env, o->status, hyperdex_client_error_message(client));
+            goto error;
+        }
+
+        (*env)->CallObjectMethod(env, obj, _client_add_op, o->reqid, op);
+        if ((*env)->ExceptionCheck(env) == JNI_TRUE) goto error;
+        (*env)->SetObjectArrayElement(env, ops, i, op);
+        if ((*env)->ExceptionCheck(env) == JNI_TRUE) goto error;
+        (*env)->DeleteLocalRef(env, op);
+    }
+
+    hyperdex_ds_arena_destroy(arena);
+    return ops;
+
+error:
+    hyperdex_ds_arena_destroy(arena);
+    return 0;
+}
+
+JNIEXPORT HYPERDEX_API jobjectArray JNICALL
+Java_org_hyperdex_client_Client_async_1get_1batch(JNIEnv* env, jobject obj, jstring spacename, jobject keys)
+{
+    return hyperdex_java_client_batch(env, obj, spacename, keys, NULL);
+}
+
+JNIEXPORT HYPERDEX_API jobjectArray JNICALL
+Java_org_hyperdex_client_Client_async_1put_1batch(JNIEnv* env, jobject obj, jstring spacename, jobject keys, jobject attributes)
+{
+    return hyperdex_java_client_batch(env, obj, spacename, keys, attributes);
+}
+
 #include "bindings/java/org_hyperdex_client_Client.definitions.c"
@@ -47,6 +47,22 @@ JNIEXPORT HYPERDEX_API void JNICALL Java_org_hyperdex_client_Client__1destroy
 JNIEXPORT HYPERDEX_API jlong JNICALL Java_org_hyperdex_client_Client_inner_1loop
   (JNIEnv *, jobject);
 
+/*
+ * Class:     org_hyperdex_client_Client
+ * Method:    async_get_batch
+ * Signature: (Ljava/lang/String;Ljava/util/List;)[Lorg/hyperdex/client/Deferred;
+ */
+JNIEXPORT HYPERDEX_API jobjectArray JNICALL Java_org_hyperdex_client_Client_async_1get_1batch
+  (JNIEnv *, jobject, jstring, jobject);
+
+/*
+ * Class:     org_hyperdex_client_Client
+ * Method:    async_put_batch
+ * Signature: (Ljava/lang/String;Ljava/util/List;Ljava/util/List;)[Lorg/hyperdex/client/Deferred;
+ */
+JNIEXPORT HYPERDEX_API jobjectArray JNICALL Java_org_hyperdex_client_Client_async_1put_1batch
+  (JNIEnv *, jobject, jstring, jobject, jobject);
+
 /*
  * Class:     org_hyperdex_client_Client
  * Method:    async_get
@@ -31,6 +31,7 @@
 
 // STL
 #include <map>
+#include <string>
 #include <vector>
 
 // e
@@ -48,6 +49,10 @@
 
 #define HYPERDEX_NODE_INCLUDED_CLIENT_CC
 
+// The most completions one pass of the thread pool will pull out of
+// hyperdex_client_loop; they are all handed to JavaScript in a single tick.
+#define HYPERDEX_NODE_BATCH_SIZE 256
+
 namespace hyperdex
 {
 namespace nodejs
@@ -97,10 +102,52 @@ class HyperDexClient : public node::ObjectWrap
         void loop(int timeout);
         void poll_start();
         void poll_stop();
+        void invoke(v8::Handle<v8::Function> callback,
+                    int argc, v8::Handle<v8::Value>* argv);
+
+    public:
+        // Held by the main thread around every call into hyperdex_client
+        // so that it never overlaps the thread pool draining completions.
+        // Guards nest, because callbacks run under one may issue new ops.
+        class guard
+        {
+            public:
+                guard(HyperDexClient* c);
+                ~guard() throw ();
+
+            private:
+                guard(const guard&);
+                guard& operator = (const guard&);
+
+            private:
+                HyperDexClient* m_c;
+        };
 
     public:
         static void poll_callback(uv_poll_t* watcher, int status, int revents);
         static void poll_cleanup(uv_handle_t* handle);
+        static void work_callback(uv_work_t* req);
+        static void after_work_callback(uv_work_t* req, int status);
+
+    private:
+        // What hyperdex_client_loop wrote into an operation, copied out
+        // before the next call to loop can overwrite it.
+        struct completion
+        {
+            completion();
+            int64_t reqid;
+            hyperdex_client_returncode status;
+            const hyperdex_client_attribute* attrs;
+            size_t attrs_sz;
+            std::string error;
+        };
+
+    private:
+        void work_start();
+        void work();
+        void after_work();
+        bool next(int timeout, completion* c);
+        void deliver(completion* c);
 
     private:
         hyperdex_client* m_cl;
@@ -108,12 +155,27 @@ class HyperDexClient : public node::ObjectWrap
         v8::Persistent<v8::Object> m_callback;
         uv_poll_t* m_poll;
         bool m_poll_active;
+        uv_mutex_t m_mtx;
+        unsigned m_guards;
+        uv_work_t m_work;
+        bool m_work_active;
+        std::vector<completion> m_batch;
+        bool m_batching;
 };
 
 typedef int (*elem_string_fptr)(void*, const char*, size_t, enum hyperdex_ds_returncode*);
 typedef int (*elem_int_fptr)(void*, int64_t, enum hyperdex_ds_returncode*);
 typedef int (*elem_float_fptr)(void*, double, enum hyperdex_ds_returncode*);
 
+// The attributes returned by one call, shared by every Buffer that points
+// into them; the last Buffer to be collected frees them.
+struct attrs_ref
+{
+    const hyperdex_client_attribute* attrs;
+    size_t attrs_sz;
+    size_t refcount;
+};
+
 class Operation
 {
     public:
@@ -193,6 +255,7 @@ class Operation
         bool set_auth_context(v8::Handle<v8::Value> &_value);
         bool clear_auth_context();
 
+        static void release_attrs(char* data, void* hint);
         bool build_string(const char* value, size_t value_sz,
                           v8::Local<v8::Value>& retval,
                           v8::Local<v8::Value>& error);
@@ -268,6 +331,8 @@ class Operation
         void make_callback_done();
         static v8::Local<v8::Value> error_from_status(hyperdex_client* client,
                                                       hyperdex_client_returncode status);
+        static v8::Local<v8::Value> error_from_status(const char* msg,
+                                                      hyperdex_client_returncode status);
         v8::Local<v8::Value> error_from_status();
         v8::Local<v8::Value> error_message(const char* msg);
         v8::Local<v8::Value> error_out_of_memory();
@@ -287,6 +352,7 @@ class Operation
         bool finished;
         void (Operation::*encode_return)();
         const char **m_auth;
+        std::string error_msg;
 
     private:
         void inc() { ++m_ref; }
@@ -296,6 +362,7 @@ class Operation
     private:
         size_t m_ref;
         hyperdex_ds_arena* m_arena;
+        attrs_ref* m_attrs_ref;
         v8::Persistent<v8::Object> m_client;
         v8::Persistent<v8::Object> m_callback;
         v8::Persistent<v8::Object> m_callback_done;
@@ -434,7 +501,16 @@ HyperDexClient :: HyperDexClient(const char* host, uint16_t port)
     : m_cl(hyperdex_client_create(host, port))
     , m_poll(NULL)
     , m_poll_active(false)
+    , m_mtx()
+    , m_guards(0)
+    , m_work()
+    , m_work_active(false)
+    , m_batch()
+    , m_batching(false)
 {
+    uv_mutex_init(&m_mtx);
+    m_work.data = this;
+
     if (m_cl)
     {
         m_poll = new uv_poll_t;
@@ -450,6 +526,10 @@ HyperDexClient :: HyperDexClient(const char* host, uint16_t port)
 
 HyperDexClient :: ~HyperDexClient() throw ()
 {
+    // Every pass of the thread pool holds a reference to this client
+    // through the operations it drains, so none can be in flight here.
+    assert(!m_work_active);
+
     if (m_cl)
     {
         hyperdex_client_destroy(m_cl);
@@ -467,50 +547,62 @@ HyperDexClient :: ~HyperDexClient() throw ()
         m_callback.Dispose();
         m_callback.Clear();
     }
+
+    uv_mutex_destroy(&m_mtx);
 }
 
 void
 HyperDexClient :: add(int64_t reqid, e::intrusive_ptr<Operation> op)
 {
+    // callers hold a guard
     m_ops[reqid] = op;
-    poll_start();
+
+    if (!m_work_active)
+    {
+        poll_start();
+    }
 }
 
 void
 HyperDexClient :: loop(int timeout)
 {
-    enum hyperdex_client_returncode rc;
-    int64_t ret = hyperdex_client_loop(m_cl, timeout, &rc);
+    completion c;
+    bool got;
 
-    if (ret < 0 && timeout == 0 && rc == HYPERDEX_CLIENT_TIMEOUT)
     {
-        return;
+        guard g(this);
+        got = next(timeout, &c);
     }
 
-    if (ret < 0)
+    if (got)
     {
-        v8::Local<v8::Object> obj = v8::Local<v8::Object>::New(m_callback);
-        v8::Local<v8::Function> callback
-            = obj->Get(v8::String::NewSymbol("callback")).As<v8::Function>();
-        v8::Local<v8::Value> err = Operation::error_from_status(m_cl, rc);
-        v8::Handle<v8::Value> argv[] = { err };
-        node::MakeCallback(v8::Context::GetCurrent()->Global(), callback, 1, argv);
-        return;
+        deliver(&c);
     }
 
-    std::map<int64_t, e::intrusive_ptr<Operation> >::iterator it;
-    it = m_ops.find(ret);
-    assert(it != m_ops.end());
-    (*it->second.*it->second->encode_return)();
+    if (m_ops.empty())
+    {
+        poll_stop();
+    }
+}
 
-    if (it->second->finished)
+void
+HyperDexClient :: invoke(v8::Handle<v8::Function> callback,
+                         int argc, v8::Handle<v8::Value>* argv)
+{
+    if (!m_batching)
     {
-        m_ops.erase(it);
+        node::MakeCallback(v8::Context::GetCurrent()->Global(), callback, argc, argv);
+        return;
     }
 
-    if (m_ops.empty())
+    // Inside a batch, skip the per-call tick processing that MakeCallback
+    // does; after_work runs it once when the whole batch is delivered.
+    v8::TryCatch try_catch;
+    callback->Call(v8::Context::GetCurrent()->Global(), argc, argv);
+
+    if (try_catch.HasCaught())
     {
-        poll_stop();
+        node::FatalException(try_catch);
     }
 }
 
@@ -545,7 +637,7 @@ HyperDexClient :: poll_callback(uv_poll_t* watcher, int status, int revents)
 
     if (cl)
     {
-        cl->loop(0);
+        cl->work_start();
     }
 }
 
@@ -560,6 +652,201 @@ HyperDexClient :: poll_cleanup(uv_handle_t* handle)
     }
 }
 
+void
+HyperDexClient :: work_callback(uv_work_t* req)
+{
+    HyperDexClient* cl = reinterpret_cast<HyperDexClient*>(req->data);
+    cl->work();
+}
+
+void
+HyperDexClient :: after_work_callback(uv_work_t* req, int status)
+{
+    HyperDexClient* cl = reinterpret_cast<HyperDexClient*>(req->data);
+    cl->after_work();
+}
+
+HyperDexClient :: completion :: completion()
+    : reqid(-1)
+    , status(HYPERDEX_CLIENT_GARBAGE)
+    , attrs(NULL)
+    , attrs_sz(0)
+    , error()
+{
+}
+
+void
+HyperDexClient :: work_start()
+{
+    if (m_work_active)
+    {
+        return;
+    }
+
+    // The fd stays readable until the pass drains it, so stop polling
+    // rather than waking the event loop on every iteration meanwhile.
+    poll_stop();
+    m_work_active = true;
+    uv_queue_work(uv_default_loop(), &m_work, work_callback, after_work_callback);
+}
+
+void
+HyperDexClient :: work()
+{
+    uv_mutex_lock(&m_mtx);
+
+    while (m_batch.size() < HYPERDEX_NODE_BATCH_SIZE)
+    {
+        completion c;
+
+        if (!next(0, &c))
+        {
+            break;
+        }
+
+        m_batch.push_back(c);
+
+        if (c.reqid < 0)
+        {
+            break;
+        }
+    }
+
+    uv_mutex_unlock(&m_mtx);
+}
+
+void
+HyperDexClient :: after_work()
+{
+    v8::HandleScope scope;
+    std::vector<completion> batch;
+    batch.swap(m_batch);
+    m_work_active = false;
+    m_batching = true;
+
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        deliver(&batch[i]);
+    }
+
+    m_batching = false;
+    v8::Local<v8::Function> noop(v8::Local<v8::Function>::New(global_err));
+    node::MakeCallback(v8::Context::GetCurrent()->Global(), noop, 0, NULL);
+
+    if (m_ops.empty())
+    {
+        return;
+    }
+
+    // a full batch likely left more behind; go straight back for it
+    if (batch.size() >= HYPERDEX_NODE_BATCH_SIZE)
+    {
+        work_start();
+    }
+    else
+    {
+        poll_start();
+    }
+}
+
+bool
+HyperDexClient :: next(int timeout, completion* c)
+{
+    // callers hold a guard
+    enum hyperdex_client_returncode rc;
+    int64_t ret = hyperdex_client_loop(m_cl, timeout, &rc);
+
+    if (ret < 0 && timeout == 0 && rc == HYPERDEX_CLIENT_TIMEOUT)
+    {
+        return false;
+    }
+
+    if (ret < 0)
+    {
+        c->reqid = ret;
+        c->status = rc;
+        c->error = hyperdex_client_error_message(m_cl);
+        return true;
+    }
+
+    std::map<int64_t, e::intrusive_ptr<Operation> >::iterator it;
+    it = m_ops.find(ret);
+    assert(it != m_ops.end());
+    Operation* op = it->second.get();
+    c->reqid = ret;
+    c->status = op->status;
+    c->attrs = op->attrs;
+    c->attrs_sz = op->attrs_sz;
+    op->attrs = NULL;
+    op->attrs_sz = 0;
+
+    if (op->status != HYPERDEX_CLIENT_SUCCESS &&
+        op->status != HYPERDEX_CLIENT_NOTFOUND &&
+        op->status != HYPERDEX_CLIENT_CMPFAIL &&
+        op->status != HYPERDEX_CLIENT_SEARCHDONE)
+    {
+        c->error = hyperdex_client_error_message(m_cl);
+    }
+
+    return true;
+}
+
+void
+HyperDexClient :: deliver(completion* c)
+{
+    if (c->reqid < 0)
+    {
+        v8::Local<v8::Object> obj = v8::Local<v8::Object>::New(m_callback);
+        v8::Local<v8::Function> callback
+            = obj->Get(v8::String::NewSymbol("callback")).As<v8::Function>();
+        v8::Local<v8::Value> err = Operation::error_from_status(c->error.c_str(), c->status);
+        v8::Handle<v8::Value> argv[] = { err };
+        invoke(callback, 1, argv);
+        return;
+    }
+
+    std::map<int64_t, e::intrusive_ptr<Operation> >::iterator it;
+    it = m_ops.find(c->reqid);
+    assert(it != m_ops.end());
+    e::intrusive_ptr<Operation> op = it->second;
+
+    if (op->attrs)
+    {
+        hyperdex_client_destroy_attrs(op->attrs, op->attrs_sz);
+    }
+
+    op->status = c->status;
+    op->attrs = c->attrs;
+    op->attrs_sz = c->attrs_sz;
+    op->error_msg = c->error;
+    c->attrs = NULL;
+    c->attrs_sz = 0;
+    (*op.*op->encode_return)();
+
+    if (op->finished)
+    {
+        guard g(this);
+        m_ops.erase(c->reqid);
+    }
+}
+
+HyperDexClient :: guard :: guard(HyperDexClient* c)
+    : m_c(c)
+{
+    if (m_c->m_guards++ == 0)
+    {
+        uv_mutex_lock(&m_c->m_mtx);
+    }
+}
+
+HyperDexClient :: guard :: ~guard() throw ()
+{
+    if (--m_c->m_guards == 0)
+    {
+        uv_mutex_unlock(&m_c->m_mtx);
+    }
+}
+
 v8::Handle<v8::Value>
 HyperDexClient :: loop(const v8::Arguments& args)
 {
@@ -858,8 +1145,10 @@ Operation :: Operation(v8::Handle<v8::Object>& c1, HyperDexClient* c2)
     , finished(false)
     , encode_return()
     , m_auth(NULL)
+    , error_msg()
     , m_ref(0)
     , m_arena(hyperdex_ds_arena_create())
+    , m_attrs_ref(NULL)
     , m_client()
     , m_callback()
     , m_callback_done()
@@ -1769,13 +2058,39 @@ Operation :: clear_auth_context()
     return true;
 }
 
+void
+Operation :: release_attrs(char*, void* hint)
+{
+    attrs_ref* ref = reinterpret_cast<attrs_ref*>(hint);
+    assert(ref->refcount > 0);
+
+    if (--ref->refcount == 0)
+    {
+        hyperdex_client_destroy_attrs(ref->attrs, ref->attrs_sz);
+        delete ref;
+    }
+}
+
 bool
 Operation :: build_string(const char* value, size_t value_sz,
                           v8::Local<v8::Value>& retval,
                           v8::Local<v8::Value>& error)
 {
-    node::Buffer* buf = node::Buffer::New(value_sz);
-    memmove(node::Buffer::Data(buf), value, value_sz);
+    node::Buffer* buf = NULL;
+
+    if (m_attrs_ref)
+    {
+        // value lies within the attributes being built; point at it
+        ++m_attrs_ref->refcount;
+        buf = node::Buffer::New(const_cast<char*>(value), value_sz,
+                                release_attrs, m_attrs_ref);
+    }
+    else
+    {
+        buf = node::Buffer::New(value_sz);
+        memmove(node::Buffer::Data(buf), value, value_sz);
+    }
+
     v8::Local<v8::Object> global = v8::Context::GetCurrent()->Global();
     v8::Local<v8::Function> buf_ctor
         = v8::Local<v8::Function>::Cast(global->Get(v8::String::NewSymbol("Buffer")));
@@ -2549,24 +2864,35 @@ Operation :: build_attributes(v8::Local<v8::Value>& retval,
 {
     v8::Local<v8::Object> obj(v8::Object::New());
 
-    for (size_t i = 0; i < attrs_sz; ++i)
+    // The Buffers built below share the attributes instead of copying
+    // them; this reference keeps them alive until the loop is done.
+    m_attrs_ref = new attrs_ref;
+    m_attrs_ref->attrs = attrs;
+    m_attrs_ref->attrs_sz = attrs_sz;
+    m_attrs_ref->refcount = 1;
+    attrs = NULL;
+    attrs_sz = 0;
+    bool built = true;
+
+    for (size_t i = 0; built && i < m_attrs_ref->attrs_sz; ++i)
     {
+        const hyperdex_client_attribute* attr = m_attrs_ref->attrs + i;
         v8::Local<v8::Value> val;
+        built = build_attribute(attr, val, error);
 
-        if (!build_attribute(attrs + i, val, error))
+        if (built)
         {
-            retval = v8::Local<v8::Value>::New(v8::Undefined());
-            return;
+            obj->Set(v8::String::New(attr->attr), val);
         }
-
-        obj->Set(v8::String::New(attrs[i].attr), val);
     }
 
-    if (attrs)
+    release_attrs(NULL, m_attrs_ref);
+    m_attrs_ref = NULL;
+
+    if (!built)
     {
-        hyperdex_client_destroy_attrs(attrs, attrs_sz);
-        attrs = NULL;
-        attrs_sz = 0;
+        retval = v8::Local<v8::Value>::New(v8::Undefined());
+        return;
     }
 
     retval = obj;
@@ -2737,7 +3063,7 @@ Operation :: make_callback(v8::Handle<v8::Value>& first,
 {
     v8::Local<v8::Function> callback = v8::Local<v8::Object>::New(m_callback)->Get(v8::String::NewSymbol("callback")).As<v8::Function>();
     v8::Handle<v8::Value> argv[] = { first, second };
-    node::MakeCallback(v8::Context::GetCurrent()->Global(), callback, 2, argv);
+    client->invoke(callback, 2, argv);
 }
 
 void
@@ -2745,17 +3071,22 @@ Operation :: make_callback_done()
 {
     assert(m_has_callback_done);
     v8::Local<v8::Function> callback = v8::Local<v8::Object>::New(m_callback_done)->Get(v8::String::NewSymbol("callback")).As<v8::Function>();
-    v8::Handle<v8::Value> argv[] = {};
-    node::MakeCallback(v8::Context::GetCurrent()->Global(), callback, 0, argv);
+    client->invoke(callback, 0, NULL);
 }
 
 v8::Local<v8::Value>
 Operation :: error_from_status(hyperdex_client* client,
                                hyperdex_client_returncode status)
+{
+    return error_from_status(hyperdex_client_error_message(client), status);
+}
+
+v8::Local<v8::Value>
+Operation :: error_from_status(const char* msg,
+                               hyperdex_client_returncode status)
 {
     v8::Local<v8::Object> obj(v8::Object::New());
-    obj->Set(v8::String::New("msg"),
-             v8::String::New(hyperdex_client_error_message(client)));
+    obj->Set(v8::String::New("msg"), v8::String::New(msg));
     obj->Set(v8::String::New("sym"),
              v8::String::New(hyperdex_client_returncode_to_string(status)));
     return obj;
@@ -2764,6 +3095,12 @@ Operation :: error_from_status(hyperdex_client* client,
 v8::Local<v8::Value>
 Operation :: error_from_status()
 {
+    // completions carry the message that went with them out of the loop
+    if (!error_msg.empty())
+    {
+        return Operation::error_from_status(error_msg.c_str(), status);
+    }
+
     return Operation::error_from_status(client->client(), status);
 }
 
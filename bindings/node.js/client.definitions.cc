@@ -55,6 +55,7 @@ HyperDexClient :: asynccall__spacename_key__status_attributes(int64_t (*f)(struc
     size_t in_key_sz;
     v8::Local<v8::Value> key = args[1];
     if (!op->convert_key(key, &in_key, &in_key_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     if (bDoAuth)
     {
         v8::Handle<v8::Value> M = args[base_args_sz];
@@ -106,6 +107,7 @@ HyperDexClient :: asynccall__spacename_key_attributenames__status_attributes(int
     size_t in_attrnames_sz;
     v8::Local<v8::Value> attributenames = args[2];
     if (!op->convert_attributenames(attributenames, &in_attrnames, &in_attrnames_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     if (bDoAuth)
     {
         v8::Handle<v8::Value> M = args[base_args_sz];
@@ -157,6 +159,7 @@ HyperDexClient :: asynccall__spacename_key_attributes__status(int64_t (*f)(struc
     size_t in_attrs_sz;
     v8::Local<v8::Value> attributes = args[2];
     if (!op->convert_attributes(attributes, &in_attrs, &in_attrs_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     if (bDoAuth)
     {
         v8::Handle<v8::Value> M = args[base_args_sz];
@@ -212,6 +215,7 @@ HyperDexClient :: asynccall__spacename_key_predicates_attributes__status(int64_t
     size_t in_attrs_sz;
     v8::Local<v8::Value> attributes = args[3];
     if (!op->convert_attributes(attributes, &in_attrs, &in_attrs_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     if (bDoAuth)
     {
         v8::Handle<v8::Value> M = args[base_args_sz];
@@ -263,6 +267,7 @@ HyperDexClient :: asynccall__spacename_predicates_attributes__status_count(int64
     size_t in_attrs_sz;
     v8::Local<v8::Value> attributes = args[2];
     if (!op->convert_attributes(attributes, &in_attrs, &in_attrs_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     if (bDoAuth)
     {
         v8::Handle<v8::Value> M = args[base_args_sz];
@@ -310,6 +315,7 @@ HyperDexClient :: asynccall__spacename_key__status(int64_t (*f)(struct hyperdex_
     size_t in_key_sz;
     v8::Local<v8::Value> key = args[1];
     if (!op->convert_key(key, &in_key, &in_key_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     if (bDoAuth)
     {
         v8::Handle<v8::Value> M = args[base_args_sz];
@@ -361,6 +367,7 @@ HyperDexClient :: asynccall__spacename_key_predicates__status(int64_t (*f)(struc
     size_t in_checks_sz;
     v8::Local<v8::Value> predicates = args[2];
     if (!op->convert_predicates(predicates, &in_checks, &in_checks_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     if (bDoAuth)
     {
         v8::Handle<v8::Value> M = args[base_args_sz];
@@ -408,6 +415,7 @@ HyperDexClient :: asynccall__spacename_predicates__status_count(int64_t (*f)(str
     size_t in_checks_sz;
     v8::Local<v8::Value> predicates = args[1];
     if (!op->convert_predicates(predicates, &in_checks, &in_checks_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     if (bDoAuth)
     {
         v8::Handle<v8::Value> M = args[base_args_sz];
@@ -459,6 +467,7 @@ HyperDexClient :: asynccall__spacename_key_mapattributes__status(int64_t (*f)(st
     size_t in_mapattrs_sz;
     v8::Local<v8::Value> mapattributes = args[2];
     if (!op->convert_mapattributes(mapattributes, &in_mapattrs, &in_mapattrs_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     if (bDoAuth)
     {
         v8::Handle<v8::Value> M = args[base_args_sz];
@@ -514,6 +523,7 @@ HyperDexClient :: asynccall__spacename_key_predicates_mapattributes__status(int6
     size_t in_mapattrs_sz;
     v8::Local<v8::Value> mapattributes = args[3];
     if (!op->convert_mapattributes(mapattributes, &in_mapattrs, &in_mapattrs_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     if (bDoAuth)
     {
         v8::Handle<v8::Value> M = args[base_args_sz];
@@ -565,6 +575,7 @@ HyperDexClient :: asynccall__spacename_predicates_mapattributes__status_count(in
     size_t in_mapattrs_sz;
     v8::Local<v8::Value> mapattributes = args[2];
     if (!op->convert_mapattributes(mapattributes, &in_mapattrs, &in_mapattrs_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     if (bDoAuth)
     {
         v8::Handle<v8::Value> M = args[base_args_sz];
@@ -616,6 +627,7 @@ HyperDexClient :: iterator__spacename_predicates__status_attributes(int64_t (*f)
     size_t in_checks_sz;
     v8::Local<v8::Value> predicates = args[1];
     if (!op->convert_predicates(predicates, &in_checks, &in_checks_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     op->reqid = f(client->client(), in_space, in_checks, in_checks_sz, &op->status, &op->attrs, &op->attrs_sz);
 
     if (op->reqid < 0)
@@ -656,6 +668,7 @@ HyperDexClient :: asynccall__spacename_predicates__status_description(int64_t (*
     size_t in_checks_sz;
     v8::Local<v8::Value> predicates = args[1];
     if (!op->convert_predicates(predicates, &in_checks, &in_checks_sz)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     if (bDoAuth)
     {
         v8::Handle<v8::Value> M = args[base_args_sz];
@@ -716,6 +729,7 @@ HyperDexClient :: iterator__spacename_predicates_sortby_limit_maxmin__status_att
     int in_maxmin;
     v8::Local<v8::Value> maxmin = args[4];
     if (!op->convert_maxmin(maxmin, &in_maxmin)) return scope.Close(v8::Undefined());
+    HyperDexClient::guard g(client);
     op->reqid = f(client->client(), in_space, in_checks, in_checks_sz, in_sort_by, in_limit, in_maxmin, &op->status, &op->attrs, &op->attrs_sz);
 
     if (op->reqid < 0)
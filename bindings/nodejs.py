@@ -111,6 +111,8 @@ def generate_worker_definitions(xs, lib):
             func += '    v8::Local<v8::Value> {0} = args[{1}];\n'.format(arg.__name__.lower(), idx)
             func += '    if (!op->convert_{0}({0}, {1})) return scope.Close(v8::Undefined());\n'.format(arg.__name__.lower(), args)
 
+        func += '    HyperDexClient::guard g(client);\n'
+
         if wrap_auth_context:
             func += '    if (bDoAuth)\n    {\n'
             func += '        v8::Handle<v8::Value> M = args[base_args_sz];\n'
@@ -32,6 +32,8 @@ import calendar
 import time
 
 from cpython cimport bool
+from cpython cimport array
+import array
 
 
 cdef extern from "stdint.h":
@@ -924,6 +926,42 @@ cdef hyperdex_python_client_build_attributes(const hyperdex_client_attribute* at
     return ret
 
 
+# Append one search result to the columns of a BatchIterator.  Integers,
+# floats and timestamps are unpacked straight into the array's storage, so no
+# Python object is created for them; other types reuse the per-value builders.
+cdef hyperdex_python_client_batch_append(dict columns, const hyperdex_client_attribute* attrs, size_t attrs_sz):
+    cdef int64_t i = 0
+    cdef double d = 0
+    cdef array.array col
+    for idx in range(attrs_sz):
+        name = attrs[idx].attr
+        if (attrs[idx].datatype in
+             [HYPERDATATYPE_INT64, HYPERDATATYPE_TIMESTAMP_SECOND,
+             HYPERDATATYPE_TIMESTAMP_MINUTE,
+             HYPERDATATYPE_TIMESTAMP_HOUR, HYPERDATATYPE_TIMESTAMP_DAY,
+             HYPERDATATYPE_TIMESTAMP_WEEK, HYPERDATATYPE_TIMESTAMP_MONTH]):
+            if hyperdex_ds_unpack_int(attrs[idx].value, attrs[idx].value_sz, &i) < 0:
+                raise HyperDexClientException(HYPERDEX_CLIENT_SERVERERROR, "server sent malformed attributes")
+            if name not in columns:
+                columns[name] = array.array('l')
+            col = columns[name]
+            array.resize_smart(col, len(col) + 1)
+            col.data.as_longs[len(col) - 1] = i
+        elif attrs[idx].datatype == HYPERDATATYPE_FLOAT:
+            if hyperdex_ds_unpack_float(attrs[idx].value, attrs[idx].value_sz, &d) < 0:
+                raise HyperDexClientException(HYPERDEX_CLIENT_SERVERERROR, "server sent malformed attributes")
+            if name not in columns:
+                columns[name] = array.array('d')
+            col = columns[name]
+            array.resize_smart(col, len(col) + 1)
+            col.data.as_doubles[len(col) - 1] = d
+        elif attrs[idx].datatype == HYPERDATATYPE_STRING:
+            columns.setdefault(name, []).append(attrs[idx].value[:attrs[idx].value_sz])
+        else:
+            val = hyperdex_python_client_build_attributes(&attrs[idx], 1)[name]
+            columns.setdefault(name, []).append(val)
+
+
 cdef hyperdex_python_client_deferred_encode_status(Deferred d):
     if d.status == HYPERDEX_CLIENT_SUCCESS:
         return True
@@ -1193,6 +1231,96 @@ cdef class Iterator:
 
 
 
+# Like Iterator, but hands back the results of search() in batches of up to
+# batch_size objects rather than one dictionary per object.  Each batch is a
+# dictionary mapping every attribute to a column holding its value for each
+# object in the batch, in the same order.  Integer and float columns are
+# array.array buffers (typecodes 'l' and 'd') that numpy.frombuffer or an
+# Arrow array can wrap without another copy; timestamps come back as
+# microseconds since the epoch in an integer column.  Other columns are lists.
+cdef class BatchIterator:
+    cdef Client client
+    cdef hyperdex_ds_arena* arena
+    cdef int64_t reqid
+    cdef hyperdex_client_returncode status
+    cdef const hyperdex_client_attribute* attrs
+    cdef size_t attrs_sz
+    cdef size_t batch_size
+    cdef size_t rows
+    cdef dict columns
+    cdef list backlogged
+    cdef bint finished
+
+    def __cinit__(self, Client client, long batch_size):
+        if batch_size <= 0:
+            raise ValueError("batch_size must be positive")
+        self.client = client
+        self.arena = hyperdex_ds_arena_create()
+        if self.arena == NULL:
+            raise MemoryError()
+        self.reqid = -1
+        self.status = HYPERDEX_CLIENT_GARBAGE
+        self.attrs = NULL
+        self.attrs_sz = 0
+        self.batch_size = batch_size
+        self.rows = 0
+        self.columns = {}
+        self.backlogged = []
+        self.finished = False
+
+    def __dealloc__(self):
+        if self.arena:
+            hyperdex_ds_arena_destroy(self.arena)
+        if self.attrs:
+            hyperdex_client_destroy_attrs(self.attrs, self.attrs_sz)
+            self.attrs = NULL
+            self.attrs_sz = 0
+
+    def __iter__(self):
+        return self
+
+    def hasNext(self):
+        # Poll until a batch fills or the search completes
+        while not self.finished and not self.backlogged:
+            self.client.loop()
+
+        return self.backlogged
+
+    def __next__(self):
+        if self.hasNext():
+            return self.backlogged.pop(0)
+        else:
+            raise StopIteration()
+
+    cdef flush(self):
+        if self.rows > 0:
+            self.backlogged.append(self.columns)
+            self.columns = {}
+            self.rows = 0
+
+    def _callback(self):
+        if self.status == HYPERDEX_CLIENT_SEARCHDONE:
+            self.flush()
+            self.finished = True
+            del self.client.ops[self.reqid]
+        else:
+            try:
+                if self.status != HYPERDEX_CLIENT_SUCCESS:
+                    raise HyperDexClientException(self.status, hyperdex_client_error_message(self.client.client))
+                hyperdex_python_client_batch_append(self.columns, self.attrs, self.attrs_sz)
+                self.rows += 1
+                if self.rows >= self.batch_size:
+                    self.flush()
+            except HyperDexClientException as e:
+                self.flush()
+                self.backlogged.append(e)
+            finally:
+                if self.attrs:
+                    hyperdex_client_destroy_attrs(self.attrs, self.attrs_sz)
+                    self.attrs = NULL
+                    self.attrs_sz = 0
+
+
 cdef class Microtransaction:
     def __cinit__(self, Client c, bytes spacename):
         cdef const char* in_space
@@ -1548,6 +1676,19 @@ cdef class Client:
     def microtransaction_init(self, bytes spacename):
         return Microtransaction(self, spacename)
 
+    def search_batches(self, bytes spacename, dict predicates, long batch_size=1024):
+        cdef BatchIterator it = BatchIterator(self, batch_size)
+        cdef const char* in_space
+        cdef hyperdex_client_attribute_check* in_checks
+        cdef size_t in_checks_sz
+        self.convert_spacename(it.arena, spacename, &in_space);
+        self.convert_predicates(it.arena, predicates, &in_checks, &in_checks_sz);
+        it.reqid = hyperdex_client_search(self.client, in_space, in_checks, in_checks_sz, &it.status, &it.attrs, &it.attrs_sz);
+        if it.reqid < 0:
+            raise HyperDexClientException(it.status, hyperdex_client_error_message(self.client))
+        self.ops[it.reqid] = it
+        return it
+
     # Begin Automatically Generated Methods
     cdef asynccall__spacename_key__status_attributes(self, asynccall__spacename_key__status_attributes_fptr f, bytes spacename, key, auth=None):
         cdef Deferred d = Deferred(self)
@@ -29,8 +29,12 @@
 /* C */
 #include <assert.h>
 
+/* POSIX */
+#include <sys/time.h>
+
 /* Ruby */
 #include <ruby.h>
+#include <ruby/io.h>
 #include <intern.h>
 #include <st.h>
 
@@ -705,6 +709,30 @@ hyperdex_ruby_client_convert_attributenames(struct hyperdex_ds_arena* arena,
     }
 }
 
+static void
+hyperdex_ruby_client_convert_keys(struct hyperdex_ds_arena* arena,
+                                  VALUE x,
+                                  const char*** keys,
+                                  size_t** keys_sz,
+                                  size_t* num_keys)
+{
+    size_t i = 0;
+    *num_keys = RARRAY_LEN(x);
+    *keys = hyperdex_ds_malloc(arena, sizeof(char*) * (*num_keys));
+    *keys_sz = hyperdex_ds_malloc(arena, sizeof(size_t) * (*num_keys));
+
+    if (!(*keys) || !(*keys_sz))
+    {
+        hyperdex_ruby_out_of_memory();
+    }
+
+    for (i = 0; i < *num_keys; ++i)
+    {
+        hyperdex_ruby_client_convert_key(arena, rb_ary_entry(x, i),
+                                         &(*keys)[i], &(*keys_sz)[i]);
+    }
+}
+
 static void
 hyperdex_ruby_client_convert_sortby(struct hyperdex_ds_arena* arena,
                                     VALUE x,
@@ -1054,6 +1082,10 @@ struct hyperdex_ruby_client_deferred
     size_t attrs_sz;
     const char* description;
     uint64_t count;
+    size_t num_keys;
+    enum hyperdex_client_returncode* statuses;
+    const struct hyperdex_client_attribute** many_attrs;
+    size_t* many_attrs_sz;
     int finished;
     VALUE (*encode_return)(struct hyperdex_ruby_client_deferred* d);
 };
@@ -1072,8 +1104,19 @@ hyperdex_ruby_client_deferred_mark(struct hyperdex_ruby_client_deferred* dfrd)
 void
 hyperdex_ruby_client_deferred_free(struct hyperdex_ruby_client_deferred* dfrd)
 {
+    size_t i = 0;
+
     if (dfrd)
     {
+        /* the get_many arrays live in the arena */
+        for (i = 0; dfrd->many_attrs && i < dfrd->num_keys; ++i)
+        {
+            if (dfrd->many_attrs[i])
+            {
+                hyperdex_client_destroy_attrs(dfrd->many_attrs[i], dfrd->many_attrs_sz[i]);
+            }
+        }
+
         if (dfrd->arena)
         {
             hyperdex_ds_arena_destroy(dfrd->arena);
@@ -1122,6 +1165,10 @@ hyperdex_ruby_client_deferred_alloc(VALUE class)
     dfrd->attrs_sz = 0;
     dfrd->description = NULL;
     dfrd->count = 0;
+    dfrd->num_keys = 0;
+    dfrd->statuses = NULL;
+    dfrd->many_attrs = NULL;
+    dfrd->many_attrs_sz = NULL;
     dfrd->finished = 0;
     dfrd->encode_return = NULL;
     return Data_Wrap_Struct(class, hyperdex_ruby_client_deferred_mark, hyperdex_ruby_client_deferred_free, dfrd);
@@ -1214,6 +1261,42 @@ hyperdex_ruby_client_deferred_encode_status_attributes(struct hyperdex_ruby_clie
     }
 }
 
+static VALUE
+hyperdex_ruby_client_deferred_encode_status_many(struct hyperdex_ruby_client_deferred* d)
+{
+    struct hyperdex_client* client = NULL;
+    VALUE ret = Qnil;
+    size_t i = 0;
+    Data_Get_Struct(d->client, struct hyperdex_client, client);
+
+    if (d->status != HYPERDEX_CLIENT_SUCCESS)
+    {
+        hyperdex_ruby_client_throw_exception(d->status, hyperdex_client_error_message(client));
+        return Qnil;
+    }
+
+    ret = rb_ary_new2(d->num_keys);
+
+    for (i = 0; i < d->num_keys; ++i)
+    {
+        if (d->statuses[i] == HYPERDEX_CLIENT_SUCCESS)
+        {
+            rb_ary_push(ret, hyperdex_ruby_client_build_attributes(d->many_attrs[i], d->many_attrs_sz[i]));
+        }
+        else if (d->statuses[i] == HYPERDEX_CLIENT_NOTFOUND)
+        {
+            rb_ary_push(ret, Qnil);
+        }
+        else
+        {
+            hyperdex_ruby_client_throw_exception(d->statuses[i], hyperdex_client_error_message(client));
+            return Qnil;
+        }
+    }
+
+    return ret;
+}
+
 static VALUE
 hyperdex_ruby_client_deferred_encode_status_count(struct hyperdex_ruby_client_deferred* d)
 {
@@ -1458,6 +1541,49 @@ hyperdex_ruby_client_init(VALUE self, VALUE host, VALUE port)
     return self;
 }
 
+/* Calling hyperdex_client_loop with a timeout blocks while holding the GVL,
+ * stalling every other Ruby thread.  Instead, poll the client without
+ * blocking, and wait on its fd with the GVL released when nothing is ready.
+ * Every call into the client still happens with the GVL held, and that is
+ * what keeps threads sharing one client from racing on it.
+ */
+static int64_t
+hyperdex_ruby_client_loop_nogvl(struct hyperdex_client* client, int timeout,
+                                enum hyperdex_client_returncode* rc)
+{
+    struct timeval tv;
+    struct timeval* tvp = NULL;
+    int64_t ret;
+
+    if (timeout >= 0)
+    {
+        tv.tv_sec = timeout / 1000;
+        tv.tv_usec = (timeout % 1000) * 1000;
+        tvp = &tv;
+    }
+
+    while (1)
+    {
+        ret = hyperdex_client_loop(client, 0, rc);
+
+        if (ret >= 0 || *rc != HYPERDEX_CLIENT_TIMEOUT || timeout == 0)
+        {
+            return ret;
+        }
+
+        if (rb_wait_for_single_fd(hyperdex_client_poll_fd(client), RB_WAITFD_IN, tvp) == 0)
+        {
+            return ret;
+        }
+
+        /* a bounded wait gets one more look, not another full timeout */
+        if (tvp)
+        {
+            timeout = 0;
+        }
+    }
+}
+
 static VALUE
 hyperdex_ruby_client_loop(int argc, VALUE *argv, VALUE self)
 {
@@ -1474,7 +1600,7 @@ hyperdex_ruby_client_loop(int argc, VALUE *argv, VALUE self)
     }
 
     Data_Get_Struct(self, struct hyperdex_client, client);
-    ret = hyperdex_client_loop(client, NUM2INT(timeout), &rc);
+    ret = hyperdex_ruby_client_loop_nogvl(client, NUM2INT(timeout), &rc);
 
     if (ret < 0)
     {
@@ -1496,6 +1622,60 @@ hyperdex_ruby_client_loop(int argc, VALUE *argv, VALUE self)
 
 #include "bindings/ruby/definitions.c"
 
+static VALUE
+hyperdex_ruby_client_get_many(VALUE self, VALUE spacename, VALUE keys)
+{
+    VALUE op;
+    const char* in_space;
+    const char** in_keys;
+    size_t* in_keys_sz;
+    size_t i;
+    struct hyperdex_client* client;
+    struct hyperdex_ruby_client_deferred* o;
+    op = rb_class_new_instance(1, &self, class_deferred);
+    rb_iv_set(self, "tmp", op);
+    Data_Get_Struct(self, struct hyperdex_client, client);
+    Data_Get_Struct(op, struct hyperdex_ruby_client_deferred, o);
+    hyperdex_ruby_client_convert_spacename(o->arena, spacename, &in_space);
+    hyperdex_ruby_client_convert_keys(o->arena, keys, &in_keys, &in_keys_sz, &o->num_keys);
+    o->statuses = hyperdex_ds_malloc(o->arena, sizeof(enum hyperdex_client_returncode) * o->num_keys);
+    o->many_attrs = hyperdex_ds_malloc(o->arena, sizeof(struct hyperdex_client_attribute*) * o->num_keys);
+    o->many_attrs_sz = hyperdex_ds_malloc(o->arena, sizeof(size_t) * o->num_keys);
+
+    if (o->num_keys > 0 && (!o->statuses || !o->many_attrs || !o->many_attrs_sz))
+    {
+        o->many_attrs = NULL;
+        hyperdex_ruby_out_of_memory();
+    }
+
+    for (i = 0; i < o->num_keys; ++i)
+    {
+        o->statuses[i] = HYPERDEX_CLIENT_GARBAGE;
+        o->many_attrs[i] = NULL;
+        o->many_attrs_sz[i] = 0;
+    }
+
+    o->reqid = hyperdex_client_get_many(client, in_space, in_keys, in_keys_sz, o->num_keys,
+                                        &o->status, o->statuses, o->many_attrs, o->many_attrs_sz);
+
+    if (o->reqid < 0)
+    {
+        hyperdex_ruby_client_throw_exception(o->status, hyperdex_client_error_message(client));
+    }
+
+    o->encode_return = hyperdex_ruby_client_deferred_encode_status_many;
+    rb_hash_aset(rb_iv_get(self, "ops"), LONG2NUM(o->reqid), op);
+    rb_iv_set(self, "tmp", Qnil);
+    return op;
+}
+
+VALUE
+hyperdex_ruby_client_wait_get_many(VALUE self, VALUE spacename, VALUE keys)
+{
+    VALUE deferred = hyperdex_ruby_client_get_many(self, spacename, keys);
+    return rb_funcall(deferred, rb_intern("wait"), 0);
+}
+
 /********************************* Predicates *********************************/
 
 static void
@@ -1711,6 +1891,8 @@ Init_hyperdex_client()
     rb_define_alloc_func(class_client, hyperdex_ruby_client_alloc);
     rb_define_method(class_client, "initialize", hyperdex_ruby_client_init, 2);
     rb_define_method(class_client, "loop", hyperdex_ruby_client_loop, -1);
+    rb_define_method(class_client, "async_get_many", hyperdex_ruby_client_get_many, 2);
+    rb_define_method(class_client, "get_many", hyperdex_ruby_client_wait_get_many, 2);
 
     /* include the generated rb_define_* calls */
 #include "bindings/ruby/prototypes.c"
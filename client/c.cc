@@ -60,6 +60,7 @@ inline void return_void() {}
 #define C_WRAP_EXCEPT(X) \
     hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl); \
     SIGNAL_PROTECT; \
+    hyperdex::client::hold _hold(cl); \
     try \
     { \
         X \
@@ -123,6 +124,50 @@ hyperdex_client_create_conn_str(const char* conn_str)
     }
 }
 
+HYPERDEX_API hyperdex_client*
+hyperdex_client_create_shared(const char* coordinator, uint16_t port)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_ERR(NULL);
+    try
+    {
+        hyperdex::client* cl = new hyperdex::client(coordinator, port);
+        cl->set_shared();
+        return reinterpret_cast<hyperdex_client*>(cl);
+    }
+    catch (std::bad_alloc& ba)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    catch (...)
+    {
+        return NULL;
+    }
+}
+
+HYPERDEX_API hyperdex_client*
+hyperdex_client_create_shared_conn_str(const char* conn_str)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_ERR(NULL);
+    try
+    {
+        hyperdex::client* cl = new hyperdex::client(conn_str);
+        cl->set_shared();
+        return reinterpret_cast<hyperdex_client*>(cl);
+    }
+    catch (std::bad_alloc& ba)
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    catch (...)
+    {
+        return NULL;
+    }
+}
+
 HYPERDEX_API void
 hyperdex_client_destroy(hyperdex_client* client)
 {
@@ -176,6 +221,7 @@ hyperdex_client_returncode_to_string(enum hyperdex_client_returncode stat)
         CSTRINGIFY(HYPERDEX_CLIENT_CLUSTER_JUMP);
         CSTRINGIFY(HYPERDEX_CLIENT_OFFLINE);
         CSTRINGIFY(HYPERDEX_CLIENT_UNAUTHORIZED);
+        CSTRINGIFY(HYPERDEX_CLIENT_THROTTLED);
         CSTRINGIFY(HYPERDEX_CLIENT_INTERNAL);
         CSTRINGIFY(HYPERDEX_CLIENT_EXCEPTION);
         CSTRINGIFY(HYPERDEX_CLIENT_GARBAGE);
@@ -191,6 +237,7 @@ hyperdex_client_attribute_type(hyperdex_client* _cl,
 {
     SIGNAL_PROTECT_ERR(HYPERDATATYPE_GARBAGE);
     hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl); \
+    hyperdex::client::hold _hold(cl);
 
     try
     {
@@ -219,12 +266,21 @@ hyperdex_client_destroy_attrs(const hyperdex_client_attribute* attrs, size_t /*a
     free(const_cast<hyperdex_client_attribute*>(attrs));
 }
 
+HYPERDEX_API void
+hyperdex_client_destroy_aggregate_groups(const hyperdex_client_aggregate_group* groups, size_t /*groups_sz*/)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    free(const_cast<hyperdex_client_aggregate_group*>(groups));
+}
+
 HYPERDEX_API void
 hyperdex_client_clear_auth_context(struct hyperdex_client* _cl)
 {
     FAKE_STATUS;
     SIGNAL_PROTECT_VOID;
     hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
     cl->clear_auth_context();
 }
 
@@ -235,6 +291,7 @@ hyperdex_client_set_auth_context(struct hyperdex_client* _cl,
     FAKE_STATUS;
     SIGNAL_PROTECT_VOID;
     hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
     cl->set_auth_context(macaroons, macaroons_sz);
 }
 
@@ -246,6 +303,7 @@ hyperdex_client_uxact_init(struct hyperdex_client* _cl,
 
     SIGNAL_PROTECT_ERR(NULL);
     hyperdex::client *cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
     hyperdex::microtransaction *tx = cl->uxact_init(space, status);
 
     return reinterpret_cast<struct hyperdex_client_microtransaction*>(tx);
@@ -2304,6 +2362,187 @@ hyperdex_client_count(struct hyperdex_client* _cl,
     );
 }
 
+HYPERDEX_API int64_t
+hyperdex_client_get_many(struct hyperdex_client* _cl,
+                         const char* space,
+                         const char** keys, const size_t* keys_sz, size_t num_keys,
+                         enum hyperdex_client_returncode* status,
+                         enum hyperdex_client_returncode* statuses,
+                         const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->get_many(space, keys, keys_sz, num_keys, status, statuses, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_sorted_search_page(struct hyperdex_client* _cl,
+                                   const char* space,
+                                   const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                   const char* sort_by,
+                                   uint64_t limit,
+                                   int maxmin,
+                                   const char* cursor, size_t cursor_sz,
+                                   enum hyperdex_client_returncode* status,
+                                   const struct hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                                   const char** next_cursor, size_t* next_cursor_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->sorted_search_page(space, checks, checks_sz, sort_by, limit, maxmin,
+                                  cursor, cursor_sz, status, attrs, attrs_sz,
+                                  next_cursor, next_cursor_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_aggregate(struct hyperdex_client* _cl,
+                          const char* space,
+                          const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                          const struct hyperdex_client_aggregate* aggs, size_t aggs_sz,
+                          const char* group_by,
+                          enum hyperdex_client_returncode* status,
+                          const struct hyperdex_client_aggregate_group** groups, size_t* groups_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->aggregate(space, checks, checks_sz, aggs, aggs_sz, group_by, status, groups, groups_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_approximate_count(struct hyperdex_client* _cl,
+                                  const char* space,
+                                  const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                  double error,
+                                  enum hyperdex_client_returncode* status,
+                                  uint64_t* count)
+{
+    C_WRAP_EXCEPT(
+    return cl->approximate_count(space, checks, checks_sz, error, status, count);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_search_limit(struct hyperdex_client* _cl,
+                             const char* space,
+                             const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             uint64_t limit,
+                             enum hyperdex_client_returncode* status,
+                             const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->search_limit(space, checks, checks_sz, limit, status, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_get_relaxed(struct hyperdex_client* _cl,
+                            const char* space,
+                            const char* key, size_t key_sz,
+                            uint64_t staleness,
+                            enum hyperdex_client_returncode* status,
+                            const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->get_relaxed(space, key, key_sz, staleness, status, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_put_many(struct hyperdex_client* _cl,
+                         const char* space,
+                         const char** keys, const size_t* keys_sz,
+                         const struct hyperdex_client_attribute* const* attrs, const size_t* attrs_sz,
+                         size_t num_objects,
+                         enum hyperdex_client_returncode* status,
+                         enum hyperdex_client_returncode* statuses)
+{
+    C_WRAP_EXCEPT(
+    return cl->put_many(space, keys, keys_sz, attrs, attrs_sz, num_objects, status, statuses);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_get_arena(struct hyperdex_client* _cl,
+                          const char* space,
+                          const char* key, size_t key_sz,
+                          struct hyperdex_ds_arena* arena,
+                          enum hyperdex_client_returncode* status,
+                          const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->get(space, key, key_sz, arena, status, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_search_arena(struct hyperdex_client* _cl,
+                             const char* space,
+                             const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             uint64_t limit,
+                             struct hyperdex_ds_arena* arena,
+                             enum hyperdex_client_returncode* status,
+                             const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->search_limit(space, checks, checks_sz, limit, arena, status, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_changes(struct hyperdex_client* _cl,
+                        const char* space,
+                        uint64_t checkpoint,
+                        enum hyperdex_client_returncode* status,
+                        const struct hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                        uint64_t* version, int* deleted,
+                        uint64_t* resume)
+{
+    C_WRAP_EXCEPT(
+    return cl->changes(space, checkpoint, status, attrs, attrs_sz, version, deleted, resume);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_read_transaction(struct hyperdex_client* _cl,
+                                 const char* space,
+                                 const char** keys, const size_t* keys_sz, size_t num_keys,
+                                 enum hyperdex_client_returncode* status,
+                                 enum hyperdex_client_returncode* statuses,
+                                 const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->read_transaction(space, keys, keys_sz, num_keys, status, statuses, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_nearest_search(struct hyperdex_client* _cl,
+                               const char* space,
+                               const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                               const char* x_attr, double x,
+                               const char* y_attr, double y,
+                               uint64_t limit,
+                               enum hyperdex_client_returncode* status,
+                               const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->nearest_search(space, checks, checks_sz, x_attr, x, y_attr, y, limit, status, attrs, attrs_sz);
+    );
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_sample_search(struct hyperdex_client* _cl,
+                              const char* space,
+                              const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                              double fraction,
+                              enum hyperdex_client_returncode* status,
+                              const struct hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    C_WRAP_EXCEPT(
+    return cl->sample_search(space, checks, checks_sz, fraction, status, attrs, attrs_sz);
+    );
+}
+
 HYPERDEX_API int64_t
 hyperdex_client_loop(hyperdex_client* _cl, int timeout,
                      hyperdex_client_returncode* status)
@@ -2331,6 +2570,158 @@ hyperdex_client_block(hyperdex_client* _cl, int timeout)
     );
 }
 
+HYPERDEX_API void
+hyperdex_client_set_corking(hyperdex_client* _cl, bool enabled)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->set_corking(enabled);
+}
+
+HYPERDEX_API void
+hyperdex_client_flush(hyperdex_client* _cl)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->flush();
+}
+
+HYPERDEX_API void
+hyperdex_client_set_read_cache(hyperdex_client* _cl, size_t budget, uint64_t fresh_for)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->set_read_cache(budget, fresh_for);
+}
+
+HYPERDEX_API void
+hyperdex_client_set_hedging(hyperdex_client* _cl, double fraction)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->set_hedging(fraction);
+}
+
+HYPERDEX_API void
+hyperdex_client_hedging_stats(hyperdex_client* _cl,
+                              uint64_t* gets, uint64_t* hedged, uint64_t* won)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->hedging_stats(gets, hedged, won);
+}
+
+HYPERDEX_API void
+hyperdex_client_set_statistics(hyperdex_client* _cl, int enabled)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->set_statistics(enabled != 0);
+}
+
+HYPERDEX_API const char*
+hyperdex_client_statistics(hyperdex_client* _cl)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_ERR(NULL);
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    return cl->statistics();
+}
+
+HYPERDEX_API void
+hyperdex_client_reset_statistics(hyperdex_client* _cl)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->reset_statistics();
+}
+
+HYPERDEX_API void
+hyperdex_client_set_operation_timeout(hyperdex_client* _cl, uint64_t timeout)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->set_operation_timeout(timeout);
+}
+
+HYPERDEX_API void
+hyperdex_client_set_config_cache(hyperdex_client* _cl, const char* directory)
+{
+    FAKE_STATUS;
+    SIGNAL_PROTECT_VOID;
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+    cl->set_config_cache(directory);
+}
+
+HYPERDEX_API struct hyperdex_client_prepared*
+hyperdex_client_prepare(hyperdex_client* _cl,
+                        const char* method, const char* space,
+                        const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                        const struct hyperdex_client_attribute* attrs, size_t attrs_sz,
+                        enum hyperdex_client_returncode* status)
+{
+    SIGNAL_PROTECT_ERR(NULL);
+    hyperdex::client* cl = reinterpret_cast<hyperdex::client*>(_cl);
+    hyperdex::client::hold _hold(cl);
+
+    try
+    {
+        return reinterpret_cast<hyperdex_client_prepared*>(
+                cl->prepare(method, space, checks, checks_sz, attrs, attrs_sz, status));
+    }
+    catch (std::bad_alloc& ba)
+    {
+        errno = ENOMEM;
+        *status = HYPERDEX_CLIENT_NOMEM;
+        cl->set_error_message("out of memory");
+        return NULL;
+    }
+    catch (...)
+    {
+        *status = HYPERDEX_CLIENT_EXCEPTION;
+        cl->set_error_message("unhandled exception was thrown");
+        return NULL;
+    }
+}
+
+HYPERDEX_API int64_t
+hyperdex_client_execute(hyperdex_client* _cl,
+                        struct hyperdex_client_prepared* prepared,
+                        const char* key, size_t key_sz,
+                        const char* const* values, const size_t* values_sz,
+                        enum hyperdex_client_returncode* status)
+{
+    C_WRAP_EXCEPT(
+    hyperdex::prepared* p = reinterpret_cast<hyperdex::prepared*>(prepared);
+    return cl->execute(p, key, key_sz, values, values_sz, status);
+    );
+}
+
+HYPERDEX_API void
+hyperdex_client_destroy_prepared(hyperdex_client*,
+                                 struct hyperdex_client_prepared* prepared)
+{
+    delete reinterpret_cast<hyperdex::prepared*>(prepared);
+}
+
 HYPERDEX_API void
 hyperdex_client_set_type_conversion(hyperdex_client* _cl, bool enabled)
 {
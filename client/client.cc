@@ -27,13 +27,23 @@
 
 #define __STDC_LIMIT_MACROS
 
+// C
+#include <cmath>
+
 // POSIX
+#include <errno.h>
 #include <poll.h>
 
 // STL
 #include <algorithm>
+#include <sstream>
+
+// po6
+#include <po6/errno.h>
+#include <po6/time.h>
 
 // e
+#include <e/endian.h>
 #include <e/intrusive_ptr.h>
 #include <e/strescape.h>
 
@@ -42,23 +52,33 @@
 
 // HyperDex
 #include "visibility.h"
+#include "common/aggregate.h"
 #include "common/attribute_check.h"
 #include "common/auth_wallet.h"
+#include "common/compression.h"
 #include "common/datatype_info.h"
 #include "common/documents.h"
 #include "common/funcall.h"
 #include "common/macros.h"
 #include "common/network_msgtype.h"
+#include "common/network_returncode.h"
 #include "common/serialization.h"
 #include "client/client.h"
 #include "client/constants.h"
 #include "client/pending_atomic.h"
 #include "client/pending_group_atomic.h"
+#include "client/pending_aggregate.h"
+#include "client/pending_changes.h"
 #include "client/pending_count.h"
 #include "client/pending_get.h"
+#include "client/pending_get_cached.h"
+#include "client/pending_get_many.h"
 #include "client/pending_get_partial.h"
+#include "client/pending_put_many.h"
 #include "client/pending_search.h"
 #include "client/pending_search_describe.h"
+#include "client/pending_read_transaction.h"
+#include "client/pending_nearest_search.h"
 #include "client/pending_sorted_search.h"
 
 #define ERROR(CODE) \
@@ -81,6 +101,40 @@
 using hyperdex::client;
 using hyperdex::microtransaction;
 
+// what is left of a loop's timeout (in milliseconds) that began at "start"
+static int
+remaining_ms(int timeout, uint64_t start)
+{
+    if (timeout < 0)
+    {
+        return -1;
+    }
+
+    const uint64_t elapsed = (po6::monotonic_time() - start) / 1000000ULL;
+    return elapsed < uint64_t(timeout) ? timeout - int(elapsed) : 0;
+}
+
+// the sooner of two waits in milliseconds, where -1 means forever
+static int
+sooner_ms(int a, int b)
+{
+    if (a < 0)
+    {
+        return b;
+    }
+
+    return b < 0 || a < b ? a : b;
+}
+
+// names the file a configuration cache keeps for this coordinator
+static std::string
+coordinator_name(const char* coordinator, uint16_t port)
+{
+    std::ostringstream ostr;
+    ostr << coordinator << ":" << port;
+    return ostr.str();
+}
+
 client :: client(const char* coordinator, uint16_t port)
     : m_coord(replicant_client_create(coordinator, port))
     , m_busybee_mapper(&m_config)
@@ -91,6 +145,10 @@ client :: client(const char* coordinator, uint16_t port)
     , m_config_state(0)
     , m_config_data(NULL)
     , m_config_data_sz(0)
+    , m_config_generation(0)
+    , m_config_cache(coordinator_name(coordinator, port))
+    , m_config_cached(false)
+    , m_config_stale(false)
     , m_next_client_id(1)
     , m_next_server_nonce(1)
     , m_flagfd()
@@ -103,6 +161,24 @@ client :: client(const char* coordinator, uint16_t port)
     , m_macaroons(NULL)
     , m_macaroons_sz(0)
     , m_convert_types(true)
+    , m_corking(false)
+    , m_corks()
+    , m_corking_searches(false)
+    , m_search_corks()
+    , m_read_cache()
+    , m_hedging()
+    , m_stats()
+    , m_stats_report()
+    , m_hedges()
+    , m_hedge_deadlines()
+    , m_hedged()
+    , m_op_timeout(0)
+    , m_op_deadlines()
+    , m_throttle_deadlines()
+    , m_shared(false)
+    , m_protect()
+    , m_completion_queues()
+    , m_attr_hints(HYPERDEX_CLIENT_ATTR_HINTS)
 {
     if (!m_coord)
     {
@@ -123,6 +199,10 @@ client :: client(const char* conn_str)
     , m_config_state(0)
     , m_config_data(NULL)
     , m_config_data_sz(0)
+    , m_config_generation(0)
+    , m_config_cache(std::string(conn_str))
+    , m_config_cached(false)
+    , m_config_stale(false)
     , m_next_client_id(1)
     , m_next_server_nonce(1)
     , m_flagfd()
@@ -135,6 +215,24 @@ client :: client(const char* conn_str)
     , m_macaroons(NULL)
     , m_macaroons_sz(0)
     , m_convert_types(true)
+    , m_corking(false)
+    , m_corks()
+    , m_corking_searches(false)
+    , m_search_corks()
+    , m_read_cache()
+    , m_hedging()
+    , m_stats()
+    , m_stats_report()
+    , m_hedges()
+    , m_hedge_deadlines()
+    , m_hedged()
+    , m_op_timeout(0)
+    , m_op_deadlines()
+    , m_throttle_deadlines()
+    , m_shared(false)
+    , m_protect()
+    , m_completion_queues()
+    , m_attr_hints(HYPERDEX_CLIENT_ATTR_HINTS)
 {
     if (!m_coord)
     {
@@ -147,11 +245,53 @@ client :: client(const char* conn_str)
 
 client :: ~client() throw ()
 {
+    for (completion_queue_map_t::iterator it = m_completion_queues.begin();
+            it != m_completion_queues.end(); ++it)
+    {
+        delete it->second;
+    }
+
     replicant_client_destroy(m_coord);
 }
 
+client :: hold :: hold(client* cl)
+    : m_cl(cl)
+{
+    if (m_cl->m_shared)
+    {
+        m_cl->m_protect.lock();
+    }
+}
+
+client :: hold :: ~hold() throw ()
+{
+    if (!m_cl->m_shared)
+    {
+        return;
+    }
+
+    try
+    {
+        m_cl->queue_for(pthread_self())->last_error = m_cl->m_last_error;
+    }
+    catch (...)
+    {
+    }
+
+    m_cl->m_protect.unlock();
+}
+
+int64_t
+client :: get(const char* space, const char* key, size_t key_sz,
+              hyperdex_client_returncode* status,
+              const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    return get(space, key, key_sz, NULL, status, attrs, attrs_sz);
+}
+
 int64_t
 client :: get(const char* space, const char* _key, size_t _key_sz,
+              hyperdex_ds_arena* arena,
               hyperdex_client_returncode* status,
               const hyperdex_client_attribute** attrs, size_t* attrs_sz)
 {
@@ -178,8 +318,15 @@ client :: get(const char* space, const char* _key, size_t _key_sz,
         return -1;
     }
 
-    e::intrusive_ptr<pending> op;
-    op = new pending_get(m_next_client_id++, status, attrs, attrs_sz);
+    if (m_read_cache.enabled())
+    {
+        return get_cached(space, key, arena, status, attrs, attrs_sz);
+    }
+
+    e::intrusive_ptr<pending_get> gop;
+    gop = new pending_get(m_next_client_id++, status, attrs, attrs_sz);
+    gop->set_arena(arena);
+    e::intrusive_ptr<pending> op(gop.get());
     size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ + pack_size(key);
     auth_wallet aw(m_macaroons, m_macaroons_sz);
 
@@ -196,9 +343,105 @@ client :: get(const char* space, const char* _key, size_t _key_sz,
         pa = pa << aw;
     }
 
+    if (sc->immutable)
+    {
+        return send_replica_readop(space, key, REQ_GET, msg, op, status);
+    }
+
+    if (m_hedging.enabled())
+    {
+        return send_hedged_get(space, key, msg, op, status);
+    }
+
     return send_keyop(space, key, REQ_GET, msg, op, status);
 }
 
+int64_t
+client :: get_relaxed(const char* space, const char* _key, size_t _key_sz,
+                      uint64_t staleness,
+                      hyperdex_client_returncode* status,
+                      const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    if (!maintain_coord_connection(status))
+    {
+        return -1;
+    }
+
+    const schema* sc = m_config.get_schema(space);
+
+    if (!sc)
+    {
+        ERROR(UNKNOWNSPACE) << "space \"" << e::strescape(space) << "\" does not exist";
+        return -1;
+    }
+
+    datatype_info* di = datatype_info::lookup(sc->attrs[0].type);
+    assert(di);
+    e::slice key(_key, _key_sz);
+
+    if (!di->validate(key))
+    {
+        ERROR(WRONGTYPE) << "key must be type " << sc->attrs[0].type;
+        return -1;
+    }
+
+    virtual_server_id leader = m_config.point_leader(space, key);
+
+    if (leader == virtual_server_id())
+    {
+        ERROR(OFFLINE) << "all servers for key \""
+                       << e::strescape(std::string(reinterpret_cast<const char*>(key.data()), key.size()))
+                       << "\" in space \"" << e::strescape(space)
+                       << "\" are offline: bring one or more online to remedy the issue";
+        return -1;
+    }
+
+    auth_wallet aw(m_macaroons, m_macaroons_sz);
+    size_t aw_sz = m_macaroons_sz ? pack_size(aw) : 0;
+
+    // should the replica be too far behind, the op falls back to a plain GET
+    // at the point leader
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ + pack_size(key) + aw_sz;
+    std::auto_ptr<e::buffer> fallback(e::buffer::create(sz));
+    e::packer pa = fallback->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << key;
+
+    if (m_macaroons_sz)
+    {
+        pa = pa << aw;
+    }
+
+    sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ + sizeof(uint64_t) + pack_size(key) + aw_sz;
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    pa = msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << staleness << key;
+
+    if (m_macaroons_sz)
+    {
+        pa = pa << aw;
+    }
+
+    e::intrusive_ptr<pending_get> op;
+    op = new pending_get(m_next_client_id++, status, attrs, attrs_sz);
+    op->set_fallback(leader, fallback);
+
+    // take turns down the chain
+    std::vector<virtual_server_id> replicas;
+    m_config.replicas_of_region(m_config.get_region_id(leader), &replicas);
+    uint64_t nonce = m_next_server_nonce++;
+    virtual_server_id vsi = replicas.empty() ? leader : replicas[nonce % replicas.size()];
+
+    e::intrusive_ptr<pending> pop(op.get());
+
+    if (send(REQ_GET_RELAXED, vsi, nonce, msg, pop, status))
+    {
+        return op->client_visible_id();
+    }
+    else
+    {
+        ERROR(RECONFIGURE) << "could not send " << REQ_GET_RELAXED << " to " << vsi;
+        return -1;
+    }
+}
+
 int64_t
 client :: get_partial(const char* space, const char* _key, size_t _key_sz,
                       const char** attrnames, size_t attrnames_sz,
@@ -222,7 +465,7 @@ client :: get_partial(const char* space, const char* _key, size_t _key_sz,
 
     for (size_t i = 0; i < attrnames_sz; ++i)
     {
-        uint16_t attr = sc->lookup_attr(attrnames[i]);
+        uint16_t attr = lookup_attr(*sc, attrnames[i]);
 
         if (attr == UINT16_MAX)
         {
@@ -274,131 +517,20 @@ client :: get_partial(const char* space, const char* _key, size_t _key_sz,
         pa = pa << aw;
     }
 
-    return send_keyop(space, key, REQ_GET_PARTIAL, msg, op, status);
-}
-
-#define SEARCH_BOILERPLATE \
-    if (!maintain_coord_connection(status)) \
-    { \
-        return -1; \
-    } \
-    const schema* sc = m_config.get_schema(space); \
-    if (!sc) \
-    { \
-        ERROR(UNKNOWNSPACE) << "space \"" << e::strescape(space) << "\" does not exist"; \
-        return -1; \
-    } \
-    std::vector<attribute_check> checks; \
-    std::vector<virtual_server_id> servers; \
-    e::arena memory; \
-    int64_t ret = prepare_searchop(*sc, space, chks, chks_sz, &memory, status, &checks, &servers); \
-    if (ret < 0) \
-    { \
-        return ret; \
-    }
-
-int64_t
-client :: search(const char* space,
-                 const hyperdex_client_attribute_check* chks, size_t chks_sz,
-                 hyperdex_client_returncode* status,
-                 const hyperdex_client_attribute** attrs, size_t* attrs_sz)
-{
-    SEARCH_BOILERPLATE
-    int64_t client_id = m_next_client_id++;
-    e::intrusive_ptr<pending_aggregation> op;
-    op = new pending_search(client_id, status, attrs, attrs_sz);
-    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
-              + sizeof(uint64_t)
-              + pack_size(checks);
-    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
-    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << client_id << checks;
-    return perform_aggregation(servers, op, REQ_SEARCH_START, msg, status);
-}
-
-int64_t
-client :: search_describe(const char* space,
-                          const hyperdex_client_attribute_check* chks, size_t chks_sz,
-                          hyperdex_client_returncode* status, const char** description)
-{
-    SEARCH_BOILERPLATE
-    int64_t client_id = m_next_client_id++;
-    e::intrusive_ptr<pending_aggregation> op;
-    op = new pending_search_describe(client_id, status, description);
-    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
-              + pack_size(checks);
-    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
-    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << checks;
-    return perform_aggregation(servers, op, REQ_SEARCH_DESCRIBE, msg, status);
-}
-
-int64_t
-client :: sorted_search(const char* space,
-                        const hyperdex_client_attribute_check* chks, size_t chks_sz,
-                        const char* sort_by,
-                        uint64_t limit,
-                        bool maximize,
-                        hyperdex_client_returncode* status,
-                        const hyperdex_client_attribute** attrs, size_t* attrs_sz)
-{
-    SEARCH_BOILERPLATE
-    uint16_t sort_by_num = sc->lookup_attr(sort_by);
-
-    if (sort_by_num == sc->attrs_sz)
-    {
-        ERROR(UNKNOWNATTR) << "\"" << e::strescape(sort_by)
-                           << "\" is not an attribute of space \""
-                           << e::strescape(space) << "\"";
-        return -1 - chks_sz;
-    }
-
-    datatype_info* di = datatype_info::lookup(sc->attrs[sort_by_num].type);
-
-    if (!di->comparable())
+    if (sc->immutable)
     {
-        ERROR(WRONGTYPE) << "cannot sort by attribute \""
-                         << e::strescape(sort_by)
-                         << "\": it is not comparable";
-        return -1 - chks_sz;
+        return send_replica_readop(space, key, REQ_GET_PARTIAL, msg, op, status);
     }
 
-    int64_t client_id = m_next_client_id++;
-    e::intrusive_ptr<pending_aggregation> op;
-    op = new pending_sorted_search(this, client_id, maximize, limit, sort_by_num, di, status, attrs, attrs_sz);
-    int8_t max = maximize ? 1 : 0;
-    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
-              + pack_size(checks)
-              + sizeof(limit)
-              + sizeof(sort_by_num)
-              + sizeof(max);
-    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
-    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << checks << limit << sort_by_num << max;
-    return perform_aggregation(servers, op, REQ_SORTED_SEARCH, msg, status);
-}
-
-int64_t
-client :: count(const char* space,
-                const hyperdex_client_attribute_check* chks, size_t chks_sz,
-                hyperdex_client_returncode* status,
-                uint64_t* result)
-{
-    SEARCH_BOILERPLATE
-    int64_t client_id = m_next_client_id++;
-    e::intrusive_ptr<pending_aggregation> op;
-    op = new pending_count(client_id, status, result);
-    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
-              + pack_size(checks);
-    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
-    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << checks;
-    return perform_aggregation(servers, op, REQ_COUNT, msg, status);
+    return send_keyop(space, key, REQ_GET_PARTIAL, msg, op, status);
 }
 
 int64_t
-client :: perform_funcall(const hyperdex_client_keyop_info* opinfo,
-                          const char* space, const char* _key, size_t _key_sz,
-                          const hyperdex_client_attribute_check* chks, size_t chks_sz,
-                          const hyperdex_client_attribute* attrs, size_t attrs_sz,
-                          const hyperdex_client_map_attribute* mapattrs, size_t mapattrs_sz,
-                          hyperdex_client_returncode* status)
+client :: get_many(const char* space,
+                   const char** _keys, const size_t* _keys_sz, size_t num_keys,
+                   hyperdex_client_returncode* status,
+                   hyperdex_client_returncode* statuses,
+                   const hyperdex_client_attribute** attrs, size_t* attrs_sz)
 {
     if (!maintain_coord_connection(status))
     {
@@ -415,873 +547,3040 @@ client :: perform_funcall(const hyperdex_client_keyop_info* opinfo,
 
     datatype_info* di = datatype_info::lookup(sc->attrs[0].type);
     assert(di);
-    e::slice key(_key, _key_sz);
+    std::vector<e::slice> keys;
+    keys.reserve(num_keys);
 
-    if (!di->validate(key))
+    for (size_t i = 0; i < num_keys; ++i)
     {
-        ERROR(WRONGTYPE) << "key must be type " << sc->attrs[0].type;
-        return -1;
+        keys.push_back(e::slice(_keys[i], _keys_sz[i]));
+
+        if (!di->validate(keys.back()))
+        {
+            ERROR(WRONGTYPE) << "key[" << i << "] must be type " << sc->attrs[0].type;
+            return -1;
+        }
     }
 
-    e::intrusive_ptr<pending> op;
-    op = new pending_atomic(m_next_client_id++, status);
-    std::auto_ptr<e::buffer> msg;
-    auth_wallet aw(m_macaroons, m_macaroons_sz);
-    size_t header_sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
-                     + pack_size(key);
-    size_t footer_sz = 0;
+    e::intrusive_ptr<pending_get_many> op;
+    op = new pending_get_many(m_next_client_id++, status, num_keys, statuses, attrs, attrs_sz);
 
-    if (m_macaroons_sz)
+    // group the keys by the point leader that will serve them
+    typedef std::map<virtual_server_id, std::vector<size_t> > batch_map_t;
+    batch_map_t batches;
+    std::vector<virtual_server_id> leaders(num_keys);
+    m_config.point_leader(space, keys.empty() ? NULL : &keys[0], num_keys,
+                          leaders.empty() ? NULL : &leaders[0]);
+
+    for (size_t i = 0; i < num_keys; ++i)
     {
-        footer_sz += pack_size(aw);
+        const virtual_server_id& vsi(leaders[i]);
+
+        if (vsi == virtual_server_id())
+        {
+            op->set_key_status(i, HYPERDEX_CLIENT_OFFLINE);
+            continue;
+        }
+
+        batches[vsi].push_back(i);
     }
 
-    int64_t ret = perform_funcall(space, sc, opinfo,
-                                  chks, chks_sz,
-                                  attrs, attrs_sz,
-                                  mapattrs, mapattrs_sz,
-                                  header_sz, footer_sz,
-                                  status, &msg);
+    auth_wallet aw(m_macaroons, m_macaroons_sz);
+    e::intrusive_ptr<pending> pop(op.get());
 
-    if (ret < 0)
+    for (batch_map_t::iterator it = batches.begin(); it != batches.end(); ++it)
     {
-        return ret;
+        std::vector<e::slice> batch_keys;
+        batch_keys.reserve(it->second.size());
+
+        for (size_t i = 0; i < it->second.size(); ++i)
+        {
+            batch_keys.push_back(keys[it->second[i]]);
+        }
+
+        size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ + pack_size(batch_keys);
+
+        if (m_macaroons_sz)
+        {
+            sz += pack_size(aw);
+        }
+
+        std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+        e::packer pa = msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << batch_keys;
+
+        if (m_macaroons_sz)
+        {
+            pa = pa << aw;
+        }
+
+        uint64_t nonce = m_next_server_nonce++;
+        op->add_batch(it->first, it->second);
+
+        if (!send(REQ_GET_BATCH, it->first, nonce, msg, pop, status))
+        {
+            m_failed.push_back(pending_server_pair(m_config.get_server_id(it->first), it->first, pop));
+        }
     }
 
-    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << key;
+    if (batches.empty())
+    {
+        // nothing went out on the wire; yield the per-key statuses directly
+        m_yieldable.push_back(pop);
+        m_flagfd.set();
+    }
 
-    if (m_macaroons_sz)
+    return op->client_visible_id();
+}
+
+int64_t
+client :: read_transaction(const char* space,
+                           const char** _keys, const size_t* _keys_sz, size_t num_keys,
+                           hyperdex_client_returncode* status,
+                           hyperdex_client_returncode* statuses,
+                           const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    if (!maintain_coord_connection(status))
     {
-        msg->pack_at(msg->capacity() - footer_sz) << aw;
+        return -1;
     }
 
-    return send_keyop(space, key, REQ_ATOMIC, msg, op, status);
+    const schema* sc = m_config.get_schema(space);
+
+    if (!sc)
+    {
+        ERROR(UNKNOWNSPACE) << "space \"" << e::strescape(space) << "\" does not exist";
+        return -1;
+    }
+
+    datatype_info* di = datatype_info::lookup(sc->attrs[0].type);
+    assert(di);
+    std::vector<e::slice> keys;
+    keys.reserve(num_keys);
+
+    for (size_t i = 0; i < num_keys; ++i)
+    {
+        keys.push_back(e::slice(_keys[i], _keys_sz[i]));
+
+        if (!di->validate(keys.back()))
+        {
+            ERROR(WRONGTYPE) << "key[" << i << "] must be type " << sc->attrs[0].type;
+            return -1;
+        }
+    }
+
+    e::intrusive_ptr<pending_read_transaction> op;
+    op = new pending_read_transaction(m_next_client_id++, status, keys, statuses, attrs, attrs_sz);
+
+    // versions come from the point leader, so that is where each key is read
+    typedef std::map<virtual_server_id, std::vector<size_t> > batch_map_t;
+    batch_map_t batches;
+    std::vector<virtual_server_id> leaders(num_keys);
+    m_config.point_leader(space, keys.empty() ? NULL : &keys[0], num_keys,
+                          leaders.empty() ? NULL : &leaders[0]);
+
+    for (size_t i = 0; i < num_keys; ++i)
+    {
+        if (leaders[i] == virtual_server_id())
+        {
+            op->set_key_status(i, HYPERDEX_CLIENT_OFFLINE);
+            continue;
+        }
+
+        batches[leaders[i]].push_back(i);
+    }
+
+    for (batch_map_t::iterator it = batches.begin(); it != batches.end(); ++it)
+    {
+        op->add_batch(it->first, it->second);
+    }
+
+    e::intrusive_ptr<pending> pop(op.get());
+    op->start(this, status);
+
+    if (op->can_yield())
+    {
+        // nothing is on the wire; yield the per-key statuses directly
+        m_yieldable.push_back(pop);
+        m_flagfd.set();
+    }
+
+    return op->client_visible_id();
 }
 
 int64_t
-client :: perform_group_funcall(const hyperdex_client_keyop_info* opinfo,
-                                const char* space,
-                                const hyperdex_client_attribute_check* chks, size_t chks_sz,
-                                const hyperdex_client_attribute* attrs, size_t attrs_sz,
-                                const hyperdex_client_map_attribute* mapattrs, size_t mapattrs_sz,
-                                hyperdex_client_returncode* status,
-                                uint64_t* update_count)
+client :: put_many(const char* space,
+                   const char** _keys, const size_t* _keys_sz,
+                   const hyperdex_client_attribute* const* attrs, const size_t* attrs_sz,
+                   size_t num_objects,
+                   hyperdex_client_returncode* status,
+                   hyperdex_client_returncode* statuses)
 {
-    SEARCH_BOILERPLATE
-    int64_t client_id = m_next_client_id++;
-    e::intrusive_ptr<pending_aggregation> op;
-    op = new pending_group_atomic(client_id, status, update_count);
-    std::auto_ptr<e::buffer> inner_msg;
-    ret = perform_funcall(space, sc, opinfo,
-                          chks, chks_sz,
-                          attrs, attrs_sz,
-                          mapattrs, mapattrs_sz,
-                          0, 0, status, &inner_msg);
+    if (!maintain_coord_connection(status))
+    {
+        return -1;
+    }
 
-    if (ret < 0)
+    const schema* sc = m_config.get_schema(space);
+
+    if (!sc)
     {
-        return ret;
+        ERROR(UNKNOWNSPACE) << "space \"" << e::strescape(space) << "\" does not exist";
+        return -1;
+    }
+
+    const hyperdex_client_keyop_info* opinfo;
+    opinfo = hyperdex_client_keyop_info_lookup("put", 3);
+    assert(opinfo);
+    datatype_info* di = datatype_info::lookup(sc->attrs[0].type);
+    assert(di);
+    const int64_t client_id = m_next_client_id++;
+    e::compat::shared_ptr<pending_put_many::progress> progress;
+    progress.reset(new pending_put_many::progress(num_objects, statuses));
+    *status = HYPERDEX_CLIENT_SUCCESS;
+
+    // group the objects by the point leader that will take them, settling
+    // the ones that can go nowhere
+    std::vector<std::pair<virtual_server_id, size_t> > order;
+    order.reserve(num_objects);
+    std::vector<e::slice> keys;
+    std::vector<size_t> valid;
+    keys.reserve(num_objects);
+    valid.reserve(num_objects);
+
+    for (size_t i = 0; i < num_objects; ++i)
+    {
+        e::slice key(_keys[i], _keys_sz[i]);
+
+        if (!di->validate(key))
+        {
+            statuses[i] = HYPERDEX_CLIENT_WRONGTYPE;
+            pending_put_many(client_id, status, progress, i).finish(statuses[i]);
+            continue;
+        }
+
+        m_read_cache.invalidate(space, key);
+        keys.push_back(key);
+        valid.push_back(i);
+    }
+
+    std::vector<virtual_server_id> leaders(keys.size());
+    m_config.point_leader(space, keys.empty() ? NULL : &keys[0], keys.size(),
+                          leaders.empty() ? NULL : &leaders[0]);
+
+    for (size_t i = 0; i < valid.size(); ++i)
+    {
+        if (leaders[i] == virtual_server_id())
+        {
+            statuses[valid[i]] = HYPERDEX_CLIENT_OFFLINE;
+            pending_put_many(client_id, status, progress, valid[i]).finish(statuses[valid[i]]);
+            continue;
+        }
+
+        order.push_back(std::make_pair(leaders[i], valid[i]));
+    }
+
+    std::sort(order.begin(), order.end());
+    auth_wallet aw(m_macaroons, m_macaroons_sz);
+    size_t footer_sz = m_macaroons_sz ? pack_size(aw) : 0;
+    // each server's objects leave as REQ_ATOMIC_BATCH frames
+    const bool corking = m_corking;
+    m_corking = true;
+
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        const size_t idx = order[i].second;
+        e::slice key(_keys[idx], _keys_sz[idx]);
+        e::intrusive_ptr<pending_put_many> op;
+        op = new pending_put_many(client_id, status, progress, idx);
+        std::auto_ptr<e::buffer> msg;
+        size_t header_sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ + pack_size(key);
+
+        if (perform_funcall(space, sc, opinfo, NULL, 0,
+                            attrs[idx], attrs_sz[idx], NULL, 0,
+                            header_sz, footer_sz, &statuses[idx], &msg) < 0)
+        {
+            op->finish(statuses[idx]);
+            continue;
+        }
+
+        msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << key;
+
+        if (m_macaroons_sz)
+        {
+            msg->pack_at(msg->capacity() - footer_sz) << aw;
+        }
+
+        e::intrusive_ptr<pending> pop(op.get());
+        send(REQ_ATOMIC, order[i].first, m_next_server_nonce++, msg, pop, status);
+    }
+
+    m_corking = corking;
+
+    if (!m_corking)
+    {
+        flush();
+    }
+
+    // settle put_many's own share; if nothing went out on the wire, this is
+    // what yields the per-object statuses
+    e::intrusive_ptr<pending_put_many> self;
+    self = new pending_put_many(client_id, status, progress, num_objects);
+    self->finish(HYPERDEX_CLIENT_SUCCESS);
+
+    if (self->can_yield())
+    {
+        m_yieldable.push_back(e::intrusive_ptr<pending>(self.get()));
+        m_flagfd.set();
+    }
+
+    return client_id;
+}
+
+#define SEARCH_BOILERPLATE \
+    if (!maintain_coord_connection(status)) \
+    { \
+        return -1; \
+    } \
+    const schema* sc = m_config.get_schema(space); \
+    if (!sc) \
+    { \
+        ERROR(UNKNOWNSPACE) << "space \"" << e::strescape(space) << "\" does not exist"; \
+        return -1; \
+    } \
+    std::vector<attribute_check> checks; \
+    std::vector<virtual_server_id> servers; \
+    e::arena memory; \
+    int64_t ret = prepare_searchop(*sc, space, chks, chks_sz, &memory, status, &checks, &servers); \
+    if (ret < 0) \
+    { \
+        return ret; \
+    }
+
+int64_t
+client :: search(const char* space,
+                 const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                 hyperdex_client_returncode* status,
+                 const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    return search_limit(space, chks, chks_sz, 0, status, attrs, attrs_sz);
+}
+
+int64_t
+client :: search_limit(const char* space,
+                       const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                       uint64_t limit,
+                       hyperdex_client_returncode* status,
+                       const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    return search_limit(space, chks, chks_sz, limit, NULL, status, attrs, attrs_sz);
+}
+
+int64_t
+client :: search_limit(const char* space,
+                       const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                       uint64_t limit,
+                       hyperdex_ds_arena* arena,
+                       hyperdex_client_returncode* status,
+                       const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    return perform_search(space, chks, chks_sz, limit, 0, arena, status, attrs, attrs_sz);
+}
+
+int64_t
+client :: sample_search(const char* space,
+                        const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                        double fraction,
+                        hyperdex_client_returncode* status,
+                        const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    if (!(fraction > 0))
+    {
+        ERROR(WRONGTYPE) << "the sampling fraction must be greater than zero";
+        return -1 - chks_sz;
+    }
+
+    // a fraction of one or more is every match, which a threshold of zero
+    // stands for; any smaller fraction keeps at least the lowest hash
+    uint64_t sample = 0;
+
+    if (fraction < 1)
+    {
+        sample = std::max(static_cast<uint64_t>(ldexp(fraction, 64)), uint64_t(1));
     }
 
+    return perform_search(space, chks, chks_sz, 0, sample, NULL, status, attrs, attrs_sz);
+}
+
+int64_t
+client :: search_describe(const char* space,
+                          const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                          hyperdex_client_returncode* status, const char** description)
+{
+    SEARCH_BOILERPLATE
+    int64_t client_id = m_next_client_id++;
+    e::intrusive_ptr<pending_aggregation> op;
+    op = new pending_search_describe(client_id, status, description);
     size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
-              + sizeof(uint64_t)
-              + pack_size(checks)
-              + inner_msg->size();
+              + pack_size(checks);
     std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
-    e::packer pa = msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ);
-    e::slice ims = inner_msg->as_slice();
-    pa = pa << checks << e::pack_memmove(ims.data(), ims.size());
-    return perform_aggregation(servers, op, REQ_GROUP_ATOMIC, msg, status);
+    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << checks;
+    return perform_aggregation(servers, op, REQ_SEARCH_DESCRIBE, msg, status);
 }
 
 int64_t
-client :: loop(int timeout, hyperdex_client_returncode* status)
+client :: sorted_search(const char* space,
+                        const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                        const char* sort_by,
+                        uint64_t limit,
+                        bool maximize,
+                        hyperdex_client_returncode* status,
+                        const hyperdex_client_attribute** attrs, size_t* attrs_sz)
 {
-    *status = HYPERDEX_CLIENT_SUCCESS;
-    m_last_error = e::error();
+    return sorted_search_page(space, chks, chks_sz, sort_by, limit, maximize,
+                              NULL, 0, status, attrs, attrs_sz, NULL, NULL);
+}
+
+int64_t
+client :: sorted_search_page(const char* space,
+                             const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                             const char* sort_by,
+                             uint64_t limit,
+                             bool maximize,
+                             const char* cursor, size_t cursor_sz,
+                             hyperdex_client_returncode* status,
+                             const hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                             const char** next_cursor, size_t* next_cursor_sz)
+{
+    SEARCH_BOILERPLATE
+    uint16_t sort_by_num = sc->lookup_attr(sort_by);
 
-    while (m_yielding ||
-           !m_failed.empty() ||
-           !m_yieldable.empty() ||
-           !m_pending_ops.empty())
+    if (sort_by_num == sc->attrs_sz)
     {
-        if (m_yielding)
-        {
-            if (!m_yielding->can_yield())
-            {
-                m_yielding = NULL;
-                continue;
-            }
+        ERROR(UNKNOWNATTR) << "\"" << e::strescape(sort_by)
+                           << "\" is not an attribute of space \""
+                           << e::strescape(space) << "\"";
+        return -1 - chks_sz;
+    }
 
-            if (!m_yielding->yield(status, &m_last_error))
-            {
-                return -1;
-            }
+    datatype_info* di = datatype_info::lookup(sc->attrs[sort_by_num].type);
+
+    if (!di->comparable())
+    {
+        ERROR(WRONGTYPE) << "cannot sort by attribute \""
+                         << e::strescape(sort_by)
+                         << "\": it is not comparable";
+        return -1 - chks_sz;
+    }
+
+    int64_t client_id = m_next_client_id++;
+    e::intrusive_ptr<pending_sorted_search> op;
+    op = new pending_sorted_search(this, client_id, maximize, limit, sort_by_num, di, status, attrs, attrs_sz,
+                                   next_cursor, next_cursor_sz);
+
+    if (cursor_sz > 0 && !op->set_cursor(cursor, cursor_sz))
+    {
+        ERROR(WRONGTYPE) << "the cursor is malformed or belongs to a different sorted search";
+        return -1;
+    }
+
+    // the second bit asks for compressed results
+    int8_t max = (maximize ? 1 : 0) | (compression_available() ? 2 : 0);
+    const uint64_t search_id = client_id;
+    const uint32_t chunk = HYPERDEX_CLIENT_SORTED_SEARCH_CHUNK;
+    e::intrusive_ptr<pending> pop(op.get());
+    bool sent = false;
+    m_corking_searches = true;
+
+    for (size_t i = 0; i < servers.size(); ++i)
+    {
+        e::slice cursor_attr;
+        e::slice cursor_key;
+        bool has_cursor = false;
+
+        if (!op->resume_point(m_config.get_region_id(servers[i]),
+                              &has_cursor, &cursor_attr, &cursor_key))
+        {
+            // the previous pages finished this region
+            continue;
+        }
+
+        size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+                  + pack_size(checks)
+                  + sizeof(limit)
+                  + sizeof(sort_by_num)
+                  + sizeof(max)
+                  + sizeof(search_id)
+                  + sizeof(chunk)
+                  + (has_cursor ? pack_size(cursor_attr) + pack_size(cursor_key) : 0);
+        std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+        e::packer pa = msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ);
+        pa = pa << checks << limit << sort_by_num << max << search_id << chunk;
+
+        if (has_cursor)
+        {
+            pa = pa << cursor_attr << cursor_key;
+        }
+
+        uint64_t nonce = m_next_server_nonce++;
+        sent = true;
+
+        if (!send(REQ_SORTED_SEARCH, servers[i], nonce, msg, pop, status))
+        {
+            m_failed.push_back(pending_server_pair(m_config.get_server_id(servers[i]), servers[i], pop));
+        }
+    }
+
+    m_corking_searches = false;
+    flush_search_corks(REQ_SORTED_SEARCH, pop);
+
+    if (!sent)
+    {
+        // every region was finished by the previous pages
+        m_yieldable.push_back(pop);
+        m_flagfd.set();
+    }
+
+    return op->client_visible_id();
+}
+
+int64_t
+client :: nearest_search(const char* space,
+                         const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                         const char* x_attr, double x,
+                         const char* y_attr, double y,
+                         uint64_t limit,
+                         hyperdex_client_returncode* status,
+                         const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    SEARCH_BOILERPLATE
+    const char* names[2] = {x_attr, y_attr};
+    uint16_t nums[2];
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        nums[i] = sc->lookup_attr(names[i]);
+
+        if (nums[i] == sc->attrs_sz)
+        {
+            ERROR(UNKNOWNATTR) << "\"" << e::strescape(names[i])
+                               << "\" is not an attribute of space \""
+                               << e::strescape(space) << "\"";
+            return -1 - chks_sz;
+        }
+
+        hyperdatatype t = sc->attrs[nums[i]].type;
+
+        if (nums[i] == 0 ||
+            (t != HYPERDATATYPE_INT64 && t != HYPERDATATYPE_FLOAT &&
+             CONTAINER_TYPE(t) != HYPERDATATYPE_TIMESTAMP_GENERIC))
+        {
+            ERROR(WRONGTYPE) << "cannot measure distance along attribute \""
+                             << e::strescape(names[i])
+                             << "\": it is the key or is not a number or timestamp";
+            return -1 - chks_sz;
+        }
+    }
+
+    if (nums[0] == nums[1])
+    {
+        ERROR(WRONGTYPE) << "a nearest search needs two different attributes";
+        return -1 - chks_sz;
+    }
+
+    int64_t client_id = m_next_client_id++;
+    e::intrusive_ptr<pending_aggregation> op;
+    op = new pending_nearest_search(this, client_id, limit,
+                                    nums[0], sc->attrs[nums[0]].type, x,
+                                    nums[1], sc->attrs[nums[1]].type, y,
+                                    status, attrs, attrs_sz);
+    char point[2 * sizeof(double)];
+    e::packdoublele(x, point);
+    e::packdoublele(y, point + sizeof(double));
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+              + pack_size(checks)
+              + sizeof(limit)
+              + 2 * sizeof(uint16_t)
+              + 2 * pack_size(e::slice(point, sizeof(double)));
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ)
+        << checks << limit
+        << nums[0] << e::slice(point, sizeof(double))
+        << nums[1] << e::slice(point + sizeof(double), sizeof(double));
+    return perform_aggregation(servers, op, REQ_NEAREST_SEARCH, msg, status);
+}
+
+int64_t
+client :: count(const char* space,
+                const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                hyperdex_client_returncode* status,
+                uint64_t* result)
+{
+    SEARCH_BOILERPLATE
+    int64_t client_id = m_next_client_id++;
+    e::intrusive_ptr<pending_aggregation> op;
+    op = new pending_count(client_id, status, result);
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+              + pack_size(checks);
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << checks;
+    return perform_aggregation(servers, op, REQ_COUNT, msg, status);
+}
+
+int64_t
+client :: approximate_count(const char* space,
+                            const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                            double error,
+                            hyperdex_client_returncode* status,
+                            uint64_t* result)
+{
+    SEARCH_BOILERPLATE
+    int64_t client_id = m_next_client_id++;
+    e::intrusive_ptr<pending_aggregation> op;
+    op = new pending_count(client_id, status, result);
+    // the relative error of an estimate from n samples shrinks as 1/sqrt(n)
+    uint64_t samples = UINT64_MAX;
+
+    if (error > 0)
+    {
+        samples = static_cast<uint64_t>(std::min(1e18, std::ceil(1. / (error * error))));
+    }
+
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+              + pack_size(checks)
+              + sizeof(uint64_t);
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << checks << samples;
+    return perform_aggregation(servers, op, REQ_APPROXIMATE_COUNT, msg, status);
+}
+
+int64_t
+client :: aggregate(const char* space,
+                    const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                    const hyperdex_client_aggregate* aggs, size_t aggs_sz,
+                    const char* group_by,
+                    hyperdex_client_returncode* status,
+                    const hyperdex_client_aggregate_group** groups, size_t* groups_sz)
+{
+    SEARCH_BOILERPLATE
+
+    if (aggs_sz > HYPERDEX_AGGREGATE_MAX_FUNCTIONS)
+    {
+        ERROR(OVERFLOW) << "cannot compute more than "
+                        << HYPERDEX_AGGREGATE_MAX_FUNCTIONS
+                        << " aggregates in one operation";
+        return -1 - chks_sz;
+    }
+
+    std::vector<std::pair<uint16_t, uint8_t> > wire;
+    std::vector<uint8_t> funcs;
+    std::vector<char> is_float;
+
+    for (size_t i = 0; i < aggs_sz; ++i)
+    {
+        uint16_t attr = lookup_attr(*sc, aggs[i].attr);
+
+        if (attr == sc->attrs_sz)
+        {
+            ERROR(UNKNOWNATTR) << "\"" << e::strescape(aggs[i].attr)
+                               << "\" is not an attribute of space \""
+                               << e::strescape(space) << "\"";
+            return -1 - chks_sz;
+        }
+
+        hyperdatatype t = sc->attrs[attr].type;
+
+        if (t != HYPERDATATYPE_INT64 && t != HYPERDATATYPE_FLOAT &&
+            CONTAINER_TYPE(t) != HYPERDATATYPE_TIMESTAMP_GENERIC)
+        {
+            ERROR(WRONGTYPE) << "cannot aggregate attribute \""
+                             << e::strescape(aggs[i].attr)
+                             << "\": it is not an int, float, or timestamp";
+            return -1 - chks_sz;
+        }
+
+        uint8_t func;
+
+        switch (aggs[i].function)
+        {
+            case HYPERDEX_CLIENT_AGGREGATE_SUM:
+                func = AGGREGATE_SUM;
+                break;
+            case HYPERDEX_CLIENT_AGGREGATE_MIN:
+                func = AGGREGATE_MIN;
+                break;
+            case HYPERDEX_CLIENT_AGGREGATE_MAX:
+                func = AGGREGATE_MAX;
+                break;
+            case HYPERDEX_CLIENT_AGGREGATE_AVG:
+                func = AGGREGATE_AVG;
+                break;
+            default:
+                ERROR(WRONGTYPE) << "invalid aggregate function for attribute \""
+                                 << e::strescape(aggs[i].attr) << "\"";
+                return -1 - chks_sz;
+        }
+
+        wire.push_back(std::make_pair(attr, func));
+        funcs.push_back(func);
+        is_float.push_back(t == HYPERDATATYPE_FLOAT ? 1 : 0);
+    }
+
+    uint16_t group_by_num = 0;
+
+    if (group_by)
+    {
+        group_by_num = sc->lookup_attr(group_by);
+
+        if (group_by_num == sc->attrs_sz)
+        {
+            ERROR(UNKNOWNATTR) << "\"" << e::strescape(group_by)
+                               << "\" is not an attribute of space \""
+                               << e::strescape(space) << "\"";
+            return -1 - chks_sz;
+        }
+
+        if (group_by_num == 0 ||
+            sc->attrs[group_by_num].type != HYPERDATATYPE_STRING)
+        {
+            ERROR(WRONGTYPE) << "cannot group by attribute \""
+                             << e::strescape(group_by)
+                             << "\": it must be a string attribute other than the key";
+            return -1 - chks_sz;
+        }
+    }
+
+    int64_t client_id = m_next_client_id++;
+    e::intrusive_ptr<pending_aggregation> op;
+    op = new pending_aggregate(client_id, status, funcs, is_float,
+                               group_by != NULL, groups, groups_sz);
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+              + pack_size(checks)
+              + sizeof(group_by_num)
+              + pack_size(wire);
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << checks << group_by_num << wire;
+    return perform_aggregation(servers, op, REQ_AGGREGATE, msg, status);
+}
+
+int64_t
+client :: changes(const char* space,
+                  uint64_t checkpoint,
+                  hyperdex_client_returncode* status,
+                  const hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                  uint64_t* version, int* deleted,
+                  uint64_t* resume)
+{
+    if (!maintain_coord_connection(status))
+    {
+        return -1;
+    }
+
+    const schema* sc = m_config.get_schema(space);
+
+    if (!sc)
+    {
+        ERROR(UNKNOWNSPACE) << "space \"" << e::strescape(space) << "\" does not exist";
+        return -1;
+    }
+
+    // the servers would have to check every change against the caller's
+    // macaroons; they do not, and serve no changes instead
+    if (sc->authorization)
+    {
+        ERROR(UNAUTHORIZED) << "space \"" << e::strescape(space)
+                            << "\" uses authorization and has no change stream";
+        return -1;
+    }
+
+    std::vector<virtual_server_id> servers;
+    m_config.lookup_changes(space, &servers);
+
+    if (servers.empty())
+    {
+        ERROR(OFFLINE) << "no regions of space \"" << e::strescape(space)
+                       << "\" are online";
+        return -1;
+    }
+
+    int64_t client_id = m_next_client_id++;
+    e::intrusive_ptr<pending_aggregation> op;
+    op = new pending_changes(this, client_id, checkpoint, status,
+                             attrs, attrs_sz, version, deleted, resume);
+    // the servers compress batches for a client that can undo it
+    uint8_t can_decompress = compression_available() ? 1 : 0;
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+              + 2 * sizeof(uint64_t)
+              + 2 * sizeof(uint32_t)
+              + sizeof(uint8_t);
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ)
+        << static_cast<uint64_t>(client_id) << checkpoint
+        << static_cast<uint32_t>(HYPERDEX_CLIENT_SEARCH_BATCH_OBJECTS)
+        << static_cast<uint32_t>(HYPERDEX_CLIENT_SEARCH_BATCH_BYTES)
+        << can_decompress;
+    return perform_aggregation(servers, op, REQ_CHANGES_START, msg, status);
+}
+
+int64_t
+client :: perform_funcall(const hyperdex_client_keyop_info* opinfo,
+                          const char* space, const char* _key, size_t _key_sz,
+                          const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                          const hyperdex_client_attribute* attrs, size_t attrs_sz,
+                          const hyperdex_client_map_attribute* mapattrs, size_t mapattrs_sz,
+                          hyperdex_client_returncode* status)
+{
+    if (!maintain_coord_connection(status))
+    {
+        return -1;
+    }
+
+    const schema* sc = m_config.get_schema(space);
+
+    if (!sc)
+    {
+        ERROR(UNKNOWNSPACE) << "space \"" << e::strescape(space) << "\" does not exist";
+        return -1;
+    }
+
+    datatype_info* di = datatype_info::lookup(sc->attrs[0].type);
+    assert(di);
+    e::slice key(_key, _key_sz);
+
+    if (!di->validate(key))
+    {
+        ERROR(WRONGTYPE) << "key must be type " << sc->attrs[0].type;
+        return -1;
+    }
+
+    m_read_cache.invalidate(space, key);
+    e::intrusive_ptr<pending> op;
+    op = new pending_atomic(m_next_client_id++, status);
+    std::auto_ptr<e::buffer> msg;
+    auth_wallet aw(m_macaroons, m_macaroons_sz);
+    size_t header_sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+                     + pack_size(key);
+    size_t footer_sz = 0;
+
+    if (m_macaroons_sz)
+    {
+        footer_sz += pack_size(aw);
+    }
+
+    int64_t ret = perform_funcall(space, sc, opinfo,
+                                  chks, chks_sz,
+                                  attrs, attrs_sz,
+                                  mapattrs, mapattrs_sz,
+                                  header_sz, footer_sz,
+                                  status, &msg);
+
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << key;
+
+    if (m_macaroons_sz)
+    {
+        msg->pack_at(msg->capacity() - footer_sz) << aw;
+    }
+
+    return send_keyop(space, key, REQ_ATOMIC, msg, op, status);
+}
+
+namespace
+{
+
+// orders the slots of a prepared operation as perform_funcall sorts the
+// checks and funcalls it sends
+bool
+slot_attr_less(const hyperdex::prepared::slot& lhs, const hyperdex::prepared::slot& rhs)
+{
+    return lhs.attr < rhs.attr;
+}
+
+void
+fill_slot(const char* name, hyperdatatype datatype, size_t value,
+          hyperdex::prepared::slot* sl)
+{
+    sl->name = name;
+    sl->path = sl->name.find_first_of("[.");
+    sl->attr_name = sl->name.substr(0, sl->path);
+
+    if (sl->path != std::string::npos)
+    {
+        ++sl->path;
+    }
+
+    sl->datatype = datatype;
+    sl->value = value;
+}
+
+} // namespace
+
+hyperdex::prepared*
+client :: prepare(const char* method, const char* space,
+                  const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                  const hyperdex_client_attribute* attrs, size_t attrs_sz,
+                  hyperdex_client_returncode* status)
+{
+    const hyperdex_client_keyop_info* opinfo;
+    opinfo = hyperdex_client_keyop_info_lookup(method, strlen(method));
+
+    // group operations go to every server, and microtransactions are
+    // assembled on the client; neither is a single keyed message
+    if (!opinfo ||
+        strncmp(method, "group_", 6) == 0 ||
+        strncmp(method, "uxact_", 6) == 0)
+    {
+        ERROR(WRONGTYPE) << "\"" << e::strescape(method)
+                         << "\" is not a key operation that can be prepared";
+        return NULL;
+    }
+
+    if (!maintain_coord_connection(status))
+    {
+        return NULL;
+    }
+
+    std::auto_ptr<prepared> p(new prepared(opinfo, space));
+    p->checks.resize(chks_sz);
+    p->funcs.resize(attrs_sz);
+
+    for (size_t i = 0; i < chks_sz; ++i)
+    {
+        fill_slot(chks[i].attr, chks[i].datatype, i, &p->checks[i]);
+        p->checks[i].predicate = chks[i].predicate;
+    }
+
+    for (size_t i = 0; i < attrs_sz; ++i)
+    {
+        fill_slot(attrs[i].attr, attrs[i].datatype, chks_sz + i, &p->funcs[i]);
+    }
+
+    if (!resolve_prepared(p.get(), status))
+    {
+        return NULL;
+    }
+
+    return p.release();
+}
+
+bool
+client :: resolve_prepared(prepared* p, hyperdex_client_returncode* status)
+{
+    const schema* sc = m_config.get_schema(p->space.c_str());
+
+    if (!sc)
+    {
+        ERROR(UNKNOWNSPACE) << "space \"" << e::strescape(p->space.c_str()) << "\" does not exist";
+        return false;
+    }
+
+    for (size_t i = 0; i < p->checks.size() + p->funcs.size(); ++i)
+    {
+        const bool is_check = i < p->checks.size();
+        prepared::slot* sl = is_check ? &p->checks[i] : &p->funcs[i - p->checks.size()];
+        sl->attr = lookup_attr(*sc, sl->attr_name.c_str());
+
+        if (sl->attr >= sc->attrs_sz)
+        {
+            ERROR(UNKNOWNATTR) << "\"" << e::strescape(sl->attr_name.c_str())
+                               << "\" is not an attribute of space \""
+                               << e::strescape(p->space.c_str()) << "\"";
+            return false;
+        }
+
+        if (!is_check && sl->attr == 0)
+        {
+            ERROR(DONTUSEKEY) << "attribute \""
+                              << e::strescape(sl->name.c_str())
+                              << "\" is the key and cannot be changed";
+            return false;
+        }
+    }
+
+    std::stable_sort(p->checks.begin(), p->checks.end(), slot_attr_less);
+    std::stable_sort(p->funcs.begin(), p->funcs.end(), slot_attr_less);
+    p->sc = sc;
+    p->generation = m_config_generation;
+    return true;
+}
+
+int64_t
+client :: execute(prepared* p, const char* _key, size_t _key_sz,
+                  const char* const* values, const size_t* values_sz,
+                  hyperdex_client_returncode* status)
+{
+    if (!maintain_coord_connection(status))
+    {
+        return -1;
+    }
+
+    if (p->generation != m_config_generation &&
+        !resolve_prepared(p, status))
+    {
+        return -1;
+    }
+
+    const schema* sc = p->sc;
+    datatype_info* di = datatype_info::lookup(sc->attrs[0].type);
+    assert(di);
+    e::slice key(_key, _key_sz);
+
+    if (!di->validate(key))
+    {
+        ERROR(WRONGTYPE) << "key must be type " << sc->attrs[0].type;
+        return -1;
+    }
+
+    // the slots are already in the order the message sends them, so each
+    // value goes straight into place with no lookup and no sort
+    std::vector<attribute_check> checks(p->checks.size());
+    std::vector<funcall> funcs(p->funcs.size());
+    e::arena memory;
+
+    for (size_t i = 0; i < p->checks.size(); ++i)
+    {
+        const prepared::slot& sl(p->checks[i]);
+        hyperdex_client_attribute_check chk;
+        chk.attr = sl.name.c_str();
+        chk.value = values[sl.value];
+        chk.value_sz = values_sz[sl.value];
+        chk.datatype = sl.datatype;
+        chk.predicate = sl.predicate;
+        const char* path = sl.path != std::string::npos ? sl.name.c_str() + sl.path : NULL;
+
+        if (!prepare_check(*sc, sl.attr, path, chk, sl.value, &memory, status, &checks[i]))
+        {
+            return -2 - sl.value;
+        }
+    }
+
+    for (size_t i = 0; i < p->funcs.size(); ++i)
+    {
+        const prepared::slot& sl(p->funcs[i]);
+        hyperdex_client_attribute a;
+        a.attr = sl.name.c_str();
+        a.value = values[sl.value];
+        a.value_sz = values_sz[sl.value];
+        a.datatype = sl.datatype;
+        const char* path = sl.path != std::string::npos ? sl.name.c_str() + sl.path : NULL;
+
+        if (!prepare_func(*sc, sl.attr, path, p->opinfo, a, &memory, status, &funcs[i]))
+        {
+            return -2 - sl.value;
+        }
+    }
+
+    m_read_cache.invalidate(p->space.c_str(), key);
+    e::intrusive_ptr<pending> op;
+    op = new pending_atomic(m_next_client_id++, status);
+    auth_wallet aw(m_macaroons, m_macaroons_sz);
+    const size_t footer_sz = m_macaroons_sz ? pack_size(aw) : 0;
+    const size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+                    + pack_size(key)
+                    + sizeof(uint8_t)
+                    + pack_size(checks)
+                    + pack_size(funcs)
+                    + footer_sz;
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    const hyperdex_client_keyop_info* opinfo = p->opinfo;
+    uint8_t flags = (opinfo->fail_if_not_found ? 1 : 0)
+                  | (opinfo->fail_if_found ? 2 : 0)
+                  | (opinfo->erase ? 0 : 128)
+                  | (m_macaroons_sz ? 64 : 0);
+    msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << key << flags << checks << funcs;
+
+    if (m_macaroons_sz)
+    {
+        msg->pack_at(msg->capacity() - footer_sz) << aw;
+    }
+
+    return send_keyop(p->space.c_str(), key, REQ_ATOMIC, msg, op, status);
+}
+
+int64_t
+client :: perform_group_funcall(const hyperdex_client_keyop_info* opinfo,
+                                const char* space,
+                                const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                                const hyperdex_client_attribute* attrs, size_t attrs_sz,
+                                const hyperdex_client_map_attribute* mapattrs, size_t mapattrs_sz,
+                                hyperdex_client_returncode* status,
+                                uint64_t* update_count)
+{
+    SEARCH_BOILERPLATE
+    int64_t client_id = m_next_client_id++;
+    e::intrusive_ptr<pending_aggregation> op;
+    op = new pending_group_atomic(client_id, status, update_count);
+    std::auto_ptr<e::buffer> inner_msg;
+    ret = perform_funcall(space, sc, opinfo,
+                          chks, chks_sz,
+                          attrs, attrs_sz,
+                          mapattrs, mapattrs_sz,
+                          0, 0, status, &inner_msg);
+
+    if (ret < 0)
+    {
+        return ret;
+    }
+
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+              + sizeof(uint64_t)
+              + pack_size(checks)
+              + inner_msg->size();
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ);
+    e::slice ims = inner_msg->as_slice();
+    pa = pa << checks << e::pack_memmove(ims.data(), ims.size());
+    return perform_aggregation(servers, op, REQ_GROUP_ATOMIC, msg, status);
+}
+
+int64_t
+client :: loop(int timeout, hyperdex_client_returncode* status)
+{
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    m_last_error = e::error();
+    flush();
+    // a shared client never blocks in BusyBee; it polls with the lock
+    // dropped so that other threads may issue operations meanwhile
+    completion_queue* cq = m_shared ? queue_for(pthread_self()) : NULL;
+    const uint64_t start = cq || !m_hedges.empty() || !m_op_deadlines.empty() ||
+                           !m_throttle_deadlines.empty()
+                         ? po6::monotonic_time() : 0;
+    bool waited = false;
+
+    while (has_work(cq))
+    {
+        if (m_yielding)
+        {
+            if (!m_yielding->can_yield())
+            {
+                m_yielding = NULL;
+                continue;
+            }
+
+            if (cq && !pthread_equal(m_yielding->owner(), pthread_self()))
+            {
+                hand_off(m_yielding);
+                m_yielding = NULL;
+                continue;
+            }
+
+            if (!m_yielding->yield(status, &m_last_error))
+            {
+                return -1;
+            }
+
+            int64_t client_id = m_yielding->client_visible_id();
+            m_last_error = m_yielding->error();
+
+            if (!m_yielding->can_yield())
+            {
+                (cq ? cq->yielded : m_yielded) = m_yielding;
+                m_yielding = NULL;
+            }
+
+            return client_id;
+        }
+        else if (cq && !cq->ready.empty())
+        {
+            m_yielding = cq->ready.front();
+            cq->ready.pop_front();
+            continue;
+        }
+        else if (!m_yieldable.empty())
+        {
+            m_yielding = m_yieldable.front();
+            m_yieldable.pop_front();
+            continue;
+        }
+        else if (!m_failed.empty())
+        {
+            const pending_server_pair& psp(m_failed.front());
+            psp.op->handle_failure(psp.si, psp.vsi);
+
+            if (psp.op->deadline() != 0 &&
+                psp.op->deadline() <= po6::monotonic_time())
+            {
+                psp.op->expire();
+            }
+
+            m_yielding = psp.op;
+            m_failed.pop_front();
+            continue;
+        }
+
+        m_flagfd.clear();
+        (cq ? cq->yielded : m_yielded) = NULL;
+        assert(!m_pending_ops.empty());
+
+        if (!maintain_coord_connection(status))
+        {
+            return -1;
+        }
+
+        expire_ops();
+
+        if (!m_failed.empty())
+        {
+            continue;
+        }
+
+        // wake for the next hedged get, throttled request or deadline that
+        // comes due, if it is sooner
+        fire_hedges();
+        resend_throttled();
+
+        if (!m_failed.empty())
+        {
+            continue;
+        }
+
+        const int timer_ms = sooner_ms(sooner_ms(hedge_wait(), throttle_wait()),
+                                       deadline_wait());
+        int wait = cq ? 0 : timeout;
+        bool timer_due = false;
+
+        if (!cq && timer_ms >= 0)
+        {
+            wait = remaining_ms(timeout, start);
+
+            if (wait < 0 || timer_ms < wait)
+            {
+                wait = timer_ms;
+                timer_due = true;
+            }
+        }
+
+        uint64_t sid_num;
+        std::auto_ptr<e::buffer> msg;
+        m_busybee.set_timeout(wait);
+        const uint64_t recv_start = m_stats.enabled() && wait != 0 ? po6::monotonic_time() : 0;
+        busybee_returncode rc = m_busybee.recv(&sid_num, &msg);
+        server_id id(sid_num);
+
+        if (recv_start > 0)
+        {
+            m_stats.record_wait(po6::monotonic_time() - recv_start);
+        }
+
+        if (timer_due && rc == BUSYBEE_TIMEOUT)
+        {
+            continue;
+        }
+
+        if (cq && rc == BUSYBEE_TIMEOUT)
+        {
+            int remain = remaining_ms(timeout, start);
+
+            if (timer_ms >= 0 && (remain < 0 || timer_ms < remain))
+            {
+                remain = timer_ms;
+                timer_due = true;
+            }
+
+            if (remain != 0 || !waited || timer_due)
+            {
+                const uint64_t wait_start = m_stats.enabled() ? po6::monotonic_time() : 0;
+                int ret = wait_unlocked(cq, remain);
+
+                if (wait_start > 0)
+                {
+                    m_stats.record_wait(po6::monotonic_time() - wait_start);
+                }
+
+                // other threads' errors went by while we were unlocked
+                m_last_error = e::error();
+                waited = true;
+
+                if (ret < 0)
+                {
+                    ERROR(POLLFAILED) << "poll failed: " << po6::strerror(errno);
+                    return -1;
+                }
+                else if (ret > 0 || timer_due)
+                {
+                    continue;
+                }
+            }
+        }
+
+        switch (rc)
+        {
+            case BUSYBEE_SUCCESS:
+                break;
+            case BUSYBEE_INTERRUPTED:
+                ERROR(INTERRUPTED) << "signal received";
+                return -1;
+            case BUSYBEE_TIMEOUT:
+                ERROR(TIMEOUT) << "operation timed out";
+                return -1;
+            case BUSYBEE_DISRUPTED:
+                handle_disruption(id);
+                continue;
+            case BUSYBEE_EXTERNAL:
+                continue;
+            BUSYBEE_ERROR_CASE(POLLFAILED);
+            BUSYBEE_ERROR_CASE(ADDFDFAIL);
+            BUSYBEE_ERROR_CASE(SHUTDOWN);
+            default:
+                ERROR(INTERNAL) << "internal error: BusyBee unexpectedly returned "
+                                << (unsigned) rc << ": please file a bug";
+                return -1;
+        }
+
+        e::unpacker up = msg->unpack_from(BUSYBEE_HEADER_SIZE);
+        uint8_t mt;
+        virtual_server_id vfrom;
+        int64_t nonce;
+        up = up >> mt >> vfrom >> nonce;
+
+        if (up.error())
+        {
+            ERROR(SERVERERROR) << "communication error: server "
+                               << sid_num << " sent message="
+                               << msg->as_slice().hex()
+                               << " with invalid header";
+            return -1;
+        }
+
+        network_msgtype msg_type = static_cast<network_msgtype>(mt);
+        pending_map_t::iterator it = m_pending_ops.find(nonce);
+
+        if (it == m_pending_ops.end())
+        {
+            continue;
+        }
+
+        const pending_server_pair psp(it->second);
+        e::intrusive_ptr<pending> op = psp.op;
+        m_pending_ops.erase(it);
+
+        if (psp.sent > 0)
+        {
+            m_stats.record_reply(psp.mt, id.get(), po6::monotonic_time() - psp.sent);
+        }
+
+        if (msg_type == CONFIGMISMATCH)
+        {
+            m_config_stale = m_config_cached;
+
+            if (!hedge_absorbs(nonce))
+            {
+                m_failed.push_back(psp);
+                m_stats.record_failed_reconfigure(1);
+            }
+
+            continue;
+        }
+
+        if (!throttle_reply(nonce, psp, up))
+        {
+            continue;
+        }
+
+        if (!hedge_reply(nonce, up))
+        {
+            continue;
+        }
+
+        if (msg_type == RESP_SEARCH_COMPRESSED)
+        {
+            decompress_page(&msg_type, &msg, &up);
+        }
+
+        if (vfrom == psp.vsi &&
+            id == psp.si &&
+            m_config.get_server_id(vfrom) == id)
+        {
+            if (!op->handle_message(this, id, vfrom, msg_type, msg, up, status, &m_last_error))
+            {
+                return -1;
+            }
+
+            m_yielding = psp.op;
+        }
+        else
+        {
+            ERROR(SERVERERROR) << "wrong server replied for nonce=" << nonce
+                               << ": expected it to come from "
+                               << psp.vsi << "/" << psp.si
+                               << "; it came from "
+                               << vfrom << "/" << id
+                               << "; our config says that virtual_id should map to "
+                               << m_config.get_server_id(vfrom);
+            return -1;
+        }
+    }
+
+    uint64_t sid_num;
+    m_busybee.set_timeout(0);
+    busybee_returncode rc = m_busybee.recv_no_msg(&sid_num);
+
+    switch (rc)
+    {
+        case BUSYBEE_SUCCESS:
+        case BUSYBEE_TIMEOUT:
+            break;
+        case BUSYBEE_INTERRUPTED:
+            ERROR(INTERRUPTED) << "signal received";
+            return -1;
+        case BUSYBEE_DISRUPTED:
+            handle_disruption(server_id(sid_num));
+            break;
+        case BUSYBEE_EXTERNAL:
+            if (!maintain_coord_connection(status))
+            {
+                return -1;
+            }
+            break;
+        BUSYBEE_ERROR_CASE(POLLFAILED);
+        BUSYBEE_ERROR_CASE(ADDFDFAIL);
+        BUSYBEE_ERROR_CASE(SHUTDOWN);
+        default:
+            ERROR(INTERNAL) << "internal error: BusyBee unexpectedly returned "
+                            << (unsigned) rc << ": please file a bug";
+            return -1;
+    }
+
+    ERROR(NONEPENDING) << "no outstanding operations to process";
+    return -1;
+}
+
+int
+client :: poll_fd()
+{
+    return m_busybee.poll_fd();
+}
+
+void
+client :: adjust_flagfd()
+{
+    if (!m_failed.empty() ||
+        !m_yieldable.empty() ||
+        m_yielding.get())
+    {
+        m_flagfd.set();
+    }
+
+    assert(m_yieldable.empty() || m_flagfd.isset());
+}
+
+int
+client :: block(int timeout)
+{
+    flush();
+
+    if (m_shared)
+    {
+        return wait_unlocked(queue_for(pthread_self()), timeout) >= 0 ? 0 : -1;
+    }
+
+    pollfd pfd;
+    pfd.fd = m_busybee.poll_fd();
+    pfd.events = POLLIN|POLLHUP;
+    pfd.revents = 0;
+    return ::poll(&pfd, 1, timeout) >= 0 ? 0 : -1;
+}
+
+const char*
+client :: error_message()
+{
+    if (m_shared)
+    {
+        po6::threads::mutex::hold hold(&m_protect);
+        return queue_for(pthread_self())->last_error.msg();
+    }
+
+    return m_last_error.msg();
+}
+
+const char*
+client :: error_location()
+{
+    if (m_shared)
+    {
+        po6::threads::mutex::hold hold(&m_protect);
+        return queue_for(pthread_self())->last_error.loc();
+    }
+
+    return m_last_error.loc();
+}
+
+void
+client :: set_error_message(const char* msg)
+{
+    m_last_error = e::error();
+    m_last_error.set_loc(__FILE__, __LINE__);
+    m_last_error.set_msg() << msg;
+}
+
+hyperdatatype
+client :: attribute_type(const char* space, const char* name,
+                         hyperdex_client_returncode* status)
+{
+    if (maintain_coord_connection(status) < 0)
+    {
+        return HYPERDATATYPE_GARBAGE;
+    }
+
+    const hyperdex::schema* sc = m_config.get_schema(space);
+
+    if (!sc)
+    {
+        ERROR(UNKNOWNSPACE) << "space \"" << e::strescape(space) << "\" does not exist";
+        return HYPERDATATYPE_GARBAGE;
+    }
+
+    uint16_t attrnum = sc->lookup_attr(name);
+
+    if (attrnum == sc->attrs_sz)
+    {
+        ERROR(UNKNOWNATTR) << "\"" << e::strescape(name)
+                           << "\" is not an attribute of space \""
+                           << e::strescape(space) << "\"";
+        return HYPERDATATYPE_GARBAGE;
+    }
+
+    return sc->attrs[attrnum].type;
+}
+
+uint16_t
+client :: lookup_attr(const schema& sc, const char* name)
+{
+    const uintptr_t addr = reinterpret_cast<uintptr_t>(name);
+    attr_hint* hint = &m_attr_hints[(addr ^ (addr >> 12)) % m_attr_hints.size()];
+    const uint16_t attr = sc.lookup_attr(name, hint->name == name ? hint->attr : UINT16_MAX);
+    hint->name = name;
+    hint->attr = attr;
+    return attr;
+}
+
+size_t
+client :: prepare_checks(const char* space, const schema& sc,
+                         const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                         e::arena* memory,
+                         hyperdex_client_returncode* status,
+                         std::vector<attribute_check>* checks)
+{
+    checks->reserve(checks->size() + chks_sz);
+
+    for (size_t i = 0; i < chks_sz; ++i)
+    {
+        std::string scratch;
+        const char* attr;
+        const char* path;
+        parse_document_path(chks[i].attr, &attr, &path, &scratch);
+        uint16_t attrnum = lookup_attr(sc, attr);
+
+        if (attrnum >= sc.attrs_sz)
+        {
+            ERROR(UNKNOWNATTR) << "\"" << e::strescape(attr)
+                               << "\" is not an attribute of space \""
+                               << e::strescape(space) << "\"";
+            return i;
+        }
+
+        attribute_check c;
+
+        if (!prepare_check(sc, attrnum, path, chks[i], i, memory, status, &c))
+        {
+            return i;
+        }
+
+        checks->push_back(c);
+    }
+
+    return chks_sz;
+}
+
+bool
+client :: prepare_check(const schema& sc, uint16_t attrnum, const char* path,
+                        const hyperdex_client_attribute_check& chk, size_t i,
+                        e::arena* memory,
+                        hyperdex_client_returncode* status,
+                        attribute_check* c)
+{
+    hyperdatatype datatype = chk.datatype;
+
+    if (datatype == CONTAINER_TYPE(datatype) &&
+        CONTAINER_TYPE(datatype) == CONTAINER_TYPE(sc.attrs[attrnum].type) &&
+        (chk.value_sz == 0 || datatype == HYPERDATATYPE_TIMESTAMP_GENERIC))
+    {
+        datatype = sc.attrs[attrnum].type;
+    }
+
+    c->attr = attrnum;
+    c->value = e::slice(chk.value, chk.value_sz);
+    c->datatype = datatype;
+    c->predicate = chk.predicate;
+    datatype_info* vtype = datatype_info::lookup(c->datatype);
+
+    if (!vtype->client_to_server(c->value, memory, &c->value))
+    {
+        ERROR(WRONGTYPE) << "check[" << i << "], which is on attribute \""
+                         << e::strescape(sc.attrs[attrnum].name)
+                         << "\", does not meet the constraints of its type";
+        return false;
+    }
+
+    if (!path && datatype == HYPERDATATYPE_DOCUMENT)
+    {
+        // Document datatype always requires a path. Empty means root.
+        path = "";
+    }
+
+    if (path)
+    {
+        size_t path_sz = strlen(path) + 1;
+        size_t sz = path_sz + c->value.size();
+        unsigned char* tmp = NULL;
+        memory->allocate(path_sz + c->value.size(), &tmp);
+        memmove(tmp, path, path_sz);
+        memmove(tmp + path_sz, c->value.data(), c->value.size());
+
+        c->value = e::slice(tmp, sz);
+    }
+
+    if (!validate_attribute_check(sc.attrs[attrnum].type, *c))
+    {
+        ERROR(WRONGTYPE) << "invalid predicate on \""
+                         << e::strescape(sc.attrs[attrnum].name) << "\"";
+        return false;
+    }
+
+    return true;
+}
+
+size_t
+client :: prepare_funcs(const char* space, const schema& sc,
+                        const hyperdex_client_keyop_info* opinfo,
+                        const hyperdex_client_attribute* attrs, size_t attrs_sz,
+                        e::arena* memory,
+                        hyperdex_client_returncode* status,
+                        std::vector<funcall>* funcs)
+{
+    funcs->reserve(funcs->size() + attrs_sz);
+
+    for (size_t i = 0; i < attrs_sz; ++i)
+    {
+        std::string scratch;
+        const char* attr;
+        const char* path;
+        parse_document_path(attrs[i].attr, &attr, &path, &scratch);
+        uint16_t attrnum = lookup_attr(sc, attr);
+
+        if (attrnum == sc.attrs_sz)
+        {
+            ERROR(UNKNOWNATTR) << "\"" << e::strescape(attr)
+                               << "\" is not an attribute of space \""
+                               << e::strescape(space) << "\"";
+            return i;
+        }
+
+        if (attrnum == 0)
+        {
+            ERROR(DONTUSEKEY) << "attribute \""
+                              << e::strescape(attrs[i].attr)
+                              << "\" is the key and cannot be changed";
+            return i;
+        }
+
+        funcall o;
+
+        if (!prepare_func(sc, attrnum, path, opinfo, attrs[i], memory, status, &o))
+        {
+            return i;
+        }
+
+        funcs->push_back(o);
+    }
+
+    return attrs_sz;
+}
+
+bool
+client :: prepare_func(const schema& sc, uint16_t attrnum, const char* path,
+                       const hyperdex_client_keyop_info* opinfo,
+                       const hyperdex_client_attribute& a,
+                       e::arena* memory,
+                       hyperdex_client_returncode* status,
+                       funcall* o)
+{
+    hyperdatatype datatype = a.datatype;
+
+    if (datatype == CONTAINER_TYPE(datatype) &&
+        CONTAINER_TYPE(datatype) == CONTAINER_TYPE(sc.attrs[attrnum].type) &&
+        (a.value_sz == 0 || datatype == HYPERDATATYPE_TIMESTAMP_GENERIC))
+    {
+        datatype = sc.attrs[attrnum].type;
+    }
+
+    if (sc.attrs[attrnum].type == HYPERDATATYPE_MACAROON_SECRET)
+    {
+        datatype = HYPERDATATYPE_MACAROON_SECRET;
+    }
+
+    o->attr = attrnum;
+    o->name = opinfo->fname;
+    o->arg1 = e::slice(a.value, a.value_sz);
+    o->arg1_datatype = datatype;
+    datatype_info* type = datatype_info::lookup(sc.attrs[attrnum].type);
+    datatype_info* a1type = datatype_info::lookup(o->arg1_datatype);
+
+    if (m_convert_types)
+    {
+        if (!a1type->client_to_server(o->arg1, memory, &o->arg1))
+        {
+            ERROR(WRONGTYPE) << "attribute \""
+                         << e::strescape(a.attr)
+                         << "\" does not meet the constraints of its type";
+            return false;
+        }
+    }
+
+    if (path != NULL)
+    {
+        o->arg2 = e::slice(path, strlen(path) + 1);
+        o->arg2_datatype = HYPERDATATYPE_STRING;
+    }
+
+    if (!type->check_args(*o))
+    {
+        ERROR(WRONGTYPE) << "invalid attribute \""
+                         << e::strescape(a.attr)
+                         << "\": attribute has the wrong type";
+        return false;
+    }
+
+    return true;
+}
+
+size_t
+client :: prepare_funcs(const char* space, const schema& sc,
+                        const hyperdex_client_keyop_info* opinfo,
+                        const hyperdex_client_map_attribute* mapattrs, size_t mapattrs_sz,
+                        e::arena* memory,
+                        hyperdex_client_returncode* status,
+                        std::vector<funcall>* funcs)
+{
+    funcs->reserve(funcs->size() + mapattrs_sz);
+
+    for (size_t i = 0; i < mapattrs_sz; ++i)
+    {
+        uint16_t attrnum = lookup_attr(sc, mapattrs[i].attr);
+
+        if (attrnum == sc.attrs_sz)
+        {
+            ERROR(UNKNOWNATTR) << "\"" << e::strescape(mapattrs[i].attr)
+                               << "\" is not an attribute of space \""
+                               << e::strescape(space) << "\"";
+            return i;
+        }
+
+        if (attrnum == 0)
+        {
+            ERROR(DONTUSEKEY) << "attribute \""
+                              << e::strescape(mapattrs[i].attr)
+                              << "\" is the key and cannot be changed";
+            return i;
+        }
+
+        hyperdatatype k_datatype = mapattrs[i].map_key_datatype;
+
+        if (k_datatype == CONTAINER_TYPE(k_datatype) &&
+            CONTAINER_TYPE(k_datatype) == CONTAINER_TYPE(sc.attrs[attrnum].type) &&
+            mapattrs[i].value_sz == 0)
+        {
+            k_datatype = sc.attrs[attrnum].type;
+        }
+
+        hyperdatatype v_datatype = mapattrs[i].value_datatype;
+
+        if (v_datatype == CONTAINER_TYPE(v_datatype) &&
+            CONTAINER_TYPE(v_datatype) == CONTAINER_TYPE(sc.attrs[attrnum].type) &&
+            mapattrs[i].value_sz == 0)
+        {
+            v_datatype = sc.attrs[attrnum].type;
+        }
+
+        funcall o;
+        o.attr = attrnum;
+        o.name = opinfo->fname;
+        o.arg2 = e::slice(mapattrs[i].map_key, mapattrs[i].map_key_sz);
+        o.arg2_datatype = k_datatype;
+        o.arg1 = e::slice(mapattrs[i].value, mapattrs[i].value_sz);
+        o.arg1_datatype = v_datatype;
+        datatype_info* type = datatype_info::lookup(sc.attrs[attrnum].type);
+        datatype_info* ktype = datatype_info::lookup(k_datatype);
+        datatype_info* vtype = datatype_info::lookup(k_datatype);
+
+        if (!ktype->client_to_server(o.arg2, memory, &o.arg2))
+        {
+            ERROR(WRONGTYPE) << "key of [" << i << "], which modifies attribute \""
+                             << e::strescape(mapattrs[i].attr)
+                             << "\", does not meet the constraints of its type";
+            return i;
+        }
+
+        if (!vtype->client_to_server(o.arg1, memory, &o.arg1))
+        {
+            ERROR(WRONGTYPE) << "value of [" << i << "], which modifies attribute \""
+                             << e::strescape(mapattrs[i].attr)
+                             << "\", does not meet the constraints of its type";
+            return i;
+        }
+
+        if (!type->check_args(o))
+        {
+            ERROR(WRONGTYPE) << "invalid attribute \""
+                             << e::strescape(mapattrs[i].attr)
+                             << "\": attribute has the wrong type";
+            return i;
+        }
+
+        funcs->push_back(o);
+    }
+
+    return mapattrs_sz;
+}
+
+size_t
+client :: prepare_searchop(const schema& sc,
+                           const char* space,
+                           const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                           e::arena* memory,
+                           hyperdex_client_returncode* status,
+                           std::vector<attribute_check>* checks,
+                           std::vector<virtual_server_id>* servers)
+{
+    size_t num_checks = prepare_checks(space, sc, chks, chks_sz, memory, status, checks);
+
+    if (num_checks != chks_sz)
+    {
+        return -1 - num_checks;
+    }
+
+    std::stable_sort(checks->begin(), checks->end());
+    m_config.lookup_search(space, *checks, servers); // XXX search guaranteed empty vs. search encounters offline server
+
+    if (servers->empty())
+    {
+        // XXX NOCOMMIT
+        ERROR(INTERNAL) << "there are no servers for the search";
+        *status = HYPERDEX_CLIENT_INTERNAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+int64_t
+client :: perform_funcall(const char* space, const schema* sc,
+                          const hyperdex_client_keyop_info* opinfo,
+                          const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                          const hyperdex_client_attribute* attrs, size_t attrs_sz,
+                          const hyperdex_client_map_attribute* mapattrs, size_t mapattrs_sz,
+                          size_t header_sz,
+                          size_t footer_sz,
+                          hyperdex_client_returncode* status,
+                          std::auto_ptr<e::buffer>* msg)
+{
+    std::vector<attribute_check> checks;
+    std::vector<funcall> funcs;
+    size_t idx = 0;
+    e::arena memory;
+
+    // Prepare the checks
+    idx = prepare_checks(space, *sc, chks, chks_sz, &memory, status, &checks);
+
+    if (idx < chks_sz)
+    {
+        return -2 - idx;
+    }
+
+    // Prepare the attrs
+    idx = prepare_funcs(space, *sc, opinfo, attrs, attrs_sz, &memory, status, &funcs);
+
+    if (idx < attrs_sz)
+    {
+        return -2 - chks_sz - idx;
+    }
+
+    // Prepare the mapattrs
+    idx = prepare_funcs(space, *sc, opinfo, mapattrs, mapattrs_sz, &memory, status, &funcs);
+
+    if (idx < mapattrs_sz)
+    {
+        return -2 - chks_sz - attrs_sz - idx;
+    }
+
+    std::stable_sort(checks.begin(), checks.end());
+    std::stable_sort(funcs.begin(), funcs.end());
+    size_t sz = header_sz + footer_sz
+              + sizeof(uint8_t)
+              + pack_size(checks)
+              + pack_size(funcs);
+    msg->reset(e::buffer::create(sz));
+    uint8_t flags = (opinfo->fail_if_not_found ? 1 : 0)
+                  | (opinfo->fail_if_found ? 2 : 0)
+                  | (opinfo->erase ? 0 : 128)
+                  | (m_macaroons_sz ? 64 : 0);
+    (*msg)->pack_at(header_sz) << flags << checks << funcs;
+    return 0;
+}
+
+int64_t
+client :: perform_search(const char* space,
+                         const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                         uint64_t limit,
+                         uint64_t sample,
+                         hyperdex_ds_arena* arena,
+                         hyperdex_client_returncode* status,
+                         const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+{
+    SEARCH_BOILERPLATE
+    int64_t client_id = m_next_client_id++;
+    e::intrusive_ptr<pending_search> sop;
+    sop = new pending_search(this, client_id, limit, status, attrs, attrs_sz);
+    sop->set_arena(arena);
+    e::intrusive_ptr<pending_aggregation> op(sop.get());
+    // the servers compress batches for a client that can undo it
+    uint8_t flags = compression_available() ? 1 : 0;
+    // a fresh seed draws a different sample each time
+    uint64_t seed = po6::monotonic_time() ^ (client_id * 0x9e3779b97f4a7c15ULL);
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+              + sizeof(uint64_t)
+              + pack_size(checks)
+              + 2 * sizeof(uint32_t)
+              + sizeof(uint64_t)
+              + sizeof(uint8_t)
+              + (sample > 0 ? 2 * sizeof(uint64_t) : 0);
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ)
+        << client_id << checks
+        << static_cast<uint32_t>(HYPERDEX_CLIENT_SEARCH_BATCH_OBJECTS)
+        << static_cast<uint32_t>(HYPERDEX_CLIENT_SEARCH_BATCH_BYTES)
+        << limit << flags;
+
+    if (sample > 0)
+    {
+        pa = pa << sample << seed;
+    }
+
+    return perform_aggregation(servers, op, REQ_SEARCH_START, msg, status);
+}
+
+int64_t
+client :: perform_aggregation(const std::vector<virtual_server_id>& servers,
+                              e::intrusive_ptr<pending_aggregation> _op,
+                              network_msgtype mt,
+                              std::auto_ptr<e::buffer> msg,
+                              hyperdex_client_returncode* status)
+{
+    e::intrusive_ptr<pending> op(_op.get());
+    m_corking_searches = true;
+
+    for (size_t i = 0; i < servers.size(); ++i)
+    {
+        uint64_t nonce = m_next_server_nonce++;
+        pending_server_pair psp(m_config.get_server_id(servers[i]), servers[i], op);
+        std::auto_ptr<e::buffer> msg_copy(msg->copy());
+
+        if (!send(mt, psp.vsi, nonce, msg_copy, op, status))
+        {
+            m_failed.push_back(psp);
+        }
+    }
+
+    m_corking_searches = false;
+    flush_search_corks(mt, op);
+    return op->client_visible_id();
+}
+
+bool
+client :: maintain_coord_connection(hyperdex_client_returncode* status)
+{
+    const uint64_t start = m_stats.enabled() ? po6::monotonic_time() : 0;
+
+    if (m_config_status != REPLICANT_SUCCESS)
+    {
+        replicant_client_kill(m_coord, m_config_id);
+        m_config_id = -1;
+    }
+
+    replicant_returncode rc;
+
+    if (m_config_id < 0)
+    {
+        m_config_status = REPLICANT_SUCCESS;
+        m_config_id = replicant_client_cond_follow(m_coord, "hyperdex", "config",
+                                                   &m_config_status, &m_config_state,
+                                                   &m_config_data, &m_config_data_sz);
+
+        // a cached configuration routes operations while we wait
+        if (!m_config_cached &&
+            replicant_client_wait(m_coord, m_config_id, -1, &rc) < 0)
+        {
+            ERROR(COORDFAIL) << "coordinator failure: " << replicant_client_error_message(m_coord);
+            return false;
+        }
+    }
+
+    if (m_config_cached && m_config_stale && m_config_state == 0)
+    {
+        if (replicant_client_wait(m_coord, m_config_id, -1, &rc) < 0)
+        {
+            ERROR(COORDFAIL) << "coordinator failure: " << replicant_client_error_message(m_coord);
+            return false;
+        }
+    }
+
+    if (replicant_client_loop(m_coord, 0, &rc) < 0)
+    {
+        if (rc == REPLICANT_INTERRUPTED)
+        {
+            ERROR(INTERRUPTED) << "interrupted by a signal";
+            return false;
+        }
+        else if (rc != REPLICANT_NONE_PENDING && rc != REPLICANT_TIMEOUT)
+        {
+            ERROR(COORDFAIL) << "coordinator failure: " << replicant_client_error_message(m_coord);
+            return false;
+        }
+    }
+
+    // the coordinator's configuration replaces a cached one even if it is
+    // no newer, as the cache may be of another incarnation of the cluster
+    if (m_config.version() < m_config_state ||
+        (m_config_cached && m_config_state > 0))
+    {
+        configuration new_config;
+        e::unpacker up(m_config_data, m_config_data_sz);
+        up = up >> new_config;
+
+        if (!up.error())
+        {
+            m_config = new_config;
+            ++m_config_generation;
+            m_config_cached = false;
+            m_config_stale = false;
+            m_config_cache.save(m_config);
+            // cached entries name regions of the old configuration
+            m_read_cache.clear();
+        }
+
+        pending_map_t::iterator it = m_pending_ops.begin();
+
+        while (it != m_pending_ops.end())
+        {
+            // If the mapping that was true when the operation started is no
+            // longer true, we fail the operation with a RECONFIGURE.
+            if (m_config.get_server_id(it->second.vsi) != it->second.si)
+            {
+                if (!hedge_absorbs(it->first))
+                {
+                    m_failed.push_back(it->second);
+                    m_stats.record_failed_reconfigure(1);
+                }
+
+                m_pending_ops.erase(it);
+                it = m_pending_ops.begin();
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        if (start > 0)
+        {
+            m_stats.record_config_refresh(po6::monotonic_time() - start);
+        }
+    }
+
+    return true;
+}
+
+bool
+client :: send(network_msgtype mt,
+               const virtual_server_id& to,
+               uint64_t nonce,
+               std::auto_ptr<e::buffer> msg,
+               e::intrusive_ptr<pending> op,
+               hyperdex_client_returncode* status)
+{
+    const uint8_t type = static_cast<uint8_t>(mt);
+    const uint8_t flags = 0x4; // with a budget
+    const uint64_t version = m_config.version();
+    const uint32_t budget = op_budget(op);
+    msg->pack_at(BUSYBEE_HEADER_SIZE)
+        << type << flags << version << to << budget << nonce;
+    server_id id = m_config.get_server_id(to);
+    const uint64_t sent = m_stats.enabled() ? po6::monotonic_time() : 0;
+
+    if (m_corking && mt == REQ_ATOMIC)
+    {
+        op->handle_sent_to(id, to);
+        m_pending_ops.insert(std::make_pair(nonce, pending_server_pair(id, to, op, mt, sent)));
+        track_deadline(op, nonce);
+        cork_op(id, to, nonce, msg);
+        return true;
+    }
+
+    if (m_corking_searches &&
+        (mt == REQ_SEARCH_START || mt == REQ_SORTED_SEARCH || mt == REQ_COUNT))
+    {
+        op->handle_sent_to(id, to);
+        m_pending_ops.insert(std::make_pair(nonce, pending_server_pair(id, to, op, mt, sent)));
+        track_deadline(op, nonce);
+        cork_search(id, to, nonce, msg);
+        return true;
+    }
+
+    pending_server_pair psp(id, to, op, mt, sent);
+
+    if (may_throttle(mt, to))
+    {
+        psp.retry.reset(new throttled(std::auto_ptr<e::buffer>(msg->copy())));
+    }
+
+    m_busybee.set_timeout(-1);
+    busybee_returncode rc = m_busybee.send(id.get(), msg);
+
+    switch (rc)
+    {
+        case BUSYBEE_SUCCESS:
+            op->handle_sent_to(id, to);
+            m_pending_ops.insert(std::make_pair(nonce, psp));
+            track_deadline(op, nonce);
+            return true;
+        case BUSYBEE_DISRUPTED:
+            handle_disruption(id);
+            ERROR(SERVERERROR) << "server " << id.get() << " had a communication disruption";
+            return false;
+        BUSYBEE_ERROR_CASE_FALSE(SHUTDOWN);
+        BUSYBEE_ERROR_CASE_FALSE(POLLFAILED);
+        BUSYBEE_ERROR_CASE_FALSE(ADDFDFAIL);
+        BUSYBEE_ERROR_CASE_FALSE(TIMEOUT);
+        BUSYBEE_ERROR_CASE_FALSE(EXTERNAL);
+        BUSYBEE_ERROR_CASE_FALSE(INTERRUPTED);
+        default:
+            ERROR(INTERNAL) << "internal error: BusyBee unexpectedly returned "
+                                << (unsigned) rc << ": please file a bug";
+            return false;
+    }
+}
+
+void
+client :: send_no_reply(network_msgtype mt,
+                        const virtual_server_id& to,
+                        std::auto_ptr<e::buffer> msg)
+{
+    const uint8_t type = static_cast<uint8_t>(mt);
+    const uint8_t flags = 0x4; // with a budget
+    const uint64_t version = m_config.version();
+    const uint32_t budget = 0;
+    const uint64_t nonce = m_next_server_nonce++;
+    msg->pack_at(BUSYBEE_HEADER_SIZE)
+        << type << flags << version << to << budget << nonce;
+    server_id id = m_config.get_server_id(to);
+    m_busybee.set_timeout(-1);
+
+    if (m_busybee.send(id.get(), msg) == BUSYBEE_DISRUPTED)
+    {
+        handle_disruption(id);
+    }
+}
+
+int64_t
+client :: send_keyop(const char* space,
+                     const e::slice& key,
+                     network_msgtype mt,
+                     std::auto_ptr<e::buffer> msg,
+                     e::intrusive_ptr<pending> op,
+                     hyperdex_client_returncode* status)
+{
+    virtual_server_id vsi = m_config.point_leader(space, key);
+
+    if (vsi == virtual_server_id())
+    {
+        ERROR(OFFLINE) << "all servers for key \""
+                       << e::strescape(std::string(reinterpret_cast<const char*>(key.data()), key.size()))
+                       << "\" in space \"" << e::strescape(space)
+                       << "\" are offline: bring one or more online to remedy the issue";
+        return -1;
+    }
+
+    int64_t nonce = m_next_server_nonce++;
+
+    if (send(mt, vsi, nonce, msg, op, status))
+    {
+        return op->client_visible_id();
+    }
+    else
+    {
+        ERROR(RECONFIGURE) << "could not send " << mt << " to " << vsi;
+        return -1;
+    }
+}
+
+int64_t
+client :: send_replica_readop(const char* space,
+                              const e::slice& key,
+                              network_msgtype mt,
+                              std::auto_ptr<e::buffer> msg,
+                              e::intrusive_ptr<pending> op,
+                              hyperdex_client_returncode* status)
+{
+    virtual_server_id leader = m_config.point_leader(space, key);
+
+    if (leader == virtual_server_id())
+    {
+        ERROR(OFFLINE) << "all servers for key \""
+                       << e::strescape(std::string(reinterpret_cast<const char*>(key.data()), key.size()))
+                       << "\" in space \"" << e::strescape(space)
+                       << "\" are offline: bring one or more online to remedy the issue";
+        return -1;
+    }
+
+    // take turns down the chain, as get_relaxed does
+    std::vector<virtual_server_id> replicas;
+    m_config.replicas_of_region(m_config.get_region_id(leader), &replicas);
+    int64_t nonce = m_next_server_nonce++;
+    virtual_server_id vsi = replicas.empty() ? leader : replicas[nonce % replicas.size()];
+
+    if (send(mt, vsi, nonce, msg, op, status))
+    {
+        return op->client_visible_id();
+    }
+    else
+    {
+        ERROR(RECONFIGURE) << "could not send " << mt << " to " << vsi;
+        return -1;
+    }
+}
+
+int64_t
+client :: send_hedged_get(const char* space, const e::slice& key,
+                          std::auto_ptr<e::buffer> msg,
+                          e::intrusive_ptr<pending> op,
+                          hyperdex_client_returncode* status)
+{
+    virtual_server_id leader = m_config.point_leader(space, key);
+    std::vector<virtual_server_id> replicas;
+
+    if (leader != virtual_server_id())
+    {
+        m_config.replicas_of_region(m_config.get_region_id(leader), &replicas);
+    }
+
+    // send_keyop takes the next nonce; spread duplicates over the chain by it
+    const uint64_t nonce = m_next_server_nonce;
+    virtual_server_id alt;
+
+    for (size_t i = 0; i < replicas.size(); ++i)
+    {
+        const virtual_server_id& r(replicas[(nonce + i) % replicas.size()]);
+
+        if (r != leader)
+        {
+            alt = r;
+            break;
+        }
+    }
+
+    m_hedging.count_get();
+
+    if (alt == virtual_server_id())
+    {
+        return send_keyop(space, key, REQ_GET, msg, op, status);
+    }
+
+    // the duplicate is a relaxed read that tolerates no missed writes, so its
+    // answer is as good as the point leader's
+    auth_wallet aw(m_macaroons, m_macaroons_sz);
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ + sizeof(uint64_t) + pack_size(key);
+
+    if (m_macaroons_sz)
+    {
+        sz += pack_size(aw);
+    }
 
-            int64_t client_id = m_yielding->client_visible_id();
-            m_last_error = m_yielding->error();
+    std::auto_ptr<e::buffer> dup(e::buffer::create(sz));
+    e::packer pa = dup->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << uint64_t(0) << key;
 
-            if (!m_yielding->can_yield())
-            {
-                m_yielded = m_yielding;
-                m_yielding = NULL;
-            }
+    if (m_macaroons_sz)
+    {
+        pa = pa << aw;
+    }
 
-            return client_id;
-        }
-        else if (!m_yieldable.empty())
-        {
-            m_yielding = m_yieldable.front();
-            m_yieldable.pop_front();
-            continue;
-        }
-        else if (!m_failed.empty())
-        {
-            const pending_server_pair& psp(m_failed.front());
-            psp.op->handle_failure(psp.si, psp.vsi);
-            m_yielding = psp.op;
-            m_failed.pop_front();
-            continue;
-        }
+    // should the original fail and the duplicate then find its replica
+    // behind, the get goes back to the point leader
+    std::auto_ptr<e::buffer> fallback(msg->copy());
+    static_cast<pending_get*>(op.get())->set_fallback(leader, fallback);
+    int64_t ret = send_keyop(space, key, REQ_GET, msg, op, status);
 
-        m_flagfd.clear();
-        m_yielded = NULL;
-        assert(!m_pending_ops.empty());
+    if (ret < 0)
+    {
+        return ret;
+    }
 
-        if (!maintain_coord_connection(status))
-        {
-            return -1;
-        }
+    const uint64_t now = po6::monotonic_time();
+    e::compat::shared_ptr<hedge> h(new hedge(alt, now, dup));
+    h->deadline = m_hedge_deadlines.end();
 
-        uint64_t sid_num;
-        std::auto_ptr<e::buffer> msg;
-        m_busybee.set_timeout(timeout);
-        busybee_returncode rc = m_busybee.recv(&sid_num, &msg);
-        server_id id(sid_num);
+    if (m_hedging.delay() > 0)
+    {
+        h->deadline = m_hedge_deadlines.insert(std::make_pair(now + m_hedging.delay(), nonce));
+    }
 
-        switch (rc)
-        {
-            case BUSYBEE_SUCCESS:
-                break;
-            case BUSYBEE_INTERRUPTED:
-                ERROR(INTERRUPTED) << "signal received";
-                return -1;
-            case BUSYBEE_TIMEOUT:
-                ERROR(TIMEOUT) << "operation timed out";
-                return -1;
-            case BUSYBEE_DISRUPTED:
-                handle_disruption(id);
-                continue;
-            case BUSYBEE_EXTERNAL:
-                continue;
-            BUSYBEE_ERROR_CASE(POLLFAILED);
-            BUSYBEE_ERROR_CASE(ADDFDFAIL);
-            BUSYBEE_ERROR_CASE(SHUTDOWN);
-            default:
-                ERROR(INTERNAL) << "internal error: BusyBee unexpectedly returned "
-                                << (unsigned) rc << ": please file a bug";
-                return -1;
-        }
+    m_hedges.insert(std::make_pair(nonce, h));
+    return ret;
+}
 
-        e::unpacker up = msg->unpack_from(BUSYBEE_HEADER_SIZE);
-        uint8_t mt;
-        virtual_server_id vfrom;
-        int64_t nonce;
-        up = up >> mt >> vfrom >> nonce;
+void
+client :: fire_hedges()
+{
+    if (m_hedge_deadlines.empty())
+    {
+        return;
+    }
 
-        if (up.error())
+    const uint64_t now = po6::monotonic_time();
+
+    while (!m_hedge_deadlines.empty() &&
+           m_hedge_deadlines.begin()->first <= now)
+    {
+        const uint64_t nonce = m_hedge_deadlines.begin()->second;
+        m_hedge_deadlines.erase(m_hedge_deadlines.begin());
+        hedge_map_t::iterator hit = m_hedges.find(nonce);
+        assert(hit != m_hedges.end());
+        e::compat::shared_ptr<hedge> h = hit->second;
+        h->deadline = m_hedge_deadlines.end();
+        pending_map_t::iterator pit = m_pending_ops.find(nonce);
+
+        if (pit == m_pending_ops.end())
         {
-            ERROR(SERVERERROR) << "communication error: server "
-                               << sid_num << " sent message="
-                               << msg->as_slice().hex()
-                               << " with invalid header";
-            return -1;
+            m_hedges.erase(hit);
+            continue;
         }
 
-        network_msgtype msg_type = static_cast<network_msgtype>(mt);
-        pending_map_t::iterator it = m_pending_ops.find(nonce);
-
-        if (it == m_pending_ops.end())
+        // over budget, the get just waits; its latency still counts
+        if (!m_hedging.admit())
         {
             continue;
         }
 
-        const pending_server_pair psp(it->second);
-        e::intrusive_ptr<pending> op = psp.op;
-        m_pending_ops.erase(it);
+        const server_id id = m_config.get_server_id(h->to);
 
-        if (msg_type == CONFIGMISMATCH)
+        if (id == server_id())
         {
-            m_failed.push_back(psp);
             continue;
         }
 
-        if (vfrom == psp.vsi &&
-            id == psp.si &&
-            m_config.get_server_id(vfrom) == id)
+        const e::intrusive_ptr<pending> op = pit->second.op;
+        const uint64_t dup = m_next_server_nonce++;
+        const uint8_t type = static_cast<uint8_t>(REQ_GET_RELAXED);
+        const uint8_t flags = 0x4; // with a budget
+        const uint64_t version = m_config.version();
+        const uint32_t budget = op_budget(op);
+        h->msg->pack_at(BUSYBEE_HEADER_SIZE)
+            << type << flags << version << h->to << budget << dup;
+        m_busybee.set_timeout(-1);
+        busybee_returncode rc = m_busybee.send(id.get(), h->msg);
+
+        if (rc == BUSYBEE_DISRUPTED)
         {
-            if (!op->handle_message(this, id, vfrom, msg_type, msg, up, status, &m_last_error))
-            {
-                return -1;
-            }
-
-            m_yielding = psp.op;
+            handle_disruption(id);
         }
-        else
+
+        if (rc != BUSYBEE_SUCCESS)
         {
-            ERROR(SERVERERROR) << "wrong server replied for nonce=" << nonce
-                               << ": expected it to come from "
-                               << psp.vsi << "/" << psp.si
-                               << "; it came from "
-                               << vfrom << "/" << id
-                               << "; our config says that virtual_id should map to "
-                               << m_config.get_server_id(vfrom);
-            return -1;
+            continue;
         }
-    }
-
-    uint64_t sid_num;
-    m_busybee.set_timeout(0);
-    busybee_returncode rc = m_busybee.recv_no_msg(&sid_num);
 
-    switch (rc)
-    {
-        case BUSYBEE_SUCCESS:
-        case BUSYBEE_TIMEOUT:
-            break;
-        case BUSYBEE_INTERRUPTED:
-            ERROR(INTERRUPTED) << "signal received";
-            return -1;
-        case BUSYBEE_DISRUPTED:
-            handle_disruption(server_id(sid_num));
-            break;
-        case BUSYBEE_EXTERNAL:
-            if (!maintain_coord_connection(status))
-            {
-                return -1;
-            }
-            break;
-        BUSYBEE_ERROR_CASE(POLLFAILED);
-        BUSYBEE_ERROR_CASE(ADDFDFAIL);
-        BUSYBEE_ERROR_CASE(SHUTDOWN);
-        default:
-            ERROR(INTERNAL) << "internal error: BusyBee unexpectedly returned "
-                            << (unsigned) rc << ": please file a bug";
-            return -1;
+        m_pending_ops.insert(std::make_pair(dup, pending_server_pair(id, h->to, op, REQ_GET_RELAXED,
+                                                                     m_stats.enabled() ? po6::monotonic_time() : 0)));
+        track_deadline(op, dup);
+        m_hedged[nonce] = hedged(dup, h->sent, false);
+        m_hedged[dup] = hedged(nonce, h->sent, true);
+        m_hedges.erase(nonce);
+        m_hedging.count_hedge();
     }
-
-    ERROR(NONEPENDING) << "no outstanding operations to process";
-    return -1;
 }
 
 int
-client :: poll_fd()
+client :: hedge_wait()
 {
-    return m_busybee.poll_fd();
-}
+    if (m_hedge_deadlines.empty())
+    {
+        return -1;
+    }
 
-void
-client :: adjust_flagfd()
-{
-    if (!m_failed.empty() ||
-        !m_yieldable.empty() ||
-        m_yielding.get())
+    const uint64_t now = po6::monotonic_time();
+    const uint64_t next = m_hedge_deadlines.begin()->first;
+
+    if (next <= now)
     {
-        m_flagfd.set();
+        return 0;
     }
 
-    assert(m_yieldable.empty() || m_flagfd.isset());
+    // round up so the hedge is due by the time the wait ends
+    return int((next - now + 999999ULL) / 1000000ULL);
 }
 
-int
-client :: block(int timeout)
+bool
+client :: hedge_reply(uint64_t nonce, e::unpacker up)
 {
-    pollfd pfd;
-    pfd.fd = m_busybee.poll_fd();
-    pfd.events = POLLIN|POLLHUP;
-    pfd.revents = 0;
-    return ::poll(&pfd, 1, timeout) >= 0 ? 0 : -1;
-}
+    hedge_map_t::iterator hit = m_hedges.find(nonce);
 
-const char*
-client :: error_message()
-{
-    return m_last_error.msg();
-}
+    if (hit != m_hedges.end())
+    {
+        m_hedging.record(po6::monotonic_time() - hit->second->sent);
 
-const char*
-client :: error_location()
-{
-    return m_last_error.loc();
-}
+        if (hit->second->deadline != m_hedge_deadlines.end())
+        {
+            m_hedge_deadlines.erase(hit->second->deadline);
+        }
 
-void
-client :: set_error_message(const char* msg)
-{
-    m_last_error = e::error();
-    m_last_error.set_loc(__FILE__, __LINE__);
-    m_last_error.set_msg() << msg;
-}
+        m_hedges.erase(hit);
+        return true;
+    }
 
-hyperdatatype
-client :: attribute_type(const char* space, const char* name,
-                         hyperdex_client_returncode* status)
-{
-    if (maintain_coord_connection(status) < 0)
+    hedged_map_t::iterator it = m_hedged.find(nonce);
+
+    if (it == m_hedged.end())
     {
-        return HYPERDATATYPE_GARBAGE;
+        return true;
     }
 
-    const hyperdex::schema* sc = m_config.get_schema(space);
+    const hedged h(it->second);
+    m_hedged.erase(it);
+    m_hedged.erase(h.sibling);
+    pending_map_t::iterator sib = m_pending_ops.find(h.sibling);
 
-    if (!sc)
+    // with its twin already gone, this reply is all there is
+    if (sib == m_pending_ops.end())
     {
-        ERROR(UNKNOWNSPACE) << "space \"" << e::strescape(space) << "\" does not exist";
-        return HYPERDATATYPE_GARBAGE;
+        return true;
     }
 
-    uint16_t attrnum = sc->lookup_attr(name);
+    uint16_t response = 0;
+    up = up >> response;
 
-    if (attrnum == sc->attrs_sz)
+    // the duplicate's replica was behind or busy; the original is still coming
+    if (h.duplicate && !up.error() &&
+        (static_cast<network_returncode>(response) == NET_STALE ||
+         static_cast<network_returncode>(response) == NET_THROTTLED))
     {
-        ERROR(UNKNOWNATTR) << "\"" << e::strescape(name)
-                           << "\" is not an attribute of space \""
-                           << e::strescape(space) << "\"";
-        return HYPERDATATYPE_GARBAGE;
+        return false;
     }
 
-    return sc->attrs[attrnum].type;
-}
-
-size_t
-client :: prepare_checks(const char* space, const schema& sc,
-                         const hyperdex_client_attribute_check* chks, size_t chks_sz,
-                         e::arena* memory,
-                         hyperdex_client_returncode* status,
-                         std::vector<attribute_check>* checks)
-{
-    checks->reserve(checks->size() + chks_sz);
+    m_pending_ops.erase(sib);
+    m_hedging.record(po6::monotonic_time() - h.sent);
 
-    for (size_t i = 0; i < chks_sz; ++i)
+    if (h.duplicate)
     {
-        std::string scratch;
-        const char* attr;
-        const char* path;
-        parse_document_path(chks[i].attr, &attr, &path, &scratch);
-        uint16_t attrnum = sc.lookup_attr(attr);
+        m_hedging.count_win();
+    }
 
-        if (attrnum >= sc.attrs_sz)
-        {
-            ERROR(UNKNOWNATTR) << "\"" << e::strescape(attr)
-                               << "\" is not an attribute of space \""
-                               << e::strescape(space) << "\"";
-            return i;
-        }
+    return true;
+}
 
-        hyperdatatype datatype = chks[i].datatype;
+bool
+client :: hedge_absorbs(uint64_t nonce)
+{
+    hedge_map_t::iterator hit = m_hedges.find(nonce);
 
-        if (datatype == CONTAINER_TYPE(datatype) &&
-            CONTAINER_TYPE(datatype) == CONTAINER_TYPE(sc.attrs[attrnum].type) &&
-            (chks[i].value_sz == 0 || datatype == HYPERDATATYPE_TIMESTAMP_GENERIC))
+    if (hit != m_hedges.end())
+    {
+        if (hit->second->deadline != m_hedge_deadlines.end())
         {
-            datatype = sc.attrs[attrnum].type;
+            m_hedge_deadlines.erase(hit->second->deadline);
         }
 
-        attribute_check c;
-        c.attr = attrnum;
-        c.value = e::slice(chks[i].value, chks[i].value_sz);
-        c.datatype = datatype;
-        c.predicate = chks[i].predicate;
-        datatype_info* vtype = datatype_info::lookup(c.datatype);
+        m_hedges.erase(hit);
+        return false;
+    }
 
-        if (!vtype->client_to_server(c.value, memory, &c.value))
-        {
-            ERROR(WRONGTYPE) << "check[" << i << "], which is on attribute \""
-                             << e::strescape(sc.attrs[attrnum].name)
-                             << "\", does not meet the constraints of its type";
-            return i;
-        }
+    hedged_map_t::iterator it = m_hedged.find(nonce);
 
-        if (!path && datatype == HYPERDATATYPE_DOCUMENT)
-        {
-            // Document datatype always requires a path. Empty means root.
-            path = "";
-        }
+    if (it == m_hedged.end())
+    {
+        return false;
+    }
 
-        if (path)
-        {
-            size_t path_sz = strlen(path) + 1;
-            size_t sz = path_sz + c.value.size();
-            unsigned char* tmp = NULL;
-            memory->allocate(path_sz + c.value.size(), &tmp);
-            memmove(tmp, path, path_sz);
-            memmove(tmp + path_sz, c.value.data(), c.value.size());
+    const uint64_t sibling = it->second.sibling;
+    m_hedged.erase(it);
+    m_hedged.erase(sibling);
+    return m_pending_ops.find(sibling) != m_pending_ops.end();
+}
 
-            c.value = e::slice(tmp, sz);
-        }
+uint32_t
+client :: op_budget(const e::intrusive_ptr<pending>& op)
+{
+    if (op->deadline() == 0 && m_op_timeout == 0)
+    {
+        return 0;
+    }
 
-        if (!validate_attribute_check(sc.attrs[attrnum].type, c))
-        {
-            ERROR(WRONGTYPE) << "invalid predicate on \""
-                             << e::strescape(attr) << "\"";
-            return i;
-        }
+    const uint64_t now = po6::monotonic_time();
 
-        checks->push_back(c);
+    if (op->deadline() == 0)
+    {
+        op->set_deadline(now + m_op_timeout * 1000000ULL);
     }
 
-    return chks_sz;
+    // an op already past its deadline is failed by the next loop, so the
+    // server need not hurry
+    if (op->deadline() <= now)
+    {
+        return 1;
+    }
+
+    const uint64_t ms = (op->deadline() - now + 999999ULL) / 1000000ULL;
+    return ms < UINT32_MAX ? uint32_t(ms) : UINT32_MAX;
 }
 
-size_t
-client :: prepare_funcs(const char* space, const schema& sc,
-                        const hyperdex_client_keyop_info* opinfo,
-                        const hyperdex_client_attribute* attrs, size_t attrs_sz,
-                        e::arena* memory,
-                        hyperdex_client_returncode* status,
-                        std::vector<funcall>* funcs)
+void
+client :: track_deadline(const e::intrusive_ptr<pending>& op, uint64_t nonce)
 {
-    funcs->reserve(funcs->size() + attrs_sz);
+    if (op->deadline() != 0)
+    {
+        m_op_deadlines.insert(std::make_pair(op->deadline(), nonce));
+    }
+}
 
-    for (size_t i = 0; i < attrs_sz; ++i)
+void
+client :: expire_ops()
+{
+    if (m_op_deadlines.empty())
     {
-        std::string scratch;
-        const char* attr;
-        const char* path;
-        parse_document_path(attrs[i].attr, &attr, &path, &scratch);
-        uint16_t attrnum = sc.lookup_attr(attr);
+        return;
+    }
 
-        if (attrnum == sc.attrs_sz)
-        {
-            ERROR(UNKNOWNATTR) << "\"" << e::strescape(attr)
-                               << "\" is not an attribute of space \""
-                               << e::strescape(space) << "\"";
-            return i;
-        }
+    const uint64_t now = po6::monotonic_time();
 
-        if (attrnum == 0)
+    while (!m_op_deadlines.empty() &&
+           m_op_deadlines.begin()->first <= now)
+    {
+        const uint64_t nonce = m_op_deadlines.begin()->second;
+        m_op_deadlines.erase(m_op_deadlines.begin());
+        pending_map_t::iterator it = m_pending_ops.find(nonce);
+
+        // most ops are answered long before their deadline
+        if (it == m_pending_ops.end())
         {
-            ERROR(DONTUSEKEY) << "attribute \""
-                              << e::strescape(attrs[i].attr)
-                              << "\" is the key and cannot be changed";
-            return i;
+            continue;
         }
 
-        hyperdatatype datatype = attrs[i].datatype;
+        const pending_server_pair psp(it->second);
+        m_pending_ops.erase(it);
 
-        if (datatype == CONTAINER_TYPE(datatype) &&
-            CONTAINER_TYPE(datatype) == CONTAINER_TYPE(sc.attrs[attrnum].type) &&
-            (attrs[i].value_sz == 0 || datatype == HYPERDATATYPE_TIMESTAMP_GENERIC))
+        if (!hedge_absorbs(nonce))
         {
-            datatype = sc.attrs[attrnum].type;
+            m_failed.push_back(psp);
         }
+    }
+}
 
-        if (sc.attrs[attrnum].type == HYPERDATATYPE_MACAROON_SECRET)
-        {
-            datatype = HYPERDATATYPE_MACAROON_SECRET;
-        }
+int
+client :: deadline_wait()
+{
+    if (m_op_deadlines.empty())
+    {
+        return -1;
+    }
 
-        funcall o;
-        o.attr = attrnum;
-        o.name = opinfo->fname;
-        o.arg1 = e::slice(attrs[i].value, attrs[i].value_sz);
-        o.arg1_datatype = datatype;
-        datatype_info* type = datatype_info::lookup(sc.attrs[attrnum].type);
-        datatype_info* a1type = datatype_info::lookup(o.arg1_datatype);
+    const uint64_t now = po6::monotonic_time();
+    const uint64_t next = m_op_deadlines.begin()->first;
 
-        if (m_convert_types)
-        {
-            if (!a1type->client_to_server(o.arg1, memory, &o.arg1))
-            {
-                ERROR(WRONGTYPE) << "attribute \""
-                             << e::strescape(attrs[i].attr)
-                             << "\" does not meet the constraints of its type";
-                return i;
-            }
-        }
+    if (next <= now)
+    {
+        return 0;
+    }
 
-        if (path != NULL)
-        {
-            o.arg2 = e::slice(path, strlen(path) + 1);
-            o.arg2_datatype = HYPERDATATYPE_STRING;
-        }
+    return int((next - now + 999999ULL) / 1000000ULL);
+}
 
-        if (!type->check_args(o))
-        {
-            ERROR(WRONGTYPE) << "invalid attribute \""
-                             << e::strescape(attrs[i].attr)
-                             << "\": attribute has the wrong type";
-            return i;
-        }
+bool
+client :: may_throttle(network_msgtype mt, const virtual_server_id& to)
+{
+    // what the daemons turn away rather than only charge to the quota
+    switch (mt)
+    {
+        case REQ_GET:
+        case REQ_GET_RELAXED:
+        case REQ_GET_PARTIAL:
+            break;
+        case REQ_ATOMIC:
+            // any daemon turns writes away while over its memory soft limit
+            return true;
+        default:
+            return false;
+    }
 
-        funcs->push_back(o);
+    const schema* sc = m_config.get_schema(m_config.get_region_id(to));
+    return sc && (sc->quota_ops != 0 ||
+                  sc->quota_bytes != 0 ||
+                  sc->quota_client_ops != 0);
+}
+
+bool
+client :: throttle_reply(uint64_t nonce, const pending_server_pair& psp,
+                         e::unpacker up)
+{
+    if (!psp.retry)
+    {
+        return true;
     }
 
-    return attrs_sz;
+    uint16_t response = 0;
+    uint32_t retry_after = 0;
+    up = up >> response >> retry_after;
+
+    if (up.error() ||
+        static_cast<network_returncode>(response) != NET_THROTTLED ||
+        psp.retry->attempts >= HYPERDEX_CLIENT_THROTTLE_ATTEMPTS)
+    {
+        return true;
+    }
+
+    // back off exponentially, but no sooner than the server says the quota
+    // allows, and spread retries out so they do not arrive together
+    uint64_t wait = HYPERDEX_CLIENT_THROTTLE_BACKOFF_MS << psp.retry->attempts;
+    wait = std::max(wait, uint64_t(retry_after));
+    wait = std::min(wait, uint64_t(HYPERDEX_CLIENT_THROTTLE_BACKOFF_MAX_MS));
+    wait += (nonce * 0x9e3779b97f4a7c15ULL >> 60) * wait / 16;
+    ++psp.retry->attempts;
+    m_pending_ops.insert(std::make_pair(nonce, psp));
+    m_throttle_deadlines.insert(std::make_pair(po6::monotonic_time() + wait * 1000000ULL, nonce));
+    return false;
 }
 
-size_t
-client :: prepare_funcs(const char* space, const schema& sc,
-                        const hyperdex_client_keyop_info* opinfo,
-                        const hyperdex_client_map_attribute* mapattrs, size_t mapattrs_sz,
-                        e::arena* memory,
-                        hyperdex_client_returncode* status,
-                        std::vector<funcall>* funcs)
+void
+client :: resend_throttled()
 {
-    funcs->reserve(funcs->size() + mapattrs_sz);
+    if (m_throttle_deadlines.empty())
+    {
+        return;
+    }
 
-    for (size_t i = 0; i < mapattrs_sz; ++i)
+    const uint64_t now = po6::monotonic_time();
+
+    while (!m_throttle_deadlines.empty() &&
+           m_throttle_deadlines.begin()->first <= now)
     {
-        uint16_t attrnum = sc.lookup_attr(mapattrs[i].attr);
+        const uint64_t nonce = m_throttle_deadlines.begin()->second;
+        m_throttle_deadlines.erase(m_throttle_deadlines.begin());
+        pending_map_t::iterator it = m_pending_ops.find(nonce);
 
-        if (attrnum == sc.attrs_sz)
+        // it failed or expired while it waited
+        if (it == m_pending_ops.end())
         {
-            ERROR(UNKNOWNATTR) << "\"" << e::strescape(mapattrs[i].attr)
-                               << "\" is not an attribute of space \""
-                               << e::strescape(space) << "\"";
-            return i;
+            continue;
         }
 
-        if (attrnum == 0)
+        const pending_server_pair psp(it->second);
+        assert(psp.retry);
+        std::auto_ptr<e::buffer> msg(psp.retry->msg->copy());
+        const uint8_t type = static_cast<uint8_t>(psp.mt);
+        const uint8_t flags = 0x4; // with a budget
+        const uint64_t version = m_config.version();
+        const uint32_t budget = op_budget(psp.op);
+        msg->pack_at(BUSYBEE_HEADER_SIZE)
+            << type << flags << version << psp.vsi << budget << nonce;
+        m_busybee.set_timeout(-1);
+        busybee_returncode rc = m_busybee.send(psp.si.get(), msg);
+
+        if (rc == BUSYBEE_DISRUPTED)
         {
-            ERROR(DONTUSEKEY) << "attribute \""
-                              << e::strescape(mapattrs[i].attr)
-                              << "\" is the key and cannot be changed";
-            return i;
+            handle_disruption(psp.si);
         }
-
-        hyperdatatype k_datatype = mapattrs[i].map_key_datatype;
-
-        if (k_datatype == CONTAINER_TYPE(k_datatype) &&
-            CONTAINER_TYPE(k_datatype) == CONTAINER_TYPE(sc.attrs[attrnum].type) &&
-            mapattrs[i].value_sz == 0)
+        else if (rc != BUSYBEE_SUCCESS)
         {
-            k_datatype = sc.attrs[attrnum].type;
-        }
-
-        hyperdatatype v_datatype = mapattrs[i].value_datatype;
+            m_pending_ops.erase(it);
 
-        if (v_datatype == CONTAINER_TYPE(v_datatype) &&
-            CONTAINER_TYPE(v_datatype) == CONTAINER_TYPE(sc.attrs[attrnum].type) &&
-            mapattrs[i].value_sz == 0)
-        {
-            v_datatype = sc.attrs[attrnum].type;
+            if (!hedge_absorbs(nonce))
+            {
+                m_failed.push_back(psp);
+            }
         }
+    }
+}
 
-        funcall o;
-        o.attr = attrnum;
-        o.name = opinfo->fname;
-        o.arg2 = e::slice(mapattrs[i].map_key, mapattrs[i].map_key_sz);
-        o.arg2_datatype = k_datatype;
-        o.arg1 = e::slice(mapattrs[i].value, mapattrs[i].value_sz);
-        o.arg1_datatype = v_datatype;
-        datatype_info* type = datatype_info::lookup(sc.attrs[attrnum].type);
-        datatype_info* ktype = datatype_info::lookup(k_datatype);
-        datatype_info* vtype = datatype_info::lookup(k_datatype);
+int
+client :: throttle_wait()
+{
+    if (m_throttle_deadlines.empty())
+    {
+        return -1;
+    }
 
-        if (!ktype->client_to_server(o.arg2, memory, &o.arg2))
-        {
-            ERROR(WRONGTYPE) << "key of [" << i << "], which modifies attribute \""
-                             << e::strescape(mapattrs[i].attr)
-                             << "\", does not meet the constraints of its type";
-            return i;
-        }
+    const uint64_t now = po6::monotonic_time();
+    const uint64_t next = m_throttle_deadlines.begin()->first;
 
-        if (!vtype->client_to_server(o.arg1, memory, &o.arg1))
-        {
-            ERROR(WRONGTYPE) << "value of [" << i << "], which modifies attribute \""
-                             << e::strescape(mapattrs[i].attr)
-                             << "\", does not meet the constraints of its type";
-            return i;
-        }
+    if (next <= now)
+    {
+        return 0;
+    }
 
-        if (!type->check_args(o))
-        {
-            ERROR(WRONGTYPE) << "invalid attribute \""
-                             << e::strescape(mapattrs[i].attr)
-                             << "\": attribute has the wrong type";
-            return i;
-        }
+    return int((next - now + 999999ULL) / 1000000ULL);
+}
 
-        funcs->push_back(o);
+bool
+client :: decompress_page(network_msgtype* mt,
+                          std::auto_ptr<e::buffer>* msg,
+                          e::unpacker* up)
+{
+    uint8_t type = 0;
+    uint32_t raw_size = 0;
+    e::slice compressed;
+    std::vector<char> raw;
+    e::unpacker body = *up >> type >> raw_size >> compressed;
+
+    if (body.error() || !decompress(compressed, raw_size, &raw))
+    {
+        return false;
     }
 
-    return mapattrs_sz;
+    // the page takes the place of the message, header and all, so that the
+    // objects the operation hands out point into it
+    const size_t header_sz = (*msg)->size() - up->remain();
+    std::auto_ptr<e::buffer> page(e::buffer::create(header_sz + raw.size()));
+    page->pack_at(0) << e::pack_memmove((*msg)->data(), header_sz)
+                     << e::pack_memmove(raw.empty() ? NULL : &raw[0], raw.size());
+    m_stats.record_compressed(static_cast<network_msgtype>(type),
+                              raw.size(), (*msg)->size() - header_sz);
+    *mt = static_cast<network_msgtype>(type);
+    *up = page->unpack_from(header_sz);
+    *msg = page;
+    return true;
 }
 
-size_t
-client :: prepare_searchop(const schema& sc,
-                           const char* space,
-                           const hyperdex_client_attribute_check* chks, size_t chks_sz,
-                           e::arena* memory,
-                           hyperdex_client_returncode* status,
-                           std::vector<attribute_check>* checks,
-                           std::vector<virtual_server_id>* servers)
+int64_t
+client :: get_cached(const char* space, const e::slice& key,
+                     hyperdex_ds_arena* arena,
+                     hyperdex_client_returncode* status,
+                     const hyperdex_client_attribute** attrs, size_t* attrs_sz)
 {
-    size_t num_checks = prepare_checks(space, sc, chks, chks_sz, memory, status, checks);
+    read_cache::entry_ptr cached = m_read_cache.lookup(space, key);
+    e::intrusive_ptr<pending_get_cached> op;
+    op = new pending_get_cached(m_next_client_id++, status, attrs, attrs_sz,
+                                space, key, cached);
+    op->set_arena(arena);
 
-    if (num_checks != chks_sz)
+    if (cached && po6::monotonic_time() - cached->validated < m_read_cache.fresh_for())
     {
-        return -1 - num_checks;
+        op->serve(this);
+        m_yieldable.push_back(e::intrusive_ptr<pending>(op.get()));
+        m_flagfd.set();
+        return op->client_visible_id();
     }
 
-    std::stable_sort(checks->begin(), checks->end());
-    m_config.lookup_search(space, *checks, servers); // XXX search guaranteed empty vs. search encounters offline server
+    // an unused version and fingerprint when there is nothing to validate
+    uint64_t version = cached ? cached->version : 0;
+    uint64_t fingerprint = cached ? cached->fingerprint : 0;
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+              + 2 * sizeof(uint64_t)
+              + pack_size(key);
+    auth_wallet aw(m_macaroons, m_macaroons_sz);
 
-    if (servers->empty())
+    if (m_macaroons_sz)
     {
-        // XXX NOCOMMIT
-        ERROR(INTERNAL) << "there are no servers for the search";
-        *status = HYPERDEX_CLIENT_INTERNAL;
-        return -1;
+        sz += pack_size(aw);
     }
 
-    return 0;
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ)
+                 << version << fingerprint << key;
+
+    if (m_macaroons_sz)
+    {
+        pa = pa << aw;
+    }
+
+    e::intrusive_ptr<pending> pop(op.get());
+    return send_keyop(space, key, REQ_GET_CACHED, msg, pop, status);
 }
 
-int64_t
-client :: perform_funcall(const char* space, const schema* sc,
-                          const hyperdex_client_keyop_info* opinfo,
-                          const hyperdex_client_attribute_check* chks, size_t chks_sz,
-                          const hyperdex_client_attribute* attrs, size_t attrs_sz,
-                          const hyperdex_client_map_attribute* mapattrs, size_t mapattrs_sz,
-                          size_t header_sz,
-                          size_t footer_sz,
-                          hyperdex_client_returncode* status,
-                          std::auto_ptr<e::buffer>* msg)
+void
+client :: handle_disruption(const server_id& si)
 {
-    std::vector<attribute_check> checks;
-    std::vector<funcall> funcs;
-    size_t idx = 0;
-    e::arena memory;
-
-    // Prepare the checks
-    idx = prepare_checks(space, *sc, chks, chks_sz, &memory, status, &checks);
+    pending_map_t::iterator it = m_pending_ops.begin();
 
-    if (idx < chks_sz)
+    while (it != m_pending_ops.end())
     {
-        return -2 - idx;
+        if (it->second.si == si)
+        {
+            if (!hedge_absorbs(it->first))
+            {
+                m_failed.push_back(it->second);
+                m_stats.record_failed_disruption(1);
+            }
+
+            pending_map_t::iterator tmp = it;
+            ++it;
+            m_pending_ops.erase(tmp);
+        }
+        else
+        {
+            ++it;
+        }
     }
 
-    // Prepare the attrs
-    idx = prepare_funcs(space, *sc, opinfo, attrs, attrs_sz, &memory, status, &funcs);
+    m_stats.record_disruption(si.get());
+    m_busybee.drop(si.get());
+}
 
-    if (idx < attrs_sz)
+void
+client :: cork_op(const server_id& si, const virtual_server_id& vsi,
+                  uint64_t nonce, std::auto_ptr<e::buffer> msg)
+{
+    // keep everything from the nonce on; the batch carries vsi itself and
+    // its ops' deadlines stay with the client
+    const size_t start = HYPERDEX_CLIENT_HEADER_SIZE_REQ - sizeof(uint64_t);
+    assert(msg->size() >= start);
+    cork& c(m_corks[si.get()]);
+    c.ops.push_back(corked_op(nonce, vsi, c.data.size(), msg->size() - start));
+    c.data.append(reinterpret_cast<const char*>(msg->data()) + start, msg->size() - start);
+
+    if (c.data.size() >= HYPERDEX_CLIENT_CORK_BYTES)
     {
-        return -2 - chks_sz - idx;
+        flush_cork(si);
     }
+}
 
-    // Prepare the mapattrs
-    idx = prepare_funcs(space, *sc, opinfo, mapattrs, mapattrs_sz, &memory, status, &funcs);
+void
+client :: flush_cork(const server_id& si)
+{
+    cork_map_t::iterator it = m_corks.find(si.get());
 
-    if (idx < mapattrs_sz)
+    if (it == m_corks.end())
     {
-        return -2 - chks_sz - attrs_sz - idx;
+        return;
     }
 
-    std::stable_sort(checks.begin(), checks.end());
-    std::stable_sort(funcs.begin(), funcs.end());
-    size_t sz = header_sz + footer_sz
-              + sizeof(uint8_t)
-              + pack_size(checks)
-              + pack_size(funcs);
-    msg->reset(e::buffer::create(sz));
-    uint8_t flags = (opinfo->fail_if_not_found ? 1 : 0)
-                  | (opinfo->fail_if_found ? 2 : 0)
-                  | (opinfo->erase ? 0 : 128)
-                  | (m_macaroons_sz ? 64 : 0);
-    (*msg)->pack_at(header_sz) << flags << checks << funcs;
-    return 0;
-}
+    cork c;
+    std::swap(c.data, it->second.data);
+    std::swap(c.ops, it->second.ops);
+    m_corks.erase(it);
 
-int64_t
-client :: perform_aggregation(const std::vector<virtual_server_id>& servers,
-                              e::intrusive_ptr<pending_aggregation> _op,
-                              network_msgtype mt,
-                              std::auto_ptr<e::buffer> msg,
-                              hyperdex_client_returncode* status)
-{
-    e::intrusive_ptr<pending> op(_op.get());
+    // ops that failed while corked, e.g. on a reconfiguration, must not go
+    // out behind the caller's back
+    std::vector<corked_op> live;
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+              - sizeof(uint32_t) /*budget*/
+              - sizeof(uint64_t) /*nonce*/
+              + sizeof(uint32_t) /*count*/;
 
-    for (size_t i = 0; i < servers.size(); ++i)
+    for (size_t i = 0; i < c.ops.size(); ++i)
     {
-        uint64_t nonce = m_next_server_nonce++;
-        pending_server_pair psp(m_config.get_server_id(servers[i]), servers[i], op);
-        std::auto_ptr<e::buffer> msg_copy(msg->copy());
+        pending_map_t::iterator p = m_pending_ops.find(c.ops[i].nonce);
 
-        if (!send(mt, psp.vsi, nonce, msg_copy, op, status))
+        if (p != m_pending_ops.end() && p->second.si == si)
         {
-            m_failed.push_back(psp);
+            live.push_back(c.ops[i]);
+            sz += sizeof(uint64_t) + sizeof(uint32_t) + c.ops[i].size;
         }
     }
 
-    return op->client_visible_id();
-}
-
-bool
-client :: maintain_coord_connection(hyperdex_client_returncode* status)
-{
-    if (m_config_status != REPLICANT_SUCCESS)
+    if (live.empty())
     {
-        replicant_client_kill(m_coord, m_config_id);
-        m_config_id = -1;
+        return;
     }
 
-    replicant_returncode rc;
+    const uint8_t type = static_cast<uint8_t>(REQ_ATOMIC_BATCH);
+    const uint8_t flags = 0;
+    const uint64_t version = m_config.version();
+    const uint32_t count = live.size();
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(BUSYBEE_HEADER_SIZE)
+        << type << flags << version << virtual_server_id(UINT64_MAX) << count;
 
-    if (m_config_id < 0)
+    for (size_t i = 0; i < live.size(); ++i)
     {
-        m_config_status = REPLICANT_SUCCESS;
-        m_config_id = replicant_client_cond_follow(m_coord, "hyperdex", "config",
-                                                   &m_config_status, &m_config_state,
-                                                   &m_config_data, &m_config_data_sz);
-        if (replicant_client_wait(m_coord, m_config_id, -1, &rc) < 0)
-        {
-            ERROR(COORDFAIL) << "coordinator failure: " << replicant_client_error_message(m_coord);
-            return false;
-        }
+        pa = pa << live[i].vsi << e::slice(c.data.data() + live[i].offset, live[i].size);
     }
 
-    if (replicant_client_loop(m_coord, 0, &rc) < 0)
+    m_busybee.set_timeout(-1);
+
+    // the ops are already pending, so any failure reaches the caller
+    // through loop as the ops fail
+    if (m_busybee.send(si.get(), msg) != BUSYBEE_SUCCESS)
     {
-        if (rc == REPLICANT_INTERRUPTED)
-        {
-            ERROR(INTERRUPTED) << "interrupted by a signal";
-            return false;
-        }
-        else if (rc != REPLICANT_NONE_PENDING && rc != REPLICANT_TIMEOUT)
-        {
-            ERROR(COORDFAIL) << "coordinator failure: " << replicant_client_error_message(m_coord);
-            return false;
-        }
+        handle_disruption(si);
     }
+}
+
+void
+client :: cork_search(const server_id& si, const virtual_server_id& vsi,
+                      uint64_t nonce, std::auto_ptr<e::buffer> msg)
+{
+    const size_t start = HYPERDEX_CLIENT_HEADER_SIZE_REQ - sizeof(uint64_t);
+    assert(msg->size() >= start);
+    cork& c(m_search_corks[si.get()]);
+    c.ops.push_back(corked_op(nonce, vsi, c.data.size(), msg->size() - start));
+    c.data.append(reinterpret_cast<const char*>(msg->data()) + start, msg->size() - start);
+}
+
+void
+client :: flush_search_corks(network_msgtype mt, const e::intrusive_ptr<pending>& op)
+{
+    const uint8_t flags = 0x4; // with a budget
+    const uint64_t version = m_config.version();
+    const uint32_t budget = op_budget(op);
 
-    if (m_config.version() < m_config_state)
+    while (!m_search_corks.empty())
     {
-        configuration new_config;
-        e::unpacker up(m_config_data, m_config_data_sz);
-        up = up >> new_config;
+        server_id si(m_search_corks.begin()->first);
+        cork c;
+        std::swap(c.data, m_search_corks.begin()->second.data);
+        std::swap(c.ops, m_search_corks.begin()->second.ops);
+        m_search_corks.erase(m_search_corks.begin());
+        std::auto_ptr<e::buffer> msg;
 
-        if (!up.error())
+        if (c.ops.size() == 1)
         {
-            m_config = new_config;
+            // a lone request, exactly as it would have gone out uncorked
+            const uint8_t type = static_cast<uint8_t>(mt);
+            size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ - sizeof(uint64_t) + c.data.size();
+            msg.reset(e::buffer::create(sz));
+            msg->pack_at(BUSYBEE_HEADER_SIZE)
+                << type << flags << version << c.ops[0].vsi << budget
+                << e::pack_memmove(c.data.data(), c.data.size());
         }
-
-        pending_map_t::iterator it = m_pending_ops.begin();
-
-        while (it != m_pending_ops.end())
+        else
         {
-            // If the mapping that was true when the operation started is no
-            // longer true, we fail the operation with a RECONFIGURE.
-            if (m_config.get_server_id(it->second.vsi) != it->second.si)
+            const uint8_t type = static_cast<uint8_t>(REQ_SEARCH_MULTI);
+            const uint8_t inner = static_cast<uint8_t>(mt);
+            const uint32_t count = c.ops.size();
+            size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+                      - sizeof(uint64_t) /*nonce*/
+                      + sizeof(uint8_t) /*type*/
+                      + sizeof(uint32_t) /*count*/;
+
+            for (size_t i = 0; i < c.ops.size(); ++i)
             {
-                m_failed.push_back(it->second);
-                m_pending_ops.erase(it);
-                it = m_pending_ops.begin();
+                sz += sizeof(uint64_t) + sizeof(uint32_t) + c.ops[i].size;
             }
-            else
+
+            msg.reset(e::buffer::create(sz));
+            e::packer pa = msg->pack_at(BUSYBEE_HEADER_SIZE)
+                << type << flags << version << virtual_server_id(UINT64_MAX)
+                << budget << inner << count;
+
+            for (size_t i = 0; i < c.ops.size(); ++i)
             {
-                ++it;
+                pa = pa << c.ops[i].vsi << e::slice(c.data.data() + c.ops[i].offset, c.ops[i].size);
             }
         }
-    }
 
-    return true;
+        m_busybee.set_timeout(-1);
+
+        // the requests are already pending, so any failure reaches the
+        // caller through loop as they fail
+        if (m_busybee.send(si.get(), msg) != BUSYBEE_SUCCESS)
+        {
+            handle_disruption(si);
+        }
+    }
 }
 
-bool
-client :: send(network_msgtype mt,
-               const virtual_server_id& to,
-               uint64_t nonce,
-               std::auto_ptr<e::buffer> msg,
-               e::intrusive_ptr<pending> op,
-               hyperdex_client_returncode* status)
+client::completion_queue*
+client :: queue_for(pthread_t thread)
 {
-    const uint8_t type = static_cast<uint8_t>(mt);
-    const uint8_t flags = 0;
-    const uint64_t version = m_config.version();
-    msg->pack_at(BUSYBEE_HEADER_SIZE)
-        << type << flags << version << to << nonce;
-    server_id id = m_config.get_server_id(to);
-    m_busybee.set_timeout(-1);
-    busybee_returncode rc = m_busybee.send(id.get(), msg);
+    completion_queue_map_t::iterator it = m_completion_queues.find(thread);
 
-    switch (rc)
+    if (it != m_completion_queues.end())
     {
-        case BUSYBEE_SUCCESS:
-            op->handle_sent_to(id, to);
-            m_pending_ops.insert(std::make_pair(nonce, pending_server_pair(id, to, op)));
-            return true;
-        case BUSYBEE_DISRUPTED:
-            handle_disruption(id);
-            ERROR(SERVERERROR) << "server " << id.get() << " had a communication disruption";
-            return false;
-        BUSYBEE_ERROR_CASE_FALSE(SHUTDOWN);
-        BUSYBEE_ERROR_CASE_FALSE(POLLFAILED);
-        BUSYBEE_ERROR_CASE_FALSE(ADDFDFAIL);
-        BUSYBEE_ERROR_CASE_FALSE(TIMEOUT);
-        BUSYBEE_ERROR_CASE_FALSE(EXTERNAL);
-        BUSYBEE_ERROR_CASE_FALSE(INTERRUPTED);
-        default:
-            ERROR(INTERNAL) << "internal error: BusyBee unexpectedly returned "
-                                << (unsigned) rc << ": please file a bug";
-            return false;
+        return it->second;
     }
+
+    std::auto_ptr<completion_queue> cq(new completion_queue());
+    m_completion_queues.insert(std::make_pair(thread, cq.get()));
+    return cq.release();
 }
 
-int64_t
-client :: send_keyop(const char* space,
-                     const e::slice& key,
-                     network_msgtype mt,
-                     std::auto_ptr<e::buffer> msg,
-                     e::intrusive_ptr<pending> op,
-                     hyperdex_client_returncode* status)
+bool
+client :: has_work(completion_queue* cq)
 {
-    virtual_server_id vsi = m_config.point_leader(space, key);
+    if (!cq)
+    {
+        return m_yielding ||
+               !m_failed.empty() ||
+               !m_yieldable.empty() ||
+               !m_pending_ops.empty();
+    }
 
-    if (vsi == virtual_server_id())
+    if (!cq->ready.empty())
     {
-        ERROR(OFFLINE) << "all servers for key \""
-                       << e::strescape(std::string(reinterpret_cast<const char*>(key.data()), key.size()))
-                       << "\" in space \"" << e::strescape(space)
-                       << "\" are offline: bring one or more online to remedy the issue";
-        return -1;
+        return true;
     }
 
-    int64_t nonce = m_next_server_nonce++;
+    const pthread_t self = pthread_self();
 
-    if (send(mt, vsi, nonce, msg, op, status))
+    if (m_yielding && pthread_equal(m_yielding->owner(), self))
     {
-        return op->client_visible_id();
+        return true;
     }
-    else
+
+    for (pending_queue_t::iterator it = m_failed.begin();
+            it != m_failed.end(); ++it)
     {
-        ERROR(RECONFIGURE) << "could not send " << mt << " to " << vsi;
-        return -1;
+        if (pthread_equal(it->op->owner(), self))
+        {
+            return true;
+        }
     }
-}
-
-void
-client :: handle_disruption(const server_id& si)
-{
-    pending_map_t::iterator it = m_pending_ops.begin();
 
-    while (it != m_pending_ops.end())
+    for (std::list<e::intrusive_ptr<pending> >::iterator it = m_yieldable.begin();
+            it != m_yieldable.end(); ++it)
     {
-        if (it->second.si == si)
+        if (pthread_equal((*it)->owner(), self))
         {
-            m_failed.push_back(it->second);
-            pending_map_t::iterator tmp = it;
-            ++it;
-            m_pending_ops.erase(tmp);
+            return true;
         }
-        else
+    }
+
+    for (pending_map_t::iterator it = m_pending_ops.begin();
+            it != m_pending_ops.end(); ++it)
+    {
+        if (pthread_equal(it->second.op->owner(), self))
         {
-            ++it;
+            return true;
         }
     }
 
-    m_busybee.drop(si.get());
+    return false;
+}
+
+void
+client :: hand_off(const e::intrusive_ptr<pending>& op)
+{
+    completion_queue* cq = queue_for(op->owner());
+    cq->ready.push_back(op);
+    cq->wakeup.set();
+}
+
+int
+client :: wait_unlocked(completion_queue* cq, int timeout)
+{
+    pollfd pfds[2];
+    pfds[0].fd = m_busybee.poll_fd();
+    pfds[0].events = POLLIN|POLLHUP;
+    pfds[0].revents = 0;
+    pfds[1].fd = cq->wakeup.poll_fd();
+    pfds[1].events = POLLIN|POLLHUP;
+    pfds[1].revents = 0;
+    m_protect.unlock();
+    int ret = ::poll(pfds, 2, timeout);
+    int saved = errno;
+    m_protect.lock();
+    cq->wakeup.clear();
+    errno = saved;
+    return ret;
 }
 
 microtransaction* client::uxact_init(const char* space, hyperdex_client_returncode *status)
@@ -1499,6 +3798,7 @@ operator << (std::ostream& lhs, hyperdex_client_returncode rhs)
         STRINGIFY(HYPERDEX_CLIENT_CLUSTER_JUMP);
         STRINGIFY(HYPERDEX_CLIENT_OFFLINE);
         STRINGIFY(HYPERDEX_CLIENT_UNAUTHORIZED);
+        STRINGIFY(HYPERDEX_CLIENT_THROTTLED);
         STRINGIFY(HYPERDEX_CLIENT_INTERNAL);
         STRINGIFY(HYPERDEX_CLIENT_EXCEPTION);
         STRINGIFY(HYPERDEX_CLIENT_GARBAGE);
@@ -1517,6 +3817,93 @@ client :: set_type_conversion(bool enabled)
     m_convert_types = enabled;
 }
 
+void
+client :: set_corking(bool enabled)
+{
+    m_corking = enabled;
+
+    if (!m_corking)
+    {
+        flush();
+    }
+}
+
+void
+client :: set_read_cache(size_t budget, uint64_t fresh_for)
+{
+    m_read_cache.configure(budget, fresh_for * 1000000ULL);
+}
+
+void
+client :: set_hedging(double fraction)
+{
+    m_hedging.configure(fraction);
+}
+
+void
+client :: hedging_stats(uint64_t* gets, uint64_t* hedged, uint64_t* won)
+{
+    *gets = m_hedging.gets();
+    *hedged = m_hedging.hedged();
+    *won = m_hedging.won();
+}
+
+void
+client :: set_statistics(bool enabled)
+{
+    m_stats.enable(enabled);
+}
+
+const char*
+client :: statistics()
+{
+    m_stats_report = m_stats.report();
+    return m_stats_report.c_str();
+}
+
+void
+client :: reset_statistics()
+{
+    m_stats.reset();
+}
+
+void
+client :: set_operation_timeout(uint64_t timeout)
+{
+    m_op_timeout = timeout;
+}
+
+void
+client :: set_config_cache(const char* directory)
+{
+    m_config_cache.set_directory(directory);
+
+    if (m_config.version() > 0)
+    {
+        m_config_cache.save(m_config);
+        return;
+    }
+
+    configuration cached;
+
+    if (m_config_cache.load(&cached))
+    {
+        m_config = cached;
+        ++m_config_generation;
+        m_config_cached = true;
+        m_config_stale = false;
+    }
+}
+
+void
+client :: flush()
+{
+    while (!m_corks.empty())
+    {
+        flush_cork(server_id(m_corks.begin()->first));
+    }
+}
+
 int64_t
 microtransaction::generate_message(size_t header_sz, size_t footer_sz,
                                    const std::vector<attribute_check>& checks,
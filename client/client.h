@@ -30,9 +30,21 @@
 #ifndef hyperdex_client_client_h_
 #define hyperdex_client_client_h_
 
+// POSIX
+#include <pthread.h>
+
 // STL
 #include <map>
 #include <list>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// e
+#include <e/compat.h>
+#include <e/flagfd.h>
 
 // BusyBee
 #include <busybee_st.h>
@@ -45,8 +57,13 @@
 #include "namespace.h"
 #include "common/configuration.h"
 #include "common/mapper.h"
+#include "client/client_stats.h"
+#include "client/config_cache.h"
+#include "client/hedge_policy.h"
+#include "client/prepared.h"
 #include "client/keyop_info.h"
 #include "client/pending.h"
+#include "client/read_cache.h"
 #include "client/pending_aggregation.h"
 
 BEGIN_HYPERDEX_NAMESPACE
@@ -80,6 +97,29 @@ class client
         client(const char* conn_str);
         ~client() throw ();
 
+    public:
+        // A shared client may be called from many threads at once; they
+        // share its connections and configuration.  Each thread's calls to
+        // loop return only the operations that thread issued, and its
+        // error_message describes only its own last call.  Mark the client
+        // shared before any thread uses it.
+        void set_shared() { m_shared = true; }
+        // Every call into a shared client must be made under a hold.  It is
+        // free for clients that are not shared.
+        class hold
+        {
+            public:
+                hold(client* cl);
+                ~hold() throw ();
+
+            private:
+                hold(const hold&);
+                hold& operator = (const hold&);
+
+            private:
+                client* m_cl;
+        };
+
     public:
         void clear_auth_context() { m_macaroons = NULL; m_macaroons_sz = 0; }
         void set_auth_context(const char** macaroons, size_t macaroons_sz)
@@ -90,14 +130,55 @@ class client
         int64_t get(const char* space, const char* key, size_t key_sz,
                     hyperdex_client_returncode* status,
                     const hyperdex_client_attribute** attrs, size_t* attrs_sz);
+        // as above, but decode into "arena" when it is not NULL
+        int64_t get(const char* space, const char* key, size_t key_sz,
+                    hyperdex_ds_arena* arena,
+                    hyperdex_client_returncode* status,
+                    const hyperdex_client_attribute** attrs, size_t* attrs_sz);
+        int64_t get_relaxed(const char* space, const char* key, size_t key_sz,
+                            uint64_t staleness,
+                            hyperdex_client_returncode* status,
+                            const hyperdex_client_attribute** attrs, size_t* attrs_sz);
         int64_t get_partial(const char* space, const char* key, size_t key_sz,
                             const char** attrnames, size_t attrnames_sz,
                             hyperdex_client_returncode* status,
                             const hyperdex_client_attribute** attrs, size_t* attrs_sz);
+        int64_t get_many(const char* space,
+                         const char** keys, const size_t* keys_sz, size_t num_keys,
+                         hyperdex_client_returncode* status,
+                         hyperdex_client_returncode* statuses,
+                         const hyperdex_client_attribute** attrs, size_t* attrs_sz);
+        int64_t read_transaction(const char* space,
+                                 const char** keys, const size_t* keys_sz, size_t num_keys,
+                                 hyperdex_client_returncode* status,
+                                 hyperdex_client_returncode* statuses,
+                                 const hyperdex_client_attribute** attrs, size_t* attrs_sz);
+        int64_t put_many(const char* space,
+                         const char** keys, const size_t* keys_sz,
+                         const hyperdex_client_attribute* const* attrs, const size_t* attrs_sz,
+                         size_t num_objects,
+                         hyperdex_client_returncode* status,
+                         hyperdex_client_returncode* statuses);
         int64_t search(const char* space,
                        const hyperdex_client_attribute_check* checks, size_t checks_sz,
                        hyperdex_client_returncode* status,
                        const hyperdex_client_attribute** attrs, size_t* attrs_sz);
+        int64_t search_limit(const char* space,
+                             const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             uint64_t limit,
+                             hyperdex_client_returncode* status,
+                             const hyperdex_client_attribute** attrs, size_t* attrs_sz);
+        int64_t search_limit(const char* space,
+                             const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             uint64_t limit,
+                             hyperdex_ds_arena* arena,
+                             hyperdex_client_returncode* status,
+                             const hyperdex_client_attribute** attrs, size_t* attrs_sz);
+        int64_t sample_search(const char* space,
+                              const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                              double fraction,
+                              hyperdex_client_returncode* status,
+                              const hyperdex_client_attribute** attrs, size_t* attrs_sz);
         int64_t search_describe(const char* space,
                                 const hyperdex_client_attribute_check* checks, size_t checks_sz,
                                 hyperdex_client_returncode* status, const char** description);
@@ -108,12 +189,44 @@ class client
                               bool maximize,
                               hyperdex_client_returncode* status,
                               const hyperdex_client_attribute** attrs, size_t* attrs_sz);
+        int64_t sorted_search_page(const char* space,
+                                   const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                   const char* sort_by,
+                                   uint64_t limit,
+                                   bool maximize,
+                                   const char* cursor, size_t cursor_sz,
+                                   hyperdex_client_returncode* status,
+                                   const hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                                   const char** next_cursor, size_t* next_cursor_sz);
+        int64_t nearest_search(const char* space,
+                               const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                               const char* x_attr, double x,
+                               const char* y_attr, double y,
+                               uint64_t limit,
+                               hyperdex_client_returncode* status,
+                               const hyperdex_client_attribute** attrs, size_t* attrs_sz);
         int64_t group_del(const char* space,
                           const hyperdex_client_attribute_check* checks, size_t checks_sz,
                           hyperdex_client_returncode* status);
         int64_t count(const char* space,
                       const hyperdex_client_attribute_check* checks, size_t checks_sz,
                       hyperdex_client_returncode* status, uint64_t* result);
+        int64_t approximate_count(const char* space,
+                                  const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                  double error,
+                                  hyperdex_client_returncode* status, uint64_t* result);
+        int64_t aggregate(const char* space,
+                          const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                          const hyperdex_client_aggregate* aggs, size_t aggs_sz,
+                          const char* group_by,
+                          hyperdex_client_returncode* status,
+                          const hyperdex_client_aggregate_group** groups, size_t* groups_sz);
+        int64_t changes(const char* space,
+                        uint64_t checkpoint,
+                        hyperdex_client_returncode* status,
+                        const hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                        uint64_t* version, int* deleted,
+                        uint64_t* resume);
 
         // General keyop call
         // This will be called by the bindings from c.cc
@@ -176,40 +289,189 @@ class client
                                      hyperdex_client_returncode* status);
         // enable or disable type conversion on the client-side
         void set_type_conversion(bool enabled);
+        // hold atomic operations per server until flush (or loop/block)
+        void set_corking(bool enabled);
+        void flush();
+        // keep up to "budget" bytes of objects read by get, serving them
+        // without a round trip for "fresh_for" milliseconds after the
+        // server last confirmed them; a budget of zero turns it off
+        void set_read_cache(size_t budget, uint64_t fresh_for);
+        // duplicate to another replica any get still unanswered after the
+        // recent 95th percentile, for at most "fraction" of gets
+        void set_hedging(double fraction);
+        void hedging_stats(uint64_t* gets, uint64_t* hedged, uint64_t* won);
+        // record where the client's time goes; see client_stats
+        void set_statistics(bool enabled);
+        const char* statistics();
+        void reset_statistics();
+        // fail operations issued from now on with TIMEOUT when they take
+        // longer than "timeout" milliseconds; zero for no limit
+        void set_operation_timeout(uint64_t timeout);
+        // resolve a key operation once for many executions; NULL on error
+        prepared* prepare(const char* method, const char* space,
+                          const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                          const hyperdex_client_attribute* attrs, size_t attrs_sz,
+                          hyperdex_client_returncode* status);
+        // issue "p" with a value for each of its checks and then each of
+        // its attributes, in the order they were prepared
+        int64_t execute(prepared* p, const char* key, size_t key_sz,
+                        const char* const* values, const size_t* values_sz,
+                        hyperdex_client_returncode* status);
+        // route from the configuration last saved within "directory" until
+        // the coordinator's arrives, and save each newer one there
+        void set_config_cache(const char* directory);
 
     private:
+        // a request to a space with a quota, kept so that it can go out
+        // again if the server turns it away
+        struct throttled
+        {
+            throttled(std::auto_ptr<e::buffer> m)
+                : msg(m), attempts(0) {}
+            ~throttled() throw () {}
+            std::auto_ptr<e::buffer> msg;
+            unsigned attempts;
+
+            private:
+                throttled(const throttled&);
+                throttled& operator = (const throttled&);
+        };
         struct pending_server_pair
         {
             pending_server_pair()
-                : si(), vsi(), op() {}
+                : si(), vsi(), op(), mt(), sent(0), retry() {}
             pending_server_pair(const server_id& s,
                                 const virtual_server_id& v,
                                 const e::intrusive_ptr<pending>& o)
-                : si(s), vsi(v), op(o) {}
+                : si(s), vsi(v), op(o), mt(), sent(0), retry() {}
+            pending_server_pair(const server_id& s,
+                                const virtual_server_id& v,
+                                const e::intrusive_ptr<pending>& o,
+                                network_msgtype m, uint64_t t)
+                : si(s), vsi(v), op(o), mt(m), sent(t), retry() {}
             ~pending_server_pair() throw () {}
             server_id si;
             virtual_server_id vsi;
             e::intrusive_ptr<pending> op;
+            // when the request was sent, if statistics are on; else 0
+            network_msgtype mt;
+            uint64_t sent;
+            // set if the request may be throttled
+            e::compat::shared_ptr<throttled> retry;
         };
         typedef std::map<uint64_t, pending_server_pair> pending_map_t;
+        // a get that may yet be hedged, keyed by its nonce
+        struct hedge
+        {
+            hedge(const virtual_server_id& t, uint64_t s, std::auto_ptr<e::buffer> m)
+                : to(t), sent(s), msg(m), deadline() {}
+            ~hedge() throw () {}
+            virtual_server_id to;
+            uint64_t sent;
+            // a REQ_GET_RELAXED for "to"
+            std::auto_ptr<e::buffer> msg;
+            std::multimap<uint64_t, uint64_t>::iterator deadline;
+
+            private:
+                hedge(const hedge&);
+                hedge& operator = (const hedge&);
+        };
+        typedef std::map<uint64_t, e::compat::shared_ptr<hedge> > hedge_map_t;
+        // one of a get and its duplicate, both in flight
+        struct hedged
+        {
+            hedged() : sibling(), sent(), duplicate() {}
+            hedged(uint64_t s, uint64_t t, bool d)
+                : sibling(s), sent(t), duplicate(d) {}
+            uint64_t sibling;
+            uint64_t sent;
+            bool duplicate;
+        };
+        typedef std::map<uint64_t, hedged> hedged_map_t;
         typedef std::list<pending_server_pair> pending_queue_t;
+        // the per-thread half of a shared client
+        struct completion_queue
+        {
+            completion_queue()
+                : wakeup(), ready(), yielded(), last_error() {}
+            ~completion_queue() throw () {}
+            e::flagfd wakeup;
+            std::list<e::intrusive_ptr<pending> > ready;
+            e::intrusive_ptr<pending> yielded;
+            e::error last_error;
+
+            private:
+                completion_queue(const completion_queue&);
+                completion_queue& operator = (const completion_queue&);
+        };
+        typedef std::map<pthread_t, completion_queue*> completion_queue_map_t;
+        // REQ_ATOMIC bodies waiting to go to one server, back to back
+        struct corked_op
+        {
+            corked_op()
+                : nonce(), vsi(), offset(), size() {}
+            corked_op(uint64_t n, const virtual_server_id& v, size_t o, size_t s)
+                : nonce(n), vsi(v), offset(o), size(s) {}
+            uint64_t nonce;
+            virtual_server_id vsi;
+            size_t offset;
+            size_t size;
+        };
+        struct cork
+        {
+            cork() : data(), ops() {}
+            std::string data;
+            std::vector<corked_op> ops;
+        };
+        typedef std::map<uint64_t, cork> cork_map_t;
+        // where a name, known by its address, was last found in a schema
+        struct attr_hint
+        {
+            attr_hint() : name(NULL), attr(UINT16_MAX) {}
+            const char* name;
+            uint16_t attr;
+        };
         friend class pending_get;
         friend class pending_get_partial;
+        friend class pending_get_cached;
+        friend class pending_get_many;
+        friend class pending_put_many;
+        friend class pending_read_transaction;
+        friend class pending_changes;
         friend class pending_search;
         friend class pending_sorted_search;
+        friend class pending_nearest_search;
+        friend class client_bench;
 
     private:
+        // sc.lookup_attr, hinted by where the same name was last found;
+        // callers that pass the same names each time, as prepared
+        // statements do, pay one comparison for each
+        uint16_t lookup_attr(const schema& sc, const char* name);
         size_t prepare_checks(const char* space, const schema& sc,
                               const hyperdex_client_attribute_check* chks, size_t chks_sz,
                               e::arena* memory,
                               hyperdex_client_returncode* status,
                               std::vector<attribute_check>* checks);
+        bool prepare_check(const schema& sc, uint16_t attrnum, const char* path,
+                           const hyperdex_client_attribute_check& chk, size_t i,
+                           e::arena* memory,
+                           hyperdex_client_returncode* status,
+                           attribute_check* c);
         size_t prepare_funcs(const char* space, const schema& sc,
                              const hyperdex_client_keyop_info* opinfo,
                              const hyperdex_client_attribute* attrs, size_t attrs_sz,
                              e::arena* memory,
                              hyperdex_client_returncode* status,
                              std::vector<funcall>* funcs);
+        bool prepare_func(const schema& sc, uint16_t attrnum, const char* path,
+                          const hyperdex_client_keyop_info* opinfo,
+                          const hyperdex_client_attribute& a,
+                          e::arena* memory,
+                          hyperdex_client_returncode* status,
+                          funcall* o);
+        // look up the schema and attributes of "p" in the current configuration
+        bool resolve_prepared(prepared* p, hyperdex_client_returncode* status);
         size_t prepare_funcs(const char* space, const schema& sc,
                              const hyperdex_client_keyop_info* opinfo,
                              const hyperdex_client_map_attribute* mapattrs, size_t mapattrs_sz,
@@ -232,6 +494,15 @@ class client
                                 size_t footer_sz,
                                 hyperdex_client_returncode* status,
                                 std::auto_ptr<e::buffer>* msg);
+        // start a search of every region; a nonzero sample keeps the matches
+        // whose keys hash below it
+        int64_t perform_search(const char* space,
+                               const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                               uint64_t limit,
+                               uint64_t sample,
+                               hyperdex_ds_arena* arena,
+                               hyperdex_client_returncode* status,
+                               const hyperdex_client_attribute** attrs, size_t* attrs_sz);
         int64_t perform_aggregation(const std::vector<virtual_server_id>& servers,
                                     e::intrusive_ptr<pending_aggregation> op,
                                     network_msgtype mt,
@@ -244,13 +515,80 @@ class client
                   std::auto_ptr<e::buffer> msg,
                   e::intrusive_ptr<pending> op,
                   hyperdex_client_returncode* status);
+        // best effort; for messages the server never answers
+        void send_no_reply(network_msgtype mt,
+                           const virtual_server_id& to,
+                           std::auto_ptr<e::buffer> msg);
         int64_t send_keyop(const char* space,
                            const e::slice& key,
                            network_msgtype mt,
                            std::auto_ptr<e::buffer> msg,
                            e::intrusive_ptr<pending> op,
                            hyperdex_client_returncode* status);
+        // like send_keyop, but to any replica of the key, for spaces whose
+        // replicas cannot disagree
+        int64_t send_replica_readop(const char* space,
+                                    const e::slice& key,
+                                    network_msgtype mt,
+                                    std::auto_ptr<e::buffer> msg,
+                                    e::intrusive_ptr<pending> op,
+                                    hyperdex_client_returncode* status);
+        // get through the read cache
+        int64_t get_cached(const char* space, const e::slice& key,
+                           hyperdex_ds_arena* arena,
+                           hyperdex_client_returncode* status,
+                           const hyperdex_client_attribute** attrs, size_t* attrs_sz);
         void handle_disruption(const server_id& si);
+        // hedged gets
+        int64_t send_hedged_get(const char* space, const e::slice& key,
+                                std::auto_ptr<e::buffer> msg,
+                                e::intrusive_ptr<pending> op,
+                                hyperdex_client_returncode* status);
+        void fire_hedges();
+        // milliseconds until the next hedge is due, or -1 if none is
+        int hedge_wait();
+        // does the reply for "nonce" go to its operation?
+        bool hedge_reply(uint64_t nonce, e::unpacker up);
+        // may the failure of "nonce" be ignored because its twin lives on?
+        bool hedge_absorbs(uint64_t nonce);
+        // requests throttled by their space's quota
+        bool may_throttle(network_msgtype mt, const virtual_server_id& to);
+        // does the reply for "nonce" go to its operation?  If the server
+        // throttled it, the request waits to go out again instead
+        bool throttle_reply(uint64_t nonce, const pending_server_pair& psp,
+                            e::unpacker up);
+        void resend_throttled();
+        // milliseconds until the next throttled request goes out, or -1
+        int throttle_wait();
+        // replace a RESP_SEARCH_COMPRESSED with the page it wraps, leaving
+        // it as it is if it will not decompress
+        bool decompress_page(network_msgtype* mt,
+                             std::auto_ptr<e::buffer>* msg,
+                             e::unpacker* up);
+        // operation deadlines; the budget is what is left of op's deadline
+        // in milliseconds (0 for none), and is what the server is told
+        uint32_t op_budget(const e::intrusive_ptr<pending>& op);
+        void track_deadline(const e::intrusive_ptr<pending>& op, uint64_t nonce);
+        void expire_ops();
+        // milliseconds until the next operation deadline, or -1 if none is
+        int deadline_wait();
+        // queue a packed REQ_ATOMIC for "si"; send what is queued for it
+        void cork_op(const server_id& si, const virtual_server_id& vsi,
+                     uint64_t nonce, std::auto_ptr<e::buffer> msg);
+        void flush_cork(const server_id& si);
+        // the same for the per-region requests of one search; each server
+        // gets them in one REQ_SEARCH_MULTI, or alone if it has only one
+        void cork_search(const server_id& si, const virtual_server_id& vsi,
+                         uint64_t nonce, std::auto_ptr<e::buffer> msg);
+        void flush_search_corks(network_msgtype mt, const e::intrusive_ptr<pending>& op);
+        // shared clients
+        completion_queue* queue_for(pthread_t thread);
+        // does the queue's thread have an operation anywhere in the client?
+        bool has_work(completion_queue* cq);
+        // pass a ready operation to the thread that issued it
+        void hand_off(const e::intrusive_ptr<pending>& op);
+        // drop the lock and wait for network traffic or a hand off
+        int wait_unlocked(completion_queue* cq, int timeout);
 
     private:
         replicant_client* m_coord;
@@ -263,6 +601,14 @@ class client
         uint64_t m_config_state;
         char* m_config_data;
         size_t m_config_data_sz;
+        // counts the configurations m_config has held, so that prepared
+        // operations know when their schema pointers went stale
+        uint64_t m_config_generation;
+        config_cache m_config_cache;
+        // m_config came from m_config_cache and not yet from the coordinator;
+        // once a server says it is stale, wait for the coordinator's
+        bool m_config_cached;
+        bool m_config_stale;
         // nonces
         int64_t m_next_client_id;
         uint64_t m_next_server_nonce;
@@ -278,6 +624,28 @@ class client
         const char** m_macaroons;
         size_t m_macaroons_sz;
         bool m_convert_types;
+        bool m_corking;
+        cork_map_t m_corks;
+        bool m_corking_searches;
+        cork_map_t m_search_corks;
+        read_cache m_read_cache;
+        hedge_policy m_hedging;
+        client_stats m_stats;
+        std::string m_stats_report;
+        hedge_map_t m_hedges;
+        // deadline -> nonce of each hedge in m_hedges that may still fire
+        std::multimap<uint64_t, uint64_t> m_hedge_deadlines;
+        hedged_map_t m_hedged;
+        uint64_t m_op_timeout;
+        // deadline -> nonce of each message sent for an op with a deadline
+        std::multimap<uint64_t, uint64_t> m_op_deadlines;
+        // when -> nonce of each throttled request waiting to go out again
+        std::multimap<uint64_t, uint64_t> m_throttle_deadlines;
+        // shared clients
+        bool m_shared;
+        po6::threads::mutex m_protect;
+        completion_queue_map_t m_completion_queues;
+        std::vector<attr_hint> m_attr_hints;
 
     private:
         client(const client&);
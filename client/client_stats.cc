@@ -0,0 +1,229 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// STL
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+// HyperDex
+#include "client/client_stats.h"
+
+using hyperdex::client_stats;
+
+// 62 powers of two from 4 up, four buckets each, plus one for each of 0-3
+#define CLIENT_STATS_BUCKETS 252
+
+client_stats :: client_stats()
+    : m_enabled(false)
+    , m_ops()
+    , m_servers()
+    , m_wait()
+    , m_refresh()
+    , m_disruptions()
+    , m_failed_disruption(0)
+    , m_failed_reconfigure(0)
+    , m_compressed()
+{
+}
+
+client_stats :: ~client_stats() throw ()
+{
+}
+
+void
+client_stats :: record_reply(network_msgtype mt, uint64_t si, uint64_t nanos)
+{
+    if (!m_enabled)
+    {
+        return;
+    }
+
+    m_ops[mt].record(nanos);
+    m_servers[si].record(nanos);
+}
+
+void
+client_stats :: record_compressed(network_msgtype mt, uint64_t raw, uint64_t wire)
+{
+    if (!m_enabled)
+    {
+        return;
+    }
+
+    std::vector<uint64_t>& c(m_compressed[mt]);
+    c.resize(3, 0);
+    ++c[0];
+    c[1] += raw;
+    c[2] += wire;
+}
+
+std::string
+client_stats :: report() const
+{
+    std::ostringstream ostr;
+
+    for (std::map<network_msgtype, histogram>::const_iterator it = m_ops.begin();
+            it != m_ops.end(); ++it)
+    {
+        ostr << "op." << it->first;
+        it->second.report(ostr);
+    }
+
+    for (std::map<uint64_t, histogram>::const_iterator it = m_servers.begin();
+            it != m_servers.end(); ++it)
+    {
+        ostr << "server." << it->first;
+        it->second.report(ostr);
+    }
+
+    ostr << "loop.wait";
+    m_wait.report(ostr);
+    ostr << "config.refresh";
+    m_refresh.report(ostr);
+
+    for (std::map<uint64_t, uint64_t>::const_iterator it = m_disruptions.begin();
+            it != m_disruptions.end(); ++it)
+    {
+        ostr << "disruptions." << it->first << " count=" << it->second << "\n";
+    }
+
+    ostr << "failed disruption=" << m_failed_disruption
+         << " reconfigure=" << m_failed_reconfigure << "\n";
+
+    for (std::map<network_msgtype, std::vector<uint64_t> >::const_iterator it = m_compressed.begin();
+            it != m_compressed.end(); ++it)
+    {
+        const std::vector<uint64_t>& c(it->second);
+        ostr << "compressed." << it->first
+             << " count=" << c[0]
+             << " raw_bytes=" << c[1]
+             << " wire_bytes=" << c[2]
+             << " ratio=" << std::fixed << std::setprecision(2)
+             << (c[2] ? double(c[1]) / c[2] : 0.) << "\n";
+    }
+
+    return ostr.str();
+}
+
+void
+client_stats :: reset()
+{
+    m_ops.clear();
+    m_servers.clear();
+    m_wait = histogram();
+    m_refresh = histogram();
+    m_disruptions.clear();
+    m_failed_disruption = 0;
+    m_failed_reconfigure = 0;
+    m_compressed.clear();
+}
+
+client_stats :: histogram :: histogram()
+    : m_counts()
+    , m_count(0)
+    , m_sum(0)
+    , m_max(0)
+{
+}
+
+void
+client_stats :: histogram :: record(uint64_t value)
+{
+    if (m_counts.empty())
+    {
+        m_counts.resize(CLIENT_STATS_BUCKETS, 0);
+    }
+
+    ++m_counts[bucket(value)];
+    ++m_count;
+    m_sum += value;
+    m_max = std::max(m_max, value);
+}
+
+uint64_t
+client_stats :: histogram :: percentile(double pct) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+
+    // the smallest rank that covers pct of the values
+    uint64_t rank = static_cast<uint64_t>(m_count * pct / 100.);
+    rank = std::max(rank, uint64_t(1));
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < m_counts.size(); ++i)
+    {
+        seen += m_counts[i];
+
+        if (seen >= rank)
+        {
+            return std::min(bucket_upper_bound(i), m_max);
+        }
+    }
+
+    return m_max;
+}
+
+void
+client_stats :: histogram :: report(std::ostream& out) const
+{
+    out << " count=" << m_count
+        << " mean_ns=" << (m_count ? m_sum / m_count : 0)
+        << " p50_ns=" << percentile(50)
+        << " p99_ns=" << percentile(99)
+        << " max_ns=" << m_max << "\n";
+}
+
+size_t
+client_stats :: histogram :: bucket(uint64_t value)
+{
+    if (value < 4)
+    {
+        return value;
+    }
+
+    const unsigned e = 63 - __builtin_clzll(value);
+    const unsigned sub = (value >> (e - 2)) & 3;
+    return ((e - 1) << 2) + sub;
+}
+
+uint64_t
+client_stats :: histogram :: bucket_upper_bound(size_t idx)
+{
+    if (idx < 4)
+    {
+        return idx;
+    }
+
+    const unsigned e = (idx >> 2) + 1;
+    const uint64_t sub = idx & 3;
+    const uint64_t width = 1ULL << (e - 2);
+    return ((4 + sub) << (e - 2)) + width - 1;
+}
@@ -0,0 +1,125 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_client_client_stats_h_
+#define hyperdex_client_client_stats_h_
+
+// C
+#include <stdint.h>
+
+// STL
+#include <map>
+#include <string>
+#include <vector>
+
+// HyperDex
+#include "namespace.h"
+#include "common/network_msgtype.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// What a client spends its time on, so that slowness can be pinned on the
+// client or the servers:  the latency of replies by the type of request and
+// by the server that answered, the time loop spends blocked waiting for
+// messages, disruptions, configuration refreshes, operations failed back to
+// the application and how well compressed replies shrank.  Off until
+// enabled; while off, nothing is recorded.
+class client_stats
+{
+    public:
+        client_stats();
+        ~client_stats() throw ();
+
+    public:
+        bool enabled() const { return m_enabled; }
+        void enable(bool on) { m_enabled = on; }
+        // a reply to a request of type "mt" came from server "si" "nanos"
+        // after it was sent
+        void record_reply(network_msgtype mt, uint64_t si, uint64_t nanos);
+        void record_wait(uint64_t nanos)
+        { if (m_enabled) m_wait.record(nanos); }
+        void record_disruption(uint64_t si)
+        { if (m_enabled) ++m_disruptions[si]; }
+        void record_config_refresh(uint64_t nanos)
+        { if (m_enabled) m_refresh.record(nanos); }
+        // operations failed back to the application for it to retry
+        void record_failed_disruption(uint64_t ops)
+        { if (m_enabled) m_failed_disruption += ops; }
+        void record_failed_reconfigure(uint64_t ops)
+        { if (m_enabled) m_failed_reconfigure += ops; }
+        // a compressed reply of type "mt" expanded to "raw" bytes from the
+        // "wire" bytes that carried it
+        void record_compressed(network_msgtype mt, uint64_t raw, uint64_t wire);
+        // one line for each histogram or counter, as "name key=value ..."
+        std::string report() const;
+        void reset();
+
+    private:
+        // latencies in logarithmic buckets, each power of two split in four
+        class histogram
+        {
+            public:
+                histogram();
+
+            public:
+                void record(uint64_t value);
+                uint64_t count() const { return m_count; }
+                // the upper bound of the bucket holding the "pct" percentile
+                uint64_t percentile(double pct) const;
+                void report(std::ostream& out) const;
+
+            public:
+                static size_t bucket(uint64_t value);
+                static uint64_t bucket_upper_bound(size_t idx);
+
+            private:
+                std::vector<uint64_t> m_counts;
+                uint64_t m_count;
+                uint64_t m_sum;
+                uint64_t m_max;
+        };
+
+    private:
+        bool m_enabled;
+        std::map<network_msgtype, histogram> m_ops;
+        std::map<uint64_t, histogram> m_servers;
+        histogram m_wait;
+        histogram m_refresh;
+        std::map<uint64_t, uint64_t> m_disruptions;
+        uint64_t m_failed_disruption;
+        uint64_t m_failed_reconfigure;
+        // replies, raw bytes and wire bytes by the type of reply compressed
+        std::map<network_msgtype, std::vector<uint64_t> > m_compressed;
+
+    private:
+        client_stats(const client_stats&);
+        client_stats& operator = (const client_stats&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_client_client_stats_h_
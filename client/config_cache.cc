@@ -0,0 +1,185 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdio.h>
+#include <string.h>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// STL
+#include <memory>
+#include <sstream>
+#include <vector>
+
+// po6
+#include <po6/io/fd.h>
+
+// e
+#include <e/buffer.h>
+
+// HyperDex
+#include "client/constants.h"
+#include "client/config_cache.h"
+
+using hyperdex::config_cache;
+
+namespace
+{
+
+// "host:port" or a connection string, made safe to use as a file name
+std::string
+file_name(const std::string& coordinator)
+{
+    std::string name(coordinator);
+
+    for (size_t i = 0; i < name.size(); ++i)
+    {
+        char c = name[i];
+
+        if (!((c >= 'a' && c <= 'z') ||
+              (c >= 'A' && c <= 'Z') ||
+              (c >= '0' && c <= '9') ||
+              c == '.' || c == '-'))
+        {
+            name[i] = '_';
+        }
+    }
+
+    return "hyperdex-" + name + ".config";
+}
+
+} // namespace
+
+config_cache :: config_cache(const std::string& coordinator)
+    : m_name(file_name(coordinator))
+    , m_path()
+    , m_cluster(0)
+    , m_version(0)
+{
+}
+
+config_cache :: ~config_cache() throw ()
+{
+}
+
+void
+config_cache :: set_directory(const char* directory)
+{
+    if (!directory || !*directory)
+    {
+        m_path.clear();
+    }
+    else
+    {
+        m_path = std::string(directory) + "/" + m_name;
+    }
+
+    m_cluster = 0;
+    m_version = 0;
+}
+
+bool
+config_cache :: load(configuration* config)
+{
+    if (!enabled())
+    {
+        return false;
+    }
+
+    po6::io::fd fd(open(m_path.c_str(), O_RDONLY));
+    struct stat st;
+
+    if (fd.get() < 0 || fstat(fd.get(), &st) < 0 ||
+        st.st_size <= HYPERDEX_CLIENT_CONFIG_CACHE_MAGIC_SZ ||
+        st.st_size > HYPERDEX_CLIENT_CONFIG_CACHE_MAX_BYTES)
+    {
+        return false;
+    }
+
+    std::vector<char> buf(st.st_size);
+
+    if (fd.xread(&buf[0], buf.size()) != static_cast<ssize_t>(buf.size()) ||
+        memcmp(&buf[0], HYPERDEX_CLIENT_CONFIG_CACHE_MAGIC,
+               HYPERDEX_CLIENT_CONFIG_CACHE_MAGIC_SZ) != 0)
+    {
+        return false;
+    }
+
+    configuration c;
+    e::unpacker up(&buf[0] + HYPERDEX_CLIENT_CONFIG_CACHE_MAGIC_SZ,
+                   buf.size() - HYPERDEX_CLIENT_CONFIG_CACHE_MAGIC_SZ);
+    up = up >> c;
+
+    if (up.error() || up.remain() != 0 || c.version() == 0)
+    {
+        return false;
+    }
+
+    *config = c;
+    m_cluster = c.cluster();
+    m_version = c.version();
+    return true;
+}
+
+void
+config_cache :: save(const configuration& config)
+{
+    if (!enabled() ||
+        (config.cluster() == m_cluster && config.version() == m_version))
+    {
+        return;
+    }
+
+    const size_t sz = HYPERDEX_CLIENT_CONFIG_CACHE_MAGIC_SZ + pack_size(config);
+    std::auto_ptr<e::buffer> buf(e::buffer::create(sz));
+    memmove(buf->data(), HYPERDEX_CLIENT_CONFIG_CACHE_MAGIC,
+            HYPERDEX_CLIENT_CONFIG_CACHE_MAGIC_SZ);
+    buf->pack_at(HYPERDEX_CLIENT_CONFIG_CACHE_MAGIC_SZ) << config;
+
+    // write a file of our own and rename it over the old one, so that a
+    // client starting meanwhile reads one whole configuration or the other
+    std::ostringstream tmp;
+    tmp << m_path << ".tmp." << getpid();
+    po6::io::fd fd(open(tmp.str().c_str(), O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR));
+
+    if (fd.get() < 0 ||
+        fd.xwrite(buf->data(), buf->size()) != static_cast<ssize_t>(buf->size()) ||
+        rename(tmp.str().c_str(), m_path.c_str()) < 0)
+    {
+        unlink(tmp.str().c_str());
+        return;
+    }
+
+    m_cluster = config.cluster();
+    m_version = config.version();
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_client_config_cache_h_
+#define hyperdex_client_config_cache_h_
+
+// C
+#include <stdint.h>
+
+// STL
+#include <string>
+
+// HyperDex
+#include "namespace.h"
+#include "common/configuration.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Keeps the last configuration a client saw in a file named for its
+// coordinator, so that the next client of the same cluster can route
+// operations before the coordinator answers.  The file is only a hint:
+// servers turn away operations routed with a configuration they no longer
+// hold, and the coordinator's configuration replaces it when it arrives.
+class config_cache
+{
+    public:
+        config_cache(const std::string& coordinator);
+        ~config_cache() throw ();
+
+    public:
+        bool enabled() const { return !m_path.empty(); }
+        // keep the file within "directory"; NULL or "" turns the cache off
+        void set_directory(const char* directory);
+        // the configuration last saved, if the file holds a usable one
+        bool load(configuration* config);
+        // replace the file unless it already holds this version of the
+        // cluster's configuration
+        void save(const configuration& config);
+
+    private:
+        const std::string m_name;
+        std::string m_path;
+        uint64_t m_cluster;
+        uint64_t m_version;
+
+    private:
+        config_cache(const config_cache&);
+        config_cache& operator = (const config_cache&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_client_config_cache_h_
@@ -36,10 +36,41 @@
                                      + sizeof(uint8_t) /*flags*/ \
                                      + sizeof(uint64_t) /*version*/ \
                                      + sizeof(uint64_t) /*vidt*/ \
+                                     + sizeof(uint32_t) /*budget*/ \
                                      + sizeof(uint64_t) /*nonce*/)
 #define HYPERDEX_CLIENT_HEADER_SIZE_RESP (BUSYBEE_HEADER_SIZE \
                                       + sizeof(uint8_t) /*mt*/ \
                                       + sizeof(uint64_t) /*vidt*/ \
                                       + sizeof(uint64_t) /*nonce*/)
 
+// how much a search asks each server for per REQ_SEARCH_NEXT
+#define HYPERDEX_CLIENT_SEARCH_BATCH_OBJECTS 256
+#define HYPERDEX_CLIENT_SEARCH_BATCH_BYTES (1024 * 1024)
+// how many REQ_SEARCH_NEXTs a search keeps in flight to each server, and how
+// many bytes of objects it holds for the caller before it stops asking
+#define HYPERDEX_CLIENT_SEARCH_PREFETCH 2
+#define HYPERDEX_CLIENT_SEARCH_BUFFER_BYTES (8 * 1024 * 1024)
+// how many objects of its sorted run a server sends at a time
+#define HYPERDEX_CLIENT_SORTED_SEARCH_CHUNK 256
+// how many bytes of corked operations a client holds for one server before
+// sending them anyway
+#define HYPERDEX_CLIENT_CORK_BYTES (256 * 1024)
+// how many recent get latencies a hedging client keeps
+#define HYPERDEX_CLIENT_HEDGE_SAMPLES 256
+// how many times a read transaction reads its keys before it gives up on
+// finding them unchanged between two rounds
+#define HYPERDEX_CLIENT_READ_TRANSACTION_ATTEMPTS 16
+// how many times a request the servers throttle goes out again, and how long
+// the client waits before each; the wait doubles from the first up to the most
+#define HYPERDEX_CLIENT_THROTTLE_ATTEMPTS 8
+#define HYPERDEX_CLIENT_THROTTLE_BACKOFF_MS 2
+#define HYPERDEX_CLIENT_THROTTLE_BACKOFF_MAX_MS 1000
+// how many attribute names a client remembers the numbers of
+#define HYPERDEX_CLIENT_ATTR_HINTS 256
+// what begins a cached configuration file, and the largest such file a
+// client will read
+#define HYPERDEX_CLIENT_CONFIG_CACHE_MAGIC "HDXCONF1"
+#define HYPERDEX_CLIENT_CONFIG_CACHE_MAGIC_SZ 8
+#define HYPERDEX_CLIENT_CONFIG_CACHE_MAX_BYTES (64 * 1024 * 1024)
+
 #endif // hyperdex_client_constants_h_
@@ -38,6 +38,7 @@
 #include <list>
 #include <memory>
 #include <string>
+#include <vector>
 
 // e
 #include <e/endian.h>
@@ -50,6 +51,14 @@
 
 using hyperdex::datatype_info;
 
+// every allocation is aligned for any type
+#define ARENA_ALIGN 16
+// chunks start small and double up to this size
+#define ARENA_CHUNK_MIN 4096
+#define ARENA_CHUNK_MAX (1024 * 1024)
+
+// Allocations are carved out of a list of chunks, so that resetting the arena
+// is just a matter of starting again at the first chunk.
 class hyperdex_ds_arena
 {
     public:
@@ -61,9 +70,27 @@ class hyperdex_ds_arena
         hyperdex_ds_list* allocate_list();
         hyperdex_ds_set* allocate_set();
         hyperdex_ds_map* allocate_map();
+        void reset();
+
+    private:
+        struct chunk
+        {
+            chunk() : base(NULL), size(0) {}
+            chunk(char* b, size_t s) : base(b), size(s) {}
+            char* base;
+            size_t size;
+        };
 
     private:
-        std::list<void*> m_voids;
+        // make a new chunk of at least "bytes" the current one; it goes
+        // ahead of any chunks a reset left to be reused
+        bool grow(size_t bytes);
+        void destroy_containers();
+
+    private:
+        std::vector<chunk> m_chunks;
+        size_t m_current;
+        size_t m_used; // bytes of m_chunks[m_current]
         std::list<hyperdex_ds_list*> m_lists;
         std::list<hyperdex_ds_set*> m_sets;
         std::list<hyperdex_ds_map*> m_maps;
@@ -104,7 +131,9 @@ class hyperdex_ds_map
 };
 
 hyperdex_ds_arena :: hyperdex_ds_arena()
-    : m_voids()
+    : m_chunks()
+    , m_current(0)
+    , m_used(0)
     , m_lists()
     , m_sets()
     , m_maps()
@@ -113,68 +142,49 @@ hyperdex_ds_arena :: hyperdex_ds_arena()
 
 hyperdex_ds_arena :: ~hyperdex_ds_arena() throw ()
 {
-    for (std::list<void*>::iterator it = m_voids.begin();
-            it != m_voids.end(); ++it)
+    for (size_t i = 0; i < m_chunks.size(); ++i)
     {
-        if (*it)
-        {
-            free(*it);
-        }
+        free(m_chunks[i].base);
     }
 
-    for (std::list<hyperdex_ds_list*>::iterator it = m_lists.begin();
-            it != m_lists.end(); ++it)
+    destroy_containers();
+}
+
+void*
+hyperdex_ds_arena :: allocate(size_t bytes)
+{
+    if (bytes > SIZE_MAX - ARENA_ALIGN)
     {
-        if (*it)
-        {
-            delete *it;
-        }
+        errno = ENOMEM;
+        return NULL;
     }
 
-    for (std::list<hyperdex_ds_set*>::iterator it = m_sets.begin();
-            it != m_sets.end(); ++it)
+    bytes = (bytes + ARENA_ALIGN - 1) & ~size_t(ARENA_ALIGN - 1);
+
+    if (m_chunks.empty())
     {
-        if (*it)
+        if (!grow(bytes))
         {
-            delete *it;
+            return NULL;
         }
     }
-
-    for (std::list<hyperdex_ds_map*>::iterator it = m_maps.begin();
-            it != m_maps.end(); ++it)
+    else if (m_chunks[m_current].size - m_used < bytes)
     {
-        if (*it)
+        if (m_current + 1 < m_chunks.size() &&
+            m_chunks[m_current + 1].size >= bytes)
         {
-            delete *it;
+            ++m_current;
+            m_used = 0;
         }
-    }
-}
-
-void*
-hyperdex_ds_arena :: allocate(size_t bytes)
-{
-    try
-    {
-        m_voids.push_back(NULL);
-        m_voids.back() = malloc(bytes);
-
-        if (m_voids.back() == NULL)
+        else if (!grow(bytes))
         {
-            m_voids.pop_back();
             return NULL;
         }
-
-        return m_voids.back();
-    }
-    catch (std::bad_alloc& ba)
-    {
-        errno = ENOMEM;
-        return NULL;
-    }
-    catch (...)
-    {
-        abort();
     }
+
+    char* ret = m_chunks[m_current].base + m_used;
+    m_used += bytes;
+    return ret;
 }
 
 hyperdex_ds_list*
@@ -237,6 +247,85 @@ hyperdex_ds_arena :: allocate_map()
     }
 }
 
+void
+hyperdex_ds_arena :: reset()
+{
+    m_current = 0;
+    m_used = 0;
+    destroy_containers();
+    m_lists.clear();
+    m_sets.clear();
+    m_maps.clear();
+}
+
+bool
+hyperdex_ds_arena :: grow(size_t bytes)
+{
+    size_t sz = ARENA_CHUNK_MIN;
+
+    if (!m_chunks.empty())
+    {
+        sz = std::min(m_chunks[m_current].size * 2, size_t(ARENA_CHUNK_MAX));
+    }
+
+    sz = std::max(sz, bytes);
+    char* base = static_cast<char*>(malloc(sz));
+
+    if (!base)
+    {
+        errno = ENOMEM;
+        return false;
+    }
+
+    const size_t pos = m_chunks.empty() ? 0 : m_current + 1;
+
+    try
+    {
+        m_chunks.insert(m_chunks.begin() + pos, chunk(base, sz));
+    }
+    catch (std::bad_alloc& ba)
+    {
+        free(base);
+        errno = ENOMEM;
+        return false;
+    }
+
+    m_current = pos;
+    m_used = 0;
+    return true;
+}
+
+void
+hyperdex_ds_arena :: destroy_containers()
+{
+    for (std::list<hyperdex_ds_list*>::iterator it = m_lists.begin();
+            it != m_lists.end(); ++it)
+    {
+        if (*it)
+        {
+            delete *it;
+        }
+    }
+
+    for (std::list<hyperdex_ds_set*>::iterator it = m_sets.begin();
+            it != m_sets.end(); ++it)
+    {
+        if (*it)
+        {
+            delete *it;
+        }
+    }
+
+    for (std::list<hyperdex_ds_map*>::iterator it = m_maps.begin();
+            it != m_maps.end(); ++it)
+    {
+        if (*it)
+        {
+            delete *it;
+        }
+    }
+}
+
 hyperdex_ds_list :: hyperdex_ds_list()
     : type(HYPERDATATYPE_LIST_GENERIC)
     , elems()
@@ -292,6 +381,12 @@ hyperdex_ds_arena_destroy(struct hyperdex_ds_arena* arena)
     }
 }
 
+HYPERDEX_API void
+hyperdex_ds_arena_reset(struct hyperdex_ds_arena* arena)
+{
+    arena->reset();
+}
+
 HYPERDEX_API void*
 hyperdex_ds_malloc(struct hyperdex_ds_arena* arena, size_t sz)
 {
@@ -0,0 +1,91 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// STL
+#include <algorithm>
+
+// HyperDex
+#include "client/constants.h"
+#include "client/hedge_policy.h"
+
+using hyperdex::hedge_policy;
+
+hedge_policy :: hedge_policy()
+    : m_fraction(0)
+    , m_samples()
+    , m_next(0)
+    , m_since_update(0)
+    , m_delay(0)
+    , m_gets(0)
+    , m_hedged(0)
+    , m_won(0)
+{
+}
+
+hedge_policy :: ~hedge_policy() throw ()
+{
+}
+
+void
+hedge_policy :: configure(double fraction)
+{
+    m_fraction = std::max(0.0, std::min(fraction, 1.0));
+}
+
+void
+hedge_policy :: record(uint64_t latency)
+{
+    if (m_samples.size() < HYPERDEX_CLIENT_HEDGE_SAMPLES)
+    {
+        m_samples.push_back(latency);
+    }
+    else
+    {
+        m_samples[m_next] = latency;
+        m_next = (m_next + 1) % m_samples.size();
+    }
+
+    // a quarter of the window is enough to start, and after that the
+    // percentile moves slowly enough to recompute now and then
+    if (m_samples.size() < HYPERDEX_CLIENT_HEDGE_SAMPLES / 4 ||
+        ++m_since_update < HYPERDEX_CLIENT_HEDGE_SAMPLES / 16)
+    {
+        return;
+    }
+
+    m_since_update = 0;
+    std::vector<uint64_t> sorted(m_samples);
+    std::vector<uint64_t>::iterator p95 = sorted.begin() + sorted.size() * 95 / 100;
+    std::nth_element(sorted.begin(), p95, sorted.end());
+    m_delay = std::max(*p95, uint64_t(1));
+}
+
+bool
+hedge_policy :: admit() const
+{
+    return m_hedged + 1 <= m_fraction * m_gets;
+}
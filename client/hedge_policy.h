@@ -0,0 +1,85 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_client_hedge_policy_h_
+#define hyperdex_client_hedge_policy_h_
+
+// C
+#include <stdint.h>
+
+// STL
+#include <vector>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Decides when a get has waited long enough on its point leader that a
+// duplicate should go to another replica.  The delay is the 95th percentile
+// of recently observed get latencies, and no more than "fraction" of gets are
+// ever hedged.
+class hedge_policy
+{
+    public:
+        hedge_policy();
+        ~hedge_policy() throw ();
+
+    public:
+        bool enabled() const { return m_fraction > 0; }
+        void configure(double fraction);
+        // nanoseconds to wait before hedging; zero until enough gets have
+        // been observed to know
+        uint64_t delay() const { return m_delay; }
+        void record(uint64_t latency);
+        void count_get() { ++m_gets; }
+        // may one more get be hedged?
+        bool admit() const;
+        void count_hedge() { ++m_hedged; }
+        void count_win() { ++m_won; }
+        uint64_t gets() const { return m_gets; }
+        uint64_t hedged() const { return m_hedged; }
+        uint64_t won() const { return m_won; }
+
+    private:
+        double m_fraction;
+        std::vector<uint64_t> m_samples;
+        size_t m_next;
+        size_t m_since_update;
+        uint64_t m_delay;
+        uint64_t m_gets;
+        uint64_t m_hedged;
+        uint64_t m_won;
+
+    private:
+        hedge_policy(const hedge_policy&);
+        hedge_policy& operator = (const hedge_policy&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_client_hedge_policy_h_
@@ -33,6 +33,8 @@ using hyperdex::pending;
 pending :: pending(uint64_t id, hyperdex_client_returncode* status)
     : m_ref(0)
     , m_client_visible_id(id)
+    , m_owner(pthread_self())
+    , m_deadline(0)
     , m_status(status)
     , m_error()
 {
@@ -42,6 +44,12 @@ pending :: ~pending() throw ()
 {
 }
 
+void
+pending :: expire()
+{
+    PENDING_ERROR(TIMEOUT) << "operation timed out";
+}
+
 std::ostream&
 pending :: error(const char* file, size_t line)
 {
@@ -28,6 +28,9 @@
 #ifndef hyperdex_client_pending_h_
 #define hyperdex_client_pending_h_
 
+// POSIX
+#include <pthread.h>
+
 // STL
 #include <memory>
 
@@ -54,8 +57,16 @@ class pending
 
     public:
         int64_t client_visible_id() const { return m_client_visible_id; }
+        // the thread that issued the operation
+        pthread_t owner() const { return m_owner; }
         void set_status(hyperdex_client_returncode status) { *m_status = status; }
         e::error error() const { return m_error; }
+        // the monotonic time by which the operation must finish; 0 for never
+        uint64_t deadline() const { return m_deadline; }
+        void set_deadline(uint64_t deadline) { m_deadline = deadline; }
+        // the operation ran past its deadline; report that in place of
+        // whatever handle_failure recorded
+        void expire();
 
     // return to client
     public:
@@ -96,6 +107,8 @@ class pending
     // operation state
     private:
         int64_t m_client_visible_id;
+        pthread_t m_owner;
+        uint64_t m_deadline;
         hyperdex_client_returncode* m_status;
         e::error m_error;
 };
@@ -0,0 +1,379 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#define __STDC_LIMIT_MACROS
+
+// C
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+// STL
+#include <limits>
+
+// HyperDex
+#include "common/aggregate.h"
+#include "client/pending_aggregate.h"
+
+using hyperdex::pending_aggregate;
+
+pending_aggregate :: pending_aggregate(uint64_t id,
+                                       hyperdex_client_returncode* status,
+                                       const std::vector<uint8_t>& funcs,
+                                       const std::vector<char>& is_float,
+                                       bool grouped,
+                                       const hyperdex_client_aggregate_group** groups,
+                                       size_t* groups_sz)
+    : pending_aggregation(id, status)
+    , m_funcs(funcs)
+    , m_is_float(is_float)
+    , m_groups(groups)
+    , m_groups_sz(groups_sz)
+    , m_partials()
+    , m_failed(false)
+    , m_done(false)
+{
+    set_status(HYPERDEX_CLIENT_SUCCESS);
+    set_error(e::error());
+    // the caller sees no rows until the aggregate yields them
+    *m_groups = NULL;
+    *m_groups_sz = 0;
+
+    if (!grouped)
+    {
+        // an ungrouped aggregate has exactly one row, even when nothing matches
+        group& g(m_partials[std::string()]);
+        g.i.resize(m_funcs.size());
+        g.d.resize(m_funcs.size());
+    }
+}
+
+pending_aggregate :: ~pending_aggregate() throw ()
+{
+}
+
+bool
+pending_aggregate :: can_yield()
+{
+    return this->aggregation_done() && !m_done;
+}
+
+bool
+pending_aggregate :: yield(hyperdex_client_returncode* status, e::error* err)
+{
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+    assert(this->can_yield());
+    m_done = true;
+
+    if (m_failed)
+    {
+        return true;
+    }
+
+    // one allocation holds the rows, then their values, then their names, so
+    // that hyperdex_client_destroy_aggregate_groups is a single free
+    const size_t rows_sz = sizeof(hyperdex_client_aggregate_group) * m_partials.size();
+    size_t sz = rows_sz + sizeof(double) * m_funcs.size() * m_partials.size();
+
+    for (std::map<std::string, group>::iterator it = m_partials.begin();
+            it != m_partials.end(); ++it)
+    {
+        sz += it->first.size() + 1;
+    }
+
+    char* ret = static_cast<char*>(malloc(sz));
+
+    if (!ret)
+    {
+        PENDING_ERROR(NOMEM) << "out of memory";
+        return true;
+    }
+
+    hyperdex_client_aggregate_group* rows = reinterpret_cast<hyperdex_client_aggregate_group*>(ret);
+    double* values = reinterpret_cast<double*>(ret + rows_sz);
+    char* names = ret + rows_sz + sizeof(double) * m_funcs.size() * m_partials.size();
+    size_t idx = 0;
+
+    for (std::map<std::string, group>::iterator it = m_partials.begin();
+            it != m_partials.end(); ++it, ++idx)
+    {
+        memmove(names, it->first.data(), it->first.size());
+        names[it->first.size()] = '\0';
+        rows[idx].group = names;
+        rows[idx].group_sz = it->first.size();
+        rows[idx].count = it->second.count;
+        rows[idx].values = values;
+        names += it->first.size() + 1;
+
+        for (size_t i = 0; i < m_funcs.size(); ++i)
+        {
+            *values = finish(it->second, i);
+            ++values;
+        }
+    }
+
+    *m_groups = rows;
+    *m_groups_sz = m_partials.size();
+    return true;
+}
+
+void
+pending_aggregate :: handle_failure(const server_id& si,
+                                    const virtual_server_id& vsi)
+{
+    m_failed = true;
+    PENDING_ERROR(RECONFIGURE) << "reconfiguration affecting "
+                               << vsi << "/" << si;
+    return pending_aggregation::handle_failure(si, vsi);
+}
+
+bool
+pending_aggregate :: handle_message(client* cl,
+                                    const server_id& si,
+                                    const virtual_server_id& vsi,
+                                    network_msgtype mt,
+                                    std::auto_ptr<e::buffer> msg,
+                                    e::unpacker up,
+                                    hyperdex_client_returncode* status,
+                                    e::error* err)
+{
+    bool handled = pending_aggregation::handle_message(cl, si, vsi, mt, std::auto_ptr<e::buffer>(), up, status, err);
+    assert(handled);
+
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+
+    if (mt != RESP_AGGREGATE)
+    {
+        m_failed = true;
+        PENDING_ERROR(SERVERERROR) << "server " << vsi << " responded to AGGREGATE with " << mt;
+        return true;
+    }
+
+    uint8_t st;
+    uint32_t groups_sz;
+    up = up >> st >> groups_sz;
+
+    if (up.error())
+    {
+        m_failed = true;
+        PENDING_ERROR(SERVERERROR) << "communication error: server "
+                                   << vsi << " sent corrupt message="
+                                   << msg->as_slice().hex()
+                                   << " in response to an AGGREGATE";
+        return true;
+    }
+
+    switch (st)
+    {
+        case AGGREGATE_OK:
+            break;
+        case AGGREGATE_TOO_MANY_GROUPS:
+            m_failed = true;
+            PENDING_ERROR(OVERFLOW) << "server " << vsi << " found more than "
+                                    << HYPERDEX_AGGREGATE_MAX_GROUPS << " groups";
+            return true;
+        case AGGREGATE_OVERFLOW:
+            m_failed = true;
+            PENDING_ERROR(OVERFLOW) << "server " << vsi << " overflowed an int64 sum";
+            return true;
+        case AGGREGATE_FAILED:
+        default:
+            m_failed = true;
+            PENDING_ERROR(SERVERERROR) << "server " << vsi << " could not compute the aggregate";
+            return true;
+    }
+
+    for (uint32_t n = 0; n < groups_sz; ++n)
+    {
+        e::slice name;
+        uint64_t count;
+        std::vector<uint64_t> partials(m_funcs.size());
+        up = up >> name >> count;
+
+        for (size_t i = 0; i < partials.size(); ++i)
+        {
+            up = up >> partials[i];
+        }
+
+        if (up.error())
+        {
+            m_failed = true;
+            PENDING_ERROR(SERVERERROR) << "communication error: server "
+                                       << vsi << " sent corrupt message="
+                                       << msg->as_slice().hex()
+                                       << " in response to an AGGREGATE";
+            return true;
+        }
+
+        std::string key(reinterpret_cast<const char*>(name.data()), name.size());
+        std::map<std::string, group>::iterator it = m_partials.find(key);
+
+        if (it == m_partials.end())
+        {
+            if (m_partials.size() >= HYPERDEX_AGGREGATE_MAX_GROUPS)
+            {
+                m_failed = true;
+                PENDING_ERROR(OVERFLOW) << "aggregate has more than "
+                                        << HYPERDEX_AGGREGATE_MAX_GROUPS << " groups";
+                return true;
+            }
+
+            it = m_partials.insert(std::make_pair(key, group())).first;
+            it->second.i.resize(m_funcs.size());
+            it->second.d.resize(m_funcs.size());
+        }
+
+        for (size_t i = 0; i < partials.size(); ++i)
+        {
+            if (!merge(&it->second, count, i, partials[i]))
+            {
+                m_failed = true;
+                PENDING_ERROR(OVERFLOW) << "an int64 sum overflowed";
+                return true;
+            }
+        }
+
+        it->second.count += count;
+    }
+
+    // Don't set the status or error so that errors will carry through.  It was
+    // set to the success state in the constructor
+    return true;
+}
+
+bool
+pending_aggregate :: merge(group* g, uint64_t count, size_t idx, uint64_t partial)
+{
+    if (count == 0)
+    {
+        return true;
+    }
+
+    if (m_is_float[idx])
+    {
+        double x;
+        memmove(&x, &partial, sizeof(x));
+        double* d = &g->d[idx];
+
+        switch (m_funcs[idx])
+        {
+            case AGGREGATE_SUM:
+            case AGGREGATE_AVG:
+                *d += x;
+                break;
+            case AGGREGATE_MIN:
+                *d = g->count == 0 || x < *d ? x : *d;
+                break;
+            case AGGREGATE_MAX:
+                *d = g->count == 0 || x > *d ? x : *d;
+                break;
+            default:
+                abort();
+        }
+    }
+    else
+    {
+        int64_t x = static_cast<int64_t>(partial);
+        int64_t* i = &g->i[idx];
+
+        switch (m_funcs[idx])
+        {
+            case AGGREGATE_SUM:
+            case AGGREGATE_AVG:
+                if ((x > 0 && *i > INT64_MAX - x) ||
+                    (x < 0 && *i < INT64_MIN - x))
+                {
+                    return false;
+                }
+
+                *i += x;
+                break;
+            case AGGREGATE_MIN:
+                *i = g->count == 0 || x < *i ? x : *i;
+                break;
+            case AGGREGATE_MAX:
+                *i = g->count == 0 || x > *i ? x : *i;
+                break;
+            default:
+                abort();
+        }
+    }
+
+    return true;
+}
+
+double
+pending_aggregate :: finish(const group& g, size_t idx) const
+{
+    double x = m_is_float[idx] ? g.d[idx] : static_cast<double>(g.i[idx]);
+
+    switch (m_funcs[idx])
+    {
+        case AGGREGATE_SUM:
+            return x;
+        case AGGREGATE_AVG:
+            return g.count > 0 ? x / g.count : std::numeric_limits<double>::quiet_NaN();
+        case AGGREGATE_MIN:
+        case AGGREGATE_MAX:
+            return g.count > 0 ? x : std::numeric_limits<double>::quiet_NaN();
+        default:
+            abort();
+    }
+}
+
+pending_aggregate :: group :: group()
+    : count(0)
+    , i()
+    , d()
+{
+}
+
+pending_aggregate :: group :: group(const group& other)
+    : count(other.count)
+    , i(other.i)
+    , d(other.d)
+{
+}
+
+pending_aggregate :: group :: ~group() throw ()
+{
+}
+
+pending_aggregate::group&
+pending_aggregate :: group :: operator = (const group& other)
+{
+    if (this != &other)
+    {
+        count = other.count;
+        i = other.i;
+        d = other.d;
+    }
+
+    return *this;
+}
@@ -0,0 +1,113 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_client_pending_aggregate_h_
+#define hyperdex_client_pending_aggregate_h_
+
+// STL
+#include <map>
+#include <string>
+#include <vector>
+
+// HyperDex
+#include "namespace.h"
+#include "client/pending_aggregation.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+class pending_aggregate : public pending_aggregation
+{
+    public:
+        pending_aggregate(uint64_t client_visible_id,
+                          hyperdex_client_returncode* status,
+                          const std::vector<uint8_t>& funcs,
+                          const std::vector<char>& is_float,
+                          bool grouped,
+                          const hyperdex_client_aggregate_group** groups,
+                          size_t* groups_sz);
+        virtual ~pending_aggregate() throw ();
+
+    // return to client
+    public:
+        virtual bool can_yield();
+        virtual bool yield(hyperdex_client_returncode* status, e::error* error);
+
+    // events
+    public:
+        virtual void handle_failure(const server_id& si,
+                                    const virtual_server_id& vsi);
+        virtual bool handle_message(client*,
+                                    const server_id& si,
+                                    const virtual_server_id& vsi,
+                                    network_msgtype mt,
+                                    std::auto_ptr<e::buffer> msg,
+                                    e::unpacker up,
+                                    hyperdex_client_returncode* status,
+                                    e::error* error);
+
+    public:
+        class group;
+
+    // noncopyable
+    private:
+        pending_aggregate(const pending_aggregate& other);
+        pending_aggregate& operator = (const pending_aggregate& rhs);
+
+    private:
+        bool merge(group* g, uint64_t count, size_t idx, uint64_t partial);
+        double finish(const group& g, size_t idx) const;
+
+    private:
+        const std::vector<uint8_t> m_funcs;
+        const std::vector<char> m_is_float;
+        const hyperdex_client_aggregate_group** m_groups;
+        size_t* m_groups_sz;
+        // partial results combined across the servers heard from so far
+        std::map<std::string, group> m_partials;
+        bool m_failed;
+        bool m_done;
+};
+
+class pending_aggregate :: group
+{
+    public:
+        group();
+        group(const group&);
+        ~group() throw ();
+
+    public:
+        group& operator = (const group&);
+
+    public:
+        uint64_t count;
+        std::vector<int64_t> i;
+        std::vector<double> d;
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_client_pending_aggregate_h_
@@ -149,6 +149,10 @@ pending_atomic :: handle_message(client*,
             PENDING_ERROR(UNAUTHORIZED) << "server " << si
                                         << " denied the request because it is unauthorized";
             return true;
+        case NET_THROTTLED:
+            PENDING_ERROR(THROTTLED) << "server " << si
+                                     << " kept refusing the request because the space is over its quota";
+            return true;
         default:
             PENDING_ERROR(SERVERERROR) << "server " << si
                                        << " returned non-sensical returncode "
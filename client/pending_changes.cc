@@ -0,0 +1,425 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// HyperDex
+#include "common/compression.h"
+#include "client/client.h"
+#include "client/constants.h"
+#include "client/pending_changes.h"
+#include "client/util.h"
+
+using hyperdex::pending_changes;
+
+pending_changes :: pending_changes(client* cl,
+                                   uint64_t id,
+                                   uint64_t checkpoint,
+                                   hyperdex_client_returncode* status,
+                                   const hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                                   uint64_t* version, int* deleted,
+                                   uint64_t* resume)
+    : pending_aggregation(id, status)
+    , m_cl(cl)
+    , m_checkpoint(checkpoint)
+    , m_attrs(attrs)
+    , m_attrs_sz(attrs_sz)
+    , m_version(version)
+    , m_deleted(deleted)
+    , m_resume(resume)
+    , m_yield(false)
+    , m_done(false)
+    , m_items()
+    , m_buffered(0)
+    , m_streams()
+{
+    *m_attrs = NULL;
+    *m_attrs_sz = 0;
+    *m_version = 0;
+    *m_deleted = 0;
+    *m_resume = checkpoint;
+}
+
+pending_changes :: ~pending_changes() throw ()
+{
+}
+
+bool
+pending_changes :: can_yield()
+{
+    return m_yield || !m_items.empty();
+}
+
+bool
+pending_changes :: yield(hyperdex_client_returncode* status, e::error* err)
+{
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+
+    // streams held back by m_buffered resume as the caller drains m_items
+    for (std::map<virtual_server_id, stream>::iterator s = m_streams.begin();
+            s != m_streams.end(); ++s)
+    {
+        hyperdex_client_returncode op_status;
+
+        if (!refill(m_cl, s->first, &s->second, &op_status))
+        {
+            PENDING_ERROR(RECONFIGURE) << "could not send CHANGES_NEXT to " << s->first;
+            m_yield = true;
+        }
+    }
+
+    *m_resume = resume_point();
+
+    // as with searches, a pending error goes out before any queued changes
+    // and SEARCHDONE only after all of them
+    if (!m_items.empty() && (!m_yield || m_done))
+    {
+        const item& it(m_items.front());
+        hyperdex_client_returncode op_status;
+        e::error op_error;
+        bool decoded;
+
+        if (it.deleted)
+        {
+            std::vector<std::pair<uint16_t, e::slice> > key;
+            key.push_back(std::make_pair(uint16_t(0), it.key));
+            decoded = value_to_attributes(m_cl->m_config, it.ri, key,
+                                          &op_status, &op_error, m_attrs, m_attrs_sz,
+                                          m_cl->m_convert_types, NULL);
+        }
+        else
+        {
+            decoded = value_to_attributes(m_cl->m_config, it.ri,
+                                          it.key.data(), it.key.size(), it.value,
+                                          &op_status, &op_error, m_attrs, m_attrs_sz,
+                                          m_cl->m_convert_types, NULL);
+        }
+
+        if (decoded)
+        {
+            set_status(HYPERDEX_CLIENT_SUCCESS);
+            set_error(e::error());
+        }
+        else
+        {
+            set_status(op_status);
+            set_error(op_error);
+        }
+
+        *m_version = it.version;
+        *m_deleted = it.deleted ? 1 : 0;
+        m_buffered -= it.bytes;
+        m_items.pop_front();
+        return true;
+    }
+
+    m_yield = false;
+
+    if (changes_done() && !m_done)
+    {
+        m_yield = true;
+        m_done = true;
+    }
+    else if (m_done)
+    {
+        set_status(HYPERDEX_CLIENT_SEARCHDONE);
+    }
+
+    return true;
+}
+
+void
+pending_changes :: handle_failure(const server_id& si,
+                                  const virtual_server_id& vsi)
+{
+    m_yield = true;
+    m_streams[vsi].done = true;
+    PENDING_ERROR(RECONFIGURE) << "reconfiguration affecting "
+                               << vsi << "/" << si;
+    return pending_aggregation::handle_failure(si, vsi);
+}
+
+bool
+pending_changes :: handle_message(client* cl,
+                                  const server_id& si,
+                                  const virtual_server_id& vsi,
+                                  network_msgtype mt,
+                                  std::auto_ptr<e::buffer> msg,
+                                  e::unpacker up,
+                                  hyperdex_client_returncode* status,
+                                  e::error* err)
+{
+    bool handled = pending_aggregation::handle_message(cl, si, vsi, mt, std::auto_ptr<e::buffer>(), up, status, err);
+    assert(handled);
+
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+    // the REQ_CHANGES_START reply always comes before any next is sent
+    stream* s = &m_streams[vsi];
+
+    if (s->in_flight > 0)
+    {
+        --s->in_flight;
+    }
+
+    if (mt == RESP_SEARCH_DONE)
+    {
+        // a next that crossed the last batch in flight finds the stream gone;
+        // otherwise the server lost the stream part way through
+        if (!s->done)
+        {
+            PENDING_ERROR(RECONFIGURE) << "server " << vsi << " no longer has this change stream";
+            s->done = true;
+            m_yield = true;
+        }
+        else if (changes_done())
+        {
+            m_yield = true;
+            m_done = true;
+        }
+
+        return true;
+    }
+    else if (mt != RESP_CHANGES_BATCH && mt != RESP_CHANGES_COMPRESSED)
+    {
+        PENDING_ERROR(SERVERERROR) << "server " << vsi << " responded to CHANGES with " << mt;
+        s->done = true;
+        m_yield = true;
+        return true;
+    }
+
+    region_id ri = cl->m_config.get_region_id(vsi);
+    e::compat::shared_ptr<e::buffer> backing(msg.release());
+
+    if (mt == RESP_CHANGES_COMPRESSED)
+    {
+        uint32_t raw_size = 0;
+        e::slice compressed;
+        std::vector<char> raw;
+
+        if ((up >> raw_size >> compressed).error() ||
+            !decompress(compressed, raw_size, &raw))
+        {
+            PENDING_ERROR(SERVERERROR) << "communication error: server "
+                                       << vsi << " sent corrupt message="
+                                       << backing->as_slice().hex()
+                                       << " in response to a CHANGES";
+            s->done = true;
+            m_yield = true;
+            return true;
+        }
+
+        // the changes point into the batch, so it replaces the message
+        backing.reset(e::buffer::create(raw.size()));
+        backing->pack_at(0) << e::pack_memmove(&raw[0], raw.size());
+        up = backing->unpack_from(0);
+    }
+    uint8_t done = 0;
+    uint64_t resume = 0;
+    uint32_t num_changes = 0;
+    up = up >> done >> resume >> num_changes;
+    std::list<item> changes;
+    uint64_t bytes = 0;
+
+    for (uint32_t i = 0; !up.error() && i < num_changes; ++i)
+    {
+        uint8_t has_value = 0;
+        e::slice key;
+        uint64_t version = 0;
+        std::vector<e::slice> value;
+        up = up >> has_value >> key >> version;
+
+        if (has_value)
+        {
+            up = up >> value;
+        }
+
+        changes.push_back(item(ri, key, version, !has_value, value, backing));
+        bytes += changes.back().bytes;
+    }
+
+    if (up.error())
+    {
+        PENDING_ERROR(SERVERERROR) << "communication error: server "
+                                   << vsi << " sent corrupt message="
+                                   << backing->as_slice().hex()
+                                   << " in response to a CHANGES";
+        s->done = true;
+        m_yield = true;
+        return true;
+    }
+
+    m_items.splice(m_items.end(), changes);
+    m_buffered += bytes;
+    s->resume = resume;
+    s->has_resume = true;
+
+    if (done)
+    {
+        s->done = true;
+    }
+
+    // keep the next batches in flight while these are consumed
+    if (!refill(cl, vsi, s, status))
+    {
+        PENDING_ERROR(RECONFIGURE) << "could not send CHANGES_NEXT to " << vsi;
+        m_yield = true;
+    }
+    else if (changes_done())
+    {
+        m_yield = true;
+        m_done = true;
+    }
+
+    return true;
+}
+
+bool
+pending_changes :: changes_done()
+{
+    if (!this->aggregation_done())
+    {
+        return false;
+    }
+
+    // with nothing outstanding, a stream not yet done is waiting on m_buffered
+    for (std::map<virtual_server_id, stream>::iterator s = m_streams.begin();
+            s != m_streams.end(); ++s)
+    {
+        if (!s->second.done)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint64_t
+pending_changes :: resume_point()
+{
+    uint64_t resume = m_checkpoint;
+
+    // a region that never said where to resume from starts over from
+    // where this call did
+    for (std::map<virtual_server_id, stream>::iterator s = m_streams.begin();
+            s != m_streams.end(); ++s)
+    {
+        if (s->second.has_resume && s->second.resume < resume)
+        {
+            resume = s->second.resume;
+        }
+    }
+
+    return resume;
+}
+
+bool
+pending_changes :: refill(client* cl, const virtual_server_id& vsi, stream* s,
+                          hyperdex_client_returncode* status)
+{
+    while (!s->done &&
+           s->in_flight < HYPERDEX_CLIENT_SEARCH_PREFETCH &&
+           m_buffered < HYPERDEX_CLIENT_SEARCH_BUFFER_BYTES)
+    {
+        if (!send_next(cl, vsi, status))
+        {
+            s->done = true;
+            return false;
+        }
+
+        ++s->in_flight;
+    }
+
+    return true;
+}
+
+bool
+pending_changes :: send_next(client* cl, const virtual_server_id& vsi,
+                             hyperdex_client_returncode* status)
+{
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+              + sizeof(uint64_t)
+              + 2 * sizeof(uint32_t);
+    std::auto_ptr<e::buffer> smsg(e::buffer::create(sz));
+    smsg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ)
+        << static_cast<uint64_t>(client_visible_id())
+        << static_cast<uint32_t>(HYPERDEX_CLIENT_SEARCH_BATCH_OBJECTS)
+        << static_cast<uint32_t>(HYPERDEX_CLIENT_SEARCH_BATCH_BYTES);
+    return cl->send(REQ_CHANGES_NEXT, vsi, cl->m_next_server_nonce++, smsg, this, status);
+}
+
+pending_changes :: item :: item(const region_id& _ri,
+                                const e::slice& _key,
+                                uint64_t _version,
+                                bool _deleted,
+                                const std::vector<e::slice>& _value,
+                                e::compat::shared_ptr<e::buffer> _backing)
+    : ri(_ri)
+    , key(_key)
+    , version(_version)
+    , deleted(_deleted)
+    , value(_value)
+    , backing(_backing)
+    , bytes(_key.size())
+{
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        bytes += value[i].size();
+    }
+}
+
+pending_changes :: item :: item(const item& other)
+    : ri(other.ri)
+    , key(other.key)
+    , version(other.version)
+    , deleted(other.deleted)
+    , value(other.value)
+    , backing(other.backing)
+    , bytes(other.bytes)
+{
+}
+
+pending_changes :: item :: ~item() throw ()
+{
+}
+
+pending_changes::item&
+pending_changes :: item :: operator = (const item& other)
+{
+    if (this != &other)
+    {
+        ri = other.ri;
+        key = other.key;
+        version = other.version;
+        deleted = other.deleted;
+        value = other.value;
+        backing = other.backing;
+        bytes = other.bytes;
+    }
+
+    return *this;
+}
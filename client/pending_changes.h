@@ -0,0 +1,157 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_client_pending_changes_h_
+#define hyperdex_client_pending_changes_h_
+
+// STL
+#include <list>
+#include <map>
+
+// e
+#include <e/compat.h>
+
+// HyperDex
+#include "namespace.h"
+#include "client/pending_aggregation.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Yields a space's changes since a checkpoint, one change at a time, from one
+// stream per region.  Each region's changes come out in the order they were
+// made; the regions' streams interleave.
+class pending_changes : public pending_aggregation
+{
+    public:
+        pending_changes(client* cl,
+                        uint64_t client_visible_id,
+                        uint64_t checkpoint,
+                        hyperdex_client_returncode* status,
+                        const hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                        uint64_t* version, int* deleted,
+                        uint64_t* resume);
+        virtual ~pending_changes() throw ();
+
+    // return to client
+    public:
+        virtual bool can_yield();
+        virtual bool yield(hyperdex_client_returncode* status, e::error* error);
+
+    // events
+    public:
+        virtual void handle_failure(const server_id& si,
+                                    const virtual_server_id& vsi);
+        virtual bool handle_message(client*,
+                                    const server_id& si,
+                                    const virtual_server_id& vsi,
+                                    network_msgtype mt,
+                                    std::auto_ptr<e::buffer> msg,
+                                    e::unpacker up,
+                                    hyperdex_client_returncode* status,
+                                    e::error* error);
+
+    public:
+        class item;
+
+    // refcount
+    protected:
+        friend class e::intrusive_ptr<pending_changes>;
+
+    // noncopyable
+    private:
+        pending_changes(const pending_changes& other);
+        pending_changes& operator = (const pending_changes& rhs);
+
+    private:
+        // what one region's stream is doing
+        struct stream
+        {
+            stream() : in_flight(0), done(false), resume(0), has_resume(false) {}
+            // REQ_CHANGES_NEXTs awaiting a reply
+            uint32_t in_flight;
+            // the stream has caught up or will not be asked again
+            bool done;
+            // the checkpoint the server says to resume this region from
+            uint64_t resume;
+            bool has_resume;
+        };
+
+    private:
+        bool changes_done();
+        // the checkpoint from which a later call sees every change this one
+        // has not yet yielded
+        uint64_t resume_point();
+        bool refill(client* cl, const virtual_server_id& vsi, stream* s,
+                    hyperdex_client_returncode* status);
+        bool send_next(client* cl, const virtual_server_id& vsi,
+                       hyperdex_client_returncode* status);
+
+    private:
+        client* m_cl;
+        const uint64_t m_checkpoint;
+        const hyperdex_client_attribute** m_attrs;
+        size_t* m_attrs_sz;
+        uint64_t* m_version;
+        int* m_deleted;
+        uint64_t* m_resume;
+        bool m_yield;
+        bool m_done;
+        // changes received in batches but not yet handed to the caller
+        std::list<item> m_items;
+        // bytes of change data in m_items
+        uint64_t m_buffered;
+        std::map<virtual_server_id, stream> m_streams;
+};
+
+class pending_changes :: item
+{
+    public:
+        item(const region_id& ri,
+             const e::slice& key,
+             uint64_t version,
+             bool deleted,
+             const std::vector<e::slice>& value,
+             e::compat::shared_ptr<e::buffer> backing);
+        item(const item&);
+        ~item() throw ();
+
+    public:
+        item& operator = (const item&);
+
+    public:
+        region_id ri;
+        e::slice key;
+        uint64_t version;
+        bool deleted;
+        std::vector<e::slice> value;
+        e::compat::shared_ptr<e::buffer> backing;
+        size_t bytes;
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_client_pending_changes_h_
@@ -41,6 +41,9 @@ pending_get :: pending_get(uint64_t id,
     , m_state(INITIALIZED)
     , m_attrs(attrs)
     , m_attrs_sz(attrs_sz)
+    , m_arena(NULL)
+    , m_fallback_to()
+    , m_fallback()
 {
 }
 
@@ -48,10 +51,18 @@ pending_get :: ~pending_get() throw ()
 {
 }
 
+void
+pending_get :: set_fallback(const virtual_server_id& vsi, std::auto_ptr<e::buffer> msg)
+{
+    m_fallback_to = vsi;
+    m_fallback = msg;
+}
+
 bool
 pending_get :: can_yield()
 {
-    assert(m_state == RECV || m_state == YIELDED);
+    // SENT when a stale relaxed read went back out to the point leader
+    assert(m_state == SENT || m_state == RECV || m_state == YIELDED);
     return m_state == RECV;
 }
 
@@ -155,6 +166,32 @@ pending_get :: handle_message(client* cl,
             PENDING_ERROR(UNAUTHORIZED) << "server " << si
                                         << " denied the request because it is unauthorized";
             return true;
+        case NET_THROTTLED:
+            PENDING_ERROR(THROTTLED) << "server " << si
+                                     << " kept refusing the request because the space is over its quota";
+            return true;
+        case NET_STALE:
+            if (!m_fallback.get())
+            {
+                PENDING_ERROR(SERVERERROR) << "server " << si
+                                           << " reports a plain GET is stale";
+                return true;
+            }
+
+            m_state = INITIALIZED;
+            hyperdex_client_returncode send_status;
+
+            if (!cl->send(REQ_GET, m_fallback_to, cl->m_next_server_nonce++, m_fallback, this, &send_status))
+            {
+                m_state = RECV;
+                PENDING_ERROR(RECONFIGURE) << "could not send " << REQ_GET
+                                           << " to " << m_fallback_to
+                                           << " after " << si << " proved stale";
+            }
+
+            *status = HYPERDEX_CLIENT_SUCCESS;
+            *err = e::error();
+            return true;
         default:
             PENDING_ERROR(SERVERERROR) << "server " << si
                                        << " returned non-sensical returncode"
@@ -180,7 +217,7 @@ pending_get :: handle_message(client* cl,
     if (!value_to_attributes(cl->m_config,
                              cl->m_config.get_region_id(vsi),
                              NULL, 0, value, &op_status, &op_error,
-                             m_attrs, m_attrs_sz, cl->m_convert_types))
+                             m_attrs, m_attrs_sz, cl->m_convert_types, m_arena))
     {
         set_status(op_status);
         set_error(op_error);
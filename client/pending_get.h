@@ -42,6 +42,12 @@ class pending_get : public pending
                     const hyperdex_client_attribute** attrs, size_t* attrs_sz);
         virtual ~pending_get() throw ();
 
+    public:
+        // where to send "msg", a REQ_GET, should a relaxed read prove stale
+        void set_fallback(const virtual_server_id& vsi, std::auto_ptr<e::buffer> msg);
+        // decode the result into "arena" rather than malloc'd memory
+        void set_arena(hyperdex_ds_arena* arena) { m_arena = arena; }
+
     // return to client
     public:
         virtual bool can_yield();
@@ -62,6 +68,10 @@ class pending_get : public pending
                                     hyperdex_client_returncode* status,
                                     e::error* error);
 
+    // refcount
+    protected:
+        friend class e::intrusive_ptr<pending_get>;
+
     // noncopyable
     private:
         pending_get(const pending_get& other);
@@ -71,6 +81,9 @@ class pending_get : public pending
         enum { INITIALIZED, SENT, RECV, YIELDED } m_state;
         const hyperdex_client_attribute** m_attrs;
         size_t* m_attrs_sz;
+        hyperdex_ds_arena* m_arena;
+        virtual_server_id m_fallback_to;
+        std::auto_ptr<e::buffer> m_fallback;
 };
 
 END_HYPERDEX_NAMESPACE
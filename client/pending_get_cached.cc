@@ -0,0 +1,225 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// po6
+#include <po6/time.h>
+
+// HyperDex
+#include "common/network_returncode.h"
+#include "client/client.h"
+#include "client/pending_get_cached.h"
+#include "client/util.h"
+
+using hyperdex::pending_get_cached;
+
+pending_get_cached :: pending_get_cached(uint64_t id,
+                                         hyperdex_client_returncode* status,
+                                         const hyperdex_client_attribute** attrs,
+                                         size_t* attrs_sz,
+                                         const char* space,
+                                         const e::slice& key,
+                                         const read_cache::entry_ptr& cached)
+    : pending(id, status)
+    , m_state(INITIALIZED)
+    , m_attrs(attrs)
+    , m_attrs_sz(attrs_sz)
+    , m_arena(NULL)
+    , m_space(space)
+    , m_key(reinterpret_cast<const char*>(key.data()), key.size())
+    , m_cached(cached)
+{
+}
+
+pending_get_cached :: ~pending_get_cached() throw ()
+{
+}
+
+void
+pending_get_cached :: serve(client* cl)
+{
+    assert(m_state == INITIALIZED);
+    assert(m_cached);
+    m_state = RECV;
+    decode(cl, m_cached->ri, m_cached->value);
+}
+
+bool
+pending_get_cached :: can_yield()
+{
+    return m_state == RECV;
+}
+
+bool
+pending_get_cached :: yield(hyperdex_client_returncode* status, e::error* err)
+{
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+    assert(this->can_yield());
+    m_state = YIELDED;
+    return true;
+}
+
+void
+pending_get_cached :: handle_sent_to(const server_id&,
+                                     const virtual_server_id&)
+{
+    assert(m_state == INITIALIZED);
+    m_state = SENT;
+}
+
+void
+pending_get_cached :: handle_failure(const server_id& si,
+                                     const virtual_server_id& vsi)
+{
+    assert(m_state == SENT);
+    m_state = RECV;
+    PENDING_ERROR(RECONFIGURE) << "reconfiguration affecting "
+                               << vsi << "/" << si;
+}
+
+bool
+pending_get_cached :: handle_message(client* cl,
+                                     const server_id& si,
+                                     const virtual_server_id& vsi,
+                                     network_msgtype mt,
+                                     std::auto_ptr<e::buffer> msg,
+                                     e::unpacker up,
+                                     hyperdex_client_returncode* status,
+                                     e::error* err)
+{
+    m_state = RECV;
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+
+    if (mt != RESP_GET_CACHED)
+    {
+        PENDING_ERROR(SERVERERROR) << "server " << vsi << " responded to GET_CACHED with " << mt;
+        return true;
+    }
+
+    uint16_t response;
+    up = up >> response;
+
+    if (up.error())
+    {
+        PENDING_ERROR(SERVERERROR) << "communication error: server "
+                                   << vsi << " sent corrupt message="
+                                   << msg->as_slice().hex()
+                                   << " in response to a GET_CACHED";
+        return true;
+    }
+
+    e::slice key(m_key.data(), m_key.size());
+    region_id ri(cl->m_config.get_region_id(vsi));
+
+    switch (static_cast<network_returncode>(response))
+    {
+        case NET_SUCCESS:
+            break;
+        case NET_NOTMODIFIED:
+            if (!m_cached)
+            {
+                PENDING_ERROR(SERVERERROR) << "server " << si
+                                           << " reports our copy current, but we have none";
+                return true;
+            }
+
+            m_cached->validated = po6::monotonic_time();
+            decode(cl, ri, m_cached->value);
+            return true;
+        case NET_NOTFOUND:
+            cl->m_read_cache.invalidate(m_space.c_str(), key);
+            set_status(HYPERDEX_CLIENT_NOTFOUND);
+            set_error(e::error());
+            return true;
+        case NET_NOTUS:
+            PENDING_ERROR(RECONFIGURE) << "server " << si
+                                       << " reports that it is no longer reponsible"
+                                       << " for the requested object";
+            return true;
+        case NET_UNAUTHORIZED:
+            PENDING_ERROR(UNAUTHORIZED) << "server " << si
+                                        << " denied the request because it is unauthorized";
+            return true;
+        case NET_SERVERERROR:
+            PENDING_ERROR(SERVERERROR) << "server " << si
+                                       << " reports a server error;"
+                                       << " check its log for details";
+            return true;
+        case NET_BADDIMSPEC:
+        case NET_CMPFAIL:
+        case NET_READONLY:
+        case NET_OVERFLOW:
+        case NET_STALE:
+        default:
+            PENDING_ERROR(SERVERERROR) << "server " << si
+                                       << " returned non-sensical returncode"
+                                       << response;
+            return true;
+    }
+
+    uint64_t version;
+    uint64_t fingerprint;
+    std::vector<e::slice> value;
+    up = up >> version >> fingerprint >> value;
+
+    if (up.error())
+    {
+        PENDING_ERROR(SERVERERROR) << "communication error: server "
+                                   << vsi << " sent corrupt message="
+                                   << msg->as_slice().hex()
+                                   << " in response to a GET_CACHED";
+        return true;
+    }
+
+    // the slices point into msg, which the cache entry now owns
+    read_cache::entry_ptr e(new read_cache::entry(ri, version, fingerprint, msg, value));
+    e->validated = po6::monotonic_time();
+    cl->m_read_cache.insert(m_space.c_str(), key, e);
+    m_cached = e;
+    decode(cl, ri, e->value);
+    return true;
+}
+
+void
+pending_get_cached :: decode(client* cl, const region_id& ri, const std::vector<e::slice>& value)
+{
+    hyperdex_client_returncode op_status;
+    e::error op_error;
+
+    if (!value_to_attributes(cl->m_config, ri,
+                             NULL, 0, value, &op_status, &op_error,
+                             m_attrs, m_attrs_sz, cl->m_convert_types, m_arena))
+    {
+        set_status(op_status);
+        set_error(op_error);
+        return;
+    }
+
+    set_status(HYPERDEX_CLIENT_SUCCESS);
+    set_error(e::error());
+}
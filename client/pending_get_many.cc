@@ -0,0 +1,247 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// HyperDex
+#include "common/network_returncode.h"
+#include "client/client.h"
+#include "client/pending_get_many.h"
+#include "client/util.h"
+
+using hyperdex::pending_get_many;
+
+pending_get_many :: pending_get_many(uint64_t id,
+                                     hyperdex_client_returncode* status,
+                                     size_t keys_sz,
+                                     hyperdex_client_returncode* statuses,
+                                     const hyperdex_client_attribute** attrs,
+                                     size_t* attrs_sz)
+    : pending_aggregation(id, status)
+    , m_keys_sz(keys_sz)
+    , m_statuses(statuses)
+    , m_attrs(attrs)
+    , m_attrs_sz(attrs_sz)
+    , m_batches()
+    , m_done(false)
+{
+    for (size_t i = 0; i < m_keys_sz; ++i)
+    {
+        m_statuses[i] = HYPERDEX_CLIENT_SUCCESS;
+        m_attrs[i] = NULL;
+        m_attrs_sz[i] = 0;
+    }
+
+    set_status(HYPERDEX_CLIENT_SUCCESS);
+    set_error(e::error());
+}
+
+pending_get_many :: ~pending_get_many() throw ()
+{
+}
+
+void
+pending_get_many :: add_batch(const virtual_server_id& vsi,
+                              const std::vector<size_t>& indices)
+{
+    m_batches.push_back(std::make_pair(vsi, indices));
+}
+
+void
+pending_get_many :: set_key_status(size_t idx, hyperdex_client_returncode status)
+{
+    assert(idx < m_keys_sz);
+    m_statuses[idx] = status;
+}
+
+bool
+pending_get_many :: can_yield()
+{
+    return this->aggregation_done() && !m_done;
+}
+
+bool
+pending_get_many :: yield(hyperdex_client_returncode* status, e::error* err)
+{
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+    assert(this->can_yield());
+    m_done = true;
+    return true;
+}
+
+void
+pending_get_many :: handle_failure(const server_id& si,
+                                   const virtual_server_id& vsi)
+{
+    const std::vector<size_t>* batch = batch_for(vsi);
+
+    if (batch)
+    {
+        fail_batch(*batch, HYPERDEX_CLIENT_RECONFIGURE);
+    }
+
+    PENDING_ERROR(RECONFIGURE) << "reconfiguration affecting "
+                               << vsi << "/" << si;
+    return pending_aggregation::handle_failure(si, vsi);
+}
+
+static hyperdex_client_returncode
+key_status(hyperdex::network_returncode rc)
+{
+    switch (rc)
+    {
+        case hyperdex::NET_SUCCESS:
+            return HYPERDEX_CLIENT_SUCCESS;
+        case hyperdex::NET_NOTFOUND:
+            return HYPERDEX_CLIENT_NOTFOUND;
+        case hyperdex::NET_NOTUS:
+            return HYPERDEX_CLIENT_RECONFIGURE;
+        case hyperdex::NET_UNAUTHORIZED:
+            return HYPERDEX_CLIENT_UNAUTHORIZED;
+        case hyperdex::NET_BADDIMSPEC:
+        case hyperdex::NET_READONLY:
+        case hyperdex::NET_SERVERERROR:
+        case hyperdex::NET_CMPFAIL:
+        case hyperdex::NET_OVERFLOW:
+        default:
+            return HYPERDEX_CLIENT_SERVERERROR;
+    }
+}
+
+bool
+pending_get_many :: handle_message(client* cl,
+                                   const server_id& si,
+                                   const virtual_server_id& vsi,
+                                   network_msgtype mt,
+                                   std::auto_ptr<e::buffer> msg,
+                                   e::unpacker up,
+                                   hyperdex_client_returncode* status,
+                                   e::error* err)
+{
+    bool handled = pending_aggregation::handle_message(cl, si, vsi, mt, std::auto_ptr<e::buffer>(), up, status, err);
+    assert(handled);
+
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+    const std::vector<size_t>* batch = batch_for(vsi);
+
+    if (!batch)
+    {
+        PENDING_ERROR(SERVERERROR) << "server " << vsi << " responded to GET_BATCH it was not sent";
+        return true;
+    }
+
+    if (mt != RESP_GET_BATCH)
+    {
+        fail_batch(*batch, HYPERDEX_CLIENT_SERVERERROR);
+        PENDING_ERROR(SERVERERROR) << "server " << vsi << " responded to GET_BATCH with " << mt;
+        return true;
+    }
+
+    uint32_t num_results;
+    up = up >> num_results;
+
+    if (up.error() || num_results != batch->size())
+    {
+        fail_batch(*batch, HYPERDEX_CLIENT_SERVERERROR);
+        PENDING_ERROR(SERVERERROR) << "communication error: server "
+                                   << vsi << " sent corrupt message="
+                                   << msg->as_slice().hex()
+                                   << " in response to a GET_BATCH";
+        return true;
+    }
+
+    region_id ri = cl->m_config.get_region_id(vsi);
+
+    for (size_t i = 0; i < batch->size(); ++i)
+    {
+        const size_t idx = (*batch)[i];
+        uint16_t response;
+        std::vector<e::slice> value;
+        up = up >> response;
+
+        if (!up.error() && response == NET_SUCCESS)
+        {
+            up = up >> value;
+        }
+
+        if (up.error())
+        {
+            std::vector<size_t> rest(batch->begin() + i, batch->end());
+            fail_batch(rest, HYPERDEX_CLIENT_SERVERERROR);
+            PENDING_ERROR(SERVERERROR) << "communication error: server "
+                                       << vsi << " sent corrupt message="
+                                       << msg->as_slice().hex()
+                                       << " in response to a GET_BATCH";
+            return true;
+        }
+
+        m_statuses[idx] = key_status(static_cast<network_returncode>(response));
+
+        if (m_statuses[idx] != HYPERDEX_CLIENT_SUCCESS)
+        {
+            continue;
+        }
+
+        e::error op_error;
+
+        if (!value_to_attributes(cl->m_config, ri,
+                                 NULL, 0, value, &m_statuses[idx], &op_error,
+                                 &m_attrs[idx], &m_attrs_sz[idx], cl->m_convert_types, NULL))
+        {
+            set_error(op_error);
+        }
+    }
+
+    // Don't set the status or error so that errors will carry through.  It was
+    // set to the success state in the constructor
+    return true;
+}
+
+const std::vector<size_t>*
+pending_get_many :: batch_for(const virtual_server_id& vsi)
+{
+    for (size_t i = 0; i < m_batches.size(); ++i)
+    {
+        if (m_batches[i].first == vsi)
+        {
+            return &m_batches[i].second;
+        }
+    }
+
+    return NULL;
+}
+
+void
+pending_get_many :: fail_batch(const std::vector<size_t>& indices,
+                               hyperdex_client_returncode status)
+{
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        assert(indices[i] < m_keys_sz);
+        m_statuses[indices[i]] = status;
+    }
+}
@@ -155,6 +155,10 @@ pending_get_partial :: handle_message(client* cl,
             PENDING_ERROR(UNAUTHORIZED) << "server " << si
                                         << " denied the request because it is unauthorized";
             return true;
+        case NET_THROTTLED:
+            PENDING_ERROR(THROTTLED) << "server " << si
+                                     << " kept refusing the request because the space is over its quota";
+            return true;
         default:
             PENDING_ERROR(SERVERERROR) << "server " << si
                                        << " returned non-sensical returncode"
@@ -187,7 +191,7 @@ pending_get_partial :: handle_message(client* cl,
     if (!value_to_attributes(cl->m_config,
                              cl->m_config.get_region_id(vsi),
                              value, &op_status, &op_error,
-                             m_attrs, m_attrs_sz, cl->m_convert_types))
+                             m_attrs, m_attrs_sz, cl->m_convert_types, NULL))
     {
         set_status(op_status);
         set_error(op_error);
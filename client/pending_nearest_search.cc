@@ -0,0 +1,286 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <string.h>
+
+// STL
+#include <algorithm>
+
+// HyperDex
+#include "common/datatype_float.h"
+#include "common/datatype_int64.h"
+#include "client/client.h"
+#include "client/pending_nearest_search.h"
+#include "client/util.h"
+
+using hyperdex::pending_nearest_search;
+
+pending_nearest_search :: pending_nearest_search(client* cl,
+                                                 uint64_t id,
+                                                 uint64_t limit,
+                                                 uint16_t x_idx, hyperdatatype x_type, double x,
+                                                 uint16_t y_idx, hyperdatatype y_type, double y,
+                                                 hyperdex_client_returncode* status,
+                                                 const hyperdex_client_attribute** attrs,
+                                                 size_t* attrs_sz)
+    : pending_aggregation(id, status)
+    , m_cl(cl)
+    , m_yield(false)
+    , m_ri()
+    , m_limit(limit)
+    , m_x_idx(x_idx)
+    , m_x_type(x_type)
+    , m_x(x)
+    , m_y_idx(y_idx)
+    , m_y_type(y_type)
+    , m_y(y)
+    , m_attrs(attrs)
+    , m_attrs_sz(attrs_sz)
+    , m_items()
+    , m_sorted(false)
+    , m_next(0)
+    , m_finished(false)
+{
+}
+
+pending_nearest_search :: ~pending_nearest_search() throw ()
+{
+}
+
+bool
+pending_nearest_search :: can_yield()
+{
+    return m_yield || (this->aggregation_done() && !m_finished);
+}
+
+bool
+pending_nearest_search :: yield(hyperdex_client_returncode* status, e::error* err)
+{
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+
+    // an error recorded by handle_message or handle_failure
+    if (m_yield)
+    {
+        m_yield = false;
+        return true;
+    }
+
+    assert(this->aggregation_done());
+
+    if (!m_sorted)
+    {
+        std::sort(m_items.begin(), m_items.end());
+
+        if (m_items.size() > m_limit)
+        {
+            m_items.resize(m_limit);
+        }
+
+        m_sorted = true;
+    }
+
+    if (m_next >= m_items.size())
+    {
+        m_finished = true;
+        set_status(HYPERDEX_CLIENT_SEARCHDONE);
+        set_error(e::error());
+        return true;
+    }
+
+    hyperdex_client_returncode op_status;
+    e::error op_error;
+    const item& it(m_items[m_next]);
+    ++m_next;
+
+    if (value_to_attributes(m_cl->m_config, m_ri, it.key.data(), it.key.size(),
+                            it.value, &op_status, &op_error, m_attrs, m_attrs_sz,
+                            m_cl->m_convert_types, NULL))
+    {
+        set_status(HYPERDEX_CLIENT_SUCCESS);
+        set_error(e::error());
+    }
+    else
+    {
+        set_status(op_status);
+        set_error(op_error);
+    }
+
+    return true;
+}
+
+void
+pending_nearest_search :: handle_sent_to(const server_id& si,
+                                         const virtual_server_id& vsi)
+{
+    if (m_ri == region_id())
+    {
+        m_ri = m_cl->m_config.get_region_id(vsi);
+    }
+
+    return pending_aggregation::handle_sent_to(si, vsi);
+}
+
+void
+pending_nearest_search :: handle_failure(const server_id& si,
+                                         const virtual_server_id& vsi)
+{
+    m_yield = true;
+    PENDING_ERROR(RECONFIGURE) << "reconfiguration affecting "
+                               << vsi << "/" << si;
+    return pending_aggregation::handle_failure(si, vsi);
+}
+
+bool
+pending_nearest_search :: handle_message(client* cl,
+                                         const server_id& si,
+                                         const virtual_server_id& vsi,
+                                         network_msgtype mt,
+                                         std::auto_ptr<e::buffer> msg,
+                                         e::unpacker up,
+                                         hyperdex_client_returncode* status,
+                                         e::error* err)
+{
+    bool handled = pending_aggregation::handle_message(cl, si, vsi, mt, std::auto_ptr<e::buffer>(), up, status, err);
+    assert(handled);
+
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+
+    if (mt != RESP_NEAREST_SEARCH)
+    {
+        PENDING_ERROR(SERVERERROR) << "server " << vsi << " responded to NEAREST_SEARCH with " << mt;
+        m_yield = true;
+        return true;
+    }
+
+    uint64_t num_results = 0;
+    up = up >> num_results;
+    e::compat::shared_ptr<e::buffer> backing(msg.release());
+    std::vector<item> results;
+
+    for (uint64_t i = 0; !up.error() && i < num_results; ++i)
+    {
+        e::slice key;
+        std::vector<e::slice> value;
+        up = up >> key >> value;
+
+        if (!up.error() &&
+            (m_x_idx > value.size() || m_y_idx > value.size()))
+        {
+            break;
+        }
+
+        results.push_back(item(distance(value), key, value, backing));
+    }
+
+    if (up.error() || results.size() != num_results)
+    {
+        PENDING_ERROR(SERVERERROR) << "communication error: server "
+                                   << vsi << " sent corrupt message="
+                                   << backing->as_slice().hex()
+                                   << " in response to a NEAREST_SEARCH";
+        m_yield = true;
+        return true;
+    }
+
+    m_items.insert(m_items.end(), results.begin(), results.end());
+    return true;
+}
+
+double
+pending_nearest_search :: distance(const std::vector<e::slice>& value) const
+{
+    double x = m_x_type == HYPERDATATYPE_FLOAT
+             ? datatype_float::unpack(value[m_x_idx - 1])
+             : static_cast<double>(datatype_int64::unpack(value[m_x_idx - 1]));
+    double y = m_y_type == HYPERDATATYPE_FLOAT
+             ? datatype_float::unpack(value[m_y_idx - 1])
+             : static_cast<double>(datatype_int64::unpack(value[m_y_idx - 1]));
+    // the same measure the servers order by, so the merge agrees with them
+    return (x - m_x) * (x - m_x) + (y - m_y) * (y - m_y);
+}
+
+pending_nearest_search :: item :: item()
+    : distance(0)
+    , key()
+    , value()
+    , backing()
+{
+}
+
+pending_nearest_search :: item :: item(double _distance,
+                                       const e::slice& _key,
+                                       const std::vector<e::slice>& _value,
+                                       e::compat::shared_ptr<e::buffer> _backing)
+    : distance(_distance)
+    , key(_key)
+    , value(_value)
+    , backing(_backing)
+{
+}
+
+pending_nearest_search :: item :: item(const item& other)
+    : distance(other.distance)
+    , key(other.key)
+    , value(other.value)
+    , backing(other.backing)
+{
+}
+
+pending_nearest_search :: item :: ~item() throw ()
+{
+}
+
+pending_nearest_search::item&
+pending_nearest_search :: item :: operator = (const item& other)
+{
+    if (this != &other)
+    {
+        distance = other.distance;
+        key = other.key;
+        value = other.value;
+        backing = other.backing;
+    }
+
+    return *this;
+}
+
+bool
+pending_nearest_search :: item :: operator < (const item& rhs) const
+{
+    if (distance != rhs.distance)
+    {
+        return distance < rhs.distance;
+    }
+
+    // ties go to the smaller key, as on the servers
+    int cmp = memcmp(key.data(), rhs.key.data(), std::min(key.size(), rhs.key.size()));
+    return cmp < 0 || (cmp == 0 && key.size() < rhs.key.size());
+}
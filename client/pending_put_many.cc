@@ -0,0 +1,163 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <assert.h>
+
+// HyperDex
+#include "common/network_returncode.h"
+#include "client/pending_put_many.h"
+
+using hyperdex::pending_put_many;
+
+pending_put_many :: pending_put_many(uint64_t id,
+                                     hyperdex_client_returncode* status,
+                                     const e::compat::shared_ptr<progress>& p,
+                                     size_t idx)
+    : pending(id, status)
+    , m_progress(p)
+    , m_idx(idx)
+    , m_finished(false)
+{
+}
+
+pending_put_many :: ~pending_put_many() throw ()
+{
+}
+
+void
+pending_put_many :: finish(hyperdex_client_returncode status)
+{
+    if (m_finished)
+    {
+        return;
+    }
+
+    m_finished = true;
+
+    if (m_idx < m_progress->objects)
+    {
+        m_progress->statuses[m_idx] = status;
+    }
+
+    assert(m_progress->remaining > 0);
+    --m_progress->remaining;
+}
+
+bool
+pending_put_many :: can_yield()
+{
+    return m_finished && m_progress->remaining == 0 && !m_progress->done;
+}
+
+bool
+pending_put_many :: yield(hyperdex_client_returncode* status, e::error* err)
+{
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+    assert(this->can_yield());
+    m_progress->done = true;
+    return true;
+}
+
+void
+pending_put_many :: handle_sent_to(const server_id&,
+                                   const virtual_server_id&)
+{
+}
+
+void
+pending_put_many :: handle_failure(const server_id&,
+                                   const virtual_server_id&)
+{
+    finish(HYPERDEX_CLIENT_RECONFIGURE);
+}
+
+static hyperdex_client_returncode
+object_status(hyperdex::network_returncode rc)
+{
+    switch (rc)
+    {
+        case hyperdex::NET_SUCCESS:
+            return HYPERDEX_CLIENT_SUCCESS;
+        case hyperdex::NET_NOTFOUND:
+            return HYPERDEX_CLIENT_NOTFOUND;
+        case hyperdex::NET_CMPFAIL:
+            return HYPERDEX_CLIENT_CMPFAIL;
+        case hyperdex::NET_NOTUS:
+            return HYPERDEX_CLIENT_RECONFIGURE;
+        case hyperdex::NET_OVERFLOW:
+            return HYPERDEX_CLIENT_OVERFLOW;
+        case hyperdex::NET_READONLY:
+            return HYPERDEX_CLIENT_READONLY;
+        case hyperdex::NET_UNAUTHORIZED:
+            return HYPERDEX_CLIENT_UNAUTHORIZED;
+        case hyperdex::NET_THROTTLED:
+            return HYPERDEX_CLIENT_THROTTLED;
+        case hyperdex::NET_BADDIMSPEC:
+        case hyperdex::NET_SERVERERROR:
+        default:
+            return HYPERDEX_CLIENT_SERVERERROR;
+    }
+}
+
+bool
+pending_put_many :: handle_message(client*,
+                                   const server_id&,
+                                   const virtual_server_id& vsi,
+                                   network_msgtype mt,
+                                   std::auto_ptr<e::buffer> msg,
+                                   e::unpacker up,
+                                   hyperdex_client_returncode* status,
+                                   e::error* err)
+{
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+
+    if (mt != RESP_ATOMIC)
+    {
+        finish(HYPERDEX_CLIENT_SERVERERROR);
+        PENDING_ERROR(SERVERERROR) << "server " << vsi << " responded to ATOMIC with " << mt;
+        return true;
+    }
+
+    uint16_t response;
+    up = up >> response;
+
+    if (up.error())
+    {
+        finish(HYPERDEX_CLIENT_SERVERERROR);
+        PENDING_ERROR(SERVERERROR) << "communication error: server "
+                                   << vsi << " sent corrupt message="
+                                   << msg->as_slice().hex()
+                                   << " in response to an ATOMIC";
+        return true;
+    }
+
+    finish(object_status(static_cast<network_returncode>(response)));
+    return true;
+}
@@ -0,0 +1,106 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_client_pending_put_many_h_
+#define hyperdex_client_pending_put_many_h_
+
+// e
+#include <e/compat.h>
+
+// HyperDex
+#include "namespace.h"
+#include "client/pending.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// One object of a put_many.  Every object travels as its own REQ_ATOMIC so
+// that the daemon treats it like any other put, but all of them share the
+// client-visible id, and only the last one to finish yields.
+class pending_put_many : public pending
+{
+    public:
+        struct progress
+        {
+            progress(size_t o, hyperdex_client_returncode* s)
+                : objects(o), remaining(o + 1), statuses(s), done(false) {}
+            size_t objects;
+            // one more than the objects; put_many itself holds the extra
+            size_t remaining;
+            hyperdex_client_returncode* statuses;
+            bool done;
+        };
+
+    public:
+        pending_put_many(uint64_t client_visible_id,
+                         hyperdex_client_returncode* status,
+                         const e::compat::shared_ptr<progress>& p,
+                         size_t idx);
+        virtual ~pending_put_many() throw ();
+
+    public:
+        // settle the object without sending it anywhere; an idx past the
+        // last object stands for put_many itself
+        void finish(hyperdex_client_returncode status);
+
+    // return to client
+    public:
+        virtual bool can_yield();
+        virtual bool yield(hyperdex_client_returncode* status, e::error* error);
+
+    // events
+    public:
+        virtual void handle_sent_to(const server_id& si,
+                                    const virtual_server_id& vsi);
+        virtual void handle_failure(const server_id& si,
+                                    const virtual_server_id& vsi);
+        virtual bool handle_message(client*,
+                                    const server_id& si,
+                                    const virtual_server_id& vsi,
+                                    network_msgtype mt,
+                                    std::auto_ptr<e::buffer> msg,
+                                    e::unpacker up,
+                                    hyperdex_client_returncode* status,
+                                    e::error* error);
+
+    // refcount
+    protected:
+        friend class e::intrusive_ptr<pending_put_many>;
+
+    // noncopyable
+    private:
+        pending_put_many(const pending_put_many& other);
+        pending_put_many& operator = (const pending_put_many& rhs);
+
+    private:
+        e::compat::shared_ptr<progress> m_progress;
+        size_t m_idx;
+        bool m_finished;
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_client_pending_put_many_h_
@@ -0,0 +1,396 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// HyperDex
+#include "common/auth_wallet.h"
+#include "common/network_returncode.h"
+#include "client/client.h"
+#include "client/constants.h"
+#include "client/pending_read_transaction.h"
+#include "client/util.h"
+
+using hyperdex::pending_read_transaction;
+
+pending_read_transaction :: pending_read_transaction(uint64_t id,
+                                                     hyperdex_client_returncode* status,
+                                                     const std::vector<e::slice>& keys,
+                                                     hyperdex_client_returncode* statuses,
+                                                     const hyperdex_client_attribute** attrs,
+                                                     size_t* attrs_sz)
+    : pending_aggregation(id, status)
+    , m_keys()
+    , m_statuses(statuses)
+    , m_attrs(attrs)
+    , m_attrs_sz(attrs_sz)
+    , m_batches()
+    , m_reads(keys.size())
+    , m_validating(false)
+    , m_consistent(true)
+    , m_attempts(0)
+    , m_finished(false)
+    , m_done(false)
+{
+    m_keys.reserve(keys.size());
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        m_keys.push_back(std::string(keys[i].cdata(), keys[i].size()));
+        m_statuses[i] = HYPERDEX_CLIENT_SUCCESS;
+        m_attrs[i] = NULL;
+        m_attrs_sz[i] = 0;
+    }
+
+    set_status(HYPERDEX_CLIENT_SUCCESS);
+    set_error(e::error());
+}
+
+pending_read_transaction :: ~pending_read_transaction() throw ()
+{
+}
+
+void
+pending_read_transaction :: add_batch(const virtual_server_id& vsi,
+                                      const std::vector<size_t>& indices)
+{
+    m_batches.push_back(batch(vsi, indices));
+}
+
+void
+pending_read_transaction :: set_key_status(size_t idx, hyperdex_client_returncode status)
+{
+    assert(idx < m_keys.size());
+    m_statuses[idx] = status;
+}
+
+bool
+pending_read_transaction :: start(client* cl, hyperdex_client_returncode* status)
+{
+    if (m_batches.empty())
+    {
+        m_finished = true;
+        return true;
+    }
+
+    return send_round(cl, true, status);
+}
+
+bool
+pending_read_transaction :: can_yield()
+{
+    return this->aggregation_done() && m_finished && !m_done;
+}
+
+bool
+pending_read_transaction :: yield(hyperdex_client_returncode* status, e::error* err)
+{
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+    assert(this->can_yield());
+    m_done = true;
+    return true;
+}
+
+void
+pending_read_transaction :: handle_failure(const server_id& si,
+                                           const virtual_server_id& vsi)
+{
+    if (!m_finished)
+    {
+        fail(HYPERDEX_CLIENT_RECONFIGURE);
+        PENDING_ERROR(RECONFIGURE) << "reconfiguration affecting "
+                                   << vsi << "/" << si;
+    }
+
+    return pending_aggregation::handle_failure(si, vsi);
+}
+
+static hyperdex_client_returncode
+key_status(hyperdex::network_returncode rc)
+{
+    switch (rc)
+    {
+        case hyperdex::NET_SUCCESS:
+            return HYPERDEX_CLIENT_SUCCESS;
+        case hyperdex::NET_NOTFOUND:
+            return HYPERDEX_CLIENT_NOTFOUND;
+        case hyperdex::NET_NOTUS:
+            return HYPERDEX_CLIENT_RECONFIGURE;
+        case hyperdex::NET_UNAUTHORIZED:
+            return HYPERDEX_CLIENT_UNAUTHORIZED;
+        case hyperdex::NET_BADDIMSPEC:
+        case hyperdex::NET_READONLY:
+        case hyperdex::NET_SERVERERROR:
+        case hyperdex::NET_CMPFAIL:
+        case hyperdex::NET_OVERFLOW:
+        default:
+            return HYPERDEX_CLIENT_SERVERERROR;
+    }
+}
+
+bool
+pending_read_transaction :: handle_message(client* cl,
+                                           const server_id& si,
+                                           const virtual_server_id& vsi,
+                                           network_msgtype mt,
+                                           std::auto_ptr<e::buffer> msg,
+                                           e::unpacker up,
+                                           hyperdex_client_returncode* status,
+                                           e::error* err)
+{
+    bool handled = pending_aggregation::handle_message(cl, si, vsi, mt, std::auto_ptr<e::buffer>(), up, status, err);
+    assert(handled);
+
+    *status = HYPERDEX_CLIENT_SUCCESS;
+    *err = e::error();
+
+    // the rest of a round that has already failed
+    if (m_finished)
+    {
+        return true;
+    }
+
+    batch* b = batch_for(vsi);
+
+    if (!b)
+    {
+        fail(HYPERDEX_CLIENT_SERVERERROR);
+        PENDING_ERROR(SERVERERROR) << "server " << vsi << " responded to GET_VERSIONED it was not sent";
+        return true;
+    }
+
+    if (mt != RESP_GET_VERSIONED)
+    {
+        fail(HYPERDEX_CLIENT_SERVERERROR);
+        PENDING_ERROR(SERVERERROR) << "server " << vsi << " responded to GET_VERSIONED with " << mt;
+        return true;
+    }
+
+    e::compat::shared_ptr<e::buffer> backing(msg.release());
+    uint64_t before;
+    uint64_t after;
+    uint32_t num_results;
+    up = up >> before >> after >> num_results;
+
+    for (size_t i = 0; !up.error() && i < b->indices.size() && num_results == b->indices.size(); ++i)
+    {
+        const size_t idx = b->indices[i];
+        uint16_t result;
+        uint64_t version;
+        uint8_t busy;
+        std::vector<e::slice> value;
+        up = up >> result >> version >> busy;
+
+        if (!m_validating && !up.error() && result == NET_SUCCESS)
+        {
+            up = up >> value;
+        }
+
+        if (up.error())
+        {
+            break;
+        }
+
+        // a write in flight may land between the rounds unseen
+        if (busy)
+        {
+            m_consistent = false;
+        }
+
+        if (!m_validating)
+        {
+            m_reads[idx].result = result;
+            m_reads[idx].version = version;
+            m_reads[idx].value.swap(value);
+            m_reads[idx].backing = backing;
+        }
+        else if (result != m_reads[idx].result ||
+                 version != m_reads[idx].version ||
+                 (result == NET_NOTFOUND && after != b->before))
+        {
+            m_consistent = false;
+        }
+    }
+
+    if (up.error() || num_results != b->indices.size())
+    {
+        fail(HYPERDEX_CLIENT_SERVERERROR);
+        PENDING_ERROR(SERVERERROR) << "communication error: server "
+                                   << vsi << " sent corrupt message="
+                                   << backing->as_slice().hex()
+                                   << " in response to a GET_VERSIONED";
+        return true;
+    }
+
+    if (!m_validating)
+    {
+        b->before = before;
+    }
+
+    if (this->aggregation_done())
+    {
+        next_round(cl);
+    }
+
+    return true;
+}
+
+pending_read_transaction::batch*
+pending_read_transaction :: batch_for(const virtual_server_id& vsi)
+{
+    for (size_t i = 0; i < m_batches.size(); ++i)
+    {
+        if (m_batches[i].vsi == vsi)
+        {
+            return &m_batches[i];
+        }
+    }
+
+    return NULL;
+}
+
+bool
+pending_read_transaction :: send_round(client* cl, bool with_values,
+                                       hyperdex_client_returncode* status)
+{
+    m_validating = !with_values;
+    m_consistent = true;
+    auth_wallet aw(cl->m_macaroons, cl->m_macaroons_sz);
+    const uint8_t flag = with_values ? 1 : 0;
+
+    for (size_t i = 0; i < m_batches.size(); ++i)
+    {
+        std::vector<e::slice> keys;
+        keys.reserve(m_batches[i].indices.size());
+
+        for (size_t j = 0; j < m_batches[i].indices.size(); ++j)
+        {
+            keys.push_back(e::slice(m_keys[m_batches[i].indices[j]]));
+        }
+
+        size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+                  + sizeof(uint8_t)
+                  + pack_size(keys);
+
+        if (cl->m_macaroons_sz)
+        {
+            sz += pack_size(aw);
+        }
+
+        std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+        e::packer pa = msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << flag << keys;
+
+        if (cl->m_macaroons_sz)
+        {
+            pa = pa << aw;
+        }
+
+        if (!cl->send(REQ_GET_VERSIONED, m_batches[i].vsi, cl->m_next_server_nonce++, msg, this, status))
+        {
+            fail(HYPERDEX_CLIENT_RECONFIGURE);
+            PENDING_ERROR(RECONFIGURE) << "could not send GET_VERSIONED to " << m_batches[i].vsi;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+pending_read_transaction :: next_round(client* cl)
+{
+    hyperdex_client_returncode status;
+
+    if (m_consistent && m_validating)
+    {
+        finish(cl);
+    }
+    else if (m_consistent)
+    {
+        send_round(cl, false, &status);
+    }
+    else if (++m_attempts >= HYPERDEX_CLIENT_READ_TRANSACTION_ATTEMPTS)
+    {
+        fail(HYPERDEX_CLIENT_CMPFAIL);
+        PENDING_ERROR(CMPFAIL) << "the keys kept changing; gave up on reading them consistently after "
+                               << m_attempts << " attempts";
+    }
+    else
+    {
+        send_round(cl, true, &status);
+    }
+}
+
+void
+pending_read_transaction :: finish(client* cl)
+{
+    m_finished = true;
+
+    for (size_t i = 0; i < m_batches.size(); ++i)
+    {
+        region_id ri = cl->m_config.get_region_id(m_batches[i].vsi);
+
+        for (size_t j = 0; j < m_batches[i].indices.size(); ++j)
+        {
+            const size_t idx = m_batches[i].indices[j];
+            read* r = &m_reads[idx];
+            m_statuses[idx] = key_status(static_cast<network_returncode>(r->result));
+
+            if (m_statuses[idx] != HYPERDEX_CLIENT_SUCCESS)
+            {
+                continue;
+            }
+
+            e::error op_error;
+
+            if (!value_to_attributes(cl->m_config, ri,
+                                     NULL, 0, r->value, &m_statuses[idx], &op_error,
+                                     &m_attrs[idx], &m_attrs_sz[idx], cl->m_convert_types, NULL))
+            {
+                set_error(op_error);
+            }
+        }
+    }
+
+    // the values now live in the caller's attributes
+    m_reads.clear();
+}
+
+void
+pending_read_transaction :: fail(hyperdex_client_returncode status)
+{
+    m_finished = true;
+
+    for (size_t i = 0; i < m_batches.size(); ++i)
+    {
+        for (size_t j = 0; j < m_batches[i].indices.size(); ++j)
+        {
+            m_statuses[m_batches[i].indices[j]] = status;
+        }
+    }
+
+    m_reads.clear();
+}
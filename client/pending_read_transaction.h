@@ -0,0 +1,143 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_client_pending_read_transaction_h_
+#define hyperdex_client_pending_read_transaction_h_
+
+// STL
+#include <string>
+#include <vector>
+
+// e
+#include <e/compat.h>
+
+// HyperDex
+#include "namespace.h"
+#include "client/pending_aggregation.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Reads several keys as of one point in time, without locking them.  Each
+// attempt reads every key with its version, then asks the servers again for
+// the versions alone; if no key changed, and no region that lacked a key
+// sequenced a write, the first reads were all true at once between the two
+// rounds.  Otherwise the attempt starts over.
+class pending_read_transaction : public pending_aggregation
+{
+    public:
+        pending_read_transaction(uint64_t client_visible_id,
+                                 hyperdex_client_returncode* status,
+                                 const std::vector<e::slice>& keys,
+                                 hyperdex_client_returncode* statuses,
+                                 const hyperdex_client_attribute** attrs,
+                                 size_t* attrs_sz);
+        virtual ~pending_read_transaction() throw ();
+
+    public:
+        // record that the keys at "indices" are led by vsi
+        void add_batch(const virtual_server_id& vsi,
+                       const std::vector<size_t>& indices);
+        // fail a key without reading it
+        void set_key_status(size_t idx, hyperdex_client_returncode status);
+        // send the first round; false if the transaction failed already
+        bool start(client* cl, hyperdex_client_returncode* status);
+
+    // return to client
+    public:
+        virtual bool can_yield();
+        virtual bool yield(hyperdex_client_returncode* status, e::error* error);
+
+    // events
+    public:
+        virtual void handle_failure(const server_id& si,
+                                    const virtual_server_id& vsi);
+        virtual bool handle_message(client*,
+                                    const server_id& si,
+                                    const virtual_server_id& vsi,
+                                    network_msgtype mt,
+                                    std::auto_ptr<e::buffer> msg,
+                                    e::unpacker up,
+                                    hyperdex_client_returncode* status,
+                                    e::error* error);
+
+    // refcount
+    protected:
+        friend class e::intrusive_ptr<pending_read_transaction>;
+
+    // noncopyable
+    private:
+        pending_read_transaction(const pending_read_transaction& other);
+        pending_read_transaction& operator = (const pending_read_transaction& rhs);
+
+    private:
+        struct batch
+        {
+            batch(const virtual_server_id& v, const std::vector<size_t>& i)
+                : vsi(v), indices(i), before(0) {}
+            virtual_server_id vsi;
+            std::vector<size_t> indices;
+            // the region's count of versions handed out when the reads began
+            uint64_t before;
+        };
+        // what the reading round found for one key
+        struct read
+        {
+            read() : result(0), version(0), value(), backing() {}
+            uint16_t result;
+            uint64_t version;
+            std::vector<e::slice> value;
+            e::compat::shared_ptr<e::buffer> backing;
+        };
+
+    private:
+        batch* batch_for(const virtual_server_id& vsi);
+        bool send_round(client* cl, bool with_values,
+                        hyperdex_client_returncode* status);
+        // a round's replies are all in; start the next round or finish
+        void next_round(client* cl);
+        void finish(client* cl);
+        void fail(hyperdex_client_returncode status);
+
+    private:
+        std::vector<std::string> m_keys;
+        hyperdex_client_returncode* m_statuses;
+        const hyperdex_client_attribute** m_attrs;
+        size_t* m_attrs_sz;
+        std::vector<batch> m_batches;
+        std::vector<read> m_reads;
+        // the round in flight only asks for versions
+        bool m_validating;
+        // nothing in the round in flight has contradicted the reads so far
+        bool m_consistent;
+        unsigned m_attempts;
+        bool m_finished;
+        bool m_done;
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_client_pending_read_transaction_h_
@@ -33,14 +33,23 @@
 
 using hyperdex::pending_search;
 
-pending_search :: pending_search(uint64_t id,
+pending_search :: pending_search(client* cl,
+                                 uint64_t id,
+                                 uint64_t limit,
                                  hyperdex_client_returncode* status,
                                  const hyperdex_client_attribute** attrs, size_t* attrs_sz)
     : pending_aggregation(id, status)
+    , m_cl(cl)
     , m_attrs(attrs)
     , m_attrs_sz(attrs_sz)
+    , m_arena(NULL)
     , m_yield(false)
     , m_done(false)
+    , m_limit(limit)
+    , m_received(0)
+    , m_items()
+    , m_buffered(0)
+    , m_streams()
 {
     *m_attrs = NULL;
     *m_attrs_sz = 0;
@@ -53,7 +62,7 @@ pending_search :: ~pending_search() throw ()
 bool
 pending_search :: can_yield()
 {
-    return m_yield;
+    return m_yield || !m_items.empty();
 }
 
 bool
@@ -61,9 +70,48 @@ pending_search :: yield(hyperdex_client_returncode* status, e::error* err)
 {
     *status = HYPERDEX_CLIENT_SUCCESS;
     *err = e::error();
+
+    // an error that is still pending (m_yield && !m_done) goes out before
+    // any queued objects; SEARCHDONE goes out only after all of them
+    if (!m_items.empty() && (!m_yield || m_done))
+    {
+        item it(m_items.front());
+        m_items.pop_front();
+        m_buffered -= it.bytes;
+
+        // servers held back by m_buffered resume as the caller drains
+        // m_items; asking only now that this object is out of the count
+        // keeps one bigger than the buffer from leaving nothing in flight
+        if (refill_all())
+        {
+            hyperdex_client_returncode op_status;
+            e::error op_error;
+
+            if (value_to_attributes(m_cl->m_config, it.ri,
+                                    it.key.data(), it.key.size(), it.value,
+                                    &op_status, &op_error, m_attrs, m_attrs_sz,
+                                    m_cl->m_convert_types, m_arena))
+            {
+                set_status(HYPERDEX_CLIENT_SUCCESS);
+                set_error(e::error());
+            }
+            else
+            {
+                set_status(op_status);
+                set_error(op_error);
+            }
+
+            return true;
+        }
+
+        // the error from asking goes out first, and this object after it
+        m_items.push_front(it);
+        m_buffered += it.bytes;
+    }
+
     m_yield = false;
 
-    if (this->aggregation_done() && !m_done)
+    if (search_done() && !m_done)
     {
         m_yield = true;
         m_done = true;
@@ -81,6 +129,7 @@ pending_search :: handle_failure(const server_id& si,
                                  const virtual_server_id& vsi)
 {
     m_yield = true;
+    m_streams[vsi].done = true;
     PENDING_ERROR(RECONFIGURE) << "reconfiguration affecting "
                                << vsi << "/" << si;
     return pending_aggregation::handle_failure(si, vsi);
@@ -101,10 +150,19 @@ pending_search :: handle_message(client* cl,
 
     *status = HYPERDEX_CLIENT_SUCCESS;
     *err = e::error();
+    // the REQ_SEARCH_START reply always comes before any next is sent
+    stream* s = &m_streams[vsi];
+
+    if (s->in_flight > 0)
+    {
+        --s->in_flight;
+    }
 
     if (mt == RESP_SEARCH_DONE)
     {
-        if (this->aggregation_done())
+        s->done = true;
+
+        if (search_done())
         {
             m_yield = true;
             m_done = true;
@@ -112,53 +170,228 @@ pending_search :: handle_message(client* cl,
 
         return true;
     }
-    else if (mt != RESP_SEARCH_ITEM)
+    else if (mt != RESP_SEARCH_ITEM && mt != RESP_SEARCH_BATCH)
     {
         PENDING_ERROR(SERVERERROR) << "server " << vsi << " responded to SEARCH with " << mt;
+        s->done = true;
         m_yield = true;
         return true;
     }
 
-    e::slice key;
-    std::vector<e::slice> value;
-    up = up >> key >> value;
+    region_id ri = cl->m_config.get_region_id(vsi);
+    e::compat::shared_ptr<e::buffer> backing(msg.release());
+    uint8_t done = 0;
+    uint32_t num_objects = 1;
+
+    // servers that predate batching send one RESP_SEARCH_ITEM at a time
+    if (mt == RESP_SEARCH_BATCH)
+    {
+        up = up >> done >> num_objects;
+    }
+
+    std::list<item> objects;
+    uint64_t bytes = 0;
+
+    for (uint32_t i = 0; !up.error() && i < num_objects; ++i)
+    {
+        e::slice key;
+        std::vector<e::slice> value;
+        up = up >> key >> value;
+
+        // other servers' batches may already have filled the limit
+        if (m_limit == 0 || m_received < m_limit)
+        {
+            objects.push_back(item(ri, key, value, backing));
+            bytes += objects.back().bytes;
+            ++m_received;
+        }
+    }
 
     if (up.error())
     {
         PENDING_ERROR(SERVERERROR) << "communication error: server "
                                    << vsi << " sent corrupt message="
-                                   << msg->as_slice().hex()
+                                   << backing->as_slice().hex()
                                    << " in response to a SEARCH";
+        s->done = true;
         m_yield = true;
         return true;
     }
 
-    hyperdex_client_returncode op_status;
-    e::error op_error;
+    m_items.splice(m_items.end(), objects);
+    m_buffered += bytes;
 
-    if (!value_to_attributes(cl->m_config,
-                             cl->m_config.get_region_id(vsi),
-                             key.data(), key.size(), value,
-                             &op_status, &op_error, m_attrs, m_attrs_sz, cl->m_convert_types))
+    // once the limit is met, servers still searching can forget the search
+    if (!done && !s->done && m_limit > 0 && m_received >= m_limit)
     {
-        set_status(op_status);
-        set_error(op_error);
-        m_yield = true;
-        return true;
+        send_stop(cl, vsi);
+        done = 1;
     }
 
-    std::auto_ptr<e::buffer> smsg(e::buffer::create(HYPERDEX_CLIENT_HEADER_SIZE_REQ + sizeof(uint64_t)));
-    smsg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << static_cast<uint64_t>(client_visible_id());
+    // as can those held back by m_buffered, which would otherwise never reply
+    if (m_limit > 0 && m_received >= m_limit)
+    {
+        for (std::map<virtual_server_id, stream>::iterator p = m_streams.begin();
+                p != m_streams.end(); ++p)
+        {
+            if (!p->second.done && p->second.in_flight == 0 && &p->second != s)
+            {
+                send_stop(cl, p->first);
+                p->second.done = true;
+            }
+        }
+    }
 
-    if (!cl->send(REQ_SEARCH_NEXT, vsi, cl->m_next_server_nonce++, smsg, this, status))
+    if (done)
+    {
+        s->done = true;
+    }
+
+    // keep the next batches in flight while these are consumed
+    if (!refill(cl, vsi, s, status))
     {
         PENDING_ERROR(RECONFIGURE) << "could not send SEARCH_NEXT to " << vsi;
         m_yield = true;
-        return true;
+    }
+    else if (search_done())
+    {
+        m_yield = true;
+        m_done = true;
+    }
+
+    return true;
+}
+
+bool
+pending_search :: search_done()
+{
+    if (!this->aggregation_done())
+    {
+        return false;
+    }
+
+    // with nothing outstanding, a server not yet done is waiting on m_buffered
+    for (std::map<virtual_server_id, stream>::iterator s = m_streams.begin();
+            s != m_streams.end(); ++s)
+    {
+        if (!s->second.done)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+pending_search :: refill_all()
+{
+    bool ret = true;
+
+    for (std::map<virtual_server_id, stream>::iterator s = m_streams.begin();
+            s != m_streams.end(); ++s)
+    {
+        hyperdex_client_returncode op_status;
+
+        if (!refill(m_cl, s->first, &s->second, &op_status))
+        {
+            PENDING_ERROR(RECONFIGURE) << "could not send SEARCH_NEXT to " << s->first;
+            m_yield = true;
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
+bool
+pending_search :: refill(client* cl, const virtual_server_id& vsi, stream* s,
+                         hyperdex_client_returncode* status)
+{
+    // whatever m_buffered says, a search the caller has drained keeps one
+    // request outstanding, as nothing else would ever ask again
+    while (!s->done &&
+           s->in_flight < HYPERDEX_CLIENT_SEARCH_PREFETCH &&
+           (m_buffered < HYPERDEX_CLIENT_SEARCH_BUFFER_BYTES ||
+            (m_items.empty() && s->in_flight == 0)))
+    {
+        if (!send_next(cl, vsi, status))
+        {
+            s->done = true;
+            return false;
+        }
+
+        ++s->in_flight;
     }
 
-    set_status(HYPERDEX_CLIENT_SUCCESS);
-    set_error(e::error());
-    m_yield = true;
     return true;
 }
+
+bool
+pending_search :: send_next(client* cl, const virtual_server_id& vsi,
+                            hyperdex_client_returncode* status)
+{
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ
+              + sizeof(uint64_t)
+              + 2 * sizeof(uint32_t);
+    std::auto_ptr<e::buffer> smsg(e::buffer::create(sz));
+    smsg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ)
+        << static_cast<uint64_t>(client_visible_id())
+        << static_cast<uint32_t>(HYPERDEX_CLIENT_SEARCH_BATCH_OBJECTS)
+        << static_cast<uint32_t>(HYPERDEX_CLIENT_SEARCH_BATCH_BYTES);
+    return cl->send(REQ_SEARCH_NEXT, vsi, cl->m_next_server_nonce++, smsg, this, status);
+}
+
+void
+pending_search :: send_stop(client* cl, const virtual_server_id& vsi)
+{
+    size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ + sizeof(uint64_t);
+    std::auto_ptr<e::buffer> smsg(e::buffer::create(sz));
+    smsg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ)
+        << static_cast<uint64_t>(client_visible_id());
+    cl->send_no_reply(REQ_SEARCH_STOP, vsi, smsg);
+}
+
+pending_search :: item :: item(const region_id& _ri,
+                               const e::slice& _key,
+                               const std::vector<e::slice>& _value,
+                               e::compat::shared_ptr<e::buffer> _backing)
+    : ri(_ri)
+    , key(_key)
+    , value(_value)
+    , backing(_backing)
+    , bytes(_key.size())
+{
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        bytes += value[i].size();
+    }
+}
+
+pending_search :: item :: item(const item& other)
+    : ri(other.ri)
+    , key(other.key)
+    , value(other.value)
+    , backing(other.backing)
+    , bytes(other.bytes)
+{
+}
+
+pending_search :: item :: ~item() throw ()
+{
+}
+
+pending_search::item&
+pending_search :: item :: operator = (const item& other)
+{
+    if (this != &other)
+    {
+        ri = other.ri;
+        key = other.key;
+        value = other.value;
+        backing = other.backing;
+        bytes = other.bytes;
+    }
+
+    return *this;
+}
@@ -28,6 +28,13 @@
 #ifndef hyperdex_client_pending_search_h_
 #define hyperdex_client_pending_search_h_
 
+// STL
+#include <list>
+#include <map>
+
+// e
+#include <e/compat.h>
+
 // HyperDex
 #include "namespace.h"
 #include "client/pending_aggregation.h"
@@ -37,11 +44,17 @@ BEGIN_HYPERDEX_NAMESPACE
 class pending_search : public pending_aggregation
 {
     public:
-        pending_search(uint64_t client_visible_id,
+        pending_search(client* cl,
+                       uint64_t client_visible_id,
+                       uint64_t limit,
                        hyperdex_client_returncode* status,
                        const hyperdex_client_attribute** attrs, size_t* attrs_sz);
         virtual ~pending_search() throw ();
 
+    public:
+        // decode results into "arena" rather than malloc'd memory
+        void set_arena(hyperdex_ds_arena* arena) { m_arena = arena; }
+
     // return to client
     public:
         virtual bool can_yield();
@@ -60,16 +73,75 @@ class pending_search : public pending_aggregation
                                     hyperdex_client_returncode* status,
                                     e::error* error);
 
+    public:
+        class item;
+
+    // refcount
+    protected:
+        friend class e::intrusive_ptr<pending_search>;
+
     // noncopyable
     private:
         pending_search(const pending_search& other);
         pending_search& operator = (const pending_search& rhs);
 
     private:
+        // what one server's part of the search is doing
+        struct stream
+        {
+            stream() : in_flight(0), done(false) {}
+            // REQ_SEARCH_NEXTs awaiting a reply
+            uint32_t in_flight;
+            // the server has nothing more or will not be asked again
+            bool done;
+        };
+
+    private:
+        bool search_done();
+        // refill every stream; false, with the error pending, if any failed
+        bool refill_all();
+        bool refill(client* cl, const virtual_server_id& vsi, stream* s,
+                    hyperdex_client_returncode* status);
+        bool send_next(client* cl, const virtual_server_id& vsi,
+                       hyperdex_client_returncode* status);
+        void send_stop(client* cl, const virtual_server_id& vsi);
+
+    private:
+        client* m_cl;
         const hyperdex_client_attribute** m_attrs;
         size_t* m_attrs_sz;
+        hyperdex_ds_arena* m_arena;
         bool m_yield;
         bool m_done;
+        // zero means every match; otherwise objects past m_limit are dropped
+        const uint64_t m_limit;
+        uint64_t m_received;
+        // objects received in batches but not yet handed to the caller
+        std::list<item> m_items;
+        // bytes of object data in m_items
+        uint64_t m_buffered;
+        std::map<virtual_server_id, stream> m_streams;
+};
+
+class pending_search :: item
+{
+    public:
+        item(const region_id& ri,
+             const e::slice& key,
+             const std::vector<e::slice>& value,
+             e::compat::shared_ptr<e::buffer> backing);
+        item(const item&);
+        ~item() throw ();
+
+    public:
+        item& operator = (const item&);
+
+    public:
+        region_id ri;
+        e::slice key;
+        std::vector<e::slice> value;
+        e::compat::shared_ptr<e::buffer> backing;
+        size_t bytes;
 };
 
 END_HYPERDEX_NAMESPACE
@@ -30,12 +30,73 @@
 
 // HyperDex
 #include "client/client.h"
+#include "client/constants.h"
 #include "client/pending_sorted_search.h"
 #include "client/util.h"
 
 using hyperdex::datatype_info;
 using hyperdex::pending_sorted_search;
 
+namespace
+{
+
+class sorted_search_comparator
+{
+    public:
+        sorted_search_comparator(bool maximize,
+                                 uint16_t sort_by_idx,
+                                 datatype_info* sort_by_di);
+
+    public:
+        bool operator () (const pending_sorted_search::item& lhs,
+                          const pending_sorted_search::item& rhs);
+
+    private:
+        bool m_maximize;
+        uint16_t m_sort_by_idx;
+        datatype_info* m_sort_by_di;
+};
+
+} // namespace
+
+sorted_search_comparator :: sorted_search_comparator(bool maximize,
+                                                     uint16_t sort_by_idx,
+                                                     datatype_info* sort_by_di)
+    : m_maximize(maximize)
+    , m_sort_by_idx(sort_by_idx)
+    , m_sort_by_di(sort_by_di)
+{
+}
+
+bool
+sorted_search_comparator :: operator () (const pending_sorted_search::item& lhs,
+                                         const pending_sorted_search::item& rhs)
+{
+    if (m_sort_by_idx > lhs.value.size() ||
+        m_sort_by_idx > rhs.value.size() ||
+        lhs.value.size() != rhs.value.size())
+    {
+        return false;
+    }
+
+    e::slice lhs_attr;
+    e::slice rhs_attr;
+
+    if (m_sort_by_idx == 0)
+    {
+        lhs_attr = lhs.key;
+        rhs_attr = rhs.key;
+    }
+    else
+    {
+        lhs_attr = lhs.value[m_sort_by_idx - 1];
+        rhs_attr = rhs.value[m_sort_by_idx - 1];
+    }
+
+    int cmp = m_sort_by_di->compare(lhs_attr, rhs_attr);
+    return m_maximize ? (cmp > 0) : (cmp < 0);
+}
+
 pending_sorted_search :: pending_sorted_search(client* cl,
                                                uint64_t id,
                                                bool maximize,
@@ -44,7 +105,9 @@ pending_sorted_search :: pending_sorted_search(client* cl,
                                                datatype_info* sort_by_di,
                                                hyperdex_client_returncode* status,
                                                const hyperdex_client_attribute** attrs,
-                                               size_t* attrs_sz)
+                                               size_t* attrs_sz,
+                                               const char** next_cursor,
+                                               size_t* next_cursor_sz)
     : pending_aggregation(id, status)
     , m_cl(cl)
     , m_yield(false)
@@ -55,19 +118,95 @@ pending_sorted_search :: pending_sorted_search(client* cl,
     , m_sort_by_di(sort_by_di)
     , m_attrs(attrs)
     , m_attrs_sz(attrs_sz)
-    , m_results()
-    , m_results_idx()
+    , m_runs()
+    , m_returned(0)
+    , m_refill_failed(false)
+    , m_refill_vsi()
+    , m_finished(false)
+    , m_next_cursor(next_cursor)
+    , m_next_cursor_sz(next_cursor_sz)
+    , m_resume()
+    , m_exhausted()
+    , m_cursor()
 {
+    if (m_next_cursor)
+    {
+        *m_next_cursor = NULL;
+        *m_next_cursor_sz = 0;
+    }
 }
 
 pending_sorted_search :: ~pending_sorted_search() throw ()
 {
 }
 
+bool
+pending_sorted_search :: set_cursor(const char* cursor, size_t cursor_sz)
+{
+    e::unpacker up(cursor, cursor_sz);
+    uint16_t sort_by;
+    uint8_t maximize;
+    uint64_t entries;
+    up = up >> sort_by >> maximize >> entries;
+
+    if (up.error() || sort_by != m_sort_by_idx || (maximize != 0) != m_maximize)
+    {
+        return false;
+    }
+
+    for (uint64_t i = 0; i < entries; ++i)
+    {
+        region_id ri;
+        uint8_t exhausted;
+        e::slice attr;
+        e::slice key;
+        up = up >> ri >> exhausted >> attr >> key;
+
+        if (up.error())
+        {
+            return false;
+        }
+
+        if (exhausted)
+        {
+            m_exhausted.insert(ri);
+        }
+        else
+        {
+            m_resume[ri] = std::make_pair(attr.str(), key.str());
+        }
+    }
+
+    return !up.error() && up.remain() == 0;
+}
+
+bool
+pending_sorted_search :: resume_point(const region_id& ri, bool* has_cursor,
+                                      e::slice* attr, e::slice* key)
+{
+    if (m_exhausted.find(ri) != m_exhausted.end())
+    {
+        return false;
+    }
+
+    std::map<region_id, std::pair<std::string, std::string> >::iterator it;
+    it = m_resume.find(ri);
+    *has_cursor = it != m_resume.end();
+
+    if (*has_cursor)
+    {
+        *attr = e::slice(it->second.first);
+        *key = e::slice(it->second.second);
+    }
+
+    return true;
+}
+
 bool
 pending_sorted_search :: can_yield()
 {
-    return m_yield;
+    return m_yield || m_refill_failed || mergeable() ||
+           (exhausted() && !m_finished);
 }
 
 bool
@@ -75,33 +214,89 @@ pending_sorted_search :: yield(hyperdex_client_returncode* status, e::error* err
 {
     *status = HYPERDEX_CLIENT_SUCCESS;
     *err = e::error();
-    m_yield = false;
 
-    if (this->aggregation_done() && m_results_idx >= m_results.size())
+    // an error recorded by handle_message or handle_failure
+    if (m_yield)
+    {
+        m_yield = false;
+        return true;
+    }
+
+    if (m_refill_failed)
     {
+        m_refill_failed = false;
+        PENDING_ERROR(RECONFIGURE) << "could not send SORTED_SEARCH_NEXT to " << m_refill_vsi;
+        return true;
+    }
+
+    if (!mergeable())
+    {
+        assert(exhausted());
+        m_finished = true;
+        stop_runs();
+        make_cursor();
         set_status(HYPERDEX_CLIENT_SEARCHDONE);
         set_error(e::error());
         return true;
     }
 
-    m_yield = true;
+    sorted_search_comparator ssc(m_maximize, m_sort_by_idx, m_sort_by_di);
+    run* best = NULL;
+
+    for (size_t i = 0; i < m_runs.size(); ++i)
+    {
+        if (!m_runs[i].items.empty() &&
+            (!best || ssc(m_runs[i].items.front(), best->items.front())))
+        {
+            best = &m_runs[i];
+        }
+    }
 
+    assert(best);
+    ++m_returned;
     hyperdex_client_returncode op_status;
     e::error op_error;
-    const e::slice& key(m_results[m_results_idx].key);
-    const std::vector<e::slice>& value(m_results[m_results_idx].value);
-    ++m_results_idx;
+    const item& it(best->items.front());
 
-    if (!value_to_attributes(m_cl->m_config, m_ri, key.data(), key.size(),
-                             value, &op_status, &op_error, m_attrs, m_attrs_sz, m_cl->m_convert_types))
+    if (value_to_attributes(m_cl->m_config, m_ri, it.key.data(), it.key.size(),
+                            it.value, &op_status, &op_error, m_attrs, m_attrs_sz,
+                            m_cl->m_convert_types, NULL))
+    {
+        set_status(HYPERDEX_CLIENT_SUCCESS);
+        set_error(e::error());
+    }
+    else
     {
         set_status(op_status);
         set_error(op_error);
-        return true;
     }
 
-    set_status(HYPERDEX_CLIENT_SUCCESS);
-    set_error(e::error());
+    best->last = best->items.front();
+    best->has_last = true;
+    best->items.pop_front();
+
+    // ask for more of this run now, because the merge cannot pass it
+    if (best->items.empty() && !best->done && m_returned < m_limit)
+    {
+        size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ + sizeof(uint64_t);
+        std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+        msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ)
+            << static_cast<uint64_t>(client_visible_id());
+        hyperdex_client_returncode send_status;
+
+        if (m_cl->send(REQ_SORTED_SEARCH_NEXT, best->vsi, m_cl->m_next_server_nonce++,
+                       msg, this, &send_status))
+        {
+            best->requested = true;
+        }
+        else
+        {
+            best->done = true;
+            m_refill_failed = true;
+            m_refill_vsi = best->vsi;
+        }
+    }
+
     return true;
 }
 
@@ -114,6 +309,12 @@ pending_sorted_search :: handle_sent_to(const server_id& si,
         m_ri = m_cl->m_config.get_region_id(vsi);
     }
 
+    if (!find_run(vsi))
+    {
+        m_runs.push_back(run(si, vsi, m_cl->m_config.get_region_id(vsi)));
+    }
+
+    find_run(vsi)->requested = true;
     return pending_aggregation::handle_sent_to(si, vsi);
 }
 
@@ -121,70 +322,18 @@ void
 pending_sorted_search :: handle_failure(const server_id& si,
                                         const virtual_server_id& vsi)
 {
-    m_yield = true;
-    PENDING_ERROR(RECONFIGURE) << "reconfiguration affecting "
-                               << vsi << "/" << si;
-    return pending_aggregation::handle_failure(si, vsi);
-}
-
-namespace
-{
-
-class sorted_search_comparator
-{
-    public:
-        sorted_search_comparator(bool maximize,
-                                 uint16_t sort_by_idx,
-                                 datatype_info* sort_by_di);
+    run* r = find_run(vsi);
 
-    public:
-        bool operator () (const pending_sorted_search::item& lhs,
-                          const pending_sorted_search::item& rhs);
-
-    private:
-        bool m_maximize;
-        uint16_t m_sort_by_idx;
-        datatype_info* m_sort_by_di;
-};
-
-} // namespace
-
-sorted_search_comparator :: sorted_search_comparator(bool maximize,
-                                                     uint16_t sort_by_idx,
-                                                     datatype_info* sort_by_di)
-    : m_maximize(maximize)
-    , m_sort_by_idx(sort_by_idx)
-    , m_sort_by_di(sort_by_di)
-{
-}
-
-bool
-sorted_search_comparator :: operator () (const pending_sorted_search::item& lhs,
-                                         const pending_sorted_search::item& rhs)
-{
-    if (m_sort_by_idx > lhs.value.size() ||
-        m_sort_by_idx > rhs.value.size() ||
-        lhs.value.size() != rhs.value.size())
+    if (r)
     {
-        return false;
+        r->done = true;
+        r->requested = false;
     }
 
-    e::slice lhs_attr;
-    e::slice rhs_attr;
-
-    if (m_sort_by_idx == 0)
-    {
-        lhs_attr = lhs.key;
-        rhs_attr = rhs.key;
-    }
-    else
-    {
-        lhs_attr = lhs.value[m_sort_by_idx - 1];
-        rhs_attr = rhs.value[m_sort_by_idx - 1];
-    }
-
-    int cmp = m_sort_by_di->compare(lhs_attr, rhs_attr);
-    return m_maximize ? (cmp > 0) : (cmp < 0);
+    m_yield = true;
+    PENDING_ERROR(RECONFIGURE) << "reconfiguration affecting "
+                               << vsi << "/" << si;
+    return pending_aggregation::handle_failure(si, vsi);
 }
 
 bool
@@ -202,68 +351,210 @@ pending_sorted_search :: handle_message(client* cl,
 
     *status = HYPERDEX_CLIENT_SUCCESS;
     *err = e::error();
+    run* r = find_run(vsi);
+    assert(r);
+    r->requested = false;
+    // whatever happens below, this server will not be asked again
+    r->done = true;
 
-    if (mt != RESP_SORTED_SEARCH)
+    if (mt != RESP_SORTED_SEARCH && mt != RESP_SORTED_SEARCH_CHUNK)
     {
         PENDING_ERROR(SERVERERROR) << "server " << vsi << " responded to SORTED_SEARCH with " << mt;
         m_yield = true;
         return true;
     }
 
+    uint8_t done = 1;
     uint64_t num_results = 0;
+
+    // servers that predate streaming send their whole run at once
+    if (mt == RESP_SORTED_SEARCH_CHUNK)
+    {
+        up = up >> done;
+    }
+
     up = up >> num_results;
+    e::compat::shared_ptr<e::buffer> backing(msg.release());
+    std::vector<item> results;
+
+    for (uint64_t i = 0; !up.error() && i < num_results; ++i)
+    {
+        e::slice key;
+        std::vector<e::slice> value;
+        up = up >> key >> value;
+        results.push_back(item(key, value, backing));
+    }
 
     if (up.error())
     {
         PENDING_ERROR(SERVERERROR) << "communication error: server "
                                    << vsi << " sent corrupt message="
-                                   << msg->as_slice().hex()
+                                   << backing->as_slice().hex()
                                    << " in response to a SORTED_SEARCH";
         m_yield = true;
         return true;
     }
 
-    sorted_search_comparator ssc(m_maximize, m_sort_by_idx, m_sort_by_di);
-    e::compat::shared_ptr<e::buffer> backing(msg.release());
-
-    for (uint64_t i = 0; i < num_results; ++i)
+    if (mt == RESP_SORTED_SEARCH)
     {
-        e::slice key;
-        std::vector<e::slice> value;
-        up = up >> key >> value;
+        sorted_search_comparator ssc(m_maximize, m_sort_by_idx, m_sort_by_di);
+        std::sort(results.begin(), results.end(), ssc);
+    }
 
-        if (up.error())
+    r->items.insert(r->items.end(), results.begin(), results.end());
+    r->received += results.size();
+    r->done = done != 0;
+    r->complete = r->done;
+    return true;
+}
+
+pending_sorted_search::run*
+pending_sorted_search :: find_run(const virtual_server_id& vsi)
+{
+    for (size_t i = 0; i < m_runs.size(); ++i)
+    {
+        if (m_runs[i].vsi == vsi)
         {
-            PENDING_ERROR(SERVERERROR) << "communication error: server "
-                                       << vsi << " sent corrupt message="
-                                       << msg->as_slice().hex()
-                                       << " in response to a SORTED_SEARCH";
-            m_yield = true;
-            return true;
+            return &m_runs[i];
         }
+    }
 
-        m_results.push_back(item(key, value, backing));
-        std::push_heap(m_results.begin(), m_results.end(), ssc);
+    return NULL;
+}
+
+bool
+pending_sorted_search :: mergeable()
+{
+    if (m_finished || m_returned >= m_limit)
+    {
+        return false;
+    }
 
-        if (m_results.size() > m_limit)
+    bool any = false;
+
+    for (size_t i = 0; i < m_runs.size(); ++i)
+    {
+        if (m_runs[i].items.empty() && !m_runs[i].done)
         {
-            std::pop_heap(m_results.begin(), m_results.end(), ssc);
-            m_results.pop_back();
+            return false;
         }
+
+        any = any || !m_runs[i].items.empty();
     }
 
-    m_yield = this->aggregation_done();
-    set_status(HYPERDEX_CLIENT_SUCCESS);
-    set_error(e::error());
+    return any;
+}
 
-    if (m_yield)
+bool
+pending_sorted_search :: exhausted()
+{
+    if (!this->aggregation_done())
     {
-        std::sort(m_results.begin(), m_results.end(), ssc);
+        return false;
+    }
+
+    if (m_returned >= m_limit)
+    {
+        return true;
+    }
+
+    for (size_t i = 0; i < m_runs.size(); ++i)
+    {
+        if (!m_runs[i].items.empty() || !m_runs[i].done)
+        {
+            return false;
+        }
     }
 
     return true;
 }
 
+void
+pending_sorted_search :: stop_runs()
+{
+    // servers still holding part of a run can forget it
+    for (size_t i = 0; i < m_runs.size(); ++i)
+    {
+        if (m_runs[i].done)
+        {
+            continue;
+        }
+
+        size_t sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ + sizeof(uint64_t);
+        std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+        msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ)
+            << static_cast<uint64_t>(client_visible_id());
+        m_cl->send_no_reply(REQ_SEARCH_STOP, m_runs[i].vsi, msg);
+        m_runs[i].done = true;
+    }
+}
+
+void
+pending_sorted_search :: make_cursor()
+{
+    if (!m_next_cursor)
+    {
+        return;
+    }
+
+    bool remaining = false;
+
+    for (size_t i = 0; i < m_runs.size(); ++i)
+    {
+        const run& r(m_runs[i]);
+
+        // a region is finished only once it sent less than a full page
+        if (r.complete && r.items.empty() && r.received < m_limit)
+        {
+            m_exhausted.insert(r.ri);
+            m_resume.erase(r.ri);
+            continue;
+        }
+
+        remaining = true;
+
+        if (r.has_last)
+        {
+            const e::slice& attr(m_sort_by_idx == 0 || m_sort_by_idx > r.last.value.size()
+                                 ? r.last.key : r.last.value[m_sort_by_idx - 1]);
+            m_resume[r.ri] = std::make_pair(attr.str(), r.last.key.str());
+        }
+    }
+
+    if (!remaining)
+    {
+        return;
+    }
+
+    e::packer pa(&m_cursor);
+    pa = pa << m_sort_by_idx
+            << static_cast<uint8_t>(m_maximize ? 1 : 0)
+            << static_cast<uint64_t>(m_exhausted.size() + m_resume.size());
+
+    for (std::set<region_id>::iterator it = m_exhausted.begin();
+            it != m_exhausted.end(); ++it)
+    {
+        pa = pa << *it << static_cast<uint8_t>(1) << e::slice() << e::slice();
+    }
+
+    for (std::map<region_id, std::pair<std::string, std::string> >::iterator it = m_resume.begin();
+            it != m_resume.end(); ++it)
+    {
+        pa = pa << it->first << static_cast<uint8_t>(0)
+                << e::slice(it->second.first) << e::slice(it->second.second);
+    }
+
+    *m_next_cursor = m_cursor.data();
+    *m_next_cursor_sz = m_cursor.size();
+}
+
+pending_sorted_search :: item :: item()
+    : key()
+    , value()
+    , backing()
+{
+}
+
 pending_sorted_search :: item :: item(const e::slice& _key,
                                       const std::vector<e::slice>& _value,
                                       e::compat::shared_ptr<e::buffer> _backing)
@@ -296,3 +587,57 @@ pending_sorted_search :: item :: operator = (const item& other)
 
     return *this;
 }
+
+pending_sorted_search :: run :: run(const server_id& _si,
+                                    const virtual_server_id& _vsi,
+                                    const region_id& _ri)
+    : si(_si)
+    , vsi(_vsi)
+    , ri(_ri)
+    , items()
+    , done(false)
+    , complete(false)
+    , requested(false)
+    , received(0)
+    , has_last(false)
+    , last()
+{
+}
+
+pending_sorted_search :: run :: run(const run& other)
+    : si(other.si)
+    , vsi(other.vsi)
+    , ri(other.ri)
+    , items(other.items)
+    , done(other.done)
+    , complete(other.complete)
+    , requested(other.requested)
+    , received(other.received)
+    , has_last(other.has_last)
+    , last(other.last)
+{
+}
+
+pending_sorted_search :: run :: ~run() throw ()
+{
+}
+
+pending_sorted_search::run&
+pending_sorted_search :: run :: operator = (const run& other)
+{
+    if (this != &other)
+    {
+        si = other.si;
+        vsi = other.vsi;
+        ri = other.ri;
+        items = other.items;
+        done = other.done;
+        complete = other.complete;
+        requested = other.requested;
+        received = other.received;
+        has_last = other.has_last;
+        last = other.last;
+    }
+
+    return *this;
+}
@@ -28,6 +28,11 @@
 #ifndef hyperdex_client_pending_sorted_search_h_
 #define hyperdex_client_pending_sorted_search_h_
 
+// STL
+#include <deque>
+#include <map>
+#include <set>
+
 // e
 #include <e/compat.h>
 
@@ -49,9 +54,19 @@ class pending_sorted_search : public pending_aggregation
                               datatype_info* sort_by_di,
                               hyperdex_client_returncode* status,
                               const hyperdex_client_attribute** attrs,
-                              size_t* attrs_sz);
+                              size_t* attrs_sz,
+                              const char** next_cursor,
+                              size_t* next_cursor_sz);
         virtual ~pending_sorted_search() throw ();
 
+    // paging
+    public:
+        // resume from the token an earlier page returned
+        bool set_cursor(const char* cursor, size_t cursor_sz);
+        // false if earlier pages finished "ri"; otherwise where to resume it
+        bool resume_point(const region_id& ri, bool* has_cursor,
+                          e::slice* attr, e::slice* key);
+
     // return to client
     public:
         virtual bool can_yield();
@@ -74,12 +89,25 @@ class pending_sorted_search : public pending_aggregation
 
     public:
         class item;
+        class run;
+
+    // refcount
+    protected:
+        friend class e::intrusive_ptr<pending_sorted_search>;
 
     // noncopyable
     private:
         pending_sorted_search(const pending_sorted_search& other);
         pending_sorted_search& operator = (const pending_sorted_search& rhs);
 
+    private:
+        run* find_run(const virtual_server_id& vsi);
+        // every server has contributed its head, so the best is known
+        bool mergeable();
+        bool exhausted();
+        void stop_runs();
+        void make_cursor();
+
     private:
         client* m_cl;
         bool m_yield;
@@ -90,8 +118,18 @@ class pending_sorted_search : public pending_aggregation
         datatype_info* m_sort_by_di;
         const hyperdex_client_attribute** m_attrs;
         size_t* m_attrs_sz;
-        std::vector<item> m_results;
-        size_t m_results_idx;
+        // one sorted run per server, merged as the caller consumes them
+        std::vector<run> m_runs;
+        uint64_t m_returned;
+        bool m_refill_failed;
+        virtual_server_id m_refill_vsi;
+        bool m_finished;
+        // paging state, as (sort attribute, key) of the last object per region
+        const char** m_next_cursor;
+        size_t* m_next_cursor_sz;
+        std::map<region_id, std::pair<std::string, std::string> > m_resume;
+        std::set<region_id> m_exhausted;
+        std::string m_cursor;
 };
 
 class pending_sorted_search :: item
@@ -116,6 +154,33 @@ class pending_sorted_search :: item
         friend class sorted_search_comparator;
 };
 
+class pending_sorted_search :: run
+{
+    public:
+        run(const server_id& si, const virtual_server_id& vsi, const region_id& ri);
+        run(const run&);
+        ~run() throw ();
+
+    public:
+        run& operator = (const run&);
+
+    public:
+        server_id si;
+        virtual_server_id vsi;
+        region_id ri;
+        std::deque<item> items;
+        // the server has sent the last of its run
+        bool done;
+        // ... because it said so, rather than because it failed
+        bool complete;
+        // a request for more of the run is outstanding
+        bool requested;
+        // objects received, and the last one handed to the caller
+        uint64_t received;
+        bool has_last;
+        item last;
+};
+
 END_HYPERDEX_NAMESPACE
 
 #endif // hyperdex_client_pending_sorted_search_h_
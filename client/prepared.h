@@ -0,0 +1,91 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_client_prepared_h_
+#define hyperdex_client_prepared_h_
+
+// STL
+#include <string>
+#include <vector>
+
+// HyperDex
+#include "namespace.h"
+#include "hyperdex.h"
+#include "common/schema.h"
+#include "client/keyop_info.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// A key operation on one space whose checks and attributes are named once.
+// Each execution then supplies only the key and a value for each of them;
+// the names are resolved again only when the configuration changes.
+class prepared
+{
+    public:
+        // a check or an attribute of the operation
+        struct slot
+        {
+            slot() : name(), attr_name(), path(std::string::npos),
+                     datatype(HYPERDATATYPE_GARBAGE),
+                     predicate(HYPERPREDICATE_FAIL), value(0), attr(0) {}
+            // as the caller gave it, perhaps with a document path
+            std::string name;
+            std::string attr_name;
+            // offset of the document path within name, or npos
+            size_t path;
+            hyperdatatype datatype;
+            hyperpredicate predicate;
+            // which of each execution's values this takes
+            size_t value;
+            // resolved against the schema
+            uint16_t attr;
+        };
+
+    public:
+        prepared(const hyperdex_client_keyop_info* opinfo, const char* space);
+        ~prepared() throw ();
+
+    public:
+        const hyperdex_client_keyop_info* const opinfo;
+        const std::string space;
+        // in the order the operation sends them, which resolution sets
+        std::vector<slot> checks;
+        std::vector<slot> funcs;
+        // the schema they were resolved against, valid while the client's
+        // configuration generation is still "generation"
+        const schema* sc;
+        uint64_t generation;
+
+    private:
+        prepared(const prepared&);
+        prepared& operator = (const prepared&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_client_prepared_h_
@@ -0,0 +1,159 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <string.h>
+
+// HyperDex
+#include "client/read_cache.h"
+
+using hyperdex::read_cache;
+
+read_cache :: entry :: entry(const region_id& r, uint64_t v, uint64_t f,
+                             std::auto_ptr<e::buffer> msg,
+                             const std::vector<e::slice>& val)
+    : ri(r)
+    , version(v)
+    , fingerprint(f)
+    , value(val)
+    , validated(0)
+    , m_msg(msg)
+{
+}
+
+read_cache :: entry :: ~entry() throw ()
+{
+}
+
+read_cache :: read_cache()
+    : m_budget(0)
+    , m_fresh_for(0)
+    , m_used(0)
+    , m_entries()
+    , m_lru()
+{
+}
+
+read_cache :: ~read_cache() throw ()
+{
+}
+
+void
+read_cache :: configure(size_t budget, uint64_t fresh_for)
+{
+    m_budget = budget;
+    m_fresh_for = fresh_for;
+    shrink();
+}
+
+read_cache::entry_ptr
+read_cache :: lookup(const char* space, const e::slice& key)
+{
+    entry_map_t::iterator it = m_entries.find(name(space, key));
+
+    if (it == m_entries.end())
+    {
+        return entry_ptr();
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, it->second.second);
+    return it->second.first;
+}
+
+void
+read_cache :: insert(const char* space, const e::slice& key, entry_ptr e)
+{
+    if (e->size() > m_budget)
+    {
+        invalidate(space, key);
+        return;
+    }
+
+    std::string n(name(space, key));
+    entry_map_t::iterator it = m_entries.find(n);
+
+    if (it != m_entries.end())
+    {
+        erase(it);
+    }
+
+    m_lru.push_front(n);
+    m_entries.insert(std::make_pair(n, std::make_pair(e, m_lru.begin())));
+    m_used += e->size();
+    shrink();
+}
+
+void
+read_cache :: invalidate(const char* space, const e::slice& key)
+{
+    if (m_entries.empty())
+    {
+        return;
+    }
+
+    entry_map_t::iterator it = m_entries.find(name(space, key));
+
+    if (it != m_entries.end())
+    {
+        erase(it);
+    }
+}
+
+void
+read_cache :: clear()
+{
+    m_entries.clear();
+    m_lru.clear();
+    m_used = 0;
+}
+
+std::string
+read_cache :: name(const char* space, const e::slice& key)
+{
+    // the space's terminating NUL keeps "ab"/"c" apart from "a"/"bc"
+    std::string n(space, strlen(space) + 1);
+    n.append(reinterpret_cast<const char*>(key.data()), key.size());
+    return n;
+}
+
+void
+read_cache :: erase(entry_map_t::iterator it)
+{
+    m_used -= it->second.first->size();
+    m_lru.erase(it->second.second);
+    m_entries.erase(it);
+}
+
+void
+read_cache :: shrink()
+{
+    while (m_used > m_budget && !m_lru.empty())
+    {
+        entry_map_t::iterator it = m_entries.find(m_lru.back());
+        erase(it);
+    }
+}
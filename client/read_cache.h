@@ -0,0 +1,121 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_client_read_cache_h_
+#define hyperdex_client_read_cache_h_
+
+// C
+#include <stdint.h>
+
+// STL
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// e
+#include <e/buffer.h>
+#include <e/compat.h>
+#include <e/slice.h>
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Objects this client has read, kept with the version the point leader
+// reported so that a later read can ask "has it changed?" instead of
+// fetching the value again.  Entries are evicted least-recently-used first
+// once their messages exceed the budget.
+class read_cache
+{
+    public:
+        class entry
+        {
+            public:
+                entry(const region_id& ri, uint64_t version, uint64_t fingerprint,
+                      std::auto_ptr<e::buffer> msg, const std::vector<e::slice>& value);
+                ~entry() throw ();
+
+            public:
+                const region_id ri;
+                const uint64_t version;
+                const uint64_t fingerprint;
+                // slices of "msg"
+                const std::vector<e::slice> value;
+                // monotonic time the point leader last vouched for it
+                uint64_t validated;
+                size_t size() const { return m_msg->capacity(); }
+
+            private:
+                const std::auto_ptr<e::buffer> m_msg;
+
+            private:
+                entry(const entry&);
+                entry& operator = (const entry&);
+        };
+        typedef e::compat::shared_ptr<entry> entry_ptr;
+
+    public:
+        read_cache();
+        ~read_cache() throw ();
+
+    public:
+        bool enabled() const { return m_budget > 0; }
+        // nanoseconds an entry may be served without asking the server
+        uint64_t fresh_for() const { return m_fresh_for; }
+        void configure(size_t budget, uint64_t fresh_for);
+        entry_ptr lookup(const char* space, const e::slice& key);
+        void insert(const char* space, const e::slice& key, entry_ptr e);
+        void invalidate(const char* space, const e::slice& key);
+        void clear();
+
+    private:
+        typedef std::list<std::string> lru_t;
+        typedef std::map<std::string, std::pair<entry_ptr, lru_t::iterator> > entry_map_t;
+        static std::string name(const char* space, const e::slice& key);
+        void erase(entry_map_t::iterator it);
+        void shrink();
+
+    private:
+        size_t m_budget;
+        uint64_t m_fresh_for;
+        size_t m_used;
+        entry_map_t m_entries;
+        // most recently used at the front
+        lru_t m_lru;
+
+    private:
+        read_cache(const read_cache&);
+        read_cache& operator = (const read_cache&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_client_read_cache_h_
@@ -0,0 +1,75 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// HyperDex
+// HyperDex
+#include "test/th.h"
+#include "client/client_stats.h"
+
+using hyperdex::client_stats;
+
+TEST(ClientStats, Report)
+{
+    client_stats cs;
+    ASSERT_FALSE(cs.enabled());
+    cs.enable(true);
+    ASSERT_TRUE(cs.enabled());
+
+    for (uint64_t i = 1; i <= 100; ++i)
+    {
+        cs.record_reply(hyperdex::REQ_GET, 7, i * 1000);
+    }
+
+    cs.record_reply(hyperdex::REQ_ATOMIC, 8, 5000);
+    cs.record_disruption(8);
+    cs.record_failed_disruption(3);
+    std::string r = cs.report();
+    // buckets hold values to within a quarter of their true size
+    ASSERT_TRUE(r.find("op.REQ_GET count=100 mean_ns=50500 p50_ns=57343 p99_ns=100000 max_ns=100000\n") != std::string::npos);
+    ASSERT_TRUE(r.find("op.REQ_ATOMIC count=1 ") != std::string::npos);
+    ASSERT_TRUE(r.find("server.7 count=100 ") != std::string::npos);
+    ASSERT_TRUE(r.find("disruptions.8 count=1\n") != std::string::npos);
+    ASSERT_TRUE(r.find("failed disruption=3 reconfigure=0\n") != std::string::npos);
+    cs.reset();
+    ASSERT_TRUE(cs.report().find("REQ_GET") == std::string::npos);
+}
+
+TEST(ClientStats, Compressed)
+{
+    client_stats cs;
+    cs.record_compressed(hyperdex::RESP_SEARCH_BATCH, 4000, 1000);
+    ASSERT_TRUE(cs.report().find("compressed.") == std::string::npos);
+    cs.enable(true);
+    cs.record_compressed(hyperdex::RESP_SEARCH_BATCH, 4000, 1000);
+    cs.record_compressed(hyperdex::RESP_SEARCH_BATCH, 2000, 1000);
+    cs.record_compressed(hyperdex::RESP_SORTED_SEARCH_CHUNK, 900, 600);
+    std::string r = cs.report();
+    ASSERT_TRUE(r.find("compressed.RESP_SEARCH_BATCH count=2 raw_bytes=6000 wire_bytes=2000 ratio=3.00\n") != std::string::npos);
+    ASSERT_TRUE(r.find("compressed.RESP_SORTED_SEARCH_CHUNK count=1 raw_bytes=900 wire_bytes=600 ratio=1.50\n") != std::string::npos);
+    cs.reset();
+    ASSERT_TRUE(cs.report().find("compressed.") == std::string::npos);
+}
@@ -99,6 +99,41 @@ TEST(ClientDataStructures, AllocateMapAttribute)
     hyperdex_ds_arena_destroy(a);
 }
 
+TEST(ClientDataStructures, ArenaReset)
+{
+    hyperdex_ds_arena* a = hyperdex_ds_arena_create();
+    char* first = static_cast<char*>(hyperdex_ds_malloc(a, 100));
+    ASSERT_TRUE(first != NULL);
+    memset(first, 'a', 100);
+
+    // spill well past the first chunk, including one oversized allocation
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        char* x = static_cast<char*>(hyperdex_ds_malloc(a, 100));
+        ASSERT_TRUE(x != NULL);
+        ASSERT_EQ(0U, reinterpret_cast<uintptr_t>(x) % 16);
+        memset(x, 'b', 100);
+    }
+
+    char* big = static_cast<char*>(hyperdex_ds_malloc(a, 4 * 1024 * 1024));
+    ASSERT_TRUE(big != NULL);
+    memset(big, 'c', 4 * 1024 * 1024);
+
+    // the memory is reused from the start
+    hyperdex_ds_arena_reset(a);
+    char* again = static_cast<char*>(hyperdex_ds_malloc(a, 100));
+    ASSERT_EQ(first, again);
+
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        char* x = static_cast<char*>(hyperdex_ds_malloc(a, 100));
+        ASSERT_TRUE(x != NULL);
+        memset(x, 'd', 100);
+    }
+
+    hyperdex_ds_arena_destroy(a);
+}
+
 TEST(ClientDataStructures, PackInt)
 {
     char buf[sizeof(int64_t)];
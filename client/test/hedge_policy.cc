@@ -0,0 +1,90 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// HyperDex
+#include "test/th.h"
+#include "client/constants.h"
+#include "client/hedge_policy.h"
+
+using hyperdex::hedge_policy;
+
+TEST(HedgePolicy, Delay)
+{
+    hedge_policy hp;
+    ASSERT_FALSE(hp.enabled());
+    hp.configure(0.05);
+    ASSERT_TRUE(hp.enabled());
+
+    // no delay until a quarter of the window has been seen
+    for (uint64_t i = 0; i + 1 < HYPERDEX_CLIENT_HEDGE_SAMPLES / 4; ++i)
+    {
+        hp.record(1000);
+    }
+
+    ASSERT_EQ(hp.delay(), 0U);
+
+    // one in ten gets is slow, so the 95th percentile is slow too
+    for (uint64_t i = 0; i < HYPERDEX_CLIENT_HEDGE_SAMPLES; ++i)
+    {
+        hp.record(i % 10 == 0 ? 100000 : 1000);
+    }
+
+    ASSERT_EQ(hp.delay(), 100000U);
+
+    // and once the slow gets stop, the delay follows
+    for (uint64_t i = 0; i < HYPERDEX_CLIENT_HEDGE_SAMPLES; ++i)
+    {
+        hp.record(2000);
+    }
+
+    ASSERT_EQ(hp.delay(), 2000U);
+}
+
+TEST(HedgePolicy, Budget)
+{
+    hedge_policy hp;
+    hp.configure(0.1);
+    ASSERT_FALSE(hp.admit());
+
+    for (uint64_t i = 0; i < 100; ++i)
+    {
+        hp.count_get();
+
+        if (hp.admit())
+        {
+            hp.count_hedge();
+        }
+    }
+
+    ASSERT_EQ(hp.gets(), 100U);
+    ASSERT_EQ(hp.hedged(), 10U);
+    hp.count_win();
+    ASSERT_EQ(hp.won(), 1U);
+    // fractions past one are clamped
+    hp.configure(2.0);
+    ASSERT_TRUE(hp.admit());
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// HyperDex
+#include "test/th.h"
+#include "client/read_cache.h"
+
+using hyperdex::read_cache;
+using hyperdex::region_id;
+
+static read_cache::entry_ptr
+make_entry(uint64_t version, size_t sz)
+{
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    std::vector<e::slice> value;
+    return read_cache::entry_ptr(new read_cache::entry(region_id(1), version, 0, msg, value));
+}
+
+TEST(ReadCache, HitMiss)
+{
+    read_cache rc;
+    ASSERT_FALSE(rc.enabled());
+    rc.configure(1 << 20, 0);
+    ASSERT_TRUE(rc.enabled());
+    e::slice key("key", 3);
+    ASSERT_FALSE(rc.lookup("space", key));
+    rc.insert("space", key, make_entry(5, 64));
+    read_cache::entry_ptr e = rc.lookup("space", key);
+    ASSERT_TRUE(e);
+    ASSERT_EQ(e->version, 5U);
+    // the same key in another space is a different object
+    ASSERT_FALSE(rc.lookup("other", key));
+    // and the space and key do not run together
+    ASSERT_FALSE(rc.lookup("spacek", e::slice("ey", 2)));
+    // replacing an entry keeps the newer one
+    rc.insert("space", key, make_entry(6, 64));
+    ASSERT_EQ(rc.lookup("space", key)->version, 6U);
+    rc.invalidate("space", key);
+    ASSERT_FALSE(rc.lookup("space", key));
+}
+
+TEST(ReadCache, Budget)
+{
+    read_cache rc;
+    rc.configure(4096, 0);
+
+    for (uint64_t i = 0; i < 8; ++i)
+    {
+        e::slice key(reinterpret_cast<const char*>(&i), sizeof(i));
+        rc.insert("space", key, make_entry(i + 1, 1024));
+    }
+
+    // only the four most recent fit
+    for (uint64_t i = 0; i < 8; ++i)
+    {
+        e::slice key(reinterpret_cast<const char*>(&i), sizeof(i));
+        ASSERT_EQ(!!rc.lookup("space", key), i >= 4);
+    }
+
+    // a lookup makes an entry recent, so the next insert evicts another
+    uint64_t keep = 4;
+    rc.lookup("space", e::slice(reinterpret_cast<const char*>(&keep), sizeof(keep)));
+    uint64_t next = 8;
+    rc.insert("space", e::slice(reinterpret_cast<const char*>(&next), sizeof(next)), make_entry(9, 1024));
+    ASSERT_TRUE(rc.lookup("space", e::slice(reinterpret_cast<const char*>(&keep), sizeof(keep))));
+    uint64_t gone = 5;
+    ASSERT_FALSE(rc.lookup("space", e::slice(reinterpret_cast<const char*>(&gone), sizeof(gone))));
+    // an object larger than the budget is never kept
+    rc.insert("space", e::slice("big", 3), make_entry(1, 8192));
+    ASSERT_FALSE(rc.lookup("space", e::slice("big", 3)));
+    // shrinking the budget evicts, and turning it off empties the cache
+    rc.configure(1024, 0);
+    ASSERT_FALSE(rc.lookup("space", e::slice(reinterpret_cast<const char*>(&keep), sizeof(keep))));
+    rc.configure(0, 0);
+    ASSERT_FALSE(rc.enabled());
+    ASSERT_FALSE(rc.lookup("space", e::slice(reinterpret_cast<const char*>(&next), sizeof(next))));
+}
@@ -50,7 +50,8 @@ hyperdex :: value_to_attributes(const configuration& config,
                                 e::error* op_error,
                                 const hyperdex_client_attribute** attrs,
                                 size_t* attrs_sz,
-                                bool convert_types)
+                                bool convert_types,
+                                hyperdex_ds_arena* arena)
 {
     std::vector<e::slice> value(_value);
     const schema* sc = config.get_schema(rid);
@@ -88,7 +89,7 @@ hyperdex :: value_to_attributes(const configuration& config,
 
     std::vector<hyperdex_client_attribute> ha;
     ha.reserve(sc->attrs_sz);
-    char* ret = static_cast<char*>(malloc(sz));
+    char* ret = static_cast<char*>(arena ? hyperdex_ds_malloc(arena, sz) : malloc(sz));
 
     if (!ret)
     {
@@ -97,6 +98,12 @@ hyperdex :: value_to_attributes(const configuration& config,
     }
 
     e::guard g = e::makeguard(free, ret);
+
+    // the arena frees it, on failure or not
+    if (arena)
+    {
+        g.dismiss();
+    }
     char* data = ret + sizeof(hyperdex_client_attribute) * value.size();
 
     if (key)
@@ -150,7 +157,8 @@ hyperdex :: value_to_attributes(const configuration& config,
                                 e::error* op_error,
                                 const hyperdex_client_attribute** attrs,
                                 size_t* attrs_sz,
-                                bool convert_types)
+                                bool convert_types,
+                                hyperdex_ds_arena* arena)
 {
     std::vector<std::pair<uint16_t, e::slice> > value(_value);
     const schema* sc = config.get_schema(rid);
@@ -185,7 +193,7 @@ hyperdex :: value_to_attributes(const configuration& config,
 
     std::vector<hyperdex_client_attribute> ha;
     ha.reserve(sc->attrs_sz);
-    char* ret = static_cast<char*>(malloc(sz));
+    char* ret = static_cast<char*>(arena ? hyperdex_ds_malloc(arena, sz) : malloc(sz));
 
     if (!ret)
     {
@@ -194,16 +202,23 @@ hyperdex :: value_to_attributes(const configuration& config,
     }
 
     e::guard g = e::makeguard(free, ret);
+
+    // the arena frees it, on failure or not
+    if (arena)
+    {
+        g.dismiss();
+    }
     char* data = ret + sizeof(hyperdex_client_attribute) * value.size();
 
     for (size_t i = 0; i < value.size(); ++i)
     {
-        if (sc->attrs[i + 1].type == HYPERDATATYPE_MACAROON_SECRET)
+        uint16_t attr = value[i].first;
+
+        if (sc->attrs[attr].type == HYPERDATATYPE_MACAROON_SECRET)
         {
             continue;
         }
 
-        uint16_t attr = value[i].first;
         ha.push_back(hyperdex_client_attribute());
         size_t attr_sz = strlen(sc->attrs[attr].name) + 1;
         ha.back().attr = data;
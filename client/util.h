@@ -33,6 +33,7 @@
 
 // HyperDex
 #include <hyperdex/client.h>
+#include <hyperdex/datastructures.h>
 #include "namespace.h"
 #include "common/configuration.h"
 #include "common/ids.h"
@@ -40,7 +41,8 @@
 BEGIN_HYPERDEX_NAMESPACE
 
 // Convert the key and value vector returned by entity to an array of
-// hyperdex_attribute using the given configuration.
+// hyperdex_attribute using the given configuration.  The array is malloc'd
+// unless an arena is given, in which case the arena owns it.
 bool
 value_to_attributes(const configuration& config,
                     const region_id& rid,
@@ -51,7 +53,8 @@ value_to_attributes(const configuration& config,
                     e::error* op_error,
                     const hyperdex_client_attribute** attrs,
                     size_t* attrs_sz,
-                    bool convert_types);
+                    bool convert_types,
+                    hyperdex_ds_arena* arena);
 
 bool
 value_to_attributes(const configuration& config,
@@ -61,7 +64,8 @@ value_to_attributes(const configuration& config,
                     e::error* op_error,
                     const hyperdex_client_attribute** attrs,
                     size_t* attrs_sz,
-                    bool convert_types);
+                    bool convert_types,
+                    hyperdex_ds_arena* arena);
 
 END_HYPERDEX_NAMESPACE
 
@@ -0,0 +1,64 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_common_aggregate_h_
+#define hyperdex_common_aggregate_h_
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// The functions a REQ_AGGREGATE may apply.  Each region sends its partial
+// result (the sum for SUM and AVG, the extreme for MIN and MAX) together with
+// the number of objects it covered, and the client combines the partials.
+enum aggregate_function
+{
+    AGGREGATE_SUM = 1,
+    AGGREGATE_MIN = 2,
+    AGGREGATE_MAX = 3,
+    AGGREGATE_AVG = 4
+};
+
+// the outcome a region reports in RESP_AGGREGATE
+enum aggregate_status
+{
+    AGGREGATE_OK              = 0,
+    AGGREGATE_TOO_MANY_GROUPS = 1,
+    AGGREGATE_OVERFLOW        = 2,
+    AGGREGATE_FAILED          = 3
+};
+
+// the most aggregates one request may carry
+#define HYPERDEX_AGGREGATE_MAX_FUNCTIONS 64
+// the most distinct groups one aggregation may produce; grouping is meant for
+// low-cardinality attributes
+#define HYPERDEX_AGGREGATE_MAX_GROUPS 1024
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_common_aggregate_h_
@@ -25,15 +25,95 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+// C
+#include <cassert>
+
+// C++
+#include <utility>
+
 // e
 #include <e/endian.h>
 
 // HyperDex
 #include "common/attribute_check.h"
+#include "common/datatype_document.h"
 #include "common/datatype_info.h"
 #include "common/serialization.h"
 
 using hyperdex::attribute_check;
+using hyperdex::datatype_document;
+
+namespace
+{
+
+// One reader per document attribute of the object being checked, so that
+// every check on a path within the same document shares its parse.
+class document_readers
+{
+    public:
+        document_readers() : m_readers() {}
+        ~document_readers() throw ()
+        {
+            for (size_t i = 0; i < m_readers.size(); ++i)
+            {
+                delete m_readers[i].second;
+            }
+        }
+
+    public:
+        // returns NULL if the check is not against a document
+        datatype_document::reader* get(hyperdatatype type,
+                                       const attribute_check& check,
+                                       const e::slice& doc)
+        {
+            hyperdex::datatype_info* di = hyperdex::datatype_info::lookup(type);
+
+            if (!di || !di->document() ||
+                !hyperdex::datatype_info::lookup(check.datatype))
+            {
+                return NULL;
+            }
+
+            for (size_t i = 0; i < m_readers.size(); ++i)
+            {
+                if (m_readers[i].first == check.attr)
+                {
+                    return m_readers[i].second;
+                }
+            }
+
+            // document() is only true of datatype_document
+            const datatype_document* dd = static_cast<const datatype_document*>(di);
+            m_readers.push_back(std::make_pair(check.attr, new datatype_document::reader(dd, doc)));
+            return m_readers.back().second;
+        }
+
+    private:
+        std::vector<std::pair<uint16_t, datatype_document::reader*> > m_readers;
+
+    private:
+        document_readers(const document_readers&);
+        document_readers& operator = (const document_readers&);
+};
+
+bool
+passes_attribute_check_shared(hyperdatatype type,
+                              const attribute_check& check,
+                              const e::slice& value,
+                              document_readers* docs)
+{
+    datatype_document::reader* r = docs->get(type, check, value);
+
+    if (r)
+    {
+        datatype_document* dd = static_cast<datatype_document*>(hyperdex::datatype_info::lookup(type));
+        return dd->document_check(check, r);
+    }
+
+    return hyperdex::passes_attribute_check(type, check, value);
+}
+
+} // namespace
 
 attribute_check :: attribute_check()
     : attr()
@@ -212,6 +292,8 @@ hyperdex :: passes_attribute_checks(const schema& sc,
                                     const e::slice& key,
                                     const std::vector<e::slice>& value)
 {
+    document_readers docs;
+
     for (size_t i = 0; i < checks.size(); ++i)
     {
         if (checks[i].attr >= sc.attrs_sz)
@@ -222,7 +304,7 @@ hyperdex :: passes_attribute_checks(const schema& sc,
         hyperdatatype type = sc.attrs[checks[i].attr].type;
 
         if (checks[i].attr > 0 &&
-            !passes_attribute_check(type, checks[i], value[checks[i].attr - 1]))
+            !passes_attribute_check_shared(type, checks[i], value[checks[i].attr - 1], &docs))
         {
             return i;
         }
@@ -236,6 +318,316 @@ hyperdex :: passes_attribute_checks(const schema& sc,
     return checks.size();
 }
 
+using hyperdex::compiled_attribute_check;
+
+compiled_attribute_check :: compiled_attribute_check()
+    : m_kind(GENERIC)
+    , m_predicate(HYPERPREDICATE_FAIL)
+    , m_int(0)
+    , m_float(0)
+    , m_regex()
+{
+}
+
+compiled_attribute_check :: ~compiled_attribute_check() throw ()
+{
+}
+
+static bool
+is_ordered_predicate(hyperpredicate p)
+{
+    return p == HYPERPREDICATE_EQUALS ||
+           p == HYPERPREDICATE_LESS_THAN ||
+           p == HYPERPREDICATE_LESS_EQUAL ||
+           p == HYPERPREDICATE_GREATER_EQUAL ||
+           p == HYPERPREDICATE_GREATER_THAN;
+}
+
+static bool
+is_timestamp(hyperdatatype t)
+{
+    return CONTAINER_TYPE(t) == HYPERDATATYPE_TIMESTAMP_GENERIC &&
+           t != HYPERDATATYPE_TIMESTAMP_GENERIC;
+}
+
+void
+compiled_attribute_check :: compile(hyperdatatype type, const attribute_check& check)
+{
+    m_kind = GENERIC;
+    m_predicate = check.predicate;
+
+    if (check.predicate == HYPERPREDICATE_REGEX &&
+        check.datatype == HYPERDATATYPE_STRING &&
+        type == HYPERDATATYPE_STRING)
+    {
+        m_regex.compile(check.value.data(), check.value.size());
+        m_kind = REGEX;
+        return;
+    }
+
+    // the fixed-width types all accept an empty value as zero
+    if (!is_ordered_predicate(check.predicate) ||
+        check.datatype != type ||
+        (check.value.size() != sizeof(int64_t) && !check.value.empty()))
+    {
+        return;
+    }
+
+    if (type == HYPERDATATYPE_INT64 || is_timestamp(type))
+    {
+        m_int = 0;
+
+        if (!check.value.empty())
+        {
+            e::unpack64le(check.value.data(), &m_int);
+        }
+
+        m_kind = INT64;
+    }
+    else if (type == HYPERDATATYPE_FLOAT)
+    {
+        m_float = 0;
+
+        if (!check.value.empty())
+        {
+            e::unpackdoublele(check.value.data(), &m_float);
+        }
+
+        m_kind = FLOAT;
+    }
+}
+
+template <typename T>
+static bool
+passes_ordered(hyperpredicate p, const T& check, const T& value)
+{
+    // mirrors datatype_info::compare(check, value), under which NaN compares
+    // equal to everything
+    int cmp = check < value ? -1 : (check > value ? 1 : 0);
+
+    switch (p)
+    {
+        case HYPERPREDICATE_EQUALS:
+            return cmp == 0;
+        case HYPERPREDICATE_LESS_THAN:
+            return cmp > 0;
+        case HYPERPREDICATE_LESS_EQUAL:
+            return cmp >= 0;
+        case HYPERPREDICATE_GREATER_EQUAL:
+            return cmp <= 0;
+        case HYPERPREDICATE_GREATER_THAN:
+            return cmp < 0;
+        default:
+            return false;
+    }
+}
+
+bool
+compiled_attribute_check :: passes(const e::slice& value) const
+{
+    assert(m_kind != GENERIC);
+
+    if (m_kind == REGEX)
+    {
+        // strings need no validation, so this is all that
+        // passes_attribute_check would do
+        return m_regex.match(value.data(), value.size());
+    }
+
+    if (value.size() != sizeof(int64_t) && !value.empty())
+    {
+        return false;
+    }
+
+    if (m_kind == INT64)
+    {
+        int64_t x = 0;
+
+        if (!value.empty())
+        {
+            e::unpack64le(value.data(), &x);
+        }
+
+        return passes_ordered(m_predicate, m_int, x);
+    }
+    else
+    {
+        double x = 0;
+
+        if (!value.empty())
+        {
+            e::unpackdoublele(value.data(), &x);
+        }
+
+        return passes_ordered(m_predicate, m_float, x);
+    }
+}
+
+void
+hyperdex :: compile_attribute_checks(const schema& sc,
+                                     const std::vector<attribute_check>& checks,
+                                     std::vector<compiled_attribute_check>* compiled)
+{
+    compiled->clear();
+    compiled->resize(checks.size());
+
+    for (size_t i = 0; i < checks.size(); ++i)
+    {
+        if (checks[i].attr < sc.attrs_sz)
+        {
+            (*compiled)[i].compile(sc.attrs[checks[i].attr].type, checks[i]);
+        }
+    }
+}
+
+size_t
+hyperdex :: passes_attribute_checks(const schema& sc,
+                                    const std::vector<attribute_check>& checks,
+                                    const std::vector<compiled_attribute_check>& compiled,
+                                    const e::slice& key,
+                                    const std::vector<e::slice>& value)
+{
+    assert(compiled.size() == checks.size());
+    document_readers docs;
+
+    for (size_t i = 0; i < checks.size(); ++i)
+    {
+        if (checks[i].attr >= sc.attrs_sz)
+        {
+            return i;
+        }
+
+        const e::slice& v(checks[i].attr > 0 ? value[checks[i].attr - 1] : key);
+
+        if (compiled[i].compiled())
+        {
+            if (!compiled[i].passes(v))
+            {
+                return i;
+            }
+        }
+        else if (checks[i].attr > 0 &&
+                 !passes_attribute_check_shared(sc.attrs[checks[i].attr].type, checks[i], v, &docs))
+        {
+            return i;
+        }
+        else if (checks[i].attr == 0 &&
+                 !passes_attribute_check(sc.attrs[checks[i].attr].type, checks[i], v))
+        {
+            return i;
+        }
+    }
+
+    return checks.size();
+}
+
+bool
+hyperdex :: attribute_check_implies(const schema& sc,
+                                    const attribute_check& check,
+                                    const attribute_check& implied)
+{
+    if (check.attr != implied.attr || check.attr >= sc.attrs_sz)
+    {
+        return false;
+    }
+
+    if (check.predicate == implied.predicate &&
+        check.datatype == implied.datatype &&
+        check.value == implied.value)
+    {
+        return true;
+    }
+
+    const hyperdatatype type = sc.attrs[check.attr].type;
+
+    if (check.predicate == HYPERPREDICATE_EQUALS &&
+        check.datatype == type)
+    {
+        return passes_attribute_check(type, implied, check.value);
+    }
+
+    datatype_info* di = datatype_info::lookup(type);
+
+    if (!di || !di->comparable() ||
+        check.datatype != type || implied.datatype != type ||
+        !di->validate(check.value) || !di->validate(implied.value))
+    {
+        return false;
+    }
+
+    const bool check_lower = check.predicate == HYPERPREDICATE_GREATER_EQUAL ||
+                             check.predicate == HYPERPREDICATE_GREATER_THAN;
+    const bool check_upper = check.predicate == HYPERPREDICATE_LESS_EQUAL ||
+                             check.predicate == HYPERPREDICATE_LESS_THAN;
+    const bool implied_lower = implied.predicate == HYPERPREDICATE_GREATER_EQUAL ||
+                               implied.predicate == HYPERPREDICATE_GREATER_THAN;
+    const bool implied_upper = implied.predicate == HYPERPREDICATE_LESS_EQUAL ||
+                               implied.predicate == HYPERPREDICATE_LESS_THAN;
+    const int cmp = di->compare(check.value, implied.value);
+
+    // equal bounds imply one another unless only the implied one is strict
+    if (check_lower && implied_lower)
+    {
+        return cmp > 0 ||
+               (cmp == 0 && (check.predicate == HYPERPREDICATE_GREATER_THAN ||
+                             implied.predicate == HYPERPREDICATE_GREATER_EQUAL));
+    }
+
+    if (check_upper && implied_upper)
+    {
+        return cmp < 0 ||
+               (cmp == 0 && (check.predicate == HYPERPREDICATE_LESS_THAN ||
+                             implied.predicate == HYPERPREDICATE_LESS_EQUAL));
+    }
+
+    return false;
+}
+
+bool
+hyperdex :: attribute_checks_imply(const schema& sc,
+                                   const std::vector<hyperdex::attribute_check>& checks,
+                                   const std::vector<hyperdex::attribute_check>& implied)
+{
+    for (size_t i = 0; i < implied.size(); ++i)
+    {
+        bool found = false;
+
+        for (size_t j = 0; !found && j < checks.size(); ++j)
+        {
+            found = attribute_check_implies(sc, checks[j], implied[i]);
+        }
+
+        if (!found)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+hyperdex :: unpack_index_filter(const e::slice& filter,
+                                std::vector<hyperdex::attribute_check>* checks)
+{
+    checks->clear();
+    e::unpacker up(filter.cdata(), filter.size());
+    uint32_t sz = 0;
+
+    if (!filter.empty())
+    {
+        up = up >> sz;
+    }
+
+    for (uint32_t i = 0; !up.error() && i < sz; ++i)
+    {
+        checks->push_back(attribute_check());
+        up = up >> checks->back();
+    }
+
+    return !up.error();
+}
+
 bool
 hyperdex :: operator < (const attribute_check& lhs, const attribute_check& rhs)
 {
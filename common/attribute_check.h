@@ -35,6 +35,7 @@
 // HyperDex
 #include "namespace.h"
 #include "hyperdex.h"
+#include "common/regex_match.h"
 #include "common/schema.h"
 
 BEGIN_HYPERDEX_NAMESPACE
@@ -72,6 +73,69 @@ passes_attribute_checks(const schema& sc,
                         const e::slice& key,
                         const std::vector<e::slice>& values);
 
+// A check prepared once per search so that examining an object doesn't
+// re-resolve its datatypes.  Regexes over strings are compiled, and ordered
+// comparisons of int64, float and timestamp attributes against a constant of
+// the same type decode the constant once and compare numbers inline.  Every
+// other check falls back to passes_attribute_check.
+class compiled_attribute_check
+{
+    public:
+        compiled_attribute_check();
+        ~compiled_attribute_check() throw ();
+
+    public:
+        void compile(hyperdatatype type, const attribute_check& check);
+        // has compile found a way around passes_attribute_check?
+        bool compiled() const { return m_kind != GENERIC; }
+        // same result as passes_attribute_check; only valid if compiled()
+        bool passes(const e::slice& value) const;
+
+    private:
+        enum kind_t { GENERIC, REGEX, INT64, FLOAT };
+
+    private:
+        kind_t m_kind;
+        hyperpredicate m_predicate;
+        int64_t m_int;
+        double m_float;
+        compiled_regex m_regex;
+};
+
+// (*compiled)[i] corresponds to checks[i]
+void
+compile_attribute_checks(const schema& sc,
+                         const std::vector<hyperdex::attribute_check>& checks,
+                         std::vector<compiled_attribute_check>* compiled);
+
+// Like passes_attribute_checks, but with the checks prepared above
+size_t
+passes_attribute_checks(const schema& sc,
+                        const std::vector<hyperdex::attribute_check>& checks,
+                        const std::vector<compiled_attribute_check>& compiled,
+                        const e::slice& key,
+                        const std::vector<e::slice>& values);
+
+// True if every object that passes "check" is sure to pass "implied".  This
+// is conservative: it knows that a check implies itself, that an equality
+// implies whatever its value passes, and that a bound implies any looser bound
+// in the same direction
+bool
+attribute_check_implies(const schema& sc,
+                        const attribute_check& check,
+                        const attribute_check& implied);
+
+// True if each of "implied" is implied by one of "checks"
+bool
+attribute_checks_imply(const schema& sc,
+                       const std::vector<hyperdex::attribute_check>& checks,
+                       const std::vector<hyperdex::attribute_check>& implied);
+
+// Unpack the checks of a partial index's filter (see index::filter)
+bool
+unpack_index_filter(const e::slice& filter,
+                    std::vector<hyperdex::attribute_check>* checks);
+
 bool
 operator < (const attribute_check& lhs,
             const attribute_check& rhs);
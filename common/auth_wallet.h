@@ -49,6 +49,8 @@ class auth_wallet
 
     public:
         bool get_macaroons(std::vector<macaroon*>* macaroons);
+        // the macaroons exactly as the client serialized them
+        const std::vector<std::string>& serialized() const { return m_macaroons; }
 
     private:
         friend e::packer operator << (e::packer lhs, const auth_wallet& rhs);
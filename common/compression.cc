@@ -0,0 +1,274 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#define __STDC_LIMIT_MACROS
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// C
+#include <stdint.h>
+#include <string.h>
+
+// STL
+#include <algorithm>
+
+#ifdef HAVE_LZ4
+// LZ4
+#include <lz4.h>
+#endif
+
+// HyperDex
+#include "common/compression.h"
+
+// dictionaries are built from DICT_SEGMENT-byte pieces of the samples, each
+// scored by how many samples share the DICT_KMER-byte strings within it
+#define DICT_KMER 8
+#define DICT_SEGMENT 64
+#define DICT_TABLE_BITS 18
+
+bool
+hyperdex :: compression_available()
+{
+#ifdef HAVE_LZ4
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool
+hyperdex :: compress(const e::slice& in, std::vector<char>* out)
+{
+#ifdef HAVE_LZ4
+    if (in.size() > LZ4_MAX_INPUT_SIZE)
+    {
+        return false;
+    }
+
+    out->resize(LZ4_compressBound(in.size()));
+    int sz = LZ4_compress_default(reinterpret_cast<const char*>(in.data()),
+                                  &(*out)[0], in.size(), out->size());
+
+    if (sz <= 0 || static_cast<size_t>(sz) >= in.size())
+    {
+        return false;
+    }
+
+    out->resize(sz);
+    return true;
+#else
+    (void) in;
+    (void) out;
+    return false;
+#endif
+}
+
+bool
+hyperdex :: decompress(const e::slice& in, size_t raw_size, std::vector<char>* out)
+{
+#ifdef HAVE_LZ4
+    if (in.size() > LZ4_MAX_INPUT_SIZE ||
+        raw_size == 0 || raw_size > LZ4_MAX_INPUT_SIZE)
+    {
+        return false;
+    }
+
+    out->resize(raw_size);
+    int sz = LZ4_decompress_safe(reinterpret_cast<const char*>(in.data()),
+                                 &(*out)[0], in.size(), out->size());
+    return sz >= 0 && static_cast<size_t>(sz) == raw_size;
+#else
+    (void) in;
+    (void) raw_size;
+    (void) out;
+    return false;
+#endif
+}
+
+bool
+hyperdex :: compress_with(const e::slice& dict, const e::slice& in, std::vector<char>* out)
+{
+#ifdef HAVE_LZ4
+    if (in.size() > LZ4_MAX_INPUT_SIZE)
+    {
+        return false;
+    }
+
+    LZ4_stream_t* stream = LZ4_createStream();
+
+    if (!stream)
+    {
+        return false;
+    }
+
+    LZ4_loadDict(stream, reinterpret_cast<const char*>(dict.data()), dict.size());
+    out->resize(LZ4_compressBound(in.size()));
+    int sz = LZ4_compress_fast_continue(stream, reinterpret_cast<const char*>(in.data()),
+                                        &(*out)[0], in.size(), out->size(), 1);
+    LZ4_freeStream(stream);
+
+    if (sz <= 0 || static_cast<size_t>(sz) >= in.size())
+    {
+        return false;
+    }
+
+    out->resize(sz);
+    return true;
+#else
+    (void) dict;
+    (void) in;
+    (void) out;
+    return false;
+#endif
+}
+
+bool
+hyperdex :: decompress_with(const e::slice& dict, const e::slice& in,
+                            size_t raw_size, std::vector<char>* out)
+{
+#ifdef HAVE_LZ4
+    if (in.size() > LZ4_MAX_INPUT_SIZE ||
+        raw_size == 0 || raw_size > LZ4_MAX_INPUT_SIZE)
+    {
+        return false;
+    }
+
+    out->resize(raw_size);
+    int sz = LZ4_decompress_safe_usingDict(reinterpret_cast<const char*>(in.data()),
+                                           &(*out)[0], in.size(), out->size(),
+                                           reinterpret_cast<const char*>(dict.data()),
+                                           dict.size());
+    return sz >= 0 && static_cast<size_t>(sz) == raw_size;
+#else
+    (void) dict;
+    (void) in;
+    (void) raw_size;
+    (void) out;
+    return false;
+#endif
+}
+
+static size_t
+kmer_bucket(const char* ptr)
+{
+    uint64_t x;
+    memcpy(&x, ptr, sizeof(x));
+    return (x * 0x9e3779b97f4a7c15ULL) >> (64 - DICT_TABLE_BITS);
+}
+
+// the share of the segment's strings that other samples have too
+static uint64_t
+segment_score(const std::vector<uint32_t>& counts,
+              const std::string& sample, size_t off)
+{
+    const size_t end = std::min(off + DICT_SEGMENT, sample.size());
+    uint64_t score = 0;
+
+    for (size_t i = off; i + DICT_KMER <= end; ++i)
+    {
+        uint32_t c = counts[kmer_bucket(sample.data() + i)];
+        score += c > 1 ? c - 1 : 0;
+    }
+
+    return score;
+}
+
+void
+hyperdex :: train_dictionary(const std::vector<std::string>& samples,
+                             size_t max_size, std::string* dict)
+{
+    dict->clear();
+    std::vector<uint32_t> counts(1ULL << DICT_TABLE_BITS, 0);
+    std::vector<uint32_t> seen(1ULL << DICT_TABLE_BITS, UINT32_MAX);
+
+    for (size_t s = 0; s < samples.size(); ++s)
+    {
+        for (size_t i = 0; i + DICT_KMER <= samples[s].size(); ++i)
+        {
+            size_t b = kmer_bucket(samples[s].data() + i);
+
+            // count a string once per sample, however often it repeats there
+            if (seen[b] != s)
+            {
+                seen[b] = s;
+                ++counts[b];
+            }
+        }
+    }
+
+    typedef std::pair<uint64_t, std::pair<size_t, size_t> > candidate;
+    std::vector<candidate> candidates;
+
+    for (size_t s = 0; s < samples.size(); ++s)
+    {
+        for (size_t off = 0; off + DICT_KMER <= samples[s].size(); off += DICT_SEGMENT)
+        {
+            uint64_t score = segment_score(counts, samples[s], off);
+
+            if (score > 0)
+            {
+                candidates.push_back(candidate(score, std::make_pair(s, off)));
+            }
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    std::vector<std::string> chosen;
+    size_t chosen_sz = 0;
+
+    for (size_t c = candidates.size(); c > 0 && chosen_sz < max_size; --c)
+    {
+        const std::string& sample(samples[candidates[c - 1].second.first]);
+        const size_t off = candidates[c - 1].second.second;
+
+        // a segment repeating ones already chosen adds nothing
+        if (segment_score(counts, sample, off) * 2 < candidates[c - 1].first)
+        {
+            continue;
+        }
+
+        const size_t end = std::min(off + DICT_SEGMENT, sample.size());
+        const size_t len = std::min(end - off, max_size - chosen_sz);
+        chosen.push_back(sample.substr(off, len));
+        chosen_sz += len;
+
+        for (size_t i = off; i + DICT_KMER <= end; ++i)
+        {
+            counts[kmer_bucket(sample.data() + i)] = 0;
+        }
+    }
+
+    // the most common pieces go last, nearest the data they will match
+    dict->reserve(chosen_sz);
+
+    for (size_t c = chosen.size(); c > 0; --c)
+    {
+        dict->append(chosen[c - 1]);
+    }
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_common_compression_h_
+#define hyperdex_common_compression_h_
+
+// STL
+#include <string>
+#include <vector>
+
+// e
+#include <e/slice.h>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Block compression for bulk traffic:  state transfer between daemons and
+// change streams to clients.  It is LZ4 when HyperDex is built with it, and
+// otherwise every call reports failure, so callers must always be ready to
+// send and receive data as-is.
+
+// can this build compress at all?
+bool
+compression_available();
+// replace out with the compressed form of in; false if the build cannot
+// compress or the data would not shrink
+bool
+compress(const e::slice& in, std::vector<char>* out);
+// replace out with the decompressed form of in, which must expand to exactly
+// raw_size bytes; false on malformed input
+bool
+decompress(const e::slice& in, size_t raw_size, std::vector<char>* out);
+
+// Like compress and decompress, but matches may refer back into "dict", so
+// that values too small to compress on their own shrink when they resemble
+// it.  Data compressed with a dictionary decompresses only with the same one.
+bool
+compress_with(const e::slice& dict, const e::slice& in, std::vector<char>* out);
+bool
+decompress_with(const e::slice& dict, const e::slice& in,
+                size_t raw_size, std::vector<char>* out);
+// replace dict with at most max_size bytes drawn from the pieces of
+// "samples" that recur across the most of them
+void
+train_dictionary(const std::vector<std::string>& samples,
+                 size_t max_size, std::string* dict);
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_common_compression_h_
@@ -31,6 +31,9 @@
 #include <algorithm>
 #include <sstream>
 
+// e
+#include <e/endian.h>
+
 // HyperDex
 #include "common/configuration.h"
 #include "common/configuration_flags.h"
@@ -41,18 +44,136 @@
 
 using hyperdex::configuration;
 using hyperdex::index;
+using hyperdex::region;
 using hyperdex::region_id;
 using hyperdex::schema;
 using hyperdex::server;
 using hyperdex::server_id;
+using hyperdex::space_id;
 using hyperdex::subspace;
 using hyperdex::subspace_id;
 using hyperdex::virtual_server_id;
 
+namespace
+{
+
+bool
+compare_space_names(const std::pair<const char*, const hyperdex::space*>& lhs,
+                    const std::pair<const char*, const hyperdex::space*>& rhs)
+{
+    return strcmp(lhs.first, rhs.first) < 0;
+}
+
+bool
+compare_coordinates(const std::pair<std::pair<uint64_t, uint64_t>, const hyperdex::region*>& lhs,
+                    const std::pair<std::pair<uint64_t, uint64_t>, const hyperdex::region*>& rhs)
+{
+    return lhs.first < rhs.first;
+}
+
+// write the filter of a partial index as the "where" clause that created it
+void
+describe_filter(std::ostream& out, const schema& sc, const index& idx)
+{
+    std::vector<hyperdex::attribute_check> checks;
+
+    if (!hyperdex::unpack_index_filter(idx.filter, &checks))
+    {
+        out << "where <corrupt>";
+        return;
+    }
+
+    for (size_t i = 0; i < checks.size(); ++i)
+    {
+        const hyperdex::attribute_check& c(checks[i]);
+        out << (i == 0 ? "where " : " and ")
+            << (c.attr < sc.attrs_sz ? sc.attrs[c.attr].name : "?");
+
+        switch (c.predicate)
+        {
+            case HYPERPREDICATE_LESS_THAN:
+                out << " < ";
+                break;
+            case HYPERPREDICATE_LESS_EQUAL:
+                out << " <= ";
+                break;
+            case HYPERPREDICATE_GREATER_EQUAL:
+                out << " >= ";
+                break;
+            case HYPERPREDICATE_GREATER_THAN:
+                out << " > ";
+                break;
+            case HYPERPREDICATE_EQUALS:
+            default:
+                out << " = ";
+                break;
+        }
+
+        if (c.datatype == HYPERDATATYPE_STRING)
+        {
+            out << "\"" << c.value.str() << "\"";
+        }
+        else if (c.datatype == HYPERDATATYPE_FLOAT && c.value.size() == sizeof(double))
+        {
+            double d;
+            e::unpackdoublele(c.value.data(), &d);
+            out << d;
+        }
+        else if (c.value.size() == sizeof(int64_t))
+        {
+            int64_t i64;
+            e::unpack64le(c.value.data(), &i64);
+            out << i64;
+        }
+        else
+        {
+            out << c.value.hex();
+        }
+    }
+}
+
+// the share of the subspace's data held by "regs", weighing each region by
+// the bytes it last reported storing; a region that has not reported weighs
+// the mean of those that have, and if none have, every region weighs the same
+double
+search_work(const subspace& ss, const std::vector<const region*>& regs)
+{
+    if (ss.regions.empty())
+    {
+        return 0;
+    }
+
+    uint64_t known = 0;
+    uint64_t known_bytes = 0;
+
+    for (size_t i = 0; i < ss.regions.size(); ++i)
+    {
+        if (ss.regions[i].stored_bytes > 0)
+        {
+            ++known;
+            known_bytes += ss.regions[i].stored_bytes;
+        }
+    }
+
+    const double mean = known > 0 ? double(known_bytes) / known : 1.;
+    const double total = known_bytes + mean * (ss.regions.size() - known);
+    double work = 0;
+
+    for (size_t i = 0; i < regs.size(); ++i)
+    {
+        work += regs[i]->stored_bytes > 0 ? double(regs[i]->stored_bytes) : mean;
+    }
+
+    return work / total;
+}
+
+} // namespace
+
 configuration :: configuration()
     : m_cluster(0)
     , m_version(0)
     , m_flags(0)
+    , m_transfer_rate(0)
     , m_servers()
     , m_region_ids_by_virtual()
     , m_server_ids_by_virtual()
@@ -65,6 +186,10 @@ configuration :: configuration()
     , m_tails_by_region()
     , m_next_by_virtual()
     , m_point_leaders_by_virtual()
+    , m_spaces_by_name()
+    , m_spaces_by_region()
+    , m_subspaces_by_id()
+    , m_regions_by_coordinate()
     , m_spaces()
     , m_transfers()
 {
@@ -75,6 +200,7 @@ configuration :: configuration(const configuration& other)
     : m_cluster(other.m_cluster)
     , m_version(other.m_version)
     , m_flags(other.m_flags)
+    , m_transfer_rate(other.m_transfer_rate)
     , m_servers(other.m_servers)
     , m_region_ids_by_virtual(other.m_region_ids_by_virtual)
     , m_server_ids_by_virtual(other.m_server_ids_by_virtual)
@@ -87,6 +213,10 @@ configuration :: configuration(const configuration& other)
     , m_tails_by_region(other.m_tails_by_region)
     , m_next_by_virtual(other.m_next_by_virtual)
     , m_point_leaders_by_virtual(other.m_point_leaders_by_virtual)
+    , m_spaces_by_name()
+    , m_spaces_by_region()
+    , m_subspaces_by_id()
+    , m_regions_by_coordinate()
     , m_spaces(other.m_spaces)
     , m_transfers(other.m_transfers)
 {
@@ -115,6 +245,12 @@ configuration :: read_only() const
     return m_flags & HYPERDEX_CONFIG_READ_ONLY;
 }
 
+uint64_t
+configuration :: transfer_rate() const
+{
+    return m_transfer_rate;
+}
+
 void
 configuration :: get_all_addresses(std::vector<std::pair<server_id, po6::net::location> >* addrs) const
 {
@@ -204,15 +340,8 @@ configuration :: get_server_id(const virtual_server_id& id) const
 const schema*
 configuration :: get_schema(const char* sname) const
 {
-    for (size_t s = 0; s < m_spaces.size(); ++s)
-    {
-        if (strcmp(sname, m_spaces[s].name) == 0)
-        {
-            return &m_spaces[s].sc;
-        }
-    }
-
-    return NULL;
+    const space* s = find_space(sname);
+    return s ? &s->sc : NULL;
 }
 
 const schema*
@@ -231,6 +360,38 @@ configuration :: get_schema(const region_id& ri) const
     return NULL;
 }
 
+const char*
+configuration :: get_space_name(const region_id& ri) const
+{
+    std::vector<uint64_space_t>::const_iterator it;
+    it = std::lower_bound(m_spaces_by_region.begin(),
+                          m_spaces_by_region.end(),
+                          uint64_space_t(ri.get(), NULL));
+
+    if (it != m_spaces_by_region.end() && it->first == ri.get())
+    {
+        return it->second->name;
+    }
+
+    return NULL;
+}
+
+space_id
+configuration :: space_of(const region_id& ri) const
+{
+    std::vector<uint64_space_t>::const_iterator it;
+    it = std::lower_bound(m_spaces_by_region.begin(),
+                          m_spaces_by_region.end(),
+                          uint64_space_t(ri.get(), NULL));
+
+    if (it != m_spaces_by_region.end() && it->first == ri.get())
+    {
+        return it->second->id;
+    }
+
+    return space_id();
+}
+
 const subspace*
 configuration :: get_subspace(const region_id& ri) const
 {
@@ -247,6 +408,22 @@ configuration :: get_subspace(const region_id& ri) const
     return NULL;
 }
 
+const region*
+configuration :: get_region(const region_id& ri) const
+{
+    const subspace* ss = get_subspace(ri);
+
+    for (size_t i = 0; ss && i < ss->regions.size(); ++i)
+    {
+        if (ss->regions[i].id == ri)
+        {
+            return &ss->regions[i];
+        }
+    }
+
+    return NULL;
+}
+
 virtual_server_id
 configuration :: get_virtual(const region_id& ri, const server_id& si) const
 {
@@ -379,6 +556,49 @@ configuration :: next_in_region(const virtual_server_id& vsi) const
     return virtual_server_id();
 }
 
+void
+configuration :: replicas_of_region(const region_id& ri, std::vector<virtual_server_id>* replicas) const
+{
+    virtual_server_id tail = tail_of_region(ri);
+    virtual_server_id vsi = head_of_region(ri);
+
+    while (vsi != virtual_server_id())
+    {
+        replicas->push_back(vsi);
+
+        if (vsi == tail)
+        {
+            break;
+        }
+
+        vsi = next_in_region(vsi);
+    }
+}
+
+uint64_t
+configuration :: fault_tolerance_of_region(const region_id& ri) const
+{
+    for (size_t w = 0; w < m_spaces.size(); ++w)
+    {
+        const space& s(m_spaces[w]);
+
+        for (size_t x = 0; x < s.subspaces.size(); ++x)
+        {
+            const subspace& ss(s.subspaces[x]);
+
+            for (size_t y = 0; y < ss.regions.size(); ++y)
+            {
+                if (ss.regions[y].id == ri)
+                {
+                    return s.fault_tolerance;
+                }
+            }
+        }
+    }
+
+    return 0;
+}
+
 void
 configuration :: point_leaders(const server_id& si, std::vector<region_id>* servers) const
 {
@@ -427,73 +647,92 @@ configuration :: is_point_leader(const virtual_server_id& e) const
 virtual_server_id
 configuration :: point_leader(const char* sname, const e::slice& key) const
 {
-    for (size_t s = 0; s < m_spaces.size(); ++s)
+    const space* s = find_space(sname);
+
+    if (!s)
     {
-        if (strcmp(sname, m_spaces[s].name) != 0)
+        return virtual_server_id();
+    }
+
+    uint64_t h;
+    hash(s->sc, key, &h);
+    const region* reg = find_region(s->subspaces[0], h);
+
+    if (!reg)
+    {
+        abort();
+    }
+
+    if (reg->replicas.empty())
+    {
+        return virtual_server_id();
+    }
+
+    return reg->replicas[0].vsi;
+}
+
+void
+configuration :: point_leader(const char* sname,
+                              const e::slice* keys, size_t keys_sz,
+                              virtual_server_id* leaders) const
+{
+    const space* s = find_space(sname);
+
+    if (!s)
+    {
+        for (size_t i = 0; i < keys_sz; ++i)
         {
-            continue;
+            leaders[i] = virtual_server_id();
         }
 
-        uint64_t h;
-        hash(m_spaces[s].sc, key, &h);
+        return;
+    }
 
-        for (size_t pl = 0; pl < m_spaces[s].subspaces[0].regions.size(); ++pl)
-        {
-            if (m_spaces[s].subspaces[0].regions[pl].lower_coord[0] <= h &&
-                h <= m_spaces[s].subspaces[0].regions[pl].upper_coord[0])
-            {
-                if (m_spaces[s].subspaces[0].regions[pl].replicas.empty())
-                {
-                    return virtual_server_id();
-                }
+    std::vector<uint64_t> hs(keys_sz);
+    hash_key(s->sc, keys, keys_sz, keys_sz ? &hs[0] : NULL);
 
-                return m_spaces[s].subspaces[0].regions[pl].replicas[0].vsi;
-            }
+    for (size_t i = 0; i < keys_sz; ++i)
+    {
+        const region* reg = find_region(s->subspaces[0], hs[i]);
+
+        if (!reg)
+        {
+            abort();
         }
 
-        abort();
+        leaders[i] = reg->replicas.empty() ? virtual_server_id() : reg->replicas[0].vsi;
     }
-
-    return virtual_server_id();
 }
 
 virtual_server_id
 configuration :: point_leader(const region_id& rid, const e::slice& key) const
 {
-    for (size_t s = 0; s < m_spaces.size(); ++s)
-    {
-        for (size_t ss = 0; ss < m_spaces[s].subspaces.size(); ++ss)
-        {
-            for (size_t r = 0; r < m_spaces[s].subspaces[ss].regions.size(); ++r)
-            {
-                if (m_spaces[s].subspaces[ss].regions[r].id != rid)
-                {
-                    continue;
-                }
+    std::vector<uint64_space_t>::const_iterator it;
+    it = std::lower_bound(m_spaces_by_region.begin(),
+                          m_spaces_by_region.end(),
+                          uint64_space_t(rid.get(), NULL));
 
-                uint64_t h;
-                hash(m_spaces[s].sc, key, &h);
+    if (it == m_spaces_by_region.end() || it->first != rid.get())
+    {
+        return virtual_server_id();
+    }
 
-                for (size_t pl = 0; pl < m_spaces[s].subspaces[0].regions.size(); ++pl)
-                {
-                    if (m_spaces[s].subspaces[0].regions[pl].lower_coord[0] <= h &&
-                        h <= m_spaces[s].subspaces[0].regions[pl].upper_coord[0])
-                    {
-                        if (m_spaces[s].subspaces[0].regions[pl].replicas.empty())
-                        {
-                            return virtual_server_id();
-                        }
+    const space* s = it->second;
+    uint64_t h;
+    hash(s->sc, key, &h);
+    const region* reg = find_region(s->subspaces[0], h);
 
-                        return m_spaces[s].subspaces[0].regions[pl].replicas[0].vsi;
-                    }
-                }
+    if (!reg)
+    {
+        abort();
+    }
 
-                abort();
-            }
-        }
+    if (reg->replicas.empty())
+    {
+        return virtual_server_id();
     }
 
-    return virtual_server_id();
+    return reg->replicas[0].vsi;
 }
 
 bool
@@ -532,6 +771,113 @@ configuration :: mapped_regions(const server_id& si, std::vector<region_id>* ser
     std::sort(servers->begin(), servers->end());
 }
 
+void
+configuration :: split_regions(const configuration& prev, const server_id& si,
+                               std::vector<region_id>* regions) const
+{
+    std::vector<region_id> mapped;
+    prev.mapped_regions(si, &mapped);
+
+    for (size_t i = 0; i < mapped.size(); ++i)
+    {
+        const region* before = prev.get_region(mapped[i]);
+        const region* after = get_region(mapped[i]);
+
+        if (!before || !after || get_virtual(mapped[i], si) == virtual_server_id())
+        {
+            continue;
+        }
+
+        if (before->lower_coord != after->lower_coord ||
+            before->upper_coord != after->upper_coord)
+        {
+            regions->push_back(mapped[i]);
+        }
+    }
+}
+
+bool
+configuration :: same_local_layout(const configuration& other, const server_id& si) const
+{
+    if (m_flags != other.m_flags ||
+        m_transfer_rate != other.m_transfer_rate)
+    {
+        return false;
+    }
+
+    std::vector<region_id> ours;
+    std::vector<region_id> theirs;
+    mapped_regions(si, &ours);
+    other.mapped_regions(si, &theirs);
+
+    if (ours != theirs)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < ours.size(); ++i)
+    {
+        if (!same_region_layout(other, ours[i]))
+        {
+            return false;
+        }
+    }
+
+    std::vector<std::pair<region_id, index_id> > our_indices;
+    std::vector<std::pair<region_id, index_id> > their_indices;
+    all_indices(si, &our_indices);
+    other.all_indices(si, &their_indices);
+    std::sort(our_indices.begin(), our_indices.end());
+    std::sort(their_indices.begin(), their_indices.end());
+
+    if (our_indices != their_indices)
+    {
+        return false;
+    }
+
+    std::vector<transfer_id> our_xfers;
+    std::vector<transfer_id> their_xfers;
+
+    for (size_t i = 0; i < m_transfers.size(); ++i)
+    {
+        if (m_transfers[i].src == si || m_transfers[i].dst == si)
+        {
+            our_xfers.push_back(m_transfers[i].id);
+        }
+    }
+
+    for (size_t i = 0; i < other.m_transfers.size(); ++i)
+    {
+        if (other.m_transfers[i].src == si || other.m_transfers[i].dst == si)
+        {
+            their_xfers.push_back(other.m_transfers[i].id);
+        }
+    }
+
+    std::sort(our_xfers.begin(), our_xfers.end());
+    std::sort(their_xfers.begin(), their_xfers.end());
+    return our_xfers == their_xfers;
+}
+
+void
+configuration :: unchanged_regions(const configuration& prev, const server_id& si,
+                                   std::vector<region_id>* regions) const
+{
+    std::vector<region_id> ours;
+    std::vector<region_id> theirs;
+    mapped_regions(si, &ours);
+    prev.mapped_regions(si, &theirs);
+
+    for (size_t i = 0; i < ours.size(); ++i)
+    {
+        if (std::binary_search(theirs.begin(), theirs.end(), ours[i]) &&
+            same_region_layout(prev, ours[i]))
+        {
+            regions->push_back(ours[i]);
+        }
+    }
+}
+
 const hyperdex::index*
 configuration :: get_index(const index_id& ii) const
 {
@@ -700,38 +1046,9 @@ configuration :: lookup_region(const subspace_id& ssid,
                                const std::vector<uint64_t>& hashes,
                                region_id* rid) const
 {
-    for (size_t s = 0; s < m_spaces.size(); ++s)
-    {
-        for (size_t ss = 0; ss < m_spaces[s].subspaces.size(); ++ss)
-        {
-            if (m_spaces[s].subspaces[ss].id != ssid)
-            {
-                continue;
-            }
-
-            assert(m_spaces[s].sc.attrs_sz == hashes.size());
-
-            for (size_t r = 0; r < m_spaces[s].subspaces[ss].regions.size(); ++r)
-            {
-                bool matches = true;
-
-                for (size_t a = 0; matches && a < m_spaces[s].subspaces[ss].attrs.size(); ++a)
-                {
-                    assert(a < m_spaces[s].sc.attrs_sz);
-                    matches &= m_spaces[s].subspaces[ss].regions[r].lower_coord[a] <= hashes[m_spaces[s].subspaces[ss].attrs[a]] &&
-                               hashes[m_spaces[s].subspaces[ss].attrs[a]] <= m_spaces[s].subspaces[ss].regions[r].upper_coord[a];
-                }
-
-                if (matches)
-                {
-                    *rid = m_spaces[s].subspaces[ss].regions[r].id;
-                    return;
-                }
-            }
-        }
-    }
-
-    *rid = region_id();
+    const subspace* ss = find_subspace(ssid);
+    const region* reg = ss ? find_region(*ss, hashes) : NULL;
+    *rid = reg ? reg->id : region_id();
 }
 
 void
@@ -739,16 +1056,7 @@ configuration :: lookup_search(const char* space_name,
                                const std::vector<attribute_check>& chks,
                                std::vector<virtual_server_id>* servers) const
 {
-    const space* s = NULL;
-
-    for (size_t i = 0; i < m_spaces.size(); ++i)
-    {
-        if (strcmp(space_name, m_spaces[i].name) == 0)
-        {
-            s = &m_spaces[i];
-            break;
-        }
-    }
+    const space* s = find_space(space_name);
 
     if (!s)
     {
@@ -769,98 +1077,42 @@ configuration :: lookup_search(const char* space_name,
     }
 
     bool initialized = false;
+    double least_work = 0;
     std::vector<virtual_server_id> smallest_server_set;
+    std::vector<const region*> regions;
 
+    // every subspace holds all of the space's data, so the share of it that
+    // the search would have to look through compares one subspace to another
     for (size_t i = 0; i < s->subspaces.size(); ++i)
     {
-        std::vector<virtual_server_id> this_server_set;
-
-        for (size_t j = 0; j < s->subspaces[i].regions.size(); ++j)
+        if (!search_regions(*s, s->subspaces[i], ranges, &regions))
         {
-            const region& reg(s->subspaces[i].regions[j]);
-
-            if (reg.replicas.empty())
-            {
-                continue;
-            }
-
-            bool exclude = false;
-
-            for (size_t k = 0; !exclude && k < ranges.size(); ++k)
-            {
-                assert(reg.lower_coord.size() == reg.upper_coord.size());
-                uint16_t attr = UINT16_MAX;
-
-                for (size_t l = 0; l < s->subspaces[i].attrs.size(); ++l)
-                {
-                    if (s->subspaces[i].attrs[l] == ranges[k].attr)
-                    {
-                        attr = l;
-                        break;
-                    }
-                }
-
-                if (attr == UINT16_MAX)
-                {
-                    continue;
-                }
-
-                if (attr >= reg.lower_coord.size() ||
-                    reg.lower_coord[attr] > reg.upper_coord[attr])
-                {
-                    servers->clear();
-                    return;
-                }
-
-                if (ranges[k].type == HYPERDATATYPE_STRING &&
-                    ranges[k].has_start && ranges[k].has_end &&
-                    ranges[k].start == ranges[k].end)
-                {
-                    uint64_t h = hash(ranges[k].type, ranges[k].start);
-
-                    if (reg.lower_coord[attr] > h ||
-                        reg.upper_coord[attr] < h)
-                    {
-                        exclude = true;
-                    }
-                }
-
-                if (ranges[k].type == HYPERDATATYPE_INT64 ||
-                    ranges[k].type == HYPERDATATYPE_FLOAT)
-                {
-                    if (ranges[k].has_start)
-                    {
-                        uint64_t h = hash(ranges[k].type, ranges[k].start);
-
-                        if (reg.upper_coord[attr] < h)
-                        {
-                            exclude = true;
-                        }
-                    }
-
-                    if (ranges[k].has_end)
-                    {
-                        uint64_t h = hash(ranges[k].type, ranges[k].end);
+            servers->clear();
+            return;
+        }
 
-                        if (reg.lower_coord[attr] > h)
-                        {
-                            exclude = true;
-                        }
-                    }
-                }
-            }
+        std::vector<virtual_server_id> this_server_set;
+        std::vector<const region*> contacted;
 
-            if (!exclude)
+        for (size_t j = 0; j < regions.size(); ++j)
+        {
+            if (!regions[j]->replicas.empty())
             {
-                this_server_set.push_back(reg.replicas.back().vsi);
+                this_server_set.push_back(regions[j]->replicas.back().vsi);
+                contacted.push_back(regions[j]);
             }
         }
 
+        const double work = search_work(s->subspaces[i], contacted);
+
         if (!initialized ||
             (!this_server_set.empty() &&
-             this_server_set.size() <= smallest_server_set.size()))
+             (work < least_work ||
+              (work == least_work &&
+               this_server_set.size() <= smallest_server_set.size()))))
         {
             smallest_server_set.swap(this_server_set);
+            least_work = work;
             initialized = true;
         }
     }
@@ -868,6 +1120,30 @@ configuration :: lookup_search(const char* space_name,
     servers->swap(smallest_server_set);
 }
 
+void
+configuration :: lookup_changes(const char* space_name,
+                                std::vector<virtual_server_id>* servers) const
+{
+    const space* s = find_space(space_name);
+    servers->clear();
+
+    if (!s || s->subspaces.empty())
+    {
+        return;
+    }
+
+    // in the key subspace no write moves an object from one region to another
+    const subspace& ss(s->subspaces[0]);
+
+    for (size_t i = 0; i < ss.regions.size(); ++i)
+    {
+        if (!ss.regions[i].replicas.empty())
+        {
+            servers->push_back(ss.regions[i].replicas.back().vsi);
+        }
+    }
+}
+
 std::string
 configuration :: list_indices(const char* space_name) const
 {
@@ -893,6 +1169,13 @@ configuration :: list_indices(const char* space_name) const
     {
         out << it->id.get() << ":";
         out << s.get_attribute(it->attr).name;
+
+        if (it->partial())
+        {
+            out << " ";
+            describe_filter(out, s.sc, *it);
+        }
+
         out << "\n";
     }
 
@@ -945,6 +1228,7 @@ configuration :: dump() const
     out << "cluster " << m_cluster << "\n";
     out << "version " << m_version << "\n";
     out << "flags " << std::hex << m_flags << std::dec << "\n";
+    out << "transfer_rate " << m_transfer_rate << "\n";
 
     for (size_t i = 0; i < m_servers.size(); ++i)
     {
@@ -974,6 +1258,52 @@ configuration :: dump() const
             out << "    with authorization\n";
         }
 
+        if (s.sc.durability == DURABILITY_SYNC)
+        {
+            out << "    with durability sync\n";
+        }
+        else if (s.sc.durability == DURABILITY_GROUP)
+        {
+            out << "    with durability group\n";
+        }
+        else if (s.sc.durability == DURABILITY_MEMORY)
+        {
+            out << "    with durability memory\n";
+        }
+
+        if (s.sc.expiry != 0)
+        {
+            out << "    with expiry " << s.sc.attrs[s.sc.expiry].name << "\n";
+        }
+
+        if (s.sc.ordered_key)
+        {
+            out << "    with ordered key\n";
+        }
+
+        if (s.sc.compressed)
+        {
+            out << "    with compression\n";
+        }
+
+        if (s.sc.bucket_attr != 0)
+        {
+            out << "    bucket " << s.sc.attrs[s.sc.bucket_attr].name
+                << " by " << s.sc.bucket_width << "us\n";
+        }
+
+        if (s.sc.immutable)
+        {
+            out << "  immutable\n";
+        }
+
+        if (s.sc.quota_ops != 0 || s.sc.quota_bytes != 0 || s.sc.quota_client_ops != 0)
+        {
+            out << "  quota " << s.sc.quota_ops << " ops/s "
+                << s.sc.quota_bytes << " bytes/s "
+                << s.sc.quota_client_ops << " ops/s per client\n";
+        }
+
         for (size_t x = 0; x < s.subspaces.size(); ++x)
         {
             const subspace& ss(s.subspaces[x]);
@@ -1027,6 +1357,43 @@ configuration :: dump() const
             {
                 out << " " << idx.extra.str();
             }
+            else if (idx.type == index::TRIGRAM)
+            {
+                out << " trigram";
+            }
+            else if (idx.type == index::HASHED)
+            {
+                out << " hashed";
+            }
+            else if (idx.type == index::COMPOSITE)
+            {
+                out << " composite";
+
+                for (size_t i = 1; i < idx.composite_sz(); ++i)
+                {
+                    out << " " << idx.composite(i);
+                }
+            }
+            else if (idx.type == index::SPATIAL)
+            {
+                out << " spatial";
+
+                for (size_t i = 1; i < idx.composite_sz(); ++i)
+                {
+                    out << " " << idx.composite(i);
+                }
+            }
+
+            for (size_t i = 0; i < idx.included_sz(); ++i)
+            {
+                out << (i == 0 ? " include " : " ") << idx.included(i);
+            }
+
+            if (idx.partial())
+            {
+                out << " ";
+                describe_filter(out, s.sc, idx);
+            }
 
             out << "\n";
         }
@@ -1064,6 +1431,7 @@ configuration :: operator = (const configuration& rhs)
     m_cluster = rhs.m_cluster;
     m_version = rhs.m_version;
     m_flags = rhs.m_flags;
+    m_transfer_rate = rhs.m_transfer_rate;
     m_servers = rhs.m_servers;
     m_region_ids_by_virtual = rhs.m_region_ids_by_virtual;
     m_server_ids_by_virtual = rhs.m_server_ids_by_virtual;
@@ -1082,6 +1450,33 @@ configuration :: operator = (const configuration& rhs)
     return *this;
 }
 
+bool
+configuration :: same_region_layout(const configuration& other, const region_id& ri) const
+{
+    const region* lhs = get_region(ri);
+    const region* rhs = other.get_region(ri);
+
+    if (!lhs || !rhs ||
+        lhs->lower_coord != rhs->lower_coord ||
+        lhs->upper_coord != rhs->upper_coord ||
+        lhs->replicas.size() != rhs->replicas.size() ||
+        fault_tolerance_of_region(ri) != other.fault_tolerance_of_region(ri))
+    {
+        return false;
+    }
+
+    for (size_t r = 0; r < lhs->replicas.size(); ++r)
+    {
+        if (lhs->replicas[r].si != rhs->replicas[r].si ||
+            lhs->replicas[r].vsi != rhs->replicas[r].vsi)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 void
 configuration :: refill_cache()
 {
@@ -1096,14 +1491,20 @@ configuration :: refill_cache()
     m_tails_by_region.clear();
     m_next_by_virtual.clear();
     m_point_leaders_by_virtual.clear();
+    m_spaces_by_name.clear();
+    m_spaces_by_region.clear();
+    m_subspaces_by_id.clear();
+    m_regions_by_coordinate.clear();
 
     for (size_t w = 0; w < m_spaces.size(); ++w)
     {
         space& s(m_spaces[w]);
+        m_spaces_by_name.push_back(std::make_pair(s.name, &s));
 
         for (size_t x = 0; x < s.subspaces.size(); ++x)
         {
             subspace& ss(s.subspaces[x]);
+            m_subspaces_by_id.push_back(std::make_pair(ss.id.get(), &ss));
 
             if (x > 0)
             {
@@ -1123,6 +1524,13 @@ configuration :: refill_cache()
                 m_schemas_by_region.push_back(std::make_pair(r.id.get(), &s.sc));
                 m_subspaces_by_region.push_back(std::make_pair(r.id.get(), &ss));
                 m_subspace_ids_by_region.push_back(std::make_pair(r.id.get(), ss.id.get()));
+                m_spaces_by_region.push_back(std::make_pair(r.id.get(), &s));
+
+                if (ss.attrs.size() == 1 && r.lower_coord.size() == 1)
+                {
+                    pair_uint64_t coord(ss.id.get(), r.lower_coord[0]);
+                    m_regions_by_coordinate.push_back(coordinate_region_t(coord, &r));
+                }
 
                 if (r.replicas.empty())
                 {
@@ -1175,6 +1583,100 @@ configuration :: refill_cache()
     std::sort(m_tails_by_region.begin(), m_tails_by_region.end());
     std::sort(m_next_by_virtual.begin(), m_next_by_virtual.end());
     std::sort(m_point_leaders_by_virtual.begin(), m_point_leaders_by_virtual.end());
+    std::sort(m_spaces_by_name.begin(), m_spaces_by_name.end(), compare_space_names);
+    std::sort(m_spaces_by_region.begin(), m_spaces_by_region.end());
+    std::sort(m_subspaces_by_id.begin(), m_subspaces_by_id.end());
+    std::sort(m_regions_by_coordinate.begin(), m_regions_by_coordinate.end(), compare_coordinates);
+}
+
+const hyperdex::space*
+configuration :: find_space(const char* name) const
+{
+    std::vector<name_space_t>::const_iterator it;
+    it = std::lower_bound(m_spaces_by_name.begin(),
+                          m_spaces_by_name.end(),
+                          name_space_t(name, NULL),
+                          compare_space_names);
+
+    if (it != m_spaces_by_name.end() && strcmp(it->first, name) == 0)
+    {
+        return it->second;
+    }
+
+    return NULL;
+}
+
+const subspace*
+configuration :: find_subspace(const subspace_id& ssid) const
+{
+    std::vector<uint64_subspace_t>::const_iterator it;
+    it = std::lower_bound(m_subspaces_by_id.begin(),
+                          m_subspaces_by_id.end(),
+                          uint64_subspace_t(ssid.get(), NULL));
+
+    if (it != m_subspaces_by_id.end() && it->first == ssid.get())
+    {
+        return it->second;
+    }
+
+    return NULL;
+}
+
+const region*
+configuration :: find_region(const subspace& ss,
+                             const std::vector<uint64_t>& hashes) const
+{
+    if (ss.attrs.size() == 1)
+    {
+        assert(ss.attrs[0] < hashes.size());
+        return find_region(ss, hashes[ss.attrs[0]]);
+    }
+
+    for (size_t r = 0; r < ss.regions.size(); ++r)
+    {
+        bool matches = true;
+
+        for (size_t a = 0; matches && a < ss.attrs.size(); ++a)
+        {
+            assert(ss.attrs[a] < hashes.size());
+            matches &= ss.regions[r].lower_coord[a] <= hashes[ss.attrs[a]] &&
+                       hashes[ss.attrs[a]] <= ss.regions[r].upper_coord[a];
+        }
+
+        if (matches)
+        {
+            return &ss.regions[r];
+        }
+    }
+
+    return NULL;
+}
+
+const region*
+configuration :: find_region(const subspace& ss, uint64_t h) const
+{
+    // the regions of a single-attribute subspace are disjoint intervals, so
+    // the only candidate is the one starting at or just below h
+    std::vector<coordinate_region_t>::const_iterator it;
+    it = std::upper_bound(m_regions_by_coordinate.begin(),
+                          m_regions_by_coordinate.end(),
+                          coordinate_region_t(pair_uint64_t(ss.id.get(), h), NULL),
+                          compare_coordinates);
+
+    if (it == m_regions_by_coordinate.begin())
+    {
+        return NULL;
+    }
+
+    --it;
+
+    if (it->first.first != ss.id.get() ||
+        h > it->second->upper_coord[0])
+    {
+        return NULL;
+    }
+
+    return it->second;
 }
 
 e::unpacker
@@ -1183,7 +1685,7 @@ hyperdex :: operator >> (e::unpacker up, configuration& c)
     uint64_t num_servers = 0;
     uint64_t num_spaces = 0;
     uint64_t num_transfers = 0;
-    up = up >> c.m_cluster >> c.m_version >> c.m_flags
+    up = up >> c.m_cluster >> c.m_version >> c.m_flags >> c.m_transfer_rate
             >> num_servers >> num_spaces
             >> num_transfers;
     c.m_servers.clear();
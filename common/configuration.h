@@ -62,6 +62,8 @@ class configuration
         uint64_t cluster() const;
         uint64_t version() const;
         bool read_only() const;
+        // bytes/second each daemon may spend on state transfer; 0 is no limit
+        uint64_t transfer_rate() const;
 
     // membership metadata
     public:
@@ -76,7 +78,12 @@ class configuration
     public:
         const schema* get_schema(const char* space) const;
         const schema* get_schema(const region_id& ri) const;
+        // the name of the space ri belongs to, or NULL
+        const char* get_space_name(const region_id& ri) const;
+        // the space ri belongs to, or space_id() if none
+        space_id space_of(const region_id& ri) const;
         const subspace* get_subspace(const region_id& ri) const;
+        const region* get_region(const region_id& ri) const;
         virtual_server_id get_virtual(const region_id& ri, const server_id& si) const;
         subspace_id subspace_of(const region_id& ri) const;
         subspace_id subspace_prev(const subspace_id& ss) const;
@@ -84,10 +91,18 @@ class configuration
         virtual_server_id head_of_region(const region_id& ri) const;
         virtual_server_id tail_of_region(const region_id& ri) const;
         virtual_server_id next_in_region(const virtual_server_id& vsi) const;
+        // the chain of ri, head first
+        void replicas_of_region(const region_id& ri, std::vector<virtual_server_id>* replicas) const;
+        uint64_t fault_tolerance_of_region(const region_id& ri) const;
         void point_leaders(const server_id& s, std::vector<region_id>* servers) const;
         void key_regions(const server_id& s, std::vector<region_id>* servers) const;
         bool is_point_leader(const virtual_server_id& e) const;
         virtual_server_id point_leader(const char* space, const e::slice& key) const;
+        // leaders[i] = point_leader(space, keys[i]), looking the space up
+        // and hashing the keys as one batch
+        void point_leader(const char* space,
+                          const e::slice* keys, size_t keys_sz,
+                          virtual_server_id* leaders) const;
         // point leader for this key in the same space as ri
         virtual_server_id point_leader(const region_id& ri, const e::slice& key) const;
         // lhs and rhs are in adjacent subspaces such that lhs sends CHAIN_PUT
@@ -95,6 +110,17 @@ class configuration
         bool subspace_adjacent(const virtual_server_id& lhs, const virtual_server_id& rhs) const;
         // mapped regions -- regions mapped for server "us"
         void mapped_regions(const server_id& s, std::vector<region_id>* servers) const;
+        // regions s maps in both prev and this configuration whose bounds
+        // shrank because the coordinator split them
+        void split_regions(const configuration& prev, const server_id& s,
+                           std::vector<region_id>* regions) const;
+        // true if s maps the same regions, with the same bounds, chains,
+        // indices and transfers, under the same flags in both configurations
+        bool same_local_layout(const configuration& other, const server_id& s) const;
+        // regions s maps in both prev and this configuration with the same
+        // bounds, chain and fault tolerance in each
+        void unchanged_regions(const configuration& prev, const server_id& s,
+                               std::vector<region_id>* regions) const;
 
     // index metadata
     public:
@@ -119,6 +145,9 @@ class configuration
         void lookup_search(const char* space,
                            const std::vector<attribute_check>& chks,
                            std::vector<virtual_server_id>* servers) const;
+        // the tail of each region of the key subspace
+        void lookup_changes(const char* space,
+                            std::vector<virtual_server_id>* servers) const;
 
     public:
         std::string dump() const;
@@ -142,6 +171,14 @@ class configuration
 
     private:
         void refill_cache();
+        const space* find_space(const char* name) const;
+        const subspace* find_subspace(const subspace_id& ssid) const;
+        // the region of ss holding the point; O(log n) when ss has a
+        // single attribute, a scan of ss's regions otherwise
+        const region* find_region(const subspace& ss,
+                                  const std::vector<uint64_t>& hashes) const;
+        const region* find_region(const subspace& ss, uint64_t h) const;
+        bool same_region_layout(const configuration& other, const region_id& ri) const;
         friend size_t pack_size(const configuration&);
         friend e::packer operator << (e::packer, const configuration& s);
         friend e::unpacker operator >> (e::unpacker, configuration& s);
@@ -151,11 +188,16 @@ class configuration
         typedef std::pair<uint64_t, schema*> uint64_schema_t;
         typedef std::pair<uint64_t, subspace*> uint64_subspace_t;
         typedef std::pair<uint64_t, po6::net::location> uint64_location_t;
+        typedef std::pair<const char*, const space*> name_space_t;
+        typedef std::pair<uint64_t, const space*> uint64_space_t;
+        // (subspace, lower coordinate) for single-attribute subspaces
+        typedef std::pair<pair_uint64_t, const region*> coordinate_region_t;
 
     private:
         uint64_t m_cluster;
         uint64_t m_version;
         uint64_t m_flags;
+        uint64_t m_transfer_rate;
         std::vector<server> m_servers;
         std::vector<pair_uint64_t> m_region_ids_by_virtual;
         std::vector<pair_uint64_t> m_server_ids_by_virtual;
@@ -168,6 +210,10 @@ class configuration
         std::vector<pair_uint64_t> m_tails_by_region;
         std::vector<pair_uint64_t> m_next_by_virtual;
         std::vector<uint64_t> m_point_leaders_by_virtual;
+        std::vector<name_space_t> m_spaces_by_name;
+        std::vector<uint64_space_t> m_spaces_by_region;
+        std::vector<uint64_subspace_t> m_subspaces_by_id;
+        std::vector<coordinate_region_t> m_regions_by_coordinate;
         std::vector<space> m_spaces;
         std::vector<transfer> m_transfers;
 };
@@ -25,6 +25,9 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+// STL
+#include <sstream>
+
 // e
 #include <e/guard.h>
 
@@ -371,6 +374,14 @@ datatype_document :: document() const
 bool
 datatype_document :: document_check(const attribute_check& check,
                                     const e::slice& doc) const
+{
+    reader r(this, doc);
+    return document_check(check, &r);
+}
+
+bool
+datatype_document :: document_check(const attribute_check& check,
+                                    reader* doc) const
 {
     // We expected the follwing format:
     // <path>\0\n<value>
@@ -384,15 +395,45 @@ datatype_document :: document_check(const attribute_check& check,
     }
 
     hyperdatatype type;
-    std::vector<char> scratch;
     e::slice value;
 
-    if (!extract_value(path, doc, &type, &scratch, &value))
+    if (!doc->extract(path, &type, &value))
     {
         return false;
     }
 
-    if(type == HYPERDATATYPE_DOCUMENT)
+    if (type == HYPERDATATYPE_DOCUMENT &&
+        check.predicate == HYPERPREDICATE_CONTAINS)
+    {
+        // An array contains the value if any of its elements equals it
+        attribute_check elem_check;
+        elem_check.attr      = check.attr;
+        elem_check.value     = check.value;
+        elem_check.datatype  = check.datatype;
+        elem_check.predicate = HYPERPREDICATE_EQUALS;
+        elem_check.value.advance(path_sz + 1);
+
+        for (size_t i = 0; i < DOCUMENT_MAX_ARRAY_ELEMENTS; ++i)
+        {
+            hyperdatatype elem_type;
+            e::slice elem;
+
+            if (!doc->extract_element(path, i, &elem_type, &elem))
+            {
+                break;
+            }
+
+            if (elem_type == HYPERDATATYPE_DOCUMENT
+                ? elem == elem_check.value
+                : passes_attribute_check(elem_type, elem_check, elem))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+    else if(type == HYPERDATATYPE_DOCUMENT)
     {
         // Compare two subdocuments
         e::slice chk_value = check.value;
@@ -428,6 +469,16 @@ datatype_document :: extract_value(const char* path,
     }
 
     e::guard transg = e::makeguard(treadstone_transformer_destroy, trans);
+    return extract_value(trans, path, type, scratch, value);
+}
+
+bool
+datatype_document :: extract_value(struct treadstone_transformer* trans,
+                                   const char* path,
+                                   hyperdatatype* type,
+                                   std::vector<char>* scratch,
+                                   e::slice* value) const
+{
     unsigned char* v = NULL;
     size_t v_sz = 0;
     e::guard g = e::makeguard(free_if_allocated, &v);
@@ -522,3 +573,67 @@ datatype_document :: coerce_binary_to_primitive(const e::slice& in,
 
     return true;
 }
+
+datatype_document :: reader :: reader(const datatype_document* dd, const e::slice& doc)
+    : m_dd(dd)
+    , m_trans(treadstone_transformer_create(doc.data(), doc.size()))
+    , m_extracted()
+{
+}
+
+datatype_document :: reader :: ~reader() throw ()
+{
+    if (m_trans)
+    {
+        treadstone_transformer_destroy(m_trans);
+    }
+}
+
+bool
+datatype_document :: reader :: extract(const char* path,
+                                       hyperdatatype* type,
+                                       e::slice* value)
+{
+    if (!m_trans)
+    {
+        return false;
+    }
+
+    std::list<extracted>::iterator it = m_extracted.begin();
+
+    while (it != m_extracted.end() && it->path != path)
+    {
+        ++it;
+    }
+
+    if (it == m_extracted.end())
+    {
+        it = m_extracted.insert(m_extracted.end(), extracted());
+        it->path = path;
+        it->found = m_dd->extract_value(m_trans, path, &it->type, &it->scratch, &it->value);
+    }
+
+    *type = it->type;
+    *value = it->value;
+    return it->found;
+}
+
+bool
+datatype_document :: reader :: extract_element(const char* path, size_t i,
+                                               hyperdatatype* type,
+                                               e::slice* value)
+{
+    if (!m_trans)
+    {
+        return false;
+    }
+
+    std::ostringstream ostr;
+    ostr << path << "[" << i << "]";
+    std::list<extracted>::iterator it = m_extracted.insert(m_extracted.end(), extracted());
+    it->path = ostr.str();
+    it->found = m_dd->extract_value(m_trans, it->path.c_str(), &it->type, &it->scratch, &it->value);
+    *type = it->type;
+    *value = it->value;
+    return it->found;
+}
@@ -28,14 +28,27 @@
 #ifndef hyperdex_common_datatype_document_h_
 #define hyperdex_common_datatype_document_h_
 
+// C++
+#include <list>
+#include <string>
+
 // HyperDex
 #include "namespace.h"
 #include "common/datatype_info.h"
 
+struct treadstone_transformer;
+
+// The most elements of an array within a document that a check or an index
+// will look at; later elements are neither matched nor indexed.
+#define DOCUMENT_MAX_ARRAY_ELEMENTS 1024
+
 BEGIN_HYPERDEX_NAMESPACE
 
 class datatype_document : public datatype_info
 {
+    public:
+        class reader;
+
     public:
         datatype_document();
         virtual ~datatype_document() throw ();
@@ -61,6 +74,8 @@ class datatype_document : public datatype_info
         virtual bool document() const;
         virtual bool document_check(const attribute_check& check,
                                     const e::slice& value) const;
+        bool document_check(const attribute_check& check,
+                            reader* doc) const;
 
     public:
         bool extract_value(const char* path,
@@ -70,6 +85,11 @@ class datatype_document : public datatype_info
                            e::slice* value) const;
 
     private:
+        bool extract_value(struct treadstone_transformer* trans,
+                           const char* path,
+                           hyperdatatype* type,
+                           std::vector<char>* scratch,
+                           e::slice* value) const;
         void coerce_primitive_to_binary(hyperdatatype type,
                                         const e::slice& in,
                                         std::vector<char>* scratch,
@@ -80,6 +100,47 @@ class datatype_document : public datatype_info
                                         e::slice* value) const;
 };
 
+// Parses a document once and remembers every path extracted from it, so that
+// several checks against the same document do not each re-parse it.
+class datatype_document::reader
+{
+    public:
+        reader(const datatype_document* dd, const e::slice& doc);
+        ~reader() throw ();
+
+    public:
+        // "value" remains valid for the lifetime of the reader
+        bool extract(const char* path,
+                     hyperdatatype* type,
+                     e::slice* value);
+        // extract element "i" of the array at "path"; false past its end or
+        // if "path" is not an array.  Elements are not remembered by path,
+        // so read each one once.
+        bool extract_element(const char* path, size_t i,
+                             hyperdatatype* type,
+                             e::slice* value);
+
+    private:
+        struct extracted
+        {
+            extracted() : path(), found(false), type(HYPERDATATYPE_GARBAGE), scratch(), value() {}
+            std::string path;
+            bool found;
+            hyperdatatype type;
+            std::vector<char> scratch;
+            e::slice value;
+        };
+
+    private:
+        const datatype_document* m_dd;
+        struct treadstone_transformer* m_trans;
+        std::list<extracted> m_extracted;
+
+    private:
+        reader(const reader&);
+        reader& operator = (const reader&);
+};
+
 END_HYPERDEX_NAMESPACE
 
 #endif // hyperdex_common_datatype_document_h_
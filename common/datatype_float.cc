@@ -125,13 +125,11 @@ datatype_float :: check_args(const funcall& func) const
             func.name == FUNC_NUM_MIN);
 }
 
-bool
-datatype_float :: apply(const e::slice& old_value,
-                        const funcall* funcs, size_t funcs_sz,
-                        e::arena* new_memory,
-                        e::slice* new_value) const
+void
+datatype_float :: apply_number(double* _number,
+                               const funcall* funcs, size_t funcs_sz)
 {
-    double number = unpack(old_value);
+    double number = *_number;
 
     for (size_t i = 0; i < funcs_sz; ++i)
     {
@@ -185,6 +183,18 @@ datatype_float :: apply(const e::slice& old_value,
         }
     }
 
+    *_number = number;
+}
+
+bool
+datatype_float :: apply(const e::slice& old_value,
+                        const funcall* funcs, size_t funcs_sz,
+                        e::arena* new_memory,
+                        e::slice* new_value) const
+{
+    double number = unpack(old_value);
+    apply_number(&number, funcs, funcs_sz);
+
     uint8_t* ptr = NULL;
     new_memory->allocate(sizeof(double), &ptr);
     e::packdoublele(number, ptr);
@@ -41,6 +41,9 @@ class datatype_float : public datatype_info
         static double unpack(const funcall& value);
         static void pack(double num, std::vector<char>* scratch, e::slice* value);
         static bool static_validate(const e::slice& value);
+        // the arithmetic of apply, without going through a slice
+        static void apply_number(double* number,
+                                 const funcall* funcs, size_t funcs_sz);
 
     public:
         datatype_float();
@@ -132,12 +132,10 @@ datatype_int64 :: check_args(const funcall& func) const
 }
 
 bool
-datatype_int64 :: apply(const e::slice& old_value,
-                        const funcall* funcs, size_t funcs_sz,
-                        e::arena* new_memory,
-                        e::slice* new_value) const
+datatype_int64 :: apply_number(int64_t* _number,
+                               const funcall* funcs, size_t funcs_sz)
 {
-    int64_t number = unpack(old_value);
+    int64_t number = *_number;
 
     for (size_t i = 0; i < funcs_sz; ++i)
     {
@@ -214,6 +212,23 @@ datatype_int64 :: apply(const e::slice& old_value,
         }
     }
 
+    *_number = number;
+    return true;
+}
+
+bool
+datatype_int64 :: apply(const e::slice& old_value,
+                        const funcall* funcs, size_t funcs_sz,
+                        e::arena* new_memory,
+                        e::slice* new_value) const
+{
+    int64_t number = unpack(old_value);
+
+    if (!apply_number(&number, funcs, funcs_sz))
+    {
+        return false;
+    }
+
     uint8_t* ptr = NULL;
     new_memory->allocate(sizeof(int64_t), &ptr);
     e::pack64le(number, ptr);
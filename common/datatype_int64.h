@@ -41,6 +41,10 @@ class datatype_int64 : public datatype_info
         static int64_t unpack(const funcall& func);
         static void pack(int64_t num, std::vector<char>* scratch, e::slice* value);
         static bool static_validate(const e::slice& value);
+        // the arithmetic of apply, without going through a slice; false on
+        // overflow
+        static bool apply_number(int64_t* number,
+                                 const funcall* funcs, size_t funcs_sz);
 
     public:
         datatype_int64();
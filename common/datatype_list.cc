@@ -29,9 +29,7 @@
 
 // C
 #include <cstdlib>
-
-// STL
-#include <list>
+#include <cstring>
 
 // e
 #include <e/endian.h>
@@ -94,40 +92,22 @@ datatype_list :: apply(const e::slice& old_value,
                        e::arena* new_memory,
                        e::slice* new_value) const
 {
-    std::list<e::slice> list;
-    const uint8_t* ptr = old_value.data();
-    const uint8_t* end = old_value.data() + old_value.size();
-    e::slice elem;
-
-    while (ptr < end)
-    {
-        bool stepped = m_elem->step(&ptr, end, &elem);
-        assert(stepped); // safe because of check_args
-        list.push_back(elem);
-    }
+    // Only the last FUNC_SET matters, and every push after it lands at one
+    // end of that list, so the encoded list is copied whole between the
+    // pushed elements without stepping through what it holds.
+    e::slice base = old_value;
+    size_t first = 0;
 
     for (size_t i = 0; i < funcs_sz; ++i)
     {
         switch (funcs[i].name)
         {
             case FUNC_SET:
-                list.clear();
-                ptr = funcs[i].arg1.data();
-                end = funcs[i].arg1.data() + funcs[i].arg1.size();
-
-                while (ptr < end)
-                {
-                    bool stepped = m_elem->step(&ptr, end, &elem);
-                    assert(stepped); // safe because of check_args
-                    list.push_back(elem);
-                }
-
+                base = funcs[i].arg1;
+                first = i + 1;
                 break;
             case FUNC_LIST_LPUSH:
-                list.push_front(funcs[i].arg1);
-                break;
             case FUNC_LIST_RPUSH:
-                list.push_back(funcs[i].arg1);
                 break;
             case FUNC_FAIL:
             case FUNC_STRING_APPEND:
@@ -157,20 +137,35 @@ datatype_list :: apply(const e::slice& old_value,
         }
     }
 
-    size_t sz = 0;
+    size_t sz = base.size();
 
-    for (std::list<e::slice>::iterator i = list.begin(); i != list.end(); ++i)
+    for (size_t i = first; i < funcs_sz; ++i)
     {
-        sz += m_elem->write_sz(*i);
+        sz += m_elem->write_sz(funcs[i].arg1);
     }
 
     uint8_t* write_to = NULL;
     new_memory->allocate(sz, &write_to);
     *new_value = e::slice(write_to, sz);
 
-    for (std::list<e::slice>::iterator i = list.begin(); i != list.end(); ++i)
+    // the last LPUSH ends up at the front
+    for (size_t i = funcs_sz; i > first; --i)
     {
-        write_to = m_elem->write(*i, write_to);
+        if (funcs[i - 1].name == FUNC_LIST_LPUSH)
+        {
+            write_to = m_elem->write(funcs[i - 1].arg1, write_to);
+        }
+    }
+
+    memmove(write_to, base.data(), base.size());
+    write_to += base.size();
+
+    for (size_t i = first; i < funcs_sz; ++i)
+    {
+        if (funcs[i].name == FUNC_LIST_RPUSH)
+        {
+            write_to = m_elem->write(funcs[i].arg1, write_to);
+        }
     }
 
     return true;
@@ -27,6 +27,9 @@
 
 #define __STDC_LIMIT_MACROS
 
+// C
+#include <cstring>
+
 // STL
 #include <algorithm>
 
@@ -150,51 +153,37 @@ datatype_map :: apply(const e::slice& old_value,
                       e::arena* new_memory,
                       e::slice* new_value) const
 {
-    // Initialize map with the compare operator of the key's datatype
-    map_t map(m_k->compare_less());
-
-    const uint8_t* ptr = old_value.data();
-    const uint8_t* end = old_value.data() + old_value.size();
-    e::slice key;
-    e::slice val;
-
-    // Read previous data into the map
-    while (ptr < end)
-    {
-        bool stepped;
-        stepped = m_k->step(&ptr, end, &key);
-        assert(stepped);
-        stepped = m_v->step(&ptr, end, &val);
-        assert(stepped);
-        map.insert(std::make_pair(key, val));
-    }
+    // Each function splices its pair into the encoded map, leaving the
+    // other pairs as they are rather than decoding and re-encoding them
+    e::slice map = old_value;
+    bool copied = false;
 
     for (size_t i = 0; i < funcs_sz; ++i)
     {
+        size_t start = 0;
+        size_t stop = 0;
+        e::slice val;
+
         switch (funcs[i].name)
         {
             case FUNC_SET:
-                // Discard current content and insert a new key-value-pair
-                map.clear();
-                ptr = funcs[i].arg1.data();
-                end = funcs[i].arg1.data() + funcs[i].arg1.size();
-
-                while (ptr < end)
-                {
-                    bool stepped;
-                    stepped = m_k->step(&ptr, end, &key);
-                    assert(stepped);
-                    stepped = m_v->step(&ptr, end, &val);
-                    assert(stepped);
-                    map.insert(std::make_pair(key, val));
-                }
-
+                // Discard current content for the new map as given
+                map = funcs[i].arg1;
+                copied = false;
                 break;
             case FUNC_MAP_ADD:
-                map[funcs[i].arg2] = funcs[i].arg1;
+                locate(map, funcs[i].arg2, &start, &stop, &val);
+                splice(map, start, stop, &funcs[i].arg2, &funcs[i].arg1,
+                       new_memory, &map);
+                copied = true;
                 break;
             case FUNC_MAP_REMOVE:
-                map.erase(funcs[i].arg1);
+                if (locate(map, funcs[i].arg1, &start, &stop, &val))
+                {
+                    splice(map, start, stop, NULL, NULL, new_memory, &map);
+                    copied = true;
+                }
+
                 break;
             case FUNC_STRING_APPEND:
             case FUNC_STRING_PREPEND:
@@ -211,11 +200,12 @@ datatype_map :: apply(const e::slice& old_value,
             case FUNC_NUM_OR:
             case FUNC_NUM_XOR:
                 // This function is a composite of several subfunctions
-                if (!apply_inner(&map, funcs + i, new_memory))
+                if (!apply_inner(map, funcs + i, new_memory, &map))
                 {
                     return false;
                 }
 
+                copied = true;
                 break;
             case FUNC_FAIL:
             case FUNC_LIST_LPUSH:
@@ -231,38 +221,132 @@ datatype_map :: apply(const e::slice& old_value,
         }
     }
 
-    size_t sz = 0;
+    if (copied)
+    {
+        *new_value = map;
+        return true;
+    }
 
-    for (map_t::iterator i = map.begin(); i != map.end(); ++i)
+    uint8_t* write_to = NULL;
+    new_memory->allocate(map.size(), &write_to);
+    memmove(write_to, map.data(), map.size());
+    *new_value = e::slice(write_to, map.size());
+    return true;
+}
+
+bool
+datatype_map :: locate(const e::slice& map, const e::slice& key,
+                       size_t* start, size_t* stop, e::slice* val) const
+{
+    const bool fixed_k = m_k->datatype() == HYPERDATATYPE_INT64 ||
+                         m_k->datatype() == HYPERDATATYPE_FLOAT;
+    const bool fixed_v = m_v->datatype() == HYPERDATATYPE_INT64 ||
+                         m_v->datatype() == HYPERDATATYPE_FLOAT;
+
+    // pairs of int64 and float are fixed-width, so bisect the encoding
+    if (fixed_k && fixed_v)
     {
-        sz += m_k->write_sz(i->first);
-        sz += m_v->write_sz(i->second);
+        const size_t width = 2 * sizeof(int64_t);
+        size_t lo = 0;
+        size_t hi = map.size() / width;
+
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            e::slice k(map.data() + mid * width, sizeof(int64_t));
+
+            if (m_k->compare(k, key) < 0)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+
+        *start = lo * width;
+        *stop = *start;
+
+        if (*start < map.size() &&
+            m_k->compare(e::slice(map.data() + *start, sizeof(int64_t)), key) == 0)
+        {
+            *val = e::slice(map.data() + *start + sizeof(int64_t), sizeof(int64_t));
+            *stop = *start + width;
+            return true;
+        }
+
+        return false;
+    }
+
+    const uint8_t* ptr = map.data();
+    const uint8_t* end = map.data() + map.size();
+    e::slice k;
+
+    while (ptr < end)
+    {
+        const uint8_t* here = ptr;
+        bool stepped;
+        stepped = m_k->step(&ptr, end, &k);
+        assert(stepped);
+        stepped = m_v->step(&ptr, end, val);
+        assert(stepped);
+        int cmp = m_k->compare(k, key);
+
+        if (cmp >= 0)
+        {
+            *start = here - map.data();
+            *stop = cmp == 0 ? ptr - map.data() : *start;
+            return cmp == 0;
+        }
+    }
+
+    *start = map.size();
+    *stop = map.size();
+    return false;
+}
+
+void
+datatype_map :: splice(const e::slice& map, size_t start, size_t stop,
+                       const e::slice* key, const e::slice* val,
+                       e::arena* new_memory, e::slice* new_map) const
+{
+    size_t sz = map.size() - (stop - start);
+
+    if (key)
+    {
+        sz += m_k->write_sz(*key) + m_v->write_sz(*val);
     }
 
     uint8_t* write_to = NULL;
     new_memory->allocate(sz, &write_to);
-    *new_value = e::slice(write_to, sz);
+    uint8_t* const base = write_to;
+    memmove(write_to, map.data(), start);
+    write_to += start;
 
-    for (map_t::iterator i = map.begin(); i != map.end(); ++i)
+    if (key)
     {
-        write_to = m_k->write(i->first, write_to);
-        write_to = m_v->write(i->second, write_to);
+        write_to = m_k->write(*key, write_to);
+        write_to = m_v->write(*val, write_to);
     }
 
-    return true;
+    memmove(write_to, map.data() + stop, map.size() - stop);
+    *new_map = e::slice(base, sz);
 }
 
 bool
-datatype_map :: apply_inner(map_t* m,
+datatype_map :: apply_inner(const e::slice& map,
                             const funcall* func,
-                            e::arena* new_memory) const
+                            e::arena* new_memory,
+                            e::slice* new_map) const
 {
-    map_t::iterator it = m->find(func->arg2);
+    size_t start = 0;
+    size_t stop = 0;
     e::slice old_value("", 0);
 
-    if (it != m->end())
+    if (!locate(map, func->arg2, &start, &stop, &old_value))
     {
-        old_value = it->second;
+        old_value = e::slice("", 0);
     }
 
     e::slice new_value;
@@ -272,7 +356,7 @@ datatype_map :: apply_inner(map_t* m,
         return false;
     }
 
-    (*m)[func->arg2] = new_value;
+    splice(map, start, stop, &func->arg2, &new_value, new_memory, new_map);
     return true;
 }
 
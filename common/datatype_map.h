@@ -28,9 +28,6 @@
 #ifndef hyperdex_common_datatype_map_h_
 #define hyperdex_common_datatype_map_h_
 
-// STL
-#include <map>
-
 // e
 #include <e/array_ptr.h>
 
@@ -67,17 +64,24 @@ class datatype_map : public datatype_info
         virtual hyperdatatype contains_datatype() const;
         virtual bool contains(const e::slice& value, const e::slice& needle) const;
 
-    private:
-        typedef std::map<e::slice, e::slice, datatype_info::compares_less> map_t;
-
     private:
         datatype_map(const datatype_map&);
         datatype_map& operator = (const datatype_map&);
 
     private:
-        bool apply_inner(map_t* m,
+        // find key's place in map as the byte range [*start, *stop) of its
+        // pair if present, or the empty range where the pair would go
+        bool locate(const e::slice& map, const e::slice& key,
+                    size_t* start, size_t* stop, e::slice* val) const;
+        // replace [start, stop) of map with the pair (key, val), or with
+        // nothing if key is NULL
+        void splice(const e::slice& map, size_t start, size_t stop,
+                    const e::slice* key, const e::slice* val,
+                    e::arena* new_memory, e::slice* new_map) const;
+        bool apply_inner(const e::slice& map,
                          const funcall* func,
-                         e::arena* new_memory) const;
+                         e::arena* new_memory,
+                         e::slice* new_map) const;
 
     private:
         // Datatype of the keys
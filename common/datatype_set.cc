@@ -29,10 +29,11 @@
 
 // C
 #include <cstdlib>
+#include <cstring>
 
 // STL
 #include <algorithm>
-#include <set>
+#include <iterator>
 
 // e
 #include <e/endian.h>
@@ -111,61 +112,66 @@ datatype_set :: apply(const e::slice& old_value,
                       e::arena* new_memory,
                       e::slice* new_value) const
 {
-    typedef std::set<e::slice, datatype_info::compares_less> set_t;
-    set_t set(m_elem->compare_less());
-    set_t tmp(m_elem->compare_less());
-    const uint8_t* ptr = old_value.data();
-    const uint8_t* end = old_value.data() + old_value.size();
-    e::slice elem;
-
-    while (ptr < end)
+    // the common single add/remove splices the encoded set directly
+    if (funcs_sz == 1 &&
+        (funcs[0].name == FUNC_SET_ADD || funcs[0].name == FUNC_SET_REMOVE))
     {
-        bool stepped = m_elem->step(&ptr, end, &elem);
-        assert(stepped); // safe because of check_args
-        set.insert(elem);
+        return apply_one(old_value, funcs[0], new_memory, new_value);
     }
 
+    // stored sets and set arguments are sorted, so every operation is a
+    // binary search or a linear merge over the slices in place
+    elements_t set;
+    elements_t tmp;
+    elements_t arg;
+    parse(old_value, &set);
+
     for (size_t i = 0; i < funcs_sz; ++i)
     {
+        elements_t::iterator it;
+
         switch (funcs[i].name)
         {
             case FUNC_SET:
-                set.clear();
-                // intentional fall-through
+                parse(funcs[i].arg1, &set);
+                break;
             case FUNC_SET_UNION:
-                ptr = funcs[i].arg1.data();
-                end = funcs[i].arg1.data() + funcs[i].arg1.size();
+                parse(funcs[i].arg1, &arg);
+                tmp.clear();
+                tmp.reserve(set.size() + arg.size());
+                std::set_union(set.begin(), set.end(),
+                               arg.begin(), arg.end(),
+                               std::back_inserter(tmp),
+                               m_elem->compare_less());
+                set.swap(tmp);
+                break;
+            case FUNC_SET_ADD:
+                it = std::lower_bound(set.begin(), set.end(), funcs[i].arg1,
+                                      m_elem->compare_less());
 
-                while (ptr < end)
+                if (it == set.end() || m_elem->compare(*it, funcs[i].arg1) != 0)
                 {
-                    bool stepped = m_elem->step(&ptr, end, &elem);
-                    assert(stepped); // safe because of check_args
-                    set.insert(elem);
+                    set.insert(it, funcs[i].arg1);
                 }
 
-                break;
-            case FUNC_SET_ADD:
-                set.insert(funcs[i].arg1);
                 break;
             case FUNC_SET_REMOVE:
-                set.erase(funcs[i].arg1);
-                break;
-            case FUNC_SET_INTERSECT:
-                tmp.clear();
-                ptr = funcs[i].arg1.data();
-                end = funcs[i].arg1.data() + funcs[i].arg1.size();
+                it = std::lower_bound(set.begin(), set.end(), funcs[i].arg1,
+                                      m_elem->compare_less());
 
-                while (ptr < end)
+                if (it != set.end() && m_elem->compare(*it, funcs[i].arg1) == 0)
                 {
-                    bool stepped = m_elem->step(&ptr, end, &elem);
-                    assert(stepped); // safe because of check_args
-
-                    if (set.find(elem) != set.end())
-                    {
-                        tmp.insert(elem);
-                    }
+                    set.erase(it);
                 }
 
+                break;
+            case FUNC_SET_INTERSECT:
+                parse(funcs[i].arg1, &arg);
+                tmp.clear();
+                std::set_intersection(set.begin(), set.end(),
+                                      arg.begin(), arg.end(),
+                                      std::back_inserter(tmp),
+                                      m_elem->compare_less());
                 set.swap(tmp);
                 break;
             case FUNC_FAIL:
@@ -196,7 +202,7 @@ datatype_set :: apply(const e::slice& old_value,
 
     size_t sz = 0;
 
-    for (set_t::iterator i = set.begin(); i != set.end(); ++i)
+    for (elements_t::iterator i = set.begin(); i != set.end(); ++i)
     {
         sz += m_elem->write_sz(*i);
     }
@@ -205,7 +211,7 @@ datatype_set :: apply(const e::slice& old_value,
     new_memory->allocate(sz, &write_to);
     *new_value = e::slice(write_to, sz);
 
-    for (set_t::iterator i = set.begin(); i != set.end(); ++i)
+    for (elements_t::iterator i = set.begin(); i != set.end(); ++i)
     {
         write_to = m_elem->write(*i, write_to);
     }
@@ -213,6 +219,123 @@ datatype_set :: apply(const e::slice& old_value,
     return true;
 }
 
+void
+datatype_set :: parse(const e::slice& set, elements_t* elems) const
+{
+    const uint8_t* ptr = set.data();
+    const uint8_t* end = set.data() + set.size();
+    e::slice elem;
+    elems->clear();
+
+    while (ptr < end)
+    {
+        bool stepped = m_elem->step(&ptr, end, &elem);
+        assert(stepped); // safe because of check_args
+        elems->push_back(elem);
+    }
+}
+
+bool
+datatype_set :: locate(const e::slice& set, const e::slice& needle,
+                       size_t* start, size_t* stop) const
+{
+    // int64 and float elements are fixed-width, so bisect the encoding
+    if (m_elem->datatype() == HYPERDATATYPE_INT64 ||
+        m_elem->datatype() == HYPERDATATYPE_FLOAT)
+    {
+        const size_t width = sizeof(int64_t);
+        size_t lo = 0;
+        size_t hi = set.size() / width;
+
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+
+            if (m_elem->compare(e::slice(set.data() + mid * width, width), needle) < 0)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+
+        *start = lo * width;
+        *stop = *start;
+
+        if (*start < set.size() &&
+            m_elem->compare(e::slice(set.data() + *start, width), needle) == 0)
+        {
+            *stop = *start + width;
+            return true;
+        }
+
+        return false;
+    }
+
+    const uint8_t* ptr = set.data();
+    const uint8_t* end = set.data() + set.size();
+    e::slice elem;
+
+    while (ptr < end)
+    {
+        const uint8_t* here = ptr;
+        bool stepped = m_elem->step(&ptr, end, &elem);
+        assert(stepped); // safe because of check_args
+        int cmp = m_elem->compare(elem, needle);
+
+        if (cmp >= 0)
+        {
+            *start = here - set.data();
+            *stop = cmp == 0 ? ptr - set.data() : *start;
+            return cmp == 0;
+        }
+    }
+
+    *start = set.size();
+    *stop = set.size();
+    return false;
+}
+
+bool
+datatype_set :: apply_one(const e::slice& old_value, const funcall& func,
+                          e::arena* new_memory, e::slice* new_value) const
+{
+    size_t start = 0;
+    size_t stop = 0;
+    bool found = locate(old_value, func.arg1, &start, &stop);
+    size_t sz = old_value.size();
+
+    if (func.name == FUNC_SET_ADD && !found)
+    {
+        sz += m_elem->write_sz(func.arg1);
+    }
+    else if (func.name == FUNC_SET_REMOVE && found)
+    {
+        sz -= stop - start;
+    }
+
+    uint8_t* write_to = NULL;
+    new_memory->allocate(sz, &write_to);
+    *new_value = e::slice(write_to, sz);
+    memmove(write_to, old_value.data(), start);
+    write_to += start;
+
+    if (func.name == FUNC_SET_ADD && !found)
+    {
+        write_to = m_elem->write(func.arg1, write_to);
+    }
+    else if (func.name == FUNC_SET_ADD || !found)
+    {
+        memmove(write_to, old_value.data() + start, stop - start);
+        write_to += stop - start;
+    }
+
+    memmove(write_to, old_value.data() + stop, old_value.size() - stop);
+    return true;
+}
+
 bool
 datatype_set :: indexable() const
 {
@@ -28,6 +28,9 @@
 #ifndef hyperdex_common_datatype_set_h_
 #define hyperdex_common_datatype_set_h_
 
+// STL
+#include <vector>
+
 // HyperDex
 #include "namespace.h"
 #include "common/datatype_info.h"
@@ -61,6 +64,16 @@ class datatype_set : public datatype_info
         virtual hyperdatatype contains_datatype() const;
         virtual bool contains(const e::slice& value, const e::slice& needle) const;
 
+    private:
+        typedef std::vector<e::slice> elements_t;
+        void parse(const e::slice& set, elements_t* elems) const;
+        // find needle's place in set as the byte range [*start, *stop) that
+        // holds it if present, or the empty range where it would go
+        bool locate(const e::slice& set, const e::slice& needle,
+                    size_t* start, size_t* stop) const;
+        bool apply_one(const e::slice& old_value, const funcall& func,
+                       e::arena* new_memory, e::slice* new_value) const;
+
     private:
         datatype_set(const datatype_set&);
         datatype_set& operator = (const datatype_set&);
@@ -27,8 +27,13 @@
 
 #define __STDC_LIMIT_MACROS
 
+// e
+#include <e/endian.h>
+
 // HyperDex
+#include "common/datatype_float.h"
 #include "common/datatype_info.h"
+#include "common/datatype_int64.h"
 #include "common/funcall.h"
 #include "common/serialization.h"
 
@@ -152,12 +157,44 @@ hyperdex :: apply_funcs(const schema& sc,
         // - we've copied all attributes so far, even those not mentioned by
         //   funcs.
 
-        // This call may modify [op, end) funcs.
-        datatype_info* di = datatype_info::lookup(sc.attrs[op->attr].type);
+        const hyperdatatype type = sc.attrs[op->attr].type;
+        const e::slice& old_attr(old_value[op->attr - 1]);
+        e::slice* new_attr = &(*new_value)[next_to_copy - 1];
+
+        // Counters are the common case, so numbers skip the datatype lookup
+        // and virtual call and are applied in place
+        if (type == HYPERDATATYPE_INT64)
+        {
+            int64_t number = datatype_int64::unpack(old_attr);
+
+            if (!datatype_int64::apply_number(&number, op, end - op))
+            {
+                return (op - &funcs.front());
+            }
 
-        if (!di->apply(old_value[op->attr - 1], op, end - op, new_memory, &(*new_value)[next_to_copy - 1]))
+            uint8_t* ptr = NULL;
+            new_memory->allocate(sizeof(int64_t), &ptr);
+            e::pack64le(number, ptr);
+            *new_attr = e::slice(ptr, sizeof(int64_t));
+        }
+        else if (type == HYPERDATATYPE_FLOAT)
+        {
+            double number = datatype_float::unpack(old_attr);
+            datatype_float::apply_number(&number, op, end - op);
+            uint8_t* ptr = NULL;
+            new_memory->allocate(sizeof(double), &ptr);
+            e::packdoublele(number, ptr);
+            *new_attr = e::slice(ptr, sizeof(double));
+        }
+        else
         {
-            return (op - &funcs.front());
+            // This call may modify [op, end) funcs.
+            datatype_info* di = datatype_info::lookup(type);
+
+            if (!di->apply(old_attr, op, end - op, new_memory, new_attr))
+            {
+                return (op - &funcs.front());
+            }
         }
 
         // Why ++ and assert rather than straight assign?  This will help us to
@@ -27,9 +27,14 @@
 
 #define __STDC_LIMIT_MACROS
 
+// e
+#include <e/endian.h>
+
 // HyperDex
 #include "common/datatype_info.h"
 #include "common/hash.h"
+#include "common/hyperspace.h"
+#include "common/ordered_encoding.h"
 
 uint64_t
 hyperdex :: hash(hyperdatatype t, const e::slice& v)
@@ -45,12 +50,83 @@ hyperdex :: hash(hyperdatatype t, const e::slice& v)
     return di->hash(v);
 }
 
+void
+hyperdex :: hash(hyperdatatype t, const e::slice* vs, size_t vs_sz, uint64_t* hs)
+{
+    datatype_info* di = datatype_info::lookup(t);
+    assert(di);
+
+    if (!di->hashable())
+    {
+        for (size_t i = 0; i < vs_sz; ++i)
+        {
+            hs[i] = 0;
+        }
+
+        return;
+    }
+
+    for (size_t i = 0; i < vs_sz; ++i)
+    {
+        hs[i] = di->hash(vs[i]);
+    }
+}
+
+uint64_t
+hyperdex :: hash_key(const schema& sc, const e::slice& key)
+{
+    // int64 and float already hash in order
+    if (sc.ordered_key && sc.attrs[0].type == HYPERDATATYPE_STRING)
+    {
+        return ordered_encode_bytes(key.cdata(), key.size());
+    }
+
+    return hash(sc.attrs[0].type, key);
+}
+
+void
+hyperdex :: hash_key(const schema& sc, const e::slice* keys, size_t keys_sz, uint64_t* hs)
+{
+    if (sc.ordered_key && sc.attrs[0].type == HYPERDATATYPE_STRING)
+    {
+        for (size_t i = 0; i < keys_sz; ++i)
+        {
+            hs[i] = ordered_encode_bytes(keys[i].cdata(), keys[i].size());
+        }
+
+        return;
+    }
+
+    hash(sc.attrs[0].type, keys, keys_sz, hs);
+}
+
+uint64_t
+hyperdex :: time_bucket(const schema& sc, const e::slice& v)
+{
+    assert(sc.bucket_width > 0);
+    int64_t timestamp = 0;
+
+    if (v.size() == sizeof(int64_t))
+    {
+        e::unpack64le(v.data(), &timestamp);
+    }
+
+    // times before the epoch share the first bucket
+    return timestamp > 0 ? static_cast<uint64_t>(timestamp) / sc.bucket_width : 0;
+}
+
+uint64_t
+hyperdex :: time_bucket_coordinate(uint64_t bucket)
+{
+    return (bucket % TIME_BUCKET_CYCLE) * (UINT64_MAX / TIME_BUCKET_CYCLE + 1);
+}
+
 void
 hyperdex :: hash(const schema& sc,
                  const e::slice& key,
                  uint64_t* h)
 {
-    *h = hash(sc.attrs[0].type, key);
+    *h = hash_key(sc, key);
 }
 
 void
@@ -59,10 +135,39 @@ hyperdex :: hash(const hyperdex::schema& sc,
                  const std::vector<e::slice>& value,
                  uint64_t* hs)
 {
-    hs[0] = hash(sc.attrs[0].type, key);
+    hs[0] = hash_key(sc, key);
 
     for (size_t i = 1; i < sc.attrs_sz; ++i)
     {
-        hs[i] = hash(sc.attrs[i].type, value[i - 1]);
+        hs[i] = i == sc.bucket_attr
+              ? time_bucket_coordinate(time_bucket(sc, value[i - 1]))
+              : hash(sc.attrs[i].type, value[i - 1]);
+    }
+}
+
+void
+hyperdex :: hash(const hyperdex::schema& sc,
+                 const subspace& ss,
+                 const e::slice& key,
+                 const std::vector<e::slice>& value,
+                 uint64_t* hs)
+{
+    for (size_t i = 0; i < ss.attrs.size(); ++i)
+    {
+        const uint16_t attr = ss.attrs[i];
+        assert(attr < sc.attrs_sz);
+
+        if (attr == 0)
+        {
+            hs[attr] = hash_key(sc, key);
+        }
+        else if (attr == sc.bucket_attr)
+        {
+            hs[attr] = time_bucket_coordinate(time_bucket(sc, value[attr - 1]));
+        }
+        else
+        {
+            hs[attr] = hash(sc.attrs[attr].type, value[attr - 1]);
+        }
     }
 }
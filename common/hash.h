@@ -40,9 +40,33 @@
 
 BEGIN_HYPERDEX_NAMESPACE
 
+class subspace;
+
 uint64_t
 hash(hyperdatatype t, const e::slice& v);
 
+// hs[i] = hash(t, vs[i]), resolving the datatype once for the whole batch
+void
+hash(hyperdatatype t, const e::slice* vs, size_t vs_sz, uint64_t* hs);
+
+// the key's coordinate, which is order-preserving for spaces with an
+// ordered key
+uint64_t
+hash_key(const schema& sc, const e::slice& key);
+void
+hash_key(const schema& sc, const e::slice* keys, size_t keys_sz, uint64_t* hs);
+
+// the time bucket of a timestamp in sc.bucket_attr, and the coordinate
+// objects in that bucket are placed at.  Buckets step through the coordinate
+// space in time order and come around again every TIME_BUCKET_CYCLE buckets,
+// so that a span of time maps onto one contiguous run of regions (or two,
+// where it wraps)
+#define TIME_BUCKET_CYCLE 1024ULL
+uint64_t
+time_bucket(const schema& sc, const e::slice& v);
+uint64_t
+time_bucket_coordinate(uint64_t bucket);
+
 void
 hash(const schema& sc,
      const e::slice& key,
@@ -54,6 +78,15 @@ hash(const schema& sc,
      const std::vector<e::slice>& value,
      uint64_t* hs);
 
+// Like the above, but only fills in the hashes of the attributes ss places
+// objects by; the rest of hs is left alone
+void
+hash(const schema& sc,
+     const subspace& ss,
+     const e::slice& key,
+     const std::vector<e::slice>& value,
+     uint64_t* hs);
+
 END_HYPERDEX_NAMESPACE
 
 #endif // hyperdex_common_hash_h_
@@ -25,6 +25,12 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+// C
+#include <string.h>
+
+// STL
+#include <algorithm>
+
 // HyperDex
 #include "common/hyperspace.h"
 #include "common/serialization.h"
@@ -34,6 +40,25 @@ using hyperdex::subspace;
 using hyperdex::region;
 using hyperdex::replica;
 
+namespace
+{
+
+// orders attribute numbers by the names of the attributes they number
+class attr_name_less
+{
+    public:
+        attr_name_less(const hyperdex::attribute* attrs) : m_attrs(attrs) {}
+
+    public:
+        bool operator () (uint16_t lhs, uint16_t rhs) const
+        { return strcmp(m_attrs[lhs].name, m_attrs[rhs].name) < 0; }
+
+    private:
+        const hyperdex::attribute* m_attrs;
+};
+
+} // namespace
+
 space :: space()
     : id()
     , name("")
@@ -44,6 +69,7 @@ space :: space()
     , indices()
     , m_c_strs()
     , m_attrs()
+    , m_attrs_by_name()
 {
 }
 
@@ -57,6 +83,7 @@ space :: space(const char* new_name, const hyperdex::schema& _sc)
     , indices()
     , m_c_strs()
     , m_attrs()
+    , m_attrs_by_name()
 {
     reestablish_backing();
 }
@@ -71,6 +98,7 @@ space :: space(const space& other)
     , indices(other.indices)
     , m_c_strs()
     , m_attrs()
+    , m_attrs_by_name()
 {
     reestablish_backing();
 }
@@ -131,6 +159,38 @@ space :: validate() const
         }
     }
 
+    if (sc.durability != DURABILITY_ASYNC &&
+        sc.durability != DURABILITY_SYNC &&
+        sc.durability != DURABILITY_GROUP &&
+        sc.durability != DURABILITY_MEMORY)
+    {
+        return false;
+    }
+
+    if (sc.expiry != 0 &&
+        (sc.expiry >= sc.attrs_sz ||
+         CONTAINER_TYPE(sc.attrs[sc.expiry].type) != HYPERDATATYPE_TIMESTAMP_GENERIC))
+    {
+        return false;
+    }
+
+    if (sc.ordered_key &&
+        (sc.attrs_sz == 0 ||
+         (sc.attrs[0].type != HYPERDATATYPE_STRING &&
+          sc.attrs[0].type != HYPERDATATYPE_INT64 &&
+          sc.attrs[0].type != HYPERDATATYPE_FLOAT)))
+    {
+        return false;
+    }
+
+    if (sc.bucket_attr != 0 &&
+        (sc.bucket_attr >= sc.attrs_sz ||
+         sc.bucket_width == 0 ||
+         CONTAINER_TYPE(sc.attrs[sc.bucket_attr].type) != HYPERDATATYPE_TIMESTAMP_GENERIC))
+    {
+        return false;
+    }
+
     return true;
 }
 
@@ -160,7 +220,7 @@ space :: reestablish_backing()
 
     for (size_t i = 0; i < indices.size(); ++i)
     {
-        sz += indices[i].extra.size();
+        sz += indices[i].extra.size() + indices[i].filter.size();
     }
 
     // Create the two new backings
@@ -184,12 +244,26 @@ space :: reestablish_backing()
     }
 
     sc.attrs = m_attrs.get();
+    e::array_ptr<uint16_t> old_attrs_by_name = m_attrs_by_name;
+    m_attrs_by_name = new uint16_t[sc.attrs_sz];
+
+    for (uint16_t i = 0; i < sc.attrs_sz; ++i)
+    {
+        m_attrs_by_name[i] = i;
+    }
+
+    std::sort(m_attrs_by_name.get(), m_attrs_by_name.get() + sc.attrs_sz,
+              attr_name_less(sc.attrs));
+    sc.attrs_by_name = m_attrs_by_name.get();
 
     for (size_t i = 0; i < indices.size(); ++i)
     {
         memmove(ptr, indices[i].extra.data(), indices[i].extra.size());
         indices[i].extra = e::slice(ptr, indices[i].extra.size());
         ptr += indices[i].extra.size();
+        memmove(ptr, indices[i].filter.data(), indices[i].filter.size());
+        indices[i].filter = e::slice(ptr, indices[i].filter.size());
+        ptr += indices[i].filter.size();
     }
 }
 
@@ -199,9 +273,16 @@ hyperdex :: operator << (e::packer pa, const space& s)
     e::slice name;
     uint16_t num_subspaces = s.subspaces.size();
     uint16_t num_indices = s.indices.size();
+    uint8_t durability = static_cast<uint8_t>(s.sc.durability);
+    uint8_t immutable = s.sc.immutable ? 1 : 0;
+    uint8_t ordered_key = s.sc.ordered_key ? 1 : 0;
+    uint8_t compressed = s.sc.compressed ? 1 : 0;
     name = e::slice(s.name, strlen(s.name));
     pa = pa << s.id.get() << name << s.fault_tolerance << s.sc.attrs_sz
-            << num_subspaces << num_indices;
+            << num_subspaces << num_indices << durability << s.sc.expiry
+            << immutable << ordered_key << s.sc.quota_ops
+            << s.sc.quota_bytes << s.sc.quota_client_ops
+            << s.sc.bucket_attr << s.sc.bucket_width << compressed;
 
     for (size_t i = 0; i < s.sc.attrs_sz; ++i)
     {
@@ -230,8 +311,19 @@ hyperdex :: operator >> (e::unpacker up, space& s)
     std::vector<attribute> attrs;
     uint16_t num_subspaces;
     uint16_t num_indices;
+    uint8_t durability;
+    uint8_t immutable;
+    uint8_t ordered_key;
+    uint8_t compressed;
     up = up >> s.id >> name >> s.fault_tolerance >> s.sc.attrs_sz
-            >> num_subspaces >> num_indices;
+            >> num_subspaces >> num_indices >> durability >> s.sc.expiry
+            >> immutable >> ordered_key >> s.sc.quota_ops
+            >> s.sc.quota_bytes >> s.sc.quota_client_ops
+            >> s.sc.bucket_attr >> s.sc.bucket_width >> compressed;
+    s.sc.durability = static_cast<durability_level>(durability);
+    s.sc.immutable = immutable != 0;
+    s.sc.ordered_key = ordered_key != 0;
+    s.sc.compressed = compressed != 0;
     strs.reserve(s.sc.attrs_sz + 1);
     attrs.reserve(s.sc.attrs_sz);
     strs.push_back(std::string(name.cdata(), name.size()));
@@ -283,7 +375,17 @@ hyperdex :: pack_size(const space& s)
               + sizeof(uint64_t) /* fault_tolerance */
               + sizeof(uint16_t) /* sc.attrs_sz */
               + sizeof(uint16_t) /* num subspaces */
-              + sizeof(uint16_t); /* num indices */
+              + sizeof(uint16_t) /* num indices */
+              + sizeof(uint8_t) /* sc.durability */
+              + sizeof(uint16_t) /* sc.expiry */
+              + sizeof(uint8_t) /* sc.immutable */
+              + sizeof(uint8_t) /* sc.ordered_key */
+              + sizeof(uint64_t) /* sc.quota_ops */
+              + sizeof(uint64_t) /* sc.quota_bytes */
+              + sizeof(uint64_t) /* sc.quota_client_ops */
+              + sizeof(uint16_t) /* sc.bucket_attr */
+              + sizeof(uint64_t) /* sc.bucket_width */
+              + sizeof(uint8_t); /* sc.compressed */
 
     for (size_t i = 0; i < s.sc.attrs_sz; ++i)
     {
@@ -398,6 +500,7 @@ region :: region()
     , lower_coord()
     , upper_coord()
     , replicas()
+    , stored_bytes(0)
 {
 }
 
@@ -406,6 +509,7 @@ region :: region(const region& other)
     , lower_coord(other.lower_coord)
     , upper_coord(other.upper_coord)
     , replicas(other.replicas)
+    , stored_bytes(other.stored_bytes)
 {
 }
 
@@ -420,6 +524,7 @@ region :: operator = (const region& rhs)
     lower_coord = rhs.lower_coord;
     upper_coord = rhs.upper_coord;
     replicas = rhs.replicas;
+    stored_bytes = rhs.stored_bytes;
     return *this;
 }
 
@@ -428,7 +533,7 @@ hyperdex :: operator << (e::packer pa, const region& r)
 {
     uint16_t num_hashes = r.lower_coord.size();
     uint8_t num_replicas = r.replicas.size();
-    pa = pa << r.id.get() << num_hashes << num_replicas;
+    pa = pa << r.id.get() << num_hashes << num_replicas << r.stored_bytes;
 
     for (size_t i = 0; i < num_hashes; ++i)
     {
@@ -449,7 +554,7 @@ hyperdex :: operator >> (e::unpacker up, region& r)
     uint64_t id;
     uint16_t num_hashes;
     uint8_t num_replicas;
-    up = up >> id >> num_hashes >> num_replicas;
+    up = up >> id >> num_hashes >> num_replicas >> r.stored_bytes;
     r.id = region_id(id);
     r.lower_coord.resize(num_hashes);
     r.upper_coord.resize(num_hashes);
@@ -474,6 +579,7 @@ hyperdex :: pack_size(const region& r)
     size_t sz = sizeof(uint64_t) /* id */
               + sizeof(uint16_t) /* num_hashes */
               + sizeof(uint8_t) /* num_replicas */
+              + sizeof(uint64_t) /* stored_bytes */
               + 2 * sizeof(uint64_t) * r.lower_coord.size();
 
     for (size_t i = 0; i < r.replicas.size(); ++i)
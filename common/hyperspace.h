@@ -81,6 +81,7 @@ class space
     private:
         e::array_ptr<char> m_c_strs;
         e::array_ptr<attribute> m_attrs;
+        e::array_ptr<uint16_t> m_attrs_by_name;
 
 };
 
@@ -134,6 +135,9 @@ class region
         std::vector<uint64_t> lower_coord;
         std::vector<uint64_t> upper_coord;
         std::vector<replica> replicas;
+        // the bytes the region's replicas last reported storing, as of the
+        // configuration; 0 if they have not reported
+        uint64_t stored_bytes;
 };
 
 e::packer
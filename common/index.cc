@@ -27,6 +27,13 @@
 
 #define __STDC_LIMIT_MACROS
 
+// C
+#include <cassert>
+#include <cstring>
+
+// e
+#include <e/endian.h>
+
 // HyperDex
 #include "common/index.h"
 
@@ -37,6 +44,7 @@ index :: index()
     , id()
     , attr(UINT16_MAX)
     , extra()
+    , filter()
 {
 }
 
@@ -45,6 +53,16 @@ index :: index(index_t t, index_id i, uint16_t a, const e::slice& e)
     , id(i)
     , attr(a)
     , extra(e)
+    , filter()
+{
+}
+
+index :: index(index_t t, index_id i, uint16_t a, const e::slice& e, const e::slice& f)
+    : type(t)
+    , id(i)
+    , attr(a)
+    , extra(e)
+    , filter(f)
 {
 }
 
@@ -57,43 +75,181 @@ index :: operator = (const index& rhs)
 {
     if (this != &rhs)
     {
+        type = rhs.type;
         id = rhs.id;
         attr = rhs.attr;
+        extra = rhs.extra;
+        filter = rhs.filter;
     }
 
     return *this;
 }
 
+size_t
+index :: included_sz() const
+{
+    return type == NORMAL ? extra.size() / sizeof(uint16_t) : 0;
+}
+
+uint16_t
+index :: included(size_t i) const
+{
+    assert(i < included_sz());
+    uint16_t attr;
+    e::unpack16be(extra.data() + i * sizeof(uint16_t), &attr);
+    return attr;
+}
+
+size_t
+index :: composite_sz() const
+{
+    return type == COMPOSITE || type == SPATIAL ? extra.size() / sizeof(uint16_t) : 0;
+}
+
+uint16_t
+index :: composite(size_t i) const
+{
+    assert(i < composite_sz());
+    uint16_t attr;
+    e::unpack16be(extra.data() + i * sizeof(uint16_t), &attr);
+    return attr;
+}
+
+namespace
+{
+
+const char* const document_types[] = {"string", "number", "document"};
+const hyperdatatype document_datatypes[] = {HYPERDATATYPE_STRING,
+                                            HYPERDATATYPE_FLOAT,
+                                            HYPERDATATYPE_DOCUMENT};
+
+// the bytes of a DOCUMENT index's "extra" before its type, if any; "*type" is
+// set to the declared type or HYPERDATATYPE_GARBAGE
+size_t
+document_untyped(const e::slice& extra, hyperdatatype* type)
+{
+    std::string spec(extra.cdata(), extra.size());
+    size_t colon = spec.rfind(':');
+    *type = HYPERDATATYPE_GARBAGE;
+
+    if (colon == std::string::npos)
+    {
+        return spec.size();
+    }
+
+    for (size_t i = 0; i < sizeof(document_types) / sizeof(document_types[0]); ++i)
+    {
+        if (spec.compare(colon + 1, std::string::npos, document_types[i]) == 0)
+        {
+            *type = document_datatypes[i];
+            return colon;
+        }
+    }
+
+    return spec.size();
+}
+
+} // namespace
+
+std::string
+index :: document_path() const
+{
+    hyperdatatype t;
+    std::string path(extra.cdata(), document_untyped(extra, &t));
+
+    if (document_elements())
+    {
+        path.resize(path.size() - 3);
+    }
+
+    return path;
+}
+
+bool
+index :: document_elements() const
+{
+    hyperdatatype t;
+    size_t sz = document_untyped(extra, &t);
+    return type == DOCUMENT && sz >= 3 &&
+           memcmp(extra.cdata() + sz - 3, "[*]", 3) == 0;
+}
+
+hyperdatatype
+index :: document_type() const
+{
+    hyperdatatype t;
+    document_untyped(extra, &t);
+    return type == DOCUMENT ? t : HYPERDATATYPE_GARBAGE;
+}
+
 std::ostream&
 hyperdex :: operator << (std::ostream& lhs, const index& rhs)
 {
     switch (rhs.type)
     {
         case index::NORMAL:
-            lhs << "index(" << rhs.id.get() << ", " << rhs.attr << ")";
+            lhs << "index(" << rhs.id.get() << ", " << rhs.attr;
+
+            for (size_t i = 0; i < rhs.included_sz(); ++i)
+            {
+                lhs << (i == 0 ? ", include " : " ") << rhs.included(i);
+            }
+
+            lhs << ")";
             break;
         case index::DOCUMENT:
             lhs << "index(" << rhs.id.get()
                 << ", " << rhs.extra.str()
                 << ", " << rhs.attr <<  ")";
             break;
+        case index::TRIGRAM:
+            lhs << "trigram_index(" << rhs.id.get() << ", " << rhs.attr << ")";
+            break;
+        case index::HASHED:
+            lhs << "hashed_index(" << rhs.id.get() << ", " << rhs.attr << ")";
+            break;
+        case index::COMPOSITE:
+            lhs << "composite_index(" << rhs.id.get();
+
+            for (size_t i = 0; i < rhs.composite_sz(); ++i)
+            {
+                lhs << (i == 0 ? ", " : " ") << rhs.composite(i);
+            }
+
+            lhs << ")";
+            break;
+        case index::SPATIAL:
+            lhs << "spatial_index(" << rhs.id.get();
+
+            for (size_t i = 0; i < rhs.composite_sz(); ++i)
+            {
+                lhs << (i == 0 ? ", " : " ") << rhs.composite(i);
+            }
+
+            lhs << ")";
+            break;
         default:
             abort();
     }
 
+    if (rhs.partial())
+    {
+        lhs << " partial";
+    }
+
     return lhs;
 }
 
 e::packer
 hyperdex :: operator << (e::packer pa, const index& t)
 {
-    return pa << t.type << t.id << t.attr << t.extra;
+    return pa << t.type << t.id << t.attr << t.extra << t.filter;
 }
 
 e::unpacker
 hyperdex :: operator >> (e::unpacker up, index& t)
 {
-    up = up >> t.type >> t.id >> t.attr >> t.extra;
+    up = up >> t.type >> t.id >> t.attr >> t.extra >> t.filter;
     return up;
 }
 
@@ -101,7 +257,8 @@ size_t
 hyperdex :: pack_size(const index& t)
 {
     return pack_size(t.type) + pack_size(t.id) + sizeof(t.attr)
-         + sizeof(uint32_t) + t.extra.size();
+         + sizeof(uint32_t) + t.extra.size()
+         + sizeof(uint32_t) + t.filter.size();
 }
 
 e::packer
@@ -28,11 +28,15 @@
 #ifndef hyperdex_common_index_h_
 #define hyperdex_common_index_h_
 
+// STL
+#include <string>
+
 // e
 #include <e/buffer.h>
 
 // HyperDex
 #include "namespace.h"
+#include "hyperdex.h"
 #include "common/ids.h"
 #include "common/range_searches.h"
 
@@ -41,21 +45,45 @@ BEGIN_HYPERDEX_NAMESPACE
 class index
 {
     public:
-        enum index_t { NORMAL, DOCUMENT };
+        enum index_t { NORMAL, DOCUMENT, TRIGRAM, COMPOSITE, HASHED, SPATIAL };
 
     public:
         index();
         index(index_t t, index_id i, uint16_t a, const e::slice& e);
+        index(index_t t, index_id i, uint16_t a, const e::slice& e, const e::slice& f);
         ~index() throw ();
 
     public:
         index& operator = (const index&);
+        // the attributes whose values a NORMAL index stores alongside each
+        // entry; they are packed into "extra" as big-endian uint16_t
+        size_t included_sz() const;
+        uint16_t included(size_t i) const;
+        // the attributes of a COMPOSITE index, most significant first, or the
+        // dimensions of a SPATIAL index, packed the same way; "attr" is the
+        // first of them
+        size_t composite_sz() const;
+        uint16_t composite(size_t i) const;
+        // a partial index has entries only for the objects that pass every
+        // check of its filter
+        bool partial() const { return !filter.empty(); }
+        // a DOCUMENT index keeps its path in "extra", optionally followed by
+        // "[*]" to index each element of the array at the path rather than
+        // the path itself, and then by ":string", ":number" or ":document"
+        // to index only values of that type
+        std::string document_path() const;
+        bool document_elements() const;
+        // HYPERDATATYPE_GARBAGE if the index takes values of every type
+        hyperdatatype document_type() const;
 
     public:
         index_t type;
         index_id id;
         uint16_t attr;
         e::slice extra;
+        // the checks of a partial index: a uint32_t count followed by each
+        // attribute_check as it is packed on the wire; empty for all others
+        e::slice filter;
 };
 
 std::ostream&
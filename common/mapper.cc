@@ -25,6 +25,9 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+// e
+#include <e/atomic.h>
+
 // HyperDex
 #include "common/mapper.h"
 
@@ -32,6 +35,13 @@ using hyperdex::mapper;
 
 mapper :: mapper(const hyperdex::configuration* config)
     : m_config(config)
+    , m_follow(NULL)
+{
+}
+
+mapper :: mapper(const hyperdex::configuration* const* config)
+    : m_config(NULL)
+    , m_follow(config)
 {
 }
 
@@ -42,6 +52,9 @@ mapper :: ~mapper() throw ()
 bool
 mapper :: lookup(uint64_t id, po6::net::location* addr)
 {
-    *addr = m_config->get_address(server_id(id));
+    const configuration* config = m_follow
+                                ? e::atomic::load_ptr_acquire(m_follow)
+                                : m_config;
+    *addr = config->get_address(server_id(id));
     return *addr != po6::net::location();
 }
@@ -41,6 +41,8 @@ class mapper : public ::busybee_mapper
 {
     public:
         mapper(const configuration* config);
+        // follow whichever configuration "*config" points to at lookup time
+        mapper(const configuration* const* config);
         ~mapper() throw ();
 
     public:
@@ -52,6 +54,7 @@ class mapper : public ::busybee_mapper
 
     private:
         const configuration* m_config;
+        const configuration* const* m_follow;
 };
 
 END_HYPERDEX_NAMESPACE
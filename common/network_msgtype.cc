@@ -38,32 +38,63 @@ hyperdex :: operator << (std::ostream& lhs, const network_msgtype& rhs)
         STRINGIFY(RESP_GET);
         STRINGIFY(REQ_GET_PARTIAL);
         STRINGIFY(RESP_GET_PARTIAL);
+        STRINGIFY(REQ_GET_BATCH);
+        STRINGIFY(RESP_GET_BATCH);
+        STRINGIFY(REQ_GET_RELAXED);
         STRINGIFY(REQ_ATOMIC);
         STRINGIFY(RESP_ATOMIC);
+        STRINGIFY(REQ_ATOMIC_BATCH);
+        STRINGIFY(REQ_GET_CACHED);
+        STRINGIFY(RESP_GET_CACHED);
+        STRINGIFY(REQ_GET_VERSIONED);
+        STRINGIFY(RESP_GET_VERSIONED);
         STRINGIFY(REQ_SEARCH_START);
         STRINGIFY(REQ_SEARCH_NEXT);
         STRINGIFY(REQ_SEARCH_STOP);
         STRINGIFY(RESP_SEARCH_ITEM);
         STRINGIFY(RESP_SEARCH_DONE);
+        STRINGIFY(RESP_SEARCH_BATCH);
+        STRINGIFY(REQ_SEARCH_MULTI);
+        STRINGIFY(RESP_SEARCH_COMPRESSED);
         STRINGIFY(REQ_SORTED_SEARCH);
         STRINGIFY(RESP_SORTED_SEARCH);
+        STRINGIFY(REQ_SORTED_SEARCH_NEXT);
+        STRINGIFY(RESP_SORTED_SEARCH_CHUNK);
+        STRINGIFY(REQ_NEAREST_SEARCH);
+        STRINGIFY(RESP_NEAREST_SEARCH);
         STRINGIFY(REQ_COUNT);
         STRINGIFY(RESP_COUNT);
         STRINGIFY(REQ_SEARCH_DESCRIBE);
         STRINGIFY(RESP_SEARCH_DESCRIBE);
         STRINGIFY(REQ_GROUP_ATOMIC);
         STRINGIFY(RESP_GROUP_ATOMIC);
+        STRINGIFY(REQ_AGGREGATE);
+        STRINGIFY(RESP_AGGREGATE);
+        STRINGIFY(REQ_APPROXIMATE_COUNT);
+        STRINGIFY(REQ_CHANGES_START);
+        STRINGIFY(REQ_CHANGES_NEXT);
+        STRINGIFY(REQ_CHANGES_STOP);
+        STRINGIFY(RESP_CHANGES_BATCH);
+        STRINGIFY(RESP_CHANGES_COMPRESSED);
         STRINGIFY(CHAIN_OP);
         STRINGIFY(CHAIN_SUBSPACE);
         STRINGIFY(CHAIN_ACK);
+        STRINGIFY(CHAIN_OP_BATCH);
+        STRINGIFY(CHAIN_ACK_BATCH);
         STRINGIFY(XFER_OP);
         STRINGIFY(XFER_ACK);
         STRINGIFY(XFER_HS);
         STRINGIFY(XFER_HSA);
         STRINGIFY(XFER_HA);
         STRINGIFY(XFER_HW);
+        STRINGIFY(XFER_OP_BATCH);
+        STRINGIFY(XFER_OP_COMPRESSED);
         STRINGIFY(BACKUP);
         STRINGIFY(PERF_COUNTERS);
+        STRINGIFY(HOT_KEYS);
+        STRINGIFY(PROFILE);
+        STRINGIFY(EXPORT);
+        STRINGIFY(MAINTENANCE);
         STRINGIFY(CONFIGMISMATCH);
         STRINGIFY(PACKET_NOP);
         default:
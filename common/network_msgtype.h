@@ -44,17 +44,53 @@ enum network_msgtype
     REQ_GET_PARTIAL = 10,
     RESP_GET_PARTIAL = 11,
 
+    REQ_GET_BATCH   = 12,
+    RESP_GET_BATCH  = 13,
+
+    /* a GET any replica may serve; answered with RESP_GET */
+    REQ_GET_RELAXED = 14,
+
     REQ_ATOMIC      = 16,
     RESP_ATOMIC     = 17,
+    /* several REQ_ATOMIC bodies for one server, each naming its own virtual
+     * server; answered with one RESP_ATOMIC apiece */
+    REQ_ATOMIC_BATCH = 18,
+
+    /* a GET naming the version the client holds; answered with
+     * RESP_GET_CACHED, which omits the value when the client is up to date */
+    REQ_GET_CACHED  = 20,
+    RESP_GET_CACHED = 21,
+
+    /* a REQ_GET_BATCH that also reports each key's version, whether writes
+     * to it are in flight, and the region's count of versions handed out
+     * before and after the reads; read transactions validate a snapshot
+     * with it */
+    REQ_GET_VERSIONED  = 22,
+    RESP_GET_VERSIONED = 23,
 
     REQ_SEARCH_START    = 32,
     REQ_SEARCH_NEXT     = 33,
     REQ_SEARCH_STOP     = 34,
     RESP_SEARCH_ITEM    = 35,
     RESP_SEARCH_DONE    = 36,
+    RESP_SEARCH_BATCH   = 37,
+    /* several REQ_SEARCH_START, REQ_SORTED_SEARCH or REQ_COUNT bodies (all
+     * of the one type named) for one server, each naming its own virtual
+     * server; read from one snapshot and answered as the lone requests are */
+    REQ_SEARCH_MULTI    = 38,
+    /* the type of a RESP_SEARCH_BATCH, RESP_SORTED_SEARCH or
+     * RESP_SORTED_SEARCH_CHUNK and its body, compressed; sent only to clients
+     * that say in REQ_SEARCH_START or REQ_SORTED_SEARCH that they can take it */
+    RESP_SEARCH_COMPRESSED = 39,
 
     REQ_SORTED_SEARCH   = 40,
     RESP_SORTED_SEARCH  = 41,
+    REQ_SORTED_SEARCH_NEXT   = 42,
+    RESP_SORTED_SEARCH_CHUNK = 43,
+
+    /* the objects nearest a point over two numeric attributes */
+    REQ_NEAREST_SEARCH  = 44,
+    RESP_NEAREST_SEARCH = 45,
 
     /* 48, 49 retired */
 
@@ -67,10 +103,30 @@ enum network_msgtype
     REQ_GROUP_ATOMIC = 54,
     RESP_GROUP_ATOMIC = 55,
 
+    REQ_AGGREGATE   = 56,
+    RESP_AGGREGATE  = 57,
+
+    /* answered with RESP_COUNT */
+    REQ_APPROXIMATE_COUNT = 58,
+
+    /* a region's writes replayed from a checkpoint, in the order they were
+     * made; RESP_CHANGES_BATCH carries each slice of them */
+    REQ_CHANGES_START   = 60,
+    REQ_CHANGES_NEXT    = 61,
+    REQ_CHANGES_STOP    = 62,
+    RESP_CHANGES_BATCH  = 63,
+    /* a RESP_CHANGES_BATCH body, compressed; sent only to clients that say
+     * in REQ_CHANGES_START that they can take it */
+    RESP_CHANGES_COMPRESSED = 59,
+
     CHAIN_OP        = 64,
     CHAIN_SUBSPACE  = 65,
     CHAIN_ACK       = 66,
     /* 67 retired */
+    /* several CHAIN_OP bodies for the same chain link */
+    CHAIN_OP_BATCH  = 68,
+    /* several CHAIN_ACK bodies for the same chain link */
+    CHAIN_ACK_BATCH = 69,
 
     XFER_OP  = 80,
     XFER_ACK = 81,
@@ -78,9 +134,18 @@ enum network_msgtype
     XFER_HSA = 83, // handshake syn-ack
     XFER_HA  = 84, // handshake ack
     XFER_HW  = 85, // wiped
+    /* several XFER_OP bodies for the same transfer */
+    XFER_OP_BATCH = 86,
+    /* an XFER_OP_BATCH body, compressed; sent only to daemons that say in
+     * XFER_HSA that they can take it */
+    XFER_OP_COMPRESSED = 87,
 
     BACKUP = 126,
     PERF_COUNTERS = 127,
+    HOT_KEYS = 128,
+    PROFILE = 129,
+    EXPORT = 130,
+    MAINTENANCE = 131,
 
     CONFIGMISMATCH  = 254,
     PACKET_NOP      = 255
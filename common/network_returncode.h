@@ -44,7 +44,13 @@ enum network_returncode
     NET_CMPFAIL      = 8325,
     NET_READONLY     = 8327,
     NET_OVERFLOW     = 8328,
-    NET_UNAUTHORIZED = 8329
+    NET_UNAUTHORIZED = 8329,
+    // a relaxed read found the replica too far behind
+    NET_STALE        = 8330,
+    // a cached read found the client's copy current
+    NET_NOTMODIFIED  = 8331,
+    // refused by the space's quota before it ran; the client may retry
+    NET_THROTTLED    = 8332
 };
 
 END_HYPERDEX_NAMESPACE
@@ -29,31 +29,23 @@
 #include <ciso646>
 
 // C
-#if defined(_LIBCPP_VERSION)
-#include <cmath>
-#else
-#include <tr1/cmath>
-#endif
-#include <cstdlib>
+#include <string.h>
 
 // HyperDex
-#include "common/ieee.h"
 #include "common/ordered_encoding.h"
 
+// Adding or subtracting 2^63 is the same as flipping the sign bit, for
+// either sign.
 uint64_t
 hyperdex :: ordered_encode_int64(int64_t x)
 {
-    uint64_t out = static_cast<uint64_t>(x);
-    out += x >= 0 ? 0x8000000000000000ULL : INT64_MIN;
-    return out;
+    return static_cast<uint64_t>(x) ^ 0x8000000000000000ULL;
 }
 
 int64_t
 hyperdex :: ordered_decode_int64(uint64_t x)
 {
-    uint64_t out = static_cast<uint64_t>(x);
-    out -= x >= 0x8000000000000000ULL ? 0x8000000000000000ULL : INT64_MIN;
-    return out;
+    return static_cast<int64_t>(x ^ 0x8000000000000000ULL);
 }
 
 // A little reminder about IEEE 754 doubles.  Source Patterson&Hennessy 3ed.
@@ -108,54 +100,55 @@ hyperdex :: ordered_decode_int64(uint64_t x)
 //                                          exp=0x7ff
 //                                          frac=0
 //                                          shift=3
-
-#pragma GCC diagnostic ignored "-Wfloat-equal"
+//
+// For every finite, nonzero x the table above works out to:
+//      positive:   bits ^ 0x8000000000000000 + 2
+//      negative:   ~bits + 1
+// so x needs only a mask and an add.  Zeros, infinities and NaN keep their
+// fixed codes.
 
 uint64_t
 hyperdex :: ordered_encode_double(double x)
 {
-    uint64_t out = 0xffffffffffffffffULL;
+    uint64_t bits;
+    memmove(&bits, &x, sizeof(bits));
+    const uint64_t sign = bits >> 63;
+    const uint64_t exp = (bits >> 52) & 0x7ffULL;
 
-    if (std::isinf(x))
+    if (__builtin_expect(exp == 0x7ffULL || (bits << 1) == 0, 0))
     {
-        if (x > 0)
+        if ((bits << 1) == 0)
+        {
+            return 0x8000000000000000ULL + 1;
+        }
+        else if ((bits & 0xfffffffffffffULL) != 0)
         {
-            out = 0xfff0000000000000ULL + 2;
+            return 0xfff0000000000000ULL + 3;
         }
         else
         {
-            out = 0;
+            return sign ? 0 : 0xfff0000000000000ULL + 2;
         }
     }
-    else if (std::isnan(x))
-    {
-        out = 0xfff0000000000000ULL + 3;
-    }
-    else if (x == 0)
-    {
-        out = 0x8000000000000000ULL + 1;
-    }
-    else
+
+    const uint64_t mask = (0 - sign) | 0x8000000000000000ULL;
+    return (bits ^ mask) + 2 - sign;
+}
+
+uint64_t
+hyperdex :: ordered_encode_bytes(const char* s, size_t sz)
+{
+    uint64_t x = 0;
+
+    for (size_t i = 0; i < sizeof(uint64_t); ++i)
     {
-        union { double d; ieee_double ieee; } d;
-        d.d = x;
-        uint64_t sign = d.ieee.dbl_sign ^ 0x1;
-        uint64_t exp  = d.ieee.dbl_exp;
-        uint64_t frac = d.ieee.dbl_frach;
-        frac <<= 32;
-        frac |= d.ieee.dbl_fracl;
-        uint64_t shift = 2;
+        x <<= 8;
 
-        if (x < 0)
+        if (i < sz)
         {
-            exp  ^= 0x7ffULL;
-            frac ^= 0xfffffffffffffULL;
-            shift = 1;
+            x |= static_cast<uint8_t>(s[i]);
         }
-
-        out = (sign << 63) | (exp << 52) | (frac);
-        out += shift;
     }
 
-    return out;
+    return x;
 }
@@ -29,6 +29,7 @@
 #define hyperdex_common_ordered_encoding_h_
 
 // C
+#include <stddef.h>
 #include <stdint.h>
 
 // HyperDex
@@ -48,6 +49,12 @@ ordered_decode_int64(uint64_t x);
 uint64_t
 ordered_encode_double(double x);
 
+// The first eight bytes of the string, big-endian and padded with zeros.  The
+// encoding is monotonic rather than strictly so: a <= b => e(a) <= e(b), and
+// strings that share an eight byte prefix encode the same.
+uint64_t
+ordered_encode_bytes(const char* s, size_t sz);
+
 END_HYPERDEX_NAMESPACE
 
 #endif // hyperdex_common_ordered_encoding_h_
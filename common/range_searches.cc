@@ -32,11 +32,14 @@
 
 // HyperDex
 #include "common/datatype_info.h"
+#include "common/hash.h"
+#include "common/hyperspace.h"
 #include "common/range_searches.h"
 
 using hyperdex::attribute_check;
 using hyperdex::datatype_info;
 using hyperdex::range;
+using hyperdex::region;
 
 // the caller of this function is safe to assume that only checks with
 //  * HYPERPREDICATE_EQUAL
@@ -200,3 +203,120 @@ hyperdex :: range_searches(const schema& sc,
 
     assert(ranges->size() <= checks.size());
 }
+
+bool
+hyperdex :: search_regions(const space& s, const subspace& ss,
+                           const std::vector<range>& ranges,
+                           std::vector<const region*>* regions)
+{
+    regions->clear();
+
+    for (size_t j = 0; j < ss.regions.size(); ++j)
+    {
+        const region& reg(ss.regions[j]);
+        bool exclude = false;
+
+        for (size_t k = 0; !exclude && k < ranges.size(); ++k)
+        {
+            assert(reg.lower_coord.size() == reg.upper_coord.size());
+            uint16_t attr = UINT16_MAX;
+
+            for (size_t l = 0; l < ss.attrs.size(); ++l)
+            {
+                if (ss.attrs[l] == ranges[k].attr)
+                {
+                    attr = l;
+                    break;
+                }
+            }
+
+            if (attr == UINT16_MAX)
+            {
+                continue;
+            }
+
+            if (attr >= reg.lower_coord.size() ||
+                reg.lower_coord[attr] > reg.upper_coord[attr])
+            {
+                regions->clear();
+                return false;
+            }
+
+            // a time-bucketed attribute narrows only when both ends of the
+            // span are known, and it covers less than a full cycle of buckets
+            if (ranges[k].attr != 0 && ranges[k].attr == s.sc.bucket_attr &&
+                ranges[k].has_start && ranges[k].has_end)
+            {
+                const uint64_t first = time_bucket(s.sc, ranges[k].start);
+                const uint64_t last = time_bucket(s.sc, ranges[k].end);
+
+                if (first <= last && last - first + 1 < TIME_BUCKET_CYCLE)
+                {
+                    const uint64_t lo = time_bucket_coordinate(first);
+                    const uint64_t hi = time_bucket_coordinate(last);
+                    const bool below = reg.upper_coord[attr] < lo;
+                    const bool above = reg.lower_coord[attr] > hi;
+
+                    // the span may wrap around the end of the cycle
+                    if (lo <= hi ? below || above : below && above)
+                    {
+                        exclude = true;
+                    }
+                }
+
+                continue;
+            }
+
+            // an ordered key places strings by order, just as int64 and
+            // float are placed everywhere
+            const bool ordered = ranges[k].attr == 0 && s.sc.ordered_key;
+
+            if (ranges[k].type == HYPERDATATYPE_STRING && !ordered &&
+                ranges[k].has_start && ranges[k].has_end &&
+                ranges[k].start == ranges[k].end)
+            {
+                uint64_t h = hash(ranges[k].type, ranges[k].start);
+
+                if (reg.lower_coord[attr] > h ||
+                    reg.upper_coord[attr] < h)
+                {
+                    exclude = true;
+                }
+            }
+
+            if (ranges[k].type == HYPERDATATYPE_INT64 ||
+                ranges[k].type == HYPERDATATYPE_FLOAT ||
+                ordered)
+            {
+                if (ranges[k].has_start)
+                {
+                    uint64_t h = ordered ? hash_key(s.sc, ranges[k].start)
+                                         : hash(ranges[k].type, ranges[k].start);
+
+                    if (reg.upper_coord[attr] < h)
+                    {
+                        exclude = true;
+                    }
+                }
+
+                if (ranges[k].has_end)
+                {
+                    uint64_t h = ordered ? hash_key(s.sc, ranges[k].end)
+                                         : hash(ranges[k].type, ranges[k].end);
+
+                    if (reg.lower_coord[attr] > h)
+                    {
+                        exclude = true;
+                    }
+                }
+            }
+        }
+
+        if (!exclude)
+        {
+            regions->push_back(&reg);
+        }
+    }
+
+    return true;
+}
@@ -37,12 +37,23 @@
 #include "common/range.h"
 
 BEGIN_HYPERDEX_NAMESPACE
+class space;
+class subspace;
+class region;
 
 void
 range_searches(const schema& sc,
                const std::vector<attribute_check>& checks,
                std::vector<range>* ranges);
 
+// the regions of subspace "ss" of "s" that may hold objects within "ranges",
+// whether or not servers are assigned to them; false when the ranges name a
+// coordinate the regions do not have, in which case no region can be trusted
+bool
+search_regions(const space& s, const subspace& ss,
+               const std::vector<range>& ranges,
+               std::vector<const region*>* regions);
+
 END_HYPERDEX_NAMESPACE
 
 #endif // hyperdex_common_range_searches_h_
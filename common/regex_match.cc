@@ -105,3 +105,210 @@ hyperdex :: regex_match(const uint8_t* _regex, size_t regex_sz,
 
     return false;
 }
+
+// the accept state needs a bit of its own
+#define COMPILED_REGEX_MAX_ELEMENTS 63
+
+hyperdex :: compiled_regex :: compiled_regex()
+    : m_compiled(false)
+    , m_never(false)
+    , m_fallback(false)
+    , m_anchor_start(false)
+    , m_anchor_end(false)
+    , m_masks()
+    , m_star(0)
+    , m_elements(0)
+    , m_prefix()
+    , m_literals()
+    , m_regex()
+{
+}
+
+hyperdex :: compiled_regex :: ~compiled_regex() throw ()
+{
+}
+
+void
+hyperdex :: compiled_regex :: compile(const uint8_t* _regex, size_t regex_sz)
+{
+    const char* regex = reinterpret_cast<const char*>(_regex);
+    const char* regex_end = regex + regex_sz;
+    m_compiled = true;
+    m_never = false;
+    m_fallback = false;
+    m_anchor_start = false;
+    m_anchor_end = false;
+    m_masks.assign(256, 0);
+    m_star = 0;
+    m_elements = 0;
+    m_prefix.clear();
+    m_literals.clear();
+    m_regex.assign(regex, regex_sz);
+
+    if (regex < regex_end && regex[0] == '^')
+    {
+        m_anchor_start = true;
+        ++regex;
+    }
+
+    bool in_prefix = m_anchor_start;
+    std::string run;
+
+    // parse exactly the way "anchored" interprets the pattern
+    while (regex < regex_end)
+    {
+        int c = static_cast<unsigned char>(regex[0]);
+        bool any = false;
+        bool star = false;
+
+        if (regex[0] == '\\')
+        {
+            if (regex + 1 >= regex_end)
+            {
+                // a trailing backslash never matches
+                m_never = true;
+                m_literals.clear();
+                return;
+            }
+
+            c = static_cast<unsigned char>(regex[1]);
+            regex += 2;
+        }
+        else if (regex + 1 < regex_end && regex[1] == '*')
+        {
+            any = regex[0] == '.';
+            star = true;
+            regex += 2;
+        }
+        else if (regex[0] == '$' && regex + 1 == regex_end)
+        {
+            m_anchor_end = true;
+            ++regex;
+            continue;
+        }
+        else
+        {
+            any = regex[0] == '.';
+            ++regex;
+        }
+
+        if (m_elements >= COMPILED_REGEX_MAX_ELEMENTS)
+        {
+            // the literals seen so far are still required
+            if (!run.empty())
+            {
+                m_literals.push_back(run);
+            }
+
+            m_fallback = true;
+            return;
+        }
+
+        const uint64_t bit = 1ULL << m_elements;
+
+        if (any)
+        {
+            for (size_t i = 0; i < m_masks.size(); ++i)
+            {
+                m_masks[i] |= bit;
+            }
+        }
+        else
+        {
+            m_masks[c] |= bit;
+        }
+
+        if (star)
+        {
+            m_star |= bit;
+        }
+
+        if (in_prefix && !any && !star)
+        {
+            m_prefix.push_back(static_cast<char>(c));
+        }
+        else
+        {
+            in_prefix = false;
+        }
+
+        if (!any && !star)
+        {
+            run.push_back(static_cast<char>(c));
+        }
+        else if (!run.empty())
+        {
+            m_literals.push_back(run);
+            run.clear();
+        }
+
+        ++m_elements;
+    }
+
+    if (!run.empty())
+    {
+        m_literals.push_back(run);
+    }
+}
+
+bool
+hyperdex :: compiled_regex :: match(const uint8_t* text, size_t text_sz) const
+{
+    assert(m_compiled);
+
+    if (m_never)
+    {
+        return false;
+    }
+
+    if (m_fallback)
+    {
+        return regex_match(reinterpret_cast<const uint8_t*>(m_regex.data()),
+                           m_regex.size(), text, text_sz);
+    }
+
+    // bit i of "states" is set when the first i elements match a substring
+    // ending at the current byte; bit m_elements is the accept state
+    const uint64_t accept = 1ULL << m_elements;
+    uint64_t states = closure(1);
+
+    for (size_t i = 0; i < text_sz; ++i)
+    {
+        if (!m_anchor_end && (states & accept))
+        {
+            return true;
+        }
+
+        const uint64_t mask = m_masks[text[i]];
+        states = ((states & ~m_star & mask) << 1) | (states & m_star & mask);
+
+        if (!m_anchor_start)
+        {
+            // a match may begin at any byte
+            states |= 1;
+        }
+        else if (states == 0)
+        {
+            return false;
+        }
+
+        states = closure(states);
+    }
+
+    return (states & accept) != 0;
+}
+
+uint64_t
+hyperdex :: compiled_regex :: closure(uint64_t states) const
+{
+    // a starred element may match nothing at all
+    uint64_t next = states | ((states & m_star) << 1);
+
+    while (next != states)
+    {
+        states = next;
+        next = states | ((states & m_star) << 1);
+    }
+
+    return states;
+}
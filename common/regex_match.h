@@ -32,6 +32,10 @@
 #include <cstdlib>
 #include <stdint.h>
 
+// STL
+#include <string>
+#include <vector>
+
 // HyperDex
 #include "namespace.h"
 
@@ -41,6 +45,47 @@ bool
 regex_match(const uint8_t* regex, size_t regex_sz,
             const uint8_t* text, size_t text_sz);
 
+// A regex compiled once so that it may be matched against many strings with
+// the same meaning as regex_match.  Patterns of up to 63 elements run as a
+// bit-parallel automaton that makes one pass over the text; longer patterns
+// fall back to regex_match.
+class compiled_regex
+{
+    public:
+        compiled_regex();
+        ~compiled_regex() throw ();
+
+    public:
+        void compile(const uint8_t* regex, size_t regex_sz);
+        bool compiled() const { return m_compiled; }
+        bool match(const uint8_t* text, size_t text_sz) const;
+        // every string the regex matches begins with this literal; it is
+        // empty unless the regex is anchored with '^'
+        const std::string& literal_prefix() const { return m_prefix; }
+        // every string the regex matches contains each of these literals as
+        // a substring; runs are split wherever a '.' or starred element
+        // appears
+        const std::vector<std::string>& literals() const { return m_literals; }
+
+    private:
+        uint64_t closure(uint64_t states) const;
+
+    private:
+        bool m_compiled;
+        bool m_never;
+        bool m_fallback;
+        bool m_anchor_start;
+        bool m_anchor_end;
+        // bit i of m_masks[c] is set when element i accepts byte c
+        std::vector<uint64_t> m_masks;
+        // bit i is set when element i is starred
+        uint64_t m_star;
+        unsigned m_elements;
+        std::string m_prefix;
+        std::vector<std::string> m_literals;
+        std::string m_regex;
+};
+
 END_HYPERDEX_NAMESPACE
 
 #endif // hyperdex_common_regex_match_h_
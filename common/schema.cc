@@ -36,13 +36,51 @@ using hyperdex::schema;
 schema :: schema()
     : attrs_sz(0)
     , attrs(NULL)
+    , attrs_by_name(NULL)
     , authorization(false)
+    , durability(DURABILITY_ASYNC)
+    , expiry(0)
+    , ordered_key(false)
+    , bucket_attr(0)
+    , bucket_width(0)
+    , immutable(false)
+    , quota_ops(0)
+    , quota_bytes(0)
+    , quota_client_ops(0)
+    , compressed(false)
 {
 }
 
 uint16_t
 schema :: lookup_attr(const char* name) const
 {
+    if (attrs_by_name)
+    {
+        uint16_t lower = 0;
+        uint16_t upper = attrs_sz;
+
+        while (lower < upper)
+        {
+            uint16_t mid = lower + (upper - lower) / 2;
+            int cmp = strcmp(name, attrs[attrs_by_name[mid]].name);
+
+            if (cmp == 0)
+            {
+                return attrs_by_name[mid];
+            }
+            else if (cmp < 0)
+            {
+                upper = mid;
+            }
+            else
+            {
+                lower = mid + 1;
+            }
+        }
+
+        return attrs_sz;
+    }
+
     for (uint16_t i = 0; i < attrs_sz; ++i)
     {
         if (strcmp(name, attrs[i].name) == 0)
@@ -53,3 +91,14 @@ schema :: lookup_attr(const char* name) const
 
     return attrs_sz;
 }
+
+uint16_t
+schema :: lookup_attr(const char* name, uint16_t hint) const
+{
+    if (hint < attrs_sz && strcmp(name, attrs[hint].name) == 0)
+    {
+        return hint;
+    }
+
+    return lookup_attr(name);
+}
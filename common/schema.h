@@ -37,6 +37,20 @@
 
 BEGIN_HYPERDEX_NAMESPACE
 
+// How far toward the disk a write to the space gets before the daemon that
+// makes it moves on to acking it.
+enum durability_level
+{
+    // in LevelDB's log, but left to the OS to flush
+    DURABILITY_ASYNC = 0,
+    // fsync'd on its own before the write returns
+    DURABILITY_SYNC  = 1,
+    // fsync'd together with the writes of a short window
+    DURABILITY_GROUP = 2,
+    // never on disk at all; each daemon's copy is gone when it restarts
+    DURABILITY_MEMORY = 3
+};
+
 class schema
 {
     public:
@@ -44,11 +58,43 @@ class schema
 
     public:
         uint16_t lookup_attr(const char* name) const;
+        // like lookup_attr, but try "hint" first; callers that remember
+        // where they last found a name pay a single comparison for it
+        uint16_t lookup_attr(const char* name, uint16_t hint) const;
 
     public:
         uint16_t attrs_sz;
         const attribute* attrs;
+        // the numbers of attrs in order of their names, so that lookup_attr
+        // may search rather than scan; NULL if whoever filled attrs did not
+        // sort them
+        const uint16_t* attrs_by_name;
         bool authorization;
+        durability_level durability;
+        // the timestamp attribute past which an object reads as absent, or 0
+        // (the key) if objects in the space never expire
+        uint16_t expiry;
+        // place objects in the key subspace by an order-preserving encoding
+        // of the key, so that each region holds a contiguous range of keys
+        bool ordered_key;
+        // the timestamp attribute whose coordinate steps through buckets of
+        // bucket_width microseconds in time order, so that searches for a
+        // span of time go only to the regions holding its buckets; 0 (the
+        // key) if every attribute is hashed
+        uint16_t bucket_attr;
+        uint64_t bucket_width;
+        // set by the administrator once the space is loaded; the space then
+        // refuses writes and any replica may serve its reads
+        bool immutable;
+        // admission quotas each daemon holds requests to the space to; 0 is
+        // no limit.  ops and bytes are for all clients together, client_ops
+        // for each client on its own
+        uint64_t quota_ops;
+        uint64_t quota_bytes;
+        uint64_t quota_client_ops;
+        // store attributes compressed, with dictionaries each daemon trains
+        // from the space's own objects
+        bool compressed;
 };
 
 END_HYPERDEX_NAMESPACE
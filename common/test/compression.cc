@@ -0,0 +1,134 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#define __STDC_LIMIT_MACROS
+
+// STL
+#include <sstream>
+#include <string>
+#include <vector>
+
+// HyperDex
+#include "test/th.h"
+#include "common/compression.h"
+
+TEST(Compression, RoundTrip)
+{
+    std::string doc;
+
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        doc += "{\"name\": \"hyperdex\", \"kind\": \"document\"}";
+    }
+
+    std::vector<char> packed;
+
+    if (!hyperdex::compression_available())
+    {
+        // without a compressor, callers send data as-is
+        ASSERT_FALSE(hyperdex::compress(e::slice(doc), &packed));
+        return;
+    }
+
+    ASSERT_TRUE(hyperdex::compress(e::slice(doc), &packed));
+    ASSERT_LT(packed.size(), doc.size());
+    std::vector<char> unpacked;
+    ASSERT_TRUE(hyperdex::decompress(e::slice(&packed[0], packed.size()), doc.size(), &unpacked));
+    ASSERT_EQ(doc, std::string(&unpacked[0], unpacked.size()));
+    // the size must match exactly
+    ASSERT_FALSE(hyperdex::decompress(e::slice(&packed[0], packed.size()), doc.size() + 1, &unpacked));
+    ASSERT_FALSE(hyperdex::decompress(e::slice(&packed[0], packed.size()), doc.size() - 1, &unpacked));
+}
+
+TEST(Compression, Incompressible)
+{
+    std::string noise;
+    uint64_t x = 0x9e3779b97f4a7c15ULL;
+
+    for (size_t i = 0; i < 4096; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        noise.push_back(static_cast<char>(x));
+    }
+
+    std::vector<char> packed;
+    ASSERT_FALSE(hyperdex::compress(e::slice(noise), &packed));
+}
+
+TEST(Compression, Malformed)
+{
+    std::string junk("\xff\xff\xff\xff\xff\xff\xff\xff");
+    std::vector<char> out;
+    ASSERT_FALSE(hyperdex::decompress(e::slice(junk), 4096, &out));
+}
+
+TEST(Compression, Dictionary)
+{
+    std::vector<std::string> samples;
+
+    for (size_t i = 0; i < 200; ++i)
+    {
+        std::ostringstream ostr;
+        ostr << "{\"user\": " << i * 7919 << ", \"status\": \"active\", "
+             << "\"plan\": \"enterprise\", \"region\": \"us-east\"}";
+        samples.push_back(ostr.str());
+    }
+
+    std::string dict;
+    hyperdex::train_dictionary(samples, 256, &dict);
+    ASSERT_LT(0U, dict.size());
+    ASSERT_LE(dict.size(), 256U);
+    ASSERT_NE(std::string::npos, dict.find("enterprise"));
+
+    std::string doc("{\"user\": 12, \"status\": \"active\", \"plan\": \"enterprise\", \"region\": \"us-east\"}");
+    std::vector<char> packed;
+
+    if (!hyperdex::compression_available())
+    {
+        ASSERT_FALSE(hyperdex::compress_with(e::slice(dict), e::slice(doc), &packed));
+        return;
+    }
+
+    ASSERT_TRUE(hyperdex::compress_with(e::slice(dict), e::slice(doc), &packed));
+    ASSERT_LT(packed.size(), doc.size());
+    std::vector<char> unpacked;
+    ASSERT_TRUE(hyperdex::decompress_with(e::slice(dict), e::slice(&packed[0], packed.size()),
+                                          doc.size(), &unpacked));
+    ASSERT_EQ(doc, std::string(&unpacked[0], unpacked.size()));
+}
+
+TEST(Compression, UnsharedSamples)
+{
+    std::vector<std::string> samples;
+    samples.push_back("the quick brown fox");
+    samples.push_back("jumps over the lazy dog");
+    std::string dict("stale");
+    hyperdex::train_dictionary(samples, 4096, &dict);
+    ASSERT_EQ(0U, dict.size());
+}
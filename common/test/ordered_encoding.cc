@@ -30,6 +30,10 @@
 // C
 #include <cmath>
 #include <stdint.h>
+#include <string.h>
+
+// STL
+#include <algorithm>
 
 // HyperDex
 #include "test/th.h"
@@ -38,6 +42,7 @@
 using hyperdex::ordered_encode_int64;
 using hyperdex::ordered_decode_int64;
 using hyperdex::ordered_encode_double;
+using hyperdex::ordered_encode_bytes;
 
 TEST(OrderedEncoding, EncodeInt64)
 {
@@ -61,6 +66,28 @@ TEST(OrderedEncoding, DecodeInt64)
     ASSERT_EQ(INT64_MIN,     ordered_decode_int64(0x0000000000000000ULL));
 }
 
+TEST(OrderedEncoding, RoundTripInt64)
+{
+    for (size_t i = 0; i < 1000000; ++i)
+    {
+        int64_t x = (static_cast<int64_t>(mrand48()) << 32) ^ static_cast<uint32_t>(mrand48());
+        ASSERT_EQ(x, ordered_decode_int64(ordered_encode_int64(x)));
+    }
+}
+
+TEST(IndexEncode, DoubleFixedPoints)
+{
+    // indices store these, so they must never change
+    ASSERT_EQ(0x8000000000000001ULL, ordered_encode_double(-0.));
+    ASSERT_EQ(0x8000000000000003ULL, ordered_encode_double(4.9406564584124654e-324));
+    ASSERT_EQ(0x7fffffffffffffffULL, ordered_encode_double(-4.9406564584124654e-324));
+    ASSERT_EQ(0xfff0000000000001ULL, ordered_encode_double(1.7976931348623157e+308));
+    ASSERT_EQ(0x0010000000000001ULL, ordered_encode_double(-1.7976931348623157e+308));
+    ASSERT_EQ(0xbff0000000000002ULL, ordered_encode_double(1.));
+    ASSERT_EQ(0x4010000000000000ULL, ordered_encode_double(-1.));
+    ASSERT_EQ(0xfff0000000000003ULL, ordered_encode_double(-NAN));
+}
+
 TEST(IndexEncode, Double)
 {
     ASSERT_EQ(0x0000000000000000ULL, ordered_encode_double(-INFINITY));
@@ -121,3 +148,53 @@ TEST(IndexEncode, Double)
         }
     }
 }
+
+TEST(OrderedEncoding, Bytes)
+{
+    ASSERT_EQ(0x0000000000000000ULL, ordered_encode_bytes("", 0));
+    ASSERT_EQ(0x6100000000000000ULL, ordered_encode_bytes("a", 1));
+    ASSERT_EQ(0x6162000000000000ULL, ordered_encode_bytes("ab", 2));
+    ASSERT_EQ(0x6162636465666768ULL, ordered_encode_bytes("abcdefgh", 8));
+    ASSERT_EQ(0x6162636465666768ULL, ordered_encode_bytes("abcdefghij", 10));
+    ASSERT_EQ(0xff00000000000000ULL, ordered_encode_bytes("\xff", 1));
+
+    char old_s[12];
+    size_t old_sz = 0;
+    uint64_t old_e = 0;
+
+    for (size_t i = 0; i < 1000000; ++i)
+    {
+        char s[12];
+        size_t sz = lrand48() % sizeof(s);
+
+        for (size_t j = 0; j < sz; ++j)
+        {
+            s[j] = static_cast<char>(lrand48() & 0x3);
+        }
+
+        uint64_t e = ordered_encode_bytes(s, sz);
+        int cmp = memcmp(old_s, s, std::min(old_sz, sz));
+
+        if (cmp == 0)
+        {
+            cmp = old_sz < sz ? -1 : old_sz > sz ? 1 : 0;
+        }
+
+        if (cmp < 0)
+        {
+            ASSERT_TRUE(old_e <= e);
+        }
+        else if (cmp > 0)
+        {
+            ASSERT_TRUE(old_e >= e);
+        }
+        else
+        {
+            ASSERT_TRUE(old_e == e);
+        }
+
+        memmove(old_s, s, sz);
+        old_sz = sz;
+        old_e = e;
+    }
+}
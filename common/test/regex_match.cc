@@ -0,0 +1,152 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <stdlib.h>
+
+// STL
+#include <string>
+#include <vector>
+
+// HyperDex
+#include "test/th.h"
+#include "common/regex_match.h"
+
+using hyperdex::compiled_regex;
+using hyperdex::regex_match;
+
+static bool
+compiled_match(const std::string& regex, const std::string& text)
+{
+    compiled_regex re;
+    re.compile(reinterpret_cast<const uint8_t*>(regex.data()), regex.size());
+    return re.match(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+}
+
+static bool
+interpreted_match(const std::string& regex, const std::string& text)
+{
+    return regex_match(reinterpret_cast<const uint8_t*>(regex.data()), regex.size(),
+                       reinterpret_cast<const uint8_t*>(text.data()), text.size());
+}
+
+static std::string
+literal_prefix(const std::string& regex)
+{
+    compiled_regex re;
+    re.compile(reinterpret_cast<const uint8_t*>(regex.data()), regex.size());
+    return re.literal_prefix();
+}
+
+static std::vector<std::string>
+literals(const std::string& regex)
+{
+    compiled_regex re;
+    re.compile(reinterpret_cast<const uint8_t*>(regex.data()), regex.size());
+    return re.literals();
+}
+
+TEST(CompiledRegex, Basics)
+{
+    ASSERT_TRUE(compiled_match("", "anything"));
+    ASSERT_TRUE(compiled_match("b.d", "abcde"));
+    ASSERT_FALSE(compiled_match("^b.d", "abcde"));
+    ASSERT_TRUE(compiled_match("^ab*c$", "ac"));
+    ASSERT_TRUE(compiled_match("^ab*c$", "abbbc"));
+    ASSERT_FALSE(compiled_match("^ab*c$", "abbbcd"));
+    ASSERT_TRUE(compiled_match("a\\.c", "xa.c"));
+    ASSERT_FALSE(compiled_match("a\\.c", "xabc"));
+    ASSERT_FALSE(compiled_match("a\\", "a\\"));
+    ASSERT_TRUE(compiled_match("a$b", "a$b"));
+}
+
+TEST(CompiledRegex, LiteralPrefix)
+{
+    ASSERT_EQ(std::string(""), literal_prefix("abc"));
+    ASSERT_EQ(std::string("abc"), literal_prefix("^abc"));
+    ASSERT_EQ(std::string("ab"), literal_prefix("^abc*"));
+    ASSERT_EQ(std::string("a"), literal_prefix("^a.c"));
+    ASSERT_EQ(std::string("a.c"), literal_prefix("^a\\.c$"));
+}
+
+TEST(CompiledRegex, Literals)
+{
+    ASSERT_TRUE(literals("").empty());
+    ASSERT_TRUE(literals(".*").empty());
+    ASSERT_EQ(1U, literals("^abc$").size());
+    ASSERT_EQ(std::string("abc"), literals("^abc$")[0]);
+    ASSERT_EQ(2U, literals("abc.de").size());
+    ASSERT_EQ(std::string("abc"), literals("abc.de")[0]);
+    ASSERT_EQ(std::string("de"), literals("abc.de")[1]);
+    ASSERT_EQ(2U, literals("abx*cd").size());
+    ASSERT_EQ(std::string("ab"), literals("abx*cd")[0]);
+    ASSERT_EQ(std::string("cd"), literals("abx*cd")[1]);
+    ASSERT_EQ(std::string("a.c"), literals("a\\.c")[0]);
+}
+
+TEST(CompiledRegex, LongPattern)
+{
+    std::string regex(100, 'a');
+    ASSERT_TRUE(compiled_match(regex, std::string(101, 'a')));
+    ASSERT_FALSE(compiled_match(regex, std::string(99, 'a')));
+}
+
+TEST(CompiledRegex, AgreesWithInterpreter)
+{
+    const char regex_chars[] = "ab.*^$\\";
+    const char text_chars[] = "ab*.$^\\";
+
+    for (size_t i = 0; i < 1000000; ++i)
+    {
+        std::string regex;
+        std::string text;
+        size_t regex_sz = lrand48() % 8;
+        size_t text_sz = lrand48() % 8;
+
+        for (size_t j = 0; j < regex_sz; ++j)
+        {
+            regex.push_back(regex_chars[lrand48() % (sizeof(regex_chars) - 1)]);
+        }
+
+        for (size_t j = 0; j < text_sz; ++j)
+        {
+            text.push_back(text_chars[lrand48() % (sizeof(text_chars) - 1)]);
+        }
+
+        ASSERT_EQ(interpreted_match(regex, text), compiled_match(regex, text));
+
+        if (interpreted_match(regex, text))
+        {
+            std::vector<std::string> lits = literals(regex);
+
+            for (size_t j = 0; j < lits.size(); ++j)
+            {
+                ASSERT_TRUE(text.find(lits[j]) != std::string::npos);
+            }
+        }
+    }
+}
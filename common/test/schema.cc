@@ -0,0 +1,68 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// HyperDex
+#include "test/th.h"
+#include "common/schema.h"
+
+using hyperdex::attribute;
+using hyperdex::schema;
+
+TEST(Schema, LookupAttr)
+{
+    attribute attrs[5];
+    attrs[0] = attribute("key", HYPERDATATYPE_STRING);
+    attrs[1] = attribute("zeta", HYPERDATATYPE_INT64);
+    attrs[2] = attribute("alpha", HYPERDATATYPE_STRING);
+    attrs[3] = attribute("mu", HYPERDATATYPE_FLOAT);
+    attrs[4] = attribute("beta", HYPERDATATYPE_STRING);
+    const uint16_t by_name[5] = {2, 4, 0, 3, 1};
+    schema sc;
+    sc.attrs_sz = 5;
+    sc.attrs = attrs;
+
+    // scanning and searching agree, on names present and absent
+    for (int sorted = 0; sorted < 2; ++sorted)
+    {
+        sc.attrs_by_name = sorted ? by_name : NULL;
+        ASSERT_EQ(sc.lookup_attr("key"), 0U);
+        ASSERT_EQ(sc.lookup_attr("zeta"), 1U);
+        ASSERT_EQ(sc.lookup_attr("alpha"), 2U);
+        ASSERT_EQ(sc.lookup_attr("mu"), 3U);
+        ASSERT_EQ(sc.lookup_attr("beta"), 4U);
+        ASSERT_EQ(sc.lookup_attr("aardvark"), 5U);
+        ASSERT_EQ(sc.lookup_attr("nu"), 5U);
+        ASSERT_EQ(sc.lookup_attr("zz"), 5U);
+    }
+
+    // a wrong or out of range hint still finds the name
+    ASSERT_EQ(sc.lookup_attr("mu", 3), 3U);
+    ASSERT_EQ(sc.lookup_attr("mu", 1), 3U);
+    ASSERT_EQ(sc.lookup_attr("mu", 9), 3U);
+    ASSERT_EQ(sc.lookup_attr("nu", 3), 5U);
+}
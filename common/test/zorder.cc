@@ -0,0 +1,129 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdint.h>
+#include <stdlib.h>
+
+// HyperDex
+#include "test/th.h"
+#include "common/zorder.h"
+
+using hyperdex::zorder_contains;
+using hyperdex::zorder_interleave;
+using hyperdex::zorder_next;
+
+namespace
+{
+
+// the code of a point whose coordinates fit in the low bits of each
+// dimension's truncated code
+uint64_t
+point(uint64_t x, uint64_t y)
+{
+    uint64_t codes[2];
+    codes[0] = x << 32;
+    codes[1] = y << 32;
+    return zorder_interleave(codes, 2);
+}
+
+} // namespace
+
+TEST(ZOrder, Interleave)
+{
+    uint64_t codes[3];
+    codes[0] = 0xffffffffffffffffULL;
+    codes[1] = 0;
+    ASSERT_EQ(0xaaaaaaaaaaaaaaaaULL, zorder_interleave(codes, 2));
+    codes[0] = 0;
+    codes[1] = 0xffffffffffffffffULL;
+    ASSERT_EQ(0x5555555555555555ULL, zorder_interleave(codes, 2));
+    codes[0] = 0x8000000000000000ULL;
+    ASSERT_EQ(0x8000000000000000ULL, zorder_interleave(codes, 1));
+    codes[0] = 0xffffffffffffffffULL;
+    codes[1] = 0;
+    codes[2] = 0;
+    // 21 bits of each, in the low 63 bits
+    ASSERT_EQ(0x4924924924924924ULL, zorder_interleave(codes, 3));
+    ASSERT_EQ(point(3, 1), 0xbULL);
+}
+
+TEST(ZOrder, Contains)
+{
+    const uint64_t zmin = point(2, 3);
+    const uint64_t zmax = point(5, 6);
+    ASSERT_TRUE(zorder_contains(point(2, 3), zmin, zmax, 2));
+    ASSERT_TRUE(zorder_contains(point(5, 6), zmin, zmax, 2));
+    ASSERT_TRUE(zorder_contains(point(4, 4), zmin, zmax, 2));
+    ASSERT_FALSE(zorder_contains(point(1, 4), zmin, zmax, 2));
+    ASSERT_FALSE(zorder_contains(point(4, 7), zmin, zmax, 2));
+}
+
+TEST(ZOrder, NextMatchesBruteForce)
+{
+    for (size_t trial = 0; trial < 2000; ++trial)
+    {
+        uint64_t x0 = lrand48() % 16;
+        uint64_t x1 = x0 + lrand48() % (16 - x0);
+        uint64_t y0 = lrand48() % 16;
+        uint64_t y1 = y0 + lrand48() % (16 - y0);
+        const uint64_t zmin = point(x0, y0);
+        const uint64_t zmax = point(x1, y1);
+        uint64_t z = point(lrand48() % 16, lrand48() % 16);
+
+        if (zorder_contains(z, zmin, zmax, 2))
+        {
+            continue;
+        }
+
+        bool expected_found = false;
+        uint64_t expected = 0;
+
+        for (uint64_t x = x0; x <= x1; ++x)
+        {
+            for (uint64_t y = y0; y <= y1; ++y)
+            {
+                uint64_t c = point(x, y);
+
+                if (c > z && (!expected_found || c < expected))
+                {
+                    expected_found = true;
+                    expected = c;
+                }
+            }
+        }
+
+        uint64_t next = 0;
+        ASSERT_EQ(expected_found, zorder_next(z, zmin, zmax, 2, &next));
+
+        if (expected_found)
+        {
+            ASSERT_EQ(expected, next);
+        }
+    }
+}
@@ -0,0 +1,154 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <assert.h>
+
+// HyperDex
+#include "common/zorder.h"
+
+namespace
+{
+
+// the bits below "bit" that belong to the same dimension
+uint64_t
+lower_bits(size_t bit, size_t d)
+{
+    uint64_t mask = 0;
+
+    while (bit >= d)
+    {
+        bit -= d;
+        mask |= 1ULL << bit;
+    }
+
+    return mask;
+}
+
+uint64_t
+deinterleave(uint64_t z, size_t dim, size_t d)
+{
+    const size_t bits = 64 / d;
+    uint64_t coord = 0;
+
+    for (size_t j = bits; j > 0; --j)
+    {
+        coord = (coord << 1) | ((z >> ((j - 1) * d + (d - 1 - dim))) & 1);
+    }
+
+    return coord;
+}
+
+} // namespace
+
+uint64_t
+hyperdex :: zorder_interleave(const uint64_t* codes, size_t d)
+{
+    assert(d > 0 && d <= ZORDER_MAX_DIMENSIONS);
+    const size_t bits = 64 / d;
+    uint64_t z = 0;
+
+    for (size_t j = 0; j < bits; ++j)
+    {
+        for (size_t k = 0; k < d; ++k)
+        {
+            z = (z << 1) | ((codes[k] >> (63 - j)) & 1);
+        }
+    }
+
+    return z;
+}
+
+bool
+hyperdex :: zorder_contains(uint64_t z, uint64_t zmin, uint64_t zmax, size_t d)
+{
+    for (size_t k = 0; k < d; ++k)
+    {
+        uint64_t c = deinterleave(z, k, d);
+
+        if (c < deinterleave(zmin, k, d) || c > deinterleave(zmax, k, d))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Tropf and Herzog's BIGMIN:  walk the bits from the top, narrowing the box
+// to the half that can still hold an answer, and remember the least corner
+// of the upper half each time the walk takes the lower one.
+bool
+hyperdex :: zorder_next(uint64_t z, uint64_t zmin, uint64_t zmax, size_t d, uint64_t* next)
+{
+    const size_t bits = (64 / d) * d;
+    bool found = false;
+    uint64_t bigmin = 0;
+
+    for (size_t i = bits; i > 0; --i)
+    {
+        const size_t bit = i - 1;
+        const uint64_t mask = 1ULL << bit;
+        const uint64_t lower = lower_bits(bit, d);
+        const bool zb = z & mask;
+        const bool lb = zmin & mask;
+        const bool hb = zmax & mask;
+
+        if (!zb && !lb && hb)
+        {
+            bigmin = (zmin | mask) & ~lower;
+            found = true;
+            zmax = (zmax & ~mask) | lower;
+        }
+        else if (!zb && lb && hb)
+        {
+            *next = zmin;
+            return true;
+        }
+        else if (zb && !lb && !hb)
+        {
+            break;
+        }
+        else if (zb && !lb && hb)
+        {
+            zmin = (zmin | mask) & ~lower;
+        }
+        else if (lb && !hb)
+        {
+            // zmin > zmax in this dimension:  the box is empty
+            return false;
+        }
+    }
+
+    if (found)
+    {
+        *next = bigmin;
+    }
+
+    return found;
+}
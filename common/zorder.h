@@ -0,0 +1,64 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_common_zorder_h_
+#define hyperdex_common_zorder_h_
+
+// C
+#include <stddef.h>
+#include <stdint.h>
+
+// HyperDex
+#include "namespace.h"
+
+// A Z-order code interleaves the bits of several ordered codes (see
+// ordered_encoding.h), most significant first, so that points close in every
+// dimension tend to be close in the code.  Each of "d" dimensions keeps its
+// top 64 / d bits; the code occupies the low d * (64 / d) bits of a uint64_t.
+
+// the most dimensions a spatial index may span
+#define ZORDER_MAX_DIMENSIONS 4
+
+BEGIN_HYPERDEX_NAMESPACE
+
+uint64_t
+zorder_interleave(const uint64_t* codes, size_t d);
+
+// true if the point "z" lies in the box whose corners are the codes "zmin"
+// and "zmax"
+bool
+zorder_contains(uint64_t z, uint64_t zmin, uint64_t zmax, size_t d);
+
+// the smallest code greater than "z" that lies in the box, if any; "z" must
+// lie outside the box
+bool
+zorder_next(uint64_t z, uint64_t zmin, uint64_t zmax, size_t d, uint64_t* next);
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_common_zorder_h_
@@ -26,9 +26,11 @@
 // POSSIBILITY OF SUCH DAMAGE.
 
 #define __STDC_FORMAT_MACROS
+#define __STDC_LIMIT_MACROS
 
 // C
 #include <inttypes.h>
+#include <stdlib.h>
 
 // STL
 #include <algorithm>
@@ -37,21 +39,48 @@
 
 // e
 #include <e/endian.h>
+#include <e/varint.h>
 
 // HyperDex
 #include "common/configuration_flags.h"
 #include "common/serialization.h"
+#include "common/zorder.h"
 #include "coordinator/coordinator.h"
 #include "coordinator/transitions.h"
 #include "coordinator/util.h"
 
 #define ALARM_INTERVAL 30
+#define TRIGRAM_INDEX_PREFIX "trigram:"
+#define HASHED_INDEX_PREFIX "hashed:"
+#define SPATIAL_INDEX_PREFIX "spatial:"
+#define COVERING_INDEX_INCLUDE " include "
+#define PARTIAL_INDEX_WHERE " where "
+#define PARTIAL_INDEX_AND " and "
+#define DOCUMENT_INDEX_AS " as "
+// balance_load acts when a server carries this many percent more than the
+// mean load, and moves load only onto servers that end up below half that
+#define LOAD_IMBALANCE_PERCENT 25
+// a region's cost is its share, in millionths, of the cluster's bytes plus
+// its share of the cluster's ops
+#define LOAD_SCALE 1000000ULL
+// split_large_region halves any region whose largest replica holds more
+// than this many bytes
+#define REGION_SPLIT_BYTES (8ULL * 1024ULL * 1024ULL * 1024ULL)
+// snapshots open with this ("hyperdex" in ASCII) and a version byte;
+// earlier releases wrote neither and began with the cluster id instead;
+// version 2 lacks the server zones that version 3 appends, and version 3
+// the server epochs of version 4
+#define SNAPSHOT_MAGIC 0x6879706572646578ULL
+#define SNAPSHOT_VERSION 4
 
 using hyperdex::coordinator;
 using hyperdex::region;
+using hyperdex::region_id;
 using hyperdex::region_intent;
 using hyperdex::server;
+using hyperdex::server_id;
 using hyperdex::transfer;
+using hyperdex::virtual_server_id;
 
 // ASSUME:  I'm assuming only one server ever changes state at a time for a
 //          given transition.  If you violate this assumption, fixup
@@ -130,6 +159,356 @@ remove_id(const TID& id, std::vector<T>* v)
     }
 }
 
+// split a comma-separated list of attribute names into their numbers;
+// returns false and the offending name if one doesn't exist
+bool
+lookup_attrs(const hyperdex::schema& sc, const std::string& list,
+             std::vector<uint16_t>* attrs, std::string* bad)
+{
+    size_t start = 0;
+
+    while (start < list.size())
+    {
+        size_t end = list.find(',', start);
+        end = end == std::string::npos ? list.size() : end;
+        std::string name(list.substr(start, end - start));
+        uint16_t num = sc.lookup_attr(name.c_str());
+        start = end + 1;
+
+        if (num >= sc.attrs_sz)
+        {
+            *bad = name;
+            return false;
+        }
+
+        attrs->push_back(num);
+    }
+
+    return true;
+}
+
+// a list of attribute numbers as stored in an index's "extra"
+std::string
+pack_attrs(const std::vector<uint16_t>& attrs)
+{
+    std::string packed(attrs.size() * sizeof(uint16_t), '\0');
+
+    for (size_t i = 0; i < attrs.size(); ++i)
+    {
+        e::pack16be(attrs[i], &packed[i * sizeof(uint16_t)]);
+    }
+
+    return packed;
+}
+
+// can NORMAL indices of this type include attributes, and can attributes of
+// this type be part of a composite index?
+bool
+primitive_indexable(hyperdatatype t)
+{
+    return t == HYPERDATATYPE_STRING ||
+           t == HYPERDATATYPE_INT64 ||
+           t == HYPERDATATYPE_FLOAT ||
+           (CONTAINER_TYPE(t) == HYPERDATATYPE_TIMESTAMP_GENERIC &&
+            t != HYPERDATATYPE_TIMESTAMP_GENERIC);
+}
+
+// can attributes of this type be dimensions of a spatial index?
+bool
+spatial_indexable(hyperdatatype t)
+{
+    return t == HYPERDATATYPE_INT64 ||
+           t == HYPERDATATYPE_FLOAT ||
+           (CONTAINER_TYPE(t) == HYPERDATATYPE_TIMESTAMP_GENERIC &&
+            t != HYPERDATATYPE_TIMESTAMP_GENERIC);
+}
+
+// parse one "<attr> <op> <value>" condition of a partial index's filter;
+// values are interpreted according to the attribute's type
+bool
+parse_condition(const hyperdex::schema& sc, const std::string& cond,
+                uint16_t* attr, hyperpredicate* pred, std::string* value)
+{
+    size_t op = cond.find_first_of("=<>");
+
+    if (op == std::string::npos)
+    {
+        return false;
+    }
+
+    size_t name_end = cond.find_last_not_of(' ', op == 0 ? 0 : op - 1);
+    std::string name(cond.substr(0, name_end == std::string::npos ? 0 : name_end + 1));
+    std::string rest(cond.substr(op));
+    size_t op_sz = 1;
+
+    if (rest.compare(0, 2, "<=") == 0)
+    {
+        *pred = HYPERPREDICATE_LESS_EQUAL;
+        op_sz = 2;
+    }
+    else if (rest.compare(0, 2, ">=") == 0)
+    {
+        *pred = HYPERPREDICATE_GREATER_EQUAL;
+        op_sz = 2;
+    }
+    else if (rest[0] == '<')
+    {
+        *pred = HYPERPREDICATE_LESS_THAN;
+    }
+    else if (rest[0] == '>')
+    {
+        *pred = HYPERPREDICATE_GREATER_THAN;
+    }
+    else
+    {
+        *pred = HYPERPREDICATE_EQUALS;
+    }
+
+    size_t val_start = rest.find_first_not_of(' ', op_sz);
+    std::string val(val_start == std::string::npos ? "" : rest.substr(val_start));
+    *attr = sc.lookup_attr(name.c_str());
+
+    if (*attr >= sc.attrs_sz || !primitive_indexable(sc.attrs[*attr].type))
+    {
+        return false;
+    }
+
+    const hyperdatatype t = sc.attrs[*attr].type;
+
+    if (t == HYPERDATATYPE_STRING)
+    {
+        if (val.size() >= 2 && val[0] == '"' && val[val.size() - 1] == '"')
+        {
+            val = val.substr(1, val.size() - 2);
+        }
+
+        *value = val;
+        return true;
+    }
+
+    char* end = NULL;
+    value->resize(sizeof(int64_t));
+
+    if (t == HYPERDATATYPE_FLOAT)
+    {
+        double d = strtod(val.c_str(), &end);
+        e::packdoublele(d, &(*value)[0]);
+    }
+    else
+    {
+        int64_t i = strtoll(val.c_str(), &end, 10);
+        e::pack64le(i, &(*value)[0]);
+    }
+
+    return !val.empty() && end && *end == '\0';
+}
+
+// parse conditions joined by " and " into the form kept in index::filter;
+// returns false and the offending condition if one can't be parsed
+bool
+parse_filter(const hyperdex::schema& sc, const std::string& clause,
+             std::string* filter, std::string* bad)
+{
+    std::vector<uint16_t> attrs;
+    std::vector<hyperpredicate> preds;
+    std::vector<std::string> values;
+    size_t start = 0;
+
+    while (start <= clause.size())
+    {
+        size_t end = clause.find(PARTIAL_INDEX_AND, start);
+        end = end == std::string::npos ? clause.size() : end;
+        std::string cond(clause.substr(start, end - start));
+        start = end + strlen(PARTIAL_INDEX_AND);
+        uint16_t attr;
+        hyperpredicate pred;
+        std::string value;
+
+        if (!parse_condition(sc, cond, &attr, &pred, &value))
+        {
+            *bad = cond;
+            return false;
+        }
+
+        attrs.push_back(attr);
+        preds.push_back(pred);
+        values.push_back(value);
+    }
+
+    size_t sz = sizeof(uint32_t);
+
+    for (size_t i = 0; i < attrs.size(); ++i)
+    {
+        sz += sizeof(uint16_t)
+            + sizeof(uint32_t) + values[i].size()
+            + sizeof(uint16_t) + sizeof(uint16_t);
+    }
+
+    // lay each condition out the way an attribute_check is packed
+    std::auto_ptr<e::buffer> buf(e::buffer::create(sz));
+    e::packer pa = buf->pack();
+    pa = pa << uint32_t(attrs.size());
+
+    for (size_t i = 0; i < attrs.size(); ++i)
+    {
+        pa = pa << attrs[i] << e::slice(values[i])
+                << static_cast<uint16_t>(sc.attrs[attrs[i]].type)
+                << static_cast<uint16_t>(preds[i]);
+    }
+
+    filter->assign(reinterpret_cast<const char*>(buf->data()), buf->size());
+    return true;
+}
+
+void
+append_varint(uint64_t x, std::string* out)
+{
+    char buf[VARINT_64_MAX_SIZE];
+    char* end = e::packvarint64(x, buf);
+    out->append(buf, end);
+}
+
+// Regions make up nearly all of a snapshot, and most of what they hold is
+// predictable:  ids are handed out in order, each region's bounds begin
+// where the previous region's end, and replicas name one of a few servers.
+// Write each region's id and bounds as varint deltas from its predecessor's
+// (wrapping around 2^64 where they go backwards), and each replica's server
+// as one more than its index in the sorted "sids", or 0 and the id itself.
+void
+pack_compact_regions(const std::vector<uint64_t>& sids,
+                     const std::vector<region>& regions,
+                     std::string* out)
+{
+    append_varint(regions.size(), out);
+    uint64_t prev_id = 0;
+    std::vector<uint64_t> prev_upper;
+
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+        const region& r(regions[i]);
+        append_varint(r.id.get() - prev_id, out);
+        prev_id = r.id.get();
+        append_varint(r.lower_coord.size(), out);
+        prev_upper.resize(r.lower_coord.size(), UINT64_MAX);
+
+        for (size_t j = 0; j < r.lower_coord.size(); ++j)
+        {
+            append_varint(r.lower_coord[j] - prev_upper[j] - 1, out);
+            append_varint(r.upper_coord[j] - r.lower_coord[j], out);
+            prev_upper[j] = r.upper_coord[j];
+        }
+
+        append_varint(r.replicas.size(), out);
+
+        for (size_t j = 0; j < r.replicas.size(); ++j)
+        {
+            const uint64_t si = r.replicas[j].si.get();
+            std::vector<uint64_t>::const_iterator it;
+            it = std::lower_bound(sids.begin(), sids.end(), si);
+
+            if (it != sids.end() && *it == si)
+            {
+                append_varint(it - sids.begin() + 1, out);
+            }
+            else
+            {
+                append_varint(0, out);
+                append_varint(si, out);
+            }
+
+            append_varint(r.replicas[j].vsi.get(), out);
+        }
+    }
+}
+
+bool
+unpack_compact_regions(const std::vector<uint64_t>& sids,
+                       const char** _ptr, const char* end,
+                       std::vector<region>* regions)
+{
+    const char* ptr = *_ptr;
+    uint64_t num_regions = 0;
+    ptr = e::varint64_decode(ptr, end, &num_regions);
+
+    if (!ptr || num_regions > static_cast<uint64_t>(end - ptr))
+    {
+        return false;
+    }
+
+    regions->resize(num_regions);
+    uint64_t prev_id = 0;
+    std::vector<uint64_t> prev_upper;
+
+    for (size_t i = 0; ptr && i < regions->size(); ++i)
+    {
+        region& r((*regions)[i]);
+        uint64_t id = 0;
+        uint64_t num_hashes = 0;
+        uint64_t num_replicas = 0;
+        ptr = ptr ? e::varint64_decode(ptr, end, &id) : NULL;
+        ptr = ptr ? e::varint64_decode(ptr, end, &num_hashes) : NULL;
+
+        if (!ptr || num_hashes > static_cast<uint64_t>(end - ptr))
+        {
+            return false;
+        }
+
+        prev_id += id;
+        r.id = region_id(prev_id);
+        r.lower_coord.resize(num_hashes);
+        r.upper_coord.resize(num_hashes);
+        prev_upper.resize(num_hashes, UINT64_MAX);
+
+        for (size_t j = 0; ptr && j < num_hashes; ++j)
+        {
+            uint64_t lower = 0;
+            uint64_t width = 0;
+            ptr = ptr ? e::varint64_decode(ptr, end, &lower) : NULL;
+            ptr = ptr ? e::varint64_decode(ptr, end, &width) : NULL;
+            r.lower_coord[j] = prev_upper[j] + 1 + lower;
+            r.upper_coord[j] = r.lower_coord[j] + width;
+            prev_upper[j] = r.upper_coord[j];
+        }
+
+        ptr = ptr ? e::varint64_decode(ptr, end, &num_replicas) : NULL;
+
+        if (!ptr || num_replicas > static_cast<uint64_t>(end - ptr))
+        {
+            return false;
+        }
+
+        r.replicas.resize(num_replicas);
+
+        for (size_t j = 0; ptr && j < num_replicas; ++j)
+        {
+            uint64_t idx = 0;
+            uint64_t si = 0;
+            uint64_t vsi = 0;
+            ptr = ptr ? e::varint64_decode(ptr, end, &idx) : NULL;
+
+            if (ptr && idx == 0)
+            {
+                ptr = e::varint64_decode(ptr, end, &si);
+            }
+            else if (ptr && idx <= sids.size())
+            {
+                si = sids[idx - 1];
+            }
+            else
+            {
+                return false;
+            }
+
+            ptr = ptr ? e::varint64_decode(ptr, end, &vsi) : NULL;
+            r.replicas[j].si = server_id(si);
+            r.replicas[j].vsi = virtual_server_id(vsi);
+        }
+    }
+
+    *_ptr = ptr;
+    return ptr != NULL;
+}
+
 } // namespace
 
 coordinator :: coordinator()
@@ -137,7 +516,10 @@ coordinator :: coordinator()
     , m_counter(1)
     , m_version(0)
     , m_flags(0)
+    , m_transfer_rate(0)
     , m_servers()
+    , m_zones()
+    , m_epochs()
     , m_permutation()
     , m_spares()
     , m_desired_spares(0)
@@ -146,6 +528,8 @@ coordinator :: coordinator()
     , m_deferred_init()
     , m_offline()
     , m_transfers()
+    , m_loads()
+    , m_placements()
     , m_config_ack_through(0)
     , m_config_ack_barrier()
     , m_config_stable_through(0)
@@ -226,6 +610,29 @@ coordinator :: read_only(rsm_context* ctx, bool ro)
     return generate_response(ctx, COORD_SUCCESS);
 }
 
+void
+coordinator :: transfer_rate(rsm_context* ctx, uint64_t rate)
+{
+    if (rate == m_transfer_rate)
+    {
+        rsm_log(ctx, "state transfer rate already %" PRIu64 " bytes/second\n", rate);
+        return generate_response(ctx, COORD_SUCCESS);
+    }
+
+    if (rate == 0)
+    {
+        rsm_log(ctx, "removing the limit on state transfer rate\n");
+    }
+    else
+    {
+        rsm_log(ctx, "limiting state transfer to %" PRIu64 " bytes/second per server\n", rate);
+    }
+
+    m_transfer_rate = rate;
+    generate_next_configuration(ctx);
+    return generate_response(ctx, COORD_SUCCESS);
+}
+
 void
 coordinator :: fault_tolerance(rsm_context* ctx,
                                const char* space, uint64_t ft)
@@ -255,9 +662,10 @@ coordinator :: fault_tolerance(rsm_context* ctx,
 
     R = ft + 1;
     P = s->predecessor_width;
-    compute_replica_sets(R, P, m_permutation, m_servers,
+    compute_replica_sets(R, P, m_permutation, m_servers, m_zones,
                          &replica_storage,
                          &replica_sets);
+    log_chain_latency(ctx, R, replica_sets);
 
     setup_intents(ctx, replica_sets, s.get(), false);
 
@@ -268,7 +676,8 @@ coordinator :: fault_tolerance(rsm_context* ctx,
 void
 coordinator :: server_register(rsm_context* ctx,
                                const server_id& sid,
-                               const po6::net::location& bind_to)
+                               const po6::net::location& bind_to,
+                               const std::string& zone)
 {
     server* srv = get_server(sid);
 
@@ -283,7 +692,18 @@ coordinator :: server_register(rsm_context* ctx,
     srv = new_server(sid);
     srv->state = server::ASSIGNED;
     srv->bind_to = bind_to;
-    rsm_log(ctx, "registered server(%" PRIu64 ")\n", sid.get());
+
+    if (!zone.empty())
+    {
+        m_zones.push_back(server_zone(sid, zone));
+        std::sort(m_zones.begin(), m_zones.end());
+        rsm_log(ctx, "registered server(%" PRIu64 ") in zone %s\n", sid.get(), zone.c_str());
+    }
+    else
+    {
+        rsm_log(ctx, "registered server(%" PRIu64 ")\n", sid.get());
+    }
+
     generate_next_configuration(ctx);
     return generate_response(ctx, COORD_SUCCESS);
 }
@@ -313,6 +733,7 @@ coordinator :: server_online(rsm_context* ctx,
     }
 
     bool changed = false;
+    bool came_online = false;
 
     if (bind_to && srv->bind_to != *bind_to)
     {
@@ -352,6 +773,7 @@ coordinator :: server_online(rsm_context* ctx,
 
         rebalance_replica_sets(ctx);
         changed = true;
+        came_online = true;
     }
 
     if (changed)
@@ -359,6 +781,22 @@ coordinator :: server_online(rsm_context* ctx,
         generate_next_configuration(ctx);
     }
 
+    if (came_online)
+    {
+        server_epoch se(sid, m_version);
+        std::vector<server_epoch>::iterator it;
+        it = std::lower_bound(m_epochs.begin(), m_epochs.end(), se);
+
+        if (it != m_epochs.end() && it->sid == sid)
+        {
+            it->version = m_version;
+        }
+        else
+        {
+            m_epochs.insert(it, se);
+        }
+    }
+
     return generate_response(ctx, COORD_SUCCESS);
 }
 
@@ -487,6 +925,38 @@ coordinator :: server_forget(rsm_context* ctx,
     std::stable_sort(m_servers.begin(), m_servers.end());
     remove_permutation(sid);
     remove_offline(sid);
+
+    for (size_t i = 0; i < m_zones.size(); ++i)
+    {
+        if (m_zones[i].sid == sid)
+        {
+            m_zones.erase(m_zones.begin() + i);
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < m_epochs.size(); ++i)
+    {
+        if (m_epochs[i].sid == sid)
+        {
+            m_epochs.erase(m_epochs.begin() + i);
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < m_loads.size(); )
+    {
+        if (m_loads[i].sid == sid)
+        {
+            std::swap(m_loads[i], m_loads.back());
+            m_loads.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
     rebalance_replica_sets(ctx);
     generate_next_configuration(ctx);
     return generate_response(ctx, COORD_SUCCESS);
@@ -533,59 +1003,229 @@ coordinator :: server_suspect(rsm_context* ctx,
 }
 
 void
-coordinator :: report_disconnect(rsm_context* ctx,
-                                 const server_id& sid, uint64_t version)
+coordinator :: report_disconnect(rsm_context* ctx, uint64_t version,
+                                 const std::vector<server_id>& sids)
 {
-    if (m_version != version)
+    bool changed = false;
+
+    for (size_t i = 0; i < sids.size(); ++i)
     {
-        return;
-    }
+        server* srv = get_server(sids[i]);
 
-    return server_suspect(ctx, sid);
-}
+        if (!srv ||
+            (srv->state != server::ASSIGNED &&
+             srv->state != server::AVAILABLE))
+        {
+            continue;
+        }
 
-static bool
-is_space_name(const char* str)
-{
-    size_t i = 0;
+        // A report made under an older configuration still counts, so that
+        // reports racing a reconfiguration are not thrown away, unless the
+        // server has come back online since.
+        server_epoch se(sids[i], 0);
+        std::vector<server_epoch>::iterator it;
+        it = std::lower_bound(m_epochs.begin(), m_epochs.end(), se);
 
-    for (i = 0; str[i]; ++i)
-    {
-        if (!(i > 0 && isdigit(str[i])) &&
-            !(isalpha(str[i])) &&
-            str[i] != '_')
+        if (version > m_version ||
+            (it != m_epochs.end() && it->sid == sids[i] && version < it->version))
         {
-            return false;
+            continue;
         }
+
+        rsm_log(ctx, "changing server(%" PRIu64 ") from %s to %s because "
+                     "another server lost touch with it in version %" PRIu64 "\n",
+                     sids[i].get(), server::to_string(srv->state),
+                     server::to_string(server::NOT_AVAILABLE), version);
+        srv->state = server::NOT_AVAILABLE;
+        changed = true;
     }
 
-    return i > 0;
+    if (changed)
+    {
+        rebalance_replica_sets(ctx);
+        generate_next_configuration(ctx);
+    }
+
+    return generate_response(ctx, COORD_SUCCESS);
 }
 
 void
-coordinator :: space_add(rsm_context* ctx, const space& _s)
+coordinator :: report_load(rsm_context* ctx,
+                           const server_id& sid,
+                           const std::vector<region_id>& rids,
+                           const std::vector<uint64_t>& bytes,
+                           const std::vector<uint64_t>& ops)
 {
-
-    if (!_s.validate())
+    if (rids.size() != bytes.size() || rids.size() != ops.size())
     {
-        rsm_log(ctx, "could not add space \"%s\" because the space does not validate\n", _s.name);
+        rsm_log(ctx, "received malformed \"report_load\" message\n");
         return generate_response(ctx, COORD_MALFORMED);
     }
 
-    if (m_spaces.find(std::string(_s.name)) != m_spaces.end())
+    if (!get_server(sid))
     {
-        rsm_log(ctx, "could not add space \"%s\" because there is already a space with that name\n", _s.name);
-        return generate_response(ctx, COORD_DUPLICATE);
+        return generate_response(ctx, COORD_NOT_FOUND);
     }
 
-    // Assign unique ids throughout the space
-    e::compat::shared_ptr<space> s(new space(_s));
-    s->id = space_id(m_counter);
-    ++m_counter;
-
-    for (size_t i = 0; i < s->subspaces.size(); ++i)
+    for (size_t i = 0; i < m_loads.size(); )
     {
-        s->subspaces[i].id = subspace_id(m_counter);
+        if (m_loads[i].sid == sid)
+        {
+            std::swap(m_loads[i], m_loads.back());
+            m_loads.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    for (size_t i = 0; i < rids.size(); ++i)
+    {
+        region* reg = get_region(rids[i]);
+        bool replica = false;
+
+        for (size_t j = 0; reg && j < reg->replicas.size(); ++j)
+        {
+            replica = replica || reg->replicas[j].si == sid;
+        }
+
+        // drop reports that raced with the region moving away
+        if (replica)
+        {
+            m_loads.push_back(region_load(rids[i], sid, bytes[i], ops[i]));
+        }
+    }
+
+    // one move at a time, and only once the layout has settled, so that
+    // the loads balance_load sees reflect where the regions actually are
+    if (m_intents.empty() && m_transfers.empty() &&
+        (split_large_region(ctx) || balance_load(ctx)))
+    {
+        generate_next_configuration(ctx);
+    }
+
+    return generate_response(ctx, COORD_SUCCESS);
+}
+
+void
+coordinator :: regions_lost(rsm_context* ctx,
+                            const server_id& sid,
+                            const std::vector<region_id>& rids)
+{
+    if (!get_server(sid))
+    {
+        rsm_log(ctx, "cannot take server(%" PRIu64 ") out of the regions it lost "
+                     "because the server doesn't exist\n", sid.get());
+        return generate_response(ctx, hyperdex::COORD_NOT_FOUND);
+    }
+
+    bool changed = false;
+
+    for (size_t i = 0; i < rids.size(); ++i)
+    {
+        region* reg = get_region(rids[i]);
+
+        // it must not come back as the region's last copy after a shutdown
+        for (size_t j = 0; j < m_offline.size(); )
+        {
+            if (m_offline[j].id == rids[i] && m_offline[j].sid == sid)
+            {
+                shift_and_pop(j, &m_offline);
+            }
+            else
+            {
+                ++j;
+            }
+        }
+
+        if (!reg)
+        {
+            continue;
+        }
+
+        for (size_t j = 0; j < reg->replicas.size(); ++j)
+        {
+            if (reg->replicas[j].si != sid)
+            {
+                continue;
+            }
+
+            if (reg->replicas.size() == 1)
+            {
+                rsm_log(ctx, "server(%" PRIu64 ") lost the contents of region(%" PRIu64 ") "
+                             "and no other server has them\n",
+                             sid.get(), reg->id.get());
+                break;
+            }
+
+            transfer* xfer = get_transfer(reg->id);
+
+            if (xfer && (xfer->src == sid || xfer->dst == sid))
+            {
+                del_transfer(xfer->id);
+            }
+
+            rsm_log(ctx, "removing server(%" PRIu64 ") from region(%" PRIu64 ") "
+                         "because it lost the region's contents when it restarted\n",
+                         sid.get(), reg->id.get());
+            shift_and_pop(j, &reg->replicas);
+            changed = true;
+            break;
+        }
+    }
+
+    if (changed)
+    {
+        rebalance_replica_sets(ctx);
+        generate_next_configuration(ctx);
+    }
+
+    return generate_response(ctx, COORD_SUCCESS);
+}
+
+static bool
+is_space_name(const char* str)
+{
+    size_t i = 0;
+
+    for (i = 0; str[i]; ++i)
+    {
+        if (!(i > 0 && isdigit(str[i])) &&
+            !(isalpha(str[i])) &&
+            str[i] != '_')
+        {
+            return false;
+        }
+    }
+
+    return i > 0;
+}
+
+void
+coordinator :: space_add(rsm_context* ctx, const space& _s)
+{
+
+    if (!_s.validate())
+    {
+        rsm_log(ctx, "could not add space \"%s\" because the space does not validate\n", _s.name);
+        return generate_response(ctx, COORD_MALFORMED);
+    }
+
+    if (m_spaces.find(std::string(_s.name)) != m_spaces.end())
+    {
+        rsm_log(ctx, "could not add space \"%s\" because there is already a space with that name\n", _s.name);
+        return generate_response(ctx, COORD_DUPLICATE);
+    }
+
+    // Assign unique ids throughout the space
+    e::compat::shared_ptr<space> s(new space(_s));
+    s->id = space_id(m_counter);
+    ++m_counter;
+
+    for (size_t i = 0; i < s->subspaces.size(); ++i)
+    {
+        s->subspaces[i].id = subspace_id(m_counter);
         ++m_counter;
 
         for (size_t j = 0; j < s->subspaces[i].regions.size(); ++j)
@@ -658,6 +1298,32 @@ coordinator :: space_rm(rsm_context* ctx, const char* name)
             }
         }
 
+        for (size_t i = 0; i < m_loads.size(); )
+        {
+            if (std::binary_search(rids.begin(), rids.end(), m_loads[i].id))
+            {
+                std::swap(m_loads[i], m_loads.back());
+                m_loads.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        for (size_t i = 0; i < m_placements.size(); )
+        {
+            if (std::binary_search(rids.begin(), rids.end(), m_placements[i].id))
+            {
+                std::swap(m_placements[i], m_placements.back());
+                m_placements.pop_back();
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
         remove(sid, &m_deferred_init);
         generate_next_configuration(ctx);
         return generate_response(ctx, COORD_SUCCESS);
@@ -700,6 +1366,65 @@ coordinator :: space_mv(rsm_context* ctx, const char* src, const char* dst)
     }
 }
 
+void
+coordinator :: space_immutable(rsm_context* ctx, const char* name, bool immutable)
+{
+    space_map_t::iterator it;
+    it = m_spaces.find(std::string(name));
+
+    if (it == m_spaces.end())
+    {
+        rsm_log(ctx, "could not change the mutability of space \"%s\" because it doesn't exist\n", name);
+        return generate_response(ctx, COORD_NOT_FOUND);
+    }
+
+    hyperdex::space* sp = it->second.get();
+
+    if (sp->sc.immutable == immutable)
+    {
+        rsm_log(ctx, "space \"%s\" is already %s\n", name, immutable ? "immutable" : "mutable");
+        return generate_response(ctx, COORD_SUCCESS);
+    }
+
+    rsm_log(ctx, "making space \"%s\" (%" PRIu64 ") %s\n", name, sp->id.get(), immutable ? "immutable" : "mutable");
+    sp->sc.immutable = immutable;
+    generate_next_configuration(ctx);
+    return generate_response(ctx, COORD_SUCCESS);
+}
+
+void
+coordinator :: space_quota(rsm_context* ctx, const char* name,
+                           uint64_t ops, uint64_t bytes, uint64_t client_ops)
+{
+    space_map_t::iterator it;
+    it = m_spaces.find(std::string(name));
+
+    if (it == m_spaces.end())
+    {
+        rsm_log(ctx, "could not set the quota of space \"%s\" because it doesn't exist\n", name);
+        return generate_response(ctx, COORD_NOT_FOUND);
+    }
+
+    hyperdex::space* sp = it->second.get();
+
+    if (sp->sc.quota_ops == ops &&
+        sp->sc.quota_bytes == bytes &&
+        sp->sc.quota_client_ops == client_ops)
+    {
+        rsm_log(ctx, "space \"%s\" already has the requested quota\n", name);
+        return generate_response(ctx, COORD_SUCCESS);
+    }
+
+    rsm_log(ctx, "limiting space \"%s\" (%" PRIu64 ") to %" PRIu64 " ops/s, %" PRIu64
+                 " bytes/s and %" PRIu64 " ops/s per client on each server (0 is no limit)\n",
+                 name, sp->id.get(), ops, bytes, client_ops);
+    sp->sc.quota_ops = ops;
+    sp->sc.quota_bytes = bytes;
+    sp->sc.quota_client_ops = client_ops;
+    generate_next_configuration(ctx);
+    return generate_response(ctx, COORD_SUCCESS);
+}
+
 void
 coordinator :: index_add(rsm_context* ctx,
                          const char* space, const char* what)
@@ -715,23 +1440,87 @@ coordinator :: index_add(rsm_context* ctx,
 
     hyperdex::space* sp = it->second.get();
 
-    // split the attr into "attr" and "dotpath" components
-    const size_t what_sz = strlen(what);
+    // peel off the filter of a partial index, then the attributes a
+    // covering index stores with its entries, and then the type of a
+    // document index
+    std::string spec(what);
+    std::string where;
+    size_t where_pos = spec.find(PARTIAL_INDEX_WHERE);
+
+    if (where_pos != std::string::npos)
+    {
+        where = spec.substr(where_pos + strlen(PARTIAL_INDEX_WHERE));
+        spec.resize(where_pos);
+    }
+
+    std::string include;
+    size_t include_pos = spec.find(COVERING_INDEX_INCLUDE);
+
+    if (include_pos != std::string::npos)
+    {
+        include = spec.substr(include_pos + strlen(COVERING_INDEX_INCLUDE));
+        spec.resize(include_pos);
+    }
+
+    // a document index may declare the type of the values it takes
+    std::string as;
+    size_t as_pos = spec.find(DOCUMENT_INDEX_AS);
+
+    if (as_pos != std::string::npos)
+    {
+        as = spec.substr(as_pos + strlen(DOCUMENT_INDEX_AS));
+        spec.resize(as_pos);
+    }
+
+    // split the attr into "attr" and "dotpath" components; a "trigram:"
+    // prefix asks for a trigram index over a string attribute instead, a
+    // "hashed:" prefix for an equality-only index over its hash, and a
+    // "spatial:" prefix for a Z-order index over a list of numeric attributes
+    const char* name = spec.c_str();
+    const size_t name_sz = spec.size();
     std::string attr;
     std::string dotpath;
     index::index_t type;
-    const char* ptr = strchr(what, '.');
+    const char* ptr = strchr(name, '.');
 
-    if (ptr)
+    if (strncmp(name, TRIGRAM_INDEX_PREFIX, strlen(TRIGRAM_INDEX_PREFIX)) == 0)
+    {
+        type = index::TRIGRAM;
+        attr.assign(name + strlen(TRIGRAM_INDEX_PREFIX),
+                    name_sz - strlen(TRIGRAM_INDEX_PREFIX));
+        dotpath.assign("", 0);
+    }
+    else if (strncmp(name, HASHED_INDEX_PREFIX, strlen(HASHED_INDEX_PREFIX)) == 0)
+    {
+        type = index::HASHED;
+        attr.assign(name + strlen(HASHED_INDEX_PREFIX),
+                    name_sz - strlen(HASHED_INDEX_PREFIX));
+        dotpath.assign("", 0);
+    }
+    else if (strncmp(name, SPATIAL_INDEX_PREFIX, strlen(SPATIAL_INDEX_PREFIX)) == 0)
+    {
+        type = index::SPATIAL;
+        spec = spec.substr(strlen(SPATIAL_INDEX_PREFIX));
+        name = spec.c_str();
+        attr.assign(name, strcspn(name, ","));
+        dotpath.assign("", 0);
+    }
+    else if (strchr(name, ','))
+    {
+        type = index::COMPOSITE;
+        attr.assign(name, strchr(name, ',') - name);
+        dotpath.assign("", 0);
+    }
+    else if (ptr)
     {
         type = index::DOCUMENT;
-        attr.assign(what, ptr - what);
-        dotpath.assign(ptr + 1, what_sz - (ptr - what) - 1);
+        attr.assign(name, ptr - name);
+        dotpath.assign(ptr + 1, name_sz - (ptr - name) - 1);
     }
     else
     {
         type = index::NORMAL;
-        attr.assign(what, what_sz);
+        attr.assign(name, name_sz);
         dotpath.assign("", 0);
     }
 
@@ -759,11 +1548,115 @@ coordinator :: index_add(rsm_context* ctx,
         return generate_response(ctx, COORD_NO_CAN_DO);
     }
 
+    if (type == index::TRIGRAM &&
+        sp->sc.attrs[attr_num].type != HYPERDATATYPE_STRING)
+    {
+        rsm_log(ctx, "could not create index on \"%s\" on space \"%s\" because "
+                     "trigram indices are only supported on strings\n", what, space);
+        return generate_response(ctx, COORD_NO_CAN_DO);
+    }
+
+    if (type == index::HASHED &&
+        sp->sc.attrs[attr_num].type != HYPERDATATYPE_STRING)
+    {
+        rsm_log(ctx, "could not create index on \"%s\" on space \"%s\" because "
+                     "hashed indices are only supported on strings\n", what, space);
+        return generate_response(ctx, COORD_NO_CAN_DO);
+    }
+
+    if (!as.empty() &&
+        (type != index::DOCUMENT ||
+         (as != "string" && as != "number" && as != "document")))
+    {
+        rsm_log(ctx, "could not create index on \"%s\" on space \"%s\" because "
+                     "only document indices may declare a type, and it must be "
+                     "string, number, or document\n", what, space);
+        return generate_response(ctx, COORD_NO_CAN_DO);
+    }
+
+    // "doc.tags[*]" indexes each element of the array at "tags"
+    if (type == index::DOCUMENT &&
+        dotpath.find("[*]") != std::string::npos &&
+        (dotpath.find("[*]") + 3 != dotpath.size() || dotpath.size() == 3))
+    {
+        rsm_log(ctx, "could not create index on \"%s\" on space \"%s\" because "
+                     "\"[*]\" may only follow the path of a document index\n", what, space);
+        return generate_response(ctx, COORD_NO_CAN_DO);
+    }
+
+    if (!as.empty())
+    {
+        dotpath += ":" + as;
+    }
+
+    if (!include.empty() &&
+        (type != index::NORMAL ||
+         !primitive_indexable(sp->sc.attrs[attr_num].type)))
+    {
+        rsm_log(ctx, "could not create index on \"%s\" on space \"%s\" because "
+                     "only indices on primitive attributes may include other attributes\n", what, space);
+        return generate_response(ctx, COORD_NO_CAN_DO);
+    }
+
+    // NORMAL, COMPOSITE and SPATIAL indices keep their attribute lists in
+    // "extra"
+    const bool multi = type == index::COMPOSITE || type == index::SPATIAL;
+    std::vector<uint16_t> attrs;
+    std::string bad;
+
+    if (!lookup_attrs(sp->sc, multi ? spec : include, &attrs, &bad))
+    {
+        rsm_log(ctx, "could not create index on \"%s\" on space \"%s\" because "
+                     "attribute \"%s\" doesn't exist\n", what, space, bad.c_str());
+        return generate_response(ctx, COORD_NOT_FOUND);
+    }
+
+    for (size_t i = 0; i < attrs.size(); ++i)
+    {
+        if (attrs[i] == 0 ||
+            std::find(attrs.begin(), attrs.begin() + i, attrs[i]) != attrs.begin() + i ||
+            (type == index::COMPOSITE && !primitive_indexable(sp->sc.attrs[attrs[i]].type)) ||
+            (type == index::SPATIAL && !spatial_indexable(sp->sc.attrs[attrs[i]].type)))
+        {
+            rsm_log(ctx, "could not create index on \"%s\" on space \"%s\" because "
+                         "attribute \"%s\" cannot be %s\n", what, space,
+                         sp->sc.attrs[attrs[i]].name,
+                         type == index::COMPOSITE ? "part of a composite index" :
+                         type == index::SPATIAL ? "a dimension of a spatial index" : "included");
+            return generate_response(ctx, COORD_NO_CAN_DO);
+        }
+    }
+
+    if (type == index::SPATIAL &&
+        (attrs.size() < 2 || attrs.size() > ZORDER_MAX_DIMENSIONS))
+    {
+        rsm_log(ctx, "could not create index on \"%s\" on space \"%s\" because "
+                     "a spatial index spans two to %d attributes\n", what, space,
+                     ZORDER_MAX_DIMENSIONS);
+        return generate_response(ctx, COORD_NO_CAN_DO);
+    }
+
+    if (!attrs.empty())
+    {
+        dotpath = pack_attrs(attrs);
+    }
+
+    std::string filter;
+
+    if (!where.empty() && !parse_filter(sp->sc, where, &filter, &bad))
+    {
+        rsm_log(ctx, "could not create index on \"%s\" on space \"%s\" because "
+                     "condition \"%s\" is not of the form \"attr op value\" over a "
+                     "string, number, or timestamp\n", what, space, bad.c_str());
+        return generate_response(ctx, COORD_NO_CAN_DO);
+    }
+
     for (size_t i = 0; i < sp->indices.size(); ++i)
     {
         if (sp->indices[i].type == type &&
             sp->indices[i].attr == attr_num &&
-            sp->indices[i].extra == e::slice(dotpath))
+            sp->indices[i].extra == e::slice(dotpath) &&
+            sp->indices[i].filter == e::slice(filter))
         {
             rsm_log(ctx, "did not create index on \"%s\" on space \"%s\" because it is already indexed\n", what, space);
             return generate_response(ctx, COORD_DUPLICATE);
@@ -773,7 +1666,7 @@ coordinator :: index_add(rsm_context* ctx,
     rsm_log(ctx, "creating index on \"%s\" on space \"%s\"\n", what, space);
     index_id id(m_counter);
     ++m_counter;
-    sp->indices.push_back(index(type, id, attr_num, e::slice(dotpath)));
+    sp->indices.push_back(index(type, id, attr_num, e::slice(dotpath), e::slice(filter)));
     sp->reestablish_backing();
     generate_next_configuration(ctx);
     return generate_response(ctx, COORD_SUCCESS);
@@ -822,77 +1715,58 @@ coordinator :: index_rm(rsm_context* ctx, index_id ii)
 }
 
 void
-coordinator :: transfer_go_live(rsm_context* ctx,
-                                const transfer_id& xid)
+coordinator :: region_split(rsm_context* ctx, const region_id& rid)
 {
-    transfer* xfer = get_transfer(xid);
-
-    if (!xfer)
+    if (!get_region(rid))
     {
-        return;
+        rsm_log(ctx, "could not split region(%" PRIu64 ") because it doesn't exist\n", rid.get());
+        return generate_response(ctx, COORD_NOT_FOUND);
     }
 
-    region* reg = get_region(xfer->rid);
-
-    if (!reg)
+    if (!split_region(ctx, rid))
     {
-        rsm_log(ctx, "cannot make transfer(%" PRIu64 ") live because it doesn't exist\n", xid.get());
-        INVARIANT_BROKEN("transfer refers to nonexistent region");
-        return generate_response(ctx, COORD_SUCCESS);
+        return generate_response(ctx, COORD_NO_CAN_DO);
     }
 
-    // If the transfer is already live
-    if (reg->replicas.size() > 1 &&
-        reg->replicas[reg->replicas.size() - 2].si == xfer->src &&
-        reg->replicas[reg->replicas.size() - 1].si == xfer->dst)
+    generate_next_configuration(ctx);
+    return generate_response(ctx, COORD_SUCCESS);
+}
+
+void
+coordinator :: transfer_go_live(rsm_context* ctx,
+                                const std::vector<transfer_id>& xids)
+{
+    bool changed = false;
+
+    for (size_t i = 0; i < xids.size(); ++i)
     {
-        return generate_response(ctx, COORD_SUCCESS);
+        changed = make_transfer_live(ctx, xids[i]) || changed;
     }
 
-    if (reg->replicas.empty() || reg->replicas.back().si != xfer->src)
+    if (changed)
     {
-        INVARIANT_BROKEN("transfer in a bad state");
-        return generate_response(ctx, COORD_SUCCESS);
+        generate_next_configuration(ctx);
     }
 
-    reg->replicas.push_back(replica(xfer->dst, xfer->vdst));
-    rsm_log(ctx, "transfer(%" PRIu64 ") is live\n", xid.get());
-    generate_next_configuration(ctx);
     return generate_response(ctx, COORD_SUCCESS);
 }
 
 void
 coordinator :: transfer_complete(rsm_context* ctx,
-                                 const transfer_id& xid)
+                                 const std::vector<transfer_id>& xids)
 {
-    transfer* xfer = get_transfer(xid);
+    bool changed = false;
 
-    if (!xfer)
+    for (size_t i = 0; i < xids.size(); ++i)
     {
-        return;
+        changed = finish_transfer(ctx, xids[i]) || changed;
     }
 
-    region* reg = get_region(xfer->rid);
-
-    if (!reg)
-    {
-        rsm_log(ctx, "cannot complete transfer(%" PRIu64 ") because it doesn't exist\n", xid.get());
-        INVARIANT_BROKEN("transfer refers to nonexistent region");
-        return generate_response(ctx, COORD_SUCCESS);
-    }
-
-    if (!(reg->replicas.size() > 1 &&
-          reg->replicas[reg->replicas.size() - 2].si == xfer->src &&
-          reg->replicas[reg->replicas.size() - 1].si == xfer->dst))
+    if (changed)
     {
-        rsm_log(ctx, "cannot complete transfer(%" PRIu64 ") because it is not live\n", xid.get());
-        return generate_response(ctx, COORD_SUCCESS);
+        generate_next_configuration(ctx);
     }
 
-    del_transfer(xfer->id);
-    rsm_log(ctx, "transfer(%" PRIu64 ") is complete\n", xid.get());
-    converge_intent(ctx, reg);
-    generate_next_configuration(ctx);
     return generate_response(ctx, COORD_SUCCESS);
 }
 
@@ -981,6 +1855,13 @@ coordinator :: debug_dump(rsm_context* ctx)
         rsm_log(ctx, " - %" PRIu64 "\n", m_permutation[i].get());
     }
 
+    rsm_log(ctx, "zones:\n");
+
+    for (size_t i = 0; i < m_zones.size(); ++i)
+    {
+        rsm_log(ctx, " - %" PRIu64 " %s\n", m_zones[i].sid.get(), m_zones[i].label.c_str());
+    }
+
     rsm_log(ctx, "spares (desire %" PRIu64 "):\n", m_desired_spares);
 
     for (size_t i = 0; i < m_spares.size(); ++i)
@@ -1019,6 +1900,27 @@ coordinator :: debug_dump(rsm_context* ctx)
                 m_transfers[i].dst.get(), m_transfers[i].vdst.get());
     }
 
+    rsm_log(ctx, "placements:\n");
+
+    for (size_t i = 0; i < m_placements.size(); ++i)
+    {
+        rsm_log(ctx, " - region=%" PRIu64 " replicas=[", m_placements[i].id.get());
+
+        for (size_t j = 0; j < m_placements[i].replicas.size(); ++j)
+        {
+            if (j == 0)
+            {
+                rsm_log(ctx, "%" PRIu64 "", m_placements[i].replicas[j].get());
+            }
+            else
+            {
+                rsm_log(ctx, ", %" PRIu64 "", m_placements[i].replicas[j].get());
+            }
+        }
+
+        rsm_log(ctx, "]\n");
+    }
+
     rsm_log(ctx, "offline servers:\n");
 
     for (size_t i = 0; i < m_offline.size(); ++i)
@@ -1046,21 +1948,98 @@ coordinator :: recreate(rsm_context* ctx,
         return NULL;
     }
 
+    uint64_t magic = 0;
+
+    if (data_sz >= sizeof(uint64_t))
+    {
+        e::unpack64be(data, &magic);
+    }
+
+    const bool versioned = magic == SNAPSHOT_MAGIC;
     e::unpacker up(data, data_sz);
-    up = up >> c->m_cluster >> c->m_counter >> c->m_version >> c->m_flags >> c->m_servers
+
+    uint8_t version = 0;
+
+    if (versioned)
+    {
+        up = up >> magic >> version;
+
+        if (!up.error() && (version < 2 || version > SNAPSHOT_VERSION))
+        {
+            rsm_log(ctx, "cannot restore a version %u snapshot\n", unsigned(version));
+            return NULL;
+        }
+    }
+
+    up = up >> c->m_cluster >> c->m_counter >> c->m_version >> c->m_flags
+            >> c->m_transfer_rate >> c->m_servers
             >> c->m_permutation >> c->m_spares >> c->m_desired_spares >> c->m_intents
             >> c->m_deferred_init >> c->m_offline >> c->m_transfers
+            >> c->m_loads >> c->m_placements
             >> c->m_config_ack_through >> c->m_config_ack_barrier
             >> c->m_config_stable_through >> c->m_config_stable_barrier
             >> c->m_checkpoint >> c->m_checkpoint_stable_through
             >> c->m_checkpoint_gc_through >> c->m_checkpoint_stable_barrier;
 
-    while (!up.error() && up.remain())
+    if (versioned)
+    {
+        uint32_t num_spaces = 0;
+        up = up >> num_spaces;
+
+        for (uint32_t i = 0; !up.error() && i < num_spaces; ++i)
+        {
+            e::slice name;
+            space_ptr ptr(new space());
+            up = up >> name >> *ptr;
+            c->m_spaces[std::string(name.cdata(), name.size())] = ptr;
+        }
+
+        e::slice compact;
+        up = up >> compact;
+        std::vector<uint64_t> sids;
+
+        for (size_t i = 0; i < c->m_servers.size(); ++i)
+        {
+            sids.push_back(c->m_servers[i].id.get());
+        }
+
+        const char* ptr = compact.cdata();
+        const char* end = ptr + compact.size();
+
+        for (space_map_t::iterator it = c->m_spaces.begin();
+                !up.error() && it != c->m_spaces.end(); ++it)
+        {
+            space* s(it->second.get());
+
+            for (size_t ss_idx = 0; ss_idx < s->subspaces.size(); ++ss_idx)
+            {
+                if (!unpack_compact_regions(sids, &ptr, end, &s->subspaces[ss_idx].regions))
+                {
+                    rsm_log(ctx, "unpacking regions failed\n");
+                    return NULL;
+                }
+            }
+        }
+
+        if (version >= 3)
+        {
+            up = up >> c->m_zones;
+        }
+
+        if (version >= 4)
+        {
+            up = up >> c->m_epochs;
+        }
+    }
+    else
     {
-        e::slice name;
-        space_ptr ptr(new space());
-        up = up >> name >> *ptr;
-        c->m_spaces[std::string(reinterpret_cast<const char*>(name.data()), name.size())] = ptr;
+        while (!up.error() && up.remain())
+        {
+            e::slice name;
+            space_ptr ptr(new space());
+            up = up >> name >> *ptr;
+            c->m_spaces[std::string(reinterpret_cast<const char*>(name.data()), name.size())] = ptr;
+        }
     }
 
     if (up.error())
@@ -1094,29 +2073,30 @@ coordinator :: recreate(rsm_context* ctx,
     }
 
     std::sort(region_tails.begin(), region_tails.end());
+    size_t kept = 0;
 
-    for (size_t i = 0; i < c->m_transfers.size(); )
+    // drop, in one pass, the transfers whose source and destination are no
+    // longer the tail of any region
+    for (size_t i = 0; i < c->m_transfers.size(); ++i)
     {
         const transfer* t = &c->m_transfers[i];
         std::pair<server_id, virtual_server_id> src(std::make_pair(t->src, t->vsrc));
         std::pair<server_id, virtual_server_id> dst(std::make_pair(t->dst, t->vdst));
 
-        if (!std::binary_search(region_tails.begin(), region_tails.end(), src) &&
-            !std::binary_search(region_tails.begin(), region_tails.end(), dst))
+        if (std::binary_search(region_tails.begin(), region_tails.end(), src) ||
+            std::binary_search(region_tails.begin(), region_tails.end(), dst))
         {
-            for (size_t j = i + 1; j < c->m_transfers.size(); ++j)
+            if (kept != i)
             {
-                c->m_transfers[j - 1] = c->m_transfers[j];
+                c->m_transfers[kept] = c->m_transfers[i];
             }
 
-            c->m_transfers.pop_back();
-        }
-        else
-        {
-            ++i;
+            ++kept;
         }
     }
 
+    c->m_transfers.resize(kept);
+
     c->generate_cached_configuration(ctx);
     return c.release();
 }
@@ -1125,10 +2105,39 @@ int
 coordinator :: snapshot(rsm_context* /*ctx*/,
                         char** data, size_t* data_sz)
 {
-    size_t sz = sizeof(m_cluster)
+    // the regions are written apart from their spaces, in the compact form
+    // pack_compact_regions describes; the spaces are packed while their
+    // subspaces hold none, and then given back what they had
+    std::vector<uint64_t> sids;
+
+    for (size_t i = 0; i < m_servers.size(); ++i)
+    {
+        sids.push_back(m_servers[i].id.get());
+    }
+
+    std::string compact;
+    std::vector<std::vector<region> > held;
+
+    for (space_map_t::iterator it = m_spaces.begin();
+            it != m_spaces.end(); ++it)
+    {
+        space* s(it->second.get());
+
+        for (size_t ss_idx = 0; ss_idx < s->subspaces.size(); ++ss_idx)
+        {
+            pack_compact_regions(sids, s->subspaces[ss_idx].regions, &compact);
+            held.push_back(std::vector<region>());
+            held.back().swap(s->subspaces[ss_idx].regions);
+        }
+    }
+
+    size_t sz = sizeof(uint64_t)
+              + sizeof(uint8_t)
+              + sizeof(m_cluster)
               + sizeof(m_counter)
               + sizeof(m_version)
               + sizeof(m_flags)
+              + sizeof(m_transfer_rate)
               + pack_size(m_servers)
               + pack_size(m_permutation)
               + pack_size(m_spares)
@@ -1137,6 +2146,8 @@ coordinator :: snapshot(rsm_context* /*ctx*/,
               + pack_size(m_deferred_init)
               + pack_size(m_offline)
               + pack_size(m_transfers)
+              + pack_size(m_loads)
+              + pack_size(m_placements)
               + sizeof(m_config_ack_through)
               + pack_size(m_config_ack_barrier)
               + sizeof(m_config_stable_through)
@@ -1144,7 +2155,11 @@ coordinator :: snapshot(rsm_context* /*ctx*/,
               + sizeof(m_checkpoint)
               + sizeof(m_checkpoint_stable_through)
               + sizeof(m_checkpoint_gc_through)
-              + pack_size(m_checkpoint_stable_barrier);
+              + pack_size(m_checkpoint_stable_barrier)
+              + sizeof(uint32_t)
+              + pack_size(e::slice(compact))
+              + pack_size(m_zones)
+              + pack_size(m_epochs);
 
     for (space_map_t::iterator it = m_spaces.begin();
             it != m_spaces.end(); ++it)
@@ -1155,13 +2170,17 @@ coordinator :: snapshot(rsm_context* /*ctx*/,
 
     std::auto_ptr<e::buffer> buf(e::buffer::create(sz));
     e::packer pa = buf->pack_at(0);
-    pa = pa << m_cluster << m_counter << m_version << m_flags << m_servers
+    pa = pa << uint64_t(SNAPSHOT_MAGIC) << uint8_t(SNAPSHOT_VERSION)
+            << m_cluster << m_counter << m_version << m_flags
+            << m_transfer_rate << m_servers
             << m_permutation << m_spares << m_desired_spares << m_intents
             << m_deferred_init << m_offline << m_transfers
+            << m_loads << m_placements
             << m_config_ack_through << m_config_ack_barrier
             << m_config_stable_through << m_config_stable_barrier
             << m_checkpoint << m_checkpoint_stable_through
-            << m_checkpoint_gc_through << m_checkpoint_stable_barrier;
+            << m_checkpoint_gc_through << m_checkpoint_stable_barrier
+            << static_cast<uint32_t>(m_spaces.size());
 
     for (space_map_t::iterator it = m_spaces.begin();
             it != m_spaces.end(); ++it)
@@ -1170,6 +2189,21 @@ coordinator :: snapshot(rsm_context* /*ctx*/,
         pa = pa << name << (*it->second);
     }
 
+    pa = pa << e::slice(compact) << m_zones << m_epochs;
+    size_t held_idx = 0;
+
+    for (space_map_t::iterator it = m_spaces.begin();
+            it != m_spaces.end(); ++it)
+    {
+        space* s(it->second.get());
+
+        for (size_t ss_idx = 0; ss_idx < s->subspaces.size(); ++ss_idx)
+        {
+            held[held_idx].swap(s->subspaces[ss_idx].regions);
+            ++held_idx;
+        }
+    }
+
     char* ptr = static_cast<char*>(malloc(buf->size()));
     *data = ptr;
     *data_sz = buf->size();
@@ -1291,175 +2325,643 @@ compare_space_ptr_by_r_p(const e::compat::shared_ptr<hyperdex::space>& lhs,
     {
         return lhs->predecessor_width < rhs->predecessor_width;
     }
-    else
+    else
+    {
+        return false;
+    }
+}
+
+bool
+is_replica_set(const std::vector<hyperdex::server_id>& replicas,
+               const std::vector<hyperdex::replica_set>& replica_sets)
+{
+    for (size_t i = 0; i < replica_sets.size(); ++i)
+    {
+        bool same = replica_sets[i].size() == replicas.size();
+
+        for (size_t j = 0; same && j < replicas.size(); ++j)
+        {
+            same = replica_sets[i][j] == replicas[j];
+        }
+
+        if (same)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace
+
+void
+coordinator :: rebalance_replica_sets(rsm_context* ctx)
+{
+    uint64_t R = 0;
+    uint64_t P = 0;
+    std::vector<server_id> replica_storage;
+    std::vector<replica_set> replica_sets;
+    std::vector<space_ptr> spaces;
+    spaces.reserve(m_spaces.size());
+
+    for (space_map_t::iterator it = m_spaces.begin();
+            it != m_spaces.end(); ++it)
+    {
+        spaces.push_back(it->second);
+    }
+
+    std::sort(spaces.begin(), spaces.end(), compare_space_ptr_by_r_p);
+
+    for (size_t i = 0; i < spaces.size(); ++i)
+    {
+        if (std::find(m_deferred_init.begin(),
+                      m_deferred_init.end(),
+                      spaces[i]->id) != m_deferred_init.end())
+        {
+            remove(spaces[i]->id, &m_deferred_init);
+            initial_space_layout(ctx, spaces[i].get());
+            continue;
+        }
+
+        if (spaces[i]->fault_tolerance + 1 != R ||
+            spaces[i]->predecessor_width != P)
+        {
+            R = spaces[i]->fault_tolerance + 1;
+            P = spaces[i]->predecessor_width;
+            compute_replica_sets(R, P, m_permutation, m_servers, m_zones,
+                                 &replica_storage,
+                                 &replica_sets);
+            log_chain_latency(ctx, R, replica_sets);
+        }
+
+        setup_intents(ctx, replica_sets, spaces[i].get(), false);
+    }
+}
+
+void
+coordinator :: initial_space_layout(rsm_context* ctx,
+                                    space* s)
+{
+    if (m_permutation.empty())
+    {
+        m_deferred_init.push_back(s->id);
+        return;
+    }
+
+    uint64_t R = s->fault_tolerance + 1;
+    uint64_t P = s->predecessor_width;
+    std::vector<server_id> replica_storage;
+    std::vector<replica_set> replica_sets;
+    compute_replica_sets(R, P, m_permutation, m_servers, m_zones,
+                         &replica_storage,
+                         &replica_sets);
+    log_chain_latency(ctx, R, replica_sets);
+    setup_intents(ctx, replica_sets, s, true);
+}
+
+region*
+coordinator :: get_region(const region_id& rid)
+{
+    for (space_map_t::iterator it = m_spaces.begin();
+            it != m_spaces.end(); ++it)
+    {
+        space& s(*it->second);
+
+        for (size_t i = 0; i < s.subspaces.size(); ++i)
+        {
+            subspace& ss(s.subspaces[i]);
+
+            for (size_t j = 0; j < ss.regions.size(); ++j)
+            {
+                if (ss.regions[j].id == rid)
+                {
+                    return &ss.regions[j];
+                }
+            }
+        }
+    }
+
+    return NULL;
+}
+
+void
+coordinator :: setup_intents(rsm_context* ctx,
+                             const std::vector<replica_set>& replica_sets,
+                             space* s, bool skip_transfers)
+{
+    if (replica_sets.size() == 0)
+    {
+        return;
+    }
+
+    for (size_t ss_idx = 0; ss_idx < s->subspaces.size(); ++ss_idx)
+    {
+        subspace& ss(s->subspaces[ss_idx]);
+
+        for (size_t reg_idx = 0; reg_idx < ss.regions.size(); ++reg_idx)
+        {
+            region* reg = &ss.regions[reg_idx];
+            size_t idx = (reg_idx * replica_sets.size()) / ss.regions.size();
+            assert(idx < replica_sets.size());
+            std::vector<server_id> target;
+            region_intent* placed = get_placement(reg->id);
+
+            // stay where balance_load put the region for as long as that
+            // is still one of the replica sets
+            if (placed && !skip_transfers &&
+                is_replica_set(placed->replicas, replica_sets))
+            {
+                target = placed->replicas;
+            }
+            else
+            {
+                remove_id(reg->id, &m_placements);
+
+                for (size_t i = 0; i < replica_sets[idx].size(); ++i)
+                {
+                    target.push_back(replica_sets[idx][i]);
+                }
+            }
+
+            bool need_change = target.size() != reg->replicas.size();
+
+            for (size_t i = 0; !need_change && i < target.size(); ++i)
+            {
+                need_change = target[i] != reg->replicas[i].si;
+            }
+
+            if (!need_change)
+            {
+                del_region_intent(reg->id);
+                transfer* xfer = get_transfer(reg->id);
+
+                // delete the transfer if we're OK with 0 replicas, or the
+                // transfer is adding a replica (that is, it's not gone-live
+                // yet).
+                if (xfer && (reg->replicas.empty() || xfer->dst != reg->replicas.back().si))
+                {
+                    del_transfer(xfer->id);
+                }
+
+                continue;
+            }
+
+            if (skip_transfers)
+            {
+                assert(reg->replicas.empty());
+
+                for (size_t i = 0; i < target.size(); ++i)
+                {
+                    reg->replicas.push_back(replica(target[i], virtual_server_id(m_counter)));
+                    ++m_counter;
+                }
+            }
+            else
+            {
+                region_intent* ri = get_region_intent(reg->id);
+
+                if (!ri)
+                {
+                    ri = new_region_intent(reg->id);
+                }
+
+                ri->replicas = target;
+                ri->checkpoint = 0;
+
+                converge_intent(ctx, reg, ri);
+            }
+        }
+    }
+}
+
+bool
+coordinator :: balance_load(rsm_context* ctx)
+{
+    std::map<region_id, uint64_t> costs;
+    region_costs(&costs);
+    std::map<server_id, uint64_t> loads;
+
+    for (size_t i = 0; i < m_permutation.size(); ++i)
+    {
+        server* srv = get_server(m_permutation[i]);
+
+        if (srv && srv->state == server::AVAILABLE)
+        {
+            loads[srv->id] = 0;
+        }
+    }
+
+    if (loads.size() < 2 || costs.empty())
+    {
+        return false;
+    }
+
+    for (space_map_t::iterator it = m_spaces.begin();
+            it != m_spaces.end(); ++it)
+    {
+        space& s(*it->second);
+
+        for (size_t i = 0; i < s.subspaces.size(); ++i)
+        {
+            subspace& ss(s.subspaces[i]);
+
+            for (size_t j = 0; j < ss.regions.size(); ++j)
+            {
+                const region& reg(ss.regions[j]);
+                std::map<region_id, uint64_t>::iterator c = costs.find(reg.id);
+
+                for (size_t k = 0; c != costs.end() && k < reg.replicas.size(); ++k)
+                {
+                    std::map<server_id, uint64_t>::iterator l = loads.find(reg.replicas[k].si);
+
+                    if (l != loads.end())
+                    {
+                        l->second += c->second;
+                    }
+                }
+            }
+        }
+    }
+
+    uint64_t total = 0;
+    server_id hot;
+    uint64_t hot_load = 0;
+
+    for (std::map<server_id, uint64_t>::iterator it = loads.begin();
+            it != loads.end(); ++it)
+    {
+        total += it->second;
+
+        if (it->second > hot_load)
+        {
+            hot = it->first;
+            hot_load = it->second;
+        }
+    }
+
+    uint64_t coolest_load = hot_load;
+
+    for (std::map<server_id, uint64_t>::iterator it = loads.begin();
+            it != loads.end(); ++it)
+    {
+        if (it->first != hot)
+        {
+            coolest_load = std::min(coolest_load, it->second);
+        }
+    }
+
+    const uint64_t mean = total / loads.size();
+
+    if (mean == 0 || hot_load * 100 <= mean * (100 + LOAD_IMBALANCE_PERCENT))
+    {
+        return false;
+    }
+
+    // servers taking on the region must stay well short of the point at
+    // which they would be moved off again
+    const uint64_t ceiling = mean * (100 + LOAD_IMBALANCE_PERCENT / 2) / 100;
+    std::vector<space_ptr> spaces;
+
+    for (space_map_t::iterator it = m_spaces.begin();
+            it != m_spaces.end(); ++it)
+    {
+        spaces.push_back(it->second);
+    }
+
+    std::sort(spaces.begin(), spaces.end(), compare_space_ptr_by_r_p);
+    uint64_t R = 0;
+    uint64_t P = 0;
+    std::vector<server_id> replica_storage;
+    std::vector<replica_set> replica_sets;
+    region* best = NULL;
+    std::vector<server_id> best_target;
+    uint64_t best_distance = UINT64_MAX;
+    region_id heaviest;
+    uint64_t heaviest_cost = 0;
+
+    for (size_t i = 0; i < spaces.size(); ++i)
+    {
+        if (spaces[i]->fault_tolerance + 1 != R ||
+            spaces[i]->predecessor_width != P)
+        {
+            R = spaces[i]->fault_tolerance + 1;
+            P = spaces[i]->predecessor_width;
+            compute_replica_sets(R, P, m_permutation, m_servers, m_zones,
+                                 &replica_storage,
+                                 &replica_sets);
+        }
+
+        for (size_t j = 0; j < spaces[i]->subspaces.size(); ++j)
+        {
+            subspace& ss(spaces[i]->subspaces[j]);
+
+            for (size_t k = 0; k < ss.regions.size(); ++k)
+            {
+                region* reg = &ss.regions[k];
+                std::map<region_id, uint64_t>::iterator c = costs.find(reg->id);
+                bool on_hot = false;
+
+                for (size_t r = 0; r < reg->replicas.size(); ++r)
+                {
+                    on_hot = on_hot || reg->replicas[r].si == hot;
+                }
+
+                if (c == costs.end() || c->second == 0 ||
+                    !on_hot || reg->replicas.size() != R)
+                {
+                    continue;
+                }
+
+                if (c->second > heaviest_cost)
+                {
+                    heaviest = reg->id;
+                    heaviest_cost = c->second;
+                }
+
+                // aim to leave the hot server as close to the mean as can be
+                const uint64_t after = hot_load - c->second;
+                const uint64_t distance = after > mean ? after - mean : mean - after;
+
+                if (distance >= best_distance)
+                {
+                    continue;
+                }
+
+                for (size_t rs = 0; rs < replica_sets.size(); ++rs)
+                {
+                    bool feasible = replica_sets[rs].size() == R;
+
+                    for (size_t m = 0; feasible && m < replica_sets[rs].size(); ++m)
+                    {
+                        const server_id sid = replica_sets[rs][m];
+                        bool present = false;
+
+                        for (size_t r = 0; r < reg->replicas.size(); ++r)
+                        {
+                            present = present || reg->replicas[r].si == sid;
+                        }
+
+                        feasible = sid != hot &&
+                                   (present || loads[sid] + c->second <= ceiling);
+                    }
+
+                    if (feasible)
+                    {
+                        best = reg;
+                        best_target.clear();
+
+                        for (size_t m = 0; m < replica_sets[rs].size(); ++m)
+                        {
+                            best_target.push_back(replica_sets[rs][m]);
+                        }
+
+                        best_distance = distance;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    if (!best)
+    {
+        // a region too heavy for even the least loaded server can only be
+        // balanced piecemeal
+        if (heaviest != region_id() && coolest_load + heaviest_cost > ceiling)
+        {
+            rsm_log(ctx, "splitting region(%" PRIu64 ") on server(%" PRIu64 ") "
+                         "because no other server has room for its %" PRIu64 " load\n",
+                         heaviest.get(), hot.get(), heaviest_cost);
+            return split_region(ctx, heaviest);
+        }
+
+        return false;
+    }
+
+    rsm_log(ctx, "moving region(%" PRIu64 ") off server(%" PRIu64 ") "
+                 "which carries %" PRIu64 " load against a mean of %" PRIu64 "\n",
+                 best->id.get(), hot.get(), hot_load, mean);
+    region_intent* placed = get_placement(best->id);
+
+    if (!placed)
+    {
+        m_placements.push_back(region_intent(best->id));
+        placed = &m_placements.back();
+    }
+
+    placed->replicas = best_target;
+    region_intent* ri = get_region_intent(best->id);
+
+    if (!ri)
     {
-        return false;
+        ri = new_region_intent(best->id);
     }
-}
 
-} // namespace
+    ri->replicas = best_target;
+    ri->checkpoint = 0;
+    converge_intent(ctx, best, ri);
+    return true;
+}
 
 void
-coordinator :: rebalance_replica_sets(rsm_context* ctx)
+coordinator :: region_costs(std::map<region_id, uint64_t>* costs)
 {
-    uint64_t R = 0;
-    uint64_t P = 0;
-    std::vector<server_id> replica_storage;
-    std::vector<replica_set> replica_sets;
-    std::vector<space_ptr> spaces;
-    spaces.reserve(m_spaces.size());
+    // every replica stores the whole region, but the ops split among them,
+    // so a region weighs its largest size and its mean ops per replica
+    std::map<region_id, std::pair<uint64_t, uint64_t> > sums;
+    std::map<region_id, uint64_t> reports;
 
-    for (space_map_t::iterator it = m_spaces.begin();
-            it != m_spaces.end(); ++it)
+    for (size_t i = 0; i < m_loads.size(); ++i)
     {
-        spaces.push_back(it->second);
+        std::pair<uint64_t, uint64_t>& sum(sums[m_loads[i].id]);
+        sum.first = std::max(sum.first, m_loads[i].bytes);
+        sum.second += m_loads[i].ops;
+        ++reports[m_loads[i].id];
     }
 
-    std::sort(spaces.begin(), spaces.end(), compare_space_ptr_by_r_p);
+    uint64_t total_bytes = 0;
+    uint64_t total_ops = 0;
 
-    for (size_t i = 0; i < spaces.size(); ++i)
+    for (std::map<region_id, std::pair<uint64_t, uint64_t> >::iterator it = sums.begin();
+            it != sums.end(); ++it)
     {
-        if (std::find(m_deferred_init.begin(),
-                      m_deferred_init.end(),
-                      spaces[i]->id) != m_deferred_init.end())
-        {
-            remove(spaces[i]->id, &m_deferred_init);
-            initial_space_layout(ctx, spaces[i].get());
-            continue;
-        }
+        it->second.second /= reports[it->first];
+        total_bytes += it->second.first;
+        total_ops += it->second.second;
+    }
 
-        if (spaces[i]->fault_tolerance + 1 != R ||
-            spaces[i]->predecessor_width != P)
-        {
-            R = spaces[i]->fault_tolerance + 1;
-            P = spaces[i]->predecessor_width;
-            compute_replica_sets(R, P, m_permutation, m_servers,
-                                 &replica_storage,
-                                 &replica_sets);
-        }
+    costs->clear();
 
-        setup_intents(ctx, replica_sets, spaces[i].get(), false);
+    for (std::map<region_id, std::pair<uint64_t, uint64_t> >::iterator it = sums.begin();
+            it != sums.end(); ++it)
+    {
+        (*costs)[it->first] = it->second.first / (total_bytes / LOAD_SCALE + 1)
+                            + it->second.second / (total_ops / LOAD_SCALE + 1);
     }
 }
 
+region_intent*
+coordinator :: get_placement(const region_id& rid)
+{
+    region_intent* placed = NULL;
+    find_id(rid, m_placements, &placed);
+    return placed;
+}
+
 void
-coordinator :: initial_space_layout(rsm_context* ctx,
-                                    space* s)
+coordinator :: region_bytes(std::map<region_id, uint64_t>* bytes)
 {
-    if (m_permutation.empty())
+    bytes->clear();
+
+    for (size_t i = 0; i < m_loads.size(); ++i)
     {
-        m_deferred_init.push_back(s->id);
-        return;
+        uint64_t& b((*bytes)[m_loads[i].id]);
+        b = std::max(b, m_loads[i].bytes);
     }
-
-    uint64_t R = s->fault_tolerance + 1;
-    uint64_t P = s->predecessor_width;
-    std::vector<server_id> replica_storage;
-    std::vector<replica_set> replica_sets;
-    compute_replica_sets(R, P, m_permutation, m_servers,
-                         &replica_storage,
-                         &replica_sets);
-    setup_intents(ctx, replica_sets, s, true);
 }
 
-region*
-coordinator :: get_region(const region_id& rid)
+bool
+coordinator :: split_large_region(rsm_context* ctx)
 {
-    for (space_map_t::iterator it = m_spaces.begin();
-            it != m_spaces.end(); ++it)
-    {
-        space& s(*it->second);
+    std::map<region_id, uint64_t> bytes;
+    region_bytes(&bytes);
 
-        for (size_t i = 0; i < s.subspaces.size(); ++i)
+    for (std::map<region_id, uint64_t>::iterator it = bytes.begin();
+            it != bytes.end(); ++it)
+    {
+        if (it->second > REGION_SPLIT_BYTES)
         {
-            subspace& ss(s.subspaces[i]);
+            rsm_log(ctx, "splitting region(%" PRIu64 ") because it holds %" PRIu64 " bytes\n",
+                         it->first.get(), it->second);
 
-            for (size_t j = 0; j < ss.regions.size(); ++j)
+            if (split_region(ctx, it->first))
             {
-                if (ss.regions[j].id == rid)
-                {
-                    return &ss.regions[j];
-                }
+                return true;
             }
         }
     }
 
-    return NULL;
+    return false;
 }
 
-void
-coordinator :: setup_intents(rsm_context* ctx,
-                             const std::vector<replica_set>& replica_sets,
-                             space* s, bool skip_transfers)
+bool
+coordinator :: split_region(rsm_context* ctx, const region_id& rid)
 {
-    if (replica_sets.size() == 0)
+    // every replica divides its copy of the region's data between the two
+    // halves when it sees the split, so every replica must have a full copy
+    for (size_t i = 0; i < m_offline.size(); ++i)
     {
-        return;
+        if (m_offline[i].id == rid)
+        {
+            rsm_log(ctx, "could not split region(%" PRIu64 ") while server(%" PRIu64 ") "
+                         "is offline\n", rid.get(), m_offline[i].sid.get());
+            return false;
+        }
     }
 
-    for (size_t ss_idx = 0; ss_idx < s->subspaces.size(); ++ss_idx)
+    if (get_region_intent(rid) || get_transfer(rid))
     {
-        subspace& ss(s->subspaces[ss_idx]);
+        rsm_log(ctx, "could not split region(%" PRIu64 ") while it is being moved\n", rid.get());
+        return false;
+    }
 
-        for (size_t reg_idx = 0; reg_idx < ss.regions.size(); ++reg_idx)
-        {
-            region* reg = &ss.regions[reg_idx];
-            size_t idx = (reg_idx * replica_sets.size()) / ss.regions.size();
-            assert(idx < replica_sets.size());
-            bool need_change = replica_sets[idx].size() != reg->replicas.size();
+    subspace* ss = NULL;
+    size_t idx = 0;
 
-            for (size_t i = 0; !need_change && i < replica_sets[idx].size(); ++i)
-            {
-                need_change = replica_sets[idx][i] != reg->replicas[i].si;
-            }
+    for (space_map_t::iterator it = m_spaces.begin();
+            !ss && it != m_spaces.end(); ++it)
+    {
+        space& s(*it->second);
 
-            if (!need_change)
+        for (size_t i = 0; !ss && i < s.subspaces.size(); ++i)
+        {
+            for (size_t j = 0; !ss && j < s.subspaces[i].regions.size(); ++j)
             {
-                del_region_intent(reg->id);
-                transfer* xfer = get_transfer(reg->id);
-
-                // delete the transfer if we're OK with 0 replicas, or the
-                // transfer is adding a replica (that is, it's not gone-live
-                // yet).
-                if (xfer && (reg->replicas.empty() || xfer->dst != reg->replicas.back().si))
+                if (s.subspaces[i].regions[j].id == rid)
                 {
-                    del_transfer(xfer->id);
+                    ss = &s.subspaces[i];
+                    idx = j;
                 }
-
-                continue;
             }
+        }
+    }
 
-            if (skip_transfers)
-            {
-                assert(reg->replicas.empty());
+    if (!ss)
+    {
+        return false;
+    }
 
-                for (size_t i = 0; i < replica_sets[idx].size(); ++i)
-                {
-                    reg->replicas.push_back(replica(replica_sets[idx][i], virtual_server_id(m_counter)));
-                    ++m_counter;
-                }
-            }
-            else
-            {
-                region_intent* ri = get_region_intent(reg->id);
+    region* reg = &ss->regions[idx];
 
-                if (!ri)
-                {
-                    ri = new_region_intent(reg->id);
-                }
+    if (reg->replicas.empty())
+    {
+        rsm_log(ctx, "could not split region(%" PRIu64 ") because it has no replicas\n", rid.get());
+        return false;
+    }
 
-                ri->replicas.resize(replica_sets[idx].size());
-                ri->checkpoint = 0;
+    // cut across the widest dimension
+    size_t dim = 0;
 
-                for (size_t i = 0; i < replica_sets[idx].size(); ++i)
-                {
-                    ri->replicas[i] = replica_sets[idx][i];
-                }
+    for (size_t i = 1; i < reg->lower_coord.size(); ++i)
+    {
+        if (reg->upper_coord[i] - reg->lower_coord[i] >
+            reg->upper_coord[dim] - reg->lower_coord[dim])
+        {
+            dim = i;
+        }
+    }
 
-                converge_intent(ctx, reg, ri);
-            }
+    if (reg->lower_coord.empty() ||
+        reg->lower_coord[dim] == reg->upper_coord[dim])
+    {
+        rsm_log(ctx, "could not split region(%" PRIu64 ") because it covers a single point\n", rid.get());
+        return false;
+    }
+
+    const uint64_t mid = reg->lower_coord[dim]
+                       + (reg->upper_coord[dim] - reg->lower_coord[dim]) / 2;
+    region child(*reg);
+    child.id = region_id(m_counter);
+    ++m_counter;
+    child.lower_coord[dim] = mid + 1;
+    reg->upper_coord[dim] = mid;
+
+    for (size_t i = 0; i < child.replicas.size(); ++i)
+    {
+        child.replicas[i].vsi = virtual_server_id(m_counter);
+        ++m_counter;
+    }
+
+    // the new region stays wherever balance_load placed its parent
+    region_intent* placed = get_placement(rid);
+
+    if (placed)
+    {
+        region_intent copy(*placed);
+        copy.id = child.id;
+        m_placements.push_back(copy);
+    }
+
+    // the parent's load reports are for both halves; wait for fresh ones
+    for (size_t i = 0; i < m_loads.size(); )
+    {
+        if (m_loads[i].id == rid)
+        {
+            std::swap(m_loads[i], m_loads.back());
+            m_loads.pop_back();
+        }
+        else
+        {
+            ++i;
         }
     }
+
+    rsm_log(ctx, "split region(%" PRIu64 ") at %" PRIu64 " along attribute %" PRIu64
+                 " of its subspace; region(%" PRIu64 ") takes the upper half\n",
+                 rid.get(), mid, static_cast<uint64_t>(dim), child.id.get());
+    ss->regions.insert(ss->regions.begin() + idx + 1, child);
+    return true;
 }
 
 void
@@ -1825,6 +3327,77 @@ coordinator :: del_transfer(const transfer_id& xid)
     }
 }
 
+bool
+coordinator :: make_transfer_live(rsm_context* ctx, const transfer_id& xid)
+{
+    transfer* xfer = get_transfer(xid);
+
+    if (!xfer)
+    {
+        return false;
+    }
+
+    region* reg = get_region(xfer->rid);
+
+    if (!reg)
+    {
+        rsm_log(ctx, "cannot make transfer(%" PRIu64 ") live because it doesn't exist\n", xid.get());
+        INVARIANT_BROKEN("transfer refers to nonexistent region");
+        return false;
+    }
+
+    // If the transfer is already live
+    if (reg->replicas.size() > 1 &&
+        reg->replicas[reg->replicas.size() - 2].si == xfer->src &&
+        reg->replicas[reg->replicas.size() - 1].si == xfer->dst)
+    {
+        return false;
+    }
+
+    if (reg->replicas.empty() || reg->replicas.back().si != xfer->src)
+    {
+        INVARIANT_BROKEN("transfer in a bad state");
+        return false;
+    }
+
+    reg->replicas.push_back(replica(xfer->dst, xfer->vdst));
+    rsm_log(ctx, "transfer(%" PRIu64 ") is live\n", xid.get());
+    return true;
+}
+
+bool
+coordinator :: finish_transfer(rsm_context* ctx, const transfer_id& xid)
+{
+    transfer* xfer = get_transfer(xid);
+
+    if (!xfer)
+    {
+        return false;
+    }
+
+    region* reg = get_region(xfer->rid);
+
+    if (!reg)
+    {
+        rsm_log(ctx, "cannot complete transfer(%" PRIu64 ") because it doesn't exist\n", xid.get());
+        INVARIANT_BROKEN("transfer refers to nonexistent region");
+        return false;
+    }
+
+    if (!(reg->replicas.size() > 1 &&
+          reg->replicas[reg->replicas.size() - 2].si == xfer->src &&
+          reg->replicas[reg->replicas.size() - 1].si == xfer->dst))
+    {
+        rsm_log(ctx, "cannot complete transfer(%" PRIu64 ") because it is not live\n", xid.get());
+        return false;
+    }
+
+    del_transfer(xfer->id);
+    rsm_log(ctx, "transfer(%" PRIu64 ") is complete\n", xid.get());
+    converge_intent(ctx, reg);
+    return true;
+}
+
 void
 coordinator :: check_ack_condition(rsm_context* ctx)
 {
@@ -1876,7 +3449,27 @@ void
 coordinator :: generate_cached_configuration(rsm_context*)
 {
     m_latest_config.reset();
-    size_t sz = 7 * sizeof(uint64_t);
+    size_t sz = 8 * sizeof(uint64_t);
+
+    // ship what each region last reported storing, so that clients can tell
+    // how much work each subspace would do for a search
+    std::map<region_id, uint64_t> bytes;
+    region_bytes(&bytes);
+
+    for (std::map<std::string, e::compat::shared_ptr<space> >::iterator it = m_spaces.begin();
+            it != m_spaces.end(); ++it)
+    {
+        for (size_t i = 0; i < it->second->subspaces.size(); ++i)
+        {
+            std::vector<region>& regions(it->second->subspaces[i].regions);
+
+            for (size_t j = 0; j < regions.size(); ++j)
+            {
+                std::map<region_id, uint64_t>::iterator b = bytes.find(regions[j].id);
+                regions[j].stored_bytes = b != bytes.end() ? b->second : 0;
+            }
+        }
+    }
 
     for (size_t i = 0; i < m_servers.size(); ++i)
     {
@@ -1899,7 +3492,7 @@ coordinator :: generate_cached_configuration(rsm_context*)
 
     std::auto_ptr<e::buffer> new_config(e::buffer::create(sz));
     e::packer pa = new_config->pack_at(0);
-    pa = pa << m_cluster << m_version << m_flags
+    pa = pa << m_cluster << m_version << m_flags << m_transfer_rate
             << uint64_t(m_servers.size())
             << uint64_t(m_spaces.size())
             << uint64_t(transfers_subset.size());
@@ -2031,6 +3624,30 @@ coordinator :: regions_in_space(space_ptr s, std::vector<region_id>* rids)
     }
 }
 
+void
+coordinator :: log_chain_latency(rsm_context* ctx, uint64_t R,
+                                 const std::vector<replica_set>& replica_sets)
+{
+    if (m_zones.empty() || replica_sets.empty())
+    {
+        return;
+    }
+
+    uint64_t total = 0;
+    uint64_t worst = 0;
+
+    for (size_t i = 0; i < replica_sets.size(); ++i)
+    {
+        uint64_t latency = expected_chain_latency(replica_sets[i], m_zones);
+        total += latency;
+        worst = std::max(worst, latency);
+    }
+
+    rsm_log(ctx, "%" PRIu64 "-replica chains expect %" PRIu64 "us of hops "
+                 "on average and %" PRIu64 "us at worst\n",
+                 R, total / replica_sets.size(), worst);
+}
+
 void
 coordinator :: check_checkpoint_stable_condition(rsm_context* ctx, bool reissue)
 {
@@ -2048,6 +3665,7 @@ coordinator :: check_checkpoint_stable_condition(rsm_context* ctx, bool reissue)
         stabilized = true;
         ++m_checkpoint_stable_through;
         broadcast_checkpoint_information(ctx);
+        rsm_cond_broadcast(ctx, "checkpoint_stable");
     }
 
     bool gc = false;
@@ -48,8 +48,11 @@
 #include "common/transfer.h"
 #include "coordinator/offline_server.h"
 #include "coordinator/region_intent.h"
+#include "coordinator/region_load.h"
 #include "coordinator/replica_sets.h"
 #include "coordinator/server_barrier.h"
+#include "coordinator/server_epoch.h"
+#include "coordinator/server_zone.h"
 
 BEGIN_HYPERDEX_NAMESPACE
 
@@ -67,14 +70,18 @@ class coordinator
     // cluster management
     public:
         void read_only(rsm_context* ctx, bool ro);
+        // bytes/second each daemon may spend on state transfer; 0 is no limit
+        void transfer_rate(rsm_context* ctx, uint64_t rate);
         void fault_tolerance(rsm_context* ctx,
                              const char* space, uint64_t consistency);
 
     // server management
     public:
+        // "zone" is "zone" or "zone/rack", or empty if unknown
         void server_register(rsm_context* ctx,
                              const server_id& sid,
-                             const po6::net::location& bind_to);
+                             const po6::net::location& bind_to,
+                             const std::string& zone);
         void server_online(rsm_context* ctx,
                            const server_id& sid,
                            const po6::net::location* bind_to);
@@ -88,26 +95,52 @@ class coordinator
                            const server_id& sid);
         void server_suspect(rsm_context* ctx,
                             const server_id& sid);
-        void report_disconnect(rsm_context* ctx,
-                               const server_id& sid, uint64_t version);
+        // servers that others lost touch with under configuration
+        // "version"; they are all taken out in one new configuration
+        void report_disconnect(rsm_context* ctx, uint64_t version,
+                               const std::vector<server_id>& sids);
+        // the bytes and ops/second of each region the server holds; this
+        // replaces whatever the server reported before
+        void report_load(rsm_context* ctx,
+                         const server_id& sid,
+                         const std::vector<region_id>& rids,
+                         const std::vector<uint64_t>& bytes,
+                         const std::vector<uint64_t>& ops);
+        // regions whose contents the server lost when it restarted; it
+        // leaves each that has another replica and is added back through
+        // state transfer
+        void regions_lost(rsm_context* ctx,
+                          const server_id& sid,
+                          const std::vector<region_id>& rids);
 
     // space management
     public:
         void space_add(rsm_context* ctx, const space& s);
         void space_rm(rsm_context* ctx, const char* name);
         void space_mv(rsm_context* ctx, const char* src, const char* dst);
+        void space_immutable(rsm_context* ctx, const char* name, bool immutable);
+        void space_quota(rsm_context* ctx, const char* name,
+                         uint64_t ops, uint64_t bytes, uint64_t client_ops);
 
     // index management
     public:
         void index_add(rsm_context* ctx, const char* space, const char* attr);
         void index_rm(rsm_context* ctx, index_id ii);
 
+    // region management
+    public:
+        // halve the region's hyperspace bounds, handing the upper half to a
+        // new region on the same replicas
+        void region_split(rsm_context* ctx, const region_id& rid);
+
     // transfers management
+    // daemons report every transfer that is ready at once, and all of them
+    // go into one new configuration
     public:
         void transfer_go_live(rsm_context* ctx,
-                              const transfer_id& xid);
+                              const std::vector<transfer_id>& xids);
         void transfer_complete(rsm_context* ctx,
-                               const transfer_id& xid);
+                               const std::vector<transfer_id>& xids);
 
     // config management
     public:
@@ -164,6 +197,20 @@ class coordinator
         void setup_intents(rsm_context* ctx,
                            const std::vector<replica_set>& replica_sets,
                            space* s, bool skip_transfers);
+        // load
+        // move one region off the most loaded server if it carries
+        // noticeably more than its share, or split the region if it will not
+        // fit anywhere else; true if the layout changed
+        bool balance_load(rsm_context* ctx);
+        void region_costs(std::map<region_id, uint64_t>* costs);
+        // the largest size any replica reported for each region
+        void region_bytes(std::map<region_id, uint64_t>* bytes);
+        region_intent* get_placement(const region_id& rid);
+        // split a region whose largest replica holds more than
+        // REGION_SPLIT_BYTES; true if a region was split
+        bool split_large_region(rsm_context* ctx);
+        // false if the region is busy or cannot be divided further
+        bool split_region(rsm_context* ctx, const region_id& rid);
         // looks up region_intent* ri, removing any possibility of the user
         // using an invalid pointer
         void converge_intent(rsm_context* ctx,
@@ -181,6 +228,9 @@ class coordinator
         transfer* get_transfer(const region_id& rid);
         transfer* get_transfer(const transfer_id& xid);
         void del_transfer(const transfer_id& xid);
+        // true if the configuration must change
+        bool make_transfer_live(rsm_context* ctx, const transfer_id& xid);
+        bool finish_transfer(rsm_context* ctx, const transfer_id& xid);
         // configuration
         void check_ack_condition(rsm_context* ctx);
         void check_stable_condition(rsm_context* ctx);
@@ -189,6 +239,8 @@ class coordinator
         void prioritized_transfer_subset(std::vector<transfer>* transfers);
         void servers_in_configuration(std::vector<server_id>* sids);
         void regions_in_space(space_ptr s, std::vector<region_id>* rids);
+        void log_chain_latency(rsm_context* ctx, uint64_t R,
+                               const std::vector<replica_set>& replica_sets);
         // checkpoints
         void check_checkpoint_stable_condition(rsm_context* ctx, bool reissue);
         void broadcast_checkpoint_information(rsm_context* ctx);
@@ -199,8 +251,12 @@ class coordinator
         uint64_t m_counter;
         uint64_t m_version;
         uint64_t m_flags;
-        // servers
+        uint64_t m_transfer_rate;
+        // servers; m_zones is sorted by server and holds those with a label
         std::vector<server> m_servers;
+        std::vector<server_zone> m_zones;
+        // sorted by server; see server_epoch
+        std::vector<server_epoch> m_epochs;
         // replica sets
         std::vector<server_id> m_permutation;
         std::vector<server_id> m_spares;
@@ -213,6 +269,10 @@ class coordinator
         std::vector<offline_server> m_offline;
         // transfers
         std::vector<transfer> m_transfers;
+        // load; m_placements holds regions that balance_load moved off
+        // their default replica set, which setup_intents leaves in place
+        std::vector<region_load> m_loads;
+        std::vector<region_intent> m_placements;
         // barriers
         uint64_t m_config_ack_through;
         server_barrier m_config_ack_barrier;
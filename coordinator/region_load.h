@@ -0,0 +1,101 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_coordinator_region_load_h_
+#define hyperdex_coordinator_region_load_h_
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// what one server last reported about one of its regions
+class region_load
+{
+    public:
+        region_load();
+        region_load(const region_id& id, const server_id& sid,
+                    uint64_t bytes, uint64_t ops);
+        region_load(const region_load& other);
+
+    public:
+        region_id id;
+        server_id sid;
+        uint64_t bytes; // on disk
+        uint64_t ops; // per second
+};
+
+inline size_t
+pack_size(const region_load& rl)
+{
+    return pack_size(rl.id) + pack_size(rl.sid)
+         + sizeof(rl.bytes) + sizeof(rl.ops);
+}
+
+inline e::packer
+operator << (e::packer pa, const region_load& rl)
+{
+    return pa << rl.id << rl.sid << rl.bytes << rl.ops;
+}
+
+inline e::unpacker
+operator >> (e::unpacker up, region_load& rl)
+{
+    return up >> rl.id >> rl.sid >> rl.bytes >> rl.ops;
+}
+
+inline
+region_load :: region_load()
+    : id()
+    , sid()
+    , bytes(0)
+    , ops(0)
+{
+}
+
+inline
+region_load :: region_load(const region_id& _id, const server_id& _sid,
+                           uint64_t _bytes, uint64_t _ops)
+    : id(_id)
+    , sid(_sid)
+    , bytes(_bytes)
+    , ops(_ops)
+{
+}
+
+inline
+region_load :: region_load(const region_load& other)
+    : id(other.id)
+    , sid(other.sid)
+    , bytes(other.bytes)
+    , ops(other.ops)
+{
+}
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_coordinator_region_load_h_
@@ -27,21 +27,138 @@
 
 // STL
 #include <algorithm>
+#include <map>
+#include <string>
 
 // HyperDex
 #include "coordinator/replica_sets.h"
 
+// the expected one-way delay of a chain hop, in microseconds, between two
+// servers of one failure domain, of one zone, and of different zones; these
+// only rank layouts against each other, so rough figures do
+#define HOP_SAME_DOMAIN_US 50
+#define HOP_SAME_ZONE_US 250
+#define HOP_CROSS_ZONE_US 2000
+
 using hyperdex::replica_set;
 using hyperdex::server;
 using hyperdex::server_id;
+using hyperdex::server_zone;
 
 namespace
 {
 
+const server_zone*
+find_zone(const std::vector<server_zone>& zones, const server_id& sid)
+{
+    server_zone key(sid, "");
+    std::vector<server_zone>::const_iterator it;
+    it = std::lower_bound(zones.begin(), zones.end(), key);
+
+    if (it == zones.end() || it->sid != sid)
+    {
+        return NULL;
+    }
+
+    return &*it;
+}
+
+// deal the permutation out one server per failure domain at a time; domains
+// go in label order, so racks of one zone sit next to each other, and a
+// server without a label is a domain of its own
+void
+_interleave_domains(const std::vector<server_id>& permutation,
+                    const std::vector<server_zone>& zones,
+                    std::vector<server_id>* interleaved)
+{
+    std::map<std::string, std::vector<server_id> > domains;
+    std::vector<std::vector<server_id> > unlabeled;
+
+    for (size_t i = 0; i < permutation.size(); ++i)
+    {
+        const server_zone* z = find_zone(zones, permutation[i]);
+
+        if (z && !z->label.empty())
+        {
+            domains[z->label].push_back(permutation[i]);
+        }
+        else
+        {
+            unlabeled.push_back(std::vector<server_id>(1, permutation[i]));
+        }
+    }
+
+    std::vector<std::vector<server_id> > order;
+
+    for (std::map<std::string, std::vector<server_id> >::iterator it = domains.begin();
+            it != domains.end(); ++it)
+    {
+        order.push_back(it->second);
+    }
+
+    order.insert(order.end(), unlabeled.begin(), unlabeled.end());
+    interleaved->clear();
+
+    for (size_t round = 0; interleaved->size() < permutation.size(); ++round)
+    {
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            if (round < order[i].size())
+            {
+                interleaved->push_back(order[i][round]);
+            }
+        }
+    }
+}
+
+// reorder the chain in storage[start:] so that replicas in one zone are
+// adjacent, keeping zones in the order the chain first reaches them; this
+// crosses between zones the fewest times possible
+void
+_order_chain(const std::vector<server_zone>& zones, size_t start,
+             std::vector<server_id>* storage)
+{
+    if (zones.empty())
+    {
+        return;
+    }
+
+    std::vector<std::string> seen;
+    std::vector<std::pair<size_t, server_id> > ranked;
+
+    for (size_t i = start; i < storage->size(); ++i)
+    {
+        const server_zone* z = find_zone(zones, (*storage)[i]);
+        std::string zone(z ? z->zone() : std::string());
+        size_t rank = std::find(seen.begin(), seen.end(), zone) - seen.begin();
+
+        if (rank == seen.size())
+        {
+            seen.push_back(zone);
+        }
+
+        ranked.push_back(std::make_pair(rank, (*storage)[i]));
+    }
+
+    for (size_t i = 1; i < ranked.size(); ++i)
+    {
+        for (size_t j = i; j > 0 && ranked[j - 1].first > ranked[j].first; --j)
+        {
+            std::swap(ranked[j - 1], ranked[j]);
+        }
+    }
+
+    for (size_t i = 0; i < ranked.size(); ++i)
+    {
+        (*storage)[start + i] = ranked[i].second;
+    }
+}
+
 void
 _small_replica_sets(uint64_t, uint64_t,
                     const std::vector<server_id>& permutation,
                     const std::vector<server_id>& servers,
+                    const std::vector<server_zone>& zones,
                     std::vector<server_id>* replica_storage,
                     std::vector<replica_set>* replica_sets)
 {
@@ -63,6 +180,7 @@ _small_replica_sets(uint64_t, uint64_t,
             }
         }
 
+        _order_chain(zones, start, replica_storage);
         replica_sets->push_back(replica_set(start, repls, replica_storage));
     }
 }
@@ -71,6 +189,7 @@ void
 _permutation_replica_sets(uint64_t R, uint64_t P,
                           const std::vector<server_id>& permutation,
                           const std::vector<server_id>& servers,
+                          const std::vector<server_zone>& zones,
                           std::vector<server_id>* replica_storage,
                           std::vector<replica_set>* replica_sets)
 {
@@ -99,6 +218,7 @@ _permutation_replica_sets(uint64_t R, uint64_t P,
                 }
             }
 
+            _order_chain(zones, start, replica_storage);
             replica_sets->push_back(replica_set(start, repls, replica_storage));
         }
     }
@@ -152,8 +272,9 @@ replica_set :: operator = (const replica_set& rhs)
 
 void
 hyperdex :: compute_replica_sets(uint64_t R, uint64_t P,
-                                 const std::vector<server_id>& permutation,
+                                 const std::vector<server_id>& _permutation,
                                  const std::vector<server>& _servers,
+                                 const std::vector<server_zone>& zones,
                                  std::vector<server_id>* replica_storage,
                                  std::vector<replica_set>* replica_sets)
 {
@@ -172,13 +293,52 @@ hyperdex :: compute_replica_sets(uint64_t R, uint64_t P,
     }
 
     std::sort(servers.begin(), servers.end());
+    std::vector<server_id> permutation(_permutation);
+
+    if (!zones.empty())
+    {
+        _interleave_domains(_permutation, zones, &permutation);
+    }
 
     if (permutation.size() <= R)
     {
-        _small_replica_sets(R, P, permutation, servers, replica_storage, replica_sets);
+        _small_replica_sets(R, P, permutation, servers, zones, replica_storage, replica_sets);
     }
     else
     {
-        _permutation_replica_sets(R, P, permutation, servers, replica_storage, replica_sets);
+        _permutation_replica_sets(R, P, permutation, servers, zones, replica_storage, replica_sets);
+    }
+}
+
+uint64_t
+hyperdex :: expected_chain_latency(const replica_set& rs,
+                                   const std::vector<server_zone>& zones)
+{
+    uint64_t latency = 0;
+
+    for (size_t i = 1; i < rs.size(); ++i)
+    {
+        const server_zone* lhs = find_zone(zones, rs[i - 1]);
+        const server_zone* rhs = find_zone(zones, rs[i]);
+
+        // without labels on both ends, assume both are close
+        if (!lhs || !rhs || lhs->label.empty() || rhs->label.empty())
+        {
+            latency += HOP_SAME_ZONE_US;
+        }
+        else if (lhs->label == rhs->label)
+        {
+            latency += HOP_SAME_DOMAIN_US;
+        }
+        else if (lhs->zone() == rhs->zone())
+        {
+            latency += HOP_SAME_ZONE_US;
+        }
+        else
+        {
+            latency += HOP_CROSS_ZONE_US;
+        }
     }
+
+    return latency;
 }
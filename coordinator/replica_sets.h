@@ -32,6 +32,7 @@
 #include "namespace.h"
 #include "common/ids.h"
 #include "common/server.h"
+#include "coordinator/server_zone.h"
 
 BEGIN_HYPERDEX_NAMESPACE
 
@@ -56,13 +57,22 @@ class replica_set
         std::vector<server_id>* m_storage;
 };
 
+// "zones" is sorted by server and may be empty; when it is not, the
+// permutation is dealt out across failure domains so that each set spans as
+// many as it can, and each chain visits its zones one after another
 void
 compute_replica_sets(uint64_t R, uint64_t P,
                      const std::vector<server_id>& permutation,
                      const std::vector<server>& servers,
+                     const std::vector<server_zone>& zones,
                      std::vector<server_id>* replica_storage,
                      std::vector<replica_set>* replica_sets);
 
+// the microseconds a write should expect to spend on the chain's hops
+uint64_t
+expected_chain_latency(const replica_set& rs,
+                       const std::vector<server_zone>& zones);
+
 END_HYPERDEX_NAMESPACE
 
 #endif // hyperdex_coordinator_replica_sets_h_
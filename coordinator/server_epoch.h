@@ -0,0 +1,100 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_coordinator_server_epoch_h_
+#define hyperdex_coordinator_server_epoch_h_
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+#include "common/serialization.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// the configuration in which a server last came online; reports of its
+// failure made against older configurations are about a previous life
+class server_epoch
+{
+    public:
+        server_epoch();
+        server_epoch(const server_id& sid, uint64_t version);
+        server_epoch(const server_epoch& other);
+
+    public:
+        server_id sid;
+        uint64_t version;
+};
+
+inline bool
+operator < (const server_epoch& lhs, const server_epoch& rhs)
+{
+    return lhs.sid < rhs.sid;
+}
+
+inline size_t
+pack_size(const server_epoch& se)
+{
+    return pack_size(se.sid) + sizeof(uint64_t);
+}
+
+inline e::packer
+operator << (e::packer pa, const server_epoch& se)
+{
+    return pa << se.sid << se.version;
+}
+
+inline e::unpacker
+operator >> (e::unpacker up, server_epoch& se)
+{
+    return up >> se.sid >> se.version;
+}
+
+inline
+server_epoch :: server_epoch()
+    : sid()
+    , version(0)
+{
+}
+
+inline
+server_epoch :: server_epoch(const server_id& _sid, uint64_t _version)
+    : sid(_sid)
+    , version(_version)
+{
+}
+
+inline
+server_epoch :: server_epoch(const server_epoch& other)
+    : sid(other.sid)
+    , version(other.version)
+{
+}
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_coordinator_server_epoch_h_
@@ -0,0 +1,108 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_coordinator_server_zone_h_
+#define hyperdex_coordinator_server_zone_h_
+
+// STL
+#include <string>
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+#include "common/serialization.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// where a server sits:  "zone" or "zone/rack"; servers that share the whole
+// label share a failure domain, and servers that share the zone are close
+class server_zone
+{
+    public:
+        server_zone();
+        server_zone(const server_id& sid, const std::string& label);
+        server_zone(const server_zone& other);
+
+    public:
+        std::string zone() const { return label.substr(0, label.find('/')); }
+
+    public:
+        server_id sid;
+        std::string label;
+};
+
+inline bool
+operator < (const server_zone& lhs, const server_zone& rhs)
+{
+    return lhs.sid < rhs.sid;
+}
+
+inline size_t
+pack_size(const server_zone& sz)
+{
+    return pack_size(sz.sid) + pack_size(e::slice(sz.label));
+}
+
+inline e::packer
+operator << (e::packer pa, const server_zone& sz)
+{
+    return pa << sz.sid << e::slice(sz.label);
+}
+
+inline e::unpacker
+operator >> (e::unpacker up, server_zone& sz)
+{
+    e::slice label;
+    up = up >> sz.sid >> label;
+    sz.label.assign(label.cdata(), label.size());
+    return up;
+}
+
+inline
+server_zone :: server_zone()
+    : sid()
+    , label()
+{
+}
+
+inline
+server_zone :: server_zone(const server_id& _sid, const std::string& _label)
+    : sid(_sid)
+    , label(_label)
+{
+}
+
+inline
+server_zone :: server_zone(const server_zone& other)
+    : sid(other.sid)
+    , label(other.label)
+{
+}
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_coordinator_server_zone_h_
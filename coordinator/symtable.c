@@ -51,16 +51,22 @@ struct state_machine HYPERDEX_API rsm = {
      {"server_forget", hyperdex_coordinator_server_forget},
      {"server_suspect", hyperdex_coordinator_server_suspect},
      {"report_disconnect", hyperdex_coordinator_report_disconnect},
+     {"report_load", hyperdex_coordinator_report_load},
+     {"regions_lost", hyperdex_coordinator_regions_lost},
      {"space_add", hyperdex_coordinator_space_add},
      {"space_rm", hyperdex_coordinator_space_rm},
      {"space_mv", hyperdex_coordinator_space_mv},
+     {"space_immutable", hyperdex_coordinator_space_immutable},
+     {"space_quota", hyperdex_coordinator_space_quota},
      {"index_add", hyperdex_coordinator_index_add},
      {"index_rm", hyperdex_coordinator_index_rm},
+     {"region_split", hyperdex_coordinator_region_split},
      {"transfer_go_live", hyperdex_coordinator_transfer_go_live},
      {"transfer_complete", hyperdex_coordinator_transfer_complete},
      {"checkpoint_stable", hyperdex_coordinator_checkpoint_stable},
      {"periodic", hyperdex_coordinator_periodic},
      {"read_only", hyperdex_coordinator_read_only},
+     {"transfer_rate", hyperdex_coordinator_transfer_rate},
      {"fault_tolerance", hyperdex_coordinator_fault_tolerance},
      {"checkpoints", hyperdex_coordinator_checkpoints},
      {"debug_dump", hyperdex_coordinator_debug_dump},
@@ -30,6 +30,7 @@
 
 // STL
 #include <string>
+#include <vector>
 
 // HyperDex
 #include "common/coordinator_returncode.h"
@@ -73,6 +74,7 @@ hyperdex_coordinator_create(struct rsm_context* ctx)
     rsm_cond_create(ctx, "ack");
     rsm_cond_create(ctx, "stable");
     rsm_cond_create(ctx, "checkpoint");
+    rsm_cond_create(ctx, "checkpoint_stable");
     return new (std::nothrow) coordinator();
 }
 
@@ -114,6 +116,18 @@ hyperdex_coordinator_read_only(struct rsm_context* ctx,
     c->read_only(ctx, set != 0);
 }
 
+void
+hyperdex_coordinator_transfer_rate(struct rsm_context* ctx,
+                                   void* obj, const char* data, size_t data_sz)
+{
+    PROTECT_UNINITIALIZED;
+    uint64_t rate;
+    e::unpacker up(data, data_sz);
+    up = up >> rate;
+    CHECK_UNPACK(transfer_rate);
+    c->transfer_rate(ctx, rate);
+}
+
 void
 hyperdex_coordinator_fault_tolerance(struct rsm_context* ctx,
                                      void* obj, const char* data, size_t data_sz)
@@ -168,10 +182,20 @@ hyperdex_coordinator_server_register(struct rsm_context* ctx,
     PROTECT_UNINITIALIZED;
     server_id sid;
     po6::net::location bind_to;
+    std::string zone;
     e::unpacker up(data, data_sz);
     up = up >> sid >> bind_to;
+
+    // the zone is optional
+    if (!up.error() && up.remain())
+    {
+        e::slice z;
+        up = up >> z;
+        zone.assign(z.cdata(), z.size());
+    }
+
     CHECK_UNPACK(server_register);
-    c->server_register(ctx, sid, bind_to);
+    c->server_register(ctx, sid, bind_to, zone);
 }
 
 void
@@ -261,12 +285,50 @@ hyperdex_coordinator_report_disconnect(struct rsm_context* ctx,
                                        void* obj, const char* data, size_t data_sz)
 {
     PROTECT_UNINITIALIZED;
-    server_id sid;
     uint64_t version;
+    std::vector<server_id> sids;
     e::unpacker up(data, data_sz);
-    up = up >> sid >> version;
+    up = up >> version;
+
+    // one or more server ids, back to back
+    do
+    {
+        server_id sid;
+        up = up >> sid;
+        sids.push_back(sid);
+    }
+    while (!up.error() && up.remain());
+
     CHECK_UNPACK(report_disconnect);
-    c->report_disconnect(ctx, sid, version);
+    c->report_disconnect(ctx, version, sids);
+}
+
+void
+hyperdex_coordinator_report_load(struct rsm_context* ctx,
+                                 void* obj, const char* data, size_t data_sz)
+{
+    PROTECT_UNINITIALIZED;
+    server_id sid;
+    std::vector<region_id> rids;
+    std::vector<uint64_t> bytes;
+    std::vector<uint64_t> ops;
+    e::unpacker up(data, data_sz);
+    up = up >> sid >> rids >> bytes >> ops;
+    CHECK_UNPACK(report_load);
+    c->report_load(ctx, sid, rids, bytes, ops);
+}
+
+void
+hyperdex_coordinator_regions_lost(struct rsm_context* ctx,
+                                  void* obj, const char* data, size_t data_sz)
+{
+    PROTECT_UNINITIALIZED;
+    server_id sid;
+    std::vector<region_id> rids;
+    e::unpacker up(data, data_sz);
+    up = up >> sid >> rids;
+    CHECK_UNPACK(regions_lost);
+    c->regions_lost(ctx, sid, rids);
 }
 
 void
@@ -320,6 +382,45 @@ hyperdex_coordinator_space_mv(struct rsm_context* ctx,
     c->space_mv(ctx, src, dst);
 }
 
+void
+hyperdex_coordinator_space_immutable(struct rsm_context* ctx,
+                                     void* obj, const char* data, size_t data_sz)
+{
+    PROTECT_UNINITIALIZED;
+
+    // the flag, then the space's name
+    if (data_sz < 3 || data[data_sz - 1] != '\0')
+    {
+        rsm_log(ctx, "received malformed \"space_immutable\" message\n");
+        return generate_response(ctx, COORD_MALFORMED);
+    }
+
+    c->space_immutable(ctx, data + 1, data[0] != 0);
+}
+
+void
+hyperdex_coordinator_space_quota(struct rsm_context* ctx,
+                                 void* obj, const char* data, size_t data_sz)
+{
+    PROTECT_UNINITIALIZED;
+    const size_t quota_sz = 3 * sizeof(uint64_t);
+
+    // the three quotas, then the space's name
+    if (data_sz < quota_sz + 2 || data[data_sz - 1] != '\0')
+    {
+        rsm_log(ctx, "received malformed \"space_quota\" message\n");
+        return generate_response(ctx, COORD_MALFORMED);
+    }
+
+    uint64_t ops;
+    uint64_t bytes;
+    uint64_t client_ops;
+    e::unpacker up(data, quota_sz);
+    up = up >> ops >> bytes >> client_ops;
+    CHECK_UNPACK(space_quota);
+    c->space_quota(ctx, data + quota_sz, ops, bytes, client_ops);
+}
+
 void
 hyperdex_coordinator_index_add(struct rsm_context* ctx,
                                void* obj, const char* data, size_t data_sz)
@@ -358,16 +459,37 @@ hyperdex_coordinator_index_rm(struct rsm_context* ctx,
     c->index_rm(ctx, ii);
 }
 
+void
+hyperdex_coordinator_region_split(struct rsm_context* ctx,
+                                  void* obj, const char* data, size_t data_sz)
+{
+    PROTECT_UNINITIALIZED;
+    region_id rid;
+    e::unpacker up(data, data_sz);
+    up = up >> rid;
+    CHECK_UNPACK(region_split);
+    c->region_split(ctx, rid);
+}
+
 void
 hyperdex_coordinator_transfer_go_live(struct rsm_context* ctx,
                                       void* obj, const char* data, size_t data_sz)
 {
     PROTECT_UNINITIALIZED;
-    transfer_id xid;
+    std::vector<transfer_id> xids;
     e::unpacker up(data, data_sz);
-    up = up >> xid;
+
+    // one or more transfer ids, back to back
+    do
+    {
+        transfer_id xid;
+        up = up >> xid;
+        xids.push_back(xid);
+    }
+    while (!up.error() && up.remain());
+
     CHECK_UNPACK(transfer_go_live);
-    c->transfer_go_live(ctx, xid);
+    c->transfer_go_live(ctx, xids);
 }
 
 void
@@ -375,11 +497,20 @@ hyperdex_coordinator_transfer_complete(struct rsm_context* ctx,
                                        void* obj, const char* data, size_t data_sz)
 {
     PROTECT_UNINITIALIZED;
-    transfer_id xid;
+    std::vector<transfer_id> xids;
     e::unpacker up(data, data_sz);
-    up = up >> xid;
+
+    // one or more transfer ids, back to back
+    do
+    {
+        transfer_id xid;
+        up = up >> xid;
+        xids.push_back(xid);
+    }
+    while (!up.error() && up.remain());
+
     CHECK_UNPACK(transfer_complete);
-    c->transfer_complete(ctx, xid);
+    c->transfer_complete(ctx, xids);
 }
 
 void
@@ -54,6 +54,7 @@ hyperdex_coordinator_snapshot(struct rsm_context* ctx,
 TRANSITION(init);
 
 TRANSITION(read_only);
+TRANSITION(transfer_rate);
 TRANSITION(fault_tolerance);
 
 TRANSITION(config_get);
@@ -68,14 +69,20 @@ TRANSITION(server_kill);
 TRANSITION(server_forget);
 TRANSITION(server_suspect);
 TRANSITION(report_disconnect);
+TRANSITION(report_load);
+TRANSITION(regions_lost);
 
 TRANSITION(space_add);
 TRANSITION(space_rm);
 TRANSITION(space_mv);
+TRANSITION(space_immutable);
+TRANSITION(space_quota);
 
 TRANSITION(index_add);
 TRANSITION(index_rm);
 
+TRANSITION(region_split);
+
 TRANSITION(transfer_go_live);
 TRANSITION(transfer_complete);
 
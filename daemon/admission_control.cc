@@ -0,0 +1,224 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// STL
+#include <algorithm>
+
+// HyperDex
+#include "daemon/admission_control.h"
+
+using hyperdex::admission_control;
+
+// past this many per-client buckets, drop those of idle clients
+#define ADMISSION_CLIENT_BUCKETS 4096
+// a bucket untouched this long is full again, no different from a new one;
+// debt is at most a second's quota, so two seconds refill any bucket
+#define ADMISSION_IDLE_NANOS 2000000000ULL
+
+admission_control :: admission_control()
+    : m_mtx()
+    , m_spaces()
+    , m_clients()
+    , m_pruned_at(0)
+{
+}
+
+admission_control :: ~admission_control() throw ()
+{
+}
+
+bool
+admission_control :: admit(const char* space, const schema& sc,
+                           const server_id& client, uint64_t bytes,
+                           uint64_t now, uint64_t* retry_after)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    space_buckets* sb = &m_spaces[space];
+    bucket* cb = sc.quota_client_ops != 0 ? client_bucket(space, client, now) : NULL;
+    uint64_t wait = 0;
+
+    if (sc.quota_ops != 0)
+    {
+        refill(&sb->ops, sc.quota_ops, now);
+        wait = std::max(wait, wait_for(sb->ops, sc.quota_ops, 1));
+    }
+
+    if (sc.quota_bytes != 0)
+    {
+        refill(&sb->bytes, sc.quota_bytes, now);
+        wait = std::max(wait, wait_for(sb->bytes, sc.quota_bytes, bytes));
+    }
+
+    if (cb)
+    {
+        refill(cb, sc.quota_client_ops, now);
+        wait = std::max(wait, wait_for(*cb, sc.quota_client_ops, 1));
+    }
+
+    if (wait > 0)
+    {
+        *retry_after = wait;
+        return false;
+    }
+
+    if (sc.quota_ops != 0)
+    {
+        take(&sb->ops, sc.quota_ops, 1);
+    }
+
+    if (sc.quota_bytes != 0)
+    {
+        take(&sb->bytes, sc.quota_bytes, bytes);
+    }
+
+    if (cb)
+    {
+        take(cb, sc.quota_client_ops, 1);
+    }
+
+    return true;
+}
+
+void
+admission_control :: charge(const char* space, const schema& sc,
+                            const server_id& client, uint64_t bytes,
+                            uint64_t now)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    space_buckets* sb = &m_spaces[space];
+
+    if (sc.quota_ops != 0)
+    {
+        refill(&sb->ops, sc.quota_ops, now);
+        take(&sb->ops, sc.quota_ops, 1);
+    }
+
+    if (sc.quota_bytes != 0)
+    {
+        refill(&sb->bytes, sc.quota_bytes, now);
+        take(&sb->bytes, sc.quota_bytes, bytes);
+    }
+
+    if (sc.quota_client_ops != 0)
+    {
+        bucket* cb = client_bucket(space, client, now);
+        refill(cb, sc.quota_client_ops, now);
+        take(cb, sc.quota_client_ops, 1);
+    }
+}
+
+uint64_t
+admission_control :: pace(const region_id& ri, uint64_t interval,
+                          uint64_t max_wait, uint64_t now)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    uint64_t& next(m_paced[ri]);
+
+    // a request told to come back holds no turn, so those that retry do
+    // not push the region's later turns further out
+    if (next > now)
+    {
+        return std::min(next - now, max_wait);
+    }
+
+    next = now + interval;
+    return 0;
+}
+
+void
+admission_control :: refill(bucket* b, uint64_t rate, uint64_t now)
+{
+    // a new bucket starts full
+    if (b->at == 0)
+    {
+        b->level = rate;
+        b->at = now;
+        return;
+    }
+
+    if (now <= b->at)
+    {
+        return;
+    }
+
+    const double elapsed = (now - b->at) / 1e9;
+    b->level = std::min(double(rate), b->level + elapsed * rate);
+    b->at = now;
+}
+
+uint64_t
+admission_control :: wait_for(const bucket& b, uint64_t rate, double cost)
+{
+    // a request costing more than the bucket holds goes when it is full
+    const double needed = std::min(cost, double(rate));
+
+    if (b.level >= needed)
+    {
+        return 0;
+    }
+
+    const uint64_t ms = uint64_t((needed - b.level) * 1000. / rate) + 1;
+    return ms;
+}
+
+void
+admission_control :: take(bucket* b, uint64_t rate, double cost)
+{
+    b->level = std::max(b->level - cost, -double(rate));
+}
+
+admission_control::bucket*
+admission_control :: client_bucket(const char* space, const server_id& client, uint64_t now)
+{
+    if (m_clients.size() > ADMISSION_CLIENT_BUCKETS &&
+        now - m_pruned_at > ADMISSION_IDLE_NANOS)
+    {
+        prune_clients(now);
+    }
+
+    return &m_clients[std::make_pair(std::string(space), client.get())];
+}
+
+void
+admission_control :: prune_clients(uint64_t now)
+{
+    client_map_t::iterator it = m_clients.begin();
+
+    while (it != m_clients.end())
+    {
+        if (it->second.at < now && now - it->second.at >= ADMISSION_IDLE_NANOS)
+        {
+            m_clients.erase(it++);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    m_pruned_at = now;
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_admission_control_h_
+#define hyperdex_daemon_admission_control_h_
+
+// STL
+#include <map>
+#include <string>
+#include <utility>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+#include "common/schema.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Holds the requests each space gets to its quota.  Every quota is a token
+// bucket that refills at the quota's rate and holds one second's worth, so a
+// quiet space may burst up to a second's quota at once.  Also paces the
+// writes each region admits while the disk falls behind.  Times are
+// nanoseconds on the monotonic clock.
+class admission_control
+{
+    public:
+        admission_control();
+        ~admission_control() throw ();
+
+    // concurrent methods
+    public:
+        // may a request of "bytes" from "client" to "space" run now?  If so,
+        // it is charged against the space's quotas; if not, nothing is
+        // charged and "retry_after" is how many milliseconds until it may
+        bool admit(const char* space, const schema& sc,
+                   const server_id& client, uint64_t bytes,
+                   uint64_t now, uint64_t* retry_after);
+        // charge a request that cannot be refused, so that what the space
+        // does next waits for it instead
+        void charge(const char* space, const schema& sc,
+                    const server_id& client, uint64_t bytes,
+                    uint64_t now);
+        // space the region's requests "interval" apart; 0 if this one may go
+        // now and it takes the turn, or else how long until the next turn,
+        // which is never more than "max_wait", and nothing is taken
+        uint64_t pace(const region_id& ri, uint64_t interval,
+                      uint64_t max_wait, uint64_t now);
+
+    private:
+        struct bucket
+        {
+            bucket() : level(0), at(0) {}
+            double level;
+            uint64_t at;
+        };
+        struct space_buckets
+        {
+            space_buckets() : ops(), bytes() {}
+            bucket ops;
+            bucket bytes;
+        };
+        typedef std::map<std::string, space_buckets> space_map_t;
+        typedef std::map<std::pair<std::string, uint64_t>, bucket> client_map_t;
+
+    private:
+        static void refill(bucket* b, uint64_t rate, uint64_t now);
+        // milliseconds until "b" holds "cost" tokens, or 0 if it does now
+        static uint64_t wait_for(const bucket& b, uint64_t rate, double cost);
+        static void take(bucket* b, uint64_t rate, double cost);
+        bucket* client_bucket(const char* space, const server_id& client, uint64_t now);
+        void prune_clients(uint64_t now);
+
+    private:
+        po6::threads::mutex m_mtx;
+        space_map_t m_spaces;
+        client_map_t m_clients;
+        uint64_t m_pruned_at;
+        // when each paced region's next request may go
+        std::map<region_id, uint64_t> m_paced;
+
+    private:
+        admission_control(const admission_control&);
+        admission_control& operator = (const admission_control&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_admission_control_h_
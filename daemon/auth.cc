@@ -25,14 +25,29 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+// STL
+#include <algorithm>
+#include <string>
+
 // po6
+#include <po6/threads/mutex.h>
 #include <po6/time.h>
 
 // HyperDex
 #include <hyperdex/client.h>
+#include "cityhash/city.h"
 #include "common/auth_wallet.h"
 #include "daemon/auth.h"
 
+// Macaroon sets that verified, so that a client presenting the same tokens
+// again and again pays for the HMAC chains once.  Each entry is keyed on all
+// the outcome depends on: the exact caveats of the operation, the object's
+// secret, and the serialized macaroons.  A new secret thus changes the key,
+// and an entry lives only until the earliest "time < " caveat it relied on.
+// Only successes are remembered.
+#define AUTH_CACHE_SLOTS 4096
+#define AUTH_CACHE_STRIPES 64
+
 BEGIN_HYPERDEX_NAMESPACE
 
 struct general_caveat
@@ -45,6 +60,20 @@ struct general_caveat
 
 END_HYPERDEX_NAMESPACE
 
+bool
+hyperdex :: has_secrets(const schema& sc)
+{
+    for (size_t i = 1; i < sc.attrs_sz; ++i)
+    {
+        if (sc.attrs[i].type == HYPERDATATYPE_MACAROON_SECRET)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void
 hyperdex :: sanitize_secrets(const schema& sc, std::vector<e::slice>* value)
 {
@@ -57,6 +86,25 @@ hyperdex :: sanitize_secrets(const schema& sc, std::vector<e::slice>* value)
     }
 }
 
+static bool
+find_secret(const hyperdex::schema& sc,
+            const std::vector<e::slice>& value,
+            e::slice* secret)
+{
+    bool has_secret = false;
+
+    for (size_t i = 1; i < sc.attrs_sz; ++i)
+    {
+        if (sc.attrs[i].type == HYPERDATATYPE_MACAROON_SECRET)
+        {
+            has_secret = true;
+            *secret = value[i - 1];
+        }
+    }
+
+    return has_secret;
+}
+
 static void
 destroy_macaroons(std::vector<macaroon*>* MS)
 {
@@ -84,17 +132,8 @@ hyperdex :: auth_verify(const schema& sc,
         return false;
     }
 
-    bool has_secret = false;
     e::slice secret;
-
-    for (size_t i = 1; i < sc.attrs_sz; ++i)
-    {
-        if (sc.attrs[i].type == HYPERDATATYPE_MACAROON_SECRET)
-        {
-            has_secret = true;
-            secret = (*value)[i - 1];
-        }
-    }
+    bool has_secret = find_secret(sc, *value, &secret);
 
     // build the verifier
     struct macaroon_verifier* V = macaroon_verifier_create();
@@ -145,6 +184,29 @@ hyperdex :: auth_verify(const schema& sc,
 #define TIME_PRED "time < "
 #define TIME_PRED_SZ (sizeof(TIME_PRED) - 1)
 
+namespace
+{
+
+struct time_caveat
+{
+    time_caveat(uint64_t n) : now(n), valid_until(UINT64_MAX) {}
+    uint64_t now;
+    // the earliest expiry among the caveats checked so far
+    uint64_t valid_until;
+};
+
+struct auth_cache_entry
+{
+    auth_cache_entry() : key(), valid_until(0) {}
+    std::string key;
+    uint64_t valid_until;
+};
+
+auth_cache_entry s_auth_cache[AUTH_CACHE_SLOTS];
+po6::threads::mutex s_auth_cache_locks[AUTH_CACHE_STRIPES];
+
+} // namespace
+
 static int
 check_time(void* t, const unsigned char* pred, size_t pred_sz)
 {
@@ -163,7 +225,97 @@ check_time(void* t, const unsigned char* pred, size_t pred_sz)
         return -1;
     }
 
-    return (*reinterpret_cast<uint64_t*>(t) < expiry) ? 0 : -1;
+    time_caveat* tc = reinterpret_cast<time_caveat*>(t);
+
+    if (tc->now >= expiry)
+    {
+        return -1;
+    }
+
+    tc->valid_until = std::min<uint64_t>(tc->valid_until, expiry);
+    return 0;
+}
+
+static void
+append_sized(std::string* key, const char* data, size_t data_sz)
+{
+    uint64_t sz = data_sz;
+    key->append(reinterpret_cast<const char*>(&sz), sizeof(sz));
+    key->append(data, data_sz);
+}
+
+static std::string
+auth_cache_key(const char** exact,
+               const e::slice& secret,
+               const hyperdex::auth_wallet& aw)
+{
+    std::string key;
+
+    while (exact && *exact)
+    {
+        key.append(*exact);
+        key.push_back('\0');
+        ++exact;
+    }
+
+    append_sized(&key, secret.cdata(), secret.size());
+    const std::vector<std::string>& macaroons(aw.serialized());
+
+    for (size_t i = 0; i < macaroons.size(); ++i)
+    {
+        append_sized(&key, macaroons[i].data(), macaroons[i].size());
+    }
+
+    return key;
+}
+
+// auth_verify with the time caveat, consulting the cache of verified sets
+static bool
+auth_verify_cached(const hyperdex::schema& sc,
+                   bool has_value,
+                   const std::vector<e::slice>* value,
+                   hyperdex::auth_wallet* aw,
+                   const char** exact)
+{
+    if (!sc.authorization)
+    {
+        return true;
+    }
+
+    e::slice secret;
+
+    if (!has_value || !aw || !find_secret(sc, *value, &secret))
+    {
+        return false;
+    }
+
+    time_caveat tc(po6::time() / 1000000000ULL);
+    const std::string key = auth_cache_key(exact, secret, *aw);
+    const uint64_t h = CityHash64(key.data(), key.size());
+    auth_cache_entry* ace = &s_auth_cache[h % AUTH_CACHE_SLOTS];
+    po6::threads::mutex* mtx = &s_auth_cache_locks[h % AUTH_CACHE_STRIPES];
+
+    {
+        po6::threads::mutex::hold hold(mtx);
+
+        if (tc.now < ace->valid_until && ace->key == key)
+        {
+            return true;
+        }
+    }
+
+    hyperdex::general_caveat general[] = {hyperdex::general_caveat(check_time, &tc),
+                                          hyperdex::general_caveat()};
+
+    if (!hyperdex::auth_verify(sc, has_value, value, aw, exact, general))
+    {
+        return false;
+    }
+
+    po6::threads::mutex::hold hold(mtx);
+    ace->key = key;
+    ace->valid_until = tc.valid_until;
+    return true;
 }
 
 bool
@@ -173,9 +325,7 @@ hyperdex :: auth_verify_read(const schema& sc,
                              auth_wallet* aw)
 {
     const char* exact[] = {"op = read", NULL};
-    uint64_t time = po6::time() / 1000000000ULL;
-    general_caveat general[] = {general_caveat(check_time, &time), general_caveat()};
-    return auth_verify(sc, has_value, value, aw, exact, general);
+    return auth_verify_cached(sc, has_value, value, aw, exact);
 }
 
 
@@ -214,8 +364,6 @@ hyperdex :: auth_verify_write(const schema& sc,
     else
     {
         const char* exact[] = {"op = write", NULL};
-        uint64_t time = po6::time() / 1000000000ULL;
-        general_caveat general[] = {general_caveat(check_time, &time), general_caveat()};
-        return auth_verify(sc, has_value, value, kc.auth.get(), exact, general);
+        return auth_verify_cached(sc, has_value, value, kc.auth.get(), exact);
     }
 }
@@ -39,6 +39,9 @@
 
 BEGIN_HYPERDEX_NAMESPACE
 
+bool
+has_secrets(const schema& sc);
+
 void
 sanitize_secrets(const schema& sc, std::vector<e::slice>* value);
 
@@ -46,6 +46,7 @@ using hyperdex::background_thread;
 background_thread :: background_thread(daemon* d)
     : m_thread(make_obj_func(&background_thread::run, this))
     , m_gc(&d->m_gc)
+    , m_placement(&d->m_placement)
     , m_protect()
     , m_wakeup_thread(&m_protect)
     , m_wakeup_pauser(&m_protect)
@@ -149,6 +150,7 @@ background_thread :: run()
 {
     LOG(INFO) << this->thread_name() << " thread started";
     block_signals();
+    m_placement->place_background_thread(this->thread_name());
     e::garbage_collector::thread_state ts;
     m_gc->register_thread(&ts);
 
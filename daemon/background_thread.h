@@ -41,6 +41,7 @@
 
 BEGIN_HYPERDEX_NAMESPACE
 class daemon;
+class thread_placement;
 
 class background_thread
 {
@@ -83,6 +84,7 @@ class background_thread
     private:
         po6::threads::thread m_thread;
         e::garbage_collector* m_gc;
+        const thread_placement* m_placement;
         po6::threads::mutex m_protect;
         po6::threads::cond m_wakeup_thread;
         po6::threads::cond m_wakeup_pauser;
@@ -0,0 +1,243 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <errno.h>
+#include <string.h>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// STL
+#include <algorithm>
+
+// e
+#include <e/endian.h>
+
+// HyperDex
+#include "common/compression.h"
+#include "daemon/column_writer.h"
+
+using hyperdex::column_writer;
+
+// a block closes at whichever of these it reaches first
+#define COLUMN_BLOCK_VALUES 8192
+#define COLUMN_BLOCK_BYTES (1024 * 1024)
+
+static const char COLUMN_MAGIC[8] = {'H', 'D', 'X', 'C', 'O', 'L', '\0', '\1'};
+
+const size_t column_writer::HEADER_SIZE;
+const size_t column_writer::BLOCK_HEADER_SIZE;
+const uint16_t column_writer::FLAG_COMPRESSED;
+
+static bool
+pwrite_fully(int fd, const uint8_t* data, size_t sz, uint64_t off)
+{
+    while (sz > 0)
+    {
+        ssize_t ret = pwrite(fd, data, sz, off);
+
+        if (ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (ret <= 0)
+        {
+            return false;
+        }
+
+        data += ret;
+        sz -= ret;
+        off += ret;
+    }
+
+    return true;
+}
+
+column_writer :: column_writer(hyperdatatype type, bool compress)
+    : m_type(type)
+    , m_compress(compress && compression_available())
+    , m_fd()
+    , m_offset(0)
+    , m_values(0)
+    , m_blocks(0)
+    , m_block_values(0)
+    , m_offsets()
+    , m_data()
+    , m_scratch()
+{
+}
+
+column_writer :: ~column_writer() throw ()
+{
+}
+
+bool
+column_writer :: open(const std::string& path)
+{
+    m_fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP);
+
+    if (m_fd.get() < 0)
+    {
+        return false;
+    }
+
+    m_offset = HEADER_SIZE;
+    m_values = 0;
+    m_blocks = 0;
+    m_block_values = 0;
+    m_offsets.clear();
+    m_data.clear();
+    // written again with the totals on close
+    return write_header();
+}
+
+bool
+column_writer :: append(const e::slice& value)
+{
+    if (fixed())
+    {
+        // empty is the default of zero; anything else is already eight bytes
+        char buf[sizeof(uint64_t)];
+        memset(buf, 0, sizeof(buf));
+        memmove(buf, value.data(), std::min(value.size(), sizeof(buf)));
+        m_data.insert(m_data.end(), buf, buf + sizeof(buf));
+    }
+    else
+    {
+        if (m_offsets.empty())
+        {
+            m_offsets.push_back(0);
+        }
+
+        m_data.insert(m_data.end(), value.cdata(), value.cdata() + value.size());
+        m_offsets.push_back(m_data.size());
+    }
+
+    ++m_values;
+    ++m_block_values;
+
+    if (m_block_values >= COLUMN_BLOCK_VALUES || m_data.size() >= COLUMN_BLOCK_BYTES)
+    {
+        return flush();
+    }
+
+    return true;
+}
+
+bool
+column_writer :: close()
+{
+    if (m_fd.get() < 0)
+    {
+        return false;
+    }
+
+    bool ret = flush() && write_header() && fsync(m_fd.get()) == 0;
+    m_fd.close();
+    return ret;
+}
+
+bool
+column_writer :: fixed() const
+{
+    return m_type == HYPERDATATYPE_INT64 ||
+           m_type == HYPERDATATYPE_FLOAT ||
+           CONTAINER_TYPE(m_type) == HYPERDATATYPE_TIMESTAMP_GENERIC;
+}
+
+bool
+column_writer :: flush()
+{
+    if (m_block_values == 0)
+    {
+        return true;
+    }
+
+    // lay the block out raw in m_scratch, offsets first
+    m_scratch.resize(m_offsets.size() * sizeof(uint32_t) + m_data.size());
+    uint8_t* ptr = m_scratch.empty() ? NULL : reinterpret_cast<uint8_t*>(&m_scratch[0]);
+
+    for (size_t i = 0; i < m_offsets.size(); ++i)
+    {
+        ptr = e::pack32le(m_offsets[i], ptr);
+    }
+
+    if (!m_data.empty())
+    {
+        memmove(ptr, &m_data[0], m_data.size());
+    }
+
+    const uint32_t raw_size = m_scratch.size();
+    std::vector<char> packed;
+    const char* body = m_scratch.empty() ? NULL : &m_scratch[0];
+    uint32_t stored_size = raw_size;
+
+    if (m_compress && compress(e::slice(body, raw_size), &packed))
+    {
+        body = &packed[0];
+        stored_size = packed.size();
+    }
+
+    uint8_t header[BLOCK_HEADER_SIZE];
+    ptr = header;
+    ptr = e::pack32le(m_block_values, ptr);
+    ptr = e::pack32le(raw_size, ptr);
+    ptr = e::pack32le(stored_size, ptr);
+    ptr = e::pack32le(uint32_t(0), ptr);
+
+    if (!pwrite_fully(m_fd.get(), header, BLOCK_HEADER_SIZE, m_offset) ||
+        !pwrite_fully(m_fd.get(), reinterpret_cast<const uint8_t*>(body), stored_size, m_offset + BLOCK_HEADER_SIZE))
+    {
+        return false;
+    }
+
+    m_offset += BLOCK_HEADER_SIZE + stored_size;
+    ++m_blocks;
+    m_block_values = 0;
+    m_offsets.clear();
+    m_data.clear();
+    return true;
+}
+
+bool
+column_writer :: write_header()
+{
+    uint8_t header[HEADER_SIZE];
+    memmove(header, COLUMN_MAGIC, sizeof(COLUMN_MAGIC));
+    uint8_t* ptr = header + sizeof(COLUMN_MAGIC);
+    ptr = e::pack16le(static_cast<uint16_t>(m_type), ptr);
+    ptr = e::pack16le(static_cast<uint16_t>(m_compress ? FLAG_COMPRESSED : 0), ptr);
+    ptr = e::pack32le(uint32_t(0), ptr);
+    ptr = e::pack64le(m_values, ptr);
+    ptr = e::pack64le(m_blocks, ptr);
+    return pwrite_fully(m_fd.get(), header, HEADER_SIZE, 0);
+}
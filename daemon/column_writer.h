@@ -0,0 +1,104 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_column_writer_h_
+#define hyperdex_daemon_column_writer_h_
+
+// STL
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/io/fd.h>
+
+// e
+#include <e/slice.h>
+
+// HyperDex
+#include "hyperdex.h"
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Writes one attribute of an export as a column file.  The file starts with
+// a fixed header (magic "HDXCOL\0\1", then little-endian uint16 datatype,
+// uint16 flags, uint32 reserved, uint64 values, uint64 blocks) and holds the
+// values in blocks.  Each block is a little-endian header of uint32 values,
+// uint32 raw size, uint32 stored size and uint32 reserved, and then its
+// data.  The data of int64, float and timestamp columns is eight bytes per
+// value; that of any other column is values + 1 uint32 offsets into the
+// bytes that follow them.  A block whose stored size differs from its raw
+// size is compressed as a whole; a file written without compression may be
+// mapped and read in place.
+class column_writer
+{
+    public:
+        static const size_t HEADER_SIZE = 32;
+        static const size_t BLOCK_HEADER_SIZE = 16;
+        static const uint16_t FLAG_COMPRESSED = 1;
+
+    public:
+        column_writer(hyperdatatype type, bool compress);
+        ~column_writer() throw ();
+
+    public:
+        bool open(const std::string& path);
+        bool append(const e::slice& value);
+        // write the last block and the final header; the file is incomplete
+        // until this succeeds
+        bool close();
+        uint64_t values() const { return m_values; }
+        // bytes written to the file so far
+        uint64_t bytes() const { return m_offset; }
+
+    private:
+        bool fixed() const;
+        bool flush();
+        bool write_header();
+
+    private:
+        const hyperdatatype m_type;
+        const bool m_compress;
+        po6::io::fd m_fd;
+        uint64_t m_offset;
+        uint64_t m_values;
+        uint64_t m_blocks;
+        // the block being filled
+        uint32_t m_block_values;
+        std::vector<uint32_t> m_offsets;
+        std::vector<char> m_data;
+        std::vector<char> m_scratch;
+
+    private:
+        column_writer(const column_writer&);
+        column_writer& operator = (const column_writer&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_column_writer_h_
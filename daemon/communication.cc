@@ -31,22 +31,49 @@
 #include "config.h"
 #endif
 
+// C
+#include <stdlib.h>
+
+// POSIX
+#include <signal.h>
+
+// STL
+#include <algorithm>
+
 // Google Log
 #include <glog/logging.h>
 
+// po6
+#include <po6/time.h>
+
 // HyperDex
+#include "common/serialization.h"
 #include "daemon/communication.h"
 #include "daemon/daemon.h"
+#include "daemon/memory_accounting.h"
+#include "daemon/thread_stripe.h"
 
+using po6::threads::make_obj_func;
 using hyperdex::communication;
+using hyperdex::memory_accounting;
 using hyperdex::reconfigure_returncode;
 
+// the most bytes one CHAIN_OP_BATCH or CHAIN_ACK_BATCH carries; a batch this
+// large goes out without waiting for the rest of its window
+#define CHAIN_BATCH_MAX_BYTES (64ULL * 1024ULL)
+// ops at least this large are sent in their own message: coalescing would
+// copy them twice more just to save a send whose cost the copy already dwarfs
+#define CHAIN_BATCH_DIRECT_BYTES (16ULL * 1024ULL)
+// the most messages, and bytes of them, held for a configuration that has yet
+// to arrive; past either, clients are told to retry and daemons retransmit
+#define EARLY_MESSAGES_MAX_COUNT 65536ULL
+#define EARLY_MESSAGES_MAX_BYTES (256ULL * 1024ULL * 1024ULL)
+
 //////////////////////////////// Early Messages ////////////////////////////////
 
 class communication::early_message
 {
     public:
-        early_message();
         early_message(uint64_t version, uint64_t id,
                       std::auto_ptr<e::buffer> m);
         ~early_message() throw ();
@@ -55,14 +82,12 @@ class communication::early_message
         uint64_t config_version;
         uint64_t id;
         std::auto_ptr<e::buffer> msg;
-};
+        uint64_t held_at;
 
-communication :: early_message :: early_message()
-    : config_version(0)
-    , id()
-    , msg()
-{
-}
+    private:
+        early_message(const early_message&);
+        early_message& operator = (const early_message&);
+};
 
 communication :: early_message :: early_message(uint64_t v,
                                                 uint64_t i,
@@ -70,6 +95,7 @@ communication :: early_message :: early_message(uint64_t v,
     : config_version(v)
     , id(i)
     , msg(m)
+    , held_at(po6::monotonic_time())
 {
 }
 
@@ -77,26 +103,183 @@ communication :: early_message :: ~early_message() throw ()
 {
 }
 
+///////////////////////////////// Chain Batches ////////////////////////////////
+
+// the bodies of CHAIN_OP or CHAIN_ACK messages waiting to go along one chain
+// link, laid end to end in one string so that batching a message costs no
+// allocation of its own
+class communication::chain_batch
+{
+    public:
+        chain_batch();
+        ~chain_batch() throw ();
+
+    public:
+        void swap(chain_batch* other);
+        bool empty() const { return ends.empty(); }
+        size_t size() const { return ends.size(); }
+        void append(const uint8_t* body, size_t body_sz);
+        e::slice op(size_t i) const;
+
+    public:
+        network_msgtype type;
+        virtual_server_id from;
+        virtual_server_id to;
+        uint64_t version;
+        uint64_t deadline;
+        size_t bytes;
+        std::string ops;
+        // ops[ends[i - 1], ends[i]) is the i-th message body
+        std::vector<size_t> ends;
+};
+
+communication :: chain_batch :: chain_batch()
+    : type(PACKET_NOP)
+    , from()
+    , to()
+    , version(0)
+    , deadline(0)
+    , bytes(0)
+    , ops()
+    , ends()
+{
+}
+
+communication :: chain_batch :: ~chain_batch() throw ()
+{
+}
+
+void
+communication :: chain_batch :: swap(chain_batch* other)
+{
+    std::swap(type, other->type);
+    std::swap(from, other->from);
+    std::swap(to, other->to);
+    std::swap(version, other->version);
+    std::swap(deadline, other->deadline);
+    std::swap(bytes, other->bytes);
+    ops.swap(other->ops);
+    ends.swap(other->ends);
+}
+
+void
+communication :: chain_batch :: append(const uint8_t* body, size_t body_sz)
+{
+    ops.append(reinterpret_cast<const char*>(body), body_sz);
+    ends.push_back(ops.size());
+    bytes += body_sz;
+}
+
+e::slice
+communication :: chain_batch :: op(size_t i) const
+{
+    assert(i < ends.size());
+    const size_t start = i > 0 ? ends[i - 1] : 0;
+    return e::slice(ops.data() + start, ends[i] - start);
+}
+
 ///////////////////////////////// Public Class /////////////////////////////////
 
 communication :: communication(daemon* d)
     : m_daemon(d)
     , m_busybee_mapper(&m_daemon->m_config)
     , m_busybee()
+    , m_threads(1)
+    , m_early_mtx()
     , m_early_messages()
+    , m_early_ready()
+    , m_early_ready_sz(0)
+    , m_early_queued(0)
+    , m_early_bytes(0)
+    , m_early_held()
+    , m_early_delivered()
+    , m_early_refused()
+    , m_early_wait()
+    , m_chain_batch_window(0)
+    , m_chain_ack_window(0)
+    , m_peer_lease_timeout(0)
+    , m_peer_leases()
+    , m_chain_batches_mtx()
+    , m_chain_batches()
+    , m_chain_batches_stop(false)
+    , m_chain_batches_ready()
+    , m_chain_batch_flusher(make_obj_func(&communication::flush_chain_batches, this))
+    , m_chain_batch_flusher_started(false)
+    , m_chain_batches_sent()
+    , m_chain_batched_ops()
+    , m_chain_ack_batches_sent()
+    , m_chain_batched_acks()
 {
 }
 
 communication :: ~communication() throw ()
 {
+    for (early_message_map_t::iterator it = m_early_messages.begin();
+            it != m_early_messages.end(); ++it)
+    {
+        for (size_t i = 0; i < it->second.size(); ++i)
+        {
+            delete it->second[i];
+        }
+    }
+
+    for (size_t i = 0; i < m_early_ready.size(); ++i)
+    {
+        delete m_early_ready[i];
+    }
+}
+
+void
+communication :: unpause()
+{
+    m_busybee->unpause();
+
+    // messages released while paused wait for a thread to look for them
+    if (e::atomic::load_64_nobarrier(&m_early_ready_sz) > 0)
+    {
+        m_busybee->wake_one();
+    }
+}
+
+void
+communication :: shutdown()
+{
+    if (m_chain_batch_flusher_started)
+    {
+        {
+            po6::threads::mutex::hold hold(&m_chain_batches_mtx);
+            m_chain_batches_stop = true;
+            m_chain_batches_ready.set();
+        }
+
+        m_chain_batch_flusher.join();
+        m_chain_batch_flusher_started = false;
+    }
+
+    m_busybee->shutdown();
 }
 
 bool
 communication :: setup(const po6::net::location& bind_to,
-                       unsigned threads)
+                       unsigned threads,
+                       uint64_t chain_batch_window,
+                       uint64_t chain_ack_window,
+                       uint64_t peer_lease)
 {
     m_busybee.reset(new busybee_mta(&m_daemon->m_gc, &m_busybee_mapper, bind_to, m_daemon->m_us.get(), threads));
     m_busybee->set_ignore_signals();
+    m_threads = std::max(threads, 1U);
+    m_chain_batch_window = chain_batch_window;
+    m_chain_ack_window = chain_ack_window;
+    m_peer_lease_timeout = peer_lease;
+    m_peer_leases.reset(po6::monotonic_time());
+
+    if (m_chain_batch_window > 0 || m_chain_ack_window > 0)
+    {
+        m_chain_batch_flusher.start();
+        m_chain_batch_flusher_started = true;
+    }
+
     return true;
 }
 
@@ -110,25 +293,9 @@ communication :: reconfigure(const configuration&,
                              const configuration& new_config,
                              const server_id&)
 {
-    e::lockfree_fifo<early_message> ems;
-    early_message em;
-
-    while (m_early_messages.pop(&em))
-    {
-        if (em.config_version <= new_config.version())
-        {
-            m_busybee->deliver(em.id, em.msg);
-        }
-        else
-        {
-            ems.push(em);
-        }
-    }
-
-    while (ems.pop(&em))
-    {
-        m_early_messages.push(em);
-    }
+    // a peer new to our chains has never had reason to talk to us
+    m_peer_leases.reset(po6::monotonic_time());
+    deliver_early_messages(new_config.version());
 }
 
 bool
@@ -139,7 +306,7 @@ communication :: send_client(const virtual_server_id& from,
 {
     assert(msg->size() >= HYPERDEX_HEADER_SIZE_VC);
 
-    if (m_daemon->m_us != m_daemon->m_config.get_server_id(from) &&
+    if (m_daemon->m_us != m_daemon->config().get_server_id(from) &&
         from != virtual_server_id(UINT64_MAX))
     {
         return false;
@@ -190,7 +357,7 @@ communication :: send(const virtual_server_id& from,
 {
     assert(msg->size() >= HYPERDEX_HEADER_SIZE_VV);
 
-    if (m_daemon->m_us != m_daemon->m_config.get_server_id(from))
+    if (m_daemon->m_us != m_daemon->config().get_server_id(from))
     {
         return false;
     }
@@ -198,7 +365,7 @@ communication :: send(const virtual_server_id& from,
     uint8_t mt = static_cast<uint8_t>(msg_type);
     uint8_t flags = 1;
     virtual_server_id vto(UINT64_MAX);
-    msg->pack_at(BUSYBEE_HEADER_SIZE) << mt << flags << m_daemon->m_config.version() << vto.get() << from.get();
+    msg->pack_at(BUSYBEE_HEADER_SIZE) << mt << flags << m_daemon->config().version() << vto.get() << from.get();
 
     if (to == server_id())
     {
@@ -247,15 +414,15 @@ communication :: send(const virtual_server_id& from,
 {
     assert(msg->size() >= HYPERDEX_HEADER_SIZE_VV);
 
-    if (m_daemon->m_us != m_daemon->m_config.get_server_id(from))
+    if (m_daemon->m_us != m_daemon->config().get_server_id(from))
     {
         return false;
     }
 
     uint8_t mt = static_cast<uint8_t>(msg_type);
     uint8_t flags = 1;
-    msg->pack_at(BUSYBEE_HEADER_SIZE) << mt << flags << m_daemon->m_config.version() << vto.get() << from.get();
-    server_id to = m_daemon->m_config.get_server_id(vto);
+    msg->pack_at(BUSYBEE_HEADER_SIZE) << mt << flags << m_daemon->config().version() << vto.get() << from.get();
+    server_id to = m_daemon->config().get_server_id(vto);
 
     if (to == server_id())
     {
@@ -305,8 +472,8 @@ communication :: send(const virtual_server_id& vto,
 
     uint8_t mt = static_cast<uint8_t>(msg_type);
     uint8_t flags = 0;
-    msg->pack_at(BUSYBEE_HEADER_SIZE) << mt << flags << m_daemon->m_config.version() << vto.get();
-    server_id to = m_daemon->m_config.get_server_id(vto);
+    msg->pack_at(BUSYBEE_HEADER_SIZE) << mt << flags << m_daemon->config().version() << vto.get();
+    server_id to = m_daemon->config().get_server_id(vto);
 
     if (to == server_id())
     {
@@ -352,18 +519,44 @@ communication :: send_exact(const virtual_server_id& from,
                             const virtual_server_id& vto,
                             network_msgtype msg_type,
                             std::auto_ptr<e::buffer> msg)
+{
+    return send_exact(m_daemon->config().version(), from, vto, msg_type, msg);
+}
+
+bool
+communication :: send_chain_op(const virtual_server_id& from,
+                               const virtual_server_id& vto,
+                               std::auto_ptr<e::buffer> msg)
+{
+    return send_batched(from, vto, CHAIN_OP, m_chain_batch_window, msg);
+}
+
+bool
+communication :: send_chain_ack(const virtual_server_id& from,
+                                const virtual_server_id& vto,
+                                std::auto_ptr<e::buffer> msg)
+{
+    return send_batched(from, vto, CHAIN_ACK, m_chain_ack_window, msg);
+}
+
+bool
+communication :: send_exact(uint64_t version,
+                            const virtual_server_id& from,
+                            const virtual_server_id& vto,
+                            network_msgtype msg_type,
+                            std::auto_ptr<e::buffer> msg)
 {
     assert(msg->size() >= HYPERDEX_HEADER_SIZE_VV);
 
-    if (m_daemon->m_us != m_daemon->m_config.get_server_id(from))
+    if (m_daemon->m_us != m_daemon->config().get_server_id(from))
     {
         return false;
     }
 
     uint8_t mt = static_cast<uint8_t>(msg_type);
     uint8_t flags = 1 | 2;
-    msg->pack_at(BUSYBEE_HEADER_SIZE) << mt << flags << m_daemon->m_config.version() << vto.get() << from.get();
-    server_id to = m_daemon->m_config.get_server_id(vto);
+    msg->pack_at(BUSYBEE_HEADER_SIZE) << mt << flags << version << vto.get() << from.get();
+    server_id to = m_daemon->config().get_server_id(vto);
 
     if (to == server_id())
     {
@@ -411,7 +604,8 @@ communication :: recv(e::garbage_collector::thread_state* ts,
                       virtual_server_id* vto,
                       network_msgtype* msg_type,
                       std::auto_ptr<e::buffer>* msg,
-                      e::unpacker* up)
+                      e::unpacker* up,
+                      uint64_t* deadline)
 {
     // Read messages from the network until we get one that meets the following
     // constraints:
@@ -422,7 +616,13 @@ communication :: recv(e::garbage_collector::thread_state* ts,
     while (true)
     {
         uint64_t id;
-        busybee_returncode rc = m_busybee->recv(ts, &id, msg);
+        busybee_returncode rc = BUSYBEE_SUCCESS;
+
+        // messages held for a config that has now arrived go first
+        if (!take_early_message(&id, msg))
+        {
+            rc = m_busybee->recv(ts, &id, msg);
+        }
 
         switch (rc)
         {
@@ -465,35 +665,88 @@ communication :: recv(e::garbage_collector::thread_state* ts,
             *vfrom = virtual_server_id();
         }
 
+        *deadline = 0;
+
+        if ((flags & 0x4))
+        {
+            uint32_t budget;
+            *up = *up >> budget;
+
+            if (budget > 0)
+            {
+                *deadline = po6::monotonic_time() + budget * 1000000ULL;
+            }
+        }
+
         if (up->error())
         {
             LOG(WARNING) << "dropping message that has a malformed header; here's some hex: " << (*msg)->hex();
             continue;
         }
 
+        // only servers send chain messages, so clients never renew a lease
+        if (m_peer_lease_timeout > 0 &&
+            (*msg_type == CHAIN_OP || *msg_type == CHAIN_OP_BATCH ||
+             *msg_type == CHAIN_SUBSPACE || *msg_type == CHAIN_ACK ||
+             *msg_type == CHAIN_ACK_BATCH))
+        {
+            m_peer_leases.heard(*from, po6::monotonic_time());
+        }
+
+        // the configuration may be swapped beneath us at any time; judge
+        // the whole message against one
+        const configuration& config(m_daemon->config());
         bool from_valid = true;
-        bool to_valid = m_daemon->m_us == m_daemon->m_config.get_server_id(*vto) ||
+        bool to_valid = m_daemon->m_us == config.get_server_id(*vto) ||
                         *vto == virtual_server_id(UINT64_MAX);
 
         // If this is a virtual-virtual message
         if ((flags & 0x1))
         {
-            from_valid = *from == m_daemon->m_config.get_server_id(virtual_server_id(vidf));
+            from_valid = *from == config.get_server_id(virtual_server_id(vidf));
         }
 
         // No matter what, wait for the config the sender saw
-        if (version > m_daemon->m_config.version())
+        if (version > config.version())
         {
-            early_message em(version, id, *msg);
-            m_early_messages.push(em);
+            if (hold_early_message(version, id, msg))
+            {
+                // the config may have been installed since we looked, in
+                // which case nobody else will deliver this message
+                const uint64_t now = m_daemon->config().version();
+
+                if (now >= version)
+                {
+                    deliver_early_messages(now);
+                }
+
+                continue;
+            }
+
+            // clients retry a CONFIGMISMATCH; daemons retransmit on their own
+            if (!(flags & 0x1))
+            {
+                mt = static_cast<uint8_t>(CONFIGMISMATCH);
+                (*msg)->pack_at(BUSYBEE_HEADER_SIZE) << mt;
+                m_busybee->send(id, *msg);
+            }
+
             continue;
         }
 
-        if ((flags & 0x2) && version < m_daemon->m_config.version())
+        if ((flags & 0x2) && version < config.version())
         {
             continue;
         }
 
+        // a region split off from one of ours takes nothing until its
+        // objects have moved over; clients retry and daemons retransmit
+        if (to_valid && *vto != virtual_server_id(UINT64_MAX) &&
+            m_daemon->m_data.region_is_filling(config.get_region_id(*vto)))
+        {
+            to_valid = false;
+        }
+
         if (from_valid && to_valid)
         {
 #ifdef HD_LOG_ALL_MESSAGES
@@ -512,11 +765,335 @@ communication :: recv(e::garbage_collector::thread_state* ts,
     }
 }
 
+bool
+communication :: send_batched(const virtual_server_id& from,
+                              const virtual_server_id& vto,
+                              network_msgtype msg_type,
+                              uint64_t window,
+                              std::auto_ptr<e::buffer> msg)
+{
+    assert(msg->size() >= HYPERDEX_HEADER_SIZE_VV);
+    server_id to = m_daemon->config().get_server_id(vto);
+
+    if (window == 0 || to == m_daemon->m_us)
+    {
+        return send_exact(from, vto, msg_type, msg);
+    }
+
+    if (m_daemon->m_us != m_daemon->config().get_server_id(from) ||
+        to == server_id())
+    {
+        return false;
+    }
+
+    const uint64_t version = m_daemon->config().version();
+    const bool direct = msg->size() - HYPERDEX_HEADER_SIZE_VV >= CHAIN_BATCH_DIRECT_BYTES;
+    chain_batch stale;
+    chain_batch full;
+
+    {
+        po6::threads::mutex::hold hold(&m_chain_batches_mtx);
+        chain_batch_key_t k(static_cast<uint8_t>(msg_type),
+                            std::make_pair(from.get(), vto.get()));
+        chain_batch& b(m_chain_batches[k]);
+
+        // messages made under an older config carry that config's version
+        if (!b.empty() && b.version != version)
+        {
+            stale.swap(&b);
+        }
+
+        if (direct)
+        {
+            // what is already waiting goes first so the link keeps its order
+            full.swap(&b);
+        }
+        else
+        {
+            if (b.empty())
+            {
+                b.type = msg_type;
+                b.from = from;
+                b.to = vto;
+                b.version = version;
+                b.deadline = po6::monotonic_time() + window;
+                b.bytes = 0;
+                // the flusher may be asleep until a later deadline, or
+                // until there is any batch at all
+                m_chain_batches_ready.set();
+            }
+
+            b.append(msg->data() + HYPERDEX_HEADER_SIZE_VV,
+                     msg->size() - HYPERDEX_HEADER_SIZE_VV);
+
+            if (b.bytes >= CHAIN_BATCH_MAX_BYTES)
+            {
+                full.swap(&b);
+            }
+        }
+    }
+
+    if (!stale.empty())
+    {
+        send_chain_batch(stale);
+    }
+
+    if (direct)
+    {
+        if (!full.empty())
+        {
+            send_chain_batch(full);
+        }
+
+        return send_exact(version, from, vto, msg_type, msg);
+    }
+
+    if (!full.empty())
+    {
+        return send_chain_batch(full);
+    }
+
+    return true;
+}
+
+bool
+communication :: send_chain_batch(const chain_batch& batch)
+{
+    size_t sz = HYPERDEX_HEADER_SIZE_VV
+              + sizeof(uint32_t);
+
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        sz += pack_size(batch.op(i));
+    }
+
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VV);
+    pa = pa << static_cast<uint32_t>(batch.size());
+
+    for (size_t i = 0; i < batch.size(); ++i)
+    {
+        pa = pa << batch.op(i);
+    }
+
+    network_msgtype type = CHAIN_OP_BATCH;
+
+    if (batch.type == CHAIN_OP)
+    {
+        m_chain_batches_sent.tap();
+        m_chain_batched_ops.add(batch.size());
+    }
+    else if (batch.type == CHAIN_ACK)
+    {
+        type = CHAIN_ACK_BATCH;
+        m_chain_ack_batches_sent.tap();
+        m_chain_batched_acks.add(batch.size());
+    }
+    else
+    {
+        abort();
+    }
+
+    // receivers drop a batch from an older config just as they would drop
+    // each of its messages, and retransmission after the reconfiguration
+    // covers it
+    return send_exact(batch.version, batch.from, batch.to, type, msg);
+}
+
+void
+communication :: flush_chain_batches()
+{
+    sigset_t ss;
+
+    // leave SIGPROF so that a profile sees this thread too
+    if (sigfillset(&ss) < 0 ||
+        sigdelset(&ss, SIGPROF) < 0 ||
+        pthread_sigmask(SIG_BLOCK, &ss, NULL) < 0)
+    {
+        PLOG(ERROR) << "could not block signals";
+        LOG(ERROR) << "could not successfully block signals; this could result in undefined behavior";
+    }
+
+    m_daemon->m_placement.place_background_thread("chain-batch");
+    std::vector<chain_batch> ready;
+    // sending reads the configuration, which reconfiguration reclaims
+    // through the garbage collector
+    e::garbage_collector::thread_state gc_ts;
+    m_daemon->m_gc.register_thread(&gc_ts);
+
+    while (true)
+    {
+        m_daemon->m_gc.quiescent_state(&gc_ts);
+        uint64_t now = po6::monotonic_time();
+        uint64_t deadline = UINT64_MAX;
+
+        {
+            po6::threads::mutex::hold hold(&m_chain_batches_mtx);
+
+            if (m_chain_batches_stop)
+            {
+                break;
+            }
+
+            chain_batch_map_t::iterator it = m_chain_batches.begin();
+
+            while (it != m_chain_batches.end())
+            {
+                if (it->second.empty())
+                {
+                    m_chain_batches.erase(it++);
+                }
+                else if (it->second.deadline <= now)
+                {
+                    ready.push_back(chain_batch());
+                    ready.back().swap(&it->second);
+                    m_chain_batches.erase(it++);
+                }
+                else
+                {
+                    deadline = std::min(deadline, it->second.deadline);
+                    ++it;
+                }
+            }
+
+            // a batch started from here on sets it again
+            m_chain_batches_ready.reset();
+        }
+
+        for (size_t i = 0; i < ready.size(); ++i)
+        {
+            send_chain_batch(ready[i]);
+        }
+
+        ready.clear();
+        m_daemon->m_gc.offline(&gc_ts);
+        m_chain_batches_ready.wait(deadline);
+        m_daemon->m_gc.online(&gc_ts);
+    }
+
+    m_daemon->m_gc.deregister_thread(&gc_ts);
+}
+
+void
+communication :: early_message_stats(uint64_t* queued, uint64_t* bytes,
+                                     uint64_t* held, uint64_t* delivered,
+                                     uint64_t* refused)
+{
+    {
+        po6::threads::mutex::hold hold(&m_early_mtx);
+        *queued = m_early_queued;
+        *bytes = m_early_bytes;
+    }
+
+    *held = m_early_held.read();
+    *delivered = m_early_delivered.read();
+    *refused = m_early_refused.read();
+}
+
+bool
+communication :: hold_early_message(uint64_t version, uint64_t id,
+                                    std::auto_ptr<e::buffer>* msg)
+{
+    const uint64_t sz = (*msg)->capacity();
+    po6::threads::mutex::hold hold(&m_early_mtx);
+
+    if (m_early_queued >= EARLY_MESSAGES_MAX_COUNT ||
+        m_early_bytes + sz > EARLY_MESSAGES_MAX_BYTES)
+    {
+        m_early_refused.tap();
+        return false;
+    }
+
+    m_early_messages[version].push_back(new early_message(version, id, *msg));
+    ++m_early_queued;
+    m_early_bytes += sz;
+    memory_accounting::charge(memory_accounting::EARLY_MESSAGES, sz);
+    m_early_held.tap();
+    return true;
+}
+
+bool
+communication :: take_early_message(uint64_t* id, std::auto_ptr<e::buffer>* msg)
+{
+    if (e::atomic::load_64_nobarrier(&m_early_ready_sz) == 0)
+    {
+        return false;
+    }
+
+    std::auto_ptr<early_message> em;
+    bool more = false;
+
+    {
+        po6::threads::mutex::hold hold(&m_early_mtx);
+
+        if (m_early_ready.empty())
+        {
+            return false;
+        }
+
+        em.reset(m_early_ready.front());
+        m_early_ready.pop_front();
+        e::atomic::store_64_nobarrier(&m_early_ready_sz, m_early_ready.size());
+        more = !m_early_ready.empty();
+        const uint64_t sz = em->msg->capacity();
+        --m_early_queued;
+        m_early_bytes -= sz;
+        memory_accounting::release(memory_accounting::EARLY_MESSAGES, sz);
+    }
+
+    // draw the next thread in, so that every network thread shares the work
+    if (more)
+    {
+        m_busybee->wake_one();
+    }
+
+    m_early_wait.record(thread_stripe(), po6::monotonic_time() - em->held_at);
+    m_early_delivered.tap();
+    *id = em->id;
+    *msg = em->msg;
+    return true;
+}
+
+void
+communication :: deliver_early_messages(uint64_t version)
+{
+    size_t released = 0;
+
+    {
+        po6::threads::mutex::hold hold(&m_early_mtx);
+
+        while (!m_early_messages.empty() &&
+               m_early_messages.begin()->first <= version)
+        {
+            std::vector<early_message*>& ems(m_early_messages.begin()->second);
+            m_early_ready.insert(m_early_ready.end(), ems.begin(), ems.end());
+            released += ems.size();
+            m_early_messages.erase(m_early_messages.begin());
+        }
+
+        e::atomic::store_64_nobarrier(&m_early_ready_sz, m_early_ready.size());
+    }
+
+    // each thread woken wakes another while messages remain
+    if (released > 0)
+    {
+        m_busybee->wake_one();
+    }
+}
+
+bool
+communication :: peer_silent(const server_id& peer, uint64_t since, uint64_t now) const
+{
+    return m_peer_lease_timeout > 0 &&
+           since < now && now - since > m_peer_lease_timeout &&
+           m_peer_leases.expired(peer, now, m_peer_lease_timeout);
+}
+
 void
 communication :: handle_disruption(uint64_t id)
 {
-    if (m_daemon->m_config.get_address(server_id(id)) != po6::net::location())
+    if (m_daemon->config().get_address(server_id(id)) != po6::net::location())
     {
-        m_daemon->m_coord->report_tcp_disconnect(m_daemon->m_config.version(), server_id(id));
+        m_daemon->m_coord->report_tcp_disconnect(m_daemon->config().version(), server_id(id));
     }
 }
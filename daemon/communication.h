@@ -29,7 +29,15 @@
 #define hyperdex_daemon_communication_h_
 
 // STL
+#include <deque>
+#include <map>
 #include <memory>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/threads/mutex.h>
+#include <po6/threads/thread.h>
 
 // BusyBee
 #include <busybee_constants.h>
@@ -37,13 +45,16 @@
 
 // e
 #include <e/buffer.h>
-#include <e/lockfree_fifo.h>
 
 // HyperDex
 #include "namespace.h"
 #include "common/ids.h"
 #include "common/mapper.h"
 #include "common/network_msgtype.h"
+#include "daemon/deadline_event.h"
+#include "daemon/latency_histogram.h"
+#include "daemon/peer_lease.h"
+#include "daemon/performance_counter.h"
 #include "daemon/reconfigure_returncode.h"
 
 #define HYPERDEX_HEADER_SIZE_VC (BUSYBEE_HEADER_SIZE \
@@ -73,13 +84,21 @@ class communication
 
     public:
         void pause() { m_busybee->pause(); }
-        void unpause() { m_busybee->unpause(); }
-        void shutdown() { m_busybee->shutdown(); }
+        void unpause();
+        void shutdown();
         void wake_one() { m_busybee->wake_one(); }
 
     public:
+        // chain_batch_window and chain_ack_window are how long, in
+        // nanoseconds, a CHAIN_OP or CHAIN_ACK may wait for others headed
+        // along the same chain link; 0 sends each one on its own.
+        // peer_lease is how long, in nanoseconds, a chain peer may go
+        // unheard from before it is presumed failed; 0 disables leases.
         bool setup(const po6::net::location& bind_to,
-                   unsigned threads);
+                   unsigned threads,
+                   uint64_t chain_batch_window,
+                   uint64_t chain_ack_window,
+                   uint64_t peer_lease);
         void teardown();
         void reconfigure(const configuration& old_config,
                          const configuration& new_config,
@@ -106,19 +125,79 @@ class communication
                         const virtual_server_id& to,
                         network_msgtype msg_type,
                         std::auto_ptr<e::buffer> msg);
+        // Send a CHAIN_OP with the semantics of send_exact.  Within the batch
+        // window, ops for the same (from, to) pair are coalesced into a single
+        // CHAIN_OP_BATCH that the receiver unpacks in order.  Large ops skip
+        // the batch (after flushing it) to avoid copying their values again.
+        bool send_chain_op(const virtual_server_id& from,
+                           const virtual_server_id& to,
+                           std::auto_ptr<e::buffer> msg);
+        // Send a CHAIN_ACK with the semantics of send_exact.  Within the ack
+        // window, acks for the same (from, to) pair are delayed and sent as
+        // one cumulative CHAIN_ACK_BATCH, much like TCP's delayed acks.
+        bool send_chain_ack(const virtual_server_id& from,
+                            const virtual_server_id& to,
+                            std::auto_ptr<e::buffer> msg);
+        // A client may say how many milliseconds its operation has left;
+        // "deadline" is then the monotonic time at which this server may
+        // give up on it, and 0 otherwise.
         bool recv(e::garbage_collector::thread_state* ts,
                   server_id* from,
                   virtual_server_id* vfrom,
                   virtual_server_id* vto,
                   network_msgtype* msg_type,
                   std::auto_ptr<e::buffer>* msg,
-                  e::unpacker* up);
+                  e::unpacker* up,
+                  uint64_t* deadline);
+        // has the chain peer let its lease run out while owing us a reply to
+        // a message sent at "since"?  Always false when leases are disabled
+        bool peer_silent(const server_id& peer, uint64_t since, uint64_t now) const;
+        // number of CHAIN_OP_BATCH messages sent, and the ops they carried
+        uint64_t chain_batches() const { return m_chain_batches_sent.read(); }
+        uint64_t chain_batched_ops() const { return m_chain_batched_ops.read(); }
+        // number of CHAIN_ACK_BATCH messages sent, and the acks they carried
+        uint64_t chain_ack_batches() const { return m_chain_ack_batches_sent.read(); }
+        uint64_t chain_batched_acks() const { return m_chain_batched_acks.read(); }
+        // messages held for a newer configuration:  those held now and their
+        // bytes, and the totals held, delivered, and refused for lack of room
+        void early_message_stats(uint64_t* queued, uint64_t* bytes,
+                                 uint64_t* held, uint64_t* delivered,
+                                 uint64_t* refused);
+        // how long, in nanoseconds, held messages waited for their config
+        latency_histogram* early_message_wait() { return &m_early_wait; }
 
     private:
         class early_message;
+        class chain_batch;
+        // (message type, (virt from, virt to))
+        typedef std::pair<uint8_t, std::pair<uint64_t, uint64_t> > chain_batch_key_t;
+        typedef std::map<chain_batch_key_t, chain_batch> chain_batch_map_t;
+        // held messages by the config version they wait for, in arrival order
+        typedef std::map<uint64_t, std::vector<early_message*> > early_message_map_t;
 
     private:
         void handle_disruption(uint64_t id);
+        // hold a message until the config it was sent under arrives; false
+        // when the queue is full
+        bool hold_early_message(uint64_t version, uint64_t id,
+                                std::auto_ptr<e::buffer>* msg);
+        // a held message whose config has arrived, if there is one
+        bool take_early_message(uint64_t* id, std::auto_ptr<e::buffer>* msg);
+        // release buffered messages sent under "version" or earlier to the
+        // network threads
+        void deliver_early_messages(uint64_t version);
+        bool send_exact(uint64_t version,
+                        const virtual_server_id& from,
+                        const virtual_server_id& to,
+                        network_msgtype msg_type,
+                        std::auto_ptr<e::buffer> msg);
+        bool send_batched(const virtual_server_id& from,
+                          const virtual_server_id& to,
+                          network_msgtype msg_type,
+                          uint64_t window,
+                          std::auto_ptr<e::buffer> msg);
+        bool send_chain_batch(const chain_batch& batch);
+        void flush_chain_batches();
 
     private:
         communication(const communication&);
@@ -128,7 +207,32 @@ class communication
         daemon* m_daemon;
         mapper m_busybee_mapper;
         std::auto_ptr<busybee_mta> m_busybee;
-        e::lockfree_fifo<early_message> m_early_messages;
+        unsigned m_threads;
+        po6::threads::mutex m_early_mtx;
+        early_message_map_t m_early_messages; // under m_early_mtx
+        std::deque<early_message*> m_early_ready; // under m_early_mtx
+        uint64_t m_early_ready_sz; // read without the lock as a hint
+        uint64_t m_early_queued; // under m_early_mtx; both maps
+        uint64_t m_early_bytes; // under m_early_mtx; both maps
+        performance_counter m_early_held;
+        performance_counter m_early_delivered;
+        performance_counter m_early_refused;
+        latency_histogram m_early_wait;
+        uint64_t m_chain_batch_window;
+        uint64_t m_chain_ack_window;
+        uint64_t m_peer_lease_timeout;
+        peer_lease m_peer_leases;
+        po6::threads::mutex m_chain_batches_mtx;
+        chain_batch_map_t m_chain_batches;
+        bool m_chain_batches_stop;
+        // set under m_chain_batches_mtx when a batch starts or on shutdown
+        deadline_event m_chain_batches_ready;
+        po6::threads::thread m_chain_batch_flusher;
+        bool m_chain_batch_flusher_started;
+        performance_counter m_chain_batches_sent;
+        performance_counter m_chain_batched_ops;
+        performance_counter m_chain_ack_batches_sent;
+        performance_counter m_chain_batched_acks;
 };
 
 END_HYPERDEX_NAMESPACE
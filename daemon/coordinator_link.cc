@@ -29,6 +29,7 @@
 #include <signal.h>
 
 // STL
+#include <algorithm>
 #include <string>
 
 // Google Log
@@ -99,6 +100,14 @@ coordinator_link :: coordinator_link(daemon* d, const char* host, uint16_t port)
     , m_mtx()
     , m_repl(replicant_client_create(host, port))
     , m_rpcs()
+    , m_go_live()
+    , m_go_live_id(-1)
+    , m_complete()
+    , m_complete_id(-1)
+    , m_disconnect_version(0)
+    , m_disconnects()
+    , m_disconnects_reported()
+    , m_disconnect_id(-1)
 {
     if (!m_repl)
     {
@@ -111,10 +120,18 @@ coordinator_link :: ~coordinator_link() throw ()
 }
 
 bool
-coordinator_link :: register_server(server_id us, const po6::net::location& bind_to)
+coordinator_link :: register_server(server_id us, const po6::net::location& bind_to,
+                                    const std::string& zone)
 {
     std::string register_msg;
-    e::packer(&register_msg) << us << bind_to;
+    e::packer pa(&register_msg);
+    pa = pa << us << bind_to;
+
+    if (!zone.empty())
+    {
+        pa = pa << e::slice(zone);
+    }
+
     char* output = NULL;
     size_t output_sz = 0;
     std::ostringstream ostr;
@@ -161,6 +178,44 @@ coordinator_link :: register_server(server_id us, const po6::net::location& bind
     }
 }
 
+bool
+coordinator_link :: report_lost_regions(const std::vector<region_id>& rids)
+{
+    std::string msg;
+    e::packer(&msg) << m_daemon->m_us << rids;
+    char* output = NULL;
+    size_t output_sz = 0;
+
+    if (!synchronous_call("report the regions lost in a restart", "regions_lost",
+                          msg.data(), msg.size(), &output, &output_sz))
+    {
+        return false;
+    }
+
+    assert(output);
+    e::guard g_output = e::makeguard(free, output);
+
+    if (output_sz < 2)
+    {
+        LOG(ERROR) << "could not report the regions lost in a restart: "
+                   << "coordinator returned invalid message";
+        return false;
+    }
+
+    uint16_t x;
+    e::unpack16be(output, &x);
+    coordinator_returncode rc = static_cast<coordinator_returncode>(x);
+
+    if (rc != COORD_SUCCESS)
+    {
+        LOG(ERROR) << "could not report the regions lost in a restart: "
+                   << "coordinator returned " << rc;
+        return false;
+    }
+
+    return true;
+}
+
 bool
 coordinator_link :: initialize()
 {
@@ -355,6 +410,7 @@ coordinator_link :: maintain()
 
             e::compat::shared_ptr<rpc> r = rit->second;
             m_rpcs.erase(rit);
+            int64_t retry_id = -1;
 
             if (r->status != REPLICANT_SUCCESS)
             {
@@ -365,9 +421,27 @@ coordinator_link :: maintain()
                 if ((r->flags & REPLICANT_CALL_IDEMPOTENT))
                 {
                     LOG(ERROR) << "retrying call to coordinator method \"" << r->func << "\"";
-                    make_rpc_no_synchro(r);
+                    retry_id = make_rpc_no_synchro(r);
                 }
             }
+
+            if (id == m_go_live_id)
+            {
+                m_go_live_id = retry_id;
+                flush_transfers_no_synchro("transfer_go_live", &m_go_live, &m_go_live_id);
+            }
+
+            if (id == m_complete_id)
+            {
+                m_complete_id = retry_id;
+                flush_transfers_no_synchro("transfer_complete", &m_complete, &m_complete_id);
+            }
+
+            if (id == m_disconnect_id)
+            {
+                m_disconnect_id = retry_id;
+                flush_disconnects_no_synchro();
+            }
         }
     }
 }
@@ -417,30 +491,66 @@ coordinator_link :: checkpoint_report_stable(uint64_t config_version)
 void
 coordinator_link :: transfer_go_live(const transfer_id& id)
 {
-    e::compat::shared_ptr<rpc> r(new rpc());
-    r->func = "transfer_go_live";
-    r->flags = REPLICANT_CALL_IDEMPOTENT;
-    e::packer(&r->input) << id;
-    make_rpc(r);
+    po6::threads::mutex::hold hold(&m_mtx);
+
+    if (std::find(m_go_live.begin(), m_go_live.end(), id) == m_go_live.end())
+    {
+        m_go_live.push_back(id);
+    }
+
+    flush_transfers_no_synchro("transfer_go_live", &m_go_live, &m_go_live_id);
 }
 
 void
 coordinator_link :: transfer_complete(const transfer_id& id)
 {
-    e::compat::shared_ptr<rpc> r(new rpc());
-    r->func = "transfer_complete";
-    r->flags = REPLICANT_CALL_IDEMPOTENT;
-    e::packer(&r->input) << id;
-    make_rpc(r);
+    po6::threads::mutex::hold hold(&m_mtx);
+
+    if (std::find(m_complete.begin(), m_complete.end(), id) == m_complete.end())
+    {
+        m_complete.push_back(id);
+    }
+
+    flush_transfers_no_synchro("transfer_complete", &m_complete, &m_complete_id);
 }
 
 void
 coordinator_link :: report_tcp_disconnect(uint64_t config_version, const server_id& id)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+
+    if (config_version < m_disconnect_version)
+    {
+        return;
+    }
+
+    // a newer configuration may already have dealt with the old reports
+    if (config_version > m_disconnect_version)
+    {
+        m_disconnect_version = config_version;
+        m_disconnects.clear();
+        m_disconnects_reported.clear();
+    }
+
+    if (std::find(m_disconnects_reported.begin(),
+                  m_disconnects_reported.end(), id) == m_disconnects_reported.end())
+    {
+        m_disconnects_reported.push_back(id);
+        m_disconnects.push_back(id);
+    }
+
+    flush_disconnects_no_synchro();
+}
+
+void
+coordinator_link :: report_load(const std::vector<region_id>& rids,
+                                const std::vector<uint64_t>& bytes,
+                                const std::vector<uint64_t>& ops)
 {
     e::compat::shared_ptr<rpc> r(new rpc());
-    r->func = "report_disconnect";
+    r->func = "report_load";
     r->flags = REPLICANT_CALL_IDEMPOTENT;
-    e::packer(&r->input) << config_version << id;
+    e::packer(&r->input) << m_daemon->m_us << rids << bytes << ops;
     make_rpc(r);
 }
 
@@ -451,7 +561,7 @@ coordinator_link :: make_rpc(e::compat::shared_ptr<rpc> r)
     make_rpc_no_synchro(r);
 }
 
-void
+int64_t
 coordinator_link :: make_rpc_no_synchro(e::compat::shared_ptr<rpc> r)
 {
     int64_t id = replicant_client_call(m_repl, "hyperdex", r->func.c_str(),
@@ -467,6 +577,55 @@ coordinator_link :: make_rpc_no_synchro(e::compat::shared_ptr<rpc> r)
     {
         m_rpcs.insert(std::make_pair(id, r));
     }
+
+    return id;
+}
+
+void
+coordinator_link :: flush_transfers_no_synchro(const char* func,
+                                               std::vector<transfer_id>* xids,
+                                               int64_t* id)
+{
+    if (*id >= 0 || xids->empty())
+    {
+        return;
+    }
+
+    e::compat::shared_ptr<rpc> r(new rpc());
+    r->func = func;
+    r->flags = REPLICANT_CALL_IDEMPOTENT;
+    e::packer pa(&r->input);
+
+    for (size_t i = 0; i < xids->size(); ++i)
+    {
+        pa = pa << (*xids)[i];
+    }
+
+    xids->clear();
+    *id = make_rpc_no_synchro(r);
+}
+
+void
+coordinator_link :: flush_disconnects_no_synchro()
+{
+    if (m_disconnect_id >= 0 || m_disconnects.empty())
+    {
+        return;
+    }
+
+    e::compat::shared_ptr<rpc> r(new rpc());
+    r->func = "report_disconnect";
+    r->flags = REPLICANT_CALL_IDEMPOTENT;
+    e::packer pa(&r->input);
+    pa = pa << m_disconnect_version;
+
+    for (size_t i = 0; i < m_disconnects.size(); ++i)
+    {
+        pa = pa << m_disconnects[i];
+    }
+
+    m_disconnects.clear();
+    m_disconnect_id = make_rpc_no_synchro(r);
 }
 
 bool
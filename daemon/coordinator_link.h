@@ -30,6 +30,8 @@
 
 // STL
 #include <map>
+#include <string>
+#include <vector>
 
 // po6
 #include <po6/threads/mutex.h>
@@ -57,7 +59,12 @@ class coordinator_link
 
     // external synchro required
     public:
-        bool register_server(server_id us, const po6::net::location& bind_to);
+        // "zone" may be empty
+        bool register_server(server_id us, const po6::net::location& bind_to,
+                             const std::string& zone);
+        // tell the coordinator which regions came back empty from a
+        // restart, before the daemon comes online to serve them
+        bool report_lost_regions(const std::vector<region_id>& rids);
         bool initialize();
         bool maintain();
         void shutdown();
@@ -75,11 +82,22 @@ class coordinator_link
         void transfer_go_live(const transfer_id& id);
         void transfer_complete(const transfer_id& id);
         void report_tcp_disconnect(uint64_t config_version, const server_id& id);
+        void report_load(const std::vector<region_id>& rids,
+                         const std::vector<uint64_t>& bytes,
+                         const std::vector<uint64_t>& ops);
 
     private:
         struct rpc;
         void make_rpc(e::compat::shared_ptr<rpc> r);
-        void make_rpc_no_synchro(e::compat::shared_ptr<rpc> r);
+        // returns the id of the call, or -1 if it could not be made
+        int64_t make_rpc_no_synchro(e::compat::shared_ptr<rpc> r);
+        // send what is queued in "xids" as one call, unless such a call is
+        // outstanding in "*id", in which case the queue waits for its return
+        void flush_transfers_no_synchro(const char* func,
+                                        std::vector<transfer_id>* xids,
+                                        int64_t* id);
+        // likewise for the servers in "m_disconnects"
+        void flush_disconnects_no_synchro();
         bool synchronous_call(const char* log_action, const char* func,
                               const char* input, size_t input_sz,
                               char** output, size_t* output_sz);
@@ -111,6 +129,18 @@ class coordinator_link
         po6::threads::mutex m_mtx;
         replicant_client* m_repl;
         std::map<int64_t, e::compat::shared_ptr<rpc> > m_rpcs;
+        // transfers reported while an earlier report is outstanding go to the
+        // coordinator together, and cost one configuration among them
+        std::vector<transfer_id> m_go_live;
+        int64_t m_go_live_id;
+        std::vector<transfer_id> m_complete;
+        int64_t m_complete_id;
+        // the same goes for failed servers, each of which is reported at most
+        // once per configuration
+        uint64_t m_disconnect_version;
+        std::vector<server_id> m_disconnects;
+        std::vector<server_id> m_disconnects_reported;
+        int64_t m_disconnect_id;
 
     private:
         coordinator_link(const coordinator_link&);
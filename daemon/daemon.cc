@@ -28,6 +28,9 @@
 #define __STDC_LIMIT_MACROS
 #define _WITH_GETLINE
 
+// C
+#include <stdlib.h>
+
 // POSIX
 #include <dirent.h>
 #include <signal.h>
@@ -36,7 +39,11 @@
 #include <unistd.h>
 
 // STL
+#include <algorithm>
+#include <map>
+#include <set>
 #include <sstream>
+#include <string>
 
 // Google Log
 #include <glog/logging.h>
@@ -51,18 +58,37 @@
 #include <e/strescape.h>
 
 // HyperDex
+#include "common/compression.h"
 #include "common/coordinator_returncode.h"
+#include "common/datatype_float.h"
 #include "common/key_change.h"
 #include "common/serialization.h"
+#include "cityhash/city.h"
 #include "daemon/auth.h"
 #include "daemon/daemon.h"
-
-#ifdef __APPLE__
-#include <mach/mach.h>
-#endif
+#include "daemon/expiry.h"
+#include "daemon/huge_pages.h"
+#include "daemon/lock_profile.h"
+#include "daemon/memory_accounting.h"
 
 using po6::threads::make_obj_func;
 using hyperdex::daemon;
+using hyperdex::lock_profile;
+using hyperdex::memory_accounting;
+
+// the most an XFER_OP_COMPRESSED may claim to expand to; senders compress
+// batches a fraction of this size
+#define XFER_MAX_DECOMPRESSED_BYTES (16ULL * 1024ULL * 1024ULL)
+// over the memory soft limit, a new client write is told to come back after
+// the most; a new search waits on its search thread in steps of this many
+// nanoseconds, up to the most, for memory to drain
+#define MEMORY_THROTTLE_STEP 100000ULL
+#define MEMORY_THROTTLE_MAX 10000000ULL
+// with compaction as far behind as it may get, each region admits a new
+// client write at most once per this many nanoseconds, and tells the rest to
+// come back in at most the second number; less behind, proportionally less
+#define COMPACTION_PACE_INTERVAL 2000000ULL
+#define COMPACTION_PACE_MAX_WAIT 20000000ULL
 
 int s_interrupts = 0;
 bool s_debug = false;
@@ -97,6 +123,8 @@ daemon :: daemon()
     : m_us()
     , m_bind_to()
     , m_threads()
+    , m_search_threads()
+    , m_placement()
     , m_gc()
     , m_gc_ts()
     , m_coord()
@@ -106,36 +134,100 @@ daemon :: daemon()
     , m_repl(this)
     , m_stm(this)
     , m_sm(this)
-    , m_config()
+    , m_config(new configuration())
+    , m_region_ops()
+    , m_hot_keys()
+    , m_profile_thread(this)
+    , m_export_thread(this)
+    , m_admission()
     , m_protect_pause()
     , m_can_pause(&m_protect_pause)
     , m_paused(false)
     , m_perf_req_get()
     , m_perf_req_get_partial()
+    , m_perf_req_get_batch()
+    , m_perf_req_get_relaxed()
+    , m_perf_req_get_cached()
+    , m_perf_req_get_versioned()
+    , m_perf_req_get_unmodified()
+    , m_perf_req_expired()
+    , m_perf_memory_throttled()
+    , m_perf_req_throttled()
+    , m_perf_compaction_throttled()
+    , m_perf_compaction_throttle_time()
     , m_perf_req_atomic()
+    , m_perf_req_atomic_batch()
+    , m_perf_req_atomic_batched()
     , m_perf_req_search_start()
     , m_perf_req_search_next()
     , m_perf_req_search_stop()
+    , m_perf_req_search_multi()
+    , m_perf_req_search_multi_regions()
     , m_perf_req_sorted_search()
+    , m_perf_req_sorted_search_next()
+    , m_perf_req_nearest_search()
     , m_perf_req_count()
+    , m_perf_req_approximate_count()
+    , m_perf_req_aggregate()
     , m_perf_req_search_describe()
+    , m_perf_req_changes_start()
+    , m_perf_req_changes_next()
+    , m_perf_req_changes_stop()
     , m_perf_req_group_atomic()
     , m_perf_chain_op()
+    , m_perf_chain_op_batch()
     , m_perf_chain_subspace()
     , m_perf_chain_ack()
+    , m_perf_chain_ack_batch()
     , m_perf_xfer_handshake_syn()
     , m_perf_xfer_handshake_synack()
     , m_perf_xfer_handshake_ack()
     , m_perf_xfer_handshake_wiped()
     , m_perf_xfer_op()
+    , m_perf_xfer_op_batch()
+    , m_perf_xfer_op_compressed()
     , m_perf_xfer_ack()
     , m_perf_backup()
     , m_perf_perf_counters()
+    , m_perf_hot_keys()
+    , m_perf_profile()
+    , m_perf_export()
+    , m_perf_maintenance()
+    , m_lat_req_get()
+    , m_lat_req_get_partial()
+    , m_lat_req_get_batch()
+    , m_lat_req_get_relaxed()
+    , m_lat_req_get_cached()
+    , m_lat_req_get_versioned()
+    , m_lat_req_atomic()
+    , m_lat_req_search_start()
+    , m_lat_req_search_next()
+    , m_lat_req_search_stop()
+    , m_lat_req_sorted_search()
+    , m_lat_req_sorted_search_next()
+    , m_lat_req_nearest_search()
+    , m_lat_req_count()
+    , m_lat_req_approximate_count()
+    , m_lat_req_aggregate()
+    , m_lat_req_search_describe()
+    , m_lat_req_changes_start()
+    , m_lat_req_changes_next()
+    , m_lat_req_changes_stop()
+    , m_lat_req_group_atomic()
+    , m_lat_chain_op()
+    , m_lat_chain_op_batch()
+    , m_lat_chain_subspace()
+    , m_lat_chain_ack()
+    , m_lat_chain_ack_batch()
     , m_block_stat_path()
     , m_stat_collector(make_obj_func(&daemon::collect_stats, this))
     , m_protect_stats()
     , m_stats_start(0)
     , m_stats()
+    , m_metrics()
+    , m_expiry_sweeper(make_obj_func(&daemon::sweep_expired, this))
+    , m_cold_migrator(make_obj_func(&daemon::migrate_cold, this))
+    , m_immutable_compactor(make_obj_func(&daemon::compact_immutable, this))
 {
     m_gc.register_thread(&m_gc_ts);
 }
@@ -143,6 +235,13 @@ daemon :: daemon()
 daemon :: ~daemon() throw ()
 {
     m_gc.deregister_thread(&m_gc_ts);
+    delete m_config;
+}
+
+static void
+delete_configuration(void* ptr)
+{
+    delete static_cast<hyperdex::configuration*>(ptr);
 }
 
 static bool
@@ -183,7 +282,19 @@ daemon :: run(bool daemonize,
               po6::net::location bind_to,
               bool set_coordinator,
               po6::net::hostname coordinator,
-              unsigned threads)
+              unsigned threads,
+              unsigned search_threads,
+              unsigned commit_threads,
+              const thread_placement& placement,
+              const datalayer::tuning& storage,
+              uint64_t chain_batch_window,
+              uint64_t chain_ack_window,
+              uint64_t peer_lease,
+              bool chain_deltas,
+              uint64_t slow_op_threshold,
+              uint64_t trace_sample,
+              uint16_t metrics_port,
+              std::string zone)
 {
     if (!install_signal_handler(SIGHUP, exit_on_signal) ||
         !install_signal_handler(SIGINT, exit_on_signal) ||
@@ -204,6 +315,15 @@ daemon :: run(bool daemonize,
     }
 
     google::LogToStderr();
+    // spans go beside the log; resolve it now, as we chdir before opening it
+    std::string trace_path;
+
+    if (!po6::path::realpath(log, &trace_path))
+    {
+        trace_path = log;
+    }
+
+    trace_path = po6::path::join(trace_path, "hyperdex-daemon-traces");
 
     if (daemonize)
     {
@@ -257,18 +377,24 @@ daemon :: run(bool daemonize,
         LOG(INFO) << "provide \"--daemon\" on the command-line if you want to run in the background";
     }
 
+    // the storage's background threads place themselves as they start
+    m_placement = placement;
+    m_placement.initialize(threads);
     bool saved = false;
     server_id saved_us;
     po6::net::location saved_bind_to;
     po6::net::hostname saved_coordinator;
     LOG(INFO) << "initializing local storage";
     m_data_dir = data;
+    const uint64_t startup_start = po6::monotonic_time();
 
-    if (!m_data.initialize(data, &saved, &saved_us, &saved_bind_to, &saved_coordinator))
+    if (!m_data.initialize(data, storage, &saved, &saved_us, &saved_bind_to, &saved_coordinator))
     {
         return EXIT_FAILURE;
     }
 
+    const uint64_t storage_ready = po6::monotonic_time();
+
     if (po6::path::dirname(data).size())
     {
         if (chdir(po6::path::dirname(data).c_str()) < 0)
@@ -318,7 +444,7 @@ daemon :: run(bool daemonize,
 
         LOG(INFO) << "generated new random token:  " << sid;
 
-        if (!m_coord->register_server(server_id(sid), bind_to))
+        if (!m_coord->register_server(server_id(sid), bind_to, zone))
         {
             return EXIT_FAILURE;
         }
@@ -331,17 +457,43 @@ daemon :: run(bool daemonize,
         return EXIT_FAILURE;
     }
 
+    std::vector<region_id> lost;
+    m_data.lost_regions(&lost);
+
+    // a replica of a memory space comes back empty, and must not serve
+    // until state transfer has refilled it from the other replicas
+    if (saved && !lost.empty())
+    {
+        LOG(INFO) << "lost the contents of " << lost.size()
+                  << " regions of spaces kept in memory; leaving them to be refilled";
+
+        if (!m_coord->report_lost_regions(lost))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
     if (!m_coord->initialize())
     {
         return EXIT_FAILURE;
     }
 
     determine_block_stat_path(data);
-    m_comm.setup(bind_to, threads);
-    m_repl.setup();
+    m_comm.setup(bind_to, threads, chain_batch_window, chain_ack_window, peer_lease);
+    m_repl.setup(chain_deltas, slow_op_threshold, trace_sample, trace_path, commit_threads);
     m_stm.setup();
     m_sm.setup();
 
+    for (size_t i = 0; i < search_threads; ++i)
+    {
+        e::compat::shared_ptr<search_thread> t(new search_thread(this, i));
+        m_search_threads.push_back(t);
+        t->start();
+    }
+
+    m_profile_thread.start();
+    m_export_thread.start();
+
     for (size_t i = 0; i < threads; ++i)
     {
         using namespace po6::threads;
@@ -350,7 +502,15 @@ daemon :: run(bool daemonize,
         t->start();
     }
 
+    if (metrics_port != 0 && !m_metrics.start(metrics_port))
+    {
+        LOG(ERROR) << "continuing without the metrics endpoint";
+    }
+
     m_stat_collector.start();
+    m_expiry_sweeper.start();
+    m_cold_migrator.start();
+    m_immutable_compactor.start();
     uint64_t checkpoint = 0;
     uint64_t checkpoint_stable = 0;
     uint64_t checkpoint_gc = 0;
@@ -364,6 +524,17 @@ daemon :: run(bool daemonize,
             m_data.debug_dump();
             m_repl.debug_dump();
             m_stm.debug_dump();
+            std::ostringstream mem;
+            collect_stats_memory(&mem);
+            LOG(INFO) << "memory:" << mem.str();
+
+            if (lock_profile::sample() > 0)
+            {
+                std::ostringstream locks;
+                collect_stats_locks(&locks);
+                LOG(INFO) << "locks:" << locks.str();
+            }
+
             LOG(INFO) << "end debug dump";
         }
 
@@ -379,24 +550,28 @@ daemon :: run(bool daemonize,
             m_coord->shutdown();
         }
 
-        if (m_config.version() > 0 &&
-            m_config.version() == m_coord->checkpoint_config_version() &&
+        if (config().version() > 0 &&
+            config().version() == m_coord->checkpoint_config_version() &&
             checkpoint < m_coord->checkpoint())
         {
             checkpoint = m_coord->checkpoint();
             m_repl.begin_checkpoint(checkpoint);
+            // checkpoints come at the coordinator's pace, which suits the
+            // load reports and the prefetch list too
+            report_load();
+            save_prefetch_list();
         }
 
-        if (m_config.version() > 0 &&
-            m_config.version() == m_coord->checkpoint_config_version() &&
+        if (config().version() > 0 &&
+            config().version() == m_coord->checkpoint_config_version() &&
             checkpoint_stable < m_coord->checkpoint_stable())
         {
             checkpoint_stable = m_coord->checkpoint_stable();
             m_repl.end_checkpoint(checkpoint_stable);
         }
 
-        if (m_config.version() > 0 &&
-            m_config.version() == m_coord->checkpoint_config_version() &&
+        if (config().version() > 0 &&
+            config().version() == m_coord->checkpoint_config_version() &&
             checkpoint_gc < m_coord->checkpoint_gc())
         {
             checkpoint_gc = m_coord->checkpoint_gc();
@@ -413,7 +588,7 @@ daemon :: run(bool daemonize,
             continue;
         }
 
-        const configuration& old_config(m_config);
+        const configuration& old_config(config());
         const configuration& new_config(m_coord->config());
 
         if (old_config.cluster() != 0 &&
@@ -461,24 +636,55 @@ daemon :: run(bool daemonize,
             continue;
         }
 
+        // most changes are to regions elsewhere in the cluster; those need
+        // only the new configuration and a fresh start for in-flight
+        // messages, so swap it in while everything keeps running
+        if (new_config.same_local_layout(old_config, m_us))
+        {
+            LOG(INFO) << "moving to configuration version=" << new_config.version()
+                      << " in place (no local regions changed)";
+            install_config(new_config);
+            m_comm.reconfigure(old_config, new_config, m_us);
+            m_repl.reconfigure_unaffected();
+            m_coord->config_ack(new_config.version());
+            continue;
+        }
+
         LOG(INFO) << "moving to configuration version=" << new_config.version()
                   << "; pausing all activity while we reconfigure";
+        // old_config goes away once the new one is installed
+        const bool first_config = old_config.version() == 0;
         this->pause();
         m_comm.reconfigure(old_config, new_config, m_us);
         m_data.reconfigure(old_config, new_config, m_us);
         m_repl.reconfigure(old_config, new_config, m_us);
         m_stm.reconfigure(old_config, new_config, m_us);
         m_sm.reconfigure(old_config, new_config, m_us);
-        m_config = new_config;
+        m_region_ops.reconfigure(new_config, m_us);
+        install_config(new_config);
         this->unpause();
         LOG(INFO) << "reconfiguration complete; resuming normal operation";
 
+        if (first_config)
+        {
+            const uint64_t now = po6::monotonic_time();
+            LOG(INFO) << "serving " << (now - startup_start) / 1000000ULL
+                      << "ms after startup: local storage took "
+                      << (storage_ready - startup_start) / 1000000ULL
+                      << "ms and joining the cluster took "
+                      << (now - storage_ready) / 1000000ULL << "ms";
+        }
+
         // let the coordinator know we've moved to this config
         m_coord->config_ack(new_config.version());
     }
 
     __sync_fetch_and_add(&s_interrupts, 2);
     m_stat_collector.join();
+    m_expiry_sweeper.join();
+    m_cold_migrator.join();
+    m_immutable_compactor.join();
+    m_metrics.shutdown();
     m_comm.shutdown();
 
     for (size_t i = 0; i < m_threads.size(); ++i)
@@ -486,15 +692,34 @@ daemon :: run(bool daemonize,
         m_threads[i]->join();
     }
 
+    for (size_t i = 0; i < m_search_threads.size(); ++i)
+    {
+        m_search_threads[i]->shutdown();
+    }
+
+    m_profile_thread.shutdown();
+    m_export_thread.shutdown();
     m_sm.teardown();
     m_stm.teardown();
     m_repl.teardown();
     m_comm.teardown();
+    save_prefetch_list();
     m_data.teardown();
     LOG(INFO) << "hyperdex-daemon will now terminate";
     return EXIT_SUCCESS;
 }
 
+void
+daemon :: install_config(const configuration& config)
+{
+    const configuration* prev = m_config;
+    const configuration* next = new configuration(config);
+    e::atomic::store_ptr_release(&m_config, next);
+    // readers that loaded "prev" are done with it by their next quiescent
+    // state
+    m_gc.collect(const_cast<configuration*>(prev), delete_configuration);
+}
+
 void
 daemon :: pause()
 {
@@ -506,11 +731,23 @@ daemon :: pause()
     }
 
     m_paused = true;
+
+    for (size_t i = 0; i < m_search_threads.size(); ++i)
+    {
+        m_search_threads[i]->initiate_pause();
+    }
+
+    for (size_t i = 0; i < m_search_threads.size(); ++i)
+    {
+        m_search_threads[i]->wait_until_paused();
+    }
+
     m_sm.pause();
     m_stm.pause();
     m_repl.pause();
     m_data.pause();
     m_comm.pause();
+    m_repl.wait_for_commits();
 }
 
 void
@@ -522,6 +759,12 @@ daemon :: unpause()
     m_repl.unpause();
     m_stm.unpause();
     m_sm.unpause();
+
+    for (size_t i = 0; i < m_search_threads.size(); ++i)
+    {
+        m_search_threads[i]->unpause();
+    }
+
     assert(m_paused);
     m_paused = false;
     m_can_pause.signal();
@@ -531,25 +774,7 @@ void
 daemon :: loop(size_t thread)
 {
     sigset_t ss;
-
-    size_t core = thread % sysconf(_SC_NPROCESSORS_ONLN);
-#ifdef __LINUX__
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    CPU_SET(core, &cpuset);
-    pthread_t cur = pthread_self();
-    int x = pthread_setaffinity_np(cur, sizeof(cpu_set_t), &cpuset);
-    assert(x == 0);
-#elif defined(__APPLE__)
-    thread_affinity_policy_data_t policy;
-    policy.affinity_tag = 0;
-    thread_policy_set(mach_thread_self(),
-                      THREAD_AFFINITY_POLICY,
-                      (thread_policy_t)&policy,
-                      THREAD_AFFINITY_POLICY_COUNT);
-#endif
-
-    LOG(INFO) << "network thread " << thread << " started on core " << core;
+    m_placement.place_network_thread(thread);
 
     if (sigfillset(&ss) < 0)
     {
@@ -574,65 +799,124 @@ daemon :: loop(size_t thread)
     network_msgtype type;
     std::auto_ptr<e::buffer> msg;
     e::unpacker up;
+    uint64_t deadline;
 
-    while (m_comm.recv(&ts, &from, &vfrom, &vto, &type, &msg, &up))
+    while (m_comm.recv(&ts, &from, &vfrom, &vto, &type, &msg, &up, &deadline))
     {
         assert(from != server_id());
         assert(vto != virtual_server_id());
+        latency_histogram* lat = NULL;
+        const uint64_t start = po6::monotonic_time();
+        m_region_ops.tap(vto, type, msg->size());
+
+        if (!throttle_for_memory(from, vto, type, up) ||
+            !throttle_for_compaction(from, vto, type, up) ||
+            !admit(from, vto, type, *msg, up))
+        {
+            m_gc.quiescent_state(&ts);
+            continue;
+        }
 
         switch (type)
         {
             case REQ_GET:
                 process_req_get(from, vfrom, vto, msg, up);
                 m_perf_req_get.tap();
+                lat = &m_lat_req_get;
                 break;
             case REQ_GET_PARTIAL:
                 process_req_get_partial(from, vfrom, vto, msg, up);
                 m_perf_req_get_partial.tap();
+                lat = &m_lat_req_get_partial;
+                break;
+            case REQ_GET_BATCH:
+                process_req_get_batch(from, vfrom, vto, msg, up);
+                m_perf_req_get_batch.tap();
+                lat = &m_lat_req_get_batch;
+                break;
+            case REQ_GET_RELAXED:
+                process_req_get_relaxed(from, vfrom, vto, msg, up);
+                m_perf_req_get_relaxed.tap();
+                lat = &m_lat_req_get_relaxed;
+                break;
+            case REQ_GET_CACHED:
+                process_req_get_cached(from, vfrom, vto, msg, up);
+                m_perf_req_get_cached.tap();
+                lat = &m_lat_req_get_cached;
+                break;
+            case REQ_GET_VERSIONED:
+                process_req_get_versioned(from, vfrom, vto, msg, up);
+                m_perf_req_get_versioned.tap();
+                lat = &m_lat_req_get_versioned;
                 break;
             case REQ_ATOMIC:
                 process_req_atomic(from, vfrom, vto, msg, up);
                 m_perf_req_atomic.tap();
+                lat = &m_lat_req_atomic;
                 break;
-            case REQ_SEARCH_START:
-                process_req_search_start(from, vfrom, vto, msg, up);
-                m_perf_req_search_start.tap();
+            case REQ_ATOMIC_BATCH:
+                process_req_atomic_batch(from, vfrom, vto, msg, up);
+                m_perf_req_atomic_batch.tap();
                 break;
+            case REQ_SEARCH_START:
             case REQ_SEARCH_NEXT:
-                process_req_search_next(from, vfrom, vto, msg, up);
-                m_perf_req_search_next.tap();
-                break;
             case REQ_SEARCH_STOP:
-                process_req_search_stop(from, vfrom, vto, msg, up);
-                m_perf_req_search_stop.tap();
-                break;
+            case REQ_SEARCH_MULTI:
             case REQ_SORTED_SEARCH:
-                process_req_sorted_search(from, vfrom, vto, msg, up);
-                m_perf_req_sorted_search.tap();
-                break;
+            case REQ_SORTED_SEARCH_NEXT:
+            case REQ_NEAREST_SEARCH:
             case REQ_COUNT:
-                process_req_count(from, vfrom, vto, msg, up);
-                m_perf_req_count.tap();
-                break;
+            case REQ_APPROXIMATE_COUNT:
+            case REQ_AGGREGATE:
             case REQ_SEARCH_DESCRIBE:
-                process_req_search_describe(from, vfrom, vto, msg, up);
-                m_perf_req_search_describe.tap();
+            case REQ_CHANGES_START:
+            case REQ_CHANGES_NEXT:
+            case REQ_CHANGES_STOP:
+                if (m_search_threads.empty())
+                {
+                    process_search(thread, from, vfrom, vto, type, msg, up, deadline);
+                }
+                else
+                {
+                    // a search touches one region per message, so spread by
+                    // (client, region):  a client's search over many regions
+                    // runs on many threads, while messages for any one region
+                    // stay on one thread and in the order they were sent;
+                    // a REQ_SEARCH_MULTI's regions share one thread
+                    uint64_t h = from.get() ^ (vto.get() * 0x9e3779b97f4a7c15ULL);
+                    size_t idx = (h ^ (h >> 32)) % m_search_threads.size();
+                    m_search_threads[idx]->enqueue(from, vfrom, vto, type, msg, up, deadline);
+                }
                 break;
             case REQ_GROUP_ATOMIC:
                 process_req_group_atomic(from, vfrom, vto, msg, up);
                 m_perf_req_group_atomic.tap();
+                lat = &m_lat_req_group_atomic;
                 break;
             case CHAIN_OP:
                 process_chain_op(from, vfrom, vto, msg, up);
                 m_perf_chain_op.tap();
+                lat = &m_lat_chain_op;
+                break;
+            case CHAIN_OP_BATCH:
+                process_chain_op_batch(from, vfrom, vto, msg, up);
+                m_perf_chain_op_batch.tap();
+                lat = &m_lat_chain_op_batch;
                 break;
             case CHAIN_SUBSPACE:
                 process_chain_subspace(from, vfrom, vto, msg, up);
                 m_perf_chain_subspace.tap();
+                lat = &m_lat_chain_subspace;
                 break;
             case CHAIN_ACK:
                 process_chain_ack(from, vfrom, vto, msg, up);
                 m_perf_chain_ack.tap();
+                lat = &m_lat_chain_ack;
+                break;
+            case CHAIN_ACK_BATCH:
+                process_chain_ack_batch(from, vfrom, vto, msg, up);
+                m_perf_chain_ack_batch.tap();
+                lat = &m_lat_chain_ack_batch;
                 break;
             case XFER_HS:
                 process_xfer_handshake_syn(from, vfrom, vto, msg, up);
@@ -654,6 +938,14 @@ daemon :: loop(size_t thread)
                 process_xfer_op(from, vfrom, vto, msg, up);
                 m_perf_xfer_op.tap();
                 break;
+            case XFER_OP_BATCH:
+                process_xfer_op_batch(from, vfrom, vto, msg, up);
+                m_perf_xfer_op_batch.tap();
+                break;
+            case XFER_OP_COMPRESSED:
+                process_xfer_op_compressed(from, vfrom, vto, msg, up);
+                m_perf_xfer_op_compressed.tap();
+                break;
             case XFER_ACK:
                 process_xfer_ack(from, vfrom, vto, msg, up);
                 m_perf_xfer_ack.tap();
@@ -665,15 +957,40 @@ daemon :: loop(size_t thread)
                 process_perf_counters(from, vfrom, vto, msg, up);
                 m_perf_perf_counters.tap();
                 break;
+            case HOT_KEYS:
+                process_hot_keys(from, vfrom, vto, msg, up);
+                m_perf_hot_keys.tap();
+                break;
+            case PROFILE:
+                process_profile(from, vfrom, vto, msg, up);
+                m_perf_profile.tap();
+                break;
+            case EXPORT:
+                process_export(from, vfrom, vto, msg, up);
+                m_perf_export.tap();
+                break;
+            case MAINTENANCE:
+                process_maintenance(from, vfrom, vto, msg, up);
+                m_perf_maintenance.tap();
+                break;
             case RESP_GET:
             case RESP_GET_PARTIAL:
+            case RESP_GET_BATCH:
+            case RESP_GET_VERSIONED:
             case RESP_ATOMIC:
             case RESP_GROUP_ATOMIC:
             case RESP_SEARCH_ITEM:
             case RESP_SEARCH_DONE:
+            case RESP_SEARCH_BATCH:
+            case RESP_SEARCH_COMPRESSED:
             case RESP_SORTED_SEARCH:
+            case RESP_SORTED_SEARCH_CHUNK:
+            case RESP_NEAREST_SEARCH:
             case RESP_COUNT:
+            case RESP_AGGREGATE:
             case RESP_SEARCH_DESCRIBE:
+            case RESP_CHANGES_BATCH:
+            case RESP_CHANGES_COMPRESSED:
             case CONFIGMISMATCH:
             case PACKET_NOP:
             default:
@@ -681,6 +998,11 @@ daemon :: loop(size_t thread)
                 break;
         }
 
+        if (lat)
+        {
+            lat->record(thread, po6::monotonic_time() - start);
+        }
+
         m_gc.quiescent_state(&ts);
     }
 
@@ -688,631 +1010,2458 @@ daemon :: loop(size_t thread)
     LOG(INFO) << "network thread shutting down";
 }
 
-void
-daemon :: process_req_get(server_id from,
-                          virtual_server_id,
-                          virtual_server_id vto,
-                          std::auto_ptr<e::buffer> msg,
-                          e::unpacker up)
+bool
+daemon :: throttle_for_memory(const server_id& from, const virtual_server_id& vto,
+                              network_msgtype type, e::unpacker up)
 {
-    uint64_t nonce;
-    e::slice key;
-    bool has_auth = false;
-    auth_wallet aw;
-    up = up >> nonce >> key;
+    // only new writes whose replies can carry a retry; the network threads
+    // also read the chain and transfer messages that let held memory drain,
+    // so they never wait for it
+    switch (type)
+    {
+        case REQ_ATOMIC:
+        case REQ_ATOMIC_BATCH:
+            break;
+        default:
+            return true;
+    }
 
-    if (up.remain())
+    if (!memory_accounting::over_soft_limit())
     {
-        has_auth = true;
-        up = up >> aw;
+        return true;
     }
 
-    if (up.error())
+    m_perf_memory_throttled.tap();
+    turn_away(from, vto, type, up, MEMORY_THROTTLE_MAX / 1000000ULL);
+    return false;
+}
+
+void
+daemon :: hold_search_for_memory(network_msgtype type)
+{
+    // later search messages are what let a search's snapshot go
+    switch (type)
+    {
+        case REQ_SEARCH_START:
+        case REQ_SEARCH_MULTI:
+        case REQ_SORTED_SEARCH:
+        case REQ_NEAREST_SEARCH:
+        case REQ_CHANGES_START:
+            break;
+        default:
+            return;
+    }
+
+    if (!memory_accounting::over_soft_limit())
     {
-        LOG(WARNING) << "unpack of REQ_GET failed; here's some hex:  " << msg->hex();
         return;
     }
 
-    region_id ri = m_config.get_region_id(vto);
-    bool has_value = false;
-    std::vector<e::slice> value;
-    uint64_t version;
-    datalayer::reference ref;
-    network_returncode result;
+    m_perf_memory_throttled.tap();
 
-    switch (m_data.get(ri, key, &value, &version, &ref))
+    for (uint64_t waited = 0; waited < MEMORY_THROTTLE_MAX &&
+            memory_accounting::over_soft_limit(); waited += MEMORY_THROTTLE_STEP)
     {
-        case datalayer::SUCCESS:
-            has_value = true;
-            result = NET_SUCCESS;
-            break;
-        case datalayer::NOT_FOUND:
-            result = NET_NOTFOUND;
+        struct timespec ts;
+        ts.tv_sec = 0;
+        ts.tv_nsec = MEMORY_THROTTLE_STEP;
+        nanosleep(&ts, NULL);
+    }
+}
+
+bool
+daemon :: throttle_for_compaction(const server_id& from, const virtual_server_id& vto,
+                                  network_msgtype type, e::unpacker up)
+{
+    // only new client writes whose replies can carry a retry; the chain must
+    // flow for them to finish, and the same threads carry it
+    switch (type)
+    {
+        case REQ_ATOMIC:
+        case REQ_ATOMIC_BATCH:
             break;
-        case datalayer::BAD_ENCODING:
-        case datalayer::CORRUPTION:
-        case datalayer::IO_ERROR:
-        case datalayer::LEVELDB_ERROR:
         default:
-            LOG(ERROR) << "GET returned unacceptable error code.";
-            result = NET_SERVERERROR;
-            break;
+            return true;
     }
 
-    const schema* sc = m_config.get_schema(ri);
+    const uint64_t pressure = m_data.compaction_pressure();
 
-    if (!auth_verify_read(*sc, has_value, &value, (has_auth ? &aw : NULL)))
+    if (pressure == 0)
     {
-        size_t sz = HYPERDEX_HEADER_SIZE_VC
-                  + sizeof(uint64_t)
-                  + sizeof(uint16_t);
-        msg.reset(e::buffer::create(sz));
-        msg->pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce << static_cast<uint16_t>(NET_UNAUTHORIZED);
+        return true;
     }
-    else
-    {
-        sanitize_secrets(*sc, &value);
-        size_t sz = HYPERDEX_HEADER_SIZE_VC
-                  + sizeof(uint64_t)
-                  + sizeof(uint16_t)
-                  + pack_size(value);
-        msg.reset(e::buffer::create(sz));
-        e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
-        pa = pa << nonce << static_cast<uint16_t>(result);
 
-        if (result == NET_SUCCESS)
-        {
-            pa = pa << value;
-        }
+    const region_id ri = config().get_region_id(vto);
+    const uint64_t interval = COMPACTION_PACE_INTERVAL * pressure / 1000;
+    const uint64_t wait = m_admission.pace(ri, interval, COMPACTION_PACE_MAX_WAIT,
+                                           po6::monotonic_time());
+
+    if (wait == 0)
+    {
+        return true;
     }
 
-    m_comm.send_client(vto, from, RESP_GET, msg);
+    m_perf_compaction_throttled.tap();
+    m_perf_compaction_throttle_time.add(wait);
+    turn_away(from, vto, type, up, (wait + 999999ULL) / 1000000ULL);
+    return false;
 }
 
-void
-daemon :: process_req_get_partial(server_id from,
-                                  virtual_server_id,
-                                  virtual_server_id vto,
-                                  std::auto_ptr<e::buffer> msg,
-                                  e::unpacker up)
+bool
+daemon :: admit(const server_id& from, const virtual_server_id& vto,
+                network_msgtype type, const e::buffer& msg, e::unpacker up)
 {
-    uint64_t nonce;
-    e::slice key;
-    std::vector<uint16_t> attrs;
-    bool has_auth = false;
-    auth_wallet aw;
-    up = up >> nonce >> key >> attrs;
+    const region_op_counter::counter_t kind = region_op_counter::classify(type);
 
-    if (up.remain())
+    if (kind != region_op_counter::READS &&
+        kind != region_op_counter::WRITES &&
+        kind != region_op_counter::SEARCHES)
     {
-        has_auth = true;
-        up = up >> aw;
+        return true;
     }
 
-    if (up.error())
+    const region_id ri = config().get_region_id(vto);
+    const schema* sc = config().get_schema(ri);
+
+    if (!sc || (sc->quota_ops == 0 && sc->quota_bytes == 0 && sc->quota_client_ops == 0))
     {
-        LOG(WARNING) << "unpack of REQ_GET_PARTIAL failed; here's some hex:  " << msg->hex();
-        return;
+        return true;
     }
 
-    region_id ri = m_config.get_region_id(vto);
-    std::sort(attrs.begin(), attrs.end());
-    bool has_value = false;
-    std::vector<e::slice> value;
-    uint64_t version;
-    datalayer::reference ref;
-    network_returncode result;
+    const char* space = config().get_space_name(ri);
+    const uint64_t now = po6::monotonic_time();
 
-    switch (m_data.get(ri, key, &value, &version, &ref))
+    // only requests whose replies lead with a returncode can be turned away;
+    // the rest are charged so that the space's next requests wait for them
+    switch (type)
     {
-        case datalayer::SUCCESS:
-            has_value = true;
-            result = NET_SUCCESS;
-            break;
-        case datalayer::NOT_FOUND:
-            result = NET_NOTFOUND;
+        case REQ_GET:
+        case REQ_GET_RELAXED:
+        case REQ_GET_PARTIAL:
+        case REQ_ATOMIC:
             break;
-        case datalayer::BAD_ENCODING:
-        case datalayer::CORRUPTION:
-        case datalayer::IO_ERROR:
-        case datalayer::LEVELDB_ERROR:
         default:
-            LOG(ERROR) << "GET returned unacceptable error code.";
-            result = NET_SERVERERROR;
-            break;
+            m_admission.charge(space, *sc, from, msg.size(), now);
+            return true;
     }
 
-    const schema* sc = m_config.get_schema(ri);
+    uint64_t retry_after = 0;
 
-    if (!auth_verify_read(*sc, has_value, &value, (has_auth ? &aw : NULL)))
+    if (m_admission.admit(space, *sc, from, msg.size(), now, &retry_after))
     {
-        size_t sz = HYPERDEX_HEADER_SIZE_VC
-                  + sizeof(uint64_t)
-                  + sizeof(uint16_t);
-        msg.reset(e::buffer::create(sz));
-        msg->pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce << static_cast<uint16_t>(NET_UNAUTHORIZED);
+        return true;
     }
-    else
-    {
-        sanitize_secrets(*sc, &value);
-        size_t sz = HYPERDEX_HEADER_SIZE_VC
-                  + sizeof(uint64_t)
-                  + sizeof(uint16_t)
-                  + pack_size(value)
-                  + value.size() * sizeof(uint16_t);
-        msg.reset(e::buffer::create(sz));
-        e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
-        pa = pa << nonce << static_cast<uint16_t>(result);
 
-        if (result == NET_SUCCESS)
+    m_perf_req_throttled.tap();
+    turn_away(from, vto, type, up, retry_after);
+    return false;
+}
+
+bool
+daemon :: turn_away(const server_id& from, const virtual_server_id& vto,
+                    network_msgtype type, e::unpacker up, uint64_t retry_after)
+{
+    network_msgtype resp;
+
+    switch (type)
+    {
+        case REQ_GET:
+        case REQ_GET_RELAXED:
+            resp = RESP_GET;
+            break;
+        case REQ_GET_PARTIAL:
+            resp = RESP_GET_PARTIAL;
+            break;
+        case REQ_ATOMIC:
+            resp = RESP_ATOMIC;
+            break;
+        case REQ_ATOMIC_BATCH:
         {
-            for (size_t i = 0; i < value.size(); ++i)
+            // each op is answered as a lone REQ_ATOMIC to its region would be
+            uint32_t count;
+            up = up >> count;
+
+            for (uint32_t i = 0; !up.error() && i < count; ++i)
             {
-                uint16_t attr = i + 1;
+                uint64_t vidt;
+                e::slice body;
+                up = up >> vidt >> body;
 
-                if (std::binary_search(attrs.begin(), attrs.end(), attr))
+                if (up.error() || body.size() < sizeof(uint64_t))
                 {
-                    pa = pa << attr << value[i];
+                    continue;
                 }
+
+                uint64_t nonce;
+                e::unpack64be(body.data(), &nonce);
+                send_throttled(from, virtual_server_id(vidt), RESP_ATOMIC, nonce, retry_after);
             }
+
+            return true;
         }
+        default:
+            return false;
     }
 
-    m_comm.send_client(vto, from, RESP_GET_PARTIAL, msg);
+    uint64_t nonce;
+    up = up >> nonce;
+
+    if (!up.error())
+    {
+        send_throttled(from, vto, resp, nonce, retry_after);
+    }
+
+    return true;
 }
 
 void
-daemon :: process_req_atomic(server_id from,
-                             virtual_server_id,
-                             virtual_server_id vto,
-                             std::auto_ptr<e::buffer> msg,
-                             e::unpacker up)
+daemon :: send_throttled(const server_id& to, const virtual_server_id& vfrom,
+                         network_msgtype resp, uint64_t nonce, uint64_t retry_after)
 {
-    // initialize nonce from pseudo-random memory
-    uint64_t nonce;
-
-    std::auto_ptr<key_change> kc(new key_change());
-    up = up >> nonce >> *kc;
+    const uint32_t ms = retry_after < UINT32_MAX ? retry_after : UINT32_MAX;
+    size_t sz = HYPERDEX_HEADER_SIZE_VC
+              + sizeof(uint64_t)
+              + sizeof(uint16_t)
+              + sizeof(uint32_t);
+    std::auto_ptr<e::buffer> reply(e::buffer::create(sz));
+    reply->pack_at(HYPERDEX_HEADER_SIZE_VC)
+        << nonce << static_cast<uint16_t>(NET_THROTTLED) << ms;
+    m_comm.send_client(vfrom, to, resp, reply);
+}
 
-    if (up.error())
+void
+daemon :: process_search(size_t thread,
+                         server_id from,
+                         virtual_server_id vfrom,
+                         virtual_server_id vto,
+                         network_msgtype type,
+                         std::auto_ptr<e::buffer> msg,
+                         e::unpacker up,
+                         uint64_t deadline)
+{
+    latency_histogram* lat = NULL;
+    const uint64_t start = po6::monotonic_time();
+
+    // it may have sat behind other searches for a search thread
+    if (deadline != 0 && start > deadline)
     {
-        LOG(WARNING) << "unpack of REQ_ATOMIC failed; here's some hex:  " << msg->hex();
+        m_perf_req_expired.tap();
         return;
     }
 
-    m_repl.client_atomic(from, vto, nonce, kc, msg);
+    switch (type)
+    {
+        case REQ_SEARCH_START:
+            process_req_search_start(from, vfrom, vto, msg, up, deadline);
+            m_perf_req_search_start.tap();
+            lat = &m_lat_req_search_start;
+            break;
+        case REQ_SEARCH_NEXT:
+            process_req_search_next(from, vfrom, vto, msg, up, deadline);
+            m_perf_req_search_next.tap();
+            lat = &m_lat_req_search_next;
+            break;
+        case REQ_SEARCH_STOP:
+            process_req_search_stop(from, vfrom, vto, msg, up);
+            m_perf_req_search_stop.tap();
+            lat = &m_lat_req_search_stop;
+            break;
+        case REQ_SEARCH_MULTI:
+            process_req_search_multi(from, vfrom, vto, msg, up, deadline);
+            m_perf_req_search_multi.tap();
+            break;
+        case REQ_SORTED_SEARCH:
+            process_req_sorted_search(from, vfrom, vto, msg, up, deadline);
+            m_perf_req_sorted_search.tap();
+            lat = &m_lat_req_sorted_search;
+            break;
+        case REQ_SORTED_SEARCH_NEXT:
+            process_req_sorted_search_next(from, vfrom, vto, msg, up);
+            m_perf_req_sorted_search_next.tap();
+            lat = &m_lat_req_sorted_search_next;
+            break;
+        case REQ_NEAREST_SEARCH:
+            process_req_nearest_search(from, vfrom, vto, msg, up, deadline);
+            m_perf_req_nearest_search.tap();
+            lat = &m_lat_req_nearest_search;
+            break;
+        case REQ_COUNT:
+            process_req_count(from, vfrom, vto, msg, up, deadline);
+            m_perf_req_count.tap();
+            lat = &m_lat_req_count;
+            break;
+        case REQ_APPROXIMATE_COUNT:
+            process_req_approximate_count(from, vfrom, vto, msg, up, deadline);
+            m_perf_req_approximate_count.tap();
+            lat = &m_lat_req_approximate_count;
+            break;
+        case REQ_AGGREGATE:
+            process_req_aggregate(from, vfrom, vto, msg, up, deadline);
+            m_perf_req_aggregate.tap();
+            lat = &m_lat_req_aggregate;
+            break;
+        case REQ_SEARCH_DESCRIBE:
+            process_req_search_describe(from, vfrom, vto, msg, up, deadline);
+            m_perf_req_search_describe.tap();
+            lat = &m_lat_req_search_describe;
+            break;
+        case REQ_CHANGES_START:
+            process_req_changes_start(from, vfrom, vto, msg, up);
+            m_perf_req_changes_start.tap();
+            lat = &m_lat_req_changes_start;
+            break;
+        case REQ_CHANGES_NEXT:
+            process_req_changes_next(from, vfrom, vto, msg, up);
+            m_perf_req_changes_next.tap();
+            lat = &m_lat_req_changes_next;
+            break;
+        case REQ_CHANGES_STOP:
+            process_req_changes_stop(from, vfrom, vto, msg, up);
+            m_perf_req_changes_stop.tap();
+            lat = &m_lat_req_changes_stop;
+            break;
+        default:
+            abort();
+    }
+
+    lat->record(thread, po6::monotonic_time() - start);
 }
 
 void
-daemon :: process_req_search_start(server_id from,
-                                   virtual_server_id,
-                                   virtual_server_id vto,
-                                   std::auto_ptr<e::buffer> msg,
-                                   e::unpacker up)
+daemon :: process_req_get(server_id from,
+                          virtual_server_id,
+                          virtual_server_id vto,
+                          std::auto_ptr<e::buffer> msg,
+                          e::unpacker up)
 {
     uint64_t nonce;
-    uint64_t search_id;
-    std::vector<attribute_check> checks;
+    e::slice key;
+    bool has_auth = false;
+    auth_wallet aw;
+    up = up >> nonce >> key;
+
+    if (up.remain())
+    {
+        has_auth = true;
+        up = up >> aw;
+    }
 
-    if ((up >> nonce >> search_id >> checks).error())
+    if (up.error())
     {
-        LOG(WARNING) << "unpack of REQ_SEARCH_START failed; here's some hex:  " << msg->hex();
+        LOG(WARNING) << "unpack of REQ_GET failed; here's some hex:  " << msg->hex();
         return;
     }
 
-    m_sm.start(from, vto, msg, nonce, search_id, &checks);
+    respond_get(from, vto, nonce, key, has_auth ? &aw : NULL);
 }
 
+class daemon::relaxed_get : public key_state::waiter
+{
+    public:
+        relaxed_get(daemon* d, server_id from, virtual_server_id vto,
+                    uint64_t nonce, uint64_t staleness,
+                    const e::slice& key, const auth_wallet* aw)
+            : m_d(d), m_from(from), m_vto(vto), m_nonce(nonce), m_staleness(staleness)
+            , m_key(reinterpret_cast<const char*>(key.data()), key.size())
+            , m_has_auth(aw != NULL), m_aw(aw ? *aw : auth_wallet()) {}
+        virtual ~relaxed_get() throw () {}
+
+    public:
+        virtual void resume(uint64_t pending)
+        {
+            m_d->respond_get_relaxed(m_from, m_vto, m_nonce, m_staleness, pending,
+                                     e::slice(m_key.data(), m_key.size()),
+                                     m_has_auth ? &m_aw : NULL);
+        }
+
+    private:
+        daemon* m_d;
+        server_id m_from;
+        virtual_server_id m_vto;
+        uint64_t m_nonce;
+        uint64_t m_staleness;
+        std::string m_key;
+        bool m_has_auth;
+        auth_wallet m_aw;
+
+    private:
+        relaxed_get(const relaxed_get&);
+        relaxed_get& operator = (const relaxed_get&);
+};
+
 void
-daemon :: process_req_search_next(server_id from,
+daemon :: process_req_get_relaxed(server_id from,
                                   virtual_server_id,
                                   virtual_server_id vto,
                                   std::auto_ptr<e::buffer> msg,
                                   e::unpacker up)
 {
     uint64_t nonce;
-    uint64_t search_id;
+    uint64_t staleness;
+    e::slice key;
+    bool has_auth = false;
+    auth_wallet aw;
+    up = up >> nonce >> staleness >> key;
 
-    if ((up >> nonce >> search_id).error())
+    if (up.remain())
     {
-        LOG(WARNING) << "unpack of REQ_SEARCH_NEXT failed; here's some hex:  " << msg->hex();
+        has_auth = true;
+        up = up >> aw;
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of REQ_GET_RELAXED failed; here's some hex:  " << msg->hex();
         return;
     }
 
-    m_sm.next(from, vto, nonce, search_id);
+    // any replica's disk holds only committed writes, so the read is as good
+    // as the point leader's unless this replica knows of more writes to the
+    // key than the client is willing to miss; an immutable space has none
+    region_id ri = config().get_region_id(vto);
+    const schema* sc = config().get_schema(ri);
+    uint64_t pending = 0;
+
+    // a running state machine has the count; rather than wait for it here,
+    // leave the read with the key state for whoever stops it to finish
+    if (!sc->immutable && !m_repl.pending_writes(ri, key, &pending, NULL))
+    {
+        std::auto_ptr<key_state::waiter> w(new relaxed_get(this, from, vto, nonce, staleness,
+                                                           key, has_auth ? &aw : NULL));
+
+        if (!m_repl.pending_writes(ri, key, &pending, &w))
+        {
+            return;
+        }
+    }
+
+    respond_get_relaxed(from, vto, nonce, staleness, pending, key, has_auth ? &aw : NULL);
 }
 
 void
-daemon :: process_req_search_stop(server_id from,
-                                  virtual_server_id,
-                                  virtual_server_id vto,
-                                  std::auto_ptr<e::buffer> msg,
-                                  e::unpacker up)
+daemon :: respond_get_relaxed(server_id from,
+                              virtual_server_id vto,
+                              uint64_t nonce,
+                              uint64_t staleness,
+                              uint64_t pending,
+                              const e::slice& key,
+                              auth_wallet* aw)
 {
-    uint64_t nonce;
-    uint64_t search_id;
-
-    if ((up >> nonce >> search_id).error())
+    if (pending > staleness)
     {
-        LOG(WARNING) << "unpack of REQ_SEARCH_STOP failed; here's some hex:  " << msg->hex();
+        size_t sz = HYPERDEX_HEADER_SIZE_VC
+                  + sizeof(uint64_t)
+                  + sizeof(uint16_t);
+        std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+        msg->pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce << static_cast<uint16_t>(NET_STALE);
+        m_comm.send_client(vto, from, RESP_GET, msg);
         return;
     }
 
-    m_sm.stop(from, vto, search_id);
+    respond_get(from, vto, nonce, key, aw);
 }
 
 void
-daemon :: process_req_sorted_search(server_id from,
-                                    virtual_server_id,
-                                    virtual_server_id vto,
-                                    std::auto_ptr<e::buffer> msg,
-                                    e::unpacker up)
+daemon :: respond_get(server_id from,
+                      virtual_server_id vto,
+                      uint64_t nonce,
+                      const e::slice& key,
+                      auth_wallet* aw)
+{
+    std::auto_ptr<e::buffer> msg;
+    region_id ri = config().get_region_id(vto);
+    m_hot_keys.touch(ri, key);
+    bool has_value = false;
+    std::vector<e::slice> value;
+    uint64_t version;
+    datalayer::reference ref;
+    network_returncode result;
+
+    switch (m_data.get(ri, key, &value, &version, &ref))
+    {
+        case datalayer::SUCCESS:
+            has_value = true;
+            result = NET_SUCCESS;
+            break;
+        case datalayer::NOT_FOUND:
+            result = NET_NOTFOUND;
+            break;
+        case datalayer::BAD_ENCODING:
+        case datalayer::CORRUPTION:
+        case datalayer::IO_ERROR:
+        case datalayer::LEVELDB_ERROR:
+        default:
+            LOG(ERROR) << "GET returned unacceptable error code.";
+            result = NET_SERVERERROR;
+            break;
+    }
+
+    const schema* sc = config().get_schema(ri);
+
+    if (has_value && is_expired(*sc, value, expiry_now()))
+    {
+        has_value = false;
+        result = NET_NOTFOUND;
+    }
+
+    if (!auth_verify_read(*sc, has_value, &value, aw))
+    {
+        size_t sz = HYPERDEX_HEADER_SIZE_VC
+                  + sizeof(uint64_t)
+                  + sizeof(uint16_t);
+        msg.reset(e::buffer::create(sz));
+        msg->pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce << static_cast<uint16_t>(NET_UNAUTHORIZED);
+    }
+    else if (result == NET_SUCCESS && !has_secrets(*sc))
+    {
+        // nothing to sanitize, so the stored attributes can go out as-is
+        // in one copy instead of being re-packed one slice at a time
+        e::slice attrs = ref.encoded_attrs();
+        size_t sz = HYPERDEX_HEADER_SIZE_VC
+                  + sizeof(uint64_t)
+                  + sizeof(uint16_t)
+                  + sizeof(uint32_t)
+                  + attrs.size();
+        msg.reset(e::buffer::create(sz));
+        msg->pack_at(HYPERDEX_HEADER_SIZE_VC)
+            << nonce << static_cast<uint16_t>(result)
+            << static_cast<uint32_t>(value.size())
+            << e::pack_memmove(attrs.data(), attrs.size());
+    }
+    else
+    {
+        sanitize_secrets(*sc, &value);
+        size_t sz = HYPERDEX_HEADER_SIZE_VC
+                  + sizeof(uint64_t)
+                  + sizeof(uint16_t)
+                  + pack_size(value);
+        msg.reset(e::buffer::create(sz));
+        e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
+        pa = pa << nonce << static_cast<uint16_t>(result);
+
+        if (result == NET_SUCCESS)
+        {
+            pa = pa << value;
+        }
+    }
+
+    m_comm.send_client(vto, from, RESP_GET, msg);
+}
+
+void
+daemon :: process_req_get_cached(server_id from,
+                                 virtual_server_id,
+                                 virtual_server_id vto,
+                                 std::auto_ptr<e::buffer> msg,
+                                 e::unpacker up)
 {
     uint64_t nonce;
-    std::vector<attribute_check> checks;
-    uint64_t limit;
-    uint16_t sort_by;
-    uint8_t flags;
+    uint64_t cached_version;
+    uint64_t cached_fingerprint;
+    e::slice key;
+    bool has_auth = false;
+    auth_wallet aw;
+    up = up >> nonce >> cached_version >> cached_fingerprint >> key;
 
-    if ((up >> nonce >> checks >> limit >> sort_by >> flags).error())
+    if (up.remain())
     {
-        LOG(WARNING) << "unpack of REQ_SORTED_SEARCH failed; here's some hex:  " << msg->hex();
+        has_auth = true;
+        up = up >> aw;
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of REQ_GET_CACHED failed; here's some hex:  " << msg->hex();
         return;
     }
 
-    m_sm.sorted_search(from, vto, nonce, &checks, limit, sort_by, flags & 0x1);
+    region_id ri = config().get_region_id(vto);
+    bool has_value = false;
+    std::vector<e::slice> value;
+    uint64_t version = 0;
+    datalayer::reference ref;
+    network_returncode result;
+
+    switch (m_data.get(ri, key, &value, &version, &ref))
+    {
+        case datalayer::SUCCESS:
+            has_value = true;
+            result = NET_SUCCESS;
+            break;
+        case datalayer::NOT_FOUND:
+            result = NET_NOTFOUND;
+            break;
+        case datalayer::BAD_ENCODING:
+        case datalayer::CORRUPTION:
+        case datalayer::IO_ERROR:
+        case datalayer::LEVELDB_ERROR:
+        default:
+            LOG(ERROR) << "GET returned unacceptable error code.";
+            result = NET_SERVERERROR;
+            break;
+    }
+
+    const schema* sc = config().get_schema(ri);
+
+    if (has_value && is_expired(*sc, value, expiry_now()))
+    {
+        has_value = false;
+        result = NET_NOTFOUND;
+    }
+
+    // versions restart when a key is deleted and put again, so the
+    // fingerprint of the stored attributes guards against a recreated
+    // object that happens to reach the version the client holds
+    uint64_t fingerprint = 0;
+
+    if (result == NET_SUCCESS)
+    {
+        e::slice attrs = ref.encoded_attrs();
+        fingerprint = CityHash64(reinterpret_cast<const char*>(attrs.data()), attrs.size());
+    }
+
+    if (!auth_verify_read(*sc, has_value, &value, has_auth ? &aw : NULL))
+    {
+        result = NET_UNAUTHORIZED;
+    }
+    else if (result == NET_SUCCESS &&
+             version == cached_version &&
+             fingerprint == cached_fingerprint)
+    {
+        result = NET_NOTMODIFIED;
+        m_perf_req_get_unmodified.tap();
+    }
+
+    size_t sz = HYPERDEX_HEADER_SIZE_VC
+              + sizeof(uint64_t)
+              + sizeof(uint16_t);
+
+    if (result == NET_SUCCESS)
+    {
+        sanitize_secrets(*sc, &value);
+        sz += 2 * sizeof(uint64_t) + pack_size(value);
+    }
+
+    msg.reset(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
+    pa = pa << nonce << static_cast<uint16_t>(result);
+
+    if (result == NET_SUCCESS)
+    {
+        pa = pa << version << fingerprint << value;
+    }
+
+    m_comm.send_client(vto, from, RESP_GET_CACHED, msg);
 }
 
 void
-daemon :: process_req_count(server_id from,
-                            virtual_server_id,
-                            virtual_server_id vto,
-                            std::auto_ptr<e::buffer> msg,
-                            e::unpacker up)
+daemon :: process_req_get_partial(server_id from,
+                                  virtual_server_id,
+                                  virtual_server_id vto,
+                                  std::auto_ptr<e::buffer> msg,
+                                  e::unpacker up)
 {
     uint64_t nonce;
-    std::vector<attribute_check> checks;
+    e::slice key;
+    std::vector<uint16_t> attrs;
+    bool has_auth = false;
+    auth_wallet aw;
+    up = up >> nonce >> key >> attrs;
 
-    if ((up >> nonce >> checks).error())
+    if (up.remain())
+    {
+        has_auth = true;
+        up = up >> aw;
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of REQ_GET_PARTIAL failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    region_id ri = config().get_region_id(vto);
+    const schema* sc = config().get_schema(ri);
+    std::sort(attrs.begin(), attrs.end());
+    // authorization needs the secret, even if the client did not ask for it
+    std::vector<uint16_t> project(attrs);
+
+    for (size_t i = 1; sc->authorization && i < sc->attrs_sz; ++i)
+    {
+        if (sc->attrs[i].type == HYPERDATATYPE_MACAROON_SECRET)
+        {
+            project.push_back(i);
+        }
+    }
+
+    // so is the expiry, which decides whether the object is there at all
+    if (sc->expiry != 0)
+    {
+        project.push_back(sc->expiry);
+    }
+
+    std::sort(project.begin(), project.end());
+    bool has_value = false;
+    std::vector<e::slice> value;
+    uint64_t version;
+    datalayer::reference ref;
+    network_returncode result;
+
+    switch (m_data.get_partial(ri, key, project, &value, &version, &ref))
+    {
+        case datalayer::SUCCESS:
+            has_value = true;
+            result = NET_SUCCESS;
+            break;
+        case datalayer::NOT_FOUND:
+            result = NET_NOTFOUND;
+            break;
+        case datalayer::BAD_ENCODING:
+        case datalayer::CORRUPTION:
+        case datalayer::IO_ERROR:
+        case datalayer::LEVELDB_ERROR:
+        default:
+            LOG(ERROR) << "GET returned unacceptable error code.";
+            result = NET_SERVERERROR;
+            break;
+    }
+
+    if (has_value && is_expired(*sc, value, expiry_now()))
+    {
+        has_value = false;
+        result = NET_NOTFOUND;
+    }
+
+    if (!auth_verify_read(*sc, has_value, &value, (has_auth ? &aw : NULL)))
+    {
+        size_t sz = HYPERDEX_HEADER_SIZE_VC
+                  + sizeof(uint64_t)
+                  + sizeof(uint16_t);
+        msg.reset(e::buffer::create(sz));
+        msg->pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce << static_cast<uint16_t>(NET_UNAUTHORIZED);
+    }
+    else
+    {
+        sanitize_secrets(*sc, &value);
+        // size the response for the projected attributes only
+        size_t sz = HYPERDEX_HEADER_SIZE_VC
+                  + sizeof(uint64_t)
+                  + sizeof(uint16_t);
+
+        for (size_t i = 0; result == NET_SUCCESS && i < value.size(); ++i)
+        {
+            if (std::binary_search(attrs.begin(), attrs.end(), uint16_t(i + 1)))
+            {
+                sz += sizeof(uint16_t) + pack_size(value[i]);
+            }
+        }
+
+        msg.reset(e::buffer::create(sz));
+        e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
+        pa = pa << nonce << static_cast<uint16_t>(result);
+
+        if (result == NET_SUCCESS)
+        {
+            for (size_t i = 0; i < value.size(); ++i)
+            {
+                uint16_t attr = i + 1;
+
+                if (std::binary_search(attrs.begin(), attrs.end(), attr))
+                {
+                    pa = pa << attr << value[i];
+                }
+            }
+        }
+    }
+
+    m_comm.send_client(vto, from, RESP_GET_PARTIAL, msg);
+}
+
+void
+daemon :: process_req_get_batch(server_id from,
+                                virtual_server_id,
+                                virtual_server_id vto,
+                                std::auto_ptr<e::buffer> msg,
+                                e::unpacker up)
+{
+    uint64_t nonce;
+    std::vector<e::slice> keys;
+    bool has_auth = false;
+    auth_wallet aw;
+    up = up >> nonce >> keys;
+
+    if (up.remain())
+    {
+        has_auth = true;
+        up = up >> aw;
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of REQ_GET_BATCH failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    region_id ri = config().get_region_id(vto);
+    const schema* sc = config().get_schema(ri);
+    const uint64_t now = expiry_now();
+    // sized once up front; the slices in values point into refs
+    std::vector<std::vector<e::slice> > values(keys.size());
+    std::vector<datalayer::reference> refs(keys.size());
+    std::vector<network_returncode> results(keys.size(), NET_SERVERERROR);
+    size_t sz = HYPERDEX_HEADER_SIZE_VC
+              + sizeof(uint64_t)
+              + sizeof(uint32_t);
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        bool has_value = false;
+        uint64_t version;
+
+        switch (m_data.get(ri, keys[i], &values[i], &version, &refs[i]))
+        {
+            case datalayer::SUCCESS:
+                has_value = true;
+                results[i] = NET_SUCCESS;
+                break;
+            case datalayer::NOT_FOUND:
+                results[i] = NET_NOTFOUND;
+                break;
+            case datalayer::BAD_ENCODING:
+            case datalayer::CORRUPTION:
+            case datalayer::IO_ERROR:
+            case datalayer::LEVELDB_ERROR:
+            default:
+                LOG(ERROR) << "GET_BATCH returned unacceptable error code.";
+                results[i] = NET_SERVERERROR;
+                break;
+        }
+
+        if (has_value && is_expired(*sc, values[i], now))
+        {
+            has_value = false;
+            results[i] = NET_NOTFOUND;
+        }
+
+        if (!auth_verify_read(*sc, has_value, &values[i], (has_auth ? &aw : NULL)))
+        {
+            results[i] = NET_UNAUTHORIZED;
+        }
+        else
+        {
+            sanitize_secrets(*sc, &values[i]);
+        }
+
+        sz += sizeof(uint16_t);
+
+        if (results[i] == NET_SUCCESS)
+        {
+            sz += pack_size(values[i]);
+        }
+    }
+
+    msg.reset(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
+    pa = pa << nonce << static_cast<uint32_t>(keys.size());
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        pa = pa << static_cast<uint16_t>(results[i]);
+
+        if (results[i] == NET_SUCCESS)
+        {
+            pa = pa << values[i];
+        }
+    }
+
+    m_comm.send_client(vto, from, RESP_GET_BATCH, msg);
+}
+
+void
+daemon :: process_req_get_versioned(server_id from,
+                                    virtual_server_id,
+                                    virtual_server_id vto,
+                                    std::auto_ptr<e::buffer> msg,
+                                    e::unpacker up)
+{
+    uint64_t nonce;
+    uint8_t with_values;
+    std::vector<e::slice> keys;
+    bool has_auth = false;
+    auth_wallet aw;
+    up = up >> nonce >> with_values >> keys;
+
+    if (up.remain())
+    {
+        has_auth = true;
+        up = up >> aw;
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of REQ_GET_VERSIONED failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    region_id ri = config().get_region_id(vto);
+    const schema* sc = config().get_schema(ri);
+    const uint64_t now = expiry_now();
+    std::vector<std::vector<e::slice> > values(keys.size());
+    std::vector<datalayer::reference> refs(keys.size());
+    std::vector<network_returncode> results(keys.size(), NET_SERVERERROR);
+    std::vector<uint64_t> versions(keys.size(), 0);
+    std::vector<uint8_t> busy(keys.size(), 0);
+    size_t sz = HYPERDEX_HEADER_SIZE_VC
+              + sizeof(uint64_t)
+              + 2 * sizeof(uint64_t)
+              + sizeof(uint32_t);
+
+    // A key that was absent at both reads may still have been written and
+    // deleted in between; the region handing out no version in between is
+    // what rules that out.  Clients compare the counts only for equality.
+    const uint64_t before = m_repl.versions_handed_out(ri);
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        bool has_value = false;
+        // a running state machine counts as writes in hand
+        uint64_t pending = 0;
+        busy[i] = !m_repl.pending_writes(ri, keys[i], &pending, NULL) || pending > 0 ? 1 : 0;
+
+        switch (m_data.get(ri, keys[i], &values[i], &versions[i], &refs[i]))
+        {
+            case datalayer::SUCCESS:
+                has_value = true;
+                results[i] = NET_SUCCESS;
+                break;
+            case datalayer::NOT_FOUND:
+                results[i] = NET_NOTFOUND;
+                break;
+            case datalayer::BAD_ENCODING:
+            case datalayer::CORRUPTION:
+            case datalayer::IO_ERROR:
+            case datalayer::LEVELDB_ERROR:
+            default:
+                LOG(ERROR) << "GET_VERSIONED returned unacceptable error code.";
+                results[i] = NET_SERVERERROR;
+                break;
+        }
+
+        if (has_value && is_expired(*sc, values[i], now))
+        {
+            has_value = false;
+            results[i] = NET_NOTFOUND;
+        }
+
+        if (!auth_verify_read(*sc, has_value, &values[i], (has_auth ? &aw : NULL)))
+        {
+            results[i] = NET_UNAUTHORIZED;
+        }
+        else
+        {
+            sanitize_secrets(*sc, &values[i]);
+        }
+
+        if (results[i] != NET_SUCCESS)
+        {
+            versions[i] = 0;
+        }
+
+        sz += sizeof(uint16_t) + sizeof(uint64_t) + sizeof(uint8_t);
+
+        if (with_values && results[i] == NET_SUCCESS)
+        {
+            sz += pack_size(values[i]);
+        }
+    }
+
+    const uint64_t after = m_repl.versions_handed_out(ri);
+    msg.reset(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
+    pa = pa << nonce << before << after << static_cast<uint32_t>(keys.size());
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        pa = pa << static_cast<uint16_t>(results[i]) << versions[i] << busy[i];
+
+        if (with_values && results[i] == NET_SUCCESS)
+        {
+            pa = pa << values[i];
+        }
+    }
+
+    m_comm.send_client(vto, from, RESP_GET_VERSIONED, msg);
+}
+
+void
+daemon :: process_req_atomic(server_id from,
+                             virtual_server_id,
+                             virtual_server_id vto,
+                             std::auto_ptr<e::buffer> msg,
+                             e::unpacker up)
+{
+    // initialize nonce from pseudo-random memory
+    uint64_t nonce;
+
+    std::auto_ptr<key_change> kc(new key_change());
+    up = up >> nonce >> *kc;
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of REQ_ATOMIC failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_repl.client_atomic(from, vto, nonce, kc, msg);
+}
+
+void
+daemon :: process_req_atomic_batch(server_id from,
+                                   virtual_server_id,
+                                   virtual_server_id,
+                                   std::auto_ptr<e::buffer> msg,
+                                   e::unpacker up)
+{
+    uint32_t count;
+    up = up >> count;
+
+    for (uint32_t i = 0; !up.error() && i < count; ++i)
+    {
+        uint64_t vidt;
+        e::slice body;
+        up = up >> vidt >> body;
+
+        if (up.error())
+        {
+            break;
+        }
+
+        virtual_server_id vto(vidt);
+        m_region_ops.tap(vto, REQ_ATOMIC, body.size());
+        m_perf_req_atomic_batched.tap();
+
+        // the client sent this op to the server it believed owned vto; if
+        // that changed, bounce it on its own as a lone REQ_ATOMIC would be
+        if (config().get_server_id(vto) != m_us)
+        {
+            if (body.size() < sizeof(uint64_t))
+            {
+                LOG(WARNING) << "dropping REQ_ATOMIC_BATCH entry without a nonce";
+                continue;
+            }
+
+            uint64_t nonce;
+            e::unpack64be(body.data(), &nonce);
+            size_t sz = HYPERDEX_HEADER_SIZE_VC + sizeof(uint64_t);
+            std::auto_ptr<e::buffer> bounce(e::buffer::create(sz));
+            bounce->pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce;
+            m_comm.send_client(virtual_server_id(UINT64_MAX), from, CONFIGMISMATCH, bounce);
+            continue;
+        }
+
+        // the replication manager hangs on to each op's buffer, so give every
+        // op one of its own that looks exactly like a lone REQ_ATOMIC
+        const uint8_t mt = static_cast<uint8_t>(REQ_ATOMIC);
+        size_t sz = HYPERDEX_HEADER_SIZE_SV + body.size();
+        std::auto_ptr<e::buffer> op(e::buffer::create(sz));
+        op->pack_at(0)
+            << e::pack_memmove(msg->data(), HYPERDEX_HEADER_SIZE_SV)
+            << e::pack_memmove(body.data(), body.size());
+        op->pack_at(BUSYBEE_HEADER_SIZE) << mt;
+        op->pack_at(HYPERDEX_HEADER_SIZE_SV - sizeof(uint64_t)) << vto;
+        e::unpacker op_up = op->unpack_from(HYPERDEX_HEADER_SIZE_SV);
+        process_req_atomic(from, virtual_server_id(), vto, op, op_up);
+        m_perf_req_atomic.tap();
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of REQ_ATOMIC_BATCH failed; here's some hex:  " << msg->hex();
+    }
+}
+
+void
+daemon :: process_req_search_start(server_id from,
+                                   virtual_server_id,
+                                   virtual_server_id vto,
+                                   std::auto_ptr<e::buffer> msg,
+                                   e::unpacker up,
+                                   uint64_t deadline,
+                                   const datalayer::snapshot* snap)
+{
+    uint64_t nonce;
+    uint64_t search_id;
+    std::vector<attribute_check> checks;
+    uint32_t max_objects = 0;
+    uint32_t max_bytes = 0;
+    uint64_t limit = 0;
+    uint8_t flags = 0;
+    uint64_t sample = 0;
+    uint64_t seed = 0;
+    up = up >> nonce >> search_id >> checks;
+
+    // clients that batch append their limits; older ones do not
+    if (up.remain())
+    {
+        up = up >> max_objects >> max_bytes;
+    }
+
+    if (up.remain())
+    {
+        up = up >> limit;
+    }
+
+    // and clients that can decompress batches say so
+    if (up.remain())
+    {
+        up = up >> flags;
+    }
+
+    // sampling searches append the sample threshold and its seed
+    if (up.remain())
+    {
+        up = up >> sample >> seed;
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of REQ_SEARCH_START failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    bool compress = (flags & 0x1) && compression_available();
+    m_sm.start(from, vto, msg, nonce, search_id, &checks, max_objects, max_bytes, limit, compress, sample, seed, deadline, snap);
+}
+
+void
+daemon :: process_req_search_next(server_id from,
+                                  virtual_server_id,
+                                  virtual_server_id vto,
+                                  std::auto_ptr<e::buffer> msg,
+                                  e::unpacker up,
+                                  uint64_t deadline)
+{
+    uint64_t nonce;
+    uint64_t search_id;
+    uint32_t max_objects = 0;
+    uint32_t max_bytes = 0;
+    up = up >> nonce >> search_id;
+
+    if (up.remain())
+    {
+        up = up >> max_objects >> max_bytes;
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of REQ_SEARCH_NEXT failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_sm.next(from, vto, nonce, search_id, max_objects, max_bytes, deadline);
+}
+
+void
+daemon :: process_req_search_stop(server_id from,
+                                  virtual_server_id,
+                                  virtual_server_id vto,
+                                  std::auto_ptr<e::buffer> msg,
+                                  e::unpacker up)
+{
+    uint64_t nonce;
+    uint64_t search_id;
+
+    if ((up >> nonce >> search_id).error())
+    {
+        LOG(WARNING) << "unpack of REQ_SEARCH_STOP failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_sm.stop(from, vto, search_id);
+}
+
+void
+daemon :: process_req_search_multi(server_id from,
+                                   virtual_server_id,
+                                   virtual_server_id,
+                                   std::auto_ptr<e::buffer> msg,
+                                   e::unpacker up,
+                                   uint64_t deadline)
+{
+    uint8_t _mt;
+    uint32_t count;
+    up = up >> _mt >> count;
+    const network_msgtype mt = static_cast<network_msgtype>(_mt);
+
+    if (up.error() ||
+        (mt != REQ_SEARCH_START && mt != REQ_SORTED_SEARCH && mt != REQ_COUNT))
+    {
+        LOG(WARNING) << "unpack of REQ_SEARCH_MULTI failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    // one snapshot for every region on a LevelDB instance, so that they
+    // agree with one another
+    std::map<size_t, datalayer::snapshot> snaps;
+
+    for (uint32_t i = 0; !up.error() && i < count; ++i)
+    {
+        uint64_t vidt;
+        e::slice body;
+        up = up >> vidt >> body;
+
+        if (up.error())
+        {
+            break;
+        }
+
+        virtual_server_id vto(vidt);
+        m_region_ops.tap(vto, mt, body.size());
+        m_perf_req_search_multi_regions.tap();
+
+        // as in REQ_ATOMIC_BATCH, bounce a region that moved on its own
+        if (config().get_server_id(vto) != m_us)
+        {
+            if (body.size() < sizeof(uint64_t))
+            {
+                LOG(WARNING) << "dropping REQ_SEARCH_MULTI entry without a nonce";
+                continue;
+            }
+
+            uint64_t nonce;
+            e::unpack64be(body.data(), &nonce);
+            size_t sz = HYPERDEX_HEADER_SIZE_VC + sizeof(uint64_t);
+            std::auto_ptr<e::buffer> bounce(e::buffer::create(sz));
+            bounce->pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce;
+            m_comm.send_client(virtual_server_id(UINT64_MAX), from, CONFIGMISMATCH, bounce);
+            continue;
+        }
+
+        // searches hang on to their request's buffer, so give every region
+        // one of its own that looks exactly like the lone request
+        size_t sz = HYPERDEX_HEADER_SIZE_SV + body.size();
+        std::auto_ptr<e::buffer> req(e::buffer::create(sz));
+        req->pack_at(0)
+            << e::pack_memmove(msg->data(), HYPERDEX_HEADER_SIZE_SV)
+            << e::pack_memmove(body.data(), body.size());
+        req->pack_at(BUSYBEE_HEADER_SIZE) << _mt;
+        req->pack_at(HYPERDEX_HEADER_SIZE_SV - sizeof(uint64_t)) << vto;
+        e::unpacker req_up = req->unpack_from(HYPERDEX_HEADER_SIZE_SV);
+
+        // charge the region's space as the lone request would have been
+        if (!admit(from, vto, mt, *req, req_up))
+        {
+            continue;
+        }
+
+        const region_id ri(config().get_region_id(vto));
+        const size_t shard = m_data.shard_of(ri);
+        std::map<size_t, datalayer::snapshot>::iterator snap = snaps.find(shard);
+
+        if (snap == snaps.end())
+        {
+            snap = snaps.insert(std::make_pair(shard, m_data.make_snapshot(ri))).first;
+        }
+
+        switch (mt)
+        {
+            case REQ_SEARCH_START:
+                process_req_search_start(from, virtual_server_id(), vto, req, req_up, deadline, &snap->second);
+                m_perf_req_search_start.tap();
+                break;
+            case REQ_SORTED_SEARCH:
+                process_req_sorted_search(from, virtual_server_id(), vto, req, req_up, deadline, &snap->second);
+                m_perf_req_sorted_search.tap();
+                break;
+            case REQ_COUNT:
+                process_req_count(from, virtual_server_id(), vto, req, req_up, deadline, &snap->second);
+                m_perf_req_count.tap();
+                break;
+            default:
+                abort();
+        }
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of REQ_SEARCH_MULTI failed; here's some hex:  " << msg->hex();
+    }
+}
+
+void
+daemon :: process_req_sorted_search(server_id from,
+                                    virtual_server_id,
+                                    virtual_server_id vto,
+                                    std::auto_ptr<e::buffer> msg,
+                                    e::unpacker up,
+                                    uint64_t deadline,
+                                    const datalayer::snapshot* snap)
+{
+    uint64_t nonce;
+    std::vector<attribute_check> checks;
+    uint64_t limit;
+    uint16_t sort_by;
+    uint8_t flags;
+    uint64_t search_id = 0;
+    uint32_t chunk = 0;
+    bool has_cursor = false;
+    e::slice cursor_attr;
+    e::slice cursor_key;
+    up = up >> nonce >> checks >> limit >> sort_by >> flags;
+
+    // clients that stream the results name the search and a chunk size
+    if (up.remain())
+    {
+        up = up >> search_id >> chunk;
+    }
+
+    // and, when resuming from an earlier page, where that page left off
+    if (up.remain())
+    {
+        has_cursor = true;
+        up = up >> cursor_attr >> cursor_key;
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of REQ_SORTED_SEARCH failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    // the second bit of flags says the client can decompress results
+    bool compress = (flags & 0x2) && compression_available();
+    m_sm.sorted_search(from, vto, nonce, &checks, limit, sort_by, flags & 0x1,
+                       search_id, chunk, compress,
+                       has_cursor ? &cursor_attr : NULL,
+                       has_cursor ? &cursor_key : NULL,
+                       deadline, snap);
+}
+
+void
+daemon :: process_req_sorted_search_next(server_id from,
+                                         virtual_server_id,
+                                         virtual_server_id vto,
+                                         std::auto_ptr<e::buffer> msg,
+                                         e::unpacker up)
+{
+    uint64_t nonce;
+    uint64_t search_id;
+
+    if ((up >> nonce >> search_id).error())
+    {
+        LOG(WARNING) << "unpack of REQ_SORTED_SEARCH_NEXT failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_sm.sorted_search_next(from, vto, nonce, search_id);
+}
+
+void
+daemon :: process_req_nearest_search(server_id from,
+                                     virtual_server_id,
+                                     virtual_server_id vto,
+                                     std::auto_ptr<e::buffer> msg,
+                                     e::unpacker up,
+                                     uint64_t deadline)
+{
+    uint64_t nonce;
+    std::vector<attribute_check> checks;
+    uint64_t limit;
+    uint16_t x_attr;
+    uint16_t y_attr;
+    e::slice x;
+    e::slice y;
+    up = up >> nonce >> checks >> limit >> x_attr >> x >> y_attr >> y;
+
+    if (up.error() || x.size() != sizeof(double) || y.size() != sizeof(double))
+    {
+        LOG(WARNING) << "unpack of REQ_NEAREST_SEARCH failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_sm.nearest_search(from, vto, nonce, &checks, limit,
+                        x_attr, datatype_float::unpack(x),
+                        y_attr, datatype_float::unpack(y),
+                        deadline);
+}
+
+void
+daemon :: process_req_count(server_id from,
+                            virtual_server_id,
+                            virtual_server_id vto,
+                            std::auto_ptr<e::buffer> msg,
+                            e::unpacker up,
+                            uint64_t deadline,
+                            const datalayer::snapshot* snap)
+{
+    uint64_t nonce;
+    std::vector<attribute_check> checks;
+
+    if ((up >> nonce >> checks).error())
+    {
+        LOG(WARNING) << "unpack of REQ_COUNT failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_sm.count(from, vto, nonce, &checks, deadline, snap);
+}
+
+void
+daemon :: process_req_approximate_count(server_id from,
+                                        virtual_server_id,
+                                        virtual_server_id vto,
+                                        std::auto_ptr<e::buffer> msg,
+                                        e::unpacker up,
+                                        uint64_t deadline)
+{
+    uint64_t nonce;
+    std::vector<attribute_check> checks;
+    uint64_t samples;
+
+    if ((up >> nonce >> checks >> samples).error())
+    {
+        LOG(WARNING) << "unpack of REQ_APPROXIMATE_COUNT failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_sm.approximate_count(from, vto, nonce, &checks, samples, deadline);
+}
+
+void
+daemon :: process_req_aggregate(server_id from,
+                                virtual_server_id,
+                                virtual_server_id vto,
+                                std::auto_ptr<e::buffer> msg,
+                                e::unpacker up,
+                                uint64_t deadline)
+{
+    uint64_t nonce;
+    std::vector<attribute_check> checks;
+    uint16_t group_by;
+    std::vector<std::pair<uint16_t, uint8_t> > aggs;
+
+    if ((up >> nonce >> checks >> group_by >> aggs).error())
+    {
+        LOG(WARNING) << "unpack of REQ_AGGREGATE failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_sm.aggregate(from, vto, nonce, &checks, group_by, aggs, deadline);
+}
+
+void
+daemon :: process_req_search_describe(server_id from,
+                                      virtual_server_id,
+                                      virtual_server_id vto,
+                                      std::auto_ptr<e::buffer> msg,
+                                      e::unpacker up,
+                                      uint64_t deadline)
+{
+    uint64_t nonce;
+    std::vector<attribute_check> checks;
+
+    if ((up >> nonce >> checks).error())
+    {
+        LOG(WARNING) << "unpack of REQ_SEARCH_DESCRIBE failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_sm.search_describe(from, vto, nonce, &checks, deadline);
+}
+
+void
+daemon :: process_req_changes_start(server_id from,
+                                    virtual_server_id,
+                                    virtual_server_id vto,
+                                    std::auto_ptr<e::buffer> msg,
+                                    e::unpacker up)
+{
+    uint64_t nonce;
+    uint64_t stream_id;
+    uint64_t checkpoint;
+    uint32_t max_objects;
+    uint32_t max_bytes;
+    uint8_t can_decompress = 0;
+
+    if ((up >> nonce >> stream_id >> checkpoint >> max_objects >> max_bytes).error())
+    {
+        LOG(WARNING) << "unpack of REQ_CHANGES_START failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    // older clients do not say whether they can decompress
+    if (up.remain() && (up >> can_decompress).error())
+    {
+        LOG(WARNING) << "unpack of REQ_CHANGES_START failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    bool compress = can_decompress && compression_available();
+    m_sm.changes_start(from, vto, nonce, stream_id, checkpoint, max_objects, max_bytes, compress);
+}
+
+void
+daemon :: process_req_changes_next(server_id from,
+                                   virtual_server_id,
+                                   virtual_server_id vto,
+                                   std::auto_ptr<e::buffer> msg,
+                                   e::unpacker up)
+{
+    uint64_t nonce;
+    uint64_t stream_id;
+    uint32_t max_objects;
+    uint32_t max_bytes;
+
+    if ((up >> nonce >> stream_id >> max_objects >> max_bytes).error())
+    {
+        LOG(WARNING) << "unpack of REQ_CHANGES_NEXT failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_sm.changes_next(from, vto, nonce, stream_id, max_objects, max_bytes);
+}
+
+void
+daemon :: process_req_changes_stop(server_id from,
+                                   virtual_server_id,
+                                   virtual_server_id vto,
+                                   std::auto_ptr<e::buffer> msg,
+                                   e::unpacker up)
+{
+    uint64_t nonce;
+    uint64_t stream_id;
+
+    if ((up >> nonce >> stream_id).error())
+    {
+        LOG(WARNING) << "unpack of REQ_CHANGES_STOP failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_sm.changes_stop(from, vto, stream_id);
+}
+
+void
+daemon :: process_req_group_atomic(server_id from,
+                                   virtual_server_id,
+                                   virtual_server_id vto,
+                                   std::auto_ptr<e::buffer> msg,
+                                   e::unpacker up)
+{
+    uint64_t nonce;
+    std::vector<attribute_check> checks;
+    up = up >> nonce >> checks;
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of REQ_GROUP_ATOMIC failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    // Only forward the actual atomic operation
+    e::slice sl = up.remainder();
+    m_sm.group_keyop(from, vto, nonce, &checks, REQ_ATOMIC, sl, RESP_GROUP_ATOMIC);
+}
+
+void
+daemon :: process_chain_op(server_id,
+                           virtual_server_id vfrom,
+                           virtual_server_id vto,
+                           std::auto_ptr<e::buffer> msg,
+                           e::unpacker up)
+{
+    uint8_t flags;
+    uint64_t old_version;
+    uint64_t new_version;
+    e::slice key;
+    std::vector<e::slice> value;
+    e::slice delta;
+    up = up >> flags >> old_version >> new_version >> key;
+
+    // a delta carries the funcs that make the value in place of the value
+    if ((flags & 4))
+    {
+        up = up >> delta;
+    }
+    else
+    {
+        up = up >> value;
+    }
+
+    // a traced op carries its trace id after everything else
+    uint64_t trace_id = 0;
+
+    if (!up.error() && up.remain() >= sizeof(uint64_t))
+    {
+        up = up >> trace_id;
+    }
+
+    if (up.error() || ((flags & 4) && delta.empty()))
+    {
+        LOG(WARNING) << "unpack of CHAIN_OP failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    bool fresh = flags & 1;
+    bool has_value = flags & 2;
+    m_repl.chain_op(vfrom, vto, old_version, new_version, fresh, has_value, key, value, delta, msg, trace_id);
+}
+
+void
+daemon :: process_chain_op_batch(server_id from,
+                                 virtual_server_id vfrom,
+                                 virtual_server_id vto,
+                                 std::auto_ptr<e::buffer> msg,
+                                 e::unpacker up)
+{
+    uint32_t count;
+    up = up >> count;
+
+    for (uint32_t i = 0; !up.error() && i < count; ++i)
+    {
+        e::slice body;
+        up = up >> body;
+
+        if (up.error())
+        {
+            break;
+        }
+
+        // the replication manager hangs on to each op's buffer, so give every
+        // op one of its own that looks exactly like a lone CHAIN_OP
+        size_t sz = HYPERDEX_HEADER_SIZE_VV + body.size();
+        std::auto_ptr<e::buffer> op(e::buffer::create(sz));
+        op->pack_at(0)
+            << e::pack_memmove(msg->data(), HYPERDEX_HEADER_SIZE_VV)
+            << e::pack_memmove(body.data(), body.size());
+        e::unpacker op_up = op->unpack_from(HYPERDEX_HEADER_SIZE_VV);
+        process_chain_op(from, vfrom, vto, op, op_up);
+        m_perf_chain_op.tap();
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of CHAIN_OP_BATCH failed; here's some hex:  " << msg->hex();
+    }
+}
+
+void
+daemon :: process_chain_subspace(server_id,
+                                 virtual_server_id vfrom,
+                                 virtual_server_id vto,
+                                 std::auto_ptr<e::buffer> msg,
+                                 e::unpacker up)
+{
+    uint64_t old_version;
+    uint64_t new_version;
+    e::slice key;
+    std::vector<e::slice> value;
+    region_id prev_region;
+    region_id this_old_region;
+    region_id this_new_region;
+    region_id next_region;
+
+    uint64_t trace_id = 0;
+    up = up >> old_version >> new_version >> key >> value
+            >> prev_region >> this_old_region >> this_new_region >> next_region;
+
+    if (!up.error() && up.remain() >= sizeof(uint64_t))
+    {
+        up = up >> trace_id;
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of CHAIN_SUBSPACE failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_repl.chain_subspace(vfrom, vto, old_version, new_version, key, value, msg,
+                          prev_region, this_old_region, this_new_region, next_region,
+                          trace_id);
+}
+
+void
+daemon :: process_chain_ack(server_id,
+                            virtual_server_id vfrom,
+                            virtual_server_id vto,
+                            std::auto_ptr<e::buffer> msg,
+                            e::unpacker up)
+{
+    uint64_t version;
+    e::slice key;
+
+    if ((up >> version >> key).error())
+    {
+        LOG(WARNING) << "unpack of CHAIN_ACK failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_repl.chain_ack(vfrom, vto, version, key);
+}
+
+void
+daemon :: process_chain_ack_batch(server_id,
+                                  virtual_server_id vfrom,
+                                  virtual_server_id vto,
+                                  std::auto_ptr<e::buffer> msg,
+                                  e::unpacker up)
+{
+    uint32_t count;
+    up = up >> count;
+
+    // acks do not hold on to their message, so fan them out in place
+    for (uint32_t i = 0; !up.error() && i < count; ++i)
+    {
+        e::slice body;
+        up = up >> body;
+
+        if (up.error())
+        {
+            break;
+        }
+
+        e::unpacker ack(reinterpret_cast<const char*>(body.data()), body.size());
+        uint64_t version;
+        e::slice key;
+
+        if ((ack >> version >> key).error())
+        {
+            LOG(WARNING) << "unpack of CHAIN_ACK_BATCH failed; here's some hex:  " << msg->hex();
+            return;
+        }
+
+        m_repl.chain_ack(vfrom, vto, version, key);
+        m_perf_chain_ack.tap();
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of CHAIN_ACK_BATCH failed; here's some hex:  " << msg->hex();
+    }
+}
+
+void
+daemon :: process_xfer_handshake_syn(server_id,
+                                     virtual_server_id vfrom,
+                                     virtual_server_id,
+                                     std::auto_ptr<e::buffer> msg,
+                                     e::unpacker up)
+{
+    transfer_id xid;
+    uint8_t flags = 0;
+    up = up >> xid;
+
+    if (up.remain())
+    {
+        up = up >> flags;
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of XFER_HS failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    bool compress = flags & 1;
+    m_stm.handshake_syn(vfrom, xid, compress);
+}
+
+void
+daemon :: process_xfer_handshake_synack(server_id from,
+                                        virtual_server_id,
+                                        virtual_server_id to,
+                                        std::auto_ptr<e::buffer> msg,
+                                        e::unpacker up)
+{
+    transfer_id xid;
+    uint64_t timestamp;
+    uint8_t flags = 0;
+    up = up >> xid >> timestamp;
+
+    if (up.remain())
+    {
+        up = up >> flags;
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of XFER_HSA failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    bool compress = flags & 1;
+    m_stm.handshake_synack(from, to, xid, timestamp, compress);
+}
+
+void
+daemon :: process_xfer_handshake_ack(server_id,
+                                     virtual_server_id vfrom,
+                                     virtual_server_id,
+                                     std::auto_ptr<e::buffer> msg,
+                                     e::unpacker up)
+{
+    transfer_id xid;
+    uint8_t flags;
+
+    if ((up >> xid >> flags).error())
+    {
+        LOG(WARNING) << "unpack of XFER_HA failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    bool wipe = flags & 0x1;
+    m_stm.handshake_ack(vfrom, xid, wipe);
+}
+
+void
+daemon :: process_xfer_handshake_wiped(server_id from,
+                                       virtual_server_id,
+                                       virtual_server_id to,
+                                       std::auto_ptr<e::buffer> msg,
+                                       e::unpacker up)
+{
+    transfer_id xid;
+
+    if ((up >> xid).error())
+    {
+        LOG(WARNING) << "unpack of XFER_HW failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    m_stm.handshake_wiped(from, to, xid);
+}
+
+void
+daemon :: process_xfer_op(server_id,
+                          virtual_server_id vfrom,
+                          virtual_server_id,
+                          std::auto_ptr<e::buffer> msg,
+                          e::unpacker up)
+{
+    uint8_t flags;
+    uint64_t xid;
+    uint64_t seq_no;
+    uint64_t version;
+    e::slice key;
+    std::vector<e::slice> value;
+
+    if ((up >> flags >> xid >> seq_no >> version >> key >> value).error())
+    {
+        LOG(WARNING) << "unpack of XFER_OP failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    bool has_value = flags & 1;
+    m_stm.xfer_op(vfrom, transfer_id(xid), seq_no, has_value, version, msg, key, value, true);
+}
+
+void
+daemon :: process_xfer_op_batch(server_id,
+                                virtual_server_id vfrom,
+                                virtual_server_id,
+                                std::auto_ptr<e::buffer> msg,
+                                e::unpacker up)
+{
+    uint32_t count;
+    up = up >> count;
+
+    for (uint32_t i = 0; !up.error() && i < count; ++i)
+    {
+        e::slice body;
+        up = up >> body;
+
+        if (up.error())
+        {
+            break;
+        }
+
+        // queued objects hold on to their buffer, so each gets its own
+        std::auto_ptr<e::buffer> op(e::buffer::create(body.size()));
+        op->pack_at(0) << e::pack_memmove(body.data(), body.size());
+        uint8_t flags;
+        uint64_t xid;
+        uint64_t seq_no;
+        uint64_t version;
+        e::slice key;
+        std::vector<e::slice> value;
+
+        if ((op->unpack_from(0) >> flags >> xid >> seq_no >> version >> key >> value).error())
+        {
+            LOG(WARNING) << "unpack of XFER_OP_BATCH failed; here's some hex:  " << msg->hex();
+            return;
+        }
+
+        // one cumulative ack for the whole batch
+        bool has_value = flags & 1;
+        bool ack = i + 1 == count;
+        m_stm.xfer_op(vfrom, transfer_id(xid), seq_no, has_value, version, op, key, value, ack);
+        m_perf_xfer_op.tap();
+    }
+
+    if (up.error())
+    {
+        LOG(WARNING) << "unpack of XFER_OP_BATCH failed; here's some hex:  " << msg->hex();
+    }
+}
+
+void
+daemon :: process_xfer_op_compressed(server_id from,
+                                     virtual_server_id vfrom,
+                                     virtual_server_id vto,
+                                     std::auto_ptr<e::buffer> msg,
+                                     e::unpacker up)
+{
+    uint32_t raw_size;
+    e::slice compressed;
+    std::vector<char> raw;
+
+    if ((up >> raw_size >> compressed).error() ||
+        raw_size > XFER_MAX_DECOMPRESSED_BYTES ||
+        !decompress(compressed, raw_size, &raw))
+    {
+        LOG(WARNING) << "unpack of XFER_OP_COMPRESSED failed; here's some hex:  " << msg->hex();
+        return;
+    }
+
+    // rebuild the XFER_OP_BATCH it was made from
+    size_t sz = HYPERDEX_HEADER_SIZE_VV + raw.size();
+    std::auto_ptr<e::buffer> batch(e::buffer::create(sz));
+    batch->pack_at(0)
+        << e::pack_memmove(msg->data(), HYPERDEX_HEADER_SIZE_VV)
+        << e::pack_memmove(&raw[0], raw.size());
+    e::unpacker batch_up = batch->unpack_from(HYPERDEX_HEADER_SIZE_VV);
+    process_xfer_op_batch(from, vfrom, vto, batch, batch_up);
+}
+
+void
+daemon :: process_xfer_ack(server_id from,
+                           virtual_server_id,
+                           virtual_server_id vto,
+                           std::auto_ptr<e::buffer> msg,
+                           e::unpacker up)
+{
+    uint8_t flags;
+    uint64_t xid;
+    uint64_t seq_no;
+
+    if ((up >> flags >> xid >> seq_no).error())
     {
-        LOG(WARNING) << "unpack of REQ_COUNT failed; here's some hex:  " << msg->hex();
+        LOG(WARNING) << "unpack of XFER_ACK failed; here's some hex:  " << msg->hex();
         return;
     }
 
-    m_sm.count(from, vto, nonce, &checks);
+    m_stm.xfer_ack(from, vto, transfer_id(xid), seq_no);
 }
 
 void
-daemon :: process_req_search_describe(server_id from,
-                                      virtual_server_id,
-                                      virtual_server_id vto,
-                                      std::auto_ptr<e::buffer> msg,
-                                      e::unpacker up)
+daemon :: process_backup(server_id from,
+                         virtual_server_id,
+                         virtual_server_id vto,
+                         std::auto_ptr<e::buffer> msg,
+                         e::unpacker up)
 {
     uint64_t nonce;
-    std::vector<attribute_check> checks;
+    e::slice _name;
 
-    if ((up >> nonce >> checks).error())
+    if ((up >> nonce >> _name).error() ||
+        strnlen(reinterpret_cast<const char*>(_name.data()), _name.size()) == _name.size())
     {
-        LOG(WARNING) << "unpack of REQ_SEARCH_DESCRIBE failed; here's some hex:  " << msg->hex();
+        LOG(WARNING) << "unpack of BACKUP failed; here's some hex:  " << msg->hex();
         return;
     }
 
-    m_sm.search_describe(from, vto, nonce, &checks);
+    std::string name(reinterpret_cast<const char*>(_name.data()));
+    network_returncode result = NET_SUCCESS;
+
+    if (!m_data.backup(e::slice(name)))
+    {
+        result = NET_SERVERERROR;
+    }
+    else
+    {
+        LOG(INFO) << "Backup succeeded and is available in the directory \"backup-"
+                  << e::strescape(name) << "\" within the data directory."
+                  << "  Copy the complete directory to elsewhere so your backup is safe.";
+    }
+
+    using po6::path::join;
+    std::string _path(join(m_data_dir, "backup-" + name));
+
+    if (!po6::path::realpath(_path, &_path))
+    {
+        // XXX
+    }
+
+    e::slice path(_path.c_str());
+
+    size_t sz = HYPERDEX_HEADER_SIZE_VC
+              + sizeof(uint64_t)
+              + sizeof(uint16_t)
+              + pack_size(path);
+    msg.reset(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
+    pa = pa << nonce << static_cast<uint16_t>(result) << path;
+    m_comm.send_client(vto, from, BACKUP, msg);
 }
 
 void
-daemon :: process_req_group_atomic(server_id from,
-                                   virtual_server_id,
-                                   virtual_server_id vto,
-                                   std::auto_ptr<e::buffer> msg,
-                                   e::unpacker up)
+daemon :: process_perf_counters(server_id from,
+                                virtual_server_id,
+                                virtual_server_id vto,
+                                std::auto_ptr<e::buffer> msg,
+                                e::unpacker up)
 {
     uint64_t nonce;
-    std::vector<attribute_check> checks;
-    up = up >> nonce >> checks;
+    uint64_t when;
+    up = up >> nonce >> when;
 
     if (up.error())
     {
-        LOG(WARNING) << "unpack of REQ_GROUP_ATOMIC failed; here's some hex:  " << msg->hex();
+        LOG(WARNING) << "unpack of PERF_COUNTERS failed; here's some hex:  " << msg->hex();
         return;
     }
 
-    // Only forward the actual atomic operation
-    e::slice sl = up.remainder();
-    m_sm.group_keyop(from, vto, nonce, &checks, REQ_ATOMIC, sl, RESP_GROUP_ATOMIC);
+    std::string out;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect_stats);
+        std::list<std::pair<uint64_t, std::string> >::iterator it;
+        it = m_stats.begin();
+
+        while (it != m_stats.end() && it->first <= when)
+        {
+            ++it;
+        }
+
+        if (it == m_stats.begin())
+        {
+            std::ostringstream ret;
+            ret << m_stats_start << " reset=" << m_stats_start << "\n";
+            out += ret.str();
+        }
+
+        while (it != m_stats.end())
+        {
+            out += it->second;
+            ++it;
+        }
+    }
+
+    size_t sz = HYPERDEX_HEADER_SIZE_VC
+              + sizeof(uint64_t)
+              + out.size() + 1;
+    msg.reset(e::buffer::create(sz));
+    msg->pack_at(HYPERDEX_HEADER_SIZE_VC)
+        << nonce << e::pack_memmove(out.c_str(), out.size() + 1);
+    m_comm.send_client(vto, from, PERF_COUNTERS, msg);
 }
 
 void
-daemon :: process_chain_op(server_id,
-                           virtual_server_id vfrom,
+daemon :: process_hot_keys(server_id from,
+                           virtual_server_id,
                            virtual_server_id vto,
                            std::auto_ptr<e::buffer> msg,
                            e::unpacker up)
 {
-    uint8_t flags;
-    uint64_t old_version;
-    uint64_t new_version;
-    e::slice key;
-    std::vector<e::slice> value;
+    uint64_t nonce;
+    up = up >> nonce;
 
-    if ((up >> flags >> old_version >> new_version >> key >> value).error())
+    if (up.error())
     {
-        LOG(WARNING) << "unpack of CHAIN_OP failed; here's some hex:  " << msg->hex();
+        LOG(WARNING) << "unpack of HOT_KEYS failed; here's some hex:  " << msg->hex();
         return;
     }
 
-    bool fresh = flags & 1;
-    bool has_value = flags & 2;
-    m_repl.chain_op(vfrom, vto, old_version, new_version, fresh, has_value, key, value, msg);
-}
-
-void
-daemon :: process_chain_subspace(server_id,
-                                 virtual_server_id vfrom,
-                                 virtual_server_id vto,
-                                 std::auto_ptr<e::buffer> msg,
-                                 e::unpacker up)
-{
-    uint64_t old_version;
-    uint64_t new_version;
-    e::slice key;
-    std::vector<e::slice> value;
-    region_id prev_region;
-    region_id this_old_region;
-    region_id this_new_region;
-    region_id next_region;
+    std::vector<hot_keys::entry> entries;
+    m_hot_keys.top(&entries);
+    size_t sz = HYPERDEX_HEADER_SIZE_VC
+              + sizeof(uint64_t)
+              + sizeof(uint16_t)
+              + sizeof(uint32_t);
 
-    if ((up >> old_version >> new_version >> key >> value >>
-               prev_region >> this_old_region >> this_new_region >> next_region).error())
+    for (size_t i = 0; i < entries.size(); ++i)
     {
-        LOG(WARNING) << "unpack of CHAIN_SUBSPACE failed; here's some hex:  " << msg->hex();
-        return;
+        sz += 2 * sizeof(uint64_t) + pack_size(e::slice(entries[i].key));
     }
 
-    m_repl.chain_subspace(vfrom, vto, old_version, new_version, key, value, msg,
-                          prev_region, this_old_region, this_new_region, next_region);
-}
-
-void
-daemon :: process_chain_ack(server_id,
-                            virtual_server_id vfrom,
-                            virtual_server_id vto,
-                            std::auto_ptr<e::buffer> msg,
-                            e::unpacker up)
-{
-    uint64_t version;
-    e::slice key;
+    msg.reset(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
+    pa = pa << nonce << static_cast<uint16_t>(NET_SUCCESS)
+            << static_cast<uint32_t>(entries.size());
 
-    if ((up >> version >> key).error())
+    for (size_t i = 0; i < entries.size(); ++i)
     {
-        LOG(WARNING) << "unpack of CHAIN_ACK failed; here's some hex:  " << msg->hex();
-        return;
+        pa = pa << entries[i].region.get()
+                << e::slice(entries[i].key)
+                << entries[i].count;
     }
 
-    m_repl.chain_ack(vfrom, vto, version, key);
+    m_comm.send_client(vto, from, HOT_KEYS, msg);
 }
 
 void
-daemon :: process_xfer_handshake_syn(server_id,
-                                     virtual_server_id vfrom,
-                                     virtual_server_id,
-                                     std::auto_ptr<e::buffer> msg,
-                                     e::unpacker up)
+daemon :: process_profile(server_id from,
+                          virtual_server_id,
+                          virtual_server_id vto,
+                          std::auto_ptr<e::buffer> msg,
+                          e::unpacker up)
 {
-    transfer_id xid;
+    uint64_t nonce;
+    uint32_t seconds;
+    up = up >> nonce >> seconds;
 
-    if ((up >> xid).error())
+    if (up.error())
     {
-        LOG(WARNING) << "unpack of XFER_HS failed; here's some hex:  " << msg->hex();
+        LOG(WARNING) << "unpack of PROFILE failed; here's some hex:  " << msg->hex();
         return;
     }
 
-    m_stm.handshake_syn(vfrom, xid);
+    // the profile thread replies once the window closes
+    if (!m_profile_thread.enqueue(from, vto, nonce, seconds))
+    {
+        LOG(WARNING) << "refusing to profile while another profile runs";
+        send_profile(from, vto, nonce, NET_SERVERERROR, 0, 0, std::string());
+    }
 }
 
 void
-daemon :: process_xfer_handshake_synack(server_id from,
-                                        virtual_server_id,
-                                        virtual_server_id to,
-                                        std::auto_ptr<e::buffer> msg,
-                                        e::unpacker up)
+daemon :: send_profile(server_id to,
+                       virtual_server_id vfrom,
+                       uint64_t nonce,
+                       network_returncode rc,
+                       uint64_t samples,
+                       uint64_t dropped,
+                       const std::string& folded)
 {
-    transfer_id xid;
-    uint64_t timestamp;
-
-    if ((up >> xid >> timestamp).error())
-    {
-        LOG(WARNING) << "unpack of XFER_HSA failed; here's some hex:  " << msg->hex();
-        return;
-    }
-
-    m_stm.handshake_synack(from, to, xid, timestamp);
+    e::slice f(folded);
+    size_t sz = HYPERDEX_HEADER_SIZE_VC
+              + sizeof(uint64_t)
+              + sizeof(uint16_t)
+              + 2 * sizeof(uint64_t)
+              + pack_size(f);
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    msg->pack_at(HYPERDEX_HEADER_SIZE_VC)
+        << nonce << static_cast<uint16_t>(rc)
+        << samples << dropped << f;
+    m_comm.send_client(vfrom, to, PROFILE, msg);
 }
 
 void
-daemon :: process_xfer_handshake_ack(server_id,
-                                     virtual_server_id vfrom,
-                                     virtual_server_id,
-                                     std::auto_ptr<e::buffer> msg,
-                                     e::unpacker up)
+daemon :: process_export(server_id from,
+                         virtual_server_id,
+                         virtual_server_id vto,
+                         std::auto_ptr<e::buffer> msg,
+                         e::unpacker up)
 {
-    transfer_id xid;
+    uint64_t nonce;
+    e::slice _space;
+    e::slice _name;
+    uint64_t rate;
     uint8_t flags;
+    up = up >> nonce >> _space >> _name >> rate >> flags;
 
-    if ((up >> xid >> flags).error())
+    if (up.error() ||
+        strnlen(reinterpret_cast<const char*>(_space.data()), _space.size()) == _space.size() ||
+        strnlen(reinterpret_cast<const char*>(_name.data()), _name.size()) == _name.size())
     {
-        LOG(WARNING) << "unpack of XFER_HA failed; here's some hex:  " << msg->hex();
+        LOG(WARNING) << "unpack of EXPORT failed; here's some hex:  " << msg->hex();
         return;
     }
 
-    bool wipe = flags & 0x1;
-    m_stm.handshake_ack(vfrom, xid, wipe);
-}
-
-void
-daemon :: process_xfer_handshake_wiped(server_id from,
-                                       virtual_server_id,
-                                       virtual_server_id to,
-                                       std::auto_ptr<e::buffer> msg,
-                                       e::unpacker up)
-{
-    transfer_id xid;
+    std::string space(reinterpret_cast<const char*>(_space.data()));
+    std::string name(reinterpret_cast<const char*>(_name.data()));
 
-    if ((up >> xid).error())
+    // the export lands in a directory of its own within the data directory
+    if (name.empty() || name[0] == '.' || name.find('/') != std::string::npos)
     {
-        LOG(WARNING) << "unpack of XFER_HW failed; here's some hex:  " << msg->hex();
+        LOG(WARNING) << "refusing to export to \"" << e::strescape(name) << "\"";
+        send_export(from, vto, nonce, NET_SERVERERROR, std::string(), 0, 0);
         return;
     }
 
-    m_stm.handshake_wiped(from, to, xid);
+    // the export thread replies once every region is written
+    if (!m_export_thread.enqueue(from, vto, nonce, space, name, rate, flags & 1))
+    {
+        LOG(WARNING) << "refusing to export while another export runs";
+        send_export(from, vto, nonce, NET_SERVERERROR, std::string(), 0, 0);
+    }
 }
 
 void
-daemon :: process_xfer_op(server_id,
-                          virtual_server_id vfrom,
-                          virtual_server_id,
-                          std::auto_ptr<e::buffer> msg,
-                          e::unpacker up)
+daemon :: send_export(server_id to,
+                      virtual_server_id vfrom,
+                      uint64_t nonce,
+                      network_returncode rc,
+                      const std::string& path,
+                      uint64_t objects,
+                      uint64_t bytes)
+{
+    e::slice p(path);
+    size_t sz = HYPERDEX_HEADER_SIZE_VC
+              + sizeof(uint64_t)
+              + sizeof(uint16_t)
+              + pack_size(p)
+              + 2 * sizeof(uint64_t);
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    msg->pack_at(HYPERDEX_HEADER_SIZE_VC)
+        << nonce << static_cast<uint16_t>(rc)
+        << p << objects << bytes;
+    m_comm.send_client(vfrom, to, EXPORT, msg);
+}
+
+void
+daemon :: process_maintenance(server_id from,
+                              virtual_server_id,
+                              virtual_server_id vto,
+                              std::auto_ptr<e::buffer> msg,
+                              e::unpacker up)
 {
+    uint64_t nonce;
     uint8_t flags;
-    uint64_t xid;
-    uint64_t seq_no;
-    uint64_t version;
-    e::slice key;
-    std::vector<e::slice> value;
+    uint16_t start;
+    uint16_t end;
+    uint64_t budget;
+    region_id ri;
+    up = up >> nonce >> flags >> start >> end >> budget >> ri;
 
-    if ((up >> flags >> xid >> seq_no >> version >> key >> value).error())
+    if (up.error())
     {
-        LOG(WARNING) << "unpack of XFER_OP failed; here's some hex:  " << msg->hex();
+        LOG(WARNING) << "unpack of MAINTENANCE failed; here's some hex:  " << msg->hex();
         return;
     }
 
-    bool has_value = flags & 1;
-    m_stm.xfer_op(vfrom, transfer_id(xid), seq_no, has_value, version, msg, key, value);
+    network_returncode rc = NET_SUCCESS;
+
+    // bit 0 sets the window and budget; bit 1 compacts the region
+    if ((flags & 1) && !m_data.set_maintenance(start, end, budget))
+    {
+        LOG(WARNING) << "refusing a maintenance window of " << start << "-" << end << " minutes";
+        rc = NET_BADDIMSPEC;
+    }
+
+    if (rc == NET_SUCCESS && (flags & 2))
+    {
+        // the compactor thread does the work, so this replies at once
+        if (config().get_virtual(ri, m_us) == virtual_server_id())
+        {
+            rc = NET_NOTFOUND;
+        }
+        else if (m_data.request_compaction(ri))
+        {
+            LOG(INFO) << "compaction of " << ri << " requested";
+        }
+    }
+
+    m_data.get_maintenance(&start, &end, &budget);
+    size_t sz = HYPERDEX_HEADER_SIZE_VC
+              + sizeof(uint64_t)
+              + sizeof(uint16_t)
+              + 2 * sizeof(uint16_t)
+              + sizeof(uint64_t);
+    std::auto_ptr<e::buffer> resp(e::buffer::create(sz));
+    resp->pack_at(HYPERDEX_HEADER_SIZE_VC)
+        << nonce << static_cast<uint16_t>(rc)
+        << start << end << budget;
+    m_comm.send_client(vto, from, MAINTENANCE, resp);
 }
 
 void
-daemon :: process_xfer_ack(server_id from,
-                           virtual_server_id,
-                           virtual_server_id vto,
-                           std::auto_ptr<e::buffer> msg,
-                           e::unpacker up)
+daemon :: report_load()
 {
-    uint8_t flags;
-    uint64_t xid;
-    uint64_t seq_no;
+    std::vector<region_id> rids;
+    std::vector<uint64_t> ops;
+    m_region_ops.rates(po6::monotonic_time(), &rids, &ops);
+    std::vector<uint64_t> bytes;
 
-    if ((up >> flags >> xid >> seq_no).error())
+    for (size_t i = 0; i < rids.size(); ++i)
     {
-        LOG(WARNING) << "unpack of XFER_ACK failed; here's some hex:  " << msg->hex();
-        return;
+        bytes.push_back(m_data.approximate_size(rids[i]));
     }
 
-    m_stm.xfer_ack(from, vto, transfer_id(xid), seq_no);
+    m_coord->report_load(rids, bytes, ops);
+}
+
+static bool
+hotter(const std::pair<uint64_t, hyperdex::region_id>& lhs,
+       const std::pair<uint64_t, hyperdex::region_id>& rhs)
+{
+    return lhs.first > rhs.first;
 }
 
 void
-daemon :: process_backup(server_id from,
-                         virtual_server_id,
-                         virtual_server_id vto,
-                         std::auto_ptr<e::buffer> msg,
-                         e::unpacker up)
+daemon :: save_prefetch_list()
 {
-    uint64_t nonce;
-    e::slice _name;
+    std::vector<region_id> rids;
+    std::vector<uint64_t> counters;
+    m_region_ops.totals(&rids, &counters);
+    std::vector<std::pair<uint64_t, region_id> > heat;
 
-    if ((up >> nonce >> _name).error() ||
-        strnlen(reinterpret_cast<const char*>(_name.data()), _name.size()) == _name.size())
+    for (size_t i = 0; i < rids.size(); ++i)
     {
-        LOG(WARNING) << "unpack of BACKUP failed; here's some hex:  " << msg->hex();
-        return;
-    }
+        const uint64_t* c = &counters[i * region_op_counter::NUM_COUNTERS];
+        uint64_t reads = c[region_op_counter::READS]
+                       + c[region_op_counter::SEARCH_SCANNED];
 
-    std::string name(reinterpret_cast<const char*>(_name.data()));
-    network_returncode result = NET_SUCCESS;
+        if (reads > 0)
+        {
+            heat.push_back(std::make_pair(reads, rids[i]));
+        }
+    }
 
-    if (!m_data.backup(e::slice(name)))
+    // an idle run has nothing better to offer than the list already saved
+    if (heat.empty())
     {
-        result = NET_SERVERERROR;
+        return;
     }
-    else
+
+    std::stable_sort(heat.begin(), heat.end(), hotter);
+    std::vector<region_id> regions;
+
+    for (size_t i = 0; i < heat.size(); ++i)
     {
-        LOG(INFO) << "Backup succeeded and is available in the directory \"backup-"
-                  << e::strescape(name) << "\" within the data directory."
-                  << "  Copy the complete directory to elsewhere so your backup is safe.";
+        regions.push_back(heat[i].second);
     }
 
-    using po6::path::join;
-    std::string _path(join(m_data_dir, "backup-" + name));
+    std::vector<hot_keys::entry> entries;
+    m_hot_keys.top(&entries);
+    std::vector<std::pair<region_id, std::string> > keys;
 
-    if (!po6::path::realpath(_path, &_path))
+    for (size_t i = 0; i < entries.size(); ++i)
     {
-        // XXX
+        keys.push_back(std::make_pair(entries[i].region, entries[i].key));
     }
 
-    e::slice path(_path.c_str());
-
-    size_t sz = HYPERDEX_HEADER_SIZE_VC
-              + sizeof(uint64_t)
-              + sizeof(uint16_t)
-              + pack_size(path);
-    msg.reset(e::buffer::create(sz));
-    e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
-    pa = pa << nonce << static_cast<uint16_t>(result) << path;
-    m_comm.send_client(vto, from, BACKUP, msg);
+    m_data.save_prefetch_list(regions, keys);
 }
 
+// how often, in nanoseconds, a point leader sweeps its regions for expired
+// objects to delete
+#define EXPIRY_SWEEP_INTERVAL (10ULL * 1000000000ULL)
+
 void
-daemon :: process_perf_counters(server_id from,
-                                virtual_server_id,
-                                virtual_server_id vto,
-                                std::auto_ptr<e::buffer> msg,
-                                e::unpacker up)
+daemon :: sweep_expired()
 {
-    uint64_t nonce;
-    uint64_t when;
-    up = up >> nonce >> when;
+    uint64_t target = po6::monotonic_time() + EXPIRY_SWEEP_INTERVAL;
+    // the sweep reads the configuration, like collect_stats
+    e::garbage_collector::thread_state ts;
+    m_gc.register_thread(&ts);
 
-    if (up.error())
+    while (__sync_fetch_and_add(&s_interrupts, 0) == 0)
     {
-        LOG(WARNING) << "unpack of PERF_COUNTERS failed; here's some hex:  " << msg->hex();
-        return;
+        m_gc.quiescent_state(&ts);
+        uint64_t now = po6::monotonic_time();
+
+        if (now < target)
+        {
+            struct timespec ts;
+            ts.tv_sec = 0;
+            ts.tv_nsec = std::min(target - now, (uint64_t)50000000UL);
+            nanosleep(&ts, NULL);
+            continue;
+        }
+
+        std::vector<region_id> regions;
+        config().point_leaders(m_us, &regions);
+
+        for (size_t i = 0; i < regions.size(); ++i)
+        {
+            const schema* sc = config().get_schema(regions[i]);
+
+            if (sc && sc->expiry != 0 && !sc->immutable)
+            {
+                m_sm.reclaim_expired(regions[i]);
+            }
+        }
+
+        m_sm.reap_idle();
+        target = po6::monotonic_time() + EXPIRY_SWEEP_INTERVAL;
     }
 
-    std::string out;
+    m_gc.deregister_thread(&ts);
+}
 
+#define COLD_MIGRATE_INTERVAL (60ULL * 1000000000ULL)
+
+void
+daemon :: migrate_cold()
+{
+    uint64_t target = po6::monotonic_time() + COLD_MIGRATE_INTERVAL;
+
+    while (__sync_fetch_and_add(&s_interrupts, 0) == 0)
     {
-        po6::threads::mutex::hold hold(&m_protect_stats);
-        std::list<std::pair<uint64_t, std::string> >::iterator it;
-        it = m_stats.begin();
+        uint64_t now = po6::monotonic_time();
 
-        while (it != m_stats.end() && it->first <= when)
+        if (now < target)
         {
-            ++it;
+            struct timespec ts;
+            ts.tv_sec = 0;
+            ts.tv_nsec = std::min(target - now, (uint64_t)50000000UL);
+            nanosleep(&ts, NULL);
+            continue;
         }
 
-        if (it == m_stats.begin())
+        m_data.migrate_cold_tables();
+        m_data.collect_value_log();
+        target = po6::monotonic_time() + COLD_MIGRATE_INTERVAL;
+    }
+}
+
+// how often, in nanoseconds, a daemon looks for regions of spaces that
+// became immutable since it last compacted them
+#define IMMUTABLE_COMPACT_INTERVAL (10ULL * 1000000000ULL)
+
+void
+daemon :: compact_immutable()
+{
+    uint64_t target = po6::monotonic_time() + IMMUTABLE_COMPACT_INTERVAL;
+    // regions already compacted; a region leaves the set once its space is
+    // made mutable, so that making it immutable again compacts it anew
+    std::set<region_id> compacted;
+    e::garbage_collector::thread_state ts;
+    m_gc.register_thread(&ts);
+
+    while (__sync_fetch_and_add(&s_interrupts, 0) == 0)
+    {
+        m_gc.quiescent_state(&ts);
+        m_data.maintain();
+        uint64_t now = po6::monotonic_time();
+
+        if (now < target)
         {
-            std::ostringstream ret;
-            ret << m_stats_start << " reset=" << m_stats_start << "\n";
-            out += ret.str();
+            struct timespec ts;
+            ts.tv_sec = 0;
+            ts.tv_nsec = std::min(target - now, (uint64_t)50000000UL);
+            nanosleep(&ts, NULL);
+            continue;
         }
 
-        while (it != m_stats.end())
+        std::vector<region_id> regions;
+        config().mapped_regions(m_us, &regions);
+        std::set<region_id> next;
+
+        for (size_t i = 0; i < regions.size(); ++i)
         {
-            out += it->second;
-            ++it;
+            const schema* sc = config().get_schema(regions[i]);
+
+            if (!sc || !sc->immutable)
+            {
+                continue;
+            }
+
+            if (compacted.find(regions[i]) == compacted.end())
+            {
+                m_data.compact_region(regions[i]);
+                LOG(INFO) << "compacted " << regions[i] << " of an immutable space for reads";
+            }
+
+            next.insert(regions[i]);
         }
+
+        compacted.swap(next);
+        target = po6::monotonic_time() + IMMUTABLE_COMPACT_INTERVAL;
     }
 
-    size_t sz = HYPERDEX_HEADER_SIZE_VC
-              + sizeof(uint64_t)
-              + out.size() + 1;
-    msg.reset(e::buffer::create(sz));
-    msg->pack_at(HYPERDEX_HEADER_SIZE_VC)
-        << nonce << e::pack_memmove(out.c_str(), out.size() + 1);
-    m_comm.send_client(vto, from, PERF_COUNTERS, msg);
+    m_gc.deregister_thread(&ts);
 }
 
 #define INTERVAL 100000000ULL
@@ -1328,8 +3477,13 @@ daemon :: collect_stats()
         m_stats_start = target;
     }
 
+    // collect_stats_regions reads the configuration
+    e::garbage_collector::thread_state ts;
+    m_gc.register_thread(&ts);
+
     while (__sync_fetch_and_add(&s_interrupts, 0) == 0)
     {
+        m_gc.quiescent_state(&ts);
         // every INTERVAL nanoseconds collect stats
         uint64_t now = po6::monotonic_time();
 
@@ -1346,10 +3500,21 @@ daemon :: collect_stats()
         std::ostringstream ret;
         ret << target;
         collect_stats_msgs(&ret);
+        collect_stats_latency(&ret);
         collect_stats_leveldb(&ret);
         collect_stats_io(&ret);
+        collect_stats_regions(&ret);
+        collect_stats_searches(&ret);
+        collect_stats_memory(&ret);
+
+        if (lock_profile::sample() > 0)
+        {
+            collect_stats_locks(&ret);
+        }
+
         ret << "\n";
         std::string out = ret.str();
+        m_metrics.publish(out);
 
         po6::threads::mutex::hold hold(&m_protect_stats);
         m_stats.push_back(std::make_pair(target, out));
@@ -1362,6 +3527,8 @@ daemon :: collect_stats()
         // next interval
         target += INTERVAL;
     }
+
+    m_gc.deregister_thread(&ts);
 }
 
 void
@@ -1369,20 +3536,156 @@ daemon :: collect_stats_msgs(std::ostringstream* ret)
 {
     *ret << " msgs.req_get=" << m_perf_req_get.read();
     *ret << " msgs.req_get_partial=" << m_perf_req_get_partial.read();
+    *ret << " msgs.req_get_batch=" << m_perf_req_get_batch.read();
+    *ret << " msgs.req_get_relaxed=" << m_perf_req_get_relaxed.read();
+    *ret << " msgs.req_get_cached=" << m_perf_req_get_cached.read();
+    *ret << " msgs.req_get_versioned=" << m_perf_req_get_versioned.read();
     *ret << " msgs.req_atomic=" << m_perf_req_atomic.read();
+    *ret << " msgs.req_atomic_batch=" << m_perf_req_atomic_batch.read();
     *ret << " msgs.req_search_start=" << m_perf_req_search_start.read();
     *ret << " msgs.req_search_next=" << m_perf_req_search_next.read();
     *ret << " msgs.req_search_stop=" << m_perf_req_search_stop.read();
+    *ret << " msgs.req_search_multi=" << m_perf_req_search_multi.read();
     *ret << " msgs.req_sorted_search=" << m_perf_req_sorted_search.read();
+    *ret << " msgs.req_sorted_search_next=" << m_perf_req_sorted_search_next.read();
+    *ret << " msgs.req_nearest_search=" << m_perf_req_nearest_search.read();
     *ret << " msgs.req_count=" << m_perf_req_count.read();
+    *ret << " msgs.req_approximate_count=" << m_perf_req_approximate_count.read();
+    *ret << " msgs.req_aggregate=" << m_perf_req_aggregate.read();
     *ret << " msgs.req_search_describe=" << m_perf_req_search_describe.read();
+    *ret << " msgs.req_changes_start=" << m_perf_req_changes_start.read();
+    *ret << " msgs.req_changes_next=" << m_perf_req_changes_next.read();
+    *ret << " msgs.req_changes_stop=" << m_perf_req_changes_stop.read();
     *ret << " msgs.req_group_atomic=" << m_perf_req_group_atomic.read();
     *ret << " msgs.chain_op=" << m_perf_chain_op.read();
+    *ret << " msgs.chain_op_batch=" << m_perf_chain_op_batch.read();
     *ret << " msgs.chain_subspace=" << m_perf_chain_subspace.read();
     *ret << " msgs.chain_ack=" << m_perf_chain_ack.read();
+    *ret << " msgs.chain_ack_batch=" << m_perf_chain_ack_batch.read();
     *ret << " msgs.xfer_op=" << m_perf_xfer_op.read();
+    *ret << " msgs.xfer_op_batch=" << m_perf_xfer_op_batch.read();
+    *ret << " msgs.xfer_op_compressed=" << m_perf_xfer_op_compressed.read();
     *ret << " msgs.xfer_ack=" << m_perf_xfer_ack.read();
     *ret << " msgs.perf_counters=" << m_perf_perf_counters.read();
+    *ret << " msgs.hot_keys=" << m_perf_hot_keys.read();
+    *ret << " msgs.profile=" << m_perf_profile.read();
+    *ret << " msgs.export=" << m_perf_export.read();
+    *ret << " msgs.maintenance=" << m_perf_maintenance.read();
+    *ret << " chain_batch.messages=" << m_comm.chain_batches();
+    *ret << " chain_batch.ops=" << m_comm.chain_batched_ops();
+    *ret << " chain_ack_batch.messages=" << m_comm.chain_ack_batches();
+    *ret << " chain_ack_batch.acks=" << m_comm.chain_batched_acks();
+    uint64_t early_queued = 0;
+    uint64_t early_bytes = 0;
+    uint64_t early_held = 0;
+    uint64_t early_delivered = 0;
+    uint64_t early_refused = 0;
+    m_comm.early_message_stats(&early_queued, &early_bytes,
+                               &early_held, &early_delivered, &early_refused);
+    *ret << " early_messages.queued=" << early_queued;
+    *ret << " early_messages.bytes=" << early_bytes;
+    *ret << " early_messages.held=" << early_held;
+    *ret << " early_messages.delivered=" << early_delivered;
+    *ret << " early_messages.refused=" << early_refused;
+    *ret << " atomic_batch.ops=" << m_perf_req_atomic_batched.read();
+    *ret << " search_multi.regions=" << m_perf_req_search_multi_regions.read();
+    *ret << " get_cached.unmodified=" << m_perf_req_get_unmodified.read();
+    *ret << " deadline.expired=" << m_perf_req_expired.read();
+    *ret << " quota.throttled=" << m_perf_req_throttled.read();
+    uint64_t retransmits = 0;
+    uint64_t retransmit_timeouts = 0;
+    uint64_t retransmits_deferred = 0;
+    m_repl.retransmit_stats(&retransmits, &retransmit_timeouts, &retransmits_deferred);
+    *ret << " retransmit.ops=" << retransmits;
+    *ret << " retransmit.timeouts=" << retransmit_timeouts;
+    *ret << " retransmit.deferred=" << retransmits_deferred;
+    uint64_t key_states = 0;
+    uint64_t key_states_largest_shard = 0;
+    uint64_t key_states_retries = 0;
+    m_repl.key_state_stats(&key_states, &key_states_largest_shard, &key_states_retries);
+    *ret << " key_states.count=" << key_states;
+    *ret << " key_states.largest_shard=" << key_states_largest_shard;
+    *ret << " key_states.retries=" << key_states_retries;
+    *ret << " key_states.early_rejects=" << m_repl.early_rejects();
+    uint64_t xfer_objects = 0;
+    uint64_t xfer_batches = 0;
+    uint64_t xfer_bytes = 0;
+    uint64_t xfer_bytes_acked = 0;
+    uint64_t xfer_throttled = 0;
+    uint64_t xfer_rate_limit = 0;
+    m_stm.xfer_stats(&xfer_objects, &xfer_batches, &xfer_bytes, &xfer_bytes_acked,
+                     &xfer_throttled, &xfer_rate_limit);
+    *ret << " xfer.objects=" << xfer_objects;
+    *ret << " xfer.batches=" << xfer_batches;
+    *ret << " xfer.bytes=" << xfer_bytes;
+    *ret << " xfer.bytes_acked=" << xfer_bytes_acked;
+    *ret << " xfer.throttled=" << xfer_throttled;
+    *ret << " xfer.rate_limit=" << xfer_rate_limit;
+    uint64_t xfer_compressed_raw = 0;
+    uint64_t xfer_compressed_bytes = 0;
+    m_stm.compression_stats(&xfer_compressed_raw, &xfer_compressed_bytes);
+    *ret << " xfer.compressed_raw=" << xfer_compressed_raw;
+    *ret << " xfer.compressed_bytes=" << xfer_compressed_bytes;
+    m_stm.progress_stats(ret);
+}
+
+namespace
+{
+
+void
+report_latency(std::ostringstream* ret, const char* name, latency_histogram* lat)
+{
+    std::vector<uint64_t> counts;
+    lat->interval(&counts);
+    uint64_t count = 0;
+
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        count += counts[i];
+    }
+
+    *ret << " lat." << name << ".count=" << count;
+    *ret << " lat." << name << ".p50=" << latency_histogram::percentile(counts, 50, 100);
+    *ret << " lat." << name << ".p99=" << latency_histogram::percentile(counts, 99, 100);
+    *ret << " lat." << name << ".p999=" << latency_histogram::percentile(counts, 999, 1000);
+}
+
+} // namespace
+
+void
+daemon :: collect_stats_latency(std::ostringstream* ret)
+{
+    report_latency(ret, "req_get", &m_lat_req_get);
+    report_latency(ret, "req_get_partial", &m_lat_req_get_partial);
+    report_latency(ret, "req_get_batch", &m_lat_req_get_batch);
+    report_latency(ret, "req_get_relaxed", &m_lat_req_get_relaxed);
+    report_latency(ret, "req_get_cached", &m_lat_req_get_cached);
+    report_latency(ret, "req_get_versioned", &m_lat_req_get_versioned);
+    report_latency(ret, "req_atomic", &m_lat_req_atomic);
+    report_latency(ret, "req_search_start", &m_lat_req_search_start);
+    report_latency(ret, "req_search_next", &m_lat_req_search_next);
+    report_latency(ret, "req_search_stop", &m_lat_req_search_stop);
+    report_latency(ret, "req_sorted_search", &m_lat_req_sorted_search);
+    report_latency(ret, "req_sorted_search_next", &m_lat_req_sorted_search_next);
+    report_latency(ret, "req_nearest_search", &m_lat_req_nearest_search);
+    report_latency(ret, "req_count", &m_lat_req_count);
+    report_latency(ret, "req_approximate_count", &m_lat_req_approximate_count);
+    report_latency(ret, "req_aggregate", &m_lat_req_aggregate);
+    report_latency(ret, "req_search_describe", &m_lat_req_search_describe);
+    report_latency(ret, "req_changes_start", &m_lat_req_changes_start);
+    report_latency(ret, "req_changes_next", &m_lat_req_changes_next);
+    report_latency(ret, "req_changes_stop", &m_lat_req_changes_stop);
+    report_latency(ret, "req_group_atomic", &m_lat_req_group_atomic);
+    report_latency(ret, "chain_op", &m_lat_chain_op);
+    report_latency(ret, "chain_op_batch", &m_lat_chain_op_batch);
+    report_latency(ret, "chain_subspace", &m_lat_chain_subspace);
+    report_latency(ret, "chain_ack", &m_lat_chain_ack);
+    report_latency(ret, "chain_ack_batch", &m_lat_chain_ack_batch);
+    report_latency(ret, "early_message_wait", m_comm.early_message_wait());
+    report_latency(ret, "write_async", m_data.write_latency(DURABILITY_ASYNC));
+    report_latency(ret, "write_sync", m_data.write_latency(DURABILITY_SYNC));
+    report_latency(ret, "write_group", m_data.write_latency(DURABILITY_GROUP));
+    report_latency(ret, "write_memory", m_data.write_latency(DURABILITY_MEMORY));
 }
 
 namespace
@@ -1398,12 +3701,75 @@ struct leveldb_stat
     uint64_t write;
 };
 
+// LevelDB compacts level 0 once it holds this many files, and each level
+// after it once it outgrows ten times the level before, starting at 10MB
+#define LEVELDB_L0_COMPACTION_TRIGGER 4
+#define LEVELDB_L1_BYTES (10ULL * 1048576ULL)
+
+// an estimate of the bytes compaction must move before every level is back
+// within its size; it grows ahead of the stalls that follow from it
+uint64_t
+compaction_debt(const leveldb_stat* stats, size_t stats_sz)
+{
+    uint64_t debt = 0;
+
+    if (stats_sz > 0 && stats[0].files >= LEVELDB_L0_COMPACTION_TRIGGER)
+    {
+        debt += stats[0].size;
+    }
+
+    uint64_t limit = LEVELDB_L1_BYTES;
+
+    for (size_t i = 1; i < stats_sz; ++i)
+    {
+        if (stats[i].size > limit)
+        {
+            debt += stats[i].size - limit;
+        }
+
+        limit *= 10;
+    }
+
+    return debt;
+}
+
 } // namespace
 
 void
 daemon :: collect_stats_leveldb(std::ostringstream* ret)
 {
     *ret << " leveldb.size=" << m_data.approximate_size();
+    uint64_t cache_hits = 0;
+    uint64_t cache_misses = 0;
+    uint64_t cache_bytes = 0;
+    m_data.cache_stats(&cache_hits, &cache_misses, &cache_bytes);
+    *ret << " object_cache.hits=" << cache_hits;
+    *ret << " object_cache.misses=" << cache_misses;
+    *ret << " object_cache.bytes=" << cache_bytes;
+    uint64_t warm_hits = 0;
+    uint64_t warm_misses = 0;
+    uint64_t warm_bytes = 0;
+    m_data.warm_cache_stats(&warm_hits, &warm_misses, &warm_bytes);
+    *ret << " warm_cache.hits=" << warm_hits;
+    *ret << " warm_cache.misses=" << warm_misses;
+    *ret << " warm_cache.bytes=" << warm_bytes;
+    uint64_t group_writes = 0;
+    uint64_t group_batches = 0;
+    m_data.group_commit_stats(&group_writes, &group_batches);
+    *ret << " group_commit.writes=" << group_writes;
+    *ret << " group_commit.batches=" << group_batches;
+    uint64_t plan_hits = 0;
+    uint64_t plan_misses = 0;
+    m_data.plan_cache_stats(&plan_hits, &plan_misses);
+    *ret << " plan_cache.hits=" << plan_hits;
+    *ret << " plan_cache.misses=" << plan_misses;
+    uint64_t index_objects = 0;
+    uint64_t index_bytes = 0;
+    uint64_t index_pending = 0;
+    m_data.indexer_stats(&index_objects, &index_bytes, &index_pending);
+    *ret << " indexer.objects=" << index_objects;
+    *ret << " indexer.bytes=" << index_bytes;
+    *ret << " indexer.pending=" << index_pending;
     std::string tmp;
 
     if (m_data.get_property(e::slice("leveldb.stats"), &tmp))
@@ -1439,6 +3805,8 @@ daemon :: collect_stats_leveldb(std::ostringstream* ret)
             ptr = eol + 1;
         }
 
+        leveldb_stat total;
+
         for (size_t i = 0; i < 7; ++i)
         {
             *ret << " leveldb.files" << i << "=" << stats[i].files;
@@ -1446,8 +3814,98 @@ daemon :: collect_stats_leveldb(std::ostringstream* ret)
             *ret << " leveldb.time" << i << "=" << stats[i].time;
             *ret << " leveldb.read" << i << "=" << stats[i].read;
             *ret << " leveldb.write" << i << "=" << stats[i].write;
+            total.files += stats[i].files;
+            total.time += stats[i].time;
+            total.read += stats[i].read;
+            total.write += stats[i].write;
         }
+
+        *ret << " leveldb.files=" << total.files;
+        *ret << " leveldb.compaction_time=" << total.time;
+        *ret << " leveldb.compaction_read=" << total.read;
+        *ret << " leveldb.compaction_write=" << total.write;
+        *ret << " leveldb.compaction_debt=" << compaction_debt(stats, 7);
+    }
+
+    // not every LevelDB knows this property
+    if (m_data.get_property(e::slice("leveldb.approximate-memory-usage"), &tmp))
+    {
+        *ret << " leveldb.memory=" << strtoull(tmp.c_str(), NULL, 10);
     }
+
+    uint64_t block_hits = 0;
+    uint64_t block_misses = 0;
+    m_data.block_cache_stats(&block_hits, &block_misses);
+    *ret << " block_cache.hits=" << block_hits;
+    *ret << " block_cache.misses=" << block_misses;
+    uint64_t bloom_checks = 0;
+    uint64_t bloom_negatives = 0;
+    m_data.filter_stats(&bloom_checks, &bloom_negatives);
+    *ret << " bloom.checks=" << bloom_checks;
+    *ret << " bloom.negatives=" << bloom_negatives;
+    uint64_t cold_hits = 0;
+    uint64_t cold_misses = 0;
+    uint64_t cold_tables = 0;
+    uint64_t cold_bytes = 0;
+    m_data.cold_tier_stats(&cold_hits, &cold_misses, &cold_tables, &cold_bytes);
+    *ret << " cold_block_cache.hits=" << cold_hits;
+    *ret << " cold_block_cache.misses=" << cold_misses;
+    *ret << " cold_tier.migrated_tables=" << cold_tables;
+    *ret << " cold_tier.migrated_bytes=" << cold_bytes;
+    uint64_t vlog_segments = 0;
+    uint64_t vlog_bytes = 0;
+    uint64_t vlog_live = 0;
+    uint64_t vlog_reclaimed = 0;
+    m_data.value_log_stats(&vlog_segments, &vlog_bytes, &vlog_live, &vlog_reclaimed);
+    *ret << " value_log.segments=" << vlog_segments;
+    *ret << " value_log.bytes=" << vlog_bytes;
+    *ret << " value_log.live_bytes=" << vlog_live;
+    *ret << " value_log.reclaimed_segments=" << vlog_reclaimed;
+    uint64_t dictionaries = 0;
+    uint64_t compress_raw = 0;
+    uint64_t compress_stored = 0;
+    m_data.compression_stats(&dictionaries, &compress_raw, &compress_stored);
+    *ret << " compression.dictionaries=" << dictionaries;
+    *ret << " compression.raw_bytes=" << compress_raw;
+    *ret << " compression.stored_bytes=" << compress_stored;
+    uint64_t index_filters = 0;
+    uint64_t index_filter_bytes = 0;
+    uint64_t index_filter_negatives = 0;
+    m_data.index_filter_stats(&index_filters, &index_filter_bytes, &index_filter_negatives);
+    *ret << " index_filter.filters=" << index_filters;
+    *ret << " index_filter.bytes=" << index_filter_bytes;
+    *ret << " index_filter.negatives=" << index_filter_negatives;
+    uint64_t stalls = 0;
+    uint64_t stall_time = 0;
+    m_data.write_stall_stats(&stalls, &stall_time);
+    *ret << " write_stall.count=" << stalls;
+    *ret << " write_stall.time=" << stall_time;
+    uint64_t l0_files = 0;
+    uint64_t debt = 0;
+    uint64_t pressure = 0;
+    m_data.compaction_stats(&l0_files, &debt, &pressure);
+    *ret << " compaction.l0_files=" << l0_files;
+    *ret << " compaction.debt=" << debt;
+    *ret << " compaction.pressure=" << pressure;
+    *ret << " compaction.throttled=" << m_perf_compaction_throttled.read();
+    *ret << " compaction.throttle_time=" << m_perf_compaction_throttle_time.read();
+    uint64_t checkpoint_records = 0;
+    uint64_t checkpoint_backlog = 0;
+    uint64_t checkpoint_collected = 0;
+    uint64_t checkpoint_gc_time = 0;
+    m_data.checkpoint_stats(&checkpoint_records, &checkpoint_backlog,
+                            &checkpoint_collected, &checkpoint_gc_time);
+    *ret << " checkpoints.records=" << checkpoint_records;
+    *ret << " checkpoints.backlog=" << checkpoint_backlog;
+    *ret << " checkpoints.collected=" << checkpoint_collected;
+    *ret << " checkpoints.gc_time=" << checkpoint_gc_time;
+    uint64_t maintenance_bytes = 0;
+    uint64_t maintenance_slept = 0;
+    uint64_t maintenance_compactions = 0;
+    m_data.maintenance_stats(&maintenance_bytes, &maintenance_slept, &maintenance_compactions);
+    *ret << " maintenance.bytes=" << maintenance_bytes;
+    *ret << " maintenance.throttle_time=" << maintenance_slept;
+    *ret << " maintenance.compactions=" << maintenance_compactions;
 }
 
 namespace
@@ -1630,3 +4088,125 @@ daemon :: collect_stats_io(std::ostringstream* ret)
         *ret << " io.time_in_queue=" << time_in_queue;
     }
 }
+
+void
+daemon :: collect_stats_regions(std::ostringstream* ret)
+{
+    std::vector<region_id> rids;
+    std::vector<uint64_t> counters;
+    m_region_ops.totals(&rids, &counters);
+    const configuration& c(config());
+    const size_t N = region_op_counter::NUM_COUNTERS;
+    // sum the regions of each space, in the order spaces first appear
+    std::vector<std::pair<std::string, std::vector<uint64_t> > > spaces;
+
+    for (size_t i = 0; i < rids.size(); ++i)
+    {
+        for (size_t j = 0; j < N; ++j)
+        {
+            region_op_counter::counter_t ct = static_cast<region_op_counter::counter_t>(j);
+            *ret << " region." << rids[i].get() << "." << region_op_counter::name(ct)
+                 << "=" << counters[i * N + j];
+        }
+
+        const char* name = c.get_space_name(rids[i]);
+
+        if (!name)
+        {
+            continue;
+        }
+
+        size_t s = 0;
+
+        while (s < spaces.size() && spaces[s].first != name)
+        {
+            ++s;
+        }
+
+        if (s == spaces.size())
+        {
+            spaces.push_back(std::make_pair(std::string(name), std::vector<uint64_t>(N, 0)));
+        }
+
+        for (size_t j = 0; j < N; ++j)
+        {
+            spaces[s].second[j] += counters[i * N + j];
+        }
+    }
+
+    for (size_t s = 0; s < spaces.size(); ++s)
+    {
+        for (size_t j = 0; j < N; ++j)
+        {
+            region_op_counter::counter_t ct = static_cast<region_op_counter::counter_t>(j);
+            *ret << " space." << spaces[s].first << "." << region_op_counter::name(ct)
+                 << "=" << spaces[s].second[j];
+        }
+    }
+}
+
+void
+daemon :: collect_stats_searches(std::ostringstream* ret)
+{
+    uint64_t open = 0;
+    uint64_t oldest = 0;
+    uint64_t reaped = 0;
+    uint64_t evicted = 0;
+    m_sm.open_stats(&open, &oldest, &reaped, &evicted);
+    *ret << " search.open=" << open;
+    *ret << " search.oldest_snapshot_age=" << oldest;
+    *ret << " search.reaped_idle=" << reaped;
+    *ret << " search.evicted=" << evicted;
+}
+
+void
+daemon :: collect_stats_locks(std::ostringstream* ret)
+{
+    for (int i = 0; i < lock_profile::NUM_CLASSES; ++i)
+    {
+        lock_profile::class_t c = static_cast<lock_profile::class_t>(i);
+        uint64_t acquired = 0;
+        uint64_t contended = 0;
+        uint64_t wait = 0;
+        uint64_t hold = 0;
+        lock_profile::stats(c, &acquired, &contended, &wait, &hold);
+        *ret << " lock." << lock_profile::name(c) << ".acquired=" << acquired;
+        *ret << " lock." << lock_profile::name(c) << ".contended=" << contended;
+        *ret << " lock." << lock_profile::name(c) << ".wait=" << wait;
+
+        if (c != lock_profile::KEY_STATE_HANDOFF)
+        {
+            *ret << " lock." << lock_profile::name(c) << ".hold=" << hold;
+        }
+    }
+}
+
+void
+daemon :: collect_stats_memory(std::ostringstream* ret)
+{
+    for (int i = 0; i < memory_accounting::NUM_CATEGORIES; ++i)
+    {
+        memory_accounting::category_t c = static_cast<memory_accounting::category_t>(i);
+        *ret << " memory." << memory_accounting::name(c) << "=" << memory_accounting::bytes(c);
+    }
+
+    *ret << " memory.tracked=" << memory_accounting::total();
+    *ret << " memory.soft_limit=" << memory_accounting::soft_limit();
+    *ret << " memory.throttled=" << m_perf_memory_throttled.read();
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t bytes = 0;
+    m_data.cache_stats(&hits, &misses, &bytes);
+    *ret << " memory.object_cache=" << bytes;
+    m_data.warm_cache_stats(&hits, &misses, &bytes);
+    *ret << " memory.warm_cache=" << bytes;
+    *ret << " memory.block_cache=" << m_data.block_cache_size();
+    *ret << " memory.cold_block_cache=" << m_data.cold_block_cache_size();
+    *ret << " memory.huge_pages=" << huge_pages::mapped();
+    std::string tmp;
+
+    if (m_data.get_property(e::slice("leveldb.approximate-memory-usage"), &tmp))
+    {
+        *ret << " memory.leveldb=" << strtoull(tmp.c_str(), NULL, 10);
+    }
+}
@@ -36,6 +36,7 @@
 #include <po6/threads/thread.h>
 
 // e
+#include <e/atomic.h>
 #include <e/compat.h>
 
 // Replicant
@@ -43,14 +44,25 @@
 
 // HyperDex
 #include "namespace.h"
+#include "common/auth_wallet.h"
 #include "common/ids.h"
+#include "common/network_returncode.h"
+#include "daemon/admission_control.h"
 #include "daemon/communication.h"
 #include "daemon/coordinator_link.h"
 #include "daemon/datalayer.h"
+#include "daemon/export_thread.h"
+#include "daemon/hot_keys.h"
+#include "daemon/latency_histogram.h"
+#include "daemon/metrics_server.h"
 #include "daemon/performance_counter.h"
+#include "daemon/profile_thread.h"
+#include "daemon/region_op_counter.h"
 #include "daemon/replication_manager.h"
 #include "daemon/search_manager.h"
+#include "daemon/search_thread.h"
 #include "daemon/state_transfer_manager.h"
+#include "daemon/thread_placement.h"
 
 BEGIN_HYPERDEX_NAMESPACE
 
@@ -70,7 +82,23 @@ class daemon
                 po6::net::location bind_to,
                 bool set_coordinator,
                 po6::net::hostname coordinator,
-                unsigned threads);
+                unsigned threads,
+                unsigned search_threads,
+                unsigned commit_threads,
+                const thread_placement& placement,
+                const datalayer::tuning& storage,
+                uint64_t chain_batch_window,
+                uint64_t chain_ack_window,
+                uint64_t peer_lease,
+                bool chain_deltas,
+                uint64_t slow_op_threshold,
+                uint64_t trace_sample,
+                uint16_t metrics_port,
+                std::string zone);
+
+    private:
+        // a relaxed get parked on a key state whose state machine was running
+        class relaxed_get;
 
     private:
         // Pause and unpause all activity, e.g. for reconfiguration or
@@ -78,51 +106,143 @@ class daemon
         // thread must remain offline for entire time between pause/unpause.
         void pause();
         void unpause();
+        // The configuration currently in effect.  Take one reference per
+        // operation; it remains valid until the caller's next quiescent state.
+        const configuration& config() const
+        { return *e::atomic::load_ptr_acquire(&m_config); }
+        // publish a copy of "config" and retire the previous one through m_gc
+        void install_config(const configuration& config);
         // process messages from the network threads
         void loop(size_t thread);
+        // process searches, either inline on a network thread or from one
+        // of the search threads; past the deadline (0 for none) the client
+        // has given up, and so does the search
+        void process_search(size_t thread, server_id from, virtual_server_id vfrom, virtual_server_id vto, network_msgtype type, std::auto_ptr<e::buffer> msg, e::unpacker up, uint64_t deadline);
         void process_req_get(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_req_get_relaxed(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        // answer a relaxed get once the key's pending writes are counted
+        void respond_get_relaxed(server_id from, virtual_server_id vto, uint64_t nonce, uint64_t staleness,
+                                 uint64_t pending, const e::slice& key, auth_wallet* aw);
+        void respond_get(server_id from, virtual_server_id vto, uint64_t nonce, const e::slice& key, auth_wallet* aw);
+        void process_req_get_cached(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_req_get_partial(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_req_get_batch(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_req_get_versioned(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_req_atomic(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
-        void process_req_search_start(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
-        void process_req_search_next(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_req_atomic_batch(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_req_search_start(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up, uint64_t deadline, const datalayer::snapshot* snap = NULL);
+        void process_req_search_next(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up, uint64_t deadline);
         void process_req_search_stop(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
-        void process_req_sorted_search(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
-        void process_req_count(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
-        void process_req_search_describe(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_req_search_multi(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up, uint64_t deadline);
+        void process_req_sorted_search(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up, uint64_t deadline, const datalayer::snapshot* snap = NULL);
+        void process_req_sorted_search_next(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_req_nearest_search(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up, uint64_t deadline);
+        void process_req_count(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up, uint64_t deadline, const datalayer::snapshot* snap = NULL);
+        void process_req_approximate_count(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up, uint64_t deadline);
+        void process_req_aggregate(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up, uint64_t deadline);
+        void process_req_search_describe(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up, uint64_t deadline);
+        void process_req_changes_start(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_req_changes_next(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_req_changes_stop(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_req_group_atomic(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_chain_op(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_chain_op_batch(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_chain_subspace(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_chain_ack(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_chain_ack_batch(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_xfer_handshake_syn(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_xfer_handshake_synack(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_xfer_handshake_ack(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_xfer_handshake_wiped(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_xfer_op(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_xfer_op_batch(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_xfer_op_compressed(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_xfer_ack(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_backup(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
         void process_perf_counters(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_hot_keys(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void process_profile(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void send_profile(server_id to, virtual_server_id vfrom, uint64_t nonce, network_returncode rc,
+                          uint64_t samples, uint64_t dropped, const std::string& folded);
+        void process_export(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+        void send_export(server_id to, virtual_server_id vfrom, uint64_t nonce, network_returncode rc,
+                         const std::string& path, uint64_t objects, uint64_t bytes);
+        void process_maintenance(server_id from, virtual_server_id vfrom, virtual_server_id vto, std::auto_ptr<e::buffer> msg, e::unpacker up);
+
+    private:
+        // tell the coordinator each region's size and op rate
+        void report_load();
+        // save the regions read most and the hottest keys for the next start
+        // to read back into the block cache
+        void save_prefetch_list();
 
     private:
+        // periodically delete the expired objects of the regions this
+        // server leads, and close searches left idle
+        void sweep_expired();
+        // periodically move old tables to the cold data directory and
+        // collect the value log
+        void migrate_cold();
+        // compact the regions of spaces that became immutable, and those
+        // asked for, and watch for the maintenance window to open
+        void compact_immutable();
         void collect_stats();
         void collect_stats_msgs(std::ostringstream* ret);
+        void collect_stats_latency(std::ostringstream* ret);
         void collect_stats_leveldb(std::ostringstream* ret);
         void determine_block_stat_path(const std::string& data);
         void collect_stats_io(std::ostringstream* ret);
+        void collect_stats_regions(std::ostringstream* ret);
+        // open searches, the age of the oldest snapshot they pin, and how
+        // many were reaped
+        void collect_stats_searches(std::ostringstream* ret);
+        // bytes held by each subsystem; also part of the debug dump
+        void collect_stats_memory(std::ostringstream* ret);
+        void collect_stats_locks(std::ostringstream* ret);
+        // turn a new client write away while memory is over its soft limit;
+        // true if the request may run, and if not, the client has been told
+        // to retry later
+        bool throttle_for_memory(const server_id& from, const virtual_server_id& vto,
+                                 network_msgtype type, e::unpacker up);
+        // hold back a new search on its search thread while memory is over
+        // its soft limit; a network thread never waits
+        void hold_search_for_memory(network_msgtype type);
+        // pace a region's new client writes while compaction is behind;
+        // true if the request may run, and if not, the client has been told
+        // to retry when the region's next turn comes
+        bool throttle_for_compaction(const server_id& from, const virtual_server_id& vto,
+                                     network_msgtype type, e::unpacker up);
+        // may the request run under its space's quotas?  If not, the client
+        // has been told to retry later
+        bool admit(const server_id& from, const virtual_server_id& vto,
+                   network_msgtype type, const e::buffer& msg, e::unpacker up);
+        // tell the client to retry the request in "retry_after" milliseconds;
+        // false if its replies cannot say so and it must run instead
+        bool turn_away(const server_id& from, const virtual_server_id& vto,
+                       network_msgtype type, e::unpacker up, uint64_t retry_after);
+        void send_throttled(const server_id& to, const virtual_server_id& vfrom,
+                            network_msgtype resp, uint64_t nonce, uint64_t retry_after);
 
     private:
         friend class background_thread;
         friend class communication;
         friend class coordinator_link;
         friend class datalayer;
+        friend class datalayer_bench;
+        friend class export_thread;
         friend class key_state;
+        friend class profile_thread;
         friend class replication_manager;
         friend class search_manager;
+        friend class search_thread;
         friend class state_transfer_manager;
 
     private:
         server_id m_us;
         po6::net::location m_bind_to;
         std::vector<e::compat::shared_ptr<po6::threads::thread> > m_threads;
+        std::vector<e::compat::shared_ptr<search_thread> > m_search_threads;
+        thread_placement m_placement;
         e::garbage_collector m_gc;
         e::garbage_collector::thread_state m_gc_ts;
         std::auto_ptr<coordinator_link> m_coord;
@@ -132,7 +252,12 @@ class daemon
         replication_manager m_repl;
         state_transfer_manager m_stm;
         search_manager m_sm;
-        configuration m_config;
+        const configuration* m_config;
+        region_op_counter m_region_ops;
+        hot_keys m_hot_keys;
+        profile_thread m_profile_thread;
+        export_thread m_export_thread;
+        admission_control m_admission;
         // pause management
         po6::threads::mutex m_protect_pause;
         po6::threads::cond m_can_pause;
@@ -140,25 +265,81 @@ class daemon
         // counters
         performance_counter m_perf_req_get;
         performance_counter m_perf_req_get_partial;
+        performance_counter m_perf_req_get_batch;
+        performance_counter m_perf_req_get_relaxed;
+        performance_counter m_perf_req_get_cached;
+        performance_counter m_perf_req_get_versioned;
+        performance_counter m_perf_req_get_unmodified;
+        performance_counter m_perf_req_expired;
+        performance_counter m_perf_memory_throttled;
+        performance_counter m_perf_req_throttled;
+        performance_counter m_perf_compaction_throttled;
+        performance_counter m_perf_compaction_throttle_time;
         performance_counter m_perf_req_atomic;
+        performance_counter m_perf_req_atomic_batch;
+        performance_counter m_perf_req_atomic_batched;
         performance_counter m_perf_req_search_start;
         performance_counter m_perf_req_search_next;
         performance_counter m_perf_req_search_stop;
+        performance_counter m_perf_req_search_multi;
+        performance_counter m_perf_req_search_multi_regions;
         performance_counter m_perf_req_sorted_search;
+        performance_counter m_perf_req_sorted_search_next;
+        performance_counter m_perf_req_nearest_search;
         performance_counter m_perf_req_count;
+        performance_counter m_perf_req_approximate_count;
+        performance_counter m_perf_req_aggregate;
         performance_counter m_perf_req_search_describe;
+        performance_counter m_perf_req_changes_start;
+        performance_counter m_perf_req_changes_next;
+        performance_counter m_perf_req_changes_stop;
         performance_counter m_perf_req_group_atomic;
         performance_counter m_perf_chain_op;
+        performance_counter m_perf_chain_op_batch;
         performance_counter m_perf_chain_subspace;
         performance_counter m_perf_chain_ack;
+        performance_counter m_perf_chain_ack_batch;
         performance_counter m_perf_xfer_handshake_syn;
         performance_counter m_perf_xfer_handshake_synack;
         performance_counter m_perf_xfer_handshake_ack;
         performance_counter m_perf_xfer_handshake_wiped;
         performance_counter m_perf_xfer_op;
+        performance_counter m_perf_xfer_op_batch;
+        performance_counter m_perf_xfer_op_compressed;
         performance_counter m_perf_xfer_ack;
         performance_counter m_perf_backup;
         performance_counter m_perf_perf_counters;
+        performance_counter m_perf_hot_keys;
+        performance_counter m_perf_profile;
+        performance_counter m_perf_export;
+        performance_counter m_perf_maintenance;
+        // latency (in nanoseconds) of the handlers in "loop"
+        latency_histogram m_lat_req_get;
+        latency_histogram m_lat_req_get_partial;
+        latency_histogram m_lat_req_get_batch;
+        latency_histogram m_lat_req_get_relaxed;
+        latency_histogram m_lat_req_get_cached;
+        latency_histogram m_lat_req_get_versioned;
+        latency_histogram m_lat_req_atomic;
+        latency_histogram m_lat_req_search_start;
+        latency_histogram m_lat_req_search_next;
+        latency_histogram m_lat_req_search_stop;
+        latency_histogram m_lat_req_sorted_search;
+        latency_histogram m_lat_req_sorted_search_next;
+        latency_histogram m_lat_req_nearest_search;
+        latency_histogram m_lat_req_count;
+        latency_histogram m_lat_req_approximate_count;
+        latency_histogram m_lat_req_aggregate;
+        latency_histogram m_lat_req_search_describe;
+        latency_histogram m_lat_req_changes_start;
+        latency_histogram m_lat_req_changes_next;
+        latency_histogram m_lat_req_changes_stop;
+        latency_histogram m_lat_req_group_atomic;
+        latency_histogram m_lat_chain_op;
+        latency_histogram m_lat_chain_op_batch;
+        latency_histogram m_lat_chain_subspace;
+        latency_histogram m_lat_chain_ack;
+        latency_histogram m_lat_chain_ack_batch;
         // iostat-like stats
         std::string m_block_stat_path;
         // historical data
@@ -166,6 +347,14 @@ class daemon
         po6::threads::mutex m_protect_stats;
         uint64_t m_stats_start;
         std::list<std::pair<uint64_t, std::string> > m_stats;
+        // the latest stats, for scrapers
+        metrics_server m_metrics;
+        // reclaims the objects of expiring spaces
+        po6::threads::thread m_expiry_sweeper;
+        // moves old tables to cheaper storage
+        po6::threads::thread m_cold_migrator;
+        // lays out immutable spaces for reads
+        po6::threads::thread m_immutable_compactor;
 };
 
 END_HYPERDEX_NAMESPACE
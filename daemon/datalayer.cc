@@ -31,11 +31,21 @@
 #include "config.h"
 #endif
 
+// C
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
 // POSIX
 #include <signal.h>
+#include <unistd.h>
 
 // STL
 #include <algorithm>
+#include <iomanip>
+#include <list>
 #include <map>
 #include <sstream>
 #include <string>
@@ -45,7 +55,9 @@
 
 // LevelDB
 #include <hyperleveldb/write_batch.h>
-#include <hyperleveldb/filter_policy.h>
+
+// po6
+#include <po6/time.h>
 
 // e
 #include <e/atomic.h>
@@ -55,6 +67,7 @@
 
 // HyperDex
 #include "common/datatype_info.h"
+#include "common/hash.h"
 #include "common/macros.h"
 #include "common/range_searches.h"
 #include "common/serialization.h"
@@ -62,13 +75,54 @@
 #include "daemon/daemon.h"
 #include "daemon/datalayer.h"
 #include "daemon/datalayer_checkpointer_thread.h"
+#include "daemon/datalayer_divider_thread.h"
 #include "daemon/datalayer_encodings.h"
+#include "daemon/datalayer_fetcher.h"
+#include "daemon/datalayer_filter_thread.h"
+#include "daemon/datalayer_group_commit.h"
 #include "daemon/datalayer_index_state.h"
 #include "daemon/datalayer_indexer_thread.h"
 #include "daemon/datalayer_iterator.h"
+#include "daemon/datalayer_plan_cache.h"
+#include "daemon/datalayer_prefetch_thread.h"
 #include "daemon/datalayer_wiper_thread.h"
+#include "daemon/index_composite.h"
+#include "daemon/index_info.h"
+#include "daemon/index_spatial.h"
 
 #define STRLENOF(x)	(sizeof(x)-1)
+// the most index bytes a search will read into memory to intersect them
+#define MATERIALIZE_MAX_BYTES (16ULL * 1024ULL * 1024ULL)
+// one seek costs about as much as reading this many index entries
+#define MATERIALIZE_SEEK_FACTOR 16
+// divide_region writes the objects it moves in batches of about this size
+#define DIVIDE_BATCH_BYTES (4ULL * 1024ULL * 1024ULL)
+// the block cache LevelDB makes when given none
+#define DEFAULT_BLOCK_CACHE_BYTES (8ULL * 1024ULL * 1024ULL)
+// the most table bytes one pass moves to the cold data directory, so that
+// turning tiering on for a full disk does not saturate both disks at once
+#define COLD_MIGRATE_MAX_BYTES (1024ULL * 1024ULL * 1024ULL)
+// each LevelDB instance may keep at least this many tables open
+#define SHARD_MIN_OPEN_FILES 64
+// the saved placement names the in-memory instance thus, so that it need not
+// move when the number of instances on disk changes
+#define MEMORY_SHARD UINT32_MAX
+// how often compaction_pressure looks at LevelDB's tables again
+#define COMPACTION_SAMPLE_NANOS 100000000ULL
+// pressure starts with this many level-0 tables and is full with the second
+// number, short of where LevelDB stops writes outright
+#define COMPACTION_L0_SOFT 8
+#define COMPACTION_L0_HARD 20
+// likewise for the bytes levels 1 and up hold past their targets
+#define COMPACTION_DEBT_SOFT (256ULL * 1024ULL * 1024ULL)
+#define COMPACTION_DEBT_HARD (4ULL * 1024ULL * 1024ULL * 1024ULL)
+// the target of level 1; each level after is ten times the one before
+#define COMPACTION_LEVEL1_BYTES (10ULL * 1024ULL * 1024ULL)
+// how often collect_value_log looks for unreferenced segments
+#define VALUE_LOG_COLLECT_INTERVAL (30ULL * 60ULL * 1000000000ULL)
+// a segment found unreferenced stays this long after, for the benefit of
+// snapshots and replays that started before the pass that found it
+#define VALUE_LOG_COLLECT_GRACE (60ULL * 60ULL * 1000000000ULL)
 
 // ASSUME:  all keys put into leveldb have a first byte without the high bit set
 
@@ -79,40 +133,162 @@ const hyperdex::region_id datalayer::defaultri;
 
 datalayer :: datalayer(daemon* d)
     : m_daemon(d)
+    , m_block_cache()
+    , m_filter_policy()
+    , m_tiers()
+    , m_cold_block_cache()
+    , m_tiered_cache()
+    , m_memory_env()
+    , m_path()
+    , m_cold_age(0)
     , m_db()
+    , m_shards()
+    , m_memory_shard(0)
+    , m_placement()
+    , m_shard_of()
+    , m_shards_unsaved(false)
+    , m_cache()
+    , m_warm()
+    , m_group_commits()
+    , m_plans(new plan_cache())
     , m_indices()
     , m_versions()
+    , m_count_mtx()
+    , m_count_id(0)
     , m_checkpointer(new checkpointer_thread(d))
     , m_mediator(new wiper_indexer_mediator())
-    , m_indexer(new indexer_thread(d, m_mediator.get()))
+    , m_indexers()
     , m_wiper(new wiper_thread(d, m_mediator.get()))
+    , m_prefetcher(new prefetch_thread(d))
+    , m_fetcher(new fetcher(this))
+    , m_filter_builder(new filter_thread(d))
+    , m_divider(new divider_thread(d))
+    , m_filter_bits(0)
+    , m_filter_count(0)
+    , m_filter_bytes(0)
+    , m_filter_negatives()
+    , m_vlog_threshold(0)
+    , m_vlog()
+    , m_vlog_dead()
+    , m_vlog_collected_at(0)
+    , m_compressor()
+    , m_compaction_sampled_at(0)
+    , m_compaction_l0(0)
+    , m_compaction_debt(0)
+    , m_compaction_pressure(0)
+    , m_maintenance()
+    , m_maintenance_open(true)
+    , m_compact_mtx()
+    , m_compact_requested()
+    , m_compactions(0)
 {
 }
 
 datalayer :: ~datalayer() throw ()
 {
     m_checkpointer->shutdown();
-    m_indexer->shutdown();
+
+    for (size_t i = 0; i < m_indexers.size(); ++i)
+    {
+        m_indexers[i]->shutdown();
+    }
+
     m_wiper->shutdown();
+    m_prefetcher->shutdown();
+    m_filter_builder->shutdown();
+    m_divider->shutdown();
+    m_fetcher->shutdown();
 }
 
 #define FORMAT_1_6 "v1.6.0 format"
+// index entries end with a compact key size; see encode_key_size_suffix
+#define FORMAT_1_7 "v1.7.0 format"
 
 bool
 datalayer :: initialize(const std::string& path,
+                        const tuning& t,
                         bool* saved,
                         server_id* saved_us,
                         po6::net::location* saved_bind_to,
                         po6::net::hostname* saved_coordinator)
 {
     leveldb::Options opts;
-    opts.write_buffer_size = 16ULL * 1024ULL * 1024ULL;
+    opts.write_buffer_size = t.write_buffer_size;
+    opts.block_size = t.block_size;
     opts.create_if_missing = true;
-    opts.filter_policy = leveldb::NewBloomFilterPolicy(10);
+    opts.compression = t.compression ? leveldb::kSnappyCompression
+                                     : leveldb::kNoCompression;
+
+    // without a size of our own, make the cache LevelDB would have made
+    // itself so that it too is counted
+    const uint64_t block_cache_size = t.block_cache_size > 0 ? t.block_cache_size
+                                                             : DEFAULT_BLOCK_CACHE_BYTES;
+    m_block_cache.reset(new counting_cache(leveldb::NewLRUCache(block_cache_size), block_cache_size));
+    opts.block_cache = m_block_cache.get();
+
+    if (t.bloom_bits > 0)
+    {
+        m_filter_policy.reset(new counting_filter_policy(leveldb::NewBloomFilterPolicy(t.bloom_bits)));
+        opts.filter_policy = m_filter_policy.get();
+    }
+
+    if (!po6::path::realpath(path, &m_path))
+    {
+        m_path = path;
+    }
+
+    if (!t.cold_dir.empty())
+    {
+        std::string cold_dir;
+
+        // the symlinks must work from wherever the daemon runs
+        if (!po6::path::realpath(t.cold_dir, &cold_dir))
+        {
+            LOG(ERROR) << "could not find cold data directory " << t.cold_dir;
+            return false;
+        }
+
+        const uint64_t cold_cache_size = t.cold_block_cache_size > 0 ? t.cold_block_cache_size
+                                                                     : DEFAULT_BLOCK_CACHE_BYTES;
+        m_tiers.reset(new tiered_env(leveldb::Env::Default(), cold_dir));
+        m_cold_block_cache.reset(new counting_cache(leveldb::NewLRUCache(cold_cache_size), cold_cache_size));
+        m_tiered_cache.reset(new tiered_cache(m_block_cache.get(), m_cold_block_cache.get()));
+        m_cold_age = t.cold_age;
+        opts.env = m_tiers.get();
+        opts.block_cache = m_tiered_cache.get();
+        LOG(INFO) << "tables unmodified for " << t.cold_age << " seconds move to "
+                  << cold_dir << " with a block cache of " << cold_cache_size << " bytes";
+    }
+
+    LOG(INFO) << "opening LevelDB with write_buffer_size=" << t.write_buffer_size
+              << " block_size=" << t.block_size
+              << " block_cache_size=" << t.block_cache_size
+              << " bloom_bits=" << t.bloom_bits
+              << " compression=" << (t.compression ? "snappy" : "none")
+              << " object_cache_size=" << t.object_cache_size
+              << " warm_cache_size=" << t.warm_cache_size
+              << " group_commit_window=" << t.group_commit_window
+              << " group_sync_window=" << t.group_sync_window
+              << " index_threads=" << t.index_threads
+              << " index_rate=" << t.index_rate
+              << " index_sort_buffer=" << t.index_sort_buffer
+              << " prefetch_rate=" << t.prefetch_rate
+              << " fetch_threads=" << t.fetch_threads
+              << " index_filter_bits=" << t.index_filter_bits
+              << " value_log_threshold=" << t.value_log_threshold
+              << " storage_shards=" << t.storage_shards;
     opts.manual_garbage_collection = true;
-    opts.max_open_files = std::max(sysconf(_SC_OPEN_MAX) >> 1, 1024L);
+    m_cache.set_budget(t.object_cache_size);
+    m_warm.set_budget(t.warm_cache_size);
+    const unsigned shards = std::max(t.storage_shards, 1U);
+    // the instances share the descriptors LevelDB may hold open
+    opts.max_open_files = std::max(sysconf(_SC_OPEN_MAX) >> 1, 1024L) / shards;
+    opts.max_open_files = std::max(opts.max_open_files, SHARD_MIN_OPEN_FILES);
     std::string name(path);
     leveldb::DB* tmp_db;
+    // opening replays the write-ahead log; with a large one, this is where
+    // a restart spends its time
+    const uint64_t open_start = po6::monotonic_time();
     leveldb::Status st = leveldb::DB::Open(opts, name, &tmp_db);
 
     if (!st.ok())
@@ -122,6 +298,53 @@ datalayer :: initialize(const std::string& path,
     }
 
     m_db.reset(tmp_db);
+    m_shards.push_back(m_db);
+
+    // cold tables are moved out of the first instance's directory only
+    leveldb::Options shard_opts(opts);
+    shard_opts.env = leveldb::Env::Default();
+    shard_opts.block_cache = m_block_cache.get();
+
+    for (unsigned i = 1; i < shards; ++i)
+    {
+        std::ostringstream shard_name;
+        shard_name << name << "/shard-" << i;
+        st = leveldb::DB::Open(shard_opts, shard_name.str(), &tmp_db);
+
+        if (!st.ok())
+        {
+            LOG(ERROR) << "could not open LevelDB in " << shard_name.str()
+                       << ": " << st.ToString();
+            return false;
+        }
+
+        m_shards.push_back(leveldb_db_ptr(tmp_db));
+    }
+
+    // never on disk, so there is nothing to stop it replaying an old log
+    m_memory_env.reset(new memory_env(leveldb::Env::Default()));
+    leveldb::Options memory_opts(shard_opts);
+    memory_opts.env = m_memory_env.get();
+    st = leveldb::DB::Open(memory_opts, name + "/memory", &tmp_db);
+
+    if (!st.ok())
+    {
+        LOG(ERROR) << "could not open the in-memory LevelDB instance: " << st.ToString();
+        return false;
+    }
+
+    m_memory_shard = m_shards.size();
+    m_shards.push_back(leveldb_db_ptr(tmp_db));
+
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        e::compat::shared_ptr<group_commit> gc(new group_commit(this, i));
+        gc->set_window(t.group_commit_window);
+        gc->set_sync_window(t.group_sync_window);
+        m_group_commits.push_back(gc);
+    }
+
+    const uint64_t open_done = po6::monotonic_time();
     leveldb::ReadOptions ropts;
     ropts.fill_cache = true;
     ropts.verify_checksums = true;
@@ -137,12 +360,19 @@ datalayer :: initialize(const std::string& path,
     {
         first_time = false;
 
-        if (rbacking != FORMAT_1_6)
+        if (rbacking == FORMAT_1_6)
+        {
+            if (!upgrade_16_to_17())
+            {
+                return false;
+            }
+        }
+        else if (rbacking != FORMAT_1_7)
         {
             LOG(ERROR) << "could not restore daemon "
                        << "the existing data was created with"
                        << "HyperDex " << rbacking << " but "
-                       << "this is requires the v1.6.0-compatible format";
+                       << "this is requires the v1.6.0- or v1.7.0-compatible format";
             return false;
         }
     }
@@ -150,7 +380,7 @@ datalayer :: initialize(const std::string& path,
     {
         first_time = true;
         leveldb::Slice k("hyperdex", 8);
-        leveldb::Slice v(FORMAT_1_6, STRLENOF(FORMAT_1_6));
+        leveldb::Slice v(FORMAT_1_7, STRLENOF(FORMAT_1_7));
         st = m_db->Put(wopts, k, v);
 
         if (!st.ok())
@@ -208,9 +438,61 @@ datalayer :: initialize(const std::string& path,
         return false;
     }
 
+    if (!load_shards(first_time))
+    {
+        return false;
+    }
+
+    // values logged before a restart without the value log stay readable
+    m_vlog_threshold = std::min(t.value_log_threshold, CHUNK_THRESHOLD);
+
+    if (!m_vlog.open(m_path + "/vlog", m_vlog_threshold > 0))
+    {
+        return false;
+    }
+
+    if (!load_dictionaries())
+    {
+        return false;
+    }
+
+    m_count_id = next_count_id();
+    LOG(INFO) << "opened LevelDB in " << (open_done - open_start) / 1000000ULL
+              << "ms; checked its format and saved state in "
+              << (po6::monotonic_time() - open_done) / 1000000ULL << "ms";
+    const unsigned index_threads = std::max(t.index_threads, 1U);
+
+    for (unsigned i = 0; i < index_threads; ++i)
+    {
+        // split the budget so that all builds together stay within it
+        e::compat::shared_ptr<indexer_thread> it(
+                new indexer_thread(m_daemon, m_mediator.get(),
+                                   t.index_rate / index_threads,
+                                   t.index_sort_buffer));
+        m_indexers.push_back(it);
+    }
+
+    m_checkpointer->load();
     m_checkpointer->start();
-    m_indexer->start();
+
+    for (size_t i = 0; i < m_indexers.size(); ++i)
+    {
+        m_indexers[i]->start();
+    }
+
     m_wiper->start();
+    m_prefetcher->set_rate(t.prefetch_rate);
+
+    if (t.prefetch_rate > 0 && !first_time)
+    {
+        load_prefetch_list();
+    }
+
+    m_prefetcher->start();
+    m_fetcher->start(t.fetch_threads);
+    m_filter_bits = t.index_filter_bits;
+    m_filter_builder->start();
+    m_divider->start();
     *saved = !first_time;
     return true;
 }
@@ -219,8 +501,17 @@ void
 datalayer :: teardown()
 {
     m_checkpointer->shutdown();
-    m_indexer->shutdown();
+
+    for (size_t i = 0; i < m_indexers.size(); ++i)
+    {
+        m_indexers[i]->shutdown();
+    }
+
     m_wiper->shutdown();
+    m_prefetcher->shutdown();
+    m_filter_builder->shutdown();
+    m_divider->shutdown();
+    m_fetcher->shutdown();
 }
 
 bool
@@ -250,237 +541,2385 @@ datalayer :: save_state(const server_id& us,
 }
 
 void
-datalayer :: pause()
+datalayer :: migrate_cold_tables()
 {
-    m_checkpointer->initiate_pause();
-    m_indexer->initiate_pause();
-    m_wiper->initiate_pause();
+    // runs on a thread that reconfigure does not pause; this and
+    // collect_value_log walk m_tiers and m_shards, which are fixed once
+    // initialize returns, and never look up where a region lives
+    if (m_tiers.get())
+    {
+        m_tiers->migrate(m_path, m_cold_age, COLD_MIGRATE_MAX_BYTES);
+    }
 }
 
 void
-datalayer :: unpause()
+datalayer :: compact_region(const region_id& ri)
 {
-    m_checkpointer->unpause();
-    m_indexer->unpause();
-    m_wiper->unpause();
+    // runs on the maintenance thread, which reconfigure does not pause
+    leveldb_db_ptr db = db_copy_for(ri);
+    const uint8_t prefixes[] = {'o', 'i'};
+
+    for (size_t i = 0; i < sizeof(prefixes); ++i)
+    {
+        char start_backing[sizeof(uint8_t) + VARINT_64_MAX_SIZE];
+        char* ptr = start_backing;
+        ptr = e::pack8be(prefixes[i], ptr);
+        ptr = e::packvarint64(ri.get(), ptr);
+        leveldb::Slice start(start_backing, ptr - start_backing);
+        char limit_backing[sizeof(uint8_t) + VARINT_64_MAX_SIZE];
+        memmove(limit_backing, start_backing, start.size());
+        encode_bump(limit_backing, limit_backing + start.size());
+        leveldb::Slice limit(limit_backing, start.size());
+        db->CompactRange(&start, &limit);
+    }
+}
+
+leveldb_db_ptr
+datalayer :: db_copy_for(const region_id& ri)
+{
+    po6::threads::mutex::hold hold(&m_protect_placement);
+    return m_shards[shard_of(ri)];
+}
+
+bool
+datalayer :: set_maintenance(uint16_t start, uint16_t end, uint64_t budget)
+{
+    if (!m_maintenance.set(start, end, budget))
+    {
+        return false;
+    }
+
+    LOG(INFO) << "maintenance window now " << start / 60 << ":"
+              << std::setw(2) << std::setfill('0') << start % 60 << "-"
+              << end / 60 << ":" << std::setw(2) << std::setfill('0') << end % 60
+              << " UTC with a budget of " << budget << " bytes/s";
+    return true;
 }
 
 void
-datalayer :: reconfigure(const configuration&,
-                         const configuration& config,
-                         const server_id&)
+datalayer :: get_maintenance(uint16_t* start, uint16_t* end, uint64_t* budget)
 {
-    m_checkpointer->wait_until_paused();
-    m_indexer->wait_until_paused();
-    m_wiper->wait_until_paused();
+    m_maintenance.get(start, end, budget);
+}
 
-    // indices that must exist
-    std::vector<std::pair<region_id, index_id> > indices;
-    config.all_indices(m_daemon->m_us, &indices);
-    std::sort(indices.begin(), indices.end());
-    std::vector<std::pair<region_id, index_id> >::iterator it;
-    it = std::unique(indices.begin(), indices.end());
-    indices.resize(it - indices.begin());
+bool
+datalayer :: request_compaction(const region_id& ri)
+{
+    po6::threads::mutex::hold hold(&m_compact_mtx);
+    return m_compact_requested.insert(ri).second;
+}
 
-    // iterate and create indices where necessary
-    std::vector<index_state> next_indices;
-    size_t old_idx = 0;
-    size_t new_idx = 0;
+void
+datalayer :: maintain()
+{
+    std::set<region_id> requested;
 
-    while (new_idx < indices.size())
     {
-        int cmp = 1;
+        po6::threads::mutex::hold hold(&m_compact_mtx);
+        requested.swap(m_compact_requested);
+    }
 
-        if (old_idx < m_indices.size())
+    for (std::set<region_id>::iterator it = requested.begin();
+            it != requested.end(); ++it)
+    {
+        const uint64_t start = po6::monotonic_time();
+        compact_region(*it);
+        LOG(INFO) << "compacted " << *it << " on request in "
+                  << (po6::monotonic_time() - start) / 1000000ULL << "ms";
+        po6::threads::mutex::hold hold(&m_compact_mtx);
+        ++m_compactions;
+    }
+
+    const bool open = m_maintenance.is_open(time(NULL));
+
+    if (open && !m_maintenance_open)
+    {
+        m_checkpointer->kick();
+
+        for (size_t i = 0; i < m_indexers.size(); ++i)
         {
-            cmp = e::tuple_compare(m_indices[old_idx].ri, m_indices[old_idx].ii,
-                                   indices[new_idx].first, indices[old_idx].second);
+            m_indexers[i]->kick();
         }
+    }
 
-        if (cmp == 0)
+    m_maintenance_open = open;
+}
+
+void
+datalayer :: collect_value_log()
+{
+    const uint64_t now = po6::monotonic_time();
+
+    if (m_vlog_collected_at > 0 &&
+        now < m_vlog_collected_at + VALUE_LOG_COLLECT_INTERVAL)
+    {
+        return;
+    }
+
+    m_vlog_collected_at = now;
+    const uint64_t gced = m_checkpointer->collected_below();
+    std::map<uint64_t, std::pair<uint64_t, uint64_t> >::iterator d = m_vlog_dead.begin();
+
+    while (d != m_vlog_dead.end())
+    {
+        // a replay from a checkpoint the pass saw may read versions of
+        // objects that predate it, which could refer to the segment
+        if ((d->second.first == 0 || gced > d->second.first) &&
+            d->second.second + VALUE_LOG_COLLECT_GRACE <= now)
         {
-            // Case B
-            next_indices.push_back(m_indices[old_idx]);
-            ++old_idx;
-            ++new_idx;
+            m_vlog.remove(d->first);
+            m_vlog_dead.erase(d++);
         }
-        else if (cmp < 0)
+        else
         {
-            // Case A
-            ++old_idx;
+            ++d;
         }
-        else if (cmp > 0)
+    }
+
+    // every write that may refer to a segment before the horizon is in
+    // LevelDB, so an iterator made after sealing sees all that refer to them
+    const uint64_t horizon = m_vlog.seal();
+    const uint64_t checkpoint = m_checkpointer->largest_checkpoint();
+    std::vector<std::pair<uint64_t, uint64_t> > segs;
+    m_vlog.segments(horizon, &segs);
+
+    if (segs.empty())
+    {
+        m_vlog.set_live(0);
+        return;
+    }
+
+    leveldb::ReadOptions opts;
+    opts.fill_cache = false;
+    opts.verify_checksums = true;
+    std::map<uint64_t, uint64_t> live;
+    uint64_t live_bytes = 0;
+    std::vector<e::slice> value;
+    std::vector<uint64_t> chunked;
+    std::vector<value_log::pointer> logged;
+    std::vector<value_compressor::packed> compressed;
+    uint64_t version;
+
+    // every instance appends to the one value log
+    for (size_t s = 0; s < m_shards.size(); ++s)
+    {
+        std::auto_ptr<leveldb::Iterator> it(m_shards[s]->NewIterator(opts));
+
+        for (it->Seek(leveldb::Slice("o", 1));
+                it->Valid() && it->key().size() > 0 && it->key()[0] == 'o';
+                it->Next())
         {
-            next_indices.push_back(index_state(indices[new_idx].first,
-                                               indices[new_idx].second));
-            ++new_idx;
-            region_id ri(indices[new_idx].first);
-            index_id ii(indices[new_idx].second);
-            char buf[sizeof(uint8_t) + 2 * VARINT_64_MAX_SIZE];
-            char* ptr = buf;
-            ptr = e::pack8be('I', ptr);
-            ptr = e::packvarint64(ri.get(), ptr);
-            ptr = e::packvarint64(ii.get(), ptr);
-            leveldb::ReadOptions ro;
-            leveldb::Slice key(buf, ptr - buf);
-            std::string val;
-            leveldb::Status st = m_db->Get(ro, key, &val);
+            e::slice v(it->value().data(), it->value().size());
 
-            if (st.ok())
+            if (decode_value_stored(v, &value, &chunked, &logged, &compressed, &version) != SUCCESS)
             {
-                next_indices.back().set_usable();
+                continue;
             }
-            else if (!st.IsNotFound())
+
+            for (size_t i = 0; i < logged.size(); ++i)
             {
-                handle_error(st);
+                if (logged[i].size > 0)
+                {
+                    live[logged[i].segment] += logged[i].size;
+                    live_bytes += logged[i].size;
+                }
             }
         }
-    }
-
-    m_indices.swap(next_indices);
-
-    // update the versions
-    std::vector<region_id> key_regions;
-    config.key_regions(m_daemon->m_us, &key_regions);
-    std::vector<region_id> xfer_regions;
-    config.transfers_in_regions(m_daemon->m_us, &xfer_regions);
 
-    for (size_t i = 0; i < xfer_regions.size(); ++i)
-    {
-        if (config.is_point_leader(config.head_of_region(xfer_regions[i])))
+        if (!it->status().ok())
         {
-            key_regions.push_back(xfer_regions[i]);
+            LOG(ERROR) << "could not look for unreferenced value log segments: "
+                       << it->status().ToString();
+            return;
         }
     }
 
-    e::ao_hash_map<region_id, uint64_t, id, defaultri> new_versions;
+    m_vlog.set_live(live_bytes);
+    uint64_t found = 0;
+    uint64_t found_bytes = 0;
 
-    for (size_t i = 0; i < key_regions.size(); ++i)
+    for (size_t i = 0; i < segs.size(); ++i)
     {
-        uint64_t val = 0;
-
-        if (!m_versions.get(key_regions[i], &val))
+        if (live.find(segs[i].first) != live.end())
         {
-            val = disk_version(key_regions[i]);
+            m_vlog_dead.erase(segs[i].first);
+        }
+        else if (m_vlog_dead.find(segs[i].first) == m_vlog_dead.end())
+        {
+            m_vlog_dead[segs[i].first] = std::make_pair(checkpoint, now);
+            ++found;
+            found_bytes += segs[i].second;
         }
-
-        new_versions.put(key_regions[i], val);
     }
 
-    m_versions.swap(&new_versions);
-    m_indexer->kick();
-    m_wiper->kick();
+    if (found > 0)
+    {
+        LOG(INFO) << "found " << found << " unreferenced value log segments holding "
+                  << found_bytes << " bytes; they go once checkpoint " << checkpoint
+                  << " is collected";
+    }
 }
 
 void
-datalayer :: debug_dump()
+datalayer :: save_prefetch_list(const std::vector<region_id>& regions,
+                                const std::vector<std::pair<region_id, std::string> >& keys)
 {
-    LOG(INFO) << "index state ===================================================================";
+    if (!m_prefetcher->enabled())
+    {
+        return;
+    }
 
-    for (size_t i = 0; i < m_indices.size(); ++i)
+    size_t sz = 2 * sizeof(uint32_t) + regions.size() * sizeof(uint64_t);
+
+    for (size_t i = 0; i < keys.size(); ++i)
     {
-        LOG(INFO) << "index id=" << m_indices[i].ii.get()
-                  << " region=" << m_indices[i].ri.get()
-                  << " usable=" << (m_indices[i].is_usable() ? "yes" : "no");
+        sz += sizeof(uint64_t) + pack_size(e::slice(keys[i].second));
     }
 
-    m_checkpointer->debug_dump();
-    m_mediator->debug_dump();
-    m_indexer->debug_dump();
-    m_wiper->debug_dump();
-}
+    std::auto_ptr<e::buffer> list(e::buffer::create(sz));
+    e::packer pa = list->pack();
+    pa = pa << static_cast<uint32_t>(regions.size());
 
-bool
-datalayer :: get_property(const e::slice& property,
-                          std::string* value)
-{
-    leveldb::Slice prop(reinterpret_cast<const char*>(property.data()), property.size());
-    return m_db->GetProperty(prop, value);
-}
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+        pa = pa << regions[i];
+    }
 
-std::string
-datalayer :: get_timestamp()
-{
-    std::string timestamp;
-    m_db->GetReplayTimestamp(&timestamp);
-    return timestamp;
+    pa = pa << static_cast<uint32_t>(keys.size());
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        pa = pa << keys[i].first << e::slice(keys[i].second);
+    }
+
+    // losing the list costs only a colder start, so it need not be synced
+    leveldb::WriteOptions wopts;
+    wopts.sync = false;
+    leveldb::Status st = m_db->Put(wopts, leveldb::Slice("prefetch", 8),
+                                   leveldb::Slice(reinterpret_cast<const char*>(list->data()), list->size()));
+
+    if (!st.ok())
+    {
+        LOG(ERROR) << "could not save the prefetch list: " << st.ToString();
+    }
 }
 
-uint64_t
-datalayer :: approximate_size()
+void
+datalayer :: load_prefetch_list()
 {
-    leveldb::Slice start("\x00", 1);
-    leveldb::Slice limit("\xff", 1);
-    leveldb::Range r(start, limit);
-    uint64_t ret = 0;
-    m_db->GetApproximateSizes(&r, 1, &ret);
-    return ret;
-}
+    leveldb::ReadOptions ropts;
+    ropts.fill_cache = false;
+    ropts.verify_checksums = true;
+    std::string backing;
+    leveldb::Status st = m_db->Get(ropts, leveldb::Slice("prefetch", 8), &backing);
+
+    if (st.IsNotFound())
+    {
+        return;
+    }
+    else if (!st.ok())
+    {
+        LOG(ERROR) << "could not read the prefetch list: " << st.ToString();
+        return;
+    }
+
+    e::unpacker up(backing.data(), backing.size());
+    std::vector<region_id> regions;
+    std::vector<std::pair<region_id, std::string> > keys;
+    uint32_t num = 0;
+    up = up >> num;
+
+    for (uint32_t i = 0; !up.error() && i < num; ++i)
+    {
+        region_id ri;
+        up = up >> ri;
+        regions.push_back(ri);
+    }
+
+    up = up >> num;
+
+    for (uint32_t i = 0; !up.error() && i < num; ++i)
+    {
+        region_id ri;
+        e::slice key;
+        up = up >> ri >> key;
+        keys.push_back(std::make_pair(ri, std::string(key.cdata(), key.size())));
+    }
+
+    if (up.error())
+    {
+        LOG(ERROR) << "ignoring the prefetch list because it is corrupt";
+        return;
+    }
+
+    m_prefetcher->prefetch(regions, keys);
+}
+
+void
+datalayer :: pause()
+{
+    m_checkpointer->initiate_pause();
+
+    for (size_t i = 0; i < m_indexers.size(); ++i)
+    {
+        m_indexers[i]->initiate_pause();
+    }
+
+    m_wiper->initiate_pause();
+    m_prefetcher->initiate_pause();
+    m_filter_builder->initiate_pause();
+    m_divider->initiate_pause();
+}
+
+void
+datalayer :: unpause()
+{
+    m_checkpointer->unpause();
+
+    for (size_t i = 0; i < m_indexers.size(); ++i)
+    {
+        m_indexers[i]->unpause();
+    }
+
+    m_wiper->unpause();
+    m_prefetcher->unpause();
+    m_filter_builder->unpause();
+    m_divider->unpause();
+}
+
+namespace
+{
+
+// only normal and document indices follow a key of variable size with its
+// size, and then only for values of variable size, which any of them (lists
+// and documents included) may hold
+bool
+entries_end_in_key_size(const hyperdex::configuration& config,
+                        const hyperdex::region_id& ri,
+                        const hyperdex::index_id& ii)
+{
+    const hyperdex::schema* sc = config.get_schema(ri);
+    const hyperdex::index* idx = config.get_index(ii);
+
+    if (!sc || !idx ||
+        (idx->type != hyperdex::index::NORMAL &&
+         idx->type != hyperdex::index::DOCUMENT))
+    {
+        return false;
+    }
+
+    const hyperdex::index_encoding* key_ie = hyperdex::index_encoding::lookup(sc->attrs[0].type);
+    return key_ie && !key_ie->encoding_fixed();
+}
+
+// does "inner" cover none of the hyperspace that "outer" does not?
+bool
+region_within(const hyperdex::region* inner, const hyperdex::region* outer)
+{
+    if (inner->lower_coord.size() != outer->lower_coord.size() ||
+        inner->upper_coord.size() != outer->upper_coord.size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < inner->lower_coord.size(); ++i)
+    {
+        if (inner->lower_coord[i] < outer->lower_coord[i] ||
+            inner->upper_coord[i] > outer->upper_coord[i])
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+void
+datalayer :: reconfigure(const configuration& old_config,
+                         const configuration& config,
+                         const server_id&)
+{
+    m_checkpointer->wait_until_paused();
+
+    for (size_t i = 0; i < m_indexers.size(); ++i)
+    {
+        m_indexers[i]->wait_until_paused();
+    }
+
+    m_wiper->wait_until_paused();
+    m_prefetcher->wait_until_paused();
+    m_filter_builder->wait_until_paused();
+    m_divider->wait_until_paused();
+    m_cache.clear();
+    m_warm.clear();
+    m_plans->clear();
+    assign_shards(old_config, config);
+
+    // indices that must exist
+    std::vector<std::pair<region_id, index_id> > indices;
+    config.all_indices(m_daemon->m_us, &indices);
+    std::sort(indices.begin(), indices.end());
+    std::vector<std::pair<region_id, index_id> >::iterator it;
+    it = std::unique(indices.begin(), indices.end());
+    indices.resize(it - indices.begin());
+
+    // iterate and create indices where necessary
+    std::vector<index_state> next_indices;
+    size_t old_idx = 0;
+    size_t new_idx = 0;
+
+    while (new_idx < indices.size())
+    {
+        int cmp = 1;
+
+        if (old_idx < m_indices.size())
+        {
+            cmp = e::tuple_compare(m_indices[old_idx].ri, m_indices[old_idx].ii,
+                                   indices[new_idx].first, indices[new_idx].second);
+        }
+
+        if (cmp == 0)
+        {
+            // Case B
+            next_indices.push_back(m_indices[old_idx]);
+            ++old_idx;
+            ++new_idx;
+        }
+        else if (cmp < 0)
+        {
+            // Case A
+            ++old_idx;
+        }
+        else if (cmp > 0)
+        {
+            next_indices.push_back(index_state(indices[new_idx].first,
+                                               indices[new_idx].second));
+            region_id ri(indices[new_idx].first);
+            index_id ii(indices[new_idx].second);
+            ++new_idx;
+            char buf[sizeof(uint8_t) + 2 * VARINT_64_MAX_SIZE];
+            char* ptr = buf;
+            ptr = e::pack8be('I', ptr);
+            ptr = e::packvarint64(ri.get(), ptr);
+            ptr = e::packvarint64(ii.get(), ptr);
+            leveldb::ReadOptions ro;
+            leveldb::Slice key(buf, ptr - buf);
+            std::string val;
+            leveldb::Status st = db_for(ri)->Get(ro, key, &val);
+
+            // the indexer rebuilds, in the current format, indices whose
+            // entries end with the key size older versions wrote
+            if (st.ok() && val.empty() && entries_end_in_key_size(config, ri, ii))
+            {
+                LOG(INFO) << "rebuilding index " << ii << " of " << ri
+                          << " to shorten its entries";
+            }
+            else if (st.ok())
+            {
+                next_indices.back().set_usable();
+            }
+            else if (!st.IsNotFound())
+            {
+                handle_error(st);
+            }
+        }
+    }
+
+    m_indices.swap(next_indices);
+
+    // update the versions
+    std::vector<region_id> key_regions;
+    config.key_regions(m_daemon->m_us, &key_regions);
+    std::vector<region_id> xfer_regions;
+    config.transfers_in_regions(m_daemon->m_us, &xfer_regions);
+
+    for (size_t i = 0; i < xfer_regions.size(); ++i)
+    {
+        if (config.is_point_leader(config.head_of_region(xfer_regions[i])))
+        {
+            key_regions.push_back(xfer_regions[i]);
+        }
+    }
+
+    // Regions that are new to us (every region, after a restart) must read
+    // their version from disk before they may serve.  Visit them in the
+    // order their versions are stored with one iterator per instance,
+    // rather than building a fresh iterator over every table for each.
+    std::sort(key_regions.begin(), key_regions.end());
+    e::ao_hash_map<region_id, uint64_t, id, defaultri> new_versions;
+    std::vector<e::compat::shared_ptr<leveldb::Iterator> > vits(m_shards.size());
+    const uint64_t versions_start = po6::monotonic_time();
+    size_t versions_from_disk = 0;
+
+    for (size_t i = 0; i < key_regions.size(); ++i)
+    {
+        uint64_t val = 0;
+
+        if (!m_versions.get(key_regions[i], &val))
+        {
+            e::compat::shared_ptr<leveldb::Iterator>& vit(vits[shard_of(key_regions[i])]);
+
+            if (!vit.get())
+            {
+                leveldb::ReadOptions opts;
+                opts.fill_cache = false;
+                opts.verify_checksums = true;
+                opts.snapshot = NULL;
+                vit.reset(db_for(key_regions[i])->NewIterator(opts));
+            }
+
+            val = disk_version(vit.get(), key_regions[i]);
+            ++versions_from_disk;
+        }
+
+        new_versions.put(key_regions[i], val);
+    }
+
+    m_versions.swap(&new_versions);
+
+    if (versions_from_disk > 0)
+    {
+        LOG(INFO) << "read the versions of " << versions_from_disk
+                  << " regions from disk in "
+                  << (po6::monotonic_time() - versions_start) / 1000000ULL << "ms";
+    }
+
+    // hand the objects of split regions over to the new regions in the
+    // background; the new regions take no requests until they have them all
+    std::vector<region_id> split;
+    config.split_regions(old_config, m_daemon->m_us, &split);
+    std::vector<region_id> mapped;
+    config.mapped_regions(m_daemon->m_us, &mapped);
+
+    for (size_t i = 0; i < split.size(); ++i)
+    {
+        const region* before = old_config.get_region(split[i]);
+        std::vector<region_id> children;
+
+        for (size_t j = 0; before && j < mapped.size(); ++j)
+        {
+            const region* after = config.get_region(mapped[j]);
+
+            if (after && !old_config.get_region(mapped[j]) &&
+                config.subspace_of(mapped[j]) == config.subspace_of(split[i]) &&
+                region_within(after, before))
+            {
+                children.push_back(mapped[j]);
+            }
+        }
+
+        m_divider->divide(split[i], children);
+    }
+
+    create_index_filters(config);
+
+    for (size_t i = 0; i < m_indexers.size(); ++i)
+    {
+        m_indexers[i]->kick();
+    }
+
+    m_wiper->kick();
+    m_prefetcher->kick();
+}
+
+bool
+datalayer :: load_shards(bool first_time)
+{
+    // without a saved placement, a daemon that saved its state ran with a
+    // single instance, which holds every region it had
+    m_shards_unsaved = !first_time;
+    leveldb::ReadOptions ropts;
+    ropts.fill_cache = false;
+    ropts.verify_checksums = true;
+    std::string backing;
+    leveldb::Status st = m_db->Get(ropts, leveldb::Slice("shards", 6), &backing);
+
+    if (st.IsNotFound())
+    {
+        return true;
+    }
+    else if (!st.ok())
+    {
+        LOG(ERROR) << "could not read where regions live: " << st.ToString();
+        return false;
+    }
+
+    m_shards_unsaved = false;
+    e::unpacker up(backing.data(), backing.size());
+    uint32_t num = 0;
+    up = up >> num;
+
+    for (uint32_t i = 0; !up.error() && i < num; ++i)
+    {
+        region_id ri;
+        uint32_t shard = 0;
+        up = up >> ri >> shard;
+
+        if (up.error())
+        {
+            break;
+        }
+
+        if (shard == MEMORY_SHARD)
+        {
+            shard = m_memory_shard;
+        }
+        else if (shard >= m_memory_shard)
+        {
+            LOG(ERROR) << "could not restore " << ri << " because it lives in LevelDB "
+                       << "instance " << shard << " and only " << m_memory_shard
+                       << " are open; restart with at least " << shard + 1
+                       << " storage shards";
+            return false;
+        }
+
+        m_placement[ri] = shard;
+        m_shard_of.put(ri, shard);
+    }
+
+    if (up.error())
+    {
+        LOG(ERROR) << "could not restore where regions live because the saved list is corrupt";
+        return false;
+    }
+
+    return true;
+}
+
+void
+datalayer :: lost_regions(std::vector<region_id>* rids)
+{
+    rids->clear();
+
+    for (std::map<region_id, uint64_t>::iterator it = m_placement.begin();
+            it != m_placement.end(); ++it)
+    {
+        if (it->second == m_memory_shard)
+        {
+            rids->push_back(it->first);
+        }
+    }
+}
+
+void
+datalayer :: assign_shards(const configuration& old_config, const configuration& config)
+{
+    std::vector<region_id> regions;
+    config.mapped_regions(m_daemon->m_us, &regions);
+    std::vector<region_id> xfer_regions;
+    config.transfers_in_regions(m_daemon->m_us, &xfer_regions);
+    regions.insert(regions.end(), xfer_regions.begin(), xfer_regions.end());
+    std::sort(regions.begin(), regions.end());
+    regions.erase(std::unique(regions.begin(), regions.end()), regions.end());
+    std::vector<region_id> split;
+    config.split_regions(old_config, m_daemon->m_us, &split);
+    std::vector<uint64_t> load(m_shards.size(), 0);
+    std::vector<region_id> fresh;
+
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+        std::map<region_id, uint64_t>::iterator p = m_placement.find(regions[i]);
+
+        if (p != m_placement.end())
+        {
+            ++load[p->second];
+        }
+        else
+        {
+            fresh.push_back(regions[i]);
+        }
+    }
+
+    if (fresh.empty())
+    {
+        m_shards_unsaved = false;
+        return;
+    }
+
+    for (size_t i = 0; i < fresh.size(); ++i)
+    {
+        uint64_t shard = 0;
+        // an older, single-instance layout has every region on m_db
+        bool placed = m_shards_unsaved;
+        const region* after = config.get_region(fresh[i]);
+        const schema* sc = config.get_schema(fresh[i]);
+
+        if (sc && sc->durability == DURABILITY_MEMORY)
+        {
+            shard = m_memory_shard;
+            placed = true;
+        }
+
+        // a region split from one of ours goes where its parent is, so that
+        // divide_region moves objects within one instance
+        for (size_t j = 0; !placed && after && j < split.size(); ++j)
+        {
+            const region* before = old_config.get_region(split[j]);
+
+            if (before && config.subspace_of(fresh[i]) == config.subspace_of(split[j]) &&
+                region_within(after, before))
+            {
+                std::map<region_id, uint64_t>::iterator p = m_placement.find(split[j]);
+                shard = p != m_placement.end() ? p->second : 0;
+                placed = true;
+            }
+        }
+
+        // others go to the instance on disk holding the fewest of our regions
+        if (!placed)
+        {
+            shard = std::min_element(load.begin(), load.begin() + m_memory_shard) - load.begin();
+        }
+
+        m_placement[fresh[i]] = shard;
+        ++load[shard];
+    }
+
+    m_shards_unsaved = false;
+    size_t sz = sizeof(uint32_t) + m_placement.size() * (sizeof(uint64_t) + sizeof(uint32_t));
+    std::auto_ptr<e::buffer> list(e::buffer::create(sz));
+    e::packer pa = list->pack();
+    pa = pa << static_cast<uint32_t>(m_placement.size());
+    e::ao_hash_map<region_id, uint64_t, id, defaultri> new_shard_of;
+
+    for (std::map<region_id, uint64_t>::iterator p = m_placement.begin();
+            p != m_placement.end(); ++p)
+    {
+        const uint32_t shard = p->second == m_memory_shard ? MEMORY_SHARD : p->second;
+        pa = pa << p->first << shard;
+        new_shard_of.put(p->first, p->second);
+    }
+
+    // the placement must be on disk before anything is written where it
+    // says; a restart that lost it would look for regions in the wrong place
+    leveldb::WriteOptions wopts;
+    wopts.sync = true;
+    leveldb::Status st = m_db->Put(wopts, leveldb::Slice("shards", 6),
+                                   leveldb::Slice(reinterpret_cast<const char*>(list->data()), list->size()));
+
+    if (!st.ok())
+    {
+        LOG(ERROR) << "LevelDB corruption: could not save where regions live: " << st.ToString();
+        abort();
+    }
+
+    {
+        po6::threads::mutex::hold hold(&m_protect_placement);
+        m_shard_of.swap(&new_shard_of);
+    }
+
+    if (m_memory_shard > 1)
+    {
+        LOG(INFO) << "placed " << fresh.size() << " new regions on "
+                  << m_shards.size() << " LevelDB instances";
+    }
+}
+
+void
+datalayer :: debug_dump()
+{
+    LOG(INFO) << "index state ===================================================================";
+
+    for (size_t i = 0; i < m_indices.size(); ++i)
+    {
+        LOG(INFO) << "index id=" << m_indices[i].ii.get()
+                  << " region=" << m_indices[i].ri.get()
+                  << " usable=" << (m_indices[i].is_usable() ? "yes" : "no");
+    }
+
+    m_checkpointer->debug_dump();
+    m_mediator->debug_dump();
+
+    for (size_t i = 0; i < m_indexers.size(); ++i)
+    {
+        m_indexers[i]->debug_dump();
+    }
+
+    m_wiper->debug_dump();
+    m_prefetcher->debug_dump();
+    m_filter_builder->debug_dump();
+    m_divider->debug_dump();
+}
+
+bool
+datalayer :: get_property(const e::slice& property,
+                          std::string* value)
+{
+    leveldb::Slice prop(reinterpret_cast<const char*>(property.data()), property.size());
+
+    // memory adds up across instances; anything else is the first one's
+    if (prop != leveldb::Slice("leveldb.approximate-memory-usage") || m_shards.size() <= 1)
+    {
+        return m_db->GetProperty(prop, value);
+    }
+
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        std::string tmp;
+
+        if (!m_shards[i]->GetProperty(prop, &tmp))
+        {
+            return false;
+        }
+
+        total += strtoull(tmp.c_str(), NULL, 10);
+    }
+
+    // so are the in-memory instance's tables and log
+    total += m_memory_env->bytes();
+    std::ostringstream ostr;
+    ostr << total;
+    *value = ostr.str();
+    return true;
+}
+
+void
+datalayer :: sample_compaction()
+{
+    // writes stall on whichever instance falls furthest behind
+    uint64_t l0 = 0;
+    uint64_t debt = 0;
+    uint64_t pressure = 0;
+
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        uint64_t shard_l0 = 0;
+        uint64_t shard_debt = 0;
+        uint64_t shard_pressure = 0;
+
+        if (sample_compaction(m_shards[i].get(), &shard_l0, &shard_debt, &shard_pressure))
+        {
+            l0 = std::max(l0, shard_l0);
+            debt += shard_debt;
+            pressure = std::max(pressure, shard_pressure);
+        }
+    }
+
+    e::atomic::store_64_nobarrier(&m_compaction_l0, l0);
+    e::atomic::store_64_nobarrier(&m_compaction_debt, debt);
+    e::atomic::store_64_nobarrier(&m_compaction_pressure, pressure);
+}
+
+bool
+datalayer :: sample_compaction(leveldb::DB* db, uint64_t* _l0,
+                               uint64_t* _debt, uint64_t* _pressure)
+{
+    std::string stats;
+
+    if (!db->GetProperty(leveldb::Slice("leveldb.stats"), &stats))
+    {
+        return false;
+    }
+
+    uint64_t l0 = 0;
+    uint64_t debt = 0;
+    std::istringstream lines(stats);
+    std::string line;
+
+    // one line per level that has tables:  level, tables, MB, and then the
+    // compaction time and bytes read and written, which this ignores
+    while (std::getline(lines, line))
+    {
+        int level;
+        int files;
+        double size;
+
+        if (sscanf(line.c_str(), "%d %d %lf", &level, &files, &size) != 3 ||
+            level < 0 || files < 0 || size < 0)
+        {
+            continue;
+        }
+
+        if (level == 0)
+        {
+            l0 = files;
+            continue;
+        }
+
+        uint64_t target = COMPACTION_LEVEL1_BYTES;
+
+        for (int i = 1; i < level && target < UINT64_MAX / 10; ++i)
+        {
+            target *= 10;
+        }
+
+        const uint64_t bytes = size * 1048576.;
+        debt += bytes > target ? bytes - target : 0;
+    }
+
+    uint64_t pressure = 0;
+
+    if (l0 > COMPACTION_L0_SOFT)
+    {
+        pressure = (std::min<uint64_t>(l0, COMPACTION_L0_HARD) - COMPACTION_L0_SOFT) * 1000
+                 / (COMPACTION_L0_HARD - COMPACTION_L0_SOFT);
+    }
+
+    if (debt > COMPACTION_DEBT_SOFT)
+    {
+        const uint64_t over = std::min(debt, COMPACTION_DEBT_HARD) - COMPACTION_DEBT_SOFT;
+        pressure = std::max(pressure, over / ((COMPACTION_DEBT_HARD - COMPACTION_DEBT_SOFT) / 1000));
+    }
+
+    *_l0 = l0;
+    *_debt = debt;
+    *_pressure = pressure;
+    return true;
+}
+
+std::string
+datalayer :: get_timestamp(const region_id& ri)
+{
+    std::string timestamp;
+    db_for(ri)->GetReplayTimestamp(&timestamp);
+    return timestamp;
+}
+
+uint64_t
+datalayer :: approximate_size()
+{
+    leveldb::Slice start("\x00", 1);
+    leveldb::Slice limit("\xff", 1);
+    leveldb::Range r(start, limit);
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < m_shards.size(); ++i)
+    {
+        uint64_t ret = 0;
+        m_shards[i]->GetApproximateSizes(&r, 1, &ret);
+        total += ret;
+    }
+
+    return total;
+}
+
+uint64_t
+datalayer :: approximate_size(const region_id& ri)
+{
+    const size_t sz = object_prefix_sz(ri);
+    char buf[2 * (sizeof(uint8_t) + VARINT_64_MAX_SIZE)];
+    char* ptr = buf;
+    ptr = encode_object_prefix(ri, ptr);
+    ptr = encode_object_prefix(ri, ptr);
+    encode_bump(buf + sz, buf + 2 * sz);
+    leveldb::Range r(leveldb::Slice(buf, sz), leveldb::Slice(buf + sz, sz));
+    uint64_t ret = 0;
+    db_for(ri)->GetApproximateSizes(&r, 1, &ret);
+    return ret;
+}
+
+void
+datalayer :: cache_stats(uint64_t* hits, uint64_t* misses, uint64_t* bytes)
+{
+    *hits = m_cache.hits();
+    *misses = m_cache.misses();
+    *bytes = m_cache.bytes();
+}
+
+void
+datalayer :: warm_cache_stats(uint64_t* hits, uint64_t* misses, uint64_t* bytes)
+{
+    *hits = m_warm.hits();
+    *misses = m_warm.misses();
+    *bytes = m_warm.bytes();
+}
+
+void
+datalayer :: group_commit_stats(uint64_t* writes, uint64_t* batches)
+{
+    *writes = 0;
+    *batches = 0;
+
+    for (size_t i = 0; i < m_group_commits.size(); ++i)
+    {
+        *writes += m_group_commits[i]->writes();
+        *batches += m_group_commits[i]->batches();
+    }
+}
+
+void
+datalayer :: block_cache_stats(uint64_t* hits, uint64_t* misses)
+{
+    *hits = m_block_cache.get() ? m_block_cache->hits() : 0;
+    *misses = m_block_cache.get() ? m_block_cache->misses() : 0;
+}
+
+uint64_t
+datalayer :: block_cache_size()
+{
+    return m_block_cache.get() ? m_block_cache->capacity() : 0;
+}
+
+void
+datalayer :: filter_stats(uint64_t* checks, uint64_t* negatives)
+{
+    *checks = m_filter_policy.get() ? m_filter_policy->checks() : 0;
+    *negatives = m_filter_policy.get() ? m_filter_policy->negatives() : 0;
+}
+
+void
+datalayer :: cold_tier_stats(uint64_t* hits, uint64_t* misses,
+                             uint64_t* tables, uint64_t* bytes)
+{
+    *hits = m_cold_block_cache.get() ? m_cold_block_cache->hits() : 0;
+    *misses = m_cold_block_cache.get() ? m_cold_block_cache->misses() : 0;
+    *tables = m_tiers.get() ? m_tiers->migrated_tables() : 0;
+    *bytes = m_tiers.get() ? m_tiers->migrated_bytes() : 0;
+}
+
+uint64_t
+datalayer :: cold_block_cache_size()
+{
+    return m_cold_block_cache.get() ? m_cold_block_cache->capacity() : 0;
+}
+
+void
+datalayer :: write_stall_stats(uint64_t* stalls, uint64_t* nanos)
+{
+    *stalls = 0;
+    *nanos = 0;
+
+    for (size_t i = 0; i < m_group_commits.size(); ++i)
+    {
+        *stalls += m_group_commits[i]->stalls();
+        *nanos += m_group_commits[i]->stall_time();
+    }
+}
+
+uint64_t
+datalayer :: compaction_pressure()
+{
+    const uint64_t now = po6::monotonic_time();
+    const uint64_t then = e::atomic::load_64_nobarrier(&m_compaction_sampled_at);
+
+    // one thread samples while the others keep using the last sample
+    if (now - then >= COMPACTION_SAMPLE_NANOS &&
+        e::atomic::compare_and_swap_64_nobarrier(&m_compaction_sampled_at, then, now) == then)
+    {
+        sample_compaction();
+    }
+
+    return e::atomic::load_64_nobarrier(&m_compaction_pressure);
+}
+
+void
+datalayer :: compaction_stats(uint64_t* l0_files, uint64_t* debt, uint64_t* pressure)
+{
+    *pressure = compaction_pressure();
+    *l0_files = e::atomic::load_64_nobarrier(&m_compaction_l0);
+    *debt = e::atomic::load_64_nobarrier(&m_compaction_debt);
+}
+
+void
+datalayer :: checkpoint_stats(uint64_t* records, uint64_t* backlog,
+                              uint64_t* collected, uint64_t* gc_time)
+{
+    m_checkpointer->gc_stats(records, backlog, collected, gc_time);
+}
+
+hyperdex::latency_histogram*
+datalayer :: write_latency(durability_level d)
+{
+    return &m_write_latency[d];
+}
+
+void
+datalayer :: plan_cache_stats(uint64_t* hits, uint64_t* misses)
+{
+    *hits = m_plans->hits();
+    *misses = m_plans->misses();
+}
+
+void
+datalayer :: value_log_stats(uint64_t* segments, uint64_t* bytes,
+                             uint64_t* live, uint64_t* reclaimed)
+{
+    m_vlog.stats(segments, bytes, live, reclaimed);
+}
+
+void
+datalayer :: compression_stats(uint64_t* dictionaries, uint64_t* raw, uint64_t* stored)
+{
+    m_compressor.stats(dictionaries, raw, stored);
+}
+
+void
+datalayer :: maintenance_stats(uint64_t* bytes, uint64_t* slept, uint64_t* compactions)
+{
+    m_maintenance.stats(bytes, slept);
+    po6::threads::mutex::hold hold(&m_compact_mtx);
+    *compactions = m_compactions;
+}
+
+void
+datalayer :: index_filter_stats(uint64_t* filters, uint64_t* bytes, uint64_t* negatives)
+{
+    *filters = e::atomic::load_64_nobarrier(&m_filter_count);
+    *bytes = e::atomic::load_64_nobarrier(&m_filter_bytes);
+    *negatives = m_filter_negatives.read();
+}
+
+void
+datalayer :: indexer_stats(uint64_t* objects, uint64_t* bytes, uint64_t* pending)
+{
+    *objects = 0;
+    *bytes = 0;
+    *pending = 0;
+
+    for (size_t i = 0; i < m_indexers.size(); ++i)
+    {
+        uint64_t o = 0;
+        uint64_t b = 0;
+        uint64_t p = 0;
+        m_indexers[i]->stats(&o, &b, &p);
+        *objects += o;
+        *bytes += b;
+        *pending += p;
+    }
+}
+
+datalayer::returncode
+datalayer :: get(const region_id& ri,
+                 const e::slice& key,
+                 std::vector<e::slice>* value,
+                 uint64_t* version,
+                 reference* ref)
+{
+    returncode rc = read_whole(ri, key, NULL, ref);
+
+    if (rc != SUCCESS)
+    {
+        return rc;
+    }
+
+    e::slice v(ref->m_backing.data(), ref->m_backing.size());
+    return decode_value(v, value, version);
+}
+
+datalayer::returncode
+datalayer :: get_remembered(const region_id& ri,
+                            const e::slice& key,
+                            std::vector<e::slice>* value,
+                            uint64_t* version,
+                            reference* ref,
+                            uint64_t* generation)
+{
+    *generation = 0;
+
+    if (m_warm.enabled() &&
+        m_warm.lookup(ri, key, &ref->m_backing, generation))
+    {
+        // an empty entry remembers that the key is not on disk
+        if (ref->m_backing.empty())
+        {
+            return NOT_FOUND;
+        }
+
+        e::slice v(ref->m_backing.data(), ref->m_backing.size());
+        return decode_value(v, value, version);
+    }
+
+    return get(ri, key, value, version, ref);
+}
+
+void
+datalayer :: remember(const region_id& ri,
+                      const e::slice& key,
+                      const std::vector<e::slice>* value,
+                      uint64_t version,
+                      uint64_t generation)
+{
+    if (!m_warm.enabled())
+    {
+        return;
+    }
+
+    std::string encoded;
+
+    if (value)
+    {
+        std::vector<char> scratch;
+        leveldb::Slice lval;
+        encode_value(*value, version, &scratch, &lval);
+        encoded.assign(lval.data(), lval.size());
+    }
+
+    m_warm.replace(ri, key, generation, encoded);
+}
+
+datalayer::returncode
+datalayer :: get(snapshot snap,
+                 const region_id& ri,
+                 const e::slice& key,
+                 std::vector<e::slice>* value,
+                 uint64_t* version,
+                 reference* ref)
+{
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    std::vector<char> scratch;
+
+    // create the encoded key
+    leveldb::Slice lkey;
+    encode_key(ri, sc.attrs[0].type, key, &scratch, &lkey);
+
+    // perform the read
+    leveldb::ReadOptions opts;
+    opts.fill_cache = true;
+    opts.verify_checksums = true;
+    opts.snapshot = snap.get();
+    leveldb::Status st = snap.db()->Get(opts, lkey, &ref->m_backing);
+
+    if (st.ok())
+    {
+        returncode rc = unchunk(ri, key, snap.get(), NULL, &ref->m_backing);
+
+        if (rc != SUCCESS)
+        {
+            return rc;
+        }
+
+        e::slice v(ref->m_backing.data(), ref->m_backing.size());
+        return decode_value(v, value, version);
+    }
+    else if (st.IsNotFound())
+    {
+        return NOT_FOUND;
+    }
+    else
+    {
+        return handle_error(st);
+    }
+}
+
+datalayer::returncode
+datalayer :: get_partial(const region_id& ri,
+                         const e::slice& key,
+                         const std::vector<uint16_t>& attrs,
+                         std::vector<e::slice>* value,
+                         uint64_t* version,
+                         reference* ref)
+{
+    returncode rc = read_whole(ri, key, &attrs, ref);
+
+    if (rc != SUCCESS)
+    {
+        return rc;
+    }
+
+    e::slice v(ref->m_backing.data(), ref->m_backing.size());
+    return decode_value_projection(v, attrs, value, version);
+}
+
+datalayer::returncode
+datalayer :: read(const region_id& ri,
+                  const e::slice& key,
+                  reference* ref)
+{
+    uint64_t generation = 0;
+
+    if (m_cache.enabled() &&
+        m_cache.lookup(ri, key, &ref->m_backing, &generation))
+    {
+        return SUCCESS;
+    }
+
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    std::vector<char> scratch;
+
+    // create the encoded key
+    leveldb::Slice lkey;
+    encode_key(ri, sc.attrs[0].type, key, &scratch, &lkey);
+
+    // perform the read
+    leveldb::ReadOptions opts;
+    opts.fill_cache = true;
+    opts.verify_checksums = true;
+    leveldb::Status st = db_for(ri)->Get(opts, lkey, &ref->m_backing);
+
+    if (st.ok())
+    {
+        if (m_cache.enabled())
+        {
+            m_cache.insert(ri, key, generation, ref->m_backing);
+        }
+
+        return SUCCESS;
+    }
+    else if (st.IsNotFound())
+    {
+        return NOT_FOUND;
+    }
+    else
+    {
+        return handle_error(st);
+    }
+}
+
+datalayer::returncode
+datalayer :: read_whole(const region_id& ri,
+                        const e::slice& key,
+                        const std::vector<uint16_t>* attrs,
+                        reference* ref)
+{
+    returncode rc = read(ri, key, ref);
+
+    if (rc != SUCCESS)
+    {
+        return rc;
+    }
+
+    std::vector<e::slice> value;
+    std::vector<uint64_t> chunked;
+    uint64_t version;
+
+    if (decode_value_chunked(e::slice(ref->m_backing.data(), ref->m_backing.size()),
+                             &value, &chunked, &version) != SUCCESS ||
+        chunked.empty())
+    {
+        return unchunk(ri, key, NULL, attrs, &ref->m_backing);
+    }
+
+    // read the object again from the snapshot its chunks come from, so that
+    // a racing write cannot pair one version's object with another's pieces
+    snapshot snap(make_snapshot(ri));
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    std::vector<char> scratch;
+    leveldb::Slice lkey;
+    encode_key(ri, sc.attrs[0].type, key, &scratch, &lkey);
+    leveldb::ReadOptions opts;
+    opts.fill_cache = true;
+    opts.verify_checksums = true;
+    opts.snapshot = snap.get();
+    leveldb::Status st = snap.db()->Get(opts, lkey, &ref->m_backing);
+
+    if (st.IsNotFound())
+    {
+        return NOT_FOUND;
+    }
+    else if (!st.ok())
+    {
+        return handle_error(st);
+    }
+
+    return unchunk(ri, key, snap.get(), attrs, &ref->m_backing);
+}
+
+datalayer::returncode
+datalayer :: del(const region_id& ri,
+                 const e::slice& key,
+                 const std::vector<e::slice>& old_value)
+{
+    leveldb::WriteBatch updates;
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    std::vector<char> scratch;
+
+    // create the encoded key
+    leveldb::Slice lkey;
+    encode_key(ri, sc.attrs[0].type, key, &scratch, &lkey);
+
+    // delete the actual object
+    updates.Delete(lkey);
+    write_chunks(ri, key, &old_value, NULL, 0, &updates);
+    write_count(ri, -1, &updates);
+
+    // delete the index entries
+    std::vector<const index*> indices;
+    find_indices(ri, &indices);
+    create_index_changes(sc, ri, indices, key, &old_value, NULL, &updates);
+
+    // Perform the write
+    leveldb::Status st = commit_for(ri)->write(&updates, sc.durability);
+
+    if (m_cache.enabled())
+    {
+        m_cache.invalidate(ri, key);
+    }
+
+    if (m_warm.enabled())
+    {
+        m_warm.erase(ri, key);
+    }
+
+    if (st.ok())
+    {
+        return SUCCESS;
+    }
+    else if (st.IsNotFound())
+    {
+        return NOT_FOUND;
+    }
+    else
+    {
+        return handle_error(st);
+    }
+}
+
+datalayer::returncode
+datalayer :: put(const region_id& ri,
+                 const e::slice& key,
+                 const std::vector<e::slice>& new_value,
+                 uint64_t version)
+{
+    leveldb::WriteBatch updates;
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    std::vector<char> scratch1;
+    std::vector<char> scratch2;
+
+    // create the encoded key
+    leveldb::Slice lkey;
+    encode_key(ri, sc.attrs[0].type, key, &scratch1, &lkey);
+
+    // create the encoded value
+    value_log::appends logged(&m_vlog);
+    leveldb::Slice lval;
+    returncode rc = encode_object(ri, sc, new_value, version, &logged, &scratch2, &lval);
+
+    if (rc != SUCCESS ||
+        (rc = sync_logged(logged, sc.durability)) != SUCCESS)
+    {
+        return rc;
+    }
+
+    // put the actual object
+    updates.Put(lkey, lval);
+    write_chunks(ri, key, NULL, &new_value, version, &updates);
+    write_count(ri, 1, &updates);
+
+    // put the index entries
+    std::vector<const index*> indices;
+    find_indices(ri, &indices);
+    create_index_changes(sc, ri, indices, key, NULL, &new_value, &updates);
+    add_to_filters(ri, sc, indices, NULL, new_value);
+
+    // ensure we've recorded a version at least as high as this key
+    write_version(ri, version, &updates);
+
+    // Perform the write
+    leveldb::Status st = commit_for(ri)->write(&updates, sc.durability);
+
+    if (m_cache.enabled())
+    {
+        m_cache.invalidate(ri, key);
+    }
+
+    if (m_warm.enabled())
+    {
+        m_warm.erase(ri, key);
+    }
+
+    if (st.ok())
+    {
+        update_memory_version(ri, version);
+        return SUCCESS;
+    }
+    else
+    {
+        return handle_error(st);
+    }
+}
+
+datalayer::returncode
+datalayer :: overput(const region_id& ri,
+                     const e::slice& key,
+                     const std::vector<e::slice>& old_value,
+                     const std::vector<e::slice>& new_value,
+                     uint64_t version)
+{
+    leveldb::WriteBatch updates;
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    std::vector<char> scratch1;
+    std::vector<char> scratch2;
+
+    // create the encoded key
+    leveldb::Slice lkey;
+    encode_key(ri, sc.attrs[0].type, key, &scratch1, &lkey);
+
+    // create the encoded value
+    value_log::appends logged(&m_vlog);
+    leveldb::Slice lval;
+    returncode rc = encode_object(ri, sc, new_value, version, &logged, &scratch2, &lval);
+
+    if (rc != SUCCESS ||
+        (rc = sync_logged(logged, sc.durability)) != SUCCESS)
+    {
+        return rc;
+    }
+
+    // put the actual object
+    updates.Put(lkey, lval);
+    write_chunks(ri, key, &old_value, &new_value, version, &updates);
+
+    // put the index entries
+    std::vector<const index*> indices;
+    find_indices(ri, &indices);
+    create_index_changes(sc, ri, indices, key, &old_value, &new_value, &updates);
+    add_to_filters(ri, sc, indices, &old_value, new_value);
+
+    // ensure we've recorded a version at least as high as this key
+    write_version(ri, version, &updates);
+
+    // Perform the write
+    leveldb::Status st = commit_for(ri)->write(&updates, sc.durability);
+
+    if (m_cache.enabled())
+    {
+        m_cache.invalidate(ri, key);
+    }
+
+    if (m_warm.enabled())
+    {
+        m_warm.erase(ri, key);
+    }
+
+    if (st.ok())
+    {
+        update_memory_version(ri, version);
+        return SUCCESS;
+    }
+    else
+    {
+        return handle_error(st);
+    }
+}
 
 datalayer::returncode
-datalayer :: get(const region_id& ri,
-                 const e::slice& key,
-                 std::vector<e::slice>* value,
-                 uint64_t* version,
-                 reference* ref)
+datalayer :: uncertain_del(const region_id& ri,
+                           const e::slice& key)
+{
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    std::vector<char> scratch;
+
+    // create the encoded key
+    leveldb::Slice lkey;
+    encode_key(ri, sc.attrs[0].type, key, &scratch, &lkey);
+
+    // perform the read
+    std::string ref;
+    leveldb::ReadOptions opts;
+    opts.fill_cache = true;
+    opts.verify_checksums = true;
+    leveldb::Status st = db_for(ri)->Get(opts, lkey, &ref);
+
+    if (st.ok())
+    {
+        std::vector<e::slice> old_value;
+        uint64_t old_version;
+        returncode rc = unchunk(ri, key, NULL, NULL, &ref);
+
+        if (rc == SUCCESS)
+        {
+            rc = decode_value(e::slice(ref.data(), ref.size()),
+                              &old_value, &old_version);
+        }
+
+        if (rc != SUCCESS)
+        {
+            return rc;
+        }
+
+        if (old_value.size() + 1 != sc.attrs_sz)
+        {
+            return BAD_ENCODING;
+        }
+
+        rc = del(ri, key, old_value);
+        forget(ri, key);
+        return rc;
+    }
+    else if (st.IsNotFound())
+    {
+        return SUCCESS;
+    }
+    else
+    {
+        return handle_error(st);
+    }
+}
+
+datalayer::returncode
+datalayer :: uncertain_put(const region_id& ri,
+                           const e::slice& key,
+                           const std::vector<e::slice>& new_value,
+                           uint64_t version)
+{
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    std::vector<char> scratch;
+
+    // create the encoded key
+    leveldb::Slice lkey;
+    encode_key(ri, sc.attrs[0].type, key, &scratch, &lkey);
+
+    // perform the read
+    std::string ref;
+    leveldb::ReadOptions opts;
+    opts.fill_cache = true;
+    opts.verify_checksums = true;
+    leveldb::Status st = db_for(ri)->Get(opts, lkey, &ref);
+
+    if (st.ok())
+    {
+        std::vector<e::slice> old_value;
+        uint64_t old_version;
+        returncode rc = unchunk(ri, key, NULL, NULL, &ref);
+
+        if (rc == SUCCESS)
+        {
+            rc = decode_value(e::slice(ref.data(), ref.size()),
+                              &old_value, &old_version);
+        }
+
+        if (rc != SUCCESS)
+        {
+            return rc;
+        }
+
+        if (old_value.size() + 1 != sc.attrs_sz)
+        {
+            return BAD_ENCODING;
+        }
+
+        rc = overput(ri, key, old_value, new_value, version);
+        forget(ri, key);
+        return rc;
+    }
+    else if (st.IsNotFound())
+    {
+        returncode rc = put(ri, key, new_value, version);
+        forget(ri, key);
+        return rc;
+    }
+    else
+    {
+        return handle_error(st);
+    }
+}
+
+datalayer::returncode
+datalayer :: uncertain_write(const region_id& ri,
+                             const std::vector<e::slice>& keys,
+                             const std::vector<const std::vector<e::slice>*>& values,
+                             const std::vector<uint64_t>& versions)
+{
+    assert(keys.size() == values.size());
+    assert(keys.size() == versions.size());
+    leveldb::WriteBatch updates;
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    std::vector<const index*> indices;
+    find_indices(ri, &indices);
+    std::vector<char> scratch1;
+    std::vector<char> scratch2;
+    leveldb::ReadOptions opts;
+    opts.fill_cache = true;
+    opts.verify_checksums = true;
+    int64_t delta = 0;
+    uint64_t max_version = 0;
+    value_log::appends logged(&m_vlog);
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        // create the encoded key
+        leveldb::Slice lkey;
+        encode_key(ri, sc.attrs[0].type, keys[i], &scratch1, &lkey);
+
+        // perform the read
+        std::string ref;
+        leveldb::Status st = db_for(ri)->Get(opts, lkey, &ref);
+        std::vector<e::slice> old_value;
+        uint64_t old_version;
+        bool found = false;
+
+        if (st.ok())
+        {
+            returncode rc = unchunk(ri, keys[i], NULL, NULL, &ref);
+
+            if (rc == SUCCESS)
+            {
+                rc = decode_value(e::slice(ref.data(), ref.size()),
+                                  &old_value, &old_version);
+            }
+
+            if (rc != SUCCESS)
+            {
+                return rc;
+            }
+
+            if (old_value.size() + 1 != sc.attrs_sz)
+            {
+                return BAD_ENCODING;
+            }
+
+            found = true;
+        }
+        else if (!st.IsNotFound())
+        {
+            return handle_error(st);
+        }
+
+        if (values[i])
+        {
+            leveldb::Slice lval;
+            returncode rc = encode_object(ri, sc, *values[i], versions[i], &logged, &scratch2, &lval);
+
+            if (rc != SUCCESS)
+            {
+                return rc;
+            }
+
+            updates.Put(lkey, lval);
+            write_chunks(ri, keys[i], found ? &old_value : NULL, values[i], versions[i], &updates);
+            create_index_changes(sc, ri, indices, keys[i],
+                                 found ? &old_value : NULL, values[i], &updates);
+            add_to_filters(ri, sc, indices, found ? &old_value : NULL, *values[i]);
+            max_version = std::max(max_version, versions[i]);
+            delta += found ? 0 : 1;
+        }
+        else if (found)
+        {
+            updates.Delete(lkey);
+            write_chunks(ri, keys[i], &old_value, NULL, 0, &updates);
+            create_index_changes(sc, ri, indices, keys[i], &old_value, NULL, &updates);
+            delta -= 1;
+        }
+    }
+
+    if (delta != 0)
+    {
+        write_count(ri, delta, &updates);
+    }
+
+    // ensure we've recorded a version at least as high as every key
+    write_version(ri, max_version, &updates);
+    returncode rc = sync_logged(logged, sc.durability);
+
+    if (rc != SUCCESS)
+    {
+        return rc;
+    }
+
+    // Perform the write
+    leveldb::Status st = commit_for(ri)->write(&updates, sc.durability);
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        if (m_cache.enabled())
+        {
+            m_cache.invalidate(ri, keys[i]);
+        }
+
+        if (m_warm.enabled())
+        {
+            m_warm.erase(ri, keys[i]);
+        }
+
+        forget(ri, keys[i]);
+    }
+
+    if (st.ok())
+    {
+        update_memory_version(ri, max_version);
+        return SUCCESS;
+    }
+    else
+    {
+        return handle_error(st);
+    }
+}
+
+datalayer::snapshot
+datalayer :: make_snapshot(const region_id& ri)
+{
+    const leveldb_db_ptr& db(db_for(ri));
+    return leveldb_snapshot_ptr(db, db->GetSnapshot());
+}
+
+size_t
+datalayer :: shard_of(const region_id& ri)
+{
+    uint64_t shard = 0;
+
+    if (m_shards.size() > 1)
+    {
+        m_shard_of.get(ri, &shard);
+    }
+
+    return shard;
+}
+
+namespace
+{
+
+// a partial index can answer a search only if the search is confined to the
+// objects the index covers
+bool
+answers_search(const hyperdex::schema& sc,
+               const hyperdex::index& idx,
+               const std::vector<hyperdex::attribute_check>& checks)
+{
+    if (!idx.partial())
+    {
+        return true;
+    }
+
+    std::vector<hyperdex::attribute_check> filter;
+    return hyperdex::unpack_index_filter(idx.filter, &filter) &&
+           hyperdex::attribute_checks_imply(sc, checks, filter);
+}
+
+// Intersecting sorted iterators by seeking costs a seek into each of the
+// others for every entry of the cheapest; reading all of them front to back
+// into memory costs only their sizes, and can intersect unsorted iterators
+// that seeking must leave out.  Choose the latter when it fits in memory and
+// reads less than the seeks would.
+bool
+prefer_materialized(const std::vector<e::intrusive_ptr<datalayer::index_iterator> >& sorted,
+                    const std::vector<e::intrusive_ptr<datalayer::index_iterator> >& unsorted,
+                    leveldb::DB* db)
+{
+    if (sorted.size() + unsorted.size() < 2)
+    {
+        return false;
+    }
+
+    uint64_t total = 0;
+    uint64_t cheapest = UINT64_MAX;
+
+    for (size_t i = 0; i < sorted.size(); ++i)
+    {
+        uint64_t c = sorted[i]->cost(db);
+        total += c;
+        cheapest = std::min(cheapest, c);
+    }
+
+    for (size_t i = 0; i < unsorted.size(); ++i)
+    {
+        total += unsorted[i]->cost(db);
+    }
+
+    if (total > MATERIALIZE_MAX_BYTES)
+    {
+        return false;
+    }
+
+    // seeking uses at most one unsorted iterator and ignores the rest
+    if (sorted.empty() || !unsorted.empty())
+    {
+        return true;
+    }
+
+    return total < cheapest * (sorted.size() - 1) * MATERIALIZE_SEEK_FACTOR;
+}
+
+} // namespace
+
+datalayer::iterator*
+datalayer :: make_search_iterator(snapshot snap,
+                                  const region_id& ri,
+                                  const std::vector<attribute_check>& checks,
+                                  std::ostringstream* ostr,
+                                  bool include_expired)
+{
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    std::vector<e::intrusive_ptr<index_iterator> > iterators;
+
+    // pull a set of range queries from checks
+    std::vector<range> ranges;
+    range_searches(sc, checks, &ranges);
+
+    // a regex anchored to a literal prefix only matches strings between the
+    // prefix and the prefix with its last byte bumped, so a string index can
+    // narrow the scan; the bumped bound is a superset, and the checks still
+    // run on every object
+    std::list<std::string> prefix_bounds;
+
+    for (size_t i = 0; i < checks.size(); ++i)
+    {
+        if (checks[i].predicate != HYPERPREDICATE_REGEX ||
+            checks[i].datatype != HYPERDATATYPE_STRING ||
+            checks[i].attr >= sc.attrs_sz ||
+            sc.attrs[checks[i].attr].type != HYPERDATATYPE_STRING)
+        {
+            continue;
+        }
+
+        compiled_regex re;
+        re.compile(checks[i].value.data(), checks[i].value.size());
+
+        if (re.literal_prefix().empty())
+        {
+            continue;
+        }
+
+        range r;
+        r.attr = checks[i].attr;
+        r.type = HYPERDATATYPE_STRING;
+        r.invalid = false;
+        prefix_bounds.push_back(re.literal_prefix());
+        r.start = e::slice(prefix_bounds.back());
+        r.has_start = true;
+        std::string upper(re.literal_prefix());
+
+        while (!upper.empty() && upper[upper.size() - 1] == '\xff')
+        {
+            upper.resize(upper.size() - 1);
+        }
+
+        if (!upper.empty())
+        {
+            ++upper[upper.size() - 1];
+            prefix_bounds.push_back(upper);
+            r.end = e::slice(prefix_bounds.back());
+            r.has_end = true;
+        }
+
+        if (ostr) *ostr << " regex on attr " << r.attr << " has literal prefix "
+                        << r.start.hex() << "\n";
+        ranges.push_back(r);
+    }
+
+    const index_encoding* key_ie = index_encoding::lookup(sc.attrs[0].type);
+    const index_info* key_ii = index_info::lookup(sc.attrs[0].type);
+
+    // an invalid range matches nothing, whatever the plan
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        if (ranges[i].invalid)
+        {
+            if (ostr) *ostr << "encountered invalid range; returning no results\n";
+            return new dummy_iterator();
+        }
+    }
+
+    // so does a range that no object's attribute lies in
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        if (filtered_out(ri, sc, ranges[i]))
+        {
+            if (ostr) *ostr << "the filter for attr " << ranges[i].attr
+                            << " rules out every value in range; returning no results\n";
+            return new dummy_iterator();
+        }
+    }
+
+    e::intrusive_ptr<index_iterator> full_scan;
+    full_scan = key_ii->iterator_for_keys(snap, ri);
+
+    // a recent search of the same shape already weighed the indices against
+    // a full scan; trust its choice instead of asking LevelDB again
+    const plan_cache::plan cached = m_plans->lookup(ri, checks);
+
+    if (cached == plan_cache::FULL_SCAN)
+    {
+        if (ostr) *ostr << " using cached plan " << cached << "\n";
+        if (ostr) *ostr << " choosing to use " << *full_scan << "\n";
+        return new search_iterator(this, ri, full_scan, ostr, &checks, include_expired);
+    }
+
+    // for each range query, construct an iterator
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        assert(ranges[i].attr < sc.attrs_sz);
+        assert(ranges[i].type == sc.attrs[ranges[i].attr].type);
+        std::vector<const index*> indices;
+        find_indices(ri, ranges[i].attr, &indices);
+
+        for (size_t j = 0; j < indices.size(); ++j)
+        {
+            assert(indices[j]->attr == ranges[i].attr);
+            const index* idx = indices[j];
+            const index_info* ii = index_info::lookup(*idx, ranges[i].type);
+
+            if (!ii || !answers_search(sc, *idx, checks))
+            {
+                continue;
+            }
+
+            e::intrusive_ptr<index_iterator> it = ii->iterator_from_range(snap, ri, idx->id, ranges[i], key_ie);
+
+            if (it)
+            {
+                iterators.push_back(it);
+
+                if (ostr) *ostr << " considering attr " << ranges[i].attr << " Range("
+                                << ranges[i].start.hex() << ", " << ranges[i].end.hex() << ") " << ranges[i].type << " "
+                                << (ranges[i].has_start ? "[" : "<") << "-" << (ranges[i].has_end ? "]" : ">")
+                                << " " << (ranges[i].invalid ? "invalid" : "valid") << "\n";
+            }
+        }
+    }
+
+    // a composite index answers equalities on a prefix of its attributes and
+    // a range on the next with a single scan, and a spatial index a box over
+    // several of its attributes; keep the one that constrains the most
+    e::intrusive_ptr<index_iterator> composite;
+    size_t composite_constrained = 0;
+    std::vector<const index*> all_indices;
+    find_indices(ri, &all_indices);
+
+    for (size_t i = 0; i < all_indices.size(); ++i)
+    {
+        if ((all_indices[i]->type != index::COMPOSITE &&
+             all_indices[i]->type != index::SPATIAL) ||
+            !answers_search(sc, *all_indices[i], checks))
+        {
+            continue;
+        }
+
+        size_t constrained = 0;
+        e::intrusive_ptr<index_iterator> it;
+
+        if (all_indices[i]->type == index::COMPOSITE)
+        {
+            it = composite_iterator(snap, sc, ri, *all_indices[i], ranges, key_ie, &constrained);
+        }
+        else
+        {
+            it = spatial_iterator(snap, sc, ri, *all_indices[i], ranges, key_ie, &constrained);
+        }
+
+        if (it && constrained > composite_constrained)
+        {
+            composite = it;
+            composite_constrained = constrained;
+        }
+    }
+
+    if (ostr && composite) *ostr << " considering " << *composite << " over "
+                                 << composite_constrained << " attributes\n";
+
+    // For each index
+    for (size_t i = 0; i < checks.size(); ++i)
+    {
+        std::vector<const index*> indices;
+        find_indices(ri, checks[i].attr, &indices);
+
+        for (size_t j = 0; j < indices.size(); ++j)
+        {
+            const index* idx = indices[j];
+            const index_info* ii = index_info::lookup(*idx, sc.attrs[checks[i].attr].type);
+
+            if (!ii || !answers_search(sc, *idx, checks) ||
+                !ii->answers_check(*idx, checks[i]))
+            {
+                continue;
+            }
+
+            e::intrusive_ptr<index_iterator> it = ii->iterator_from_check(snap, ri, idx->id, checks[i], key_ie);
+
+            if (it)
+            {
+                iterators.push_back(it);
+            }
+        }
+    }
+
+    if (cached == plan_cache::NONE)
+    {
+        // figure out the cost of accessing all objects
+        if (ostr) *ostr << " accessing all objects has cost " << full_scan->cost(snap.db()) << "\n";
+
+        // figure out the cost of each iterator
+        // we do this here and not below so that iterators can cache the size and we
+        // don't ping-pong between HyperDex and LevelDB.
+        for (size_t i = 0; i < iterators.size(); ++i)
+        {
+            uint64_t iterator_cost = iterators[i]->cost(snap.db());
+            if (ostr) *ostr << " iterator " << *iterators[i] << " has cost " << iterator_cost << "\n";
+        }
+    }
+    else
+    {
+        if (ostr) *ostr << " using cached plan " << cached << "\n";
+    }
+
+    std::vector<e::intrusive_ptr<index_iterator> > sorted;
+    std::vector<e::intrusive_ptr<index_iterator> > unsorted;
+
+    for (size_t i = 0; i < iterators.size(); ++i)
+    {
+        if (iterators[i]->sorted())
+        {
+            sorted.push_back(iterators[i]);
+        }
+        else
+        {
+            unsorted.push_back(iterators[i]);
+        }
+    }
+
+    e::intrusive_ptr<index_iterator> best;
+
+    // one scan of a composite index beats intersecting single attributes
+    if (composite && (composite_constrained > 1 || iterators.empty()))
+    {
+        best = composite;
+    }
+
+    if (!best && prefer_materialized(sorted, unsorted, snap.db()))
+    {
+        best = new materialized_intersect_iterator(snap, iterators, key_ie);
+    }
+
+    if (!best && !sorted.empty())
+    {
+        best = new intersect_iterator(snap, sorted);
+    }
+    else if (!best && !unsorted.empty())
+    {
+        best = unsorted[0];
+    }
+    else if (!best)
+    {
+        best = full_scan;
+    }
+
+    assert(best);
+
+    if (cached == plan_cache::NONE)
+    {
+        uint64_t cost = best->cost(snap.db());
+
+        if (cost > 0 && cost * 4 > full_scan->cost(snap.db()))
+        {
+            best = full_scan;
+        }
+
+        m_plans->insert(ri, checks, best == full_scan ? plan_cache::FULL_SCAN
+                                                      : plan_cache::INDICES);
+    }
+
+    if (ostr) *ostr << " choosing to use " << *best << "\n";
+    return new search_iterator(this, ri, best, ostr, &checks, include_expired);
+}
+
+datalayer::iterator*
+datalayer :: make_nearest_iterator(snapshot snap,
+                                   const region_id& ri,
+                                   const std::vector<attribute_check>& checks,
+                                   const std::vector<uint16_t>& attrs,
+                                   const std::vector<double>& point)
 {
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
-    std::vector<char> scratch;
+    assert(attrs.size() == point.size());
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    const index_encoding* key_ie = index_encoding::lookup(sc.attrs[0].type);
+    std::vector<const index*> all_indices;
+    find_indices(ri, &all_indices);
 
-    // create the encoded key
-    leveldb::Slice lkey;
-    encode_key(ri, sc.attrs[0].type, key, &scratch, &lkey);
+    for (size_t i = 0; i < all_indices.size(); ++i)
+    {
+        const index* idx = all_indices[i];
 
-    // perform the read
-    leveldb::ReadOptions opts;
-    opts.fill_cache = true;
-    opts.verify_checksums = true;
-    leveldb::Status st = m_db->Get(opts, lkey, &ref->m_backing);
+        if (idx->type != index::SPATIAL ||
+            idx->composite_sz() != attrs.size() ||
+            !answers_search(sc, *idx, checks))
+        {
+            continue;
+        }
+
+        // the index may order its attributes differently
+        std::vector<double> coords;
+
+        for (size_t j = 0; j < idx->composite_sz(); ++j)
+        {
+            size_t k = std::find(attrs.begin(), attrs.end(), idx->composite(j)) - attrs.begin();
+
+            if (k == attrs.size())
+            {
+                break;
+            }
+
+            coords.push_back(point[k]);
+        }
+
+        if (coords.size() != attrs.size())
+        {
+            continue;
+        }
+
+        e::intrusive_ptr<index_iterator> it;
+        it = spatial_iterator_from(snap, sc, ri, *idx, coords, key_ie);
+        return new search_iterator(this, ri, it, NULL, &checks, false);
+    }
 
+    return NULL;
+}
+
+datalayer::iterator*
+datalayer :: make_sorted_iterator(snapshot snap,
+                                  const region_id& ri,
+                                  const std::vector<attribute_check>& checks,
+                                  uint16_t sort_by,
+                                  bool maximize)
+{
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    assert(sort_by > 0 && sort_by < sc.attrs_sz);
+    const index_encoding* key_ie = index_encoding::lookup(sc.attrs[0].type);
+    std::vector<range> ranges;
+    range_searches(sc, checks, &ranges);
+
+    // walk the checks' range over sort_by, or all of the index without one
+    range r;
+    r.attr = sort_by;
+    r.type = sc.attrs[sort_by].type;
+    r.has_start = false;
+    r.has_end = false;
+    r.invalid = false;
+
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        if (ranges[i].invalid || filtered_out(ri, sc, ranges[i]))
+        {
+            return new dummy_iterator();
+        }
+
+        if (ranges[i].attr == sort_by)
+        {
+            r = ranges[i];
+        }
+    }
+
+    std::vector<const index*> indices;
+    find_indices(ri, sort_by, &indices);
+
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        const index* idx = indices[i];
+
+        if (idx->type != index::NORMAL ||
+            !answers_search(sc, *idx, checks))
+        {
+            continue;
+        }
+
+        const index_info* ii = index_info::lookup(*idx, r.type);
+        e::intrusive_ptr<index_iterator> it;
+
+        if (ii)
+        {
+            it = ii->iterator_in_order(snap, ri, idx->id, r, key_ie, maximize);
+        }
+
+        if (it)
+        {
+            return new search_iterator(this, ri, it, NULL, &checks, false);
+        }
+    }
+
+    return NULL;
+}
+
+bool
+datalayer :: backup(const e::slice& _name)
+{
+    leveldb::Slice name(reinterpret_cast<const char*>(_name.data()), _name.size());
+    leveldb::Status st = m_db->LiveBackup(name);
+    const std::string backup_dir(m_path + "/backup-" + name.ToString());
+
+    // the other instances back up within their own directories; gather
+    // them into the first's backup so that it is laid out as the data
+    // directory is, linking those on other disks rather than copying them;
+    // the in-memory instance has nothing to back up
+    for (size_t i = 1; st.ok() && i < m_memory_shard; ++i)
+    {
+        st = m_shards[i]->LiveBackup(name);
+
+        if (!st.ok())
+        {
+            break;
+        }
+
+        std::ostringstream from;
+        from << m_path << "/shard-" << i << "/backup-" << name.ToString();
+        std::ostringstream to;
+        to << backup_dir << "/shard-" << i;
+
+        if (rename(from.str().c_str(), to.str().c_str()) < 0 &&
+            (errno != EXDEV || symlink(from.str().c_str(), to.str().c_str()) < 0))
+        {
+            LOG(ERROR) << "could not move the backup of " << from.str()
+                       << " into " << backup_dir << ": " << strerror(errno);
+            return false;
+        }
+    }
+
+    // the objects in the backup may refer to any segment so far
     if (st.ok())
     {
-        e::slice v(ref->m_backing.data(), ref->m_backing.size());
-        return decode_value(v, value, version);
+        return m_vlog.link_into(backup_dir + "/vlog");
+    }
+    else if (st.IsCorruption())
+    {
+        LOG(ERROR) << "corruption while taking a backup: " << st.ToString();
+        return false;
     }
-    else if (st.IsNotFound())
+    else if (st.IsIOError())
     {
-        return NOT_FOUND;
+        LOG(ERROR) << "IO error while taking a backup: " << st.ToString();
+        return false;
     }
     else
     {
-        return handle_error(st);
+        LOG(ERROR) << "LevelDB returned an unknown error that we don't know how to handle: " << st.ToString();
+        return false;
     }
 }
 
 datalayer::returncode
-datalayer :: del(const region_id& ri,
-                 const e::slice& key,
-                 const std::vector<e::slice>& old_value)
+datalayer :: get_from_iterator(const region_id& ri,
+                               const schema& sc,
+                               iterator* iter,
+                               e::slice* key,
+                               std::vector<e::slice>* value,
+                               uint64_t* version,
+                               reference* ref)
+{
+    // a search iterator has usually read the object already
+    if (!iter->take_object(&ref->m_backing))
+    {
+        returncode rc = read_object(ri, sc.attrs[0].type, iter->key(),
+                                    iter->snap().get(), &ref->m_backing);
+
+        if (rc != SUCCESS)
+        {
+            return rc;
+        }
+    }
+
+    ref->m_backing += std::string(reinterpret_cast<const char*>(iter->key().data()), iter->key().size());
+    *key = e::slice(ref->m_backing.data()
+                    + ref->m_backing.size()
+                    - iter->key().size(),
+                    iter->key().size());
+    e::slice v(ref->m_backing.data(), ref->m_backing.size() - iter->key().size());
+    return decode_value(v, value, version);
+}
+
+datalayer::returncode
+datalayer :: read_object(const region_id& ri,
+                         hyperdatatype key_type,
+                         const e::slice& key,
+                         const leveldb::Snapshot* snap,
+                         std::string* backing)
 {
-    leveldb::WriteBatch updates;
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
     std::vector<char> scratch;
 
     // create the encoded key
     leveldb::Slice lkey;
-    encode_key(ri, sc.attrs[0].type, key, &scratch, &lkey);
-
-    // delete the actual object
-    updates.Delete(lkey);
-
-    // delete the index entries
-    std::vector<const index*> indices;
-    find_indices(ri, &indices);
-    create_index_changes(sc, ri, indices, key, &old_value, NULL, &updates);
+    encode_key(ri, key_type, key, &scratch, &lkey);
 
-    // Perform the write
-    leveldb::WriteOptions opts;
-    opts.sync = false;
-    leveldb::Status st = m_db->Write(opts, &updates);
+    // perform the read
+    leveldb::ReadOptions opts;
+    opts.fill_cache = true;
+    opts.verify_checksums = true;
+    opts.snapshot = snap;
+    leveldb::Status st = db_for(ri)->Get(opts, lkey, backing);
 
     if (st.ok())
     {
-        return SUCCESS;
+        return unchunk(ri, key, snap, NULL, backing);
     }
     else if (st.IsNotFound())
     {
@@ -492,494 +2931,631 @@ datalayer :: del(const region_id& ri,
     }
 }
 
-datalayer::returncode
-datalayer :: put(const region_id& ri,
-                 const e::slice& key,
-                 const std::vector<e::slice>& new_value,
-                 uint64_t version)
+namespace
 {
-    leveldb::WriteBatch updates;
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
-    std::vector<char> scratch1;
-    std::vector<char> scratch2;
-
-    // create the encoded key
-    leveldb::Slice lkey;
-    encode_key(ri, sc.attrs[0].type, key, &scratch1, &lkey);
-
-    // create the encoded value
-    leveldb::Slice lval;
-    encode_value(new_value, version, &scratch2, &lval);
-
-    // put the actual object
-    updates.Put(lkey, lval);
 
-    // put the index entries
-    std::vector<const index*> indices;
-    find_indices(ri, &indices);
-    create_index_changes(sc, ri, indices, key, NULL, &new_value, &updates);
+uint64_t
+roundup_version(uint64_t v)
+{
+    const static uint64_t REGION_PERIODIC = hyperdex::datalayer::REGION_PERIODIC;
+    v += REGION_PERIODIC;
+    v  = v & ~(REGION_PERIODIC - 1);
+    return v;
+}
 
-    // ensure we've recorded a version at least as high as this key
-    write_version(ri, version, &updates);
+}
 
-    // Perform the write
-    leveldb::WriteOptions opts;
-    opts.sync = false;
-    leveldb::Status st = m_db->Write(opts, &updates);
+bool
+datalayer :: write_version(const region_id& ri,
+                           uint64_t version,
+                           leveldb::WriteBatch* updates)
+{
+    version = roundup_version(version);
+    uint64_t* current = NULL;
 
-    if (st.ok())
-    {
-        update_memory_version(ri, version);
-        return SUCCESS;
-    }
-    else
+    if (!m_versions.mod(ri, &current) ||
+        e::atomic::load_64_nobarrier(current) >= version)
     {
-        return handle_error(st);
+        return false;
     }
+
+    char vbacking[VERSION_BUF_SIZE];
+    encode_version(ri, version, vbacking);
+    updates->Put(leveldb::Slice(vbacking, VERSION_BUF_SIZE), leveldb::Slice());
+    return true;
 }
 
-datalayer::returncode
-datalayer :: overput(const region_id& ri,
-                     const e::slice& key,
-                     const std::vector<e::slice>& old_value,
-                     const std::vector<e::slice>& new_value,
-                     uint64_t version)
+void
+datalayer :: write_count(const region_id& ri, int64_t delta,
+                         leveldb::WriteBatch* updates)
 {
-    leveldb::WriteBatch updates;
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
-    std::vector<char> scratch1;
-    std::vector<char> scratch2;
+    uint64_t id = e::atomic::increment_64_nobarrier(&m_count_id, 1);
+    char backing[COUNT_BUF_SIZE];
+    char* ptr = encode_count(ri, id, backing);
+    char vbacking[sizeof(uint64_t)];
+    e::pack64be(static_cast<uint64_t>(delta), vbacking);
+    updates->Put(leveldb::Slice(backing, ptr - backing),
+                 leveldb::Slice(vbacking, sizeof(uint64_t)));
+}
 
-    // create the encoded key
-    leveldb::Slice lkey;
-    encode_key(ri, sc.attrs[0].type, key, &scratch1, &lkey);
+uint64_t
+datalayer :: next_count_id()
+{
+    leveldb::ReadOptions opts;
+    opts.fill_cache = false;
+    opts.verify_checksums = true;
+    opts.snapshot = NULL;
+    uint64_t max_id = 0;
 
-    // create the encoded value
-    leveldb::Slice lval;
-    encode_value(new_value, version, &scratch2, &lval);
+    // count ids are shared by every instance
+    for (size_t s = 0; s < m_shards.size(); ++s)
+    {
+        std::auto_ptr<leveldb::Iterator> it(m_shards[s]->NewIterator(opts));
+        it->Seek(leveldb::Slice("n", 1));
 
-    // put the actual object
-    updates.Put(lkey, lval);
+        // hop from region to region, reading only the last key of each
+        while (it->Valid())
+        {
+            region_id ri;
+            uint64_t id;
 
-    // put the index entries
-    std::vector<const index*> indices;
-    find_indices(ri, &indices);
-    create_index_changes(sc, ri, indices, key, &old_value, &new_value, &updates);
+            if (!decode_count(it->key(), &ri, &id))
+            {
+                break;
+            }
 
-    // ensure we've recorded a version at least as high as this key
-    write_version(ri, version, &updates);
+            char backing[COUNT_BUF_SIZE];
+            char* ptr = encode_count(ri, UINT64_MAX, backing);
+            it->Seek(leveldb::Slice(backing, ptr - backing));
 
-    // Perform the write
-    leveldb::WriteOptions opts;
-    opts.sync = false;
-    leveldb::Status st = m_db->Write(opts, &updates);
+            if (it->Valid())
+            {
+                it->Prev();
+            }
+            else
+            {
+                it->SeekToLast();
+            }
 
-    if (st.ok())
-    {
-        update_memory_version(ri, version);
-        return SUCCESS;
-    }
-    else
-    {
-        return handle_error(st);
+            if (it->Valid() && decode_count(it->key(), &ri, &id))
+            {
+                max_id = std::max(max_id, id);
+            }
+
+            it->Seek(leveldb::Slice(backing, ptr - backing));
+        }
     }
+
+    return max_id;
 }
 
 datalayer::returncode
-datalayer :: uncertain_del(const region_id& ri,
-                           const e::slice& key)
+datalayer :: unchunk(const region_id& ri,
+                     const e::slice& key,
+                     const leveldb::Snapshot* snap,
+                     const std::vector<uint16_t>* attrs,
+                     std::string* backing)
 {
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
-    std::vector<char> scratch;
-
-    // create the encoded key
-    leveldb::Slice lkey;
-    encode_key(ri, sc.attrs[0].type, key, &scratch, &lkey);
+    std::vector<e::slice> value;
+    std::vector<uint64_t> chunked;
+    std::vector<value_log::pointer> logged;
+    std::vector<value_compressor::packed> compressed;
+    uint64_t version;
+    returncode rc = decode_value_stored(e::slice(backing->data(), backing->size()),
+                                        &value, &chunked, &logged, &compressed, &version);
+
+    if (rc != SUCCESS || (chunked.empty() && logged.empty() && compressed.empty()))
+    {
+        return rc;
+    }
 
-    // perform the read
-    std::string ref;
     leveldb::ReadOptions opts;
     opts.fill_cache = true;
     opts.verify_checksums = true;
-    leveldb::Status st = m_db->Get(opts, lkey, &ref);
+    opts.snapshot = snap;
+    std::vector<std::string> whole(value.size());
+    std::vector<char> scratch;
+    std::auto_ptr<leveldb::Iterator> it;
 
-    if (st.ok())
+    for (size_t i = 0; i < value.size(); ++i)
     {
-        std::vector<e::slice> old_value;
-        uint64_t old_version;
-        returncode rc = decode_value(e::slice(ref.data(), ref.size()),
-                                     &old_value, &old_version);
-
-        if (rc != SUCCESS)
+        // attributes not asked for stay empty, and compressed ones are not
+        // decompressed
+        if (attrs && !std::binary_search(attrs->begin(), attrs->end(), i + 1))
         {
-            return rc;
+            continue;
         }
 
-        if (old_value.size() + 1 != sc.attrs_sz)
+        if (i < compressed.size() && compressed[i].size > 0)
         {
-            return BAD_ENCODING;
+            if (!m_compressor.decompress(compressed[i].dictionary, compressed[i].bytes,
+                                         compressed[i].size, &scratch))
+            {
+                LOG(ERROR) << "could not decompress an attribute of an object of " << ri
+                           << " compressed with dictionary " << compressed[i].dictionary;
+                return CORRUPTION;
+            }
+
+            whole[i].assign(&scratch[0], scratch.size());
+            value[i] = e::slice(whole[i].data(), whole[i].size());
+            continue;
         }
 
-        return del(ri, key, old_value);
-    }
-    else if (st.IsNotFound())
-    {
-        return SUCCESS;
-    }
-    else
-    {
-        return handle_error(st);
-    }
-}
+        if (i < logged.size() && logged[i].size > 0)
+        {
+            if (!m_vlog.read(logged[i], &whole[i]))
+            {
+                LOG(ERROR) << "could not read value log segment " << logged[i].segment
+                           << " at " << logged[i].offset << " for an object of " << ri;
+                return CORRUPTION;
+            }
 
-datalayer::returncode
-datalayer :: uncertain_put(const region_id& ri,
-                           const e::slice& key,
-                           const std::vector<e::slice>& new_value,
-                           uint64_t version)
-{
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
-    std::vector<char> scratch;
+            value[i] = e::slice(whole[i].data(), whole[i].size());
+            continue;
+        }
 
-    // create the encoded key
-    leveldb::Slice lkey;
-    encode_key(ri, sc.attrs[0].type, key, &scratch, &lkey);
+        if (i >= chunked.size() || chunked[i] == 0)
+        {
+            continue;
+        }
 
-    // perform the read
-    std::string ref;
-    leveldb::ReadOptions opts;
-    opts.fill_cache = true;
-    opts.verify_checksums = true;
-    leveldb::Status st = m_db->Get(opts, lkey, &ref);
+        whole[i].reserve(chunked[i]);
+        const uint32_t chunks = (chunked[i] + CHUNK_SIZE - 1) / CHUNK_SIZE;
 
-    if (st.ok())
-    {
-        std::vector<e::slice> old_value;
-        uint64_t old_version;
-        returncode rc = decode_value(e::slice(ref.data(), ref.size()),
-                                     &old_value, &old_version);
+        if (!it.get())
+        {
+            it.reset(db_for(ri)->NewIterator(opts));
+        }
 
-        if (rc != SUCCESS)
+        for (uint32_t c = 0; c < chunks; ++c)
         {
-            return rc;
+            // the newest piece no later than this version of the object
+            leveldb::Slice lkey;
+            encode_chunk_key(ri, key, i + 1, c, version, &scratch, &lkey);
+            const leveldb::Slice piece(lkey.data(), lkey.size() - CHUNK_KEY_VERSION_SIZE);
+            it->Seek(lkey);
+
+            if (!it->status().ok())
+            {
+                return handle_error(it->status());
+            }
+
+            // a write since has replaced the pieces of this version
+            if (!it->Valid() || !it->key().starts_with(piece))
+            {
+                return NOT_FOUND;
+            }
+
+            whole[i].append(it->value().data(), it->value().size());
         }
 
-        if (old_value.size() + 1 != sc.attrs_sz)
+        if (whole[i].size() != chunked[i])
         {
-            return BAD_ENCODING;
+            return CORRUPTION;
         }
 
-        return overput(ri, key, old_value, new_value, version);
-    }
-    else if (st.IsNotFound())
-    {
-        return put(ri, key, new_value, version);
-    }
-    else
-    {
-        return handle_error(st);
+        value[i] = e::slice(whole[i].data(), whole[i].size());
     }
-}
 
-datalayer::snapshot
-datalayer :: make_snapshot()
-{
-    return leveldb_snapshot_ptr(m_db, m_db->GetSnapshot());
+    std::vector<char> encoded;
+    leveldb::Slice lval;
+    encode_value(value, version, &encoded, &lval);
+    backing->assign(lval.data(), lval.size());
+    return SUCCESS;
 }
-
-datalayer::iterator*
-datalayer :: make_search_iterator(snapshot snap,
-                                  const region_id& ri,
-                                  const std::vector<attribute_check>& checks,
-                                  std::ostringstream* ostr)
+
+datalayer::returncode
+datalayer :: encode_object(const region_id& ri,
+                           const schema& sc,
+                           const std::vector<e::slice>& value,
+                           uint64_t version,
+                           value_log::appends* logged,
+                           std::vector<char>* backing,
+                           leveldb::Slice* out)
 {
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
-    std::vector<e::intrusive_ptr<index_iterator> > iterators;
+    std::vector<value_log::pointer> ptrs;
 
-    // pull a set of range queries from checks
-    std::vector<range> ranges;
-    range_searches(sc, checks, &ranges);
-    const index_encoding* key_ie = index_encoding::lookup(sc.attrs[0].type);
-    const index_info* key_ii = index_info::lookup(sc.attrs[0].type);
+    // the value log is on disk, which in-memory spaces never touch
+    const uint64_t vlog_threshold = sc.durability != DURABILITY_MEMORY ? m_vlog_threshold : 0;
 
-    // for each range query, construct an iterator
-    for (size_t i = 0; i < ranges.size(); ++i)
+    for (size_t i = 0; vlog_threshold > 0 && i < value.size(); ++i)
     {
-        if (ranges[i].invalid)
+        // larger attributes go in chunks, which appends rewrite piecemeal
+        if (value[i].size() < vlog_threshold ||
+            value[i].size() >= CHUNK_THRESHOLD)
         {
-            if (ostr) *ostr << "encountered invalid range; returning no results\n";
-            return new dummy_iterator();
+            continue;
         }
 
-        assert(ranges[i].attr < sc.attrs_sz);
-        assert(ranges[i].type == sc.attrs[ranges[i].attr].type);
-        std::vector<const index*> indices;
-        find_indices(ri, ranges[i].attr, &indices);
+        ptrs.resize(value.size());
 
-        for (size_t j = 0; j < indices.size(); ++j)
+        if (!m_vlog.append(value[i], &ptrs[i], logged))
         {
-            assert(indices[j]->attr == ranges[i].attr);
-            const index* idx = indices[j];
-            const index_info* ii = index_info::lookup(ranges[i].type);
-
-            if (!ii)
-            {
-                continue;
-            }
-
-            e::intrusive_ptr<index_iterator> it = ii->iterator_from_range(snap, ri, idx->id, ranges[i], key_ie);
-
-            if (it)
-            {
-                iterators.push_back(it);
-
-                if (ostr) *ostr << " considering attr " << ranges[i].attr << " Range("
-                                << ranges[i].start.hex() << ", " << ranges[i].end.hex() << ") " << ranges[i].type << " "
-                                << (ranges[i].has_start ? "[" : "<") << "-" << (ranges[i].has_end ? "]" : ">")
-                                << " " << (ranges[i].invalid ? "invalid" : "valid") << "\n";
-            }
+            return IO_ERROR;
         }
     }
 
-    // For each index
-    for (size_t i = 0; i < checks.size(); ++i)
+    std::vector<value_compressor::packed> packed;
+    std::vector<std::vector<char> > packed_bytes;
+
+    if (sc.compressed)
     {
-        std::vector<const index*> indices;
-        find_indices(ri, checks[i].attr, &indices);
+        const space_id sid = m_daemon->config().space_of(ri);
+        sample_for_dictionary(sid, value);
+        packed_bytes.resize(value.size());
 
-        for (size_t j = 0; j < indices.size(); ++j)
+        for (size_t i = 0; i < value.size(); ++i)
         {
-            const index* idx = indices[j];
-            const index_info* ii = index_info::lookup(sc.attrs[checks[i].attr].type);
+            uint32_t dictionary = 0;
 
-            if (!ii)
+            if ((!ptrs.empty() && ptrs[i].size > 0) ||
+                value[i].size() >= CHUNK_THRESHOLD ||
+                !m_compressor.compress(sid, value[i], &dictionary, &packed_bytes[i]))
             {
                 continue;
             }
 
-            e::intrusive_ptr<index_iterator> it = ii->iterator_from_check(snap, ri, idx->id, checks[i], key_ie);
-
-            if (it)
-            {
-                iterators.push_back(it);
-            }
+            packed.resize(value.size());
+            packed[i].dictionary = dictionary;
+            packed[i].size = value[i].size();
+            packed[i].bytes = e::slice(&packed_bytes[i][0], packed_bytes[i].size());
         }
     }
 
-    // figure out the cost of accessing all objects
-    e::intrusive_ptr<index_iterator> full_scan;
-    full_scan = key_ii->iterator_for_keys(snap, ri);
-    if (ostr) *ostr << " accessing all objects has cost " << full_scan->cost(m_db.get()) << "\n";
+    encode_value_stored(value, version, CHUNK_THRESHOLD,
+                        ptrs.empty() ? NULL : &ptrs,
+                        packed.empty() ? NULL : &packed,
+                        backing, out);
+    return SUCCESS;
+}
 
-    // figure out the cost of each iterator
-    // we do this here and not below so that iterators can cache the size and we
-    // don't ping-pong between HyperDex and LevelDB.
-    for (size_t i = 0; i < iterators.size(); ++i)
+datalayer::returncode
+datalayer :: sync_logged(const value_log::appends& logged, durability_level d)
+{
+    // an async write leaves both LevelDB's log and the value log to the OS
+    if (logged.empty() || d == DURABILITY_ASYNC)
     {
-        uint64_t iterator_cost = iterators[i]->cost(m_db.get());
-        if (ostr) *ostr << " iterator " << *iterators[i] << " has cost " << iterator_cost << "\n";
+        return SUCCESS;
     }
 
-    std::vector<e::intrusive_ptr<index_iterator> > sorted;
-    std::vector<e::intrusive_ptr<index_iterator> > unsorted;
+    return m_vlog.sync() ? SUCCESS : IO_ERROR;
+}
 
-    for (size_t i = 0; i < iterators.size(); ++i)
+bool
+datalayer :: load_dictionaries()
+{
+    leveldb::ReadOptions opts;
+    opts.fill_cache = false;
+    opts.verify_checksums = true;
+    std::auto_ptr<leveldb::Iterator> it(m_db->NewIterator(opts));
+    uint64_t loaded = 0;
+
+    for (it->Seek(leveldb::Slice("d", 1)); it->Valid(); it->Next())
     {
-        if (iterators[i]->sorted())
+        uint32_t id;
+
+        if (!decode_dictionary(it->key(), &id))
         {
-            sorted.push_back(iterators[i]);
+            break;
         }
-        else
+
+        if (it->value().size() < sizeof(uint64_t))
         {
-            unsorted.push_back(iterators[i]);
+            LOG(ERROR) << "compression dictionary " << id << " is corrupt";
+            return false;
         }
-    }
 
-    e::intrusive_ptr<index_iterator> best;
+        uint64_t sid;
+        e::unpack64be(it->value().data(), &sid);
+        m_compressor.load(id, space_id(sid),
+                          e::slice(it->value().data() + sizeof(uint64_t),
+                                   it->value().size() - sizeof(uint64_t)));
+        ++loaded;
+    }
 
-    if (!best && !sorted.empty())
+    if (!it->status().ok())
     {
-        best = new intersect_iterator(snap, sorted);
+        LOG(ERROR) << "could not load compression dictionaries: " << it->status().ToString();
+        return false;
     }
-    else if (!best && !unsorted.empty())
+
+    if (loaded > 0)
     {
-        best = unsorted[0];
+        LOG(INFO) << "loaded " << loaded << " compression dictionaries";
     }
-    else
+
+    return true;
+}
+
+void
+datalayer :: sample_for_dictionary(const space_id& sid, const std::vector<e::slice>& value)
+{
+    uint32_t id;
+    std::string dict;
+
+    if (!m_compressor.sample(sid, value, &id, &dict))
     {
-        best = full_scan;
+        return;
     }
 
-    assert(best);
-    uint64_t cost = best->cost(m_db.get());
+    // it must be on disk before any attribute compressed with it
+    char key[DICTIONARY_BUF_SIZE];
+    encode_dictionary(id, key);
+    std::string val(sizeof(uint64_t), '\0');
+    e::pack64be(sid.get(), &val[0]);
+    val += dict;
+    leveldb::WriteOptions wopts;
+    wopts.sync = true;
+    leveldb::Status st = m_db->Put(wopts, leveldb::Slice(key, DICTIONARY_BUF_SIZE), val);
 
-    if (cost > 0 && cost * 4 > full_scan->cost(m_db.get()))
+    if (!st.ok())
     {
-        best = full_scan;
+        LOG(ERROR) << "could not save compression dictionary " << id
+                   << " for space " << sid << ": " << st.ToString();
+        return;
     }
 
-    if (ostr) *ostr << " choosing to use " << *best << "\n";
-    return new search_iterator(this, ri, best, ostr, &checks);
+    LOG(INFO) << "trained compression dictionary " << id << " of "
+              << dict.size() << " bytes for space " << sid;
+    m_compressor.load(id, sid, e::slice(dict));
 }
 
-bool
-datalayer :: backup(const e::slice& _name)
+void
+datalayer :: write_chunks(const region_id& ri,
+                          const e::slice& key,
+                          const std::vector<e::slice>* old_value,
+                          const std::vector<e::slice>* new_value,
+                          uint64_t version,
+                          leveldb::WriteBatch* updates)
 {
-    leveldb::Slice name(reinterpret_cast<const char*>(_name.data()), _name.size());
-    leveldb::Status st = m_db->LiveBackup(name);
+    const size_t old_sz = old_value ? old_value->size() : 0;
+    const size_t new_sz = new_value ? new_value->size() : 0;
+    std::vector<char> scratch;
+    std::vector<uint64_t> stored;
+    uint64_t old_version = 0;
+    leveldb::ReadOptions opts;
+    opts.verify_checksums = true;
 
-    if (st.ok())
-    {
-        return true;
-    }
-    else if (st.IsCorruption())
+    // objects written before chunking keep even large attributes inline, so
+    // ask the object on disk which of old_value's attributes are chunked
+    for (size_t i = 0; i < old_sz; ++i)
     {
-        LOG(ERROR) << "corruption while taking a backup: " << st.ToString();
-        return false;
+        if ((*old_value)[i].size() < CHUNK_THRESHOLD)
+        {
+            continue;
+        }
+
+        const schema& sc(*m_daemon->config().get_schema(ri));
+        leveldb::Slice lkey;
+        encode_key(ri, sc.attrs[0].type, key, &scratch, &lkey);
+        std::string raw;
+        std::vector<e::slice> tmp;
+
+        if (db_for(ri)->Get(opts, lkey, &raw).ok())
+        {
+            decode_value_chunked(e::slice(raw.data(), raw.size()), &tmp, &stored, &old_version);
+        }
+
+        break;
     }
-    else if (st.IsIOError())
+
+    // an unchanged piece is left where it is only if the new version will
+    // find it; a write that does not move the version forward rewrites all
+    const bool keep_unchanged = !stored.empty() && old_version < version;
+    std::auto_ptr<leveldb::Iterator> it;
+
+    for (size_t i = 0; i < std::max(old_sz, new_sz); ++i)
     {
-        LOG(ERROR) << "IO error while taking a backup: " << st.ToString();
-        return false;
+        e::slice o = i < old_sz ? (*old_value)[i] : e::slice();
+        e::slice n = i < new_sz ? (*new_value)[i] : e::slice();
+        const uint32_t old_chunks = i < stored.size() && stored[i] > 0
+                                  ? (stored[i] + CHUNK_SIZE - 1) / CHUNK_SIZE : 0;
+        const uint32_t new_chunks = n.size() >= CHUNK_THRESHOLD
+                                  ? (n.size() + CHUNK_SIZE - 1) / CHUNK_SIZE : 0;
+
+        for (uint32_t c = 0; c < std::max(old_chunks, new_chunks); ++c)
+        {
+            if (c < new_chunks)
+            {
+                const size_t off = c * CHUNK_SIZE;
+                const size_t len = n.size() - off < CHUNK_SIZE
+                                 ? n.size() - off : CHUNK_SIZE;
+                const size_t old_len = c >= old_chunks || off >= o.size() ? 0
+                                     : o.size() - off < CHUNK_SIZE
+                                     ? o.size() - off : CHUNK_SIZE;
+
+                // an append leaves every full piece but the last as it was
+                if (keep_unchanged && len == old_len &&
+                    memcmp(o.data() + off, n.data() + off, len) == 0)
+                {
+                    continue;
+                }
+            }
+
+            // drop every version of the piece; replays of the versions that
+            // read them fail to unchunk, and skip to the write replacing them
+            if (c < old_chunks)
+            {
+                if (!it.get())
+                {
+                    it.reset(db_for(ri)->NewIterator(opts));
+                }
+
+                leveldb::Slice lkey;
+                encode_chunk_key(ri, key, i + 1, c, UINT64_MAX, &scratch, &lkey);
+                const std::string piece(lkey.data(), lkey.size() - CHUNK_KEY_VERSION_SIZE);
+
+                for (it->Seek(lkey); it->Valid() && it->key().starts_with(piece); it->Next())
+                {
+                    updates->Delete(it->key());
+                }
+            }
+
+            if (c < new_chunks)
+            {
+                const size_t off = c * CHUNK_SIZE;
+                const size_t len = n.size() - off < CHUNK_SIZE
+                                 ? n.size() - off : CHUNK_SIZE;
+                leveldb::Slice lkey;
+                encode_chunk_key(ri, key, i + 1, c, version, &scratch, &lkey);
+                updates->Put(lkey, leveldb::Slice(reinterpret_cast<const char*>(n.data()) + off, len));
+            }
+        }
     }
-    else
+}
+
+void
+datalayer :: forget(const region_id& ri, const e::slice& key)
+{
+    if (m_warm.enabled())
     {
-        LOG(ERROR) << "LevelDB returned an unknown error that we don't know how to handle: " << st.ToString();
-        return false;
+        m_warm.invalidate(ri, key);
     }
 }
 
-datalayer::returncode
-datalayer :: get_from_iterator(const region_id& ri,
-                               const schema& sc,
-                               iterator* iter,
-                               e::slice* key,
-                               std::vector<e::slice>* value,
-                               uint64_t* version,
-                               reference* ref)
+void
+datalayer :: update_memory_version(const region_id& ri, uint64_t version)
 {
-    std::vector<char> scratch;
-
-    // create the encoded key
-    leveldb::Slice lkey;
-    encode_key(ri, sc.attrs[0].type, iter->key(), &scratch, &lkey);
-
-    // perform the read
-    leveldb::ReadOptions opts;
-    opts.fill_cache = true;
-    opts.verify_checksums = true;
-    opts.snapshot = iter->snap().get();
-    leveldb::Status st = m_db->Get(opts, lkey, &ref->m_backing);
+    version = roundup_version(version);
+    uint64_t* current = NULL;
+    m_versions.mod(ri, &current);
 
-    if (st.ok())
-    {
-        ref->m_backing += std::string(reinterpret_cast<const char*>(iter->key().data()), iter->key().size());
-        *key = e::slice(ref->m_backing.data()
-                        + ref->m_backing.size()
-                        - iter->key().size(),
-                        iter->key().size());
-        e::slice v(ref->m_backing.data(), ref->m_backing.size() - iter->key().size());
-        return decode_value(v, value, version);
-    }
-    else if (st.IsNotFound())
+    if (current == NULL)
     {
-        return NOT_FOUND;
+        return;
     }
-    else
+
+    uint64_t expected = e::atomic::load_64_nobarrier(current);
+    uint64_t witness  = 0;
+
+    while ((witness = e::atomic::compare_and_swap_64_nobarrier(current, expected, version)) < version)
     {
-        return handle_error(st);
+        expected = witness;
     }
 }
 
-namespace
+void
+datalayer :: bump_version(const region_id& ri, uint64_t version)
 {
+    leveldb::WriteBatch updates;
 
-uint64_t
-roundup_version(uint64_t v)
-{
-    const static uint64_t REGION_PERIODIC = hyperdex::datalayer::REGION_PERIODIC;
-    v += REGION_PERIODIC;
-    v  = v & ~(REGION_PERIODIC - 1);
-    return v;
-}
+    if (!write_version(ri, version, &updates))
+    {
+        return;
+    }
+
+    // Perform the write
+    leveldb::WriteOptions opts;
+    opts.sync = false;
+    leveldb::Status st = db_for(ri)->Write(opts, &updates);
+
+    if (!st.ok())
+    {
+        handle_error(st);
+    }
 
+    update_memory_version(ri, version);
 }
 
-bool
-datalayer :: write_version(const region_id& ri,
-                           uint64_t version,
-                           leveldb::WriteBatch* updates)
+uint64_t
+datalayer :: max_version(const region_id& ri)
 {
-    version = roundup_version(version);
-    uint64_t* current = NULL;
+    uint64_t val;
 
-    if (!m_versions.mod(ri, &current) ||
-        e::atomic::load_64_nobarrier(current) >= version)
+    if (!m_versions.get(ri, &val))
     {
-        return false;
+        val = disk_version(ri);
     }
 
-    char vbacking[VERSION_BUF_SIZE];
-    encode_version(ri, version, vbacking);
-    updates->Put(leveldb::Slice(vbacking, VERSION_BUF_SIZE), leveldb::Slice());
-    return true;
+    return val;
 }
 
-void
-datalayer :: update_memory_version(const region_id& ri, uint64_t version)
+datalayer::returncode
+datalayer :: object_count(const region_id& ri, uint64_t* count)
 {
-    version = roundup_version(version);
-    uint64_t* current = NULL;
-    m_versions.mod(ri, &current);
+    po6::threads::mutex::hold hold(&m_count_mtx);
+    leveldb_snapshot_ptr snap(make_snapshot(ri));
+    leveldb::ReadOptions opts;
+    opts.fill_cache = true;
+    opts.verify_checksums = true;
+    opts.snapshot = snap.get();
+    std::auto_ptr<leveldb::Iterator> it(snap.db()->NewIterator(opts));
+    char backing[COUNT_BUF_SIZE];
+    char* ptr = encode_count(ri, 0, backing);
+    leveldb::Slice prefix(backing, ptr - backing - sizeof(uint64_t));
+    leveldb::WriteBatch updates;
+    bool has_base = false;
+    uint64_t base = 0;
+    int64_t delta = 0;
 
-    if (current == NULL)
+    for (it->Seek(leveldb::Slice(backing, ptr - backing));
+            it->Valid() && it->key().starts_with(prefix); it->Next())
     {
-        return;
+        region_id tmp_ri;
+        uint64_t id;
+        uint64_t val;
+
+        if (!decode_count(it->key(), &tmp_ri, &id) ||
+            it->value().size() != sizeof(uint64_t))
+        {
+            return BAD_ENCODING;
+        }
+
+        e::unpack64be(it->value().data(), &val);
+
+        if (id == 0)
+        {
+            has_base = true;
+            base = val;
+        }
+        else
+        {
+            delta += static_cast<int64_t>(val);
+            updates.Delete(it->key());
+        }
     }
 
-    uint64_t expected = e::atomic::load_64_nobarrier(current);
-    uint64_t witness  = 0;
-
-    while ((witness = e::atomic::compare_and_swap_64_nobarrier(current, expected, version)) < version)
+    if (!it->status().ok())
     {
-        expected = witness;
+        return handle_error(it->status());
     }
-}
 
-void
-datalayer :: bump_version(const region_id& ri, uint64_t version)
-{
-    leveldb::WriteBatch updates;
-
-    if (!write_version(ri, version, &updates))
+    // without a base, count the objects in the snapshot, which already
+    // reflect every delta it holds
+    if (!has_base)
     {
-        return;
-    }
+        std::vector<char> scratch;
+        leveldb::Slice oprefix;
+        encode_object_region(ri, &scratch, &oprefix);
+        base = 0;
+        delta = 0;
 
-    // Perform the write
-    leveldb::WriteOptions opts;
-    opts.sync = false;
-    leveldb::Status st = m_db->Write(opts, &updates);
+        for (it->Seek(oprefix); it->Valid() && it->key().starts_with(oprefix); it->Next())
+        {
+            ++base;
+        }
 
-    if (!st.ok())
-    {
-        handle_error(st);
+        if (!it->status().ok())
+        {
+            return handle_error(it->status());
+        }
     }
 
-    update_memory_version(ri, version);
-}
-
-uint64_t
-datalayer :: max_version(const region_id& ri)
-{
-    uint64_t val;
+    *count = delta < 0 && uint64_t(-delta) > base ? 0 : base + delta;
+    char vbacking[sizeof(uint64_t)];
+    e::pack64be(*count, vbacking);
+    updates.Put(leveldb::Slice(backing, ptr - backing),
+                leveldb::Slice(vbacking, sizeof(uint64_t)));
+    leveldb::WriteOptions wopts;
+    wopts.sync = false;
+    leveldb::Status st = snap.db()->Write(wopts, &updates);
 
-    if (!m_versions.get(ri, &val))
+    if (!st.ok())
     {
-        val = disk_version(ri);
+        return handle_error(st);
     }
 
-    return val;
+    return SUCCESS;
 }
 
 uint64_t
@@ -989,7 +3565,13 @@ datalayer :: disk_version(const region_id& ri)
     opts.fill_cache = false;
     opts.verify_checksums = true;
     opts.snapshot = NULL;
-    std::auto_ptr<leveldb::Iterator> it(m_db->NewIterator(opts));
+    std::auto_ptr<leveldb::Iterator> it(db_for(ri)->NewIterator(opts));
+    return disk_version(it.get(), ri);
+}
+
+uint64_t
+datalayer :: disk_version(leveldb::Iterator* it, const region_id& ri)
+{
     char vbacking[VERSION_BUF_SIZE];
     encode_version(ri, UINT64_MAX, vbacking);
     leveldb::Slice key(vbacking, VERSION_BUF_SIZE);
@@ -1021,6 +3603,155 @@ datalayer :: disk_version(const region_id& ri)
     return tmp_version;
 }
 
+bool
+datalayer :: divide_region(const configuration& config, const region_id& ri,
+                           region_iterator* it, uint64_t* moved, uint64_t* dropped)
+{
+    const schema* sc = config.get_schema(ri);
+    const subspace_id ssid = config.subspace_of(ri);
+    const subspace* ss = config.get_subspace(ri);
+
+    if (!sc || !ss)
+    {
+        return false;
+    }
+
+    std::vector<region_id> mapped;
+    config.mapped_regions(m_daemon->m_us, &mapped);
+    std::vector<const index*> indices;
+    find_indices(ri, &indices);
+    std::vector<uint64_t> hashes(sc->attrs_sz);
+    std::vector<e::slice> value;
+    std::vector<uint64_t> chunked;
+    std::vector<value_log::pointer> logged;
+    std::vector<value_compressor::packed> compressed;
+    uint64_t version;
+    std::vector<char> scratch1;
+    std::vector<char> scratch2;
+    std::map<region_id, int64_t> deltas;
+    std::map<region_id, uint64_t> versions;
+    std::vector<std::pair<region_id, std::string> > gone;
+    leveldb::WriteBatch updates;
+    uint64_t batch_bytes = 0;
+    bool more = it->valid();
+
+    while (more && batch_bytes < DIVIDE_BATCH_BYTES)
+    {
+        e::slice key = it->key();
+        std::string raw(reinterpret_cast<const char*>(it->value().data()), it->value().size());
+
+        // a moved object keeps its attributes' places in the value log and
+        // their compressed forms, which point into the iterator's value
+        if (decode_value_stored(it->value(), &value, &chunked, &logged,
+                                &compressed, &version) != SUCCESS ||
+            unchunk(ri, key, NULL, NULL, &raw) != SUCCESS ||
+            decode_value(e::slice(raw.data(), raw.size()), &value, &version) != SUCCESS ||
+            value.size() + 1 != sc->attrs_sz)
+        {
+            LOG(ERROR) << "skipping badly encoded object while splitting " << ri;
+            it->next();
+            more = it->valid();
+            continue;
+        }
+
+        // only the attributes this subspace places objects by matter here
+        hyperdex::hash(*sc, *ss, key, value, &hashes.front());
+        region_id target;
+        config.lookup_region(ssid, hashes, &target);
+
+        if (target != ri)
+        {
+            leveldb::Slice lkey;
+            encode_key(ri, sc->attrs[0].type, key, &scratch1, &lkey);
+            updates.Delete(lkey);
+            write_chunks(ri, key, &value, NULL, 0, &updates);
+            create_index_changes(*sc, ri, indices, key, &value, NULL, &updates);
+            --deltas[ri];
+            batch_bytes += lkey.size();
+            gone.push_back(std::make_pair(target, std::string(
+                            reinterpret_cast<const char*>(key.data()), key.size())));
+
+            if (std::binary_search(mapped.begin(), mapped.end(), target))
+            {
+                std::vector<const index*> target_indices;
+                find_indices(target, &target_indices);
+                leveldb::Slice lval;
+                encode_key(target, sc->attrs[0].type, key, &scratch1, &lkey);
+                encode_value_stored(value, version, CHUNK_THRESHOLD,
+                                    logged.empty() ? NULL : &logged,
+                                    compressed.empty() ? NULL : &compressed,
+                                    &scratch2, &lval);
+                updates.Put(lkey, lval);
+                write_chunks(target, key, NULL, &value, version, &updates);
+                create_index_changes(*sc, target, target_indices, key, NULL, &value, &updates);
+                add_to_filters(target, *sc, target_indices, NULL, value);
+                ++deltas[target];
+                versions[target] = std::max(versions[target], version);
+                batch_bytes += lkey.size() + lval.size();
+                ++*moved;
+            }
+            else
+            {
+                ++*dropped;
+            }
+        }
+
+        it->next();
+        more = it->valid();
+    }
+
+    for (std::map<region_id, int64_t>::iterator d = deltas.begin();
+            d != deltas.end(); ++d)
+    {
+        write_count(d->first, d->second, &updates);
+    }
+
+    for (std::map<region_id, uint64_t>::iterator v = versions.begin();
+            v != versions.end(); ++v)
+    {
+        write_version(v->first, v->second, &updates);
+    }
+
+    // the new regions live on the instance of ri, so that one batch moves
+    // objects between them
+    leveldb::Status st = commit_for(ri)->write(&updates, sc->durability);
+
+    if (!st.ok())
+    {
+        handle_error(st);
+        LOG(ERROR) << "could not finish splitting " << ri;
+        return false;
+    }
+
+    for (std::map<region_id, uint64_t>::iterator v = versions.begin();
+            v != versions.end(); ++v)
+    {
+        update_memory_version(v->first, v->second);
+    }
+
+    // reads of ri must no longer find what moved, nor reads of a target
+    // find what it held under the key before; invalidating also fails any
+    // read that saw the old objects and has yet to cache them
+    for (size_t i = 0; i < gone.size(); ++i)
+    {
+        e::slice key(gone[i].second.data(), gone[i].second.size());
+
+        if (m_cache.enabled())
+        {
+            m_cache.invalidate(ri, key);
+            m_cache.invalidate(gone[i].first, key);
+        }
+
+        if (m_warm.enabled())
+        {
+            m_warm.invalidate(ri, key);
+            m_warm.invalidate(gone[i].first, key);
+        }
+    }
+
+    return more;
+}
+
 datalayer::returncode
 datalayer :: create_checkpoint(const region_timestamp& rt)
 {
@@ -1039,13 +3770,14 @@ datalayer :: create_checkpoint(const region_timestamp& rt)
     opts.sync = false;
     leveldb::Slice ckey(cbacking, CHECKPOINT_BUF_SIZE);
     leveldb::Slice val(rt.local_timestamp);
-    leveldb::Status st = m_db->Put(opts, ckey, val);
+    leveldb::Status st = db_for(rt.rid)->Put(opts, ckey, val);
 
     if (!st.ok())
     {
         return handle_error(st);
     }
 
+    m_checkpointer->record(rt);
     return SUCCESS;
 }
 
@@ -1068,34 +3800,7 @@ datalayer :: largest_checkpoint_for(const region_id& ri, uint64_t* checkpoint)
         return;
     }
 
-    leveldb::ReadOptions opts;
-    opts.verify_checksums = true;
-    std::auto_ptr<leveldb::Iterator> it;
-    it.reset(m_db->NewIterator(opts));
-    char cbacking[CHECKPOINT_BUF_SIZE];
-    encode_checkpoint(ri, 0, cbacking);
-    it->Seek(leveldb::Slice(cbacking, CHECKPOINT_BUF_SIZE));
-    *checkpoint = 0;
-
-    while (it->Valid())
-    {
-        region_timestamp rt;
-        e::slice key(it->key().data(), it->key().size());
-        returncode rc = decode_checkpoint(key, &rt.rid, &rt.checkpoint);
-
-        if (rc != datalayer::SUCCESS)
-        {
-            break;
-        }
-
-        if (rt.rid != ri)
-        {
-            break;
-        }
-
-        *checkpoint = std::max(*checkpoint, rt.checkpoint);
-        it->Next();
-    }
+    *checkpoint = m_checkpointer->largest_checkpoint(ri);
 }
 
 bool
@@ -1104,6 +3809,12 @@ datalayer :: region_will_be_wiped(region_id rid)
     return m_wiper->region_will_be_wiped(rid);
 }
 
+bool
+datalayer :: region_is_filling(const region_id& ri)
+{
+    return m_divider->is_filling(ri);
+}
+
 void
 datalayer :: request_wipe(const transfer_id& xid,
                           const region_id& ri)
@@ -1135,39 +3846,12 @@ datalayer :: replay_region_from_checkpoint(const region_id& ri,
     e::guard g2 = e::makeobjguard(*m_checkpointer, &checkpointer_thread::permit_gc);
     g2.use_variable();
 
-    leveldb::ReadOptions opts;
-    opts.verify_checksums = true;
-    std::auto_ptr<leveldb::Iterator> it;
-    it.reset(m_db->NewIterator(opts));
-    char cbacking[CHECKPOINT_BUF_SIZE];
-    encode_checkpoint(ri, 0, cbacking);
-    it->Seek(leveldb::Slice(cbacking, CHECKPOINT_BUF_SIZE));
-    std::string local_timestamp("all");
-
-    while (it->Valid())
-    {
-        region_timestamp rt;
-        e::slice key(it->key().data(), it->key().size());
-        returncode rc = decode_checkpoint(key, &rt.rid, &rt.checkpoint);
-
-        if (rc != datalayer::SUCCESS)
-        {
-            break;
-        }
-
-        if (rt.rid != ri || rt.checkpoint > checkpoint)
-        {
-            break;
-        }
-
-        local_timestamp.assign(it->value().data(), it->value().size());
-        it->Next();
-    }
-
+    std::string local_timestamp(m_checkpointer->replay_timestamp(ri, checkpoint));
     assert(!m_wiper->region_will_be_wiped(ri));
     *wipe = local_timestamp == "all";
+    const leveldb_db_ptr& db(db_for(ri));
     leveldb::ReplayIterator* iter;
-    leveldb::Status st = m_db->GetReplayIterator(local_timestamp, &iter);
+    leveldb::Status st = db->GetReplayIterator(local_timestamp, &iter);
 
     if (!st.ok())
     {
@@ -1175,9 +3859,9 @@ datalayer :: replay_region_from_checkpoint(const region_id& ri,
         abort();
     }
 
-    leveldb_replay_iterator_ptr ptr(m_db, iter);
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
-    return new replay_iterator(ri, ptr, index_encoding::lookup(sc.attrs[0].type));
+    leveldb_replay_iterator_ptr ptr(db, iter);
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    return new replay_iterator(this, ri, ptr, index_encoding::lookup(sc.attrs[0].type));
 }
 
 void
@@ -1189,8 +3873,8 @@ datalayer :: create_index_marker(const region_id& ri, const index_id& ii)
     ptr = e::packvarint64(ri.get(), ptr);
     ptr = e::packvarint64(ii.get(), ptr);
     leveldb::Slice key(buf, ptr - buf);
-    leveldb::Slice val;
-    leveldb::Status st = m_db->Put(leveldb::WriteOptions(), key, val);
+    leveldb::Slice val(INDEX_FORMAT_COMPACT, INDEX_FORMAT_COMPACT_SIZE);
+    leveldb::Status st = db_for(ri)->Put(leveldb::WriteOptions(), key, val);
 
     if (!st.ok())
     {
@@ -1209,7 +3893,7 @@ datalayer :: has_index_marker(const region_id& ri, const index_id& ii)
     ptr = e::packvarint64(ii.get(), ptr);
     leveldb::Slice key(buf, ptr - buf);
     std::string val;
-    leveldb::Status st = m_db->Get(leveldb::ReadOptions(), key, &val);
+    leveldb::Status st = db_for(ri)->Get(leveldb::ReadOptions(), key, &val);
 
     if (!st.ok() && !st.IsNotFound())
     {
@@ -1245,6 +3929,32 @@ datalayer :: only_key_is_hyperdex_key()
     return seen;
 }
 
+bool
+datalayer :: upgrade_16_to_17()
+{
+    // Entries of indices built before 1.7 end with their key's size as a
+    // 32-bit integer.  Their markers stay empty, so reconfigure leaves such
+    // indices unusable and the indexer wipes and rebuilds them shortly after
+    // startup, while the daemon serves requests; no entry is rewritten here.
+    // Marking the new format first keeps older versions from misreading the
+    // entries written from now on.
+    leveldb::WriteOptions wopts;
+    wopts.sync = true;
+    leveldb::Slice k("hyperdex", 8);
+    leveldb::Slice v(FORMAT_1_7, STRLENOF(FORMAT_1_7));
+    leveldb::Status st = m_db->Put(wopts, k, v);
+
+    if (!st.ok())
+    {
+        LOG(ERROR) << "could not upgrade to 1.7: " << st.ToString();
+        return false;
+    }
+
+    LOG(INFO) << "upgraded the data to the 1.7 format; indices with entries that "
+              << "end in a key of variable size will be rebuilt in the background";
+    return true;
+}
+
 bool
 datalayer :: upgrade_13x_to_14()
 {
@@ -1362,7 +4072,7 @@ datalayer :: find_indices(const region_id& rid, std::vector<const index*>* indic
             continue;
         }
 
-        const index* idx = m_daemon->m_config.get_index(it->ii);
+        const index* idx = m_daemon->config().get_index(it->ii);
         assert(idx);
         indices->push_back(idx);
     }
@@ -1382,7 +4092,7 @@ datalayer :: find_indices(const region_id& rid, uint16_t attr,
             continue;
         }
 
-        const index* idx = m_daemon->m_config.get_index(it->ii);
+        const index* idx = m_daemon->config().get_index(it->ii);
         assert(idx);
 
         if (idx->attr == attr)
@@ -1392,6 +4102,184 @@ datalayer :: find_indices(const region_id& rid, uint16_t attr,
     }
 }
 
+// the fewest values an index filter is sized for, so that those of small
+// regions do not saturate at their first writes
+#define INDEX_FILTER_MIN_VALUES 4096
+
+namespace
+{
+
+// the types a normal index keeps one entry for each value of
+bool
+filterable(const hyperdex::schema& sc, const hyperdex::index& idx)
+{
+    if (idx.type != hyperdex::index::NORMAL || idx.partial())
+    {
+        return false;
+    }
+
+    hyperdatatype t = sc.attrs[idx.attr].type;
+    return t == HYPERDATATYPE_STRING ||
+           t == HYPERDATATYPE_INT64 ||
+           t == HYPERDATATYPE_FLOAT;
+}
+
+void
+encode_for_filter(const hyperdex::index_encoding* ie,
+                  const e::slice& value,
+                  std::vector<char>* scratch,
+                  e::slice* encoded)
+{
+    const size_t sz = ie->encoded_size(value);
+    scratch->resize(sz + 1);
+    ie->encode(value, &(*scratch)[0]);
+    *encoded = e::slice(&(*scratch)[0], sz);
+}
+
+} // namespace
+
+void
+datalayer :: create_index_filters(const configuration& config)
+{
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+    std::vector<snapshot> snaps(m_shards.size());
+
+    for (size_t i = 0; i < m_indices.size(); ++i)
+    {
+        index_state* is = &m_indices[i];
+
+        if (is->filter.get() && !is->filter->saturated())
+        {
+            ++count;
+            bytes += is->filter->bytes();
+            continue;
+        }
+
+        is->filter.reset();
+        const schema* sc = config.get_schema(is->ri);
+        const index* idx = config.get_index(is->ii);
+        uint64_t objects = 0;
+
+        if (m_filter_bits == 0 || !is->is_usable() || !sc || !idx ||
+            !filterable(*sc, *idx) || object_count(is->ri, &objects) != SUCCESS)
+        {
+            continue;
+        }
+
+        // no write is in flight, so once the filter thread adds what this
+        // snapshot holds, writes made since will have added the rest
+        snapshot& snap(snaps[shard_of(is->ri)]);
+
+        if (!snap.get())
+        {
+            snap = make_snapshot(is->ri);
+        }
+
+        // leave room for the region to grow before the filter saturates
+        is->filter.reset(new index_filter(objects + objects / 2 + INDEX_FILTER_MIN_VALUES,
+                                          m_filter_bits));
+        m_filter_builder->build(is->ri, is->ii,
+                                index_info::lookup(*idx, sc->attrs[idx->attr].type),
+                                index_encoding::lookup(sc->attrs[0].type),
+                                snap, is->filter);
+        ++count;
+        bytes += is->filter->bytes();
+    }
+
+    e::atomic::store_64_nobarrier(&m_filter_count, count);
+    e::atomic::store_64_nobarrier(&m_filter_bytes, bytes);
+}
+
+void
+datalayer :: add_to_filters(const region_id& ri,
+                            const schema& sc,
+                            const std::vector<const index*>& indices,
+                            const std::vector<e::slice>* old_value,
+                            const std::vector<e::slice>& value)
+{
+    std::vector<index_state>::iterator it;
+    it = std::lower_bound(m_indices.begin(), m_indices.end(), ri);
+    std::vector<char> scratch;
+
+    for (; it < m_indices.end() && it->ri == ri; ++it)
+    {
+        if (!it->filter.get())
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            if (indices[i]->id != it->ii)
+            {
+                continue;
+            }
+
+            const uint16_t attr = indices[i]->attr;
+
+            // the filter already holds a value that did not change
+            if (old_value && (*old_value)[attr - 1] == value[attr - 1])
+            {
+                continue;
+            }
+
+            e::slice encoded;
+            encode_for_filter(index_encoding::lookup(sc.attrs[attr].type),
+                              value[attr - 1], &scratch, &encoded);
+            it->filter->add(encoded);
+        }
+    }
+}
+
+bool
+datalayer :: filtered_out(const region_id& ri, const schema& sc, const range& r)
+{
+    if (r.attr == 0 || !r.has_start || !r.has_end)
+    {
+        return false;
+    }
+
+    std::vector<index_state>::iterator it;
+    it = std::lower_bound(m_indices.begin(), m_indices.end(), ri);
+    const index_encoding* ie = index_encoding::lookup(sc.attrs[r.attr].type);
+    std::vector<char> scratch_lower;
+    std::vector<char> scratch_upper;
+    e::slice lower;
+    e::slice upper;
+    bool encoded = false;
+
+    for (; it < m_indices.end() && it->ri == ri; ++it)
+    {
+        if (!it->filter.get() || !it->filter->ready() || it->filter->saturated())
+        {
+            continue;
+        }
+
+        const index* idx = m_daemon->config().get_index(it->ii);
+
+        if (!idx || idx->attr != r.attr)
+        {
+            continue;
+        }
+
+        if (!encoded)
+        {
+            encode_for_filter(ie, r.start, &scratch_lower, &lower);
+            encode_for_filter(ie, r.end, &scratch_upper, &upper);
+            encoded = true;
+        }
+
+        if (!it->filter->may_contain(lower, upper))
+        {
+            m_filter_negatives.tap();
+            return true;
+        }
+    }
+
+    return false;
+}
+
 datalayer::returncode
 datalayer :: handle_error(leveldb::Status st)
 {
@@ -1428,6 +4316,43 @@ datalayer :: reference :: swap(reference* ref)
     m_backing.swap(ref->m_backing);
 }
 
+e::slice
+datalayer :: reference :: encoded_attrs() const
+{
+    const size_t header = sizeof(uint64_t) + sizeof(uint16_t);
+
+    if (m_backing.size() < header)
+    {
+        return e::slice();
+    }
+
+    return e::slice(m_backing.data() + header, m_backing.size() - header);
+}
+
+datalayer :: tuning :: tuning()
+    : write_buffer_size(16ULL * 1024ULL * 1024ULL)
+    , block_size(4096)
+    , block_cache_size(0)
+    , bloom_bits(10)
+    , compression(true)
+    , object_cache_size(0)
+    , warm_cache_size(0)
+    , group_commit_window(0)
+    , group_sync_window(0)
+    , index_threads(1)
+    , index_rate(0)
+    , index_sort_buffer(64ULL * 1024ULL * 1024ULL)
+    , prefetch_rate(0)
+    , fetch_threads(4)
+    , index_filter_bits(10)
+    , cold_dir()
+    , cold_age(24ULL * 3600ULL)
+    , cold_block_cache_size(0)
+    , value_log_threshold(0)
+    , storage_shards(1)
+{
+}
+
 std::ostream&
 hyperdex :: operator << (std::ostream& lhs, datalayer::returncode rhs)
 {
@@ -30,13 +30,16 @@
 
 // STL
 #include <list>
+#include <map>
 #include <set>
 #include <sstream>
 #include <string>
 #include <vector>
 
 // LevelDB
+#include <hyperleveldb/cache.h>
 #include <hyperleveldb/db.h>
+#include <hyperleveldb/filter_policy.h>
 
 // po6
 #include <po6/net/hostname.h>
@@ -48,6 +51,7 @@
 
 // e
 #include <e/ao_hash_map.h>
+#include <e/compat.h>
 
 // HyperDex
 #include "namespace.h"
@@ -55,10 +59,20 @@
 #include "common/configuration.h"
 #include "common/datatype_info.h"
 #include "common/ids.h"
+#include "common/range.h"
 #include "common/schema.h"
+#include "daemon/latency_histogram.h"
 #include "daemon/leveldb.h"
+#include "daemon/leveldb_counters.h"
+#include "daemon/leveldb_memory.h"
+#include "daemon/leveldb_tiering.h"
+#include "daemon/maintenance_window.h"
+#include "daemon/object_cache.h"
+#include "daemon/performance_counter.h"
 #include "daemon/reconfigure_returncode.h"
 #include "daemon/region_timestamp.h"
+#include "daemon/value_compressor.h"
+#include "daemon/value_log.h"
 
 BEGIN_HYPERDEX_NAMESPACE
 class daemon;
@@ -76,6 +90,7 @@ class datalayer
             LEVELDB_ERROR
         };
         class reference;
+        class tuning;
         class iterator;
         class replay_iterator;
         class dummy_iterator;
@@ -84,9 +99,15 @@ class datalayer
         class index_iterator;
         class range_index_iterator;
         class intersect_iterator;
+        class materialized_intersect_iterator;
         typedef leveldb_snapshot_ptr snapshot;
         // must be pow2
         const static uint64_t REGION_PERIODIC = 65536;
+        // Attributes at least CHUNK_THRESHOLD bytes long live in CHUNK_SIZE
+        // pieces under keys of their own, so that a write rewrites only the
+        // pieces that changed and get_partial reads only what it asked for.
+        const static uint64_t CHUNK_THRESHOLD = 1024 * 1024;
+        const static uint64_t CHUNK_SIZE = 256 * 1024;
 
     public:
         datalayer(daemon*);
@@ -94,6 +115,7 @@ class datalayer
 
     public:
         bool initialize(const std::string& path,
+                        const tuning& t,
                         bool* saved,
                         server_id* saved_us,
                         po6::net::location* saved_bind_to,
@@ -101,6 +123,13 @@ class datalayer
         bool save_state(const server_id& m_us,
                         const po6::net::location& bind_to,
                         const po6::net::hostname& coordinator);
+        // the regions initialize placed on the memory instance, which
+        // starts empty, along with their versions and checkpoints
+        void lost_regions(std::vector<region_id>* rids);
+        // remember what the next start should read back into the block
+        // cache:  regions hottest first, and hot keys within them
+        void save_prefetch_list(const std::vector<region_id>& regions,
+                                const std::vector<std::pair<region_id, std::string> >& keys);
         void teardown();
         // reconfiguration
         void pause();
@@ -112,8 +141,80 @@ class datalayer
         // stats
         bool get_property(const e::slice& property,
                           std::string* value);
-        std::string get_timestamp();
+        // the replay timestamp of the instance holding the region
+        std::string get_timestamp(const region_id& ri);
         uint64_t approximate_size();
+        // bytes on disk for the region's objects
+        uint64_t approximate_size(const region_id& ri);
+        void cache_stats(uint64_t* hits, uint64_t* misses, uint64_t* bytes);
+        void warm_cache_stats(uint64_t* hits, uint64_t* misses, uint64_t* bytes);
+        void group_commit_stats(uint64_t* writes, uint64_t* batches);
+        // lookups LevelDB made of its block cache, and how many found the
+        // block; keys checked against bloom filters, and how many were ruled
+        // out; writes LevelDB held back to let compaction catch up, and the
+        // nanoseconds they were held
+        void block_cache_stats(uint64_t* hits, uint64_t* misses);
+        uint64_t block_cache_size();
+        void filter_stats(uint64_t* checks, uint64_t* negatives);
+        // lookups of the cold tables' block cache, and how many found the
+        // block; tables and bytes moved to the cold directory
+        void cold_tier_stats(uint64_t* hits, uint64_t* misses,
+                             uint64_t* tables, uint64_t* bytes);
+        uint64_t cold_block_cache_size();
+        void write_stall_stats(uint64_t* stalls, uint64_t* nanos);
+        // how close compaction is to falling far enough behind that LevelDB
+        // stalls writes, from 0 (keeping up) to 1000 (about to stall), as of
+        // a sample of LevelDB's tables taken at most COMPACTION_SAMPLE_NANOS
+        // ago; and the level-0 tables and bytes over their levels' targets
+        // that went into it
+        uint64_t compaction_pressure();
+        void compaction_stats(uint64_t* l0_files, uint64_t* debt, uint64_t* pressure);
+        // checkpoints held, those waiting to be collected, those collected,
+        // and the nanoseconds spent collecting them
+        void checkpoint_stats(uint64_t* records, uint64_t* backlog,
+                              uint64_t* collected, uint64_t* gc_time);
+        // the latency of writes to spaces of the given durability
+        latency_histogram* write_latency(durability_level d);
+        void plan_cache_stats(uint64_t* hits, uint64_t* misses);
+        // objects and bytes scanned by index backfills, and an estimate of
+        // the bytes the backfills in progress have yet to scan
+        void indexer_stats(uint64_t* objects, uint64_t* bytes, uint64_t* pending);
+        // segments in the value log, the bytes they hold, the bytes objects
+        // referred to when last collected, and the segments removed
+        void value_log_stats(uint64_t* segments, uint64_t* bytes,
+                             uint64_t* live, uint64_t* reclaimed);
+        // dictionaries trained for compressed spaces, and the attribute
+        // bytes written to them before and after compression
+        void compression_stats(uint64_t* dictionaries, uint64_t* raw, uint64_t* stored);
+        // index filters made at the last reconfiguration, the bytes they
+        // hold, and the searches they answered without reading LevelDB
+        void index_filter_stats(uint64_t* filters, uint64_t* bytes, uint64_t* negatives);
+        // bytes maintenance wrote within its budget, the nanoseconds it slept
+        // to stay there, and the regions compacted on request
+        void maintenance_stats(uint64_t* bytes, uint64_t* slept, uint64_t* compactions);
+
+    public:
+        // move tables old enough to be cold to the cold data directory, a
+        // bounded amount at a time; does nothing without one
+        void migrate_cold_tables();
+        // rewrite the region's objects and index entries into LevelDB's
+        // last level, so that each read of them consults a single table
+        void compact_region(const region_id& ri);
+        // the window collecting checkpoints and building indices wait for,
+        // and the budget they and wiping write within; see maintenance_window
+        bool set_maintenance(uint16_t start, uint16_t end, uint64_t budget);
+        void get_maintenance(uint16_t* start, uint16_t* end, uint64_t* budget);
+        // compact the region on the next call to "maintain", whatever the
+        // window; false if no region is queued because it was already
+        bool request_compaction(const region_id& ri);
+        // compact the regions requested, and when the window has opened since
+        // the last call, wake the threads that waited for it; only one thread
+        // may call this, every so often
+        void maintain();
+        // every so often, remove the value log segments that an earlier pass
+        // found no object refers to, once no checkpoint a replay could start
+        // from predates that pass; then look for more
+        void collect_value_log();
 
     public:
         // retrieve the current value of a key
@@ -122,6 +223,38 @@ class datalayer
                        std::vector<e::slice>* value,
                        uint64_t* version,
                        reference* ref);
+        // like "get", but only decode the attributes in "attrs", which must
+        // be sorted and numbered as in the schema (so never 0).  The
+        // remaining attributes are left as empty slices.
+        returncode get_partial(const region_id& ri,
+                               const e::slice& key,
+                               const std::vector<uint16_t>& attrs,
+                               std::vector<e::slice>* value,
+                               uint64_t* version,
+                               reference* ref);
+        // like "get", but read the value as of "snap", bypassing the cache
+        returncode get(snapshot snap,
+                       const region_id& ri,
+                       const e::slice& key,
+                       std::vector<e::slice>* value,
+                       uint64_t* version,
+                       reference* ref);
+        // like "get", but first consult the values key states left behind
+        // with "remember"; "*generation" is the token to pass to "remember"
+        returncode get_remembered(const region_id& ri,
+                                  const e::slice& key,
+                                  std::vector<e::slice>* value,
+                                  uint64_t* version,
+                                  reference* ref,
+                                  uint64_t* generation);
+        // keep the committed value of a key whose key state has gone idle so
+        // the next key state for it may skip the read; "value" is NULL when
+        // the key is not on disk
+        void remember(const region_id& ri,
+                      const e::slice& key,
+                      const std::vector<e::slice>* value,
+                      uint64_t version,
+                      uint64_t generation);
         // put, overput, or delete a key where the existing value is known
         returncode del(const region_id& ri,
                        const e::slice& key,
@@ -142,13 +275,43 @@ class datalayer
                                  const e::slice& key,
                                  const std::vector<e::slice>& new_value,
                                  uint64_t version);
-        // leveldb provides no failure mechanism for this, neither do we
-        snapshot make_snapshot();
-        // create iterators from snapshots
+        // uncertain_put/uncertain_del for many distinct keys as one write;
+        // a NULL value deletes the key.  Nothing is written on failure.
+        returncode uncertain_write(const region_id& ri,
+                                   const std::vector<e::slice>& keys,
+                                   const std::vector<const std::vector<e::slice>*>& values,
+                                   const std::vector<uint64_t>& versions);
+        // leveldb provides no failure mechanism for this, neither do we; a
+        // snapshot covers only the instance holding the region
+        snapshot make_snapshot(const region_id& ri);
+        // the LevelDB instance holding the region's objects, indices,
+        // versions, counts and checkpoints; regions sharing one may share
+        // a snapshot
+        size_t shard_of(const region_id& ri);
+        // create iterators from snapshots; objects past their expiry are
+        // skipped unless the caller is the sweep that reclaims them
         iterator* make_search_iterator(snapshot snap,
                                        const region_id& ri,
                                        const std::vector<attribute_check>& checks,
-                                       std::ostringstream* ostr);
+                                       std::ostringstream* ostr,
+                                       bool include_expired = false);
+        // iterate the objects that pass "checks" through a spatial index over
+        // exactly "attrs", starting from the code of "point" (a coordinate
+        // per attribute) so that the first objects lie near it; NULL if the
+        // region has no such index
+        iterator* make_nearest_iterator(snapshot snap,
+                                        const region_id& ri,
+                                        const std::vector<attribute_check>& checks,
+                                        const std::vector<uint16_t>& attrs,
+                                        const std::vector<double>& point);
+        // iterate the objects that pass "checks" in the order of attribute
+        // "sort_by", lowest first unless "maximize", by walking an index
+        // over it; NULL if the region has no index that keeps that order
+        iterator* make_sorted_iterator(snapshot snap,
+                                       const region_id& ri,
+                                       const std::vector<attribute_check>& checks,
+                                       uint16_t sort_by,
+                                       bool maximize);
         // backups
         bool backup(const e::slice& name);
         // get the object pointed to by the iterator
@@ -162,11 +325,17 @@ class datalayer
         // track version counters
         void bump_version(const region_id& ri, uint64_t version);
         uint64_t max_version(const region_id& ri);
+        // the exact number of objects in the region; the first call for a
+        // region counts them, and later calls fold in the deltas written since
+        returncode object_count(const region_id& ri, uint64_t* count);
         // checkpointing
         returncode create_checkpoint(const region_timestamp& rt);
         void set_checkpoint_gc(uint64_t checkpoint_gc);
         void largest_checkpoint_for(const region_id& ri, uint64_t* checkpoint);
         bool region_will_be_wiped(region_id rid);
+        // true while a region split off from one of ours waits for its
+        // objects; it must take no requests until then
+        bool region_is_filling(const region_id& ri);
         void request_wipe(const transfer_id& xid,
                           const region_id& ri);
         void inhibit_wiping();
@@ -179,42 +348,219 @@ class datalayer
         // used on startup
         bool only_key_is_hyperdex_key();
         bool upgrade_13x_to_14();
+        // mark the data as 1.7, whose index entries end in compact key sizes
+        bool upgrade_16_to_17();
 
     private:
         class index_state;
+        class group_commit;
+        class plan_cache;
         class checkpointer_thread;
+        class divider_thread;
+        class index_sorter;
         class indexer_thread;
+        class prefetch_thread;
+        class fetcher;
+        class filter_thread;
         class wiper_thread;
         class wiper_indexer_mediator;
         datalayer(const datalayer&);
         datalayer& operator = (const datalayer&);
 
     private:
+        // read the encoded object into "ref" from the cache or LevelDB
+        returncode read(const region_id& ri,
+                        const e::slice& key,
+                        reference* ref);
+        // read the object into "ref" with the attributes in "attrs" (all when
+        // NULL) inline; one with chunks is read, chunks and all, from a
+        // single snapshot
+        returncode read_whole(const region_id& ri,
+                              const e::slice& key,
+                              const std::vector<uint16_t>* attrs,
+                              reference* ref);
+        // turn the stored object in "backing" into one with every attribute
+        // inline, reading the chunks of those in "attrs" (all when NULL) as
+        // of "snap" (now when NULL); NOT_FOUND if writes since the object's
+        // version have replaced its pieces, as they may have for a replay
+        returncode unchunk(const region_id& ri,
+                           const e::slice& key,
+                           const leveldb::Snapshot* snap,
+                           const std::vector<uint16_t>* attrs,
+                           std::string* backing);
+        // read and unchunk the stored object for key as of "snap", bypassing
+        // the caches; safe to call from any thread
+        returncode read_object(const region_id& ri,
+                               hyperdatatype key_type,
+                               const e::slice& key,
+                               const leveldb::Snapshot* snap,
+                               std::string* backing);
+        // encode "value" for LevelDB, first appending to the value log the
+        // attributes that belong there, and compressing the rest if the
+        // space is compressed
+        returncode encode_object(const region_id& ri,
+                                 const schema& sc,
+                                 const std::vector<e::slice>& value,
+                                 uint64_t version,
+                                 value_log::appends* logged,
+                                 std::vector<char>* backing,
+                                 leveldb::Slice* out);
+        // make appends durable before a write of the given durability
+        // refers to them
+        returncode sync_logged(const value_log::appends& logged, durability_level d);
+        // move key's chunks from those of old_value to those of new_value,
+        // which has the given version, skipping pieces that are unchanged;
+        // either may be NULL.  Each piece written replaces every other
+        // version of it
+        void write_chunks(const region_id& ri,
+                          const e::slice& key,
+                          const std::vector<e::slice>* old_value,
+                          const std::vector<e::slice>* new_value,
+                          uint64_t version,
+                          leveldb::WriteBatch* updates);
+        // drop what key states remembered for a key written behind their
+        // backs, failing any "remember" that raced with the write
+        void forget(const region_id& ri, const e::slice& key);
         bool write_version(const region_id& ri,
                            uint64_t version,
                            leveldb::WriteBatch* updates);
         void update_memory_version(const region_id& ri, uint64_t version);
+        // hand the list save_prefetch_list wrote to the prefetch thread
+        void load_prefetch_list();
         uint64_t disk_version(const region_id& ri);
+        // the same, reusing an existing iterator for a batch of regions
+        uint64_t disk_version(leveldb::Iterator* it, const region_id& ri);
+        // move the next batch of objects "it" reaches that config places in
+        // another region into that region, or drop them if we do not map
+        // that region; false once "it" runs out or a write fails
+        bool divide_region(const configuration& config, const region_id& ri,
+                           region_iterator* it, uint64_t* moved, uint64_t* dropped);
+        // record that the region gained or lost an object as part of "updates"
+        void write_count(const region_id& ri, int64_t delta,
+                         leveldb::WriteBatch* updates);
+        // one more than the largest count id on disk
+        uint64_t next_count_id();
+        // make the compression dictionaries saved on disk usable
+        bool load_dictionaries();
+        // offer an object written to sid for its dictionary, saving the
+        // dictionary if this completes it
+        void sample_for_dictionary(const space_id& sid, const std::vector<e::slice>& value);
         void find_indices(const region_id& rid,
                           std::vector<const index*>* indices);
+        // give every usable index that can have a filter and lacks a
+        // trustworthy one a new filter, for the filter thread to fill
+        void create_index_filters(const configuration& config);
+        // add the values of an object just written to the filters of its
+        // region's indices, skipping those unchanged from old_value
+        void add_to_filters(const region_id& ri,
+                            const schema& sc,
+                            const std::vector<const index*>& indices,
+                            const std::vector<e::slice>* old_value,
+                            const std::vector<e::slice>& value);
+        // does a filter show that no object's attribute lies in r?
+        bool filtered_out(const region_id& ri, const schema& sc, const range& r);
         void find_indices(const region_id& rid, uint16_t attr,
                           std::vector<const index*>* indices);
 
+        const leveldb_db_ptr& db_for(const region_id& ri) { return m_shards[shard_of(ri)]; }
+        // for threads that keep running through a reconfigure: reads the
+        // placement under m_protect_placement and keeps the instance alive
+        leveldb_db_ptr db_copy_for(const region_id& ri);
+        group_commit* commit_for(const region_id& ri) { return m_group_commits[shard_of(ri)].get(); }
+        // read back where regions live; a daemon that saved its state but
+        // no placement predates sharding
+        bool load_shards(bool first_time);
+        // place the regions new to us on an instance, and save where every
+        // region lives before anything is written to its instance
+        void assign_shards(const configuration& old_config, const configuration& config);
+
         returncode handle_error(leveldb::Status st);
         void collect_lower_checkpoints(uint64_t checkpoint_gc);
+        void sample_compaction();
+        // one instance's level-0 tables, bytes past its levels' targets, and
+        // the pressure they make; false if LevelDB would not say
+        bool sample_compaction(leveldb::DB* db, uint64_t* l0,
+                               uint64_t* debt, uint64_t* pressure);
 
         const static region_id defaultri;
         static uint64_t id(region_id ri) { return ri.get(); }
 
     private:
         daemon* m_daemon;
+        // must outlive m_db
+        std::auto_ptr<counting_cache> m_block_cache;
+        std::auto_ptr<counting_filter_policy> m_filter_policy;
+        std::auto_ptr<tiered_env> m_tiers;
+        std::auto_ptr<counting_cache> m_cold_block_cache;
+        std::auto_ptr<tiered_cache> m_tiered_cache;
+        std::auto_ptr<memory_env> m_memory_env;
+        // where LevelDB lives and how long a table waits before it is cold
+        std::string m_path;
+        uint64_t m_cold_age;
+        // the instance holding the daemon's own keys (format, state,
+        // prefetch list, dictionaries, region placement); m_shards[0]
         leveldb_db_ptr m_db;
+        std::vector<leveldb_db_ptr> m_shards;
+        // the last of m_shards keeps its files in m_memory_env and holds
+        // the regions of spaces with DURABILITY_MEMORY, and only those
+        size_t m_memory_shard;
+        // every region ever placed, as saved under "shards"; only
+        // initialize and reconfigure touch it
+        std::map<region_id, uint64_t> m_placement;
+        // a copy of m_placement for lookups; absent regions live on m_db.
+        // assign_shards swaps it under m_protect_placement, which threads
+        // that are not paused for reconfigure read it under
+        e::ao_hash_map<region_id, uint64_t, id, defaultri> m_shard_of;
+        po6::threads::mutex m_protect_placement;
+        // no placement was saved, so the regions of an older,
+        // single-instance layout have their objects on m_db
+        bool m_shards_unsaved;
+        object_cache m_cache;
+        // values left behind by idle key states; written only by "remember"
+        object_cache m_warm;
+        // one per instance, made when they are opened
+        std::vector<e::compat::shared_ptr<group_commit> > m_group_commits;
+        // how long writes of each durability took, queueing included
+        latency_histogram m_write_latency[DURABILITY_MEMORY + 1];
+        const std::auto_ptr<plan_cache> m_plans;
         std::vector<index_state> m_indices;
         e::ao_hash_map<region_id, uint64_t, id, defaultri> m_versions;
+        // serializes folding deltas into the base counts
+        po6::threads::mutex m_count_mtx;
+        uint64_t m_count_id;
         const std::auto_ptr<checkpointer_thread> m_checkpointer;
         const std::auto_ptr<wiper_indexer_mediator> m_mediator;
-        const std::auto_ptr<indexer_thread> m_indexer;
+        std::vector<e::compat::shared_ptr<indexer_thread> > m_indexers;
         const std::auto_ptr<wiper_thread> m_wiper;
+        const std::auto_ptr<prefetch_thread> m_prefetcher;
+        const std::auto_ptr<fetcher> m_fetcher;
+        const std::auto_ptr<filter_thread> m_filter_builder;
+        const std::auto_ptr<divider_thread> m_divider;
+        unsigned m_filter_bits;
+        uint64_t m_filter_count;
+        uint64_t m_filter_bytes;
+        performance_counter m_filter_negatives;
+        // attributes at least this big, and smaller than CHUNK_THRESHOLD, go
+        // in the value log; 0 keeps them in LevelDB
+        uint64_t m_vlog_threshold;
+        value_log m_vlog;
+        // segments collect_value_log found unreferenced, with the largest
+        // checkpoint and the time of the pass that found them; only it
+        // touches these
+        std::map<uint64_t, std::pair<uint64_t, uint64_t> > m_vlog_dead;
+        uint64_t m_vlog_collected_at;
+        value_compressor m_compressor;
+        // the last sample of compaction debt; see compaction_pressure
+        uint64_t m_compaction_sampled_at;
+        uint64_t m_compaction_l0;
+        uint64_t m_compaction_debt;
+        uint64_t m_compaction_pressure;
+        maintenance_window m_maintenance;
+        // only "maintain" touches m_maintenance_open
+        bool m_maintenance_open;
+        po6::threads::mutex m_compact_mtx;
+        std::set<region_id> m_compact_requested; // under m_compact_mtx
+        uint64_t m_compactions; // under m_compact_mtx
 };
 
 class datalayer::reference
@@ -225,6 +571,11 @@ class datalayer::reference
 
     public:
         void swap(reference* ref);
+        // The secondary attributes exactly as they were stored.  They are
+        // laid out the way a packed std::vector<e::slice> is after its
+        // leading count, so they may be copied into a message verbatim.
+        // Only meaningful after a successful "get".
+        e::slice encoded_attrs() const;
 
     private:
         friend class datalayer;
@@ -233,6 +584,62 @@ class datalayer::reference
         std::string m_backing;
 };
 
+// LevelDB knobs that may be set from the command line
+class datalayer::tuning
+{
+    public:
+        tuning();
+
+    public:
+        uint64_t write_buffer_size;
+        uint64_t block_size;
+        // 0 selects LevelDB's built-in cache
+        uint64_t block_cache_size;
+        // 0 disables the bloom filter
+        unsigned bloom_bits;
+        bool compression;
+        // 0 disables the object cache
+        uint64_t object_cache_size;
+        // 0 disables remembering the values of idle key states
+        uint64_t warm_cache_size;
+        // how long, in nanoseconds, a write waits for others to commit with
+        // it; 0 disables group commit
+        uint64_t group_commit_window;
+        // how long, in nanoseconds, a write to a space with group durability
+        // waits for others to share its fsync
+        uint64_t group_sync_window;
+        // threads that build new indices, each working on a different region
+        unsigned index_threads;
+        // bytes per second all index builds may scan; 0 leaves them unthrottled
+        uint64_t index_rate;
+        // memory each index build may use to sort its entries before writing
+        // them; 0 writes entries as they are made
+        uint64_t index_sort_buffer;
+        // bytes per second that refilling the block cache after a restart
+        // may read; 0 disables it
+        uint64_t prefetch_rate;
+        // threads that read the objects an index search finds, so that
+        // several reads are outstanding at once; 0 reads them one at a time
+        unsigned fetch_threads;
+        // bits per value of the filters that let searches for values an
+        // index lacks skip LevelDB; 0 disables them
+        unsigned index_filter_bits;
+        // a directory on cheaper storage for tables left unmodified for
+        // cold_age seconds; empty keeps every table with the rest
+        std::string cold_dir;
+        uint64_t cold_age;
+        // 0 gives cold tables a cache as large as LevelDB's built-in one
+        uint64_t cold_block_cache_size;
+        // attributes at least this big (and under CHUNK_THRESHOLD) are kept
+        // in the value log instead of LevelDB; 0 disables it
+        uint64_t value_log_threshold;
+        // LevelDB instances to spread regions over; those past the first
+        // live in shard-<n> under the data directory, which may link to
+        // other disks.  Spaces with DURABILITY_MEMORY have an instance of
+        // their own that is in addition to these.
+        unsigned storage_shards;
+};
+
 std::ostream&
 operator << (std::ostream& lhs, datalayer::returncode rhs);
 
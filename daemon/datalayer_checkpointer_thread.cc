@@ -27,9 +27,22 @@
 
 #define __STDC_LIMIT_MACROS
 
+// C
+#include <time.h>
+
+// STL
+#include <algorithm>
+#include <vector>
+
 // Google Log
 #include <glog/logging.h>
 
+// LevelDB
+#include <hyperleveldb/write_batch.h>
+
+// po6
+#include <po6/time.h>
+
 // HyperDex
 #include "daemon/daemon.h"
 #include "daemon/datalayer.h"
@@ -38,6 +51,26 @@
 
 using hyperdex::datalayer;
 
+// delete at most this many checkpoints with each LevelDB write
+#define CHECKPOINT_GC_BATCH_SIZE 4096
+
+namespace
+{
+
+bool
+checkpoint_less(const std::pair<uint64_t, std::string>& lhs, uint64_t rhs)
+{
+    return lhs.first < rhs;
+}
+
+bool
+checkpoint_greater(uint64_t lhs, const std::pair<uint64_t, std::string>& rhs)
+{
+    return lhs < rhs.first;
+}
+
+} // namespace
+
 datalayer :: checkpointer_thread :: checkpointer_thread(daemon* d)
     : background_thread(d)
     , m_daemon(d)
@@ -45,6 +78,11 @@ datalayer :: checkpointer_thread :: checkpointer_thread(daemon* d)
     , m_checkpoint_gced(0)
     , m_checkpoint_target(0)
     , m_gc_inhibit_permit_diff(0)
+    , m_protect_checkpoints()
+    , m_checkpoints()
+    , m_checkpoints_sz(0)
+    , m_collected(0)
+    , m_gc_time(0)
 {
 }
 
@@ -61,8 +99,10 @@ datalayer :: checkpointer_thread :: thread_name()
 bool
 datalayer :: checkpointer_thread :: have_work()
 {
+    // collection is heavy enough to wait for the maintenance window
     return m_checkpoint_gced < m_checkpoint_gc &&
-           m_gc_inhibit_permit_diff == 0;
+           m_gc_inhibit_permit_diff == 0 &&
+           m_daemon->m_data.m_maintenance.is_open(time(NULL));
 }
 
 void
@@ -87,6 +127,10 @@ datalayer :: checkpointer_thread :: debug_dump()
     LOG(INFO) << "checkpoint_target=" << m_checkpoint_target;
     LOG(INFO) << "gc_inhibit_permit_diff=" << m_gc_inhibit_permit_diff;
     this->unlock();
+    po6::threads::mutex::hold hold(&m_protect_checkpoints);
+    LOG(INFO) << "checkpoint_regions=" << m_checkpoints.size();
+    LOG(INFO) << "checkpoint_records=" << m_checkpoints_sz;
+    LOG(INFO) << "checkpoints_collected=" << m_collected;
 }
 
 void
@@ -122,57 +166,284 @@ datalayer :: checkpointer_thread :: set_checkpoint_gc(uint64_t checkpoint_gc)
 }
 
 void
-datalayer :: checkpointer_thread :: collect_lower_checkpoints(uint64_t checkpoint_gc)
+datalayer :: checkpointer_thread :: kick()
+{
+    this->lock();
+    this->wakeup();
+    this->unlock();
+}
+
+void
+datalayer :: checkpointer_thread :: load()
 {
     leveldb::ReadOptions opts;
     opts.verify_checksums = true;
-    std::auto_ptr<leveldb::Iterator> it;
-    it.reset(m_daemon->m_data.m_db->NewIterator(opts));
-    it->Seek(leveldb::Slice("c", 1));
-    std::string lower_bound_timestamp("now");
+    opts.fill_cache = false;
+    po6::threads::mutex::hold hold(&m_protect_checkpoints);
+    m_checkpoints.clear();
+    m_checkpoints_sz = 0;
+    const std::vector<leveldb_db_ptr>& shards(m_daemon->m_data.m_shards);
+
+    // each region's checkpoints are with the rest of it
+    for (size_t i = 0; i < shards.size(); ++i)
+    {
+        std::auto_ptr<leveldb::Iterator> it;
+        it.reset(shards[i]->NewIterator(opts));
+        it->Seek(leveldb::Slice("c", 1));
+
+        while (it->Valid())
+        {
+            region_id ri;
+            uint64_t checkpoint;
+            e::slice key(it->key().data(), it->key().size());
+
+            if (decode_checkpoint(key, &ri, &checkpoint) != datalayer::SUCCESS)
+            {
+                break;
+            }
+
+            std::string ts(it->value().data(), it->value().size());
+            m_checkpoints[ri].push_back(std::make_pair(checkpoint, ts));
+            ++m_checkpoints_sz;
+            it->Next();
+        }
+    }
+}
+
+void
+datalayer :: checkpointer_thread :: record(const region_timestamp& rt)
+{
+    po6::threads::mutex::hold hold(&m_protect_checkpoints);
+    checkpoint_list* cl = &m_checkpoints[rt.rid];
+
+    // checkpoints only grow, so this is almost always an append
+    checkpoint_list::iterator it = std::lower_bound(cl->begin(), cl->end(),
+                                                    rt.checkpoint, checkpoint_less);
+
+    if (it != cl->end() && it->first == rt.checkpoint)
+    {
+        it->second = rt.local_timestamp;
+        return;
+    }
+
+    cl->insert(it, std::make_pair(rt.checkpoint, rt.local_timestamp));
+    ++m_checkpoints_sz;
+}
+
+uint64_t
+datalayer :: checkpointer_thread :: largest_checkpoint(const region_id& ri)
+{
+    po6::threads::mutex::hold hold(&m_protect_checkpoints);
+    checkpoint_map::iterator it = m_checkpoints.find(ri);
+
+    if (it == m_checkpoints.end() || it->second.empty())
+    {
+        return 0;
+    }
+
+    return it->second.back().first;
+}
+
+uint64_t
+datalayer :: checkpointer_thread :: largest_checkpoint()
+{
+    po6::threads::mutex::hold hold(&m_protect_checkpoints);
+    uint64_t largest = 0;
+
+    for (checkpoint_map::iterator it = m_checkpoints.begin();
+            it != m_checkpoints.end(); ++it)
+    {
+        if (!it->second.empty())
+        {
+            largest = std::max(largest, it->second.back().first);
+        }
+    }
+
+    return largest;
+}
+
+uint64_t
+datalayer :: checkpointer_thread :: collected_below()
+{
+    this->lock();
+    uint64_t gced = m_checkpoint_gced;
+    this->unlock();
+    return gced;
+}
+
+std::string
+datalayer :: checkpointer_thread :: replay_timestamp(const region_id& ri, uint64_t checkpoint)
+{
+    po6::threads::mutex::hold hold(&m_protect_checkpoints);
+    checkpoint_map::iterator it = m_checkpoints.find(ri);
+
+    if (it == m_checkpoints.end())
+    {
+        return "all";
+    }
+
+    checkpoint_list::iterator cp = std::upper_bound(it->second.begin(), it->second.end(),
+                                                    checkpoint, checkpoint_greater);
+
+    if (cp == it->second.begin())
+    {
+        return "all";
+    }
+
+    --cp;
+    return cp->second;
+}
+
+void
+datalayer :: checkpointer_thread :: forget_region(const region_id& ri)
+{
+    po6::threads::mutex::hold hold(&m_protect_checkpoints);
+    checkpoint_map::iterator it = m_checkpoints.find(ri);
+
+    if (it != m_checkpoints.end())
+    {
+        m_checkpoints_sz -= it->second.size();
+        m_checkpoints.erase(it);
+    }
+}
+
+void
+datalayer :: checkpointer_thread :: gc_stats(uint64_t* records, uint64_t* backlog,
+                                             uint64_t* collected, uint64_t* gc_time)
+{
+    this->lock();
+    uint64_t checkpoint_gc = m_checkpoint_gc;
+    this->unlock();
+    po6::threads::mutex::hold hold(&m_protect_checkpoints);
+    *records = m_checkpoints_sz;
+    *backlog = 0;
+    *collected = m_collected;
+    *gc_time = m_gc_time;
 
-    while (it->Valid())
+    for (checkpoint_map::iterator it = m_checkpoints.begin();
+            it != m_checkpoints.end(); ++it)
     {
-        region_timestamp rt;
-        e::slice key(it->key().data(), it->key().size());
-        returncode rc = decode_checkpoint(key, &rt.rid, &rt.checkpoint);
+        *backlog += std::lower_bound(it->second.begin(), it->second.end(),
+                                     checkpoint_gc, checkpoint_less)
+                  - it->second.begin();
+    }
+}
+
+void
+datalayer :: checkpointer_thread :: collect_lower_checkpoints(uint64_t checkpoint_gc)
+{
+    const uint64_t start = po6::monotonic_time();
+    const std::vector<leveldb_db_ptr>& shards(m_daemon->m_data.m_shards);
+    // a region's timestamps are those of the instance holding it
+    std::vector<std::vector<std::pair<region_id, uint64_t> > > doomed(shards.size());
+    std::vector<std::string> lower_bound_timestamps(shards.size(), "now");
 
-        if (rc != datalayer::SUCCESS)
+    // decide what goes from the copy in memory; each region's doomed
+    // checkpoints are the front of its list and adjacent in LevelDB
+    {
+        po6::threads::mutex::hold hold(&m_protect_checkpoints);
+
+        for (checkpoint_map::iterator it = m_checkpoints.begin();
+                it != m_checkpoints.end(); ++it)
         {
-            break;
+            const size_t shard = m_daemon->m_data.shard_of(it->first);
+            leveldb::DB* db = shards[shard].get();
+
+            for (checkpoint_list::iterator cp = it->second.begin();
+                    cp != it->second.end(); ++cp)
+            {
+                if (cp->first >= checkpoint_gc &&
+                    db->ValidateTimestamp(cp->second))
+                {
+                    if (db->CompareTimestamps(cp->second, lower_bound_timestamps[shard]) < 0)
+                    {
+                        lower_bound_timestamps[shard] = cp->second;
+                    }
+
+                    continue;
+                }
+
+                doomed[shard].push_back(std::make_pair(it->first, cp->first));
+            }
         }
+    }
 
-        rt.local_timestamp = std::string(it->value().data(), it->value().size());
+    // delete them in large batches rather than one write apiece
+    std::vector<std::pair<region_id, uint64_t> > deleted;
 
-        if (rt.checkpoint >= checkpoint_gc &&
-            m_daemon->m_data.m_db->ValidateTimestamp(rt.local_timestamp))
+    for (size_t s = 0; s < shards.size(); ++s)
+    {
+        size_t done = 0;
+
+        while (done < doomed[s].size())
         {
-            if (m_daemon->m_data.m_db->CompareTimestamps(rt.local_timestamp, lower_bound_timestamp) < 0)
+            leveldb::WriteBatch updates;
+            size_t limit = std::min(doomed[s].size(), done + CHECKPOINT_GC_BATCH_SIZE);
+
+            for (size_t i = done; i < limit; ++i)
             {
-                lower_bound_timestamp = rt.local_timestamp;
+                char cbacking[CHECKPOINT_BUF_SIZE];
+                encode_checkpoint(doomed[s][i].first, doomed[s][i].second, cbacking);
+                updates.Delete(leveldb::Slice(cbacking, CHECKPOINT_BUF_SIZE));
             }
 
-            it->Next();
-            continue;
+            leveldb::WriteOptions wopts;
+            wopts.sync = false;
+            leveldb::Status st = shards[s]->Write(wopts, &updates);
+
+            if (!st.ok())
+            {
+                LOG(ERROR) << "could not collect checkpoints: " << st.ToString();
+                break;
+            }
+
+            deleted.insert(deleted.end(), doomed[s].begin() + done, doomed[s].begin() + limit);
+            m_daemon->m_data.m_maintenance.throttle((limit - done) * CHECKPOINT_BUF_SIZE);
+            done = limit;
         }
+    }
 
-        leveldb::WriteOptions wopts;
-        wopts.sync = false;
-        leveldb::Status st = m_daemon->m_data.m_db->Delete(wopts, it->key());
+    {
+        po6::threads::mutex::hold hold(&m_protect_checkpoints);
 
-        if (!st.ok())
+        for (size_t i = 0; i < deleted.size(); ++i)
         {
-            break;
+            checkpoint_map::iterator it = m_checkpoints.find(deleted[i].first);
+
+            // the wiper may have taken the whole region meanwhile
+            if (it == m_checkpoints.end())
+            {
+                continue;
+            }
+
+            checkpoint_list::iterator cp = std::lower_bound(it->second.begin(), it->second.end(),
+                                                            deleted[i].second, checkpoint_less);
+
+            if (cp != it->second.end() && cp->first == deleted[i].second)
+            {
+                it->second.erase(cp);
+                --m_checkpoints_sz;
+            }
+
+            if (it->second.empty())
+            {
+                m_checkpoints.erase(it);
+            }
         }
 
-        it->Next();
+        m_collected += deleted.size();
+        m_gc_time += po6::monotonic_time() - start;
     }
 
     this->lock();
 
     if (m_gc_inhibit_permit_diff == 0)
     {
-        m_daemon->m_data.m_db->AllowGarbageCollectBeforeTimestamp(lower_bound_timestamp);
+        for (size_t s = 0; s < shards.size(); ++s)
+        {
+            shards[s]->AllowGarbageCollectBeforeTimestamp(lower_bound_timestamps[s]);
+        }
+
         m_checkpoint_gced = m_checkpoint_target;
     }
 
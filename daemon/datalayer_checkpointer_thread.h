@@ -28,6 +28,15 @@
 #ifndef hyperdex_daemon_datalayer_checkpointer_h_
 #define hyperdex_daemon_datalayer_checkpointer_h_
 
+// STL
+#include <deque>
+#include <map>
+#include <string>
+#include <utility>
+
+// po6
+#include <po6/threads/mutex.h>
+
 // HyperDex
 #include "daemon/background_thread.h"
 #include "daemon/datalayer.h"
@@ -52,6 +61,37 @@ class hyperdex::datalayer::checkpointer_thread : public hyperdex::background_thr
         void inhibit_gc();
         void permit_gc();
         void set_checkpoint_gc(uint64_t checkpoint_gc);
+        // look for work anew; the maintenance window may have opened
+        void kick();
+
+    // LevelDB holds each region's checkpoints under "c"; so that lookups and
+    // collection need not scan for them, this keeps a copy in memory.
+    public:
+        // read the checkpoints from LevelDB; call before start
+        void load();
+        // a checkpoint the datalayer just wrote
+        void record(const region_timestamp& rt);
+        // 0 when the region has no checkpoints
+        uint64_t largest_checkpoint(const region_id& ri);
+        // the largest of any region, or 0
+        uint64_t largest_checkpoint();
+        // every checkpoint below this has been collected
+        uint64_t collected_below();
+        // the timestamp of the region's latest checkpoint no later than
+        // "checkpoint", or "all" when there is none
+        std::string replay_timestamp(const region_id& ri, uint64_t checkpoint);
+        // the wiper removed the region's checkpoints from LevelDB
+        void forget_region(const region_id& ri);
+        // checkpoints held, those below the requested collection point,
+        // those collected so far, and the nanoseconds spent collecting them
+        void gc_stats(uint64_t* records, uint64_t* backlog,
+                      uint64_t* collected, uint64_t* gc_time);
+
+    private:
+        // a region's checkpoints and their local timestamps, in increasing
+        // order, which is also the order LevelDB keeps them in
+        typedef std::deque<std::pair<uint64_t, std::string> > checkpoint_list;
+        typedef std::map<region_id, checkpoint_list> checkpoint_map;
 
     private:
         void collect_lower_checkpoints(uint64_t checkpoint_gc);
@@ -62,6 +102,11 @@ class hyperdex::datalayer::checkpointer_thread : public hyperdex::background_thr
         uint64_t m_checkpoint_gced;
         uint64_t m_checkpoint_target; // do_work; no lock; copy of _gc
         uint64_t m_gc_inhibit_permit_diff;
+        po6::threads::mutex m_protect_checkpoints;
+        checkpoint_map m_checkpoints; // under m_protect_checkpoints
+        uint64_t m_checkpoints_sz; // under m_protect_checkpoints
+        uint64_t m_collected; // under m_protect_checkpoints
+        uint64_t m_gc_time; // under m_protect_checkpoints
 
     private:
         checkpointer_thread(const checkpointer_thread&);
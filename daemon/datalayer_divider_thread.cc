@@ -0,0 +1,193 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// Google Log
+#include <glog/logging.h>
+
+// po6
+#include <po6/time.h>
+
+// e
+#include <e/atomic.h>
+
+// HyperDex
+#include "daemon/daemon.h"
+#include "daemon/datalayer_divider_thread.h"
+#include "daemon/datalayer_iterator.h"
+
+using hyperdex::datalayer;
+
+datalayer :: divider_thread :: divider_thread(daemon* d)
+    : background_thread(d)
+    , m_daemon(d)
+    , m_pending()
+    , m_filling()
+    , m_filling_sz(0)
+    , m_current()
+    , m_iter()
+    , m_region_iter(NULL)
+    , m_started(0)
+    , m_moved(0)
+    , m_dropped(0)
+{
+}
+
+datalayer :: divider_thread :: ~divider_thread() throw ()
+{
+}
+
+const char*
+datalayer :: divider_thread :: thread_name()
+{
+    return "region divider";
+}
+
+bool
+datalayer :: divider_thread :: have_work()
+{
+    return !m_pending.empty();
+}
+
+void
+datalayer :: divider_thread :: copy_work()
+{
+    m_current = m_pending.front();
+}
+
+void
+datalayer :: divider_thread :: do_work()
+{
+    // between batches the configuration may change, so look at the latest
+    const configuration& config(m_daemon->config());
+    datalayer* dl = &m_daemon->m_data;
+    const region_id& ri(m_current.parent);
+
+    if (!m_iter.get())
+    {
+        const schema* sc = config.get_schema(ri);
+
+        if (!sc)
+        {
+            LOG(ERROR) << "could not split " << ri << " because it no longer exists";
+            finish();
+            return;
+        }
+
+        // the iterator's snapshot holds every object to move: clients send
+        // writes of those to the children, which are filling
+        const leveldb_db_ptr& db(dl->db_for(ri));
+        leveldb_iterator_ptr iip;
+        leveldb::ReadOptions ro;
+        ro.fill_cache = false;
+        ro.verify_checksums = true;
+        iip.reset(leveldb_snapshot_ptr(db, NULL), db->NewIterator(ro));
+        m_region_iter = new region_iterator(iip, ri, index_encoding::lookup(sc->attrs[0].type));
+        m_iter = e::intrusive_ptr<iterator>(m_region_iter);
+        m_started = po6::monotonic_time();
+        m_moved = 0;
+        m_dropped = 0;
+    }
+
+    if (dl->divide_region(config, ri, m_region_iter, &m_moved, &m_dropped))
+    {
+        return;
+    }
+
+    LOG(INFO) << "split " << ri << ": moved " << m_moved << " objects to new regions"
+              << " and dropped " << m_dropped << " objects that now belong elsewhere in "
+              << (po6::monotonic_time() - m_started) / 1000000ULL << "ms";
+    finish();
+}
+
+void
+datalayer :: divider_thread :: debug_dump()
+{
+    this->lock();
+    LOG(INFO) << "region divider thread =========================================================";
+    LOG(INFO) << "pending=" << m_pending.size();
+
+    for (std::list<job>::iterator it = m_pending.begin(); it != m_pending.end(); ++it)
+    {
+        LOG(INFO) << "  " << it->parent << " filling " << it->children.size() << " regions";
+    }
+
+    this->unlock();
+}
+
+void
+datalayer :: divider_thread :: divide(const region_id& parent,
+                                      const std::vector<region_id>& children)
+{
+    job j;
+    j.parent = parent;
+    j.children = children;
+    this->lock();
+    m_pending.push_back(j);
+    m_filling.insert(children.begin(), children.end());
+    e::atomic::store_64_release(&m_filling_sz, m_filling.size());
+    this->wakeup();
+    this->unlock();
+}
+
+bool
+datalayer :: divider_thread :: is_filling(const region_id& ri)
+{
+    if (e::atomic::load_64_acquire(&m_filling_sz) == 0)
+    {
+        return false;
+    }
+
+    this->lock();
+    bool ret = m_filling.find(ri) != m_filling.end();
+    this->unlock();
+    return ret;
+}
+
+void
+datalayer :: divider_thread :: finish()
+{
+    m_iter = e::intrusive_ptr<iterator>();
+    m_region_iter = NULL;
+    this->lock();
+
+    for (size_t i = 0; i < m_current.children.size(); ++i)
+    {
+        std::multiset<region_id>::iterator it = m_filling.find(m_current.children[i]);
+
+        if (it != m_filling.end())
+        {
+            m_filling.erase(it);
+        }
+    }
+
+    e::atomic::store_64_release(&m_filling_sz, m_filling.size());
+    m_pending.pop_front();
+    this->unlock();
+    // transfers out of the children waited for this
+    m_daemon->m_stm.kick();
+}
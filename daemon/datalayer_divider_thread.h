@@ -0,0 +1,101 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_datalayer_divider_thread_h_
+#define hyperdex_daemon_datalayer_divider_thread_h_
+
+// STL
+#include <list>
+#include <set>
+#include <vector>
+
+// e
+#include <e/intrusive_ptr.h>
+
+// HyperDex
+#include "daemon/background_thread.h"
+#include "daemon/datalayer.h"
+
+// Moves the objects of regions a reconfiguration split into the regions split
+// off from them.  Until every object has left the parent, the regions split
+// off from it are filling: this server bounces requests for them and starts
+// no transfer out of them, so nothing sees them half full.  Each call to
+// do_work writes one batch, so a reconfiguration waits for no more than that.
+class hyperdex::datalayer::divider_thread : public hyperdex::background_thread
+{
+    public:
+        divider_thread(daemon* d);
+        ~divider_thread() throw ();
+
+    public:
+        virtual const char* thread_name();
+        virtual bool have_work();
+        virtual void copy_work();
+        virtual void do_work();
+
+    public:
+        void debug_dump();
+        // call while the network threads are paused, so that the children
+        // are filling before any request for them arrives
+        void divide(const region_id& parent, const std::vector<region_id>& children);
+        bool is_filling(const region_id& ri);
+
+    private:
+        struct job
+        {
+            job() : parent(), children() {}
+            ~job() throw () {}
+            region_id parent;
+            std::vector<region_id> children;
+        };
+
+    private:
+        // the children of the current job may take requests from now on
+        void finish();
+
+    private:
+        daemon* m_daemon;
+        // under lock
+        std::list<job> m_pending;
+        std::multiset<region_id> m_filling;
+        // the size of m_filling, read without the lock as a hint
+        uint64_t m_filling_sz;
+        // do_work; no lock
+        job m_current;
+        e::intrusive_ptr<iterator> m_iter;
+        region_iterator* m_region_iter;
+        uint64_t m_started;
+        uint64_t m_moved;
+        uint64_t m_dropped;
+
+    private:
+        divider_thread(const divider_thread&);
+        divider_thread& operator = (const divider_thread&);
+};
+
+#endif // hyperdex_daemon_datalayer_divider_thread_h_
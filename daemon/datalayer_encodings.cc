@@ -35,7 +35,10 @@
 #include <e/varint.h>
 
 // HyperDex
+#include "common/attribute_check.h"
 #include "daemon/datalayer_encodings.h"
+#include "daemon/index_composite.h"
+#include "daemon/index_spatial.h"
 #include "daemon/index_info.h"
 
 using hyperdex::datalayer;
@@ -136,18 +139,68 @@ hyperdex :: decode_key(const leveldb::Slice& in,
     return true;
 }
 
+// the size of an attribute kept in chunks has this bit set, and the inline
+// bytes are its full size as a 64-bit integer; for one in the value log they
+// are its full size, segment, and offset
+static const uint32_t CHUNKED_ATTR = 0x80000000U;
+static const uint32_t LOGGED_ATTR_SIZE = 3 * sizeof(uint64_t);
+// the size of a compressed attribute has this bit set, and the inline bytes
+// are its dictionary and full size as 32-bit integers, then the compressed
+// bytes
+static const uint32_t COMPRESSED_ATTR = 0x40000000U;
+static const uint32_t COMPRESSED_ATTR_HEADER = 2 * sizeof(uint32_t);
+
 void
 hyperdex :: encode_value(const std::vector<e::slice>& attrs,
                          uint64_t version,
                          std::vector<char>* backing,
                          leveldb::Slice* out)
+{
+    encode_value_chunked(attrs, version, 0, backing, out);
+}
+
+void
+hyperdex :: encode_value_chunked(const std::vector<e::slice>& attrs,
+                                 uint64_t version,
+                                 uint64_t chunk_threshold,
+                                 std::vector<char>* backing,
+                                 leveldb::Slice* out)
+{
+    encode_value_stored(attrs, version, chunk_threshold, NULL, NULL, backing, out);
+}
+
+void
+hyperdex :: encode_value_stored(const std::vector<e::slice>& attrs,
+                                uint64_t version,
+                                uint64_t chunk_threshold,
+                                const std::vector<value_log::pointer>* logged,
+                                const std::vector<value_compressor::packed>* compressed,
+                                std::vector<char>* backing,
+                                leveldb::Slice* out)
 {
     assert(attrs.size() < 65536);
+    assert(!logged || logged->size() == attrs.size());
+    assert(!compressed || compressed->size() == attrs.size());
     size_t sz = sizeof(uint64_t) + sizeof(uint16_t);
 
     for (size_t i = 0; i < attrs.size(); ++i)
     {
-        sz += sizeof(uint32_t) + attrs[i].size();
+        if (logged && (*logged)[i].size > 0)
+        {
+            sz += sizeof(uint32_t) + LOGGED_ATTR_SIZE;
+        }
+        else if (compressed && (*compressed)[i].size > 0)
+        {
+            sz += sizeof(uint32_t) + COMPRESSED_ATTR_HEADER + (*compressed)[i].bytes.size();
+        }
+        else if (chunk_threshold > 0 && attrs[i].size() >= chunk_threshold)
+        {
+            sz += sizeof(uint32_t) + sizeof(uint64_t);
+        }
+        else
+        {
+            sz += sizeof(uint32_t) + attrs[i].size();
+        }
     }
 
     backing->resize(sz);
@@ -157,6 +210,35 @@ hyperdex :: encode_value(const std::vector<e::slice>& attrs,
 
     for (size_t i = 0; i < attrs.size(); ++i)
     {
+        if (logged && (*logged)[i].size > 0)
+        {
+            ptr = e::pack32be(CHUNKED_ATTR | LOGGED_ATTR_SIZE, ptr);
+            ptr = e::pack64be((*logged)[i].size, ptr);
+            ptr = e::pack64be((*logged)[i].segment, ptr);
+            ptr = e::pack64be((*logged)[i].offset, ptr);
+            continue;
+        }
+
+        if (compressed && (*compressed)[i].size > 0)
+        {
+            const value_compressor::packed& p((*compressed)[i]);
+            assert(COMPRESSED_ATTR_HEADER + p.bytes.size() < COMPRESSED_ATTR);
+            ptr = e::pack32be(COMPRESSED_ATTR | (COMPRESSED_ATTR_HEADER + p.bytes.size()), ptr);
+            ptr = e::pack32be(p.dictionary, ptr);
+            ptr = e::pack32be(p.size, ptr);
+            memmove(ptr, p.bytes.data(), p.bytes.size());
+            ptr += p.bytes.size();
+            continue;
+        }
+
+        if (chunk_threshold > 0 && attrs[i].size() >= chunk_threshold)
+        {
+            ptr = e::pack32be(CHUNKED_ATTR | sizeof(uint64_t), ptr);
+            ptr = e::pack64be(attrs[i].size(), ptr);
+            continue;
+        }
+
+        assert(attrs[i].size() < COMPRESSED_ATTR);
         ptr = e::pack32be(attrs[i].size(), ptr);
         memmove(ptr, attrs[i].data(), attrs[i].size());
         ptr += attrs[i].size();
@@ -208,6 +290,12 @@ hyperdex :: decode_value(const e::slice& in,
             return datalayer::BAD_ENCODING;
         }
 
+        // the caller should have gone through decode_value_stored
+        if ((sz & (CHUNKED_ATTR | COMPRESSED_ATTR)))
+        {
+            return datalayer::BAD_ENCODING;
+        }
+
         e::slice s(reinterpret_cast<const uint8_t*>(ptr), sz);
         ptr += sz;
         attrs->push_back(s);
@@ -216,6 +304,341 @@ hyperdex :: decode_value(const e::slice& in,
     return datalayer::SUCCESS;
 }
 
+datalayer::returncode
+hyperdex :: decode_value_chunked(const e::slice& in,
+                                 std::vector<e::slice>* attrs,
+                                 std::vector<uint64_t>* chunked,
+                                 uint64_t* version)
+{
+    std::vector<value_log::pointer> logged;
+    std::vector<value_compressor::packed> compressed;
+    return decode_value_stored(in, attrs, chunked, &logged, &compressed, version);
+}
+
+datalayer::returncode
+hyperdex :: decode_value_stored(const e::slice& in,
+                                std::vector<e::slice>* attrs,
+                                std::vector<uint64_t>* chunked,
+                                std::vector<value_log::pointer>* logged,
+                                std::vector<value_compressor::packed>* compressed,
+                                uint64_t* version)
+{
+    const uint8_t* ptr = in.data();
+    const uint8_t* end = ptr + in.size();
+    uint16_t num_attrs;
+
+    if (ptr + sizeof(uint64_t) + sizeof(uint16_t) <= end)
+    {
+        ptr = e::unpack64be(ptr, version);
+        ptr = e::unpack16be(ptr, &num_attrs);
+    }
+    else
+    {
+        return datalayer::BAD_ENCODING;
+    }
+
+    attrs->clear();
+    chunked->clear();
+    logged->clear();
+    compressed->clear();
+
+    for (size_t i = 0; i < num_attrs; ++i)
+    {
+        uint32_t sz = 0;
+
+        if (ptr + sizeof(uint32_t) <= end)
+        {
+            ptr = e::unpack32be(ptr, &sz);
+        }
+        else
+        {
+            return datalayer::BAD_ENCODING;
+        }
+
+        if ((sz & COMPRESSED_ATTR))
+        {
+            sz &= ~COMPRESSED_ATTR;
+
+            if (sz < COMPRESSED_ATTR_HEADER || ptr + sz > end)
+            {
+                return datalayer::BAD_ENCODING;
+            }
+
+            compressed->resize(num_attrs);
+            value_compressor::packed& p((*compressed)[i]);
+            ptr = e::unpack32be(ptr, &p.dictionary);
+            ptr = e::unpack32be(ptr, &p.size);
+            p.bytes = e::slice(ptr, sz - COMPRESSED_ATTR_HEADER);
+            ptr += sz - COMPRESSED_ATTR_HEADER;
+            attrs->push_back(e::slice());
+
+            if (p.size == 0)
+            {
+                return datalayer::BAD_ENCODING;
+            }
+
+            continue;
+        }
+
+        if (!(sz & CHUNKED_ATTR))
+        {
+            if (ptr + sz > end)
+            {
+                return datalayer::BAD_ENCODING;
+            }
+
+            attrs->push_back(e::slice(ptr, sz));
+            ptr += sz;
+            continue;
+        }
+
+        uint64_t full = 0;
+        sz &= ~CHUNKED_ATTR;
+
+        if ((sz != sizeof(uint64_t) && sz != LOGGED_ATTR_SIZE) ||
+            ptr + sz > end)
+        {
+            return datalayer::BAD_ENCODING;
+        }
+
+        ptr = e::unpack64be(ptr, &full);
+        attrs->push_back(e::slice());
+
+        if (sz == LOGGED_ATTR_SIZE)
+        {
+            logged->resize(num_attrs);
+            (*logged)[i].size = full;
+            ptr = e::unpack64be(ptr, &(*logged)[i].segment);
+            ptr = e::unpack64be(ptr, &(*logged)[i].offset);
+            continue;
+        }
+
+        chunked->resize(num_attrs, 0);
+        (*chunked)[i] = full;
+    }
+
+    return datalayer::SUCCESS;
+}
+
+void
+hyperdex :: encode_chunk_key(const region_id& ri,
+                             const e::slice& key,
+                             uint16_t attr,
+                             uint32_t chunk,
+                             uint64_t version,
+                             std::vector<char>* scratch,
+                             leveldb::Slice* out)
+{
+    size_t sz = sizeof(uint8_t)
+              + e::varint_length(ri.get())
+              + e::varint_length(key.size())
+              + key.size()
+              + sizeof(uint16_t)
+              + sizeof(uint32_t)
+              + CHUNK_KEY_VERSION_SIZE;
+
+    if (scratch->size() < sz)
+    {
+        scratch->resize(sz);
+    }
+
+    char* ptr = &scratch->front();
+    *out = leveldb::Slice(ptr, sz);
+    // region first so the wiper can drop a region's chunks by prefix
+    ptr = e::pack8be('k', ptr);
+    ptr = e::packvarint64(ri.get(), ptr);
+    ptr = e::packvarint64(key.size(), ptr);
+    memmove(ptr, key.data(), key.size());
+    ptr += key.size();
+    ptr = e::pack16be(attr, ptr);
+    ptr = e::pack32be(chunk, ptr);
+    ptr = e::pack64be(UINT64_MAX - version, ptr);
+}
+
+datalayer::returncode
+hyperdex :: decode_value_projection(const e::slice& in,
+                                    const std::vector<uint16_t>& project,
+                                    std::vector<e::slice>* attrs,
+                                    uint64_t* version)
+{
+    const uint8_t* ptr = in.data();
+    const uint8_t* end = ptr + in.size();
+    uint16_t num_attrs;
+
+    if (ptr + sizeof(uint64_t) + sizeof(uint16_t) <= end)
+    {
+        ptr = e::unpack64be(ptr, version);
+        ptr = e::unpack16be(ptr, &num_attrs);
+    }
+    else
+    {
+        return datalayer::BAD_ENCODING;
+    }
+
+    attrs->clear();
+    attrs->resize(num_attrs);
+    std::vector<uint16_t>::const_iterator want = project.begin();
+
+    for (size_t i = 0; i < num_attrs && want != project.end(); ++i)
+    {
+        uint32_t sz = 0;
+
+        if (ptr + sizeof(uint32_t) <= end)
+        {
+            ptr = e::unpack32be(ptr, &sz);
+        }
+        else
+        {
+            return datalayer::BAD_ENCODING;
+        }
+
+        if ((sz & (CHUNKED_ATTR | COMPRESSED_ATTR)) || ptr + sz > end)
+        {
+            return datalayer::BAD_ENCODING;
+        }
+
+        while (want != project.end() && *want < i + 1)
+        {
+            ++want;
+        }
+
+        if (want != project.end() && *want == i + 1)
+        {
+            (*attrs)[i] = e::slice(ptr, sz);
+            ++want;
+        }
+
+        ptr += sz;
+    }
+
+    return datalayer::SUCCESS;
+}
+
+size_t
+hyperdex :: key_size_suffix_length(uint64_t key_sz)
+{
+    size_t sz = 1;
+
+    while (key_sz >= 128)
+    {
+        key_sz >>= 7;
+        ++sz;
+    }
+
+    return sz;
+}
+
+char*
+hyperdex :: encode_key_size_suffix(uint64_t key_sz, char* ptr)
+{
+    const size_t sz = key_size_suffix_length(key_sz);
+
+    // the low bits go last; every byte but the first says one precedes it
+    for (size_t i = sz; i > 0; --i)
+    {
+        uint8_t b = key_sz & 0x7f;
+        key_sz >>= 7;
+
+        if (i > 1)
+        {
+            b |= 0x80;
+        }
+
+        ptr[i - 1] = static_cast<char>(b);
+    }
+
+    return ptr + sz;
+}
+
+bool
+hyperdex :: decode_key_size_suffix(const char* start, const char* end,
+                                   uint64_t* key_sz, size_t* suffix_sz)
+{
+    *key_sz = 0;
+    *suffix_sz = 0;
+    unsigned shift = 0;
+
+    while (end > start && shift < 64)
+    {
+        --end;
+        uint8_t b = static_cast<uint8_t>(*end);
+        *key_sz |= static_cast<uint64_t>(b & 0x7f) << shift;
+        shift += 7;
+        ++*suffix_sz;
+
+        if (!(b & 0x80))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void
+hyperdex :: encode_covering(const index& idx,
+                            const std::vector<e::slice>& attrs,
+                            std::vector<char>* backing,
+                            e::slice* out)
+{
+    size_t sz = 0;
+
+    for (size_t i = 0; i < idx.included_sz(); ++i)
+    {
+        assert(idx.included(i) > 0 && idx.included(i) <= attrs.size());
+        sz += sizeof(uint16_t) + sizeof(uint32_t) + attrs[idx.included(i) - 1].size();
+    }
+
+    backing->resize(sz);
+    char* ptr = sz > 0 ? &backing->front() : NULL;
+
+    for (size_t i = 0; i < idx.included_sz(); ++i)
+    {
+        const e::slice& attr(attrs[idx.included(i) - 1]);
+        ptr = e::pack16be(idx.included(i), ptr);
+        ptr = e::pack32be(attr.size(), ptr);
+        memmove(ptr, attr.data(), attr.size());
+        ptr += attr.size();
+    }
+
+    *out = sz > 0 ? e::slice(&backing->front(), sz) : e::slice();
+}
+
+bool
+hyperdex :: decode_covering(const e::slice& in,
+                            std::vector<e::slice>* attrs,
+                            std::vector<uint16_t>* covered)
+{
+    const uint8_t* ptr = in.data();
+    const uint8_t* end = ptr + in.size();
+    covered->clear();
+
+    while (ptr < end)
+    {
+        uint16_t attr;
+        uint32_t sz;
+
+        if (ptr + sizeof(uint16_t) + sizeof(uint32_t) > end)
+        {
+            return false;
+        }
+
+        ptr = e::unpack16be(ptr, &attr);
+        ptr = e::unpack32be(ptr, &sz);
+
+        if (attr == 0 || attr > attrs->size() || ptr + sz > end)
+        {
+            return false;
+        }
+
+        (*attrs)[attr - 1] = e::slice(ptr, sz);
+        covered->push_back(attr);
+        ptr += sz;
+    }
+
+    return true;
+}
+
 void
 hyperdex :: encode_version(const region_id& ri, /*region we wrote*/
                            uint64_t version,
@@ -248,6 +671,43 @@ hyperdex :: decode_version(const e::slice& in,
     return _p == 'v' ? datalayer::SUCCESS : datalayer::BAD_ENCODING;
 }
 
+char*
+hyperdex :: encode_count(const region_id& ri,
+                         uint64_t id,
+                         char* out)
+{
+    char* ptr = out;
+    ptr = e::pack8be('n', ptr);
+    ptr = e::packvarint64(ri.get(), ptr);
+    ptr = e::pack64be(id, ptr);
+    return ptr;
+}
+
+bool
+hyperdex :: decode_count(const leveldb::Slice& in,
+                         region_id* ri,
+                         uint64_t* id)
+{
+    if (in.size() < 2 || in.data()[0] != 'n')
+    {
+        return false;
+    }
+
+    uint64_t r;
+    const char* const end = in.data() + in.size();
+    const char* ptr = in.data() + sizeof(uint8_t);
+    ptr = e::varint64_decode(ptr, end, &r);
+
+    if (!ptr || end - ptr != sizeof(uint64_t))
+    {
+        return false;
+    }
+
+    e::unpack64be(ptr, id);
+    *ri = region_id(r);
+    return true;
+}
+
 void
 hyperdex :: encode_checkpoint(const region_id& ri,
                               uint64_t checkpoint,
@@ -279,6 +739,26 @@ hyperdex :: decode_checkpoint(const e::slice& in,
     return t == 'c' ? datalayer::SUCCESS : datalayer::BAD_ENCODING;
 }
 
+void
+hyperdex :: encode_dictionary(uint32_t id, char* out)
+{
+    char* ptr = out;
+    ptr = e::pack8be('d', ptr);
+    ptr = e::pack32be(id, ptr);
+}
+
+bool
+hyperdex :: decode_dictionary(const leveldb::Slice& in, uint32_t* id)
+{
+    if (in.size() != DICTIONARY_BUF_SIZE || in[0] != 'd')
+    {
+        return false;
+    }
+
+    e::unpack32be(in.data() + sizeof(uint8_t), id);
+    return true;
+}
+
 void
 hyperdex :: create_index_changes(const schema& sc,
                                  const region_id& ri,
@@ -299,20 +779,98 @@ hyperdex :: create_index_changes(const schema& sc,
 
         assert(idx->attr > 0);
         assert(idx->attr < sc.attrs_sz);
+        const std::vector<e::slice>* idx_old_value = old_value;
+        const std::vector<e::slice>* idx_new_value = new_value;
+
+        // a partial index treats objects outside its filter as absent, so an
+        // object moving in or out of it gains or loses its entries
+        if (idx->partial())
+        {
+            std::vector<attribute_check> filter;
+
+            if (!unpack_index_filter(idx->filter, &filter))
+            {
+                continue;
+            }
+
+            if (old_value &&
+                passes_attribute_checks(sc, filter, key, *old_value) < filter.size())
+            {
+                idx_old_value = NULL;
+            }
+
+            if (new_value &&
+                passes_attribute_checks(sc, filter, key, *new_value) < filter.size())
+            {
+                idx_new_value = NULL;
+            }
+        }
 
-        const index_info* ai = index_info::lookup(sc.attrs[idx->attr].type);
+        if (idx->type == index::COMPOSITE)
+        {
+            composite_index_changes(sc, *idx, ri, key_ie, key,
+                                    idx_old_value, idx_new_value, updates);
+            continue;
+        }
+
+        if (idx->type == index::SPATIAL)
+        {
+            spatial_index_changes(sc, *idx, ri, key_ie, key,
+                                  idx_old_value, idx_new_value, updates);
+            continue;
+        }
+
+        const index_info* ai = index_info::lookup(*idx, sc.attrs[idx->attr].type);
         assert(ai);
 
         const e::slice* old_attr = NULL;
         const e::slice* new_attr = NULL;
-        old_attr = old_value ? &(*old_value)[idx->attr - 1] : NULL;
-        new_attr = new_value ? &(*new_value)[idx->attr - 1] : NULL;
+        old_attr = idx_old_value ? &(*idx_old_value)[idx->attr - 1] : NULL;
+        new_attr = idx_new_value ? &(*idx_new_value)[idx->attr - 1] : NULL;
 
         if (!old_attr && !new_attr)
         {
             continue;
         }
 
+        // most writes touch only a few attributes; the entries of any other
+        // attribute stay exactly as they are, so don't bother deriving them
+        if (old_attr && new_attr && *old_attr == *new_attr &&
+            idx->included_sz() == 0)
+        {
+            continue;
+        }
+
+        if (idx->included_sz() > 0)
+        {
+            e::slice old_payload;
+            e::slice new_payload;
+            std::vector<char> old_scratch;
+            std::vector<char> new_scratch;
+
+            if (idx_old_value)
+            {
+                encode_covering(*idx, *idx_old_value, &old_scratch, &old_payload);
+            }
+
+            if (idx_new_value)
+            {
+                encode_covering(*idx, *idx_new_value, &new_scratch, &new_payload);
+            }
+
+            if (old_attr && new_attr && *old_attr == *new_attr &&
+                old_payload == new_payload)
+            {
+                continue;
+            }
+
+            if (ai->covering_changes(idx, ri, key_ie, key, old_attr, new_attr,
+                                     new_payload, updates))
+            {
+                continue;
+            }
+        }
+
         ai->index_changes(idx, ri, key_ie, key, old_attr, new_attr, updates);
     }
 }
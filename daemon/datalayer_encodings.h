@@ -31,10 +31,15 @@
 // LevelDB
 #include <hyperleveldb/slice.h>
 
+// e
+#include <e/varint.h>
+
 // HyperDex
 #include "namespace.h"
 #include "common/ids.h"
 #include "daemon/datalayer.h"
+#include "daemon/value_compressor.h"
+#include "daemon/value_log.h"
 
 BEGIN_HYPERDEX_NAMESPACE
 
@@ -76,6 +81,99 @@ datalayer::returncode
 decode_value(const e::slice& in,
              std::vector<e::slice>* attrs,
              uint64_t* version);
+// decode only the attributes whose numbers appear in the sorted "project";
+// every other entry of "attrs" is an empty slice
+datalayer::returncode
+decode_value_projection(const e::slice& in,
+                        const std::vector<uint16_t>& project,
+                        std::vector<e::slice>* attrs,
+                        uint64_t* version);
+// Like encode_value, but attributes of at least "chunk_threshold" bytes are
+// replaced by their size; the caller stores them under encode_chunk_key.
+void
+encode_value_chunked(const std::vector<e::slice>& attrs,
+                     uint64_t version,
+                     uint64_t chunk_threshold,
+                     std::vector<char>* backing,
+                     leveldb::Slice* out);
+// Like encode_value_chunked, but the attributes with a non-zero size in
+// "logged" (which may be NULL) are replaced by where the value log has them,
+// and the rest with a non-zero size in "compressed" (which may also be NULL)
+// by their compressed form.
+void
+encode_value_stored(const std::vector<e::slice>& attrs,
+                    uint64_t version,
+                    uint64_t chunk_threshold,
+                    const std::vector<value_log::pointer>* logged,
+                    const std::vector<value_compressor::packed>* compressed,
+                    std::vector<char>* backing,
+                    leveldb::Slice* out);
+// Like decode_value, but accept attributes kept in chunks, leaving them empty
+// and putting their size in "chunked" (zero for inline attributes).
+// "chunked" is left empty when no attribute is in chunks.  Attributes in
+// the value log or compressed are left empty too, and count as neither.
+datalayer::returncode
+decode_value_chunked(const e::slice& in,
+                     std::vector<e::slice>* attrs,
+                     std::vector<uint64_t>* chunked,
+                     uint64_t* version);
+// Like decode_value_chunked, but also put where the value log has each
+// attribute in "logged", which is left empty when no attribute is there, and
+// the compressed form of each compressed attribute in "compressed", which is
+// likewise left empty when none is compressed.
+datalayer::returncode
+decode_value_stored(const e::slice& in,
+                    std::vector<e::slice>* attrs,
+                    std::vector<uint64_t>* chunked,
+                    std::vector<value_log::pointer>* logged,
+                    std::vector<value_compressor::packed>* compressed,
+                    uint64_t* version);
+// The key of one piece of a chunked attribute, as written by the object of
+// the given version.  Versions sort newest first, so a seek to the key for
+// version v lands on the piece an object of version v reads; the first
+// CHUNK_KEY_VERSION_SIZE bytes from the end are what tell the pieces apart.
+#define CHUNK_KEY_VERSION_SIZE sizeof(uint64_t)
+void
+encode_chunk_key(const region_id& ri,
+                 const e::slice& key,
+                 uint16_t attr,
+                 uint32_t chunk,
+                 uint64_t version,
+                 std::vector<char>* scratch,
+                 leveldb::Slice* out);
+
+// An index entry with both a value and a key of variable size ends with the
+// key's size, written so that it reads back from the end of the entry:  the
+// last byte holds the low seven bits, and its high bit says whether another
+// byte before it holds the next seven.  Keys under 128 bytes take one byte.
+size_t
+key_size_suffix_length(uint64_t key_sz);
+char*
+encode_key_size_suffix(uint64_t key_sz, char* ptr);
+// read the suffix ending at "end", which may extend back no further than
+// "start"; false if it is malformed
+bool
+decode_key_size_suffix(const char* start, const char* end,
+                       uint64_t* key_sz, size_t* suffix_sz);
+// the value of the marker of an index whose entries end that way; the markers
+// of indices built by older versions are empty, and their entries end with
+// the key's size as a 32-bit integer
+#define INDEX_FORMAT_COMPACT "\x01"
+#define INDEX_FORMAT_COMPACT_SIZE 1
+
+// the value stored with each entry of an index that includes attributes:
+// the number and length-prefixed value of every included attribute
+void
+encode_covering(const index& idx,
+                const std::vector<e::slice>& attrs,
+                std::vector<char>* backing,
+                e::slice* out);
+// fill in the attributes stored in "in"; "attrs" must already hold one slice
+// per non-key attribute, and the numbers of those filled go in "covered"
+bool
+decode_covering(const e::slice& in,
+                std::vector<e::slice>* attrs,
+                std::vector<uint16_t>* covered);
 
 // Encode the record of an operation for which we have sent an ACK
 #define VERSION_BUF_SIZE (sizeof(uint8_t) + 2 * sizeof(uint64_t))
@@ -88,6 +186,19 @@ decode_version(const e::slice& in,
                region_id* ri, /*region we saw an ack for*/
                uint64_t* version);
 
+// object counts:  each region has a base count under id 0 and a signed delta
+// under a fresh id for every insert or delete since the deltas were last
+// folded into the base
+#define COUNT_BUF_SIZE (sizeof(uint8_t) + VARINT_64_MAX_SIZE + sizeof(uint64_t))
+char*
+encode_count(const region_id& ri,
+             uint64_t id,
+             char* out);
+bool
+decode_count(const leveldb::Slice& in,
+             region_id* ri,
+             uint64_t* id);
+
 // checkpoints
 #define CHECKPOINT_BUF_SIZE (sizeof(uint8_t) + 2 * sizeof(uint64_t))
 void
@@ -99,6 +210,14 @@ decode_checkpoint(const e::slice& in,
                   region_id* ri,
                   uint64_t* checkpoint);
 
+// compression dictionaries, by number; the value is the space the
+// dictionary was trained for, then the dictionary itself
+#define DICTIONARY_BUF_SIZE (sizeof(uint8_t) + sizeof(uint32_t))
+void
+encode_dictionary(uint32_t id, char* out);
+bool
+decode_dictionary(const leveldb::Slice& in, uint32_t* id);
+
 void
 create_index_changes(const schema& sc,
                      const region_id& ri,
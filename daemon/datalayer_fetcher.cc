@@ -0,0 +1,225 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <cassert>
+
+// POSIX
+#include <signal.h>
+
+// Google Log
+#include <glog/logging.h>
+
+// HyperDex
+#include "daemon/datalayer_fetcher.h"
+
+using po6::threads::make_obj_func;
+using hyperdex::datalayer;
+
+class datalayer::fetcher::batch
+{
+    public:
+        batch(const region_id& r, hyperdatatype kt,
+              const leveldb::Snapshot* s, std::vector<item>* i)
+            : ri(r), key_type(kt), snap(s), items(i), claimed(0), finished(0) {}
+        ~batch() throw () {}
+
+    public:
+        const region_id ri;
+        const hyperdatatype key_type;
+        const leveldb::Snapshot* const snap;
+        std::vector<item>* const items;
+        size_t claimed;
+        size_t finished;
+
+    private:
+        batch(const batch&);
+        batch& operator = (const batch&);
+};
+
+datalayer :: fetcher :: fetcher(datalayer* dl)
+    : m_dl(dl)
+    , m_threads()
+    , m_protect()
+    , m_work(&m_protect)
+    , m_done(&m_protect)
+    , m_queue()
+    , m_shutdown(false)
+{
+}
+
+datalayer :: fetcher :: ~fetcher() throw ()
+{
+    shutdown();
+}
+
+void
+datalayer :: fetcher :: start(unsigned threads)
+{
+    po6::threads::mutex::hold hold(&m_protect);
+    m_shutdown = false;
+
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        e::compat::shared_ptr<po6::threads::thread> t(
+                new po6::threads::thread(make_obj_func(&fetcher::run, this)));
+        t->start();
+        m_threads.push_back(t);
+    }
+}
+
+void
+datalayer :: fetcher :: shutdown()
+{
+    std::vector<e::compat::shared_ptr<po6::threads::thread> > threads;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect);
+        m_shutdown = true;
+        m_work.broadcast();
+        threads.swap(m_threads);
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        threads[i]->join();
+    }
+}
+
+void
+datalayer :: fetcher :: fetch(const region_id& ri,
+                              hyperdatatype key_type,
+                              const leveldb::Snapshot* snap,
+                              std::vector<item>* items)
+{
+    batch b(ri, key_type, snap, items);
+    m_protect.lock();
+
+    if (m_threads.empty() || items->size() < 2)
+    {
+        m_protect.unlock();
+
+        for (size_t i = 0; i < items->size(); ++i)
+        {
+            read(&b, &(*items)[i]);
+        }
+
+        return;
+    }
+
+    m_queue.push_back(&b);
+    m_work.broadcast();
+
+    // rather than sit idle, read alongside the fetch threads
+    while (b.claimed < items->size())
+    {
+        item* it = claim(&b);
+        m_protect.unlock();
+        read(&b, it);
+        m_protect.lock();
+        ++b.finished;
+    }
+
+    while (b.finished < items->size())
+    {
+        m_done.wait();
+    }
+
+    m_protect.unlock();
+}
+
+void
+datalayer :: fetcher :: run()
+{
+    sigset_t ss;
+
+    // leave SIGPROF so that a profile sees this thread too
+    if (sigfillset(&ss) < 0 ||
+        sigdelset(&ss, SIGPROF) < 0 ||
+        pthread_sigmask(SIG_BLOCK, &ss, NULL) < 0)
+    {
+        PLOG(ERROR) << "could not block signals";
+        LOG(ERROR) << "could not successfully block signals; this could result in undefined behavior";
+    }
+
+    m_protect.lock();
+
+    while (true)
+    {
+        while (m_queue.empty() && !m_shutdown)
+        {
+            m_work.wait();
+        }
+
+        if (m_shutdown)
+        {
+            break;
+        }
+
+        batch* b = m_queue.front();
+        item* it = claim(b);
+        m_protect.unlock();
+        read(b, it);
+        m_protect.lock();
+        ++b->finished;
+
+        if (b->finished == b->items->size())
+        {
+            m_done.broadcast();
+        }
+    }
+
+    m_protect.unlock();
+}
+
+datalayer::fetcher::item*
+datalayer :: fetcher :: claim(batch* b)
+{
+    assert(b->claimed < b->items->size());
+    item* it = &(*b->items)[b->claimed];
+    ++b->claimed;
+
+    // once every item is taken, no one else need look at the batch
+    if (b->claimed == b->items->size())
+    {
+        m_queue.remove(b);
+    }
+
+    return it;
+}
+
+void
+datalayer :: fetcher :: read(batch* b, item* it)
+{
+    if (!it->wanted)
+    {
+        return;
+    }
+
+    it->rc = m_dl->read_object(b->ri, b->key_type, e::slice(it->key), b->snap, &it->object);
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_datalayer_fetcher_h_
+#define hyperdex_daemon_datalayer_fetcher_h_
+
+// STL
+#include <list>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/threads/cond.h>
+#include <po6/threads/mutex.h>
+#include <po6/threads/thread.h>
+
+// e
+#include <e/compat.h>
+
+// HyperDex
+#include "daemon/datalayer.h"
+
+// Reads several objects at once for a search, so that an index search keeps
+// more than one random read outstanding.  The searching thread hands over a
+// batch and works on it alongside the fetch threads until every object in it
+// has been read; with no threads, it reads the batch alone, in order.
+class hyperdex::datalayer::fetcher
+{
+    public:
+        // one object to read; the results are valid once fetch returns
+        class item
+        {
+            public:
+                item() : key(), wanted(true), object(), rc(SUCCESS) {}
+                ~item() throw () {}
+
+            public:
+                std::string key;
+                // false for entries the caller already has, which are skipped
+                bool wanted;
+                // the stored object, with chunks and logged attributes inline
+                std::string object;
+                returncode rc;
+        };
+
+    public:
+        fetcher(datalayer* dl);
+        ~fetcher() throw ();
+
+    public:
+        void start(unsigned threads);
+        void shutdown();
+        // read items of region ri, whose keys are of type key_type, as of snap
+        void fetch(const region_id& ri,
+                   hyperdatatype key_type,
+                   const leveldb::Snapshot* snap,
+                   std::vector<item>* items);
+
+    private:
+        class batch;
+
+    private:
+        void run();
+        // take the next unread item of b; call with m_protect held
+        item* claim(batch* b);
+        void read(batch* b, item* it);
+
+    private:
+        datalayer* m_dl;
+        std::vector<e::compat::shared_ptr<po6::threads::thread> > m_threads;
+        po6::threads::mutex m_protect;
+        po6::threads::cond m_work;
+        po6::threads::cond m_done;
+        // batches with items no thread has taken yet
+        std::list<batch*> m_queue;
+        bool m_shutdown;
+
+    private:
+        fetcher(const fetcher&);
+        fetcher& operator = (const fetcher&);
+};
+
+#endif // hyperdex_daemon_datalayer_fetcher_h_
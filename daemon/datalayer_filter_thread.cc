@@ -0,0 +1,167 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// Google Log
+#include <glog/logging.h>
+
+// po6
+#include <po6/time.h>
+
+// e
+#include <e/intrusive_ptr.h>
+
+// HyperDex
+#include "daemon/datalayer_filter_thread.h"
+#include "daemon/datalayer_iterator.h"
+
+// entries added between checks for shutdown
+#define FILTER_CHECK_INTERVAL 4096
+
+using hyperdex::datalayer;
+
+datalayer :: filter_thread :: filter_thread(daemon* d)
+    : background_thread(d)
+    , m_pending()
+    , m_building()
+{
+}
+
+datalayer :: filter_thread :: ~filter_thread() throw ()
+{
+}
+
+const char*
+datalayer :: filter_thread :: thread_name()
+{
+    return "index filter";
+}
+
+bool
+datalayer :: filter_thread :: have_work()
+{
+    return !m_pending.empty();
+}
+
+void
+datalayer :: filter_thread :: copy_work()
+{
+    m_building.swap(m_pending);
+    m_pending.clear();
+}
+
+void
+datalayer :: filter_thread :: do_work()
+{
+    // a build reads only its own snapshot, so it need not hold up a
+    // reconfiguration
+    this->offline();
+
+    for (size_t i = 0; i < m_building.size() && !interrupted(); ++i)
+    {
+        const job& j(m_building[i]);
+        const uint64_t start = po6::monotonic_time();
+        range_index_iterator* rit = j.info->iterator_for_values(j.snap, j.ri, j.ii, j.key_ie);
+
+        if (!rit)
+        {
+            continue;
+        }
+
+        e::intrusive_ptr<index_iterator> it(rit);
+        uint64_t entries = 0;
+
+        for (; rit->valid(); rit->next())
+        {
+            j.filter->add(rit->value());
+
+            if (++entries % FILTER_CHECK_INTERVAL == 0 && interrupted())
+            {
+                break;
+            }
+        }
+
+        // a filter missing any value could rule out values that exist
+        if (rit->valid())
+        {
+            break;
+        }
+
+        if (!rit->status().ok())
+        {
+            LOG(ERROR) << "could not fill the filter for index " << j.ii << " of " << j.ri
+                       << ": " << rit->status().ToString();
+            continue;
+        }
+
+        j.filter->set_ready();
+        LOG(INFO) << "filled the filter for index " << j.ii << " of " << j.ri
+                  << " with " << entries << " entries ("
+                  << j.filter->bytes() << " bytes) in "
+                  << (po6::monotonic_time() - start) / 1000000ULL << "ms";
+    }
+
+    m_building.clear();
+    this->online();
+}
+
+void
+datalayer :: filter_thread :: debug_dump()
+{
+    this->lock();
+    LOG(INFO) << "index filter thread ===========================================================";
+    LOG(INFO) << "pending=" << m_pending.size();
+    this->unlock();
+}
+
+void
+datalayer :: filter_thread :: build(const region_id& ri, const index_id& ii,
+                                    const index_info* info, const index_encoding* key_ie,
+                                    leveldb_snapshot_ptr snap,
+                                    e::compat::shared_ptr<index_filter> f)
+{
+    job j;
+    j.ri = ri;
+    j.ii = ii;
+    j.info = info;
+    j.key_ie = key_ie;
+    j.snap = snap;
+    j.filter = f;
+    this->lock();
+    m_pending.push_back(j);
+    this->wakeup();
+    this->unlock();
+}
+
+bool
+datalayer :: filter_thread :: interrupted()
+{
+    this->lock();
+    bool ret = this->is_shutdown();
+    this->unlock();
+    return ret;
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_datalayer_filter_thread_h_
+#define hyperdex_daemon_datalayer_filter_thread_h_
+
+// STL
+#include <vector>
+
+// e
+#include <e/compat.h>
+
+// HyperDex
+#include "daemon/background_thread.h"
+#include "daemon/datalayer.h"
+#include "daemon/index_filter.h"
+#include "daemon/index_info.h"
+
+// Fills the index filters a reconfiguration creates.  Each starts out empty
+// beside a snapshot taken while no write was in flight; every write since
+// adds its own values, so once this thread has added every value the index
+// held in that snapshot, the filter is complete and may be trusted.
+class hyperdex::datalayer::filter_thread : public hyperdex::background_thread
+{
+    public:
+        filter_thread(daemon* d);
+        ~filter_thread() throw ();
+
+    public:
+        virtual const char* thread_name();
+        virtual bool have_work();
+        virtual void copy_work();
+        virtual void do_work();
+
+    public:
+        void debug_dump();
+        // add to f the value of every entry of ii in ri as of snap, then mark
+        // it ready
+        void build(const region_id& ri, const index_id& ii,
+                   const index_info* info, const index_encoding* key_ie,
+                   leveldb_snapshot_ptr snap,
+                   e::compat::shared_ptr<index_filter> f);
+
+    private:
+        struct job
+        {
+            job() : ri(), ii(), info(NULL), key_ie(NULL), snap(), filter() {}
+            ~job() throw () {}
+            region_id ri;
+            index_id ii;
+            const index_info* info;
+            const index_encoding* key_ie;
+            leveldb_snapshot_ptr snap;
+            e::compat::shared_ptr<index_filter> filter;
+        };
+
+    private:
+        bool interrupted();
+
+    private:
+        // under lock
+        std::vector<job> m_pending;
+        // do_work; no lock
+        std::vector<job> m_building;
+
+    private:
+        filter_thread(const filter_thread&);
+        filter_thread& operator = (const filter_thread&);
+};
+
+#endif // hyperdex_daemon_datalayer_filter_thread_h_
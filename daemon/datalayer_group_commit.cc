@@ -0,0 +1,233 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#define __STDC_LIMIT_MACROS
+
+// C
+#include <cassert>
+
+// STL
+#include <algorithm>
+#include <iterator>
+
+// po6
+#include <po6/time.h>
+
+// HyperDex
+#include "daemon/datalayer_group_commit.h"
+#include "daemon/thread_stripe.h"
+
+using hyperdex::datalayer;
+
+// the most a leader will put into a single LevelDB write
+#define GROUP_COMMIT_MAX_BYTES (1ULL << 20)
+// LevelDB slows writes down by a millisecond at a time when level 0 fills
+#define WRITE_STALL_NANOS 1000000ULL
+
+struct datalayer::group_commit::writer
+{
+    writer(leveldb::WriteBatch* u, bool s) : updates(u), sync(s), bytes(0), done(false), st() {}
+    leveldb::WriteBatch* updates;
+    bool sync;
+    size_t bytes;
+    bool done;
+    leveldb::Status st;
+};
+
+// WriteBatch has no public way to append one batch to another, so replay
+// each follower's batch into the leader's; with no target it only counts
+class datalayer::group_commit::appender : public leveldb::WriteBatch::Handler
+{
+    public:
+        appender(leveldb::WriteBatch* target) : m_target(target), m_bytes(0) {}
+        virtual ~appender() {}
+
+    public:
+        virtual void Put(const leveldb::Slice& key, const leveldb::Slice& value)
+        { if (m_target) m_target->Put(key, value); m_bytes += key.size() + value.size(); }
+        virtual void Delete(const leveldb::Slice& key)
+        { if (m_target) m_target->Delete(key); m_bytes += key.size(); }
+        size_t bytes() const { return m_bytes; }
+
+    private:
+        leveldb::WriteBatch* m_target;
+        size_t m_bytes;
+
+    private:
+        appender(const appender&);
+        appender& operator = (const appender&);
+};
+
+datalayer :: group_commit :: group_commit(datalayer* dl, size_t shard)
+    : m_dl(dl)
+    , m_shard(shard)
+    , m_window(0)
+    , m_sync_window(0)
+    , m_protect()
+    , m_wakeup(&m_protect)
+    , m_joined()
+    , m_queue()
+    , m_queued_bytes(0)
+    , m_writes()
+    , m_batches()
+    , m_stalls()
+    , m_stall_time()
+{
+}
+
+datalayer :: group_commit :: ~group_commit() throw ()
+{
+}
+
+leveldb::Status
+datalayer :: group_commit :: write(leveldb::WriteBatch* updates, durability_level d)
+{
+    const uint64_t start = po6::monotonic_time();
+    const uint64_t window = d == DURABILITY_GROUP ? std::max(m_window, m_sync_window) : m_window;
+    leveldb::Status st;
+
+    if (d == DURABILITY_SYNC || (d != DURABILITY_GROUP && window == 0))
+    {
+        leveldb::WriteOptions opts;
+        opts.sync = d == DURABILITY_SYNC;
+        m_writes.tap();
+        m_batches.tap();
+        st = commit(opts, updates);
+    }
+    else
+    {
+        writer w(updates, d == DURABILITY_GROUP);
+        st = write_group(&w, window);
+    }
+
+    m_dl->m_write_latency[d].record(thread_stripe(), po6::monotonic_time() - start);
+    return st;
+}
+
+leveldb::Status
+datalayer :: group_commit :: write_group(writer* w, uint64_t window)
+{
+    leveldb::WriteBatch* updates = w->updates;
+    appender sizer(NULL);
+    updates->Iterate(&sizer);
+    w->bytes = sizer.bytes();
+    po6::threads::mutex::hold hold(&m_protect);
+    m_queue.push_back(w);
+    m_queued_bytes += w->bytes;
+
+    // a leader waiting for company checks whether the group is full
+    if (m_queue.size() > 1)
+    {
+        m_joined.set();
+    }
+
+    while (!w->done && m_queue.front() != w)
+    {
+        m_wakeup.wait();
+    }
+
+    if (w->done)
+    {
+        return w->st;
+    }
+
+    // we are the leader; give others until the window closes, or until
+    // they fill the group, to join it
+    if (m_queue.size() == 1)
+    {
+        const uint64_t deadline = po6::monotonic_time() + window;
+
+        while (m_queued_bytes < GROUP_COMMIT_MAX_BYTES &&
+               po6::monotonic_time() < deadline)
+        {
+            // reset under m_protect so that a join from here on is not lost
+            m_joined.reset();
+            m_protect.unlock();
+            m_joined.wait(deadline);
+            m_protect.lock();
+        }
+    }
+
+    // one fsync covers the whole group if any batch in it wants one
+    leveldb::WriteOptions opts;
+    opts.sync = w->sync;
+    leveldb::WriteBatch combined;
+    leveldb::WriteBatch* batch = updates;
+    std::list<writer*>::iterator last = m_queue.begin();
+    ++last;
+
+    if (last != m_queue.end())
+    {
+        appender app(&combined);
+        updates->Iterate(&app);
+        batch = &combined;
+
+        while (last != m_queue.end() && app.bytes() < GROUP_COMMIT_MAX_BYTES)
+        {
+            (*last)->updates->Iterate(&app);
+            opts.sync = opts.sync || (*last)->sync;
+            ++last;
+        }
+    }
+
+    size_t count = std::distance(m_queue.begin(), last);
+    m_protect.unlock();
+    leveldb::Status st = commit(opts, batch);
+    m_protect.lock();
+    m_writes.tap();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        writer* x = m_queue.front();
+        m_queue.pop_front();
+        m_queued_bytes -= x->bytes;
+        x->st = st;
+        x->done = true;
+        m_batches.tap();
+    }
+
+    m_wakeup.broadcast();
+    return st;
+}
+
+leveldb::Status
+datalayer :: group_commit :: commit(const leveldb::WriteOptions& opts,
+                                    leveldb::WriteBatch* batch)
+{
+    const uint64_t start = po6::monotonic_time();
+    leveldb::Status st = m_dl->m_shards[m_shard]->Write(opts, batch);
+    const uint64_t took = po6::monotonic_time() - start;
+
+    // an fsync may take as long as it likes, but a write that only touches
+    // the log and memtable takes this long only when LevelDB slows it down
+    if (!opts.sync && took >= WRITE_STALL_NANOS)
+    {
+        m_stalls.tap();
+        m_stall_time.add(took);
+    }
+
+    return st;
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef hyperdex_daemon_datalayer_group_commit_h_
+#define hyperdex_daemon_datalayer_group_commit_h_
+
+// STL
+#include <list>
+
+// po6
+#include <po6/threads/cond.h>
+#include <po6/threads/mutex.h>
+
+// LevelDB
+#include <hyperleveldb/write_batch.h>
+
+// HyperDex
+#include "common/schema.h"
+#include "daemon/datalayer.h"
+#include "daemon/deadline_event.h"
+#include "daemon/performance_counter.h"
+
+// Coalesce the write batches of concurrent callers into a single LevelDB
+// write.  The first caller to arrive becomes the leader; it waits up to the
+// configured window for others to queue behind it, then writes every queued
+// batch at once and hands each caller the shared status.  With a window of
+// zero, writes go straight to LevelDB.  Each LevelDB instance of the
+// datalayer has a group_commit of its own.
+//
+// Each write carries the durability of its space.  DURABILITY_SYNC writes go
+// straight to LevelDB with an fsync of their own.  DURABILITY_GROUP writes
+// always queue, so that those arriving during one group's fsync share the
+// next; a leader among them waits at least the sync window, and the group is
+// written with an fsync that covers every batch in it.  DURABILITY_MEMORY
+// writes go to an instance with no disk under it and are never synced.
+class hyperdex::datalayer::group_commit
+{
+    public:
+        group_commit(datalayer* dl, size_t shard);
+        ~group_commit() throw ();
+
+    public:
+        void set_window(uint64_t window_ns) { m_window = window_ns; }
+        void set_sync_window(uint64_t window_ns) { m_sync_window = window_ns; }
+        leveldb::Status write(leveldb::WriteBatch* updates, durability_level d);
+        // number of LevelDB writes, and the number of batches they carried
+        uint64_t writes() const { return m_writes.read(); }
+        uint64_t batches() const { return m_batches.read(); }
+        // unsynced writes that LevelDB held back, as it does when compaction
+        // falls behind, and the nanoseconds they spent held
+        uint64_t stalls() const { return m_stalls.read(); }
+        uint64_t stall_time() const { return m_stall_time.read(); }
+
+    private:
+        struct writer;
+        class appender;
+
+    private:
+        leveldb::Status write_group(writer* w, uint64_t window);
+        leveldb::Status commit(const leveldb::WriteOptions& opts,
+                               leveldb::WriteBatch* batch);
+
+    private:
+        datalayer* m_dl;
+        size_t m_shard;
+        uint64_t m_window;
+        uint64_t m_sync_window;
+        po6::threads::mutex m_protect;
+        po6::threads::cond m_wakeup;
+        // set under m_protect when a writer joins a waiting leader
+        deadline_event m_joined;
+        std::list<writer*> m_queue;
+        // the bytes of every batch in m_queue
+        uint64_t m_queued_bytes;
+        performance_counter m_writes;
+        performance_counter m_batches;
+        performance_counter m_stalls;
+        performance_counter m_stall_time;
+
+    private:
+        group_commit(const group_commit&);
+        group_commit& operator = (const group_commit&);
+};
+
+#endif // hyperdex_daemon_datalayer_group_commit_h_
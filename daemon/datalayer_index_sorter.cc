@@ -0,0 +1,363 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <stdlib.h>
+
+// POSIX
+#include <unistd.h>
+
+// STL
+#include <algorithm>
+
+// Google Log
+#include <glog/logging.h>
+
+// e
+#include <e/endian.h>
+
+// HyperDex
+#include "daemon/datalayer_index_sorter.h"
+
+using hyperdex::datalayer;
+
+// the bytes of entries "next" puts into a single batch
+#define INDEX_SORTER_BATCH (4ULL << 20)
+// the in-memory cost of an entry beyond its key and value
+#define INDEX_SORTER_OVERHEAD sizeof(entry)
+
+class datalayer::index_sorter::collector : public leveldb::WriteBatch::Handler
+{
+    public:
+        collector(index_sorter* s) : m_sorter(s) {}
+        virtual ~collector() {}
+
+    public:
+        virtual void Put(const leveldb::Slice& key, const leveldb::Slice& value)
+        { m_sorter->put(key, value); }
+        // the index is wiped before it is built, so there is nothing to delete
+        virtual void Delete(const leveldb::Slice&) {}
+
+    private:
+        index_sorter* m_sorter;
+
+    private:
+        collector(const collector&);
+        collector& operator = (const collector&);
+};
+
+class datalayer::index_sorter::run
+{
+    public:
+        run(FILE* f) : file(f), key(), val(), valid(false) {}
+        ~run() throw () { fclose(file); }
+
+    public:
+        // read the next entry; false on error, while "valid" is false at the
+        // end of the run
+        bool advance();
+
+    public:
+        FILE* file;
+        std::string key;
+        std::string val;
+        bool valid;
+
+    private:
+        run(const run&);
+        run& operator = (const run&);
+};
+
+bool
+datalayer :: index_sorter :: run :: advance()
+{
+    char hdr[2 * sizeof(uint32_t)];
+    size_t n = fread(hdr, 1, sizeof(hdr), file);
+
+    if (n == 0 && feof(file))
+    {
+        valid = false;
+        return true;
+    }
+
+    if (n != sizeof(hdr))
+    {
+        return false;
+    }
+
+    uint32_t key_sz;
+    uint32_t val_sz;
+    e::unpack32be(hdr, &key_sz);
+    e::unpack32be(hdr + sizeof(uint32_t), &val_sz);
+    key.resize(key_sz);
+    val.resize(val_sz);
+
+    if ((key_sz > 0 && fread(&key[0], 1, key_sz, file) != key_sz) ||
+        (val_sz > 0 && fread(&val[0], 1, val_sz, file) != val_sz))
+    {
+        return false;
+    }
+
+    valid = true;
+    return true;
+}
+
+class datalayer::index_sorter::compare_entries
+{
+    public:
+        compare_entries(const std::vector<char>* data) : m_data(data) {}
+
+    public:
+        bool operator () (const entry& lhs, const entry& rhs) const
+        {
+            leveldb::Slice l(&(*m_data)[lhs.offset], lhs.key_sz);
+            leveldb::Slice r(&(*m_data)[rhs.offset], rhs.key_sz);
+            return l.compare(r) < 0;
+        }
+
+    private:
+        const std::vector<char>* m_data;
+};
+
+// orders the heap so the run with the smallest key is on top
+class datalayer::index_sorter::compare_runs
+{
+    public:
+        compare_runs(const std::vector<run*>* runs) : m_runs(runs) {}
+
+    public:
+        bool operator () (size_t lhs, size_t rhs) const
+        {
+            leveldb::Slice l((*m_runs)[lhs]->key);
+            leveldb::Slice r((*m_runs)[rhs]->key);
+            return l.compare(r) > 0;
+        }
+
+    private:
+        const std::vector<run*>* m_runs;
+};
+
+datalayer :: index_sorter :: index_sorter(const std::string& dir, uint64_t budget)
+    : m_dir(dir)
+    , m_budget(budget)
+    , m_data()
+    , m_entries()
+    , m_emitted(0)
+    , m_runs()
+    , m_heap()
+    , m_error(false)
+{
+}
+
+datalayer :: index_sorter :: ~index_sorter() throw ()
+{
+    for (size_t i = 0; i < m_runs.size(); ++i)
+    {
+        delete m_runs[i];
+    }
+}
+
+bool
+datalayer :: index_sorter :: add(leveldb::WriteBatch* batch)
+{
+    collector c(this);
+    leveldb::Status st = batch->Iterate(&c);
+
+    if (!st.ok())
+    {
+        LOG(ERROR) << "could not sort index entries: " << st.ToString();
+        m_error = true;
+        return false;
+    }
+
+    if (m_data.size() + m_entries.size() * INDEX_SORTER_OVERHEAD >= m_budget)
+    {
+        return spill();
+    }
+
+    return true;
+}
+
+bool
+datalayer :: index_sorter :: finish()
+{
+    if (m_runs.empty())
+    {
+        sort();
+        m_emitted = 0;
+        return true;
+    }
+
+    if (!m_entries.empty() && !spill())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_runs.size(); ++i)
+    {
+        if (fseek(m_runs[i]->file, 0, SEEK_SET) != 0 ||
+            !m_runs[i]->advance())
+        {
+            PLOG(ERROR) << "could not read sorted run of index entries";
+            m_error = true;
+            return false;
+        }
+
+        if (m_runs[i]->valid)
+        {
+            m_heap.push_back(i);
+        }
+    }
+
+    std::make_heap(m_heap.begin(), m_heap.end(), compare_runs(&m_runs));
+    return true;
+}
+
+uint64_t
+datalayer :: index_sorter :: next(leveldb::WriteBatch* batch)
+{
+    uint64_t bytes = 0;
+
+    if (m_error)
+    {
+        return 0;
+    }
+
+    if (m_runs.empty())
+    {
+        while (m_emitted < m_entries.size() && bytes < INDEX_SORTER_BATCH)
+        {
+            const entry& ent(m_entries[m_emitted]);
+            const char* ptr = &m_data[ent.offset];
+            batch->Put(leveldb::Slice(ptr, ent.key_sz),
+                       leveldb::Slice(ptr + ent.key_sz, ent.val_sz));
+            bytes += ent.key_sz + ent.val_sz;
+            ++m_emitted;
+        }
+
+        return bytes;
+    }
+
+    while (!m_heap.empty() && bytes < INDEX_SORTER_BATCH)
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end(), compare_runs(&m_runs));
+        run* r = m_runs[m_heap.back()];
+        batch->Put(r->key, r->val);
+        bytes += r->key.size() + r->val.size();
+
+        if (!r->advance())
+        {
+            PLOG(ERROR) << "could not read sorted run of index entries";
+            m_error = true;
+            return 0;
+        }
+
+        if (r->valid)
+        {
+            std::push_heap(m_heap.begin(), m_heap.end(), compare_runs(&m_runs));
+        }
+        else
+        {
+            m_heap.pop_back();
+        }
+    }
+
+    return bytes;
+}
+
+void
+datalayer :: index_sorter :: put(const leveldb::Slice& key, const leveldb::Slice& val)
+{
+    m_entries.push_back(entry(m_data.size(), key.size(), val.size()));
+    m_data.insert(m_data.end(), key.data(), key.data() + key.size());
+    m_data.insert(m_data.end(), val.data(), val.data() + val.size());
+}
+
+void
+datalayer :: index_sorter :: sort()
+{
+    std::sort(m_entries.begin(), m_entries.end(), compare_entries(&m_data));
+}
+
+bool
+datalayer :: index_sorter :: spill()
+{
+    sort();
+    std::string path(m_dir + "/index-sort-XXXXXX");
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    int fd = mkstemp(&name[0]);
+
+    if (fd < 0)
+    {
+        PLOG(ERROR) << "could not create a sorted run of index entries in " << m_dir;
+        m_error = true;
+        return false;
+    }
+
+    // nothing but this process needs the run, so let it vanish on close
+    unlink(&name[0]);
+    FILE* f = fdopen(fd, "w+");
+
+    if (!f)
+    {
+        PLOG(ERROR) << "could not create a sorted run of index entries in " << m_dir;
+        close(fd);
+        m_error = true;
+        return false;
+    }
+
+    m_runs.push_back(new run(f));
+
+    for (size_t i = 0; i < m_entries.size(); ++i)
+    {
+        const entry& ent(m_entries[i]);
+        char hdr[2 * sizeof(uint32_t)];
+        e::pack32be(ent.key_sz, hdr);
+        e::pack32be(ent.val_sz, hdr + sizeof(uint32_t));
+        const size_t sz = ent.key_sz + ent.val_sz;
+
+        if (fwrite(hdr, 1, sizeof(hdr), f) != sizeof(hdr) ||
+            (sz > 0 && fwrite(&m_data[ent.offset], 1, sz, f) != sz))
+        {
+            PLOG(ERROR) << "could not write a sorted run of index entries";
+            m_error = true;
+            return false;
+        }
+    }
+
+    if (fflush(f) != 0)
+    {
+        PLOG(ERROR) << "could not write a sorted run of index entries";
+        m_error = true;
+        return false;
+    }
+
+    m_data.clear();
+    m_entries.clear();
+    return true;
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_datalayer_index_sorter_h_
+#define hyperdex_daemon_datalayer_index_sorter_h_
+
+// C
+#include <stdio.h>
+
+// STL
+#include <string>
+#include <vector>
+
+// LevelDB
+#include <hyperleveldb/write_batch.h>
+
+// HyperDex
+#include "daemon/datalayer.h"
+
+// Collect the entries of an index being built from scratch and hand them back
+// in key order.  Entries accumulate in memory until they exceed the budget,
+// at which point they are sorted and spilled to a run in the data directory;
+// "next" merges the runs.  Writing a fresh index in key order lets LevelDB
+// lay its tables down without overlapping one another, instead of sorting
+// the entries again through every level of compaction.
+class hyperdex::datalayer::index_sorter
+{
+    public:
+        index_sorter(const std::string& dir, uint64_t budget);
+        ~index_sorter() throw ();
+
+    public:
+        // take the puts in batch; false if a run could not be spilled
+        bool add(leveldb::WriteBatch* batch);
+        // stop adding and prepare to merge
+        bool finish();
+        // fill batch with the next entries in key order; returns the bytes
+        // added, or 0 once every entry has been returned or on error
+        uint64_t next(leveldb::WriteBatch* batch);
+        bool error() const { return m_error; }
+        size_t runs() const { return m_runs.size(); }
+
+    private:
+        class collector;
+        class run;
+        struct entry
+        {
+            entry(size_t o, uint32_t k, uint32_t v) : offset(o), key_sz(k), val_sz(v) {}
+            size_t offset;
+            uint32_t key_sz;
+            uint32_t val_sz;
+        };
+        class compare_entries;
+        class compare_runs;
+
+    private:
+        void put(const leveldb::Slice& key, const leveldb::Slice& val);
+        void sort();
+        bool spill();
+
+    private:
+        const std::string m_dir;
+        const uint64_t m_budget;
+        std::vector<char> m_data;
+        std::vector<entry> m_entries;
+        size_t m_emitted;
+        std::vector<run*> m_runs;
+        // the runs that still have entries, as a heap ordered by next key
+        std::vector<size_t> m_heap;
+        bool m_error;
+
+    private:
+        index_sorter(const index_sorter&);
+        index_sorter& operator = (const index_sorter&);
+};
+
+#endif // hyperdex_daemon_datalayer_index_sorter_h_
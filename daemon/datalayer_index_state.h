@@ -28,18 +28,22 @@
 #ifndef hyperdex_daemon_datalayer_index_state_h_
 #define hyperdex_daemon_datalayer_index_state_h_
 
+// e
+#include <e/compat.h>
+
 // HyperDex
 #include "daemon/datalayer.h"
+#include "daemon/index_filter.h"
 
 using hyperdex::datalayer;
 
 struct datalayer::index_state
 {
-    index_state() : ri(), ii(), m_usable(0) {}
+    index_state() : ri(), ii(), filter(), m_usable(0) {}
     index_state(region_id _ri, index_id _ii)
-        : ri(_ri), ii(_ii), m_usable(0) {}
+        : ri(_ri), ii(_ii), filter(), m_usable(0) {}
     index_state(const index_state& other)
-        : ri(other.ri), ii(other.ii)
+        : ri(other.ri), ii(other.ii), filter(other.filter)
         , m_usable(other.m_usable) {}
     bool is_usable() { e::atomic::memory_barrier(); return e::atomic::load_64_acquire(&m_usable) == 1; }
     void set_usable() { e::atomic::store_64_release(&m_usable, 1); e::atomic::memory_barrier(); }
@@ -49,6 +53,7 @@ struct datalayer::index_state
         {
             ri = rhs.ri;
             ii = rhs.ii;
+            filter = rhs.filter;
             m_usable = rhs.m_usable;
         }
 
@@ -58,6 +63,9 @@ struct datalayer::index_state
 
     region_id ri;
     index_id ii;
+    // set only while the daemon is paused for a reconfiguration; NULL when
+    // the index has none
+    e::compat::shared_ptr<index_filter> filter;
 
     private:
         uint64_t m_usable;
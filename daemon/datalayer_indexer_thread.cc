@@ -27,10 +27,23 @@
 
 #define __STDC_LIMIT_MACROS
 
+// C
+#include <time.h>
+
+// STL
+#include <algorithm>
+
 // Google Log
 #include <glog/logging.h>
 
+// LevelDB
+#include <hyperleveldb/write_batch.h>
+
+// po6
+#include <po6/time.h>
+
 // e
+#include <e/atomic.h>
 #include <e/endian.h>
 #include <e/varint.h>
 
@@ -38,22 +51,41 @@
 #include "daemon/daemon.h"
 #include "daemon/datalayer_checkpointer_thread.h"
 #include "daemon/datalayer_encodings.h"
+#include "daemon/datalayer_index_sorter.h"
 #include "daemon/datalayer_index_state.h"
 #include "daemon/datalayer_indexer_thread.h"
+#include "daemon/datalayer_plan_cache.h"
 #include "daemon/datalayer_wiper_thread.h"
 
+// objects written to LevelDB together while scanning a region
+#define INDEXER_BATCH_OBJECTS 256
+// the longest the indexer sleeps at once to stay within its budget
+#define INDEXER_MAX_SLEEP 100000000ULL
+// bytes scanned between charges to the maintenance budget
+#define INDEXER_MAINTENANCE_CHARGE 65536ULL
+
 using hyperdex::datalayer;
 
-datalayer :: indexer_thread :: indexer_thread(daemon* d, wiper_indexer_mediator* m)
+datalayer :: indexer_thread :: indexer_thread(daemon* d, wiper_indexer_mediator* m,
+                                              uint64_t rate, uint64_t sort_buffer)
     : background_thread(d)
     , m_daemon(d)
     , m_mediator(m)
     , m_config()
     , m_have_current(false)
     , m_current_region()
-    , m_current_index()
+    , m_current_indices()
     , m_interrupted_count(0)
     , m_interrupted(false)
+    , m_rate(rate)
+    , m_sort_buffer(sort_buffer)
+    , m_throttle_start(0)
+    , m_throttle_bytes(0)
+    , m_maintenance_bytes(0)
+    , m_objects()
+    , m_bytes()
+    , m_scan_total(0)
+    , m_scan_done(0)
 {
 }
 
@@ -71,21 +103,36 @@ bool
 datalayer :: indexer_thread :: have_work()
 {
     m_interrupted = false;
-    m_mediator->clear_indexer_region();
+
+    if (m_have_current)
+    {
+        m_mediator->clear_indexer_region(m_current_region);
+    }
+
     m_have_current = false;
     m_current_region = region_id();
-    m_current_index = index_id();
+    m_current_indices.clear();
+    e::atomic::store_64_nobarrier(&m_scan_total, 0);
+    e::atomic::store_64_nobarrier(&m_scan_done, 0);
+
+    // builds wait for the maintenance window to open, but one under way
+    // when it closes runs to the end
+    if (!m_daemon->m_data.m_maintenance.is_open(time(NULL)))
+    {
+        return false;
+    }
 
     for (size_t i = 0; i < m_daemon->m_data.m_indices.size(); ++i)
     {
         index_state* is = &m_daemon->m_data.m_indices[i];
 
         // if it's not usable (we have to index it first), and it's not
-        // currently being wiped, and it's something that we've been mapped to,
-        // then we have work to do
+        // currently being wiped or indexed by another thread, and it's
+        // something that we've been mapped to, then we have work to do
         if (!is->is_usable() &&
             !m_mediator->region_conflicts_with_wiper(is->ri) &&
-            m_daemon->m_config.get_virtual(is->ri, m_daemon->m_us) != virtual_server_id())
+            !m_mediator->region_conflicts_with_indexer(is->ri) &&
+            m_daemon->config().get_virtual(is->ri, m_daemon->m_us) != virtual_server_id())
         {
             return true;
         }
@@ -105,37 +152,57 @@ datalayer :: indexer_thread :: copy_work()
         // currently being wiped, and it's something that we've been mapped to,
         // then we have work to do
         if (!is->is_usable() &&
-            m_daemon->m_config.get_virtual(is->ri, m_daemon->m_us) != virtual_server_id() &&
+            m_daemon->config().get_virtual(is->ri, m_daemon->m_us) != virtual_server_id() &&
             m_mediator->set_indexer_region(is->ri))
         {
-            m_config = m_daemon->m_config;
+            m_config = m_daemon->config();
             m_have_current   = true;
             m_current_region = is->ri;
-            m_current_index  = is->ii;
-            return;
+            break;
         }
     }
-}
 
-void
-datalayer :: indexer_thread :: do_work()
-{
     if (!m_have_current)
     {
         return;
     }
 
-    if (!wipe(m_current_region, m_current_index))
+    // build every index of the region in the same pass over its objects
+    for (size_t i = 0; i < m_daemon->m_data.m_indices.size(); ++i)
+    {
+        index_state* is = &m_daemon->m_data.m_indices[i];
+
+        if (!is->is_usable() && is->ri == m_current_region)
+        {
+            m_current_indices.push_back(is->ii);
+        }
+    }
+}
+
+void
+datalayer :: indexer_thread :: do_work()
+{
+    if (!m_have_current)
     {
         return;
     }
 
     configuration config = m_config;
-    leveldb_db_ptr db = m_daemon->m_data.m_db;
+    leveldb_db_ptr db = m_daemon->m_data.db_for(m_current_region);
     const schema* sc = config.get_schema(m_current_region);
-    const index* idx = config.get_index(m_current_index);
-    assert(idx);
-    std::vector<const index*> idxs(1, idx);
+    std::vector<const index*> idxs;
+
+    for (size_t i = 0; i < m_current_indices.size(); ++i)
+    {
+        if (!wipe(m_current_region, m_current_indices[i]))
+        {
+            return;
+        }
+
+        const index* idx = config.get_index(m_current_indices[i]);
+        assert(idx);
+        idxs.push_back(idx);
+    }
 
     // prohibit garbage collection during this section.
     // this ensures that the timestamp we take will remain valid until the end
@@ -165,16 +232,97 @@ datalayer :: indexer_thread :: do_work()
         return;
     }
 
+    const uint64_t start = po6::monotonic_time();
+    const uint64_t start_objects = m_objects.read();
+    const uint64_t start_bytes = m_bytes.read();
+    e::atomic::store_64_nobarrier(&m_scan_total, it->cost(db.get()));
+    m_throttle_start = start;
+    m_throttle_bytes = 0;
+    LOG(INFO) << "building " << idxs.size() << " index(es) for " << m_current_region
+              << " from approximately " << m_scan_total << " bytes of objects";
+    std::auto_ptr<index_sorter> sorter;
+
+    if (m_sort_buffer > 0)
+    {
+        sorter.reset(new index_sorter(m_daemon->m_data_dir, m_sort_buffer));
+    }
+
+    leveldb::WriteBatch batch;
+    size_t batched = 0;
+
     while (it->valid())
     {
-        if (!index_from_iterator(it.get(), sc, m_current_region, idxs))
+        uint64_t bytes = 0;
+
+        if (!index_from_iterator(it.get(), sc, m_current_region, idxs, &batch, &bytes))
         {
             return;
         }
 
+        m_objects.tap();
+        m_bytes.add(bytes);
+        e::atomic::increment_64_nobarrier(&m_scan_done, bytes);
+        ++batched;
+
+        if (batched >= INDEXER_BATCH_OBJECTS)
+        {
+            if (!flush(sorter.get(), &batch))
+            {
+                return;
+            }
+
+            batched = 0;
+        }
+
+        throttle(bytes);
         it->next();
     }
 
+    if (!flush(sorter.get(), &batch))
+    {
+        return;
+    }
+
+    // write the sorted entries out in key order
+    if (sorter.get())
+    {
+        if (!sorter->finish())
+        {
+            return;
+        }
+
+        while (true)
+        {
+            if (interrupted())
+            {
+                return;
+            }
+
+            uint64_t bytes = sorter->next(&batch);
+
+            if (sorter->error())
+            {
+                return;
+            }
+
+            if (bytes == 0)
+            {
+                break;
+            }
+
+            if (!flush(NULL, &batch))
+            {
+                return;
+            }
+
+            throttle(bytes);
+        }
+
+        LOG(INFO) << "merged " << sorter->runs() << " sorted run(s) of index entries for "
+                  << m_current_region;
+        sorter.reset();
+    }
+
     // Now do it again from the checkpoint we took.
     std::auto_ptr<replay_iterator> rit(replay(m_current_region, timestamp));
 
@@ -190,6 +338,7 @@ datalayer :: indexer_thread :: do_work()
             return;
         }
 
+        throttle(rit->key().size());
         rit->next();
     }
 
@@ -209,15 +358,24 @@ datalayer :: indexer_thread :: do_work()
         rit->next();
     }
 
-    // make the index usable to all
-    if (!mark_usable(m_current_region, m_current_index))
+    // make the indices usable to all
+    for (size_t i = 0; i < m_current_indices.size(); ++i)
     {
-        return;
+        if (!mark_usable(m_current_region, m_current_indices[i]))
+        {
+            return;
+        }
     }
 
     // Unpause writes
     g3.dismiss();
     m_daemon->unpause();
+    const uint64_t elapsed = po6::monotonic_time() - start;
+    const uint64_t bytes = m_bytes.read() - start_bytes;
+    LOG(INFO) << "built " << idxs.size() << " index(es) for " << m_current_region
+              << " from " << m_objects.read() - start_objects << " objects ("
+              << bytes << " bytes) in " << elapsed / 1000000000ULL << " seconds ("
+              << bytes * 1000ULL / (elapsed / 1000000ULL + 1) << " bytes/s)";
 
     // Let the index possibly do its thing
     m_daemon->m_data.m_wiper->kick();
@@ -230,8 +388,16 @@ datalayer :: indexer_thread :: debug_dump()
     LOG(INFO) << "indexer thread ================================================================";
     LOG(INFO) << "have_current=" << (m_have_current ? "yes" : "no");
     LOG(INFO) << "current_region=" << m_current_region;
-    LOG(INFO) << "current_index=" << m_current_index;
+
+    for (size_t i = 0; i < m_current_indices.size(); ++i)
+    {
+        LOG(INFO) << "current_index=" << m_current_indices[i];
+    }
+
     LOG(INFO) << "interrupted_count=" << m_interrupted_count;
+    LOG(INFO) << "rate=" << m_rate;
+    LOG(INFO) << "scanned=" << e::atomic::load_64_nobarrier(&m_scan_done)
+              << "/" << e::atomic::load_64_nobarrier(&m_scan_total);
     this->unlock();
 }
 
@@ -254,8 +420,8 @@ datalayer :: indexer_thread :: mark_usable(const region_id& ri, const index_id&
     ptr = e::packvarint64(ii.get(), ptr);
     leveldb::WriteOptions wo;
     leveldb::Slice key(buf, ptr - buf);
-    leveldb::Slice val;
-    leveldb::Status st = m_daemon->m_data.m_db->Put(wo, key, val);
+    leveldb::Slice val(INDEX_FORMAT_COMPACT, INDEX_FORMAT_COMPACT_SIZE);
+    leveldb::Status st = m_daemon->m_data.db_for(ri)->Put(wo, key, val);
 
     if (!st.ok())
     {
@@ -275,9 +441,23 @@ datalayer :: indexer_thread :: mark_usable(const region_id& ri, const index_id&
         }
     }
 
+    // plans made without the index would keep ignoring it
+    m_daemon->m_data.m_plans->forget(ri);
+
     return true;
 }
 
+void
+datalayer :: indexer_thread :: stats(uint64_t* objects, uint64_t* bytes, uint64_t* pending)
+{
+    *objects = m_objects.read();
+    *bytes = m_bytes.read();
+    uint64_t total = e::atomic::load_64_nobarrier(&m_scan_total);
+    uint64_t done = e::atomic::load_64_nobarrier(&m_scan_done);
+    // the total is LevelDB's estimate, so the scan may overrun it
+    *pending = total > done ? total - done : 0;
+}
+
 bool
 datalayer :: indexer_thread :: interrupted()
 {
@@ -295,10 +475,67 @@ datalayer :: indexer_thread :: interrupted()
     return ret;
 }
 
+void
+datalayer :: indexer_thread :: throttle(uint64_t bytes)
+{
+    // the maintenance budget is shared, so charge it in chunks
+    m_maintenance_bytes += bytes;
+
+    if (m_maintenance_bytes >= INDEXER_MAINTENANCE_CHARGE)
+    {
+        m_daemon->m_data.m_maintenance.throttle(m_maintenance_bytes);
+        m_maintenance_bytes = 0;
+    }
+
+    if (m_rate == 0)
+    {
+        return;
+    }
+
+    // sleep whenever the scan gets ahead of the time its budget allows for
+    m_throttle_bytes += bytes;
+    const uint64_t allowed = m_throttle_bytes * 1000000ULL / m_rate * 1000ULL;
+    const uint64_t elapsed = po6::monotonic_time() - m_throttle_start;
+
+    if (allowed > elapsed)
+    {
+        uint64_t ns = std::min(allowed - elapsed, uint64_t(INDEXER_MAX_SLEEP));
+        timespec ts;
+        ts.tv_sec = ns / 1000000000ULL;
+        ts.tv_nsec = ns % 1000000000ULL;
+        nanosleep(&ts, NULL);
+    }
+}
+
+bool
+datalayer :: indexer_thread :: flush(index_sorter* sorter, leveldb::WriteBatch* batch)
+{
+    if (sorter)
+    {
+        bool ok = sorter->add(batch);
+        batch->Clear();
+        return ok;
+    }
+
+    leveldb::WriteOptions opts;
+    opts.sync = false;
+    leveldb::Status st = m_daemon->m_data.db_for(m_current_region)->Write(opts, batch);
+    batch->Clear();
+
+    if (!st.ok())
+    {
+        datalayer::returncode rc = m_daemon->m_data.handle_error(st);
+        LOG(ERROR) << "error indexing: " << rc;
+        return false;
+    }
+
+    return true;
+}
+
 datalayer::region_iterator*
 datalayer :: indexer_thread :: play(const region_id& ri, const schema* sc)
 {
-    leveldb_db_ptr db = m_daemon->m_data.m_db;
+    leveldb_db_ptr db = m_daemon->m_data.db_for(ri);
     leveldb_iterator_ptr iip;
     leveldb::ReadOptions ro;
     ro.fill_cache = false;
@@ -310,8 +547,9 @@ datalayer :: indexer_thread :: play(const region_id& ri, const schema* sc)
 datalayer::replay_iterator*
 datalayer :: indexer_thread :: replay(const region_id& ri, const std::string& timestamp)
 {
+    leveldb_db_ptr db = m_daemon->m_data.db_for(ri);
     leveldb::ReplayIterator* riip;
-    leveldb::Status st = m_daemon->m_data.m_db->GetReplayIterator(timestamp, &riip);
+    leveldb::Status st = db->GetReplayIterator(timestamp, &riip);
 
     if (!st.ok())
     {
@@ -319,9 +557,9 @@ datalayer :: indexer_thread :: replay(const region_id& ri, const std::string& ti
         return NULL;
     }
 
-    leveldb_replay_iterator_ptr ptr(m_daemon->m_data.m_db, riip);
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
-    return new replay_iterator(ri, ptr, index_encoding::lookup(sc.attrs[0].type));
+    leveldb_replay_iterator_ptr ptr(db, riip);
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    return new replay_iterator(&m_daemon->m_data, ri, ptr, index_encoding::lookup(sc.attrs[0].type));
 }
 
 bool
@@ -334,7 +572,8 @@ bool
 datalayer :: indexer_thread :: wipe_common(uint8_t c, const region_id& ri, const index_id& ii)
 {
     std::auto_ptr<leveldb::Iterator> it;
-    it.reset(m_daemon->m_data.m_db->NewIterator(leveldb::ReadOptions()));
+    leveldb_db_ptr db = m_daemon->m_data.db_for(ri);
+    it.reset(db->NewIterator(leveldb::ReadOptions()));
     char backing[sizeof(uint8_t) + 2 * VARINT_64_MAX_SIZE];
     char* ptr = backing;
     ptr = e::pack8be(c, ptr);
@@ -350,7 +589,7 @@ datalayer :: indexer_thread :: wipe_common(uint8_t c, const region_id& ri, const
             return false;
         }
 
-        m_daemon->m_data.m_db->Delete(leveldb::WriteOptions(), it->key());
+        db->Delete(leveldb::WriteOptions(), it->key());
         it->Next();
     }
 
@@ -361,20 +600,27 @@ bool
 datalayer :: indexer_thread :: index_from_iterator(region_iterator* it,
                                                    const schema* sc,
                                                    const region_id& ri,
-                                                   const std::vector<const index*>& idxs)
+                                                   const std::vector<const index*>& idxs,
+                                                   leveldb::WriteBatch* batch,
+                                                   uint64_t* bytes)
 {
     if (interrupted())
     {
         return false;
     }
 
-    e::slice key;
+    // the iterator reads from a snapshot, so the object is right there; there
+    // is no need to look it up again
+    e::slice key = it->key();
+    std::string raw(reinterpret_cast<const char*>(it->value().data()), it->value().size());
     std::vector<e::slice> value;
     uint64_t version;
-    datalayer::reference ref;
-    datalayer::returncode rc;
-    rc = m_daemon->m_data.get_from_iterator(ri, *sc, it,
-            &key, &value, &version, &ref);
+    datalayer::returncode rc = m_daemon->m_data.unchunk(ri, key, it->snap().get(), NULL, &raw);
+
+    if (rc == SUCCESS)
+    {
+        rc = decode_value(e::slice(raw.data(), raw.size()), &value, &version);
+    }
 
     if (rc != SUCCESS)
     {
@@ -382,20 +628,14 @@ datalayer :: indexer_thread :: index_from_iterator(region_iterator* it,
         return false;
     }
 
-    leveldb::WriteBatch batch;
-    create_index_changes(*sc, ri, idxs, key, NULL, &value, &batch);
-
-    leveldb::WriteOptions opts;
-    opts.sync = false;
-    leveldb::Status st = m_daemon->m_data.m_db->Write(opts, &batch);
-
-    if (!st.ok())
+    if (value.size() + 1 != sc->attrs_sz)
     {
-        rc = m_daemon->m_data.handle_error(st);
-        LOG(ERROR) << "error indexing: " << rc;
+        LOG(ERROR) << "error indexing: " << BAD_ENCODING;
         return false;
     }
 
+    create_index_changes(*sc, ri, idxs, key, NULL, &value, batch);
+    *bytes = key.size() + raw.size();
     return true;
 }
 
@@ -422,6 +662,13 @@ datalayer :: indexer_thread :: index_from_replay_iterator(replay_iterator* rit,
     {
         rc = rit->unpack_value(&_value, &version, &ref1);
 
+        // a later write replaced this version's chunks, and the replay will
+        // index that write in its turn
+        if (rc == NOT_FOUND)
+        {
+            return true;
+        }
+
         if (rc != SUCCESS)
         {
             LOG(ERROR) << "error indexing: " << rc;
@@ -442,14 +689,19 @@ datalayer :: indexer_thread :: index_from_replay_iterator(replay_iterator* rit,
     std::string ref2;
     leveldb::ReadOptions opts;
     opts.verify_checksums = true;
-    leveldb::Status st = m_daemon->m_data.m_db->Get(opts, lkey, &ref2);
+    leveldb::Status st = m_daemon->m_data.db_for(ri)->Get(opts, lkey, &ref2);
     std::vector<e::slice> _old_value;
 
     if (st.ok())
     {
         uint64_t old_version;
-        rc = decode_value(e::slice(ref2.data(), ref2.size()),
-                          &_old_value, &old_version);
+        rc = m_daemon->m_data.unchunk(ri, key, NULL, NULL, &ref2);
+
+        if (rc == SUCCESS)
+        {
+            rc = decode_value(e::slice(ref2.data(), ref2.size()),
+                              &_old_value, &old_version);
+        }
 
         if (rc != SUCCESS)
         {
@@ -481,7 +733,7 @@ datalayer :: indexer_thread :: index_from_replay_iterator(replay_iterator* rit,
     create_index_changes(*sc, ri, idxs, key, old_value, new_value, &batch);
     leveldb::WriteOptions wopts;
     wopts.sync = false;
-    st = m_daemon->m_data.m_db->Write(wopts, &batch);
+    st = m_daemon->m_data.db_for(ri)->Write(wopts, &batch);
 
     if (!st.ok())
     {
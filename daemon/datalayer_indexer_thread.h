@@ -36,11 +36,16 @@
 #include "daemon/datalayer_wiper_indexer_mediator.h"
 #include "daemon/index_info.h"
 #include "daemon/leveldb.h"
+#include "daemon/performance_counter.h"
 
 class hyperdex::datalayer::indexer_thread : public hyperdex::background_thread
 {
     public:
-        indexer_thread(daemon* d, wiper_indexer_mediator* m);
+        // rate is the number of bytes per second this thread may scan; 0
+        // leaves it unthrottled.  sort_buffer is the memory it may use to
+        // write new indices in key order; 0 writes entries as they are made
+        indexer_thread(daemon* d, wiper_indexer_mediator* m,
+                       uint64_t rate, uint64_t sort_buffer);
         ~indexer_thread() throw ();
 
     public:
@@ -53,9 +58,14 @@ class hyperdex::datalayer::indexer_thread : public hyperdex::background_thread
         void debug_dump();
         void kick();
         bool mark_usable(const region_id& ri, const index_id& ii);
+        // objects and bytes this thread has scanned, and an estimate of the
+        // bytes left to scan in the region it is indexing
+        void stats(uint64_t* objects, uint64_t* bytes, uint64_t* pending);
 
     private:
         bool interrupted();
+        void throttle(uint64_t bytes);
+        bool flush(index_sorter* sorter, leveldb::WriteBatch* batch);
         region_iterator* play(const region_id& ri, const schema* sc);
         replay_iterator* replay(const region_id& ri,
                                 const std::string& timestamp);
@@ -64,7 +74,9 @@ class hyperdex::datalayer::indexer_thread : public hyperdex::background_thread
         bool index_from_iterator(region_iterator* it,
                                  const schema* sc,
                                  const region_id& ri,
-                                 const std::vector<const index*>& idxs);
+                                 const std::vector<const index*>& idxs,
+                                 leveldb::WriteBatch* batch,
+                                 uint64_t* bytes);
         bool index_from_replay_iterator(replay_iterator* rit,
                                         const schema* sc,
                                         const region_id& ri,
@@ -76,9 +88,20 @@ class hyperdex::datalayer::indexer_thread : public hyperdex::background_thread
         configuration m_config;
         bool m_have_current;
         region_id m_current_region;
-        index_id m_current_index;
+        // every index of the region that needs building; one scan builds all
+        std::vector<index_id> m_current_indices;
         uint64_t m_interrupted_count;
         bool m_interrupted;
+        const uint64_t m_rate;
+        const uint64_t m_sort_buffer;
+        uint64_t m_throttle_start;
+        uint64_t m_throttle_bytes;
+        // scanned, but not yet charged to the maintenance window
+        uint64_t m_maintenance_bytes;
+        performance_counter m_objects;
+        performance_counter m_bytes;
+        uint64_t m_scan_total;
+        uint64_t m_scan_done;
 
     private:
         indexer_thread(const indexer_thread&);
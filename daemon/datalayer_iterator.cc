@@ -27,6 +27,11 @@
 
 #define __STDC_LIMIT_MACROS
 
+// STL
+#include <algorithm>
+#include <iterator>
+#include <string>
+
 // e
 #include <e/endian.h>
 #include <e/varint.h>
@@ -35,10 +40,15 @@
 #include "daemon/daemon.h"
 #include "daemon/datalayer_encodings.h"
 #include "daemon/datalayer_iterator.h"
+#include "daemon/expiry.h"
 
 using hyperdex::datalayer;
 using hyperdex::leveldb_snapshot_ptr;
 
+// the most candidates a search_iterator reads ahead of the one it is on; it
+// starts at one and doubles with each batch, so short searches read little
+#define SEARCH_READ_AHEAD 32
+
 inline leveldb::Slice e2level(const e::slice& s) { return leveldb::Slice(reinterpret_cast<const char*>(s.data()), s.size()); }
 inline e::slice level2e(const leveldb::Slice& s) { return e::slice(s.data(), s.size()); }
 
@@ -74,10 +84,32 @@ internal_key_compare(const e::slice& lhs, const e::slice& rhs)
 
 datalayer :: iterator :: iterator(leveldb_snapshot_ptr s)
     : m_ref(0)
+    , m_exec()
     , m_snap(s)
 {
 }
 
+double
+datalayer :: iterator :: progress(leveldb::DB*)
+{
+    return 0;
+}
+
+void
+datalayer :: iterator :: analyze(std::ostream& out, const std::string& indent) const
+{
+    out << indent << *this
+        << " examined=" << m_exec.examined
+        << " seeks=" << m_exec.seeks
+        << " bytes=" << m_exec.bytes << "\n";
+}
+
+bool
+datalayer :: iterator :: take_object(std::string*)
+{
+    return false;
+}
+
 leveldb_snapshot_ptr
 datalayer :: iterator :: snap()
 {
@@ -90,10 +122,12 @@ datalayer :: iterator :: ~iterator() throw ()
 
 ///////////////////////////// class replay_iterator ////////////////////////////
 
-datalayer :: replay_iterator :: replay_iterator(const region_id& ri,
+datalayer :: replay_iterator :: replay_iterator(datalayer* dl,
+                                                const region_id& ri,
                                                 leveldb_replay_iterator_ptr ptr,
                                                 const index_encoding* ie)
-    : m_ri(ri)
+    : m_dl(dl)
+    , m_ri(ri)
     , m_iter(ptr.get())
     , m_ptr(ptr)
     , m_decoded()
@@ -164,6 +198,13 @@ datalayer :: replay_iterator :: unpack_value(std::vector<e::slice>* value,
                                              reference* ref)
 {
     ref->m_backing.assign(m_iter->value().data(), m_iter->value().size());
+    returncode rc = m_dl->unchunk(m_ri, key(), NULL, NULL, &ref->m_backing);
+
+    if (rc != SUCCESS)
+    {
+        return rc;
+    }
+
     e::slice v(ref->m_backing.data(), ref->m_backing.size());
     return decode_value(v, value, version);
 }
@@ -224,12 +265,15 @@ datalayer :: region_iterator :: region_iterator(leveldb_iterator_ptr iter,
     , m_ri(ri)
     , m_decoded()
     , m_ie(ie)
+    , m_cost(0)
+    , m_has_cost(false)
 {
     char buf[sizeof(uint8_t) + VARINT_64_MAX_SIZE];
     char* ptr = buf;
     ptr = e::pack8be('o', ptr);
     ptr = e::packvarint64(ri.get(), ptr);
     m_iter->Seek(leveldb::Slice(buf, ptr - buf));
+    ++m_exec.seeks;
 }
 
 datalayer :: region_iterator :: ~region_iterator() throw ()
@@ -270,12 +314,19 @@ datalayer :: region_iterator :: valid()
 void
 datalayer :: region_iterator :: next()
 {
+    ++m_exec.examined;
+    m_exec.bytes += m_iter->key().size() + m_iter->value().size();
     m_iter->Next();
 }
 
 uint64_t
 datalayer :: region_iterator :: cost(leveldb::DB* db)
 {
+    if (m_has_cost)
+    {
+        return m_cost;
+    }
+
     const size_t sz = object_prefix_sz(m_ri);
     char buf[2 * (sizeof(uint8_t) + VARINT_64_MAX_SIZE)];
     char* ptr = buf;
@@ -289,9 +340,9 @@ datalayer :: region_iterator :: cost(leveldb::DB* db)
     r.start = leveldb::Slice(buf, sz);
     r.limit = leveldb::Slice(buf + sz, sz);
     // ask leveldb for the size of the range
-    uint64_t ret;
-    db->GetApproximateSizes(&r, 1, &ret);
-    return ret;
+    db->GetApproximateSizes(&r, 1, &m_cost);
+    m_has_cost = true;
+    return m_cost;
 }
 
 e::slice
@@ -318,6 +369,13 @@ datalayer :: region_iterator :: key()
     return e::slice(&m_decoded.front(), decoded_sz);
 }
 
+e::slice
+datalayer :: region_iterator :: value()
+{
+    leveldb::Slice v = m_iter->value();
+    return e::slice(v.data(), v.size());
+}
+
 ///////////////////////////// class index_iterator /////////////////////////////
 
 datalayer :: index_iterator :: index_iterator(leveldb_snapshot_ptr s)
@@ -329,6 +387,12 @@ datalayer :: index_iterator :: ~index_iterator() throw ()
 {
 }
 
+bool
+datalayer :: index_iterator :: covering(e::slice*)
+{
+    return false;
+}
+
 ////////////////////////// class range_index_iterator //////////////////////////
 
 datalayer :: range_index_iterator :: range_index_iterator(leveldb_snapshot_ptr s,
@@ -353,6 +417,9 @@ datalayer :: range_index_iterator :: range_index_iterator(leveldb_snapshot_ptr s
     , m_has_lower(has_lower)
     , m_has_upper(has_upper)
     , m_invalid(false)
+    , m_reverse(false)
+    , m_cost(0)
+    , m_has_cost(false)
 {
     // setup the iterator
     leveldb::ReadOptions opts;
@@ -384,6 +451,7 @@ datalayer :: range_index_iterator :: range_index_iterator(leveldb_snapshot_ptr s
     }
 
     m_iter->Seek(e2level(m_range_lower));
+    ++m_exec.seeks;
 }
 
 datalayer :: range_index_iterator :: ~range_index_iterator() throw ()
@@ -411,23 +479,31 @@ datalayer :: range_index_iterator :: valid()
             return false;
         }
 
-        size_t sz = std::min(m_range_upper.size(), current.size());
-
-        if (m_has_upper && memcmp(m_range_upper.data(), current.data(), sz) < 0)
+        if (m_reverse)
         {
-            m_invalid = true;
-            return false;
-        }
+            size_t sz = std::min(m_range_lower.size(), current.size());
 
-        if (m_has_lower && internal_key_compare(m_value_lower, iv) > 0)
+            if (m_has_lower && memcmp(m_range_lower.data(), current.data(), sz) > 0)
+            {
+                m_invalid = true;
+                return false;
+            }
+        }
+        else
         {
-            m_iter->Next();
-            continue;
+            size_t sz = std::min(m_range_upper.size(), current.size());
+
+            if (m_has_upper && memcmp(m_range_upper.data(), current.data(), sz) < 0)
+            {
+                m_invalid = true;
+                return false;
+            }
         }
 
-        if (m_has_upper && internal_key_compare(m_value_upper, iv) < 0)
+        if ((m_has_lower && internal_key_compare(m_value_lower, iv) > 0) ||
+            (m_has_upper && internal_key_compare(m_value_upper, iv) < 0))
         {
-            m_iter->Next();
+            next();
             continue;
         }
 
@@ -440,12 +516,28 @@ datalayer :: range_index_iterator :: valid()
 void
 datalayer :: range_index_iterator :: next()
 {
-    m_iter->Next();
+    ++m_exec.examined;
+    m_exec.bytes += m_iter->key().size() + m_iter->value().size();
+
+    if (m_reverse)
+    {
+        m_iter->Prev();
+    }
+    else
+    {
+        m_iter->Next();
+    }
 }
 
 uint64_t
 datalayer :: range_index_iterator :: cost(leveldb::DB* db)
 {
+    // estimate from the start of the range, before iteration moves m_iter
+    if (m_has_cost)
+    {
+        return m_cost;
+    }
+
     if (m_scratch.size() < m_range_upper.size())
     {
         m_scratch.resize(m_range_upper.size());
@@ -455,12 +547,12 @@ datalayer :: range_index_iterator :: cost(leveldb::DB* db)
     hyperdex::encode_bump(&m_scratch[0], &m_scratch[0] + m_range_upper.size());
     // create the range
     leveldb::Range r;
-    r.start = m_iter->key();
+    r.start = m_reverse ? e2level(m_range_lower) : m_iter->key();
     r.limit = leveldb::Slice(&m_scratch[0], m_range_upper.size());
     // ask leveldb for the size of the range
-    uint64_t ret;
-    db->GetApproximateSizes(&r, 1, &ret);
-    return ret;
+    db->GetApproximateSizes(&r, 1, &m_cost);
+    m_has_cost = true;
+    return m_cost;
 }
 
 e::slice
@@ -494,10 +586,52 @@ datalayer :: range_index_iterator :: internal_key()
     return k;
 }
 
+e::slice
+datalayer :: range_index_iterator :: value()
+{
+    leveldb::Slice in = m_iter->key();
+    e::slice v;
+    e::slice k;
+    decode_entry(level2e(in), &v, &k);
+    return v;
+}
+
+leveldb::Status
+datalayer :: range_index_iterator :: status()
+{
+    return m_iter->status();
+}
+
+void
+datalayer :: range_index_iterator :: reverse()
+{
+    // position on the last entry at or below the upper end of the range
+    if (m_scratch.size() < m_range_upper.size())
+    {
+        m_scratch.resize(m_range_upper.size());
+    }
+
+    memmove(&m_scratch[0], m_range_upper.data(), m_range_upper.size());
+    hyperdex::encode_bump(&m_scratch[0], &m_scratch[0] + m_range_upper.size());
+    m_iter->Seek(leveldb::Slice(&m_scratch[0], m_range_upper.size()));
+
+    if (m_iter->Valid())
+    {
+        m_iter->Prev();
+    }
+    else
+    {
+        m_iter->SeekToLast();
+    }
+
+    ++m_exec.seeks;
+    m_reverse = true;
+}
+
 bool
 datalayer :: range_index_iterator :: sorted()
 {
-    return m_has_lower && m_has_upper && m_value_lower == m_value_upper;
+    return !m_reverse && m_has_lower && m_has_upper && m_value_lower == m_value_upper;
 }
 
 void
@@ -509,6 +643,46 @@ datalayer :: range_index_iterator :: seek(const e::slice& ik)
     decode_entry(level2e(in), &v, &k);
     encode_entry(v, ik, &m_scratch, &k);
     m_iter->Seek(e2level(k));
+    ++m_exec.seeks;
+}
+
+bool
+datalayer :: range_index_iterator :: covering(e::slice* payload)
+{
+    // scans over the objects themselves have no value encoding
+    if (!m_val_ie)
+    {
+        return false;
+    }
+
+    *payload = level2e(m_iter->value());
+    return !payload->empty();
+}
+
+double
+datalayer :: range_index_iterator :: progress(leveldb::DB* db)
+{
+    if (!m_iter->Valid())
+    {
+        return 1;
+    }
+
+    std::vector<char> upper(m_range_upper.data(), m_range_upper.data() + m_range_upper.size());
+    hyperdex::encode_bump(&upper[0], &upper[0] + upper.size());
+    leveldb::Range r[2];
+    r[0].start = e2level(m_range_lower);
+    r[0].limit = m_iter->key();
+    r[1].start = e2level(m_range_lower);
+    r[1].limit = leveldb::Slice(&upper[0], upper.size());
+    uint64_t sizes[2];
+    db->GetApproximateSizes(r, 2, sizes);
+
+    if (sizes[1] == 0)
+    {
+        return 0;
+    }
+
+    return std::min(1.0, double(sizes[0]) / double(sizes[1]));
 }
 
 bool
@@ -551,20 +725,16 @@ datalayer :: range_index_iterator :: decode_entry(const e::slice& in, e::slice*
     }
     else
     {
-        if (rem < sizeof(uint32_t))
-        {
-            return false;
-        }
-
-        uint32_t k_sz;
-        e::unpack32be(end - sizeof(uint32_t), &k_sz);
+        uint64_t k_sz;
+        size_t suffix_sz;
 
-        if (k_sz + sizeof(uint32_t) > rem)
+        if (!decode_key_size_suffix(ptr, end, &k_sz, &suffix_sz) ||
+            k_sz > rem - suffix_sz)
         {
             return false;
         }
 
-        *v = e::slice(ptr, rem - sizeof(uint32_t) - k_sz);
+        *v = e::slice(ptr, rem - suffix_sz - k_sz);
         *k = e::slice(ptr + v->size(), k_sz);
     }
 
@@ -603,7 +773,8 @@ datalayer :: range_index_iterator :: encode_entry(const e::slice& v,
     }
     else
     {
-        size_t sz = m_prefix.size() + v.size() + k.size() + sizeof(uint32_t);
+        size_t sz = m_prefix.size() + v.size() + k.size()
+                  + key_size_suffix_length(k.size());
 
         if (scratch->size() < sz)
         {
@@ -620,7 +791,7 @@ datalayer :: range_index_iterator :: encode_entry(const e::slice& v,
 
         if (!m_val_ie->encoding_fixed() && !m_key_ie->encoding_fixed())
         {
-            ptr = e::pack32be(k.size(), ptr);
+            ptr = encode_key_size_suffix(k.size(), ptr);
         }
 
         *slice = e::slice(&(*scratch)[0], ptr - &(*scratch)[0]);
@@ -673,6 +844,7 @@ datalayer :: intersect_iterator :: valid()
     while (!m_invalid && m_iters[0]->valid())
     {
         bool retry = false;
+        ++m_exec.examined;
 
         for (size_t i = 1; i < m_iters.size(); ++i)
         {
@@ -761,13 +933,236 @@ datalayer :: intersect_iterator :: seek(const e::slice& k)
     return m_iters[0]->seek(k);
 }
 
+bool
+datalayer :: intersect_iterator :: covering(e::slice* payload)
+{
+    // every iterator sits on the same object, so any of them will do
+    for (size_t i = 0; i < m_iters.size(); ++i)
+    {
+        if (m_iters[i]->covering(payload))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+double
+datalayer :: intersect_iterator :: progress(leveldb::DB* db)
+{
+    // the others only ever seek to where the first one is
+    return m_iters[0]->progress(db);
+}
+
+void
+datalayer :: intersect_iterator :: analyze(std::ostream& out, const std::string& indent) const
+{
+    out << indent << "intersect_iterator candidates=" << m_exec.examined << "\n";
+
+    for (size_t i = 0; i < m_iters.size(); ++i)
+    {
+        m_iters[i]->analyze(out, indent + "  ");
+    }
+}
+
+/////////////////////// class materialized_intersect_iterator ///////////////////////
+
+datalayer :: materialized_intersect_iterator :: materialized_intersect_iterator(leveldb_snapshot_ptr s,
+                                                                                const std::vector<e::intrusive_ptr<index_iterator> >& iterators,
+                                                                                const index_encoding* key_ie)
+    : index_iterator(s)
+    , m_iters()
+    , m_key_ie(key_ie)
+    , m_cost(0)
+    , m_materialized(false)
+    , m_keys()
+    , m_idx(0)
+    , m_scratch()
+{
+    assert(!iterators.empty());
+    std::vector<std::pair<uint64_t, e::intrusive_ptr<index_iterator> > > iters;
+
+    for (size_t i = 0; i < iterators.size(); ++i)
+    {
+        iters.push_back(std::make_pair(iterators[i]->cost(s.db()), iterators[i]));
+    }
+
+    // read the cheapest first so the set shrinks as early as possible
+    std::sort(iters.begin(), iters.end());
+    m_iters.resize(iters.size());
+
+    for (size_t i = 0; i < iters.size(); ++i)
+    {
+        m_cost += iters[i].first;
+        m_iters[i] = iters[i].second;
+    }
+}
+
+datalayer :: materialized_intersect_iterator :: ~materialized_intersect_iterator() throw ()
+{
+}
+
+bool
+datalayer :: materialized_intersect_iterator :: valid()
+{
+    if (!m_materialized)
+    {
+        materialize();
+    }
+
+    return m_idx < m_keys.size();
+}
+
+void
+datalayer :: materialized_intersect_iterator :: next()
+{
+    ++m_idx;
+}
+
+uint64_t
+datalayer :: materialized_intersect_iterator :: cost(leveldb::DB*)
+{
+    return m_cost;
+}
+
+e::slice
+datalayer :: materialized_intersect_iterator :: key()
+{
+    e::slice ik = this->internal_key();
+    size_t decoded_sz = m_key_ie->decoded_size(ik);
+
+    if (m_scratch.size() < decoded_sz)
+    {
+        m_scratch.resize(decoded_sz);
+    }
+
+    m_key_ie->decode(ik, &m_scratch.front());
+    return e::slice(&m_scratch.front(), decoded_sz);
+}
+
+std::ostream&
+datalayer :: materialized_intersect_iterator :: describe(std::ostream& out) const
+{
+    out << "materialized_intersect_iterator(";
+
+    for (size_t i = 0; i < m_iters.size(); ++i)
+    {
+        if (i > 0)
+        {
+            out << ", ";
+        }
+
+        out << *m_iters[i];
+    }
+
+    return out << ")";
+}
+
+e::slice
+datalayer :: materialized_intersect_iterator :: internal_key()
+{
+    return e::slice(m_keys[m_idx]);
+}
+
+bool
+datalayer :: materialized_intersect_iterator :: sorted()
+{
+    return true;
+}
+
+void
+datalayer :: materialized_intersect_iterator :: seek(const e::slice& ik)
+{
+    if (!m_materialized)
+    {
+        materialize();
+    }
+
+    std::string target(reinterpret_cast<const char*>(ik.data()), ik.size());
+    m_idx = std::lower_bound(m_keys.begin() + m_idx, m_keys.end(), target) - m_keys.begin();
+}
+
+double
+datalayer :: materialized_intersect_iterator :: progress(leveldb::DB*)
+{
+    if (!m_materialized)
+    {
+        return 0;
+    }
+
+    return m_keys.empty() ? 1 : double(m_idx) / double(m_keys.size());
+}
+
+void
+datalayer :: materialized_intersect_iterator :: analyze(std::ostream& out, const std::string& indent) const
+{
+    out << indent << "materialized_intersect_iterator read=" << m_exec.examined
+        << " kept=" << m_keys.size() << "\n";
+
+    for (size_t i = 0; i < m_iters.size(); ++i)
+    {
+        m_iters[i]->analyze(out, indent + "  ");
+    }
+}
+
+void
+datalayer :: materialized_intersect_iterator :: materialize()
+{
+    // std::string compares as memcmp does, so the sets are in the same order
+    // internal_key_compare would put them
+    std::vector<std::string> keys;
+    std::vector<std::string> both;
+
+    for (size_t i = 0; i < m_iters.size(); ++i)
+    {
+        keys.clear();
+
+        for (; m_iters[i]->valid(); m_iters[i]->next())
+        {
+            e::slice ik = m_iters[i]->internal_key();
+            keys.push_back(std::string(reinterpret_cast<const char*>(ik.data()), ik.size()));
+            ++m_exec.examined;
+        }
+
+        if (!m_iters[i]->sorted())
+        {
+            std::sort(keys.begin(), keys.end());
+        }
+
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+        if (i == 0)
+        {
+            m_keys.swap(keys);
+        }
+        else
+        {
+            both.clear();
+            std::set_intersection(m_keys.begin(), m_keys.end(),
+                                  keys.begin(), keys.end(),
+                                  std::back_inserter(both));
+            m_keys.swap(both);
+        }
+
+        if (m_keys.empty())
+        {
+            break;
+        }
+    }
+
+    m_materialized = true;
+    m_idx = 0;
+}
+
 ///////////////////////////// class search_iterator ////////////////////////////
 
 datalayer :: search_iterator :: search_iterator(datalayer* dl,
                                                 const region_id& ri,
                                                 e::intrusive_ptr<index_iterator> iter,
                                                 std::ostringstream* ostr,
-                                                const std::vector<attribute_check>* checks)
+                                                const std::vector<attribute_check>* checks,
+                                                bool include_expired)
     : iterator(iter->snap())
     , m_dl(dl)
     , m_ri(ri)
@@ -775,8 +1170,26 @@ datalayer :: search_iterator :: search_iterator(datalayer* dl,
     , m_error(SUCCESS)
     , m_ostr(ostr)
     , m_num_gets(0)
+    , m_num_covered(0)
+    , m_num_rejected(0)
     , m_checks(checks)
+    , m_compiled()
+    , m_covered()
+    , m_expiry(0)
+    , m_now(0)
+    , m_ahead()
+    , m_ahead_idx(0)
+    , m_window(1)
 {
+    // compile once here rather than once for every object examined
+    const schema& sc(*m_dl->m_daemon->config().get_schema(m_ri));
+    compile_attribute_checks(sc, *m_checks, &m_compiled);
+
+    if (!include_expired && sc.expiry != 0)
+    {
+        m_expiry = sc.expiry;
+        m_now = expiry_now();
+    }
 }
 
 datalayer :: search_iterator :: ~search_iterator() throw ()
@@ -792,67 +1205,167 @@ datalayer :: search_iterator :: describe(std::ostream& out) const
 bool
 datalayer :: search_iterator :: valid()
 {
-    if (m_error != SUCCESS)
+    while (m_ahead_idx == m_ahead.size())
     {
-        return false;
+        if (m_error != SUCCESS)
+        {
+            return false;
+        }
+
+        if (!m_iter->valid())
+        {
+            if (m_ostr) *m_ostr << " iterator retrieved " << m_num_gets << " objects from disk"
+                                << " and answered " << m_num_covered << " from the index\n";
+            return false;
+        }
+
+        read_ahead();
     }
 
+    return true;
+}
+
+void
+datalayer :: search_iterator :: read_ahead()
+{
     // Don't try to optimize by replacing m_ri with a const schema* because it
     // won't persist across reconfigurations
-    const schema& sc(*m_dl->m_daemon->m_config.get_schema(m_ri));
-
-    uint64_t version;
+    const schema& sc(*m_dl->m_daemon->config().get_schema(m_ri));
     std::vector<e::slice> value;
-    reference ref;
+    uint64_t version;
+    m_ahead.clear();
+    m_ahead_idx = 0;
+
+    // take the next candidates from the most selective iterator; an index
+    // that includes every checked attribute answers the checks without
+    // reading the object
+    while (m_iter->valid() && m_ahead.size() < m_window)
+    {
+        e::slice payload;
+
+        if (m_iter->covering(&payload))
+        {
+            value.clear();
+            value.resize(sc.attrs_sz - 1);
+
+            if (decode_covering(payload, &value, &m_covered) && covers_checks())
+            {
+                ++m_num_covered;
+
+                if ((m_expiry == 0 || !is_expired(sc, value, m_now)) &&
+                    passes_attribute_checks(sc, *m_checks, m_compiled, m_iter->key(), value) == m_checks->size())
+                {
+                    m_ahead.push_back(fetcher::item());
+                    m_ahead.back().key.assign(reinterpret_cast<const char*>(m_iter->key().data()),
+                                              m_iter->key().size());
+                    m_ahead.back().wanted = false;
+                }
+                else
+                {
+                    ++m_num_rejected;
+                }
+
+                m_iter->next();
+                continue;
+            }
+        }
 
-    // while the most selective iterator is valid and not past the end
-    while (m_iter->valid())
+        m_ahead.push_back(fetcher::item());
+        m_ahead.back().key.assign(reinterpret_cast<const char*>(m_iter->key().data()),
+                                  m_iter->key().size());
+        m_iter->next();
+    }
+
+    m_window = std::min(m_window * 2, size_t(SEARCH_READ_AHEAD));
+    m_dl->m_fetcher->fetch(m_ri, sc.attrs[0].type, snap().get(), &m_ahead);
+    size_t kept = 0;
+
+    // keep, in order, the candidates that pass; an error ends the search
+    // after the ones before it
+    for (size_t i = 0; i < m_ahead.size(); ++i)
     {
-        leveldb::ReadOptions opts;
-        opts.fill_cache = true;
-        opts.verify_checksums = true;
-        std::vector<char> kbacking;
-        leveldb::Slice lkey;
-        encode_key(m_ri, sc.attrs[0].type, m_iter->key(), &kbacking, &lkey);
-        leveldb::Status st = m_dl->m_db->Get(opts, lkey, &ref.m_backing);
+        fetcher::item* it = &m_ahead[i];
 
-        if (st.ok())
+        if (it->wanted)
         {
-            e::slice v(ref.m_backing.data(), ref.m_backing.size());
-            datalayer::returncode rc = decode_value(v, &value, &version);
+            datalayer::returncode rc = it->rc;
+
+            if (rc == SUCCESS)
+            {
+                ++m_num_gets;
+                m_exec.bytes += it->key.size() + it->object.size();
+                rc = decode_value(e::slice(it->object), &value, &version);
+            }
 
             if (rc != SUCCESS)
             {
                 m_error = rc;
-                return false;
+                break;
             }
 
-            ++m_num_gets;
-        }
-        else
-        {
-            m_error = m_dl->handle_error(st);
-            return false;
+            if ((m_expiry != 0 && is_expired(sc, value, m_now)) ||
+                passes_attribute_checks(sc, *m_checks, m_compiled, e::slice(it->key), value) != m_checks->size())
+            {
+                ++m_num_rejected;
+                continue;
+            }
         }
 
-        if (passes_attribute_checks(sc, *m_checks, m_iter->key(), value) == m_checks->size())
+        if (kept != i)
         {
-            return true;
+            m_ahead[kept].key.swap(it->key);
+            m_ahead[kept].wanted = it->wanted;
+            m_ahead[kept].object.swap(it->object);
         }
-        else
+
+        ++kept;
+    }
+
+    m_ahead.resize(kept);
+}
+
+bool
+datalayer :: search_iterator :: take_object(std::string* object)
+{
+    fetcher::item* it = &m_ahead[m_ahead_idx];
+
+    if (!it->wanted)
+    {
+        return false;
+    }
+
+    object->swap(it->object);
+    it->wanted = false;
+    return true;
+}
+
+bool
+datalayer :: search_iterator :: covers_checks() const
+{
+    if (m_expiry != 0 &&
+        std::find(m_covered.begin(), m_covered.end(), m_expiry) == m_covered.end())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < m_checks->size(); ++i)
+    {
+        const uint16_t attr = (*m_checks)[i].attr;
+
+        if (attr != 0 &&
+            std::find(m_covered.begin(), m_covered.end(), attr) == m_covered.end())
         {
-            m_iter->next();
+            return false;
         }
     }
 
-    if (m_ostr) *m_ostr << " iterator retrieved " << m_num_gets << " objects from disk\n";
-    return false;
+    return true;
 }
 
 void
 datalayer :: search_iterator :: next()
 {
-    m_iter->next();
+    ++m_ahead_idx;
 }
 
 uint64_t
@@ -864,5 +1377,21 @@ datalayer :: search_iterator :: cost(leveldb::DB* db)
 e::slice
 datalayer :: search_iterator :: key()
 {
-    return m_iter->key();
+    return e::slice(m_ahead[m_ahead_idx].key);
+}
+
+double
+datalayer :: search_iterator :: progress(leveldb::DB* db)
+{
+    return m_iter->progress(db);
+}
+
+void
+datalayer :: search_iterator :: analyze(std::ostream& out, const std::string& indent) const
+{
+    out << indent << "search_iterator fetched=" << m_num_gets
+        << " covered=" << m_num_covered
+        << " rejected=" << m_num_rejected
+        << " bytes=" << m_exec.bytes << "\n";
+    m_iter->analyze(out, indent + "  ");
 }
@@ -28,18 +28,35 @@
 #ifndef hyperdex_daemon_datalayer_iterator_h_
 #define hyperdex_daemon_datalayer_iterator_h_
 
+// STL
+#include <string>
+#include <vector>
+
 // e
 #include <e/intrusive_ptr.h>
 
 // HyperDex
 #include "namespace.h"
 #include "daemon/datalayer.h"
+#include "daemon/datalayer_fetcher.h"
 #include "daemon/index_info.h"
 
 BEGIN_HYPERDEX_NAMESPACE
 
 class datalayer::iterator
 {
+    public:
+        // what an iterator did while it ran, for search_describe to report
+        struct execution
+        {
+            execution() : examined(0), seeks(0), bytes(0) {}
+            // entries stepped over, whether or not they were returned
+            uint64_t examined;
+            uint64_t seeks;
+            // bytes of the keys and values read from LevelDB
+            uint64_t bytes;
+        };
+
     public:
         iterator(leveldb_snapshot_ptr snap);
 
@@ -51,9 +68,19 @@ class datalayer::iterator
         // REQUIRES: valid
         virtual e::slice key() = 0;
         virtual std::ostream& describe(std::ostream&) const = 0;
+        // the approximate fraction of the iterator's entries already passed,
+        // in [0, 1]; 0 if it cannot tell
+        virtual double progress(leveldb::DB*);
+        // one line for this iterator and each beneath it, saying what each
+        // has done so far, indented by depth under "indent"
+        virtual void analyze(std::ostream& out, const std::string& indent) const;
+        // move the stored object at key() into "object" if the iterator has
+        // already read it; false if it has not (or has given it up already)
+        virtual bool take_object(std::string* object);
 
     public:
         leveldb_snapshot_ptr snap();
+        const execution& executed() const { return m_exec; }
 
     protected:
         friend class e::intrusive_ptr<iterator>;
@@ -61,6 +88,7 @@ class datalayer::iterator
         void inc() { ++m_ref; }
         void dec() { --m_ref; if (m_ref == 0) delete this; }
         size_t m_ref;
+        execution m_exec;
 
     private:
         leveldb_snapshot_ptr m_snap;
@@ -69,7 +97,7 @@ class datalayer::iterator
 class datalayer::replay_iterator
 {
     public:
-        replay_iterator(const region_id& ri, leveldb_replay_iterator_ptr ptr, const index_encoding* ie);
+        replay_iterator(datalayer* dl, const region_id& ri, leveldb_replay_iterator_ptr ptr, const index_encoding* ie);
 
     public:
         bool valid();
@@ -82,6 +110,7 @@ class datalayer::replay_iterator
         leveldb::Status status();
 
     private:
+        datalayer* m_dl;
         region_id m_ri;
         leveldb::ReplayIterator* m_iter;
         leveldb_replay_iterator_ptr m_ptr;
@@ -123,6 +152,9 @@ class datalayer::region_iterator : public iterator
         virtual uint64_t cost(leveldb::DB*);
         virtual e::slice key();
         virtual std::ostream& describe(std::ostream&) const;
+        // REQUIRES: valid
+        // the object as it is stored; valid until the next call to "next"
+        e::slice value();
 
     private:
         region_iterator(const region_iterator&);
@@ -133,6 +165,9 @@ class datalayer::region_iterator : public iterator
         region_id m_ri;
         std::vector<char> m_decoded;
         const index_encoding *const m_ie;
+        // the size LevelDB estimated on the first call to "cost"
+        uint64_t m_cost;
+        bool m_has_cost;
 };
 
 class datalayer::index_iterator : public iterator
@@ -145,6 +180,10 @@ class datalayer::index_iterator : public iterator
         virtual e::slice internal_key() = 0;
         virtual bool sorted() = 0;
         virtual void seek(const e::slice& internal_key) = 0;
+        // REQUIRES: valid
+        // point payload at the attributes stored with the current entry by an
+        // index that includes them; false if there are none
+        virtual bool covering(e::slice* payload);
 
     protected:
         friend class e::intrusive_ptr<index_iterator>;
@@ -172,6 +211,16 @@ class datalayer::range_index_iterator : public index_iterator
         virtual e::slice internal_key();
         virtual bool sorted();
         virtual void seek(const e::slice& internal_key);
+        virtual bool covering(e::slice* payload);
+        virtual double progress(leveldb::DB*);
+
+    public:
+        // REQUIRES: valid; the encoded value of the current entry
+        e::slice value();
+        leveldb::Status status();
+        // walk the range from its upper end down; call before the first
+        // call to "valid"
+        void reverse();
 
     private:
         bool decode_entry(const e::slice& in, e::slice* val, e::slice* key);
@@ -199,6 +248,10 @@ class datalayer::range_index_iterator : public index_iterator
         bool m_has_lower;
         bool m_has_upper;
         bool m_invalid;
+        bool m_reverse;
+        // the size LevelDB estimated on the first call to "cost"
+        uint64_t m_cost;
+        bool m_has_cost;
 };
 
 class datalayer::intersect_iterator : public index_iterator
@@ -217,6 +270,9 @@ class datalayer::intersect_iterator : public index_iterator
         virtual e::slice internal_key();
         virtual bool sorted();
         virtual void seek(const e::slice& internal_key);
+        virtual bool covering(e::slice* payload);
+        virtual double progress(leveldb::DB*);
+        virtual void analyze(std::ostream& out, const std::string& indent) const;
 
     private:
         std::vector<e::intrusive_ptr<index_iterator> > m_iters;
@@ -224,6 +280,46 @@ class datalayer::intersect_iterator : public index_iterator
         bool m_invalid;
 };
 
+// Intersects iterators by reading each of them once, front to back, into a
+// sorted set of keys rather than by seeking them against one another.  This
+// trades memory for seeks, and works for unsorted iterators too.
+class datalayer::materialized_intersect_iterator : public index_iterator
+{
+    public:
+        materialized_intersect_iterator(leveldb_snapshot_ptr snap,
+                                        const std::vector<e::intrusive_ptr<index_iterator> >& iterators,
+                                        const index_encoding* key_ie);
+        virtual ~materialized_intersect_iterator() throw ();
+
+    public:
+        virtual bool valid();
+        virtual void next();
+        virtual uint64_t cost(leveldb::DB*);
+        virtual e::slice key();
+        virtual std::ostream& describe(std::ostream&) const;
+        virtual e::slice internal_key();
+        virtual bool sorted();
+        virtual void seek(const e::slice& internal_key);
+        virtual double progress(leveldb::DB*);
+        virtual void analyze(std::ostream& out, const std::string& indent) const;
+
+    private:
+        void materialize();
+
+    private:
+        materialized_intersect_iterator(const materialized_intersect_iterator&);
+        materialized_intersect_iterator& operator = (const materialized_intersect_iterator&);
+
+    private:
+        std::vector<e::intrusive_ptr<index_iterator> > m_iters;
+        const index_encoding *const m_key_ie;
+        uint64_t m_cost;
+        bool m_materialized;
+        std::vector<std::string> m_keys;
+        size_t m_idx;
+        std::vector<char> m_scratch;
+};
+
 class datalayer::search_iterator : public iterator
 {
     public:
@@ -231,7 +327,8 @@ class datalayer::search_iterator : public iterator
                         const region_id& ri,
                         e::intrusive_ptr<index_iterator> iter,
                         std::ostringstream* ostr,
-                        const std::vector<attribute_check>* checks);
+                        const std::vector<attribute_check>* checks,
+                        bool include_expired);
         virtual ~search_iterator() throw ();
 
     public:
@@ -240,6 +337,18 @@ class datalayer::search_iterator : public iterator
         virtual uint64_t cost(leveldb::DB*);
         virtual e::slice key();
         virtual std::ostream& describe(std::ostream&) const;
+        // how far through its candidates the search is
+        virtual double progress(leveldb::DB*);
+        virtual void analyze(std::ostream& out, const std::string& indent) const;
+        virtual bool take_object(std::string* object);
+
+    private:
+        // does m_covered hold every attribute the checks (and the expiry)
+        // examine?
+        bool covers_checks() const;
+        // replace m_ahead with the next candidates that pass the checks,
+        // reading their objects together
+        void read_ahead();
 
     private:
         search_iterator(const search_iterator&);
@@ -252,7 +361,21 @@ class datalayer::search_iterator : public iterator
         returncode m_error;
         std::ostringstream* m_ostr;
         uint64_t m_num_gets;
+        uint64_t m_num_covered;
+        // objects examined that failed the checks
+        uint64_t m_num_rejected;
         const std::vector<attribute_check>* m_checks;
+        std::vector<compiled_attribute_check> m_compiled;
+        std::vector<uint16_t> m_covered;
+        // the expiry attribute to hide expired objects by (0 to show them),
+        // and the time they are judged against
+        uint16_t m_expiry;
+        uint64_t m_now;
+        // candidates already taken from m_iter that passed, the one at key()
+        // first; those the index answered have not been read (wanted is false)
+        std::vector<fetcher::item> m_ahead;
+        size_t m_ahead_idx;
+        size_t m_window;
 };
 
 inline std::ostream&
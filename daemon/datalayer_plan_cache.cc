@@ -0,0 +1,164 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// po6
+#include <po6/time.h>
+
+// e
+#include <e/endian.h>
+
+// HyperDex
+#include "common/macros.h"
+#include "daemon/datalayer_plan_cache.h"
+
+using hyperdex::datalayer;
+
+// how long, in nanoseconds, and for how many searches a plan is trusted
+#define PLAN_CACHE_TTL 1000000000ULL
+#define PLAN_CACHE_USES 256
+// the cache is emptied rather than grown past this many plans
+#define PLAN_CACHE_ENTRIES 4096
+
+datalayer :: plan_cache :: plan_cache()
+    : m_protect()
+    , m_plans()
+    , m_hits()
+    , m_misses()
+{
+}
+
+datalayer :: plan_cache :: ~plan_cache() throw ()
+{
+}
+
+datalayer::plan_cache::plan
+datalayer :: plan_cache :: lookup(const region_id& ri,
+                                  const std::vector<attribute_check>& checks)
+{
+    std::string s;
+    shape(ri, checks, &s);
+    const uint64_t now = po6::monotonic_time();
+    po6::threads::mutex::hold hold(&m_protect);
+    std::map<std::string, entry>::iterator it = m_plans.find(s);
+
+    if (it == m_plans.end())
+    {
+        m_misses.tap();
+        return NONE;
+    }
+
+    if (it->second.expires < now || it->second.uses >= PLAN_CACHE_USES)
+    {
+        m_plans.erase(it);
+        m_misses.tap();
+        return NONE;
+    }
+
+    ++it->second.uses;
+    m_hits.tap();
+    return it->second.p;
+}
+
+void
+datalayer :: plan_cache :: insert(const region_id& ri,
+                                  const std::vector<attribute_check>& checks,
+                                  plan p)
+{
+    std::string s;
+    shape(ri, checks, &s);
+    entry ent;
+    ent.p = p;
+    ent.expires = po6::monotonic_time() + PLAN_CACHE_TTL;
+    po6::threads::mutex::hold hold(&m_protect);
+
+    if (m_plans.size() >= PLAN_CACHE_ENTRIES)
+    {
+        m_plans.clear();
+    }
+
+    m_plans[s] = ent;
+}
+
+void
+datalayer :: plan_cache :: forget(const region_id& ri)
+{
+    // shapes begin with the region, so its plans are contiguous
+    char buf[sizeof(uint64_t)];
+    e::pack64be(ri.get(), buf);
+    const std::string prefix(buf, sizeof(buf));
+    po6::threads::mutex::hold hold(&m_protect);
+    std::map<std::string, entry>::iterator lower = m_plans.lower_bound(prefix);
+    std::map<std::string, entry>::iterator upper = lower;
+
+    while (upper != m_plans.end() &&
+           upper->first.compare(0, prefix.size(), prefix) == 0)
+    {
+        ++upper;
+    }
+
+    m_plans.erase(lower, upper);
+}
+
+void
+datalayer :: plan_cache :: clear()
+{
+    po6::threads::mutex::hold hold(&m_protect);
+    m_plans.clear();
+}
+
+void
+datalayer :: plan_cache :: shape(const region_id& ri,
+                                 const std::vector<attribute_check>& checks,
+                                 std::string* s)
+{
+    const size_t per_check = sizeof(uint16_t) + 2 * sizeof(uint32_t);
+    s->resize(sizeof(uint64_t) + checks.size() * per_check);
+    char* ptr = &(*s)[0];
+    ptr = e::pack64be(ri.get(), ptr);
+
+    for (size_t i = 0; i < checks.size(); ++i)
+    {
+        ptr = e::pack16be(checks[i].attr, ptr);
+        ptr = e::pack32be(static_cast<uint32_t>(checks[i].predicate), ptr);
+        ptr = e::pack32be(static_cast<uint32_t>(checks[i].datatype), ptr);
+    }
+}
+
+std::ostream&
+hyperdex :: operator << (std::ostream& lhs, datalayer::plan_cache::plan rhs)
+{
+    switch (rhs)
+    {
+        STRINGIFY(datalayer::plan_cache::NONE);
+        STRINGIFY(datalayer::plan_cache::FULL_SCAN);
+        STRINGIFY(datalayer::plan_cache::INDICES);
+        default:
+            lhs << "unknown plan";
+    }
+
+    return lhs;
+}
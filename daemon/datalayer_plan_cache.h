@@ -0,0 +1,105 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_datalayer_plan_cache_h_
+#define hyperdex_daemon_datalayer_plan_cache_h_
+
+// STL
+#include <map>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// HyperDex
+#include "common/attribute_check.h"
+#include "daemon/datalayer.h"
+#include "daemon/performance_counter.h"
+
+// Remember how make_search_iterator planned each shape of search in each
+// region, so that short, selective searches don't pay for a round of
+// GetApproximateSizes calls every time.  A shape is the (attribute, predicate,
+// datatype) sequence of the checks; the values are not part of it, so a plan
+// is trusted for a bounded number of uses and a bounded time.
+class hyperdex::datalayer::plan_cache
+{
+    public:
+        enum plan
+        {
+            NONE,
+            FULL_SCAN,
+            INDICES
+        };
+
+    public:
+        plan_cache();
+        ~plan_cache() throw ();
+
+    public:
+        plan lookup(const region_id& ri,
+                    const std::vector<attribute_check>& checks);
+        void insert(const region_id& ri,
+                    const std::vector<attribute_check>& checks,
+                    plan p);
+        // forget the plans of one region, e.g., when an index becomes usable
+        void forget(const region_id& ri);
+        void clear();
+        uint64_t hits() const { return m_hits.read(); }
+        uint64_t misses() const { return m_misses.read(); }
+
+    private:
+        struct entry
+        {
+            entry() : p(NONE), expires(0), uses(0) {}
+            plan p;
+            uint64_t expires;
+            uint64_t uses;
+        };
+        static void shape(const region_id& ri,
+                          const std::vector<attribute_check>& checks,
+                          std::string* s);
+
+    private:
+        po6::threads::mutex m_protect;
+        std::map<std::string, entry> m_plans;
+        performance_counter m_hits;
+        performance_counter m_misses;
+
+    private:
+        plan_cache(const plan_cache&);
+        plan_cache& operator = (const plan_cache&);
+};
+
+BEGIN_HYPERDEX_NAMESPACE
+
+std::ostream&
+operator << (std::ostream& lhs, datalayer::plan_cache::plan rhs);
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_datalayer_plan_cache_h_
@@ -0,0 +1,249 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <time.h>
+
+// STL
+#include <algorithm>
+
+// Google Log
+#include <glog/logging.h>
+
+// po6
+#include <po6/time.h>
+
+// HyperDex
+#include "daemon/daemon.h"
+#include "daemon/datalayer_encodings.h"
+#include "daemon/datalayer_prefetch_thread.h"
+
+// the longest the prefetcher sleeps at once to stay within its budget
+#define PREFETCH_MAX_SLEEP 100000000ULL
+// objects read between checks for shutdown
+#define PREFETCH_CHECK_INTERVAL 1024
+
+using hyperdex::datalayer;
+
+datalayer :: prefetch_thread :: prefetch_thread(daemon* d)
+    : background_thread(d)
+    , m_daemon(d)
+    , m_rate(0)
+    , m_pending(false)
+    , m_regions()
+    , m_keys()
+    , m_lookups()
+    , m_prefixes()
+    , m_throttle_start(0)
+    , m_throttle_bytes(0)
+{
+}
+
+datalayer :: prefetch_thread :: ~prefetch_thread() throw ()
+{
+}
+
+const char*
+datalayer :: prefetch_thread :: thread_name()
+{
+    return "prefetch";
+}
+
+bool
+datalayer :: prefetch_thread :: have_work()
+{
+    return m_pending && m_rate > 0 && m_daemon->config().version() > 0;
+}
+
+void
+datalayer :: prefetch_thread :: copy_work()
+{
+    // resolve the saved list against the configuration while it is safe to
+    // read; regions no longer ours are skipped
+    const configuration& config(m_daemon->config());
+    std::vector<char> scratch;
+    m_lookups.clear();
+    m_prefixes.clear();
+
+    for (size_t i = 0; i < m_keys.size(); ++i)
+    {
+        const region_id& ri(m_keys[i].first);
+        const schema* sc = config.get_schema(ri);
+
+        if (!sc || config.get_virtual(ri, m_daemon->m_us) == virtual_server_id())
+        {
+            continue;
+        }
+
+        leveldb::Slice lkey;
+        encode_key(ri, sc->attrs[0].type, e::slice(m_keys[i].second), &scratch, &lkey);
+        m_lookups.push_back(std::make_pair(m_daemon->m_data.shard_of(ri),
+                                           std::string(lkey.data(), lkey.size())));
+    }
+
+    for (size_t i = 0; i < m_regions.size(); ++i)
+    {
+        if (config.get_virtual(m_regions[i], m_daemon->m_us) == virtual_server_id())
+        {
+            continue;
+        }
+
+        leveldb::Slice prefix;
+        encode_object_region(m_regions[i], &scratch, &prefix);
+        m_prefixes.push_back(std::make_pair(m_daemon->m_data.shard_of(m_regions[i]),
+                                            std::string(prefix.data(), prefix.size())));
+    }
+
+    m_pending = false;
+    m_regions.clear();
+    m_keys.clear();
+}
+
+void
+datalayer :: prefetch_thread :: do_work()
+{
+    // reads need nothing from the configuration, so they need not hold up
+    // a reconfiguration
+    this->offline();
+    const uint64_t budget = m_daemon->m_data.block_cache_size();
+    const uint64_t start = po6::monotonic_time();
+    leveldb::ReadOptions opts;
+    opts.fill_cache = true;
+    opts.verify_checksums = true;
+    m_throttle_start = start;
+    m_throttle_bytes = 0;
+    uint64_t objects = 0;
+    uint64_t bytes = 0;
+
+    for (size_t i = 0; i < m_lookups.size() && bytes < budget; ++i)
+    {
+        leveldb::DB* db = m_daemon->m_data.m_shards[m_lookups[i].first].get();
+        const std::string& lkey(m_lookups[i].second);
+        std::string val;
+        leveldb::Status st = db->Get(opts, leveldb::Slice(lkey), &val);
+
+        if (st.ok())
+        {
+            ++objects;
+            bytes += lkey.size() + val.size();
+            throttle(lkey.size() + val.size());
+        }
+    }
+
+    for (size_t i = 0; i < m_prefixes.size() && bytes < budget && !interrupted(); ++i)
+    {
+        leveldb::DB* db = m_daemon->m_data.m_shards[m_prefixes[i].first].get();
+        leveldb::Slice prefix(m_prefixes[i].second);
+        std::auto_ptr<leveldb::Iterator> it(db->NewIterator(opts));
+
+        for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix) &&
+                bytes < budget; it->Next())
+        {
+            const uint64_t sz = it->key().size() + it->value().size();
+            ++objects;
+            bytes += sz;
+            throttle(sz);
+
+            if (objects % PREFETCH_CHECK_INTERVAL == 0 && interrupted())
+            {
+                break;
+            }
+        }
+
+        if (!it->status().ok())
+        {
+            LOG(ERROR) << "prefetch stopped early: " << it->status().ToString();
+            break;
+        }
+    }
+
+    LOG(INFO) << "prefetched " << objects << " objects (" << bytes << " bytes) from "
+              << m_lookups.size() << " hot keys and " << m_prefixes.size()
+              << " regions in " << (po6::monotonic_time() - start) / 1000000ULL << "ms";
+    m_lookups.clear();
+    m_prefixes.clear();
+    this->online();
+}
+
+void
+datalayer :: prefetch_thread :: debug_dump()
+{
+    this->lock();
+    LOG(INFO) << "prefetch thread ===============================================================";
+    LOG(INFO) << "rate=" << m_rate;
+    LOG(INFO) << "pending=" << m_pending;
+    LOG(INFO) << "regions=" << m_regions.size();
+    LOG(INFO) << "keys=" << m_keys.size();
+    this->unlock();
+}
+
+void
+datalayer :: prefetch_thread :: prefetch(const std::vector<region_id>& regions,
+                                         const std::vector<std::pair<region_id, std::string> >& keys)
+{
+    this->lock();
+    m_pending = true;
+    m_regions = regions;
+    m_keys = keys;
+    this->wakeup();
+    this->unlock();
+}
+
+void
+datalayer :: prefetch_thread :: kick()
+{
+    this->lock();
+    this->wakeup();
+    this->unlock();
+}
+
+bool
+datalayer :: prefetch_thread :: interrupted()
+{
+    this->lock();
+    bool ret = this->is_shutdown();
+    this->unlock();
+    return ret;
+}
+
+void
+datalayer :: prefetch_thread :: throttle(uint64_t bytes)
+{
+    // sleep whenever the reads get ahead of the time the budget allows for
+    m_throttle_bytes += bytes;
+    const uint64_t allowed = m_throttle_bytes * 1000000ULL / m_rate * 1000ULL;
+    const uint64_t elapsed = po6::monotonic_time() - m_throttle_start;
+
+    if (allowed > elapsed)
+    {
+        uint64_t ns = std::min(allowed - elapsed, uint64_t(PREFETCH_MAX_SLEEP));
+        timespec ts;
+        ts.tv_sec = ns / 1000000000ULL;
+        ts.tv_nsec = ns % 1000000000ULL;
+        nanosleep(&ts, NULL);
+    }
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_datalayer_prefetch_thread_h_
+#define hyperdex_daemon_datalayer_prefetch_thread_h_
+
+// STL
+#include <string>
+#include <utility>
+#include <vector>
+
+// HyperDex
+#include "daemon/background_thread.h"
+#include "daemon/datalayer.h"
+
+// Refills the block cache after a restart.  The daemon saves the regions it
+// read most and its hottest keys as it runs; once the next run knows its
+// configuration, this thread reads those keys and then those regions'
+// objects, hottest first, until it has read as much as the block cache
+// holds.  Reads are paced to stay within the rate it is given.
+class hyperdex::datalayer::prefetch_thread : public hyperdex::background_thread
+{
+    public:
+        prefetch_thread(daemon* d);
+        ~prefetch_thread() throw ();
+
+    public:
+        virtual const char* thread_name();
+        virtual bool have_work();
+        virtual void copy_work();
+        virtual void do_work();
+
+    public:
+        void debug_dump();
+        // call before start; 0 disables prefetching
+        void set_rate(uint64_t rate) { m_rate = rate; }
+        bool enabled() const { return m_rate > 0; }
+        // what to prefetch once there is a configuration
+        void prefetch(const std::vector<region_id>& regions,
+                      const std::vector<std::pair<region_id, std::string> >& keys);
+        void kick();
+
+    private:
+        bool interrupted();
+        void throttle(uint64_t bytes);
+
+    private:
+        daemon* m_daemon;
+        uint64_t m_rate;
+        // under lock
+        bool m_pending;
+        std::vector<region_id> m_regions;
+        std::vector<std::pair<region_id, std::string> > m_keys;
+        // do_work; no lock; the encoded keys and region prefixes to read,
+        // each with the LevelDB instance holding it
+        std::vector<std::pair<size_t, std::string> > m_lookups;
+        std::vector<std::pair<size_t, std::string> > m_prefixes;
+        uint64_t m_throttle_start;
+        uint64_t m_throttle_bytes;
+
+    private:
+        prefetch_thread(const prefetch_thread&);
+        prefetch_thread& operator = (const prefetch_thread&);
+};
+
+#endif // hyperdex_daemon_datalayer_prefetch_thread_h_
@@ -28,6 +28,10 @@
 #ifndef hyperdex_daemon_datalayer_wiper_indexer_mediator_h_
 #define hyperdex_daemon_datalayer_wiper_indexer_mediator_h_
 
+// STL
+#include <algorithm>
+#include <vector>
+
 using hyperdex::datalayer;
 
 class datalayer::wiper_indexer_mediator
@@ -43,7 +47,7 @@ class datalayer::wiper_indexer_mediator
         bool set_wiper_region(const region_id& ri);
         bool set_indexer_region(const region_id& ri);
         void clear_wiper_region();
-        void clear_indexer_region();
+        void clear_indexer_region(const region_id& ri);
 
     private:
         wiper_indexer_mediator(const wiper_indexer_mediator&);
@@ -52,14 +56,15 @@ class datalayer::wiper_indexer_mediator
     private:
         po6::threads::mutex m_protect;
         region_id m_wiper;
-        region_id m_indexer;
+        // each indexer thread claims one region at a time
+        std::vector<region_id> m_indexers;
 };
 
 inline
 datalayer :: wiper_indexer_mediator :: wiper_indexer_mediator()
     : m_protect()
     , m_wiper()
-    , m_indexer()
+    , m_indexers()
 {
 }
 
@@ -74,7 +79,11 @@ datalayer :: wiper_indexer_mediator :: debug_dump()
     po6::threads::mutex::hold hold(&m_protect);
     LOG(INFO) << "wiper-indexer mediator ========================================================";
     LOG(INFO) << "wiper=" << m_wiper;
-    LOG(INFO) << "indexer=" << m_indexer;
+
+    for (size_t i = 0; i < m_indexers.size(); ++i)
+    {
+        LOG(INFO) << "indexer=" << m_indexers[i];
+    }
 }
 
 inline bool
@@ -88,7 +97,7 @@ inline bool
 datalayer :: wiper_indexer_mediator :: region_conflicts_with_indexer(const region_id& ri)
 {
     po6::threads::mutex::hold hold(&m_protect);
-    return m_indexer == ri;
+    return std::find(m_indexers.begin(), m_indexers.end(), ri) != m_indexers.end();
 }
 
 inline bool
@@ -96,7 +105,7 @@ datalayer :: wiper_indexer_mediator :: set_wiper_region(const region_id& ri)
 {
     po6::threads::mutex::hold hold(&m_protect);
 
-    if (m_indexer != ri)
+    if (std::find(m_indexers.begin(), m_indexers.end(), ri) == m_indexers.end())
     {
         m_wiper = ri;
         return true;
@@ -110,9 +119,10 @@ datalayer :: wiper_indexer_mediator :: set_indexer_region(const region_id& ri)
 {
     po6::threads::mutex::hold hold(&m_protect);
 
-    if (m_wiper != ri)
+    if (m_wiper != ri &&
+        std::find(m_indexers.begin(), m_indexers.end(), ri) == m_indexers.end())
     {
-        m_indexer = ri;
+        m_indexers.push_back(ri);
         return true;
     }
 
@@ -127,10 +137,16 @@ datalayer :: wiper_indexer_mediator :: clear_wiper_region()
 }
 
 inline void
-datalayer :: wiper_indexer_mediator :: clear_indexer_region()
+datalayer :: wiper_indexer_mediator :: clear_indexer_region(const region_id& ri)
 {
     po6::threads::mutex::hold hold(&m_protect);
-    m_indexer = region_id();
+    std::vector<region_id>::iterator it;
+    it = std::find(m_indexers.begin(), m_indexers.end(), ri);
+
+    if (it != m_indexers.end())
+    {
+        m_indexers.erase(it);
+    }
 }
 
 #endif // hyperdex_daemon_datalayer_wiper_indexer_mediator_h_
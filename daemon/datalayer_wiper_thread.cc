@@ -27,21 +27,31 @@
 
 #define __STDC_LIMIT_MACROS
 
+// C
+#include <cstring>
+
 // Google Log
 #include <glog/logging.h>
 
+// LevelDB
+#include <hyperleveldb/write_batch.h>
+
 // e
 #include <e/endian.h>
 #include <e/varint.h>
 
 // HyperDex
 #include "daemon/daemon.h"
+#include "daemon/datalayer_checkpointer_thread.h"
 #include "daemon/datalayer_index_state.h"
 #include "daemon/datalayer_indexer_thread.h"
 #include "daemon/datalayer_wiper_thread.h"
 
 using hyperdex::datalayer;
 
+// deletes are applied in batches of this many keys
+#define WIPE_BATCH_SIZE 4096
+
 datalayer :: wiper_thread :: wiper_thread(daemon* d, wiper_indexer_mediator* m)
     : background_thread(d)
     , m_daemon(d)
@@ -212,7 +222,7 @@ datalayer :: wiper_thread :: wipe(transfer_id xid, region_id rid)
 
         if (is->ri == rid)
         {
-            if (!m_daemon->m_data.m_indexer->mark_usable(is->ri, is->ii))
+            if (!m_daemon->m_data.m_indexers.front()->mark_usable(is->ri, is->ii))
             {
                 return;
             }
@@ -230,7 +240,11 @@ datalayer :: wiper_thread :: wipe(transfer_id xid, region_id rid)
     }
 
     this->unlock();
-    m_daemon->m_data.m_indexer->kick();
+
+    for (size_t i = 0; i < m_daemon->m_data.m_indexers.size(); ++i)
+    {
+        m_daemon->m_data.m_indexers[i]->kick();
+    }
 
     // now report that it was wiped
     m_daemon->m_stm.report_wiped(xid);
@@ -239,11 +253,19 @@ datalayer :: wiper_thread :: wipe(transfer_id xid, region_id rid)
 void
 datalayer :: wiper_thread :: wipe_checkpoints(region_id rid)
 {
+    // a wiped region has no checkpoints to look up or collect, even if
+    // this is interrupted before LevelDB catches up
+    m_daemon->m_data.m_checkpointer->forget_region(rid);
+    leveldb::ReadOptions opts;
+    opts.fill_cache = false;
     std::auto_ptr<leveldb::Iterator> it;
-    it.reset(m_daemon->m_data.m_db->NewIterator(leveldb::ReadOptions()));
+    it.reset(m_daemon->m_data.db_for(rid)->NewIterator(opts));
     char cbacking[CHECKPOINT_BUF_SIZE];
     encode_checkpoint(rid, 0, cbacking);
     it->Seek(leveldb::Slice(cbacking, CHECKPOINT_BUF_SIZE));
+    leveldb::WriteBatch updates;
+    size_t batched = 0;
+    uint64_t bytes = 0;
 
     while (it->Valid())
     {
@@ -261,9 +283,21 @@ datalayer :: wiper_thread :: wipe_checkpoints(region_id rid)
             break;
         }
 
-        m_daemon->m_data.m_db->Delete(leveldb::WriteOptions(), it->key());
+        updates.Delete(it->key());
+        ++batched;
+        bytes += it->key().size();
+
+        if (batched >= WIPE_BATCH_SIZE)
+        {
+            flush(rid, &updates, bytes);
+            batched = 0;
+            bytes = 0;
+        }
+
         it->Next();
     }
+
+    flush(rid, &updates, bytes);
 }
 
 void
@@ -277,28 +311,75 @@ void
 datalayer :: wiper_thread :: wipe_objects(region_id rid)
 {
     wipe_common('o', rid);
+    wipe_common('k', rid);
+    wipe_common('n', rid);
+    m_daemon->m_data.m_cache.clear();
+    m_daemon->m_data.m_warm.clear();
 }
 
 void
 datalayer :: wiper_thread :: wipe_common(uint8_t c, region_id rid)
 {
+    // the wiped data will never be read again, so keep it out of the cache
+    leveldb::ReadOptions opts;
+    opts.fill_cache = false;
     std::auto_ptr<leveldb::Iterator> it;
-    it.reset(m_daemon->m_data.m_db->NewIterator(leveldb::ReadOptions()));
+    it.reset(m_daemon->m_data.db_for(rid)->NewIterator(opts));
     char backing[sizeof(uint8_t) + VARINT_64_MAX_SIZE];
     char* ptr = backing;
     ptr = e::pack8be(c, ptr);
     ptr = e::packvarint64(rid.get(), ptr);
     leveldb::Slice prefix(backing, ptr - backing);
     it->Seek(prefix);
+    leveldb::WriteBatch updates;
+    size_t batched = 0;
+    uint64_t bytes = 0;
 
-    while (it->key().starts_with(prefix))
+    while (it->Valid() && it->key().starts_with(prefix))
     {
         if (interrupted())
         {
             return;
         }
 
-        m_daemon->m_data.m_db->Delete(leveldb::WriteOptions(), it->key());
+        updates.Delete(it->key());
+        ++batched;
+        bytes += it->key().size();
+
+        if (batched >= WIPE_BATCH_SIZE)
+        {
+            flush(rid, &updates, bytes);
+            batched = 0;
+            bytes = 0;
+        }
+
         it->Next();
     }
+
+    flush(rid, &updates, bytes);
+    it.reset();
+
+    // Compact the wiped range now so that its tombstones, and the data they
+    // cover, are dropped in one pass rather than being carried through
+    // every level by later compactions.
+    char limit_backing[sizeof(uint8_t) + VARINT_64_MAX_SIZE];
+    memmove(limit_backing, backing, prefix.size());
+    encode_bump(limit_backing, limit_backing + prefix.size());
+    leveldb::Slice limit(limit_backing, prefix.size());
+    m_daemon->m_data.db_for(rid)->CompactRange(&prefix, &limit);
+}
+
+void
+datalayer :: wiper_thread :: flush(region_id rid, leveldb::WriteBatch* updates, uint64_t bytes)
+{
+    leveldb::Status st = m_daemon->m_data.db_for(rid)->Write(leveldb::WriteOptions(), updates);
+
+    if (!st.ok())
+    {
+        LOG(ERROR) << "could not wipe keys: " << st.ToString();
+    }
+
+    // transfers wait on wiping, so it shares the budget but not the window
+    m_daemon->m_data.m_maintenance.throttle(bytes);
+    updates->Clear();
 }
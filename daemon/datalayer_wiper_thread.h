@@ -66,6 +66,9 @@ class hyperdex::datalayer::wiper_thread : public hyperdex::background_thread
         void wipe_indices(region_id rid);
         void wipe_objects(region_id rid);
         void wipe_common(uint8_t c, region_id rid);
+        // write the batch, and charge the bytes of its keys to the
+        // maintenance budget
+        void flush(region_id rid, leveldb::WriteBatch* updates, uint64_t bytes);
 
     private:
         daemon* m_daemon;
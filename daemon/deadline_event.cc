@@ -0,0 +1,118 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#define __STDC_LIMIT_MACROS
+
+// C
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+// po6
+#include <po6/time.h>
+
+// HyperDex
+#include "daemon/deadline_event.h"
+
+using hyperdex::deadline_event;
+
+deadline_event :: deadline_event()
+    : m_mtx()
+    , m_cond()
+    , m_set(false)
+{
+    pthread_condattr_t attr;
+
+    if (pthread_mutex_init(&m_mtx, NULL) != 0 ||
+        pthread_condattr_init(&attr) != 0 ||
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) != 0 ||
+        pthread_cond_init(&m_cond, &attr) != 0)
+    {
+        abort();
+    }
+
+    pthread_condattr_destroy(&attr);
+}
+
+deadline_event :: ~deadline_event() throw ()
+{
+    pthread_cond_destroy(&m_cond);
+    pthread_mutex_destroy(&m_mtx);
+}
+
+void
+deadline_event :: reset()
+{
+    pthread_mutex_lock(&m_mtx);
+    m_set = false;
+    pthread_mutex_unlock(&m_mtx);
+}
+
+void
+deadline_event :: set()
+{
+    pthread_mutex_lock(&m_mtx);
+    m_set = true;
+    pthread_cond_broadcast(&m_cond);
+    pthread_mutex_unlock(&m_mtx);
+}
+
+bool
+deadline_event :: wait(uint64_t deadline)
+{
+    pthread_mutex_lock(&m_mtx);
+
+    while (!m_set)
+    {
+        if (deadline == UINT64_MAX)
+        {
+            pthread_cond_wait(&m_cond, &m_mtx);
+            continue;
+        }
+
+        const uint64_t now = po6::monotonic_time();
+
+        if (now >= deadline)
+        {
+            break;
+        }
+
+        // po6 need not read the clock the condition variable waits on, so
+        // turn what is left into a time on that clock
+        const uint64_t left = deadline - now;
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        uint64_t nsec = ts.tv_nsec + left % 1000000000ULL;
+        ts.tv_sec += left / 1000000000ULL + nsec / 1000000000ULL;
+        ts.tv_nsec = nsec % 1000000000ULL;
+        pthread_cond_timedwait(&m_cond, &m_mtx, &ts);
+    }
+
+    const bool was_set = m_set;
+    pthread_mutex_unlock(&m_mtx);
+    return was_set;
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_deadline_event_h_
+#define hyperdex_daemon_deadline_event_h_
+
+// C
+#include <stdint.h>
+
+// POSIX
+#include <pthread.h>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// A flag one thread waits on until another sets it or a deadline passes.  The
+// po6 condition variables cannot time out, and the threads that linger for a
+// batch to fill must not sleep past its window.  Callers that guard their own
+// state with a mutex reset the event under that mutex before releasing it to
+// wait, and set it under the same mutex, so that no wakeup is lost.
+class deadline_event
+{
+    public:
+        deadline_event();
+        ~deadline_event() throw ();
+
+    public:
+        void reset();
+        void set();
+        // false if "deadline", a po6::monotonic_time, passed first; a
+        // deadline of UINT64_MAX waits for as long as it takes
+        bool wait(uint64_t deadline);
+
+    private:
+        pthread_mutex_t m_mtx;
+        pthread_cond_t m_cond;
+        bool m_set;
+
+    private:
+        deadline_event(const deadline_event&);
+        deadline_event& operator = (const deadline_event&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_deadline_event_h_
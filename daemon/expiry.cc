@@ -0,0 +1,91 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <assert.h>
+
+// e
+#include <e/endian.h>
+
+// po6
+#include <po6/time.h>
+
+// HyperDex
+#include "daemon/expiry.h"
+
+uint64_t
+hyperdex :: expiry_now()
+{
+    return po6::time() / 1000ULL;
+}
+
+bool
+hyperdex :: is_expired(const schema& sc, const std::vector<e::slice>& value, uint64_t now)
+{
+    if (sc.expiry == 0)
+    {
+        return false;
+    }
+
+    assert(sc.expiry <= value.size());
+    const e::slice& when(value[sc.expiry - 1]);
+
+    // an unset timestamp never expires
+    if (when.size() != sizeof(int64_t))
+    {
+        return false;
+    }
+
+    int64_t timestamp;
+    e::unpack64le(when.data(), &timestamp);
+    return timestamp > 0 && static_cast<uint64_t>(timestamp) <= now;
+}
+
+void
+hyperdex :: expired_checks(const schema& sc, uint64_t now, e::arena* memory,
+                           std::vector<attribute_check>* checks)
+{
+    assert(sc.expiry != 0 && sc.expiry < sc.attrs_sz);
+    uint8_t* ptr = NULL;
+    memory->allocate(2 * sizeof(int64_t), &ptr);
+    e::pack64le(int64_t(0), ptr);
+    e::pack64le(static_cast<int64_t>(now), ptr + sizeof(int64_t));
+
+    attribute_check set;
+    set.attr = sc.expiry;
+    set.value = e::slice(ptr, sizeof(int64_t));
+    set.datatype = sc.attrs[sc.expiry].type;
+    set.predicate = HYPERPREDICATE_GREATER_THAN;
+    checks->push_back(set);
+
+    attribute_check past;
+    past.attr = sc.expiry;
+    past.value = e::slice(ptr + sizeof(int64_t), sizeof(int64_t));
+    past.datatype = sc.attrs[sc.expiry].type;
+    past.predicate = HYPERPREDICATE_LESS_EQUAL;
+    checks->push_back(past);
+}
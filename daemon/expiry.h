@@ -0,0 +1,63 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_expiry_h_
+#define hyperdex_daemon_expiry_h_
+
+// STL
+#include <vector>
+
+// e
+#include <e/arena.h>
+#include <e/slice.h>
+
+// HyperDex
+#include "namespace.h"
+#include "common/attribute_check.h"
+#include "common/schema.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// the wallclock time in the unit of timestamp attributes (microseconds since
+// the epoch)
+uint64_t
+expiry_now();
+
+// true when the space expires objects and this object's expiry attribute is
+// set to a time at or before "now"; "value" is every attribute but the key
+bool
+is_expired(const schema& sc, const std::vector<e::slice>& value, uint64_t now);
+
+// append to "checks" the checks that pass exactly when is_expired would;
+// "memory" backs the values they compare against
+void
+expired_checks(const schema& sc, uint64_t now, e::arena* memory,
+               std::vector<attribute_check>* checks);
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_expiry_h_
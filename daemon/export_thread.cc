@@ -0,0 +1,395 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#define __STDC_LIMIT_MACROS
+
+// C
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// POSIX
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+
+// STL
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/path.h>
+#include <po6/time.h>
+
+// e
+#include <e/compat.h>
+#include <e/strescape.h>
+
+// Google Log
+#include <glog/logging.h>
+
+// HyperDex
+#include "common/attribute_check.h"
+#include "daemon/column_writer.h"
+#include "daemon/daemon.h"
+#include "daemon/export_thread.h"
+
+using hyperdex::column_writer;
+using hyperdex::export_thread;
+using hyperdex::network_returncode;
+
+// objects exported between chances for a reconfiguration to go through
+#define EXPORT_YIELD_OBJECTS 4096
+// how often a throttled export checks for shutdown
+#define EXPORT_POLL_NANOS 100000000ULL
+
+export_thread :: export_thread(daemon* d)
+    : background_thread(d)
+    , m_daemon(d)
+    , m_busy(false)
+    , m_pending(false)
+    , m_from()
+    , m_vto()
+    , m_nonce(0)
+    , m_space()
+    , m_name()
+    , m_rate(0)
+    , m_compress(false)
+    , m_start(0)
+    , m_written(0)
+{
+}
+
+export_thread :: ~export_thread() throw ()
+{
+    shutdown();
+}
+
+const char*
+export_thread :: thread_name()
+{
+    return "export";
+}
+
+bool
+export_thread :: have_work()
+{
+    return m_pending;
+}
+
+void
+export_thread :: copy_work()
+{
+    m_pending = false;
+}
+
+void
+export_thread :: do_work()
+{
+    std::string dir(po6::path::join(m_daemon->m_data_dir, "export-" + m_name));
+    LOG(INFO) << "exporting space \"" << e::strescape(m_space)
+              << "\" to \"" << e::strescape(dir) << "\"";
+    m_start = po6::monotonic_time();
+    m_written = 0;
+    uint64_t objects = 0;
+    uint64_t bytes = 0;
+    network_returncode rc = export_space(dir, &objects, &bytes);
+
+    if (rc == NET_SUCCESS)
+    {
+        LOG(INFO) << "export finished with " << objects << " objects in "
+                  << bytes << " bytes of columns";
+    }
+    else
+    {
+        LOG(ERROR) << "export of space \"" << e::strescape(m_space)
+                   << "\" failed; whatever is in \"" << e::strescape(dir)
+                   << "\" is incomplete";
+    }
+
+    std::string path(dir);
+
+    if (!po6::path::realpath(dir, &path))
+    {
+        path = dir;
+    }
+
+    m_daemon->send_export(m_from, m_vto, m_nonce, rc, path, objects, bytes);
+    this->lock();
+    m_busy = false;
+    this->unlock();
+}
+
+bool
+export_thread :: enqueue(server_id from, virtual_server_id vto, uint64_t nonce,
+                         const std::string& space, const std::string& name,
+                         uint64_t rate, bool compress)
+{
+    this->lock();
+
+    if (m_busy)
+    {
+        this->unlock();
+        return false;
+    }
+
+    m_busy = true;
+    m_pending = true;
+    m_from = from;
+    m_vto = vto;
+    m_nonce = nonce;
+    m_space = space;
+    m_name = name;
+    m_rate = rate;
+    m_compress = compress;
+    this->wakeup();
+    this->unlock();
+    return true;
+}
+
+network_returncode
+export_thread :: export_space(const std::string& dir,
+                              uint64_t* objects, uint64_t* bytes)
+{
+    const schema* sc = m_daemon->config().get_schema(m_space.c_str());
+
+    if (!sc)
+    {
+        LOG(ERROR) << "cannot export space \"" << e::strescape(m_space)
+                   << "\" because it does not exist";
+        return NET_NOTFOUND;
+    }
+
+    if (mkdir(dir.c_str(), S_IRWXU) < 0)
+    {
+        PLOG(ERROR) << "could not create export directory \"" << e::strescape(dir) << "\"";
+        return NET_SERVERERROR;
+    }
+
+    // the column files are named for the attributes; this says their types
+    std::string schema_path(po6::path::join(dir, "schema"));
+    FILE* fout = fopen(schema_path.c_str(), "w");
+
+    if (!fout)
+    {
+        PLOG(ERROR) << "could not write \"" << e::strescape(schema_path) << "\"";
+        return NET_SERVERERROR;
+    }
+
+    std::ostringstream ostr;
+    ostr << "space " << m_space << "\n";
+
+    for (size_t i = 0; i < sc->attrs_sz; ++i)
+    {
+        ostr << "attribute " << sc->attrs[i].name << " " << sc->attrs[i].type << "\n";
+    }
+
+    const std::string s(ostr.str());
+    const bool wrote = fwrite(s.data(), 1, s.size(), fout) == s.size();
+
+    if (fclose(fout) != 0 || !wrote)
+    {
+        PLOG(ERROR) << "could not write \"" << e::strescape(schema_path) << "\"";
+        return NET_SERVERERROR;
+    }
+
+    // the point leader of each region exports it, so that across all
+    // servers every object is exported once
+    std::vector<region_id> regions;
+    m_daemon->config().point_leaders(m_daemon->m_us, &regions);
+
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+        const char* name = m_daemon->config().get_space_name(regions[i]);
+
+        if (!name || m_space != name)
+        {
+            continue;
+        }
+
+        if (!export_region(regions[i], dir, objects, bytes))
+        {
+            return NET_SERVERERROR;
+        }
+    }
+
+    return NET_SUCCESS;
+}
+
+bool
+export_thread :: export_region(const region_id& ri, const std::string& dir,
+                               uint64_t* objects, uint64_t* bytes)
+{
+    const schema* sc = m_daemon->config().get_schema(ri);
+
+    if (!sc)
+    {
+        LOG(ERROR) << "cannot export " << ri << " because it went away";
+        return false;
+    }
+
+    std::ostringstream ostr;
+    ostr << "region-" << ri.get();
+    const std::string rdir(po6::path::join(dir, ostr.str()));
+
+    if (mkdir(rdir.c_str(), S_IRWXU) < 0)
+    {
+        PLOG(ERROR) << "could not create export directory \"" << e::strescape(rdir) << "\"";
+        return false;
+    }
+
+    std::vector<e::compat::shared_ptr<column_writer> > columns;
+
+    for (size_t i = 0; i < sc->attrs_sz; ++i)
+    {
+        const std::string path(po6::path::join(rdir, std::string(sc->attrs[i].name) + ".col"));
+        columns.push_back(e::compat::shared_ptr<column_writer>(new column_writer(sc->attrs[i].type, m_compress)));
+
+        if (!columns.back()->open(path))
+        {
+            PLOG(ERROR) << "could not create column \"" << e::strescape(path) << "\"";
+            return false;
+        }
+    }
+
+    datalayer::snapshot snap = m_daemon->m_data.make_snapshot(ri);
+    std::vector<attribute_check> checks;
+    e::intrusive_ptr<datalayer::iterator> iter;
+    iter = m_daemon->m_data.make_search_iterator(snap, ri, checks, NULL);
+    datalayer::reference ref;
+    uint64_t count = 0;
+    uint64_t pending = 0;
+
+    while (iter->valid())
+    {
+        e::slice key;
+        std::vector<e::slice> value;
+        uint64_t version;
+        datalayer::returncode rc;
+        rc = m_daemon->m_data.get_from_iterator(ri, *sc, iter.get(), &key, &value, &version, &ref);
+
+        if (rc != datalayer::SUCCESS)
+        {
+            LOG(ERROR) << "could not read an object of " << ri << " for export: " << rc;
+            return false;
+        }
+
+        if (value.size() + 1 != columns.size())
+        {
+            LOG(ERROR) << "an object of " << ri << " does not match its schema";
+            return false;
+        }
+
+        bool appended = columns[0]->append(key);
+        pending += key.size();
+
+        for (size_t i = 0; appended && i < value.size(); ++i)
+        {
+            appended = columns[i + 1]->append(value[i]);
+            pending += value[i].size();
+        }
+
+        if (!appended)
+        {
+            PLOG(ERROR) << "could not write the columns of " << ri;
+            return false;
+        }
+
+        ++*objects;
+        iter->next();
+
+        if (++count % EXPORT_YIELD_OBJECTS == 0)
+        {
+            if (!yield(pending))
+            {
+                LOG(ERROR) << "export interrupted by shutdown";
+                return false;
+            }
+
+            pending = 0;
+            // the configuration may have changed while the export yielded;
+            // the snapshot has not
+            sc = m_daemon->config().get_schema(ri);
+
+            if (!sc)
+            {
+                LOG(ERROR) << "cannot finish exporting " << ri << " because it went away";
+                return false;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        if (!columns[i]->close())
+        {
+            PLOG(ERROR) << "could not finish the columns of " << ri;
+            return false;
+        }
+
+        *bytes += columns[i]->bytes();
+    }
+
+    return yield(pending);
+}
+
+bool
+export_thread :: yield(uint64_t bytes)
+{
+    m_written += bytes;
+    this->offline();
+
+    if (m_rate > 0)
+    {
+        const uint64_t due = m_start + static_cast<uint64_t>(m_written * 1e9 / m_rate);
+        uint64_t now;
+
+        while ((now = po6::monotonic_time()) < due && !shutting_down())
+        {
+            struct timespec ts;
+            ts.tv_sec = 0;
+            ts.tv_nsec = std::min(due - now, static_cast<uint64_t>(EXPORT_POLL_NANOS));
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    const bool ret = !shutting_down();
+    this->online();
+    return ret;
+}
+
+bool
+export_thread :: shutting_down()
+{
+    this->lock();
+    const bool ret = this->is_shutdown();
+    this->unlock();
+    return ret;
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_export_thread_h_
+#define hyperdex_daemon_export_thread_h_
+
+// STL
+#include <string>
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+#include "common/network_returncode.h"
+#include "daemon/background_thread.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Runs the exports that administrators ask for with EXPORT.  Each region of
+// the space that this server is the point leader for is read from a
+// snapshot and written beside the data directory as one column file per
+// attribute (see column_writer), so that every object is exported by
+// exactly one server and the export never passes through the client
+// protocol.  One export runs at a time.
+class export_thread : public background_thread
+{
+    public:
+        export_thread(daemon* d);
+        ~export_thread() throw ();
+
+    public:
+        virtual const char* thread_name();
+        virtual bool have_work();
+        virtual void copy_work();
+        virtual void do_work();
+
+    public:
+        // false if an export is already pending or running; "rate" is in
+        // bytes per second, and zero leaves the export unthrottled
+        bool enqueue(server_id from, virtual_server_id vto, uint64_t nonce,
+                     const std::string& space, const std::string& name,
+                     uint64_t rate, bool compress);
+
+    private:
+        network_returncode export_space(const std::string& dir,
+                                        uint64_t* objects, uint64_t* bytes);
+        bool export_region(const region_id& ri, const std::string& dir,
+                           uint64_t* objects, uint64_t* bytes);
+        // let a reconfiguration through and hold the export to its rate;
+        // false if the daemon is shutting down
+        bool yield(uint64_t bytes);
+        bool shutting_down();
+
+    private:
+        daemon* m_daemon;
+        // under lock
+        bool m_busy;
+        bool m_pending;
+        // set with m_pending; read by do_work
+        server_id m_from;
+        virtual_server_id m_vto;
+        uint64_t m_nonce;
+        std::string m_space;
+        std::string m_name;
+        uint64_t m_rate;
+        bool m_compress;
+        // pacing of the running export
+        uint64_t m_start;
+        uint64_t m_written;
+
+    private:
+        export_thread(const export_thread&);
+        export_thread& operator = (const export_thread&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_export_thread_h_
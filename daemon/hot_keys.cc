@@ -0,0 +1,179 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#define __STDC_LIMIT_MACROS
+
+// C
+#include <stdint.h>
+#include <string.h>
+
+// STL
+#include <algorithm>
+
+// po6
+#include <po6/time.h>
+
+// HyperDex
+#include "cityhash/city.h"
+#include "daemon/hot_keys.h"
+
+using hyperdex::hot_keys;
+
+// one in HOT_KEYS_SAMPLE touches is counted
+#define HOT_KEYS_SAMPLE 16
+// the sketch has HOT_KEYS_DEPTH rows of HOT_KEYS_WIDTH counters
+#define HOT_KEYS_DEPTH 4
+#define HOT_KEYS_WIDTH 4096
+// the keys kept as candidates for the top
+#define HOT_KEYS_TRACKED 64
+// how often every count halves
+#define HOT_KEYS_DECAY_NANOS 10000000000ULL
+
+namespace
+{
+
+__thread uint64_t s_countdown = 0;
+
+bool
+same(const hot_keys::entry& e, const hyperdex::region_id& ri, const e::slice& key)
+{
+    return e.region == ri &&
+           e.key.size() == key.size() &&
+           memcmp(e.key.data(), key.data(), key.size()) == 0;
+}
+
+bool
+hotter(const hot_keys::entry& lhs, const hot_keys::entry& rhs)
+{
+    return lhs.count > rhs.count;
+}
+
+} // namespace
+
+hot_keys :: hot_keys()
+    : m_mtx()
+    , m_sketch(HOT_KEYS_DEPTH * HOT_KEYS_WIDTH, 0)
+    , m_top()
+    , m_decayed_at(0)
+{
+}
+
+hot_keys :: ~hot_keys() throw ()
+{
+}
+
+void
+hot_keys :: touch(const region_id& ri, const e::slice& key)
+{
+    if (++s_countdown % HOT_KEYS_SAMPLE != 0)
+    {
+        return;
+    }
+
+    // the rows index by h1 + i * h2, two halves of one hash
+    const uint64_t h = CityHash64WithSeed(key.cdata(), key.size(), ri.get());
+    const uint64_t h1 = h & 0xffffffffULL;
+    const uint64_t h2 = (h >> 32) | 1;
+    const uint64_t now = po6::monotonic_time();
+    po6::threads::mutex::hold hold(&m_mtx);
+
+    if (now - m_decayed_at >= HOT_KEYS_DECAY_NANOS)
+    {
+        decay(now);
+    }
+
+    uint64_t estimate = UINT64_MAX;
+
+    for (uint64_t i = 0; i < HOT_KEYS_DEPTH; ++i)
+    {
+        uint64_t& c(m_sketch[i * HOT_KEYS_WIDTH + (h1 + i * h2) % HOT_KEYS_WIDTH]);
+        ++c;
+        estimate = std::min(estimate, c);
+    }
+
+    estimate *= HOT_KEYS_SAMPLE;
+    size_t coldest = 0;
+
+    for (size_t i = 0; i < m_top.size(); ++i)
+    {
+        if (same(m_top[i], ri, key))
+        {
+            m_top[i].count = estimate;
+            return;
+        }
+
+        if (m_top[i].count < m_top[coldest].count)
+        {
+            coldest = i;
+        }
+    }
+
+    if (m_top.size() < HOT_KEYS_TRACKED)
+    {
+        m_top.push_back(entry(ri, key, estimate));
+    }
+    else if (m_top[coldest].count < estimate)
+    {
+        m_top[coldest] = entry(ri, key, estimate);
+    }
+}
+
+void
+hot_keys :: top(std::vector<entry>* entries)
+{
+    {
+        po6::threads::mutex::hold hold(&m_mtx);
+        *entries = m_top;
+    }
+
+    std::sort(entries->begin(), entries->end(), hotter);
+}
+
+void
+hot_keys :: decay(uint64_t now)
+{
+    for (size_t i = 0; i < m_sketch.size(); ++i)
+    {
+        m_sketch[i] /= 2;
+    }
+
+    size_t kept = 0;
+
+    for (size_t i = 0; i < m_top.size(); ++i)
+    {
+        m_top[i].count /= 2;
+
+        if (m_top[i].count >= HOT_KEYS_SAMPLE)
+        {
+            m_top[kept] = m_top[i];
+            ++kept;
+        }
+    }
+
+    m_top.resize(kept);
+    m_decayed_at = now;
+}
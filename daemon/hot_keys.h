@@ -0,0 +1,91 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_hot_keys_h_
+#define hyperdex_daemon_hot_keys_h_
+
+// STL
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// e
+#include <e/slice.h>
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Finds the keys that gets and atomics touch most often.  A sample of the
+// touches feeds a count-min sketch of every (region, key) pair, and the pairs
+// the sketch rates highest are kept beside it.  Counts halve every few
+// seconds, so the keys reported are those hot now rather than ever.
+class hot_keys
+{
+    public:
+        struct entry
+        {
+            entry() : region(), key(), count(0) {}
+            entry(const region_id& r, const e::slice& k, uint64_t c)
+                : region(r), key(k.cdata(), k.size()), count(c) {}
+            region_id region;
+            std::string key;
+            // the estimated touches, scaled up from the sample
+            uint64_t count;
+        };
+
+    public:
+        hot_keys();
+        ~hot_keys() throw ();
+
+    // concurrent methods
+    public:
+        void touch(const region_id& ri, const e::slice& key);
+        // the hottest keys, hottest first
+        void top(std::vector<entry>* entries);
+
+    private:
+        void decay(uint64_t now);
+
+    private:
+        po6::threads::mutex m_mtx;
+        std::vector<uint64_t> m_sketch;
+        std::vector<entry> m_top;
+        uint64_t m_decayed_at;
+
+    private:
+        hot_keys(const hot_keys&);
+        hot_keys& operator = (const hot_keys&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_hot_keys_h_
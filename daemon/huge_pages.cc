@@ -0,0 +1,277 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <stdlib.h>
+#include <string.h>
+
+// POSIX
+#include <sys/mman.h>
+
+// Google Log
+#include <glog/logging.h>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// HyperDex
+#include "daemon/huge_pages.h"
+
+using hyperdex::huge_pages;
+
+// regions are mapped in multiples of, and aligned to, this size
+#define HUGE_PAGE_BYTES (2ULL * 1024ULL * 1024ULL)
+// small blocks are carved from regions of this size
+#define HUGE_PAGE_REGION_BYTES (64ULL * 1024ULL * 1024ULL)
+// block sizes are powers of two from 2^HUGE_PAGE_MIN_SHIFT to
+// 2^HUGE_PAGE_MAX_SHIFT; larger blocks get huge pages of their own
+#define HUGE_PAGE_MIN_SHIFT 4
+#define HUGE_PAGE_MAX_SHIFT 18
+#define HUGE_PAGE_CLASSES (HUGE_PAGE_MAX_SHIFT - HUGE_PAGE_MIN_SHIFT + 1)
+
+huge_pages::mode huge_pages::s_mode = huge_pages::NONE;
+
+namespace
+{
+
+struct free_block
+{
+    free_block* next;
+};
+
+struct size_class
+{
+    size_class() : mtx(), free(NULL) {}
+    po6::threads::mutex mtx;
+    free_block* free;
+
+    private:
+        size_class(const size_class&);
+        size_class& operator = (const size_class&);
+};
+
+size_class s_classes[HUGE_PAGE_CLASSES];
+// the region small blocks are being carved from
+po6::threads::mutex s_region_mtx;
+char* s_region = NULL;
+size_t s_region_left = 0;
+uint64_t s_mapped = 0;
+int s_warned = 0;
+
+size_t
+round_to_pages(size_t sz)
+{
+    return (sz + HUGE_PAGE_BYTES - 1) & ~(HUGE_PAGE_BYTES - 1);
+}
+
+unsigned
+class_of(size_t sz)
+{
+    unsigned c = 0;
+
+    while ((size_t(1) << (c + HUGE_PAGE_MIN_SHIFT)) < sz)
+    {
+        ++c;
+    }
+
+    return c;
+}
+
+// "sz" is a multiple of HUGE_PAGE_BYTES
+void*
+map_pages(size_t sz)
+{
+#ifdef MAP_HUGETLB
+    if (huge_pages::configured() == huge_pages::EXPLICIT)
+    {
+        void* ptr = mmap(NULL, sz, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (ptr != MAP_FAILED)
+        {
+            __sync_add_and_fetch(&s_mapped, sz);
+            return ptr;
+        }
+
+        if (!__sync_lock_test_and_set(&s_warned, 1))
+        {
+            LOG(WARNING) << "the huge pages reserved in /proc/sys/vm/nr_hugepages "
+                         << "have run out; asking for transparent huge pages instead";
+        }
+    }
+#endif
+
+    // over-map by a page so that the region may start on a page boundary
+    char* base = static_cast<char*>(mmap(NULL, sz + HUGE_PAGE_BYTES, PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+
+    char* ptr = reinterpret_cast<char*>(round_to_pages(reinterpret_cast<size_t>(base)));
+
+    if (ptr > base)
+    {
+        munmap(base, ptr - base);
+    }
+
+    if (base + sz + HUGE_PAGE_BYTES > ptr + sz)
+    {
+        munmap(ptr + sz, base + sz + HUGE_PAGE_BYTES - (ptr + sz));
+    }
+
+#ifdef MADV_HUGEPAGE
+    madvise(ptr, sz, MADV_HUGEPAGE);
+#endif
+    __sync_add_and_fetch(&s_mapped, sz);
+    return ptr;
+}
+
+} // namespace
+
+bool
+huge_pages :: configure(const char* name)
+{
+    if (strcmp(name, "none") == 0)
+    {
+        s_mode = NONE;
+    }
+    else if (strcmp(name, "transparent") == 0)
+    {
+        s_mode = TRANSPARENT;
+    }
+    else if (strcmp(name, "explicit") == 0)
+    {
+        s_mode = EXPLICIT;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+void*
+huge_pages :: allocate(size_t sz)
+{
+    if (s_mode == NONE)
+    {
+        void* ptr = malloc(sz > 0 ? sz : 1);
+
+        if (!ptr)
+        {
+            throw std::bad_alloc();
+        }
+
+        return ptr;
+    }
+
+    if (sz > (size_t(1) << HUGE_PAGE_MAX_SHIFT))
+    {
+        void* ptr = map_pages(round_to_pages(sz));
+
+        if (!ptr)
+        {
+            throw std::bad_alloc();
+        }
+
+        return ptr;
+    }
+
+    const unsigned c = class_of(sz);
+    const size_t block_sz = size_t(1) << (c + HUGE_PAGE_MIN_SHIFT);
+
+    {
+        po6::threads::mutex::hold hold(&s_classes[c].mtx);
+        free_block* b = s_classes[c].free;
+
+        if (b)
+        {
+            s_classes[c].free = b->next;
+            return b;
+        }
+    }
+
+    po6::threads::mutex::hold hold(&s_region_mtx);
+
+    // the tail of the last region, less than the largest block, is left over
+    if (s_region_left < block_sz)
+    {
+        s_region = static_cast<char*>(map_pages(HUGE_PAGE_REGION_BYTES));
+
+        if (!s_region)
+        {
+            s_region_left = 0;
+            throw std::bad_alloc();
+        }
+
+        s_region_left = HUGE_PAGE_REGION_BYTES;
+    }
+
+    // blocks are multiples of 16 bytes, so each is as aligned as malloc's
+    void* ptr = s_region;
+    s_region += block_sz;
+    s_region_left -= block_sz;
+    return ptr;
+}
+
+void
+huge_pages :: deallocate(void* ptr, size_t sz)
+{
+    if (!ptr)
+    {
+        return;
+    }
+
+    if (s_mode == NONE)
+    {
+        free(ptr);
+        return;
+    }
+
+    if (sz > (size_t(1) << HUGE_PAGE_MAX_SHIFT))
+    {
+        munmap(ptr, round_to_pages(sz));
+        __sync_sub_and_fetch(&s_mapped, round_to_pages(sz));
+        return;
+    }
+
+    const unsigned c = class_of(sz);
+    free_block* b = static_cast<free_block*>(ptr);
+    po6::threads::mutex::hold hold(&s_classes[c].mtx);
+    b->next = s_classes[c].free;
+    s_classes[c].free = b;
+}
+
+uint64_t
+huge_pages :: mapped()
+{
+    return __sync_add_and_fetch(&s_mapped, 0);
+}
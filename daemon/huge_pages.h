@@ -0,0 +1,128 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_huge_pages_h_
+#define hyperdex_daemon_huge_pages_h_
+
+// C
+#include <stddef.h>
+#include <stdint.h>
+
+// STL
+#include <limits>
+#include <new>
+#include <string>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Memory for the daemon's large caches, taken from huge pages so that reading
+// them costs fewer TLB misses.  Blocks are carved from big regions mapped
+// either with MAP_HUGETLB, which draws on the pages reserved in
+// /proc/sys/vm/nr_hugepages, or as ordinary memory the kernel is asked to
+// back with transparent huge pages.  Small blocks are rounded up to a power
+// of two and recycled within their size; freed memory stays with the daemon.
+// Until "configure" picks a mode, every block comes straight from malloc.
+class huge_pages
+{
+    public:
+        enum mode
+        {
+            NONE,
+            TRANSPARENT,
+            EXPLICIT
+        };
+
+    public:
+        // call once, before anything is allocated; false if "name" is not
+        // one of "none", "transparent" or "explicit"
+        static bool configure(const char* name);
+        static mode configured() { return s_mode; }
+        static void* allocate(size_t sz);
+        // "sz" must be what was passed to allocate
+        static void deallocate(void* ptr, size_t sz);
+        // bytes mapped for huge pages
+        static uint64_t mapped();
+
+    private:
+        static mode s_mode;
+};
+
+// An STL allocator over huge_pages
+template <typename T>
+class huge_page_allocator
+{
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef size_t size_type;
+        typedef ptrdiff_t difference_type;
+        template <typename U> struct rebind { typedef huge_page_allocator<U> other; };
+
+    public:
+        huge_page_allocator() throw () {}
+        huge_page_allocator(const huge_page_allocator&) throw () {}
+        template <typename U> huge_page_allocator(const huge_page_allocator<U>&) throw () {}
+        ~huge_page_allocator() throw () {}
+
+    public:
+        pointer address(reference x) const { return &x; }
+        const_pointer address(const_reference x) const { return &x; }
+        pointer allocate(size_type n, const void* = 0)
+        { return static_cast<pointer>(huge_pages::allocate(n * sizeof(T))); }
+        void deallocate(pointer p, size_type n)
+        { huge_pages::deallocate(p, n * sizeof(T)); }
+        size_type max_size() const throw ()
+        { return std::numeric_limits<size_type>::max() / sizeof(T); }
+        void construct(pointer p, const T& val) { new (p) T(val); }
+        void destroy(pointer p) { p->~T(); }
+};
+
+template <typename T, typename U>
+inline bool
+operator == (const huge_page_allocator<T>&, const huge_page_allocator<U>&)
+{
+    return true;
+}
+
+template <typename T, typename U>
+inline bool
+operator != (const huge_page_allocator<T>&, const huge_page_allocator<U>&)
+{
+    return false;
+}
+
+typedef std::basic_string<char, std::char_traits<char>, huge_page_allocator<char> > huge_string;
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_huge_pages_h_
@@ -25,75 +25,214 @@
 // ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 // POSSIBILITY OF SUCH DAMAGE.
 
+// C
+#include <stdlib.h>
+
 // STL
 #include <algorithm>
 
+// po6
+#include <po6/threads/mutex.h>
+
 // e
 #include <e/atomic.h>
 
 // HyperDex
 #include "daemon/identifier_generator.h"
+#include "daemon/thread_stripe.h"
 
 using namespace e::atomic;
 using hyperdex::identifier_generator;
 using hyperdex::region_id;
 
+const size_t identifier_generator::STRIPES;
+const uint64_t identifier_generator::LEASE;
 const region_id identifier_generator::defaultri;
 
-identifier_generator :: identifier_generator()
-    : m_generators()
+// one region's identifiers; the shared counter is touched once per lease
+class identifier_generator::generator
+{
+    public:
+        generator(uint64_t next);
+        ~generator() throw ();
+
+    public:
+        void bump(uint64_t id);
+        uint64_t peek();
+        uint64_t handed_out();
+        uint64_t generate(uint64_t floor, uint64_t* lease);
+
+    private:
+        // identifiers [next, limit) are leased to the stripe, which has
+        // handed out "handed" identifiers in all
+        struct stripe
+        {
+            stripe() : mtx(), next(0), limit(0), handed(0) {}
+            po6::threads::mutex mtx;
+            uint64_t next;
+            uint64_t limit;
+            uint64_t handed;
+            char pad[64];
+        };
+
+    private:
+        void raise(uint64_t id);
+
+    private:
+        // the first identifier not yet leased
+        uint64_t m_counter;
+        // where handed_out starts, so that a generator built from another's
+        // peek never counts back to a value the other one gave
+        const uint64_t m_base;
+        char m_pad[64];
+        stripe m_stripes[STRIPES];
+
+    private:
+        generator(const generator&);
+        generator& operator = (const generator&);
+};
+
+identifier_generator :: generator :: generator(uint64_t next)
+    : m_counter(next)
+    , m_base(next)
 {
 }
 
-identifier_generator :: ~identifier_generator() throw ()
+identifier_generator :: generator :: ~generator() throw ()
 {
 }
 
-bool
-identifier_generator :: bump(const region_id& ri, uint64_t id)
+void
+identifier_generator :: generator :: bump(uint64_t id)
 {
-    uint64_t* val = NULL;
+    raise(id);
 
-    if (!m_generators.mod(ri, &val))
+    // a lease taken once the stripe is passed comes after the raise
+    for (size_t i = 0; i < STRIPES; ++i)
     {
-        return false;
+        stripe* s = &m_stripes[i];
+        po6::threads::mutex::hold hold(&s->mtx);
+
+        if (s->next <= id)
+        {
+            s->next = std::min(id + 1, s->limit);
+        }
     }
+}
 
-    uint64_t count = load_64_nobarrier(val);
+uint64_t
+identifier_generator :: generator :: peek()
+{
+    memory_barrier();
+    const uint64_t count = load_64_nobarrier(&m_counter);
+    memory_barrier();
 
-    while (count <= id)
+    // a lease taken once the stripe is passed starts at "count" or later
+    for (size_t i = 0; i < STRIPES; ++i)
     {
-        count = e::atomic::compare_and_swap_64_nobarrier(val, count, id + 1);
+        stripe* s = &m_stripes[i];
+        po6::threads::mutex::hold hold(&s->mtx);
+        s->next = s->limit;
     }
 
-    return true;
+    return count;
 }
 
 uint64_t
-identifier_generator :: peek(const region_id& ri) const
+identifier_generator :: generator :: handed_out()
 {
-    e::atomic::memory_barrier();
-    uint64_t val = 0;
+    // each stripe's count only grows, so two equal sums mean no stripe
+    // handed out an identifier in between
+    memory_barrier();
+    uint64_t handed = m_base;
 
-    if (!m_generators.get(ri, &val))
+    for (size_t i = 0; i < STRIPES; ++i)
     {
-        abort();
+        handed += load_64_nobarrier(&m_stripes[i].handed);
     }
 
-    return val;
+    memory_barrier();
+    return handed;
 }
 
 uint64_t
-identifier_generator :: generate_id(const region_id& ri)
+identifier_generator :: generator :: generate(uint64_t floor, uint64_t* lease)
 {
-    uint64_t* val = NULL;
+    stripe* s = &m_stripes[thread_stripe() % STRIPES];
+    po6::threads::mutex::hold hold(&s->mtx);
+    *lease = 0;
 
-    if (!m_generators.mod(ri, &val))
+    // what is left of the lease is given up when it cannot go above floor
+    if (s->next >= s->limit || s->next <= floor)
     {
-        abort();
+        raise(floor);
+        s->next = increment_64_nobarrier(&m_counter, LEASE) - LEASE;
+        s->limit = s->next + LEASE;
+        *lease = s->limit - 1;
     }
 
-    return e::atomic::increment_64_nobarrier(val, 1) - 1;
+    store_64_nobarrier(&s->handed, s->handed + 1);
+    return s->next++;
+}
+
+void
+identifier_generator :: generator :: raise(uint64_t id)
+{
+    uint64_t count = load_64_nobarrier(&m_counter);
+
+    while (count <= id)
+    {
+        count = compare_and_swap_64_nobarrier(&m_counter, count, id + 1);
+    }
+}
+
+identifier_generator :: identifier_generator()
+    : m_generators()
+    , m_regions()
+{
+}
+
+identifier_generator :: ~identifier_generator() throw ()
+{
+}
+
+bool
+identifier_generator :: bump(const region_id& ri, uint64_t id)
+{
+    e::compat::shared_ptr<generator>* g = NULL;
+
+    if (!m_generators.mod(ri, &g))
+    {
+        return false;
+    }
+
+    (*g)->bump(id);
+    return true;
+}
+
+uint64_t
+identifier_generator :: peek(const region_id& ri) const
+{
+    return get(ri)->peek();
+}
+
+uint64_t
+identifier_generator :: handed_out(const region_id& ri) const
+{
+    return get(ri)->handed_out();
+}
+
+uint64_t
+identifier_generator :: generate_id(const region_id& ri)
+{
+    uint64_t lease;
+    return get(ri)->generate(0, &lease);
+}
+
+uint64_t
+identifier_generator :: generate_id(const region_id& ri, uint64_t floor, uint64_t* lease)
+{
+    return get(ri)->generate(floor, lease);
 }
 
 void
@@ -103,21 +242,48 @@ identifier_generator :: adopt(region_id* ris, size_t ris_sz)
 
     for (size_t i = 0; i < ris_sz; ++i)
     {
-        uint64_t count = 0;
+        e::compat::shared_ptr<generator> g;
 
-        if (!m_generators.get(ris[i], &count))
+        if (!m_generators.get(ris[i], &g))
         {
-            count = 1;
+            g = e::compat::shared_ptr<generator>(new generator(1));
         }
 
-        new_generators.put(ris[i], count);
+        new_generators.put(ris[i], g);
     }
 
     m_generators.swap(&new_generators);
+    m_regions.assign(ris, ris + ris_sz);
 }
 
 void
 identifier_generator :: copy_from(const identifier_generator& ig)
 {
-    m_generators.copy_from(ig.m_generators);
+    generator_map_t new_generators;
+
+    // the copy starts where the original would hand out identifiers next,
+    // with nothing leased
+    for (size_t i = 0; i < ig.m_regions.size(); ++i)
+    {
+        const uint64_t next = ig.get(ig.m_regions[i])->peek();
+        new_generators.put(ig.m_regions[i], e::compat::shared_ptr<generator>(new generator(next)));
+    }
+
+    m_generators.swap(&new_generators);
+    m_regions = ig.m_regions;
+}
+
+identifier_generator::generator*
+identifier_generator :: get(const region_id& ri) const
+{
+    // mod hands out the stored pointer without touching its reference count,
+    // which every thread generating for the region would otherwise share
+    e::compat::shared_ptr<generator>* g = NULL;
+
+    if (!const_cast<generator_map_t&>(m_generators).mod(ri, &g))
+    {
+        abort();
+    }
+
+    return g->get();
 }
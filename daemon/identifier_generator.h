@@ -28,8 +28,16 @@
 #ifndef hyperdex_daemon_identifier_generator_h_
 #define hyperdex_daemon_identifier_generator_h_
 
+// C
+#include <stddef.h>
+#include <stdint.h>
+
+// STL
+#include <vector>
+
 // e
 #include <e/ao_hash_map.h>
+#include <e/compat.h>
 
 // HyperDex
 #include "namespace.h"
@@ -37,8 +45,18 @@
 
 BEGIN_HYPERDEX_NAMESPACE
 
+// Hands out increasing identifiers for each region.  So that the threads
+// writing to a hot region do not all contend for one counter, each stripe of
+// threads leases LEASE identifiers at a time and hands them out without
+// touching the shared counter.  Identifiers handed out for a region are
+// therefore unique, but only increase within a stripe; callers that need
+// them to increase for a key say so with "floor".
 class identifier_generator
 {
+    public:
+        const static size_t STRIPES = 16;
+        const static uint64_t LEASE = 64;
+
     public:
         identifier_generator();
         ~identifier_generator() throw ();
@@ -48,10 +66,19 @@ class identifier_generator
     public:
         // ensure that new identifiers are strictly greater than "id"
         bool bump(const region_id& ri, uint64_t id);
-        // look at the next identifier, and store it in "id"
+        // look at the next identifier, and store it in "id"; identifiers
+        // leased but not yet handed out are given up, so every identifier
+        // generated after this returns is at least the one it returns
         uint64_t peek(const region_id& ri) const;
+        // a count that moves each time an identifier for the region is
+        // handed out; unlike peek, reading it leaves the leases alone
+        uint64_t handed_out(const region_id& ri) const;
         // generate one unique identifier, and store it in "id"
         uint64_t generate_id(const region_id& ri);
+        // like generate_id, but greater than "floor".  When this leases new
+        // identifiers to do so, the last of them is stored in "*lease",
+        // else 0.
+        uint64_t generate_id(const region_id& ri, uint64_t floor, uint64_t* lease);
 
     // external synchronization required; nothing can call other methods during
     // adopt; copy_from must be mutually exclusive with adopt on either
@@ -61,14 +88,17 @@ class identifier_generator
         void copy_from(const identifier_generator&);
 
     private:
+        class generator;
         identifier_generator(const identifier_generator&);
         identifier_generator& operator = (const identifier_generator&);
         static uint64_t hashid(region_id ri) { return ri.get(); }
+        generator* get(const region_id& ri) const;
 
     private:
         const static region_id defaultri;
-        typedef e::ao_hash_map<region_id, uint64_t, hashid, defaultri> generator_map_t;
+        typedef e::ao_hash_map<region_id, e::compat::shared_ptr<generator>, hashid, defaultri> generator_map_t;
         generator_map_t m_generators;
+        std::vector<region_id> m_regions;
 };
 
 END_HYPERDEX_NAMESPACE
@@ -0,0 +1,535 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// C
+#include <cassert>
+#include <cstring>
+
+// STL
+#include <algorithm>
+#include <string>
+
+// e
+#include <e/endian.h>
+#include <e/varint.h>
+
+// HyperDex
+#include "daemon/datalayer_encodings.h"
+#include "daemon/datalayer_iterator.h"
+#include "daemon/index_composite.h"
+
+// a string component ends with this pair; zero bytes within the string are
+// escaped to 0x00 0xff so that the pair sorts before any continuation
+#define COMPOSITE_STRING_END 0x01
+#define COMPOSITE_STRING_ESCAPE 0xff
+
+using hyperdex::datalayer;
+using hyperdex::index_encoding;
+using hyperdex::leveldb_snapshot_ptr;
+
+inline leveldb::Slice e2level(const e::slice& s) { return leveldb::Slice(reinterpret_cast<const char*>(s.data()), s.size()); }
+inline leveldb::Slice str2level(const std::string& s) { return leveldb::Slice(s.data(), s.size()); }
+
+namespace
+{
+
+void
+encode_prefix(const hyperdex::region_id& ri,
+              const hyperdex::index_id& ii,
+              std::string* out)
+{
+    size_t sz = sizeof(uint8_t)
+              + e::varint_length(ri.get())
+              + e::varint_length(ii.get());
+    out->resize(sz);
+    char* ptr = &(*out)[0];
+    ptr = e::pack8be('i', ptr);
+    ptr = e::packvarint64(ri.get(), ptr);
+    ptr = e::packvarint64(ii.get(), ptr);
+    assert(ptr == &(*out)[0] + sz);
+}
+
+void
+encode_component(hyperdatatype t, const e::slice& value, std::string* out)
+{
+    if (t == HYPERDATATYPE_STRING)
+    {
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            out->push_back(static_cast<char>(value.data()[i]));
+
+            if (value.data()[i] == 0)
+            {
+                out->push_back(static_cast<char>(COMPOSITE_STRING_ESCAPE));
+            }
+        }
+
+        out->push_back('\0');
+        out->push_back(static_cast<char>(COMPOSITE_STRING_END));
+        return;
+    }
+
+    const index_encoding* ie = index_encoding::lookup(t);
+    assert(ie->encoding_fixed());
+    size_t off = out->size();
+    out->resize(off + ie->encoded_size(value));
+    ie->encode(value, &(*out)[off]);
+}
+
+// the size of the component at the start of [ptr, end), or 0 if malformed
+size_t
+component_size(hyperdatatype t, const char* ptr, const char* end)
+{
+    if (t == HYPERDATATYPE_STRING)
+    {
+        const char* p = ptr;
+
+        while (p + 1 < end)
+        {
+            if (*p != '\0')
+            {
+                ++p;
+            }
+            else if (static_cast<uint8_t>(p[1]) == COMPOSITE_STRING_ESCAPE)
+            {
+                p += 2;
+            }
+            else if (static_cast<uint8_t>(p[1]) == COMPOSITE_STRING_END)
+            {
+                return p + 2 - ptr;
+            }
+            else
+            {
+                return 0;
+            }
+        }
+
+        return 0;
+    }
+
+    size_t sz = index_encoding::lookup(t)->encoded_size(e::slice());
+    return sz <= static_cast<size_t>(end - ptr) ? sz : 0;
+}
+
+void
+encode_entry(const hyperdex::schema& sc,
+             const hyperdex::index& idx,
+             const hyperdex::region_id& ri,
+             const index_encoding* key_ie,
+             const e::slice& key,
+             const std::vector<e::slice>& value,
+             std::string* out)
+{
+    encode_prefix(ri, idx.id, out);
+
+    for (size_t i = 0; i < idx.composite_sz(); ++i)
+    {
+        const uint16_t attr = idx.composite(i);
+        assert(attr > 0 && attr < sc.attrs_sz);
+        encode_component(sc.attrs[attr].type, value[attr - 1], out);
+    }
+
+    // the components delimit themselves, so the key needs no length suffix
+    size_t off = out->size();
+    out->resize(off + key_ie->encoded_size(key));
+    key_ie->encode(key, &(*out)[off]);
+}
+
+class composite_index_iterator : public datalayer::index_iterator
+{
+    public:
+        composite_index_iterator(leveldb_snapshot_ptr snap,
+                                 const std::string& prefix,
+                                 const std::string* start,
+                                 const std::string* end,
+                                 const std::vector<hyperdatatype>& suffix,
+                                 const index_encoding* key_ie);
+        virtual ~composite_index_iterator() throw ();
+
+    public:
+        virtual bool valid();
+        virtual void next();
+        virtual uint64_t cost(leveldb::DB*);
+        virtual e::slice key();
+        virtual std::ostream& describe(std::ostream&) const;
+        virtual e::slice internal_key();
+        virtual bool sorted();
+        virtual void seek(const e::slice& internal_key);
+        virtual double progress(leveldb::DB*);
+
+    private:
+        composite_index_iterator(const composite_index_iterator&);
+        composite_index_iterator& operator = (const composite_index_iterator&);
+
+    private:
+        hyperdex::leveldb_iterator_ptr m_iter;
+        // every entry shares this prefix: the index and the equal components
+        std::string m_prefix;
+        std::string m_lower;
+        std::string m_end;
+        bool m_has_end;
+        // the types of the components that follow m_prefix
+        std::vector<hyperdatatype> m_suffix;
+        const index_encoding *const m_key_ie;
+        std::vector<char> m_scratch;
+        bool m_invalid;
+        uint64_t m_cost;
+        bool m_has_cost;
+};
+
+composite_index_iterator :: composite_index_iterator(leveldb_snapshot_ptr s,
+                                                     const std::string& prefix,
+                                                     const std::string* start,
+                                                     const std::string* end,
+                                                     const std::vector<hyperdatatype>& suffix,
+                                                     const index_encoding* key_ie)
+    : index_iterator(s)
+    , m_iter()
+    , m_prefix(prefix)
+    , m_lower(prefix)
+    , m_end()
+    , m_has_end(end != NULL)
+    , m_suffix(suffix)
+    , m_key_ie(key_ie)
+    , m_scratch()
+    , m_invalid(false)
+    , m_cost(0)
+    , m_has_cost(false)
+{
+    leveldb::ReadOptions opts;
+    opts.fill_cache = true;
+    opts.verify_checksums = true;
+    opts.snapshot = s.get();
+    m_iter.reset(s, s.db()->NewIterator(opts));
+
+    if (start)
+    {
+        m_lower += *start;
+    }
+
+    if (end)
+    {
+        m_end = *end;
+    }
+
+    m_iter->Seek(str2level(m_lower));
+    ++m_exec.seeks;
+}
+
+composite_index_iterator :: ~composite_index_iterator() throw ()
+{
+}
+
+bool
+composite_index_iterator :: valid()
+{
+    if (m_invalid || !m_iter->Valid())
+    {
+        return false;
+    }
+
+    leveldb::Slice k = m_iter->key();
+
+    if (!k.starts_with(str2level(m_prefix)))
+    {
+        m_invalid = true;
+        return false;
+    }
+
+    if (m_has_end)
+    {
+        // entries are sorted, so the first one past the end ends the scan
+        const char* ptr = k.data() + m_prefix.size();
+        const char* end = k.data() + k.size();
+        size_t sz = component_size(m_suffix[0], ptr, end);
+
+        if (sz == 0)
+        {
+            m_invalid = true;
+            return false;
+        }
+
+        int cmp = memcmp(ptr, m_end.data(), std::min(sz, m_end.size()));
+
+        if (cmp > 0 || (cmp == 0 && sz > m_end.size()))
+        {
+            m_invalid = true;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void
+composite_index_iterator :: next()
+{
+    ++m_exec.examined;
+    m_exec.bytes += m_iter->key().size() + m_iter->value().size();
+    m_iter->Next();
+}
+
+uint64_t
+composite_index_iterator :: cost(leveldb::DB* db)
+{
+    if (m_has_cost)
+    {
+        return m_cost;
+    }
+
+    std::string upper(m_prefix + m_end);
+    hyperdex::encode_bump(&upper[0], &upper[0] + upper.size());
+    leveldb::Range r;
+    r.start = str2level(m_lower);
+    r.limit = str2level(upper);
+    db->GetApproximateSizes(&r, 1, &m_cost);
+    m_has_cost = true;
+    return m_cost;
+}
+
+e::slice
+composite_index_iterator :: key()
+{
+    e::slice ik = this->internal_key();
+    size_t decoded_sz = m_key_ie->decoded_size(ik);
+
+    if (m_scratch.size() < decoded_sz)
+    {
+        m_scratch.resize(decoded_sz);
+    }
+
+    m_key_ie->decode(ik, &m_scratch.front());
+    return e::slice(&m_scratch.front(), decoded_sz);
+}
+
+std::ostream&
+composite_index_iterator :: describe(std::ostream& out) const
+{
+    return out << "composite_iterator()";
+}
+
+e::slice
+composite_index_iterator :: internal_key()
+{
+    leveldb::Slice k = m_iter->key();
+    const char* ptr = k.data() + m_prefix.size();
+    const char* end = k.data() + k.size();
+
+    for (size_t i = 0; i < m_suffix.size(); ++i)
+    {
+        size_t sz = component_size(m_suffix[i], ptr, end);
+        ptr += sz;
+
+        if (sz == 0)
+        {
+            return e::slice();
+        }
+    }
+
+    return e::slice(ptr, end - ptr);
+}
+
+bool
+composite_index_iterator :: sorted()
+{
+    // with every component fixed, the entries are in key order
+    return m_suffix.empty();
+}
+
+void
+composite_index_iterator :: seek(const e::slice& ik)
+{
+    assert(m_suffix.empty());
+    std::string target(m_prefix);
+    target.append(reinterpret_cast<const char*>(ik.data()), ik.size());
+    m_iter->Seek(str2level(target));
+    ++m_exec.seeks;
+}
+
+double
+composite_index_iterator :: progress(leveldb::DB* db)
+{
+    if (!m_iter->Valid())
+    {
+        return 1;
+    }
+
+    std::string upper(m_prefix + m_end);
+    hyperdex::encode_bump(&upper[0], &upper[0] + upper.size());
+    leveldb::Range r[2];
+    r[0].start = str2level(m_lower);
+    r[0].limit = m_iter->key();
+    r[1].start = str2level(m_lower);
+    r[1].limit = str2level(upper);
+    uint64_t sizes[2];
+    db->GetApproximateSizes(r, 2, sizes);
+
+    if (sizes[1] == 0)
+    {
+        return 0;
+    }
+
+    return std::min(1.0, double(sizes[0]) / double(sizes[1]));
+}
+
+} // namespace
+
+void
+hyperdex :: composite_index_changes(const schema& sc,
+                                    const index& idx,
+                                    const region_id& ri,
+                                    const index_encoding* key_ie,
+                                    const e::slice& key,
+                                    const std::vector<e::slice>* old_value,
+                                    const std::vector<e::slice>* new_value,
+                                    leveldb::WriteBatch* updates)
+{
+    if (old_value && new_value)
+    {
+        bool unchanged = true;
+
+        for (size_t i = 0; unchanged && i < idx.composite_sz(); ++i)
+        {
+            const uint16_t attr = idx.composite(i);
+            unchanged = (*old_value)[attr - 1] == (*new_value)[attr - 1];
+        }
+
+        if (unchanged)
+        {
+            return;
+        }
+    }
+
+    std::string old_entry;
+    std::string new_entry;
+
+    if (old_value)
+    {
+        encode_entry(sc, idx, ri, key_ie, key, *old_value, &old_entry);
+    }
+
+    if (new_value)
+    {
+        encode_entry(sc, idx, ri, key_ie, key, *new_value, &new_entry);
+    }
+
+    if (old_value && new_value && old_entry == new_entry)
+    {
+        return;
+    }
+
+    if (old_value)
+    {
+        updates->Delete(str2level(old_entry));
+    }
+
+    if (new_value)
+    {
+        updates->Put(str2level(new_entry), leveldb::Slice());
+    }
+}
+
+datalayer::index_iterator*
+hyperdex :: composite_iterator(leveldb_snapshot_ptr snap,
+                               const schema& sc,
+                               const region_id& ri,
+                               const index& idx,
+                               const std::vector<range>& ranges,
+                               const index_encoding* key_ie,
+                               size_t* constrained)
+{
+    std::string prefix;
+    encode_prefix(ri, idx.id, &prefix);
+    const range* bound = NULL;
+    size_t equal = 0;
+
+    // extend the prefix with each leading attribute an equality fixes, and
+    // stop at the first one that is a range or unconstrained
+    for (; equal < idx.composite_sz(); ++equal)
+    {
+        const uint16_t attr = idx.composite(equal);
+        const range* r = NULL;
+
+        for (size_t i = 0; !r && i < ranges.size(); ++i)
+        {
+            if (ranges[i].attr == attr && !ranges[i].invalid &&
+                ranges[i].type == sc.attrs[attr].type)
+            {
+                r = &ranges[i];
+            }
+        }
+
+        if (!r)
+        {
+            break;
+        }
+
+        if (r->has_start && r->has_end && r->start == r->end)
+        {
+            encode_component(sc.attrs[attr].type, r->start, &prefix);
+            continue;
+        }
+
+        bound = r;
+        break;
+    }
+
+    if (equal == 0 && !bound)
+    {
+        return NULL;
+    }
+
+    std::vector<hyperdatatype> suffix;
+
+    for (size_t i = equal; i < idx.composite_sz(); ++i)
+    {
+        suffix.push_back(sc.attrs[idx.composite(i)].type);
+    }
+
+    std::string start;
+    std::string end;
+
+    if (bound && bound->has_start)
+    {
+        encode_component(bound->type, bound->start, &start);
+    }
+
+    if (bound && bound->has_end)
+    {
+        encode_component(bound->type, bound->end, &end);
+    }
+
+    *constrained = equal + (bound ? 1 : 0);
+    return new composite_index_iterator(snap, prefix,
+                                        bound && bound->has_start ? &start : NULL,
+                                        bound && bound->has_end ? &end : NULL,
+                                        suffix, key_ie);
+}
@@ -82,11 +82,10 @@ index_container :: index_changes(const index* idx,
     while (old_idx < old_elems.size() &&
            new_idx < new_elems.size())
     {
+        // elements in both containers keep their entries; only those added
+        // or removed change the index
         if (old_elems[old_idx] == new_elems[new_idx])
         {
-            ii->index_changes(idx, ri, key_ie, key,
-                              &old_elems[old_idx], &new_elems[new_idx],
-                              updates);
             ++old_idx;
             ++new_idx;
         }
@@ -29,6 +29,10 @@
 #include "config.h"
 #endif
 
+// STL
+#include <algorithm>
+#include <memory>
+
 // e
 #include <e/endian.h>
 #include <e/guard.h>
@@ -69,27 +73,94 @@ index_document :: index_changes(const index* idx,
                                 const e::slice* new_document,
                                 leveldb::WriteBatch* updates) const
 {
-    type_t t;
-    std::vector<char> scratch_value;
-    e::slice value;
+    if (old_document && new_document && *old_document == *new_document)
+    {
+        return;
+    }
+
+    std::auto_ptr<datatype_document::reader> old_doc;
+    std::auto_ptr<datatype_document::reader> new_doc;
+    std::list<std::string> numbers;
+    std::vector<value_t> old_values;
+    std::vector<value_t> new_values;
+
+    if (old_document)
+    {
+        old_doc.reset(new datatype_document::reader(&m_di, *old_document));
+        parse_values(idx, old_doc.get(), &numbers, &old_values);
+    }
+
+    if (new_document)
+    {
+        new_doc.reset(new datatype_document::reader(&m_di, *new_document));
+        parse_values(idx, new_doc.get(), &numbers, &new_values);
+    }
+
     std::vector<char> scratch_entry;
     e::slice entry;
+    size_t old_idx = 0;
+    size_t new_idx = 0;
 
-    if (old_document && new_document && *old_document == *new_document)
+    // values in both documents keep their entries, so a document that
+    // changed somewhere other than the indexed path writes nothing
+    while (old_idx < old_values.size() || new_idx < new_values.size())
     {
-        return;
+        if (old_idx < old_values.size() && new_idx < new_values.size() &&
+            old_values[old_idx] == new_values[new_idx])
+        {
+            ++old_idx;
+            ++new_idx;
+        }
+        else if (new_idx >= new_values.size() ||
+                 (old_idx < old_values.size() &&
+                  old_values[old_idx] < new_values[new_idx]))
+        {
+            const value_t& v(old_values[old_idx]);
+            index_entry(ri, idx->id, v.first, key_ie, key, v.second, &scratch_entry, &entry);
+            updates->Delete(leveldb::Slice(reinterpret_cast<const char*>(entry.data()), entry.size()));
+            ++old_idx;
+        }
+        else
+        {
+            const value_t& v(new_values[new_idx]);
+            index_entry(ri, idx->id, v.first, key_ie, key, v.second, &scratch_entry, &entry);
+            updates->Put(leveldb::Slice(reinterpret_cast<const char*>(entry.data()), entry.size()), leveldb::Slice());
+            ++new_idx;
+        }
+    }
+}
+
+bool
+index_document :: answers_check(const index& idx,
+                                const attribute_check& check) const
+{
+    const char* path = reinterpret_cast<const char*>(check.value.data());
+    size_t path_sz = strnlen(path, check.value.size());
+
+    if (path_sz >= check.value.size() ||
+        idx.document_path() != std::string(path, path_sz))
+    {
+        return false;
     }
 
-    if (old_document && parse_path(idx, *old_document, &t, &scratch_value, &value))
+    // an index of each element answers only whether the array contains a
+    // value, and an index of the path itself never does
+    if (idx.document_elements() != (check.predicate == HYPERPREDICATE_CONTAINS))
     {
-        index_entry(ri, idx->id, t, key_ie, key, value, &scratch_entry, &entry);
-        updates->Delete(leveldb::Slice(reinterpret_cast<const char*>(entry.data()), entry.size()));
+        return false;
     }
 
-    if (new_document && parse_path(idx, *new_document, &t, &scratch_value, &value))
+    switch (idx.document_type())
     {
-        index_entry(ri, idx->id, t, key_ie, key, value, &scratch_entry, &entry);
-        updates->Put(leveldb::Slice(reinterpret_cast<const char*>(entry.data()), entry.size()), leveldb::Slice());
+        case HYPERDATATYPE_STRING:
+            return check.datatype == HYPERDATATYPE_STRING;
+        case HYPERDATATYPE_FLOAT:
+            return check.datatype == HYPERDATATYPE_INT64 ||
+                   check.datatype == HYPERDATATYPE_FLOAT;
+        case HYPERDATATYPE_DOCUMENT:
+            return check.datatype == HYPERDATATYPE_DOCUMENT;
+        default:
+            return true;
     }
 }
 
@@ -148,7 +219,8 @@ index_document :: iterator_from_check(leveldb_snapshot_ptr snap,
     }
     else if(check.datatype == HYPERDATATYPE_DOCUMENT)
     {
-        if(check.predicate != HYPERPREDICATE_EQUALS)
+        if(check.predicate != HYPERPREDICATE_EQUALS &&
+           check.predicate != HYPERPREDICATE_CONTAINS)
         {
             return NULL;
         }
@@ -165,7 +237,10 @@ index_document :: iterator_from_check(leveldb_snapshot_ptr snap,
 
     switch (check.predicate)
     {
+        // answers_check lets CONTAINS through only to an index of each
+        // element, where it is the equality of one of them
         case HYPERPREDICATE_EQUALS:
+        case HYPERPREDICATE_CONTAINS:
             start = a;
             limit = a;
             break;
@@ -185,7 +260,6 @@ index_document :: iterator_from_check(leveldb_snapshot_ptr snap,
         case HYPERPREDICATE_LENGTH_EQUALS:
         case HYPERPREDICATE_LENGTH_LESS_EQUAL:
         case HYPERPREDICATE_LENGTH_GREATER_EQUAL:
-        case HYPERPREDICATE_CONTAINS:
         default:
             return NULL;
     }
@@ -218,33 +292,99 @@ index_document :: lookup_encoding(type_t t) const
     return NULL;
 }
 
-bool
-index_document :: parse_path(const index* idx,
-                             const e::slice& document,
-                             type_t* t,
-                             std::vector<char>* scratch,
-                             e::slice* value) const
+void
+index_document :: parse_values(const index* idx,
+                               datatype_document::reader* doc,
+                               std::list<std::string>* numbers,
+                               std::vector<value_t>* values) const
 {
+    const std::string path(idx->document_path());
     hyperdatatype type;
+    e::slice value;
+    value_t v;
 
-    if (m_di.extract_value(idx->extra.cdata(), document, &type, scratch, value))
+    if (!idx->document_elements())
     {
-        if (type == HYPERDATATYPE_STRING)
+        if (doc->extract(path.c_str(), &type, &value) &&
+            parse_value(idx, type, value, numbers, &v))
         {
-            *t = STRING;
-            return true;
+            values->push_back(v);
         }
-        else if (type == HYPERDATATYPE_INT64 || type == HYPERDATATYPE_FLOAT)
+
+        return;
+    }
+
+    for (size_t i = 0; i < DOCUMENT_MAX_ARRAY_ELEMENTS; ++i)
+    {
+        if (!doc->extract_element(path.c_str(), i, &type, &value))
         {
-            *t = NUMBER;
-            return true;
+            break;
         }
-        else if (type == HYPERDATATYPE_DOCUMENT)
+
+        if (parse_value(idx, type, value, numbers, &v))
         {
-            *t = DOCUMENT;
-            return true;
+            values->push_back(v);
+        }
+    }
+
+    std::sort(values->begin(), values->end());
+    std::vector<value_t>::iterator it;
+    it = std::unique(values->begin(), values->end());
+    values->resize(it - values->begin());
+}
+
+bool
+index_document :: parse_value(const index* idx,
+                              hyperdatatype type,
+                              const e::slice& value,
+                              std::list<std::string>* numbers,
+                              value_t* v) const
+{
+    hyperdatatype declared = idx->document_type();
+
+    // values not of the declared type are left out of the index; the check
+    // against the document itself still sees them
+    if (declared == HYPERDATATYPE_FLOAT)
+    {
+        if (type != HYPERDATATYPE_INT64 && type != HYPERDATATYPE_FLOAT)
+        {
+            return false;
         }
     }
+    else if (declared != HYPERDATATYPE_GARBAGE && type != declared)
+    {
+        return false;
+    }
+
+    if (type == HYPERDATATYPE_STRING)
+    {
+        *v = value_t(STRING, value);
+        return true;
+    }
+    else if (type == HYPERDATATYPE_INT64)
+    {
+        // numbers are indexed as doubles, as iterator_from_check looks for
+        int64_t val_i = 0;
+        char buf[sizeof(double)];
+        memset(buf, 0, sizeof(buf));
+        memmove(buf, value.data(), std::min(value.size(), sizeof(int64_t)));
+        e::unpack64le(buf, &val_i);
+        double val_d = val_i;
+        e::pack64le(val_d, buf);
+        numbers->push_back(std::string(buf, sizeof(double)));
+        *v = value_t(NUMBER, e::slice(numbers->back().data(), sizeof(double)));
+        return true;
+    }
+    else if (type == HYPERDATATYPE_FLOAT)
+    {
+        *v = value_t(NUMBER, value);
+        return true;
+    }
+    else if (type == HYPERDATATYPE_DOCUMENT)
+    {
+        *v = value_t(DOCUMENT, value);
+        return true;
+    }
 
     return false;
 }
@@ -424,7 +564,7 @@ index_document :: index_entry(const region_id& ri,
               + sizeof(uint8_t)
               + val_sz
               + key_sz
-              + (variable ? sizeof(uint32_t) : 0);
+              + (variable ? key_size_suffix_length(key_sz) : 0);
 
     if (scratch->size() < sz)
     {
@@ -455,7 +595,7 @@ index_document :: index_entry(const region_id& ri,
 
     if (variable)
     {
-        ptr = e::pack32be(key_sz, ptr);
+        ptr = encode_key_size_suffix(key_sz, ptr);
     }
 
     assert(ptr == &scratch->front() + sz);
@@ -28,6 +28,12 @@
 #ifndef hyperdex_daemon_index_document_h_
 #define hyperdex_daemon_index_document_h_
 
+// STL
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+
 // HyperDex
 #include "namespace.h"
 #include "common/datatype_document.h"
@@ -50,6 +56,8 @@ class index_document : public index_info
                                    const e::slice* old_document,
                                    const e::slice* new_document,
                                    leveldb::WriteBatch* updates) const;
+        virtual bool answers_check(const index& idx,
+                                   const attribute_check& c) const;
         virtual datalayer::index_iterator* iterator_from_check(leveldb_snapshot_ptr snap,
                                                                const region_id& ri,
                                                                const index_id& ii,
@@ -60,11 +68,18 @@ class index_document : public index_info
 
     private:
         enum type_t { STRING, NUMBER, DOCUMENT };
-        bool parse_path(const index* idx,
-                        const e::slice& document,
-                        type_t* t,
-                        std::vector<char>* scratch,
-                        e::slice* value) const;
+        typedef std::pair<type_t, e::slice> value_t;
+        // the distinct values idx holds for the document, in sorted order;
+        // they point into doc and numbers
+        void parse_values(const index* idx,
+                          datatype_document::reader* doc,
+                          std::list<std::string>* numbers,
+                          std::vector<value_t>* values) const;
+        bool parse_value(const index* idx,
+                         hyperdatatype type,
+                         const e::slice& value,
+                         std::list<std::string>* numbers,
+                         value_t* v) const;
         size_t index_entry_prefix_size(const region_id& ri, const index_id& ii) const;
         void index_entry(const region_id& ri,
                          const index_id& ii,
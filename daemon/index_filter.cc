@@ -0,0 +1,160 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <string.h>
+
+// STL
+#include <algorithm>
+
+// e
+#include <e/atomic.h>
+
+// HyperDex
+#include "cityhash/city.h"
+#include "daemon/index_filter.h"
+
+// the seeds that keep the hashes of whole values apart from those of prefixes
+#define FILTER_VALUE_SEED 1
+#define FILTER_PREFIX_SEED 2
+
+using hyperdex::index_filter;
+
+index_filter :: index_filter(uint64_t expected, unsigned bits)
+    : m_bits()
+    , m_capacity(std::max(expected, uint64_t(1)))
+    , m_probes(1)
+    , m_added(0)
+    , m_ready(0)
+{
+    // each value sets bits for itself and for its prefix
+    const uint64_t nbits = std::max(m_capacity * 2 * bits, uint64_t(512));
+    m_bits.resize((nbits + 63) / 64, 0);
+    // ln(2) * bits per entry minimizes false positives
+    m_probes = std::max(1U, std::min(30U, (bits * 69) / 100));
+}
+
+index_filter :: ~index_filter() throw ()
+{
+}
+
+void
+index_filter :: add(const e::slice& value)
+{
+    insert(FILTER_VALUE_SEED, value);
+
+    if (value.size() >= PREFIX)
+    {
+        insert(FILTER_PREFIX_SEED, e::slice(value.data(), PREFIX));
+    }
+
+    __sync_add_and_fetch(&m_added, 1);
+}
+
+bool
+index_filter :: may_contain(const e::slice& lower, const e::slice& upper) const
+{
+    if (lower.size() == upper.size() &&
+        memcmp(lower.data(), upper.data(), lower.size()) == 0)
+    {
+        return test(FILTER_VALUE_SEED, lower);
+    }
+
+    // every value between the two shares the prefix they have in common
+    if (lower.size() >= PREFIX && upper.size() >= PREFIX &&
+        memcmp(lower.data(), upper.data(), PREFIX) == 0)
+    {
+        return test(FILTER_PREFIX_SEED, e::slice(lower.data(), PREFIX));
+    }
+
+    return true;
+}
+
+bool
+index_filter :: ready() const
+{
+    e::atomic::memory_barrier();
+    return e::atomic::load_64_acquire(&m_ready) == 1;
+}
+
+void
+index_filter :: set_ready()
+{
+    e::atomic::store_64_release(&m_ready, 1);
+    e::atomic::memory_barrier();
+}
+
+bool
+index_filter :: saturated() const
+{
+    return added() > 2 * m_capacity;
+}
+
+uint64_t
+index_filter :: added() const
+{
+    return e::atomic::load_64_nobarrier(&m_added);
+}
+
+void
+index_filter :: insert(uint64_t seed, const e::slice& s)
+{
+    // double hashing, as LevelDB's own bloom filter does
+    const uint64_t nbits = m_bits.size() * 64;
+    uint64_t h = CityHash64WithSeed(reinterpret_cast<const char*>(s.data()), s.size(), seed);
+    const uint64_t delta = (h >> 33) | (h << 31);
+
+    for (unsigned i = 0; i < m_probes; ++i)
+    {
+        const uint64_t bit = h % nbits;
+        __sync_fetch_and_or(&m_bits[bit / 64], uint64_t(1) << (bit % 64));
+        h += delta;
+    }
+}
+
+bool
+index_filter :: test(uint64_t seed, const e::slice& s) const
+{
+    const uint64_t nbits = m_bits.size() * 64;
+    uint64_t h = CityHash64WithSeed(reinterpret_cast<const char*>(s.data()), s.size(), seed);
+    const uint64_t delta = (h >> 33) | (h << 31);
+
+    for (unsigned i = 0; i < m_probes; ++i)
+    {
+        const uint64_t bit = h % nbits;
+
+        if (!(e::atomic::load_64_nobarrier(&m_bits[bit / 64]) & (uint64_t(1) << (bit % 64))))
+        {
+            return false;
+        }
+
+        h += delta;
+    }
+
+    return true;
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_index_filter_h_
+#define hyperdex_daemon_index_filter_h_
+
+// C
+#include <stdint.h>
+
+// STL
+#include <vector>
+
+// e
+#include <e/slice.h>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// A bloom filter over the values one index holds for one region, so a search
+// for a value the index has no entries for is answered without reading
+// LevelDB.  It holds each encoded value and, separately, its first PREFIX
+// bytes, so that a range whose ends share that many bytes can be ruled out
+// too.  Values are never removed; deleting objects only makes the filter
+// less selective.  "add" is lock-free and safe to race with "may_contain".
+class index_filter
+{
+    public:
+        const static size_t PREFIX = 4;
+
+    public:
+        // sized for "expected" values at "bits" bits for each value and
+        // prefix it holds
+        index_filter(uint64_t expected, unsigned bits);
+        ~index_filter() throw ();
+
+    public:
+        // encoded as the index encodes it
+        void add(const e::slice& value);
+        // false only if no value added lies between "lower" and "upper",
+        // both encoded and inclusive
+        bool may_contain(const e::slice& lower, const e::slice& upper) const;
+        // until it is ready, values from before the filter existed may be
+        // missing; may_contain must not be trusted
+        bool ready() const;
+        void set_ready();
+        // it now holds so many more values than it was sized for that it
+        // rules out too little to be worth keeping
+        bool saturated() const;
+        uint64_t added() const;
+        uint64_t bytes() const { return m_bits.size() * sizeof(uint64_t); }
+
+    private:
+        void insert(uint64_t seed, const e::slice& s);
+        bool test(uint64_t seed, const e::slice& s) const;
+
+    private:
+        std::vector<uint64_t> m_bits;
+        const uint64_t m_capacity;
+        unsigned m_probes;
+        uint64_t m_added;
+        uint64_t m_ready;
+
+    private:
+        index_filter(const index_filter&);
+        index_filter& operator = (const index_filter&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_index_filter_h_
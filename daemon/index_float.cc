@@ -76,16 +76,15 @@ index_encoding_float :: encoded_size(const e::slice&) const
 char*
 index_encoding_float :: encode(const e::slice& decoded, char* encoded) const
 {
-    datatype_info* di = datatype_info::lookup(HYPERDATATYPE_FLOAT);
     double number = 0;
 
-    if (di->validate(decoded) && decoded.size() == sizeof(double))
+    if (decoded.size() == sizeof(double))
     {
         e::unpackdoublele(decoded.data(), &number);
     }
 
     char* ptr = encoded;
-    ptr = e::pack64be(di->hash(decoded), ptr);
+    ptr = e::pack64be(ordered_encode_double(number), ptr);
     ptr = e::packdoublele(number, ptr);
     return ptr;
 }
@@ -103,7 +102,7 @@ index_encoding_float :: decode(const e::slice& encoded, char* decoded) const
 
     if (encoded.size() == 2 * sizeof(double))
     {
-        e::unpackdoublele(decoded + sizeof(double), &number);
+        e::unpackdoublele(encoded.data() + sizeof(double), &number);
     }
 
     return e::packdoublele(number, decoded);
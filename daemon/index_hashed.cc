@@ -0,0 +1,223 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// e
+#include <e/endian.h>
+#include <e/varint.h>
+
+// HyperDex
+#include "cityhash/city.h"
+#include "daemon/datalayer_iterator.h"
+#include "daemon/index_hashed.h"
+
+#define HASHED_SZ sizeof(uint64_t)
+
+using hyperdex::datalayer;
+using hyperdex::index_encoding_hashed;
+using hyperdex::index_hashed;
+
+inline leveldb::Slice e2level(const e::slice& s) { return leveldb::Slice(reinterpret_cast<const char*>(s.data()), s.size()); }
+
+static const index_encoding_hashed e_hashed;
+
+static char*
+pack_hash(const e::slice& value, char* ptr)
+{
+    uint64_t h = CityHash64(reinterpret_cast<const char*>(value.data()), value.size());
+    return e::pack64be(h, ptr);
+}
+
+index_hashed :: index_hashed()
+{
+}
+
+index_hashed :: ~index_hashed() throw ()
+{
+}
+
+hyperdatatype
+index_hashed :: datatype() const
+{
+    return HYPERDATATYPE_STRING;
+}
+
+void
+index_hashed :: index_changes(const index* idx,
+                              const region_id& ri,
+                              const index_encoding* key_ie,
+                              const e::slice& key,
+                              const e::slice* old_value,
+                              const e::slice* new_value,
+                              leveldb::WriteBatch* updates) const
+{
+    if (old_value && new_value && *old_value == *new_value)
+    {
+        return;
+    }
+
+    std::vector<char> scratch;
+    e::slice slice;
+
+    if (old_value)
+    {
+        index_entry(ri, idx->id, *old_value, key_ie, key, &scratch, &slice);
+        updates->Delete(e2level(slice));
+    }
+
+    if (new_value)
+    {
+        index_entry(ri, idx->id, *new_value, key_ie, key, &scratch, &slice);
+        updates->Put(e2level(slice), leveldb::Slice());
+    }
+}
+
+datalayer::index_iterator*
+index_hashed :: iterator_from_check(leveldb_snapshot_ptr snap,
+                                    const region_id& ri,
+                                    const index_id& ii,
+                                    const attribute_check& c,
+                                    const index_encoding* key_ie) const
+{
+    if (c.predicate != HYPERPREDICATE_EQUALS ||
+        c.datatype != HYPERDATATYPE_STRING)
+    {
+        return NULL;
+    }
+
+    std::vector<char> scratch;
+    e::slice entry;
+    index_entry(ri, ii, c.value, &scratch, &entry);
+    return new datalayer::range_index_iterator(snap, index_entry_prefix_size(ri, ii),
+                                               entry, entry,
+                                               true, true,
+                                               &e_hashed, key_ie);
+}
+
+size_t
+index_hashed :: index_entry_prefix_size(const region_id& ri, const index_id& ii) const
+{
+    return sizeof(uint8_t)
+         + e::varint_length(ri.get())
+         + e::varint_length(ii.get());
+}
+
+void
+index_hashed :: index_entry(const region_id& ri,
+                            const index_id& ii,
+                            const e::slice& value,
+                            std::vector<char>* scratch,
+                            e::slice* slice) const
+{
+    size_t sz = index_entry_prefix_size(ri, ii) + HASHED_SZ;
+
+    if (scratch->size() < sz)
+    {
+        scratch->resize(sz);
+    }
+
+    char* ptr = &scratch->front();
+    ptr = e::pack8be('i', ptr);
+    ptr = e::packvarint64(ri.get(), ptr);
+    ptr = e::packvarint64(ii.get(), ptr);
+    ptr = pack_hash(value, ptr);
+    assert(ptr == &scratch->front() + sz);
+    *slice = e::slice(&scratch->front(), sz);
+}
+
+void
+index_hashed :: index_entry(const region_id& ri,
+                            const index_id& ii,
+                            const e::slice& value,
+                            const index_encoding* key_ie,
+                            const e::slice& key,
+                            std::vector<char>* scratch,
+                            e::slice* slice) const
+{
+    // the hash is fixed in size, so the key needs no length suffix
+    size_t key_sz = key_ie->encoded_size(key);
+    size_t sz = index_entry_prefix_size(ri, ii) + HASHED_SZ + key_sz;
+
+    if (scratch->size() < sz)
+    {
+        scratch->resize(sz);
+    }
+
+    char* ptr = &scratch->front();
+    ptr = e::pack8be('i', ptr);
+    ptr = e::packvarint64(ri.get(), ptr);
+    ptr = e::packvarint64(ii.get(), ptr);
+    ptr = pack_hash(value, ptr);
+    ptr = key_ie->encode(key, ptr);
+    assert(ptr == &scratch->front() + sz);
+    *slice = e::slice(&scratch->front(), sz);
+}
+
+index_encoding_hashed :: index_encoding_hashed()
+{
+}
+
+index_encoding_hashed :: ~index_encoding_hashed() throw ()
+{
+}
+
+bool
+index_encoding_hashed :: encoding_fixed() const
+{
+    return true;
+}
+
+size_t
+index_encoding_hashed :: encoded_size(const e::slice&) const
+{
+    return HASHED_SZ;
+}
+
+char*
+index_encoding_hashed :: encode(const e::slice& decoded, char* encoded) const
+{
+    assert(decoded.size() == HASHED_SZ);
+    memmove(encoded, decoded.data(), HASHED_SZ);
+    return encoded + HASHED_SZ;
+}
+
+size_t
+index_encoding_hashed :: decoded_size(const e::slice&) const
+{
+    return HASHED_SZ;
+}
+
+char*
+index_encoding_hashed :: decode(const e::slice& encoded, char* decoded) const
+{
+    assert(encoded.size() == HASHED_SZ);
+    memmove(decoded, encoded.data(), HASHED_SZ);
+    return decoded + HASHED_SZ;
+}
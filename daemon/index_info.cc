@@ -27,8 +27,10 @@
 
 // HyperDex
 #include "common/datatype_info.h"
+#include "common/index.h"
 #include "daemon/index_document.h"
 #include "daemon/index_float.h"
+#include "daemon/index_hashed.h"
 #include "daemon/index_info.h"
 #include "daemon/index_int64.h"
 #include "daemon/index_list.h"
@@ -36,6 +38,7 @@
 #include "daemon/index_map.h"
 #include "daemon/index_set.h"
 #include "daemon/index_string.h"
+#include "daemon/index_trigram.h"
 
 using hyperdex::datalayer;
 using hyperdex::index_encoding;
@@ -51,6 +54,8 @@ static const hyperdex::index_string i_string;
 static const hyperdex::index_int64 i_int64;
 static const hyperdex::index_float i_float;
 static const hyperdex::index_document i_document;
+static const hyperdex::index_trigram i_trigram;
+static const hyperdex::index_hashed i_hashed;
 static const hyperdex::index_list i_list_string(HYPERDATATYPE_STRING);
 static const hyperdex::index_list i_list_int64(HYPERDATATYPE_INT64);
 static const hyperdex::index_list i_list_float(HYPERDATATYPE_FLOAT);
@@ -201,6 +206,28 @@ index_info :: lookup(hyperdatatype datatype)
     }
 }
 
+const index_info*
+index_info :: lookup(const index& idx, hyperdatatype datatype)
+{
+    if (idx.type == index::TRIGRAM)
+    {
+        return datatype == HYPERDATATYPE_STRING ? &i_trigram : NULL;
+    }
+
+    if (idx.type == index::HASHED)
+    {
+        return datatype == HYPERDATATYPE_STRING ? &i_hashed : NULL;
+    }
+
+    // composite and spatial indices span attributes and are planned separately
+    if (idx.type == index::COMPOSITE || idx.type == index::SPATIAL)
+    {
+        return NULL;
+    }
+
+    return lookup(datatype);
+}
+
 index_info :: index_info()
 {
 }
@@ -209,6 +236,19 @@ index_info :: ~index_info() throw ()
 {
 }
 
+bool
+index_info :: covering_changes(const index*,
+                               const region_id&,
+                               const index_encoding*,
+                               const e::slice&,
+                               const e::slice*,
+                               const e::slice*,
+                               const e::slice&,
+                               leveldb::WriteBatch*) const
+{
+    return false;
+}
+
 datalayer::index_iterator*
 index_info :: iterator_for_keys(leveldb_snapshot_ptr,
                                 const region_id&) const
@@ -226,6 +266,13 @@ index_info :: iterator_from_range(leveldb_snapshot_ptr,
     return NULL;
 }
 
+bool
+index_info :: answers_check(const index&,
+                            const attribute_check&) const
+{
+    return true;
+}
+
 datalayer::index_iterator*
 index_info :: iterator_from_check(leveldb_snapshot_ptr,
                                   const region_id&,
@@ -235,3 +282,23 @@ index_info :: iterator_from_check(leveldb_snapshot_ptr,
 {
     return NULL;
 }
+
+datalayer::range_index_iterator*
+index_info :: iterator_for_values(leveldb_snapshot_ptr,
+                                  const region_id&,
+                                  const index_id&,
+                                  const index_encoding*) const
+{
+    return NULL;
+}
+
+datalayer::index_iterator*
+index_info :: iterator_in_order(leveldb_snapshot_ptr,
+                                const region_id&,
+                                const index_id&,
+                                const range&,
+                                const index_encoding*,
+                                bool) const
+{
+    return NULL;
+}
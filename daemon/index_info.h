@@ -75,6 +75,10 @@ class index_info
     public:
         // return NULL for unindexable type
         static const index_info* lookup(hyperdatatype datatype);
+        // return the index_info that maintains idx on an attribute of the
+        // given datatype; differs from lookup(datatype) for trigram and hashed
+        // indices and is NULL for composite indices
+        static const index_info* lookup(const index& idx, hyperdatatype datatype);
 
     public:
         index_info();
@@ -92,6 +96,17 @@ class index_info
                                    const e::slice* old_value,
                                    const e::slice* new_value,
                                    leveldb::WriteBatch* updates) const = 0;
+        // like index_changes, but store "payload" with the new entry so that
+        // searches may read the index's included attributes without fetching
+        // the object; return false if this kind of index cannot do so
+        virtual bool covering_changes(const index* idx,
+                                      const region_id& ri,
+                                      const index_encoding* key_ie,
+                                      const e::slice& key,
+                                      const e::slice* old_value,
+                                      const e::slice* new_value,
+                                      const e::slice& payload,
+                                      leveldb::WriteBatch* updates) const;
         // return an iterator across all keys
         // if not indexable (full scan), return NULL
         virtual datalayer::index_iterator* iterator_for_keys(leveldb_snapshot_ptr snap,
@@ -103,6 +118,11 @@ class index_info
                                                                const index_id& ii,
                                                                const range& r,
                                                                const index_encoding* key_ie) const;
+        // can idx, which this maintains, answer c at all?  indices that hold
+        // only part of an attribute, such as one path of a document, say no
+        // to checks on the rest of it
+        virtual bool answers_check(const index& idx,
+                                   const attribute_check& c) const;
         // return an iterator that retrieves at least the keys that pass c
         // if not indexable (full scan), return NULL
         virtual datalayer::index_iterator* iterator_from_check(leveldb_snapshot_ptr snap,
@@ -110,6 +130,21 @@ class index_info
                                                                const index_id& ii,
                                                                const attribute_check& c,
                                                                const index_encoding* key_ie) const;
+        // return an iterator across every entry of ii, whose value() is the
+        // encoded value of the entry; NULL if entries are not one per value
+        virtual datalayer::range_index_iterator* iterator_for_values(leveldb_snapshot_ptr snap,
+                                                                     const region_id& ri,
+                                                                     const index_id& ii,
+                                                                     const index_encoding* key_ie) const;
+        // return an iterator across the entries of ii matching r in the order
+        // of their values, highest first if reverse; NULL if the entries are
+        // not stored in value order
+        virtual datalayer::index_iterator* iterator_in_order(leveldb_snapshot_ptr snap,
+                                                             const region_id& ri,
+                                                             const index_id& ii,
+                                                             const range& r,
+                                                             const index_encoding* key_ie,
+                                                             bool reverse) const;
 };
 
 END_HYPERDEX_NAMESPACE
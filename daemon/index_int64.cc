@@ -29,7 +29,7 @@
 #include <e/endian.h>
 
 // HyperDex
-#include "common/datatype_info.h"
+#include "common/datatype_int64.h"
 #include "common/ordered_encoding.h"
 #include "daemon/datalayer_encodings.h"
 #include "daemon/index_int64.h"
@@ -75,7 +75,7 @@ index_encoding_int64 :: encoded_size(const e::slice&) const
 char*
 index_encoding_int64 :: encode(const e::slice& decoded, char* encoded) const
 {
-    return e::pack64be(datatype_info::lookup(HYPERDATATYPE_INT64)->hash(decoded), encoded);
+    return e::pack64be(ordered_encode_int64(datatype_int64::unpack(decoded)), encoded);
 }
 
 size_t
@@ -79,6 +79,35 @@ index_primitive :: index_changes(const index* idx,
     }
 }
 
+bool
+index_primitive :: covering_changes(const index* idx,
+                                    const region_id& ri,
+                                    const index_encoding* key_ie,
+                                    const e::slice& key,
+                                    const e::slice* old_value,
+                                    const e::slice* new_value,
+                                    const e::slice& payload,
+                                    leveldb::WriteBatch* updates) const
+{
+    std::vector<char> scratch;
+    e::slice slice;
+
+    // the entry must be rewritten when only the included attributes change
+    if (old_value && !(new_value && *old_value == *new_value))
+    {
+        index_entry(ri, idx->id, key_ie, key, *old_value, &scratch, &slice);
+        updates->Delete(e2level(slice));
+    }
+
+    if (new_value)
+    {
+        index_entry(ri, idx->id, key_ie, key, *new_value, &scratch, &slice);
+        updates->Put(e2level(slice), e2level(payload));
+    }
+
+    return true;
+}
+
 datalayer::index_iterator*
 index_primitive :: iterator_for_keys(leveldb_snapshot_ptr snap,
                                      const region_id& ri) const
@@ -115,6 +144,47 @@ index_primitive :: iterator_from_range(leveldb_snapshot_ptr snap,
     }
 }
 
+datalayer::range_index_iterator*
+index_primitive :: iterator_for_values(leveldb_snapshot_ptr snap,
+                                       const region_id& ri,
+                                       const index_id& ii,
+                                       const index_encoding* key_ie) const
+{
+    std::vector<char> scratch_start;
+    std::vector<char> scratch_limit;
+    e::slice start;
+    e::slice limit;
+    index_entry(ri, ii, &scratch_start, &start);
+    index_entry(ri, ii, &scratch_limit, &limit);
+    return new datalayer::range_index_iterator(snap, index_entry_prefix_size(ri, ii),
+                                               start, limit, false, false,
+                                               m_ie, key_ie);
+}
+
+datalayer::index_iterator*
+index_primitive :: iterator_in_order(leveldb_snapshot_ptr snap,
+                                     const region_id& ri,
+                                     const index_id& ii,
+                                     const range& r,
+                                     const index_encoding* key_ie,
+                                     bool reverse) const
+{
+    // variable-length encodings do not keep entries in value order
+    if (r.invalid || r.attr == 0 || !m_ie->encoding_fixed())
+    {
+        return NULL;
+    }
+
+    datalayer::range_index_iterator* rii = iterator_attr(snap, ri, ii, r, key_ie);
+
+    if (reverse)
+    {
+        rii->reverse();
+    }
+
+    return rii;
+}
+
 datalayer::index_iterator*
 index_primitive :: iterator_key(leveldb_snapshot_ptr snap,
                                 const region_id& ri,
@@ -160,7 +230,7 @@ index_primitive :: iterator_key(leveldb_snapshot_ptr snap,
                                                NULL, key_ie);
 }
 
-datalayer::index_iterator*
+datalayer::range_index_iterator*
 index_primitive :: iterator_attr(leveldb_snapshot_ptr snap,
                                  const region_id& ri,
                                  const index_id& ii,
@@ -305,7 +375,7 @@ index_primitive :: index_entry(const region_id& ri,
               + e::varint_length(ii.get())
               + val_sz
               + key_sz
-              + (variable ? sizeof(uint32_t) : 0);
+              + (variable ? key_size_suffix_length(key_sz) : 0);
 
     if (scratch->size() < sz)
     {
@@ -321,7 +391,7 @@ index_primitive :: index_entry(const region_id& ri,
 
     if (variable)
     {
-        ptr = e::pack32be(key_sz, ptr);
+        ptr = encode_key_size_suffix(key_sz, ptr);
     }
 
     assert(ptr == &scratch->front() + sz);
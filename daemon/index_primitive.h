@@ -48,6 +48,14 @@ class index_primitive : public index_info
                                    const e::slice* old_value,
                                    const e::slice* new_value,
                                    leveldb::WriteBatch* updates) const;
+        virtual bool covering_changes(const index* idx,
+                                      const region_id& ri,
+                                      const index_encoding* key_ie,
+                                      const e::slice& key,
+                                      const e::slice* old_value,
+                                      const e::slice* new_value,
+                                      const e::slice& payload,
+                                      leveldb::WriteBatch* updates) const;
         virtual datalayer::index_iterator* iterator_for_keys(leveldb_snapshot_ptr snap,
                                                              const region_id& ri) const;
         virtual datalayer::index_iterator* iterator_from_range(leveldb_snapshot_ptr snap,
@@ -55,6 +63,16 @@ class index_primitive : public index_info
                                                                const index_id& ii,
                                                                const range& r,
                                                                const index_encoding* key_ie) const;
+        virtual datalayer::range_index_iterator* iterator_for_values(leveldb_snapshot_ptr snap,
+                                                                     const region_id& ri,
+                                                                     const index_id& ii,
+                                                                     const index_encoding* key_ie) const;
+        virtual datalayer::index_iterator* iterator_in_order(leveldb_snapshot_ptr snap,
+                                                             const region_id& ri,
+                                                             const index_id& ii,
+                                                             const range& r,
+                                                             const index_encoding* key_ie,
+                                                             bool reverse) const;
 
     private:
         class range_iterator;
@@ -65,11 +83,11 @@ class index_primitive : public index_info
                                                 const region_id& ri,
                                                 const range& r,
                                                 const index_encoding* key_ie) const;
-        datalayer::index_iterator* iterator_attr(leveldb_snapshot_ptr snap,
-                                                 const region_id& ri,
-                                                 const index_id& ii,
-                                                 const range& r,
-                                                 const index_encoding* key_ie) const;
+        datalayer::range_index_iterator* iterator_attr(leveldb_snapshot_ptr snap,
+                                                       const region_id& ri,
+                                                       const index_id& ii,
+                                                       const range& r,
+                                                       const index_encoding* key_ie) const;
         size_t index_entry_prefix_size(const region_id& ri, const index_id& ii) const;
         void index_entry(const region_id& ri,
                          const index_id& ii,
@@ -0,0 +1,536 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#define __STDC_LIMIT_MACROS
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// C
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+// STL
+#include <algorithm>
+#include <string>
+
+// e
+#include <e/endian.h>
+#include <e/varint.h>
+
+// HyperDex
+#include "common/datatype_float.h"
+#include "common/datatype_int64.h"
+#include "common/ordered_encoding.h"
+#include "common/zorder.h"
+#include "daemon/datalayer_encodings.h"
+#include "daemon/datalayer_iterator.h"
+#include "daemon/index_spatial.h"
+
+using hyperdex::datalayer;
+using hyperdex::index_encoding;
+using hyperdex::leveldb_snapshot_ptr;
+
+inline leveldb::Slice str2level(const std::string& s) { return leveldb::Slice(s.data(), s.size()); }
+
+namespace
+{
+
+void
+encode_prefix(const hyperdex::region_id& ri,
+              const hyperdex::index_id& ii,
+              std::string* out)
+{
+    size_t sz = sizeof(uint8_t)
+              + e::varint_length(ri.get())
+              + e::varint_length(ii.get());
+    out->resize(sz);
+    char* ptr = &(*out)[0];
+    ptr = e::pack8be('i', ptr);
+    ptr = e::packvarint64(ri.get(), ptr);
+    ptr = e::packvarint64(ii.get(), ptr);
+    assert(ptr == &(*out)[0] + sz);
+}
+
+uint64_t
+ordered_code(hyperdatatype t, const e::slice& value)
+{
+    if (t == HYPERDATATYPE_FLOAT)
+    {
+        return hyperdex::ordered_encode_double(hyperdex::datatype_float::unpack(value));
+    }
+
+    // timestamps are stored exactly like int64
+    return hyperdex::ordered_encode_int64(hyperdex::datatype_int64::unpack(value));
+}
+
+uint64_t
+ordered_code(hyperdatatype t, double x)
+{
+    if (t == HYPERDATATYPE_FLOAT)
+    {
+        return hyperdex::ordered_encode_double(x);
+    }
+
+    if (x != x)
+    {
+        x = 0;
+    }
+
+    int64_t i = x <= static_cast<double>(INT64_MIN) ? INT64_MIN
+              : x >= static_cast<double>(INT64_MAX) ? INT64_MAX
+              : static_cast<int64_t>(x);
+    return hyperdex::ordered_encode_int64(i);
+}
+
+void
+append_code(uint64_t code, std::string* out)
+{
+    size_t off = out->size();
+    out->resize(off + sizeof(uint64_t));
+    e::pack64be(code, &(*out)[off]);
+}
+
+void
+encode_entry(const hyperdex::schema& sc,
+             const hyperdex::index& idx,
+             const hyperdex::region_id& ri,
+             const index_encoding* key_ie,
+             const e::slice& key,
+             const std::vector<e::slice>& value,
+             std::string* out)
+{
+    encode_prefix(ri, idx.id, out);
+    uint64_t codes[ZORDER_MAX_DIMENSIONS];
+    const size_t d = idx.composite_sz();
+    assert(d <= ZORDER_MAX_DIMENSIONS);
+
+    for (size_t i = 0; i < d; ++i)
+    {
+        const uint16_t attr = idx.composite(i);
+        assert(attr > 0 && attr < sc.attrs_sz);
+        codes[i] = ordered_code(sc.attrs[attr].type, value[attr - 1]);
+    }
+
+    append_code(hyperdex::zorder_interleave(codes, d), out);
+
+    // the full codes settle what the truncated ones in the Z-order code
+    // cannot, without reading the object
+    for (size_t i = 0; i < d; ++i)
+    {
+        append_code(codes[i], out);
+    }
+
+    size_t off = out->size();
+    out->resize(off + key_ie->encoded_size(key));
+    key_ie->encode(key, &(*out)[off]);
+}
+
+class spatial_index_iterator : public datalayer::index_iterator
+{
+    public:
+        spatial_index_iterator(leveldb_snapshot_ptr snap,
+                               const std::string& prefix,
+                               const std::vector<uint64_t>& lower,
+                               const std::vector<uint64_t>& upper,
+                               uint64_t start,
+                               const index_encoding* key_ie);
+        virtual ~spatial_index_iterator() throw ();
+
+    public:
+        virtual bool valid();
+        virtual void next();
+        virtual uint64_t cost(leveldb::DB*);
+        virtual e::slice key();
+        virtual std::ostream& describe(std::ostream&) const;
+        virtual e::slice internal_key();
+        virtual bool sorted();
+        virtual void seek(const e::slice& internal_key);
+        virtual double progress(leveldb::DB*);
+
+    private:
+        spatial_index_iterator(const spatial_index_iterator&);
+        spatial_index_iterator& operator = (const spatial_index_iterator&);
+
+    private:
+        void seek_code(uint64_t z);
+        std::string bound(uint64_t z) const;
+        size_t header_size() const
+        { return m_prefix.size() + sizeof(uint64_t) * (1 + m_lower.size()); }
+
+    private:
+        hyperdex::leveldb_iterator_ptr m_iter;
+        std::string m_prefix;
+        // the box, as the full ordered code of each corner per dimension
+        std::vector<uint64_t> m_lower;
+        std::vector<uint64_t> m_upper;
+        // ... and as the Z-order codes of its corners
+        uint64_t m_zmin;
+        uint64_t m_zmax;
+        uint64_t m_start;
+        const index_encoding *const m_key_ie;
+        std::vector<char> m_scratch;
+        bool m_invalid;
+        uint64_t m_cost;
+        bool m_has_cost;
+};
+
+spatial_index_iterator :: spatial_index_iterator(leveldb_snapshot_ptr s,
+                                                 const std::string& prefix,
+                                                 const std::vector<uint64_t>& lower,
+                                                 const std::vector<uint64_t>& upper,
+                                                 uint64_t start,
+                                                 const index_encoding* key_ie)
+    : index_iterator(s)
+    , m_iter()
+    , m_prefix(prefix)
+    , m_lower(lower)
+    , m_upper(upper)
+    , m_zmin(hyperdex::zorder_interleave(&lower[0], lower.size()))
+    , m_zmax(hyperdex::zorder_interleave(&upper[0], upper.size()))
+    , m_start(std::max(start, m_zmin))
+    , m_key_ie(key_ie)
+    , m_scratch()
+    , m_invalid(false)
+    , m_cost(0)
+    , m_has_cost(false)
+{
+    assert(m_lower.size() == m_upper.size());
+    leveldb::ReadOptions opts;
+    opts.fill_cache = true;
+    opts.verify_checksums = true;
+    opts.snapshot = s.get();
+    m_iter.reset(s, s.db()->NewIterator(opts));
+    seek_code(m_start);
+}
+
+spatial_index_iterator :: ~spatial_index_iterator() throw ()
+{
+}
+
+bool
+spatial_index_iterator :: valid()
+{
+    const size_t d = m_lower.size();
+
+    while (!m_invalid && m_iter->Valid())
+    {
+        leveldb::Slice k = m_iter->key();
+
+        if (!k.starts_with(str2level(m_prefix)) || k.size() < header_size())
+        {
+            m_invalid = true;
+            return false;
+        }
+
+        const uint8_t* ptr = reinterpret_cast<const uint8_t*>(k.data()) + m_prefix.size();
+        uint64_t z;
+        ptr = e::unpack64be(ptr, &z);
+
+        if (z > m_zmax)
+        {
+            m_invalid = true;
+            return false;
+        }
+
+        // outside the box in the truncated codes:  jump to where the span
+        // next enters it
+        if (!hyperdex::zorder_contains(z, m_zmin, m_zmax, d))
+        {
+            uint64_t nz;
+
+            if (!hyperdex::zorder_next(z, m_zmin, m_zmax, d, &nz))
+            {
+                m_invalid = true;
+                return false;
+            }
+
+            seek_code(nz);
+            continue;
+        }
+
+        bool inside = true;
+
+        for (size_t i = 0; i < d; ++i)
+        {
+            uint64_t code;
+            ptr = e::unpack64be(ptr, &code);
+            inside = inside && m_lower[i] <= code && code <= m_upper[i];
+        }
+
+        if (inside)
+        {
+            return true;
+        }
+
+        // in a cell on the edge of the box, but not in the box itself
+        next();
+    }
+
+    return false;
+}
+
+void
+spatial_index_iterator :: next()
+{
+    ++m_exec.examined;
+    m_exec.bytes += m_iter->key().size() + m_iter->value().size();
+    m_iter->Next();
+}
+
+uint64_t
+spatial_index_iterator :: cost(leveldb::DB* db)
+{
+    if (m_has_cost)
+    {
+        return m_cost;
+    }
+
+    // the whole span of codes, though the box may cover little of it
+    std::string lower(bound(m_start));
+    std::string upper(bound(m_zmax));
+    hyperdex::encode_bump(&upper[0], &upper[0] + upper.size());
+    leveldb::Range r;
+    r.start = str2level(lower);
+    r.limit = str2level(upper);
+    db->GetApproximateSizes(&r, 1, &m_cost);
+    m_has_cost = true;
+    return m_cost;
+}
+
+e::slice
+spatial_index_iterator :: key()
+{
+    e::slice ik = this->internal_key();
+    size_t decoded_sz = m_key_ie->decoded_size(ik);
+
+    if (m_scratch.size() < decoded_sz)
+    {
+        m_scratch.resize(decoded_sz);
+    }
+
+    m_key_ie->decode(ik, &m_scratch.front());
+    return e::slice(&m_scratch.front(), decoded_sz);
+}
+
+std::ostream&
+spatial_index_iterator :: describe(std::ostream& out) const
+{
+    return out << "spatial_iterator(" << m_lower.size() << " dimensions)";
+}
+
+e::slice
+spatial_index_iterator :: internal_key()
+{
+    leveldb::Slice k = m_iter->key();
+    const size_t sz = std::min(k.size(), header_size());
+    return e::slice(k.data() + sz, k.size() - sz);
+}
+
+bool
+spatial_index_iterator :: sorted()
+{
+    return false;
+}
+
+void
+spatial_index_iterator :: seek(const e::slice&)
+{
+    // only sorted iterators are asked to seek
+    abort();
+}
+
+double
+spatial_index_iterator :: progress(leveldb::DB* db)
+{
+    if (!m_iter->Valid())
+    {
+        return 1;
+    }
+
+    std::string lower(bound(m_start));
+    std::string upper(bound(m_zmax));
+    hyperdex::encode_bump(&upper[0], &upper[0] + upper.size());
+    leveldb::Range r[2];
+    r[0].start = str2level(lower);
+    r[0].limit = m_iter->key();
+    r[1].start = str2level(lower);
+    r[1].limit = str2level(upper);
+    uint64_t sizes[2];
+    db->GetApproximateSizes(r, 2, sizes);
+
+    if (sizes[1] == 0)
+    {
+        return 0;
+    }
+
+    return std::min(1.0, double(sizes[0]) / double(sizes[1]));
+}
+
+void
+spatial_index_iterator :: seek_code(uint64_t z)
+{
+    std::string target(bound(z));
+    m_iter->Seek(str2level(target));
+    ++m_exec.seeks;
+}
+
+std::string
+spatial_index_iterator :: bound(uint64_t z) const
+{
+    std::string b(m_prefix);
+    append_code(z, &b);
+    return b;
+}
+
+} // namespace
+
+void
+hyperdex :: spatial_index_changes(const schema& sc,
+                                  const index& idx,
+                                  const region_id& ri,
+                                  const index_encoding* key_ie,
+                                  const e::slice& key,
+                                  const std::vector<e::slice>* old_value,
+                                  const std::vector<e::slice>* new_value,
+                                  leveldb::WriteBatch* updates)
+{
+    if (old_value && new_value)
+    {
+        bool unchanged = true;
+
+        for (size_t i = 0; unchanged && i < idx.composite_sz(); ++i)
+        {
+            const uint16_t attr = idx.composite(i);
+            unchanged = (*old_value)[attr - 1] == (*new_value)[attr - 1];
+        }
+
+        if (unchanged)
+        {
+            return;
+        }
+    }
+
+    std::string entry;
+
+    if (old_value)
+    {
+        encode_entry(sc, idx, ri, key_ie, key, *old_value, &entry);
+        updates->Delete(str2level(entry));
+    }
+
+    if (new_value)
+    {
+        encode_entry(sc, idx, ri, key_ie, key, *new_value, &entry);
+        updates->Put(str2level(entry), leveldb::Slice());
+    }
+}
+
+datalayer::index_iterator*
+hyperdex :: spatial_iterator(leveldb_snapshot_ptr snap,
+                             const schema& sc,
+                             const region_id& ri,
+                             const index& idx,
+                             const std::vector<range>& ranges,
+                             const index_encoding* key_ie,
+                             size_t* constrained)
+{
+    const size_t d = idx.composite_sz();
+    std::vector<uint64_t> lower(d, 0);
+    std::vector<uint64_t> upper(d, UINT64_MAX);
+    *constrained = 0;
+
+    for (size_t i = 0; i < d; ++i)
+    {
+        const uint16_t attr = idx.composite(i);
+        const range* r = NULL;
+
+        for (size_t j = 0; !r && j < ranges.size(); ++j)
+        {
+            if (ranges[j].attr == attr && !ranges[j].invalid &&
+                ranges[j].type == sc.attrs[attr].type &&
+                (ranges[j].has_start || ranges[j].has_end))
+            {
+                r = &ranges[j];
+            }
+        }
+
+        if (!r)
+        {
+            continue;
+        }
+
+        if (r->has_start)
+        {
+            lower[i] = ordered_code(r->type, r->start);
+        }
+
+        if (r->has_end)
+        {
+            upper[i] = ordered_code(r->type, r->end);
+        }
+
+        ++*constrained;
+    }
+
+    if (*constrained < 2)
+    {
+        return NULL;
+    }
+
+    std::string prefix;
+    encode_prefix(ri, idx.id, &prefix);
+    return new spatial_index_iterator(snap, prefix, lower, upper, 0, key_ie);
+}
+
+datalayer::index_iterator*
+hyperdex :: spatial_iterator_from(leveldb_snapshot_ptr snap,
+                                  const schema& sc,
+                                  const region_id& ri,
+                                  const index& idx,
+                                  const std::vector<double>& point,
+                                  const index_encoding* key_ie)
+{
+    const size_t d = idx.composite_sz();
+    assert(point.size() == d);
+    uint64_t codes[ZORDER_MAX_DIMENSIONS];
+
+    for (size_t i = 0; i < d; ++i)
+    {
+        codes[i] = ordered_code(sc.attrs[idx.composite(i)].type, point[i]);
+    }
+
+    std::string prefix;
+    encode_prefix(ri, idx.id, &prefix);
+    std::vector<uint64_t> lower(d, 0);
+    std::vector<uint64_t> upper(d, UINT64_MAX);
+    return new spatial_index_iterator(snap, prefix, lower, upper,
+                                      zorder_interleave(codes, d), key_ie);
+}
@@ -0,0 +1,305 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+// STL
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// e
+#include <e/endian.h>
+#include <e/varint.h>
+
+// HyperDex
+#include "common/regex_match.h"
+#include "daemon/datalayer_iterator.h"
+#include "daemon/index_trigram.h"
+
+// intersecting more postings than this costs more seeks than it saves
+#define TRIGRAM_MAX_POSTINGS 8
+#define TRIGRAM_SZ 3
+
+using hyperdex::datalayer;
+using hyperdex::index_encoding_trigram;
+using hyperdex::index_trigram;
+
+inline leveldb::Slice e2level(const e::slice& s) { return leveldb::Slice(reinterpret_cast<const char*>(s.data()), s.size()); }
+
+static const index_encoding_trigram e_trigram;
+
+static void
+trigrams(const char* str, size_t str_sz, std::vector<std::string>* out)
+{
+    out->clear();
+
+    for (size_t i = 0; i + TRIGRAM_SZ <= str_sz; ++i)
+    {
+        out->push_back(std::string(str + i, TRIGRAM_SZ));
+    }
+
+    std::sort(out->begin(), out->end());
+    out->erase(std::unique(out->begin(), out->end()), out->end());
+}
+
+index_trigram :: index_trigram()
+{
+}
+
+index_trigram :: ~index_trigram() throw ()
+{
+}
+
+hyperdatatype
+index_trigram :: datatype() const
+{
+    return HYPERDATATYPE_STRING;
+}
+
+void
+index_trigram :: index_changes(const index* idx,
+                               const region_id& ri,
+                               const index_encoding* key_ie,
+                               const e::slice& key,
+                               const e::slice* old_value,
+                               const e::slice* new_value,
+                               leveldb::WriteBatch* updates) const
+{
+    if (old_value && new_value && *old_value == *new_value)
+    {
+        return;
+    }
+
+    std::vector<std::string> old_trigrams;
+    std::vector<std::string> new_trigrams;
+
+    if (old_value)
+    {
+        trigrams(reinterpret_cast<const char*>(old_value->data()),
+                 old_value->size(), &old_trigrams);
+    }
+
+    if (new_value)
+    {
+        trigrams(reinterpret_cast<const char*>(new_value->data()),
+                 new_value->size(), &new_trigrams);
+    }
+
+    // only touch the postings that actually change
+    std::vector<std::string> removed;
+    std::vector<std::string> added;
+    std::set_difference(old_trigrams.begin(), old_trigrams.end(),
+                        new_trigrams.begin(), new_trigrams.end(),
+                        std::back_inserter(removed));
+    std::set_difference(new_trigrams.begin(), new_trigrams.end(),
+                        old_trigrams.begin(), old_trigrams.end(),
+                        std::back_inserter(added));
+    std::vector<char> scratch;
+    e::slice slice;
+
+    for (size_t i = 0; i < removed.size(); ++i)
+    {
+        index_entry(ri, idx->id, removed[i].data(), key_ie, key, &scratch, &slice);
+        updates->Delete(e2level(slice));
+    }
+
+    for (size_t i = 0; i < added.size(); ++i)
+    {
+        index_entry(ri, idx->id, added[i].data(), key_ie, key, &scratch, &slice);
+        updates->Put(e2level(slice), leveldb::Slice());
+    }
+}
+
+datalayer::index_iterator*
+index_trigram :: iterator_from_check(leveldb_snapshot_ptr snap,
+                                     const region_id& ri,
+                                     const index_id& ii,
+                                     const attribute_check& c,
+                                     const index_encoding* key_ie) const
+{
+    if (c.predicate != HYPERPREDICATE_REGEX ||
+        c.datatype != HYPERDATATYPE_STRING)
+    {
+        return NULL;
+    }
+
+    compiled_regex re;
+    re.compile(c.value.data(), c.value.size());
+    const std::vector<std::string>& literals(re.literals());
+    std::vector<std::string> required;
+
+    for (size_t i = 0; i < literals.size(); ++i)
+    {
+        std::vector<std::string> tmp;
+        trigrams(literals[i].data(), literals[i].size(), &tmp);
+        required.insert(required.end(), tmp.begin(), tmp.end());
+    }
+
+    std::sort(required.begin(), required.end());
+    required.erase(std::unique(required.begin(), required.end()), required.end());
+
+    if (required.empty())
+    {
+        return NULL;
+    }
+
+    if (required.size() > TRIGRAM_MAX_POSTINGS)
+    {
+        required.resize(TRIGRAM_MAX_POSTINGS);
+    }
+
+    size_t range_prefix_sz = index_entry_prefix_size(ri, ii);
+    std::vector<e::intrusive_ptr<datalayer::index_iterator> > postings;
+
+    for (size_t i = 0; i < required.size(); ++i)
+    {
+        std::vector<char> scratch;
+        e::slice entry;
+        index_entry(ri, ii, required[i].data(), &scratch, &entry);
+        datalayer::index_iterator* it;
+        it = new datalayer::range_index_iterator(snap, range_prefix_sz,
+                                                 entry, entry,
+                                                 true, true,
+                                                 &e_trigram, key_ie);
+
+        if (required.size() == 1)
+        {
+            return it;
+        }
+
+        postings.push_back(it);
+    }
+
+    return new datalayer::intersect_iterator(snap, postings);
+}
+
+size_t
+index_trigram :: index_entry_prefix_size(const region_id& ri, const index_id& ii) const
+{
+    return sizeof(uint8_t)
+         + e::varint_length(ri.get())
+         + e::varint_length(ii.get());
+}
+
+void
+index_trigram :: index_entry(const region_id& ri,
+                             const index_id& ii,
+                             const char* trigram,
+                             std::vector<char>* scratch,
+                             e::slice* slice) const
+{
+    size_t sz = index_entry_prefix_size(ri, ii) + TRIGRAM_SZ;
+
+    if (scratch->size() < sz)
+    {
+        scratch->resize(sz);
+    }
+
+    char* ptr = &scratch->front();
+    ptr = e::pack8be('i', ptr);
+    ptr = e::packvarint64(ri.get(), ptr);
+    ptr = e::packvarint64(ii.get(), ptr);
+    memmove(ptr, trigram, TRIGRAM_SZ);
+    ptr += TRIGRAM_SZ;
+    assert(ptr == &scratch->front() + sz);
+    *slice = e::slice(&scratch->front(), sz);
+}
+
+void
+index_trigram :: index_entry(const region_id& ri,
+                             const index_id& ii,
+                             const char* trigram,
+                             const index_encoding* key_ie,
+                             const e::slice& key,
+                             std::vector<char>* scratch,
+                             e::slice* slice) const
+{
+    // the trigram is fixed in size, so the key needs no length suffix
+    size_t key_sz = key_ie->encoded_size(key);
+    size_t sz = index_entry_prefix_size(ri, ii) + TRIGRAM_SZ + key_sz;
+
+    if (scratch->size() < sz)
+    {
+        scratch->resize(sz);
+    }
+
+    char* ptr = &scratch->front();
+    ptr = e::pack8be('i', ptr);
+    ptr = e::packvarint64(ri.get(), ptr);
+    ptr = e::packvarint64(ii.get(), ptr);
+    memmove(ptr, trigram, TRIGRAM_SZ);
+    ptr += TRIGRAM_SZ;
+    ptr = key_ie->encode(key, ptr);
+    assert(ptr == &scratch->front() + sz);
+    *slice = e::slice(&scratch->front(), sz);
+}
+
+index_encoding_trigram :: index_encoding_trigram()
+{
+}
+
+index_encoding_trigram :: ~index_encoding_trigram() throw ()
+{
+}
+
+bool
+index_encoding_trigram :: encoding_fixed() const
+{
+    return true;
+}
+
+size_t
+index_encoding_trigram :: encoded_size(const e::slice&) const
+{
+    return TRIGRAM_SZ;
+}
+
+char*
+index_encoding_trigram :: encode(const e::slice& decoded, char* encoded) const
+{
+    assert(decoded.size() == TRIGRAM_SZ);
+    memmove(encoded, decoded.data(), TRIGRAM_SZ);
+    return encoded + TRIGRAM_SZ;
+}
+
+size_t
+index_encoding_trigram :: decoded_size(const e::slice&) const
+{
+    return TRIGRAM_SZ;
+}
+
+char*
+index_encoding_trigram :: decode(const e::slice& encoded, char* decoded) const
+{
+    assert(encoded.size() == TRIGRAM_SZ);
+    memmove(decoded, encoded.data(), TRIGRAM_SZ);
+    return decoded + TRIGRAM_SZ;
+}
@@ -30,10 +30,32 @@
 // Google Log
 #include <glog/logging.h>
 
+// e
+#include <e/serialization.h>
+
 // HyperDex
 #include "daemon/key_operation.h"
 
 using hyperdex::key_operation;
+using hyperdex::memory_accounting;
+
+namespace
+{
+
+size_t
+values_size(const std::vector<e::slice>& value)
+{
+    size_t sz = 0;
+
+    for (size_t i = 0; i < value.size(); ++i)
+    {
+        sz += value[i].size();
+    }
+
+    return sz;
+}
+
+} // namespace
 
 key_operation :: key_operation(uint64_t old_version,
                                uint64_t new_version,
@@ -51,14 +73,24 @@ key_operation :: key_operation(uint64_t old_version,
     , m_recv()
     , m_sent_config_version()
     , m_sent()
+    , m_sent_at(0)
+    , m_retransmits(0)
+    , m_trace_id(0)
     , m_value(_value)
     , m_memory(memory)
+    , m_delta()
+    , m_needs_value(false)
     , m_type(UNKNOWN)
     , m_this_old_region()
     , m_this_new_region()
     , m_prev_region()
     , m_next_region()
+    , m_charge(memory_accounting::QUEUED_VALUES, sizeof(key_operation) + values_size(_value))
 {
+    for (size_t i = 0; i < NUM_STAGES; ++i)
+    {
+        m_stages[i] = 0;
+    }
 }
 
 key_operation :: ~key_operation() throw ()
@@ -109,13 +141,84 @@ key_operation :: set_discontinuous(const region_id& pr,
     m_next_region = nr;
 }
 
+bool
+key_operation :: apply_delta(const schema& sc, const e::slice& key,
+                             const std::vector<e::slice>& old_value)
+{
+    assert(m_needs_value);
+    assert(m_has_value);
+    // the funcs point into m_delta, which outlives them here, and the
+    // values they make go into m_memory alongside the message they came in
+    e::unpacker up(m_delta.data(), m_delta.size());
+    uint32_t count = 0;
+    up = up >> count;
+    std::vector<e::slice> value(old_value);
+    std::vector<e::slice> next(sc.attrs_sz - 1);
+    std::vector<funcall> funcs;
+
+    for (uint32_t i = 0; !up.error() && i < count; ++i)
+    {
+        funcs.clear();
+        up = up >> funcs;
+
+        if (up.error() ||
+            validate_funcs(sc, funcs) < funcs.size() ||
+            apply_funcs(sc, funcs, key, value, m_memory.get(), &next) < funcs.size())
+        {
+            return false;
+        }
+
+        value.swap(next);
+    }
+
+    if (up.error() || up.remain() != 0)
+    {
+        return false;
+    }
+
+    m_value = value;
+    m_needs_value = false;
+    m_charge.set(sizeof(key_operation) + values_size(m_value) + m_delta.size());
+    return true;
+}
+
+void
+key_operation :: set_delta(const std::string& delta)
+{
+    m_delta = delta;
+    m_charge.set(sizeof(key_operation) + values_size(m_value) + m_delta.size());
+}
+
+const char*
+key_operation :: stage_name(stage_t s)
+{
+    switch (s)
+    {
+        case RECEIVED:
+            return "received";
+        case STARTED:
+            return "started";
+        case SENT:
+            return "sent";
+        case ACKED:
+            return "acked";
+        case COMMITTED:
+            return "committed";
+        case NUM_STAGES:
+        default:
+            return "unknown";
+    }
+}
+
 void
 key_operation :: debug_dump()
 {
     LOG(INFO) << "    unique op id: prev=" << m_prev_version << " this=" << m_this_version;
     LOG(INFO) << "    has value: " << (m_has_value ? "yes" : "no");
+    LOG(INFO) << "    delta: " << m_delta.size() << " bytes" << (m_needs_value ? " (unapplied)" : "");
     LOG(INFO) << "    recv: version=" << m_recv_config_version << " from=" << m_recv;
-    LOG(INFO) << "    sent: version=" << m_sent_config_version << " to=" << m_sent;
+    LOG(INFO) << "    sent: version=" << m_sent_config_version << " to=" << m_sent
+              << " at=" << m_sent_at << " retransmits=" << m_retransmits;
     LOG(INFO) << "    fresh: " << (m_fresh ? "yes" : "no");
     LOG(INFO) << "    acked: " << (m_acked ? "yes" : "no");
     LOG(INFO) << "    prev: " << m_prev_region;
@@ -123,3 +226,18 @@ key_operation :: debug_dump()
     LOG(INFO) << "    this_new: " << m_this_new_region;
     LOG(INFO) << "    next: " << m_next_region;
 }
+
+std::string
+hyperdex :: pack_delta(const std::vector<const std::vector<funcall>*>& changes)
+{
+    std::string delta;
+    e::packer pa(&delta);
+    pa = pa << uint32_t(changes.size());
+
+    for (size_t i = 0; i < changes.size(); ++i)
+    {
+        pa = pa << *changes[i];
+    }
+
+    return delta;
+}
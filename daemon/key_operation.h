@@ -30,6 +30,8 @@
 
 // STL
 #include <memory>
+#include <string>
+#include <vector>
 
 // e
 #include <e/arena.h>
@@ -37,11 +39,15 @@
 
 // HyperDex
 #include "namespace.h"
+#include "common/funcall.h"
 #include "common/ids.h"
+#include "common/schema.h"
+#include "daemon/memory_accounting.h"
+#include "daemon/object_pool.h"
 
 BEGIN_HYPERDEX_NAMESPACE
 
-class key_operation
+class key_operation : public pooled<key_operation>
 {
     public:
         key_operation(uint64_t old_version,
@@ -72,6 +78,27 @@ class key_operation
         uint64_t sent_version() const { return m_sent_config_version; }
         bool sent_to(uint64_t version, const virtual_server_id& vsi) const
         { return m_sent_config_version == version && m_sent == vsi; }
+        // when it was last sent, and how many times the retransmitter has
+        // sent it again since the first time
+        void set_sent_at(uint64_t when) { m_sent_at = when; }
+        uint64_t sent_at() const { return m_sent_at; }
+        void count_retransmit() { ++m_retransmits; }
+        unsigned retransmits() const { return m_retransmits; }
+
+        // when a client's op passed each stage at its point leader, for the
+        // slow op log; only ops begun by "time_from" are timed, and each
+        // stage keeps the first time it is stamped
+        enum stage_t { RECEIVED, STARTED, SENT, ACKED, COMMITTED, NUM_STAGES };
+        static const char* stage_name(stage_t s);
+        void time_from(uint64_t received, uint64_t started)
+        { m_stages[RECEIVED] = received; m_stages[STARTED] = started; }
+        bool timed() const { return m_stages[RECEIVED] != 0; }
+        void stamp(stage_t s, uint64_t when)
+        { if (timed() && m_stages[s] == 0) m_stages[s] = when; }
+        uint64_t stamped(stage_t s) const { return m_stages[s]; }
+        // the id every server's span of a traced op shares; 0 if untraced
+        void set_trace_id(uint64_t id) { m_trace_id = id; }
+        uint64_t trace_id() const { return m_trace_id; }
 
         // the path of the op through the value-dependent chain
         bool is_continuous() { return m_type == CONTINUOUS; }
@@ -97,6 +124,18 @@ class key_operation
         bool has_value() { return m_has_value; }
         const std::vector<e::slice>& value() { return m_value; }
 
+        // the funcs that took the previous version's value to this one, as
+        // made by "pack_delta"; empty when they are not known
+        const std::string& delta() const { return m_delta; }
+        void set_delta(const std::string& delta);
+        void clear_delta() { m_delta.clear(); }
+        // an op that arrived as a delta has no value until "apply_delta"
+        // runs it against the value of the previous version
+        bool needs_value() const { return m_needs_value; }
+        void set_needs_value() { m_needs_value = true; }
+        bool apply_delta(const schema& sc, const e::slice& key,
+                         const std::vector<e::slice>& old_value);
+
         void debug_dump();
 
     private:
@@ -116,21 +155,32 @@ class key_operation
         virtual_server_id m_recv; // we recv from here
         uint64_t m_sent_config_version;
         virtual_server_id m_sent; // we sent to here
+        uint64_t m_sent_at;
+        unsigned m_retransmits;
+        uint64_t m_stages[NUM_STAGES];
+        uint64_t m_trace_id;
 
-        const std::vector<e::slice> m_value;
+        std::vector<e::slice> m_value;
         const std::auto_ptr<e::arena> m_memory;
+        std::string m_delta;
+        bool m_needs_value;
 
         enum { UNKNOWN, CONTINUOUS, DISCONTINUOUS } m_type;
         region_id m_this_old_region;
         region_id m_this_new_region;
         region_id m_prev_region;
         region_id m_next_region;
+        memory_charge m_charge;
 
     private:
         key_operation(const key_operation&);
         key_operation& operator = (const key_operation&);
 };
 
+// pack the funcs of the changes an op applies, in the order they apply
+std::string
+pack_delta(const std::vector<const std::vector<funcall>*>& changes);
+
 END_HYPERDEX_NAMESPACE
 
 #endif // hyperdex_daemon_key_operation_h_
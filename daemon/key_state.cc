@@ -27,17 +27,25 @@
 
 #define __STDC_LIMIT_MACROS
 
+// STL
+#include <sstream>
+
 // Google Log
 #include <glog/logging.h>
 
+// po6
+#include <po6/time.h>
+
 // HyperDex
 #include "common/hash.h"
 #include "common/network_returncode.h"
 #include "daemon/auth.h"
 #include "daemon/daemon.h"
+#include "daemon/expiry.h"
 #include "daemon/key_region.h"
 #include "daemon/key_state.h"
 #include "daemon/key_operation.h"
+#include "daemon/replication_manager_committer.h"
 
 #if 0
 #define CHECK_INVARIANTS() this->check_invariants()
@@ -48,19 +56,30 @@
 using hyperdex::key_operation;
 using hyperdex::key_region;
 using hyperdex::key_state;
+using hyperdex::pool_stats;
+using hyperdex::pooled;
+
+// most client changes folded into the chain op of the change before them
+#define MAX_MERGED_CHANGES 256
+// one in this many acked versions feeds the round trip estimate of its peer
+#define RTT_SAMPLE_EVERY 16
 
-struct key_state::deferred_key_change
+struct key_state::deferred_key_change : public pooled<deferred_key_change>
 {
     deferred_key_change(const server_id& _from,
                         uint64_t _nonce, uint64_t _version,
                         std::auto_ptr<key_change> _kc,
-                        std::auto_ptr<e::buffer> _backing)
+                        std::auto_ptr<e::buffer> _backing,
+                        uint64_t _received)
         : from(_from)
         , nonce(_nonce)
         , version(_version)
         , kc(_kc)
         , backing(_backing)
+        , received(_received)
         , m_ref(0)
+        , m_charge(hyperdex::memory_accounting::QUEUED_VALUES,
+                   sizeof(deferred_key_change) + (backing.get() ? backing->capacity() : 0))
     {
     }
 
@@ -72,9 +91,12 @@ struct key_state::deferred_key_change
     const uint64_t version;
     const std::auto_ptr<key_change> kc;
     const std::auto_ptr<e::buffer> backing;
+    // when it arrived, or 0 when slow ops are not being logged
+    const uint64_t received;
 
     private:
         size_t m_ref;
+        hyperdex::memory_charge m_charge;
 
     private:
         deferred_key_change(const deferred_key_change&);
@@ -112,20 +134,29 @@ key_state :: key_state(const key_region& kr)
     : m_ri(kr.region)
     , m_key_backing(reinterpret_cast<const char*>(kr.key.data()), kr.key.size())
     , m_key(m_key_backing.data(), m_key_backing.size())
+    , m_charge(hyperdex::memory_accounting::KEY_STATES, sizeof(key_state) + kr.key.size())
     , m_client_atomics()
     , m_chain_ops()
     , m_chain_subspaces()
     , m_chain_acks()
-    , m_lock()
-    , m_avail(&m_lock)
+    , m_lock(lock_profile::KEY_STATE)
+    , m_avail(m_lock.raw())
     , m_someone_is_working_the_state_machine(false)
     , m_someone_needs_to_work_the_state_machine(false)
+    , m_parked()
     , m_initialized(false)
     , m_has_old_value(false)
     , m_old_version(0)
     , m_old_value()
     , m_old_disk_ref()
     , m_old_op()
+    , m_warm_pending(false)
+    , m_warm_on_disk(false)
+    , m_warm_generation(0)
+    , m_committing(false)
+    , m_commit_failed(false)
+    , m_commit_op()
+    , m_commit_us()
     , m_client_responses_heap()
     , m_committable()
     , m_committable_empty(true)
@@ -142,6 +173,12 @@ key_state :: ~key_state() throw ()
 {
     m_lock.lock();
     m_lock.unlock();
+
+    // only a running state machine has any, and it resumes them as it stops
+    for (size_t i = 0; i < m_parked.size(); ++i)
+    {
+        delete m_parked[i];
+    }
 }
 
 key_region
@@ -153,9 +190,10 @@ key_state :: state_key() const
 bool
 key_state :: finished()
 {
-    po6::threads::mutex::hold hold(&m_lock);
+    profiled_mutex::hold hold(&m_lock);
     return !m_someone_is_working_the_state_machine &&
            !m_someone_needs_to_work_the_state_machine &&
+           !m_committing &&
            m_committable_empty &&
            m_blocked_empty &&
            m_deferred_empty &&
@@ -165,7 +203,7 @@ key_state :: finished()
 bool
 key_state :: initialized()
 {
-    po6::threads::mutex::hold hold(&m_lock);
+    profiled_mutex::hold hold(&m_lock);
     return m_initialized;
 }
 
@@ -174,7 +212,7 @@ key_state :: initialize(datalayer* data,
                         const schema&,
                         const region_id& ri)
 {
-    po6::threads::mutex::hold hold(&m_lock);
+    profiled_mutex::hold hold(&m_lock);
 
     // maybe we get lucky
     if (m_initialized)
@@ -182,10 +220,7 @@ key_state :: initialize(datalayer* data,
         return datalayer::SUCCESS;
     }
 
-    while (m_someone_is_working_the_state_machine)
-    {
-        m_avail.wait();
-    }
+    wait_for_state_machine();
 
     // make sure someone else didn't initialize while we waited
     if (m_initialized)
@@ -193,7 +228,8 @@ key_state :: initialize(datalayer* data,
         return datalayer::SUCCESS;
     }
 
-    datalayer::returncode rc = data->get(ri, m_key, &m_old_value, &m_old_version, &m_old_disk_ref);
+    datalayer::returncode rc = data->get_remembered(ri, m_key, &m_old_value, &m_old_version,
+                                                    &m_old_disk_ref, &m_warm_generation);
 
     switch (rc)
     {
@@ -216,7 +252,7 @@ key_state :: initialize(datalayer* data,
     return rc;
 }
 
-struct key_state::stub_client_atomic
+struct key_state::stub_client_atomic : public pooled<stub_client_atomic>
 {
     stub_client_atomic(const server_id& f,
                        uint64_t n,
@@ -255,7 +291,7 @@ key_state :: enqueue_client_atomic(replication_manager* rm,
     }
 }
 
-struct key_state::stub_chain_op
+struct key_state::stub_chain_op : public pooled<stub_chain_op>
 {
     stub_chain_op(const virtual_server_id& _from,
                   uint64_t _old_version,
@@ -263,14 +299,18 @@ struct key_state::stub_chain_op
                   bool _fresh,
                   bool _has_value,
                   const std::vector<e::slice>& _value,
-                  std::auto_ptr<e::buffer> _backing)
+                  const e::slice& _delta,
+                  std::auto_ptr<e::buffer> _backing,
+                  uint64_t _trace_id)
         : from(_from)
         , old_version(_old_version)
         , new_version(_new_version)
         , fresh(_fresh)
         , has_value(_has_value)
         , value(_value)
+        , delta(_delta)
         , backing(_backing)
+        , trace_id(_trace_id)
     {
     }
     ~stub_chain_op() throw () {}
@@ -281,7 +321,9 @@ struct key_state::stub_chain_op
     bool fresh;
     bool has_value;
     std::vector<e::slice> value;
+    e::slice delta;
     std::auto_ptr<e::buffer> backing;
+    uint64_t trace_id;
 };
 
 void
@@ -294,24 +336,26 @@ key_state :: enqueue_chain_op(replication_manager* rm,
                               bool fresh,
                               bool has_value,
                               const std::vector<e::slice>& value,
-                              std::auto_ptr<e::buffer> backing)
+                              const e::slice& delta,
+                              std::auto_ptr<e::buffer> backing,
+                              uint64_t trace_id)
 {
     bool have_it = possibly_takeover_state_machine();
 
     if (have_it)
     {
-        do_chain_op(rm, us, sc, from, old_version, new_version, fresh, has_value, value, backing);
+        do_chain_op(rm, us, sc, from, old_version, new_version, fresh, has_value, value, delta, backing, trace_id);
         work_state_machine_with_work_bit(rm, us, sc);
     }
     else
     {
-        m_chain_ops.push(new stub_chain_op(from, old_version, new_version, fresh, has_value, value, backing));
+        m_chain_ops.push(new stub_chain_op(from, old_version, new_version, fresh, has_value, value, delta, backing, trace_id));
         someone_needs_to_work_the_state_machine();
         work_state_machine_or_pass_the_buck(rm, us, sc);
     }
 }
 
-struct key_state::stub_chain_subspace
+struct key_state::stub_chain_subspace : public pooled<stub_chain_subspace>
 {
     stub_chain_subspace(const virtual_server_id& _from,
                         uint64_t _old_version,
@@ -321,7 +365,8 @@ struct key_state::stub_chain_subspace
                         const region_id& _prev_region,
                         const region_id& _this_old_region,
                         const region_id& _this_new_region,
-                        const region_id& _next_region)
+                        const region_id& _next_region,
+                        uint64_t _trace_id)
         : from(_from)
         , old_version(_old_version)
         , new_version(_new_version)
@@ -331,6 +376,7 @@ struct key_state::stub_chain_subspace
         , this_old_region(_this_old_region)
         , this_new_region(_this_new_region)
         , next_region(_next_region)
+        , trace_id(_trace_id)
     {
     }
     ~stub_chain_subspace() throw () {}
@@ -344,6 +390,7 @@ struct key_state::stub_chain_subspace
     region_id this_old_region;
     region_id this_new_region;
     region_id next_region;
+    uint64_t trace_id;
 };
 
 void
@@ -358,24 +405,25 @@ key_state :: enqueue_chain_subspace(replication_manager* rm,
                                     const region_id& prev_region,
                                     const region_id& this_old_region,
                                     const region_id& this_new_region,
-                                    const region_id& next_region)
+                                    const region_id& next_region,
+                                    uint64_t trace_id)
 {
     bool have_it = possibly_takeover_state_machine();
 
     if (have_it)
     {
-        do_chain_subspace(rm, us, sc, from, old_version, new_version, value, backing, prev_region, this_old_region, this_new_region, next_region);
+        do_chain_subspace(rm, us, sc, from, old_version, new_version, value, backing, prev_region, this_old_region, this_new_region, next_region, trace_id);
         work_state_machine_with_work_bit(rm, us, sc);
     }
     else
     {
-        m_chain_subspaces.push(new stub_chain_subspace(from, old_version, new_version, value, backing, prev_region, this_old_region, this_new_region, next_region));
+        m_chain_subspaces.push(new stub_chain_subspace(from, old_version, new_version, value, backing, prev_region, this_old_region, this_new_region, next_region, trace_id));
         someone_needs_to_work_the_state_machine();
         work_state_machine_or_pass_the_buck(rm, us, sc);
     }
 }
 
-struct key_state::stub_chain_ack
+struct key_state::stub_chain_ack : public pooled<stub_chain_ack>
 {
     stub_chain_ack(const virtual_server_id& _from,
                    uint64_t _version)
@@ -422,12 +470,9 @@ key_state :: work_state_machine(replication_manager* rm,
 uint64_t
 key_state :: max_version()
 {
-    po6::threads::mutex::hold hold(&m_lock);
+    profiled_mutex::hold hold(&m_lock);
 
-    while (m_someone_is_working_the_state_machine)
-    {
-        m_avail.wait();
-    }
+    wait_for_state_machine();
 
     uint64_t ret = 0;
 
@@ -458,16 +503,34 @@ key_state :: max_version()
     return ret;
 }
 
-void
-key_state :: reconfigure(e::garbage_collector* gc)
+bool
+key_state :: pending_writes(uint64_t* pending, std::auto_ptr<waiter>* w)
 {
-    po6::threads::mutex::hold hold(&m_lock);
+    profiled_mutex::hold hold(&m_lock);
 
-    while (m_someone_is_working_the_state_machine)
+    // the queues belong to the state machine while it runs, and waiting
+    // for it would hold up a network thread behind a commit
+    if (m_someone_is_working_the_state_machine)
     {
-        m_avail.wait();
+        if (w && w->get())
+        {
+            m_parked.push_back(w->release());
+        }
+
+        return false;
     }
 
+    *pending = queued_writes();
+    return true;
+}
+
+void
+key_state :: reconfigure(e::garbage_collector* gc)
+{
+    profiled_mutex::hold hold(&m_lock);
+
+    wait_for_state_machine();
+
     stub_client_atomic* sca;
     stub_chain_op* sco;
     stub_chain_subspace* scs;
@@ -500,12 +563,9 @@ key_state :: reconfigure(e::garbage_collector* gc)
 void
 key_state :: reset(e::garbage_collector* gc)
 {
-    po6::threads::mutex::hold hold(&m_lock);
+    profiled_mutex::hold hold(&m_lock);
 
-    while (m_someone_is_working_the_state_machine)
-    {
-        m_avail.wait();
-    }
+    wait_for_state_machine();
 
     stub_client_atomic* sca;
     stub_chain_op* sco;
@@ -543,44 +603,70 @@ key_state :: reset(e::garbage_collector* gc)
     CHECK_INVARIANTS();
 }
 
-void
+bool
 key_state :: resend_committable(replication_manager* rm,
                                 const virtual_server_id& us)
 {
-    po6::threads::mutex::hold hold(&m_lock);
+    profiled_mutex::hold hold(&m_lock);
 
-    while (m_someone_is_working_the_state_machine)
-    {
-        m_avail.wait();
-    }
+    wait_for_state_machine();
 
     CHECK_INVARIANTS();
+    const configuration& config(rm->m_daemon->config());
+    const uint64_t now = po6::monotonic_time();
+    bool again = false;
 
     for (key_operation_list_t::iterator it = m_committable.begin();
             it != m_committable.end(); ++it)
     {
-        // skip those messages already sent in this version
-        if ((*it)->sent_version() >= rm->m_daemon->m_config.version())
+        key_operation* op = it->get();
+
+        // those messages already sent in this version get sent again only
+        // once they have gone unacknowledged past their peer's timeout
+        if (op->sent_version() >= config.version())
         {
-            continue;
+            if (op->ackable())
+            {
+                continue;
+            }
+
+            server_id peer = config.get_server_id(op->sent_to());
+
+            if (now - op->sent_at() < rm->m_timer.timeout(peer, op->retransmits()))
+            {
+                // the ones we already resent are ours to follow up on
+                again = again || op->retransmits() > 0;
+                continue;
+            }
+
+            rm->m_retransmit_timeouts.tap();
+            rm->check_peer_lease(peer, op->sent_at(), now);
         }
 
-        (*it)->set_sent(0, virtual_server_id());
-        rm->send_message(us, m_key, *it);
+        // resend the full value; whoever missed the op may not have the
+        // version its delta builds upon
+        bool deferred = false;
+        op->clear_delta();
+        op->set_sent(0, virtual_server_id());
+
+        if (rm->resend_message(us, m_key, *it, &deferred))
+        {
+            again = again || !op->ackable();
+        }
+
+        again = again || deferred;
     }
 
     CHECK_INVARIANTS();
+    return again;
 }
 
 void
 key_state :: append_all_versions(std::vector<std::pair<region_id, uint64_t> >* versions)
 {
-    po6::threads::mutex::hold hold(&m_lock);
+    profiled_mutex::hold hold(&m_lock);
 
-    while (m_someone_is_working_the_state_machine)
-    {
-        m_avail.wait();
-    }
+    wait_for_state_machine();
 
     size_t sz = versions->size() + m_committable.size() + m_blocked.size() + m_deferred.size();
 
@@ -613,12 +699,9 @@ key_state :: append_all_versions(std::vector<std::pair<region_id, uint64_t> >* v
 void
 key_state :: debug_dump()
 {
-    po6::threads::mutex::hold hold(&m_lock);
+    profiled_mutex::hold hold(&m_lock);
 
-    while (m_someone_is_working_the_state_machine)
-    {
-        m_avail.wait();
-    }
+    wait_for_state_machine();
 
     LOG(INFO) << " old " << m_old_version;
 
@@ -644,6 +727,33 @@ key_state :: debug_dump()
     }
 }
 
+#define DUMP_POOL(NAME, TAG) \
+    LOG(INFO) << NAME << " in_use=" << pool_stats<TAG>::in_use() \
+              << " cached=" << pool_stats<TAG>::cached()
+
+void
+key_state :: debug_dump_pools()
+{
+    DUMP_POOL("key_state", key_state);
+    DUMP_POOL("key_operation", key_operation);
+    DUMP_POOL("deferred_key_change", deferred_key_change);
+    DUMP_POOL("stub_client_atomic", stub_client_atomic);
+    DUMP_POOL("stub_chain_op", stub_chain_op);
+    DUMP_POOL("stub_chain_subspace", stub_chain_subspace);
+    DUMP_POOL("stub_chain_ack", stub_chain_ack);
+    DUMP_POOL("key_operation_list_t nodes", e::intrusive_ptr<key_operation>);
+    DUMP_POOL("key_change_list_t nodes", e::intrusive_ptr<deferred_key_change>);
+}
+
+#undef DUMP_POOL
+
+uint64_t
+key_state :: queued_writes() const
+{
+    return m_committable.size() + m_blocked.size()
+         + m_deferred.size() + m_changes.size();
+}
+
 void
 key_state :: check_invariants() const
 {
@@ -708,13 +818,65 @@ key_state :: check_invariants() const
     assert(m_changes_empty == m_changes.empty());
 }
 
+uint64_t
+key_state :: latest_version() const
+{
+    // queued changes are newer than anything else; see check_invariants
+    if (!m_changes.empty())
+    {
+        return m_changes.back()->version;
+    }
+
+    uint64_t ret = m_old_version;
+
+    if (!m_committable.empty())
+    {
+        ret = std::max(ret, m_committable.back()->this_version());
+    }
+
+    if (!m_blocked.empty())
+    {
+        ret = std::max(ret, m_blocked.back()->this_version());
+    }
+
+    for (key_operation_list_t::const_iterator it = m_deferred.begin();
+            it != m_deferred.end(); ++it)
+    {
+        ret = std::max(ret, (*it)->this_version());
+    }
+
+    return ret;
+}
+
 void
 key_state :: someone_needs_to_work_the_state_machine()
 {
-    po6::threads::mutex::hold hold(&m_lock);
+    profiled_mutex::hold hold(&m_lock);
     m_someone_needs_to_work_the_state_machine = true;
 }
 
+void
+key_state :: wait_for_state_machine()
+{
+    if (!m_someone_is_working_the_state_machine)
+    {
+        return;
+    }
+
+    const uint64_t start = lock_profile::sampled() ? po6::monotonic_time() : 0;
+
+    while (m_someone_is_working_the_state_machine)
+    {
+        m_avail.wait();
+    }
+
+    if (start > 0)
+    {
+        lock_profile::record_wait(lock_profile::KEY_STATE_HANDOFF,
+                                  po6::monotonic_time() - start);
+    }
+}
+
 void
 key_state :: work_state_machine_or_pass_the_buck(replication_manager* rm,
                                                  const virtual_server_id& us,
@@ -729,12 +891,9 @@ key_state :: work_state_machine_or_pass_the_buck(replication_manager* rm,
 void
 key_state :: takeover_state_machine()
 {
-    po6::threads::mutex::hold hold(&m_lock);
+    profiled_mutex::hold hold(&m_lock);
 
-    while (m_someone_is_working_the_state_machine)
-    {
-        m_avail.wait();
-    }
+    wait_for_state_machine();
 
     m_someone_is_working_the_state_machine = true;
 }
@@ -742,7 +901,7 @@ key_state :: takeover_state_machine()
 bool
 key_state :: possibly_takeover_state_machine()
 {
-    po6::threads::mutex::hold hold(&m_lock);
+    profiled_mutex::hold hold(&m_lock);
     bool have_it = !m_someone_is_working_the_state_machine;
     m_someone_is_working_the_state_machine = true;
     return have_it;
@@ -753,6 +912,9 @@ key_state :: work_state_machine_with_work_bit(replication_manager* rm,
                                               const virtual_server_id& us,
                                               const schema& sc)
 {
+    std::vector<waiter*> parked;
+    uint64_t pending = 0;
+
     while (true)
     {
         m_lock.lock();
@@ -772,14 +934,15 @@ key_state :: work_state_machine_with_work_bit(replication_manager* rm,
 
         while (m_chain_ops.pop(gc, &sco))
         {
-            do_chain_op(rm, us, sc, sco->from, sco->old_version, sco->new_version, sco->fresh, sco->has_value, sco->value, sco->backing);
+            do_chain_op(rm, us, sc, sco->from, sco->old_version, sco->new_version, sco->fresh, sco->has_value, sco->value, sco->delta, sco->backing, sco->trace_id);
             delete sco;
         }
 
         while (m_chain_subspaces.pop(gc, &scs))
         {
             do_chain_subspace(rm, us, sc, scs->from, scs->old_version, scs->new_version, scs->value, scs->backing,
-                              scs->prev_region, scs->this_old_region, scs->this_new_region, scs->next_region);
+                              scs->prev_region, scs->this_old_region, scs->this_new_region, scs->next_region,
+                              scs->trace_id);
             delete scs;
         }
 
@@ -837,20 +1000,65 @@ key_state :: work_state_machine_with_work_bit(replication_manager* rm,
         }
 
         bool done = false;
-        po6::threads::mutex::hold hold(&m_lock);
+        profiled_mutex::hold hold(&m_lock);
         done = !m_someone_needs_to_work_the_state_machine;
         m_someone_is_working_the_state_machine = !done;
 
         if (done)
         {
+            m_commit_failed = false;
             m_committable_empty = m_committable.empty();
             m_blocked_empty = m_blocked.empty();
             m_deferred_empty = m_deferred.empty();
             m_changes_empty = m_changes.empty();
+
+            // the key state has gone idle, so leave what it committed behind
+            // for the next one to skip the read
+            if (m_warm_pending &&
+                m_committable_empty && m_blocked_empty &&
+                m_deferred_empty && m_changes_empty)
+            {
+                rm->m_daemon->m_data.remember(m_ri, m_key,
+                                              m_warm_on_disk ? &m_old_value : NULL,
+                                              m_old_version, m_warm_generation);
+                m_warm_pending = false;
+            }
+
+            parked.swap(m_parked);
+            pending = queued_writes();
             m_avail.broadcast();
             break;
         }
     }
+
+    for (size_t i = 0; i < parked.size(); ++i)
+    {
+        parked[i]->resume(pending);
+        delete parked[i];
+    }
+}
+
+void
+key_state :: commit(replication_manager* rm)
+{
+    // the state machine may be running elsewhere, but it leaves the op and
+    // the old value it is written over alone until the write completes
+    datalayer::returncode rc = write_committed(rm, m_commit_op.get());
+
+    {
+        profiled_mutex::hold hold(&m_lock);
+        wait_for_state_machine();
+        m_someone_is_working_the_state_machine = true;
+        m_committing = false;
+    }
+
+    e::intrusive_ptr<key_operation> op = m_commit_op;
+    m_commit_op = NULL;
+    record_committed(rm, op.get(), rc);
+    // the configuration the write was handed over in may have been retired,
+    // but one that changes this key's region pauses for the write first
+    const schema& sc(*rm->m_daemon->config().get_schema(m_ri));
+    work_state_machine_with_work_bit(rm, m_commit_us, sc);
 }
 
 void
@@ -862,18 +1070,44 @@ key_state :: do_client_atomic(replication_manager* rm,
                               std::auto_ptr<key_change> kc,
                               std::auto_ptr<e::buffer> backing)
 {
-    uint64_t version = rm->m_idgen.generate_id(m_ri);
+    // ids are leased to each thread in blocks, so only the floor keeps this
+    // key's versions increasing
+    uint64_t lease = 0;
+    uint64_t version = rm->m_idgen.generate_id(m_ri, latest_version(), &lease);
 
-    if (version % datalayer::REGION_PERIODIC == 0)
+    // the thread whose lease reaches into a new period records it for the
+    // whole lease, which may be given up before its first id is handed out
+    if (lease != 0 &&
+        (version % datalayer::REGION_PERIODIC == 0 ||
+         version / datalayer::REGION_PERIODIC != lease / datalayer::REGION_PERIODIC))
     {
-        rm->m_daemon->m_data.bump_version(m_ri, version);
+        rm->m_daemon->m_data.bump_version(m_ri, lease);
     }
 
     e::intrusive_ptr<deferred_key_change> dkc;
-    dkc = new deferred_key_change(from, nonce, version, kc, backing);
+    uint64_t received = rm->m_slow_op_threshold > 0 || rm->m_trace_sample > 0
+                      ? po6::monotonic_time() : 0;
+    dkc = new deferred_key_change(from, nonce, version, kc, backing, received);
     m_changes.push_back(dkc);
 }
 
+namespace
+{
+
+// ops that come down the chain are timed from when they reach this server
+void
+start_trace(key_operation* op, uint64_t trace_id)
+{
+    if (trace_id)
+    {
+        const uint64_t now = po6::monotonic_time();
+        op->time_from(now, now);
+        op->set_trace_id(trace_id);
+    }
+}
+
+} // namespace
+
 void
 key_state :: do_chain_op(replication_manager* rm,
                          const virtual_server_id& us,
@@ -884,7 +1118,9 @@ key_state :: do_chain_op(replication_manager* rm,
                          bool fresh,
                          bool has_value,
                          const std::vector<e::slice>& value,
-                         std::auto_ptr<e::buffer> backing)
+                         const e::slice& delta,
+                         std::auto_ptr<e::buffer> backing,
+                         uint64_t trace_id)
 {
     e::intrusive_ptr<key_operation> op = get(new_version);
     std::auto_ptr<e::arena> memory(new e::arena());
@@ -894,12 +1130,22 @@ key_state :: do_chain_op(replication_manager* rm,
     {
         op = enqueue_continuous_key_op(old_version, new_version, fresh,
                                        has_value, value, memory);
+        start_trace(op.get(), trace_id);
+
+        // the value gets built from the delta once the previous version is
+        // here; see drain_deferred
+        if (!delta.empty())
+        {
+            op->set_delta(std::string(reinterpret_cast<const char*>(delta.data()), delta.size()));
+            op->set_needs_value();
+        }
     }
 
     assert(op);
-    op->set_recv(rm->m_daemon->m_config.version(), from);
+    op->set_recv(rm->m_daemon->config().version(), from);
 
-    if (op->ackable())
+    if (op->ackable() &&
+        (op->this_version() <= m_old_version || !rm->acks_wait_for_disk(m_ri)))
     {
         rm->send_ack(us, m_key, op);
     }
@@ -917,7 +1163,8 @@ key_state :: do_chain_subspace(replication_manager* rm,
                                const region_id& prev_region,
                                const region_id& this_old_region,
                                const region_id& this_new_region,
-                               const region_id& next_region)
+                               const region_id& next_region,
+                               uint64_t trace_id)
 {
     e::intrusive_ptr<key_operation> op = get(new_version);
     std::auto_ptr<e::arena> memory(new e::arena());
@@ -929,12 +1176,14 @@ key_state :: do_chain_subspace(replication_manager* rm,
                                           value, memory,
                                           prev_region, this_old_region,
                                           this_new_region, next_region);
+        start_trace(op.get(), trace_id);
     }
 
     assert(op);
-    op->set_recv(rm->m_daemon->m_config.version(), from);
+    op->set_recv(rm->m_daemon->config().version(), from);
 
-    if (op->ackable())
+    if (op->ackable() &&
+        (op->this_version() <= m_old_version || !rm->acks_wait_for_disk(m_ri)))
     {
         rm->send_ack(us, m_key, op);
     }
@@ -957,13 +1206,28 @@ key_state :: do_chain_ack(replication_manager* rm,
         return;
     }
 
-    if (!op->sent_to(rm->m_daemon->m_config.version(), from))
+    if (!op->sent_to(rm->m_daemon->config().version(), from))
     {
         return;
     }
 
+    // Karn's rule:  the ack of an op sent more than once could be for any
+    // of its sends, so only ops sent once say anything of the round trip
+    if (op->retransmits() == 0 && op->sent_at() > 0 &&
+        op->this_version() % RTT_SAMPLE_EVERY == 0)
+    {
+        rm->m_timer.sample(rm->m_daemon->config().get_server_id(from),
+                           po6::monotonic_time() - op->sent_at());
+    }
+
     op->mark_acked();
-    rm->send_ack(us, m_key, op);
+    op->stamp(key_operation::ACKED, op->timed() ? po6::monotonic_time() : 0);
+
+    if (!rm->acks_wait_for_disk(m_ri))
+    {
+        rm->send_ack(us, m_key, op);
+    }
+
     rm->collect(m_ri, op);
 }
 
@@ -983,6 +1247,7 @@ key_state :: send_responses(replication_manager* rm,
            m_client_responses_heap[0].respond_after <= m_old_version)
     {
         const client_response& cr(m_client_responses_heap[0]);
+        rm->m_nonces.complete(m_ri, cr.client, cr.nonce, cr.ret);
         rm->respond_to_client(us, cr.client, cr.nonce, cr.ret);
 
         std::pop_heap(m_client_responses_heap.begin(),
@@ -994,8 +1259,9 @@ key_state :: send_responses(replication_manager* rm,
 namespace
 {
 
+template <typename L>
 bool
-get_by_version(const std::list<e::intrusive_ptr<key_operation> >& list,
+get_by_version(const L& list,
                uint64_t version, e::intrusive_ptr<key_operation>* op)
 {
     if (list.empty() || list.back()->this_version() < version)
@@ -1003,7 +1269,7 @@ get_by_version(const std::list<e::intrusive_ptr<key_operation> >& list,
         return false;
     }
 
-    for (std::list<e::intrusive_ptr<key_operation> >::const_iterator it = list.begin();
+    for (typename L::const_iterator it = list.begin();
             it != list.end(); ++it)
     {
         uint64_t v = (*it)->this_version();
@@ -1178,8 +1444,62 @@ key_state :: drain_queue(replication_manager* rm,
     return did_work;
 }
 
+namespace
+{
+
+// true if the change only applies funcs whose outcome does not depend on the
+// order they run in, and so may share a version with its neighbours
+bool
+is_commutative(const hyperdex::key_change& kc)
+{
+    if (kc.erase || kc.fail_if_found || !kc.checks.empty())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < kc.funcs.size(); ++i)
+    {
+        switch (kc.funcs[i].name)
+        {
+            case hyperdex::FUNC_NUM_ADD:
+            case hyperdex::FUNC_NUM_SUB:
+            case hyperdex::FUNC_NUM_MAX:
+            case hyperdex::FUNC_NUM_MIN:
+            case hyperdex::FUNC_SET_ADD:
+            case hyperdex::FUNC_SET_REMOVE:
+                break;
+            case hyperdex::FUNC_FAIL:
+            case hyperdex::FUNC_SET:
+            case hyperdex::FUNC_STRING_APPEND:
+            case hyperdex::FUNC_STRING_PREPEND:
+            case hyperdex::FUNC_STRING_LTRIM:
+            case hyperdex::FUNC_STRING_RTRIM:
+            case hyperdex::FUNC_NUM_MUL:
+            case hyperdex::FUNC_NUM_DIV:
+            case hyperdex::FUNC_NUM_MOD:
+            case hyperdex::FUNC_NUM_AND:
+            case hyperdex::FUNC_NUM_OR:
+            case hyperdex::FUNC_NUM_XOR:
+            case hyperdex::FUNC_LIST_LPUSH:
+            case hyperdex::FUNC_LIST_RPUSH:
+            case hyperdex::FUNC_SET_INTERSECT:
+            case hyperdex::FUNC_SET_UNION:
+            case hyperdex::FUNC_MAP_ADD:
+            case hyperdex::FUNC_MAP_REMOVE:
+            case hyperdex::FUNC_DOC_RENAME:
+            case hyperdex::FUNC_DOC_UNSET:
+            default:
+                return false;
+        }
+    }
+
+    return !kc.funcs.empty();
+}
+
+} // namespace
+
 void
-key_state :: drain_changes(replication_manager*,
+key_state :: drain_changes(replication_manager* rm,
                            const virtual_server_id&,
                            const schema& sc)
 {
@@ -1200,6 +1520,14 @@ key_state :: drain_changes(replication_manager*,
     m_changes.pop_front();
     key_change* kc = dkc->kc.get();
 
+    // readers already treat an expired object as absent, so writes start
+    // over from nothing; only a delete still sees it, which is how the
+    // point leader's sweep reclaims it
+    if (has_old_value && !kc->erase && is_expired(sc, *old_value, expiry_now()))
+    {
+        has_old_value = false;
+    }
+
     if (!auth_verify_write(sc, has_old_value, old_value, *kc))
     {
         add_response(client_response(old_version, dkc->from, dkc->nonce, NET_UNAUTHORIZED));
@@ -1210,7 +1538,8 @@ key_state :: drain_changes(replication_manager*,
 
     if (nrc != NET_SUCCESS)
     {
-        add_response(client_response(old_version, dkc->from, dkc->nonce, nrc));
+        uint64_t after = respond_after_failure(rm, sc, *kc, old_version, nrc);
+        add_response(client_response(after, dkc->from, dkc->nonce, nrc));
         return;
     }
 
@@ -1221,6 +1550,13 @@ key_state :: drain_changes(replication_manager*,
                                false, std::vector<e::slice>(sc.attrs_sz - 1),
                                std::auto_ptr<e::arena>());
         op->set_continuous();
+
+        if (dkc->received)
+        {
+            op->time_from(dkc->received, po6::monotonic_time());
+            op->set_trace_id(rm->trace_id(m_ri, dkc->version));
+        }
+
         add_response(client_response(dkc->version, dkc->from, dkc->nonce, NET_SUCCESS));
         m_deferred.push_back(op);
         return;
@@ -1240,18 +1576,123 @@ key_state :: drain_changes(replication_manager*,
 
     if (funcs_passed < kc->funcs.size())
     {
-        add_response(client_response(old_version, dkc->from, dkc->nonce, NET_CMPFAIL));
+        uint64_t after = respond_after_failure(rm, sc, *kc, old_version, NET_CMPFAIL);
+        add_response(client_response(after, dkc->from, dkc->nonce, NET_CMPFAIL));
         return;
     }
 
+    // Fold the commutative changes queued behind this one into the same chain
+    // op, so a hot counter takes one version step per batch instead of one
+    // per client.  Each is applied to the value so far exactly as it would be
+    // alone; the first that cannot be is left for its own pass.
+    std::vector<e::intrusive_ptr<deferred_key_change> > merged;
+    std::vector<e::slice> next_value(sc.attrs_sz - 1);
+    uint64_t version = dkc->version;
+
+    while (!m_changes.empty() && merged.size() < MAX_MERGED_CHANGES)
+    {
+        e::intrusive_ptr<deferred_key_change> next = m_changes.front();
+        key_change* nkc = next->kc.get();
+
+        if (!is_commutative(*nkc) ||
+            !auth_verify_write(sc, true, &new_value, *nkc) ||
+            nkc->check(sc, true, &new_value) != NET_SUCCESS ||
+            apply_funcs(sc, nkc->funcs, m_key, new_value, memory.get(), &next_value) < nkc->funcs.size())
+        {
+            break;
+        }
+
+        new_value.swap(next_value);
+        assert(version < next->version);
+        version = next->version;
+        merged.push_back(next);
+        m_changes.pop_front();
+    }
+
     e::intrusive_ptr<key_operation> op;
-    op = new key_operation(old_version, dkc->version, !has_old_value,
+    op = new key_operation(old_version, version, !has_old_value,
                            true, new_value, memory);
     op->set_continuous();
-    add_response(client_response(dkc->version, dkc->from, dkc->nonce, NET_SUCCESS));
+
+    // merged changes arrived after the first, so its time stands for all
+    if (dkc->received)
+    {
+        op->time_from(dkc->received, po6::monotonic_time());
+        op->set_trace_id(rm->trace_id(m_ri, version));
+    }
+
+    if (rm->m_chain_deltas)
+    {
+        std::vector<const std::vector<funcall>*> changes;
+        changes.push_back(&kc->funcs);
+
+        for (size_t i = 0; i < merged.size(); ++i)
+        {
+            changes.push_back(&merged[i]->kc->funcs);
+        }
+
+        op->set_delta(pack_delta(changes));
+    }
+
+    add_response(client_response(version, dkc->from, dkc->nonce, NET_SUCCESS));
+
+    for (size_t i = 0; i < merged.size(); ++i)
+    {
+        add_response(client_response(version, merged[i]->from, merged[i]->nonce, NET_SUCCESS));
+    }
+
     m_deferred.push_back(op);
 }
 
+uint64_t
+key_state :: respond_after_failure(replication_manager* rm,
+                                   const schema& sc,
+                                   const key_change& kc,
+                                   uint64_t latest_version,
+                                   network_returncode nrc)
+{
+    if (latest_version <= m_old_version)
+    {
+        return latest_version;
+    }
+
+    // every pending write is yet to be answered, so the change may take its
+    // place before all of them if it fails there too
+    bool has_old_value = m_has_old_value;
+
+    if (has_old_value && !kc.erase && is_expired(sc, m_old_value, expiry_now()))
+    {
+        has_old_value = false;
+    }
+
+    if (!auth_verify_write(sc, has_old_value, &m_old_value, kc))
+    {
+        return latest_version;
+    }
+
+    network_returncode committed = kc.check(sc, has_old_value, &m_old_value);
+
+    if (committed == NET_SUCCESS && !kc.erase)
+    {
+        e::arena memory;
+        std::vector<e::slice> new_value(sc.attrs_sz - 1);
+        const std::vector<e::slice>& old_value(has_old_value ? m_old_value : new_value);
+
+        if (apply_funcs(sc, kc.funcs, m_key, old_value, &memory, &new_value) < kc.funcs.size())
+        {
+            committed = NET_CMPFAIL;
+        }
+    }
+
+    if (committed != nrc)
+    {
+        return latest_version;
+    }
+
+    rm->m_early_rejects.tap();
+    return m_old_version;
+}
+
 bool
 key_state :: compare_key_op_ptrs(const e::intrusive_ptr<key_operation>& lhs,
                                  const e::intrusive_ptr<key_operation>& rhs)
@@ -1291,9 +1732,27 @@ key_state :: drain_deferred(replication_manager* rm,
         return;
     }
 
+    // a delta applies to the value of the version it follows, which we now
+    // have; a fresh op makes its value from nothing, just as the point leader
+    // did
+    if (op->needs_value())
+    {
+        std::vector<e::slice> empty(sc.attrs_sz - 1);
+
+        if (!op->apply_delta(sc, m_key, has_old_value && !op->is_fresh() ? *old_value : empty))
+        {
+            LOG(ERROR) << "dropping deferred CHAIN_OP whose delta does not apply: "
+                       << "we're using key " << e::slice(state_key().key).hex() << " in region "
+                       << state_key().region
+                       << ".  The CHAIN_OP is for version " << op->this_version();
+            m_deferred.pop_front();
+            return;
+        }
+    }
+
     if (op->is_continuous())
     {
-        hash_objects(&rm->m_daemon->m_config, m_ri, sc,
+        hash_objects(&rm->m_daemon->config(), m_ri, sc,
                      op->has_value(), op->value(),
                      has_old_value, old_value ? *old_value : op->value(), op);
     }
@@ -1313,8 +1772,8 @@ key_state :: drain_deferred(replication_manager* rm,
     // check that the sender was the correct sender
     if (op->is_continuous() &&
         op->recv_from() != virtual_server_id() &&
-        rm->m_daemon->m_config.next_in_region(op->recv_from()) != us &&
-        !rm->m_daemon->m_config.subspace_adjacent(op->recv_from(), us))
+        rm->m_daemon->config().next_in_region(op->recv_from()) != us &&
+        !rm->m_daemon->config().subspace_adjacent(op->recv_from(), us))
     {
         LOG(WARNING) << "dropping deferred CHAIN_OP which didn't come from the right host: "
                      << "we're using key " << e::slice(state_key().key).hex() << " in region "
@@ -1326,8 +1785,8 @@ key_state :: drain_deferred(replication_manager* rm,
 
     if (op->is_discontinuous() &&
         op->recv_from() != virtual_server_id() &&
-        rm->m_daemon->m_config.next_in_region(op->recv_from()) != us &&
-        rm->m_daemon->m_config.tail_of_region(op->this_old_region()) != op->recv_from())
+        rm->m_daemon->config().next_in_region(op->recv_from()) != us &&
+        rm->m_daemon->config().tail_of_region(op->this_old_region()) != op->recv_from())
     {
         LOG(WARNING) << "dropping deferred CHAIN_SUBSPACE which didn't come from the right host: "
                      << "we're using key " << e::slice(state_key().key).hex() << " in region "
@@ -1372,8 +1831,8 @@ key_state :: drain_blocked(replication_manager* rm,
 
 void
 key_state :: drain_committable(replication_manager* rm,
-                               const virtual_server_id&,
-                               const schema&)
+                               const virtual_server_id& us,
+                               const schema& sc)
 {
     assert(!m_committable.empty());
     bool found = false;
@@ -1392,64 +1851,187 @@ key_state :: drain_committable(replication_manager* rm,
         }
     }
 
-    if (found && m_old_version < version)
+    // only one write is out at a time; the ops committed meanwhile go to
+    // disk together in the one that follows it
+    if (found && m_old_version < version && !m_committing && !m_commit_failed)
     {
         CHECK_INVARIANTS();
         e::intrusive_ptr<key_operation> op = get(version);
         assert(op);
         assert(op->this_version() == version);
-        datalayer::returncode rc = datalayer::SUCCESS;
 
-        // if this is a case where we are to remove the object from disk
-        // because of a delete or the first half of a subspace transfer
-        if (!op->has_value() ||
-            (op->this_old_region() != op->this_new_region() && m_ri == op->this_old_region()))
+        if (rm->m_committer->enabled())
         {
-            if (m_has_old_value)
-            {
-                rc = rm->m_daemon->m_data.del(m_ri, m_key, m_old_value);
-            }
+            m_commit_op = op;
+            m_commit_us = us;
+            m_lock.lock();
+            m_committing = true;
+            m_lock.unlock();
+            rm->m_committer->enqueue(state_key());
+            return;
         }
-        // otherwise it is a case where we are to place this object on disk
-        else
+
+        record_committed(rm, op.get(), write_committed(rm, op.get()));
+        CHECK_INVARIANTS();
+    }
+
+    while (!m_committable.empty() && m_committable.front()->ackable())
+    {
+        assert(m_committable.front()->this_version() <= m_old_version);
+
+        // the acks held back until the write reached the disk
+        if (sc.durability == DURABILITY_SYNC || sc.durability == DURABILITY_GROUP)
         {
-            if (m_has_old_value)
-            {
-                rc = rm->m_daemon->m_data.overput(m_ri, m_key, m_old_value, op->value(), version);
-            }
-            else
-            {
-                rc = rm->m_daemon->m_data.put(m_ri, m_key, op->value(), version);
-            }
+            rm->send_ack(us, m_key, m_committable.front());
         }
 
-        switch (rc)
+        if (m_committable.front()->timed())
         {
-            case datalayer::SUCCESS:
-                break;
-            case datalayer::NOT_FOUND:
-            case datalayer::BAD_ENCODING:
-            case datalayer::CORRUPTION:
-            case datalayer::IO_ERROR:
-            case datalayer::LEVELDB_ERROR:
-                return; // XXX
-            default:
-                return; // XXX
+            finish_timing(rm, us, sc, m_committable.front().get());
         }
 
-        m_has_old_value = op->has_value();
-        m_old_version = version;
-        m_old_value = op->value();
-        m_old_op = op;
+        m_committable.pop_front();
         CHECK_INVARIANTS();
     }
+}
 
-    while (!m_committable.empty() && m_committable.front()->ackable())
+hyperdex::datalayer::returncode
+key_state :: write_committed(replication_manager* rm, key_operation* op)
+{
+    // if this is a case where we are to remove the object from disk
+    // because of a delete or the first half of a subspace transfer
+    if (!op->has_value() ||
+        (op->this_old_region() != op->this_new_region() && m_ri == op->this_old_region()))
     {
-        assert(m_committable.front()->this_version() <= m_old_version);
-        m_committable.pop_front();
-        CHECK_INVARIANTS();
+        if (m_has_old_value)
+        {
+            return rm->m_daemon->m_data.del(m_ri, m_key, m_old_value);
+        }
+
+        return datalayer::SUCCESS;
+    }
+    // otherwise it is a case where we are to place this object on disk
+    else if (m_has_old_value)
+    {
+        return rm->m_daemon->m_data.overput(m_ri, m_key, m_old_value, op->value(), op->this_version());
+    }
+    else
+    {
+        return rm->m_daemon->m_data.put(m_ri, m_key, op->value(), op->this_version());
+    }
+}
+
+void
+key_state :: record_committed(replication_manager* rm,
+                              key_operation* op,
+                              datalayer::returncode rc)
+{
+    switch (rc)
+    {
+        case datalayer::SUCCESS:
+            break;
+        case datalayer::NOT_FOUND:
+        case datalayer::BAD_ENCODING:
+        case datalayer::CORRUPTION:
+        case datalayer::IO_ERROR:
+        case datalayer::LEVELDB_ERROR:
+            m_commit_failed = true;
+            return; // XXX
+        default:
+            m_commit_failed = true;
+            return; // XXX
     }
+
+    const bool on_disk = op->has_value() &&
+                         !(op->this_old_region() != op->this_new_region() && m_ri == op->this_old_region());
+    region_op_counter::counter_t counted = region_op_counter::NUM_COUNTERS;
+    uint64_t written = m_key.size();
+
+    if (!on_disk)
+    {
+        if (m_has_old_value)
+        {
+            counted = region_op_counter::KEYS_DELETED;
+        }
+    }
+    else
+    {
+        if (!m_has_old_value)
+        {
+            counted = region_op_counter::KEYS_CREATED;
+        }
+
+        for (size_t i = 0; i < op->value().size(); ++i)
+        {
+            written += op->value()[i].size();
+        }
+    }
+
+    if (counted != region_op_counter::NUM_COUNTERS)
+    {
+        rm->m_daemon->m_region_ops.add(m_ri, counted, 1);
+    }
+
+    rm->m_daemon->m_region_ops.add(m_ri, region_op_counter::BYTES_WRITTEN, written);
+    m_has_old_value = op->has_value();
+    m_old_version = op->this_version();
+    m_old_value = op->value();
+    m_old_op = op;
+    m_warm_pending = true;
+    m_warm_on_disk = on_disk;
+}
+
+void
+key_state :: finish_timing(replication_manager* rm,
+                           const virtual_server_id& us,
+                           const schema& sc,
+                           key_operation* op)
+{
+    const uint64_t now = po6::monotonic_time();
+    op->stamp(key_operation::COMMITTED, now);
+    const uint64_t received = op->stamped(key_operation::RECEIVED);
+
+    if (op->trace_id())
+    {
+        rm->m_traces.record(rm->m_daemon->config().get_server_id(us), m_ri, *op);
+    }
+
+    // only the point leader saw the op come from a client
+    if (rm->m_slow_op_threshold == 0 ||
+        op->recv_from() != virtual_server_id() ||
+        now - received < rm->m_slow_op_threshold)
+    {
+        return;
+    }
+
+    // one line of key=value pairs per op, in microseconds; each stage is
+    // timed from the stage before it that the op went through, and stages it
+    // skipped, like the send at the tail of a chain, show as "-"
+    std::ostringstream ostr;
+    ostr << "slow op: region=" << m_ri.get()
+         << " key_hash=" << std::hex << hash_key(sc, m_key) << std::dec
+         << " version=" << op->this_version()
+         << " total_us=" << (now - received) / 1000;
+    uint64_t prev = received;
+
+    for (int s = key_operation::STARTED; s < key_operation::NUM_STAGES; ++s)
+    {
+        key_operation::stage_t stage = static_cast<key_operation::stage_t>(s);
+        uint64_t when = op->stamped(stage);
+        ostr << " " << key_operation::stage_name(stage) << "_us=";
+
+        if (when == 0)
+        {
+            ostr << "-";
+            continue;
+        }
+
+        ostr << (when - prev) / 1000;
+        prev = when;
+    }
+
+    ostr << " retransmits=" << op->retransmits();
+    LOG(WARNING) << ostr.str();
 }
 
 void
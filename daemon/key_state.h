@@ -28,6 +28,10 @@
 #ifndef hyperdex_daemon_key_state_h_
 #define hyperdex_daemon_key_state_h_
 
+// STL
+#include <memory>
+#include <vector>
+
 // e
 #include <e/lockfree_mpsc_fifo.h>
 
@@ -35,6 +39,9 @@
 #include "namespace.h"
 #include "daemon/datalayer.h"
 #include "daemon/key_operation.h"
+#include "daemon/lock_profile.h"
+#include "daemon/memory_accounting.h"
+#include "daemon/object_pool.h"
 
 BEGIN_HYPERDEX_NAMESPACE
 class replication_manager;
@@ -44,6 +51,9 @@ class replication_manager;
 
 class key_state
 {
+    public:
+        class waiter;
+
     public:
         key_state(const key_region& kr);
         ~key_state() throw ();
@@ -74,7 +84,9 @@ class key_state
                               bool fresh,
                               bool has_value,
                               const std::vector<e::slice>& value,
-                              std::auto_ptr<e::buffer> backing);
+                              const e::slice& delta,
+                              std::auto_ptr<e::buffer> backing,
+                              uint64_t trace_id);
         void enqueue_chain_subspace(replication_manager* rm,
                                     const virtual_server_id& us,
                                     const schema& sc,
@@ -86,7 +98,8 @@ class key_state
                                     const region_id& prev_region,
                                     const region_id& this_old_region,
                                     const region_id& this_new_region,
-                                    const region_id& next_region);
+                                    const region_id& next_region,
+                                    uint64_t trace_id);
         void enqueue_chain_ack(replication_manager* rm,
                                 const virtual_server_id& us,
                                 const schema& sc,
@@ -95,17 +108,30 @@ class key_state
         void work_state_machine(replication_manager* rm,
                                 const virtual_server_id& us,
                                 const schema& sc);
+        // the commit threads call this to write the op drain_committable
+        // handed them, and then work the state machine
+        void commit(replication_manager* rm);
 
         uint64_t max_version();
+        // writes this state knows of that have yet to reach the disk; false
+        // if the state machine is running, in which case the count must wait
+        // for it to stop: if "w" holds a waiter, the state takes it and
+        // resumes it with the count then
+        bool pending_writes(uint64_t* pending, std::auto_ptr<waiter>* w);
         void reconfigure(e::garbage_collector* gc);
         void reset(e::garbage_collector* gc);
 
-        void resend_committable(replication_manager* rm,
+        // resend ops not yet sent in this configuration, and those sent that
+        // have gone unacknowledged too long; returns true when some op should
+        // be looked at again by a later pass
+        bool resend_committable(replication_manager* rm,
                                 const virtual_server_id& us);
 
         void append_all_versions(std::vector<std::pair<region_id, uint64_t> >* versions);
 
         void debug_dump();
+        // log how many pooled write-path objects are live and cached
+        static void debug_dump_pools();
 
     private:
         struct deferred_key_change;
@@ -114,12 +140,22 @@ class key_state
         struct stub_chain_subspace;
         struct stub_chain_ack;
         struct client_response;
-        typedef std::list<e::intrusive_ptr<key_operation> > key_operation_list_t;
-        typedef std::list<e::intrusive_ptr<deferred_key_change> > key_change_list_t;
+        typedef std::list<e::intrusive_ptr<key_operation>,
+                          pool_allocator<e::intrusive_ptr<key_operation> > > key_operation_list_t;
+        typedef std::list<e::intrusive_ptr<deferred_key_change>,
+                          pool_allocator<e::intrusive_ptr<deferred_key_change> > > key_change_list_t;
 
     private:
         void check_invariants() const;
+        // call with m_lock held and the state machine stopped
+        uint64_t queued_writes() const;
+        // the greatest version this state holds or has queued; call while
+        // working the state machine
+        uint64_t latest_version() const;
         void someone_needs_to_work_the_state_machine();
+        // returns with m_lock held once no one is working the state machine;
+        // call with m_lock held
+        void wait_for_state_machine();
         void work_state_machine_or_pass_the_buck(replication_manager* rm,
                                                  const virtual_server_id& us,
                                                  const schema& sc);
@@ -148,7 +184,9 @@ class key_state
                          bool fresh,
                          bool has_value,
                          const std::vector<e::slice>& value,
-                         std::auto_ptr<e::buffer> backing);
+                         const e::slice& delta,
+                         std::auto_ptr<e::buffer> backing,
+                         uint64_t trace_id);
         void do_chain_subspace(replication_manager* rm,
                                const virtual_server_id& us,
                                const schema& sc,
@@ -160,7 +198,8 @@ class key_state
                                const region_id& prev_region,
                                const region_id& this_old_region,
                                const region_id& this_new_region,
-                               const region_id& next_region);
+                               const region_id& next_region,
+                               uint64_t trace_id);
         void do_chain_ack(replication_manager* rm,
                           const virtual_server_id& us,
                           const schema& sc,
@@ -206,6 +245,15 @@ class key_state
         void drain_changes(replication_manager* rm,
                            const virtual_server_id& us,
                            const schema& sc);
+        // the version to hold the response to a change that failed with "nrc"
+        // against the latest value, of "latest_version", until; a change that
+        // fails the same way against the committed value can be ordered ahead
+        // of the writes still pending, and so is answered without them
+        uint64_t respond_after_failure(replication_manager* rm,
+                                       const schema& sc,
+                                       const key_change& kc,
+                                       uint64_t latest_version,
+                                       network_returncode nrc);
         static bool compare_key_op_ptrs(const e::intrusive_ptr<key_operation>& lhs,
                                         const e::intrusive_ptr<key_operation>& rhs);
         void drain_deferred(replication_manager* rm,
@@ -217,6 +265,19 @@ class key_state
         void drain_committable(replication_manager* rm,
                                const virtual_server_id& us,
                                const schema& sc);
+        // put "op" on disk over the old value, leaving this state untouched
+        datalayer::returncode write_committed(replication_manager* rm,
+                                              key_operation* op);
+        // make "op" the old value if write_committed returned SUCCESS
+        void record_committed(replication_manager* rm,
+                              key_operation* op,
+                              datalayer::returncode rc);
+        // stamp when "op" committed, record its span if it is traced, and
+        // log it if it is a client's op that came in long enough ago
+        void finish_timing(replication_manager* rm,
+                           const virtual_server_id& us,
+                           const schema& sc,
+                           key_operation* op);
         void hash_objects(const configuration* config,
                           const region_id& reg,
                           const schema& sc,
@@ -232,6 +293,7 @@ class key_state
         const region_id m_ri;
         const std::string m_key_backing;
         const e::slice m_key;
+        memory_charge m_charge;
 
         e::lockfree_mpsc_fifo<stub_client_atomic> m_client_atomics;
         e::lockfree_mpsc_fifo<stub_chain_op> m_chain_ops;
@@ -240,10 +302,12 @@ class key_state
 
     // protected state, synchronized by m_lock;
     private:
-        po6::threads::mutex m_lock;
+        profiled_mutex m_lock;
         po6::threads::cond m_avail;
         bool m_someone_is_working_the_state_machine;
         bool m_someone_needs_to_work_the_state_machine;
+        // pending_writes callers that found the state machine running
+        std::vector<waiter*> m_parked;
 
         bool m_initialized;
 
@@ -255,6 +319,20 @@ class key_state
         datalayer::reference m_old_disk_ref;
         e::intrusive_ptr<key_operation> m_old_op;
 
+        // Token from "initialize" to hand the datalayer when remembering
+        // the committed value, and whether a commit since then needs it
+        bool m_warm_pending;
+        bool m_warm_on_disk;
+        uint64_t m_warm_generation;
+
+        // The write handed to the commit threads, if any.  The old value above
+        // and the queues' ops hold still until it completes; a write that
+        // fails waits for the next run of the state machine to try again.
+        bool m_committing;
+        bool m_commit_failed;
+        e::intrusive_ptr<key_operation> m_commit_op;
+        virtual_server_id m_commit_us;
+
         std::vector<client_response> m_client_responses_heap;
 
         // These operations are being actively replicated by HyperDex
@@ -281,6 +359,21 @@ class key_state
         bool m_changes_empty;
 };
 
+class key_state::waiter
+{
+    public:
+        waiter() {}
+        virtual ~waiter() throw () {}
+
+    public:
+        // called once, on whichever thread stopped the state machine
+        virtual void resume(uint64_t pending) = 0;
+
+    private:
+        waiter(const waiter&);
+        waiter& operator = (const waiter&);
+};
+
 END_HYPERDEX_NAMESPACE
 
 #endif // hyperdex_daemon_key_state_h_
@@ -0,0 +1,138 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <string.h>
+
+// e
+#include <e/atomic.h>
+
+// HyperDex
+#include "daemon/latency_histogram.h"
+
+using hyperdex::latency_histogram;
+
+latency_histogram :: latency_histogram()
+    : m_last(BUCKETS, 0)
+{
+    memset(m_stripes, 0, sizeof(m_stripes));
+}
+
+latency_histogram :: ~latency_histogram() throw ()
+{
+}
+
+void
+latency_histogram :: snapshot(std::vector<uint64_t>* counts) const
+{
+    counts->assign(BUCKETS, 0);
+
+    for (size_t s = 0; s < STRIPES; ++s)
+    {
+        for (size_t b = 0; b < BUCKETS; ++b)
+        {
+            (*counts)[b] += e::atomic::load_64_nobarrier(&m_stripes[s].counts[b]);
+        }
+    }
+}
+
+void
+latency_histogram :: interval(std::vector<uint64_t>* counts)
+{
+    std::vector<uint64_t> now;
+    snapshot(&now);
+    counts->resize(BUCKETS);
+
+    for (size_t b = 0; b < BUCKETS; ++b)
+    {
+        (*counts)[b] = now[b] - m_last[b];
+    }
+
+    m_last.swap(now);
+}
+
+size_t
+latency_histogram :: bucket(uint64_t value)
+{
+    if (value < (1ULL << SUB_BITS))
+    {
+        return value;
+    }
+
+    unsigned msb = 63 - __builtin_clzll(value);
+    unsigned shift = msb - SUB_BITS;
+    size_t sub = (value >> shift) & ((1ULL << SUB_BITS) - 1);
+    return ((shift + 1) << SUB_BITS) + sub;
+}
+
+uint64_t
+latency_histogram :: bucket_upper_bound(size_t idx)
+{
+    if (idx < (1ULL << SUB_BITS))
+    {
+        return idx;
+    }
+
+    unsigned shift = (idx >> SUB_BITS) - 1;
+    uint64_t sub = idx & ((1ULL << SUB_BITS) - 1);
+    uint64_t lower = ((1ULL << SUB_BITS) + sub) << shift;
+    return lower + ((1ULL << shift) - 1);
+}
+
+uint64_t
+latency_histogram :: percentile(const std::vector<uint64_t>& counts,
+                                uint64_t part, uint64_t whole)
+{
+    uint64_t total = 0;
+
+    for (size_t b = 0; b < counts.size(); ++b)
+    {
+        total += counts[b];
+    }
+
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    // rank of the sample we want, rounded up and 1-indexed
+    uint64_t rank = (total * part + whole - 1) / whole;
+    rank = rank > 0 ? rank : 1;
+    uint64_t seen = 0;
+
+    for (size_t b = 0; b < counts.size(); ++b)
+    {
+        seen += counts[b];
+
+        if (seen >= rank)
+        {
+            return bucket_upper_bound(b);
+        }
+    }
+
+    return bucket_upper_bound(counts.size() - 1);
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_latency_histogram_h_
+#define hyperdex_daemon_latency_histogram_h_
+
+// C
+#include <stdint.h>
+
+// STL
+#include <vector>
+
+// e
+#include <e/atomic.h>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// A threadsafe histogram of latencies with logarithmic buckets.  Each power of
+// two is split into 2^SUB_BITS linear sub-buckets, so every recorded value is
+// reported to within 25% of its true value.  Writers are striped by thread so
+// that concurrent records rarely touch the same cache line.
+class latency_histogram
+{
+    public:
+        const static unsigned SUB_BITS = 2;
+        const static size_t BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS;
+        const static size_t STRIPES = 16;
+
+    public:
+        latency_histogram();
+        ~latency_histogram() throw ();
+
+    public:
+        // any number of threads can record simultaneously
+        void record(size_t thread, uint64_t value)
+        { e::atomic::increment_64_nobarrier(&m_stripes[thread % STRIPES].counts[bucket(value)], 1); }
+        // any number of threads can call "snapshot" simultaneously
+        void snapshot(std::vector<uint64_t>* counts) const;
+        // the counts recorded since the previous call to "interval"; only one
+        // thread may call "interval"
+        void interval(std::vector<uint64_t>* counts);
+
+    public:
+        static size_t bucket(uint64_t value);
+        static uint64_t bucket_upper_bound(size_t idx);
+        // the upper bound of the bucket holding the "part"/"whole" percentile
+        static uint64_t percentile(const std::vector<uint64_t>& counts,
+                                   uint64_t part, uint64_t whole);
+
+    private:
+        struct stripe
+        {
+            uint64_t counts[BUCKETS];
+            char pad[64];
+        };
+
+    private:
+        latency_histogram(const latency_histogram&);
+        latency_histogram& operator = (const latency_histogram&);
+
+    private:
+        stripe m_stripes[STRIPES];
+        std::vector<uint64_t> m_last;
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_latency_histogram_h_
@@ -0,0 +1,131 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// HyperDex
+#include "daemon/leveldb_counters.h"
+
+using hyperdex::counting_cache;
+using hyperdex::counting_filter_policy;
+
+counting_cache :: counting_cache(leveldb::Cache* cache, uint64_t _capacity)
+    : m_cache(cache)
+    , m_capacity(_capacity)
+    , m_hits()
+    , m_misses()
+{
+}
+
+counting_cache :: ~counting_cache() throw ()
+{
+}
+
+leveldb::Cache::Handle*
+counting_cache :: Insert(const leveldb::Slice& key, void* value, size_t charge,
+                         void (*deleter)(const leveldb::Slice& key, void* value))
+{
+    return m_cache->Insert(key, value, charge, deleter);
+}
+
+leveldb::Cache::Handle*
+counting_cache :: Lookup(const leveldb::Slice& key)
+{
+    Handle* h = m_cache->Lookup(key);
+
+    if (h)
+    {
+        m_hits.tap();
+    }
+    else
+    {
+        m_misses.tap();
+    }
+
+    return h;
+}
+
+void
+counting_cache :: Release(Handle* handle)
+{
+    m_cache->Release(handle);
+}
+
+void*
+counting_cache :: Value(Handle* handle)
+{
+    return m_cache->Value(handle);
+}
+
+void
+counting_cache :: Erase(const leveldb::Slice& key)
+{
+    m_cache->Erase(key);
+}
+
+uint64_t
+counting_cache :: NewId()
+{
+    return m_cache->NewId();
+}
+
+counting_filter_policy :: counting_filter_policy(const leveldb::FilterPolicy* policy)
+    : m_policy(policy)
+    , m_checks()
+    , m_negatives()
+{
+}
+
+counting_filter_policy :: ~counting_filter_policy() throw ()
+{
+}
+
+const char*
+counting_filter_policy :: Name() const
+{
+    return m_policy->Name();
+}
+
+void
+counting_filter_policy :: CreateFilter(const leveldb::Slice* keys, int n,
+                                       std::string* dst) const
+{
+    m_policy->CreateFilter(keys, n, dst);
+}
+
+bool
+counting_filter_policy :: KeyMayMatch(const leveldb::Slice& key,
+                                      const leveldb::Slice& filter) const
+{
+    bool may_match = m_policy->KeyMayMatch(key, filter);
+    m_checks.tap();
+
+    if (!may_match)
+    {
+        m_negatives.tap();
+    }
+
+    return may_match;
+}
@@ -0,0 +1,114 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_leveldb_counters_h_
+#define hyperdex_daemon_leveldb_counters_h_
+
+// STL
+#include <memory>
+#include <string>
+
+// LevelDB
+#include <hyperleveldb/cache.h>
+#include <hyperleveldb/filter_policy.h>
+
+// HyperDex
+#include "namespace.h"
+#include "daemon/performance_counter.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// LevelDB keeps no statistics on its block cache or its filters, so hand it
+// these in place of its own.  Each passes every call through to the object it
+// wraps, counting as it goes.
+
+// counts lookups that found their block, and those that did not
+class counting_cache : public leveldb::Cache
+{
+    public:
+        counting_cache(leveldb::Cache* cache, uint64_t capacity);
+        virtual ~counting_cache() throw ();
+
+    public:
+        uint64_t capacity() const { return m_capacity; }
+        uint64_t hits() const { return m_hits.read(); }
+        uint64_t misses() const { return m_misses.read(); }
+
+    public:
+        virtual Handle* Insert(const leveldb::Slice& key, void* value, size_t charge,
+                               void (*deleter)(const leveldb::Slice& key, void* value));
+        virtual Handle* Lookup(const leveldb::Slice& key);
+        virtual void Release(Handle* handle);
+        virtual void* Value(Handle* handle);
+        virtual void Erase(const leveldb::Slice& key);
+        virtual uint64_t NewId();
+
+    private:
+        const std::auto_ptr<leveldb::Cache> m_cache;
+        const uint64_t m_capacity;
+        performance_counter m_hits;
+        performance_counter m_misses;
+
+    private:
+        counting_cache(const counting_cache&);
+        counting_cache& operator = (const counting_cache&);
+};
+
+// counts the keys checked against a filter, and those the filter ruled out
+// and so spared a read of their block
+class counting_filter_policy : public leveldb::FilterPolicy
+{
+    public:
+        counting_filter_policy(const leveldb::FilterPolicy* policy);
+        virtual ~counting_filter_policy() throw ();
+
+    public:
+        uint64_t checks() const { return m_checks.read(); }
+        uint64_t negatives() const { return m_negatives.read(); }
+
+    public:
+        // the name is that of the wrapped policy, as it is kept on disk with
+        // the filters it made
+        virtual const char* Name() const;
+        virtual void CreateFilter(const leveldb::Slice* keys, int n,
+                                  std::string* dst) const;
+        virtual bool KeyMayMatch(const leveldb::Slice& key,
+                                 const leveldb::Slice& filter) const;
+
+    private:
+        const std::auto_ptr<const leveldb::FilterPolicy> m_policy;
+        mutable performance_counter m_checks;
+        mutable performance_counter m_negatives;
+
+    private:
+        counting_filter_policy(const counting_filter_policy&);
+        counting_filter_policy& operator = (const counting_filter_policy&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_leveldb_counters_h_
@@ -0,0 +1,523 @@
+// Copyright (c) 2016, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <assert.h>
+#include <stdarg.h>
+#include <string.h>
+
+// STL
+#include <algorithm>
+
+// HyperDex
+#include "daemon/leveldb_memory.h"
+
+using hyperdex::memory_env;
+
+// The contents of one file, shared by its open handles and every name it is
+// linked under; it goes away with the last of them.
+class memory_env::file
+{
+    public:
+        file();
+        ~file() throw ();
+
+    public:
+        void ref();
+        // returns true when that was the last reference
+        bool unref();
+        uint64_t size();
+        void write_at(uint64_t offset, const leveldb::Slice& data);
+        void append(const leveldb::Slice& data);
+        size_t read(uint64_t offset, size_t n, char* scratch);
+
+    private:
+        po6::threads::mutex m_mtx;
+        unsigned m_ref;
+        std::string m_data;
+
+    private:
+        file(const file&);
+        file& operator = (const file&);
+};
+
+memory_env :: file :: file()
+    : m_mtx()
+    , m_ref(1)
+    , m_data()
+{
+}
+
+memory_env :: file :: ~file() throw ()
+{
+}
+
+void
+memory_env :: file :: ref()
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    ++m_ref;
+}
+
+bool
+memory_env :: file :: unref()
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    assert(m_ref > 0);
+    --m_ref;
+    return m_ref == 0;
+}
+
+uint64_t
+memory_env :: file :: size()
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    return m_data.size();
+}
+
+void
+memory_env :: file :: write_at(uint64_t offset, const leveldb::Slice& data)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+
+    if (data.empty())
+    {
+        return;
+    }
+
+    if (m_data.size() < offset + data.size())
+    {
+        m_data.resize(offset + data.size());
+    }
+
+    memmove(&m_data[offset], data.data(), data.size());
+}
+
+void
+memory_env :: file :: append(const leveldb::Slice& data)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    m_data.append(data.data(), data.size());
+}
+
+size_t
+memory_env :: file :: read(uint64_t offset, size_t n, char* scratch)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+
+    if (offset >= m_data.size())
+    {
+        return 0;
+    }
+
+    n = std::min(static_cast<uint64_t>(n), m_data.size() - offset);
+    memmove(scratch, m_data.data() + offset, n);
+    return n;
+}
+
+static void
+release(memory_env::file* f)
+{
+    if (f->unref())
+    {
+        delete f;
+    }
+}
+
+class memory_env::sequential : public leveldb::SequentialFile
+{
+    public:
+        sequential(file* f) : m_file(f), m_offset(0) {}
+        virtual ~sequential() throw () { release(m_file); }
+
+    public:
+        virtual leveldb::Status Read(size_t n, leveldb::Slice* result, char* scratch)
+        {
+            size_t sz = m_file->read(m_offset, n, scratch);
+            *result = leveldb::Slice(scratch, sz);
+            m_offset += sz;
+            return leveldb::Status::OK();
+        }
+        virtual leveldb::Status Skip(uint64_t n)
+        {
+            m_offset = std::min(m_offset + n, m_file->size());
+            return leveldb::Status::OK();
+        }
+
+    private:
+        file* m_file;
+        uint64_t m_offset;
+
+    private:
+        sequential(const sequential&);
+        sequential& operator = (const sequential&);
+};
+
+class memory_env::random_access : public leveldb::RandomAccessFile
+{
+    public:
+        random_access(file* f) : m_file(f) {}
+        virtual ~random_access() throw () { release(m_file); }
+
+    public:
+        virtual leveldb::Status Read(uint64_t offset, size_t n,
+                                     leveldb::Slice* result, char* scratch) const
+        {
+            size_t sz = m_file->read(offset, n, scratch);
+            *result = leveldb::Slice(scratch, sz);
+            return leveldb::Status::OK();
+        }
+
+    private:
+        file* m_file;
+
+    private:
+        random_access(const random_access&);
+        random_access& operator = (const random_access&);
+};
+
+// serves both the tables LevelDB appends to and the log it writes at offsets
+class memory_env::writable : public leveldb::ConcurrentWritableFile
+{
+    public:
+        writable(file* f) : m_file(f) {}
+        virtual ~writable() throw () { release(m_file); }
+
+    public:
+        virtual leveldb::Status WriteAt(uint64_t offset, const leveldb::Slice& data)
+        {
+            m_file->write_at(offset, data);
+            return leveldb::Status::OK();
+        }
+        virtual leveldb::Status Append(const leveldb::Slice& data)
+        {
+            m_file->append(data);
+            return leveldb::Status::OK();
+        }
+        virtual leveldb::Status Close() { return leveldb::Status::OK(); }
+        virtual leveldb::Status Flush() { return leveldb::Status::OK(); }
+        virtual leveldb::Status Sync() { return leveldb::Status::OK(); }
+
+    private:
+        file* m_file;
+
+    private:
+        writable(const writable&);
+        writable& operator = (const writable&);
+};
+
+namespace
+{
+
+// LevelDB's informational log has nowhere to go
+class null_logger : public leveldb::Logger
+{
+    public:
+        null_logger() {}
+        virtual ~null_logger() throw () {}
+
+    public:
+        virtual void Logv(const char*, va_list) {}
+};
+
+} // namespace
+
+memory_env :: memory_env(leveldb::Env* base)
+    : leveldb::EnvWrapper(base)
+    , m_mtx()
+    , m_files()
+{
+}
+
+memory_env :: ~memory_env() throw ()
+{
+    for (file_map_t::iterator it = m_files.begin(); it != m_files.end(); ++it)
+    {
+        release(it->second);
+    }
+}
+
+uint64_t
+memory_env :: bytes()
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    uint64_t sz = 0;
+
+    for (file_map_t::iterator it = m_files.begin(); it != m_files.end(); ++it)
+    {
+        sz += it->second->size();
+    }
+
+    return sz;
+}
+
+leveldb::Status
+memory_env :: NewSequentialFile(const std::string& fname,
+                                leveldb::SequentialFile** result)
+{
+    file* f = open(fname, false);
+
+    if (!f)
+    {
+        *result = NULL;
+        return leveldb::Status::IOError(fname, "file not found");
+    }
+
+    *result = new sequential(f);
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: NewRandomAccessFile(const std::string& fname,
+                                  leveldb::RandomAccessFile** result)
+{
+    file* f = open(fname, false);
+
+    if (!f)
+    {
+        *result = NULL;
+        return leveldb::Status::IOError(fname, "file not found");
+    }
+
+    *result = new random_access(f);
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: NewWritableFile(const std::string& fname,
+                              leveldb::WritableFile** result)
+{
+    *result = new writable(open(fname, true));
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: NewConcurrentWritableFile(const std::string& fname,
+                                        leveldb::ConcurrentWritableFile** result)
+{
+    *result = new writable(open(fname, true));
+    return leveldb::Status::OK();
+}
+
+bool
+memory_env :: FileExists(const std::string& fname)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    return m_files.find(fname) != m_files.end();
+}
+
+leveldb::Status
+memory_env :: GetChildren(const std::string& dir,
+                          std::vector<std::string>* result)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    const std::string prefix(dir + "/");
+    result->clear();
+
+    for (file_map_t::iterator it = m_files.lower_bound(prefix);
+            it != m_files.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+            ++it)
+    {
+        const std::string name(it->first.substr(prefix.size()));
+
+        if (name.find('/') == std::string::npos)
+        {
+            result->push_back(name);
+        }
+    }
+
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: DeleteFile(const std::string& fname)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    file_map_t::iterator it = m_files.find(fname);
+
+    if (it == m_files.end())
+    {
+        return leveldb::Status::IOError(fname, "file not found");
+    }
+
+    release(it->second);
+    m_files.erase(it);
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: CreateDir(const std::string&)
+{
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: DeleteDir(const std::string&)
+{
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: GetFileSize(const std::string& fname, uint64_t* size)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    file_map_t::iterator it = m_files.find(fname);
+
+    if (it == m_files.end())
+    {
+        return leveldb::Status::IOError(fname, "file not found");
+    }
+
+    *size = it->second->size();
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: RenameFile(const std::string& src,
+                         const std::string& target)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    file_map_t::iterator it = m_files.find(src);
+
+    if (it == m_files.end())
+    {
+        return leveldb::Status::IOError(src, "file not found");
+    }
+
+    file* f = it->second;
+    m_files.erase(it);
+    it = m_files.find(target);
+
+    if (it != m_files.end())
+    {
+        release(it->second);
+        it->second = f;
+    }
+    else
+    {
+        m_files.insert(std::make_pair(target, f));
+    }
+
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: CopyFile(const std::string& src,
+                       const std::string& target)
+{
+    file* f = open(src, false);
+
+    if (!f)
+    {
+        return leveldb::Status::IOError(src, "file not found");
+    }
+
+    file* t = open(target, true);
+    std::vector<char> buf(f->size());
+    size_t sz = f->read(0, buf.size(), buf.empty() ? NULL : &buf[0]);
+    t->append(leveldb::Slice(buf.empty() ? NULL : &buf[0], sz));
+    release(t);
+    release(f);
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: LinkFile(const std::string& src,
+                       const std::string& target)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    file_map_t::iterator it = m_files.find(src);
+
+    if (it == m_files.end())
+    {
+        return leveldb::Status::IOError(src, "file not found");
+    }
+
+    if (m_files.find(target) != m_files.end())
+    {
+        return leveldb::Status::IOError(target, "file exists");
+    }
+
+    it->second->ref();
+    m_files.insert(std::make_pair(target, it->second));
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: LockFile(const std::string&, leveldb::FileLock** lock)
+{
+    *lock = new leveldb::FileLock();
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: UnlockFile(leveldb::FileLock* lock)
+{
+    delete lock;
+    return leveldb::Status::OK();
+}
+
+leveldb::Status
+memory_env :: NewLogger(const std::string&, leveldb::Logger** result)
+{
+    *result = new null_logger();
+    return leveldb::Status::OK();
+}
+
+memory_env::file*
+memory_env :: open(const std::string& fname, bool create)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    file_map_t::iterator it = m_files.find(fname);
+
+    if (!create)
+    {
+        if (it == m_files.end())
+        {
+            return NULL;
+        }
+
+        it->second->ref();
+        return it->second;
+    }
+
+    // handles open on the old contents keep them until they are closed
+    file* f = new file();
+
+    if (it != m_files.end())
+    {
+        release(it->second);
+        it->second = f;
+    }
+    else
+    {
+        m_files.insert(std::make_pair(fname, f));
+    }
+
+    f->ref();
+    return f;
+}
@@ -0,0 +1,114 @@
+// Copyright (c) 2016, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_leveldb_memory_h_
+#define hyperdex_daemon_leveldb_memory_h_
+
+// STL
+#include <map>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// LevelDB
+#include <hyperleveldb/env.h>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Keeps every file of a LevelDB instance in memory, for spaces whose objects
+// need not survive a restart.  LevelDB still keeps its log and tables and
+// compacts them, so reads, writes, snapshots and iterators behave exactly as
+// they do on disk, but none of it ever waits for the disk.  Each instance
+// opened through a memory_env starts out empty.  Threads, clocks and logging
+// come from the wrapped Env.
+class memory_env : public leveldb::EnvWrapper
+{
+    public:
+        memory_env(leveldb::Env* base);
+        virtual ~memory_env() throw ();
+
+    public:
+        // bytes held by every file
+        uint64_t bytes();
+
+    public:
+        virtual leveldb::Status NewSequentialFile(const std::string& fname,
+                                                  leveldb::SequentialFile** result);
+        virtual leveldb::Status NewRandomAccessFile(const std::string& fname,
+                                                    leveldb::RandomAccessFile** result);
+        virtual leveldb::Status NewWritableFile(const std::string& fname,
+                                                leveldb::WritableFile** result);
+        virtual leveldb::Status NewConcurrentWritableFile(const std::string& fname,
+                                                          leveldb::ConcurrentWritableFile** result);
+        virtual bool FileExists(const std::string& fname);
+        virtual leveldb::Status GetChildren(const std::string& dir,
+                                            std::vector<std::string>* result);
+        virtual leveldb::Status DeleteFile(const std::string& fname);
+        virtual leveldb::Status CreateDir(const std::string& dirname);
+        virtual leveldb::Status DeleteDir(const std::string& dirname);
+        virtual leveldb::Status GetFileSize(const std::string& fname, uint64_t* size);
+        virtual leveldb::Status RenameFile(const std::string& src,
+                                           const std::string& target);
+        virtual leveldb::Status CopyFile(const std::string& src,
+                                         const std::string& target);
+        virtual leveldb::Status LinkFile(const std::string& src,
+                                         const std::string& target);
+        virtual leveldb::Status LockFile(const std::string& fname,
+                                         leveldb::FileLock** lock);
+        virtual leveldb::Status UnlockFile(leveldb::FileLock* lock);
+        virtual leveldb::Status NewLogger(const std::string& fname,
+                                          leveldb::Logger** result);
+
+    public:
+        class file;
+
+    private:
+        class sequential;
+        class random_access;
+        class writable;
+        typedef std::map<std::string, file*> file_map_t;
+        // take a reference to the file, making it empty if "create"; NULL if
+        // there is no such file
+        file* open(const std::string& fname, bool create);
+
+    private:
+        po6::threads::mutex m_mtx;
+        file_map_t m_files;
+
+    private:
+        memory_env(const memory_env&);
+        memory_env& operator = (const memory_env&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_leveldb_memory_h_
@@ -0,0 +1,392 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// STL
+#include <vector>
+
+// Google Log
+#include <glog/logging.h>
+
+// po6
+#include <po6/io/fd.h>
+
+// HyperDex
+#include "daemon/leveldb_tiering.h"
+
+using hyperdex::tiered_cache;
+using hyperdex::tiered_env;
+
+// copies go through a buffer of this size
+#define COPY_BUFFER_BYTES (1024ULL * 1024ULL)
+
+__thread bool tiered_env::s_opened_cold = false;
+
+static bool
+is_table(const std::string& name)
+{
+    const size_t sz = name.size();
+    return (sz > 4 && name.compare(sz - 4, 4, ".sst") == 0) ||
+           (sz > 4 && name.compare(sz - 4, 4, ".ldb") == 0);
+}
+
+static bool
+sync_dir(const std::string& dir)
+{
+    po6::io::fd fd(open(dir.c_str(), O_RDONLY));
+    return fd.get() >= 0 && fsync(fd.get()) == 0;
+}
+
+tiered_env :: tiered_env(leveldb::Env* base, const std::string& cold_dir)
+    : leveldb::EnvWrapper(base)
+    , m_cold_dir(cold_dir)
+    , m_tables()
+    , m_bytes()
+{
+}
+
+tiered_env :: ~tiered_env() throw ()
+{
+}
+
+bool
+tiered_env :: migrate(const std::string& db_dir, uint64_t min_age, uint64_t max_bytes)
+{
+    struct stat cst;
+
+    if (stat(m_cold_dir.c_str(), &cst) < 0)
+    {
+        LOG(ERROR) << "cold data directory " << m_cold_dir << " is unusable: "
+                   << strerror(errno);
+        return false;
+    }
+
+    if (!S_ISDIR(cst.st_mode))
+    {
+        LOG(ERROR) << "cold data directory " << m_cold_dir << " is not a directory";
+        return false;
+    }
+
+    std::vector<std::string> children;
+    leveldb::Status status = target()->GetChildren(db_dir, &children);
+
+    if (!status.ok())
+    {
+        LOG(ERROR) << "could not list " << db_dir << " to find cold tables: "
+                   << status.ToString();
+        return true;
+    }
+
+    const time_t now = time(NULL);
+    uint64_t moved = 0;
+
+    for (size_t i = 0; i < children.size() && moved < max_bytes; ++i)
+    {
+        if (!is_table(children[i]))
+        {
+            continue;
+        }
+
+        std::string path(db_dir + "/" + children[i]);
+        struct stat st;
+
+        // a symlink is a table that is already cold
+        if (lstat(path.c_str(), &st) < 0 || !S_ISREG(st.st_mode) ||
+            now < st.st_mtime ||
+            static_cast<uint64_t>(now - st.st_mtime) < min_age)
+        {
+            continue;
+        }
+
+        if (migrate_table(db_dir, children[i], st.st_size))
+        {
+            moved += st.st_size;
+            m_tables.tap();
+            m_bytes.add(st.st_size);
+        }
+    }
+
+    if (moved > 0)
+    {
+        LOG(INFO) << "moved " << moved << " bytes of tables to " << m_cold_dir;
+    }
+
+    return true;
+}
+
+leveldb::Status
+tiered_env :: NewRandomAccessFile(const std::string& fname,
+                                  leveldb::RandomAccessFile** result)
+{
+    std::string cold_path;
+    s_opened_cold = is_cold(fname, &cold_path);
+    return target()->NewRandomAccessFile(fname, result);
+}
+
+leveldb::Status
+tiered_env :: DeleteFile(const std::string& fname)
+{
+    std::string cold_path;
+    struct stat st;
+
+    // a hard link to the symlink means a backup still needs the copy
+    if (is_cold(fname, &cold_path) &&
+        lstat(fname.c_str(), &st) == 0 && st.st_nlink == 1 &&
+        unlink(cold_path.c_str()) < 0 && errno != ENOENT)
+    {
+        LOG(WARNING) << "could not remove cold table " << cold_path
+                     << ": " << strerror(errno);
+    }
+
+    return target()->DeleteFile(fname);
+}
+
+leveldb::Status
+tiered_env :: LinkFile(const std::string& src, const std::string& dst)
+{
+    std::string cold_path;
+
+    if (is_cold(src, &cold_path))
+    {
+        return target()->CopyFile(cold_path, dst);
+    }
+
+    return target()->LinkFile(src, dst);
+}
+
+bool
+tiered_env :: is_cold(const std::string& fname, std::string* cold_path)
+{
+    std::vector<char> buf(PATH_MAX + 1);
+    ssize_t sz = readlink(fname.c_str(), &buf[0], PATH_MAX);
+
+    if (sz <= 0)
+    {
+        return false;
+    }
+
+    // only our own links; the data directory itself may be reached by one
+    cold_path->assign(&buf[0], sz);
+    return cold_path->size() > m_cold_dir.size() &&
+           cold_path->compare(0, m_cold_dir.size(), m_cold_dir) == 0 &&
+           (*cold_path)[m_cold_dir.size()] == '/';
+}
+
+bool
+tiered_env :: migrate_table(const std::string& db_dir, const std::string& name,
+                            uint64_t size)
+{
+    const std::string path(db_dir + "/" + name);
+    const std::string cold_path(m_cold_dir + "/" + name);
+    const std::string cold_tmp(cold_path + ".tmp");
+    const std::string link_tmp(path + ".cold");
+
+    if (!copy_to(path, cold_tmp) ||
+        rename(cold_tmp.c_str(), cold_path.c_str()) < 0 ||
+        !sync_dir(m_cold_dir))
+    {
+        LOG(ERROR) << "could not copy table " << path << " to " << cold_path
+                   << ": " << strerror(errno);
+        unlink(cold_tmp.c_str());
+        return false;
+    }
+
+    struct stat st;
+    unlink(link_tmp.c_str());
+
+    // compaction may have retired the table while it was being copied
+    if (lstat(path.c_str(), &st) < 0 ||
+        static_cast<uint64_t>(st.st_size) != size ||
+        symlink(cold_path.c_str(), link_tmp.c_str()) < 0 ||
+        rename(link_tmp.c_str(), path.c_str()) < 0)
+    {
+        unlink(link_tmp.c_str());
+        unlink(cold_path.c_str());
+        return false;
+    }
+
+    if (!sync_dir(db_dir))
+    {
+        LOG(WARNING) << "could not sync " << db_dir << " after moving " << name
+                     << ": " << strerror(errno);
+    }
+
+    return true;
+}
+
+bool
+tiered_env :: copy_to(const std::string& src, const std::string& dst)
+{
+    po6::io::fd in(open(src.c_str(), O_RDONLY));
+    po6::io::fd out(open(dst.c_str(), O_WRONLY|O_CREAT|O_TRUNC, S_IRUSR|S_IWUSR));
+
+    if (in.get() < 0 || out.get() < 0)
+    {
+        return false;
+    }
+
+    std::vector<char> buf(COPY_BUFFER_BYTES);
+
+    while (true)
+    {
+        ssize_t amt = in.xread(&buf[0], buf.size());
+
+        if (amt < 0)
+        {
+            return false;
+        }
+
+        if (amt == 0)
+        {
+            break;
+        }
+
+        if (out.xwrite(&buf[0], amt) != amt)
+        {
+            return false;
+        }
+    }
+
+    return fsync(out.get()) == 0;
+}
+
+tiered_cache :: tiered_cache(counting_cache* hot, counting_cache* cold)
+    : m_hot(hot)
+    , m_cold(cold)
+{
+}
+
+tiered_cache :: ~tiered_cache() throw ()
+{
+}
+
+leveldb::Cache::Handle*
+tiered_cache :: Insert(const leveldb::Slice& key, void* value, size_t charge,
+                       void (*deleter)(const leveldb::Slice& key, void* value))
+{
+    if (is_cold(key))
+    {
+        return tag(m_cold->Insert(key, value, charge, deleter));
+    }
+
+    return m_hot->Insert(key, value, charge, deleter);
+}
+
+leveldb::Cache::Handle*
+tiered_cache :: Lookup(const leveldb::Slice& key)
+{
+    if (is_cold(key))
+    {
+        Handle* h = m_cold->Lookup(key);
+        return h ? tag(h) : NULL;
+    }
+
+    return m_hot->Lookup(key);
+}
+
+void
+tiered_cache :: Release(Handle* handle)
+{
+    if (is_cold(handle))
+    {
+        m_cold->Release(untag(handle));
+    }
+    else
+    {
+        m_hot->Release(handle);
+    }
+}
+
+void*
+tiered_cache :: Value(Handle* handle)
+{
+    if (is_cold(handle))
+    {
+        return m_cold->Value(untag(handle));
+    }
+
+    return m_hot->Value(handle);
+}
+
+void
+tiered_cache :: Erase(const leveldb::Slice& key)
+{
+    if (is_cold(key))
+    {
+        m_cold->Erase(key);
+    }
+    else
+    {
+        m_hot->Erase(key);
+    }
+}
+
+uint64_t
+tiered_cache :: NewId()
+{
+    // LevelDB asks for an id right after opening the table it is for
+    uint64_t id = m_hot->NewId() & ~COLD_ID;
+    return tiered_env::opened_cold() ? id | COLD_ID : id;
+}
+
+bool
+tiered_cache :: is_cold(const leveldb::Slice& key)
+{
+    // block keys start with the table's id as a little-endian fixed64
+    return key.size() >= sizeof(uint64_t) &&
+           (static_cast<uint8_t>(key.data()[sizeof(uint64_t) - 1]) & 0x80);
+}
+
+bool
+tiered_cache :: is_cold(Handle* handle)
+{
+    return reinterpret_cast<uintptr_t>(handle) & 1;
+}
+
+leveldb::Cache::Handle*
+tiered_cache :: tag(Handle* handle)
+{
+    return reinterpret_cast<Handle*>(reinterpret_cast<uintptr_t>(handle) | 1);
+}
+
+leveldb::Cache::Handle*
+tiered_cache :: untag(Handle* handle)
+{
+    return reinterpret_cast<Handle*>(reinterpret_cast<uintptr_t>(handle) & ~uintptr_t(1));
+}
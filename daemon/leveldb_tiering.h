@@ -0,0 +1,131 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_leveldb_tiering_h_
+#define hyperdex_daemon_leveldb_tiering_h_
+
+// STL
+#include <string>
+
+// LevelDB
+#include <hyperleveldb/cache.h>
+#include <hyperleveldb/env.h>
+
+// HyperDex
+#include "namespace.h"
+#include "daemon/leveldb_counters.h"
+#include "daemon/performance_counter.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Keeps LevelDB's old tables on a second, cheaper disk.  LevelDB never
+// changes a table once it is written, and compaction pushes older data into
+// deeper levels, so a table's age is a fair stand-in for its level.
+// "migrate" copies each table that has gone unmodified long enough into the
+// cold directory and puts a symlink in its place, which LevelDB then opens
+// as if it were the table itself.
+class tiered_env : public leveldb::EnvWrapper
+{
+    public:
+        tiered_env(leveldb::Env* base, const std::string& cold_dir);
+        virtual ~tiered_env() throw ();
+
+    public:
+        // move up to "max_bytes" of the tables in "db_dir" that are at least
+        // "min_age" seconds old; returns false only if the cold directory is
+        // unusable
+        bool migrate(const std::string& db_dir, uint64_t min_age, uint64_t max_bytes);
+        uint64_t migrated_tables() const { return m_tables.read(); }
+        uint64_t migrated_bytes() const { return m_bytes.read(); }
+        // was the table most recently opened by this thread a cold one?
+        static bool opened_cold() { return s_opened_cold; }
+
+    public:
+        virtual leveldb::Status NewRandomAccessFile(const std::string& fname,
+                                                    leveldb::RandomAccessFile** result);
+        // removes the cold copy with the symlink, unless a backup links it
+        virtual leveldb::Status DeleteFile(const std::string& fname);
+        // backups get a copy of a cold table, not a link to a symlink
+        virtual leveldb::Status LinkFile(const std::string& src,
+                                         const std::string& target);
+
+    private:
+        bool is_cold(const std::string& fname, std::string* cold_path);
+        bool migrate_table(const std::string& db_dir, const std::string& name,
+                           uint64_t size);
+        bool copy_to(const std::string& src, const std::string& dst);
+
+    private:
+        const std::string m_cold_dir;
+        performance_counter m_tables;
+        performance_counter m_bytes;
+        static __thread bool s_opened_cold;
+
+    private:
+        tiered_env(const tiered_env&);
+        tiered_env& operator = (const tiered_env&);
+};
+
+// Gives the blocks of cold tables a cache of their own, so that a scan over
+// cold data cannot push the hot working set out of the block cache.  A table
+// opened through tiered_env as cold gets a cache id with COLD_ID set, and
+// every block key begins with its table's id; handles from the cold cache
+// are told apart by their low bit, which LevelDB never sets.
+class tiered_cache : public leveldb::Cache
+{
+    public:
+        tiered_cache(counting_cache* hot, counting_cache* cold);
+        virtual ~tiered_cache() throw ();
+
+    public:
+        virtual Handle* Insert(const leveldb::Slice& key, void* value, size_t charge,
+                               void (*deleter)(const leveldb::Slice& key, void* value));
+        virtual Handle* Lookup(const leveldb::Slice& key);
+        virtual void Release(Handle* handle);
+        virtual void* Value(Handle* handle);
+        virtual void Erase(const leveldb::Slice& key);
+        virtual uint64_t NewId();
+
+    private:
+        const static uint64_t COLD_ID = 1ULL << 63;
+        static bool is_cold(const leveldb::Slice& key);
+        static bool is_cold(Handle* handle);
+        static Handle* tag(Handle* handle);
+        static Handle* untag(Handle* handle);
+
+    private:
+        counting_cache* const m_hot;
+        counting_cache* const m_cold;
+
+    private:
+        tiered_cache(const tiered_cache&);
+        tiered_cache& operator = (const tiered_cache&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_leveldb_tiering_h_
@@ -0,0 +1,125 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// po6
+#include <po6/time.h>
+
+// HyperDex
+#include "daemon/lock_profile.h"
+
+using hyperdex::lock_profile;
+using hyperdex::profiled_mutex;
+
+// a sampled acquisition that waits longer than this found the lock held
+#define LOCK_CONTENDED_NANOS 1000ULL
+
+uint64_t lock_profile::s_sample = 0;
+__thread uint64_t lock_profile::s_countdown = 0;
+uint64_t lock_profile::s_acquired[lock_profile::NUM_CLASSES];
+uint64_t lock_profile::s_contended[lock_profile::NUM_CLASSES];
+uint64_t lock_profile::s_wait[lock_profile::NUM_CLASSES];
+uint64_t lock_profile::s_hold[lock_profile::NUM_CLASSES];
+
+const char*
+lock_profile :: name(class_t c)
+{
+    switch (c)
+    {
+        case KEY_STATE:
+            return "key_state";
+        case KEY_STATE_HANDOFF:
+            return "key_state_handoff";
+        case SEARCH_STATE:
+            return "search_state";
+        case NUM_CLASSES:
+        default:
+            return "unknown";
+    }
+}
+
+void
+lock_profile :: record_wait(class_t c, uint64_t nanos)
+{
+    __sync_add_and_fetch(&s_acquired[c], 1);
+    __sync_add_and_fetch(&s_wait[c], nanos);
+
+    if (nanos > LOCK_CONTENDED_NANOS)
+    {
+        __sync_add_and_fetch(&s_contended[c], 1);
+    }
+}
+
+void
+lock_profile :: stats(class_t c, uint64_t* acquired, uint64_t* contended,
+                      uint64_t* wait, uint64_t* hold)
+{
+    *acquired = __sync_add_and_fetch(&s_acquired[c], 0);
+    *contended = __sync_add_and_fetch(&s_contended[c], 0);
+    *wait = __sync_add_and_fetch(&s_wait[c], 0);
+    *hold = __sync_add_and_fetch(&s_hold[c], 0);
+}
+
+profiled_mutex :: profiled_mutex(lock_profile::class_t c)
+    : m_mtx()
+    , m_class(c)
+    , m_acquired(0)
+{
+}
+
+profiled_mutex :: ~profiled_mutex() throw ()
+{
+}
+
+void
+profiled_mutex :: lock()
+{
+    if (!lock_profile::sampled())
+    {
+        m_mtx.lock();
+        m_acquired = 0;
+        return;
+    }
+
+    uint64_t start = po6::monotonic_time();
+    m_mtx.lock();
+    m_acquired = po6::monotonic_time();
+    lock_profile::record_wait(m_class, m_acquired - start);
+}
+
+void
+profiled_mutex :: unlock()
+{
+    uint64_t acquired = m_acquired;
+    m_acquired = 0;
+
+    if (acquired > 0)
+    {
+        lock_profile::record_hold(m_class, po6::monotonic_time() - acquired);
+    }
+
+    m_mtx.unlock();
+}
@@ -0,0 +1,127 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_lock_profile_h_
+#define hyperdex_daemon_lock_profile_h_
+
+// C
+#include <stdint.h>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// How long threads wait for and hold the daemon's hot locks, by the class of
+// lock; safe to update and read from any thread.  Profiling is off unless
+// enabled, and then each thread times one in every "sample" acquisitions, so
+// the figures are of the sampled acquisitions alone.
+class lock_profile
+{
+    public:
+        enum class_t
+        {
+            KEY_STATE,         // key_state::m_lock
+            KEY_STATE_HANDOFF, // waits for another thread to finish a key's state machine
+            SEARCH_STATE,      // the lock of each search
+            NUM_CLASSES
+        };
+        static const char* name(class_t c);
+
+    public:
+        // time one in every "sample" acquisitions; 0 disables profiling
+        static void enable(uint64_t sample) { s_sample = sample; }
+        static uint64_t sample() { return s_sample; }
+        // true if the calling thread should time its next acquisition
+        static bool sampled()
+        { return s_sample > 0 && ++s_countdown % s_sample == 0; }
+        static void record_wait(class_t c, uint64_t nanos);
+        static void record_hold(class_t c, uint64_t nanos)
+        { __sync_add_and_fetch(&s_hold[c], nanos); }
+
+    public:
+        static void stats(class_t c, uint64_t* acquired, uint64_t* contended,
+                          uint64_t* wait, uint64_t* hold);
+
+    private:
+        static uint64_t s_sample;
+        static __thread uint64_t s_countdown;
+        static uint64_t s_acquired[NUM_CLASSES];
+        static uint64_t s_contended[NUM_CLASSES];
+        static uint64_t s_wait[NUM_CLASSES];
+        static uint64_t s_hold[NUM_CLASSES];
+};
+
+// A po6 mutex that reports its sampled acquisitions to lock_profile.  An
+// acquisition whose holder waits on a condition variable built on raw() may
+// go without its hold time.
+class profiled_mutex
+{
+    public:
+        class hold;
+
+    public:
+        explicit profiled_mutex(lock_profile::class_t c);
+        ~profiled_mutex() throw ();
+
+    public:
+        void lock();
+        void unlock();
+        // for constructing condition variables
+        po6::threads::mutex* raw() { return &m_mtx; }
+
+    private:
+        po6::threads::mutex m_mtx;
+        const lock_profile::class_t m_class;
+        // when the holder acquired the lock, if it is timing it; else 0
+        uint64_t m_acquired;
+
+    private:
+        profiled_mutex(const profiled_mutex&);
+        profiled_mutex& operator = (const profiled_mutex&);
+};
+
+class profiled_mutex::hold
+{
+    public:
+        hold(profiled_mutex* mtx) : m_mtx(mtx) { m_mtx->lock(); }
+        ~hold() throw () { m_mtx->unlock(); }
+
+    private:
+        profiled_mutex* m_mtx;
+
+    private:
+        hold(const hold&);
+        hold& operator = (const hold&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_lock_profile_h_
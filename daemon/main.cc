@@ -45,6 +45,9 @@
 
 // HyperDex
 #include "daemon/daemon.h"
+#include "daemon/huge_pages.h"
+#include "daemon/lock_profile.h"
+#include "daemon/memory_accounting.h"
 
 int
 main(int argc, const char* argv[])
@@ -61,7 +64,41 @@ main(int argc, const char* argv[])
     const char* coordinator_host = "127.0.0.1";
     long coordinator_port = 1982;
     long threads = 0;
+    long search_threads = 0;
+    long commit_threads = 4;
+    const char* placement = "round-robin";
+    long write_buffer = 16;
+    long block_size = 4096;
+    long block_cache = 0;
+    long bloom_bits = 10;
+    bool no_compression = false;
+    long object_cache = 0;
+    long warm_cache = 0;
+    long group_commit = 0;
+    long group_sync = 0;
+    long chain_batch = 0;
+    long chain_ack = 0;
+    long peer_lease = 0;
+    bool chain_deltas = false;
+    long slow_op = 0;
+    long trace_sample = 0;
+    long metrics_port = 0;
+    long memory_limit = 0;
+    long lock_sample = 0;
+    const char* huge_pages = "none";
+    long index_threads = 1;
+    long index_rate = 0;
+    long index_sort_buffer = 64;
+    long prefetch_rate = 0;
+    long fetch_threads = 4;
+    long index_filter_bits = 10;
+    const char* cold_data = NULL;
+    long cold_after = 1440;
+    long cold_block_cache = 0;
+    long value_log_threshold = 0;
+    long storage_shards = 1;
     bool log_immediate = false;
+    const char* zone = NULL;
 
     e::argparser ap;
     ap.autohelp();
@@ -95,6 +132,108 @@ main(int argc, const char* argv[])
     ap.arg().name('t', "threads")
             .description("the number of threads which will handle network traffic")
             .metavar("N").as_long(&threads);
+    ap.arg().long_name("search-threads")
+            .description("the number of threads dedicated to searches; they keep searches from delaying other requests and work on different regions in parallel (default: 0, searches run on the network threads)")
+            .metavar("N").as_long(&search_threads);
+    ap.arg().long_name("commit-threads")
+            .description("the number of threads that write committed ops to disk, so that a slow write holds up only its own key; 0 writes them on the network threads (default: 4)")
+            .metavar("N").as_long(&commit_threads);
+    ap.arg().long_name("thread-placement")
+            .description("how to bind threads to CPUs: round-robin, compact, scatter, numa, or a list of CPUs like 0,2,8-11 (default: round-robin)")
+            .metavar("policy").as_string(&placement);
+    ap.arg().long_name("write-buffer")
+            .description("size of LevelDB's write buffer in MB (default: 16)")
+            .metavar("MB").as_long(&write_buffer);
+    ap.arg().long_name("block-size")
+            .description("size of LevelDB's blocks in bytes (default: 4096)")
+            .metavar("bytes").as_long(&block_size);
+    ap.arg().long_name("block-cache")
+            .description("size of LevelDB's block cache in MB (default: LevelDB's built-in 8MB cache)")
+            .metavar("MB").as_long(&block_cache);
+    ap.arg().long_name("bloom-bits")
+            .description("bits per key in LevelDB's bloom filters; 0 disables them (default: 10)")
+            .metavar("N").as_long(&bloom_bits);
+    ap.arg().long_name("no-compression")
+            .description("do not compress LevelDB's blocks")
+            .set_true(&no_compression);
+    ap.arg().long_name("object-cache")
+            .description("memory in MB for caching recently read objects in front of LevelDB (default: 0, disabled)")
+            .metavar("MB").as_long(&object_cache);
+    ap.arg().long_name("warm-cache")
+            .description("memory in MB for keeping the values of recently written keys so their next write skips the read (default: 0, disabled)")
+            .metavar("MB").as_long(&warm_cache);
+    ap.arg().long_name("group-commit-window")
+            .description("microseconds a write waits for concurrent writes to commit with it (default: 0, disabled)")
+            .metavar("usec").as_long(&group_commit);
+    ap.arg().long_name("group-sync-window")
+            .description("microseconds a write to a space with group durability waits for others to share its fsync (default: 0, only those that queue during an fsync)")
+            .metavar("usec").as_long(&group_sync);
+    ap.arg().long_name("chain-batch-window")
+            .description("microseconds a chain operation waits for others bound for the same server to share its message (default: 0, disabled)")
+            .metavar("usec").as_long(&chain_batch);
+    ap.arg().long_name("chain-ack-window")
+            .description("microseconds a chain acknowledgment waits for others bound for the same server to share its message (default: 0, disabled)")
+            .metavar("usec").as_long(&chain_ack);
+    ap.arg().long_name("peer-lease")
+            .description("milliseconds a chain peer that owes us an acknowledgment may stay silent before it is reported failed (default: 0, disabled)")
+            .metavar("msec").as_long(&peer_lease);
+    ap.arg().long_name("chain-deltas")
+            .description("send the funcs of an atomic down the chain instead of the object they make when smaller; every daemon must understand them")
+            .set_true(&chain_deltas);
+    ap.arg().long_name("slow-op-threshold")
+            .description("log each write that takes this many milliseconds or more from arrival to commit, with the time spent in each stage (default: 0, disabled)")
+            .metavar("msec").as_long(&slow_op);
+    ap.arg().long_name("trace-sample")
+            .description("trace one in every N writes down the chain, appending each server's span of them to hyperdex-daemon-traces in the log directory (default: 0, disabled)")
+            .metavar("N").as_long(&trace_sample);
+    ap.arg().long_name("metrics-port")
+            .description("serve the perf counters over HTTP on this port in the Prometheus text format, at /metrics (default: 0, disabled)")
+            .metavar("port").as_long(&metrics_port);
+    ap.arg().long_name("memory-soft-limit")
+            .description("MB that key states, queued writes, searches, transfers and early messages may hold before new client requests are slowed (default: 0, unlimited)")
+            .metavar("MB").as_long(&memory_limit);
+    ap.arg().long_name("lock-profile")
+            .description("time one in every N acquisitions of the key state and search locks, reporting waits, holds and contention in the perf counters (default: 0, disabled)")
+            .metavar("N").as_long(&lock_sample);
+    ap.arg().long_name("huge-pages")
+            .description("back the object caches and the pools key states come from with huge pages: none, transparent, or explicit to use those reserved in /proc/sys/vm/nr_hugepages (default: none)")
+            .metavar("mode").as_string(&huge_pages);
+    ap.arg().long_name("index-threads")
+            .description("the number of threads that build new indices, each on a different region (default: 1)")
+            .metavar("N").as_long(&index_threads);
+    ap.arg().long_name("index-rate")
+            .description("MB per second that building new indices may read, shared by all index threads (default: 0, unlimited)")
+            .metavar("MB").as_long(&index_rate);
+    ap.arg().long_name("index-sort-buffer")
+            .description("memory in MB each index thread uses to write new indices in sorted order; 0 writes entries as they are made (default: 64)")
+            .metavar("MB").as_long(&index_sort_buffer);
+    ap.arg().long_name("prefetch-rate")
+            .description("MB per second that refilling the block cache after a restart may read, starting with the keys and regions that were read most before it (default: 0, disabled)")
+            .metavar("MB").as_long(&prefetch_rate);
+    ap.arg().long_name("fetch-threads")
+            .description("the number of threads that read the objects an index search finds, so that several reads are outstanding at once; 0 reads them one at a time (default: 4)")
+            .metavar("N").as_long(&fetch_threads);
+    ap.arg().long_name("index-filter-bits")
+            .description("bits per value of the in-memory filters that let searches for a value (or short range) an index holds no entries for skip reading LevelDB; 0 disables them (default: 10)")
+            .metavar("N").as_long(&index_filter_bits);
+    ap.arg().long_name("cold-data")
+            .description("move LevelDB's tables to this directory, on cheaper storage, once they are old enough (default: keep every table in the data directory)")
+            .metavar("dir").as_string(&cold_data);
+    ap.arg().long_name("cold-after")
+            .description("minutes a table goes unmodified before it moves to the cold data directory (default: 1440)")
+            .metavar("min").as_long(&cold_after);
+    ap.arg().long_name("cold-block-cache")
+            .description("size in MB of the block cache for tables in the cold data directory, kept apart from the block cache (default: 8)")
+            .metavar("MB").as_long(&cold_block_cache);
+    ap.arg().long_name("value-log-threshold")
+            .description("keep attributes of at least this many KB (and under 1 MB) in a log beside LevelDB, so compaction does not rewrite them (default: 0, disabled)")
+            .metavar("KB").as_long(&value_log_threshold);
+    ap.arg().long_name("storage-shards")
+            .description("spread regions over this many LevelDB instances, each with its own log, write buffer and compaction; those past the first live in shard-N under the data directory, which may be a link to another disk.  Cannot shrink once data is placed (default: 1)")
+            .metavar("N").as_long(&storage_shards);
+    ap.arg().name('z', "zone")
+            .description("register in this zone or zone/rack, so replicas spread across them (default: none)")
+            .metavar("label").as_string(&zone);
     ap.arg().long_name("log-immediate")
             .description("immediately flush all log output")
             .set_true(&log_immediate).hidden();
@@ -162,6 +301,101 @@ main(int argc, const char* argv[])
         return EXIT_FAILURE;
     }
 
+    if (write_buffer <= 0 || block_size <= 0 ||
+        block_cache < 0 || bloom_bits < 0 || bloom_bits > 64 ||
+        object_cache < 0 || warm_cache < 0 || group_commit < 0 || group_sync < 0 ||
+        index_threads <= 0 || index_threads > 64 || index_rate < 0 ||
+        index_sort_buffer < 0 || prefetch_rate < 0 ||
+        fetch_threads < 0 || fetch_threads > 256 ||
+        index_filter_bits < 0 || index_filter_bits > 64 ||
+        cold_after < 0 || cold_block_cache < 0 || value_log_threshold < 0 ||
+        storage_shards <= 0 || storage_shards > 64)
+    {
+        std::cerr << "storage options are out of range" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (chain_batch < 0 || chain_ack < 0)
+    {
+        std::cerr << "chain batching windows cannot be negative" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (peer_lease < 0)
+    {
+        std::cerr << "the peer lease cannot be negative" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (slow_op < 0)
+    {
+        std::cerr << "the slow op threshold cannot be negative" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (trace_sample < 0)
+    {
+        std::cerr << "the trace sampling rate cannot be negative" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (metrics_port < 0 || metrics_port >= (1 << 16))
+    {
+        std::cerr << "the metrics port must be between 0 and 65535" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (memory_limit < 0)
+    {
+        std::cerr << "the memory soft limit cannot be negative" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    hyperdex::memory_accounting::set_soft_limit(memory_limit * 1024ULL * 1024ULL);
+
+    if (lock_sample < 0)
+    {
+        std::cerr << "the lock profile sampling rate cannot be negative" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    hyperdex::lock_profile::enable(lock_sample);
+
+    if (!hyperdex::huge_pages::configure(huge_pages))
+    {
+        std::cerr << "cannot interpret huge page mode \"" << huge_pages << "\"" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    hyperdex::datalayer::tuning storage;
+    storage.write_buffer_size = write_buffer * 1024ULL * 1024ULL;
+    storage.block_size = block_size;
+    storage.block_cache_size = block_cache * 1024ULL * 1024ULL;
+    storage.bloom_bits = bloom_bits;
+    storage.compression = !no_compression;
+    storage.object_cache_size = object_cache * 1024ULL * 1024ULL;
+    storage.warm_cache_size = warm_cache * 1024ULL * 1024ULL;
+    storage.group_commit_window = group_commit * 1000ULL;
+    storage.group_sync_window = group_sync * 1000ULL;
+    storage.index_threads = index_threads;
+    storage.index_rate = index_rate * 1024ULL * 1024ULL;
+    storage.index_sort_buffer = index_sort_buffer * 1024ULL * 1024ULL;
+    storage.prefetch_rate = prefetch_rate * 1024ULL * 1024ULL;
+    storage.fetch_threads = fetch_threads;
+    storage.index_filter_bits = index_filter_bits;
+    storage.cold_dir = cold_data ? cold_data : "";
+    storage.cold_age = cold_after * 60ULL;
+    storage.cold_block_cache_size = cold_block_cache * 1024ULL * 1024ULL;
+    storage.value_log_threshold = value_log_threshold * 1024ULL;
+    storage.storage_shards = storage_shards;
+    hyperdex::thread_placement tp;
+
+    if (!tp.parse(placement))
+    {
+        std::cerr << "cannot interpret thread placement policy \"" << placement << "\"" << std::endl;
+        return EXIT_FAILURE;
+    }
+
     google::InitGoogleLogging(argv[0]);
     google::InstallFailureSignalHandler();
 
@@ -190,13 +424,39 @@ main(int argc, const char* argv[])
             return EXIT_FAILURE;
         }
 
+        if (search_threads < 0)
+        {
+            std::cerr << "cannot create a negative number of search threads" << std::endl;
+            return EXIT_FAILURE;
+        }
+        else if (search_threads > 512)
+        {
+            std::cerr << "refusing to create more than 512 search threads" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (commit_threads < 0)
+        {
+            std::cerr << "cannot create a negative number of commit threads" << std::endl;
+            return EXIT_FAILURE;
+        }
+        else if (commit_threads > 512)
+        {
+            std::cerr << "refusing to create more than 512 commit threads" << std::endl;
+            return EXIT_FAILURE;
+        }
+
         return d.run(daemonize,
                      std::string(data),
                      std::string(log ? log : data),
                      std::string(pidfile), has_pidfile,
                      listen, bind_to,
                      coordinator, po6::net::hostname(coordinator_host, coordinator_port),
-                     threads);
+                     threads, search_threads, commit_threads, tp, storage,
+                     chain_batch * 1000ULL, chain_ack * 1000ULL,
+                     peer_lease * 1000000ULL,
+                     chain_deltas, slow_op * 1000000ULL, trace_sample,
+                     metrics_port, std::string(zone ? zone : ""));
     }
     catch (std::exception& e)
     {
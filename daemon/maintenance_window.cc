@@ -0,0 +1,162 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <time.h>
+
+// STL
+#include <algorithm>
+
+// po6
+#include <po6/time.h>
+
+// HyperDex
+#include "daemon/maintenance_window.h"
+
+// the longest, in nanoseconds, throttle sleeps before charging again;
+// writers sleeping past the end of the window would hold it open
+#define MAINTENANCE_MAX_SLEEP 100000000ULL
+// how far, in nanoseconds, writers may fall behind the budget and then
+// write in a burst to catch up
+#define MAINTENANCE_MAX_CREDIT 1000000000ULL
+
+using hyperdex::maintenance_window;
+
+maintenance_window :: maintenance_window()
+    : m_mtx()
+    , m_start(0)
+    , m_end(0)
+    , m_budget(0)
+    , m_paid_at(0)
+    , m_bytes(0)
+    , m_slept(0)
+{
+}
+
+maintenance_window :: ~maintenance_window() throw ()
+{
+}
+
+bool
+maintenance_window :: set(uint16_t start, uint16_t end, uint64_t budget)
+{
+    if (start >= MINUTES_PER_DAY || end >= MINUTES_PER_DAY)
+    {
+        return false;
+    }
+
+    po6::threads::mutex::hold hold(&m_mtx);
+    m_start = start;
+    m_end = end;
+    m_budget = budget;
+    m_paid_at = 0;
+    return true;
+}
+
+void
+maintenance_window :: get(uint16_t* start, uint16_t* end, uint64_t* budget)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    *start = m_start;
+    *end = m_end;
+    *budget = m_budget;
+}
+
+bool
+maintenance_window :: is_open(uint64_t now)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+
+    if (m_start == m_end)
+    {
+        return true;
+    }
+
+    const uint16_t minute = (now / 60) % MINUTES_PER_DAY;
+
+    // a window like 22:00-04:00 wraps past midnight
+    if (m_start < m_end)
+    {
+        return m_start <= minute && minute < m_end;
+    }
+
+    return m_start <= minute || minute < m_end;
+}
+
+uint64_t
+maintenance_window :: charge(uint64_t bytes, uint64_t now)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    m_bytes += bytes;
+
+    if (m_budget == 0)
+    {
+        return 0;
+    }
+
+    if (m_paid_at + MAINTENANCE_MAX_CREDIT < now)
+    {
+        m_paid_at = now - MAINTENANCE_MAX_CREDIT;
+    }
+
+    m_paid_at += bytes * 1000000ULL / m_budget * 1000ULL;
+    return m_paid_at > now ? m_paid_at - now : 0;
+}
+
+void
+maintenance_window :: throttle(uint64_t bytes)
+{
+    uint64_t ns = charge(bytes, po6::monotonic_time());
+
+    while (ns > 0)
+    {
+        const uint64_t nap = std::min(ns, static_cast<uint64_t>(MAINTENANCE_MAX_SLEEP));
+        timespec ts;
+        ts.tv_sec = nap / 1000000000ULL;
+        ts.tv_nsec = nap % 1000000000ULL;
+        nanosleep(&ts, NULL);
+        ns -= nap;
+
+        po6::threads::mutex::hold hold(&m_mtx);
+        m_slept += nap;
+
+        // a budget changed meanwhile ends the sleep early
+        if (m_budget == 0 || m_paid_at == 0)
+        {
+            break;
+        }
+    }
+}
+
+void
+maintenance_window :: stats(uint64_t* bytes, uint64_t* slept)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    *bytes = m_bytes;
+    *slept = m_slept;
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_maintenance_window_h_
+#define hyperdex_daemon_maintenance_window_h_
+
+// C
+#include <stdint.h>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// The hours of the day in which a daemon does its heavy maintenance, and the
+// bytes per second that maintenance may move.  Collecting checkpoints and
+// building indices wait for the window to open; they, and wiping, share the
+// budget, which counts the bytes index builds scan and the bytes the others
+// write.  Times are minutes past midnight UTC, and a window whose start and
+// end are the same is always open.  A budget of 0 leaves maintenance
+// unthrottled.
+class maintenance_window
+{
+    public:
+        static const uint16_t MINUTES_PER_DAY = 24 * 60;
+
+    public:
+        maintenance_window();
+        ~maintenance_window() throw ();
+
+    public:
+        // false if either time is not a minute of the day
+        bool set(uint16_t start, uint16_t end, uint64_t budget);
+        void get(uint16_t* start, uint16_t* end, uint64_t* budget);
+        // whether "now", in seconds since the epoch, falls in the window
+        bool is_open(uint64_t now);
+        // account for "bytes" written at "now", a monotonic time in
+        // nanoseconds, and return how long the writer should sleep so that
+        // all writers together stay within the budget
+        uint64_t charge(uint64_t bytes, uint64_t now);
+        // charge the bytes and sleep for as long as that says, a bounded
+        // amount at a time
+        void throttle(uint64_t bytes);
+        // bytes charged and nanoseconds slept by throttle
+        void stats(uint64_t* bytes, uint64_t* slept);
+
+    private:
+        po6::threads::mutex m_mtx;
+        uint16_t m_start;
+        uint16_t m_end;
+        uint64_t m_budget;
+        // when the bytes charged so far will have been paid for
+        uint64_t m_paid_at;
+        uint64_t m_bytes;
+        uint64_t m_slept;
+
+    private:
+        maintenance_window(const maintenance_window&);
+        maintenance_window& operator = (const maintenance_window&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_maintenance_window_h_
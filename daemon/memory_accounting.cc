@@ -0,0 +1,68 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// HyperDex
+#include "daemon/memory_accounting.h"
+
+using hyperdex::memory_accounting;
+
+uint64_t memory_accounting::s_bytes[memory_accounting::NUM_CATEGORIES];
+uint64_t memory_accounting::s_soft_limit = 0;
+
+const char*
+memory_accounting :: name(category_t c)
+{
+    switch (c)
+    {
+        case KEY_STATES:
+            return "key_states";
+        case QUEUED_VALUES:
+            return "queued_values";
+        case SEARCHES:
+            return "searches";
+        case TRANSFERS:
+            return "transfers";
+        case EARLY_MESSAGES:
+            return "early_messages";
+        case NUM_CATEGORIES:
+        default:
+            return "unknown";
+    }
+}
+
+uint64_t
+memory_accounting :: total()
+{
+    uint64_t sum = 0;
+
+    for (int c = 0; c < NUM_CATEGORIES; ++c)
+    {
+        sum += bytes(static_cast<category_t>(c));
+    }
+
+    return sum;
+}
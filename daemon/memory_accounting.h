@@ -0,0 +1,106 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_memory_accounting_h_
+#define hyperdex_daemon_memory_accounting_h_
+
+// C
+#include <stdint.h>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Bytes held by the daemon's in-memory structures, by the subsystem holding
+// them; safe to update and read from any thread.  The figures count the
+// objects and the buffers they keep, not the allocator's overhead, so they
+// bound the heap from below.  Caches that account for themselves (the object
+// caches and LevelDB's) are reported beside these by collect_stats.
+class memory_accounting
+{
+    public:
+        enum category_t
+        {
+            KEY_STATES,     // key_states and their keys
+            QUEUED_VALUES,  // changes and ops queued in key_states
+            SEARCHES,       // search states and the messages they hold
+            TRANSFERS,      // objects in state transfer windows
+            EARLY_MESSAGES, // messages held for a configuration to arrive
+            NUM_CATEGORIES
+        };
+        static const char* name(category_t c);
+
+    public:
+        static void charge(category_t c, uint64_t bytes)
+        { __sync_add_and_fetch(&s_bytes[c], bytes); }
+        static void release(category_t c, uint64_t bytes)
+        { __sync_sub_and_fetch(&s_bytes[c], bytes); }
+        static uint64_t bytes(category_t c)
+        { return __sync_add_and_fetch(&s_bytes[c], 0); }
+        static uint64_t total();
+        // past the soft limit the daemon slows the intake of new client
+        // requests so that what it holds can drain; 0 is no limit
+        static void set_soft_limit(uint64_t bytes) { s_soft_limit = bytes; }
+        static uint64_t soft_limit() { return s_soft_limit; }
+        static bool over_soft_limit()
+        { return s_soft_limit > 0 && total() > s_soft_limit; }
+
+    private:
+        static uint64_t s_bytes[NUM_CATEGORIES];
+        static uint64_t s_soft_limit;
+};
+
+// The bytes one object holds, released when it goes away
+class memory_charge
+{
+    public:
+        memory_charge(memory_accounting::category_t c, uint64_t bytes)
+            : m_category(c), m_bytes(bytes) { memory_accounting::charge(c, bytes); }
+        ~memory_charge() throw () { memory_accounting::release(m_category, m_bytes); }
+
+    public:
+        // the object now holds "bytes" in all
+        void set(uint64_t bytes)
+        {
+            memory_accounting::charge(m_category, bytes);
+            memory_accounting::release(m_category, m_bytes);
+            m_bytes = bytes;
+        }
+
+    private:
+        const memory_accounting::category_t m_category;
+        uint64_t m_bytes;
+
+    private:
+        memory_charge(const memory_charge&);
+        memory_charge& operator = (const memory_charge&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_memory_accounting_h_
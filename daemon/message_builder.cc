@@ -0,0 +1,89 @@
+// Copyright (c) 2016, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <cassert>
+
+// STL
+#include <algorithm>
+
+// e
+#include <e/serialization.h>
+
+// HyperDex
+#include "daemon/message_builder.h"
+
+using hyperdex::message_builder;
+
+message_builder :: message_builder(size_t header_sz, size_t expected_sz)
+    : m_msg(e::buffer::create(header_sz + expected_sz))
+    , m_size(header_sz)
+{
+}
+
+message_builder :: ~message_builder() throw ()
+{
+}
+
+e::packer
+message_builder :: append(size_t sz)
+{
+    assert(m_msg.get());
+
+    if (m_size + sz > m_msg->capacity())
+    {
+        grow(m_size + sz);
+    }
+
+    e::packer pa = m_msg->pack_at(m_size);
+    m_size += sz;
+    return pa;
+}
+
+e::packer
+message_builder :: pack_at(size_t off)
+{
+    assert(m_msg.get());
+    assert(off <= m_size);
+    return m_msg->pack_at(off);
+}
+
+std::auto_ptr<e::buffer>
+message_builder :: finish()
+{
+    assert(m_msg.get());
+    m_msg->resize(m_size);
+    return m_msg;
+}
+
+void
+message_builder :: grow(size_t sz)
+{
+    std::auto_ptr<e::buffer> bigger(e::buffer::create(std::max(sz, 2 * static_cast<size_t>(m_msg->capacity()))));
+    bigger->pack_at(0) << e::pack_memmove(m_msg->data(), m_size);
+    m_msg = bigger;
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2016, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_message_builder_h_
+#define hyperdex_daemon_message_builder_h_
+
+// C
+#include <stddef.h>
+
+// STL
+#include <memory>
+
+// e
+#include <e/buffer.h>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Builds a message whose length isn't known up front in a single pass.  The
+// header is left for communication to fill in, and each piece is packed as
+// soon as it is produced.  The buffer doubles whenever a piece does not fit,
+// so the payload is copied O(1) times on average.
+class message_builder
+{
+    public:
+        message_builder(size_t header_sz, size_t expected_sz);
+        ~message_builder() throw ();
+
+    public:
+        // bytes in the message so far, header included
+        size_t size() const { return m_size; }
+        // packs exactly "sz" more bytes at the end of the message
+        e::packer append(size_t sz);
+        // overwrites bytes that have already been appended
+        e::packer pack_at(size_t off);
+        std::auto_ptr<e::buffer> finish();
+
+    private:
+        void grow(size_t sz);
+
+    private:
+        std::auto_ptr<e::buffer> m_msg;
+        size_t m_size;
+
+    private:
+        message_builder(const message_builder&);
+        message_builder& operator = (const message_builder&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_message_builder_h_
@@ -0,0 +1,349 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// POSIX
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// STL
+#include <cstring>
+#include <sstream>
+
+// Google Log
+#include <glog/logging.h>
+
+// po6
+#include <po6/time.h>
+
+// HyperDex
+#include "daemon/metrics_server.h"
+
+using po6::threads::make_obj_func;
+using hyperdex::metrics_server;
+
+// how long the server waits on a scraper, and how often it checks for
+// shutdown while it has none, in milliseconds
+#define METRICS_IO_TIMEOUT 250
+#define METRICS_POLL_INTERVAL 100
+// the most of a request it reads; only the request line matters
+#define METRICS_MAX_REQUEST 4096
+
+namespace
+{
+
+// families whose second part names a region, space, operation or lock
+const char* const labeled[][2] = {
+    {"region", "region"},
+    {"space", "space"},
+    {"lat", "op"},
+    {"lock", "lock"},
+};
+
+void
+sanitize(const std::string& in, std::string* out)
+{
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        char c = in[i];
+        bool ok = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                  (c >= '0' && c <= '9') || c == '_';
+        out->push_back(ok ? c : '_');
+    }
+}
+
+// wait for "fd" to be ready for "events"; false on timeout or error
+bool
+wait_for(int fd, short events, uint64_t deadline)
+{
+    uint64_t now = po6::monotonic_time();
+
+    if (now >= deadline)
+    {
+        return false;
+    }
+
+    pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+    int timeout = (deadline - now) / 1000000ULL + 1;
+    return poll(&pfd, 1, timeout) > 0 && (pfd.revents & events);
+}
+
+} // namespace
+
+metrics_server :: metrics_server()
+    : m_listen()
+    , m_thread(make_obj_func(&metrics_server::serve, this))
+    , m_started(false)
+    , m_mtx()
+    , m_stop(false)
+    , m_latest()
+{
+}
+
+metrics_server :: ~metrics_server() throw ()
+{
+    shutdown();
+}
+
+bool
+metrics_server :: start(uint16_t port)
+{
+    m_listen = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (m_listen.get() < 0)
+    {
+        PLOG(ERROR) << "could not create the metrics socket";
+        return false;
+    }
+
+    int yes = 1;
+    setsockopt(m_listen.get(), SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    sa.sin_port = htons(port);
+
+    if (bind(m_listen.get(), reinterpret_cast<sockaddr*>(&sa), sizeof(sa)) < 0 ||
+        listen(m_listen.get(), 16) < 0)
+    {
+        PLOG(ERROR) << "could not listen for metrics scrapes on port " << port;
+        m_listen.close();
+        return false;
+    }
+
+    m_listen.set_nonblocking();
+    LOG(INFO) << "serving metrics on port " << port;
+    m_thread.start();
+    m_started = true;
+    return true;
+}
+
+void
+metrics_server :: shutdown()
+{
+    if (!m_started)
+    {
+        return;
+    }
+
+    {
+        po6::threads::mutex::hold hold(&m_mtx);
+        m_stop = true;
+    }
+
+    m_thread.join();
+    m_started = false;
+}
+
+void
+metrics_server :: publish(const std::string& stats)
+{
+    if (!m_started)
+    {
+        return;
+    }
+
+    po6::threads::mutex::hold hold(&m_mtx);
+    m_latest = stats;
+}
+
+std::string
+metrics_server :: exposition(const std::string& stats)
+{
+    std::istringstream in(stats);
+    std::string pair;
+    std::string out;
+
+    while (in >> pair)
+    {
+        size_t eq = pair.find('=');
+
+        if (eq == std::string::npos || eq == 0 || eq + 1 == pair.size())
+        {
+            continue;
+        }
+
+        const std::string key(pair.substr(0, eq));
+        const std::string value(pair.substr(eq + 1));
+        size_t first = key.find('.');
+        size_t last = key.rfind('.');
+        const char* label = NULL;
+
+        if (first != std::string::npos && first != last)
+        {
+            for (size_t i = 0; i < sizeof(labeled) / sizeof(labeled[0]); ++i)
+            {
+                if (key.compare(0, first, labeled[i][0]) == 0)
+                {
+                    label = labeled[i][1];
+                }
+            }
+        }
+
+        out += "hyperdex_";
+
+        if (label)
+        {
+            sanitize(key.substr(0, first), &out);
+            out += "_";
+            sanitize(key.substr(last + 1), &out);
+            out += "{";
+            out += label;
+            out += "=\"";
+            sanitize(key.substr(first + 1, last - first - 1), &out);
+            out += "\"}";
+        }
+        else
+        {
+            sanitize(key, &out);
+        }
+
+        out += " ";
+        out += value;
+        out += "\n";
+    }
+
+    return out;
+}
+
+void
+metrics_server :: serve()
+{
+    while (true)
+    {
+        {
+            po6::threads::mutex::hold hold(&m_mtx);
+
+            if (m_stop)
+            {
+                break;
+            }
+        }
+
+        pollfd pfd;
+        pfd.fd = m_listen.get();
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+
+        if (poll(&pfd, 1, METRICS_POLL_INTERVAL) <= 0)
+        {
+            continue;
+        }
+
+        po6::io::fd conn(accept(m_listen.get(), NULL, NULL));
+
+        if (conn.get() < 0)
+        {
+            continue;
+        }
+
+        conn.set_nonblocking();
+        answer(conn.get());
+    }
+}
+
+void
+metrics_server :: answer(int conn)
+{
+    const uint64_t deadline = po6::monotonic_time() + METRICS_IO_TIMEOUT * 1000000ULL;
+    std::string request;
+
+    while (request.find("\r\n\r\n") == std::string::npos &&
+           request.size() < METRICS_MAX_REQUEST)
+    {
+        char buf[512];
+
+        if (!wait_for(conn, POLLIN, deadline))
+        {
+            return;
+        }
+
+        ssize_t amt = read(conn, buf, sizeof(buf));
+
+        if (amt <= 0)
+        {
+            return;
+        }
+
+        request.append(buf, amt);
+    }
+
+    std::string body;
+    const char* status = "200 OK";
+
+    if (request.compare(0, 13, "GET /metrics ") == 0 ||
+        request.compare(0, 6, "GET / ") == 0)
+    {
+        po6::threads::mutex::hold hold(&m_mtx);
+        body = m_latest;
+    }
+    else
+    {
+        status = "404 Not Found";
+    }
+
+    if (*status == '2')
+    {
+        body = exposition(body);
+    }
+
+    std::ostringstream ostr;
+    ostr << "HTTP/1.0 " << status << "\r\n"
+         << "Content-Type: text/plain; version=0.0.4\r\n"
+         << "Content-Length: " << body.size() << "\r\n"
+         << "Connection: close\r\n\r\n"
+         << body;
+    const std::string response(ostr.str());
+    size_t sent = 0;
+
+    while (sent < response.size())
+    {
+        if (!wait_for(conn, POLLOUT, deadline))
+        {
+            return;
+        }
+
+        ssize_t amt = write(conn, response.data() + sent, response.size() - sent);
+
+        if (amt < 0 && (errno == EAGAIN || errno == EINTR))
+        {
+            continue;
+        }
+        else if (amt <= 0)
+        {
+            return;
+        }
+
+        sent += amt;
+    }
+}
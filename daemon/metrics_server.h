@@ -0,0 +1,90 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_metrics_server_h_
+#define hyperdex_daemon_metrics_server_h_
+
+// C
+#include <stdint.h>
+
+// STL
+#include <string>
+
+// po6
+#include <po6/io/fd.h>
+#include <po6/threads/mutex.h>
+#include <po6/threads/thread.h>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Serve the latest perf counters over HTTP in the Prometheus text format, so
+// that monitoring can scrape each daemon without a client library.  The stat
+// collector publishes each line it makes; a scrape converts the latest one.
+// One thread answers scrapes one at a time, and every read and write it does
+// is bounded by a short timeout, so a slow scraper cannot hold it for long.
+class metrics_server
+{
+    public:
+        metrics_server();
+        ~metrics_server() throw ();
+
+    public:
+        // listen on "port" on every address; false if that cannot be done
+        bool start(uint16_t port);
+        void shutdown();
+        // "stats" is a line of the perf counters stream:  a timestamp
+        // followed by space-separated name=value pairs
+        void publish(const std::string& stats);
+        // the Prometheus exposition of such a line; a name's middle part
+        // becomes a label for the families that have one per region, space
+        // or operation, e.g. "region.7.reads=3" is
+        // "hyperdex_region_reads{region="7"} 3"
+        static std::string exposition(const std::string& stats);
+
+    private:
+        void serve();
+        void answer(int conn);
+
+    private:
+        po6::io::fd m_listen;
+        po6::threads::thread m_thread;
+        bool m_started;
+        po6::threads::mutex m_mtx;
+        bool m_stop;
+        std::string m_latest;
+
+    private:
+        metrics_server(const metrics_server&);
+        metrics_server& operator = (const metrics_server&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_metrics_server_h_
@@ -0,0 +1,294 @@
+// Copyright (c) 2013-2014, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <assert.h>
+
+// STL
+#include <deque>
+#include <map>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// HyperDex
+#include "daemon/nonce_table.h"
+
+// how long a client's op is remembered after it first arrives (ns); retries
+// generally come within an operation timeout, which is far shorter
+#define NONCE_TABLE_TTL (60ULL * 1000ULL * 1000ULL * 1000ULL)
+// results remembered per client and region; the oldest are forgotten first
+#define NONCE_TABLE_PER_CLIENT 4096
+// ops marked in a region between sweeps for clients that went quiet
+#define NONCE_TABLE_SWEEP_INTERVAL 1024
+
+using hyperdex::nonce_table;
+using hyperdex::region_id;
+using hyperdex::server_id;
+
+class nonce_table::region_nonces
+{
+    public:
+        region_nonces();
+        ~region_nonces() throw ();
+
+    public:
+        lookup_result check_and_mark(const server_id& client,
+                                     uint64_t nonce, uint64_t now,
+                                     network_returncode* ret);
+        void complete(const server_id& client, uint64_t nonce,
+                      network_returncode ret);
+        void forget_pending();
+
+    private:
+        struct result
+        {
+            result() : pending(true), ret(NET_SUCCESS) {}
+            bool pending;
+            network_returncode ret;
+        };
+        struct client_nonces
+        {
+            client_nonces() : results(), order() {}
+            std::map<uint64_t, result> results;
+            // (arrival time, nonce) in order of arrival
+            std::deque<std::pair<uint64_t, uint64_t> > order;
+        };
+        typedef std::map<server_id, client_nonces> client_map_t;
+
+    private:
+        static void expire(client_nonces* cn, uint64_t now);
+        void sweep(uint64_t now);
+
+    private:
+        po6::threads::mutex m_mtx;
+        client_map_t m_clients;
+        uint64_t m_marks;
+
+    private:
+        region_nonces(const region_nonces&);
+        region_nonces& operator = (const region_nonces&);
+};
+
+nonce_table :: region_nonces :: region_nonces()
+    : m_mtx()
+    , m_clients()
+    , m_marks(0)
+{
+}
+
+nonce_table :: region_nonces :: ~region_nonces() throw ()
+{
+}
+
+nonce_table::lookup_result
+nonce_table :: region_nonces :: check_and_mark(const server_id& client,
+                                               uint64_t nonce, uint64_t now,
+                                               network_returncode* ret)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    client_nonces* cn = &m_clients[client];
+    expire(cn, now);
+    std::map<uint64_t, result>::iterator it = cn->results.find(nonce);
+
+    if (it != cn->results.end())
+    {
+        if (it->second.pending)
+        {
+            return NONCE_PENDING;
+        }
+
+        *ret = it->second.ret;
+        return NONCE_COMPLETED;
+    }
+
+    cn->results[nonce] = result();
+    cn->order.push_back(std::make_pair(now, nonce));
+
+    while (cn->order.size() > NONCE_TABLE_PER_CLIENT)
+    {
+        cn->results.erase(cn->order.front().second);
+        cn->order.pop_front();
+    }
+
+    ++m_marks;
+
+    if (m_marks % NONCE_TABLE_SWEEP_INTERVAL == 0)
+    {
+        sweep(now);
+    }
+
+    return NONCE_UNSEEN;
+}
+
+void
+nonce_table :: region_nonces :: complete(const server_id& client,
+                                         uint64_t nonce,
+                                         network_returncode ret)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    client_map_t::iterator cit = m_clients.find(client);
+
+    if (cit == m_clients.end())
+    {
+        return;
+    }
+
+    std::map<uint64_t, result>::iterator it = cit->second.results.find(nonce);
+
+    if (it != cit->second.results.end())
+    {
+        it->second.pending = false;
+        it->second.ret = ret;
+    }
+}
+
+void
+nonce_table :: region_nonces :: forget_pending()
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+
+    for (client_map_t::iterator cit = m_clients.begin();
+            cit != m_clients.end(); ++cit)
+    {
+        client_nonces* cn = &cit->second;
+        std::deque<std::pair<uint64_t, uint64_t> > order;
+
+        for (size_t i = 0; i < cn->order.size(); ++i)
+        {
+            std::map<uint64_t, result>::iterator it = cn->results.find(cn->order[i].second);
+            assert(it != cn->results.end());
+
+            if (it->second.pending)
+            {
+                cn->results.erase(it);
+            }
+            else
+            {
+                order.push_back(cn->order[i]);
+            }
+        }
+
+        cn->order.swap(order);
+    }
+}
+
+void
+nonce_table :: region_nonces :: expire(client_nonces* cn, uint64_t now)
+{
+    while (!cn->order.empty() &&
+           cn->order.front().first + NONCE_TABLE_TTL <= now)
+    {
+        cn->results.erase(cn->order.front().second);
+        cn->order.pop_front();
+    }
+}
+
+void
+nonce_table :: region_nonces :: sweep(uint64_t now)
+{
+    client_map_t::iterator cit = m_clients.begin();
+
+    while (cit != m_clients.end())
+    {
+        expire(&cit->second, now);
+
+        if (cit->second.order.empty())
+        {
+            m_clients.erase(cit++);
+        }
+        else
+        {
+            ++cit;
+        }
+    }
+}
+
+const region_id nonce_table::defaultri;
+
+nonce_table :: nonce_table()
+    : m_regions()
+{
+}
+
+nonce_table :: ~nonce_table() throw ()
+{
+}
+
+nonce_table::lookup_result
+nonce_table :: check_and_mark(const region_id& ri,
+                              const server_id& client,
+                              uint64_t nonce, uint64_t now,
+                              network_returncode* ret)
+{
+    e::compat::shared_ptr<region_nonces> rn;
+
+    if (!m_regions.get(ri, &rn))
+    {
+        return NONCE_UNSEEN;
+    }
+
+    return rn->check_and_mark(client, nonce, now, ret);
+}
+
+void
+nonce_table :: complete(const region_id& ri,
+                        const server_id& client,
+                        uint64_t nonce, network_returncode ret)
+{
+    e::compat::shared_ptr<region_nonces> rn;
+
+    if (m_regions.get(ri, &rn))
+    {
+        rn->complete(client, nonce, ret);
+    }
+}
+
+void
+nonce_table :: adopt(region_id* ris, size_t ris_sz)
+{
+    nonce_map_t new_regions;
+
+    for (size_t i = 0; i < ris_sz; ++i)
+    {
+        e::compat::shared_ptr<region_nonces> rn;
+
+        if (m_regions.get(ris[i], &rn))
+        {
+            rn->forget_pending();
+        }
+        else
+        {
+            rn = e::compat::shared_ptr<region_nonces>(new region_nonces());
+        }
+
+        assert(rn);
+        new_regions.put(ris[i], rn);
+    }
+
+    m_regions.swap(&new_regions);
+}
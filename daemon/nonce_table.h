@@ -0,0 +1,95 @@
+// Copyright (c) 2013, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_nonce_table_h_
+#define hyperdex_daemon_nonce_table_h_
+
+// e
+#include <e/ao_hash_map.h>
+#include <e/compat.h>
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+#include "common/network_returncode.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Remembers, per region, the outcome of each client's recent atomics so that a
+// retry carrying the same (client, nonce) is answered without being executed
+// a second time.  Timestamps are supplied by the caller in nanoseconds.
+class nonce_table
+{
+    public:
+        enum lookup_result
+        {
+            NONCE_UNSEEN,
+            // the op was accepted and has not yet been answered
+            NONCE_PENDING,
+            // the op completed; its result is in the "ret" out parameter
+            NONCE_COMPLETED
+        };
+
+    public:
+        nonce_table();
+        ~nonce_table() throw ();
+
+    // concurrent methods
+    // regions that are not adopted are never tracked
+    public:
+        // returns NONCE_UNSEEN and marks the op as pending if it is new, or
+        // else what is known about the earlier op with the same nonce
+        lookup_result check_and_mark(const region_id& ri,
+                                     const server_id& client,
+                                     uint64_t nonce, uint64_t now,
+                                     network_returncode* ret);
+        // record the result the client was sent for a pending op
+        void complete(const region_id& ri,
+                      const server_id& client,
+                      uint64_t nonce, network_returncode ret);
+
+    // external synchronization required; nothing can call other methods
+    public:
+        // keep results for the listed regions and drop the rest; ops that were
+        // still pending may have been discarded, so forget them too
+        void adopt(region_id* ris, size_t ris_sz);
+
+    private:
+        class region_nonces;
+        nonce_table(const nonce_table&);
+        nonce_table& operator = (const nonce_table&);
+        static uint64_t id(region_id ri) { return ri.get(); }
+
+    private:
+        const static region_id defaultri;
+        typedef e::ao_hash_map<region_id, e::compat::shared_ptr<region_nonces>, id, defaultri> nonce_map_t;
+        nonce_map_t m_regions;
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_nonce_table_h_
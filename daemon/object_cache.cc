@@ -0,0 +1,252 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#define __STDC_LIMIT_MACROS
+
+// C
+#include <cstring>
+
+// e
+#include <e/endian.h>
+
+// HyperDex
+#include "cityhash/city.h"
+#include "daemon/huge_pages.h"
+#include "daemon/object_cache.h"
+
+using hyperdex::object_cache;
+
+// per-entry bookkeeping charged against the budget in addition to the key
+// and value themselves
+#define ENTRY_OVERHEAD 96
+
+struct object_cache::entry
+{
+    entry(const std::string& k, const std::string& v) : key(k), value(v.data(), v.size()) {}
+    size_t size() const { return key.size() + value.size() + ENTRY_OVERHEAD; }
+    std::string key;
+    huge_string value;
+};
+
+struct object_cache::shard
+{
+    typedef std::list<entry, huge_page_allocator<entry> > lru_t;
+    typedef std::map<std::string, lru_t::iterator, std::less<std::string>,
+                     huge_page_allocator<std::pair<const std::string, lru_t::iterator> > > lookup_t;
+    shard() : mtx(), generation(0), bytes(0), lru(), lookup() {}
+    po6::threads::mutex mtx;
+    uint64_t generation;
+    uint64_t bytes;
+    // most recently used at the front
+    lru_t lru;
+    lookup_t lookup;
+
+    private:
+        shard(const shard&);
+        shard& operator = (const shard&);
+};
+
+object_cache :: object_cache()
+    : m_shard_budget(0)
+    , m_hits()
+    , m_misses()
+    , m_shards(new shard[SHARDS])
+{
+}
+
+object_cache :: ~object_cache() throw ()
+{
+    delete[] m_shards;
+}
+
+void
+object_cache :: set_budget(uint64_t bytes)
+{
+    m_shard_budget = bytes / SHARDS;
+}
+
+bool
+object_cache :: lookup(const region_id& ri, const e::slice& key,
+                       std::string* encoded, uint64_t* generation)
+{
+    std::string k(make_key(ri, key));
+    shard* s = get_shard(k);
+    po6::threads::mutex::hold hold(&s->mtx);
+    shard::lookup_t::iterator it;
+    it = s->lookup.find(k);
+    *generation = s->generation;
+
+    if (it == s->lookup.end())
+    {
+        m_misses.tap();
+        return false;
+    }
+
+    s->lru.splice(s->lru.begin(), s->lru, it->second);
+    encoded->assign(it->second->value.data(), it->second->value.size());
+    m_hits.tap();
+    return true;
+}
+
+void
+object_cache :: insert(const region_id& ri, const e::slice& key,
+                       uint64_t generation, const std::string& encoded)
+{
+    store(ri, key, generation, encoded, false);
+}
+
+void
+object_cache :: replace(const region_id& ri, const e::slice& key,
+                        uint64_t generation, const std::string& encoded)
+{
+    store(ri, key, generation, encoded, true);
+}
+
+void
+object_cache :: invalidate(const region_id& ri, const e::slice& key)
+{
+    std::string k(make_key(ri, key));
+    shard* s = get_shard(k);
+    po6::threads::mutex::hold hold(&s->mtx);
+    ++s->generation;
+    remove(s, k);
+}
+
+void
+object_cache :: erase(const region_id& ri, const e::slice& key)
+{
+    std::string k(make_key(ri, key));
+    shard* s = get_shard(k);
+    po6::threads::mutex::hold hold(&s->mtx);
+    remove(s, k);
+}
+
+void
+object_cache :: clear()
+{
+    for (size_t i = 0; i < SHARDS; ++i)
+    {
+        shard* s = m_shards + i;
+        po6::threads::mutex::hold hold(&s->mtx);
+        ++s->generation;
+        s->lru.clear();
+        s->lookup.clear();
+        s->bytes = 0;
+    }
+}
+
+uint64_t
+object_cache :: bytes()
+{
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < SHARDS; ++i)
+    {
+        shard* s = m_shards + i;
+        po6::threads::mutex::hold hold(&s->mtx);
+        total += s->bytes;
+    }
+
+    return total;
+}
+
+std::string
+object_cache :: make_key(const region_id& ri, const e::slice& key)
+{
+    std::string k(sizeof(uint64_t) + key.size(), '\0');
+    char* ptr = &k[0];
+    ptr = e::pack64be(ri.get(), ptr);
+    memmove(ptr, key.data(), key.size());
+    return k;
+}
+
+object_cache::shard*
+object_cache :: get_shard(const std::string& k)
+{
+    return m_shards + CityHash64(k.data(), k.size()) % SHARDS;
+}
+
+void
+object_cache :: store(const region_id& ri, const e::slice& key,
+                      uint64_t generation, const std::string& encoded,
+                      bool overwrite)
+{
+    std::string k(make_key(ri, key));
+    shard* s = get_shard(k);
+    po6::threads::mutex::hold hold(&s->mtx);
+
+    if (s->generation != generation)
+    {
+        return;
+    }
+
+    if (s->lookup.find(k) != s->lookup.end())
+    {
+        if (!overwrite)
+        {
+            return;
+        }
+
+        remove(s, k);
+    }
+
+    s->lru.push_front(entry(k, encoded));
+
+    if (s->lru.front().size() > m_shard_budget)
+    {
+        s->lru.pop_front();
+        return;
+    }
+
+    s->lookup[k] = s->lru.begin();
+    s->bytes += s->lru.front().size();
+    evict(s);
+}
+
+void
+object_cache :: remove(shard* s, const std::string& k)
+{
+    shard::lookup_t::iterator it;
+    it = s->lookup.find(k);
+
+    if (it != s->lookup.end())
+    {
+        s->bytes -= it->second->size();
+        s->lru.erase(it->second);
+        s->lookup.erase(it);
+    }
+}
+
+void
+object_cache :: evict(shard* s)
+{
+    while (s->bytes > m_shard_budget && !s->lru.empty())
+    {
+        s->bytes -= s->lru.back().size();
+        s->lookup.erase(s->lru.back().key);
+        s->lru.pop_back();
+    }
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef hyperdex_daemon_object_cache_h_
+#define hyperdex_daemon_object_cache_h_
+
+// STL
+#include <list>
+#include <map>
+#include <string>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// e
+#include <e/slice.h>
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+#include "daemon/performance_counter.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// A sharded LRU cache of encoded objects keyed by (region, key).  It sits in
+// front of LevelDB for point reads and is invalidated by every write.  Each
+// shard keeps a generation that any invalidation bumps; a reader that missed
+// passes the generation it saw back to "insert", so a value read from disk
+// before a concurrent write can never be cached after that write.  Entries
+// live in huge_pages memory.
+class object_cache
+{
+    public:
+        object_cache();
+        ~object_cache() throw ();
+
+    public:
+        // a budget of 0 disables the cache; call before use
+        void set_budget(uint64_t bytes);
+        bool enabled() const { return m_shard_budget > 0; }
+        // on a hit, copy the encoded value into "*encoded" and return true;
+        // either way, store the token to later pass to "insert" or "replace"
+        bool lookup(const region_id& ri, const e::slice& key,
+                    std::string* encoded, uint64_t* generation);
+        // cache "encoded" unless the key is already cached
+        void insert(const region_id& ri, const e::slice& key,
+                    uint64_t generation, const std::string& encoded);
+        // cache "encoded", overwriting any value already cached
+        void replace(const region_id& ri, const e::slice& key,
+                     uint64_t generation, const std::string& encoded);
+        // drop the key and fail any "insert" or "replace" holding an older
+        // token for the shard
+        void invalidate(const region_id& ri, const e::slice& key);
+        // drop the key without touching the generation; for writers that
+        // will "replace" the value themselves
+        void erase(const region_id& ri, const e::slice& key);
+        void clear();
+
+    public:
+        uint64_t hits() const { return m_hits.read(); }
+        uint64_t misses() const { return m_misses.read(); }
+        uint64_t bytes();
+
+    private:
+        const static size_t SHARDS = 64;
+        struct entry;
+        struct shard;
+        static std::string make_key(const region_id& ri, const e::slice& key);
+        shard* get_shard(const std::string& k);
+        void store(const region_id& ri, const e::slice& key,
+                   uint64_t generation, const std::string& encoded,
+                   bool overwrite);
+        static void remove(shard* s, const std::string& k);
+        void evict(shard* s);
+
+    private:
+        uint64_t m_shard_budget;
+        performance_counter m_hits;
+        performance_counter m_misses;
+        shard* m_shards;
+
+    private:
+        object_cache(const object_cache&);
+        object_cache& operator = (const object_cache&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_object_cache_h_
@@ -0,0 +1,235 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_object_pool_h_
+#define hyperdex_daemon_object_pool_h_
+
+// C
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// STL
+#include <limits>
+#include <new>
+
+// HyperDex
+#include "namespace.h"
+#include "daemon/huge_pages.h"
+
+// the most free blocks a thread keeps for each pool before handing them back
+// to huge_pages
+#define OBJECT_POOL_MAX_CACHED 4096
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Occupancy of every pool tagged with "Tag"; safe to read from any thread
+template <typename Tag>
+class pool_stats
+{
+    public:
+        // blocks handed out and not yet returned
+        static uint64_t in_use() { return __sync_add_and_fetch(&s_in_use, 0); }
+        // free blocks sitting in the per-thread caches
+        static uint64_t cached() { return __sync_add_and_fetch(&s_cached, 0); }
+
+    public:
+        static uint64_t s_in_use;
+        static uint64_t s_cached;
+};
+
+template <typename Tag> uint64_t pool_stats<Tag>::s_in_use = 0;
+template <typename Tag> uint64_t pool_stats<Tag>::s_cached = 0;
+
+// A per-thread free list of sizeof(T) blocks.  Objects on the write path are
+// often freed by a different thread than the one that made them; the block
+// then joins the freeing thread's cache.  Each cache is capped, so a thread
+// that only frees cannot hoard memory.  Blocks cached by a thread that exits
+// are not reclaimed, which is fine for the daemon's long-lived threads.
+template <typename T, typename Tag = T>
+class object_pool
+{
+    public:
+        static void* allocate();
+        static void deallocate(void* ptr);
+
+    private:
+        struct block { block* next; };
+        static const size_t block_size = sizeof(T) > sizeof(block) ? sizeof(T) : sizeof(block);
+
+    private:
+        static __thread block* s_free;
+        static __thread size_t s_free_sz;
+};
+
+template <typename T, typename Tag>
+__thread typename object_pool<T, Tag>::block* object_pool<T, Tag>::s_free = NULL;
+template <typename T, typename Tag>
+__thread size_t object_pool<T, Tag>::s_free_sz = 0;
+
+template <typename T, typename Tag>
+void*
+object_pool<T, Tag> :: allocate()
+{
+    __sync_add_and_fetch(&pool_stats<Tag>::s_in_use, 1);
+
+    if (s_free)
+    {
+        block* b = s_free;
+        s_free = b->next;
+        --s_free_sz;
+        __sync_sub_and_fetch(&pool_stats<Tag>::s_cached, 1);
+        return b;
+    }
+
+    try
+    {
+        return huge_pages::allocate(block_size);
+    }
+    catch (std::bad_alloc&)
+    {
+        __sync_sub_and_fetch(&pool_stats<Tag>::s_in_use, 1);
+        throw;
+    }
+}
+
+template <typename T, typename Tag>
+void
+object_pool<T, Tag> :: deallocate(void* ptr)
+{
+    if (!ptr)
+    {
+        return;
+    }
+
+    __sync_sub_and_fetch(&pool_stats<Tag>::s_in_use, 1);
+
+    if (s_free_sz >= OBJECT_POOL_MAX_CACHED)
+    {
+        huge_pages::deallocate(ptr, block_size);
+        return;
+    }
+
+    block* b = static_cast<block*>(ptr);
+    b->next = s_free;
+    s_free = b;
+    ++s_free_sz;
+    __sync_add_and_fetch(&pool_stats<Tag>::s_cached, 1);
+}
+
+// Derive T from pooled<T> to allocate every T from object_pool; a class
+// derived from T (and so of a different size) falls through to the heap
+template <typename T, typename Tag = T>
+class pooled
+{
+    public:
+        static void* operator new(size_t sz)
+        {
+            return sz == sizeof(T) ? object_pool<T, Tag>::allocate()
+                                   : ::operator new(sz);
+        }
+        static void operator delete(void* ptr, size_t sz)
+        {
+            if (sz == sizeof(T))
+            {
+                object_pool<T, Tag>::deallocate(ptr);
+            }
+            else
+            {
+                ::operator delete(ptr);
+            }
+        }
+};
+
+// An STL allocator that takes single objects (e.g., std::list nodes) from
+// object_pool and anything larger from the heap.  Every type the container
+// rebinds to shares the pool_stats of "Tag".
+template <typename T, typename Tag = T>
+class pool_allocator
+{
+    public:
+        typedef T value_type;
+        typedef T* pointer;
+        typedef const T* const_pointer;
+        typedef T& reference;
+        typedef const T& const_reference;
+        typedef size_t size_type;
+        typedef ptrdiff_t difference_type;
+        template <typename U> struct rebind { typedef pool_allocator<U, Tag> other; };
+
+    public:
+        pool_allocator() throw () {}
+        pool_allocator(const pool_allocator&) throw () {}
+        template <typename U> pool_allocator(const pool_allocator<U, Tag>&) throw () {}
+        ~pool_allocator() throw () {}
+
+    public:
+        pointer address(reference x) const { return &x; }
+        const_pointer address(const_reference x) const { return &x; }
+        pointer allocate(size_type n, const void* = 0)
+        {
+            if (n == 1)
+            {
+                return static_cast<pointer>(object_pool<T, Tag>::allocate());
+            }
+
+            return static_cast<pointer>(::operator new(n * sizeof(T)));
+        }
+        void deallocate(pointer p, size_type n)
+        {
+            if (n == 1)
+            {
+                object_pool<T, Tag>::deallocate(p);
+            }
+            else
+            {
+                ::operator delete(p);
+            }
+        }
+        size_type max_size() const throw ()
+        { return std::numeric_limits<size_type>::max() / sizeof(T); }
+        void construct(pointer p, const T& val) { new (p) T(val); }
+        void destroy(pointer p) { p->~T(); }
+};
+
+template <typename T, typename U, typename Tag>
+inline bool
+operator == (const pool_allocator<T, Tag>&, const pool_allocator<U, Tag>&)
+{
+    return true;
+}
+
+template <typename T, typename U, typename Tag>
+inline bool
+operator != (const pool_allocator<T, Tag>&, const pool_allocator<U, Tag>&)
+{
+    return false;
+}
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_object_pool_h_
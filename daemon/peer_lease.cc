@@ -0,0 +1,81 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// e
+#include <e/atomic.h>
+
+// HyperDex
+#include "daemon/peer_lease.h"
+
+using hyperdex::peer_lease;
+
+// a lease renewed this recently is not written again, so that the network
+// threads do not all write the same cache line for every message
+#define LEASE_GRANULARITY 1000000ULL
+
+peer_lease :: peer_lease()
+{
+    reset(0);
+}
+
+peer_lease :: ~peer_lease() throw ()
+{
+}
+
+void
+peer_lease :: reset(uint64_t now)
+{
+    for (size_t i = 0; i < SLOTS; ++i)
+    {
+        e::atomic::store_64_nobarrier(&m_heard[i], now);
+    }
+}
+
+void
+peer_lease :: heard(const server_id& peer, uint64_t now)
+{
+    uint64_t* h = &m_heard[slot(peer)];
+
+    if (e::atomic::load_64_nobarrier(h) + LEASE_GRANULARITY < now)
+    {
+        e::atomic::store_64_nobarrier(h, now);
+    }
+}
+
+bool
+peer_lease :: expired(const server_id& peer, uint64_t now, uint64_t timeout) const
+{
+    uint64_t h = e::atomic::load_64_nobarrier(&m_heard[slot(peer)]);
+    return h < now && now - h > timeout;
+}
+
+size_t
+peer_lease :: slot(const server_id& peer)
+{
+    return (peer.get() * 0x9e3779b97f4a7c15ULL) >> 56;
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_peer_lease_h_
+#define hyperdex_daemon_peer_lease_h_
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// When each chain peer was last heard from.  Every chain message from a peer
+// renews its lease; a peer that lets its lease run out while it owes us an
+// acknowledgment is presumed to have failed, without waiting for TCP to
+// notice.  Peers hash into a fixed table of slots, and peers that share a slot
+// share a lease, which only ever errs toward thinking a peer alive.  Safe to
+// use from any thread without locks.  All times are in nanoseconds.
+class peer_lease
+{
+    public:
+        peer_lease();
+        ~peer_lease() throw ();
+
+    public:
+        // start every lease afresh, as though every peer were just heard
+        void reset(uint64_t now);
+        void heard(const server_id& peer, uint64_t now);
+        // has "peer" been silent for more than "timeout"?
+        bool expired(const server_id& peer, uint64_t now, uint64_t timeout) const;
+
+    private:
+        const static size_t SLOTS = 256;
+        static size_t slot(const server_id& peer);
+
+    private:
+        uint64_t m_heard[SLOTS];
+
+    private:
+        peer_lease(const peer_lease&);
+        peer_lease& operator = (const peer_lease&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_peer_lease_h_
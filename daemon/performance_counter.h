@@ -28,31 +28,60 @@
 #ifndef hyperdex_daemon_performance_counters_h_
 #define hyperdex_daemon_performance_counters_h_
 
+// C
+#include <string.h>
+
 // e
 #include <e/atomic.h>
 
+// HyperDex
+#include "daemon/thread_stripe.h"
+
 BEGIN_HYPERDEX_NAMESPACE
 
-// a threadsafe counter
+// a threadsafe counter, striped by thread so that the many threads tapping
+// the same counter do not contend for the cache line holding it
 class performance_counter
 {
     public:
-        performance_counter() : m_count(0) {}
+        const static size_t STRIPES = 16;
+
+    public:
+        performance_counter() { memset(m_stripes, 0, sizeof(m_stripes)); }
         ~performance_counter() throw () {}
 
     public:
         // increment the counter
         // any number of threads can tap simultaneously
-        void tap() { e::atomic::increment_64_nobarrier(&m_count, 1); }
+        void tap() { add(1); }
+        void add(uint64_t x)
+        { e::atomic::increment_64_nobarrier(&m_stripes[thread_stripe() % STRIPES].count, x); }
         // any number of threads can call "read" simultaneously
-        uint64_t read() const { return e::atomic::load_64_nobarrier(&m_count); }
+        uint64_t read() const
+        {
+            uint64_t count = 0;
+
+            for (size_t s = 0; s < STRIPES; ++s)
+            {
+                count += e::atomic::load_64_nobarrier(&m_stripes[s].count);
+            }
+
+            return count;
+        }
+
+    private:
+        struct stripe
+        {
+            uint64_t count;
+            char pad[64];
+        };
 
     private:
         performance_counter(const performance_counter&);
         performance_counter& operator = (const performance_counter&);
 
     private:
-        uint64_t m_count;
+        stripe m_stripes[STRIPES];
 };
 
 END_HYPERDEX_NAMESPACE
@@ -0,0 +1,167 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#define __STDC_LIMIT_MACROS
+
+// C
+#include <stdint.h>
+
+// POSIX
+#include <time.h>
+
+// STL
+#include <algorithm>
+#include <string>
+
+// po6
+#include <po6/time.h>
+
+// Google Log
+#include <glog/logging.h>
+
+// HyperDex
+#include "common/network_returncode.h"
+#include "daemon/daemon.h"
+#include "daemon/profile_thread.h"
+#include "daemon/profiler.h"
+
+using hyperdex::profile_thread;
+
+// the longest window a single request may ask for
+#define PROFILE_MAX_SECONDS 300
+// how often a running window checks for shutdown
+#define PROFILE_POLL_NANOS 100000000ULL
+
+profile_thread :: profile_thread(daemon* d)
+    : background_thread(d)
+    , m_daemon(d)
+    , m_busy(false)
+    , m_pending(false)
+    , m_from()
+    , m_vto()
+    , m_nonce(0)
+    , m_seconds(0)
+{
+}
+
+profile_thread :: ~profile_thread() throw ()
+{
+    shutdown();
+}
+
+const char*
+profile_thread :: thread_name()
+{
+    return "profile";
+}
+
+bool
+profile_thread :: have_work()
+{
+    return m_pending;
+}
+
+void
+profile_thread :: copy_work()
+{
+    m_pending = false;
+}
+
+void
+profile_thread :: do_work()
+{
+    const uint32_t seconds = std::max(1U, std::min(m_seconds, static_cast<uint32_t>(PROFILE_MAX_SECONDS)));
+    network_returncode rc = NET_SERVERERROR;
+    std::string folded;
+    uint64_t samples = 0;
+    uint64_t dropped = 0;
+    // a reconfiguration must not wait out the window
+    this->offline();
+
+    if (profiler::start())
+    {
+        LOG(INFO) << "profiling all threads for " << seconds << " seconds";
+        const uint64_t deadline = po6::monotonic_time() + seconds * 1000000000ULL;
+        uint64_t now;
+
+        while ((now = po6::monotonic_time()) < deadline && !shutting_down())
+        {
+            struct timespec ts;
+            ts.tv_sec = 0;
+            ts.tv_nsec = std::min(deadline - now, static_cast<uint64_t>(PROFILE_POLL_NANOS));
+            nanosleep(&ts, NULL);
+        }
+
+        profiler::stop(&folded, &samples, &dropped);
+        LOG(INFO) << "profile finished with " << samples << " samples"
+                  << " (" << dropped << " dropped)";
+        rc = NET_SUCCESS;
+    }
+    else
+    {
+        PLOG(ERROR) << "could not start the profiler";
+    }
+
+    this->online();
+    m_daemon->send_profile(m_from, m_vto, m_nonce, rc, samples, dropped, folded);
+    this->lock();
+    m_busy = false;
+    this->unlock();
+}
+
+bool
+profile_thread :: enqueue(server_id from, virtual_server_id vto,
+                          uint64_t nonce, uint32_t seconds)
+{
+    this->lock();
+
+    if (m_busy)
+    {
+        this->unlock();
+        return false;
+    }
+
+    m_busy = true;
+    m_pending = true;
+    m_from = from;
+    m_vto = vto;
+    m_nonce = nonce;
+    m_seconds = seconds;
+    this->wakeup();
+    this->unlock();
+    return true;
+}
+
+bool
+profile_thread :: shutting_down()
+{
+    this->lock();
+    const bool ret = this->is_shutdown();
+    this->unlock();
+    return ret;
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_profile_thread_h_
+#define hyperdex_daemon_profile_thread_h_
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+#include "daemon/background_thread.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Runs the profiles that administrators ask for with PROFILE.  The window
+// elapses here rather than on a network thread, and the folded stacks go
+// back to whoever asked once it closes.  One profile runs at a time.
+class profile_thread : public background_thread
+{
+    public:
+        profile_thread(daemon* d);
+        ~profile_thread() throw ();
+
+    public:
+        virtual const char* thread_name();
+        virtual bool have_work();
+        virtual void copy_work();
+        virtual void do_work();
+
+    public:
+        // false if a profile is already pending or running
+        bool enqueue(server_id from, virtual_server_id vto,
+                     uint64_t nonce, uint32_t seconds);
+
+    private:
+        bool shutting_down();
+
+    private:
+        daemon* m_daemon;
+        // under lock
+        bool m_busy;
+        bool m_pending;
+        // set with m_pending; read by do_work
+        server_id m_from;
+        virtual_server_id m_vto;
+        uint64_t m_nonce;
+        uint32_t m_seconds;
+
+    private:
+        profile_thread(const profile_thread&);
+        profile_thread& operator = (const profile_thread&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_profile_thread_h_
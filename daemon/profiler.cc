@@ -0,0 +1,257 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// POSIX
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/time.h>
+
+// STL
+#include <cxxabi.h>
+#include <map>
+#include <sstream>
+
+// HyperDex
+#include "daemon/profiler.h"
+
+using hyperdex::profiler;
+
+// samples per second of CPU time
+#define PROFILER_HZ 100
+// samples held per profile; the rest are counted and dropped
+#define PROFILER_MAX_SAMPLES 32768
+// frames kept per sample, innermost first
+#define PROFILER_MAX_DEPTH 64
+// the signal handler and the kernel's trampoline sit atop every stack
+#define PROFILER_SKIP_FRAMES 2
+
+namespace
+{
+
+struct sample
+{
+    void* pcs[PROFILER_MAX_DEPTH];
+    int depth;
+};
+
+sample* s_samples = NULL;
+uint64_t s_next = 0;
+uint64_t s_inflight = 0;
+uint64_t s_sampling = 0;
+uint64_t s_running = 0;
+bool s_installed = false;
+
+void
+handle_sigprof(int)
+{
+    const int saved = errno;
+    __sync_fetch_and_add(&s_inflight, 1);
+
+    if (__sync_fetch_and_add(&s_sampling, 0))
+    {
+        const uint64_t idx = __sync_fetch_and_add(&s_next, 1);
+
+        if (idx < PROFILER_MAX_SAMPLES)
+        {
+            sample* s = s_samples + idx;
+            s->depth = backtrace(s->pcs, PROFILER_MAX_DEPTH);
+        }
+    }
+
+    __sync_fetch_and_sub(&s_inflight, 1);
+    errno = saved;
+}
+
+bool
+arm(long usec)
+{
+    struct itimerval it;
+    it.it_interval.tv_sec = 0;
+    it.it_interval.tv_usec = usec;
+    it.it_value = it.it_interval;
+    return setitimer(ITIMER_PROF, &it, NULL) >= 0;
+}
+
+std::string
+symbolize(void* pc, bool leaf)
+{
+    // a return address may lie just past the end of its caller
+    const uintptr_t addr = reinterpret_cast<uintptr_t>(pc) - (leaf ? 0 : 1);
+    Dl_info info;
+    char buf[64];
+
+    if (dladdr(reinterpret_cast<void*>(addr), &info) == 0)
+    {
+        snprintf(buf, sizeof(buf), "0x%llx", static_cast<unsigned long long>(addr));
+        return buf;
+    }
+
+    if (info.dli_sname)
+    {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+        std::string name(status == 0 && demangled ? demangled : info.dli_sname);
+        free(demangled);
+        return name;
+    }
+
+    // no symbol: name the object and the offset, for addr2line
+    const char* obj = info.dli_fname ? info.dli_fname : "?";
+    const char* slash = strrchr(obj, '/');
+    snprintf(buf, sizeof(buf), "+0x%llx",
+             static_cast<unsigned long long>(addr - reinterpret_cast<uintptr_t>(info.dli_fbase)));
+    return std::string(slash ? slash + 1 : obj) + buf;
+}
+
+} // namespace
+
+bool
+profiler :: start()
+{
+    if (!__sync_bool_compare_and_swap(&s_running, 0, 1))
+    {
+        return false;
+    }
+
+    // the first backtrace loads the unwinder, which is no business for a
+    // signal handler
+    void* warm[1];
+    backtrace(warm, 1);
+
+    if (!s_installed)
+    {
+        // left in place for good: a SIGPROF still pending after "stop" must
+        // not meet the default action, which kills the process
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = handle_sigprof;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESTART;
+
+        if (sigaction(SIGPROF, &sa, NULL) < 0)
+        {
+            __sync_fetch_and_sub(&s_running, 1);
+            return false;
+        }
+
+        s_installed = true;
+    }
+
+    s_samples = static_cast<sample*>(malloc(sizeof(sample) * PROFILER_MAX_SAMPLES));
+
+    if (!s_samples)
+    {
+        __sync_fetch_and_sub(&s_running, 1);
+        return false;
+    }
+
+    s_next = 0;
+    __sync_fetch_and_add(&s_sampling, 1);
+
+    if (!arm(1000000 / PROFILER_HZ))
+    {
+        __sync_fetch_and_sub(&s_sampling, 1);
+        free(s_samples);
+        s_samples = NULL;
+        __sync_fetch_and_sub(&s_running, 1);
+        return false;
+    }
+
+    return true;
+}
+
+void
+profiler :: stop(std::string* folded, uint64_t* samples, uint64_t* dropped)
+{
+    arm(0);
+    __sync_fetch_and_sub(&s_sampling, 1);
+
+    // a handler that saw s_sampling set is still writing its sample
+    while (__sync_fetch_and_add(&s_inflight, 0) != 0)
+    {
+        sched_yield();
+    }
+
+    const uint64_t taken = __sync_fetch_and_add(&s_next, 0);
+    const uint64_t kept = taken < PROFILER_MAX_SAMPLES ? taken : PROFILER_MAX_SAMPLES;
+    std::map<std::pair<void*, bool>, std::string> names;
+    std::map<std::string, uint64_t> stacks;
+
+    for (uint64_t i = 0; i < kept; ++i)
+    {
+        const sample& s(s_samples[i]);
+        std::string stack;
+
+        for (int f = s.depth - 1; f >= PROFILER_SKIP_FRAMES; --f)
+        {
+            const std::pair<void*, bool> pc(s.pcs[f], f == PROFILER_SKIP_FRAMES);
+            std::map<std::pair<void*, bool>, std::string>::iterator it = names.find(pc);
+
+            if (it == names.end())
+            {
+                it = names.insert(std::make_pair(pc, symbolize(pc.first, pc.second))).first;
+            }
+
+            if (!stack.empty())
+            {
+                stack += ";";
+            }
+
+            stack += it->second;
+        }
+
+        if (!stack.empty())
+        {
+            ++stacks[stack];
+        }
+    }
+
+    std::ostringstream ostr;
+
+    for (std::map<std::string, uint64_t>::iterator it = stacks.begin();
+            it != stacks.end(); ++it)
+    {
+        ostr << it->first << " " << it->second << "\n";
+    }
+
+    *folded = ostr.str();
+    *samples = kept;
+    *dropped = taken - kept;
+    free(s_samples);
+    s_samples = NULL;
+    __sync_fetch_and_sub(&s_running, 1);
+}
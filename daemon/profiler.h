@@ -0,0 +1,63 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_profiler_h_
+#define hyperdex_daemon_profiler_h_
+
+// C
+#include <stdint.h>
+
+// STL
+#include <string>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Samples the stacks of the daemon's threads on demand.  While a profile
+// runs, ITIMER_PROF raises SIGPROF for each hundredth of a second of CPU the
+// process uses, and the handler records the stack of whichever thread it
+// interrupts.  Stopping folds identical stacks into one line apiece,
+// "outermost;...;innermost count", the input flamegraph.pl expects.  Threads
+// that block SIGPROF are never sampled.
+class profiler
+{
+    public:
+        // false if a profile is already running or the timer cannot be armed
+        static bool start();
+        // stop the profile "start" began; "dropped" counts the samples that
+        // did not fit in the buffer
+        static void stop(std::string* folded,
+                         uint64_t* samples,
+                         uint64_t* dropped);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_profiler_h_
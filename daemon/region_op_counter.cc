@@ -0,0 +1,298 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <cassert>
+
+// STL
+#include <algorithm>
+
+// e
+#include <e/atomic.h>
+
+// HyperDex
+#include "daemon/region_op_counter.h"
+#include "daemon/thread_stripe.h"
+
+using hyperdex::region_op_counter;
+
+const char*
+region_op_counter :: name(counter_t c)
+{
+    switch (c)
+    {
+        case READS: return "reads";
+        case WRITES: return "writes";
+        case SEARCHES: return "searches";
+        case CHAIN: return "chain";
+        case TRANSFERS: return "transfers";
+        case BYTES_IN: return "bytes_in";
+        case BYTES_WRITTEN: return "bytes_written";
+        case KEYS_CREATED: return "keys_created";
+        case KEYS_DELETED: return "keys_deleted";
+        case SEARCH_SCANNED: return "search_scanned";
+        case NUM_COUNTERS:
+        default:
+            return "unknown";
+    }
+}
+
+region_op_counter::counter_t
+region_op_counter :: classify(network_msgtype mt)
+{
+    switch (mt)
+    {
+        case REQ_GET:
+        case REQ_GET_PARTIAL:
+        case REQ_GET_BATCH:
+        case REQ_GET_RELAXED:
+        case REQ_GET_CACHED:
+        case REQ_GET_VERSIONED:
+            return READS;
+        case REQ_ATOMIC:
+        case REQ_ATOMIC_BATCH:
+        case REQ_GROUP_ATOMIC:
+            return WRITES;
+        case REQ_SEARCH_START:
+        case REQ_SEARCH_NEXT:
+        case REQ_SEARCH_STOP:
+        case REQ_SEARCH_MULTI:
+        case REQ_SORTED_SEARCH:
+        case REQ_SORTED_SEARCH_NEXT:
+        case REQ_NEAREST_SEARCH:
+        case REQ_COUNT:
+        case REQ_APPROXIMATE_COUNT:
+        case REQ_AGGREGATE:
+        case REQ_SEARCH_DESCRIBE:
+        case REQ_CHANGES_START:
+        case REQ_CHANGES_NEXT:
+        case REQ_CHANGES_STOP:
+            return SEARCHES;
+        case CHAIN_OP:
+        case CHAIN_OP_BATCH:
+        case CHAIN_SUBSPACE:
+        case CHAIN_ACK:
+        case CHAIN_ACK_BATCH:
+            return CHAIN;
+        case XFER_HS:
+        case XFER_HSA:
+        case XFER_HA:
+        case XFER_HW:
+        case XFER_OP:
+        case XFER_OP_BATCH:
+        case XFER_OP_COMPRESSED:
+        case XFER_ACK:
+            return TRANSFERS;
+        default:
+            return NUM_COUNTERS;
+    }
+}
+
+region_op_counter :: region_op_counter()
+    : m_mtx()
+    , m_vsis()
+    , m_regions()
+    , m_counts()
+    , m_counts_stride(0)
+    , m_counters()
+    , m_counters_stride(0)
+    , m_reported()
+    , m_reported_at(0)
+{
+}
+
+region_op_counter :: ~region_op_counter() throw ()
+{
+}
+
+void
+region_op_counter :: tap(const virtual_server_id& vsi)
+{
+    std::vector<std::pair<virtual_server_id, size_t> >::iterator it;
+    it = std::lower_bound(m_vsis.begin(), m_vsis.end(),
+                          std::make_pair(vsi, size_t(0)));
+
+    if (it != m_vsis.end() && it->first == vsi)
+    {
+        const size_t s = thread_stripe() % STRIPES;
+        e::atomic::increment_64_nobarrier(&m_counts[s * m_counts_stride + it->second], 1);
+    }
+}
+
+void
+region_op_counter :: tap(const virtual_server_id& vsi, network_msgtype mt, uint64_t bytes)
+{
+    std::vector<std::pair<virtual_server_id, size_t> >::iterator it;
+    it = std::lower_bound(m_vsis.begin(), m_vsis.end(),
+                          std::make_pair(vsi, size_t(0)));
+
+    if (it != m_vsis.end() && it->first == vsi)
+    {
+        const size_t s = thread_stripe() % STRIPES;
+        e::atomic::increment_64_nobarrier(&m_counts[s * m_counts_stride + it->second], 1);
+        counter_t c = classify(mt);
+
+        if (c != NUM_COUNTERS)
+        {
+            add(it->second, c, 1);
+        }
+
+        add(it->second, BYTES_IN, bytes);
+    }
+}
+
+void
+region_op_counter :: add(const region_id& ri, counter_t c, uint64_t x)
+{
+    std::vector<region_id>::iterator it;
+    it = std::lower_bound(m_regions.begin(), m_regions.end(), ri);
+
+    if (it != m_regions.end() && *it == ri)
+    {
+        add(it - m_regions.begin(), c, x);
+    }
+}
+
+void
+region_op_counter :: totals(std::vector<region_id>* rids,
+                            std::vector<uint64_t>* counters)
+{
+    po6::threads::mutex::hold hold(&m_mtx);
+    *rids = m_regions;
+    counters->resize(m_regions.size() * NUM_COUNTERS);
+
+    for (size_t i = 0; i < counters->size(); ++i)
+    {
+        (*counters)[i] = counter(i);
+    }
+}
+
+void
+region_op_counter :: reconfigure(const configuration& config, const server_id& us)
+{
+    std::vector<region_id> regions;
+    config.mapped_regions(us, &regions);
+    std::sort(regions.begin(), regions.end());
+    std::vector<std::pair<virtual_server_id, size_t> > vsis;
+    const size_t counts_stride = stride(regions.size());
+    const size_t counters_stride = stride(regions.size() * NUM_COUNTERS);
+    std::vector<uint64_t> counts(STRIPES * counts_stride, 0);
+    std::vector<uint64_t> reported(regions.size(), 0);
+    std::vector<uint64_t> counters(STRIPES * counters_stride, 0);
+
+    for (size_t i = 0; i < regions.size(); ++i)
+    {
+        vsis.push_back(std::make_pair(config.get_virtual(regions[i], us), i));
+
+        // carry the counts over so a reconfiguration does not zero the rate;
+        // the sums all go to the first stripe
+        std::vector<region_id>::iterator it;
+        it = std::lower_bound(m_regions.begin(), m_regions.end(), regions[i]);
+
+        if (it != m_regions.end() && *it == regions[i])
+        {
+            const size_t idx = it - m_regions.begin();
+            counts[i] = count(idx);
+            reported[i] = m_reported[idx];
+
+            for (size_t c = 0; c < NUM_COUNTERS; ++c)
+            {
+                counters[i * NUM_COUNTERS + c] = counter(idx * NUM_COUNTERS + c);
+            }
+        }
+    }
+
+    std::sort(vsis.begin(), vsis.end());
+    po6::threads::mutex::hold hold(&m_mtx);
+    m_vsis.swap(vsis);
+    m_regions.swap(regions);
+    m_counts.swap(counts);
+    m_counts_stride = counts_stride;
+    m_reported.swap(reported);
+    m_counters.swap(counters);
+    m_counters_stride = counters_stride;
+}
+
+void
+region_op_counter :: rates(uint64_t now, std::vector<region_id>* rids,
+                           std::vector<uint64_t>* ops)
+{
+    rids->clear();
+    ops->clear();
+    const uint64_t elapsed = now > m_reported_at ? now - m_reported_at : 0;
+
+    for (size_t i = 0; i < m_regions.size(); ++i)
+    {
+        uint64_t count = this->count(i);
+        uint64_t rate = 0;
+
+        if (m_reported_at > 0 && elapsed > 0)
+        {
+            rate = (count - m_reported[i]) * 1000000000ULL / elapsed;
+        }
+
+        rids->push_back(m_regions[i]);
+        ops->push_back(rate);
+        m_reported[i] = count;
+    }
+
+    m_reported_at = now;
+}
+
+void
+region_op_counter :: add(size_t idx, counter_t c, uint64_t x)
+{
+    assert(c < NUM_COUNTERS);
+    const size_t s = thread_stripe() % STRIPES;
+    e::atomic::increment_64_nobarrier(&m_counters[s * m_counters_stride + idx * NUM_COUNTERS + c], x);
+}
+
+uint64_t
+region_op_counter :: count(size_t idx) const
+{
+    uint64_t sum = 0;
+
+    for (size_t s = 0; s < STRIPES; ++s)
+    {
+        sum += e::atomic::load_64_nobarrier(&m_counts[s * m_counts_stride + idx]);
+    }
+
+    return sum;
+}
+
+uint64_t
+region_op_counter :: counter(size_t idx) const
+{
+    uint64_t sum = 0;
+
+    for (size_t s = 0; s < STRIPES; ++s)
+    {
+        sum += e::atomic::load_64_nobarrier(&m_counters[s * m_counters_stride + idx]);
+    }
+
+    return sum;
+}
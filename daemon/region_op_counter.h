@@ -0,0 +1,133 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_region_op_counter_h_
+#define hyperdex_daemon_region_op_counter_h_
+
+// STL
+#include <utility>
+#include <vector>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// HyperDex
+#include "namespace.h"
+#include "common/configuration.h"
+#include "common/ids.h"
+#include "common/network_msgtype.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// counts the messages each of our regions handles, for the load reports
+// the coordinator balances replica sets with, and breaks them down by kind
+// for the per-region and per-space performance counters
+class region_op_counter
+{
+    public:
+        enum counter_t
+        {
+            READS,
+            WRITES,
+            SEARCHES,
+            CHAIN,
+            TRANSFERS,
+            BYTES_IN,
+            BYTES_WRITTEN,
+            KEYS_CREATED,
+            KEYS_DELETED,
+            SEARCH_SCANNED,
+            NUM_COUNTERS
+        };
+        // the name reported for each counter
+        static const char* name(counter_t c);
+        // the counter a message of type "mt" counts against, or NUM_COUNTERS
+        static counter_t classify(network_msgtype mt);
+
+    public:
+        // each count is kept once per stripe, and summed when read
+        const static size_t STRIPES = 16;
+
+    public:
+        region_op_counter();
+        ~region_op_counter() throw ();
+
+    // concurrent methods
+    public:
+        // count one message to "vsi"; a no-op if it is not one of ours
+        void tap(const virtual_server_id& vsi);
+        // as above, while also adding one to the message's kind and its size
+        // to BYTES_IN
+        void tap(const virtual_server_id& vsi, network_msgtype mt, uint64_t bytes);
+        // add "x" to counter "c" of region "ri"; a no-op if it is not ours
+        void add(const region_id& ri, counter_t c, uint64_t x);
+        // every region's counters, NUM_COUNTERS to a region
+        void totals(std::vector<region_id>* rids,
+                    std::vector<uint64_t>* counters);
+
+    // external synchronization required; nothing can call tap
+    public:
+        void reconfigure(const configuration& config, const server_id& us);
+
+    // may run concurrently with tap, but not with itself
+    public:
+        // each region's messages per second since the last call
+        void rates(uint64_t now, std::vector<region_id>* rids,
+                   std::vector<uint64_t>* ops);
+
+    private:
+        region_op_counter(const region_op_counter&);
+        region_op_counter& operator = (const region_op_counter&);
+
+    private:
+        void add(size_t idx, counter_t c, uint64_t x);
+        uint64_t count(size_t idx) const;
+        uint64_t counter(size_t idx) const;
+        // the room one stripe of "n" counts takes, padded to a cache line
+        static size_t stride(size_t n) { return ((n + 7) & ~size_t(7)) + 8; }
+
+    private:
+        // keeps totals from seeing reconfigure half done; tap needs no lock
+        // because the daemon is paused while it reconfigures
+        po6::threads::mutex m_mtx;
+        // sorted, mapping each virtual server to its index in m_regions
+        std::vector<std::pair<virtual_server_id, size_t> > m_vsis;
+        std::vector<region_id> m_regions;
+        // STRIPES stripes of m_counts_stride, one count for each of m_regions
+        std::vector<uint64_t> m_counts;
+        size_t m_counts_stride;
+        // STRIPES stripes of m_counters_stride, NUM_COUNTERS for each of
+        // m_regions
+        std::vector<uint64_t> m_counters;
+        size_t m_counters_stride;
+        std::vector<uint64_t> m_reported;
+        uint64_t m_reported_at;
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_region_op_counter_h_
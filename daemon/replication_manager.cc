@@ -29,6 +29,8 @@
 
 // POSIX
 #include <signal.h>
+#include <time.h>
+#include <unistd.h>
 
 // STL
 #include <algorithm>
@@ -36,6 +38,9 @@
 // Google Log
 #include <glog/logging.h>
 
+// po6
+#include <po6/time.h>
+
 // HyperDex
 #include "common/datatype_info.h"
 #include "common/hash.h"
@@ -44,10 +49,69 @@
 #include "daemon/background_thread.h"
 #include "daemon/daemon.h"
 #include "daemon/replication_manager.h"
+#include "daemon/replication_manager_committer.h"
 
 using hyperdex::key_state;
 using hyperdex::reconfigure_returncode;
 using hyperdex::replication_manager;
+using po6::threads::make_obj_func;
+
+// a reconfiguration walks fewer key states than this on its own thread
+#define RECONFIGURE_PARALLEL_STATES 4096
+
+// the key states of one reconfiguration, handed out to the walking threads a
+// shard at a time
+class replication_manager::reconfigure_walk
+{
+    public:
+        reconfigure_walk(const std::vector<region_id>& unchanged,
+                         const std::vector<region_id>& resets,
+                         const std::vector<region_id>& key_regions);
+        ~reconfigure_walk() throw ();
+
+    public:
+        // the key states of an unchanged region keep their queued work, as
+        // they would had no local region changed; those of a region being
+        // transferred in or split are reset whether it changed or not
+        bool skip(const region_id& ri) const;
+
+    public:
+        const std::vector<region_id>& unchanged;
+        const std::vector<region_id>& resets;
+        const std::vector<region_id>& key_regions;
+        size_t next_shard;
+        uint64_t visited;
+        uint64_t reconfigured;
+        uint64_t reset;
+
+    private:
+        reconfigure_walk(const reconfigure_walk&);
+        reconfigure_walk& operator = (const reconfigure_walk&);
+};
+
+replication_manager :: reconfigure_walk :: reconfigure_walk(const std::vector<region_id>& u,
+                                                            const std::vector<region_id>& r,
+                                                            const std::vector<region_id>& k)
+    : unchanged(u)
+    , resets(r)
+    , key_regions(k)
+    , next_shard(0)
+    , visited(0)
+    , reconfigured(0)
+    , reset(0)
+{
+}
+
+replication_manager :: reconfigure_walk :: ~reconfigure_walk() throw ()
+{
+}
+
+bool
+replication_manager :: reconfigure_walk :: skip(const region_id& ri) const
+{
+    return std::binary_search(unchanged.begin(), unchanged.end(), ri) &&
+           !std::binary_search(resets.begin(), resets.end(), ri);
+}
 
 class replication_manager::retransmitter_thread : public hyperdex::background_thread
 {
@@ -64,9 +128,15 @@ class replication_manager::retransmitter_thread : public hyperdex::background_th
     public:
         void trigger();
 
+    private:
+        // sleep before a pass that follows up on the last one; returns false
+        // if the thread is shutting down or a pass was triggered meanwhile
+        bool rearm();
+
     public:
         replication_manager* m_rm;
         uint64_t m_trigger;
+        unsigned m_passes;
 
     private:
         retransmitter_thread(const retransmitter_thread&);
@@ -79,12 +149,23 @@ replication_manager :: replication_manager(daemon* d)
     , m_idgen()
     , m_idcol(&d->m_gc)
     , m_stable()
+    , m_nonces()
     , m_retransmitter(new retransmitter_thread(d))
+    , m_committer(new committer(this))
     , m_protect_stable_stuff()
     , m_checkpoint(0)
     , m_need_check(0)
     , m_timestamps()
     , m_unstable()
+    , m_chain_deltas(false)
+    , m_slow_op_threshold(0)
+    , m_trace_sample(0)
+    , m_traces()
+    , m_timer()
+    , m_retransmits()
+    , m_retransmit_timeouts()
+    , m_retransmits_deferred()
+    , m_early_rejects()
 {
     po6::threads::mutex::hold hold(&m_protect_stable_stuff);
     check_is_needed();
@@ -92,12 +173,26 @@ replication_manager :: replication_manager(daemon* d)
 
 replication_manager :: ~replication_manager() throw ()
 {
+    m_committer->shutdown();
     m_retransmitter->shutdown();
 }
 
 bool
-replication_manager :: setup()
+replication_manager :: setup(bool chain_deltas, uint64_t slow_op_threshold,
+                             uint64_t trace_sample, const std::string& trace_path,
+                             unsigned commit_threads)
 {
+    m_chain_deltas = chain_deltas;
+    m_slow_op_threshold = slow_op_threshold;
+
+    // a server that cannot write its spans still passes trace ids along
+    if (trace_sample > 0 && m_traces.open(trace_path))
+    {
+        LOG(INFO) << "tracing one in every " << trace_sample << " writes to " << trace_path;
+    }
+
+    m_trace_sample = trace_sample;
+    m_committer->start(commit_threads);
     m_retransmitter->start();
     return true;
 }
@@ -105,6 +200,7 @@ replication_manager :: setup()
 void
 replication_manager :: teardown()
 {
+    m_committer->shutdown();
     m_retransmitter->shutdown();
 }
 
@@ -114,6 +210,12 @@ replication_manager :: pause()
     m_retransmitter->initiate_pause();
 }
 
+void
+replication_manager :: wait_for_commits()
+{
+    m_committer->drain();
+}
+
 void
 replication_manager :: unpause()
 {
@@ -122,41 +224,66 @@ replication_manager :: unpause()
 }
 
 void
-replication_manager :: reconfigure(const configuration&,
+replication_manager :: reconfigure(const configuration& old_config,
                                    const configuration& new_config,
                                    const server_id&)
 {
+    const uint64_t start = po6::monotonic_time();
     m_retransmitter->wait_until_paused();
     m_retransmitter->trigger();
+    const uint64_t paused = po6::monotonic_time();
 
     std::vector<region_id> key_regions;
     new_config.key_regions(m_daemon->m_us, &key_regions);
     m_idgen.adopt(&key_regions[0], key_regions.size());
     m_idcol.adopt(&key_regions[0], key_regions.size());
+    m_nonces.adopt(&key_regions[0], key_regions.size());
 
-    std::vector<region_id> transfers_in_regions;
-    new_config.transfers_in_regions(m_daemon->m_us, &transfers_in_regions);
+    std::vector<region_id> resets;
+    new_config.transfers_in_regions(m_daemon->m_us, &resets);
 
-    // iterate over all key states; cleanup dead ones, and bump idgen
-    for (key_map_t::iterator it(&m_key_states); it.valid(); ++it)
+    // operations in flight against a split region may be for keys that it
+    // no longer holds
+    new_config.split_regions(old_config, m_daemon->m_us, &resets);
+    std::sort(resets.begin(), resets.end());
+
+    std::vector<region_id> unchanged;
+    new_config.unchanged_regions(old_config, m_daemon->m_us, &unchanged);
+
+    // split the walk over all key states across threads when there are
+    // enough of them to be worth it; the daemon is paused until it's done
+    uint64_t states = 0;
+    uint64_t largest_shard = 0;
+    uint64_t retries = 0;
+    key_state_stats(&states, &largest_shard, &retries);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = 1;
+
+    if (states >= RECONFIGURE_PARALLEL_STATES && cpus > 1)
     {
-        key_state* ks = *it;
-        ks->reconfigure(&m_daemon->m_gc);
-        region_id ri = ks->state_key().region;
+        threads = std::min(static_cast<size_t>(cpus), size_t(key_map_t::SHARDS));
+    }
 
-        if (std::binary_search(transfers_in_regions.begin(),
-                               transfers_in_regions.end(), ri))
-        {
-            ks->reset(&m_daemon->m_gc);
-        }
+    reconfigure_walk walk(unchanged, resets, key_regions);
+    std::vector<e::compat::shared_ptr<po6::threads::thread> > workers;
 
-        if (std::binary_search(key_regions.begin(),
-                               key_regions.end(), ri))
-        {
-            m_idgen.bump(ri, ks->max_version());
-        }
+    for (size_t i = 1; i < threads; ++i)
+    {
+        e::compat::shared_ptr<po6::threads::thread> t(
+                new po6::threads::thread(make_obj_func(&replication_manager::reconfigure_thread, this, &walk)));
+        t->start();
+        workers.push_back(t);
+    }
+
+    reconfigure_shards(&walk);
+
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        workers[i]->join();
     }
 
+    const uint64_t walked = po6::monotonic_time();
+
     // iterate over all regions on disk/lb, and bump idgen
     for (size_t i = 0; i < key_regions.size(); ++i)
     {
@@ -172,10 +299,11 @@ replication_manager :: reconfigure(const configuration&,
 
     // figure out when we're stable
     m_stable.copy_from(m_idgen);
+    const uint64_t bumped = po6::monotonic_time();
 
     // clear timestamps for regions we no longer manage
     std::vector<region_id> mapped_regions;
-    m_daemon->m_config.mapped_regions(m_daemon->m_us, &mapped_regions);
+    m_daemon->config().mapped_regions(m_daemon->m_us, &mapped_regions);
     po6::threads::mutex::hold hold(&m_protect_stable_stuff);
     reset_to_unstable();
 
@@ -193,6 +321,118 @@ replication_manager :: reconfigure(const configuration&,
             ++i;
         }
     }
+
+    const uint64_t done = po6::monotonic_time();
+    LOG(INFO) << "reconfigured " << walk.reconfigured << " of " << walk.visited
+              << " key states (" << walk.reset << " reset) on " << threads
+              << " threads: pausing the retransmitter took "
+              << (paused - start) / 1000000ULL << "ms, walking the key states took "
+              << (walked - paused) / 1000000ULL << "ms, bumping versions took "
+              << (bumped - walked) / 1000000ULL << "ms, and clearing timestamps took "
+              << (done - bumped) / 1000000ULL << "ms";
+}
+
+void
+replication_manager :: reconfigure_shards(reconfigure_walk* walk)
+{
+    uint64_t visited = 0;
+    uint64_t reconfigured = 0;
+    uint64_t reset = 0;
+
+    while (true)
+    {
+        size_t shard = __sync_fetch_and_add(&walk->next_shard, 1);
+
+        if (shard >= key_map_t::SHARDS)
+        {
+            break;
+        }
+
+        // cleanup dead key states, and bump idgen
+        for (key_map_t::iterator it(&m_key_states, shard, shard + 1); it.valid(); ++it)
+        {
+            key_state* ks = *it;
+            region_id ri = ks->state_key().region;
+            ++visited;
+
+            if (walk->skip(ri))
+            {
+                continue;
+            }
+
+            ks->reconfigure(&m_daemon->m_gc);
+            ++reconfigured;
+
+            if (std::binary_search(walk->resets.begin(),
+                                   walk->resets.end(), ri))
+            {
+                ks->reset(&m_daemon->m_gc);
+                ++reset;
+            }
+
+            if (std::binary_search(walk->key_regions.begin(),
+                                   walk->key_regions.end(), ri))
+            {
+                m_idgen.bump(ri, ks->max_version());
+            }
+        }
+    }
+
+    __sync_fetch_and_add(&walk->visited, visited);
+    __sync_fetch_and_add(&walk->reconfigured, reconfigured);
+    __sync_fetch_and_add(&walk->reset, reset);
+}
+
+void
+replication_manager :: reconfigure_thread(reconfigure_walk* walk)
+{
+    sigset_t ss;
+
+    // leave SIGPROF so that a profile sees this thread too
+    if (sigfillset(&ss) < 0 ||
+        sigdelset(&ss, SIGPROF) < 0 ||
+        pthread_sigmask(SIG_BLOCK, &ss, NULL) < 0)
+    {
+        PLOG(ERROR) << "could not block signals";
+        LOG(ERROR) << "could not successfully block signals; this could result in undefined behavior";
+    }
+
+    e::garbage_collector::thread_state ts;
+    m_daemon->m_gc.register_thread(&ts);
+    reconfigure_shards(walk);
+    m_daemon->m_gc.deregister_thread(&ts);
+}
+
+void
+replication_manager :: reconfigure_unaffected()
+{
+    m_retransmitter->trigger();
+}
+
+void
+replication_manager :: retransmit_stats(uint64_t* sent, uint64_t* timeouts, uint64_t* deferred)
+{
+    *sent = m_retransmits.read();
+    *timeouts = m_retransmit_timeouts.read();
+    *deferred = m_retransmits_deferred.read();
+}
+
+void
+replication_manager :: key_state_stats(uint64_t* states, uint64_t* largest_shard, uint64_t* retries)
+{
+    std::vector<uint64_t> sizes;
+    std::vector<uint64_t> shard_retries;
+    m_key_states.shard_stats(&sizes, &shard_retries);
+    *states = 0;
+    *largest_shard = 0;
+    *retries = 0;
+
+    for (size_t i = 0; i < sizes.size(); ++i)
+    {
+        *states += sizes[i];
+        *largest_shard = std::max(*largest_shard, sizes[i]);
+        *retries += shard_retries[i];
+    }
 }
 
 void
@@ -201,7 +441,7 @@ replication_manager :: debug_dump()
     m_retransmitter->initiate_pause();
     m_retransmitter->wait_until_paused();
     std::vector<region_id> regions;
-    m_daemon->m_config.key_regions(m_daemon->m_us, &regions);
+    m_daemon->config().key_regions(m_daemon->m_us, &regions);
 
     // print counters
     LOG(INFO) << "region counters ===============================================================";
@@ -224,6 +464,10 @@ replication_manager :: debug_dump()
         ks->debug_dump();
     }
 
+    // print allocation pools
+    LOG(INFO) << "allocation pools ==============================================================";
+    key_state::debug_dump_pools();
+
     m_retransmitter->unpause();
     m_retransmitter->trigger();
 }
@@ -235,10 +479,10 @@ replication_manager :: client_atomic(const server_id& from,
                                      std::auto_ptr<key_change> kc,
                                      std::auto_ptr<e::buffer> backing)
 {
-    const region_id ri(m_daemon->m_config.get_region_id(to));
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
+    const region_id ri(m_daemon->config().get_region_id(to));
+    const schema& sc(*m_daemon->config().get_schema(ri));
 
-    if (m_daemon->m_config.read_only())
+    if (m_daemon->config().read_only() || sc.immutable)
     {
         respond_to_client(to, from, nonce, NET_READONLY);
         return;
@@ -252,7 +496,7 @@ replication_manager :: client_atomic(const server_id& from,
         return;
     }
 
-    if (m_daemon->m_config.point_leader(ri, kc->key) != to)
+    if (m_daemon->config().point_leader(ri, kc->key) != to)
     {
         LOG(ERROR) << "dropping nonce=" << nonce << " from client=" << from
                    << " because it doesn't map to " << ri;
@@ -260,6 +504,27 @@ replication_manager :: client_atomic(const server_id& from,
         return;
     }
 
+    // a client retrying an op sends the nonce it used the first time
+    if (from != m_daemon->m_us)
+    {
+        network_returncode ret = NET_SUCCESS;
+
+        switch (m_nonces.check_and_mark(ri, from, nonce, po6::time(), &ret))
+        {
+            case nonce_table::NONCE_UNSEEN:
+                break;
+            case nonce_table::NONCE_PENDING:
+                // the first copy will be answered when it completes
+                return;
+            case nonce_table::NONCE_COMPLETED:
+                respond_to_client(to, from, nonce, ret);
+                return;
+            default:
+                abort();
+        }
+    }
+
+    m_daemon->m_hot_keys.touch(ri, kc->key);
     key_map_t::state_reference ksr;
     key_state* ks = get_or_create_key_state(ri, kc->key, &ksr);
     ks->enqueue_client_atomic(this, to, sc, from, nonce, kc, backing);
@@ -274,14 +539,17 @@ replication_manager :: chain_op(const virtual_server_id& from,
                                 bool has_value,
                                 const e::slice& key,
                                 const std::vector<e::slice>& value,
-                                std::auto_ptr<e::buffer> backing)
+                                const e::slice& delta,
+                                std::auto_ptr<e::buffer> backing,
+                                uint64_t trace_id)
 {
-    const region_id ri(m_daemon->m_config.get_region_id(to));
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
-    bool valid = sc.attrs_sz == value.size() + 1 &&
+    const region_id ri(m_daemon->config().get_region_id(to));
+    const schema& sc(*m_daemon->config().get_schema(ri));
+    // a delta's funcs are checked when it is applied
+    bool valid = (!delta.empty() || sc.attrs_sz == value.size() + 1) &&
                  datatype_info::lookup(sc.attrs[0].type)->validate(key);
 
-    if (has_value)
+    if (has_value && delta.empty())
     {
         valid = valid && sc.attrs_sz == value.size() + 1;
 
@@ -299,7 +567,7 @@ replication_manager :: chain_op(const virtual_server_id& from,
 
     key_map_t::state_reference ksr;
     key_state* ks = get_or_create_key_state(ri, key, &ksr);
-    ks->enqueue_chain_op(this, to, sc, from, old_version, new_version, fresh, has_value, value, backing);
+    ks->enqueue_chain_op(this, to, sc, from, old_version, new_version, fresh, has_value, value, delta, backing, trace_id);
 }
 
 void
@@ -313,10 +581,11 @@ replication_manager :: chain_subspace(const virtual_server_id& from,
                                       const region_id& prev_region,
                                       const region_id& this_old_region,
                                       const region_id& this_new_region,
-                                      const region_id& next_region)
+                                      const region_id& next_region,
+                                      uint64_t trace_id)
 {
-    const region_id ri(m_daemon->m_config.get_region_id(to));
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
+    const region_id ri(m_daemon->config().get_region_id(to));
+    const schema& sc(*m_daemon->config().get_schema(ri));
     bool valid = sc.attrs_sz == value.size() + 1 &&
                  datatype_info::lookup(sc.attrs[0].type)->validate(key);
 
@@ -334,7 +603,8 @@ replication_manager :: chain_subspace(const virtual_server_id& from,
     key_map_t::state_reference ksr;
     key_state* ks = get_or_create_key_state(ri, key, &ksr);
     ks->enqueue_chain_subspace(this, to, sc, from, old_version, new_version, value, backing,
-                               prev_region, this_old_region, this_new_region, next_region);
+                               prev_region, this_old_region, this_new_region, next_region,
+                               trace_id);
 }
 
 void
@@ -343,8 +613,8 @@ replication_manager :: chain_ack(const virtual_server_id& from,
                                  uint64_t version,
                                  const e::slice& key)
 {
-    const region_id ri(m_daemon->m_config.get_region_id(to));
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
+    const region_id ri(m_daemon->config().get_region_id(to));
+    const schema& sc(*m_daemon->config().get_schema(ri));
     key_map_t::state_reference ksr;
     key_state* ks = get_key_state(ri, key, &ksr);
 
@@ -364,23 +634,30 @@ replication_manager :: begin_checkpoint(uint64_t checkpoint_num)
 {
     m_retransmitter->initiate_pause();
     m_retransmitter->wait_until_paused();
-    std::string timestamp = m_daemon->m_data.get_timestamp();
 
     {
         std::vector<region_id> mapped_regions;
-        m_daemon->m_config.mapped_regions(m_daemon->m_us, &mapped_regions);
+        m_daemon->config().mapped_regions(m_daemon->m_us, &mapped_regions);
+        // each region's timestamp comes from the LevelDB instance holding it
+        std::vector<std::string> timestamps;
+
+        for (size_t i = 0; i < mapped_regions.size(); ++i)
+        {
+            timestamps.push_back(m_daemon->m_data.get_timestamp(mapped_regions[i]));
+        }
+
         po6::threads::mutex::hold hold(&m_protect_stable_stuff);
         m_checkpoint = std::max(m_checkpoint, checkpoint_num);
         reset_to_unstable();
 
         for (size_t i = 0; i < mapped_regions.size(); ++i)
         {
-            m_timestamps.push_back(region_timestamp(mapped_regions[i], checkpoint_num, timestamp));
+            m_timestamps.push_back(region_timestamp(mapped_regions[i], checkpoint_num, timestamps[i]));
         }
     }
 
     std::vector<region_id> key_regions;
-    m_daemon->m_config.key_regions(m_daemon->m_us, &key_regions);
+    m_daemon->config().key_regions(m_daemon->m_us, &key_regions);
 
     for (size_t i = 0; i < key_regions.size(); ++i)
     {
@@ -425,6 +702,30 @@ replication_manager :: end_checkpoint(uint64_t checkpoint_num)
     m_retransmitter->trigger();
 }
 
+bool
+replication_manager :: pending_writes(const region_id& ri, const e::slice& key,
+                                      uint64_t* pending, std::auto_ptr<key_state::waiter>* w)
+{
+    // look without creating or initializing; no state means no writes
+    key_region kr(ri, key);
+    key_map_t::state_reference ksr;
+    key_state* ks = m_key_states.get_state(kr, &ksr);
+
+    if (!ks)
+    {
+        *pending = 0;
+        return true;
+    }
+
+    return ks->pending_writes(pending, w);
+}
+
+uint64_t
+replication_manager :: versions_handed_out(const region_id& ri)
+{
+    return m_idgen.handed_out(ri);
+}
+
 key_state*
 replication_manager :: get_key_state(const region_id& ri,
                                      const e::slice& key,
@@ -453,7 +754,7 @@ replication_manager :: post_get_key_state_init(region_id ri, key_state* ks)
         return ks;
     }
 
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
+    const schema& sc(*m_daemon->config().get_schema(ri));
 
     switch (ks->initialize(&m_daemon->m_data, sc, ri))
     {
@@ -489,21 +790,49 @@ bool
 replication_manager :: send_message(const virtual_server_id& us,
                                     const e::slice& key,
                                     e::intrusive_ptr<key_operation> op)
+{
+    return send_message(us, key, op, false, NULL);
+}
+
+bool
+replication_manager :: resend_message(const virtual_server_id& us,
+                                      const e::slice& key,
+                                      e::intrusive_ptr<key_operation> op,
+                                      bool* deferred)
+{
+    return send_message(us, key, op, true, deferred);
+}
+
+void
+replication_manager :: check_peer_lease(const server_id& peer, uint64_t sent_at, uint64_t now)
+{
+    if (m_daemon->m_comm.peer_silent(peer, sent_at, now))
+    {
+        m_daemon->m_coord->report_tcp_disconnect(m_daemon->config().version(), peer);
+    }
+}
+
+bool
+replication_manager :: send_message(const virtual_server_id& us,
+                                    const e::slice& key,
+                                    e::intrusive_ptr<key_operation> op,
+                                    bool retransmission,
+                                    bool* deferred)
 {
     // If we've sent it somewhere, we shouldn't resend.  If the sender intends a
     // resend, they should clear "sent" first.
     assert(op->sent_to() == virtual_server_id());
-    region_id ri(m_daemon->m_config.get_region_id(us));
+    region_id ri(m_daemon->config().get_region_id(us));
 
     // If there's an ongoing transfer, don't actually send
-    if (m_daemon->m_config.is_server_blocked_by_live_transfer(m_daemon->m_us, ri))
+    if (m_daemon->config().is_server_blocked_by_live_transfer(m_daemon->m_us, ri))
     {
         return false;
     }
 
     // facts we use to decide what to do
     assert(ri == op->this_old_region() || ri == op->this_new_region());
-    bool last_in_chain = m_daemon->m_config.tail_of_region(ri) == us;
+    bool last_in_chain = m_daemon->config().tail_of_region(ri) == us;
     bool has_next_subspace = op->next_region() != region_id();
 
     // variables we fill in to determine the message type/destination
@@ -516,7 +845,7 @@ replication_manager :: send_message(const virtual_server_id& us,
         {
             if (has_next_subspace)
             {
-                dest = m_daemon->m_config.head_of_region(op->next_region());
+                dest = m_daemon->config().head_of_region(op->next_region());
                 type = CHAIN_OP;
             }
             else
@@ -524,15 +853,17 @@ replication_manager :: send_message(const virtual_server_id& us,
                 if (!op->ackable())
                 {
                     op->mark_acked();
+                    op->stamp(key_operation::ACKED, op->timed() ? po6::monotonic_time() : 0);
                     collect(ri, op);
                 }
 
-                return send_ack(us, key, op);
+                // durable spaces ack once the op is on disk; see drain_committable
+                return acks_wait_for_disk(ri) || send_ack(us, key, op);
             }
         }
         else
         {
-            dest = m_daemon->m_config.next_in_region(us);
+            dest = m_daemon->config().next_in_region(us);
             type = CHAIN_OP;
         }
     }
@@ -541,12 +872,12 @@ replication_manager :: send_message(const virtual_server_id& us,
         if (last_in_chain)
         {
             assert(op->has_value());
-            dest = m_daemon->m_config.head_of_region(op->this_new_region());
+            dest = m_daemon->config().head_of_region(op->this_new_region());
             type = CHAIN_SUBSPACE;
         }
         else
         {
-            dest = m_daemon->m_config.next_in_region(us);
+            dest = m_daemon->config().next_in_region(us);
             type = CHAIN_OP;
         }
     }
@@ -556,7 +887,7 @@ replication_manager :: send_message(const virtual_server_id& us,
         {
             if (has_next_subspace)
             {
-                dest = m_daemon->m_config.head_of_region(op->next_region());
+                dest = m_daemon->config().head_of_region(op->next_region());
                 type = CHAIN_OP;
             }
             else
@@ -564,16 +895,18 @@ replication_manager :: send_message(const virtual_server_id& us,
                 if (!op->ackable())
                 {
                     op->mark_acked();
+                    op->stamp(key_operation::ACKED, op->timed() ? po6::monotonic_time() : 0);
                     collect(ri, op);
                 }
 
-                return send_ack(us, key, op);
+                // durable spaces ack once the op is on disk; see drain_committable
+                return acks_wait_for_disk(ri) || send_ack(us, key, op);
             }
         }
         else
         {
             assert(op->has_value());
-            dest = m_daemon->m_config.next_in_region(us);
+            dest = m_daemon->config().next_in_region(us);
             type = CHAIN_SUBSPACE;
         }
     }
@@ -582,22 +915,58 @@ replication_manager :: send_message(const virtual_server_id& us,
         abort();
     }
 
+    const uint64_t now = po6::monotonic_time();
+
+    if (retransmission)
+    {
+        if (!m_timer.admit(m_daemon->config().get_server_id(dest), now))
+        {
+            m_retransmits_deferred.tap();
+            *deferred = true;
+            return false;
+        }
+
+        op->count_retransmit();
+        m_retransmits.tap();
+    }
+
     std::auto_ptr<e::buffer> msg;
 
     if (type == CHAIN_OP)
     {
+        // the delta stands in for the value only when it saves space
+        e::slice delta(op->delta().data(), op->delta().size());
+        bool use_delta = m_chain_deltas && op->has_value() &&
+                         !delta.empty() && pack_size(delta) < pack_size(op->value());
         uint8_t flags = (op->is_fresh() ? 1 : 0)
-                      | (op->has_value() ? 2 : 0);
+                      | (op->has_value() ? 2 : 0)
+                      | (use_delta ? 4 : 0);
         size_t sz = HYPERDEX_HEADER_SIZE_VV
                   + sizeof(uint8_t)
                   + sizeof(uint64_t)
                   + sizeof(uint64_t)
                   + pack_size(key)
-                  + pack_size(op->value());
+                  + (use_delta ? pack_size(delta) : pack_size(op->value()))
+                  + (op->trace_id() ? sizeof(uint64_t) : 0);
         msg.reset(e::buffer::create(sz));
-        msg->pack_at(HYPERDEX_HEADER_SIZE_VV)
+        e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VV)
             << flags << op->prev_version() << op->this_version()
-            << key << op->value();
+            << key;
+
+        if (use_delta)
+        {
+            pa = pa << delta;
+        }
+        else
+        {
+            pa = pa << op->value();
+        }
+
+        // daemons that predate tracing stop reading before the trace id
+        if (op->trace_id())
+        {
+            pa = pa << op->trace_id();
+        }
     }
     else if (type == CHAIN_SUBSPACE)
     {
@@ -609,31 +978,66 @@ replication_manager :: send_message(const virtual_server_id& us,
                   + pack_size(op->prev_region())
                   + pack_size(op->this_old_region())
                   + pack_size(op->this_new_region())
-                  + pack_size(op->next_region());
+                  + pack_size(op->next_region())
+                  + (op->trace_id() ? sizeof(uint64_t) : 0);
         msg.reset(e::buffer::create(sz));
-        msg->pack_at(HYPERDEX_HEADER_SIZE_VV)
+        e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VV)
             << op->prev_version() << op->this_version()
             << key << op->value()
             << op->prev_region()
             << op->this_old_region()
             << op->this_new_region()
             << op->next_region();
+
+        if (op->trace_id())
+        {
+            pa = pa << op->trace_id();
+        }
     }
     else
     {
         abort();
     }
 
-    op->set_sent(m_daemon->m_config.version(), dest);
+    op->set_sent(m_daemon->config().version(), dest);
+    op->set_sent_at(now);
+    op->stamp(key_operation::SENT, now);
+
+    if (type == CHAIN_OP)
+    {
+        return m_daemon->m_comm.send_chain_op(us, dest, msg);
+    }
+
     return m_daemon->m_comm.send_exact(us, dest, type, msg);
 }
 
+bool
+replication_manager :: acks_wait_for_disk(const region_id& ri)
+{
+    const schema* sc = m_daemon->config().get_schema(ri);
+    return sc && (sc->durability == DURABILITY_SYNC ||
+                  sc->durability == DURABILITY_GROUP);
+}
+
+uint64_t
+replication_manager :: trace_id(const region_id& ri, uint64_t version)
+{
+    if (m_trace_sample == 0 || version % m_trace_sample != 0)
+    {
+        return 0;
+    }
+
+    // a version is unique within its region, so the pair names the op
+    uint64_t id = (ri.get() * 0x9e3779b97f4a7c15ULL) ^ version;
+    return id != 0 ? id : 1;
+}
+
 bool
 replication_manager :: send_ack(const virtual_server_id& us,
                                 const e::slice& key,
                                 e::intrusive_ptr<key_operation> op)
 {
-    if (!op->ackable() || !op->recv_from(m_daemon->m_config.version()))
+    if (!op->ackable() || !op->recv_from(m_daemon->config().version()))
     {
         return false;
     }
@@ -641,13 +1045,15 @@ replication_manager :: send_ack(const virtual_server_id& us,
     size_t sz = HYPERDEX_HEADER_SIZE_VV + sizeof(uint64_t) + pack_size(key);
     std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
     msg->pack_at(HYPERDEX_HEADER_SIZE_VV) << op->this_version() << key;
-    return m_daemon->m_comm.send_exact(us, op->recv_from(), CHAIN_ACK, msg);
+    return m_daemon->m_comm.send_chain_ack(us, op->recv_from(), msg);
 }
 
-void
+bool
 replication_manager :: retransmit(const std::vector<region_id>& point_leaders,
                                   std::vector<std::pair<region_id, uint64_t> >* versions)
 {
+    bool again = false;
+
     for (key_map_t::iterator it(&m_key_states); it.valid(); ++it)
     {
         key_state* ks = *it;
@@ -659,12 +1065,12 @@ replication_manager :: retransmit(const std::vector<region_id>& point_leaders,
             ks->append_all_versions(versions);
         }
 
-        if (m_daemon->m_config.is_server_blocked_by_live_transfer(m_daemon->m_us, ri))
+        if (m_daemon->config().is_server_blocked_by_live_transfer(m_daemon->m_us, ri))
         {
             continue;
         }
 
-        virtual_server_id us = m_daemon->m_config.get_virtual(ri, m_daemon->m_us);
+        virtual_server_id us = m_daemon->config().get_virtual(ri, m_daemon->m_us);
 
         if (us == virtual_server_id() || ks->finished())
         {
@@ -672,12 +1078,13 @@ replication_manager :: retransmit(const std::vector<region_id>& point_leaders,
             continue;
         }
 
-        const schema& sc(*m_daemon->m_config.get_schema(ri));
-        ks->resend_committable(this, us);
+        const schema& sc(*m_daemon->config().get_schema(ri));
+        again = ks->resend_committable(this, us) || again;
         ks->work_state_machine(this, us, sc);
     }
 
     m_daemon->m_comm.wake_one();
+    return again;
 }
 
 void
@@ -761,7 +1168,7 @@ void
 replication_manager :: reset_to_unstable()
 {
     m_unstable.clear();
-    m_daemon->m_config.point_leaders(m_daemon->m_us, &m_unstable);
+    m_daemon->config().point_leaders(m_daemon->m_us, &m_unstable);
     check_is_needed();
     m_retransmitter->trigger();
 }
@@ -786,7 +1193,7 @@ replication_manager :: check_stable()
 
     if (tell_coord_stable)
     {
-        m_daemon->m_coord->config_stable(m_daemon->m_config.version());
+        m_daemon->m_coord->config_stable(m_daemon->config().version());
         m_daemon->m_coord->checkpoint_report_stable(checkpoint);
     }
 }
@@ -834,7 +1241,7 @@ replication_manager :: check_stable(const region_id& ri)
 
     if (tell_coord_stable)
     {
-        m_daemon->m_coord->config_stable(m_daemon->m_config.version());
+        m_daemon->m_coord->config_stable(m_daemon->config().version());
         m_daemon->m_coord->checkpoint_report_stable(checkpoint);
     }
 }
@@ -843,6 +1250,7 @@ replication_manager :: retransmitter_thread :: retransmitter_thread(daemon* d)
     : background_thread(d)
     , m_rm(&d->m_repl)
     , m_trigger(0)
+    , m_passes(0)
 {
 }
 
@@ -868,7 +1276,7 @@ replication_manager :: retransmitter_thread :: do_work()
 {
     // get the list of point leaders
     std::vector<region_id> point_leaders;
-    m_rm->m_daemon->m_config.point_leaders(m_rm->m_daemon->m_us, &point_leaders);
+    m_rm->m_daemon->config().point_leaders(m_rm->m_daemon->m_us, &point_leaders);
     std::sort(point_leaders.begin(), point_leaders.end());
 
     // peek at the next-to-generate values of m_idgen
@@ -877,7 +1285,7 @@ replication_manager :: retransmitter_thread :: do_work()
     std::vector<std::pair<region_id, uint64_t> > versions;
 
     // retransmit everything
-    m_rm->retransmit(point_leaders, &versions);
+    bool again = m_rm->retransmit(point_leaders, &versions);
 
     // now close all gaps
     m_rm->close_gaps(point_leaders, peeked_values, &versions);
@@ -889,6 +1297,18 @@ replication_manager :: retransmitter_thread :: do_work()
 
     m_rm->check_stable();
     m_rm->m_daemon->m_comm.wake_one();
+
+    // follow up on whatever the pacing put off or is still unacknowledged,
+    // waiting longer each time the follow up finds more to do
+    if (!again)
+    {
+        m_passes = 0;
+    }
+    else if (rearm())
+    {
+        ++m_passes;
+        trigger();
+    }
 }
 
 void
@@ -899,3 +1319,36 @@ replication_manager :: retransmitter_thread :: trigger()
     this->wakeup();
     this->unlock();
 }
+
+bool
+replication_manager :: retransmitter_thread :: rearm()
+{
+    const uint64_t start = po6::monotonic_time();
+    const uint64_t wait = retransmit_timer::backoff(m_passes, start);
+    bool ret = true;
+
+    // offline so that pausing the thread need not wait out the sleep
+    this->offline();
+
+    while (true)
+    {
+        this->lock();
+        bool stop = this->is_shutdown() || m_trigger > 0;
+        ret = !stop;
+        this->unlock();
+        uint64_t now = po6::monotonic_time();
+
+        if (stop || now - start >= wait)
+        {
+            break;
+        }
+
+        timespec ts;
+        ts.tv_sec = 0;
+        ts.tv_nsec = std::min(wait - (now - start), uint64_t(50000000ULL));
+        nanosleep(&ts, NULL);
+    }
+
+    this->online();
+    return ret;
+}
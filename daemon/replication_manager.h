@@ -30,6 +30,7 @@
 
 // STL
 #include <list>
+#include <string>
 
 // po6
 #include <po6/threads/cond.h>
@@ -55,9 +56,13 @@
 #include "daemon/key_operation.h"
 #include "daemon/key_region.h"
 #include "daemon/key_state.h"
+#include "daemon/nonce_table.h"
+#include "daemon/performance_counter.h"
 #include "daemon/reconfigure_returncode.h"
 #include "daemon/region_timestamp.h"
+#include "daemon/retransmit_timer.h"
 #include "daemon/state_hash_table.h"
+#include "daemon/trace_sink.h"
 
 BEGIN_HYPERDEX_NAMESPACE
 class daemon;
@@ -71,14 +76,47 @@ class replication_manager
 
     // Reconfigure this layer.
     public:
-        bool setup();
+        // "chain_deltas" sends the funcs of an atomic down the chain in place
+        // of the value they make when they are the smaller of the two;
+        // client ops that take "slow_op_threshold" nanoseconds or more from
+        // arrival to commit are logged with the time spent in each stage
+        // (0 disables timing them); one in every "trace_sample" client ops
+        // is traced down the chain, each server appending its span of the op
+        // to "trace_path" (0 traces none); "commit_threads" write committed
+        // ops to disk for the network threads (0 writes them inline)
+        bool setup(bool chain_deltas, uint64_t slow_op_threshold,
+                   uint64_t trace_sample, const std::string& trace_path,
+                   unsigned commit_threads);
         void teardown();
         void pause();
+        // wait for the writes the commit threads hold to reach the disk; call
+        // once the network threads are paused, so that nothing writes until
+        // the daemon unpauses
+        void wait_for_commits();
         void unpause();
         void reconfigure(const configuration& old_config,
                          const configuration& new_config,
                          const server_id& us);
+        // the new configuration left our regions alone; nothing changes
+        // hands, but messages in flight went out under the old version
+        void reconfigure_unaffected();
         void debug_dump();
+        // writes to the key this server knows of but has yet to apply; false
+        // while its state machine runs, as for key_state::pending_writes
+        bool pending_writes(const region_id& ri, const e::slice& key,
+                            uint64_t* pending, std::auto_ptr<key_state::waiter>* w);
+        // a count that moves each time this server sequences a write for the
+        // region; cheap enough for every read, as it leaves leases alone
+        uint64_t versions_handed_out(const region_id& ri);
+        // ops retransmitted, those among them that timed out within a
+        // configuration, and retransmissions the pacing put off
+        void retransmit_stats(uint64_t* sent, uint64_t* timeouts, uint64_t* deferred);
+        // key states held, the most any one shard of the table holds, and
+        // lookups that raced a state's creation or retirement
+        void key_state_stats(uint64_t* states, uint64_t* largest_shard, uint64_t* retries);
+        // conditional writes that failed against the committed value as well
+        // as the pending ones, and were answered without waiting for them
+        uint64_t early_rejects() { return m_early_rejects.read(); }
 
     // Network workers call these methods.
     public:
@@ -98,7 +136,9 @@ class replication_manager
                       bool has_value,
                       const e::slice& key,
                       const std::vector<e::slice>& value,
-                      std::auto_ptr<e::buffer> backing);
+                      const e::slice& delta,
+                      std::auto_ptr<e::buffer> backing,
+                      uint64_t trace_id);
         void chain_subspace(const virtual_server_id& from,
                             const virtual_server_id& to,
                             uint64_t old_version,
@@ -109,7 +149,8 @@ class replication_manager
                             const region_id& prev_region,
                             const region_id& this_old_region,
                             const region_id& this_new_region,
-                            const region_id& next_region);
+                            const region_id& next_region,
+                            uint64_t trace_id);
         void chain_ack(const virtual_server_id& from,
                        const virtual_server_id& to,
                        uint64_t version,
@@ -119,6 +160,8 @@ class replication_manager
 
     private:
         class retransmitter_thread;
+        class committer;
+        class reconfigure_walk;
         typedef state_hash_table<key_region, key_state> key_map_t;
         friend class key_state;
 
@@ -142,16 +185,42 @@ class replication_manager
         bool send_message(const virtual_server_id& us,
                           const e::slice& key,
                           e::intrusive_ptr<key_operation> op);
+        // send an op again; retransmissions are paced per destination and
+        // "*deferred" is set when the pacing holds this one back
+        bool resend_message(const virtual_server_id& us,
+                            const e::slice& key,
+                            e::intrusive_ptr<key_operation> op,
+                            bool* deferred);
+        // report "peer" to the coordinator if it has let its lease run out
+        // since we sent it an op at "sent_at"
+        void check_peer_lease(const server_id& peer, uint64_t sent_at, uint64_t now);
+        bool send_message(const virtual_server_id& us,
+                          const e::slice& key,
+                          e::intrusive_ptr<key_operation> op,
+                          bool retransmission,
+                          bool* deferred);
         bool send_ack(const virtual_server_id& us,
                       const e::slice& key,
                       e::intrusive_ptr<key_operation> op);
-        void retransmit(const std::vector<region_id>& point_leaders,
+        // spaces that fsync their writes hold each ack until the op it
+        // acknowledges is on this server's disk
+        bool acks_wait_for_disk(const region_id& ri);
+        // returns true when some op is left for a later pass to resend
+        bool retransmit(const std::vector<region_id>& point_leaders,
                         std::vector<std::pair<region_id, uint64_t> >* versions);
         void collect(const region_id& ri, e::intrusive_ptr<key_operation> op);
+        // the trace id of the client op that takes "version" in "ri", or 0
+        // if it is not one of the sampled ones
+        uint64_t trace_id(const region_id& ri, uint64_t version);
         void collect(const region_id& ri, uint64_t version);
         void close_gaps(const std::vector<region_id>& point_leaders,
                         const identifier_generator& peek_ids,
                         std::vector<std::pair<region_id, uint64_t> >* versions);
+        // reconfigure the key states of each shard "walk" hands out until
+        // none remain; reconfigure runs one of these on its own thread and
+        // the rest on threads of their own
+        void reconfigure_shards(reconfigure_walk* walk);
+        void reconfigure_thread(reconfigure_walk* walk);
         // call reset_to_unstable holding m_protect_stable_stuff
         void reset_to_unstable();
         bool is_check_needed() { return e::atomic::compare_and_swap_32_nobarrier(&m_need_check, 0, 0) == 1; }
@@ -166,12 +235,23 @@ class replication_manager
         identifier_generator m_idgen;
         identifier_collector m_idcol;
         identifier_generator m_stable;
+        nonce_table m_nonces;
         const std::auto_ptr<retransmitter_thread> m_retransmitter;
+        const std::auto_ptr<committer> m_committer;
         po6::threads::mutex m_protect_stable_stuff;
         uint64_t m_checkpoint;
         uint32_t m_need_check;
         std::vector<region_timestamp> m_timestamps;
         std::vector<region_id> m_unstable;
+        bool m_chain_deltas;
+        uint64_t m_slow_op_threshold;
+        uint64_t m_trace_sample;
+        trace_sink m_traces;
+        retransmit_timer m_timer;
+        performance_counter m_retransmits;
+        performance_counter m_retransmit_timeouts;
+        performance_counter m_retransmits_deferred;
+        performance_counter m_early_rejects;
 
     private:
         replication_manager(const replication_manager&);
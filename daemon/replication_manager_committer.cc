@@ -0,0 +1,184 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// POSIX
+#include <signal.h>
+
+// Google Log
+#include <glog/logging.h>
+
+// HyperDex
+#include "daemon/daemon.h"
+#include "daemon/replication_manager_committer.h"
+
+using po6::threads::make_obj_func;
+using hyperdex::replication_manager;
+
+replication_manager :: committer :: committer(replication_manager* rm)
+    : m_rm(rm)
+    , m_threads()
+    , m_enabled(false)
+    , m_protect()
+    , m_work(&m_protect)
+    , m_idle(&m_protect)
+    , m_queue()
+    , m_busy(0)
+    , m_shutdown(false)
+{
+}
+
+replication_manager :: committer :: ~committer() throw ()
+{
+    shutdown();
+}
+
+void
+replication_manager :: committer :: start(unsigned threads)
+{
+    po6::threads::mutex::hold hold(&m_protect);
+    m_shutdown = false;
+
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        e::compat::shared_ptr<po6::threads::thread> t(
+                new po6::threads::thread(make_obj_func(&committer::run, this)));
+        t->start();
+        m_threads.push_back(t);
+    }
+
+    m_enabled = !m_threads.empty();
+}
+
+void
+replication_manager :: committer :: shutdown()
+{
+    std::vector<e::compat::shared_ptr<po6::threads::thread> > threads;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect);
+        m_enabled = false;
+        m_shutdown = true;
+        m_work.broadcast();
+        threads.swap(m_threads);
+    }
+
+    for (size_t i = 0; i < threads.size(); ++i)
+    {
+        threads[i]->join();
+    }
+}
+
+void
+replication_manager :: committer :: enqueue(const key_region& kr)
+{
+    po6::threads::mutex::hold hold(&m_protect);
+    m_queue.push_back(kr);
+    m_work.signal();
+}
+
+void
+replication_manager :: committer :: drain()
+{
+    po6::threads::mutex::hold hold(&m_protect);
+
+    while (!m_queue.empty() || m_busy > 0)
+    {
+        m_idle.wait();
+    }
+}
+
+void
+replication_manager :: committer :: run()
+{
+    sigset_t ss;
+
+    // leave SIGPROF so that a profile sees this thread too
+    if (sigfillset(&ss) < 0 ||
+        sigdelset(&ss, SIGPROF) < 0 ||
+        pthread_sigmask(SIG_BLOCK, &ss, NULL) < 0)
+    {
+        PLOG(ERROR) << "could not block signals";
+        LOG(ERROR) << "could not successfully block signals; this could result in undefined behavior";
+    }
+
+    m_rm->m_daemon->m_placement.place_background_thread("commit");
+    e::garbage_collector* gc = &m_rm->m_daemon->m_gc;
+    e::garbage_collector::thread_state ts;
+    gc->register_thread(&ts);
+    m_protect.lock();
+
+    while (true)
+    {
+        // a shutdown still finishes the writes handed over before it
+        while (m_queue.empty() && !m_shutdown)
+        {
+            gc->offline(&ts);
+            m_work.wait();
+            gc->online(&ts);
+        }
+
+        if (m_queue.empty())
+        {
+            break;
+        }
+
+        key_region kr(m_queue.front());
+        m_queue.pop_front();
+        ++m_busy;
+        m_protect.unlock();
+
+        {
+            // the state cannot retire while its write is out, and releasing
+            // this reference retires it if the write left it finished
+            key_map_t::state_reference ksr;
+            key_state* ks = m_rm->m_key_states.get_state(kr, &ksr);
+
+            if (ks)
+            {
+                ks->commit(m_rm);
+            }
+            else
+            {
+                LOG(ERROR) << "dropping a write for " << kr.region
+                           << " because its key state went away";
+            }
+        }
+
+        gc->quiescent_state(&ts);
+        m_protect.lock();
+        --m_busy;
+
+        if (m_queue.empty() && m_busy == 0)
+        {
+            m_idle.broadcast();
+        }
+    }
+
+    m_protect.unlock();
+    gc->deregister_thread(&ts);
+}
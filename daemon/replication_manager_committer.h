@@ -0,0 +1,92 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_replication_manager_committer_h_
+#define hyperdex_daemon_replication_manager_committer_h_
+
+// STL
+#include <list>
+#include <vector>
+
+// po6
+#include <po6/threads/cond.h>
+#include <po6/threads/mutex.h>
+#include <po6/threads/thread.h>
+
+// e
+#include <e/compat.h>
+
+// HyperDex
+#include "daemon/key_region.h"
+#include "daemon/replication_manager.h"
+
+// Writes committed ops to disk off the network threads, so that a slow
+// LevelDB write holds up only the key it is for.  A key state hands over at
+// most one write at a time; the commit thread that finishes it works the
+// key's state machine to send the acks the write was holding back, and to
+// hand over the next write if one has built up meanwhile.  With no threads,
+// key states write inline.
+class hyperdex::replication_manager::committer
+{
+    public:
+        committer(replication_manager* rm);
+        ~committer() throw ();
+
+    public:
+        void start(unsigned threads);
+        // finishes the writes already handed over before returning
+        void shutdown();
+        // whether key states should hand their writes over
+        bool enabled() const { return m_enabled; }
+        // write the commit the key state for "kr" has set up
+        void enqueue(const key_region& kr);
+        // wait for every write handed over, and those they led to, to finish;
+        // call once nothing else can hand over writes
+        void drain();
+
+    private:
+        void run();
+
+    private:
+        replication_manager* m_rm;
+        std::vector<e::compat::shared_ptr<po6::threads::thread> > m_threads;
+        bool m_enabled;
+        po6::threads::mutex m_protect;
+        po6::threads::cond m_work;
+        po6::threads::cond m_idle;
+        std::list<key_region> m_queue;
+        // writes taken off m_queue that are not yet finished
+        size_t m_busy;
+        bool m_shutdown;
+
+    private:
+        committer(const committer&);
+        committer& operator = (const committer&);
+};
+
+#endif // hyperdex_daemon_replication_manager_committer_h_
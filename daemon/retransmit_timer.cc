@@ -0,0 +1,175 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// STL
+#include <algorithm>
+
+// HyperDex
+#include "daemon/retransmit_timer.h"
+
+using hyperdex::retransmit_timer;
+
+// the timeout for a peer we have yet to hear back from
+#define RTO_INITIAL 200000000ULL
+// bounds on any timeout, however the round trips look
+#define RTO_MIN 10000000ULL
+#define RTO_MAX 5000000000ULL
+// retransmissions each peer takes per second once its burst is spent
+#define RETRANSMIT_RATE 10000ULL
+#define RETRANSMIT_BURST 1000ULL
+
+struct retransmit_timer::peer
+{
+    peer() : srtt(0), rttvar(0), credit(0), refilled(0) {}
+    uint64_t srtt;
+    uint64_t rttvar;
+    // the token bucket, kept as the nanoseconds of sending it has saved up
+    uint64_t credit;
+    uint64_t refilled;
+};
+
+struct retransmit_timer::shard
+{
+    shard() : mtx(), peers() {}
+    po6::threads::mutex mtx;
+    std::map<server_id, peer> peers;
+
+    private:
+        shard(const shard&);
+        shard& operator = (const shard&);
+};
+
+retransmit_timer :: retransmit_timer()
+    : m_shards(new shard[SHARDS])
+{
+}
+
+retransmit_timer :: ~retransmit_timer() throw ()
+{
+    delete[] m_shards;
+}
+
+void
+retransmit_timer :: sample(const server_id& p, uint64_t rtt)
+{
+    shard* s = get_shard(p);
+    po6::threads::mutex::hold hold(&s->mtx);
+    peer* pr = get_peer(s, p);
+
+    if (pr->srtt == 0)
+    {
+        pr->srtt = rtt;
+        pr->rttvar = rtt / 2;
+        return;
+    }
+
+    uint64_t err = rtt > pr->srtt ? rtt - pr->srtt : pr->srtt - rtt;
+    pr->rttvar = pr->rttvar - pr->rttvar / 4 + err / 4;
+    pr->srtt = pr->srtt - pr->srtt / 8 + rtt / 8;
+}
+
+uint64_t
+retransmit_timer :: timeout(const server_id& p, unsigned retransmits)
+{
+    uint64_t rto = RTO_INITIAL;
+
+    {
+        shard* s = get_shard(p);
+        po6::threads::mutex::hold hold(&s->mtx);
+        peer* pr = get_peer(s, p);
+
+        if (pr->srtt > 0)
+        {
+            rto = pr->srtt + 4 * pr->rttvar;
+        }
+    }
+
+    rto = std::max(rto, uint64_t(RTO_MIN));
+
+    for (unsigned i = 0; i < retransmits && rto < RTO_MAX; ++i)
+    {
+        rto *= 2;
+    }
+
+    return std::min(rto, uint64_t(RTO_MAX));
+}
+
+bool
+retransmit_timer :: admit(const server_id& p, uint64_t now)
+{
+    const uint64_t cost = 1000000000ULL / RETRANSMIT_RATE;
+    const uint64_t full = RETRANSMIT_BURST * cost;
+    shard* s = get_shard(p);
+    po6::threads::mutex::hold hold(&s->mtx);
+    peer* pr = get_peer(s, p);
+
+    if (pr->refilled == 0)
+    {
+        pr->credit = full;
+    }
+    else if (now > pr->refilled)
+    {
+        pr->credit = std::min(full, pr->credit + (now - pr->refilled));
+    }
+
+    pr->refilled = std::max(pr->refilled, now);
+
+    if (pr->credit < cost)
+    {
+        return false;
+    }
+
+    pr->credit -= cost;
+    return true;
+}
+
+uint64_t
+retransmit_timer :: backoff(unsigned passes, uint64_t seed)
+{
+    uint64_t wait = RTO_MIN;
+
+    for (unsigned i = 0; i < passes && wait < RTO_MAX; ++i)
+    {
+        wait *= 2;
+    }
+
+    wait = std::min(wait, uint64_t(RTO_MAX));
+    // somewhere between three and five quarters of the wait
+    return wait - wait / 4 + seed % (wait / 2 + 1);
+}
+
+retransmit_timer::shard*
+retransmit_timer :: get_shard(const server_id& p)
+{
+    return &m_shards[p.get() % SHARDS];
+}
+
+retransmit_timer::peer*
+retransmit_timer :: get_peer(shard* s, const server_id& p)
+{
+    return &s->peers[p];
+}
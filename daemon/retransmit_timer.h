@@ -0,0 +1,88 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_retransmit_timer_h_
+#define hyperdex_daemon_retransmit_timer_h_
+
+// STL
+#include <map>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Per-peer retransmission state for the chain.  Each peer gets a round trip
+// estimate (smoothed mean and deviation, as TCP keeps) from which to derive
+// how long an op sent to it may go unacknowledged before it is sent again,
+// and a token bucket that paces retransmissions to it so that the burst that
+// follows a reconfiguration does not land on one server all at once.  All
+// times are in nanoseconds.
+class retransmit_timer
+{
+    public:
+        retransmit_timer();
+        ~retransmit_timer() throw ();
+
+    public:
+        // an op sent to "peer" was acknowledged "rtt" after it was sent; only
+        // sample ops sent once, as the ack of a resent op is ambiguous
+        void sample(const server_id& peer, uint64_t rtt);
+        // how long an op sent to "peer" and then resent "retransmits" times
+        // may go unacknowledged; doubles with every retransmission
+        uint64_t timeout(const server_id& peer, unsigned retransmits);
+        // take one of the peer's retransmission tokens; returns false when
+        // the peer has had its share for now and the op should wait
+        bool admit(const server_id& peer, uint64_t now);
+        // the wait before the "passes"-th consecutive retransmission pass,
+        // growing with each and spread by "seed" so that servers that lost
+        // the same peer do not retransmit in lock step
+        static uint64_t backoff(unsigned passes, uint64_t seed);
+
+    private:
+        const static size_t SHARDS = 16;
+        struct peer;
+        struct shard;
+        shard* get_shard(const server_id& p);
+        // call holding the shard's lock
+        static peer* get_peer(shard* s, const server_id& p);
+
+    private:
+        shard* m_shards;
+
+    private:
+        retransmit_timer(const retransmit_timer&);
+        retransmit_timer& operator = (const retransmit_timer&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_retransmit_timer_h_
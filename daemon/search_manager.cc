@@ -27,8 +27,15 @@
 
 #define __STDC_LIMIT_MACROS
 
+// C
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
 // STL
 #include <algorithm>
+#include <list>
+#include <map>
 #include <sstream>
 
 // Google Log
@@ -38,20 +45,61 @@
 #include <po6/time.h>
 
 // e
+#include <e/arena.h>
+#include <e/endian.h>
 #include <e/intrusive_ptr.h>
 
 // HyperDex
+#include "cityhash/city.h"
+#include "common/aggregate.h"
 #include "common/attribute_check.h"
+#include "common/compression.h"
+#include "common/datatype_float.h"
 #include "common/datatype_info.h"
+#include "common/datatype_int64.h"
+#include "common/key_change.h"
 #include "common/serialization.h"
 #include "daemon/daemon.h"
 #include "daemon/datalayer_iterator.h"
+#include "daemon/expiry.h"
+#include "daemon/lock_profile.h"
+#include "daemon/memory_accounting.h"
+#include "daemon/message_builder.h"
 #include "daemon/search_manager.h"
 
 using hyperdex::datatype_info;
+using hyperdex::lock_profile;
+using hyperdex::memory_accounting;
+using hyperdex::memory_charge;
+using hyperdex::profiled_mutex;
 using hyperdex::search_manager;
 using hyperdex::reconfigure_returncode;
 
+// upper bounds on what a client may ask for in one RESP_SEARCH_BATCH
+const static uint32_t SEARCH_BATCH_MAX_OBJECTS = 4096;
+const static uint32_t SEARCH_BATCH_MAX_BYTES = 4 * 1024 * 1024;
+// a batch's buffer starts this big and doubles as objects overflow it
+const static uint32_t SEARCH_BATCH_INITIAL_BYTES = 64 * 1024;
+// pages smaller than this go out as they are even to clients that could
+// decompress them
+const static size_t SEARCH_COMPRESS_MIN_BYTES = 1024;
+// how many objects a scan reads between looks at the clock
+const static uint64_t SEARCH_DEADLINE_INTERVAL = 256;
+// the most deletes one sweep of a region sends; the next sweep picks up the
+// rest, so a backlog of expired objects drains without flooding the chain
+const static uint64_t EXPIRY_SWEEP_MAX_DELETES = 4096;
+// a group operation sends each other server its ops in REQ_ATOMIC_BATCHes
+// of up to this many, and logs its progress every interval ops
+const static size_t GROUP_KEYOP_BATCH_OPS = 256;
+const static uint64_t GROUP_KEYOP_PROGRESS_INTERVAL = 100000;
+// a search left untouched this long, in nanoseconds, is closed so that a
+// crashed client's snapshot does not keep LevelDB from dropping old versions
+const static uint64_t SEARCH_IDLE_TIMEOUT = 300ULL * 1000000000ULL;
+// the most searches one client, and all clients together, may hold open on
+// this server; opening one more closes the least recently used
+const static uint64_t SEARCH_MAX_PER_CLIENT = 1024;
+const static uint64_t SEARCH_MAX_OPEN = 16384;
+
 /////////////////////////////// Search Manager ID //////////////////////////////
 
 class search_manager::id
@@ -107,6 +155,35 @@ search_manager :: id :: operator == (const id& rhs) const
            search_id == rhs.search_id;
 }
 
+//////////////////////////// Group Operation Batch /////////////////////////////
+
+class search_manager::group_batch
+{
+    public:
+        group_batch() : vsis(), keys() {}
+        ~group_batch() throw () {}
+
+    public:
+        // keys[i] is led by vsis[i]
+        std::vector<virtual_server_id> vsis;
+        std::vector<std::string> keys;
+};
+
+///////////////////////////// Search Manager Lease /////////////////////////////
+
+class search_manager::lease
+{
+    public:
+        lease(uint64_t now) : opened(now), touched(now) {}
+        ~lease() throw () {}
+
+    public:
+        // when the search took its snapshot and when it was last asked for
+        // more objects
+        uint64_t opened;
+        uint64_t touched;
+};
+
 ///////////////////////////// Search Manager State /////////////////////////////
 
 class search_manager::state
@@ -114,15 +191,32 @@ class search_manager::state
     public:
         state(const region_id& region,
               std::auto_ptr<e::buffer> msg,
-              std::vector<attribute_check>* checks);
+              std::vector<attribute_check>* checks,
+              uint64_t limit,
+              bool compress,
+              uint64_t sample,
+              uint64_t seed);
         ~state() throw ();
 
     public:
-        po6::threads::mutex lock;
+        bool sampled(const e::slice& key) const;
+
+    public:
+        profiled_mutex lock;
         const region_id region;
         const std::auto_ptr<e::buffer> backing;
         std::vector<attribute_check> checks;
         e::intrusive_ptr<datalayer::iterator> iter;
+        // objects still to send before the search is done; zero is unlimited
+        const bool limited;
+        uint64_t remaining;
+        // the client takes RESP_SEARCH_COMPRESSED
+        const bool compress;
+        // a sampling search keeps the matches whose keyed hash falls below
+        // the threshold; zero keeps every match
+        const uint64_t sample;
+        const uint64_t seed;
+        memory_charge charge;
 
     private:
         friend class e::intrusive_ptr<state>;
@@ -137,12 +231,22 @@ class search_manager::state
 
 search_manager :: state :: state(const region_id& r,
                                  std::auto_ptr<e::buffer> msg,
-                                 std::vector<attribute_check>* c)
-    : lock()
+                                 std::vector<attribute_check>* c,
+                                 uint64_t l,
+                                 bool co,
+                                 uint64_t sa,
+                                 uint64_t se)
+    : lock(lock_profile::SEARCH_STATE)
     , region(r)
     , backing(msg)
     , checks()
     , iter()
+    , limited(l > 0)
+    , remaining(l)
+    , compress(co)
+    , sample(sa)
+    , seed(se)
+    , charge(memory_accounting::SEARCHES, sizeof(state) + (backing.get() ? backing->capacity() : 0))
     , m_ref(0)
 {
     checks.swap(*c);
@@ -152,11 +256,132 @@ search_manager :: state :: ~state() throw ()
 {
 }
 
+bool
+search_manager :: state :: sampled(const e::slice& key) const
+{
+    // the hash is of the key alone, so every region of the space (and every
+    // replica of a region) samples the same objects for the same seed
+    return sample == 0 ||
+           CityHash64WithSeed(reinterpret_cast<const char*>(key.data()), key.size(), seed) < sample;
+}
+
+////////////////////////// Search Manager Sorted State //////////////////////////
+
+// the keys of a streamed sorted search, best first, that remain to be sent
+class search_manager::sorted_state
+{
+    public:
+        sorted_state(const region_id& region,
+                     datalayer::snapshot snap,
+                     uint32_t chunk,
+                     bool compress);
+        ~sorted_state() throw ();
+
+    public:
+        profiled_mutex lock;
+        const region_id region;
+        const datalayer::snapshot snap;
+        const uint32_t chunk;
+        // the client takes RESP_SEARCH_COMPRESSED
+        const bool compress;
+        std::vector<std::string> keys;
+        size_t next;
+        memory_charge charge;
+
+    private:
+        friend class e::intrusive_ptr<sorted_state>;
+
+    private:
+        void inc() { __sync_add_and_fetch(&m_ref, 1); }
+        void dec() { if (__sync_sub_and_fetch(&m_ref, 1) == 0) delete this; }
+
+    private:
+        size_t m_ref;
+};
+
+search_manager :: sorted_state :: sorted_state(const region_id& r,
+                                               datalayer::snapshot s,
+                                               uint32_t c,
+                                               bool co)
+    : lock(lock_profile::SEARCH_STATE)
+    , region(r)
+    , snap(s)
+    , chunk(c)
+    , compress(co)
+    , keys()
+    , next(0)
+    , charge(memory_accounting::SEARCHES, sizeof(sorted_state))
+    , m_ref(0)
+{
+}
+
+search_manager :: sorted_state :: ~sorted_state() throw ()
+{
+}
+
+///////////////////////// Search Manager Changes State /////////////////////////
+
+// a region's writes being replayed to a change stream consumer
+class search_manager::changes_state
+{
+    public:
+        changes_state(const region_id& region,
+                      datalayer::replay_iterator* iter,
+                      uint64_t resume,
+                      bool compress);
+        ~changes_state() throw ();
+
+    public:
+        profiled_mutex lock;
+        const region_id region;
+        const std::auto_ptr<datalayer::replay_iterator> iter;
+        // the checkpoint a consumer resumes from having seen this stream
+        const uint64_t resume;
+        // the consumer takes RESP_CHANGES_COMPRESSED
+        const bool compress;
+        memory_charge charge;
+
+    private:
+        friend class e::intrusive_ptr<changes_state>;
+
+    private:
+        void inc() { __sync_add_and_fetch(&m_ref, 1); }
+        void dec() { if (__sync_sub_and_fetch(&m_ref, 1) == 0) delete this; }
+
+    private:
+        size_t m_ref;
+};
+
+search_manager :: changes_state :: changes_state(const region_id& r,
+                                                 datalayer::replay_iterator* i,
+                                                 uint64_t re,
+                                                 bool c)
+    : lock(lock_profile::SEARCH_STATE)
+    , region(r)
+    , iter(i)
+    , resume(re)
+    , compress(c)
+    , charge(memory_accounting::SEARCHES, sizeof(changes_state))
+    , m_ref(0)
+{
+}
+
+search_manager :: changes_state :: ~changes_state() throw ()
+{
+}
+
 //////////////////////////////// Search Manager ////////////////////////////////
 
 search_manager :: search_manager(daemon* d)
     : m_daemon(d)
     , m_searches(10)
+    , m_sorted_searches(10)
+    , m_changes(10)
+    , m_protect_leases()
+    , m_leases()
+    , m_leases_per_client()
+    , m_perf_reaped()
+    , m_perf_evicted()
 {
 }
 
@@ -187,10 +412,89 @@ search_manager :: unpause()
 
 void
 search_manager :: reconfigure(const configuration&,
-                              const configuration&,
-                              const server_id&)
+                              const configuration& new_config,
+                              const server_id& us)
+{
+    std::vector<region_id> mapped;
+    new_config.mapped_regions(us, &mapped);
+    std::sort(mapped.begin(), mapped.end());
+    std::vector<id> doomed;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect_leases);
+        lease_map::iterator it = m_leases.begin();
+
+        while (it != m_leases.end())
+        {
+            lease_map::iterator here = it;
+            ++it;
+
+            if (!std::binary_search(mapped.begin(), mapped.end(), here->first.region))
+            {
+                doomed.push_back(here->first);
+                drop_lease(here);
+            }
+        }
+    }
+
+    close_searches(doomed);
+}
+
+void
+search_manager :: reap_idle()
+{
+    uint64_t now = po6::monotonic_time();
+    std::vector<id> doomed;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect_leases);
+        lease_map::iterator it = m_leases.begin();
+
+        while (it != m_leases.end())
+        {
+            lease_map::iterator here = it;
+            ++it;
+
+            if (here->second.touched + SEARCH_IDLE_TIMEOUT < now)
+            {
+                doomed.push_back(here->first);
+                drop_lease(here);
+            }
+        }
+    }
+
+    close_searches(doomed);
+    m_perf_reaped.add(doomed.size());
+
+    if (!doomed.empty())
+    {
+        LOG(INFO) << "closed " << doomed.size() << " searches left idle for more than "
+                  << SEARCH_IDLE_TIMEOUT / 1000000000ULL << "s";
+    }
+}
+
+void
+search_manager :: open_stats(uint64_t* open, uint64_t* oldest,
+                             uint64_t* reaped, uint64_t* evicted)
 {
-    // XXX cleanup dead or old searches
+    uint64_t now = po6::monotonic_time();
+    *oldest = 0;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect_leases);
+        *open = m_leases.size();
+
+        for (lease_map::iterator it = m_leases.begin(); it != m_leases.end(); ++it)
+        {
+            if (it->second.opened < now)
+            {
+                *oldest = std::max(*oldest, now - it->second.opened);
+            }
+        }
+    }
+
+    *reaped = m_perf_reaped.read();
+    *evicted = m_perf_evicted.read();
 }
 
 void
@@ -199,10 +503,18 @@ search_manager :: start(const server_id& from,
                         std::auto_ptr<e::buffer> msg,
                         uint64_t nonce,
                         uint64_t search_id,
-                        std::vector<attribute_check>* checks)
+                        std::vector<attribute_check>* checks,
+                        uint32_t max_objects,
+                        uint32_t max_bytes,
+                        uint64_t limit,
+                        bool compress,
+                        uint64_t sample,
+                        uint64_t seed,
+                        uint64_t deadline,
+                        const datalayer::snapshot* shared)
 {
-    region_id ri(m_daemon->m_config.get_region_id(to));
-    const schema* sc = m_daemon->m_config.get_schema(ri);
+    region_id ri(m_daemon->config().get_region_id(to));
+    const schema* sc = m_daemon->config().get_schema(ri);
 
     if (sc->authorization)
     {
@@ -218,10 +530,10 @@ search_manager :: start(const server_id& from,
         return;
     }
 
-    e::intrusive_ptr<state> st = new state(ri, msg, checks);
+    e::intrusive_ptr<state> st = new state(ri, msg, checks, limit, compress, sample, seed);
     std::stable_sort(st->checks.begin(), st->checks.end());
     datalayer::returncode rc = datalayer::SUCCESS;
-    datalayer::snapshot snap = m_daemon->m_data.make_snapshot();
+    datalayer::snapshot snap = shared ? *shared : m_daemon->m_data.make_snapshot(ri);
     st->iter = m_daemon->m_data.make_search_iterator(snap, ri, st->checks, NULL);
 
     switch (rc)
@@ -239,18 +551,22 @@ search_manager :: start(const server_id& from,
             abort();
     }
 
+    open_lease(sid);
     m_searches.insert(sid, st);
-    next(from, to, nonce, search_id);
+    next(from, to, nonce, search_id, max_objects, max_bytes, deadline);
 }
 
 void
 search_manager :: next(const server_id& from,
                        const virtual_server_id& to,
                        uint64_t nonce,
-                       uint64_t search_id)
+                       uint64_t search_id,
+                       uint32_t max_objects,
+                       uint32_t max_bytes,
+                       uint64_t deadline)
 {
-    region_id ri(m_daemon->m_config.get_region_id(to));
-    const schema& sc(*m_daemon->m_config.get_schema(ri));
+    region_id ri(m_daemon->config().get_region_id(to));
+    const schema& sc(*m_daemon->config().get_schema(ri));
     id sid(ri, from, search_id);
     e::intrusive_ptr<state> st;
 
@@ -262,7 +578,18 @@ search_manager :: next(const server_id& from,
         return;
     }
 
-    po6::threads::mutex::hold hold(&st->lock);
+    touch_lease(sid);
+
+    if (max_objects > 0)
+    {
+        next_batch(from, to, nonce, search_id, st.get(),
+                   std::min(max_objects, SEARCH_BATCH_MAX_OBJECTS),
+                   std::min(max_bytes, SEARCH_BATCH_MAX_BYTES),
+                   deadline);
+        return;
+    }
+
+    profiled_mutex::hold hold(&st->lock);
 
     if (st->iter->valid())
     {
@@ -289,137 +616,316 @@ search_manager :: next(const server_id& from,
     }
 }
 
+void
+search_manager :: next_batch(const server_id& from,
+                             const virtual_server_id& to,
+                             uint64_t nonce,
+                             uint64_t search_id,
+                             state* st,
+                             uint32_t max_objects,
+                             uint32_t max_bytes,
+                             uint64_t deadline)
+{
+    const schema& sc(*m_daemon->config().get_schema(st->region));
+    // objects are packed as they are read, so each reference can be reused
+    // for the next object; the count and done flag are filled in at the end
+    const size_t prefix_sz = sizeof(uint64_t) + sizeof(uint8_t) + sizeof(uint32_t);
+    message_builder mb(HYPERDEX_HEADER_SIZE_VC,
+                       prefix_sz + std::min(max_bytes, SEARCH_BATCH_INITIAL_BYTES));
+    mb.append(prefix_sz);
+    e::slice key;
+    std::vector<e::slice> val;
+    datalayer::reference ref;
+    uint32_t count = 0;
+    size_t budget = 0;
+    uint64_t scanned = 0;
+    bool done = false;
+
+    {
+        profiled_mutex::hold hold(&st->lock);
+
+        if (st->limited && st->remaining < max_objects)
+        {
+            max_objects = st->remaining;
+        }
+
+        // always send at least one object, even if it busts the byte budget
+        while (st->iter->valid() &&
+               count < max_objects &&
+               (count == 0 || budget < max_bytes))
+        {
+            // the rest of the region waits for the client's next request
+            if (expired(deadline, ++scanned))
+            {
+                break;
+            }
+
+            // decide from the key whether to keep a match before reading the
+            // object, so a sample costs reads in proportion to its size
+            if (!st->sampled(st->iter->key()))
+            {
+                st->iter->next();
+                continue;
+            }
+
+            uint64_t ver;
+            datalayer::returncode rc;
+            rc = m_daemon->m_data.get_from_iterator(st->region, sc, st->iter.get(),
+                                                    &key, &val, &ver, &ref);
+            st->iter->next();
+
+            if (rc != datalayer::SUCCESS)
+            {
+                LOG(ERROR) << "could not read object for search: " << rc;
+                continue;
+            }
+
+            size_t obj_sz = pack_size(key) + pack_size(val);
+            mb.append(obj_sz) << key << val;
+            budget += obj_sz;
+            ++count;
+        }
+
+        if (st->limited)
+        {
+            st->remaining -= count;
+        }
+
+        // a region never sends more than the whole search's limit, so it can
+        // stop without waiting for the client to say so
+        done = !st->iter->valid() || (st->limited && st->remaining == 0);
+    }
+
+    m_daemon->m_region_ops.add(st->region, region_op_counter::SEARCH_SCANNED, scanned);
+    mb.pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce
+                                        << static_cast<uint8_t>(done ? 1 : 0)
+                                        << count;
+    std::auto_ptr<e::buffer> msg(mb.finish());
+    send_page(from, to, RESP_SEARCH_BATCH, nonce, msg, st->compress);
+
+    // the client knows from the done flag not to ask again
+    if (done)
+    {
+        stop(from, to, search_id);
+    }
+}
+
 void
 search_manager :: stop(const server_id& from,
                        const virtual_server_id& to,
                        uint64_t search_id)
 {
-    region_id ri(m_daemon->m_config.get_region_id(to));
+    region_id ri(m_daemon->config().get_region_id(to));
     id sid(ri, from, search_id);
+    close_lease(sid);
     m_searches.remove(sid);
+    m_sorted_searches.remove(sid);
 }
 
 namespace hyperdex
 {
 
+// A sorted search runs in two phases.  The first walks the iterator and
+// keeps only the key and sort attribute of each candidate in a heap of
+// indices into a pool, so heap operations move integers rather than objects.
+// The second reads the full objects for the winners from the same snapshot.
+struct _sorted_search_candidate
+{
+    _sorted_search_candidate() : key(), attr(), i(0), d(0) {}
+    std::string key;
+    std::string attr;
+    int64_t i;
+    double d;
+};
+
 struct _sorted_search_params
 {
+    enum kind { SORT_NONE, SORT_INT64, SORT_FLOAT, SORT_STRING, SORT_OTHER };
     _sorted_search_params(const schema* _sc,
                           uint16_t _sort_by,
-                          bool _maximize)
-        : sc(_sc), sort_by(_sort_by), maximize(_maximize) {}
+                          bool _maximize);
     ~_sorted_search_params() throw () {}
+    void extract(const e::slice& attr, _sorted_search_candidate* c) const;
+    int compare(const _sorted_search_candidate& lhs,
+                const _sorted_search_candidate& rhs) const;
+    bool better(const _sorted_search_candidate& lhs,
+                const _sorted_search_candidate& rhs) const;
     const schema* sc;
     uint16_t sort_by;
     bool maximize;
+    kind k;
+    datatype_info* di;
 
     private:
         _sorted_search_params(const _sorted_search_params&);
         _sorted_search_params& operator = (const _sorted_search_params&);
 };
 
-struct _sorted_search_item
-{
-    _sorted_search_item(_sorted_search_params* p)
-        : params(p), key(), value(), version(), ref() {}
-    _sorted_search_item(const _sorted_search_item& other);
-    ~_sorted_search_item() throw () {}
-    _sorted_search_item& operator = (const _sorted_search_item& other);
-    _sorted_search_params* params;
-    e::slice key;
-    std::vector<e::slice> value;
-    uint64_t version;
-    datalayer::reference ref;
-};
-
-_sorted_search_item :: _sorted_search_item(const _sorted_search_item& other)
-    : params(other.params)
-    , key(other.key)
-    , value(other.value)
-    , version(other.version)
-    , ref(other.ref)
-{
-}
-
-_sorted_search_item&
-_sorted_search_item :: _sorted_search_item :: operator = (const _sorted_search_item& other)
-{
-    params = other.params;
-    key = other.key;
-    value = other.value;
-    version = other.version;
-    ref = other.ref;
-    return *this;
-}
-
-bool
-operator < (const _sorted_search_item& lhs, const _sorted_search_item& rhs)
+_sorted_search_params :: _sorted_search_params(const schema* _sc,
+                                               uint16_t _sort_by,
+                                               bool _maximize)
+    : sc(_sc)
+    , sort_by(_sort_by)
+    , maximize(_maximize)
+    , k(SORT_NONE)
+    , di(NULL)
 {
-    assert(lhs.params == rhs.params);
-    _sorted_search_params* params = lhs.params;
-
-    if (params->sort_by >= params->sc->attrs_sz)
+    if (sort_by >= sc->attrs_sz)
     {
-        return false;
+        return;
     }
 
-    int cmp = 0;
+    hyperdatatype t = sc->attrs[sort_by].type;
+    di = datatype_info::lookup(t);
 
-    if (params->sort_by == 0)
+    if (t == HYPERDATATYPE_INT64 ||
+        CONTAINER_TYPE(t) == HYPERDATATYPE_TIMESTAMP_GENERIC)
     {
-        datatype_info* di = datatype_info::lookup(params->sc->attrs[0].type);
-        cmp = di->compare(lhs.key, rhs.key);
+        // timestamps are stored exactly like int64
+        k = SORT_INT64;
     }
-    else
+    else if (t == HYPERDATATYPE_FLOAT)
     {
-        datatype_info* di = datatype_info::lookup(params->sc->attrs[params->sort_by].type);
-        cmp = di->compare(lhs.value[params->sort_by - 1],
-                          rhs.value[params->sort_by - 1]);
+        k = SORT_FLOAT;
     }
-
-    if (params->maximize)
+    else if (t == HYPERDATATYPE_STRING)
     {
-        return cmp < 0;
+        k = SORT_STRING;
     }
     else
     {
-        return cmp > 0;
+        k = SORT_OTHER;
     }
 }
 
-bool
-operator > (const _sorted_search_item& lhs, const _sorted_search_item& rhs)
+void
+_sorted_search_params :: extract(const e::slice& attr,
+                                 _sorted_search_candidate* c) const
+{
+    switch (k)
+    {
+        case SORT_INT64:
+            c->i = datatype_int64::unpack(attr);
+            break;
+        case SORT_FLOAT:
+            c->d = datatype_float::unpack(attr);
+            break;
+        case SORT_STRING:
+        case SORT_OTHER:
+            c->attr.assign(reinterpret_cast<const char*>(attr.data()), attr.size());
+            break;
+        case SORT_NONE:
+        default:
+            break;
+    }
+}
+
+static int
+compare_bytes(const std::string& lhs, const std::string& rhs)
 {
-    assert(lhs.params == rhs.params);
-    _sorted_search_params* params = lhs.params;
+    // same order as datatype_string::compare
+    int cmp = memcmp(lhs.data(), rhs.data(), std::min(lhs.size(), rhs.size()));
 
-    if (params->sort_by >= params->sc->attrs_sz)
+    if (cmp == 0)
     {
-        return false;
+        cmp = lhs.size() < rhs.size() ? -1 : (lhs.size() > rhs.size() ? 1 : 0);
     }
 
-    int cmp = 0;
+    return cmp;
+}
 
-    if (params->sort_by == 0)
+// compares the sort attributes alone, ignoring the keys
+int
+_sorted_search_params :: compare(const _sorted_search_candidate& lhs,
+                                 const _sorted_search_candidate& rhs) const
+{
+    switch (k)
     {
-        datatype_info* di = datatype_info::lookup(params->sc->attrs[0].type);
-        cmp = di->compare(lhs.key, rhs.key);
+        case SORT_INT64:
+            return lhs.i < rhs.i ? -1 : (lhs.i > rhs.i ? 1 : 0);
+        case SORT_FLOAT:
+            return lhs.d < rhs.d ? -1 : (lhs.d > rhs.d ? 1 : 0);
+        case SORT_STRING:
+            return compare_bytes(lhs.attr, rhs.attr);
+        case SORT_OTHER:
+            return di->compare(e::slice(lhs.attr), e::slice(rhs.attr));
+        case SORT_NONE:
+        default:
+            return 0;
     }
-    else
+}
+
+bool
+_sorted_search_params :: better(const _sorted_search_candidate& lhs,
+                                const _sorted_search_candidate& rhs) const
+{
+    if (k == SORT_NONE)
     {
-        datatype_info* di = datatype_info::lookup(params->sc->attrs[params->sort_by].type);
-        cmp = di->compare(lhs.value[params->sort_by - 1],
-                          rhs.value[params->sort_by - 1]);
+        return false;
     }
 
-    if (params->maximize)
+    int cmp = compare(lhs, rhs);
+
+    if (cmp == 0)
     {
-        return cmp > 0;
+        // ties go to the smaller key so that a cursor names a unique spot
+        return compare_bytes(lhs.key, rhs.key) < 0;
     }
-    else
+
+    return maximize ? cmp > 0 : cmp < 0;
+}
+
+// orders pool indices so that the heap's front is the worst candidate kept
+struct _sorted_search_cmp
+{
+    _sorted_search_cmp(const _sorted_search_params* p,
+                       const std::vector<_sorted_search_candidate>* c)
+        : params(p), pool(c) {}
+    bool operator () (size_t lhs, size_t rhs) const
+    { return params->better((*pool)[lhs], (*pool)[rhs]); }
+    const _sorted_search_params* params;
+    const std::vector<_sorted_search_candidate>* pool;
+};
+
+// read the objects for keys[begin, end) as they were in "snap", skipping any
+// that cannot be read, and return how many bytes they will pack into
+static size_t
+read_sorted(datalayer* data,
+            datalayer::snapshot snap,
+            const region_id& ri,
+            const std::vector<std::string>& keys,
+            size_t begin, size_t end,
+            std::vector<e::slice>* objkeys,
+            std::vector<std::vector<e::slice> >* values,
+            std::vector<datalayer::reference>* refs)
+{
+    // sized once up front; the slices in values point into refs
+    objkeys->resize(end - begin);
+    values->resize(end - begin);
+    refs->resize(end - begin);
+    size_t found = 0;
+    size_t sz = 0;
+
+    for (size_t i = begin; i < end; ++i)
     {
-        return cmp < 0;
+        uint64_t version;
+        (*objkeys)[found] = e::slice(keys[i]);
+        datalayer::returncode rc;
+        rc = data->get(snap, ri, (*objkeys)[found], &(*values)[found], &version, &(*refs)[found]);
+
+        if (rc != datalayer::SUCCESS)
+        {
+            LOG(ERROR) << "could not read object for sorted search: " << rc;
+            continue;
+        }
+
+        sz += pack_size((*objkeys)[found]) + pack_size((*values)[found]);
+        ++found;
     }
+
+    objkeys->resize(found);
+    values->resize(found);
+    return sz;
 }
 
 } // namespace hyperdex
@@ -431,21 +937,61 @@ search_manager :: sorted_search(const server_id& from,
                                 std::vector<attribute_check>* checks,
                                 uint64_t limit,
                                 uint16_t sort_by,
-                                bool maximize)
+                                bool maximize,
+                                uint64_t search_id,
+                                uint32_t chunk,
+                                bool compress,
+                                const e::slice* cursor_attr,
+                                const e::slice* cursor_key,
+                                uint64_t deadline,
+                                const datalayer::snapshot* shared)
 {
-    region_id ri(m_daemon->m_config.get_region_id(to));
-    const schema* sc = m_daemon->m_config.get_schema(ri);
+    region_id ri(m_daemon->config().get_region_id(to));
+    const schema* sc = m_daemon->config().get_schema(ri);
 
     if (sc->authorization)
     {
         return;
     }
 
+    _sorted_search_params params(sc, sort_by, maximize);
+    _sorted_search_candidate cursor;
+    const bool has_cursor = cursor_attr && cursor_key && params.k != _sorted_search_params::SORT_NONE;
+
+    if (has_cursor)
+    {
+        // bound the iterator at the cursor so a range index can seek past
+        // the earlier pages; ties at the cursor are filtered out below
+        attribute_check chk;
+        chk.attr = sort_by;
+        chk.value = *cursor_attr;
+        chk.datatype = sc->attrs[sort_by].type;
+        chk.predicate = maximize ? HYPERPREDICATE_LESS_EQUAL : HYPERPREDICATE_GREATER_EQUAL;
+        checks->push_back(chk);
+        cursor.key.assign(reinterpret_cast<const char*>(cursor_key->data()), cursor_key->size());
+        params.extract(*cursor_attr, &cursor);
+    }
+
     std::stable_sort(checks->begin(), checks->end());
     datalayer::returncode rc = datalayer::SUCCESS;
-    datalayer::snapshot snap = m_daemon->m_data.make_snapshot();
+    datalayer::snapshot snap = shared ? *shared : m_daemon->m_data.make_snapshot(ri);
     e::intrusive_ptr<datalayer::iterator> iter;
-    iter = m_daemon->m_data.make_search_iterator(snap, ri, *checks, NULL);
+
+    // an index over a numeric sort attribute yields candidates best first,
+    // so the scan may stop once the next one cannot beat the worst kept
+    if (sort_by != 0 &&
+        (params.k == _sorted_search_params::SORT_INT64 ||
+         params.k == _sorted_search_params::SORT_FLOAT))
+    {
+        iter = m_daemon->m_data.make_sorted_iterator(snap, ri, *checks, sort_by, maximize);
+    }
+
+    const bool ordered = iter.get() != NULL;
+
+    if (!ordered)
+    {
+        iter = m_daemon->m_data.make_search_iterator(snap, ri, *checks, NULL);
+    }
 
     switch (rc)
     {
@@ -462,67 +1008,681 @@ search_manager :: sorted_search(const server_id& from,
             abort();
     }
 
-    _sorted_search_params params(sc, sort_by, maximize);
-    std::vector<_sorted_search_item> top_n;
-    top_n.reserve(limit);
+    // phase one:  find the keys of the top "limit" objects
+    std::vector<_sorted_search_candidate> pool;
+    std::vector<size_t> top_n;
+    _sorted_search_cmp cmp(&params, &pool);
+    // the slot the next candidate is read into; reused when it loses
+    size_t spare = 0;
+    uint64_t scanned = 0;
+    datalayer::reference scratch;
 
-    while (iter->valid())
+    while (limit > 0 && iter->valid())
     {
-        top_n.push_back(_sorted_search_item(&params));
-        m_daemon->m_data.get_from_iterator(ri, *sc, iter.get(), &top_n.back().key, &top_n.back().value, &top_n.back().version, &top_n.back().ref);
-        std::push_heap(top_n.begin(), top_n.end());
+        if (expired(deadline, ++scanned))
+        {
+            return;
+        }
 
-        if (top_n.size() > limit)
+        if (spare == pool.size())
         {
-            std::pop_heap(top_n.begin(), top_n.end());
-            top_n.pop_back();
+            pool.push_back(_sorted_search_candidate());
+        }
+
+        _sorted_search_candidate* c = &pool[spare];
+        e::slice key = iter->key();
+        c->key.assign(reinterpret_cast<const char*>(key.data()), key.size());
+
+        if (sort_by == 0)
+        {
+            params.extract(key, c);
+        }
+        else
+        {
+            e::slice k;
+            std::vector<e::slice> value;
+            uint64_t version;
+            rc = m_daemon->m_data.get_from_iterator(ri, *sc, iter.get(), &k, &value, &version, &scratch);
+
+            if (rc != datalayer::SUCCESS || sort_by > value.size())
+            {
+                iter->next();
+                continue;
+            }
+
+            params.extract(value[sort_by - 1], c);
+        }
+
+        if (has_cursor && !params.better(cursor, *c))
+        {
+            iter->next();
+            continue;
+        }
+
+        // ties with the worst kept may still displace it on the key
+        if (ordered && top_n.size() == limit &&
+            (maximize ? params.compare(*c, pool[top_n.front()]) < 0
+                      : params.compare(*c, pool[top_n.front()]) > 0))
+        {
+            break;
+        }
+
+        if (top_n.size() < limit)
+        {
+            top_n.push_back(spare);
+            std::push_heap(top_n.begin(), top_n.end(), cmp);
+            spare = pool.size();
+        }
+        else if (params.better(*c, pool[top_n.front()]))
+        {
+            std::pop_heap(top_n.begin(), top_n.end(), cmp);
+            std::swap(top_n.back(), spare);
+            std::push_heap(top_n.begin(), top_n.end(), cmp);
         }
 
         iter->next();
     }
 
-    std::sort(top_n.begin(), top_n.end(), std::greater<_sorted_search_item>());
-    size_t sz = HYPERDEX_HEADER_SIZE_VC + sizeof(uint64_t) + sizeof(uint64_t);
+    std::sort(top_n.begin(), top_n.end(), cmp);
+    std::vector<std::string> keys(top_n.size());
 
     for (size_t i = 0; i < top_n.size(); ++i)
     {
-        sz += pack_size(top_n[i].key) + pack_size(top_n[i].value);
+        keys[i].swap(pool[top_n[i]].key);
+    }
+
+    // phase two:  read the winners from the snapshot the search saw
+    if (chunk > 0)
+    {
+        id sid(ri, from, search_id);
+        e::intrusive_ptr<sorted_state> st = new sorted_state(ri, snap, chunk, compress);
+        st->keys.swap(keys);
+        size_t held = sizeof(sorted_state);
+
+        for (size_t i = 0; i < st->keys.size(); ++i)
+        {
+            held += sizeof(std::string) + st->keys[i].size();
+        }
+
+        st->charge.set(held);
+
+        if (st->keys.size() > chunk)
+        {
+            open_lease(sid);
+            m_sorted_searches.insert(sid, st);
+        }
+
+        sorted_chunk(from, to, nonce, search_id, st.get());
+        return;
     }
 
+    std::vector<e::slice> objkeys;
+    std::vector<std::vector<e::slice> > values;
+    std::vector<datalayer::reference> refs;
+    size_t sz = HYPERDEX_HEADER_SIZE_VC + sizeof(uint64_t) + sizeof(uint64_t)
+              + read_sorted(&m_daemon->m_data, snap, ri, keys, 0, keys.size(),
+                            &objkeys, &values, &refs);
     std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
     e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
-    pa = pa << nonce << static_cast<uint64_t>(top_n.size());
+    pa = pa << nonce << static_cast<uint64_t>(objkeys.size());
 
-    for (size_t i = 0; i < top_n.size(); ++i)
+    for (size_t i = 0; i < objkeys.size(); ++i)
     {
-        pa = pa << top_n[i].key << top_n[i].value;
+        pa = pa << objkeys[i] << values[i];
     }
 
-    m_daemon->m_comm.send_client(to, from, RESP_SORTED_SEARCH, msg);
+    send_page(from, to, RESP_SORTED_SEARCH, nonce, msg, compress);
 }
 
 void
-search_manager :: group_keyop(const server_id& from,
-                              const virtual_server_id& to,
-                              uint64_t nonce,
-                              std::vector<attribute_check>* checks,
-                              network_msgtype mt,
-                              const e::slice& remain,
-                              network_msgtype resp)
+search_manager :: sorted_search_next(const server_id& from,
+                                     const virtual_server_id& to,
+                                     uint64_t nonce,
+                                     uint64_t search_id)
 {
-    region_id ri(m_daemon->m_config.get_region_id(to));
-    const schema* sc = m_daemon->m_config.get_schema(ri);
+    region_id ri(m_daemon->config().get_region_id(to));
+    id sid(ri, from, search_id);
+    e::intrusive_ptr<sorted_state> st;
 
-    if (sc->authorization)
+    if (!m_sorted_searches.lookup(sid, &st))
     {
+        // an empty, final chunk
+        size_t sz = HYPERDEX_HEADER_SIZE_VC
+                  + sizeof(uint64_t)
+                  + sizeof(uint8_t)
+                  + sizeof(uint64_t);
+        std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+        msg->pack_at(HYPERDEX_HEADER_SIZE_VC)
+            << nonce << static_cast<uint8_t>(1) << static_cast<uint64_t>(0);
+        m_daemon->m_comm.send_client(to, from, RESP_SORTED_SEARCH_CHUNK, msg);
         return;
     }
 
-    std::stable_sort(checks->begin(), checks->end());
-    datalayer::returncode rc = datalayer::SUCCESS;
-    datalayer::snapshot snap = m_daemon->m_data.make_snapshot();
-    e::intrusive_ptr<datalayer::iterator> iter;
-    iter = m_daemon->m_data.make_search_iterator(snap, ri, *checks, NULL);
+    touch_lease(sid);
+    sorted_chunk(from, to, nonce, search_id, st.get());
+}
+
+void
+search_manager :: sorted_chunk(const server_id& from,
+                               const virtual_server_id& to,
+                               uint64_t nonce,
+                               uint64_t search_id,
+                               sorted_state* st)
+{
+    profiled_mutex::hold hold(&st->lock);
+    size_t begin = st->next;
+    size_t end = std::min(st->keys.size(), begin + st->chunk);
+    st->next = end;
+    const bool done = end == st->keys.size();
+    std::vector<e::slice> objkeys;
+    std::vector<std::vector<e::slice> > values;
+    std::vector<datalayer::reference> refs;
+    size_t sz = HYPERDEX_HEADER_SIZE_VC
+              + sizeof(uint64_t)
+              + sizeof(uint8_t)
+              + sizeof(uint64_t)
+              + read_sorted(&m_daemon->m_data, st->snap, st->region, st->keys,
+                            begin, end, &objkeys, &values, &refs);
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
+    pa = pa << nonce << static_cast<uint8_t>(done ? 1 : 0)
+            << static_cast<uint64_t>(objkeys.size());
+
+    for (size_t i = 0; i < objkeys.size(); ++i)
+    {
+        pa = pa << objkeys[i] << values[i];
+    }
+
+    send_page(from, to, RESP_SORTED_SEARCH_CHUNK, nonce, msg, st->compress);
+
+    if (done)
+    {
+        stop(from, to, search_id);
+    }
+}
+
+void
+search_manager :: send_page(const server_id& from,
+                            const virtual_server_id& to,
+                            network_msgtype type,
+                            uint64_t nonce,
+                            std::auto_ptr<e::buffer> msg,
+                            bool may_compress)
+{
+    const size_t raw_off = HYPERDEX_HEADER_SIZE_VC + sizeof(uint64_t);
+    std::vector<char> compressed;
+
+    if (may_compress &&
+        msg->size() - raw_off >= SEARCH_COMPRESS_MIN_BYTES &&
+        compress(e::slice(msg->data() + raw_off, msg->size() - raw_off), &compressed))
+    {
+        // the nonce stays in the clear so the client can route the reply
+        size_t csz = raw_off + sizeof(uint8_t) + sizeof(uint32_t)
+                   + sizeof(uint32_t) + compressed.size();
+        std::auto_ptr<e::buffer> cmsg(e::buffer::create(csz));
+        cmsg->pack_at(HYPERDEX_HEADER_SIZE_VC)
+            << nonce
+            << static_cast<uint8_t>(type)
+            << static_cast<uint32_t>(msg->size() - raw_off)
+            << e::slice(&compressed[0], compressed.size());
+        m_daemon->m_comm.send_client(to, from, RESP_SEARCH_COMPRESSED, cmsg);
+    }
+    else
+    {
+        m_daemon->m_comm.send_client(to, from, type, msg);
+    }
+}
+
+namespace hyperdex
+{
+
+// can a nearest search measure distance along this attribute?
+static bool
+nearest_attr(const schema& sc, uint16_t attr)
+{
+    if (attr == 0 || attr >= sc.attrs_sz)
+    {
+        return false;
+    }
+
+    hyperdatatype t = sc.attrs[attr].type;
+    return t == HYPERDATATYPE_INT64 ||
+           t == HYPERDATATYPE_FLOAT ||
+           CONTAINER_TYPE(t) == HYPERDATATYPE_TIMESTAMP_GENERIC;
+}
+
+static double
+nearest_coordinate(hyperdatatype t, const e::slice& value)
+{
+    if (t == HYPERDATATYPE_FLOAT)
+    {
+        return datatype_float::unpack(value);
+    }
+
+    // timestamps are stored exactly like int64
+    return static_cast<double>(datatype_int64::unpack(value));
+}
+
+// restrict "attr" to [center - radius, center + radius], with the bounds
+// kept alive in "storage"
+static void
+nearest_bound(const schema& sc, uint16_t attr, double center, double radius,
+              std::list<std::string>* storage,
+              std::vector<attribute_check>* checks)
+{
+    const hyperdatatype t = sc.attrs[attr].type;
+
+    for (int i = 0; i < 2; ++i)
+    {
+        double x = i == 0 ? center - radius : center + radius;
+        storage->push_back(std::string(sizeof(uint64_t), '\0'));
+
+        if (t == HYPERDATATYPE_FLOAT)
+        {
+            e::packdoublele(x, &storage->back()[0]);
+        }
+        else
+        {
+            x = i == 0 ? floor(x) : ceil(x);
+            int64_t v = x <= static_cast<double>(INT64_MIN) ? INT64_MIN
+                      : x >= static_cast<double>(INT64_MAX) ? INT64_MAX
+                      : static_cast<int64_t>(x);
+            e::pack64le(v, &storage->back()[0]);
+        }
+
+        attribute_check chk;
+        chk.attr = attr;
+        chk.value = e::slice(storage->back());
+        chk.datatype = t;
+        chk.predicate = i == 0 ? HYPERPREDICATE_GREATER_EQUAL : HYPERPREDICATE_LESS_EQUAL;
+        checks->push_back(chk);
+    }
+}
+
+} // namespace hyperdex
+
+void
+search_manager :: nearest_search(const server_id& from,
+                                 const virtual_server_id& to,
+                                 uint64_t nonce,
+                                 std::vector<attribute_check>* checks,
+                                 uint64_t limit,
+                                 uint16_t x_attr, double x,
+                                 uint16_t y_attr, double y,
+                                 uint64_t deadline)
+{
+    region_id ri(m_daemon->config().get_region_id(to));
+    const schema* sc = m_daemon->config().get_schema(ri);
+
+    if (sc->authorization)
+    {
+        return;
+    }
+
+    if (!nearest_attr(*sc, x_attr) || !nearest_attr(*sc, y_attr) ||
+        x_attr == y_attr || x != x || y != y)
+    {
+        limit = 0;
+    }
+
+    const hyperdatatype x_type = limit > 0 ? sc->attrs[x_attr].type : HYPERDATATYPE_GARBAGE;
+    const hyperdatatype y_type = limit > 0 ? sc->attrs[y_attr].type : HYPERDATATYPE_GARBAGE;
+    std::stable_sort(checks->begin(), checks->end());
+    datalayer::snapshot snap = m_daemon->m_data.make_snapshot(ri);
+    datalayer::reference scratch;
+    uint64_t scanned = 0;
+
+    // phase one:  the first "limit" objects that follow the point in a
+    // spatial index lie near it, so the farthest of them bounds how far the
+    // nearest "limit" can be.  Without an index, or with too few objects
+    // past the point, the second phase examines every object.
+    bool bounded = false;
+    double bound_sq = 0;
+
+    if (limit > 0)
+    {
+        std::vector<uint16_t> attrs;
+        attrs.push_back(x_attr);
+        attrs.push_back(y_attr);
+        std::vector<double> point;
+        point.push_back(x);
+        point.push_back(y);
+        e::intrusive_ptr<datalayer::iterator> seed;
+        seed = m_daemon->m_data.make_nearest_iterator(snap, ri, *checks, attrs, point);
+        uint64_t seen = 0;
+
+        while (seed && seen < limit && seed->valid())
+        {
+            if (expired(deadline, ++scanned))
+            {
+                return;
+            }
+
+            e::slice k;
+            std::vector<e::slice> value;
+            uint64_t version;
+
+            if (m_daemon->m_data.get_from_iterator(ri, *sc, seed.get(), &k, &value, &version, &scratch) == datalayer::SUCCESS)
+            {
+                double dx = nearest_coordinate(x_type, value[x_attr - 1]) - x;
+                double dy = nearest_coordinate(y_type, value[y_attr - 1]) - y;
+                double d = dx * dx + dy * dy;
+
+                if (d == d)
+                {
+                    bound_sq = std::max(bound_sq, d);
+                    ++seen;
+                }
+            }
+
+            seed->next();
+        }
+
+        bounded = seed && seen == limit;
+    }
+
+    // phase two:  keep the nearest "limit" objects within the box that
+    // encloses the bound; a spatial index over the attributes scans just it
+    std::list<std::string> bounds;
+
+    if (bounded)
+    {
+        // a little slack so rounding cannot drop an object on the boundary
+        double radius = sqrt(bound_sq) * (1 + 1e-9);
+        nearest_bound(*sc, x_attr, x, radius, &bounds, checks);
+        nearest_bound(*sc, y_attr, y, radius, &bounds, checks);
+        std::stable_sort(checks->begin(), checks->end());
+    }
+
+    e::intrusive_ptr<datalayer::iterator> iter;
+    iter = m_daemon->m_data.make_search_iterator(snap, ri, *checks, NULL);
+    // a heap whose front is the farthest candidate kept
+    std::vector<std::pair<double, std::string> > top_n;
+
+    while (limit > 0 && iter->valid())
+    {
+        if (expired(deadline, ++scanned))
+        {
+            return;
+        }
+
+        e::slice k;
+        std::vector<e::slice> value;
+        uint64_t version;
+
+        if (m_daemon->m_data.get_from_iterator(ri, *sc, iter.get(), &k, &value, &version, &scratch) != datalayer::SUCCESS)
+        {
+            iter->next();
+            continue;
+        }
+
+        double dx = nearest_coordinate(x_type, value[x_attr - 1]) - x;
+        double dy = nearest_coordinate(y_type, value[y_attr - 1]) - y;
+        double d = dx * dx + dy * dy;
+
+        if (d != d || (top_n.size() == limit && d > top_n.front().first))
+        {
+            iter->next();
+            continue;
+        }
+
+        std::pair<double, std::string> c(d, std::string(reinterpret_cast<const char*>(k.data()), k.size()));
+
+        if (top_n.size() < limit)
+        {
+            top_n.push_back(c);
+            std::push_heap(top_n.begin(), top_n.end());
+        }
+        else if (c < top_n.front())
+        {
+            std::pop_heap(top_n.begin(), top_n.end());
+            top_n.back() = c;
+            std::push_heap(top_n.begin(), top_n.end());
+        }
+
+        iter->next();
+    }
+
+    std::sort(top_n.begin(), top_n.end());
+    std::vector<std::string> keys(top_n.size());
+
+    for (size_t i = 0; i < top_n.size(); ++i)
+    {
+        keys[i].swap(top_n[i].second);
+    }
+
+    std::vector<e::slice> objkeys;
+    std::vector<std::vector<e::slice> > values;
+    std::vector<datalayer::reference> refs;
+    size_t sz = HYPERDEX_HEADER_SIZE_VC + sizeof(uint64_t) + sizeof(uint64_t)
+              + read_sorted(&m_daemon->m_data, snap, ri, keys, 0, keys.size(),
+                            &objkeys, &values, &refs);
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
+    pa = pa << nonce << static_cast<uint64_t>(objkeys.size());
+
+    for (size_t i = 0; i < objkeys.size(); ++i)
+    {
+        pa = pa << objkeys[i] << values[i];
+    }
+
+    m_daemon->m_comm.send_client(to, from, RESP_NEAREST_SEARCH, msg);
+}
+
+void
+search_manager :: changes_start(const server_id& from,
+                                const virtual_server_id& to,
+                                uint64_t nonce,
+                                uint64_t stream_id,
+                                uint64_t checkpoint,
+                                uint32_t max_objects,
+                                uint32_t max_bytes,
+                                bool compress)
+{
+    region_id ri(m_daemon->config().get_region_id(to));
+    const schema* sc = m_daemon->config().get_schema(ri);
+
+    if (sc->authorization)
+    {
+        return;
+    }
+
+    id sid(ri, from, stream_id);
+
+    if (m_changes.contains(sid))
+    {
+        LOG(WARNING) << "received request for change stream " << stream_id << " from client "
+                     << from << " but the stream is already in progress";
+        return;
+    }
+
+    // a region on its way out has no history worth replaying
+    if (m_daemon->m_data.region_will_be_wiped(ri))
+    {
+        std::auto_ptr<e::buffer> msg(e::buffer::create(HYPERDEX_HEADER_SIZE_VC + sizeof(uint64_t)));
+        msg->pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce;
+        m_daemon->m_comm.send_client(to, from, RESP_SEARCH_DONE, msg);
+        return;
+    }
+
+    // taken before the replay starts, so every write the stream could miss
+    // comes after it
+    uint64_t resume = 0;
+    m_daemon->m_data.largest_checkpoint_for(ri, &resume);
+    bool wipe = false;
+    datalayer::replay_iterator* iter;
+    iter = m_daemon->m_data.replay_region_from_checkpoint(ri, checkpoint, &wipe);
+    e::intrusive_ptr<changes_state> st = new changes_state(ri, iter, resume, compress);
+    m_changes.insert(sid, st);
+    changes_next(from, to, nonce, stream_id, max_objects, max_bytes);
+}
+
+void
+search_manager :: changes_next(const server_id& from,
+                               const virtual_server_id& to,
+                               uint64_t nonce,
+                               uint64_t stream_id,
+                               uint32_t max_objects,
+                               uint32_t max_bytes)
+{
+    region_id ri(m_daemon->config().get_region_id(to));
+    id sid(ri, from, stream_id);
+    e::intrusive_ptr<changes_state> st;
+
+    if (!m_changes.lookup(sid, &st))
+    {
+        std::auto_ptr<e::buffer> msg(e::buffer::create(HYPERDEX_HEADER_SIZE_VC + sizeof(uint64_t)));
+        msg->pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce;
+        m_daemon->m_comm.send_client(to, from, RESP_SEARCH_DONE, msg);
+        return;
+    }
+
+    changes_batch(from, to, nonce, stream_id, st.get(),
+                  std::max(std::min(max_objects, SEARCH_BATCH_MAX_OBJECTS), uint32_t(1)),
+                  std::min(max_bytes, SEARCH_BATCH_MAX_BYTES));
+}
+
+void
+search_manager :: changes_batch(const server_id& from,
+                                const virtual_server_id& to,
+                                uint64_t nonce,
+                                uint64_t stream_id,
+                                changes_state* st,
+                                uint32_t max_objects,
+                                uint32_t max_bytes)
+{
+    // as in next_batch, the prefix is filled in once the count is known
+    const size_t prefix_sz = sizeof(uint64_t) + sizeof(uint8_t)
+                           + sizeof(uint64_t) + sizeof(uint32_t);
+    message_builder mb(HYPERDEX_HEADER_SIZE_VC,
+                       prefix_sz + std::min(max_bytes, SEARCH_BATCH_INITIAL_BYTES));
+    mb.append(prefix_sz);
+    std::vector<e::slice> val;
+    datalayer::reference ref;
+    uint32_t count = 0;
+    size_t budget = 0;
+    bool done = false;
+
+    {
+        profiled_mutex::hold hold(&st->lock);
+
+        // always send at least one change, even if it busts the byte budget
+        while (st->iter->valid() &&
+               count < max_objects &&
+               (count == 0 || budget < max_bytes))
+        {
+            e::slice key = st->iter->key();
+
+            if (!st->iter->has_value())
+            {
+                size_t chg_sz = sizeof(uint8_t) + pack_size(key) + sizeof(uint64_t);
+                mb.append(chg_sz) << uint8_t(0) << key << uint64_t(0);
+                budget += chg_sz;
+                ++count;
+                st->iter->next();
+                continue;
+            }
+
+            uint64_t ver;
+            datalayer::returncode rc = st->iter->unpack_value(&val, &ver, &ref);
+
+            // NOT_FOUND is a version whose chunks a later write replaced; the
+            // stream carries that write instead
+            if (rc != datalayer::SUCCESS)
+            {
+                if (rc != datalayer::NOT_FOUND)
+                {
+                    LOG(ERROR) << "could not read object for change stream: " << rc;
+                }
+
+                st->iter->next();
+                continue;
+            }
+
+            // unpack_value decodes the key again, into the same place
+            key = st->iter->key();
+            size_t chg_sz = sizeof(uint8_t) + pack_size(key)
+                          + sizeof(uint64_t) + pack_size(val);
+            mb.append(chg_sz) << uint8_t(1) << key << ver << val;
+            budget += chg_sz;
+            ++count;
+            st->iter->next();
+        }
+
+        done = !st->iter->valid();
+
+        if (done && !st->iter->status().ok())
+        {
+            LOG(ERROR) << "change stream for " << st->region << " cut short: "
+                       << st->iter->status().ToString();
+        }
+    }
+
+    mb.pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce
+                                        << static_cast<uint8_t>(done ? 1 : 0)
+                                        << st->resume
+                                        << count;
+    std::auto_ptr<e::buffer> msg(mb.finish());
+    const size_t raw_off = HYPERDEX_HEADER_SIZE_VC + sizeof(uint64_t);
+    std::vector<char> compressed;
+
+    if (st->compress &&
+        compress(e::slice(msg->data() + raw_off, msg->size() - raw_off), &compressed))
+    {
+        // the nonce stays in the clear so the client can route the reply
+        size_t csz = raw_off + sizeof(uint32_t)
+                   + sizeof(uint32_t) + compressed.size();
+        std::auto_ptr<e::buffer> cmsg(e::buffer::create(csz));
+        cmsg->pack_at(HYPERDEX_HEADER_SIZE_VC)
+            << nonce
+            << static_cast<uint32_t>(msg->size() - raw_off)
+            << e::slice(&compressed[0], compressed.size());
+        m_daemon->m_comm.send_client(to, from, RESP_CHANGES_COMPRESSED, cmsg);
+    }
+    else
+    {
+        m_daemon->m_comm.send_client(to, from, RESP_CHANGES_BATCH, msg);
+    }
+
+    if (done)
+    {
+        changes_stop(from, to, stream_id);
+    }
+}
+
+void
+search_manager :: changes_stop(const server_id& from,
+                               const virtual_server_id& to,
+                               uint64_t stream_id)
+{
+    region_id ri(m_daemon->config().get_region_id(to));
+    id sid(ri, from, stream_id);
+    m_changes.remove(sid);
+}
+
+void
+search_manager :: group_keyop(const server_id& from,
+                              const virtual_server_id& to,
+                              uint64_t nonce,
+                              std::vector<attribute_check>* checks,
+                              network_msgtype mt,
+                              const e::slice& remain,
+                              network_msgtype resp)
+{
+    assert(mt == REQ_ATOMIC);
+    region_id ri(m_daemon->config().get_region_id(to));
+    const schema* sc = m_daemon->config().get_schema(ri);
+
+    if (sc->authorization)
+    {
+        return;
+    }
+
+    std::stable_sort(checks->begin(), checks->end());
+    datalayer::returncode rc = datalayer::SUCCESS;
+    datalayer::snapshot snap = m_daemon->m_data.make_snapshot(ri);
+    e::intrusive_ptr<datalayer::iterator> iter;
+    iter = m_daemon->m_data.make_search_iterator(snap, ri, *checks, NULL);
     uint64_t result = 0;
 
     switch (rc)
@@ -541,59 +1701,208 @@ search_manager :: group_keyop(const server_id& from,
             abort();
     }
 
+    const uint64_t start = po6::monotonic_time();
+    group_batches batches;
+
     while (iter->valid() && result < UINT64_MAX)
     {
-        e::slice key;
-        std::vector<e::slice> val;
-        uint64_t ver;
-        datalayer::reference tmp;
-        m_daemon->m_data.get_from_iterator(ri, *sc, iter.get(), &key, &val, &ver, &tmp);
+        e::slice key = iter->key();
+        virtual_server_id vsi = m_daemon->config().point_leader(ri, key);
+        server_id si = m_daemon->config().get_server_id(vsi);
+
+        if (vsi == virtual_server_id() || si == server_id())
+        {
+            iter->next();
+            continue;
+        }
+
+        if (si == m_daemon->m_us)
+        {
+            // we lead this key too, so skip the network entirely
+            size_t sz = HYPERDEX_HEADER_SIZE_SV // SV because we imitate a client
+                      + sizeof(uint64_t)
+                      + pack_size(key)
+                      + remain.size();
+            std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+            msg->pack_at(HYPERDEX_HEADER_SIZE_SV)
+                << uint64_t(0) << key << e::pack_memmove(remain.data(), remain.size());
+            std::auto_ptr<key_change> kc(new key_change());
+            e::unpacker up = msg->unpack_from(HYPERDEX_HEADER_SIZE_SV + sizeof(uint64_t));
+            up = up >> *kc;
+
+            if (!up.error())
+            {
+                m_daemon->m_repl.client_atomic(m_daemon->m_us, vsi, 0, kc, msg);
+            }
+        }
+        else
+        {
+            group_batch* batch = &batches[si];
+            batch->vsis.push_back(vsi);
+            batch->keys.push_back(std::string(key.cdata(), key.size()));
+
+            if (batch->vsis.size() >= GROUP_KEYOP_BATCH_OPS)
+            {
+                send_group_batch(to, si, remain, batch);
+            }
+        }
+
+        ++result;
+
+        if (result % GROUP_KEYOP_PROGRESS_INTERVAL == 0)
+        {
+            LOG(INFO) << "group operation on " << ri << " has issued " << result
+                      << " ops in " << (po6::monotonic_time() - start) / 1000000ULL << "ms";
+        }
+
+        iter->next();
+    }
+
+    for (group_batches::iterator it = batches.begin(); it != batches.end(); ++it)
+    {
+        send_group_batch(to, it->first, remain, &it->second);
+    }
+
+    size_t sz = HYPERDEX_HEADER_SIZE_VC
+              + sizeof(uint64_t)
+              + sizeof(uint64_t);
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    msg->pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce << result;
+    m_daemon->m_comm.send_client(to, from, resp, msg);
+}
+
+void
+search_manager :: send_group_batch(const virtual_server_id& from,
+                                   const server_id& to,
+                                   const e::slice& remain,
+                                   group_batch* batch)
+{
+    if (batch->vsis.empty())
+    {
+        return;
+    }
+
+    // each entry looks like the body of a lone REQ_ATOMIC
+    size_t sz = HYPERDEX_HEADER_SIZE_VV
+              + sizeof(uint32_t);
+
+    for (size_t i = 0; i < batch->vsis.size(); ++i)
+    {
+        sz += sizeof(uint64_t)
+            + sizeof(uint32_t)
+            + sizeof(uint64_t)
+            + sizeof(uint32_t) + batch->keys[i].size()
+            + remain.size();
+    }
+
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VV);
+    pa = pa << static_cast<uint32_t>(batch->vsis.size());
+
+    for (size_t i = 0; i < batch->vsis.size(); ++i)
+    {
+        const std::string& key(batch->keys[i]);
+        uint32_t body_sz = sizeof(uint64_t)
+                         + sizeof(uint32_t) + key.size()
+                         + remain.size();
+        pa = pa << batch->vsis[i] << body_sz
+                << uint64_t(0) << e::slice(key)
+                << e::pack_memmove(remain.data(), remain.size());
+    }
+
+    m_daemon->m_comm.send(from, to, REQ_ATOMIC_BATCH, msg);
+    batch->vsis.clear();
+    batch->keys.clear();
+}
+
+void
+search_manager :: reclaim_expired(const region_id& ri)
+{
+    const schema* sc = m_daemon->config().get_schema(ri);
+
+    // the deletes carry no wallet to authorize them
+    if (sc->expiry == 0 || sc->authorization)
+    {
+        return;
+    }
+
+    e::arena memory;
+    key_change kc;
+    kc.erase = true;
+    expired_checks(*sc, expiry_now(), &memory, &kc.checks);
+    std::stable_sort(kc.checks.begin(), kc.checks.end());
+    datalayer::snapshot snap = m_daemon->m_data.make_snapshot(ri);
+    e::intrusive_ptr<datalayer::iterator> iter;
+    iter = m_daemon->m_data.make_search_iterator(snap, ri, kc.checks, NULL, true);
+    uint64_t reclaimed = 0;
+
+    while (iter->valid() && reclaimed < EXPIRY_SWEEP_MAX_DELETES)
+    {
+        kc.key = iter->key();
         size_t sz = HYPERDEX_HEADER_SIZE_SV // SV because we imitate a client
                   + sizeof(uint64_t)
-                  + pack_size(key)
-                  + remain.size();
+                  + pack_size(kc);
         std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
-        msg->pack_at(HYPERDEX_HEADER_SIZE_SV)
-            << uint64_t(0) << key << e::pack_memmove(remain.data(), remain.size());
-        virtual_server_id vsi = m_daemon->m_config.point_leader(ri, key);
+        msg->pack_at(HYPERDEX_HEADER_SIZE_SV) << uint64_t(0) << kc;
+        virtual_server_id vsi = m_daemon->config().point_leader(ri, kc.key);
 
         if (vsi != virtual_server_id())
         {
-            m_daemon->m_comm.send(vsi, mt, msg);
-            result++;
+            m_daemon->m_comm.send(vsi, REQ_ATOMIC, msg);
+            ++reclaimed;
         }
 
         iter->next();
     }
+}
 
+void
+search_manager :: send_count(const server_id& from,
+                             const virtual_server_id& to,
+                             uint64_t nonce,
+                             uint64_t result)
+{
     size_t sz = HYPERDEX_HEADER_SIZE_VC
               + sizeof(uint64_t)
               + sizeof(uint64_t);
     std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
     msg->pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce << result;
-    m_daemon->m_comm.send_client(to, from, resp, msg);
+    m_daemon->m_comm.send_client(to, from, RESP_COUNT, msg);
 }
 
 void
 search_manager :: count(const server_id& from,
                         const virtual_server_id& to,
                         uint64_t nonce,
-                        std::vector<attribute_check>* checks)
+                        std::vector<attribute_check>* checks,
+                        uint64_t deadline,
+                        const datalayer::snapshot* shared)
 {
-    region_id ri(m_daemon->m_config.get_region_id(to));
-    const schema* sc = m_daemon->m_config.get_schema(ri);
+    region_id ri(m_daemon->config().get_region_id(to));
+    const schema* sc = m_daemon->config().get_schema(ri);
 
     if (sc->authorization)
     {
         return;
     }
 
+    uint64_t result = 0;
+
+    // with nothing to check, the maintained count is the answer, unless
+    // some of the objects it counts have expired
+    if (checks->empty() && sc->expiry == 0 &&
+        m_daemon->m_data.object_count(ri, &result) == datalayer::SUCCESS)
+    {
+        send_count(from, to, nonce, result);
+        return;
+    }
+
+    result = 0;
     std::stable_sort(checks->begin(), checks->end());
     datalayer::returncode rc = datalayer::SUCCESS;
-    datalayer::snapshot snap = m_daemon->m_data.make_snapshot();
+    datalayer::snapshot snap = shared ? *shared : m_daemon->m_data.make_snapshot(ri);
     e::intrusive_ptr<datalayer::iterator> iter;
     iter = m_daemon->m_data.make_search_iterator(snap, ri, *checks, NULL);
-    uint64_t result = 0;
 
     switch (rc)
     {
@@ -613,26 +1922,322 @@ search_manager :: count(const server_id& from,
 
     while (iter->valid() && result < UINT64_MAX)
     {
-        ++result;
+        if (expired(deadline, ++result))
+        {
+            return;
+        }
+
+        iter->next();
+    }
+
+    send_count(from, to, nonce, result);
+}
+
+void
+search_manager :: approximate_count(const server_id& from,
+                                    const virtual_server_id& to,
+                                    uint64_t nonce,
+                                    std::vector<attribute_check>* checks,
+                                    uint64_t samples,
+                                    uint64_t deadline)
+{
+    region_id ri(m_daemon->config().get_region_id(to));
+    const schema* sc = m_daemon->config().get_schema(ri);
+
+    if (sc->authorization)
+    {
+        return;
+    }
+
+    uint64_t result = 0;
+
+    if (checks->empty() &&
+        m_daemon->m_data.object_count(ri, &result) == datalayer::SUCCESS)
+    {
+        send_count(from, to, nonce, result);
+        return;
+    }
+
+    result = 0;
+    std::stable_sort(checks->begin(), checks->end());
+    datalayer::snapshot snap = m_daemon->m_data.make_snapshot(ri);
+    e::intrusive_ptr<datalayer::iterator> iter;
+    iter = m_daemon->m_data.make_search_iterator(snap, ri, *checks, NULL);
+    samples = std::max(samples, uint64_t(1));
+
+    // count exactly until there are enough samples and LevelDB can say how
+    // far through the candidates they reach; extrapolate from there
+    while (iter->valid() && result < UINT64_MAX)
+    {
+        if (expired(deadline, ++result))
+        {
+            return;
+        }
+
+        iter->next();
+
+        if (result % samples == 0 && iter->valid())
+        {
+            double progress = iter->progress(snap.db());
+
+            if (progress > 0)
+            {
+                result = static_cast<uint64_t>(result / progress);
+                break;
+            }
+        }
+    }
+
+    send_count(from, to, nonce, result);
+}
+
+struct _aggregate_cell
+{
+    _aggregate_cell() : i(0), d(0) {}
+    int64_t i;
+    double d;
+};
+
+struct _aggregate_group
+{
+    _aggregate_group() : count(0), cells() {}
+    uint64_t count;
+    std::vector<_aggregate_cell> cells;
+};
+
+void
+search_manager :: aggregate(const server_id& from,
+                            const virtual_server_id& to,
+                            uint64_t nonce,
+                            std::vector<attribute_check>* checks,
+                            uint16_t group_by,
+                            const std::vector<std::pair<uint16_t, uint8_t> >& aggs,
+                            uint64_t deadline)
+{
+    region_id ri(m_daemon->config().get_region_id(to));
+    const schema* sc = m_daemon->config().get_schema(ri);
+
+    if (sc->authorization)
+    {
+        return;
+    }
+
+    if (aggs.size() > HYPERDEX_AGGREGATE_MAX_FUNCTIONS ||
+        group_by >= sc->attrs_sz ||
+        (group_by > 0 && sc->attrs[group_by].type != HYPERDATATYPE_STRING))
+    {
+        LOG(WARNING) << "dropping malformed aggregation from " << from;
+        return;
+    }
+
+    std::vector<char> is_float(aggs.size(), 0);
+    bool need_value = group_by > 0;
+
+    for (size_t i = 0; i < aggs.size(); ++i)
+    {
+        hyperdatatype t = aggs[i].first < sc->attrs_sz
+                        ? sc->attrs[aggs[i].first].type
+                        : HYPERDATATYPE_GARBAGE;
+
+        if (aggs[i].second < AGGREGATE_SUM || aggs[i].second > AGGREGATE_AVG ||
+            (t != HYPERDATATYPE_INT64 && t != HYPERDATATYPE_FLOAT &&
+             CONTAINER_TYPE(t) != HYPERDATATYPE_TIMESTAMP_GENERIC))
+        {
+            LOG(WARNING) << "dropping malformed aggregation from " << from;
+            return;
+        }
+
+        is_float[i] = t == HYPERDATATYPE_FLOAT ? 1 : 0;
+        need_value = need_value || aggs[i].first > 0;
+    }
+
+    std::stable_sort(checks->begin(), checks->end());
+    datalayer::returncode rc = datalayer::SUCCESS;
+    datalayer::snapshot snap = m_daemon->m_data.make_snapshot(ri);
+    e::intrusive_ptr<datalayer::iterator> iter;
+    iter = m_daemon->m_data.make_search_iterator(snap, ri, *checks, NULL);
+    uint8_t status = AGGREGATE_OK;
+
+    switch (rc)
+    {
+        case datalayer::SUCCESS:
+            break;
+        case datalayer::NOT_FOUND:
+        case datalayer::BAD_ENCODING:
+        case datalayer::CORRUPTION:
+        case datalayer::IO_ERROR:
+        case datalayer::LEVELDB_ERROR:
+            LOG(ERROR) << "could not make snapshot for search:  " << rc;
+            status = AGGREGATE_FAILED;
+            break;
+        default:
+            abort();
+    }
+
+    // the partials stay next to the data; only one row per group travels
+    std::map<std::string, _aggregate_group> groups;
+    std::string group;
+    uint64_t scanned = 0;
+    datalayer::reference scratch;
+
+    while (status == AGGREGATE_OK && iter->valid())
+    {
+        if (expired(deadline, ++scanned))
+        {
+            return;
+        }
+
+        e::slice key = iter->key();
+        std::vector<e::slice> value;
+
+        if (need_value)
+        {
+            e::slice k;
+            uint64_t version;
+            rc = m_daemon->m_data.get_from_iterator(ri, *sc, iter.get(), &k, &value, &version, &scratch);
+
+            if (rc != datalayer::SUCCESS || value.size() + 1 != sc->attrs_sz)
+            {
+                iter->next();
+                continue;
+            }
+        }
+
+        if (group_by > 0)
+        {
+            const e::slice& g(value[group_by - 1]);
+            group.assign(reinterpret_cast<const char*>(g.data()), g.size());
+        }
+
+        std::map<std::string, _aggregate_group>::iterator it = groups.find(group);
+
+        if (it == groups.end())
+        {
+            if (groups.size() >= HYPERDEX_AGGREGATE_MAX_GROUPS)
+            {
+                status = AGGREGATE_TOO_MANY_GROUPS;
+                break;
+            }
+
+            it = groups.insert(std::make_pair(group, _aggregate_group())).first;
+            it->second.cells.resize(aggs.size());
+        }
+
+        _aggregate_group* grp = &it->second;
+
+        for (size_t i = 0; i < aggs.size(); ++i)
+        {
+            const e::slice& attr(aggs[i].first == 0 ? key : value[aggs[i].first - 1]);
+            _aggregate_cell* c = &grp->cells[i];
+
+            if (is_float[i])
+            {
+                double x = datatype_float::unpack(attr);
+
+                switch (aggs[i].second)
+                {
+                    case AGGREGATE_SUM:
+                    case AGGREGATE_AVG:
+                        c->d += x;
+                        break;
+                    case AGGREGATE_MIN:
+                        c->d = grp->count == 0 || x < c->d ? x : c->d;
+                        break;
+                    case AGGREGATE_MAX:
+                        c->d = grp->count == 0 || x > c->d ? x : c->d;
+                        break;
+                    default:
+                        abort();
+                }
+            }
+            else
+            {
+                int64_t x = datatype_int64::unpack(attr);
+
+                switch (aggs[i].second)
+                {
+                    case AGGREGATE_SUM:
+                    case AGGREGATE_AVG:
+                        if ((x > 0 && c->i > INT64_MAX - x) ||
+                            (x < 0 && c->i < INT64_MIN - x))
+                        {
+                            status = AGGREGATE_OVERFLOW;
+                        }
+                        else
+                        {
+                            c->i += x;
+                        }
+
+                        break;
+                    case AGGREGATE_MIN:
+                        c->i = grp->count == 0 || x < c->i ? x : c->i;
+                        break;
+                    case AGGREGATE_MAX:
+                        c->i = grp->count == 0 || x > c->i ? x : c->i;
+                        break;
+                    default:
+                        abort();
+                }
+            }
+        }
+
+        ++grp->count;
         iter->next();
     }
 
+    if (status != AGGREGATE_OK)
+    {
+        groups.clear();
+    }
+
     size_t sz = HYPERDEX_HEADER_SIZE_VC
               + sizeof(uint64_t)
-              + sizeof(uint64_t);
+              + sizeof(uint8_t)
+              + sizeof(uint32_t);
+
+    for (std::map<std::string, _aggregate_group>::iterator it = groups.begin();
+            it != groups.end(); ++it)
+    {
+        sz += pack_size(e::slice(it->first))
+            + sizeof(uint64_t)
+            + sizeof(uint64_t) * aggs.size();
+    }
+
     std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
-    msg->pack_at(HYPERDEX_HEADER_SIZE_VC) << nonce << result;
-    m_daemon->m_comm.send_client(to, from, RESP_COUNT, msg);
+    e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VC);
+    pa = pa << nonce << status << static_cast<uint32_t>(groups.size());
+
+    for (std::map<std::string, _aggregate_group>::iterator it = groups.begin();
+            it != groups.end(); ++it)
+    {
+        pa = pa << e::slice(it->first) << it->second.count;
+
+        for (size_t i = 0; i < aggs.size(); ++i)
+        {
+            // floats travel as their bit pattern; the client knows the types
+            uint64_t bits = static_cast<uint64_t>(it->second.cells[i].i);
+
+            if (is_float[i])
+            {
+                memmove(&bits, &it->second.cells[i].d, sizeof(bits));
+            }
+
+            pa = pa << bits;
+        }
+    }
+
+    m_daemon->m_comm.send_client(to, from, RESP_AGGREGATE, msg);
 }
 
 void
 search_manager :: search_describe(const server_id& from,
                                   const virtual_server_id& to,
                                   uint64_t nonce,
-                                  std::vector<attribute_check>* checks)
+                                  std::vector<attribute_check>* checks,
+                                  uint64_t deadline)
 {
-    region_id ri(m_daemon->m_config.get_region_id(to));
-    const schema* sc = m_daemon->m_config.get_schema(ri);
+    region_id ri(m_daemon->config().get_region_id(to));
+    const schema* sc = m_daemon->config().get_schema(ri);
 
     if (sc->authorization)
     {
@@ -644,7 +2249,7 @@ search_manager :: search_describe(const server_id& from,
     std::ostringstream ostr;
     ostr << "search\n";
     uint64_t t_start = po6::monotonic_time();
-    datalayer::snapshot snap = m_daemon->m_data.make_snapshot();
+    datalayer::snapshot snap = m_daemon->m_data.make_snapshot(ri);
     uint64_t t_end = po6::monotonic_time();
     ostr << " snapshot took " << t_end - t_start << "ns\n";
     e::intrusive_ptr<datalayer::iterator> iter;
@@ -673,12 +2278,18 @@ search_manager :: search_describe(const server_id& from,
 
     while (iter->valid())
     {
-        ++num;
+        if (expired(deadline, ++num))
+        {
+            return;
+        }
+
         iter->next();
     }
 
     t_end = po6::monotonic_time();
     ostr << " retrieved " << num << " objects in " << t_end - t_start << "ns\n";
+    ostr << " executed\n";
+    iter->analyze(ostr, "  ");
     std::string str(ostr.str());
     const char* text = str.c_str();
     size_t text_sz = strlen(text);
@@ -691,8 +2302,133 @@ search_manager :: search_describe(const server_id& from,
     m_daemon->m_comm.send_client(to, from, RESP_SEARCH_DESCRIBE, msg);
 }
 
+bool
+search_manager :: expired(uint64_t deadline, uint64_t scanned)
+{
+    if (deadline == 0 ||
+        scanned % SEARCH_DEADLINE_INTERVAL != 0 ||
+        po6::monotonic_time() <= deadline)
+    {
+        return false;
+    }
+
+    m_daemon->m_perf_req_expired.tap();
+    return true;
+}
+
 uint64_t
 search_manager :: hash(const id& sid)
 {
     return sid.region.get() + sid.client.get() + sid.search_id;
 }
+
+void
+search_manager :: open_lease(const id& sid)
+{
+    uint64_t now = po6::monotonic_time();
+    std::vector<id> doomed;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect_leases);
+        lease_map::iterator it = m_leases.find(sid);
+
+        if (it != m_leases.end())
+        {
+            it->second = lease(now);
+            return;
+        }
+
+        std::map<server_id, uint64_t>::iterator pc = m_leases_per_client.find(sid.client);
+        lease_map::iterator victim = m_leases.end();
+
+        if (pc != m_leases_per_client.end() && pc->second >= SEARCH_MAX_PER_CLIENT)
+        {
+            victim = least_recent(&sid.client);
+        }
+        else if (m_leases.size() >= SEARCH_MAX_OPEN)
+        {
+            victim = least_recent(NULL);
+        }
+
+        if (victim != m_leases.end())
+        {
+            doomed.push_back(victim->first);
+            drop_lease(victim);
+        }
+
+        m_leases.insert(std::make_pair(sid, lease(now)));
+        ++m_leases_per_client[sid.client];
+    }
+
+    close_searches(doomed);
+    m_perf_evicted.add(doomed.size());
+}
+
+void
+search_manager :: touch_lease(const id& sid)
+{
+    uint64_t now = po6::monotonic_time();
+    po6::threads::mutex::hold hold(&m_protect_leases);
+    lease_map::iterator it = m_leases.find(sid);
+
+    if (it != m_leases.end())
+    {
+        it->second.touched = now;
+    }
+}
+
+void
+search_manager :: close_lease(const id& sid)
+{
+    po6::threads::mutex::hold hold(&m_protect_leases);
+    lease_map::iterator it = m_leases.find(sid);
+
+    if (it != m_leases.end())
+    {
+        drop_lease(it);
+    }
+}
+
+search_manager::lease_map::iterator
+search_manager :: least_recent(const server_id* client)
+{
+    lease_map::iterator lru = m_leases.end();
+
+    for (lease_map::iterator it = m_leases.begin(); it != m_leases.end(); ++it)
+    {
+        if (client && it->first.client != *client)
+        {
+            continue;
+        }
+
+        if (lru == m_leases.end() || it->second.touched < lru->second.touched)
+        {
+            lru = it;
+        }
+    }
+
+    return lru;
+}
+
+void
+search_manager :: drop_lease(lease_map::iterator it)
+{
+    std::map<server_id, uint64_t>::iterator pc = m_leases_per_client.find(it->first.client);
+
+    if (pc != m_leases_per_client.end() && --pc->second == 0)
+    {
+        m_leases_per_client.erase(pc);
+    }
+
+    m_leases.erase(it);
+}
+
+void
+search_manager :: close_searches(const std::vector<id>& sids)
+{
+    for (size_t i = 0; i < sids.size(); ++i)
+    {
+        m_searches.remove(sids[i]);
+        m_sorted_searches.remove(sids[i]);
+    }
+}
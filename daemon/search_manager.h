@@ -28,6 +28,12 @@
 #ifndef hyperdex_daemon_search_manager_h_
 #define hyperdex_daemon_search_manager_h_
 
+// STL
+#include <map>
+
+// po6
+#include <po6/threads/mutex.h>
+
 // e
 #include <e/intrusive_ptr.h>
 #include <e/lockfree_hash_map.h>
@@ -37,6 +43,7 @@
 #include "common/ids.h"
 #include "common/network_msgtype.h"
 #include "daemon/datalayer.h"
+#include "daemon/performance_counter.h"
 #include "daemon/reconfigure_returncode.h"
 
 BEGIN_HYPERDEX_NAMESPACE
@@ -56,32 +63,120 @@ class search_manager
         void reconfigure(const configuration& old_config,
                          const configuration& new_config,
                          const server_id& us);
+        // close the searches and sorted searches no client has asked for
+        // more of in a while, releasing the snapshots they pin
+        void reap_idle();
+        // how many searches are open, how long ago (in nanoseconds) the
+        // oldest of them took its snapshot, and how many were closed for
+        // sitting idle or to stay within the caps on open searches
+        void open_stats(uint64_t* open, uint64_t* oldest,
+                        uint64_t* reaped, uint64_t* evicted);
 
     public:
+        // start, sorted_search and count read from "shared" when given one, so
+        // that the regions of one REQ_SEARCH_MULTI all see the same data;
+        // otherwise each takes a snapshot of its own
         void start(const server_id& from,
                    const virtual_server_id& to,
                    std::auto_ptr<e::buffer> msg,
                    uint64_t nonce,
                    uint64_t search_id,
-                   std::vector<attribute_check>* checks);
+                   std::vector<attribute_check>* checks,
+                   uint32_t max_objects,
+                   uint32_t max_bytes,
+                   uint64_t limit,
+                   bool compress,
+                   uint64_t sample,
+                   uint64_t seed,
+                   uint64_t deadline,
+                   const datalayer::snapshot* shared = NULL);
+        // When max_objects is zero the client predates batching and gets one
+        // RESP_SEARCH_ITEM per call; otherwise up to max_objects objects (or
+        // roughly max_bytes of them) are returned in one RESP_SEARCH_BATCH.
+        // With compress (given to start), batches that shrink go out as
+        // RESP_SEARCH_COMPRESSED instead.  A nonzero sample (also given to
+        // start) batches only the matches whose keys hash below it under seed,
+        // and the objects of the rest are never read.
+        // Past the deadline (a monotonic time, or 0 for none) the batch is
+        // cut short; the scans below are abandoned without a reply.
         void next(const server_id& from,
                   const virtual_server_id& to,
                   uint64_t nonce,
-                  uint64_t search_id);
+                  uint64_t search_id,
+                  uint32_t max_objects,
+                  uint32_t max_bytes,
+                  uint64_t deadline);
         void stop(const server_id& from,
                   const virtual_server_id& to,
                   uint64_t search_id);
+        // When chunk is zero the whole result goes out in one
+        // RESP_SORTED_SEARCH; otherwise it is streamed chunk objects at a
+        // time in RESP_SORTED_SEARCH_CHUNKs, best first.  A cursor (the sort
+        // attribute and key of the last object a previous page returned)
+        // restricts the results to those that sort after it.  With
+        // compress, results and chunks that shrink go out as
+        // RESP_SEARCH_COMPRESSED instead.
         void sorted_search(const server_id& from,
                            const virtual_server_id& to,
                            uint64_t nonce,
                            std::vector<attribute_check>* checks,
                            uint64_t limit,
                            uint16_t sort_by,
-                           bool maximize);
+                           bool maximize,
+                           uint64_t search_id,
+                           uint32_t chunk,
+                           bool compress,
+                           const e::slice* cursor_attr,
+                           const e::slice* cursor_key,
+                           uint64_t deadline,
+                           const datalayer::snapshot* shared = NULL);
+        void sorted_search_next(const server_id& from,
+                                const virtual_server_id& to,
+                                uint64_t nonce,
+                                uint64_t search_id);
+        // The "limit" objects nearest (x, y) by Euclidean distance over the
+        // two numeric attributes, nearest first, in one RESP_NEAREST_SEARCH.
+        // A spatial index over the attributes narrows the objects examined.
+        void nearest_search(const server_id& from,
+                            const virtual_server_id& to,
+                            uint64_t nonce,
+                            std::vector<attribute_check>* checks,
+                            uint64_t limit,
+                            uint16_t x_attr, double x,
+                            uint16_t y_attr, double y,
+                            uint64_t deadline);
+
+        // Stream the region's writes since "checkpoint" in the order they
+        // were made, as puts (with the new value) and deletes.  Each
+        // RESP_CHANGES_BATCH carries up to max_objects changes (or roughly
+        // max_bytes of them) and the checkpoint this server had when the
+        // stream began, from which a later stream picks up without missing
+        // a change.  A batch marked done has caught up with the region.
+        // With compress, batches that shrink go out as
+        // RESP_CHANGES_COMPRESSED instead.
+        void changes_start(const server_id& from,
+                           const virtual_server_id& to,
+                           uint64_t nonce,
+                           uint64_t stream_id,
+                           uint64_t checkpoint,
+                           uint32_t max_objects,
+                           uint32_t max_bytes,
+                           bool compress);
+        void changes_next(const server_id& from,
+                          const virtual_server_id& to,
+                          uint64_t nonce,
+                          uint64_t stream_id,
+                          uint32_t max_objects,
+                          uint32_t max_bytes);
+        void changes_stop(const server_id& from,
+                          const virtual_server_id& to,
+                          uint64_t stream_id);
 
         // Find keys that match the check and forward ops to the corresponding servers
         // Essentially this splits out the group operation in several seperate operations
-        // (by acting like it was a client)
+        // (by acting like it was a client).  Keys this server leads are applied
+        // in place; the rest go out in one REQ_ATOMIC_BATCH per server at a time.
+        // "mt" must be REQ_ATOMIC.
         void group_keyop(const server_id& from,
                          const virtual_server_id& to,
                          uint64_t nonce,
@@ -90,20 +185,53 @@ class search_manager
                          const e::slice& remain,
                          network_msgtype resp);
 
+        // Delete the region's expired objects by sending each key's point
+        // leader a delete that checks it is still expired, so a concurrent
+        // write that extends the object wins
+        void reclaim_expired(const region_id& ri);
+
         // Calculate the amount of entries that match the checks
         void count(const server_id& from,
                    const virtual_server_id& to,
                    uint64_t nonce,
-                   std::vector<attribute_check>* checks);
+                   std::vector<attribute_check>* checks,
+                   uint64_t deadline,
+                   const datalayer::snapshot* shared = NULL);
+
+        // Estimate the amount of entries that match the checks from the first
+        // "samples" of them and how far through the index they reach
+        void approximate_count(const server_id& from,
+                               const virtual_server_id& to,
+                               uint64_t nonce,
+                               std::vector<attribute_check>* checks,
+                               uint64_t samples,
+                               uint64_t deadline);
+
+        // Compute partial aggregates over the entries that match the checks,
+        // grouped by the string attribute "group_by" (0 for no grouping)
+        void aggregate(const server_id& from,
+                       const virtual_server_id& to,
+                       uint64_t nonce,
+                       std::vector<attribute_check>* checks,
+                       uint16_t group_by,
+                       const std::vector<std::pair<uint16_t, uint8_t> >& aggs,
+                       uint64_t deadline);
 
         void search_describe(const server_id& from,
                              const virtual_server_id& to,
                              uint64_t nonce,
-                             std::vector<attribute_check>* checks);
+                             std::vector<attribute_check>* checks,
+                             uint64_t deadline);
 
     private:
         class id;
         class state;
+        class sorted_state;
+        class changes_state;
+        class group_batch;
+        class lease;
+        typedef std::map<server_id, group_batch> group_batches;
+        typedef std::map<id, lease> lease_map;
 
     private:
         search_manager(const search_manager&);
@@ -111,10 +239,68 @@ class search_manager
 
     private:
         static uint64_t hash(const id&);
+        void next_batch(const server_id& from,
+                        const virtual_server_id& to,
+                        uint64_t nonce,
+                        uint64_t search_id,
+                        state* st,
+                        uint32_t max_objects,
+                        uint32_t max_bytes,
+                        uint64_t deadline);
+        void sorted_chunk(const server_id& from,
+                          const virtual_server_id& to,
+                          uint64_t nonce,
+                          uint64_t search_id,
+                          sorted_state* st);
+        // send a page of search results as "type", wrapped in a
+        // RESP_SEARCH_COMPRESSED if "may_compress" and it shrinks
+        void send_page(const server_id& from,
+                       const virtual_server_id& to,
+                       network_msgtype type,
+                       uint64_t nonce,
+                       std::auto_ptr<e::buffer> msg,
+                       bool may_compress);
+        void changes_batch(const server_id& from,
+                           const virtual_server_id& to,
+                           uint64_t nonce,
+                           uint64_t stream_id,
+                           changes_state* st,
+                           uint32_t max_objects,
+                           uint32_t max_bytes);
+        // send "batch" to "to" as one REQ_ATOMIC_BATCH and empty it
+        void send_group_batch(const virtual_server_id& from,
+                              const server_id& to,
+                              const e::slice& remain,
+                              group_batch* batch);
+        void send_count(const server_id& from,
+                        const virtual_server_id& to,
+                        uint64_t nonce,
+                        uint64_t result);
+        // is a scan "scanned" objects in past its deadline?  only looks at
+        // the clock every so often
+        bool expired(uint64_t deadline, uint64_t scanned);
+        // track a newly opened search, first closing the least recently
+        // used one if the client or the server is at its cap
+        void open_lease(const id& sid);
+        void touch_lease(const id& sid);
+        void close_lease(const id& sid);
+        // the least recently used lease, of one client or of all of them;
+        // call with m_protect_leases held
+        lease_map::iterator least_recent(const server_id* client);
+        void drop_lease(lease_map::iterator it);
+        void close_searches(const std::vector<id>& sids);
 
     private:
         daemon* m_daemon;
         e::lockfree_hash_map<id, e::intrusive_ptr<state>, hash> m_searches;
+        e::lockfree_hash_map<id, e::intrusive_ptr<sorted_state>, hash> m_sorted_searches;
+        e::lockfree_hash_map<id, e::intrusive_ptr<changes_state>, hash> m_changes;
+        // when each open search and sorted search was opened and last used
+        po6::threads::mutex m_protect_leases;
+        lease_map m_leases;
+        std::map<server_id, uint64_t> m_leases_per_client;
+        performance_counter m_perf_reaped;
+        performance_counter m_perf_evicted;
 };
 
 END_HYPERDEX_NAMESPACE
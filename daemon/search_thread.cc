@@ -0,0 +1,125 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#define __STDC_LIMIT_MACROS
+
+// C
+#include <cassert>
+
+// HyperDex
+#include "daemon/daemon.h"
+#include "daemon/search_thread.h"
+
+using hyperdex::search_thread;
+
+struct search_thread::request
+{
+    request(server_id f, virtual_server_id vf, virtual_server_id vt,
+            network_msgtype t, e::buffer* m, e::unpacker u, uint64_t d)
+        : from(f), vfrom(vf), vto(vt), type(t), msg(m), up(u), deadline(d) {}
+    server_id from;
+    virtual_server_id vfrom;
+    virtual_server_id vto;
+    network_msgtype type;
+    e::buffer* msg; // owned by whichever list holds the request
+    e::unpacker up;
+    uint64_t deadline;
+};
+
+search_thread :: search_thread(daemon* d, size_t idx)
+    : background_thread(d)
+    , m_daemon(d)
+    , m_idx(idx)
+    , m_queue()
+    , m_work()
+{
+}
+
+search_thread :: ~search_thread() throw ()
+{
+    shutdown();
+
+    for (std::list<request>::iterator it = m_queue.begin();
+            it != m_queue.end(); ++it)
+    {
+        delete it->msg;
+    }
+
+    for (std::list<request>::iterator it = m_work.begin();
+            it != m_work.end(); ++it)
+    {
+        delete it->msg;
+    }
+}
+
+const char*
+search_thread :: thread_name()
+{
+    return "search";
+}
+
+bool
+search_thread :: have_work()
+{
+    return !m_queue.empty();
+}
+
+void
+search_thread :: copy_work()
+{
+    assert(m_work.empty());
+    m_work.swap(m_queue);
+}
+
+void
+search_thread :: do_work()
+{
+    while (!m_work.empty())
+    {
+        request& r(m_work.front());
+        std::auto_ptr<e::buffer> msg(r.msg);
+        r.msg = NULL;
+        m_daemon->hold_search_for_memory(r.type);
+        m_daemon->process_search(m_idx, r.from, r.vfrom, r.vto, r.type, msg, r.up, r.deadline);
+        m_work.pop_front();
+    }
+}
+
+void
+search_thread :: enqueue(server_id from,
+                         virtual_server_id vfrom,
+                         virtual_server_id vto,
+                         network_msgtype type,
+                         std::auto_ptr<e::buffer> msg,
+                         e::unpacker up,
+                         uint64_t deadline)
+{
+    this->lock();
+    m_queue.push_back(request(from, vfrom, vto, type, msg.get(), up, deadline));
+    msg.release();
+    this->wakeup();
+    this->unlock();
+}
@@ -0,0 +1,86 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef hyperdex_daemon_search_thread_h_
+#define hyperdex_daemon_search_thread_h_
+
+// STL
+#include <list>
+#include <memory>
+
+// e
+#include <e/buffer.h>
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+#include "common/network_msgtype.h"
+#include "daemon/background_thread.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Searches, counts and sorted searches can scan an entire region.  When the
+// daemon is started with search threads, the network threads hand these
+// requests off to a search_thread so that they never hold up point
+// operations and chain traffic.
+class search_thread : public background_thread
+{
+    public:
+        search_thread(daemon* d, size_t idx);
+        ~search_thread() throw ();
+
+    public:
+        virtual const char* thread_name();
+        virtual bool have_work();
+        virtual void copy_work();
+        virtual void do_work();
+
+    public:
+        void enqueue(server_id from,
+                     virtual_server_id vfrom,
+                     virtual_server_id vto,
+                     network_msgtype type,
+                     std::auto_ptr<e::buffer> msg,
+                     e::unpacker up,
+                     uint64_t deadline);
+
+    private:
+        struct request;
+
+    private:
+        daemon* m_daemon;
+        const size_t m_idx;
+        std::list<request> m_queue; // under lock
+        std::list<request> m_work; // do_work; no lock
+
+    private:
+        search_thread(const search_thread&);
+        search_thread& operator = (const search_thread&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_search_thread_h_
@@ -28,6 +28,10 @@
 #ifndef hyperdex_daemon_state_hash_table_h_
 #define hyperdex_daemon_state_hash_table_h_
 
+// STL
+#include <memory>
+#include <vector>
+
 // po6
 #include <po6/threads/mutex.h>
 
@@ -36,6 +40,7 @@
 
 // HyperDex
 #include "namespace.h"
+#include "daemon/object_pool.h"
 
 // This provides a hash table to map from a key to a piece of state.  It
 // differs from an ordinary hash table in that the piece of state is assumed to
@@ -48,6 +53,14 @@
 // with returning "false" for subsequent calls to "finished").
 //
 // A newly constructed T(K) must return "true" for finished();
+//
+// States come from an object_pool; their occupancy is pool_stats<T>.
+//
+// The table is split by hash into SHARDS independent maps, each padded onto
+// cache lines of its own, so that threads working different keys do not
+// contend on one map's internals.  Each shard counts the states it holds and
+// the lookups that had to start over because they raced with a state being
+// created or retired.
 
 BEGIN_HYPERDEX_NAMESPACE
 
@@ -75,10 +88,26 @@ class state_hash_table
         T* get_state(const K& key, state_reference* sr);
         T* get_or_create_state(const K& key, state_reference* sr);
 
+    public:
+        const static unsigned SHARD_BITS = 4;
+        const static size_t SHARDS = 1U << SHARD_BITS;
+        // the states each shard holds and the retries its lookups took
+        void shard_stats(std::vector<uint64_t>* sizes,
+                         std::vector<uint64_t>* retries);
+
     private:
         class state;
+        class shard;
         typedef typename e::nwf_hash_map<K, e::intrusive_ptr<state>, H> state_map_t;
-        state_map_t m_table;
+        // the high bits pick the shard; the map within uses the low ones
+        shard* get_shard(const K& key) { return m_shards[H(key) >> (64 - SHARD_BITS)]; }
+
+    private:
+        shard* m_shards[SHARDS];
+
+    private:
+        state_hash_table(const state_hash_table&);
+        state_hash_table& operator = (const state_hash_table&);
 };
 
 template <typename K, typename T, uint64_t (*H)(const K& k)>
@@ -94,7 +123,10 @@ class state_hash_table<K, T, H>::state_reference
 
     private:
         friend class state_hash_table;
-        void acquire(state_hash_table* sht, e::intrusive_ptr<state> s);
+        // lock and count an acquire of the state already in m_state; the
+        // table's lookups fill m_state in place to spare the hot path a
+        // round of reference counting on a shared state
+        void acquire(state_hash_table* sht);
         void unlock(); // still acquired, but state unlocked
 
     private:
@@ -112,6 +144,8 @@ class state_hash_table<K, T, H>::iterator
 {
     public:
         iterator(state_hash_table* sht);
+        // walk only shards [first, last), so that threads can split a walk
+        iterator(state_hash_table* sht, size_t first, size_t last);
         ~iterator() throw ();
 
     public:
@@ -122,10 +156,14 @@ class state_hash_table<K, T, H>::iterator
 
     private:
         void prime();
+        // whether m_iter has yet to reach the end of the shard it walks
+        bool in_shard();
 
     private:
         state_hash_table* m_sht;
-        typename state_map_t::iterator m_iter;
+        size_t m_shard;
+        size_t m_last;
+        std::auto_ptr<typename state_map_t::iterator> m_iter;
         state_reference m_sr;
         bool m_primed;
 
@@ -135,7 +173,7 @@ class state_hash_table<K, T, H>::iterator
 };
 
 template <typename K, typename T, uint64_t (*H)(const K& k)>
-class state_hash_table<K, T, H>::state
+class state_hash_table<K, T, H>::state : public pooled<state, T>
 {
     public:
         state(const K& k);
@@ -153,15 +191,42 @@ class state_hash_table<K, T, H>::state
         void dec() { if (__sync_sub_and_fetch(&ref, 1) == 0) delete this; }
 };
 
+template <typename K, typename T, uint64_t (*H)(const K& k)>
+class state_hash_table<K, T, H>::shard
+{
+    public:
+        shard(e::garbage_collector* gc);
+        ~shard() throw ();
+
+    public:
+        // keep neighbouring allocations off the cache lines the shard uses
+        char head[64];
+        state_map_t table;
+        uint64_t size;
+        uint64_t retries;
+        char tail[64];
+
+    private:
+        shard(const shard&);
+        shard& operator = (const shard&);
+};
+
 template <typename K, typename T, uint64_t (*H)(const K& k)>
 state_hash_table<K, T, H> :: state_hash_table(e::garbage_collector* gc)
-    : m_table(gc)
 {
+    for (size_t i = 0; i < SHARDS; ++i)
+    {
+        m_shards[i] = new shard(gc);
+    }
 }
 
 template <typename K, typename T, uint64_t (*H)(const K& k)>
 state_hash_table<K, T, H> :: ~state_hash_table() throw ()
 {
+    for (size_t i = 0; i < SHARDS; ++i)
+    {
+        delete m_shards[i];
+    }
 }
 
 template <typename K, typename T, uint64_t (*H)(const K& k)>
@@ -169,12 +234,13 @@ T*
 state_hash_table<K, T, H> :: create_state(const K& key, state_reference* sr)
 {
     sr->release();
+    shard* sh = get_shard(key);
+    sr->m_state = new state(key);
+    sr->acquire(this);
 
-    e::intrusive_ptr<state> s = new state(key);
-    sr->acquire(this, s);
-
-    if (m_table.put_ine(key, s))
+    if (sh->table.put_ine(key, sr->m_state))
     {
+        __sync_add_and_fetch(&sh->size, 1);
         sr->unlock();
         return sr->get();
     }
@@ -188,21 +254,22 @@ T*
 state_hash_table<K, T, H> :: get_state(const K& key, state_reference* sr)
 {
     sr->release();
+    shard* sh = get_shard(key);
 
     while (true)
     {
-        e::intrusive_ptr<state> s;
-
-        if (!m_table.get(key, &s))
+        if (!sh->table.get(key, &sr->m_state))
         {
+            sr->m_state = NULL;
             return NULL;
         }
 
-        sr->acquire(this, s);
+        sr->acquire(this);
 
-        if (s->garbage)
+        if (sr->m_state->garbage)
         {
             sr->release();
+            __sync_add_and_fetch(&sh->retries, 1);
             continue;
         }
 
@@ -216,33 +283,35 @@ T*
 state_hash_table<K, T, H> :: get_or_create_state(const K& key, state_reference* sr)
 {
     sr->release();
+    shard* sh = get_shard(key);
 
     while (true)
     {
-        e::intrusive_ptr<state> s;
-
-        if (m_table.get(key, &s))
+        if (sh->table.get(key, &sr->m_state))
         {
-            sr->acquire(this, s);
+            sr->acquire(this);
         }
         else
         {
-            assert(!s);
-            s = new state(key);
-            sr->acquire(this, s);
+            sr->m_state = new state(key);
+            sr->acquire(this);
 
-            if (!m_table.put_ine(key, s))
+            if (!sh->table.put_ine(key, sr->m_state))
             {
                 sr->release();
+                __sync_add_and_fetch(&sh->retries, 1);
                 continue;
             }
+
+            __sync_add_and_fetch(&sh->size, 1);
         }
 
-        assert(s);
+        assert(sr->m_state);
 
-        if (s->garbage)
+        if (sr->m_state->garbage)
         {
             sr->release();
+            __sync_add_and_fetch(&sh->retries, 1);
             continue;
         }
 
@@ -251,6 +320,21 @@ state_hash_table<K, T, H> :: get_or_create_state(const K& key, state_reference*
     }
 }
 
+template <typename K, typename T, uint64_t (*H)(const K& k)>
+void
+state_hash_table<K, T, H> :: shard_stats(std::vector<uint64_t>* sizes,
+                                         std::vector<uint64_t>* retries)
+{
+    sizes->resize(SHARDS);
+    retries->resize(SHARDS);
+
+    for (size_t i = 0; i < SHARDS; ++i)
+    {
+        (*sizes)[i] = __sync_add_and_fetch(&m_shards[i]->size, 0);
+        (*retries)[i] = __sync_add_and_fetch(&m_shards[i]->retries, 0);
+    }
+}
+
 template <typename K, typename T, uint64_t (*H)(const K& k)>
 state_hash_table<K, T, H> :: state_reference :: state_reference()
     : m_sht(NULL)
@@ -293,8 +377,13 @@ state_hash_table<K, T, H> :: state_reference :: release()
         !m_state->garbage &&
         m_state->t.finished())
     {
+        shard* sh = m_sht->get_shard(m_state->t.state_key());
         m_state->garbage = true;
-        m_sht->m_table.del_if(m_state->t.state_key(), m_state);
+
+        if (sh->table.del_if(m_state->t.state_key(), m_state))
+        {
+            __sync_sub_and_fetch(&sh->size, 1);
+        }
     }
 
     m_state->mtx.unlock();
@@ -312,15 +401,12 @@ state_hash_table<K, T, H> :: state_reference :: get()
 
 template <typename K, typename T, uint64_t (*H)(const K& k)>
 void
-state_hash_table<K, T, H> :: state_reference :: acquire(state_hash_table* sht, e::intrusive_ptr<state> s)
+state_hash_table<K, T, H> :: state_reference :: acquire(state_hash_table* sht)
 {
-    if (m_sht || m_state || m_locked)
-    {
-        release();
-    }
-
+    assert(!m_sht);
+    assert(m_state);
+    assert(!m_locked);
     m_sht = sht;
-    m_state = s;
     m_state->mtx.lock();
     m_locked = true;
     ++m_state->acquires;
@@ -340,13 +426,32 @@ state_hash_table<K, T, H> :: state_reference :: unlock()
 template <typename K, typename T, uint64_t (*H)(const K& k)>
 state_hash_table<K, T, H> :: iterator :: iterator(state_hash_table* sht)
     : m_sht(sht)
-    , m_iter(m_sht->m_table.begin())
+    , m_shard(0)
+    , m_last(SHARDS)
+    , m_iter(new typename state_map_t::iterator(m_sht->m_shards[0]->table.begin()))
     , m_sr()
     , m_primed(false)
 {
     prime();
 }
 
+template <typename K, typename T, uint64_t (*H)(const K& k)>
+state_hash_table<K, T, H> :: iterator :: iterator(state_hash_table* sht, size_t first, size_t last)
+    : m_sht(sht)
+    , m_shard(first)
+    , m_last(last < SHARDS ? last : SHARDS)
+    , m_iter()
+    , m_sr()
+    , m_primed(false)
+{
+    if (m_shard < m_last)
+    {
+        m_iter.reset(new typename state_map_t::iterator(m_sht->m_shards[m_shard]->table.begin()));
+    }
+
+    prime();
+}
+
 template <typename K, typename T, uint64_t (*H)(const K& k)>
 state_hash_table<K, T, H> :: iterator :: ~iterator() throw ()
 {
@@ -357,7 +462,7 @@ bool
 state_hash_table<K, T, H> :: iterator :: valid()
 {
     prime();
-    return m_iter != m_sht->m_table.end();
+    return m_shard < m_last;
 }
 
 template <typename K, typename T, uint64_t (*H)(const K& k)>
@@ -381,7 +486,7 @@ typename state_hash_table<K, T, H>::iterator&
 state_hash_table<K, T, H> :: iterator :: operator ++ ()
 {
     m_primed = false;
-    ++m_iter;
+    ++*m_iter;
     prime();
     return *this;
 }
@@ -395,22 +500,55 @@ state_hash_table<K, T, H> :: iterator :: prime()
         return;
     }
 
-    while (true)
+    m_sr.release();
+
+    while (m_shard < m_last)
     {
         m_sr.release();
 
-        if (m_iter == m_sht->m_table.end() ||
-            m_sht->get_state(m_iter->first, &m_sr))
+        if (!in_shard())
+        {
+            ++m_shard;
+
+            if (m_shard < m_last)
+            {
+                m_iter.reset(new typename state_map_t::iterator(m_sht->m_shards[m_shard]->table.begin()));
+            }
+
+            continue;
+        }
+
+        if (m_sht->get_state((*m_iter)->first, &m_sr))
         {
             break;
         }
 
-        ++m_iter;
+        ++*m_iter;
     }
 
     m_primed = true;
 }
 
+template <typename K, typename T, uint64_t (*H)(const K& k)>
+bool
+state_hash_table<K, T, H> :: iterator :: in_shard()
+{
+    return *m_iter != m_sht->m_shards[m_shard]->table.end();
+}
+
+template <typename K, typename T, uint64_t (*H)(const K& k)>
+state_hash_table<K, T, H> :: shard :: shard(e::garbage_collector* gc)
+    : table(gc)
+    , size(0)
+    , retries(0)
+{
+}
+
+template <typename K, typename T, uint64_t (*H)(const K& k)>
+state_hash_table<K, T, H> :: shard :: ~shard() throw ()
+{
+}
+
 template <typename K, typename T, uint64_t (*H)(const K& k)>
 state_hash_table<K, T, H> :: state :: state(const K& k)
     : t(k)
@@ -29,14 +29,21 @@
 
 // POSIX
 #include <signal.h>
+#include <time.h>
 
 // STL
 #include <algorithm>
+#include <set>
+#include <string>
 
 // Google Log
 #include <glog/logging.h>
 
+// po6
+#include <po6/time.h>
+
 // HyperDex
+#include "common/compression.h"
 #include "common/serialization.h"
 #include "daemon/daemon.h"
 #include "daemon/datalayer_iterator.h"
@@ -49,6 +56,13 @@ using hyperdex::reconfigure_returncode;
 using hyperdex::state_transfer_manager;
 using hyperdex::transfer_id;
 
+// the most bytes of objects one XFER_OP_BATCH carries
+#define XFER_BATCH_MAX_BYTES (256ULL * 1024ULL)
+// the most objects the receiver puts to disk in one write
+#define XFER_APPLY_MAX_OBJECTS 1024
+// how long transfers held back by the bandwidth budget wait to try again
+#define XFER_BUDGET_WAIT (10ULL * 1000ULL * 1000ULL)
+
 class state_transfer_manager::background_thread : public ::hyperdex::background_thread
 {
     public:
@@ -63,6 +77,8 @@ class state_transfer_manager::background_thread : public ::hyperdex::background_
 
     public:
         void kick();
+        // resume transfers after the budget has had XFER_BUDGET_WAIT to refill
+        void throttle();
 
     private:
         background_thread(const background_thread&);
@@ -71,13 +87,27 @@ class state_transfer_manager::background_thread : public ::hyperdex::background_
     private:
         state_transfer_manager* m_stm;
         bool m_need_kickstart;
+        bool m_need_refill;
+        bool m_kickstart;
 };
 
 state_transfer_manager :: state_transfer_manager(daemon* d)
     : m_daemon(d)
+    , m_protect_transfers()
     , m_transfers_in()
     , m_transfers_out()
     , m_background_thread(new background_thread(this))
+    , m_objects_sent()
+    , m_batches_sent()
+    , m_bytes_sent()
+    , m_bytes_acked()
+    , m_compressed_raw()
+    , m_compressed_bytes()
+    , m_throttled()
+    , m_budget_mtx()
+    , m_budget_rate(0)
+    , m_budget_tokens(0)
+    , m_budget_refilled(0)
 {
 }
 
@@ -97,6 +127,7 @@ void
 state_transfer_manager :: teardown()
 {
     m_background_thread->shutdown();
+    po6::threads::mutex::hold hold(&m_protect_transfers);
     m_transfers_in.clear();
     m_transfers_out.clear();
 }
@@ -107,6 +138,12 @@ state_transfer_manager :: pause()
     m_background_thread->initiate_pause();
 }
 
+void
+state_transfer_manager :: kick()
+{
+    m_background_thread->kick();
+}
+
 void
 state_transfer_manager :: unpause()
 {
@@ -170,6 +207,7 @@ state_transfer_manager :: reconfigure(const configuration&,
                                       const server_id&)
 {
     m_background_thread->wait_until_paused();
+    po6::threads::mutex::hold hold_transfers(&m_protect_transfers);
 
     // Setup transfers in
     std::vector<transfer> transfers_in;
@@ -182,6 +220,29 @@ state_transfer_manager :: reconfigure(const configuration&,
     new_config.transfers_out(m_daemon->m_us, &transfers_out);
     std::sort(transfers_out.begin(), transfers_out.end());
     setup_transfer_state("outgoing", transfers_out, &m_transfers_out);
+
+    for (size_t i = 0; i < m_transfers_out.size(); ++i)
+    {
+        // a transfer restores fault tolerance when the chain, not counting
+        // the destination, is too short to survive the failures it must
+        const transfer& xfer(m_transfers_out[i]->xfer);
+        std::vector<virtual_server_id> replicas;
+        new_config.replicas_of_region(xfer.rid, &replicas);
+        size_t have = replicas.size() - std::count(replicas.begin(), replicas.end(), xfer.vdst);
+        po6::threads::mutex::hold hold(&m_transfers_out[i]->mtx);
+        m_transfers_out[i]->urgent = have <= new_config.fault_tolerance_of_region(xfer.rid);
+    }
+
+    po6::threads::mutex::hold hold(&m_budget_mtx);
+
+    if (m_budget_rate != new_config.transfer_rate())
+    {
+        LOG(INFO) << "limiting state transfer to " << new_config.transfer_rate()
+                  << " bytes/second (0 is no limit)";
+        m_budget_rate = new_config.transfer_rate();
+        m_budget_tokens = 0;
+        m_budget_refilled = po6::monotonic_time();
+    }
 }
 
 void
@@ -207,9 +268,87 @@ state_transfer_manager :: debug_dump()
     unpause();
 }
 
+void
+state_transfer_manager :: xfer_stats(uint64_t* objects, uint64_t* batches,
+                                     uint64_t* bytes, uint64_t* bytes_acked,
+                                     uint64_t* throttled, uint64_t* rate_limit)
+{
+    *objects = m_objects_sent.read();
+    *batches = m_batches_sent.read();
+    *bytes = m_bytes_sent.read();
+    *bytes_acked = m_bytes_acked.read();
+    *throttled = m_throttled.read();
+    po6::threads::mutex::hold hold(&m_budget_mtx);
+    *rate_limit = m_budget_rate;
+}
+
+void
+state_transfer_manager :: compression_stats(uint64_t* raw, uint64_t* compressed)
+{
+    *raw = m_compressed_raw.read();
+    *compressed = m_compressed_bytes.read();
+}
+
+void
+state_transfer_manager :: progress_stats(std::ostringstream* ret)
+{
+    std::vector<e::intrusive_ptr<transfer_in_state> > transfers_in;
+    std::vector<e::intrusive_ptr<transfer_out_state> > transfers_out;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect_transfers);
+        transfers_in = m_transfers_in;
+        transfers_out = m_transfers_out;
+    }
+
+    const uint64_t now = po6::monotonic_time();
+
+    for (size_t i = 0; i < transfers_out.size(); ++i)
+    {
+        transfer_out_state* tos = transfers_out[i].get();
+        po6::threads::mutex::hold hold(&tos->mtx);
+        const uint64_t id = tos->xfer.id.get();
+        // the average rate since the handshake, which unlike tos->bandwidth
+        // accounts for the time spent throttled or waiting on acks
+        uint64_t rate = 0;
+        uint64_t eta = 0;
+
+        if (tos->started > 0 && now > tos->started)
+        {
+            rate = tos->delivered * 1000000000ULL / (now - tos->started);
+        }
+
+        if (rate > 0 && tos->bytes_estimate > tos->delivered)
+        {
+            eta = (tos->bytes_estimate - tos->delivered) / rate;
+        }
+
+        *ret << " xfer_out." << id << ".region=" << tos->xfer.rid.get();
+        *ret << " xfer_out." << id << ".dst=" << tos->xfer.dst.get();
+        *ret << " xfer_out." << id << ".objects_sent=" << tos->objects_sent;
+        *ret << " xfer_out." << id << ".objects_acked=" << tos->objects_acked;
+        *ret << " xfer_out." << id << ".bytes_sent=" << tos->bytes_sent;
+        *ret << " xfer_out." << id << ".bytes_acked=" << tos->delivered;
+        *ret << " xfer_out." << id << ".bytes_estimate=" << tos->bytes_estimate;
+        *ret << " xfer_out." << id << ".rate=" << rate;
+        *ret << " xfer_out." << id << ".eta=" << eta;
+    }
+
+    for (size_t i = 0; i < transfers_in.size(); ++i)
+    {
+        transfer_in_state* tis = transfers_in[i].get();
+        po6::threads::mutex::hold hold(&tis->mtx);
+        const uint64_t id = tis->xfer.id.get();
+        *ret << " xfer_in." << id << ".region=" << tis->xfer.rid.get();
+        *ret << " xfer_in." << id << ".src=" << tis->xfer.src.get();
+        *ret << " xfer_in." << id << ".objects_applied=" << tis->objects_applied;
+    }
+}
+
 void
 state_transfer_manager :: handshake_syn(const virtual_server_id& from,
-                                        const transfer_id& xid)
+                                        const transfer_id& xid,
+                                        bool compress)
 {
     transfer_in_state* tis = get_tis(xid);
 
@@ -229,7 +368,7 @@ state_transfer_manager :: handshake_syn(const virtual_server_id& from,
 
     uint64_t timestamp = 0;
     m_daemon->m_data.largest_checkpoint_for(tis->xfer.rid, &timestamp);
-    send_handshake_synack(tis->xfer, timestamp);
+    send_handshake_synack(tis->xfer, timestamp, compress && compression_available());
     LOG(INFO) << "received handshake_syn for " << xid;
 }
 
@@ -237,7 +376,8 @@ void
 state_transfer_manager :: handshake_synack(const server_id& from,
                                            const virtual_server_id& to,
                                            const transfer_id& xid,
-                                           uint64_t timestamp)
+                                           uint64_t timestamp,
+                                           bool compress)
 {
     transfer_out_state* tos = get_tos(xid);
 
@@ -260,10 +400,19 @@ state_transfer_manager :: handshake_synack(const server_id& from,
     iter.reset(m_daemon->m_data.replay_region_from_checkpoint(tos->xfer.rid, timestamp, &wipe));
     tos->handshake_syn = true;
     tos->wipe = wipe;
+    tos->compress = compress && compression_available();
     tos->iter = iter;
+
+    if (tos->started == 0)
+    {
+        tos->started = po6::monotonic_time();
+        tos->bytes_estimate = m_daemon->m_data.approximate_size(tos->xfer.rid);
+    }
+
     send_handshake_ack(tos->xfer, tos->wipe);
     transfer_more_state(tos);
-    LOG(INFO) << "received handshake_synack for " << xid << " @ " << timestamp;
+    LOG(INFO) << "received handshake_synack for " << xid << " @ " << timestamp
+              << (tos->compress ? " (compressing)" : "");
 }
 
 void
@@ -294,7 +443,7 @@ state_transfer_manager :: handshake_ack(const virtual_server_id& from,
         LOG(INFO) << "received handshake_ack for " << xid << (wipe ? " (and we must wipe our previous state)" : "");
     }
 
-    put_to_disk_and_send_acks(tis);
+    put_to_disk_and_send_acks(tis, true);
 }
 
 void
@@ -339,7 +488,7 @@ state_transfer_manager :: report_wiped(const transfer_id& xid)
     {
         po6::threads::mutex::hold hold(&tis->mtx);
         tis->wiped = true;
-        put_to_disk_and_send_acks(tis);
+        put_to_disk_and_send_acks(tis, true);
         LOG(INFO) << "we've wiped our state for " << xid;
     }
 
@@ -354,7 +503,8 @@ state_transfer_manager :: xfer_op(const virtual_server_id& from,
                                   uint64_t version,
                                   std::auto_ptr<e::buffer> msg,
                                   const e::slice& key,
-                                  const std::vector<e::slice>& value)
+                                  const std::vector<e::slice>& value,
+                                  bool ack)
 {
     transfer_in_state* tis = get_tis(xid);
 
@@ -374,7 +524,9 @@ state_transfer_manager :: xfer_op(const virtual_server_id& from,
 
     if (seq_no < tis->upper_bound_acked)
     {
-        return send_ack(tis->xfer, seq_no);
+        // already on disk; the sender never saw the ack that covered it
+        tis->ack_owed = true;
+        return put_to_disk_and_send_acks(tis, ack);
     }
 
     std::list<e::intrusive_ptr<pending> >::iterator where_to_put_it;
@@ -384,8 +536,8 @@ state_transfer_manager :: xfer_op(const virtual_server_id& from,
     {
         if ((*where_to_put_it)->seq_no == seq_no)
         {
-            // silently drop it
-            return;
+            // silently drop it, but still ack if it ends a batch
+            return put_to_disk_and_send_acks(tis, ack);
         }
 
         if ((*where_to_put_it)->seq_no > seq_no)
@@ -401,8 +553,9 @@ state_transfer_manager :: xfer_op(const virtual_server_id& from,
     op->key = key;
     op->value = value;
     op->msg = msg;
+    op->charge.set(sizeof(pending) + (op->msg.get() ? op->msg->capacity() : 0));
     tis->queued.insert(where_to_put_it, op);
-    put_to_disk_and_send_acks(tis);
+    put_to_disk_and_send_acks(tis, ack);
 }
 
 void
@@ -427,30 +580,41 @@ state_transfer_manager :: xfer_ack(const server_id& from,
         return;
     }
 
-    std::list<e::intrusive_ptr<pending> >::iterator it;
-
-    for (it = tos->window.begin(); it != tos->window.end(); ++it)
-    {
-        if ((*it)->seq_no == seq_no)
-        {
-            break;
-        }
-    }
+    const uint64_t now = po6::monotonic_time();
+    e::intrusive_ptr<pending> sample;
 
-    if (it != tos->window.end())
+    // the other end applies objects in order, so each ack covers every
+    // object up to and including seq_no
+    while (!tos->window.empty() && tos->window.front()->seq_no <= seq_no)
     {
-        (*it)->acked = true;
+        e::intrusive_ptr<pending> op = tos->window.front();
+        tos->window.pop_front();
+        tos->window_bytes -= op->size;
+        tos->delivered += op->size;
+        ++tos->objects_acked;
         tos->handshake_ack = true;
+        m_bytes_acked.add(op->size);
 
-        if (tos->window_sz < 1024)
+        // an ack for a retransmitted object says nothing about the RTT
+        if (!op->retransmitted)
         {
-            ++tos->window_sz;
+            sample = op;
         }
     }
 
-    while (!tos->window.empty() && (*tos->window.begin())->acked)
+    if (sample && now > sample->sent_at)
     {
-        tos->window.pop_front();
+        // the rate at which the other end took data while the sample was
+        // in flight; twice that over the RTT keeps the pipe full, and because
+        // a full window caps the rate, the window doubles each RTT until the
+        // network or the other end's disk becomes the limit
+        uint64_t rtt = now - sample->sent_at;
+        uint64_t rate = (tos->delivered - sample->delivered) * 1000000000ULL / rtt;
+        tos->rtt = tos->rtt ? (7 * tos->rtt + rtt) / 8 : rtt;
+        tos->bandwidth = std::max(rate, tos->bandwidth - tos->bandwidth / 8);
+        uint64_t bdp = tos->bandwidth * (tos->rtt / 1000) / 1000000ULL;
+        tos->window_limit = std::min<uint64_t>(std::max<uint64_t>(2 * bdp, XFER_WINDOW_MIN_BYTES),
+                                               XFER_WINDOW_MAX_BYTES);
     }
 
     transfer_more_state(tos);
@@ -489,6 +653,13 @@ state_transfer_manager :: transfer_more_state(transfer_out_state* tos)
 {
     if (!tos->handshake_syn)
     {
+        // a region still filling after a split has only some of its
+        // objects; the divider kicks us once it has them all
+        if (m_daemon->m_data.region_is_filling(tos->xfer.rid))
+        {
+            return;
+        }
+
         send_handshake_syn(tos->xfer);
         return;
     }
@@ -500,21 +671,41 @@ state_transfer_manager :: transfer_more_state(transfer_out_state* tos)
 
     assert(tos->iter.get());
 
-    while (tos->window.size() < tos->window_sz && tos->iter->valid())
+    std::vector<pending*> fresh;
+    size_t window_objects = tos->window.size();
+
+    while (tos->window_bytes < tos->window_limit &&
+           window_objects < XFER_WINDOW_MAX_OBJECTS &&
+           tos->iter->valid())
     {
+        if (!budget_admit(tos->urgent))
+        {
+            m_throttled.tap();
+            m_background_thread->throttle();
+            break;
+        }
+
         e::intrusive_ptr<pending> op(new pending());
-        op->seq_no = tos->next_seq_no;
-        ++tos->next_seq_no;
         op->kref.assign(reinterpret_cast<const char*>(tos->iter->key().data()), tos->iter->key().size());
         op->key = e::slice(op->kref);
 
         if (tos->iter->has_value())
         {
             op->has_value = true;
+            datalayer::returncode rc = tos->iter->unpack_value(&op->value, &op->version, &op->vref);
+
+            // a later write replaced the chunks of this version; the replay
+            // reaches that write, which is all the other end needs
+            if (rc == datalayer::NOT_FOUND)
+            {
+                tos->iter->next();
+                continue;
+            }
 
-            if (tos->iter->unpack_value(&op->value, &op->version, &op->vref) != datalayer::SUCCESS)
+            // the seq_no stays unused, so the same object goes next time
+            if (rc != datalayer::SUCCESS)
             {
-                LOG(ERROR) << "error doing state transfer";
+                LOG(ERROR) << "error doing state transfer: " << rc;
                 break;
             }
         }
@@ -524,17 +715,34 @@ state_transfer_manager :: transfer_more_state(transfer_out_state* tos)
             op->version = 0;
         }
 
+        op->seq_no = tos->next_seq_no;
+        ++tos->next_seq_no;
+
+        op->size = sizeof(uint8_t)
+                 + sizeof(uint64_t)
+                 + sizeof(uint64_t)
+                 + sizeof(uint64_t)
+                 + sizeof(uint32_t) + op->key.size()
+                 + pack_size(op->value);
+        op->charge.set(sizeof(pending) + op->size);
+        tos->window_bytes += op->size;
+        tos->bytes_sent += op->size;
+        ++tos->objects_sent;
+        budget_spend(op->size);
         tos->window.push_back(op);
-        send_object(tos->xfer, op.get());
+        fresh.push_back(op.get());
+        ++window_objects;
         tos->iter->next();
     }
 
+    send_objects(tos, fresh);
+
     if (!tos->handshake_ack)
     {
         // pass!  we need the other end to give us some sign that it's ready,
         // otherwise we cannot consider moving forward, even if we're ready.
     }
-    else if (tos->window.empty() && m_daemon->m_config.is_transfer_live(tos->xfer.id))
+    else if (tos->window.empty() && m_daemon->config().is_transfer_live(tos->xfer.id))
     {
         m_daemon->m_coord->transfer_complete(tos->xfer.id);
     }
@@ -547,15 +755,20 @@ state_transfer_manager :: transfer_more_state(transfer_out_state* tos)
 void
 state_transfer_manager :: retransmit(transfer_out_state* tos)
 {
+    std::vector<pending*> ops;
+
     for (std::list<e::intrusive_ptr<pending> >::iterator it = tos->window.begin();
             it != tos->window.end(); ++it)
     {
-        send_object(tos->xfer, it->get());
+        (*it)->retransmitted = true;
+        ops.push_back(it->get());
     }
+
+    send_objects(tos, ops);
 }
 
 void
-state_transfer_manager :: put_to_disk_and_send_acks(transfer_in_state* tis)
+state_transfer_manager :: put_to_disk_and_send_acks(transfer_in_state* tis, bool ack)
 {
     if (!tis->handshake_complete)
     {
@@ -576,73 +789,127 @@ state_transfer_manager :: put_to_disk_and_send_acks(transfer_in_state* tis)
     while (!tis->queued.empty() &&
            tis->queued.front()->seq_no == tis->upper_bound_acked)
     {
-        e::intrusive_ptr<pending> op = tis->queued.front();
-
-        if (op->has_value)
+        // take the run of objects that can go to disk now, stopping short of
+        // a repeated key so that its second write sees the first
+        std::vector<e::intrusive_ptr<pending> > run;
+        std::vector<e::slice> keys;
+        std::vector<const std::vector<e::slice>*> values;
+        std::vector<uint64_t> versions;
+        std::set<std::string> seen;
+        uint64_t seq_no = tis->upper_bound_acked;
+
+        for (std::list<e::intrusive_ptr<pending> >::iterator it = tis->queued.begin();
+                it != tis->queued.end() && (*it)->seq_no == seq_no &&
+                run.size() < XFER_APPLY_MAX_OBJECTS; ++it, ++seq_no)
         {
-            datalayer::returncode rc = m_daemon->m_data.uncertain_put(tis->xfer.rid, op->key, op->value, op->version);
+            pending* op = it->get();
 
-            switch (rc)
+            if (!seen.insert(std::string(op->key.cdata(), op->key.size())).second)
             {
-                case datalayer::SUCCESS:
-                    break;
-                case datalayer::NOT_FOUND:
-                case datalayer::BAD_ENCODING:
-                case datalayer::CORRUPTION:
-                case datalayer::IO_ERROR:
-                case datalayer::LEVELDB_ERROR:
-                    LOG(ERROR) << "state transfer caused error " << rc;
-                    break;
-                default:
-                    LOG(ERROR) << "state transfer caused unknown error";
-                    break;
+                break;
             }
+
+            run.push_back(*it);
+            keys.push_back(op->key);
+            values.push_back(op->has_value ? &op->value : NULL);
+            versions.push_back(op->version);
         }
-        else
-        {
-            datalayer::returncode rc = m_daemon->m_data.uncertain_del(tis->xfer.rid, op->key);
 
-            switch (rc)
+        datalayer::returncode rc = m_daemon->m_data.uncertain_write(tis->xfer.rid, keys, values, versions);
+
+        for (size_t i = 0; i < run.size(); ++i)
+        {
+            if (rc != datalayer::SUCCESS)
             {
-                case datalayer::SUCCESS:
-                case datalayer::NOT_FOUND:
-                    break;
-                case datalayer::BAD_ENCODING:
-                case datalayer::CORRUPTION:
-                case datalayer::IO_ERROR:
-                case datalayer::LEVELDB_ERROR:
-                    LOG(ERROR) << "state transfer caused error " << rc;
-                    break;
-                default:
-                    LOG(ERROR) << "state transfer caused unknown error";
-                    break;
+                // one at a time, so a bad object costs only itself
+                put_to_disk(tis, run[i].get());
             }
+
+            tis->upper_bound_acked = std::max(tis->upper_bound_acked, run[i]->seq_no + 1);
+            tis->queued.pop_front();
         }
 
-        send_ack(tis->xfer, op->seq_no);
-        tis->upper_bound_acked = std::max(tis->upper_bound_acked, op->seq_no + 1);
-        tis->queued.pop_front();
+        tis->objects_applied += run.size();
+
+        tis->ack_owed = true;
+    }
+
+    if (ack && tis->ack_owed)
+    {
+        send_ack(tis->xfer, tis->upper_bound_acked - 1);
+        tis->ack_owed = false;
+    }
+}
+
+void
+state_transfer_manager :: put_to_disk(transfer_in_state* tis, pending* op)
+{
+    if (op->has_value)
+    {
+        datalayer::returncode rc = m_daemon->m_data.uncertain_put(tis->xfer.rid, op->key, op->value, op->version);
+
+        switch (rc)
+        {
+            case datalayer::SUCCESS:
+                break;
+            case datalayer::NOT_FOUND:
+            case datalayer::BAD_ENCODING:
+            case datalayer::CORRUPTION:
+            case datalayer::IO_ERROR:
+            case datalayer::LEVELDB_ERROR:
+                LOG(ERROR) << "state transfer caused error " << rc;
+                break;
+            default:
+                LOG(ERROR) << "state transfer caused unknown error";
+                break;
+        }
+    }
+    else
+    {
+        datalayer::returncode rc = m_daemon->m_data.uncertain_del(tis->xfer.rid, op->key);
+
+        switch (rc)
+        {
+            case datalayer::SUCCESS:
+            case datalayer::NOT_FOUND:
+                break;
+            case datalayer::BAD_ENCODING:
+            case datalayer::CORRUPTION:
+            case datalayer::IO_ERROR:
+            case datalayer::LEVELDB_ERROR:
+                LOG(ERROR) << "state transfer caused error " << rc;
+                break;
+            default:
+                LOG(ERROR) << "state transfer caused unknown error";
+                break;
+        }
     }
 }
 
 void
 state_transfer_manager :: send_handshake_syn(const transfer& xfer)
 {
+    // older daemons ignore the trailing flags and answer without any,
+    // which leaves the transfer uncompressed
+    uint8_t flags = compression_available() ? 0x1 : 0;
     size_t sz = HYPERDEX_HEADER_SIZE_VV
-              + sizeof(uint64_t);
+              + sizeof(uint64_t)
+              + sizeof(uint8_t);
     std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
-    msg->pack_at(HYPERDEX_HEADER_SIZE_VV) << xfer.id;
+    msg->pack_at(HYPERDEX_HEADER_SIZE_VV) << xfer.id << flags;
     m_daemon->m_comm.send_exact(xfer.vsrc, xfer.vdst, XFER_HS, msg);
 }
 
 void
-state_transfer_manager :: send_handshake_synack(const transfer& xfer, uint64_t timestamp)
+state_transfer_manager :: send_handshake_synack(const transfer& xfer, uint64_t timestamp, bool compress)
 {
+    uint8_t flags = compress ? 0x1 : 0;
     size_t sz = HYPERDEX_HEADER_SIZE_VV
               + sizeof(uint64_t)
-              + sizeof(uint64_t);
+              + sizeof(uint64_t)
+              + sizeof(uint8_t);
     std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
-    msg->pack_at(HYPERDEX_HEADER_SIZE_VV) << xfer.id << timestamp;
+    msg->pack_at(HYPERDEX_HEADER_SIZE_VV) << xfer.id << timestamp << flags;
     m_daemon->m_comm.send_exact(xfer.vdst, xfer.vsrc, XFER_HSA, msg);
 }
 
@@ -673,19 +940,93 @@ state_transfer_manager :: send_object(const transfer& xfer,
                                       pending* op)
 {
     uint8_t flags = (op->has_value ? 1 : 0);
-    size_t sz = HYPERDEX_HEADER_SIZE_VV
-              + sizeof(uint8_t)
-              + sizeof(uint64_t)
-              + sizeof(uint64_t)
-              + sizeof(uint64_t)
-              + sizeof(uint32_t) + op->key.size()
-              + pack_size(op->value);
+    size_t sz = HYPERDEX_HEADER_SIZE_VV + op->size;
     std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
     msg->pack_at(HYPERDEX_HEADER_SIZE_VV) << flags << xfer.id.get() << op->seq_no
                                           << op->version << op->key << op->value;
     m_daemon->m_comm.send_exact(xfer.vsrc, xfer.vdst, XFER_OP, msg);
 }
 
+void
+state_transfer_manager :: send_objects(transfer_out_state* tos,
+                                       const std::vector<pending*>& ops)
+{
+    const uint64_t now = po6::monotonic_time();
+    size_t start = 0;
+
+    while (start < ops.size())
+    {
+        size_t limit = start + 1;
+        size_t body = ops[start]->size;
+
+        while (limit < ops.size() &&
+               body + ops[limit]->size <= XFER_BATCH_MAX_BYTES)
+        {
+            body += ops[limit]->size;
+            ++limit;
+        }
+
+        if (limit - start == 1)
+        {
+            send_object(tos->xfer, ops[start]);
+        }
+        else
+        {
+            // each object is a slice laid out exactly like an XFER_OP body
+            size_t sz = HYPERDEX_HEADER_SIZE_VV
+                      + sizeof(uint32_t)
+                      + (limit - start) * sizeof(uint32_t) + body;
+            std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+            e::packer pa = msg->pack_at(HYPERDEX_HEADER_SIZE_VV);
+            pa = pa << static_cast<uint32_t>(limit - start);
+
+            for (size_t i = start; i < limit; ++i)
+            {
+                pending* op = ops[i];
+                uint8_t flags = (op->has_value ? 1 : 0);
+                pa = pa << static_cast<uint32_t>(op->size)
+                        << flags << tos->xfer.id.get() << op->seq_no
+                        << op->version << op->key << op->value;
+            }
+
+            std::vector<char> compressed;
+            e::slice raw(msg->data() + HYPERDEX_HEADER_SIZE_VV,
+                         msg->size() - HYPERDEX_HEADER_SIZE_VV);
+
+            if (tos->compress && compress(raw, &compressed))
+            {
+                // an XFER_OP_BATCH body behind its LZ4 compressed form
+                size_t csz = HYPERDEX_HEADER_SIZE_VV
+                           + sizeof(uint32_t)
+                           + sizeof(uint32_t) + compressed.size();
+                std::auto_ptr<e::buffer> cmsg(e::buffer::create(csz));
+                cmsg->pack_at(HYPERDEX_HEADER_SIZE_VV)
+                    << static_cast<uint32_t>(raw.size())
+                    << e::slice(&compressed[0], compressed.size());
+                m_daemon->m_comm.send_exact(tos->xfer.vsrc, tos->xfer.vdst, XFER_OP_COMPRESSED, cmsg);
+                m_compressed_raw.add(raw.size());
+                m_compressed_bytes.add(compressed.size());
+            }
+            else
+            {
+                m_daemon->m_comm.send_exact(tos->xfer.vsrc, tos->xfer.vdst, XFER_OP_BATCH, msg);
+            }
+
+            m_batches_sent.tap();
+        }
+
+        for (size_t i = start; i < limit; ++i)
+        {
+            ops[i]->sent_at = now;
+            ops[i]->delivered = tos->delivered;
+            m_objects_sent.tap();
+            m_bytes_sent.add(ops[i]->size);
+        }
+
+        start = limit;
+    }
+}
+
 void
 state_transfer_manager :: send_ack(const transfer& xfer, uint64_t seq_no)
 {
@@ -699,10 +1040,52 @@ state_transfer_manager :: send_ack(const transfer& xfer, uint64_t seq_no)
     m_daemon->m_comm.send_exact(xfer.vdst, xfer.vsrc, XFER_ACK, msg);
 }
 
+bool
+state_transfer_manager :: budget_admit(bool urgent)
+{
+    po6::threads::mutex::hold hold(&m_budget_mtx);
+
+    if (m_budget_rate == 0)
+    {
+        return true;
+    }
+
+    // refill, holding at most a tenth of a second (or one batch) in reserve
+    const uint64_t now = po6::monotonic_time();
+    const int64_t burst = std::max<uint64_t>(m_budget_rate / 10, XFER_BATCH_MAX_BYTES);
+    uint64_t elapsed = std::min<uint64_t>(now - m_budget_refilled, 1000000000ULL);
+    const uint64_t refill = elapsed / 1000 * m_budget_rate / 1000000;
+
+    // leave the clock alone until a whole byte has accrued, else slow rates
+    // would round to nothing on every call
+    if (refill > 0)
+    {
+        m_budget_tokens = std::min<int64_t>(m_budget_tokens + refill, burst);
+        m_budget_refilled = now;
+    }
+
+    // rebalancing spends only what lies beyond half the bucket, so whenever
+    // both kinds of transfer run, those restoring fault tolerance go first
+    return m_budget_tokens > (urgent ? 0 : burst / 2);
+}
+
+void
+state_transfer_manager :: budget_spend(uint64_t bytes)
+{
+    po6::threads::mutex::hold hold(&m_budget_mtx);
+
+    if (m_budget_rate != 0)
+    {
+        m_budget_tokens -= bytes;
+    }
+}
+
 state_transfer_manager :: background_thread :: background_thread(state_transfer_manager* stm)
     : hyperdex::background_thread(stm->m_daemon)
     , m_stm(stm)
     , m_need_kickstart(false)
+    , m_need_refill(false)
+    , m_kickstart(false)
 {
 }
 
@@ -719,24 +1102,42 @@ state_transfer_manager :: background_thread :: thread_name()
 bool
 state_transfer_manager :: background_thread :: have_work()
 {
-    return m_need_kickstart;
+    return m_need_kickstart || m_need_refill;
 }
 
 void
 state_transfer_manager :: background_thread :: copy_work()
 {
+    m_kickstart = m_need_kickstart;
     m_need_kickstart = false;
+    m_need_refill = false;
 }
 
 void
 state_transfer_manager :: background_thread :: do_work()
 {
+    if (!m_kickstart)
+    {
+        // only here to resume throttled transfers, so let the budget refill;
+        // offline so that pausing the thread need not wait out the sleep
+        this->offline();
+        timespec ts;
+        ts.tv_sec = 0;
+        ts.tv_nsec = XFER_BUDGET_WAIT;
+        nanosleep(&ts, NULL);
+        this->online();
+    }
+
     for (size_t idx = 0; idx < m_stm->m_transfers_out.size(); ++idx)
     {
         po6::threads::mutex::hold hold2(&m_stm->m_transfers_out[idx]->mtx);
-        m_stm->retransmit(m_stm->m_transfers_out[idx].get());
+
+        if (m_kickstart)
+        {
+            m_stm->retransmit(m_stm->m_transfers_out[idx].get());
+        }
+
         m_stm->transfer_more_state(m_stm->m_transfers_out[idx].get());
-        ++idx;
     }
 
     m_stm->m_daemon->m_comm.wake_one();
@@ -750,3 +1151,12 @@ state_transfer_manager :: background_thread :: kick()
     this->wakeup();
     this->unlock();
 }
+
+void
+state_transfer_manager :: background_thread :: throttle()
+{
+    this->lock();
+    m_need_refill = true;
+    this->wakeup();
+    this->unlock();
+}
@@ -30,6 +30,7 @@
 
 // STL
 #include <memory>
+#include <sstream>
 
 // po6
 #include <po6/threads/cond.h>
@@ -43,6 +44,7 @@
 #include "namespace.h"
 #include "common/configuration.h"
 #include "daemon/background_thread.h"
+#include "daemon/performance_counter.h"
 #include "daemon/reconfigure_returncode.h"
 
 BEGIN_HYPERDEX_NAMESPACE
@@ -60,18 +62,31 @@ class state_transfer_manager
         void teardown();
         void pause();
         void unpause();
+        // retry the transfers that waited for the datalayer
+        void kick();
         void reconfigure(const configuration& old_config,
                          const configuration& new_config,
                          const server_id& us);
         void debug_dump();
+        void xfer_stats(uint64_t* objects, uint64_t* batches,
+                        uint64_t* bytes, uint64_t* bytes_acked,
+                        uint64_t* throttled, uint64_t* rate_limit);
+        // bytes of XFER_OP_BATCH bodies sent compressed, before and after
+        void compression_stats(uint64_t* raw, uint64_t* compressed);
+        // per-transfer progress as " xfer_out.<id>.<field>=<value>" and
+        // " xfer_in.<id>.<field>=<value>" perf counters
+        void progress_stats(std::ostringstream* ret);
 
     public:
+        // "compress" says whether the other end can take compressed batches
         void handshake_syn(const virtual_server_id& from,
-                           const transfer_id& xid);
+                           const transfer_id& xid,
+                           bool compress);
         void handshake_synack(const server_id& from,
                               const virtual_server_id& to,
                               const transfer_id& xid,
-                              uint64_t timestamp);
+                              uint64_t timestamp,
+                              bool compress);
         void handshake_ack(const virtual_server_id& from,
                            const transfer_id& xid,
                            bool wipe);
@@ -86,7 +101,8 @@ class state_transfer_manager
                      uint64_t version,
                      std::auto_ptr<e::buffer> msg,
                      const e::slice& key,
-                     const std::vector<e::slice>& value);
+                     const std::vector<e::slice>& value,
+                     bool ack);
         void xfer_ack(const server_id& from,
                       const virtual_server_id& to,
                       const transfer_id& xid,
@@ -106,15 +122,23 @@ class state_transfer_manager
         void transfer_more_state(transfer_out_state* tos);
         void retransmit(transfer_out_state* tos);
         // caller must hold mtx on tis
-        void put_to_disk_and_send_acks(transfer_in_state* tis);
+        // acks cover everything applied so far; the ack is put off while
+        // !ack, as it is for all but the last object of an XFER_OP_BATCH
+        void put_to_disk_and_send_acks(transfer_in_state* tis, bool ack);
+        void put_to_disk(transfer_in_state* tis, pending* op);
         // caller must hold mtx on tos
         // send the last object in tos
         void send_handshake_syn(const transfer& xfer);
-        void send_handshake_synack(const transfer& xfer, uint64_t timestamp);
+        void send_handshake_synack(const transfer& xfer, uint64_t timestamp, bool compress);
         void send_handshake_ack(const transfer& xfer, bool wipe);
         void send_handshake_wiped(const transfer& xfer);
         void send_object(const transfer& xfer, pending* op);
+        // send ops, packing runs of them into XFER_OP_BATCH messages
+        void send_objects(transfer_out_state* tos, const std::vector<pending*>& ops);
         void send_ack(const transfer& xfer, uint64_t seq_id);
+        // the daemon-wide token bucket all outgoing transfers draw on
+        bool budget_admit(bool urgent);
+        void budget_spend(uint64_t bytes);
 
     private:
         state_transfer_manager(const state_transfer_manager&);
@@ -122,9 +146,23 @@ class state_transfer_manager
 
     private:
         daemon* m_daemon;
+        // held while swapping out the transfers so progress_stats, which
+        // runs outside the pause, sees whole vectors
+        po6::threads::mutex m_protect_transfers;
         std::vector<e::intrusive_ptr<transfer_in_state> > m_transfers_in;
         std::vector<e::intrusive_ptr<transfer_out_state> > m_transfers_out;
         const std::auto_ptr<background_thread> m_background_thread;
+        performance_counter m_objects_sent;
+        performance_counter m_batches_sent;
+        performance_counter m_bytes_sent;
+        performance_counter m_bytes_acked;
+        performance_counter m_compressed_raw;
+        performance_counter m_compressed_bytes;
+        performance_counter m_throttled;
+        po6::threads::mutex m_budget_mtx;
+        uint64_t m_budget_rate;
+        int64_t m_budget_tokens;
+        uint64_t m_budget_refilled;
 };
 
 END_HYPERDEX_NAMESPACE
@@ -30,6 +30,7 @@
 // HyperDex
 #include "daemon/state_transfer_manager_pending.h"
 
+using hyperdex::memory_accounting;
 using hyperdex::state_transfer_manager;
 
 state_transfer_manager :: state_transfer_manager :: pending :: pending()
@@ -38,10 +39,14 @@ state_transfer_manager :: state_transfer_manager :: pending :: pending()
     , version(0)
     , key()
     , value()
-    , acked(false)
     , msg()
     , kref()
     , vref()
+    , size(0)
+    , sent_at(0)
+    , delivered(0)
+    , retransmitted(false)
+    , charge(memory_accounting::TRANSFERS, sizeof(pending))
     , m_ref(0)
 {
 }
@@ -30,6 +30,7 @@
 
 // HyperDex
 #include "daemon/datalayer.h"
+#include "daemon/memory_accounting.h"
 #include "daemon/state_transfer_manager.h"
 
 class hyperdex::state_transfer_manager::pending
@@ -44,10 +45,16 @@ class hyperdex::state_transfer_manager::pending
         uint64_t version;
         e::slice key;
         std::vector<e::slice> value;
-        bool acked;
         std::auto_ptr<e::buffer> msg;
         std::string kref;
         datalayer::reference vref;
+        // sender-side bookkeeping for sizing the window
+        size_t size; // bytes of the object's XFER_OP body
+        uint64_t sent_at;
+        uint64_t delivered; // tos->delivered when last sent
+        bool retransmitted;
+        // the bytes the op holds while it is in a window or queued
+        memory_charge charge;
 
     private:
         friend class e::intrusive_ptr<pending>;
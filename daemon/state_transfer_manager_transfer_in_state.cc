@@ -42,6 +42,8 @@ state_transfer_manager :: transfer_in_state :: transfer_in_state(const transfer&
     : xfer(_xfer)
     , mtx()
     , upper_bound_acked(1)
+    , ack_owed(false)
+    , objects_applied(0)
     , queued()
     , handshake_complete(false)
     , wipe(false)
@@ -60,6 +62,8 @@ state_transfer_manager :: transfer_in_state :: debug_dump()
     po6::threads::mutex::hold hold(&mtx);
     LOG(INFO) << "  transfer=" << xfer;
     LOG(INFO) << "    upper_bound_acked=" << upper_bound_acked;
+    LOG(INFO) << "    ack_owed=" << ack_owed;
+    LOG(INFO) << "    objects_applied=" << objects_applied;
     LOG(INFO) << "    wipe=" << wipe;
     LOG(INFO) << "    wiped=" << wiped;
 }
@@ -47,6 +47,8 @@ class hyperdex::state_transfer_manager::transfer_in_state
         transfer xfer;
         po6::threads::mutex mtx;
         uint64_t upper_bound_acked;
+        bool ack_owed; // applied objects not yet covered by an ack
+        uint64_t objects_applied;
         std::list<e::intrusive_ptr<pending> > queued;
         bool handshake_complete;
         bool wipe;
@@ -42,11 +42,22 @@ state_transfer_manager :: transfer_out_state :: transfer_out_state(const transfe
     , mtx()
     , next_seq_no(1)
     , window()
-    , window_sz(1)
+    , window_bytes(0)
+    , window_limit(XFER_WINDOW_MIN_BYTES)
+    , delivered(0)
+    , rtt(0)
+    , bandwidth(0)
+    , started(0)
+    , objects_sent(0)
+    , objects_acked(0)
+    , bytes_sent(0)
+    , bytes_estimate(0)
     , iter()
     , handshake_syn(false)
     , handshake_ack(false)
     , wipe(false)
+    , compress(false)
+    , urgent(false)
     , m_ref(0)
 {
 }
@@ -61,8 +72,18 @@ state_transfer_manager :: transfer_out_state :: debug_dump()
     po6::threads::mutex::hold hold(&mtx);
     LOG(INFO) << "  transfer=" << xfer;
     LOG(INFO) << "    next_seq_no=" << next_seq_no;
-    LOG(INFO) << "    window_sz=" << window_sz;
+    LOG(INFO) << "    window_bytes=" << window_bytes;
+    LOG(INFO) << "    window_limit=" << window_limit;
+    LOG(INFO) << "    delivered=" << delivered;
+    LOG(INFO) << "    rtt=" << rtt;
+    LOG(INFO) << "    bandwidth=" << bandwidth;
+    LOG(INFO) << "    objects_sent=" << objects_sent;
+    LOG(INFO) << "    objects_acked=" << objects_acked;
+    LOG(INFO) << "    bytes_sent=" << bytes_sent;
+    LOG(INFO) << "    bytes_estimate=" << bytes_estimate;
     LOG(INFO) << "    handshake_syn=" << handshake_syn;
     LOG(INFO) << "    handshake_ack=" << handshake_ack;
     LOG(INFO) << "    wipe=" << wipe;
+    LOG(INFO) << "    compress=" << compress;
+    LOG(INFO) << "    urgent=" << urgent;
 }
@@ -43,6 +43,13 @@
 
 using hyperdex::state_transfer_manager;
 
+// bounds on the bytes of objects a transfer keeps unacknowledged; the lower
+// bound is one full XFER_OP_BATCH
+#define XFER_WINDOW_MIN_BYTES (256ULL * 1024ULL)
+#define XFER_WINDOW_MAX_BYTES (256ULL * 1024ULL * 1024ULL)
+// cap on the objects in the window, which bounds the receiver's reorder queue
+#define XFER_WINDOW_MAX_OBJECTS 65536
+
 class state_transfer_manager::transfer_out_state
 {
     public:
@@ -57,11 +64,26 @@ class state_transfer_manager::transfer_out_state
         po6::threads::mutex mtx;
         uint64_t next_seq_no;
         std::list<e::intrusive_ptr<pending> > window;
-        size_t window_sz;
+        // the window is sized in bytes to twice the bandwidth-delay product
+        // measured from acks; see xfer_ack
+        uint64_t window_bytes; // bytes of objects in the window
+        uint64_t window_limit;
+        uint64_t delivered; // bytes acked over the transfer
+        uint64_t rtt; // smoothed, in nanoseconds
+        uint64_t bandwidth; // decaying peak, in bytes/second
+        // progress, for the xfer_out.* stats; retransmissions are not counted
+        uint64_t started; // when the handshake completed
+        uint64_t objects_sent;
+        uint64_t objects_acked;
+        uint64_t bytes_sent;
+        uint64_t bytes_estimate; // the region's size; an upper bound when
+                                 // replaying from a checkpoint
         std::auto_ptr<datalayer::replay_iterator> iter;
         bool handshake_syn; // do we know the other end got a syn?
         bool handshake_ack; // do we know the other end got a ack?
         bool wipe;
+        bool compress; // the other end takes XFER_OP_COMPRESSED
+        bool urgent; // restores fault tolerance, so goes before rebalancing
 
     private:
         friend class e::intrusive_ptr<transfer_out_state>;
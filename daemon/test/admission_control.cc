@@ -0,0 +1,133 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/admission_control.h"
+
+using hyperdex::admission_control;
+using hyperdex::schema;
+using hyperdex::server_id;
+
+TEST(AdmissionControl, Ops)
+{
+    admission_control ac;
+    schema sc;
+    sc.quota_ops = 100;
+    uint64_t now = 1000000000ULL;
+    uint64_t retry = 0;
+    size_t admitted = 0;
+
+    while (ac.admit("kv", sc, server_id(1), 10, now, &retry))
+    {
+        ++admitted;
+    }
+
+    // a second's burst, then a wait of one token's worth
+    ASSERT_EQ(admitted, 100U);
+    ASSERT_EQ(retry, 11U);
+    // other spaces keep their own buckets
+    ASSERT_TRUE(ac.admit("other", sc, server_id(1), 10, now, &retry));
+    // 50ms buys 5 more
+    now += 50000000ULL;
+    admitted = 0;
+
+    while (ac.admit("kv", sc, server_id(1), 10, now, &retry))
+    {
+        ++admitted;
+    }
+
+    ASSERT_EQ(admitted, 5U);
+}
+
+TEST(AdmissionControl, Bytes)
+{
+    admission_control ac;
+    schema sc;
+    sc.quota_bytes = 1000;
+    uint64_t now = 1000000000ULL;
+    uint64_t retry = 0;
+    ASSERT_TRUE(ac.admit("kv", sc, server_id(1), 600, now, &retry));
+    ASSERT_FALSE(ac.admit("kv", sc, server_id(1), 600, now, &retry));
+    // 200 bytes short at 1000 bytes/s
+    ASSERT_EQ(retry, 201U);
+    // a request bigger than the burst goes once the bucket is full
+    now += 2000000000ULL;
+    ASSERT_TRUE(ac.admit("kv", sc, server_id(1), 5000, now, &retry));
+    ASSERT_FALSE(ac.admit("kv", sc, server_id(1), 1, now, &retry));
+}
+
+TEST(AdmissionControl, Clients)
+{
+    admission_control ac;
+    schema sc;
+    sc.quota_client_ops = 10;
+    uint64_t now = 1000000000ULL;
+    uint64_t retry = 0;
+
+    for (size_t i = 0; i < 10; ++i)
+    {
+        ASSERT_TRUE(ac.admit("kv", sc, server_id(1), 10, now, &retry));
+    }
+
+    ASSERT_FALSE(ac.admit("kv", sc, server_id(1), 10, now, &retry));
+    // another client is not held back by the first
+    ASSERT_TRUE(ac.admit("kv", sc, server_id(2), 10, now, &retry));
+    // what cannot be refused still counts against the client
+    ac.charge("kv", sc, server_id(2), 10, now);
+
+    for (size_t i = 0; i < 8; ++i)
+    {
+        ASSERT_TRUE(ac.admit("kv", sc, server_id(2), 10, now, &retry));
+    }
+
+    ASSERT_FALSE(ac.admit("kv", sc, server_id(2), 10, now, &retry));
+}
+
+TEST(AdmissionControl, Pace)
+{
+    admission_control ac;
+    hyperdex::region_id ri(1);
+    uint64_t now = 1000000000ULL;
+    // the first goes at once, and those after are told when the next turn
+    // comes without taking it
+    ASSERT_EQ(ac.pace(ri, 1000, 2500, now), 0U);
+    ASSERT_EQ(ac.pace(ri, 1000, 2500, now), 1000U);
+    ASSERT_EQ(ac.pace(ri, 1000, 2500, now), 1000U);
+    ASSERT_EQ(ac.pace(ri, 1000, 2500, now + 400), 600U);
+    // the turn goes to whoever asks first once it comes
+    ASSERT_EQ(ac.pace(ri, 1000, 2500, now + 1000), 0U);
+    ASSERT_EQ(ac.pace(ri, 1000, 2500, now + 1000), 1000U);
+    // never longer than the most it may wait
+    ASSERT_EQ(ac.pace(ri, 5000, 2500, now + 2000), 0U);
+    ASSERT_EQ(ac.pace(ri, 5000, 2500, now + 2000), 2500U);
+    // other regions are paced on their own
+    ASSERT_EQ(ac.pace(hyperdex::region_id(2), 1000, 2500, now), 0U);
+    // and a quiet region starts over
+    now += 10000ULL;
+    ASSERT_EQ(ac.pace(ri, 1000, 2500, now), 0U);
+}
@@ -0,0 +1,242 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#define __STDC_LIMIT_MACROS
+
+// C
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// POSIX
+#include <unistd.h>
+
+// STL
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// e
+#include <e/endian.h>
+
+// HyperDex
+#include "test/th.h"
+#include "common/compression.h"
+#include "daemon/column_writer.h"
+
+using hyperdex::column_writer;
+
+static std::string
+temp_path()
+{
+    char buf[] = "/tmp/hyperdex-column-XXXXXX";
+    int fd = mkstemp(buf);
+    ASSERT_LE(0, fd);
+    close(fd);
+    return buf;
+}
+
+static std::string
+slurp(const std::string& path)
+{
+    std::ifstream fin(path.c_str(), std::ios::binary);
+    std::ostringstream ostr;
+    ostr << fin.rdbuf();
+    return ostr.str();
+}
+
+// read a whole column back, the way a reader of the format would
+static void
+read_column(const std::string& file, uint16_t* type, uint64_t* values,
+            std::vector<std::string>* blocks, std::vector<uint32_t>* counts)
+{
+    ASSERT_LE(column_writer::HEADER_SIZE, file.size());
+    ASSERT_EQ(0, memcmp(file.data(), "HDXCOL\0\1", 8));
+    const uint8_t* base = reinterpret_cast<const uint8_t*>(file.data());
+    uint16_t flags;
+    uint64_t nblocks;
+    e::unpack16le(base + 8, type);
+    e::unpack16le(base + 10, &flags);
+    e::unpack64le(base + 16, values);
+    e::unpack64le(base + 24, &nblocks);
+    size_t off = column_writer::HEADER_SIZE;
+
+    for (uint64_t i = 0; i < nblocks; ++i)
+    {
+        ASSERT_LE(off + column_writer::BLOCK_HEADER_SIZE, file.size());
+        uint32_t count;
+        uint32_t raw_size;
+        uint32_t stored_size;
+        e::unpack32le(base + off, &count);
+        e::unpack32le(base + off + 4, &raw_size);
+        e::unpack32le(base + off + 8, &stored_size);
+        off += column_writer::BLOCK_HEADER_SIZE;
+        ASSERT_LE(off + stored_size, file.size());
+        e::slice body(base + off, stored_size);
+
+        if (raw_size == stored_size)
+        {
+            blocks->push_back(std::string(body.cdata(), body.size()));
+        }
+        else
+        {
+            ASSERT_TRUE(flags & column_writer::FLAG_COMPRESSED);
+            std::vector<char> raw;
+            ASSERT_TRUE(hyperdex::decompress(body, raw_size, &raw));
+            blocks->push_back(std::string(&raw[0], raw.size()));
+        }
+
+        counts->push_back(count);
+        off += stored_size;
+    }
+
+    ASSERT_EQ(file.size(), off);
+}
+
+TEST(ColumnWriter, FixedWidth)
+{
+    std::string path(temp_path());
+    column_writer cw(HYPERDATATYPE_INT64, false);
+    ASSERT_TRUE(cw.open(path));
+
+    for (int64_t i = 0; i < 20000; ++i)
+    {
+        uint8_t buf[sizeof(int64_t)];
+        e::pack64le(i * 3, buf);
+        ASSERT_TRUE(cw.append(e::slice(buf, sizeof(buf))));
+    }
+
+    // the default int64 is empty and reads back as zero
+    ASSERT_TRUE(cw.append(e::slice()));
+    ASSERT_TRUE(cw.close());
+    ASSERT_EQ(20001U, cw.values());
+
+    std::string file(slurp(path));
+    ASSERT_EQ(cw.bytes(), file.size());
+    uint16_t type;
+    uint64_t values;
+    std::vector<std::string> blocks;
+    std::vector<uint32_t> counts;
+    read_column(file, &type, &values, &blocks, &counts);
+    ASSERT_EQ(uint16_t(HYPERDATATYPE_INT64), type);
+    ASSERT_EQ(20001U, values);
+    ASSERT_LT(1U, blocks.size());
+    int64_t expect = 0;
+
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        ASSERT_EQ(counts[i] * sizeof(int64_t), blocks[i].size());
+        const uint8_t* ptr = reinterpret_cast<const uint8_t*>(blocks[i].data());
+
+        for (uint32_t j = 0; j < counts[i]; ++j)
+        {
+            int64_t x;
+            e::unpack64le(ptr + j * sizeof(int64_t), &x);
+            ASSERT_EQ(expect < 20000 ? expect * 3 : 0, x);
+            ++expect;
+        }
+    }
+
+    ASSERT_EQ(20001, expect);
+    unlink(path.c_str());
+}
+
+TEST(ColumnWriter, VariableWidth)
+{
+    std::string path(temp_path());
+    column_writer cw(HYPERDATATYPE_STRING, true);
+    ASSERT_TRUE(cw.open(path));
+    std::vector<std::string> strs;
+
+    for (size_t i = 0; i < 10000; ++i)
+    {
+        std::ostringstream ostr;
+        ostr << "status=active user=" << i;
+        strs.push_back(i % 7 == 0 ? std::string() : ostr.str());
+        ASSERT_TRUE(cw.append(e::slice(strs.back())));
+    }
+
+    ASSERT_TRUE(cw.close());
+    std::string file(slurp(path));
+    uint16_t type;
+    uint64_t values;
+    std::vector<std::string> blocks;
+    std::vector<uint32_t> counts;
+    read_column(file, &type, &values, &blocks, &counts);
+    ASSERT_EQ(uint16_t(HYPERDATATYPE_STRING), type);
+    ASSERT_EQ(strs.size(), values);
+    size_t idx = 0;
+
+    for (size_t i = 0; i < blocks.size(); ++i)
+    {
+        const uint8_t* ptr = reinterpret_cast<const uint8_t*>(blocks[i].data());
+        const size_t data = (counts[i] + 1) * sizeof(uint32_t);
+        ASSERT_LE(data, blocks[i].size());
+
+        for (uint32_t j = 0; j < counts[i]; ++j)
+        {
+            uint32_t start;
+            uint32_t limit;
+            e::unpack32le(ptr + j * sizeof(uint32_t), &start);
+            e::unpack32le(ptr + (j + 1) * sizeof(uint32_t), &limit);
+            ASSERT_LE(start, limit);
+            ASSERT_LE(data + limit, blocks[i].size());
+            ASSERT_EQ(strs[idx], blocks[i].substr(data + start, limit - start));
+            ++idx;
+        }
+    }
+
+    ASSERT_EQ(strs.size(), idx);
+
+    if (hyperdex::compression_available())
+    {
+        // repetitive strings always shrink
+        ASSERT_LT(file.size(), blocks[0].size() * blocks.size());
+    }
+
+    unlink(path.c_str());
+}
+
+TEST(ColumnWriter, Empty)
+{
+    std::string path(temp_path());
+    column_writer cw(HYPERDATATYPE_FLOAT, true);
+    ASSERT_TRUE(cw.open(path));
+    ASSERT_TRUE(cw.close());
+    std::string file(slurp(path));
+    ASSERT_EQ(column_writer::HEADER_SIZE, file.size());
+    uint16_t type;
+    uint64_t values;
+    std::vector<std::string> blocks;
+    std::vector<uint32_t> counts;
+    read_column(file, &type, &values, &blocks, &counts);
+    ASSERT_EQ(0U, values);
+    ASSERT_TRUE(blocks.empty());
+    unlink(path.c_str());
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#define __STDC_LIMIT_MACROS
+
+// C
+#include <time.h>
+
+// POSIX
+#include <pthread.h>
+
+// po6
+#include <po6/time.h>
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/deadline_event.h"
+
+using hyperdex::deadline_event;
+
+static void*
+set_later(void* arg)
+{
+    deadline_event* de = static_cast<deadline_event*>(arg);
+    timespec ts;
+    ts.tv_sec = 0;
+    ts.tv_nsec = 10000000;
+    nanosleep(&ts, NULL);
+    de->set();
+    return NULL;
+}
+
+TEST(DeadlineEvent, SetBeforeWait)
+{
+    deadline_event de;
+    de.set();
+    ASSERT_TRUE(de.wait(0));
+    ASSERT_TRUE(de.wait(UINT64_MAX));
+    de.reset();
+    ASSERT_FALSE(de.wait(0));
+}
+
+TEST(DeadlineEvent, Timeout)
+{
+    deadline_event de;
+    const uint64_t start = po6::monotonic_time();
+    ASSERT_FALSE(de.wait(start + 20000000ULL));
+    ASSERT_GE(po6::monotonic_time(), start + 20000000ULL);
+}
+
+TEST(DeadlineEvent, SetByAnotherThread)
+{
+    deadline_event de;
+    pthread_t t;
+    ASSERT_EQ(pthread_create(&t, NULL, set_later, &de), 0);
+    ASSERT_TRUE(de.wait(UINT64_MAX));
+    ASSERT_EQ(pthread_join(t, NULL), 0);
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdint.h>
+#include <string.h>
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/huge_pages.h"
+
+using hyperdex::huge_pages;
+
+// the mode is process-wide, so one test covers every step after configure
+TEST(HugePages, Transparent)
+{
+    ASSERT_FALSE(huge_pages::configure("gigantic"));
+    ASSERT_TRUE(huge_pages::configure("transparent"));
+    ASSERT_EQ(huge_pages::configured(), huge_pages::TRANSPARENT);
+    void* a = huge_pages::allocate(100);
+    void* b = huge_pages::allocate(100);
+    ASSERT_TRUE(a != NULL);
+    ASSERT_TRUE(b != NULL);
+    ASSERT_TRUE(a != b);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(a) % 16, 0U);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(b) % 16, 0U);
+    memset(a, 'a', 100);
+    memset(b, 'b', 100);
+    const uint64_t mapped = huge_pages::mapped();
+    ASSERT_TRUE(mapped > 0);
+    // a freed block goes to the next request of its size
+    huge_pages::deallocate(a, 100);
+    ASSERT_EQ(huge_pages::allocate(128), a);
+    ASSERT_EQ(huge_pages::mapped(), mapped);
+    // large blocks are mapped, and unmapped, on their own
+    void* c = huge_pages::allocate(1 << 20);
+    memset(c, 'c', 1 << 20);
+    ASSERT_TRUE(huge_pages::mapped() > mapped);
+    huge_pages::deallocate(c, 1 << 20);
+    ASSERT_EQ(huge_pages::mapped(), mapped);
+    hyperdex::huge_string s(1000, 'x');
+    s += "yz";
+    ASSERT_EQ(s.size(), 1002U);
+    ASSERT_EQ(s[1001], 'z');
+}
@@ -31,6 +31,13 @@
 #include <cmath>
 #include <stdint.h>
 
+// POSIX
+#include <pthread.h>
+
+// STL
+#include <algorithm>
+#include <vector>
+
 // HyperDex
 #include "test/th.h"
 #include "daemon/identifier_generator.h"
@@ -38,6 +45,64 @@
 using hyperdex::identifier_generator;
 using hyperdex::region_id;
 
+namespace
+{
+
+const size_t THREADS = 8;
+const uint64_t IDS = 10000;
+
+struct generator_thread
+{
+    generator_thread() : ig(NULL), ri(), ids() {}
+    identifier_generator* ig;
+    region_id ri;
+    std::vector<uint64_t> ids;
+};
+
+void*
+generate_many(void* arg)
+{
+    generator_thread* gt = static_cast<generator_thread*>(arg);
+
+    for (uint64_t i = 0; i < IDS; ++i)
+    {
+        gt->ids.push_back(gt->ig->generate_id(gt->ri));
+    }
+
+    return NULL;
+}
+
+struct reader_thread
+{
+    reader_thread() : ig(NULL), ri(), stop(false), reads(0), ok(true) {}
+    identifier_generator* ig;
+    region_id ri;
+    volatile bool stop;
+    uint64_t reads;
+    bool ok;
+};
+
+// brackets nothing, as a versioned read does, while the generators run
+void*
+read_many(void* arg)
+{
+    reader_thread* rt = static_cast<reader_thread*>(arg);
+    uint64_t last = rt->ig->handed_out(rt->ri);
+
+    while (!rt->stop)
+    {
+        const uint64_t before = rt->ig->handed_out(rt->ri);
+        const uint64_t after = rt->ig->handed_out(rt->ri);
+        rt->ok = rt->ok && last <= before && before <= after;
+        last = after;
+        ++rt->reads;
+    }
+
+    return NULL;
+}
+
+} // namespace
+
 TEST(IdentifierGenerator, Test)
 {
     identifier_generator ig;
@@ -67,3 +132,138 @@ TEST(IdentifierGenerator, Test)
     id = ig.generate_id(ri);
     ASSERT_EQ(id, 9U);
 }
+
+TEST(IdentifierGenerator, Leases)
+{
+    identifier_generator ig;
+    region_id ri(1);
+    ig.adopt(&ri, 1);
+    uint64_t lease;
+    ASSERT_EQ(ig.generate_id(ri, 0, &lease), 1U);
+    ASSERT_EQ(lease, identifier_generator::LEASE);
+    ASSERT_EQ(ig.generate_id(ri, 0, &lease), 2U);
+    ASSERT_EQ(lease, 0U);
+    // a peek gives up the rest of the lease
+    ASSERT_EQ(ig.peek(ri), identifier_generator::LEASE + 1);
+    ASSERT_EQ(ig.generate_id(ri, 0, &lease), identifier_generator::LEASE + 1);
+    ASSERT_EQ(lease, 2 * identifier_generator::LEASE);
+    // and so does a floor the lease cannot get above
+    ASSERT_EQ(ig.generate_id(ri, 1000, &lease), 1001U);
+    ASSERT_EQ(lease, 1000 + identifier_generator::LEASE);
+    ASSERT_EQ(ig.generate_id(ri, 1001, &lease), 1002U);
+    ASSERT_EQ(lease, 0U);
+}
+
+TEST(IdentifierGenerator, Copy)
+{
+    identifier_generator ig;
+    region_id ri(1);
+    ig.adopt(&ri, 1);
+    ASSERT_EQ(ig.generate_id(ri), 1U);
+    identifier_generator copy;
+    copy.copy_from(ig);
+    ASSERT_EQ(copy.peek(ri), identifier_generator::LEASE + 1);
+    // nothing the original generates afterwards is below the copy
+    ASSERT_EQ(ig.generate_id(ri), identifier_generator::LEASE + 1);
+    ASSERT_TRUE(copy.bump(ri, 1000));
+    ASSERT_EQ(copy.peek(ri), 1001U);
+    ASSERT_EQ(ig.peek(ri), 2 * identifier_generator::LEASE + 1);
+}
+
+TEST(IdentifierGenerator, Threads)
+{
+    identifier_generator ig;
+    region_id ri(1);
+    ig.adopt(&ri, 1);
+    generator_thread gts[THREADS];
+    pthread_t threads[THREADS];
+
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+        gts[i].ig = &ig;
+        gts[i].ri = ri;
+        ASSERT_EQ(pthread_create(&threads[i], NULL, generate_many, &gts[i]), 0);
+    }
+
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+        ASSERT_EQ(pthread_join(threads[i], NULL), 0);
+    }
+
+    // every identifier is unique, and each thread saw its own increase
+    std::vector<uint64_t> all;
+
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+        for (size_t j = 1; j < gts[i].ids.size(); ++j)
+        {
+            ASSERT_LT(gts[i].ids[j - 1], gts[i].ids[j]);
+        }
+
+        all.insert(all.end(), gts[i].ids.begin(), gts[i].ids.end());
+    }
+
+    std::sort(all.begin(), all.end());
+    ASSERT_EQ(all.size(), THREADS * IDS);
+    ASSERT_TRUE(std::adjacent_find(all.begin(), all.end()) == all.end());
+    ASSERT_LT(all.back(), ig.peek(ri));
+}
+
+TEST(IdentifierGenerator, HandedOut)
+{
+    identifier_generator ig;
+    region_id ri(1);
+    ig.adopt(&ri, 1);
+    uint64_t lease;
+    const uint64_t start = ig.handed_out(ri);
+    ASSERT_EQ(ig.generate_id(ri, 0, &lease), 1U);
+    ASSERT_EQ(ig.handed_out(ri), start + 1);
+    ASSERT_EQ(ig.handed_out(ri), start + 1);
+    // reading the count kept the lease
+    ASSERT_EQ(ig.generate_id(ri, 0, &lease), 2U);
+    ASSERT_EQ(lease, 0U);
+    ASSERT_EQ(ig.handed_out(ri), start + 2);
+    // a copy never counts back to a value the original gave
+    identifier_generator copy;
+    copy.copy_from(ig);
+    ASSERT_GE(copy.handed_out(ri), start + 2);
+    ASSERT_EQ(copy.generate_id(ri), identifier_generator::LEASE + 1);
+    ASSERT_GT(copy.handed_out(ri), start + 2);
+}
+
+TEST(IdentifierGenerator, HandedOutWithThreads)
+{
+    identifier_generator ig;
+    region_id ri(1);
+    ig.adopt(&ri, 1);
+    const uint64_t start = ig.handed_out(ri);
+    generator_thread gts[THREADS];
+    pthread_t threads[THREADS];
+    reader_thread rt;
+    pthread_t reader;
+    rt.ig = &ig;
+    rt.ri = ri;
+    ASSERT_EQ(pthread_create(&reader, NULL, read_many, &rt), 0);
+
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+        gts[i].ig = &ig;
+        gts[i].ri = ri;
+        ASSERT_EQ(pthread_create(&threads[i], NULL, generate_many, &gts[i]), 0);
+    }
+
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+        ASSERT_EQ(pthread_join(threads[i], NULL), 0);
+    }
+
+    rt.stop = true;
+    ASSERT_EQ(pthread_join(reader, NULL), 0);
+    ASSERT_TRUE(rt.ok);
+    ASSERT_GT(rt.reads, 0U);
+    ASSERT_EQ(ig.handed_out(ri), start + THREADS * IDS);
+    // the reads gave up no lease, so each stripe leased only what it used
+    const uint64_t leases = THREADS * IDS / identifier_generator::LEASE
+                          + identifier_generator::STRIPES;
+    ASSERT_LE(ig.peek(ri), 1 + leases * identifier_generator::LEASE);
+}
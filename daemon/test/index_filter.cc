@@ -0,0 +1,101 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdio.h>
+
+// STL
+#include <string>
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/index_filter.h"
+
+using hyperdex::index_filter;
+
+TEST(IndexFilter, Values)
+{
+    index_filter f(1000, 10);
+    char buf[16];
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        int sz = sprintf(buf, "value-%d", i);
+        f.add(e::slice(buf, sz));
+    }
+
+    size_t false_positives = 0;
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        int sz = sprintf(buf, "value-%d", i);
+        ASSERT_TRUE(f.may_contain(e::slice(buf, sz), e::slice(buf, sz)));
+        sz = sprintf(buf, "other-%d", i);
+
+        if (f.may_contain(e::slice(buf, sz), e::slice(buf, sz)))
+        {
+            ++false_positives;
+        }
+    }
+
+    // about 1% at 10 bits per entry
+    ASSERT_LT(false_positives, 50U);
+    ASSERT_EQ(f.added(), 1000U);
+    ASSERT_FALSE(f.saturated());
+}
+
+TEST(IndexFilter, Ranges)
+{
+    index_filter f(16, 10);
+    f.add(e::slice("abcdef", 6));
+    f.add(e::slice("ab", 2));
+    // ends sharing a prefix that was added
+    ASSERT_TRUE(f.may_contain(e::slice("abcd", 4), e::slice("abcdzz", 6)));
+    // ends sharing a prefix no value has
+    ASSERT_FALSE(f.may_contain(e::slice("wxyz", 4), e::slice("wxyzzz", 6)));
+    // ends sharing too little to tell
+    ASSERT_TRUE(f.may_contain(e::slice("wx", 2), e::slice("wy", 2)));
+    // short values are held whole, but not as prefixes
+    ASSERT_TRUE(f.may_contain(e::slice("ab", 2), e::slice("ab", 2)));
+}
+
+TEST(IndexFilter, ReadyAndSaturated)
+{
+    index_filter f(4, 10);
+    ASSERT_FALSE(f.ready());
+    f.set_ready();
+    ASSERT_TRUE(f.ready());
+
+    for (int i = 0; i < 9; ++i)
+    {
+        std::string v(1, static_cast<char>('a' + i));
+        f.add(e::slice(v));
+    }
+
+    ASSERT_TRUE(f.saturated());
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#define __STDC_LIMIT_MACROS
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/latency_histogram.h"
+
+using hyperdex::latency_histogram;
+
+TEST(LatencyHistogram, Buckets)
+{
+    // small values get a bucket of their own
+    for (uint64_t i = 0; i < 8; ++i)
+    {
+        ASSERT_EQ(latency_histogram::bucket(i), i);
+        ASSERT_EQ(latency_histogram::bucket_upper_bound(i), i);
+    }
+
+    ASSERT_EQ(latency_histogram::bucket(8), 8U);
+    ASSERT_EQ(latency_histogram::bucket(9), 8U);
+    ASSERT_EQ(latency_histogram::bucket(10), 9U);
+    ASSERT_EQ(latency_histogram::bucket_upper_bound(8), 9U);
+    ASSERT_EQ(latency_histogram::bucket(UINT64_MAX), latency_histogram::BUCKETS - 1);
+    ASSERT_EQ(latency_histogram::bucket_upper_bound(latency_histogram::BUCKETS - 1), UINT64_MAX);
+
+    // every value falls within its bucket, and the buckets are ordered
+    for (uint64_t v = 1; v < (1ULL << 62); v = v * 3 + 1)
+    {
+        size_t b = latency_histogram::bucket(v);
+        ASSERT_LE(v, latency_histogram::bucket_upper_bound(b));
+        ASSERT_GT(v, latency_histogram::bucket_upper_bound(b - 1));
+    }
+}
+
+TEST(LatencyHistogram, Percentiles)
+{
+    latency_histogram lh;
+    std::vector<uint64_t> counts;
+
+    for (uint64_t i = 1; i <= 1000; ++i)
+    {
+        lh.record(i, i * 1000);
+    }
+
+    lh.interval(&counts);
+    uint64_t p50 = latency_histogram::percentile(counts, 50, 100);
+    uint64_t p99 = latency_histogram::percentile(counts, 99, 100);
+    ASSERT_GE(p50, 500000U);
+    ASSERT_LE(p50, 500000U * 5 / 4);
+    ASSERT_GE(p99, 990000U);
+    ASSERT_LE(p99, 990000U * 5 / 4);
+
+    // a second interval sees only what was recorded since the first
+    lh.record(0, 7);
+    lh.interval(&counts);
+    ASSERT_EQ(latency_histogram::percentile(counts, 999, 1000), 7U);
+    lh.interval(&counts);
+    ASSERT_EQ(latency_histogram::percentile(counts, 50, 100), 0U);
+}
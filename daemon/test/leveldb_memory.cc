@@ -0,0 +1,127 @@
+// Copyright (c) 2016, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// STL
+#include <algorithm>
+#include <string>
+#include <vector>
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/leveldb_memory.h"
+
+using hyperdex::memory_env;
+
+namespace
+{
+
+std::string
+read_all(memory_env* env, const std::string& fname)
+{
+    leveldb::SequentialFile* f = NULL;
+    ASSERT_TRUE(env->NewSequentialFile(fname, &f).ok());
+    std::string out;
+    char buf[4];
+    leveldb::Slice s;
+
+    do
+    {
+        ASSERT_TRUE(f->Read(sizeof(buf), &s, buf).ok());
+        out.append(s.data(), s.size());
+    }
+    while (!s.empty());
+
+    delete f;
+    return out;
+}
+
+} // namespace
+
+TEST(MemoryEnv, WriteRead)
+{
+    memory_env env(leveldb::Env::Default());
+    leveldb::WritableFile* w = NULL;
+    ASSERT_TRUE(env.NewWritableFile("/db/000001.log", &w).ok());
+    ASSERT_TRUE(w->Append(leveldb::Slice("hello ", 6)).ok());
+    ASSERT_TRUE(w->Append(leveldb::Slice("world", 5)).ok());
+    ASSERT_TRUE(w->Close().ok());
+    delete w;
+    ASSERT_TRUE(env.FileExists("/db/000001.log"));
+    ASSERT_FALSE(env.FileExists("/db/000002.log"));
+    uint64_t sz = 0;
+    ASSERT_TRUE(env.GetFileSize("/db/000001.log", &sz).ok());
+    ASSERT_EQ(sz, 11U);
+    ASSERT_EQ(env.bytes(), 11U);
+    ASSERT_EQ(read_all(&env, "/db/000001.log"), "hello world");
+    leveldb::RandomAccessFile* r = NULL;
+    ASSERT_TRUE(env.NewRandomAccessFile("/db/000001.log", &r).ok());
+    char scratch[16];
+    leveldb::Slice s;
+    ASSERT_TRUE(r->Read(6, 16, &s, scratch).ok());
+    ASSERT_EQ(s.ToString(), "world");
+    delete r;
+    ASSERT_FALSE(env.NewRandomAccessFile("/db/000002.log", &r).ok());
+}
+
+TEST(MemoryEnv, WriteAt)
+{
+    memory_env env(leveldb::Env::Default());
+    leveldb::ConcurrentWritableFile* w = NULL;
+    ASSERT_TRUE(env.NewConcurrentWritableFile("/db/000003.log", &w).ok());
+    // writes at offsets may arrive out of order
+    ASSERT_TRUE(w->WriteAt(4, leveldb::Slice("efgh", 4)).ok());
+    ASSERT_TRUE(w->WriteAt(0, leveldb::Slice("abcd", 4)).ok());
+    delete w;
+    ASSERT_EQ(read_all(&env, "/db/000003.log"), "abcdefgh");
+}
+
+TEST(MemoryEnv, Names)
+{
+    memory_env env(leveldb::Env::Default());
+    leveldb::WritableFile* w = NULL;
+    ASSERT_TRUE(env.NewWritableFile("/db/CURRENT.tmp", &w).ok());
+    ASSERT_TRUE(w->Append(leveldb::Slice("MANIFEST-000002\n", 16)).ok());
+    // an open handle keeps contents that a rename moves on
+    ASSERT_TRUE(env.RenameFile("/db/CURRENT.tmp", "/db/CURRENT").ok());
+    delete w;
+    ASSERT_FALSE(env.FileExists("/db/CURRENT.tmp"));
+    ASSERT_EQ(read_all(&env, "/db/CURRENT"), "MANIFEST-000002\n");
+    ASSERT_TRUE(env.LinkFile("/db/CURRENT", "/db/backup/CURRENT").ok());
+    ASSERT_TRUE(env.CopyFile("/db/CURRENT", "/db/COPY").ok());
+    std::vector<std::string> children;
+    ASSERT_TRUE(env.GetChildren("/db", &children).ok());
+    std::sort(children.begin(), children.end());
+    ASSERT_EQ(children.size(), 2U);
+    ASSERT_EQ(children[0], "COPY");
+    ASSERT_EQ(children[1], "CURRENT");
+    // a link outlives the name it was made from
+    ASSERT_TRUE(env.DeleteFile("/db/CURRENT").ok());
+    ASSERT_FALSE(env.DeleteFile("/db/CURRENT").ok());
+    ASSERT_EQ(read_all(&env, "/db/backup/CURRENT"), "MANIFEST-000002\n");
+    ASSERT_EQ(read_all(&env, "/db/COPY"), "MANIFEST-000002\n");
+}
@@ -0,0 +1,111 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/maintenance_window.h"
+
+using hyperdex::maintenance_window;
+
+// seconds since the epoch of the given time on 1 January 1970
+static uint64_t
+at(uint64_t hours, uint64_t minutes)
+{
+    return hours * 3600 + minutes * 60;
+}
+
+TEST(MaintenanceWindow, AlwaysOpen)
+{
+    maintenance_window mw;
+    ASSERT_TRUE(mw.is_open(at(0, 0)));
+    ASSERT_TRUE(mw.is_open(at(13, 37)));
+    ASSERT_TRUE(mw.set(120, 120, 0));
+    ASSERT_TRUE(mw.is_open(at(23, 59)));
+}
+
+TEST(MaintenanceWindow, Daytime)
+{
+    maintenance_window mw;
+    ASSERT_TRUE(mw.set(at(2, 0) / 60, at(5, 30) / 60, 0));
+    ASSERT_FALSE(mw.is_open(at(1, 59)));
+    ASSERT_TRUE(mw.is_open(at(2, 0)));
+    ASSERT_TRUE(mw.is_open(at(5, 29)));
+    ASSERT_FALSE(mw.is_open(at(5, 30)));
+    // any day will do
+    ASSERT_TRUE(mw.is_open(at(24 * 400 + 3, 0)));
+    ASSERT_FALSE(mw.is_open(at(24 * 400 + 12, 0)));
+}
+
+TEST(MaintenanceWindow, PastMidnight)
+{
+    maintenance_window mw;
+    ASSERT_TRUE(mw.set(at(22, 0) / 60, at(4, 0) / 60, 0));
+    ASSERT_FALSE(mw.is_open(at(21, 59)));
+    ASSERT_TRUE(mw.is_open(at(22, 0)));
+    ASSERT_TRUE(mw.is_open(at(0, 0)));
+    ASSERT_TRUE(mw.is_open(at(3, 59)));
+    ASSERT_FALSE(mw.is_open(at(4, 0)));
+    ASSERT_FALSE(mw.is_open(at(12, 0)));
+}
+
+TEST(MaintenanceWindow, Invalid)
+{
+    maintenance_window mw;
+    ASSERT_FALSE(mw.set(maintenance_window::MINUTES_PER_DAY, 0, 0));
+    ASSERT_FALSE(mw.set(0, maintenance_window::MINUTES_PER_DAY, 0));
+    uint16_t start = 1;
+    uint16_t end = 1;
+    uint64_t budget = 1;
+    mw.get(&start, &end, &budget);
+    ASSERT_EQ(0U, start);
+    ASSERT_EQ(0U, end);
+    ASSERT_EQ(0U, budget);
+}
+
+TEST(MaintenanceWindow, Unthrottled)
+{
+    maintenance_window mw;
+    ASSERT_EQ(0U, mw.charge(1ULL << 30, 1000000000ULL));
+    ASSERT_EQ(0U, mw.charge(1ULL << 30, 1000000000ULL));
+}
+
+TEST(MaintenanceWindow, Budget)
+{
+    const uint64_t second = 1000000000ULL;
+    const uint64_t now = 100 * second;
+    maintenance_window mw;
+    ASSERT_TRUE(mw.set(0, 0, 1000000));
+    // an idle window lends a second's worth of writes
+    ASSERT_EQ(0U, mw.charge(1000000, now));
+    // and the writers share what is left
+    ASSERT_EQ(second / 2, mw.charge(500000, now));
+    ASSERT_EQ(second, mw.charge(500000, now));
+    ASSERT_EQ(second / 2, mw.charge(0, now + second / 2));
+    // the credit is bounded however long the writers wait
+    ASSERT_EQ(second, mw.charge(2000000, now + 10 * second));
+}
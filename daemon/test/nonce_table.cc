@@ -0,0 +1,102 @@
+// Copyright (c) 2013, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/nonce_table.h"
+
+using hyperdex::network_returncode;
+using hyperdex::nonce_table;
+using hyperdex::region_id;
+using hyperdex::server_id;
+
+#define SECONDS(X) ((X) * 1000ULL * 1000ULL * 1000ULL)
+
+TEST(NonceTable, Retry)
+{
+    nonce_table nt;
+    region_id ri(1);
+    server_id c1(7);
+    server_id c2(8);
+    network_returncode ret = hyperdex::NET_SERVERERROR;
+    nt.adopt(&ri, 1);
+    // a new op gets marked, and its retry finds it pending
+    ASSERT_EQ(nt.check_and_mark(ri, c1, 1, SECONDS(1), &ret), nonce_table::NONCE_UNSEEN);
+    ASSERT_EQ(nt.check_and_mark(ri, c1, 1, SECONDS(2), &ret), nonce_table::NONCE_PENDING);
+    // the same nonce from another client is a different op
+    ASSERT_EQ(nt.check_and_mark(ri, c2, 1, SECONDS(2), &ret), nonce_table::NONCE_UNSEEN);
+    // once complete, the retry gets the same result
+    nt.complete(ri, c1, 1, hyperdex::NET_CMPFAIL);
+    ASSERT_EQ(nt.check_and_mark(ri, c1, 1, SECONDS(3), &ret), nonce_table::NONCE_COMPLETED);
+    ASSERT_EQ(ret, hyperdex::NET_CMPFAIL);
+    // and it is forgotten after it expires
+    ASSERT_EQ(nt.check_and_mark(ri, c1, 1, SECONDS(1000), &ret), nonce_table::NONCE_UNSEEN);
+}
+
+TEST(NonceTable, Adopt)
+{
+    nonce_table nt;
+    region_id ris[2];
+    ris[0] = region_id(1);
+    ris[1] = region_id(2);
+    server_id c(7);
+    network_returncode ret = hyperdex::NET_SERVERERROR;
+    // regions not adopted are not tracked
+    ASSERT_EQ(nt.check_and_mark(ris[0], c, 1, SECONDS(1), &ret), nonce_table::NONCE_UNSEEN);
+    ASSERT_EQ(nt.check_and_mark(ris[0], c, 1, SECONDS(1), &ret), nonce_table::NONCE_UNSEEN);
+    nt.adopt(ris, 2);
+    ASSERT_EQ(nt.check_and_mark(ris[0], c, 1, SECONDS(1), &ret), nonce_table::NONCE_UNSEEN);
+    ASSERT_EQ(nt.check_and_mark(ris[0], c, 2, SECONDS(1), &ret), nonce_table::NONCE_UNSEEN);
+    nt.complete(ris[0], c, 1, hyperdex::NET_SUCCESS);
+    // pending ops may be discarded by a reconfiguration; completed ones stay
+    nt.adopt(ris, 2);
+    ASSERT_EQ(nt.check_and_mark(ris[0], c, 1, SECONDS(2), &ret), nonce_table::NONCE_COMPLETED);
+    ASSERT_EQ(ret, hyperdex::NET_SUCCESS);
+    ASSERT_EQ(nt.check_and_mark(ris[0], c, 2, SECONDS(2), &ret), nonce_table::NONCE_UNSEEN);
+    // dropping a region drops what it knew
+    nt.adopt(ris + 1, 1);
+    nt.adopt(ris, 2);
+    ASSERT_EQ(nt.check_and_mark(ris[0], c, 1, SECONDS(2), &ret), nonce_table::NONCE_UNSEEN);
+}
+
+TEST(NonceTable, Bounded)
+{
+    nonce_table nt;
+    region_id ri(1);
+    server_id c(7);
+    network_returncode ret = hyperdex::NET_SERVERERROR;
+    nt.adopt(&ri, 1);
+
+    for (uint64_t i = 1; i <= 5000; ++i)
+    {
+        ASSERT_EQ(nt.check_and_mark(ri, c, i, SECONDS(1), &ret), nonce_table::NONCE_UNSEEN);
+    }
+
+    // the oldest have been forgotten, the newest have not
+    ASSERT_EQ(nt.check_and_mark(ri, c, 1, SECONDS(1), &ret), nonce_table::NONCE_UNSEEN);
+    ASSERT_EQ(nt.check_and_mark(ri, c, 5000, SECONDS(1), &ret), nonce_table::NONCE_PENDING);
+}
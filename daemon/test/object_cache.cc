@@ -0,0 +1,129 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#define __STDC_LIMIT_MACROS
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/object_cache.h"
+
+using hyperdex::object_cache;
+using hyperdex::region_id;
+
+TEST(ObjectCache, HitMiss)
+{
+    object_cache oc;
+    oc.set_budget(1 << 20);
+    region_id ri(1);
+    e::slice key("key", 3);
+    std::string value;
+    uint64_t gen;
+    ASSERT_FALSE(oc.lookup(ri, key, &value, &gen));
+    oc.insert(ri, key, gen, "value");
+    ASSERT_TRUE(oc.lookup(ri, key, &value, &gen));
+    ASSERT_EQ(value, "value");
+    // same key in another region is a different object
+    ASSERT_FALSE(oc.lookup(region_id(2), key, &value, &gen));
+    ASSERT_EQ(oc.hits(), 1U);
+    ASSERT_EQ(oc.misses(), 2U);
+    // invalidation drops it
+    oc.invalidate(ri, key);
+    ASSERT_FALSE(oc.lookup(ri, key, &value, &gen));
+    ASSERT_EQ(oc.bytes(), 0U);
+}
+
+TEST(ObjectCache, RacingWrite)
+{
+    object_cache oc;
+    oc.set_budget(1 << 20);
+    region_id ri(1);
+    e::slice key("key", 3);
+    std::string value;
+    uint64_t gen;
+    // a reader misses, a writer invalidates, then the reader tries to fill
+    // the cache with what it read before the write
+    ASSERT_FALSE(oc.lookup(ri, key, &value, &gen));
+    oc.invalidate(ri, key);
+    oc.insert(ri, key, gen, "stale");
+    ASSERT_FALSE(oc.lookup(ri, key, &value, &gen));
+    // and clearing has the same effect
+    oc.clear();
+    oc.insert(ri, key, gen, "stale");
+    ASSERT_FALSE(oc.lookup(ri, key, &value, &gen));
+}
+
+TEST(ObjectCache, Budget)
+{
+    object_cache oc;
+    // roughly 1KB for each of the shards
+    oc.set_budget(64 * 1024);
+    std::string big(4096, 'x');
+    std::string value;
+    uint64_t gen;
+
+    for (uint64_t i = 0; i < 1024; ++i)
+    {
+        e::slice key(reinterpret_cast<const char*>(&i), sizeof(i));
+        ASSERT_FALSE(oc.lookup(region_id(1), key, &value, &gen));
+        oc.insert(region_id(1), key, gen, big);
+        oc.insert(region_id(1), key, gen, "small");
+    }
+
+    ASSERT_LE(oc.bytes(), 64U * 1024U);
+    ASSERT_GT(oc.bytes(), 0U);
+}
+
+TEST(ObjectCache, Replace)
+{
+    object_cache oc;
+    oc.set_budget(1 << 20);
+    region_id ri(1);
+    e::slice key("key", 3);
+    std::string value;
+    uint64_t gen;
+    ASSERT_FALSE(oc.lookup(ri, key, &value, &gen));
+    oc.replace(ri, key, gen, "one");
+    // a hit still hands out the token, and replace overwrites where insert
+    // would not
+    ASSERT_TRUE(oc.lookup(ri, key, &value, &gen));
+    oc.insert(ri, key, gen, "two");
+    ASSERT_TRUE(oc.lookup(ri, key, &value, &gen));
+    ASSERT_EQ(value, "one");
+    oc.replace(ri, key, gen, "two");
+    ASSERT_TRUE(oc.lookup(ri, key, &value, &gen));
+    ASSERT_EQ(value, "two");
+    // erase keeps the token good, invalidate does not
+    oc.erase(ri, key);
+    uint64_t before = gen;
+    ASSERT_FALSE(oc.lookup(ri, key, &value, &gen));
+    ASSERT_EQ(gen, before);
+    oc.replace(ri, key, gen, "three");
+    ASSERT_TRUE(oc.lookup(ri, key, &value, &gen));
+    ASSERT_EQ(value, "three");
+    oc.invalidate(ri, key);
+    oc.replace(ri, key, gen, "stale");
+    ASSERT_FALSE(oc.lookup(ri, key, &value, &gen));
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#define __STDC_LIMIT_MACROS
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/peer_lease.h"
+
+using hyperdex::peer_lease;
+using hyperdex::server_id;
+
+TEST(PeerLease, Expiry)
+{
+    peer_lease pl;
+    server_id p(1);
+    server_id q(2);
+    const uint64_t start = 1000000000ULL;
+    const uint64_t timeout = 500000000ULL;
+    pl.reset(start);
+
+    // every lease runs from the reset
+    ASSERT_FALSE(pl.expired(p, start + timeout, timeout));
+    ASSERT_TRUE(pl.expired(p, start + timeout + 1, timeout));
+    ASSERT_TRUE(pl.expired(q, start + timeout + 1, timeout));
+
+    // hearing from one peer renews its lease alone
+    pl.heard(p, start + timeout);
+    ASSERT_FALSE(pl.expired(p, start + timeout + 1, timeout));
+    ASSERT_TRUE(pl.expired(q, start + timeout + 1, timeout));
+    ASSERT_TRUE(pl.expired(p, start + 2 * timeout + 1, timeout));
+
+    // a clock that reads behind the lease never expires it
+    ASSERT_FALSE(pl.expired(p, start, timeout));
+}
+
+TEST(PeerLease, Granularity)
+{
+    peer_lease pl;
+    server_id p(1);
+    const uint64_t start = 1000000000ULL;
+    pl.reset(start);
+
+    // renewals within a millisecond of the last are not recorded
+    pl.heard(p, start + 500000ULL);
+    ASSERT_TRUE(pl.expired(p, start + 1000000ULL, 999999ULL));
+    pl.heard(p, start + 2000000ULL);
+    ASSERT_FALSE(pl.expired(p, start + 2000000ULL, 0));
+}
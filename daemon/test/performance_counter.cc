@@ -0,0 +1,110 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// POSIX
+#include <pthread.h>
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/performance_counter.h"
+#include "daemon/thread_stripe.h"
+
+using hyperdex::performance_counter;
+
+namespace
+{
+
+const size_t THREADS = 8;
+const uint64_t TAPS = 100000;
+
+struct tapper
+{
+    tapper() : counter(NULL), stripe(0) {}
+    performance_counter* counter;
+    size_t stripe;
+};
+
+void*
+tap_many(void* arg)
+{
+    tapper* t = static_cast<tapper*>(arg);
+
+    for (uint64_t i = 0; i < TAPS; ++i)
+    {
+        t->counter->tap();
+    }
+
+    t->counter->add(TAPS);
+    t->stripe = hyperdex::thread_stripe();
+    return NULL;
+}
+
+} // namespace
+
+TEST(PerformanceCounter, Single)
+{
+    performance_counter pc;
+    ASSERT_EQ(pc.read(), 0U);
+    pc.tap();
+    pc.tap();
+    ASSERT_EQ(pc.read(), 2U);
+    pc.add(40);
+    ASSERT_EQ(pc.read(), 42U);
+}
+
+TEST(PerformanceCounter, Threads)
+{
+    performance_counter pc;
+    tapper tappers[THREADS];
+    pthread_t threads[THREADS];
+
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+        tappers[i].counter = &pc;
+        ASSERT_EQ(pthread_create(&threads[i], NULL, tap_many, &tappers[i]), 0);
+    }
+
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+        ASSERT_EQ(pthread_join(threads[i], NULL), 0);
+    }
+
+    // no tap is lost to the striping, and no two threads shared a stripe
+    ASSERT_EQ(pc.read(), THREADS * TAPS * 2);
+
+    for (size_t i = 0; i < THREADS; ++i)
+    {
+        for (size_t j = i + 1; j < THREADS; ++j)
+        {
+            ASSERT_NE(tappers[i].stripe, tappers[j].stripe);
+        }
+    }
+
+    // a thread keeps the stripe it was first given
+    ASSERT_EQ(hyperdex::thread_stripe(), hyperdex::thread_stripe());
+}
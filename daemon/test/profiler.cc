@@ -0,0 +1,92 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <stdint.h>
+
+// POSIX
+#include <time.h>
+
+// STL
+#include <string>
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/profiler.h"
+
+using hyperdex::profiler;
+
+// kept out of line and exported so that a sample can name it
+extern "C" uint64_t
+profiler_test_spin(uint64_t nanos)
+{
+    struct timespec start;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    volatile uint64_t x = 0;
+
+    do
+    {
+        for (int i = 0; i < 100000; ++i)
+        {
+            x = x * 31 + i;
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    }
+    while ((now.tv_sec - start.tv_sec) * 1000000000ULL + now.tv_nsec - start.tv_nsec < nanos);
+
+    return x;
+}
+
+TEST(Profiler, FoldsStacks)
+{
+    ASSERT_TRUE(profiler::start());
+    // only one profile at a time
+    ASSERT_FALSE(profiler::start());
+    profiler_test_spin(500000000ULL);
+    std::string folded;
+    uint64_t samples = 0;
+    uint64_t dropped = 0;
+    profiler::stop(&folded, &samples, &dropped);
+    ASSERT_TRUE(samples > 0);
+    ASSERT_EQ(dropped, 0U);
+    ASSERT_TRUE(folded.find("profiler_test_spin") != std::string::npos);
+    ASSERT_EQ(folded[folded.size() - 1], '\n');
+}
+
+TEST(Profiler, Restarts)
+{
+    ASSERT_TRUE(profiler::start());
+    std::string folded;
+    uint64_t samples = 0;
+    uint64_t dropped = 0;
+    profiler::stop(&folded, &samples, &dropped);
+    ASSERT_TRUE(profiler::start());
+    profiler::stop(&folded, &samples, &dropped);
+}
@@ -0,0 +1,111 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#define __STDC_LIMIT_MACROS
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/retransmit_timer.h"
+
+using hyperdex::retransmit_timer;
+using hyperdex::server_id;
+
+TEST(RetransmitTimer, Timeout)
+{
+    retransmit_timer rt;
+    server_id p(1);
+    // peers we have never heard from get the initial timeout
+    ASSERT_EQ(rt.timeout(p, 0), 200000000ULL);
+    ASSERT_EQ(rt.timeout(p, 1), 400000000ULL);
+
+    // a steady 1ms round trip settles near the floor
+    for (size_t i = 0; i < 64; ++i)
+    {
+        rt.sample(p, 1000000ULL);
+    }
+
+    ASSERT_EQ(rt.timeout(p, 0), 10000000ULL);
+    ASSERT_EQ(rt.timeout(p, 2), 40000000ULL);
+    // and backoff stops at the ceiling
+    ASSERT_EQ(rt.timeout(p, 64), 5000000000ULL);
+
+    // a slow peer gets a longer timeout than the fast one
+    server_id q(2);
+
+    for (size_t i = 0; i < 64; ++i)
+    {
+        rt.sample(q, 100000000ULL + (i % 2) * 20000000ULL);
+    }
+
+    ASSERT_GT(rt.timeout(q, 0), 110000000ULL);
+    ASSERT_LT(rt.timeout(q, 0), 200000000ULL);
+    ASSERT_EQ(rt.timeout(p, 0), 10000000ULL);
+}
+
+TEST(RetransmitTimer, Admit)
+{
+    retransmit_timer rt;
+    server_id p(1);
+    uint64_t now = 1000000000ULL;
+    size_t admitted = 0;
+
+    while (rt.admit(p, now))
+    {
+        ++admitted;
+    }
+
+    // a full burst, then nothing until time passes
+    ASSERT_EQ(admitted, 1000U);
+    ASSERT_FALSE(rt.admit(p, now));
+    // other peers keep their own budgets
+    ASSERT_TRUE(rt.admit(server_id(2), now));
+    // 10ms buys 100 more
+    now += 10000000ULL;
+    admitted = 0;
+
+    while (rt.admit(p, now))
+    {
+        ++admitted;
+    }
+
+    ASSERT_EQ(admitted, 100U);
+}
+
+TEST(RetransmitTimer, Backoff)
+{
+    for (uint64_t seed = 0; seed < 1000; seed += 7)
+    {
+        uint64_t first = retransmit_timer::backoff(0, seed);
+        uint64_t third = retransmit_timer::backoff(2, seed);
+        uint64_t last = retransmit_timer::backoff(64, seed);
+        ASSERT_GE(first, 7500000ULL);
+        ASSERT_LE(first, 12500000ULL);
+        ASSERT_GE(third, 30000000ULL);
+        ASSERT_LE(third, 50000000ULL);
+        ASSERT_GE(last, 3750000000ULL);
+        ASSERT_LE(last, 6250000000ULL);
+    }
+}
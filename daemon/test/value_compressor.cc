@@ -0,0 +1,116 @@
+// Copyright (c) 2013, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#define __STDC_LIMIT_MACROS
+
+// STL
+#include <sstream>
+#include <string>
+#include <vector>
+
+// HyperDex
+#include "test/th.h"
+#include "common/compression.h"
+#include "daemon/value_compressor.h"
+
+using hyperdex::space_id;
+using hyperdex::value_compressor;
+
+static std::string
+document(uint64_t i)
+{
+    std::ostringstream ostr;
+    ostr << "{\"user\": " << i << ", \"status\": \"active\", "
+         << "\"plan\": \"enterprise\", \"region\": \"us-east\"}";
+    return ostr.str();
+}
+
+TEST(ValueCompressor, TrainThenCompress)
+{
+    value_compressor vc;
+    const space_id sid(5);
+    uint32_t id = 0;
+    std::string dict;
+    bool trained = false;
+
+    for (uint64_t i = 0; !trained && i < 1000000; ++i)
+    {
+        std::string doc(document(i));
+        std::vector<e::slice> value(1, e::slice(doc));
+        trained = vc.sample(sid, value, &id, &dict);
+    }
+
+    if (!hyperdex::compression_available())
+    {
+        // without a compressor every attribute is stored as it is
+        ASSERT_FALSE(trained);
+        std::string doc(document(1));
+        std::vector<char> out;
+        uint32_t used = 0;
+        ASSERT_FALSE(vc.compress(sid, e::slice(doc), &used, &out));
+        return;
+    }
+
+    ASSERT_TRUE(trained);
+    ASSERT_LT(0U, id);
+    ASSERT_LT(0U, dict.size());
+    vc.load(id, sid, e::slice(dict));
+
+    // once a space has its dictionary it samples no more
+    std::string doc(document(424242));
+    std::vector<e::slice> value(1, e::slice(doc));
+    uint32_t other = 0;
+    std::string unused;
+    ASSERT_FALSE(vc.sample(sid, value, &other, &unused));
+
+    std::vector<char> packed;
+    uint32_t used = 0;
+    ASSERT_TRUE(vc.compress(sid, e::slice(doc), &used, &packed));
+    ASSERT_EQ(id, used);
+    ASSERT_LT(packed.size(), doc.size());
+    std::vector<char> unpacked;
+    ASSERT_TRUE(vc.decompress(used, e::slice(&packed[0], packed.size()), doc.size(), &unpacked));
+    ASSERT_EQ(doc, std::string(&unpacked[0], unpacked.size()));
+    ASSERT_FALSE(vc.decompress(used + 1, e::slice(&packed[0], packed.size()), doc.size(), &unpacked));
+
+    uint64_t dictionaries = 0;
+    uint64_t raw = 0;
+    uint64_t stored = 0;
+    vc.stats(&dictionaries, &raw, &stored);
+    ASSERT_EQ(1U, dictionaries);
+    ASSERT_EQ(doc.size(), raw);
+    ASSERT_EQ(packed.size(), stored);
+}
+
+TEST(ValueCompressor, ShortAttributes)
+{
+    value_compressor vc;
+    std::string tiny("{}");
+    std::vector<char> out;
+    uint32_t used = 0;
+    ASSERT_FALSE(vc.compress(space_id(1), e::slice(tiny), &used, &out));
+}
@@ -0,0 +1,188 @@
+// Copyright (c) 2013, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#define __STDC_LIMIT_MACROS
+
+// C
+#include <stdint.h>
+#include <stdlib.h>
+
+// POSIX
+#include <sys/stat.h>
+#include <unistd.h>
+
+// STL
+#include <string>
+#include <vector>
+
+// HyperDex
+#include "test/th.h"
+#include "daemon/value_log.h"
+
+using hyperdex::value_log;
+
+namespace
+{
+
+std::string
+make_dir()
+{
+    char tmpl[] = "/tmp/hyperdex-value-log-XXXXXX";
+    const char* dir = mkdtemp(tmpl);
+    ASSERT_TRUE(dir != NULL);
+    return std::string(dir) + "/vlog";
+}
+
+void
+remove_dir(const std::string& dir)
+{
+    std::string cmd("rm -rf " + dir.substr(0, dir.size() - 5));
+    ASSERT_EQ(system(cmd.c_str()), 0);
+}
+
+} // namespace
+
+TEST(ValueLog, AppendRead)
+{
+    std::string dir(make_dir());
+    value_log vl;
+    ASSERT_TRUE(vl.open(dir, true));
+    value_log::pointer p1;
+    value_log::pointer p2;
+
+    {
+        value_log::appends logged(&vl);
+        ASSERT_TRUE(vl.append(e::slice("hello", 5), &p1, &logged));
+        ASSERT_TRUE(vl.append(e::slice("world!", 6), &p2, &logged));
+        ASSERT_TRUE(vl.sync());
+    }
+
+    ASSERT_EQ(p1.segment, p2.segment);
+    ASSERT_EQ(p1.size, 5U);
+    ASSERT_EQ(p2.size, 6U);
+    std::string v;
+    ASSERT_TRUE(vl.read(p1, &v));
+    ASSERT_EQ(v, "hello");
+    ASSERT_TRUE(vl.read(p2, &v));
+    ASSERT_EQ(v, "world!");
+    // a pointer whose size disagrees with the record is refused
+    value_log::pointer bad(p2);
+    bad.size = 5;
+    ASSERT_FALSE(vl.read(bad, &v));
+    remove_dir(dir);
+}
+
+TEST(ValueLog, Horizon)
+{
+    std::string dir(make_dir());
+    value_log vl;
+    ASSERT_TRUE(vl.open(dir, true));
+    value_log::pointer p1;
+    value_log::pointer p2;
+    std::vector<std::pair<uint64_t, uint64_t> > segs;
+
+    {
+        value_log::appends logged(&vl);
+        ASSERT_TRUE(vl.append(e::slice("a", 1), &p1, &logged));
+        // an append not yet settled holds its segment at the horizon
+        ASSERT_EQ(vl.seal(), p1.segment);
+        vl.segments(vl.seal(), &segs);
+        ASSERT_TRUE(segs.empty());
+    }
+
+    // once settled, the sealed segment is before the horizon, and appends
+    // go to a new one
+    ASSERT_TRUE(vl.seal() > p1.segment);
+
+    {
+        value_log::appends logged(&vl);
+        ASSERT_TRUE(vl.append(e::slice("b", 1), &p2, &logged));
+    }
+
+    ASSERT_TRUE(p2.segment > p1.segment);
+    vl.segments(p2.segment, &segs);
+    ASSERT_EQ(segs.size(), 1U);
+    ASSERT_EQ(segs[0].first, p1.segment);
+    ASSERT_EQ(segs[0].second, sizeof(uint32_t) + 1);
+    // removing a segment makes its values unreadable
+    ASSERT_TRUE(vl.remove(p1.segment));
+    std::string v;
+    ASSERT_FALSE(vl.read(p1, &v));
+    ASSERT_TRUE(vl.read(p2, &v));
+    ASSERT_EQ(v, "b");
+    uint64_t segments = 0;
+    uint64_t bytes = 0;
+    uint64_t live = 0;
+    uint64_t reclaimed = 0;
+    vl.stats(&segments, &bytes, &live, &reclaimed);
+    ASSERT_EQ(segments, 1U);
+    ASSERT_EQ(bytes, sizeof(uint32_t) + 1);
+    ASSERT_EQ(reclaimed, 1U);
+    remove_dir(dir);
+}
+
+TEST(ValueLog, Reopen)
+{
+    std::string dir(make_dir());
+    value_log::pointer p1;
+
+    {
+        value_log vl;
+        ASSERT_TRUE(vl.open(dir, true));
+        value_log::appends logged(&vl);
+        ASSERT_TRUE(vl.append(e::slice("persist", 7), &p1, &logged));
+    }
+
+    // a log that was never created is empty without "create"
+    value_log missing;
+    ASSERT_TRUE(missing.open(dir + "-missing", false));
+    std::string v;
+    ASSERT_FALSE(missing.read(p1, &v));
+    // a reopened log reads old values but appends to a new segment
+    value_log vl;
+    ASSERT_TRUE(vl.open(dir, false));
+    ASSERT_TRUE(vl.read(p1, &v));
+    ASSERT_EQ(v, "persist");
+    value_log::pointer p2;
+
+    {
+        value_log::appends logged(&vl);
+        ASSERT_TRUE(vl.append(e::slice("new", 3), &p2, &logged));
+    }
+
+    ASSERT_TRUE(p2.segment > p1.segment);
+    // a backup gets a link to every segment
+    ASSERT_TRUE(vl.link_into(dir + "-backup"));
+    value_log backup;
+    ASSERT_TRUE(backup.open(dir + "-backup", false));
+    ASSERT_TRUE(backup.read(p1, &v));
+    ASSERT_EQ(v, "persist");
+    ASSERT_TRUE(backup.read(p2, &v));
+    ASSERT_EQ(v, "new");
+    remove_dir(dir);
+}
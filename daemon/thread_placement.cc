@@ -0,0 +1,494 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+// C
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// POSIX
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+// STL
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+
+// Google Log
+#include <glog/logging.h>
+
+// HyperDex
+#include "daemon/thread_placement.h"
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+using hyperdex::thread_placement;
+
+namespace
+{
+
+struct cpu_info
+{
+    cpu_info() : id(0), package(0), core(0), node(0), sibling(0), core_rank(0) {}
+    unsigned id;
+    unsigned package;
+    unsigned core;
+    unsigned node;
+    // position among the hardware threads of its core
+    unsigned sibling;
+    // position of its core among the cores of its package
+    unsigned core_rank;
+};
+
+bool
+compare_compact(const cpu_info& lhs, const cpu_info& rhs)
+{
+    if (lhs.node != rhs.node) return lhs.node < rhs.node;
+    if (lhs.package != rhs.package) return lhs.package < rhs.package;
+    if (lhs.core != rhs.core) return lhs.core < rhs.core;
+    return lhs.id < rhs.id;
+}
+
+bool
+compare_scatter(const cpu_info& lhs, const cpu_info& rhs)
+{
+    if (lhs.sibling != rhs.sibling) return lhs.sibling < rhs.sibling;
+    if (lhs.core_rank != rhs.core_rank) return lhs.core_rank < rhs.core_rank;
+    if (lhs.node != rhs.node) return lhs.node < rhs.node;
+    if (lhs.package != rhs.package) return lhs.package < rhs.package;
+    return lhs.id < rhs.id;
+}
+
+bool
+parse_cpu_list(const char* s, std::vector<unsigned>* cpus)
+{
+    cpus->clear();
+
+    while (*s && *s != '\n')
+    {
+        char* end = NULL;
+        unsigned long lower = strtoul(s, &end, 10);
+
+        if (end == s)
+        {
+            return false;
+        }
+
+        unsigned long upper = lower;
+        s = end;
+
+        if (*s == '-')
+        {
+            ++s;
+            upper = strtoul(s, &end, 10);
+
+            if (end == s || upper < lower)
+            {
+                return false;
+            }
+
+            s = end;
+        }
+
+        for (unsigned long c = lower; c <= upper; ++c)
+        {
+            cpus->push_back(c);
+        }
+
+        if (*s == ',')
+        {
+            ++s;
+        }
+        else if (*s && *s != '\n')
+        {
+            return false;
+        }
+    }
+
+    return !cpus->empty();
+}
+
+bool
+read_line(const std::string& path, std::string* line)
+{
+    FILE* fin = fopen(path.c_str(), "r");
+
+    if (!fin)
+    {
+        return false;
+    }
+
+    char buf[4096];
+    bool ret = fgets(buf, sizeof(buf), fin) != NULL;
+    fclose(fin);
+
+    if (ret)
+    {
+        *line = buf;
+    }
+
+    return ret;
+}
+
+bool
+read_cpu_list(const std::string& path, std::vector<unsigned>* cpus)
+{
+    std::string line;
+    return read_line(path, &line) && parse_cpu_list(line.c_str(), cpus);
+}
+
+unsigned
+read_topology_id(unsigned cpu, const char* file, unsigned def)
+{
+    std::ostringstream path;
+    path << "/sys/devices/system/cpu/cpu" << cpu << "/topology/" << file;
+    std::string line;
+
+    if (!read_line(path.str(), &line))
+    {
+        return def;
+    }
+
+    return strtoul(line.c_str(), NULL, 10);
+}
+
+std::string
+cpus_to_string(const std::vector<unsigned>& cpus)
+{
+    std::ostringstream ostr;
+
+    for (size_t i = 0; i < cpus.size(); ++i)
+    {
+        ostr << (i > 0 ? "," : "") << cpus[i];
+    }
+
+    return ostr.str();
+}
+
+// Fill in "cpus" with every online CPU.  Missing pieces of /sys are treated
+// as a single NUMA node with one package and no hyperthreads.
+void
+read_topology(std::vector<cpu_info>* cpus)
+{
+    std::vector<unsigned> online;
+
+    if (!read_cpu_list("/sys/devices/system/cpu/online", &online))
+    {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+        for (long i = 0; i < n; ++i)
+        {
+            online.push_back(i);
+        }
+    }
+
+    std::map<unsigned, unsigned> node_of;
+    DIR* dir = opendir("/sys/devices/system/node");
+    struct dirent* ent = NULL;
+
+    while (dir && (ent = readdir(dir)))
+    {
+        unsigned node;
+        char trailing;
+
+        if (sscanf(ent->d_name, "node%u%c", &node, &trailing) != 1)
+        {
+            continue;
+        }
+
+        std::vector<unsigned> members;
+        std::ostringstream path;
+        path << "/sys/devices/system/node/" << ent->d_name << "/cpulist";
+
+        if (!read_cpu_list(path.str(), &members))
+        {
+            continue;
+        }
+
+        for (size_t i = 0; i < members.size(); ++i)
+        {
+            node_of[members[i]] = node;
+        }
+    }
+
+    if (dir)
+    {
+        closedir(dir);
+    }
+
+    cpus->clear();
+
+    for (size_t i = 0; i < online.size(); ++i)
+    {
+        cpu_info c;
+        c.id = online[i];
+        c.package = read_topology_id(c.id, "physical_package_id", 0);
+        c.core = read_topology_id(c.id, "core_id", c.id);
+        std::map<unsigned, unsigned>::iterator n = node_of.find(c.id);
+        c.node = n != node_of.end() ? n->second : 0;
+        cpus->push_back(c);
+    }
+
+    // rank the hyperthreads within a core and the cores within a package
+    std::sort(cpus->begin(), cpus->end(), compare_compact);
+    std::map<std::pair<unsigned, unsigned>, unsigned> siblings;
+    std::map<unsigned, std::set<unsigned> > cores;
+
+    for (size_t i = 0; i < cpus->size(); ++i)
+    {
+        cpu_info& c((*cpus)[i]);
+        c.sibling = siblings[std::make_pair(c.package, c.core)]++;
+        std::set<unsigned>& pkg(cores[c.package]);
+        pkg.insert(c.core);
+        c.core_rank = std::distance(pkg.begin(), pkg.find(c.core));
+    }
+}
+
+} // namespace
+
+thread_placement :: thread_placement()
+    : m_policy(ROUND_ROBIN)
+    , m_explicit()
+    , m_network()
+    , m_background()
+{
+}
+
+thread_placement :: ~thread_placement() throw ()
+{
+}
+
+bool
+thread_placement :: parse(const char* policy)
+{
+    if (strcmp(policy, "round-robin") == 0)
+    {
+        m_policy = ROUND_ROBIN;
+    }
+    else if (strcmp(policy, "compact") == 0)
+    {
+        m_policy = COMPACT;
+    }
+    else if (strcmp(policy, "scatter") == 0)
+    {
+        m_policy = SCATTER;
+    }
+    else if (strcmp(policy, "numa") == 0)
+    {
+        m_policy = NUMA;
+    }
+    else if (parse_cpu_list(policy, &m_explicit))
+    {
+        m_policy = EXPLICIT;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+void
+thread_placement :: initialize(size_t network_threads)
+{
+    std::vector<cpu_info> cpus;
+    read_topology(&cpus);
+    m_network.clear();
+    m_background.clear();
+
+    if (cpus.empty())
+    {
+        LOG(WARNING) << "could not determine the CPU topology; threads will not be bound to CPUs";
+        return;
+    }
+
+    std::map<unsigned, unsigned> node_of;
+    std::map<unsigned, std::vector<unsigned> > node_cpus;
+
+    for (size_t i = 0; i < cpus.size(); ++i)
+    {
+        node_of[cpus[i].id] = cpus[i].node;
+        node_cpus[cpus[i].node].push_back(cpus[i].id);
+    }
+
+    if (m_policy == SCATTER)
+    {
+        std::sort(cpus.begin(), cpus.end(), compare_scatter);
+    }
+
+    std::vector<unsigned> nodes;
+
+    for (std::map<unsigned, std::vector<unsigned> >::iterator it = node_cpus.begin();
+            it != node_cpus.end(); ++it)
+    {
+        nodes.push_back(it->first);
+    }
+
+    for (size_t i = 0; i < network_threads; ++i)
+    {
+        std::vector<unsigned> assigned;
+
+        switch (m_policy)
+        {
+            case ROUND_ROBIN:
+                assigned.push_back(i % cpus.size());
+                break;
+            case COMPACT:
+            case SCATTER:
+                assigned.push_back(cpus[i % cpus.size()].id);
+                break;
+            case NUMA:
+                assigned = node_cpus[nodes[i % nodes.size()]];
+                break;
+            case EXPLICIT:
+                assigned.push_back(m_explicit[i % m_explicit.size()]);
+
+                if (i < m_explicit.size() &&
+                    node_of.find(assigned.back()) == node_of.end())
+                {
+                    LOG(WARNING) << "CPU " << assigned.back() << " is not online";
+                }
+
+                break;
+            default:
+                abort();
+        }
+
+        m_network.push_back(assigned);
+    }
+
+    if (m_policy == ROUND_ROBIN)
+    {
+        return;
+    }
+
+    // confine the background threads to the nodes the network threads use
+    std::set<unsigned> used;
+
+    for (size_t i = 0; i < m_network.size(); ++i)
+    {
+        for (size_t j = 0; j < m_network[i].size(); ++j)
+        {
+            std::map<unsigned, unsigned>::iterator n = node_of.find(m_network[i][j]);
+
+            if (n != node_of.end())
+            {
+                used.insert(n->second);
+            }
+        }
+    }
+
+    if (used.size() < nodes.size())
+    {
+        for (std::set<unsigned>::iterator it = used.begin(); it != used.end(); ++it)
+        {
+            m_background.insert(m_background.end(),
+                                node_cpus[*it].begin(),
+                                node_cpus[*it].end());
+        }
+
+        std::sort(m_background.begin(), m_background.end());
+    }
+}
+
+void
+thread_placement :: place_network_thread(size_t thread) const
+{
+    if (thread >= m_network.size())
+    {
+        LOG(INFO) << "network thread " << thread << " started without a CPU binding";
+        return;
+    }
+
+#ifdef __APPLE__
+    thread_affinity_policy_data_t policy;
+    policy.affinity_tag = 0;
+    thread_policy_set(mach_thread_self(),
+                      THREAD_AFFINITY_POLICY,
+                      (thread_policy_t)&policy,
+                      THREAD_AFFINITY_POLICY_COUNT);
+#endif
+
+    if (bind(m_network[thread]))
+    {
+        LOG(INFO) << "network thread " << thread << " started on CPUs " << cpus_to_string(m_network[thread]);
+    }
+    else
+    {
+        LOG(WARNING) << "network thread " << thread << " could not be bound to CPUs " << cpus_to_string(m_network[thread]);
+    }
+}
+
+void
+thread_placement :: place_background_thread(const char* name) const
+{
+    if (m_background.empty())
+    {
+        return;
+    }
+
+    if (bind(m_background))
+    {
+        LOG(INFO) << name << " thread bound to CPUs " << cpus_to_string(m_background);
+    }
+    else
+    {
+        LOG(WARNING) << name << " thread could not be bound to CPUs " << cpus_to_string(m_background);
+    }
+}
+
+bool
+thread_placement :: bind(const std::vector<unsigned>& cpus)
+{
+#ifdef __linux__
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+
+    for (size_t i = 0; i < cpus.size(); ++i)
+    {
+        if (cpus[i] < CPU_SETSIZE)
+        {
+            CPU_SET(cpus[i], &cpuset);
+        }
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) == 0;
+#else
+    (void) cpus;
+    return false;
+#endif
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+#ifndef hyperdex_daemon_thread_placement_h_
+#define hyperdex_daemon_thread_placement_h_
+
+// STL
+#include <string>
+#include <vector>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Decides which CPUs the daemon's threads run on.  The policies are:
+//  - round-robin:  network thread i runs on the i'th online CPU (default)
+//  - compact:  fill every hardware thread of a core, then every core of a
+//    socket, then move on to the next socket
+//  - scatter:  spread across sockets and physical cores before using any
+//    hyperthread siblings
+//  - numa:  network thread i may run anywhere on the i'th NUMA node
+//  - an explicit list of CPUs, e.g. "0,2,8-11"
+// Under every policy but round-robin, the background threads are confined
+// to the NUMA nodes used by the network threads.
+class thread_placement
+{
+    public:
+        thread_placement();
+        ~thread_placement() throw ();
+
+    public:
+        bool parse(const char* policy);
+        // read the topology from /sys and compute the placement of
+        // "network_threads" network threads
+        void initialize(size_t network_threads);
+        void place_network_thread(size_t thread) const;
+        void place_background_thread(const char* name) const;
+
+    private:
+        enum policy_t { ROUND_ROBIN, COMPACT, SCATTER, NUMA, EXPLICIT };
+
+    private:
+        static bool bind(const std::vector<unsigned>& cpus);
+
+    private:
+        policy_t m_policy;
+        std::vector<unsigned> m_explicit;
+        // the CPUs each network thread may use
+        std::vector<std::vector<unsigned> > m_network;
+        // the CPUs the background threads may use; empty means anywhere
+        std::vector<unsigned> m_background;
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_thread_placement_h_
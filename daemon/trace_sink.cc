@@ -0,0 +1,121 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// POSIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+
+// STL
+#include <sstream>
+
+// Google Log
+#include <glog/logging.h>
+
+// po6
+#include <po6/time.h>
+
+// HyperDex
+#include "daemon/key_operation.h"
+#include "daemon/trace_sink.h"
+
+using hyperdex::trace_sink;
+
+trace_sink :: trace_sink()
+    : m_fd()
+{
+}
+
+trace_sink :: ~trace_sink() throw ()
+{
+}
+
+bool
+trace_sink :: open(const std::string& path)
+{
+    m_fd = ::open(path.c_str(), O_WRONLY|O_CREAT|O_APPEND, S_IRUSR|S_IWUSR);
+
+    if (m_fd.get() < 0)
+    {
+        PLOG(ERROR) << "could not open trace file " << path.c_str();
+        return false;
+    }
+
+    return true;
+}
+
+void
+trace_sink :: record(const server_id& us, const region_id& ri,
+                     const key_operation& op)
+{
+    if (m_fd.get() < 0)
+    {
+        return;
+    }
+
+    // place the monotonic stamps on the wall clock so that servers' spans
+    // line up as well as their clocks do
+    const uint64_t received = op.stamped(key_operation::RECEIVED);
+    const uint64_t mono_now = po6::monotonic_time();
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    const uint64_t wall_now = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    const uint64_t wall_received = wall_now - (mono_now - received);
+
+    std::ostringstream ostr;
+    ostr << "trace=" << std::hex << op.trace_id() << std::dec
+         << " server=" << us.get()
+         << " region=" << ri.get()
+         << " version=" << op.this_version()
+         << " from=" << op.recv_from().get()
+         << " to=" << op.sent_to().get()
+         << " at_us=" << wall_received / 1000;
+
+    for (int s = key_operation::STARTED; s < key_operation::NUM_STAGES; ++s)
+    {
+        key_operation::stage_t stage = static_cast<key_operation::stage_t>(s);
+        uint64_t when = op.stamped(stage);
+        ostr << " " << key_operation::stage_name(stage) << "_us=";
+
+        if (when == 0)
+        {
+            ostr << "-";
+        }
+        else
+        {
+            ostr << (when - received) / 1000;
+        }
+    }
+
+    ostr << " retransmits=" << op.retransmits() << "\n";
+    const std::string line(ostr.str());
+
+    if (m_fd.xwrite(line.data(), line.size()) != static_cast<ssize_t>(line.size()))
+    {
+        PLOG(WARNING) << "could not write a span to the trace file";
+    }
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_trace_sink_h_
+#define hyperdex_daemon_trace_sink_h_
+
+// STL
+#include <string>
+
+// po6
+#include <po6/io/fd.h>
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+class key_operation;
+
+// Where the spans of traced ops go.  Each server a traced op passes through
+// appends one line for it once it is done with the op, so that the lines of
+// all servers, joined on their trace id, give the op's path down the chain.
+// Lines are whole single writes to a file opened for appending, so any number
+// of threads may record at once.
+class trace_sink
+{
+    public:
+        trace_sink();
+        ~trace_sink() throw ();
+
+    public:
+        bool open(const std::string& path);
+        bool is_open() const { return m_fd.get() >= 0; }
+        // one line of key=value pairs:  the op's trace id, the server and
+        // region it passed through, its neighbours on the chain, the wall
+        // clock time it arrived in microseconds, and the microseconds from
+        // arrival to each later stage it passed, or "-" for those it skipped
+        void record(const server_id& us, const region_id& ri,
+                    const key_operation& op);
+
+    private:
+        po6::io::fd m_fd;
+
+    private:
+        trace_sink(const trace_sink&);
+        trace_sink& operator = (const trace_sink&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_trace_sink_h_
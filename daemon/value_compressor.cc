@@ -0,0 +1,240 @@
+// Copyright (c) 2013, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// STL
+#include <algorithm>
+
+// HyperDex
+#include "common/compression.h"
+#include "daemon/value_compressor.h"
+
+using hyperdex::value_compressor;
+
+// attributes shorter than this gain too little to be worth compressing
+#define COMPRESS_MIN_BYTES 32
+// one in this many objects written to a space goes in its sample
+#define COMPRESS_SAMPLE_EVERY 4
+// a space's dictionary is trained once its sample holds this many bytes or
+// attributes, of which only the first COMPRESS_SAMPLE_ATTR_BYTES are kept
+#define COMPRESS_SAMPLE_BYTES (1024ULL * 1024ULL)
+#define COMPRESS_SAMPLE_ATTRS 8192
+#define COMPRESS_SAMPLE_ATTR_BYTES 4096
+// LZ4 looks back no more than 64 KB, and loads the dictionary every time it
+// compresses, so dictionaries stay well short of that
+#define COMPRESS_DICTIONARY_BYTES (32ULL * 1024ULL)
+
+class value_compressor::trainer
+{
+    public:
+        trainer() : seen(0), bytes(0), samples(), training(false) {}
+        ~trainer() throw () {}
+
+    public:
+        uint64_t seen;
+        uint64_t bytes;
+        std::vector<std::string> samples;
+        // the sample is complete and a dictionary is being made from it
+        bool training;
+
+    private:
+        trainer(const trainer&);
+        trainer& operator = (const trainer&);
+};
+
+value_compressor :: value_compressor()
+    : m_protect()
+    , m_dictionaries()
+    , m_current()
+    , m_trainers()
+    , m_next_id(1)
+    , m_raw(0)
+    , m_stored(0)
+{
+}
+
+value_compressor :: ~value_compressor() throw ()
+{
+}
+
+void
+value_compressor :: load(uint32_t id, const space_id& sid, const e::slice& dict)
+{
+    po6::threads::mutex::hold hold(&m_protect);
+
+    if (m_dictionaries.find(id) == m_dictionaries.end())
+    {
+        m_dictionaries[id] = std::string(dict.cdata(), dict.size());
+    }
+
+    current_map::iterator it = m_current.find(sid);
+
+    if (it == m_current.end() || it->second < id)
+    {
+        m_current[sid] = id;
+    }
+
+    m_trainers.erase(sid);
+    m_next_id = std::max(m_next_id, id + 1);
+}
+
+bool
+value_compressor :: compress(const space_id& sid, const e::slice& in,
+                             uint32_t* dictionary, std::vector<char>* out)
+{
+    if (in.size() < COMPRESS_MIN_BYTES || !compression_available())
+    {
+        return false;
+    }
+
+    const std::string* dict = NULL;
+    *dictionary = 0;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect);
+        current_map::iterator it = m_current.find(sid);
+
+        if (it != m_current.end())
+        {
+            *dictionary = it->second;
+            dict = &m_dictionaries[it->second];
+        }
+    }
+
+    bool compressed = dict ? compress_with(e::slice(*dict), in, out)
+                           : hyperdex::compress(in, out);
+    po6::threads::mutex::hold hold(&m_protect);
+    m_raw += in.size();
+    m_stored += compressed ? out->size() : in.size();
+    return compressed;
+}
+
+bool
+value_compressor :: decompress(uint32_t dictionary, const e::slice& in,
+                               size_t raw_size, std::vector<char>* out)
+{
+    if (dictionary == 0)
+    {
+        return hyperdex::decompress(in, raw_size, out);
+    }
+
+    const std::string* dict = NULL;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect);
+        dictionary_map::iterator it = m_dictionaries.find(dictionary);
+
+        if (it == m_dictionaries.end())
+        {
+            return false;
+        }
+
+        dict = &it->second;
+    }
+
+    return decompress_with(e::slice(*dict), in, raw_size, out);
+}
+
+bool
+value_compressor :: sample(const space_id& sid, const std::vector<e::slice>& value,
+                           uint32_t* id, std::string* dict)
+{
+    if (!compression_available())
+    {
+        return false;
+    }
+
+    e::compat::shared_ptr<trainer> t;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect);
+
+        if (m_current.find(sid) != m_current.end())
+        {
+            return false;
+        }
+
+        trainer_map::iterator it = m_trainers.find(sid);
+
+        if (it == m_trainers.end())
+        {
+            it = m_trainers.insert(std::make_pair(sid, e::compat::shared_ptr<trainer>(new trainer()))).first;
+        }
+
+        t = it->second;
+
+        if (t->training || t->seen++ % COMPRESS_SAMPLE_EVERY != 0)
+        {
+            return false;
+        }
+
+        for (size_t i = 0; i < value.size(); ++i)
+        {
+            if (value[i].size() < COMPRESS_MIN_BYTES)
+            {
+                continue;
+            }
+
+            size_t sz = std::min(value[i].size(), size_t(COMPRESS_SAMPLE_ATTR_BYTES));
+            t->samples.push_back(std::string(value[i].cdata(), sz));
+            t->bytes += sz;
+        }
+
+        if (t->bytes < COMPRESS_SAMPLE_BYTES &&
+            t->samples.size() < COMPRESS_SAMPLE_ATTRS)
+        {
+            return false;
+        }
+
+        t->training = true;
+    }
+
+    // no other thread touches a sample being trained on
+    train_dictionary(t->samples, COMPRESS_DICTIONARY_BYTES, dict);
+    po6::threads::mutex::hold hold(&m_protect);
+    t->samples.clear();
+    t->bytes = 0;
+
+    // objects with nothing in common get no dictionary; sample them afresh
+    if (dict->empty())
+    {
+        t->training = false;
+        return false;
+    }
+
+    *id = m_next_id;
+    ++m_next_id;
+    return true;
+}
+
+void
+value_compressor :: stats(uint64_t* dictionaries, uint64_t* raw, uint64_t* stored)
+{
+    po6::threads::mutex::hold hold(&m_protect);
+    *dictionaries = m_dictionaries.size();
+    *raw = m_raw;
+    *stored = m_stored;
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2013, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef hyperdex_daemon_value_compressor_h_
+#define hyperdex_daemon_value_compressor_h_
+
+// STL
+#include <map>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// e
+#include <e/compat.h>
+#include <e/slice.h>
+
+// HyperDex
+#include "namespace.h"
+#include "common/ids.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Compresses the attributes of spaces created "with compression".  Each
+// space gets a dictionary trained from a sample of the attributes written
+// to it, so that small documents that look alike compress even though each
+// is too short to compress on its own.  Dictionaries are numbered, and every
+// compressed attribute names the one it needs; they are never discarded, so
+// any attribute on disk can always be read back.
+class value_compressor
+{
+    public:
+        class packed;
+
+    public:
+        value_compressor();
+        ~value_compressor() throw ();
+
+    public:
+        // make a dictionary saved by an earlier run usable, and the one its
+        // space compresses with if it is the newest
+        void load(uint32_t id, const space_id& sid, const e::slice& dict);
+        // compress "in" for sid, with its dictionary if it has one; false if
+        // the attribute should be stored as it is
+        bool compress(const space_id& sid, const e::slice& in,
+                      uint32_t* dictionary, std::vector<char>* out);
+        bool decompress(uint32_t dictionary, const e::slice& in,
+                        size_t raw_size, std::vector<char>* out);
+        // offer the attributes of an object written to sid; true when it
+        // completes the sample for sid's dictionary, which the caller must
+        // save durably before passing it to "load"
+        bool sample(const space_id& sid, const std::vector<e::slice>& value,
+                    uint32_t* id, std::string* dict);
+        // attribute bytes offered to "compress", and what they were stored as
+        void stats(uint64_t* dictionaries, uint64_t* raw, uint64_t* stored);
+
+    private:
+        class trainer;
+        typedef std::map<uint32_t, std::string> dictionary_map;
+        typedef std::map<space_id, uint32_t> current_map;
+        typedef std::map<space_id, e::compat::shared_ptr<trainer> > trainer_map;
+
+    private:
+        po6::threads::mutex m_protect;
+        // entries are only ever added, so their strings may be read once
+        // looked up without holding m_protect
+        dictionary_map m_dictionaries;
+        current_map m_current;
+        trainer_map m_trainers;
+        uint32_t m_next_id;
+        uint64_t m_raw;
+        uint64_t m_stored;
+
+    private:
+        value_compressor(const value_compressor&);
+        value_compressor& operator = (const value_compressor&);
+};
+
+class value_compressor::packed
+{
+    public:
+        packed() : dictionary(0), size(0), bytes() {}
+        ~packed() throw () {}
+
+    public:
+        // 0 if compressed without a dictionary
+        uint32_t dictionary;
+        uint32_t size;
+        e::slice bytes;
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_value_compressor_h_
@@ -0,0 +1,541 @@
+// Copyright (c) 2013, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#define __STDC_LIMIT_MACROS
+
+// C
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// POSIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+// STL
+#include <algorithm>
+
+// Google Log
+#include <glog/logging.h>
+
+// po6
+#include <po6/io/fd.h>
+
+// e
+#include <e/endian.h>
+
+// HyperDex
+#include "daemon/value_log.h"
+
+using hyperdex::value_log;
+
+// a segment takes no more appends once it is this big
+#define VALUE_LOG_SEGMENT_BYTES (256ULL * 1024ULL * 1024ULL)
+#define VALUE_LOG_SUFFIX ".vlog"
+
+class value_log::segment
+{
+    public:
+        segment(int f, uint64_t sz) : fd(f), size(sz) {}
+        ~segment() throw () {}
+
+    public:
+        po6::io::fd fd;
+        uint64_t size;
+
+    private:
+        segment(const segment&);
+        segment& operator = (const segment&);
+};
+
+static bool
+sync_dir(const std::string& dir)
+{
+    po6::io::fd fd(open(dir.c_str(), O_RDONLY));
+    return fd.get() >= 0 && fsync(fd.get()) == 0;
+}
+
+static bool
+pwrite_fully(int fd, const uint8_t* data, size_t sz, uint64_t off)
+{
+    while (sz > 0)
+    {
+        ssize_t ret = pwrite(fd, data, sz, off);
+
+        if (ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (ret <= 0)
+        {
+            return false;
+        }
+
+        data += ret;
+        sz -= ret;
+        off += ret;
+    }
+
+    return true;
+}
+
+static bool
+pread_fully(int fd, uint8_t* data, size_t sz, uint64_t off)
+{
+    while (sz > 0)
+    {
+        ssize_t ret = pread(fd, data, sz, off);
+
+        if (ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else if (ret <= 0)
+        {
+            return false;
+        }
+
+        data += ret;
+        sz -= ret;
+        off += ret;
+    }
+
+    return true;
+}
+
+value_log :: value_log()
+    : m_protect()
+    , m_dir()
+    , m_segments()
+    , m_active()
+    , m_active_id(0)
+    , m_synced(0)
+    , m_next_id(1)
+    , m_pending()
+    , m_live(0)
+    , m_reclaimed(0)
+{
+}
+
+value_log :: ~value_log() throw ()
+{
+}
+
+bool
+value_log :: open(const std::string& dir, bool create)
+{
+    po6::threads::mutex::hold hold(&m_protect);
+    m_dir = dir;
+    struct stat st;
+
+    if (stat(dir.c_str(), &st) < 0)
+    {
+        if (errno != ENOENT)
+        {
+            LOG(ERROR) << "could not open the value log in " << dir << ": " << strerror(errno);
+            return false;
+        }
+
+        if (!create)
+        {
+            return true;
+        }
+
+        if (mkdir(dir.c_str(), S_IRWXU) < 0)
+        {
+            LOG(ERROR) << "could not create the value log in " << dir << ": " << strerror(errno);
+            return false;
+        }
+
+        return true;
+    }
+
+    DIR* d = opendir(dir.c_str());
+
+    if (!d)
+    {
+        LOG(ERROR) << "could not list the value log in " << dir << ": " << strerror(errno);
+        return false;
+    }
+
+    struct dirent* ent;
+    const size_t suffix_sz = strlen(VALUE_LOG_SUFFIX);
+    bool ok = true;
+
+    while (ok && (ent = readdir(d)) != NULL)
+    {
+        std::string name(ent->d_name);
+
+        if (name.size() <= suffix_sz ||
+            name.compare(name.size() - suffix_sz, suffix_sz, VALUE_LOG_SUFFIX) != 0)
+        {
+            continue;
+        }
+
+        char* end = NULL;
+        uint64_t id = strtoull(name.c_str(), &end, 16);
+
+        if (id == 0 || end != name.c_str() + name.size() - suffix_sz)
+        {
+            continue;
+        }
+
+        int fd = ::open(path(id).c_str(), O_RDONLY);
+        struct stat sst;
+
+        if (fd < 0 || fstat(fd, &sst) < 0)
+        {
+            LOG(ERROR) << "could not open value log segment " << path(id) << ": " << strerror(errno);
+            ok = false;
+
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+
+            break;
+        }
+
+        e::compat::shared_ptr<segment> seg(new segment(fd, sst.st_size));
+        m_segments[id] = seg;
+        m_next_id = std::max(m_next_id, id + 1);
+    }
+
+    closedir(d);
+
+    if (ok && !m_segments.empty())
+    {
+        LOG(INFO) << "found " << m_segments.size() << " value log segments in " << dir;
+    }
+
+    return ok;
+}
+
+bool
+value_log :: append(const e::slice& value, pointer* ptr, appends* logged)
+{
+    assert(value.size() < UINT32_MAX);
+    po6::threads::mutex::hold hold(&m_protect);
+    const uint64_t record = sizeof(uint32_t) + value.size();
+
+    if ((!m_active.get() ||
+         (m_active->size > 0 && m_active->size + record > VALUE_LOG_SEGMENT_BYTES)) &&
+        !roll())
+    {
+        return false;
+    }
+
+    // every record says how long it is, which read checks against the pointer
+    uint8_t header[sizeof(uint32_t)];
+    e::pack32be(static_cast<uint32_t>(value.size()), header);
+
+    if (!pwrite_fully(m_active->fd.get(), header, sizeof(header), m_active->size) ||
+        !pwrite_fully(m_active->fd.get(), value.data(), value.size(), m_active->size + sizeof(header)))
+    {
+        LOG(ERROR) << "could not append to value log segment " << path(m_active_id)
+                   << ": " << strerror(errno);
+        return false;
+    }
+
+    ptr->segment = m_active_id;
+    ptr->offset = m_active->size;
+    ptr->size = value.size();
+    m_active->size += record;
+    ++m_pending[m_active_id];
+    logged->m_segments.push_back(m_active_id);
+    return true;
+}
+
+bool
+value_log :: sync()
+{
+    e::compat::shared_ptr<segment> seg;
+    uint64_t id;
+    uint64_t target;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect);
+
+        // a sealed segment was synced as it was sealed
+        if (!m_active.get() || m_synced >= m_active->size)
+        {
+            return true;
+        }
+
+        seg = m_active;
+        id = m_active_id;
+        target = m_active->size;
+    }
+
+    if (fdatasync(seg->fd.get()) < 0)
+    {
+        LOG(ERROR) << "could not sync value log segment " << path(id) << ": " << strerror(errno);
+        return false;
+    }
+
+    po6::threads::mutex::hold hold(&m_protect);
+
+    if (id == m_active_id)
+    {
+        m_synced = std::max(m_synced, target);
+    }
+
+    return true;
+}
+
+bool
+value_log :: read(const pointer& ptr, std::string* value)
+{
+    e::compat::shared_ptr<segment> seg;
+
+    {
+        po6::threads::mutex::hold hold(&m_protect);
+        segment_map::iterator it = m_segments.find(ptr.segment);
+
+        if (it == m_segments.end())
+        {
+            return false;
+        }
+
+        seg = it->second;
+    }
+
+    uint8_t header[sizeof(uint32_t)];
+    uint32_t sz = 0;
+
+    if (!pread_fully(seg->fd.get(), header, sizeof(header), ptr.offset))
+    {
+        return false;
+    }
+
+    e::unpack32be(header, &sz);
+
+    if (sz != ptr.size)
+    {
+        return false;
+    }
+
+    value->resize(sz);
+    return sz == 0 ||
+           pread_fully(seg->fd.get(), reinterpret_cast<uint8_t*>(&(*value)[0]),
+                       sz, ptr.offset + sizeof(header));
+}
+
+uint64_t
+value_log :: seal()
+{
+    po6::threads::mutex::hold hold(&m_protect);
+
+    if (m_active.get())
+    {
+        if (fdatasync(m_active->fd.get()) < 0)
+        {
+            LOG(ERROR) << "could not sync value log segment " << path(m_active_id)
+                       << ": " << strerror(errno);
+        }
+
+        m_active.reset();
+    }
+
+    uint64_t horizon = m_next_id;
+
+    if (!m_pending.empty())
+    {
+        horizon = std::min(horizon, m_pending.begin()->first);
+    }
+
+    return horizon;
+}
+
+void
+value_log :: segments(uint64_t horizon, std::vector<std::pair<uint64_t, uint64_t> >* segs)
+{
+    po6::threads::mutex::hold hold(&m_protect);
+    segs->clear();
+
+    for (segment_map::iterator it = m_segments.begin();
+            it != m_segments.end() && it->first < horizon; ++it)
+    {
+        segs->push_back(std::make_pair(it->first, it->second->size));
+    }
+}
+
+bool
+value_log :: remove(uint64_t id)
+{
+    po6::threads::mutex::hold hold(&m_protect);
+    segment_map::iterator it = m_segments.find(id);
+
+    if (it == m_segments.end() || (m_active.get() && id == m_active_id))
+    {
+        return false;
+    }
+
+    // readers that already found the segment keep it open
+    m_segments.erase(it);
+
+    if (unlink(path(id).c_str()) < 0)
+    {
+        LOG(ERROR) << "could not remove value log segment " << path(id) << ": " << strerror(errno);
+        return false;
+    }
+
+    ++m_reclaimed;
+    return true;
+}
+
+bool
+value_log :: link_into(const std::string& dir)
+{
+    seal();
+    std::vector<std::pair<uint64_t, uint64_t> > segs;
+    segments(UINT64_MAX, &segs);
+
+    if (segs.empty())
+    {
+        return true;
+    }
+
+    if (mkdir(dir.c_str(), S_IRWXU) < 0 && errno != EEXIST)
+    {
+        LOG(ERROR) << "could not create " << dir << " for the value log: " << strerror(errno);
+        return false;
+    }
+
+    for (size_t i = 0; i < segs.size(); ++i)
+    {
+        const std::string src(path(segs[i].first));
+        const std::string dst(dir + src.substr(m_dir.size()));
+
+        if (link(src.c_str(), dst.c_str()) < 0 && errno != EEXIST)
+        {
+            LOG(ERROR) << "could not link value log segment " << src << " into "
+                       << dir << ": " << strerror(errno);
+            return false;
+        }
+    }
+
+    return sync_dir(dir);
+}
+
+void
+value_log :: set_live(uint64_t live)
+{
+    po6::threads::mutex::hold hold(&m_protect);
+    m_live = live;
+}
+
+void
+value_log :: stats(uint64_t* segments, uint64_t* bytes,
+                   uint64_t* live, uint64_t* reclaimed)
+{
+    po6::threads::mutex::hold hold(&m_protect);
+    *segments = m_segments.size();
+    *bytes = 0;
+
+    for (segment_map::iterator it = m_segments.begin();
+            it != m_segments.end(); ++it)
+    {
+        *bytes += it->second->size;
+    }
+
+    *live = m_live;
+    *reclaimed = m_reclaimed;
+}
+
+std::string
+value_log :: path(uint64_t id) const
+{
+    char buf[2 * sizeof(uint64_t) + 1];
+    snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(id));
+    return m_dir + "/" + buf + VALUE_LOG_SUFFIX;
+}
+
+bool
+value_log :: roll()
+{
+    if (m_active.get() && fdatasync(m_active->fd.get()) < 0)
+    {
+        LOG(ERROR) << "could not sync value log segment " << path(m_active_id)
+                   << ": " << strerror(errno);
+        return false;
+    }
+
+    m_active.reset();
+    const uint64_t id = m_next_id;
+    int fd = ::open(path(id).c_str(), O_RDWR|O_CREAT|O_EXCL, S_IRUSR|S_IWUSR);
+
+    if (fd < 0)
+    {
+        LOG(ERROR) << "could not create value log segment " << path(id) << ": " << strerror(errno);
+        return false;
+    }
+
+    ++m_next_id;
+    e::compat::shared_ptr<segment> seg(new segment(fd, 0));
+    m_segments[id] = seg;
+
+    // a synced append is no good in a segment a crash could forget
+    if (!sync_dir(m_dir))
+    {
+        LOG(ERROR) << "could not sync the value log directory " << m_dir << ": " << strerror(errno);
+        return false;
+    }
+
+    m_active = seg;
+    m_active_id = id;
+    m_synced = 0;
+    return true;
+}
+
+void
+value_log :: settle(const std::vector<uint64_t>& segments)
+{
+    if (segments.empty())
+    {
+        return;
+    }
+
+    po6::threads::mutex::hold hold(&m_protect);
+
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+        std::map<uint64_t, uint64_t>::iterator it = m_pending.find(segments[i]);
+        assert(it != m_pending.end() && it->second > 0);
+
+        if (--it->second == 0)
+        {
+            m_pending.erase(it);
+        }
+    }
+}
@@ -0,0 +1,154 @@
+// Copyright (c) 2013, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+#ifndef hyperdex_daemon_value_log_h_
+#define hyperdex_daemon_value_log_h_
+
+// STL
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// po6
+#include <po6/threads/mutex.h>
+
+// e
+#include <e/compat.h>
+#include <e/slice.h>
+
+// HyperDex
+#include "namespace.h"
+
+BEGIN_HYPERDEX_NAMESPACE
+
+// Attributes too large to be worth rewriting at every compaction are
+// appended to segment files beside LevelDB, and the object in LevelDB keeps
+// only where to find them.  Only the newest segment is ever appended to; the
+// datalayer removes older ones once nothing can refer to them any more.
+class value_log
+{
+    public:
+        class pointer;
+        class appends;
+
+    public:
+        value_log();
+        ~value_log() throw ();
+
+    public:
+        // find the segments in "dir", creating it if "create"; appends go to
+        // a segment of their own, never to one found here
+        bool open(const std::string& dir, bool create);
+        // append "value", holding its segment back from collection until
+        // "logged" is destroyed
+        bool append(const e::slice& value, pointer* ptr, appends* logged);
+        // make every append so far durable; concurrent callers share syncs
+        bool sync();
+        bool read(const pointer& ptr, std::string* value);
+        // stop appending to the newest segment and return the oldest segment
+        // that a write not yet in LevelDB may refer to
+        uint64_t seal();
+        // the segments before "horizon" and their sizes
+        void segments(uint64_t horizon, std::vector<std::pair<uint64_t, uint64_t> >* segs);
+        bool remove(uint64_t segment);
+        // hard link every segment into "dir", for a backup of LevelDB
+        bool link_into(const std::string& dir);
+        // the bytes referred to as of the datalayer's last look
+        void set_live(uint64_t live);
+        void stats(uint64_t* segments, uint64_t* bytes,
+                   uint64_t* live, uint64_t* reclaimed);
+
+    private:
+        class segment;
+        typedef std::map<uint64_t, e::compat::shared_ptr<segment> > segment_map;
+
+    private:
+        std::string path(uint64_t segment) const;
+        // call with m_protect held
+        bool roll();
+        void settle(const std::vector<uint64_t>& segments);
+
+    private:
+        po6::threads::mutex m_protect;
+        std::string m_dir;
+        segment_map m_segments;
+        // the segment appended to, if any, and how much of it is synced
+        e::compat::shared_ptr<segment> m_active;
+        uint64_t m_active_id;
+        uint64_t m_synced;
+        uint64_t m_next_id;
+        // appends per segment not yet settled
+        std::map<uint64_t, uint64_t> m_pending;
+        uint64_t m_live;
+        uint64_t m_reclaimed;
+
+    private:
+        value_log(const value_log&);
+        value_log& operator = (const value_log&);
+};
+
+class value_log::pointer
+{
+    public:
+        pointer() : segment(0), offset(0), size(0) {}
+        ~pointer() throw () {}
+
+    public:
+        uint64_t segment;
+        uint64_t offset;
+        // zero for an attribute that is not in the log
+        uint64_t size;
+};
+
+// the segments one write appended to; they are settled when it goes, which
+// must be after the write is in LevelDB
+class value_log::appends
+{
+    public:
+        appends(value_log* vl) : m_vl(vl), m_segments() {}
+        ~appends() throw () { m_vl->settle(m_segments); }
+
+    public:
+        bool empty() const { return m_segments.empty(); }
+
+    private:
+        friend class value_log;
+
+    private:
+        value_log* m_vl;
+        std::vector<uint64_t> m_segments;
+
+    private:
+        appends(const appends&);
+        appends& operator = (const appends&);
+};
+
+END_HYPERDEX_NAMESPACE
+
+#endif // hyperdex_daemon_value_log_h_
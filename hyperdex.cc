@@ -48,6 +48,7 @@ main(int argc, const char* argv[])
     cmds.push_back(e::subcommand("rm-index",              "Remove an existing index"));
     cmds.push_back(e::subcommand("list-spaces",           "List the names of all spaces"));
     cmds.push_back(e::subcommand("validate-space",        "Validate a HyperDex space description"));
+    cmds.push_back(e::subcommand("advise-space",          "Recommend subspaces and indices for a space from sampled searches"));
     cmds.push_back(e::subcommand("server-register",       "Manually register a new HyperDex server"));
     cmds.push_back(e::subcommand("server-offline",        "Manually take a daemon offline"));
     cmds.push_back(e::subcommand("server-online",         "Manually bring a daemon online"));
@@ -55,12 +56,26 @@ main(int argc, const char* argv[])
     cmds.push_back(e::subcommand("server-forget",         "Manually remove all trace that a daemon exists"));
     cmds.push_back(e::subcommand("show-config",           "Output a human-readable version of the cluster configuration"));
     cmds.push_back(e::subcommand("perf-counters",         "Collect performance counters from a cluster"));
+    cmds.push_back(e::subcommand("show-transfers",        "Show the progress of state transfers in a cluster"));
     cmds.push_back(e::subcommand("set-read-only",         "Put the cluster into read-only mode, blocking writes"));
     cmds.push_back(e::subcommand("set-read-write",        "Put the cluster into read-write mode, permitting writes"));
     cmds.push_back(e::subcommand("set-fault-tolerance",   "Set the fault-tolerance for the specified space"));
+    cmds.push_back(e::subcommand("set-transfer-rate",     "Limit the bandwidth each daemon spends on state transfer"));
+    cmds.push_back(e::subcommand("set-immutable",         "Make a space immutable, serving its reads from any replica"));
+    cmds.push_back(e::subcommand("set-quota",             "Limit the requests each daemon admits to a space"));
+    cmds.push_back(e::subcommand("split-region",          "Split a region's hyperspace bounds in two"));
+    cmds.push_back(e::subcommand("bulk-load",             "Load a CSV file of objects into a HyperDex space"));
+    cmds.push_back(e::subcommand("replicate",             "Copy a space's changes to another HyperDex cluster as they happen"));
     cmds.push_back(e::subcommand("backup",                "Take a backup of the entire HyperDex cluster"));
     cmds.push_back(e::subcommand("backup-manager",        "Manage incremental backups of the entire HyperDex cluster"));
+    cmds.push_back(e::subcommand("restore-manager",       "Copy a backup of the entire HyperDex cluster to its new servers"));
     cmds.push_back(e::subcommand("raw-backup",            "Take a raw backup of a single HyperDex daemon"));
+    cmds.push_back(e::subcommand("hot-keys",              "Show the keys a single HyperDex daemon serves most often"));
+    cmds.push_back(e::subcommand("profile",               "Sample the stacks of a single HyperDex daemon's threads"));
+    cmds.push_back(e::subcommand("export",                "Export a space as column files on every daemon at once"));
+    cmds.push_back(e::subcommand("maintenance",           "Schedule a daemon's heavy maintenance and compact its regions"));
+    cmds.push_back(e::subcommand("bench",                 "Run a YCSB-style workload against a HyperDex space"));
+    cmds.push_back(e::subcommand("search-bench",          "Measure searches over an indexed space at chosen selectivities"));
     cmds.push_back(e::subcommand("wait-until-stable",     "Wait for the cluster to become stable on the new configuration"));
     return dispatch_to_subcommands(argc, argv,
                                    "hyperdex", "HyperDex",
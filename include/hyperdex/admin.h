@@ -189,6 +189,49 @@ hyperdex_admin_enable_perf_counters(struct hyperdex_admin* admin,
 void
 hyperdex_admin_disable_perf_counters(struct hyperdex_admin* admin);
 
+int64_t
+hyperdex_admin_transfer_rate(struct hyperdex_admin* admin,
+                             uint64_t rate,
+                             enum hyperdex_admin_returncode* status);
+
+int64_t
+hyperdex_admin_split_region(struct hyperdex_admin* admin,
+                            uint64_t rid,
+                            enum hyperdex_admin_returncode* status);
+
+/* Writes to an immutable space fail with HYPERDEX_CLIENT_READONLY, and any
+ * replica may serve its reads. */
+int64_t
+hyperdex_admin_immutable_space(struct hyperdex_admin* admin,
+                               const char* name,
+                               int immutable,
+                               enum hyperdex_admin_returncode* status);
+
+/* Each server admits at most "ops" requests and "bytes" bytes of requests per
+ * second to the space, and at most "client_ops" requests per second from any
+ * one client; zero is no limit.  Requests over quota fail with
+ * HYPERDEX_CLIENT_THROTTLED once the client has backed off and retried a few
+ * times. */
+int64_t
+hyperdex_admin_space_quota(struct hyperdex_admin* admin,
+                           const char* name,
+                           uint64_t ops,
+                           uint64_t bytes,
+                           uint64_t client_ops,
+                           enum hyperdex_admin_returncode* status);
+
+int64_t
+hyperdex_admin_wait_until_checkpoint_stable(struct hyperdex_admin* admin,
+                                            uint64_t checkpoint,
+                                            enum hyperdex_admin_returncode* status);
+
+int64_t
+hyperdex_admin_server_register_in_zone(struct hyperdex_admin* admin,
+                                       uint64_t token,
+                                       const char* address,
+                                       const char* zone,
+                                       enum hyperdex_admin_returncode* status);
+
 int64_t
 hyperdex_admin_loop(struct hyperdex_admin* admin, int timeout,
                     enum hyperdex_admin_returncode* status);
@@ -198,6 +241,47 @@ hyperdex_admin_raw_backup(const char* host, uint16_t port,
                           const char* name,
                           enum hyperdex_admin_returncode* status);
 
+/* on success, *hot_keys is a string the caller must free(), with one line for
+ * each of the keys the daemon's gets and atomics touch most, hottest first */
+int
+hyperdex_admin_raw_hot_keys(const char* host, uint16_t port,
+                            enum hyperdex_admin_returncode* status,
+                            char** hot_keys);
+
+/* on success, *profile is a string the caller must free(), holding the stacks
+ * the daemon's threads were sampled in over the next "seconds", folded one
+ * "outermost;...;innermost count" line apiece for flamegraph.pl */
+int
+hyperdex_admin_raw_profile(const char* host, uint16_t port,
+                           unsigned seconds,
+                           enum hyperdex_admin_returncode* status,
+                           char** profile);
+
+/* export the regions of "space" that the daemon is the point leader for into
+ * the directory "export-<name>" within its data directory, one column file
+ * per attribute for each region, at no more than "rate" bytes per second
+ * (zero for no limit).  On success, *path is a string the caller must free()
+ * naming that directory */
+int
+hyperdex_admin_raw_export(const char* host, uint16_t port,
+                          const char* space, const char* name,
+                          uint64_t rate, int compress,
+                          enum hyperdex_admin_returncode* status,
+                          char** path, uint64_t* objects, uint64_t* bytes);
+
+/* when "set" is nonzero, make the daemon do its heavy maintenance (collecting
+ * checkpoints and building indices) only from "start" to "end", in minutes
+ * past midnight UTC (equal times for always), and spend no more than "budget"
+ * bytes per second on it and on wiping (zero for no limit).  When "region" is
+ * nonzero, also compact that region, which the daemon must hold, in the
+ * background.  On success, *start, *end and *budget hold the daemon's
+ * settings; pass "set" as zero to merely read them */
+int
+hyperdex_admin_raw_maintenance(const char* host, uint16_t port,
+                               int set, uint64_t region,
+                               enum hyperdex_admin_returncode* status,
+                               uint16_t* start, uint16_t* end, uint64_t* budget);
+
 const char*
 hyperdex_admin_error_message(struct hyperdex_admin* admin);
 const char*
@@ -61,9 +61,16 @@ class Admin
             { return hyperdex_admin_read_only(m_adm, ro, status); }
         int64_t wait_until_stable(enum hyperdex_admin_returncode* status)
             { return hyperdex_admin_wait_until_stable(m_adm, status); }
+        int64_t wait_until_checkpoint_stable(uint64_t checkpoint,
+                                             enum hyperdex_admin_returncode* status)
+            { return hyperdex_admin_wait_until_checkpoint_stable(m_adm, checkpoint, status); }
+        int64_t transfer_rate(uint64_t rate, enum hyperdex_admin_returncode* status)
+            { return hyperdex_admin_transfer_rate(m_adm, rate, status); }
         int64_t fault_tolerance(const char* space, uint64_t ft,
                                 enum hyperdex_admin_returncode* status)
             { return hyperdex_admin_fault_tolerance(m_adm, space, ft, status); }
+        int64_t split_region(uint64_t rid, enum hyperdex_admin_returncode* status)
+            { return hyperdex_admin_split_region(m_adm, rid, status); }
         int validate_space(const char* description,
                            enum hyperdex_admin_returncode* status)
             { return hyperdex_admin_validate_space(m_adm, description, status); }
@@ -76,6 +83,13 @@ class Admin
         int64_t mv_space(const char* source, const char* target,
                          enum hyperdex_admin_returncode* status)
             { return hyperdex_admin_mv_space(m_adm, source, target, status); }
+        int64_t immutable_space(const char* name, int immutable,
+                                enum hyperdex_admin_returncode* status)
+            { return hyperdex_admin_immutable_space(m_adm, name, immutable, status); }
+        int64_t space_quota(const char* name, uint64_t ops, uint64_t bytes,
+                            uint64_t client_ops,
+                            enum hyperdex_admin_returncode* status)
+            { return hyperdex_admin_space_quota(m_adm, name, ops, bytes, client_ops, status); }
         int64_t list_spaces(enum hyperdex_admin_returncode* status,
                             const char** spaces)
             { return hyperdex_admin_list_spaces(m_adm, status, spaces); }
@@ -87,6 +101,9 @@ class Admin
         int64_t server_register(uint64_t token, const char* address,
                                 enum hyperdex_admin_returncode* status)
             { return hyperdex_admin_server_register(m_adm, token, address, status); }
+        int64_t server_register(uint64_t token, const char* address, const char* zone,
+                                enum hyperdex_admin_returncode* status)
+            { return hyperdex_admin_server_register_in_zone(m_adm, token, address, zone, status); }
         int64_t server_online(uint64_t token, enum hyperdex_admin_returncode* status)
             { return hyperdex_admin_server_online(m_adm, token, status); }
         int64_t server_offline(uint64_t token, enum hyperdex_admin_returncode* status)
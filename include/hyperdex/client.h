@@ -41,7 +41,9 @@ extern "C"
 #endif /* __cplusplus */
 
 struct hyperdex_client;
+struct hyperdex_client_prepared;
 struct hyperdex_client_microtransaction;
+struct hyperdex_ds_arena;
 
 struct hyperdex_client_attribute
 {
@@ -71,6 +73,28 @@ struct hyperdex_client_attribute_check
     enum hyperpredicate predicate;
 };
 
+enum hyperdex_client_aggregate_function
+{
+    HYPERDEX_CLIENT_AGGREGATE_SUM = 1,
+    HYPERDEX_CLIENT_AGGREGATE_MIN = 2,
+    HYPERDEX_CLIENT_AGGREGATE_MAX = 3,
+    HYPERDEX_CLIENT_AGGREGATE_AVG = 4
+};
+
+struct hyperdex_client_aggregate
+{
+    const char* attr; /* NULL-terminated */
+    enum hyperdex_client_aggregate_function function;
+};
+
+struct hyperdex_client_aggregate_group
+{
+    const char* group; /* the group_by value; empty when not grouping */
+    size_t group_sz;
+    uint64_t count;
+    const double* values; /* one per requested aggregate */
+};
+
 /* hyperdex_client_returncode occupies [8448, 8576) */
 enum hyperdex_client_returncode
 {
@@ -98,6 +122,7 @@ enum hyperdex_client_returncode
     HYPERDEX_CLIENT_CLUSTER_JUMP = 8531,
     HYPERDEX_CLIENT_OFFLINE      = 8533,
     HYPERDEX_CLIENT_UNAUTHORIZED = 8534,
+    HYPERDEX_CLIENT_THROTTLED    = 8535,
 
     /* This should never happen.  It indicates a bug */
     HYPERDEX_CLIENT_INTERNAL     = 8573,
@@ -111,6 +136,16 @@ struct hyperdex_client*
 hyperdex_client_create(const char* coordinator, uint16_t port);
 struct hyperdex_client*
 hyperdex_client_create_conn_str(const char* conn_str);
+/* A shared client may be used by many threads at once, all of them sharing
+ * its connections and its copy of the configuration.  Any thread may issue
+ * operations; hyperdex_client_loop returns only the operations the calling
+ * thread issued, and hyperdex_client_error_message describes the calling
+ * thread's last call.  The auth context is shared by all threads.
+ */
+struct hyperdex_client*
+hyperdex_client_create_shared(const char* coordinator, uint16_t port);
+struct hyperdex_client*
+hyperdex_client_create_shared_conn_str(const char* conn_str);
 void
 hyperdex_client_destroy(struct hyperdex_client* client);
 
@@ -1161,6 +1196,201 @@ hyperdex_client_count(struct hyperdex_client* client,
                       enum hyperdex_client_returncode* status,
                       uint64_t* count);
 
+/* Retrieve num_keys objects in one operation.  Keys are grouped by the server
+ * that leads them, and each group travels in a single message.  When the
+ * operation completes, statuses[i], attrs[i] and attrs_sz[i] hold the result
+ * for keys[i]; each attrs[i] must be freed with hyperdex_client_destroy_attrs.
+ */
+int64_t
+hyperdex_client_get_many(struct hyperdex_client* client,
+                         const char* space,
+                         const char** keys, const size_t* keys_sz, size_t num_keys,
+                         enum hyperdex_client_returncode* status,
+                         enum hyperdex_client_returncode* statuses,
+                         const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* One page of "limit" results of a sorted search.  Pass a NULL cursor for the
+ * first page and the previous page's next_cursor thereafter; servers resume
+ * where the previous page left off instead of re-sorting the earlier pages.
+ * Once the page is done (HYPERDEX_CLIENT_SEARCHDONE), next_cursor points to an
+ * opaque token that is valid until the next call to hyperdex_client_loop, or
+ * is NULL if no results remain.  In a space created "with ordered key", paging
+ * by the key with a range on the key scans the range in key order, asking only
+ * the regions that hold it.
+ */
+int64_t
+hyperdex_client_sorted_search_page(struct hyperdex_client* client,
+                                   const char* space,
+                                   const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                   const char* sort_by,
+                                   uint64_t limit,
+                                   int maxmin,
+                                   const char* cursor, size_t cursor_sz,
+                                   enum hyperdex_client_returncode* status,
+                                   const struct hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                                   const char** next_cursor, size_t* next_cursor_sz);
+
+/* Compute aggregates over the int64, float or timestamp attributes of the
+ * objects that match the checks.  Each server computes partial results next to
+ * its data, so only one row per group crosses the network.  When group_by is
+ * a string attribute, there is one group for each of its distinct values
+ * (at most 1024); when it is NULL, there is exactly one group.  MIN, MAX and
+ * AVG of an empty group are NaN.  Once the operation succeeds, groups must be
+ * freed with hyperdex_client_destroy_aggregate_groups.
+ */
+int64_t
+hyperdex_client_aggregate(struct hyperdex_client* client,
+                          const char* space,
+                          const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                          const struct hyperdex_client_aggregate* aggs, size_t aggs_sz,
+                          const char* group_by,
+                          enum hyperdex_client_returncode* status,
+                          const struct hyperdex_client_aggregate_group** groups, size_t* groups_sz);
+
+/* Estimate how many objects match the checks without visiting them all.
+ * Each server counts matches until it has about 1/(error*error) of them and
+ * then extrapolates from how far through its index they reach, so the result
+ * is typically within "error" of the true count (e.g., 0.05 for 5%).  Regions
+ * with fewer matches, and an error of 0, are counted exactly.
+ */
+int64_t
+hyperdex_client_approximate_count(struct hyperdex_client* client,
+                                  const char* space,
+                                  const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                  double error,
+                                  enum hyperdex_client_returncode* status,
+                                  uint64_t* count);
+
+/* Like hyperdex_client_search, but return at most "limit" objects in no
+ * particular order.  Servers stop searching once they have sent "limit"
+ * objects, and the client stops the rest of them once it has "limit" in all.
+ * A limit of 0 returns every match.
+ */
+int64_t
+hyperdex_client_search_limit(struct hyperdex_client* client,
+                             const char* space,
+                             const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             uint64_t limit,
+                             enum hyperdex_client_returncode* status,
+                             const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* Like hyperdex_client_get, but let any replica of the key serve the read so
+ * gets spread across each chain instead of all landing on its head.  Every
+ * replica returns a committed value; a replica that knows of more than
+ * "staleness" writes to the key it has yet to apply hands the read back, and
+ * the client retries it at the head.  The value returned may be older than one
+ * a previous call returned.
+ */
+int64_t
+hyperdex_client_get_relaxed(struct hyperdex_client* client,
+                            const char* space,
+                            const char* key, size_t key_sz,
+                            uint64_t staleness,
+                            enum hyperdex_client_returncode* status,
+                            const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* Put many objects with one call, as for a bulk load.  Objects are grouped
+ * by the server that leads them and sent in batches.  Each object's outcome
+ * lands in statuses; the call yields once, when every object has settled. */
+int64_t
+hyperdex_client_put_many(struct hyperdex_client* client,
+                         const char* space,
+                         const char** keys, const size_t* keys_sz,
+                         const struct hyperdex_client_attribute* const* attrs, const size_t* attrs_sz,
+                         size_t num_objects,
+                         enum hyperdex_client_returncode* status,
+                         enum hyperdex_client_returncode* statuses);
+
+/* Like hyperdex_client_get, but the object is placed in "arena" rather than
+ * in memory of its own.  It must not be passed to
+ * hyperdex_client_destroy_attrs, and lives until the arena is reset or
+ * destroyed.  One arena may hold the results of many operations.
+ */
+int64_t
+hyperdex_client_get_arena(struct hyperdex_client* client,
+                          const char* space,
+                          const char* key, size_t key_sz,
+                          struct hyperdex_ds_arena* arena,
+                          enum hyperdex_client_returncode* status,
+                          const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* Like hyperdex_client_search_limit, but each object is placed in "arena" as
+ * for hyperdex_client_get_arena.  Resetting the arena between loops keeps a
+ * long search to one allocation.
+ */
+int64_t
+hyperdex_client_search_arena(struct hyperdex_client* client,
+                             const char* space,
+                             const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             uint64_t limit,
+                             struct hyperdex_ds_arena* arena,
+                             enum hyperdex_client_returncode* status,
+                             const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* The changes made to a space since "checkpoint" (0 for every change still
+ * on disk), one per loop, until HYPERDEX_CLIENT_SEARCHDONE says the servers
+ * have no more.  Each change is an object as it was written, or, when
+ * "deleted" is nonzero, just the key of an object that was deleted; the
+ * changes to one key come out in the order they were made.  "resume" always
+ * holds a checkpoint to pass to the next call, which then yields every
+ * change this call has not, and possibly some that it has:  consumers should
+ * ignore a put whose version is not newer than the one they hold.  A
+ * checkpoint the servers have since collected replays each region in full.
+ */
+int64_t
+hyperdex_client_changes(struct hyperdex_client* client,
+                        const char* space,
+                        uint64_t checkpoint,
+                        enum hyperdex_client_returncode* status,
+                        const struct hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                        uint64_t* version, int* deleted,
+                        uint64_t* resume);
+
+/* Like hyperdex_client_get_many, but the results are a snapshot: every key's
+ * result held at one moment, even across regions, without locking the keys.
+ * The keys are read again until two consecutive rounds agree; should they
+ * keep changing, the operation fails with HYPERDEX_CLIENT_CMPFAIL and may be
+ * retried.
+ */
+int64_t
+hyperdex_client_read_transaction(struct hyperdex_client* client,
+                                 const char* space,
+                                 const char** keys, const size_t* keys_sz, size_t num_keys,
+                                 enum hyperdex_client_returncode* status,
+                                 enum hyperdex_client_returncode* statuses,
+                                 const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* The "limit" objects that match the checks and lie nearest the point (x, y),
+ * nearest first, where x_attr and y_attr are int64, float or timestamp
+ * attributes and distance is Euclidean in their units.  A spatial index over
+ * the two attributes (see hyperdex add-index) lets servers examine only the
+ * objects near the point; without one, every matching object is examined.
+ */
+int64_t
+hyperdex_client_nearest_search(struct hyperdex_client* client,
+                               const char* space,
+                               const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                               const char* x_attr, double x,
+                               const char* y_attr, double y,
+                               uint64_t limit,
+                               enum hyperdex_client_returncode* status,
+                               const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
+/* Like hyperdex_client_search, but return a uniform random sample of the
+ * matching objects, each kept with probability "fraction" independently of
+ * the rest.  Servers decide from a hash of the key before reading an object,
+ * so a small sample reads little more than the objects it returns.  Each call
+ * draws a fresh sample.  For roughly N objects, pass N divided by the result
+ * of hyperdex_client_approximate_count for the same checks.
+ */
+int64_t
+hyperdex_client_sample_search(struct hyperdex_client* client,
+                              const char* space,
+                              const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                              double fraction,
+                              enum hyperdex_client_returncode* status,
+                              const struct hyperdex_client_attribute** attrs, size_t* attrs_sz);
+
 int64_t
 hyperdex_client_loop(struct hyperdex_client* client, int timeout,
                      enum hyperdex_client_returncode* status);
@@ -1171,6 +1401,101 @@ hyperdex_client_poll_fd(struct hyperdex_client* client);
 int
 hyperdex_client_block(struct hyperdex_client* client, int timeout);
 
+/* While corking is on, the client holds puts and other atomic operations
+ * and sends each server's share as one message.  They go out on
+ * hyperdex_client_flush, on hyperdex_client_loop, or once a server's share
+ * grows large.  Callers that wait on hyperdex_client_poll_fd must flush
+ * first.  Turning corking off flushes.
+ */
+void
+hyperdex_client_set_corking(struct hyperdex_client* client, bool enabled);
+
+void
+hyperdex_client_flush(struct hyperdex_client* client);
+
+/* Keep up to budget bytes of objects read with hyperdex_client_get.  A cached
+ * object is returned without contacting a server for fresh_for milliseconds
+ * after a server last confirmed it, and during that window it may miss writes
+ * made by others.  Afterward, the get asks the server to send the object only
+ * if it changed.  A budget of zero turns the cache off.
+ */
+void
+hyperdex_client_set_read_cache(struct hyperdex_client* client,
+                               size_t budget, uint64_t fresh_for);
+
+/* Hedge gets against a slow server.  A get still unanswered after the 95th
+ * percentile of recent get latencies is sent again to another replica, and
+ * the first answer wins.  At most fraction of all gets are hedged; zero turns
+ * hedging off.  The stats count gets, gets hedged, and hedges that answered
+ * first.
+ */
+void
+hyperdex_client_set_hedging(struct hyperdex_client* client, double fraction);
+
+void
+hyperdex_client_hedging_stats(struct hyperdex_client* client,
+                              uint64_t* gets, uint64_t* hedged, uint64_t* won);
+
+/* Record how long replies take by request type and by server, how long loop
+ * blocks waiting for them, disruptions, configuration refreshes and the
+ * operations failed because of either.  Off by default.  The report has one
+ * line for each, of space-separated key=value pairs, and remains valid until
+ * the next call; reset clears what has been recorded.
+ */
+void
+hyperdex_client_set_statistics(struct hyperdex_client* client, int enabled);
+
+const char*
+hyperdex_client_statistics(struct hyperdex_client* client);
+
+void
+hyperdex_client_reset_statistics(struct hyperdex_client* client);
+
+/* Fail each operation issued after this call with HYPERDEX_CLIENT_TIMEOUT
+ * if it has not finished within timeout milliseconds.  The servers are told
+ * how long the operation has left, and give up on work that outlives it.
+ * Zero, the default, sets no limit.
+ */
+void
+hyperdex_client_set_operation_timeout(struct hyperdex_client* client, uint64_t timeout);
+
+/* Start from the configuration last saved within directory, and save each
+ * newer one there.  A new client then routes operations at once instead of
+ * waiting on the coordinator.  A stale file costs the first operations a
+ * HYPERDEX_CLIENT_RECONFIGURE, after which the client waits for the
+ * coordinator's configuration.  NULL turns the cache off.
+ */
+void
+hyperdex_client_set_config_cache(struct hyperdex_client* client, const char* directory);
+
+/* Name the checks and attributes of a key operation once, for operations
+ * issued many times with only their values changing.  method is the name of
+ * the operation as in hyperdex_client_<method>, such as "put", "cond_put" or
+ * "atomic_add"; the values of checks and attrs are ignored.  The space,
+ * attribute names and datatypes are resolved here and again only when the
+ * configuration changes.
+ */
+struct hyperdex_client_prepared*
+hyperdex_client_prepare(struct hyperdex_client* client,
+                        const char* method, const char* space,
+                        const struct hyperdex_client_attribute_check* checks, size_t checks_sz,
+                        const struct hyperdex_client_attribute* attrs, size_t attrs_sz,
+                        enum hyperdex_client_returncode* status);
+
+/* Issue a prepared operation on key.  values holds one value for each check
+ * and then one for each attribute, in the order they were prepared.
+ */
+int64_t
+hyperdex_client_execute(struct hyperdex_client* client,
+                        struct hyperdex_client_prepared* prepared,
+                        const char* key, size_t key_sz,
+                        const char* const* values, const size_t* values_sz,
+                        enum hyperdex_client_returncode* status);
+
+void
+hyperdex_client_destroy_prepared(struct hyperdex_client* client,
+                                 struct hyperdex_client_prepared* prepared);
+
 enum hyperdatatype
 hyperdex_client_attribute_type(struct hyperdex_client* client,
                                const char* space, const char* name,
@@ -1188,6 +1513,9 @@ hyperdex_client_returncode_to_string(enum hyperdex_client_returncode);
 void
 hyperdex_client_destroy_attrs(const struct hyperdex_client_attribute* attrs, size_t attrs_sz);
 
+void
+hyperdex_client_destroy_aggregate_groups(const struct hyperdex_client_aggregate_group* groups, size_t groups_sz);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif /* __cplusplus */
@@ -29,6 +29,7 @@
 
 // C++
 #include <iostream>
+#include <map>
 
 // HyperDex
 #include <hyperdex/client.h>
@@ -36,6 +37,108 @@
 namespace hyperdex
 {
 
+class Client;
+
+// An operation issued through one of Client's async_* calls.  The operation
+// owns the status (and any result storage) for the call and is called back
+// from Client::dispatch each time the call yields, so callers need not match
+// the ids returned by loop() against their own bookkeeping.  It must outlive
+// the call; once done() it may be deleted from inside complete().
+class Operation
+{
+    public:
+        Operation() : status(HYPERDEX_CLIENT_GARBAGE), m_done(false) {}
+        virtual ~Operation() throw () {}
+
+    public:
+        bool done() const { return m_done; }
+
+    public:
+        hyperdex_client_returncode status;
+
+    protected:
+        // runs on the thread that called dispatch
+        virtual void complete() {}
+        virtual bool finished() const { return true; }
+        virtual void yielded() { complete(); }
+
+    private:
+        friend class Client;
+        void issued() { status = HYPERDEX_CLIENT_GARBAGE; m_done = false; }
+        void deliver() { m_done = finished(); yielded(); }
+
+    private:
+        Operation(const Operation&);
+        Operation& operator = (const Operation&);
+
+    private:
+        bool m_done;
+};
+
+// The object found by async_get; it lives until the operation is reused or
+// destroyed.
+class GetOperation : public Operation
+{
+    public:
+        GetOperation() : attrs(NULL), attrs_sz(0) {}
+        virtual ~GetOperation() throw () { clear(); }
+
+    public:
+        const hyperdex_client_attribute* attrs;
+        size_t attrs_sz;
+
+    private:
+        friend class Client;
+        void clear()
+        {
+            if (attrs)
+            {
+                hyperdex_client_destroy_attrs(attrs, attrs_sz);
+            }
+
+            attrs = NULL;
+            attrs_sz = 0;
+        }
+};
+
+// complete() runs once per object found by async_search, and a final time
+// with status HYPERDEX_CLIENT_SEARCHDONE; attrs is valid only inside
+// complete().
+class SearchOperation : public Operation
+{
+    public:
+        SearchOperation() : attrs(NULL), attrs_sz(0) {}
+        virtual ~SearchOperation() throw () {}
+
+    public:
+        const hyperdex_client_attribute* attrs;
+        size_t attrs_sz;
+
+    protected:
+        virtual bool finished() const { return status != HYPERDEX_CLIENT_SUCCESS; }
+        virtual void yielded()
+        {
+            const hyperdex_client_attribute* a = attrs;
+            size_t a_sz = attrs_sz;
+            complete();
+
+            if (a)
+            {
+                hyperdex_client_destroy_attrs(a, a_sz);
+            }
+        }
+};
+
+class CountOperation : public Operation
+{
+    public:
+        CountOperation() : count(0) {}
+        virtual ~CountOperation() throw () {}
+
+    public:
+        uint64_t count;
+};
+
 class Client
 {
     public:
@@ -55,6 +158,25 @@ class Client
                 throw std::bad_alloc();
             }
         }
+        // see hyperdex_client_create_shared
+        Client(const char* coordinator, uint16_t port, bool shared)
+            : m_cl(shared ? hyperdex_client_create_shared(coordinator, port)
+                          : hyperdex_client_create(coordinator, port))
+        {
+            if (!m_cl)
+            {
+                throw std::bad_alloc();
+            }
+        }
+        Client(const char* conn_str, bool shared)
+            : m_cl(shared ? hyperdex_client_create_shared_conn_str(conn_str)
+                          : hyperdex_client_create_conn_str(conn_str))
+        {
+            if (!m_cl)
+            {
+                throw std::bad_alloc();
+            }
+        }
         ~Client() throw ()
         {
             hyperdex_client_destroy(m_cl);
@@ -749,6 +871,198 @@ class Client
                       hyperdex_client_returncode* status,
                       uint64_t* count)
             { return hyperdex_client_count(m_cl, space, checks, checks_sz, status, count); }
+        int64_t get_many(const char* space,
+                         const char** keys, const size_t* keys_sz, size_t num_keys,
+                         hyperdex_client_returncode* status,
+                         hyperdex_client_returncode* statuses,
+                         const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+            { return hyperdex_client_get_many(m_cl, space, keys, keys_sz, num_keys, status, statuses, attrs, attrs_sz); }
+        int64_t sorted_search_page(const char* space,
+                                   const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                   const char* sort_by,
+                                   uint64_t limit,
+                                   int maxmin,
+                                   const char* cursor, size_t cursor_sz,
+                                   hyperdex_client_returncode* status,
+                                   const hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                                   const char** next_cursor, size_t* next_cursor_sz)
+            { return hyperdex_client_sorted_search_page(m_cl, space, checks, checks_sz, sort_by, limit, maxmin, cursor, cursor_sz, status, attrs, attrs_sz, next_cursor, next_cursor_sz); }
+        int64_t aggregate(const char* space,
+                          const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                          const struct hyperdex_client_aggregate* aggs, size_t aggs_sz,
+                          const char* group_by,
+                          hyperdex_client_returncode* status,
+                          const hyperdex_client_aggregate_group** groups, size_t* groups_sz)
+            { return hyperdex_client_aggregate(m_cl, space, checks, checks_sz, aggs, aggs_sz, group_by, status, groups, groups_sz); }
+        int64_t approximate_count(const char* space,
+                                  const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                  double error,
+                                  hyperdex_client_returncode* status,
+                                  uint64_t* count)
+            { return hyperdex_client_approximate_count(m_cl, space, checks, checks_sz, error, status, count); }
+        int64_t search_limit(const char* space,
+                             const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             uint64_t limit,
+                             hyperdex_client_returncode* status,
+                             const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+            { return hyperdex_client_search_limit(m_cl, space, checks, checks_sz, limit, status, attrs, attrs_sz); }
+        int64_t get_relaxed(const char* space,
+                            const char* key, size_t key_sz,
+                            uint64_t staleness,
+                            hyperdex_client_returncode* status,
+                            const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+            { return hyperdex_client_get_relaxed(m_cl, space, key, key_sz, staleness, status, attrs, attrs_sz); }
+        int64_t put_many(const char* space,
+                         const char** keys, const size_t* keys_sz,
+                         const hyperdex_client_attribute* const* attrs, const size_t* attrs_sz,
+                         size_t num_objects,
+                         hyperdex_client_returncode* status,
+                         hyperdex_client_returncode* statuses)
+            { return hyperdex_client_put_many(m_cl, space, keys, keys_sz, attrs, attrs_sz, num_objects, status, statuses); }
+        int64_t get_arena(const char* space,
+                          const char* key, size_t key_sz,
+                          hyperdex_ds_arena* arena,
+                          hyperdex_client_returncode* status,
+                          const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+            { return hyperdex_client_get_arena(m_cl, space, key, key_sz, arena, status, attrs, attrs_sz); }
+        int64_t search_arena(const char* space,
+                             const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             uint64_t limit,
+                             hyperdex_ds_arena* arena,
+                             hyperdex_client_returncode* status,
+                             const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+            { return hyperdex_client_search_arena(m_cl, space, checks, checks_sz, limit, arena, status, attrs, attrs_sz); }
+        int64_t changes(const char* space,
+                        uint64_t checkpoint,
+                        hyperdex_client_returncode* status,
+                        const hyperdex_client_attribute** attrs, size_t* attrs_sz,
+                        uint64_t* version, int* deleted,
+                        uint64_t* resume)
+            { return hyperdex_client_changes(m_cl, space, checkpoint, status, attrs, attrs_sz, version, deleted, resume); }
+        int64_t read_transaction(const char* space,
+                                 const char** keys, const size_t* keys_sz, size_t num_keys,
+                                 hyperdex_client_returncode* status,
+                                 hyperdex_client_returncode* statuses,
+                                 const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+            { return hyperdex_client_read_transaction(m_cl, space, keys, keys_sz, num_keys, status, statuses, attrs, attrs_sz); }
+        int64_t nearest_search(const char* space,
+                               const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                               const char* x_attr, double x,
+                               const char* y_attr, double y,
+                               uint64_t limit,
+                               hyperdex_client_returncode* status,
+                               const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+            { return hyperdex_client_nearest_search(m_cl, space, checks, checks_sz, x_attr, x, y_attr, y, limit, status, attrs, attrs_sz); }
+        int64_t sample_search(const char* space,
+                              const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                              double fraction,
+                              hyperdex_client_returncode* status,
+                              const hyperdex_client_attribute** attrs, size_t* attrs_sz)
+            { return hyperdex_client_sample_search(m_cl, space, checks, checks_sz, fraction, status, attrs, attrs_sz); }
+
+    public:
+        int64_t async_get(const char* space,
+                          const char* key, size_t key_sz,
+                          GetOperation* op)
+        {
+            op->clear();
+            op->issued();
+            return track(hyperdex_client_get(m_cl, space, key, key_sz, &op->status, &op->attrs, &op->attrs_sz), op);
+        }
+        int64_t async_put(const char* space,
+                          const char* key, size_t key_sz,
+                          const hyperdex_client_attribute* attrs, size_t attrs_sz,
+                          Operation* op)
+        {
+            op->issued();
+            return track(hyperdex_client_put(m_cl, space, key, key_sz, attrs, attrs_sz, &op->status), op);
+        }
+        int64_t async_del(const char* space,
+                          const char* key, size_t key_sz,
+                          Operation* op)
+        {
+            op->issued();
+            return track(hyperdex_client_del(m_cl, space, key, key_sz, &op->status), op);
+        }
+        int64_t async_search(const char* space,
+                             const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                             SearchOperation* op)
+        {
+            op->issued();
+            return track(hyperdex_client_search(m_cl, space, checks, checks_sz, &op->status, &op->attrs, &op->attrs_sz), op);
+        }
+        int64_t async_count(const char* space,
+                            const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                            CountOperation* op)
+        {
+            op->issued();
+            return track(hyperdex_client_count(m_cl, space, checks, checks_sz, &op->status, &op->count), op);
+        }
+        // Wait at most timeout ms for an async_* operation to yield, then
+        // call back everything that is already ready without blocking again.
+        // An epoll-driven caller watches poll_fd() and calls dispatch(0, ..)
+        // when it is readable.  Returns the number of callbacks run; 0 with
+        // *status TIMEOUT or NONEPENDING when nothing was ready, and -1 on
+        // error.  Don't mix with loop(), and issue every operation through
+        // async_* while dispatching: ids this client did not track are
+        // dropped.
+        int dispatch(int timeout, hyperdex_client_returncode* status)
+        {
+            int ran = 0;
+
+            while (true)
+            {
+                int64_t id = hyperdex_client_loop(m_cl, ran > 0 ? 0 : timeout, status);
+
+                if (id < 0)
+                {
+                    if (*status != HYPERDEX_CLIENT_TIMEOUT &&
+                        *status != HYPERDEX_CLIENT_NONEPENDING)
+                    {
+                        return -1;
+                    }
+
+                    if (ran > 0)
+                    {
+                        *status = HYPERDEX_CLIENT_SUCCESS;
+                    }
+
+                    return ran;
+                }
+
+                std::map<int64_t, Operation*>::iterator it = m_async.find(id);
+
+                if (it == m_async.end())
+                {
+                    continue;
+                }
+
+                Operation* op = it->second;
+
+                if (op->finished())
+                {
+                    m_async.erase(it);
+                }
+
+                ++ran;
+                op->deliver();
+            }
+        }
+        // Dispatch until op is done: a blocking wait on one operation, like
+        // a future's get().  Returns false if timeout ms pass without
+        // progress or dispatch fails; *status says which.
+        bool wait(Operation* op, int timeout, hyperdex_client_returncode* status)
+        {
+            while (!op->done())
+            {
+                if (dispatch(timeout, status) <= 0)
+                {
+                    return op->done();
+                }
+            }
+
+            return true;
+        }
 
     public:
         void clear_auth_context()
@@ -763,6 +1077,41 @@ class Client
             { return hyperdex_client_poll_fd(m_cl); }
         int block(int timeout)
             { return hyperdex_client_block(m_cl, timeout); }
+        void set_corking(bool enabled)
+            { hyperdex_client_set_corking(m_cl, enabled); }
+        void flush()
+            { hyperdex_client_flush(m_cl); }
+        void set_read_cache(size_t budget, uint64_t fresh_for)
+            { hyperdex_client_set_read_cache(m_cl, budget, fresh_for); }
+        void set_hedging(double fraction)
+            { hyperdex_client_set_hedging(m_cl, fraction); }
+        void hedging_stats(uint64_t* gets, uint64_t* hedged, uint64_t* won)
+            { hyperdex_client_hedging_stats(m_cl, gets, hedged, won); }
+        void set_statistics(bool enabled)
+            { hyperdex_client_set_statistics(m_cl, enabled ? 1 : 0); }
+        const char* statistics()
+            { return hyperdex_client_statistics(m_cl); }
+        void reset_statistics()
+            { hyperdex_client_reset_statistics(m_cl); }
+        void set_operation_timeout(uint64_t timeout)
+            { hyperdex_client_set_operation_timeout(m_cl, timeout); }
+        void set_config_cache(const char* directory)
+            { hyperdex_client_set_config_cache(m_cl, directory); }
+        hyperdex_client_prepared* prepare(const char* method, const char* space,
+                                          const hyperdex_client_attribute_check* checks, size_t checks_sz,
+                                          const hyperdex_client_attribute* attrs, size_t attrs_sz,
+                                          hyperdex_client_returncode* status)
+            { return hyperdex_client_prepare(m_cl, method, space, checks, checks_sz, attrs, attrs_sz, status); }
+        int64_t execute(hyperdex_client_prepared* prepared,
+                        const char* key, size_t key_sz,
+                        const char* const* values, const size_t* values_sz,
+                        hyperdex_client_returncode* status)
+            { return hyperdex_client_execute(m_cl, prepared, key, key_sz, values, values_sz, status); }
+        void destroy_prepared(hyperdex_client_prepared* prepared)
+            { hyperdex_client_destroy_prepared(m_cl, prepared); }
+        hyperdatatype attribute_type(const char* space, const char* name,
+                                     hyperdex_client_returncode* status)
+            { return hyperdex_client_attribute_type(m_cl, space, name, status); }
         std::string error_message()
             { return hyperdex_client_error_message(m_cl); }
         std::string error_location()
@@ -772,8 +1121,24 @@ class Client
         Client(const Client&);
         Client& operator = (const Client&);
 
+    private:
+        int64_t track(int64_t id, Operation* op)
+        {
+            if (id < 0)
+            {
+                op->m_done = true;
+            }
+            else
+            {
+                m_async[id] = op;
+            }
+
+            return id;
+        }
+
     private:
         hyperdex_client* m_cl;
+        std::map<int64_t, Operation*> m_async;
 };
 
 } // namespace hyperdex
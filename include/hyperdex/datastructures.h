@@ -69,6 +69,13 @@ hyperdex_ds_arena_create();
 void
 hyperdex_ds_arena_destroy(struct hyperdex_ds_arena* arena);
 
+/* Free everything allocated from the arena at once, keeping its memory to
+ * be reused by later allocations.  Anything allocated from the arena before
+ * the reset, including results the client placed in it, must no longer be
+ * used. */
+void
+hyperdex_ds_arena_reset(struct hyperdex_ds_arena* arena);
+
 void*
 hyperdex_ds_malloc(struct hyperdex_ds_arena* arena, size_t sz);
 
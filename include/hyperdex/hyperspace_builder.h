@@ -30,6 +30,7 @@
 #define hyperdex_hyperspace_builder_h_
 
 /* C */
+#include <stddef.h>
 #include <stdint.h>
 
 /* HyperDex */
@@ -45,17 +46,19 @@ struct hyperspace;
 /* hyperspace_returncode occupies [8576, 8704) */
 enum hyperspace_returncode
 {
-    HYPERSPACE_SUCCESS       = 8576,
-    HYPERSPACE_INVALID_NAME  = 8577,
-    HYPERSPACE_INVALID_TYPE  = 8578,
-    HYPERSPACE_DUPLICATE     = 8579,
-    HYPERSPACE_IS_KEY        = 8580,
-    HYPERSPACE_UNKNOWN_ATTR  = 8581,
-    HYPERSPACE_NO_SUBSPACE   = 8582,
-    HYPERSPACE_OUT_OF_BOUNDS = 8583,
-    HYPERSPACE_UNINDEXABLE   = 8584,
-
-    HYPERSPACE_GARBAGE       = 8703
+    HYPERSPACE_SUCCESS            = 8576,
+    HYPERSPACE_INVALID_NAME       = 8577,
+    HYPERSPACE_INVALID_TYPE       = 8578,
+    HYPERSPACE_DUPLICATE          = 8579,
+    HYPERSPACE_IS_KEY             = 8580,
+    HYPERSPACE_UNKNOWN_ATTR       = 8581,
+    HYPERSPACE_NO_SUBSPACE        = 8582,
+    HYPERSPACE_OUT_OF_BOUNDS      = 8583,
+    HYPERSPACE_UNINDEXABLE        = 8584,
+    HYPERSPACE_INVALID_DURABILITY = 8585,
+    HYPERSPACE_INVALID_EXPIRY     = 8586,
+
+    HYPERSPACE_GARBAGE            = 8703
 };
 
 struct hyperspace*
@@ -99,6 +102,54 @@ hyperspace_set_number_of_partitions(struct hyperspace* space, uint64_t num);
 enum hyperspace_returncode
 hyperspace_use_authorization(struct hyperspace* space);
 
+/* "level" is one of "async" (the default), "sync", "group" or "memory" */
+enum hyperspace_returncode
+hyperspace_set_durability(struct hyperspace* space, const char* level);
+
+/* objects whose timestamp "attr" is set and in the past read as absent */
+enum hyperspace_returncode
+hyperspace_set_expiry(struct hyperspace* space, const char* attr);
+
+/* place objects by key order rather than by key hash, so that searches for a
+ * range of keys go only to the regions that hold the range */
+enum hyperspace_returncode
+hyperspace_use_ordered_key(struct hyperspace* space);
+
+/* store the space's attributes compressed, with dictionaries each daemon
+ * trains from the objects it holds; daemons built without LZ4 store them
+ * as they are */
+enum hyperspace_returncode
+hyperspace_use_compression(struct hyperspace* space);
+
+/* place objects by the timestamp "attr" in buckets of one "unit" ("minute",
+ * "hour", "day" or "week") laid out in time order, so that searches for a
+ * span of time go only to the regions that hold its buckets; "attr" gets a
+ * subspace of its own unless one is given */
+enum hyperspace_returncode
+hyperspace_set_time_buckets(struct hyperspace* space, const char* attr, const char* unit);
+
+/* the space written back in the form hyperspace_parse takes; the string
+ * belongs to the space and lives until it is destroyed */
+const char*
+hyperspace_describe(struct hyperspace* space);
+
+/* route searches through the regions the space would be created with, the
+ * way clients pick the servers to contact.  Each search is a list of
+ * "<attr> <op> <value>" conditions joined by " and ", with op one of =, <,
+ * <=, >= or >.  For search i, regions[i] of the total[i] regions in the
+ * subspace that narrows it furthest are contacted, and indexed[i] is nonzero
+ * when the key or an index narrows the scan within each region */
+enum hyperspace_returncode
+hyperspace_route_searches(struct hyperspace* space,
+                          const char* const* searches, size_t searches_sz,
+                          uint64_t* regions, uint64_t* total, int* indexed);
+
+/* the copies of an object, and the index entries over those copies, that
+ * the space stores for each write */
+enum hyperspace_returncode
+hyperspace_write_cost(struct hyperspace* space,
+                      uint64_t* copies, uint64_t* index_entries);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif /* __cplusplus */
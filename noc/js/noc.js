@@ -162,6 +162,10 @@ app.controller('WidgetsDisplayCtrl', ['$scope', 'BackendPropertyService',
                             tag: "io.time_in_queue",
                             name: "Time Spent on All Requests",
                             form: "aggregate"}]},
+                    {template: "/partials/latency_heatmap.html"},
+                    {template: "/partials/hot_regions.html"},
+                    {template: "/partials/hot_keys.html"},
+                    {template: "/partials/server_health.html"},
                     {template: "/partials/default_chart.html",
                      arg: {type: "line",
                            options: {hAxis: {title: "Time",
@@ -240,6 +244,145 @@ app.controller('WidgetsDisplayCtrl', ['$scope', 'BackendPropertyService',
   $scope.addServers = function() {
     $scope.widgets.push({template: '/partials/servers.html'});
   };
+
+  $scope.addHeatmap = function() {
+    $scope.widgets.push({template: '/partials/latency_heatmap.html'});
+  };
+
+  $scope.addHotRegions = function() {
+    $scope.widgets.push({template: '/partials/hot_regions.html'});
+  };
+
+  $scope.addHotKeys = function() {
+    $scope.widgets.push({template: '/partials/hot_keys.html'});
+  };
+
+  $scope.addServerHealth = function() {
+    $scope.widgets.push({template: '/partials/server_health.html'});
+  };
+}]);
+
+/* Fetch "path" from the backend now and every "interval" milliseconds after,
+ * handing each response to "done", until the scope goes away */
+function PollBackend($scope, $http, $timeout, BackendPropertyService, path, interval, done) {
+  var timeout = null;
+  var poll = function() {
+    $http.jsonp(BackendPropertyService.url + path() + (path().indexOf('?') < 0 ? '?' : '&') +
+                'callback=JSON_CALLBACK', {timeout: 500})
+      .success(function(data, status, headers, config) {
+        done(data);
+      }).error(function(data, status, headers, config) {
+        // XXX
+      });
+    $timeout.cancel(timeout);
+    timeout = $timeout(poll, interval);
+  };
+  $scope.$on('$destroy', function() {
+    $timeout.cancel(timeout);
+  });
+  poll();
+  return poll;
+};
+
+function FormatNanos(ns) {
+  if (ns >= 1000000000) {
+    return (ns / 1000000000).toFixed(1) + 's';
+  } else if (ns >= 1000000) {
+    return (ns / 1000000).toFixed(1) + 'ms';
+  } else if (ns >= 1000) {
+    return (ns / 1000).toFixed(0) + '\u00b5s';
+  }
+  return ns + 'ns';
+};
+
+function FormatBytes(b) {
+  var units = ['B', 'KB', 'MB', 'GB', 'TB'];
+  var i = 0;
+  while (b >= 1024 && i + 1 < units.length) {
+    b /= 1024;
+    ++i;
+  }
+  return b.toFixed(i == 0 ? 0 : 1) + units[i];
+};
+
+/* Renders one row per operation and one column per second, shaded by how
+ * slow the slowest server was */
+app.controller('LatencyHeatmapCtrl', ['$scope', '$http', '$timeout', 'BackendPropertyService',
+        function ($scope, $http, $timeout, BackendPropertyService) {
+  $scope.percentiles = ['p50', 'p99', 'p999'];
+  $scope.percentile = 'p99';
+  $scope.heatmap = {times: [], rows: []};
+  $scope.max = 0;
+  $scope.format = FormatNanos;
+
+  var path = function() {
+    return '/heatmap.json?args=' + encodeURIComponent(angular.toJson({duration: 60,
+                                                                       interval: 1000,
+                                                                       percentile: $scope.percentile}));
+  };
+  var poll = PollBackend($scope, $http, $timeout, BackendPropertyService, path, 5000, function(data) {
+    var max = 0;
+    for (var i = 0; i < data.rows.length; ++i) {
+      for (var j = 0; j < data.rows[i].values.length; ++j) {
+        max = Math.max(max, data.rows[i].values[j]);
+      }
+    }
+    $scope.heatmap = data;
+    $scope.max = max;
+  });
+
+  $scope.$watch('percentile', function(newValue, oldValue) {
+    if (newValue != oldValue) {
+      poll();
+    }
+  });
+
+  // shade on a log scale from one microsecond to the slowest cell shown
+  $scope.cellStyle = function(ns) {
+    var floor = 1000;
+    var alpha = 0;
+    if (ns > floor && $scope.max > floor) {
+      alpha = Math.log(ns / floor) / Math.log($scope.max / floor);
+    }
+    return {'background-color': 'rgba(179, 27, 27, ' + alpha.toFixed(2) + ')'};
+  };
+}]);
+
+app.controller('HotRegionsCtrl', ['$scope', '$http', '$timeout', 'BackendPropertyService',
+        function ($scope, $http, $timeout, BackendPropertyService) {
+  $scope.regions = [];
+  $scope.formatBytes = FormatBytes;
+  PollBackend($scope, $http, $timeout, BackendPropertyService,
+              function() { return '/regions.json?limit=20'; }, 5000,
+              function(data) { $scope.regions = data; });
+}]);
+
+app.controller('HotKeysCtrl', ['$scope', '$http', '$timeout', 'BackendPropertyService',
+        function ($scope, $http, $timeout, BackendPropertyService) {
+  $scope.keys = [];
+  PollBackend($scope, $http, $timeout, BackendPropertyService,
+              function() { return '/hot_keys.json?limit=20'; }, 5000,
+              function(data) { $scope.keys = data; });
+}]);
+
+app.controller('ServerHealthCtrl', ['$scope', '$http', '$timeout', 'BackendPropertyService', 'ClusterConfigService',
+        function ($scope, $http, $timeout, BackendPropertyService, ClusterConfigService) {
+  $scope.servers = [];
+  $scope.formatBytes = FormatBytes;
+
+  $scope.location = function(id) {
+    var servers = ClusterConfigService.config.servers || [];
+    for (var i = 0; i < servers.length; ++i) {
+      if (servers[i].id == id) {
+        return servers[i].location;
+      }
+    }
+    return id;
+  };
+
+  PollBackend($scope, $http, $timeout, BackendPropertyService,
+              function() { return '/health.json'; }, 5000,
+              function(data) { $scope.servers = data; });
 }]);
 
 /* This little controller renders the list of servers */
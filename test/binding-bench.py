@@ -0,0 +1,202 @@
+# Copyright (c) 2015, Cornell University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+#     * Redistributions of source code must retain the above copyright notice,
+#       this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the name of HyperDex nor the names of its contributors may be
+#       used to endorse or promote products derived from this software without
+#       specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+'''Measure what each language binding adds on top of the C client.
+
+Brings up a local cluster, loads a space, and then drives get, put and
+search through the C client ("hyperdex bench" with one thread and one
+outstanding operation) and through the Python, Java and Go bindings, each
+issuing the same operations one at a time from test/binding-bench/.  It
+prints the throughput of each and the client CPU time per operation, and how
+the latter compares to C's; with a single outstanding operation the
+difference in throughput is the binding's overhead on the critical path, and
+the difference in CPU is what it costs a frontend running many clients.
+
+The bindings time themselves and leave out one second of warm up (which
+matters for the JIT); the C client's CPU is its whole run as reported by
+rusage, so it is slightly pessimistic.  Searches cover 1 to --scan-length
+consecutive keys.
+'''
+
+from __future__ import absolute_import
+from __future__ import print_function
+from __future__ import unicode_literals
+from __future__ import with_statement
+
+
+import os
+import os.path
+import re
+import resource
+import subprocess
+import sys
+import time
+
+sys.path.append(os.path.dirname(os.path.abspath(__file__)))
+
+
+import argparse
+
+import hyperdex.admin
+import runner
+
+
+HERE = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'binding-bench')
+BINDINGS = ('c', 'python', 'java', 'go')
+# the operation of "hyperdex bench" equivalent to each binding operation
+C_OPS = (('get', 'read'), ('put', 'update'), ('search', 'scan'))
+SUMMARY = re.compile(r'^ops=(\d+) seconds=(\S+)')
+RESULT = re.compile(r'^(\w+) ops=(\d+) missing=(\d+) seconds=(\S+) cpu=(\S+)$')
+
+
+def word_list(text):
+    words = [x for x in text.split(',') if x]
+    for w in words:
+        if w not in BINDINGS:
+            raise argparse.ArgumentTypeError('unknown binding %r' % w)
+    return words
+
+
+def children_cpu():
+    ru = resource.getrusage(resource.RUSAGE_CHILDREN)
+    return ru.ru_utime + ru.ru_stime
+
+
+def hyperdex_bench(args, mix, duration, extra=()):
+    cmd = ['hyperdex', 'bench', '-h', '127.0.0.1', '-p', '1982',
+           '-t', '1', '-w', '1', '-m', mix, '--distribution', 'uniform',
+           '-n', str(args.records), '-d', str(duration),
+           '--value-min', str(args.value_size), '--value-max', str(args.value_size),
+           '--scan-length', str(args.scan_length)] + list(extra) + ['bindingbench']
+    return subprocess.check_output(cmd).decode('utf-8')
+
+
+def c_results(args):
+    '''(op, ops, seconds, cpu) for the C client.'''
+    for op, mix in C_OPS:
+        before = children_cpu()
+        output = hyperdex_bench(args, mix + '=1', args.duration)
+        cpu = children_cpu() - before
+        for line in output.splitlines():
+            m = SUMMARY.match(line)
+            if m:
+                yield op, int(m.group(1)), float(m.group(2)), cpu
+                break
+        else:
+            raise RuntimeError('could not parse the output of hyperdex bench:\n' + output)
+
+
+def binding_cmd(args, binding):
+    argv = ['127.0.0.1', '1982', 'bindingbench', str(args.records), str(args.duration),
+            str(args.value_size), str(args.scan_length)]
+    if binding == 'python':
+        return ['python2', os.path.join(HERE, 'bench.py')] + argv
+    if binding == 'java':
+        classes = os.path.join(runner.BUILDDIR, 'test', 'binding-bench')
+        if not os.path.isdir(classes):
+            os.makedirs(classes)
+        subprocess.check_call(['javac', '-d', classes, os.path.join(HERE, 'Bench.java')])
+        libpath = os.path.join(runner.BUILDDIR, '.libs') + ':/usr/local/lib:/usr/local/lib64:/usr/lib:/usr/lib64'
+        classpath = classes + ':' + (os.getenv('CLASSPATH') or '')
+        return ['java', '-Djava.library.path=' + libpath, '-cp', classpath, 'Bench'] + argv
+    if binding == 'go':
+        return ['go', 'run', os.path.join(HERE, 'bench.go')] + argv
+    raise ValueError(binding)
+
+
+def binding_results(args, binding):
+    '''(op, ops, seconds, cpu) for one of the bindings.'''
+    output = subprocess.check_output(binding_cmd(args, binding)).decode('utf-8')
+    results = []
+    for line in output.splitlines():
+        m = RESULT.match(line)
+        if m:
+            results.append((m.group(1), int(m.group(2)), float(m.group(4)), float(m.group(5))))
+    if len(results) != len(C_OPS):
+        raise RuntimeError('could not parse the output of the %s benchmark:\n%s' % (binding, output))
+    return results
+
+
+HEADER = ('binding', 'op', 'ops/s', 'cpu us/op', 'vs c')
+
+
+def print_row(row):
+    print('%-8s %-7s %10s %10s %7s' % row)
+    sys.stdout.flush()
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--bindings', default=list(BINDINGS), type=word_list,
+                        help='comma-separated clients to measure (default: c,python,java,go)')
+    parser.add_argument('--daemons', default=1, type=int,
+                        help='start this many daemons (default: 1)')
+    parser.add_argument('--partitions', default=8, type=int,
+                        help='create the space with this many partitions (default: 8)')
+    parser.add_argument('--records', default=10000, type=int,
+                        help='load and operate on this many objects (default: 10000)')
+    parser.add_argument('--value-size', default=100, type=int,
+                        help='bytes in each value (default: 100)')
+    parser.add_argument('--scan-length', default=10, type=int,
+                        help='search at most this many consecutive keys (default: 10)')
+    parser.add_argument('--duration', default=10, type=int,
+                        help='seconds to measure each operation (default: 10)')
+    args = parser.parse_args(argv)
+    if args.records <= 0 or args.scan_length <= 0 or args.duration <= 0:
+        parser.error('the records, scan length and duration must be positive')
+    hdc = runner.HyperDexCluster(1, args.daemons, clean=True)
+    try:
+        hdc.setup()
+        time.sleep(1)
+        adm = hyperdex.admin.Admin('127.0.0.1', 1982)
+        adm.add_space('space bindingbench key int k attributes string v, int count '
+                      'create %d partitions' % args.partitions)
+        adm.wait_until_stable()
+        hyperdex_bench(args, 'read=1', 0, ['--load'])
+        c_cpu = {}
+        print('%-8s %-7s %10s %10s %7s' % HEADER)
+        for binding in args.bindings:
+            if binding == 'c':
+                results = list(c_results(args))
+            else:
+                results = binding_results(args, binding)
+            for op, ops, seconds, cpu in results:
+                us = cpu * 1e6 / ops if ops else 0
+                if binding == 'c':
+                    c_cpu[op] = us
+                ratio = '%.2fx' % (us / c_cpu[op]) if c_cpu.get(op) else '-'
+                print_row((binding, op, '%.1f' % (ops / seconds if seconds else 0), '%.1f' % us, ratio))
+    except:
+        hdc.log_output = True
+        raise
+    finally:
+        hdc.cleanup()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,146 @@
+/* Copyright (c) 2015, Cornell University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of HyperDex nor the names of its contributors may be
+ *       used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// The Java half of test/binding-bench.py; see bench.py for what it measures
+// and prints.
+
+import java.lang.management.ManagementFactory;
+import java.util.*;
+
+import org.hyperdex.client.Client;
+import org.hyperdex.client.HyperDexClientException;
+import org.hyperdex.client.Iterator;
+import org.hyperdex.client.Range;
+
+public class Bench
+{
+    private static final long WARMUP_NS = 1000000000L;
+
+    private interface Op
+    {
+        boolean run() throws HyperDexClientException;
+    }
+
+    private static long cpu()
+    {
+        // includes the JIT and collector threads, as bench.py's rusage does
+        return ((com.sun.management.OperatingSystemMXBean)
+                ManagementFactory.getOperatingSystemMXBean()).getProcessCpuTime();
+    }
+
+    private static void run(String name, Op op, long seconds) throws HyperDexClientException
+    {
+        long end = System.nanoTime() + WARMUP_NS;
+
+        while (System.nanoTime() < end)
+        {
+            op.run();
+        }
+
+        long ops = 0;
+        long missing = 0;
+        long start = System.nanoTime();
+        long startCpu = cpu();
+        end = start + seconds * 1000000000L;
+
+        while (true)
+        {
+            if (!op.run())
+            {
+                ++missing;
+            }
+
+            ++ops;
+
+            if (ops % 64 == 0 && System.nanoTime() >= end)
+            {
+                break;
+            }
+        }
+
+        double elapsed = (System.nanoTime() - start) / 1e9;
+        double elapsedCpu = (cpu() - startCpu) / 1e9;
+        System.out.printf("%s ops=%d missing=%d seconds=%f cpu=%f\n",
+                          name, ops, missing, elapsed, elapsedCpu);
+        System.out.flush();
+    }
+
+    public static void main(String[] args) throws HyperDexClientException
+    {
+        final Client c = new Client(args[0], Integer.parseInt(args[1]));
+        final String space = args[2];
+        final long records = Long.parseLong(args[3]);
+        final long seconds = Long.parseLong(args[4]);
+        final int valueSize = Integer.parseInt(args[5]);
+        final long scanLength = Long.parseLong(args[6]);
+        final Random rand = new Random();
+        char[] v = new char[valueSize];
+        Arrays.fill(v, 'v');
+        final String value = new String(v);
+
+        Op get = new Op() {
+            public boolean run() throws HyperDexClientException
+            {
+                long k = (rand.nextLong() & Long.MAX_VALUE) % records;
+                return c.get(space, k) != null;
+            }
+        };
+        Op put = new Op() {
+            public boolean run() throws HyperDexClientException
+            {
+                long k = (rand.nextLong() & Long.MAX_VALUE) % records;
+                Map<String, Object> attrs = new HashMap<String, Object>();
+                attrs.put("v", value);
+                return c.put(space, k, attrs);
+            }
+        };
+        Op search = new Op() {
+            public boolean run() throws HyperDexClientException
+            {
+                long first = (rand.nextLong() & Long.MAX_VALUE) % records;
+                long last = first + (rand.nextLong() & Long.MAX_VALUE) % scanLength;
+                Map<String, Object> checks = new HashMap<String, Object>();
+                checks.put("k", new Range(first, last));
+                Iterator it = c.search(space, checks);
+                long found = 0;
+
+                while (it.hasNext())
+                {
+                    it.next();
+                    ++found;
+                }
+
+                return found > 0;
+            }
+        };
+
+        run("get", get, seconds);
+        run("put", put, seconds);
+        run("search", search, seconds);
+    }
+}
@@ -0,0 +1,129 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// The Go half of test/binding-bench.py; see bench.py for what it measures
+// and prints.
+package main
+
+import (
+	"fmt"
+	"math/rand"
+	"os"
+	"strconv"
+	"strings"
+	"syscall"
+	"time"
+
+	"hyperdex/client"
+)
+
+const warmup = time.Second
+
+func cpu() float64 {
+	var ru syscall.Rusage
+	syscall.Getrusage(syscall.RUSAGE_SELF, &ru)
+	return float64(ru.Utime.Nano()+ru.Stime.Nano()) / 1e9
+}
+
+func run(name string, op func() bool, seconds int64) {
+	end := time.Now().Add(warmup)
+	for time.Now().Before(end) {
+		op()
+	}
+	var ops, missing int64
+	start := time.Now()
+	startCpu := cpu()
+	end = start.Add(time.Duration(seconds) * time.Second)
+	for {
+		if !op() {
+			missing++
+		}
+		ops++
+		if ops%64 == 0 && !time.Now().Before(end) {
+			break
+		}
+	}
+	elapsed := time.Since(start).Seconds()
+	fmt.Printf("%s ops=%d missing=%d seconds=%f cpu=%f\n", name, ops, missing, elapsed, cpu()-startCpu)
+}
+
+func fail(what string, err *client.Error) {
+	fmt.Fprintf(os.Stderr, "%s failed: %v\n", what, *err)
+	os.Exit(1)
+}
+
+func main() {
+	port, _ := strconv.Atoi(os.Args[2])
+	space := os.Args[3]
+	records, _ := strconv.ParseInt(os.Args[4], 10, 64)
+	seconds, _ := strconv.ParseInt(os.Args[5], 10, 64)
+	valueSize, _ := strconv.Atoi(os.Args[6])
+	scanLength, _ := strconv.ParseInt(os.Args[7], 10, 64)
+	c, er, _ := client.NewClient(os.Args[1], port)
+	if er != nil {
+		fmt.Fprintln(os.Stderr, er)
+		os.Exit(1)
+	}
+	defer c.Destroy()
+	value := strings.Repeat("v", valueSize)
+
+	get := func() bool {
+		_, err := c.Get(space, rand.Int63n(records))
+		if err != nil && err.Status != client.NOTFOUND {
+			fail("get", err)
+		}
+		return err == nil
+	}
+	put := func() bool {
+		err := c.Put(space, rand.Int63n(records), client.Attributes{"v": value})
+		if err != nil {
+			fail("put", err)
+		}
+		return true
+	}
+	search := func() bool {
+		first := rand.Int63n(records)
+		last := first + rand.Int63n(scanLength)
+		objs, errs := c.Search(space, []client.Predicate{
+			{"k", first, client.GREATER_EQUAL},
+			{"k", last, client.LESS_EQUAL}})
+		found := 0
+		for _ = range objs {
+			found++
+		}
+		for err := range errs {
+			if err.Status != client.SUCCESS && err.Status != client.SEARCHDONE {
+				fail("search", &err)
+			}
+		}
+		return found > 0
+	}
+
+	run("get", get, seconds)
+	run("put", put, seconds)
+	run("search", search, seconds)
+}
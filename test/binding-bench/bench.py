@@ -0,0 +1,101 @@
+# Copyright (c) 2015, Cornell University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+#     * Redistributions of source code must retain the above copyright notice,
+#       this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the name of HyperDex nor the names of its contributors may be
+#       used to endorse or promote products derived from this software without
+#       specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+'''The Python half of test/binding-bench.py.
+
+Usage: bench.py <host> <port> <space> <records> <seconds> <value-size> <scan-length>
+
+Issues one synchronous operation at a time for <seconds> each of get, put
+and search, the way "hyperdex bench -t 1 -w 1" does, and prints one line per
+operation: how many completed, how many found nothing, the wall clock time and
+the CPU time this process spent.  The first second of each is discarded to
+warm up.
+'''
+
+import random
+import resource
+import sys
+import time
+
+import hyperdex.client
+
+
+WARMUP = 1.0
+
+
+def cpu():
+    ru = resource.getrusage(resource.RUSAGE_SELF)
+    return ru.ru_utime + ru.ru_stime
+
+
+def run(name, op, seconds):
+    end = time.time() + WARMUP
+    while time.time() < end:
+        op()
+    ops = 0
+    missing = 0
+    start = time.time()
+    start_cpu = cpu()
+    end = start + seconds
+    while True:
+        if not op():
+            missing += 1
+        ops += 1
+        if ops % 64 == 0 and time.time() >= end:
+            break
+    elapsed = time.time() - start
+    print('%s ops=%d missing=%d seconds=%f cpu=%f' % (name, ops, missing, elapsed, cpu() - start_cpu))
+    sys.stdout.flush()
+
+
+def main(argv):
+    host, port, space = argv[0], int(argv[1]), argv[2]
+    records, seconds, value_size, scan_length = [int(x) for x in argv[3:7]]
+    c = hyperdex.client.Client(host, port)
+    value = 'v' * value_size
+
+    def get():
+        return c.get(space, random.randrange(records)) is not None
+
+    def put():
+        return c.put(space, random.randrange(records), {'v': value})
+
+    def search():
+        first = random.randrange(records)
+        last = first + random.randrange(scan_length)
+        found = 0
+        for obj in c.search(space, {'k': hyperdex.client.Range(first, last)}):
+            found += 1
+        return found > 0
+
+    run('get', get, seconds)
+    run('put', put, seconds)
+    run('search', search, seconds)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,218 @@
+# Copyright (c) 2015, Cornell University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+#     * Redistributions of source code must retain the above copyright notice,
+#       this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the name of HyperDex nor the names of its contributors may be
+#       used to endorse or promote products derived from this software without
+#       specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+'''Measure what value replication costs.
+
+Brings up a local cluster and, for each fault tolerance and subspace layout,
+loads a space and drives it with "hyperdex bench":  once with a single
+outstanding update to see the latency of a chain of each length, and once
+with many to see the throughput it sustains.  The layouts are:
+
+    none        the key subspace only
+    stable      a second subspace on an attribute updates never change
+    relocating  a second subspace on the value, so every update moves the
+                object to another region: a CHAIN_SUBSPACE relocation
+
+The whole sweep repeats for each combination of --delay, --batch-window and
+--ack-window, the latter two being the daemons' --chain-batch-window and
+--chain-ack-window.  A delay is added to the loopback device with netem,
+which needs root, and applies to each packet, so a round trip pays it twice.
+'''
+
+from __future__ import absolute_import
+from __future__ import print_function
+from __future__ import unicode_literals
+from __future__ import with_statement
+
+
+import os
+import os.path
+import re
+import subprocess
+import sys
+import time
+
+sys.path.append(os.path.dirname(os.path.abspath(__file__)))
+
+
+import argparse
+
+import hyperdex.admin
+import runner
+
+
+LAYOUTS = {'none': '',
+           'stable': 'subspace count',
+           'relocating': 'subspace v'}
+
+SUMMARY = re.compile(r'^ops=(\d+) seconds=\S+(?: throughput=(\S+)/s)?')
+LATENCY = re.compile(r'^\s+latency\s+p50=\s*(\S+) p90=\s*\S+ p99=\s*(\S+) p99.9=\s*(\S+)')
+
+
+def int_list(text):
+    return [int(x) for x in text.split(',') if x]
+
+
+def word_list(text):
+    words = [x for x in text.split(',') if x]
+    for w in words:
+        if w not in LAYOUTS:
+            raise argparse.ArgumentTypeError('unknown layout %r' % w)
+    return words
+
+
+class Shaper(object):
+    '''Delay every packet on the loopback device for the duration of a with
+    block.'''
+
+    def __init__(self, delay_ms):
+        self.delay_ms = delay_ms
+
+    def __enter__(self):
+        if self.delay_ms > 0:
+            subprocess.check_call(['tc', 'qdisc', 'add', 'dev', 'lo', 'root',
+                                   'netem', 'delay', '%dms' % self.delay_ms])
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        if self.delay_ms > 0:
+            subprocess.call(['tc', 'qdisc', 'del', 'dev', 'lo', 'root'])
+        return False
+
+
+def bench(args, space, threads, window, load):
+    '''Run "hyperdex bench" and return (throughput, p50, p99, p99.9) of its
+    updates, in operations per second and microseconds.'''
+    cmd = ['hyperdex', 'bench', '-h', '127.0.0.1', '-p', '1982',
+           '-t', str(threads), '-w', str(window),
+           '-n', str(args.records), '-d', str(args.duration),
+           '-m', 'update=100', '--distribution', 'uniform',
+           '--value-min', str(args.value_size), '--value-max', str(args.value_size)]
+    if load:
+        cmd.append('--load')
+    cmd.append(space)
+    output = subprocess.check_output(cmd).decode('utf-8')
+    throughput = None
+    percentiles = None
+    in_update = False
+    for line in output.splitlines():
+        m = SUMMARY.match(line)
+        if m:
+            throughput = float(m.group(2) or 0)
+        if line.startswith('update'):
+            in_update = True
+            continue
+        m = LATENCY.match(line)
+        if in_update and m:
+            percentiles = tuple(float(x) for x in m.groups())
+            in_update = False
+    if throughput is None or percentiles is None:
+        raise RuntimeError('could not parse the output of %s:\n%s' % (' '.join(cmd), output))
+    return (throughput,) + percentiles
+
+
+def sweep(args, delay, batch, ack):
+    daemon_args = ['--chain-batch-window', str(batch),
+                   '--chain-ack-window', str(ack)]
+    hdc = runner.HyperDexCluster(1, args.daemons, clean=True, daemon_args=daemon_args)
+    try:
+        hdc.setup()
+        time.sleep(1)
+        adm = hyperdex.admin.Admin('127.0.0.1', 1982)
+        with Shaper(delay):
+            for ft in args.fault_tolerance:
+                for layout in args.layouts:
+                    space = 'chainbench'
+                    adm.add_space('space %s key int k attributes string v, int count %s '
+                                  'create %d partitions tolerate %d failures' %
+                                  (space, LAYOUTS[layout], args.partitions, ft))
+                    adm.wait_until_stable()
+                    lat = bench(args, space, 1, 1, True)
+                    tput = bench(args, space, args.threads, args.window, False)
+                    row = (delay, batch, ack, ft + 1, layout,
+                           lat[1], lat[2], lat[3], tput[0], tput[2])
+                    print_row(row)
+                    adm.rm_space(space)
+                    adm.wait_until_stable()
+    except:
+        hdc.log_output = True
+        raise
+    finally:
+        hdc.cleanup()
+
+
+HEADER = ('delay', 'batch', 'ack', 'chain', 'layout',
+          'p50', 'p99', 'p99.9', 'ops/s', 'load p99')
+
+
+def print_row(row):
+    print('%5s %5s %5s %5s %-10s %9s %9s %9s %10s %9s' % row)
+    sys.stdout.flush()
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--daemons', default=3, type=int,
+                        help='start this many daemons (default: 3)')
+    parser.add_argument('--fault-tolerance', default=[0, 1, 2], type=int_list,
+                        help='comma-separated failures to tolerate; a chain is one longer (default: 0,1,2)')
+    parser.add_argument('--layouts', default=['none', 'stable', 'relocating'], type=word_list,
+                        help='comma-separated subspace layouts (default: none,stable,relocating)')
+    parser.add_argument('--partitions', default=8, type=int,
+                        help='create each space with this many partitions (default: 8)')
+    parser.add_argument('--records', default=10000, type=int,
+                        help='load and update this many objects (default: 10000)')
+    parser.add_argument('--value-size', default=100, type=int,
+                        help='bytes in each value (default: 100)')
+    parser.add_argument('--duration', default=10, type=int,
+                        help='seconds in each measurement (default: 10)')
+    parser.add_argument('--threads', default=4, type=int,
+                        help='client threads when measuring throughput (default: 4)')
+    parser.add_argument('--window', default=64, type=int,
+                        help='outstanding updates per thread when measuring throughput (default: 64)')
+    parser.add_argument('--delay', default=[0], type=int_list,
+                        help='comma-separated milliseconds to delay each loopback packet (default: 0)')
+    parser.add_argument('--batch-window', default=[0], type=int_list,
+                        help='comma-separated values of the daemons\' --chain-batch-window (default: 0)')
+    parser.add_argument('--ack-window', default=[0], type=int_list,
+                        help='comma-separated values of the daemons\' --chain-ack-window (default: 0)')
+    args = parser.parse_args(argv)
+    for ft in args.fault_tolerance:
+        if ft < 0 or ft >= args.daemons:
+            parser.error('cannot tolerate %d failures with %d daemons' % (ft, args.daemons))
+    if any(d > 0 for d in args.delay) and os.geteuid() != 0:
+        parser.error('--delay needs root to change the loopback device')
+    print('%5s %5s %5s %5s %-10s %9s %9s %9s %10s %9s' % HEADER)
+    for delay in args.delay:
+        for batch in args.batch_window:
+            for ack in args.ack_window:
+                sweep(args, delay, batch, ack)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
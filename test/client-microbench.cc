@@ -0,0 +1,643 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// Time the work a client does for an operation before the request leaves and
+// after the response arrives: routing the key to its point leader, preparing
+// checks and funcalls, packing the request and turning the response back into
+// attributes, with and without type conversion.  Nothing touches the network;
+// the client is handed a configuration built here instead of fetching one.
+// The output has the same JSON form as test/datatype-microbench.
+
+// C
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+// STL
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/time.h>
+
+// e
+#include <e/arena.h>
+#include <e/buffer.h>
+#include <e/endian.h>
+#include <e/popt.h>
+
+// HyperDex
+#include <hyperdex/datastructures.h>
+#include "admin/partition.h"
+#include "common/configuration.h"
+#include "common/datatype_info.h"
+#include "common/hyperspace.h"
+#include "common/network_returncode.h"
+#include "common/serialization.h"
+#include "common/server.h"
+#include "client/client.h"
+#include "client/constants.h"
+#include "client/keyop_info.h"
+#include "client/util.h"
+
+// distinct keys the routing benchmarks cycle through
+#define BENCH_KEYS 1024
+// keys per call of the batched point leader lookup
+#define BENCH_BATCH 64
+// entries in the map and list attributes
+#define BENCH_ELEMS 16
+
+static long _min_time_ms = 200;
+static long _servers = 16;
+static long _partitions = 256;
+static const char* _filter = "";
+// keeps the compiler from discarding the work being timed
+static volatile uint64_t _sink = 0;
+
+BEGIN_HYPERDEX_NAMESPACE
+
+class client_bench
+{
+    public:
+        enum kind_t
+        {
+            POINT_LEADER,
+            POINT_LEADER_BATCH,
+            PREPARE_CHECKS,
+            PREPARE_PRIMITIVES,
+            PREPARE_CONTAINERS,
+            PREPARE_DOCUMENT,
+            PREPARE_DOCUMENT_RAW,
+            ENCODE_PUT,
+            ENCODE_COND_PUT,
+            DECODE_GET,
+            DECODE_GET_RAW
+        };
+
+    public:
+        client_bench();
+        ~client_bench() throw ();
+
+    public:
+        bool setup(uint64_t servers, uint64_t partitions);
+        uint64_t run(kind_t k, uint64_t iters);
+
+    private:
+        uint64_t prepare(const hyperdex_client_attribute* attrs, size_t attrs_sz,
+                         bool convert, uint64_t iters);
+        uint64_t encode(const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                        const hyperdex_client_keyop_info* opinfo, uint64_t iters);
+        uint64_t decode(bool convert, uint64_t iters);
+
+    private:
+        client m_cl;
+        const schema* m_sc;
+        region_id m_ri;
+        hyperdex_ds_arena* m_arena;
+        std::vector<std::string> m_keys;
+        std::vector<e::slice> m_key_slices;
+        std::string m_name;
+        char m_n[sizeof(int64_t)];
+        char m_f[sizeof(double)];
+        std::string m_json;
+        std::string m_bson;
+        const char* m_map;
+        size_t m_map_sz;
+        const char* m_list;
+        size_t m_list_sz;
+        std::string m_regex;
+        char m_lo[sizeof(int64_t)];
+        char m_hi[sizeof(int64_t)];
+        char m_min[sizeof(double)];
+        std::vector<hyperdex_client_attribute> m_primitives;
+        std::vector<hyperdex_client_attribute> m_containers;
+        std::vector<hyperdex_client_attribute> m_document;
+        std::vector<hyperdex_client_attribute> m_document_raw;
+        std::vector<hyperdex_client_attribute> m_object;
+        std::vector<hyperdex_client_attribute_check> m_checks;
+        std::auto_ptr<e::buffer> m_response;
+
+    private:
+        client_bench(const client_bench&);
+        client_bench& operator = (const client_bench&);
+};
+
+// a key string, five attributes of the common types and a document
+static attribute _attrs[] = {attribute("k", HYPERDATATYPE_STRING),
+                             attribute("name", HYPERDATATYPE_STRING),
+                             attribute("n", HYPERDATATYPE_INT64),
+                             attribute("f", HYPERDATATYPE_FLOAT),
+                             attribute("m", HYPERDATATYPE_MAP_STRING_INT64),
+                             attribute("l", HYPERDATATYPE_LIST_STRING),
+                             attribute("doc", HYPERDATATYPE_DOCUMENT)};
+
+static hyperdex_client_attribute
+make_attr(const char* attr, const char* value, size_t value_sz, hyperdatatype t)
+{
+    hyperdex_client_attribute a;
+    a.attr = attr;
+    a.value = value;
+    a.value_sz = value_sz;
+    a.datatype = t;
+    return a;
+}
+
+static hyperdex_client_attribute_check
+make_check(const char* attr, const char* value, size_t value_sz,
+           hyperdatatype t, hyperpredicate p)
+{
+    hyperdex_client_attribute_check c;
+    c.attr = attr;
+    c.value = value;
+    c.value_sz = value_sz;
+    c.datatype = t;
+    c.predicate = p;
+    return c;
+}
+
+client_bench :: client_bench()
+    : m_cl("127.0.0.1", 1982)
+    , m_sc(NULL)
+    , m_ri()
+    , m_arena(hyperdex_ds_arena_create())
+    , m_keys()
+    , m_key_slices()
+    , m_name("alice liddell")
+    , m_json("{\"name\": \"alice\", \"age\": 30, \"tags\": [\"a\", \"b\", \"c\"], "
+             "\"address\": {\"city\": \"ithaca\", \"zip\": \"14850\"}}")
+    , m_bson()
+    , m_map(NULL)
+    , m_map_sz(0)
+    , m_list(NULL)
+    , m_list_sz(0)
+    , m_regex("^al")
+    , m_primitives()
+    , m_containers()
+    , m_document()
+    , m_document_raw()
+    , m_object()
+    , m_checks()
+    , m_response()
+{
+    if (!m_arena)
+    {
+        throw std::bad_alloc();
+    }
+}
+
+client_bench :: ~client_bench() throw ()
+{
+    hyperdex_ds_arena_destroy(m_arena);
+}
+
+bool
+client_bench :: setup(uint64_t servers, uint64_t partitions)
+{
+    // the servers and the one space, laid out as the coordinator would and
+    // packed the way it sends configurations, replicas placed round robin
+    std::vector<server> srvs;
+
+    for (uint64_t i = 0; i < servers; ++i)
+    {
+        srvs.push_back(server(server_id(i + 1)));
+        srvs.back().state = server::AVAILABLE;
+    }
+
+    schema sc;
+    sc.attrs_sz = sizeof(_attrs) / sizeof(_attrs[0]);
+    sc.attrs = _attrs;
+    space sp("bench", sc);
+    uint64_t id = 1;
+    sp.id = space_id(id++);
+    sp.subspaces.push_back(subspace());
+    sp.subspaces[0].id = subspace_id(id++);
+    sp.subspaces[0].attrs.push_back(0);
+    partition(1, partitions, &sp.subspaces[0].regions);
+
+    for (size_t i = 0; i < sp.subspaces[0].regions.size(); ++i)
+    {
+        region& r(sp.subspaces[0].regions[i]);
+        r.id = region_id(id++);
+
+        for (uint64_t j = 0; j < 2 && j < servers; ++j)
+        {
+            server_id si(srvs[(i + j) % servers].id);
+            r.replicas.push_back(replica(si, virtual_server_id(id++)));
+        }
+    }
+
+    size_t sz = 7 * sizeof(uint64_t) + pack_size(sp);
+
+    for (size_t i = 0; i < srvs.size(); ++i)
+    {
+        sz += pack_size(srvs[i]);
+    }
+
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    e::packer pa = msg->pack_at(0);
+    pa = pa << uint64_t(1) << uint64_t(1) << uint64_t(0) << uint64_t(0)
+            << uint64_t(srvs.size()) << uint64_t(1) << uint64_t(0);
+
+    for (size_t i = 0; i < srvs.size(); ++i)
+    {
+        pa = pa << srvs[i];
+    }
+
+    pa = pa << sp;
+
+    if ((msg->unpack_from(0) >> m_cl.m_config).error())
+    {
+        std::cerr << "could not build a configuration" << std::endl;
+        return false;
+    }
+
+    m_sc = m_cl.m_config.get_schema("bench");
+    m_ri = m_cl.m_config.get_region_id(m_cl.m_config.point_leader("bench", e::slice("k")));
+
+    if (!m_sc || m_ri == region_id())
+    {
+        std::cerr << "the configuration has no space to route to" << std::endl;
+        return false;
+    }
+
+    for (uint64_t i = 0; i < BENCH_KEYS; ++i)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "user:%010lu", static_cast<unsigned long>(i));
+        m_keys.push_back(buf);
+    }
+
+    for (size_t i = 0; i < m_keys.size(); ++i)
+    {
+        m_key_slices.push_back(e::slice(m_keys[i]));
+    }
+
+    // the values, in the form an application hands them over
+    hyperdex_ds_pack_int(30, m_n);
+    hyperdex_ds_pack_float(0.75, m_f);
+    hyperdex_ds_pack_int(18, m_lo);
+    hyperdex_ds_pack_int(65, m_hi);
+    hyperdex_ds_pack_float(0.5, m_min);
+    hyperdex_ds_returncode dsrc;
+    hyperdatatype t;
+    hyperdex_ds_map* map = hyperdex_ds_allocate_map(m_arena);
+    hyperdex_ds_list* list = hyperdex_ds_allocate_list(m_arena);
+
+    for (uint64_t i = 0; i < BENCH_ELEMS; ++i)
+    {
+        char buf[32];
+        int buf_sz = snprintf(buf, sizeof(buf), "element-%04lu", static_cast<unsigned long>(i));
+
+        if (hyperdex_ds_map_insert_key_string(map, buf, buf_sz, &dsrc) < 0 ||
+            hyperdex_ds_map_insert_val_int(map, i, &dsrc) < 0 ||
+            hyperdex_ds_list_append_string(list, buf, buf_sz, &dsrc) < 0)
+        {
+            std::cerr << "could not build the container values" << std::endl;
+            return false;
+        }
+    }
+
+    if (hyperdex_ds_map_finalize(map, &dsrc, &m_map, &m_map_sz, &t) < 0 ||
+        hyperdex_ds_list_finalize(list, &dsrc, &m_list, &m_list_sz, &t) < 0)
+    {
+        std::cerr << "could not build the container values" << std::endl;
+        return false;
+    }
+
+    // the document as the server keeps it, for unconverted puts and for the
+    // response the decoding benchmarks unpack
+    e::arena memory;
+    e::slice bson;
+
+    if (!datatype_info::lookup(HYPERDATATYPE_DOCUMENT)->client_to_server(e::slice(m_json), &memory, &bson))
+    {
+        std::cerr << "could not convert the document" << std::endl;
+        return false;
+    }
+
+    m_bson.assign(reinterpret_cast<const char*>(bson.data()), bson.size());
+
+    m_primitives.push_back(make_attr("name", m_name.data(), m_name.size(), HYPERDATATYPE_STRING));
+    m_primitives.push_back(make_attr("n", m_n, sizeof(m_n), HYPERDATATYPE_INT64));
+    m_primitives.push_back(make_attr("f", m_f, sizeof(m_f), HYPERDATATYPE_FLOAT));
+    m_containers.push_back(make_attr("m", m_map, m_map_sz, HYPERDATATYPE_MAP_STRING_INT64));
+    m_containers.push_back(make_attr("l", m_list, m_list_sz, HYPERDATATYPE_LIST_STRING));
+    m_document.push_back(make_attr("doc", m_json.data(), m_json.size(), HYPERDATATYPE_DOCUMENT));
+    m_document_raw.push_back(make_attr("doc", m_bson.data(), m_bson.size(), HYPERDATATYPE_DOCUMENT));
+    m_object = m_primitives;
+    m_object.insert(m_object.end(), m_containers.begin(), m_containers.end());
+    m_object.push_back(m_document[0]);
+
+    m_checks.push_back(make_check("n", m_lo, sizeof(m_lo), HYPERDATATYPE_INT64, HYPERPREDICATE_GREATER_EQUAL));
+    m_checks.push_back(make_check("n", m_hi, sizeof(m_hi), HYPERDATATYPE_INT64, HYPERPREDICATE_LESS_THAN));
+    m_checks.push_back(make_check("name", m_regex.data(), m_regex.size(), HYPERDATATYPE_STRING, HYPERPREDICATE_REGEX));
+    m_checks.push_back(make_check("f", m_min, sizeof(m_min), HYPERDATATYPE_FLOAT, HYPERPREDICATE_GREATER_THAN));
+
+    // a RESP_GET carrying the whole object
+    std::vector<e::slice> value;
+    value.push_back(e::slice(m_name));
+    value.push_back(e::slice(m_n, sizeof(m_n)));
+    value.push_back(e::slice(m_f, sizeof(m_f)));
+    value.push_back(e::slice(m_map, m_map_sz));
+    value.push_back(e::slice(m_list, m_list_sz));
+    value.push_back(e::slice(m_bson));
+    uint16_t rc = static_cast<uint16_t>(NET_SUCCESS);
+    m_response.reset(e::buffer::create(HYPERDEX_CLIENT_HEADER_SIZE_RESP
+                                       + sizeof(uint16_t) + pack_size(value)));
+    m_response->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_RESP) << rc << value;
+    return true;
+}
+
+uint64_t
+client_bench :: run(kind_t k, uint64_t iters)
+{
+    uint64_t acc = 0;
+
+    switch (k)
+    {
+        case POINT_LEADER:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                acc += m_cl.m_config.point_leader("bench", m_key_slices[i % BENCH_KEYS]).get();
+            }
+            break;
+        case POINT_LEADER_BATCH:
+        {
+            virtual_server_id leaders[BENCH_BATCH];
+
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                size_t off = (i * BENCH_BATCH) % BENCH_KEYS;
+                m_cl.m_config.point_leader("bench", &m_key_slices[off], BENCH_BATCH, leaders);
+                acc += leaders[i % BENCH_BATCH].get();
+            }
+            break;
+        }
+        case PREPARE_CHECKS:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                e::arena memory;
+                hyperdex_client_returncode status;
+                std::vector<attribute_check> checks;
+                acc += m_cl.prepare_checks("bench", *m_sc, &m_checks[0], m_checks.size(),
+                                           &memory, &status, &checks);
+            }
+            break;
+        case PREPARE_PRIMITIVES:
+            return prepare(&m_primitives[0], m_primitives.size(), true, iters);
+        case PREPARE_CONTAINERS:
+            return prepare(&m_containers[0], m_containers.size(), true, iters);
+        case PREPARE_DOCUMENT:
+            return prepare(&m_document[0], m_document.size(), true, iters);
+        case PREPARE_DOCUMENT_RAW:
+            return prepare(&m_document_raw[0], m_document_raw.size(), false, iters);
+        case ENCODE_PUT:
+            return encode(NULL, 0, hyperdex_client_keyop_info_lookup("put", 3), iters);
+        case ENCODE_COND_PUT:
+            return encode(&m_checks[0], m_checks.size(),
+                          hyperdex_client_keyop_info_lookup("cond_put", 8), iters);
+        case DECODE_GET:
+            return decode(true, iters);
+        case DECODE_GET_RAW:
+            return decode(false, iters);
+        default:
+            abort();
+    }
+
+    return acc;
+}
+
+uint64_t
+client_bench :: prepare(const hyperdex_client_attribute* attrs, size_t attrs_sz,
+                        bool convert, uint64_t iters)
+{
+    const hyperdex_client_keyop_info* opinfo = hyperdex_client_keyop_info_lookup("put", 3);
+    m_cl.set_type_conversion(convert);
+    uint64_t acc = 0;
+
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        e::arena memory;
+        hyperdex_client_returncode status;
+        std::vector<funcall> funcs;
+        acc += m_cl.prepare_funcs("bench", *m_sc, opinfo, attrs, attrs_sz,
+                                  &memory, &status, &funcs);
+    }
+
+    m_cl.set_type_conversion(true);
+    return acc;
+}
+
+// what client::perform_funcall does for a key operation once it knows the
+// schema: checks, funcalls and the packed request, key included
+uint64_t
+client_bench :: encode(const hyperdex_client_attribute_check* chks, size_t chks_sz,
+                       const hyperdex_client_keyop_info* opinfo, uint64_t iters)
+{
+    uint64_t acc = 0;
+
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        const e::slice& key(m_key_slices[i % BENCH_KEYS]);
+        size_t header_sz = HYPERDEX_CLIENT_HEADER_SIZE_REQ + pack_size(key);
+        hyperdex_client_returncode status;
+        std::auto_ptr<e::buffer> msg;
+
+        if (m_cl.perform_funcall("bench", m_sc, opinfo, chks, chks_sz,
+                                 &m_object[0], m_object.size(), NULL, 0,
+                                 header_sz, 0, &status, &msg) < 0)
+        {
+            continue;
+        }
+
+        msg->pack_at(HYPERDEX_CLIENT_HEADER_SIZE_REQ) << key;
+        acc += msg->size();
+    }
+
+    return acc;
+}
+
+// what pending_get does with a RESP_GET: unpack it and build the attributes
+uint64_t
+client_bench :: decode(bool convert, uint64_t iters)
+{
+    uint64_t acc = 0;
+
+    for (uint64_t i = 0; i < iters; ++i)
+    {
+        uint16_t rc;
+        std::vector<e::slice> value;
+        e::unpacker up = m_response->unpack_from(HYPERDEX_CLIENT_HEADER_SIZE_RESP);
+        up = up >> rc >> value;
+        hyperdex_client_returncode status;
+        e::error err;
+        const hyperdex_client_attribute* attrs = NULL;
+        size_t attrs_sz = 0;
+
+        if (up.error() ||
+            !value_to_attributes(m_cl.m_config, m_ri, NULL, 0, value,
+                                 &status, &err, &attrs, &attrs_sz,
+                                 convert, NULL))
+        {
+            continue;
+        }
+
+        acc += attrs_sz;
+        free(const_cast<hyperdex_client_attribute*>(attrs));
+    }
+
+    return acc;
+}
+
+END_HYPERDEX_NAMESPACE
+
+using hyperdex::client_bench;
+
+namespace
+{
+
+struct bench
+{
+    const char* name;
+    client_bench::kind_t kind;
+};
+
+const bench _benches[] = {
+    {"route/point_leader", client_bench::POINT_LEADER},
+    {"route/point_leader_batch/64", client_bench::POINT_LEADER_BATCH},
+    {"prepare/checks", client_bench::PREPARE_CHECKS},
+    {"prepare/funcs_primitive", client_bench::PREPARE_PRIMITIVES},
+    {"prepare/funcs_container", client_bench::PREPARE_CONTAINERS},
+    {"prepare/funcs_document", client_bench::PREPARE_DOCUMENT},
+    {"prepare/funcs_document_unconverted", client_bench::PREPARE_DOCUMENT_RAW},
+    {"encode/put", client_bench::ENCODE_PUT},
+    {"encode/cond_put", client_bench::ENCODE_COND_PUT},
+    {"decode/get", client_bench::DECODE_GET},
+    {"decode/get_unconverted", client_bench::DECODE_GET_RAW}
+};
+
+// Run b in doubling batches until a batch takes at least the minimum time;
+// report that batch
+void
+measure(client_bench* cb, const bench& b, bool first)
+{
+    const uint64_t min_ns = static_cast<uint64_t>(_min_time_ms) * 1000000ULL;
+    uint64_t iters = 1;
+    uint64_t elapsed = 0;
+
+    // one untimed pass to warm the caches and the allocator
+    _sink += cb->run(b.kind, 1);
+
+    while (true)
+    {
+        uint64_t start = po6::monotonic_time();
+        _sink += cb->run(b.kind, iters);
+        elapsed = po6::monotonic_time() - start;
+
+        if (elapsed >= min_ns || iters >= (1ULL << 40))
+        {
+            break;
+        }
+
+        iters *= 2;
+    }
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.3f", static_cast<double>(elapsed) / iters);
+    std::cout << (first ? "" : ",\n")
+              << "    {\"name\": \"" << b.name << "\", "
+              << "\"iterations\": " << iters << ", "
+              << "\"ns_per_op\": " << buf << "}";
+}
+
+} // namespace
+
+int
+main(int argc, const char* argv[])
+{
+    e::argparser ap;
+    ap.autohelp();
+    ap.arg().name('t', "min-time")
+            .description("run each benchmark for at least this many milliseconds (default: 200)")
+            .metavar("ms").as_long(&_min_time_ms);
+    ap.arg().name('f', "filter")
+            .description("only run benchmarks whose name contains this string")
+            .metavar("substr").as_string(&_filter);
+    ap.arg().name('s', "servers")
+            .description("servers in the configuration (default: 16)")
+            .metavar("N").as_long(&_servers);
+    ap.arg().name('P', "partitions")
+            .description("regions in the key subspace (default: 256)")
+            .metavar("N").as_long(&_partitions);
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() != 0)
+    {
+        std::cerr << "command takes no positional arguments\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (_min_time_ms <= 0 || _servers <= 0 || _partitions <= 0)
+    {
+        std::cerr << "the minimum time, servers and partitions must be positive" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    client_bench cb;
+
+    if (!cb.setup(_servers, _partitions))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "{\n  \"benchmarks\": [\n";
+    bool first = true;
+
+    for (size_t i = 0; i < sizeof(_benches) / sizeof(_benches[0]); ++i)
+    {
+        if (strstr(_benches[i].name, _filter) == NULL)
+        {
+            continue;
+        }
+
+        measure(&cb, _benches[i], first);
+        first = false;
+        std::cout << std::flush;
+    }
+
+    std::cout << "\n  ]\n}" << std::endl;
+    return EXIT_SUCCESS;
+}
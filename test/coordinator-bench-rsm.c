@@ -0,0 +1,130 @@
+/* Copyright (c) 2015, Cornell University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *     * Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the name of Replicant nor the names of its contributors may be
+ *       used to endorse or promote products derived from this software without
+ *       specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/* Stand-ins for Replicant's state machine context, so that
+ * coordinator-bench can call the coordinator's transitions directly.  They
+ * deliberately do not include <rsm.h>: the coordinator only ever passes the
+ * context back to these functions, so nothing depends on its layout. */
+
+/* C */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct rsm_context
+{
+    int unused;
+};
+
+static struct rsm_context the_context;
+int coordinator_bench_verbose = 0;
+/* the most recent "config" broadcast, which a change to the coordinator's
+ * state always ends with */
+char* coordinator_bench_config = NULL;
+size_t coordinator_bench_config_sz = 0;
+uint64_t coordinator_bench_configs = 0;
+
+struct rsm_context*
+coordinator_bench_context(void)
+{
+    return &the_context;
+}
+
+void
+rsm_log(struct rsm_context* ctx, const char* format, ...)
+{
+    va_list args;
+    (void) ctx;
+
+    if (coordinator_bench_verbose)
+    {
+        va_start(args, format);
+        vfprintf(stderr, format, args);
+        va_end(args);
+    }
+}
+
+void
+rsm_set_output(struct rsm_context* ctx, const char* output, size_t output_sz)
+{
+    (void) ctx;
+    (void) output;
+    (void) output_sz;
+}
+
+void
+rsm_cond_create(struct rsm_context* ctx, const char* cond)
+{
+    (void) ctx;
+    (void) cond;
+}
+
+int
+rsm_cond_broadcast(struct rsm_context* ctx, const char* cond)
+{
+    (void) ctx;
+    (void) cond;
+    return 0;
+}
+
+int
+rsm_cond_broadcast_data(struct rsm_context* ctx,
+                        const char* cond,
+                        const char* data, size_t data_sz)
+{
+    char* copy;
+    (void) ctx;
+
+    if (strcmp(cond, "config") != 0)
+    {
+        return 0;
+    }
+
+    copy = realloc(coordinator_bench_config, data_sz ? data_sz : 1);
+
+    if (!copy)
+    {
+        abort();
+    }
+
+    memmove(copy, data, data_sz);
+    coordinator_bench_config = copy;
+    coordinator_bench_config_sz = data_sz;
+    ++coordinator_bench_configs;
+    return 0;
+}
+
+void
+rsm_tick_interval(struct rsm_context* ctx, const char* func, uint64_t seconds)
+{
+    (void) ctx;
+    (void) func;
+    (void) seconds;
+}
@@ -0,0 +1,540 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// Drive the coordinator's state machine directly, with synthetic servers and
+// spaces, to see how its transitions scale with the size of the cluster.
+// The Replicant context is stubbed out by coordinator-bench-rsm.c, which
+// keeps the configuration the coordinator last broadcast.
+
+// C
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+// STL
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/net/location.h>
+#include <po6/time.h>
+
+// e
+#include <e/popt.h>
+#include <e/serialization.h>
+
+// HyperDex
+#include "common/attribute.h"
+#include "common/configuration.h"
+#include "common/hyperspace.h"
+#include "common/schema.h"
+#include "common/transfer.h"
+#include "admin/partition.h"
+#include "coordinator/coordinator.h"
+
+extern "C"
+{
+extern int coordinator_bench_verbose;
+extern char* coordinator_bench_config;
+extern size_t coordinator_bench_config_sz;
+extern uint64_t coordinator_bench_configs;
+struct rsm_context* coordinator_bench_context(void);
+}
+
+using hyperdex::server_id;
+
+namespace
+{
+
+struct options
+{
+    options()
+        : servers(1000), spaces(100), partitions(1000), subspaces(0)
+        , fault_tolerance(2), offline(10), online(10), transfers(1000) {}
+    uint64_t servers;
+    uint64_t spaces;
+    uint64_t partitions;
+    uint64_t subspaces;
+    uint64_t fault_tolerance;
+    uint64_t offline;
+    uint64_t online;
+    uint64_t transfers;
+};
+
+class timing
+{
+    public:
+        timing(const char* name) : m_name(name), m_count(0), m_total(0), m_max(0), m_start(0) {}
+
+    public:
+        void start() { m_start = po6::monotonic_time(); }
+        void stop()
+        {
+            uint64_t t = po6::monotonic_time() - m_start;
+            ++m_count;
+            m_total += t;
+            m_max = std::max(m_max, t);
+        }
+        void print(double scale) const;
+
+    private:
+        const char* m_name;
+        uint64_t m_count;
+        uint64_t m_total;
+        uint64_t m_max;
+        uint64_t m_start;
+};
+
+class harness
+{
+    public:
+        harness(const options& opts);
+
+    public:
+        void run(double scale);
+
+    private:
+        bool refresh();
+        server_id add_server(timing* reg, timing* online);
+        void add_space(uint64_t idx);
+        void ack_all(timing* t);
+        void report_all(timing* t);
+        // complete up to opts.transfers transfers, the way daemons would
+        uint64_t converge(timing* t);
+
+    private:
+        const options m_opts;
+        rsm_context* m_ctx;
+        hyperdex::coordinator m_coord;
+        hyperdex::configuration m_config;
+        std::vector<server_id> m_sids;
+        uint64_t m_seed;
+
+    private:
+        harness(const harness&);
+        harness& operator = (const harness&);
+};
+
+void
+timing :: print(double scale) const
+{
+    std::cout << std::setw(7) << scale << " "
+              << std::setw(16) << std::left << m_name << std::right
+              << std::setw(8) << m_count
+              << std::setw(12) << (m_count ? m_total / m_count / 1000. : 0)
+              << std::setw(12) << m_max / 1000.
+              << std::setw(12) << m_total / 1000000.
+              << std::setw(12) << coordinator_bench_config_sz << "\n";
+}
+
+harness :: harness(const options& opts)
+    : m_opts(opts)
+    , m_ctx(coordinator_bench_context())
+    , m_coord()
+    , m_config()
+    , m_sids()
+    , m_seed(0x9e3779b97f4a7c15ULL)
+{
+    // each harness starts from a fresh coordinator
+    free(coordinator_bench_config);
+    coordinator_bench_config = NULL;
+    coordinator_bench_config_sz = 0;
+    coordinator_bench_configs = 0;
+}
+
+bool
+harness :: refresh()
+{
+    if (!coordinator_bench_config)
+    {
+        return false;
+    }
+
+    e::unpacker up(coordinator_bench_config, coordinator_bench_config_sz);
+    up = up >> m_config;
+    return !up.error();
+}
+
+server_id
+harness :: add_server(timing* reg, timing* online)
+{
+    server_id sid(m_sids.size() + 1);
+    po6::net::location loc("127.0.0.1", 1024 + m_sids.size());
+    reg->start();
+    m_coord.server_register(m_ctx, sid, loc, std::string());
+    reg->stop();
+    online->start();
+    m_coord.server_online(m_ctx, sid, &loc);
+    online->stop();
+    m_sids.push_back(sid);
+    return sid;
+}
+
+void
+harness :: add_space(uint64_t idx)
+{
+    std::vector<hyperdex::attribute> attrs;
+    std::vector<std::string> names;
+    names.push_back("k");
+
+    for (uint64_t i = 0; i < m_opts.subspaces + 1; ++i)
+    {
+        std::ostringstream ostr;
+        ostr << "a" << i;
+        names.push_back(ostr.str());
+    }
+
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        attrs.push_back(hyperdex::attribute(names[i].c_str(), HYPERDATATYPE_STRING));
+    }
+
+    hyperdex::schema sc;
+    sc.attrs_sz = attrs.size();
+    sc.attrs = &attrs.front();
+    std::ostringstream name;
+    name << "space" << idx;
+    std::string name_str(name.str());
+    hyperdex::space sp(name_str.c_str(), sc);
+
+    for (uint64_t i = 0; i < m_opts.subspaces + 1; ++i)
+    {
+        sp.subspaces.push_back(hyperdex::subspace());
+        sp.subspaces.back().attrs.push_back(i);
+        hyperdex::partition(1, m_opts.partitions, &sp.subspaces.back().regions);
+    }
+
+    sp.fault_tolerance = m_opts.fault_tolerance;
+    m_coord.space_add(m_ctx, sp);
+}
+
+void
+harness :: ack_all(timing* t)
+{
+    if (!refresh())
+    {
+        return;
+    }
+
+    uint64_t version = m_config.version();
+
+    for (size_t i = 0; i < m_sids.size(); ++i)
+    {
+        t->start();
+        m_coord.config_ack(m_ctx, m_sids[i], version);
+        t->stop();
+    }
+
+    for (size_t i = 0; i < m_sids.size(); ++i)
+    {
+        t->start();
+        m_coord.config_stable(m_ctx, m_sids[i], version);
+        t->stop();
+    }
+}
+
+void
+harness :: report_all(timing* t)
+{
+    if (!refresh())
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < m_sids.size(); ++i)
+    {
+        std::vector<hyperdex::region_id> rids;
+        m_config.mapped_regions(m_sids[i], &rids);
+        std::vector<uint64_t> bytes;
+        std::vector<uint64_t> ops;
+
+        for (size_t j = 0; j < rids.size(); ++j)
+        {
+            m_seed ^= m_seed << 13;
+            m_seed ^= m_seed >> 7;
+            m_seed ^= m_seed << 17;
+            bytes.push_back((m_seed & 0xffff) << 20);
+            ops.push_back(m_seed >> 48);
+        }
+
+        t->start();
+        m_coord.report_load(m_ctx, m_sids[i], rids, bytes, ops);
+        t->stop();
+    }
+}
+
+uint64_t
+harness :: converge(timing* t)
+{
+    uint64_t done = 0;
+
+    while (done < m_opts.transfers && refresh())
+    {
+        std::vector<hyperdex::transfer> xfers;
+
+        for (size_t i = 0; i < m_sids.size(); ++i)
+        {
+            m_config.transfers_in(m_sids[i], &xfers);
+        }
+
+        if (xfers.empty())
+        {
+            break;
+        }
+
+        for (size_t i = 0; i < xfers.size() && done < m_opts.transfers; ++i, ++done)
+        {
+            std::vector<hyperdex::transfer_id> xids(1, xfers[i].id);
+            t->start();
+            m_coord.transfer_go_live(m_ctx, xids);
+            m_coord.transfer_complete(m_ctx, xids);
+            t->stop();
+        }
+    }
+
+    return done;
+}
+
+void
+harness :: run(double scale)
+{
+    timing t_init("init");
+    t_init.start();
+    m_coord.init(m_ctx, 0xdeadbeef);
+    t_init.stop();
+    t_init.print(scale);
+
+    timing t_register("server_register");
+    timing t_online("server_online");
+    uint64_t servers = std::max<uint64_t>(m_opts.servers * scale, m_opts.fault_tolerance + 1);
+
+    for (uint64_t i = 0; i < servers; ++i)
+    {
+        add_server(&t_register, &t_online);
+    }
+
+    t_register.print(scale);
+    t_online.print(scale);
+
+    timing t_space("space_add");
+    uint64_t spaces = std::max<uint64_t>(m_opts.spaces * scale, 1);
+
+    for (uint64_t i = 0; i < spaces; ++i)
+    {
+        t_space.start();
+        add_space(i);
+        t_space.stop();
+    }
+
+    t_space.print(scale);
+
+    timing t_get("config_get");
+    t_get.start();
+    m_coord.config_get(m_ctx);
+    t_get.stop();
+    t_get.print(scale);
+
+    timing t_ack("ack/stable");
+    ack_all(&t_ack);
+    t_ack.print(scale);
+
+    timing t_report("report_load");
+    report_all(&t_report);
+    t_report.print(scale);
+
+    timing t_offline("server_offline");
+
+    for (uint64_t i = 0; i < m_opts.offline && i < m_sids.size(); ++i)
+    {
+        t_offline.start();
+        m_coord.server_offline(m_ctx, m_sids[i]);
+        t_offline.stop();
+    }
+
+    t_offline.print(scale);
+    timing t_xfer_offline("transfer(offline)");
+    converge(&t_xfer_offline);
+    t_xfer_offline.print(scale);
+
+    timing t_register2("rebalance_reg");
+    timing t_rebalance("rebalance");
+
+    for (uint64_t i = 0; i < m_opts.online; ++i)
+    {
+        add_server(&t_register2, &t_rebalance);
+    }
+
+    t_rebalance.print(scale);
+    timing t_xfer_rebalance("transfer(rebal)");
+    converge(&t_xfer_rebalance);
+    t_xfer_rebalance.print(scale);
+
+    timing t_periodic("periodic");
+    t_periodic.start();
+    m_coord.periodic(m_ctx);
+    t_periodic.stop();
+    t_periodic.print(scale);
+
+    timing t_snapshot("snapshot");
+    char* data = NULL;
+    size_t data_sz = 0;
+    t_snapshot.start();
+    m_coord.snapshot(m_ctx, &data, &data_sz);
+    t_snapshot.stop();
+    t_snapshot.print(scale);
+    timing t_recreate("recreate");
+    t_recreate.start();
+    hyperdex::coordinator* restored = hyperdex::coordinator::recreate(m_ctx, data, data_sz);
+    t_recreate.stop();
+    t_recreate.print(scale);
+    // a restored coordinator must snapshot back to the same bytes
+    const char* roundtrip = "failed";
+
+    if (restored)
+    {
+        char* again = NULL;
+        size_t again_sz = 0;
+        restored->snapshot(m_ctx, &again, &again_sz);
+        roundtrip = again_sz == data_sz && memcmp(again, data, data_sz) == 0
+                  ? "ok" : "differs";
+        free(again);
+        delete restored;
+    }
+
+    free(data);
+    std::cout << std::setw(7) << scale << " servers=" << m_sids.size()
+              << " regions=" << spaces * m_opts.partitions * (m_opts.subspaces + 1)
+              << " configs=" << coordinator_bench_configs
+              << " config_bytes=" << coordinator_bench_config_sz
+              << " snapshot_bytes=" << data_sz
+              << " roundtrip=" << roundtrip << "\n" << std::flush;
+}
+
+} // namespace
+
+int
+main(int argc, const char* argv[])
+{
+    long servers = 1000;
+    long spaces = 100;
+    long partitions = 1000;
+    long subspaces = 0;
+    long fault_tolerance = 2;
+    long offline = 10;
+    long online = 10;
+    long transfers = 1000;
+    bool sweep = false;
+    bool verbose = false;
+    e::argparser ap;
+    ap.autohelp();
+    ap.arg().name('s', "servers")
+            .description("register and bring online this many servers (default: 1000)")
+            .metavar("N").as_long(&servers);
+    ap.arg().name('S', "spaces")
+            .description("add this many spaces (default: 100)")
+            .metavar("N").as_long(&spaces);
+    ap.arg().name('P', "partitions")
+            .description("divide each subspace into this many regions (default: 1000)")
+            .metavar("N").as_long(&partitions);
+    ap.arg().long_name("subspaces")
+            .description("give each space this many subspaces beyond the key's (default: 0)")
+            .metavar("N").as_long(&subspaces);
+    ap.arg().name('f', "fault-tolerance")
+            .description("create each space to tolerate this many failures (default: 2)")
+            .metavar("N").as_long(&fault_tolerance);
+    ap.arg().long_name("offline")
+            .description("take this many servers offline (default: 10)")
+            .metavar("N").as_long(&offline);
+    ap.arg().long_name("online")
+            .description("then bring this many new servers online (default: 10)")
+            .metavar("N").as_long(&online);
+    ap.arg().long_name("transfers")
+            .description("complete at most this many of the transfers each change starts (default: 1000)")
+            .metavar("N").as_long(&transfers);
+    ap.arg().long_name("sweep")
+            .description("repeat with 1/8, 1/4 and 1/2 of the servers and spaces, to expose super-linear growth")
+            .set_true(&sweep);
+    ap.arg().name('v', "verbose")
+            .description("print the coordinator's log")
+            .set_true(&verbose);
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() != 0)
+    {
+        std::cerr << "command takes no positional arguments\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (servers <= 0 || spaces <= 0 || partitions <= 0 || subspaces < 0 ||
+        fault_tolerance < 0 || fault_tolerance >= servers ||
+        offline < 0 || offline > servers || online < 0 || transfers < 0)
+    {
+        std::cerr << "an option is out of range" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    options opts;
+    opts.servers = servers;
+    opts.spaces = spaces;
+    opts.partitions = partitions;
+    opts.subspaces = subspaces;
+    opts.fault_tolerance = fault_tolerance;
+    opts.offline = offline;
+    opts.online = online;
+    opts.transfers = transfers;
+    coordinator_bench_verbose = verbose ? 1 : 0;
+    std::cout << std::fixed << std::setprecision(3)
+              << std::setw(7) << "scale" << " "
+              << std::setw(16) << std::left << "transition" << std::right
+              << std::setw(8) << "count"
+              << std::setw(12) << "mean(us)"
+              << std::setw(12) << "max(us)"
+              << std::setw(12) << "total(ms)"
+              << std::setw(12) << "config(B)" << "\n";
+    double scales[] = {0.125, 0.25, 0.5, 1};
+    size_t first = sweep ? 0 : 3;
+
+    for (size_t i = first; i < sizeof(scales) / sizeof(scales[0]); ++i)
+    {
+        harness h(opts);
+        h.run(scales[i]);
+    }
+
+    return EXIT_SUCCESS;
+}
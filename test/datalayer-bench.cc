@@ -0,0 +1,620 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// Drive the datalayer directly, with no network, replication or coordinator,
+// so that storage changes can be measured on their own.  A daemon object is
+// built only to carry the configuration and server id the datalayer reads;
+// it never runs.
+
+// C
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <stdint.h>
+
+// POSIX
+#include <sys/stat.h>
+#include <sys/types.h>
+
+// STL
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Google Log
+#include <glog/logging.h>
+
+// po6
+#include <po6/threads/thread.h>
+#include <po6/time.h>
+
+// e
+#include <e/buffer.h>
+#include <e/compat.h>
+#include <e/endian.h>
+#include <e/intrusive_ptr.h>
+#include <e/popt.h>
+
+// HyperDex
+#include "cityhash/city.h"
+#include "common/attribute_check.h"
+#include "common/configuration.h"
+#include "common/hyperspace.h"
+#include "common/server.h"
+#include "daemon/daemon.h"
+#include "daemon/datalayer.h"
+#include "daemon/datalayer_iterator.h"
+#include "daemon/huge_pages.h"
+#include "daemon/latency_histogram.h"
+
+using po6::threads::make_obj_func;
+
+// secondary int attributes; the first --indexes of them are indexed
+#define BENCH_INT_ATTRS 4
+
+BEGIN_HYPERDEX_NAMESPACE
+
+class datalayer_bench
+{
+    public:
+        enum phase_t { PUT, GET, OVERPUT, SEARCH, DEL, PHASES };
+
+    public:
+        datalayer_bench();
+        ~datalayer_bench() throw ();
+
+    public:
+        bool setup(const std::string& dir, const datalayer::tuning& t, unsigned indexes);
+        void run_phase(phase_t p);
+        void teardown() { m_d.m_data.teardown(); }
+
+    public:
+        unsigned threads;
+        uint64_t objects;
+        uint64_t value_size;
+        uint64_t searches;
+        uint64_t search_width;
+
+    private:
+        // the value of object k after "generation" writes
+        void make_value(uint64_t k, uint64_t generation,
+                        std::vector<std::string>* backing,
+                        std::vector<e::slice>* value);
+        void worker(unsigned idx);
+        static bool io_written(uint64_t* bytes);
+
+    private:
+        daemon m_d;
+        attribute m_attrs[BENCH_INT_ATTRS + 2];
+        schema m_sc;
+        region_id m_ri;
+        std::vector<index_id> m_indices;
+        phase_t m_phase;
+        latency_histogram m_lat;
+        uint64_t m_logical;
+        uint64_t m_failed;
+        uint64_t m_found;
+
+    private:
+        datalayer_bench(const datalayer_bench&);
+        datalayer_bench& operator = (const datalayer_bench&);
+};
+
+static const char* phase_names[datalayer_bench::PHASES] = {"put", "get", "overput", "search", "del"};
+
+datalayer_bench :: datalayer_bench()
+    : threads(4)
+    , objects(100000)
+    , value_size(100)
+    , searches(1000)
+    , search_width(100)
+    , m_d()
+    , m_attrs()
+    , m_sc()
+    , m_ri(3)
+    , m_indices()
+    , m_phase(PUT)
+    , m_lat()
+    , m_logical(0)
+    , m_failed(0)
+    , m_found(0)
+{
+    static const char* names[BENCH_INT_ATTRS] = {"a0", "a1", "a2", "a3"};
+    m_attrs[0] = attribute("k", HYPERDATATYPE_INT64);
+
+    for (size_t i = 0; i < BENCH_INT_ATTRS; ++i)
+    {
+        m_attrs[i + 1] = attribute(names[i], HYPERDATATYPE_INT64);
+    }
+
+    m_attrs[BENCH_INT_ATTRS + 1] = attribute("v", HYPERDATATYPE_STRING);
+    m_sc.attrs_sz = BENCH_INT_ATTRS + 2;
+    m_sc.attrs = m_attrs;
+}
+
+datalayer_bench :: ~datalayer_bench() throw ()
+{
+}
+
+bool
+datalayer_bench :: setup(const std::string& dir, const datalayer::tuning& t, unsigned indexes)
+{
+    // one server holding the one region of a one-subspace space, laid out
+    // as the coordinator would and packed the way it sends configurations
+    server_id us(1);
+    server srv(us);
+    srv.state = server::AVAILABLE;
+    space sp("bench", m_sc);
+    sp.id = space_id(2);
+    sp.subspaces.push_back(subspace());
+    sp.subspaces[0].id = subspace_id(4);
+    sp.subspaces[0].attrs.push_back(0);
+    sp.subspaces[0].regions.push_back(region());
+    region& r(sp.subspaces[0].regions[0]);
+    r.id = m_ri;
+    r.lower_coord.push_back(0);
+    r.upper_coord.push_back(UINT64_MAX);
+    r.replicas.push_back(replica(us, virtual_server_id(5)));
+
+    for (unsigned i = 0; i < indexes; ++i)
+    {
+        m_indices.push_back(index_id(6 + i));
+        sp.indices.push_back(index(index::NORMAL, m_indices.back(), i + 1, e::slice()));
+    }
+
+    size_t sz = 7 * sizeof(uint64_t) + pack_size(srv) + pack_size(sp);
+    std::auto_ptr<e::buffer> msg(e::buffer::create(sz));
+    msg->pack_at(0) << uint64_t(1) << uint64_t(1) << uint64_t(0) << uint64_t(0)
+                    << uint64_t(1) << uint64_t(1) << uint64_t(0)
+                    << srv << sp;
+    configuration config;
+
+    if ((msg->unpack_from(0) >> config).error())
+    {
+        std::cerr << "could not build a configuration" << std::endl;
+        return false;
+    }
+
+    if (mkdir(dir.c_str(), S_IRWXU) < 0 && errno != EEXIST)
+    {
+        std::cerr << "could not create " << dir << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    bool saved = false;
+    server_id saved_us;
+    po6::net::location saved_bind_to;
+    po6::net::hostname saved_coordinator;
+    m_d.m_us = us;
+    m_d.m_data_dir = dir;
+
+    if (!m_d.m_data.initialize(dir, t, &saved, &saved_us, &saved_bind_to, &saved_coordinator))
+    {
+        std::cerr << "could not initialize the datalayer in " << dir << std::endl;
+        return false;
+    }
+
+    configuration empty;
+    m_d.m_data.pause();
+    m_d.m_data.reconfigure(empty, config, us);
+    m_d.install_config(config);
+    m_d.m_data.unpause();
+
+    // the indexer marks each index usable once it has backfilled it
+    uint64_t deadline = po6::monotonic_time() + 60 * 1000000000ULL;
+
+    for (size_t i = 0; i < m_indices.size(); ++i)
+    {
+        while (!m_d.m_data.has_index_marker(m_ri, m_indices[i]))
+        {
+            if (po6::monotonic_time() > deadline)
+            {
+                std::cerr << "index " << m_indices[i] << " never became usable" << std::endl;
+                return false;
+            }
+
+            timespec ts = {0, 10 * 1000000};
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    return true;
+}
+
+void
+datalayer_bench :: make_value(uint64_t k, uint64_t generation,
+                              std::vector<std::string>* backing,
+                              std::vector<e::slice>* value)
+{
+    backing->resize(BENCH_INT_ATTRS + 1);
+    value->resize(BENCH_INT_ATTRS + 1);
+
+    for (size_t i = 0; i < BENCH_INT_ATTRS; ++i)
+    {
+        // spread each attribute uniformly over [0, objects) so that a range
+        // of width w matches about w objects
+        uint64_t h = CityHash64WithSeed(reinterpret_cast<const char*>(&k), sizeof(k),
+                                        generation * BENCH_INT_ATTRS + i);
+        char buf[sizeof(int64_t)];
+        e::pack64le(static_cast<int64_t>(h % objects), buf);
+        (*backing)[i].assign(buf, sizeof(buf));
+    }
+
+    (*backing)[BENCH_INT_ATTRS].assign(value_size, 'a' + (k + generation) % 26);
+
+    for (size_t i = 0; i < backing->size(); ++i)
+    {
+        (*value)[i] = e::slice((*backing)[i]);
+    }
+}
+
+void
+datalayer_bench :: worker(unsigned idx)
+{
+    datalayer& dl(m_d.m_data);
+    std::vector<std::string> old_backing;
+    std::vector<std::string> new_backing;
+    std::vector<e::slice> old_value;
+    std::vector<e::slice> new_value;
+    std::vector<e::slice> got;
+    uint64_t logical = 0;
+    uint64_t failed = 0;
+    uint64_t found = 0;
+    uint64_t seed = idx + 1;
+    uint64_t begin = objects * idx / threads;
+    uint64_t end = objects * (idx + 1) / threads;
+    uint64_t count = m_phase == SEARCH ? searches / threads : end - begin;
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        uint64_t k = begin + i;
+        char kbuf[sizeof(int64_t)];
+        e::slice key(kbuf, sizeof(kbuf));
+        datalayer::returncode rc = datalayer::SUCCESS;
+        uint64_t t_start = po6::monotonic_time();
+
+        switch (m_phase)
+        {
+            case PUT:
+                e::pack64le(static_cast<int64_t>(k), kbuf);
+                make_value(k, 0, &new_backing, &new_value);
+                rc = dl.put(m_ri, key, new_value, 1);
+                break;
+            case GET:
+            {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                k = (seed >> 33) % objects;
+                e::pack64le(static_cast<int64_t>(k), kbuf);
+                uint64_t version;
+                datalayer::reference ref;
+                rc = dl.get(m_ri, key, &got, &version, &ref);
+                break;
+            }
+            case OVERPUT:
+                e::pack64le(static_cast<int64_t>(k), kbuf);
+                make_value(k, 0, &old_backing, &old_value);
+                make_value(k, 1, &new_backing, &new_value);
+                rc = dl.overput(m_ri, key, old_value, new_value, 2);
+                break;
+            case SEARCH:
+            {
+                seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                uint64_t lo = (seed >> 33) % objects;
+                char lbuf[sizeof(int64_t)];
+                char hbuf[sizeof(int64_t)];
+                e::pack64le(static_cast<int64_t>(lo), lbuf);
+                e::pack64le(static_cast<int64_t>(lo + search_width), hbuf);
+                std::vector<attribute_check> checks(2);
+                checks[0].attr = 1;
+                checks[0].value = e::slice(lbuf, sizeof(lbuf));
+                checks[0].datatype = HYPERDATATYPE_INT64;
+                checks[0].predicate = HYPERPREDICATE_GREATER_EQUAL;
+                checks[1].attr = 1;
+                checks[1].value = e::slice(hbuf, sizeof(hbuf));
+                checks[1].datatype = HYPERDATATYPE_INT64;
+                checks[1].predicate = HYPERPREDICATE_LESS_THAN;
+                datalayer::snapshot snap = dl.make_snapshot();
+                e::intrusive_ptr<datalayer::iterator> iter;
+                iter = dl.make_search_iterator(snap, m_ri, checks, NULL);
+
+                while (rc == datalayer::SUCCESS && iter->valid())
+                {
+                    e::slice k2;
+                    uint64_t version;
+                    datalayer::reference ref;
+                    rc = dl.get_from_iterator(m_ri, m_sc, iter.get(), &k2, &got, &version, &ref);
+                    found += rc == datalayer::SUCCESS ? 1 : 0;
+                    iter->next();
+                }
+
+                break;
+            }
+            case DEL:
+                e::pack64le(static_cast<int64_t>(k), kbuf);
+                make_value(k, 1, &old_backing, &old_value);
+                rc = dl.del(m_ri, key, old_value);
+                break;
+            case PHASES:
+            default:
+                abort();
+        }
+
+        m_lat.record(idx, po6::monotonic_time() - t_start);
+
+        if (m_phase == GET && rc == datalayer::SUCCESS)
+        {
+            ++found;
+        }
+
+        if (rc != datalayer::SUCCESS)
+        {
+            ++failed;
+        }
+        else if (m_phase == PUT || m_phase == OVERPUT)
+        {
+            logical += key.size();
+
+            for (size_t j = 0; j < new_value.size(); ++j)
+            {
+                logical += new_value[j].size();
+            }
+        }
+    }
+
+    __sync_fetch_and_add(&m_logical, logical);
+    __sync_fetch_and_add(&m_failed, failed);
+    __sync_fetch_and_add(&m_found, found);
+}
+
+void
+datalayer_bench :: run_phase(phase_t p)
+{
+    m_phase = p;
+    m_logical = 0;
+    m_failed = 0;
+    m_found = 0;
+    std::vector<uint64_t> ignored;
+    m_lat.interval(&ignored);
+    uint64_t io_before = 0;
+    bool have_io = io_written(&io_before);
+    std::vector<e::compat::shared_ptr<po6::threads::thread> > ts;
+
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        ts.push_back(e::compat::shared_ptr<po6::threads::thread>(
+                    new po6::threads::thread(make_obj_func(&datalayer_bench::worker, this, i))));
+    }
+
+    uint64_t t_start = po6::monotonic_time();
+
+    for (size_t i = 0; i < ts.size(); ++i)
+    {
+        ts[i]->start();
+    }
+
+    for (size_t i = 0; i < ts.size(); ++i)
+    {
+        ts[i]->join();
+    }
+
+    uint64_t elapsed = po6::monotonic_time() - t_start;
+    uint64_t io_after = 0;
+    have_io = io_written(&io_after) && have_io;
+    std::vector<uint64_t> counts;
+    m_lat.interval(&counts);
+    uint64_t ops = 0;
+
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        ops += counts[i];
+    }
+
+    std::cout << std::setw(8) << std::left << phase_names[p] << std::right
+              << " ops=" << ops
+              << " failed=" << m_failed
+              << std::fixed << std::setprecision(1)
+              << " seconds=" << elapsed / 1e9
+              << " ops/s=" << (elapsed ? ops * 1e9 / elapsed : 0)
+              << " p50=" << latency_histogram::percentile(counts, 50, 100) / 1000.
+              << " p99=" << latency_histogram::percentile(counts, 99, 100) / 1000.
+              << " p99.9=" << latency_histogram::percentile(counts, 999, 1000) / 1000. << "us";
+
+    if (p == GET || p == SEARCH)
+    {
+        std::cout << " found=" << m_found;
+    }
+
+    if (p == PUT || p == OVERPUT || p == DEL)
+    {
+        std::cout << " logical_bytes=" << m_logical;
+
+        if (have_io)
+        {
+            // LevelDB's flushes and compactions run on this process's
+            // threads, so they count here too, at least those that ran
+            // during the phase
+            std::cout << " written_bytes=" << io_after - io_before;
+
+            if (m_logical)
+            {
+                std::cout << std::setprecision(2) << " write_amp="
+                          << static_cast<double>(io_after - io_before) / m_logical;
+            }
+        }
+    }
+
+    std::cout << std::endl;
+}
+
+bool
+datalayer_bench :: io_written(uint64_t* bytes)
+{
+    std::ifstream in("/proc/self/io");
+    std::string name;
+    uint64_t value;
+
+    while (in >> name >> value)
+    {
+        if (name == "write_bytes:")
+        {
+            *bytes = value;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+END_HYPERDEX_NAMESPACE
+
+int
+main(int argc, const char* argv[])
+{
+    hyperdex::datalayer::tuning t;
+    const char* dir = "datalayer-bench-data";
+    long threads = 4;
+    long objects = 100000;
+    long value_size = 100;
+    long searches = 1000;
+    long search_width = 100;
+    long indexes = 1;
+    long write_buffer = t.write_buffer_size;
+    long bloom_bits = t.bloom_bits;
+    long block_cache = t.block_cache_size;
+    long object_cache = t.object_cache_size;
+    bool no_compression = false;
+    const char* huge_pages = "none";
+    e::argparser ap;
+    ap.autohelp();
+    ap.arg().name('D', "data")
+            .description("keep the LevelDB files in this directory (default: datalayer-bench-data)")
+            .metavar("dir").as_string(&dir);
+    ap.arg().name('t', "threads")
+            .description("run each phase on this many threads (default: 4)")
+            .metavar("N").as_long(&threads);
+    ap.arg().name('n', "objects")
+            .description("put, overput and delete this many objects (default: 100000)")
+            .metavar("N").as_long(&objects);
+    ap.arg().long_name("value-size")
+            .description("store a string of this many bytes with each object (default: 100)")
+            .metavar("B").as_long(&value_size);
+    ap.arg().long_name("searches")
+            .description("run this many range searches (default: 1000)")
+            .metavar("N").as_long(&searches);
+    ap.arg().long_name("search-width")
+            .description("match about this many objects with each search (default: 100)")
+            .metavar("N").as_long(&search_width);
+    ap.arg().name('i', "indexes")
+            .description("index this many of the four int attributes, 0 to 4 (default: 1)")
+            .metavar("N").as_long(&indexes);
+    ap.arg().long_name("write-buffer")
+            .description("LevelDB write buffer size in bytes")
+            .metavar("B").as_long(&write_buffer);
+    ap.arg().long_name("bloom-bits")
+            .description("bits per key of LevelDB's bloom filter; 0 disables it")
+            .metavar("N").as_long(&bloom_bits);
+    ap.arg().long_name("block-cache")
+            .description("LevelDB block cache size in bytes; 0 uses LevelDB's default")
+            .metavar("B").as_long(&block_cache);
+    ap.arg().long_name("object-cache")
+            .description("object cache size in bytes; 0 disables it")
+            .metavar("B").as_long(&object_cache);
+    ap.arg().long_name("no-compression")
+            .description("store LevelDB blocks uncompressed")
+            .set_true(&no_compression);
+    ap.arg().long_name("huge-pages")
+            .description("back the object cache with huge pages: none, transparent or explicit (default: none)")
+            .metavar("mode").as_string(&huge_pages);
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() != 0)
+    {
+        std::cerr << "command takes no positional arguments\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (threads <= 0 || objects <= 0 || value_size < 0 || searches < 0 ||
+        search_width <= 0 || indexes < 0 || indexes > BENCH_INT_ATTRS ||
+        write_buffer <= 0 || bloom_bits < 0 || block_cache < 0 || object_cache < 0)
+    {
+        std::cerr << "an option is out of range" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (!hyperdex::huge_pages::configure(huge_pages))
+    {
+        std::cerr << "cannot interpret huge page mode \"" << huge_pages << "\"" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    google::InitGoogleLogging(argv[0]);
+    google::LogToStderr();
+    t.write_buffer_size = write_buffer;
+    t.bloom_bits = bloom_bits;
+    t.block_cache_size = block_cache;
+    t.object_cache_size = object_cache;
+    t.compression = !no_compression;
+    hyperdex::datalayer_bench b;
+    b.threads = threads;
+    b.objects = objects;
+    b.value_size = value_size;
+    b.searches = searches;
+    b.search_width = search_width;
+
+    if (!b.setup(dir, t, indexes))
+    {
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "objects=" << objects << " value_size=" << value_size
+              << " indexes=" << indexes << " threads=" << threads
+              << " write_buffer=" << write_buffer << " bloom_bits=" << bloom_bits
+              << " block_cache=" << block_cache << " object_cache=" << object_cache
+              << " compression=" << (no_compression ? "no" : "yes")
+              << " huge_pages=" << huge_pages << std::endl;
+
+    for (int p = 0; p < hyperdex::datalayer_bench::PHASES; ++p)
+    {
+        b.run_phase(static_cast<hyperdex::datalayer_bench::phase_t>(p));
+    }
+
+    b.teardown();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,636 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// Time the datatype layer in isolation: every datatype_info operation, each
+// funcall over containers of growing size, the ordered encodings, hashing and
+// attribute checks.  The output is JSON with one benchmark per line in a fixed
+// order so that runs from two commits can be diffed or compared by a script.
+
+// C
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+// STL
+#include <iostream>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/time.h>
+
+// e
+#include <e/arena.h>
+#include <e/endian.h>
+#include <e/popt.h>
+
+// HyperDex
+#include "common/attribute_check.h"
+#include "common/datatype_info.h"
+#include "common/funcall.h"
+#include "common/hash.h"
+#include "common/ordered_encoding.h"
+#include "common/schema.h"
+
+using hyperdex::attribute;
+using hyperdex::attribute_check;
+using hyperdex::compiled_attribute_check;
+using hyperdex::datatype_info;
+using hyperdex::funcall;
+using hyperdex::funcall_t;
+using hyperdex::schema;
+
+static long _min_time_ms = 200;
+static const char* _filter = "";
+// keeps the compiler from discarding the work being timed
+static volatile uint64_t _sink = 0;
+
+namespace
+{
+
+enum bench_kind
+{
+    VALIDATE,
+    COMPARE,
+    HASH,
+    LENGTH,
+    CONTAINS,
+    APPLY,
+    ENCODE_INT64,
+    ENCODE_DOUBLE,
+    DECODE_INT64,
+    HASH_OBJECT,
+    CHECKS,
+    CHECKS_COMPILED
+};
+
+// One benchmark.  Only the fields its kind uses are filled in.
+struct bench
+{
+    bench(const std::string& n, bench_kind k)
+        : name(n), kind(k), di(NULL), lhs(), rhs(), funcs()
+        , sc(NULL), checks(), compiled(), key(), values() {}
+
+    uint64_t run(uint64_t iters) const;
+
+    std::string name;
+    bench_kind kind;
+    datatype_info* di;
+    std::string lhs;
+    std::string rhs;
+    std::vector<funcall> funcs;
+    const schema* sc;
+    std::vector<attribute_check> checks;
+    std::vector<compiled_attribute_check> compiled;
+    std::string key;
+    std::vector<e::slice> values;
+};
+
+uint64_t
+bench :: run(uint64_t iters) const
+{
+    e::slice l(lhs);
+    e::slice r(rhs);
+    uint64_t acc = 0;
+
+    switch (kind)
+    {
+        case VALIDATE:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                acc += di->validate(l) ? 1 : 0;
+            }
+            break;
+        case COMPARE:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                acc += di->compare(l, r);
+            }
+            break;
+        case HASH:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                acc += di->hash(l);
+            }
+            break;
+        case LENGTH:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                acc += di->length(l);
+            }
+            break;
+        case CONTAINS:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                acc += di->contains(l, r) ? 1 : 0;
+            }
+            break;
+        case APPLY:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                // a fresh arena per call, as the daemon has per operation
+                e::arena memory;
+                e::slice out;
+
+                if (di->apply(l, &funcs[0], funcs.size(), &memory, &out))
+                {
+                    acc += out.size();
+                }
+            }
+            break;
+        case ENCODE_INT64:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                acc += hyperdex::ordered_encode_int64(static_cast<int64_t>(i) - 1000000);
+            }
+            break;
+        case ENCODE_DOUBLE:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                acc += hyperdex::ordered_encode_double(static_cast<double>(i) * 0.5 - 1e6);
+            }
+            break;
+        case DECODE_INT64:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                acc += hyperdex::ordered_decode_int64(i * 0x9e3779b97f4a7c15ULL);
+            }
+            break;
+        case HASH_OBJECT:
+        {
+            std::vector<uint64_t> hs(sc->attrs_sz);
+
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                hyperdex::hash(*sc, e::slice(key), values, &hs[0]);
+                acc += hs[0] ^ hs[hs.size() - 1];
+            }
+            break;
+        }
+        case CHECKS:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                acc += hyperdex::passes_attribute_checks(*sc, checks, e::slice(key), values);
+            }
+            break;
+        case CHECKS_COMPILED:
+            for (uint64_t i = 0; i < iters; ++i)
+            {
+                acc += hyperdex::passes_attribute_checks(*sc, checks, compiled, e::slice(key), values);
+            }
+            break;
+        default:
+            abort();
+    }
+
+    return acc;
+}
+
+std::string
+pack_int64(int64_t x)
+{
+    char buf[sizeof(int64_t)];
+    e::pack64le(x, buf);
+    return std::string(buf, sizeof(buf));
+}
+
+std::string
+pack_double(double x)
+{
+    char buf[sizeof(double)];
+    e::packdoublele(x, buf);
+    return std::string(buf, sizeof(buf));
+}
+
+// the i'th string element; zero padding keeps them in sorted order
+std::string
+string_elem(uint64_t i)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "element%010llu", static_cast<unsigned long long>(i));
+    return std::string(buf);
+}
+
+// a string as it appears inside a container
+std::string
+contained(const std::string& s)
+{
+    char buf[sizeof(uint32_t)];
+    e::pack32le(s.size(), buf);
+    return std::string(buf, sizeof(buf)) + s;
+}
+
+// The i'th element of a container of strings or int64s, bare and in its
+// encoded form.  Containers are built from the even elements so that odd ones
+// are known to be absent.
+std::string
+elem(hyperdatatype t, uint64_t i)
+{
+    return t == HYPERDATATYPE_STRING ? string_elem(i) : pack_int64(i);
+}
+
+std::string
+encoded(hyperdatatype t, uint64_t i)
+{
+    return t == HYPERDATATYPE_STRING ? contained(string_elem(i)) : pack_int64(i);
+}
+
+std::string
+container(hyperdatatype t, uint64_t n, uint64_t offset)
+{
+    std::string out;
+
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        out += encoded(t, 2 * i + offset);
+    }
+
+    return out;
+}
+
+// map from string to int64
+std::string
+string_int64_map(uint64_t n)
+{
+    std::string out;
+
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        out += contained(string_elem(2 * i)) + pack_int64(i);
+    }
+
+    return out;
+}
+
+funcall
+make_func(funcall_t name,
+          const std::string& arg1, hyperdatatype arg1_datatype,
+          const std::string& arg2 = std::string(),
+          hyperdatatype arg2_datatype = HYPERDATATYPE_GARBAGE)
+{
+    funcall f;
+    f.attr = 1;
+    f.name = name;
+    f.arg1 = e::slice(arg1);
+    f.arg1_datatype = arg1_datatype;
+    f.arg2 = arg2.empty() ? e::slice() : e::slice(arg2);
+    f.arg2_datatype = arg2_datatype;
+    return f;
+}
+
+// funcalls point at their arguments, so the benchmarks keep the arguments
+// alive here for as long as they run
+std::vector<std::string*> _args;
+
+const std::string&
+keep(const std::string& s)
+{
+    _args.push_back(new std::string(s));
+    return *_args.back();
+}
+
+bench*
+value_bench(const std::string& name, bench_kind kind, hyperdatatype t,
+            const std::string& lhs, const std::string& rhs = std::string())
+{
+    bench* b = new bench(name, kind);
+    b->di = datatype_info::lookup(t);
+    b->lhs = lhs;
+    b->rhs = rhs;
+    return b;
+}
+
+bench*
+apply_bench(const std::string& name, hyperdatatype t,
+            const std::string& old_value, const funcall& f)
+{
+    bench* b = value_bench(name, APPLY, t, old_value);
+    b->funcs.push_back(f);
+    return b;
+}
+
+std::string
+sized(const std::string& name, uint64_t n)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), "/%llu", static_cast<unsigned long long>(n));
+    return name + buf;
+}
+
+void
+primitive_benches(std::vector<bench*>* bs)
+{
+    const std::string s64(64, 'x');
+    const std::string s64b = s64.substr(0, 63) + "y";
+    bs->push_back(value_bench("string/validate/64", VALIDATE, HYPERDATATYPE_STRING, s64));
+    bs->push_back(value_bench("string/compare/64", COMPARE, HYPERDATATYPE_STRING, s64, s64b));
+    bs->push_back(value_bench("string/hash/64", HASH, HYPERDATATYPE_STRING, s64));
+    bs->push_back(apply_bench("string/apply/set/64", HYPERDATATYPE_STRING, s64,
+                              make_func(hyperdex::FUNC_SET, keep(s64b), HYPERDATATYPE_STRING)));
+    bs->push_back(apply_bench("string/apply/append/64", HYPERDATATYPE_STRING, s64,
+                              make_func(hyperdex::FUNC_STRING_APPEND, keep(std::string(16, 'z')), HYPERDATATYPE_STRING)));
+    bs->push_back(apply_bench("string/apply/prepend/64", HYPERDATATYPE_STRING, s64,
+                              make_func(hyperdex::FUNC_STRING_PREPEND, keep(std::string(16, 'z')), HYPERDATATYPE_STRING)));
+
+    const std::string i1 = pack_int64(0x0123456789abcdefLL);
+    const std::string i2 = pack_int64(42);
+    bs->push_back(value_bench("int64/validate", VALIDATE, HYPERDATATYPE_INT64, i1));
+    bs->push_back(value_bench("int64/compare", COMPARE, HYPERDATATYPE_INT64, i1, i2));
+    bs->push_back(value_bench("int64/hash", HASH, HYPERDATATYPE_INT64, i1));
+    bs->push_back(apply_bench("int64/apply/add", HYPERDATATYPE_INT64, i1,
+                              make_func(hyperdex::FUNC_NUM_ADD, keep(i2), HYPERDATATYPE_INT64)));
+    bs->push_back(apply_bench("int64/apply/mul", HYPERDATATYPE_INT64, i2,
+                              make_func(hyperdex::FUNC_NUM_MUL, keep(i2), HYPERDATATYPE_INT64)));
+    bs->push_back(apply_bench("int64/apply/xor", HYPERDATATYPE_INT64, i1,
+                              make_func(hyperdex::FUNC_NUM_XOR, keep(i2), HYPERDATATYPE_INT64)));
+
+    const std::string f1 = pack_double(3.14159);
+    const std::string f2 = pack_double(2.71828);
+    bs->push_back(value_bench("float/validate", VALIDATE, HYPERDATATYPE_FLOAT, f1));
+    bs->push_back(value_bench("float/compare", COMPARE, HYPERDATATYPE_FLOAT, f1, f2));
+    bs->push_back(value_bench("float/hash", HASH, HYPERDATATYPE_FLOAT, f1));
+    bs->push_back(apply_bench("float/apply/add", HYPERDATATYPE_FLOAT, f1,
+                              make_func(hyperdex::FUNC_NUM_ADD, keep(f2), HYPERDATATYPE_FLOAT)));
+    bs->push_back(apply_bench("float/apply/div", HYPERDATATYPE_FLOAT, f1,
+                              make_func(hyperdex::FUNC_NUM_DIV, keep(f2), HYPERDATATYPE_FLOAT)));
+
+    const std::string ts1 = pack_int64(1400000000LL * 1000000LL);
+    const std::string ts2 = pack_int64(1400000060LL * 1000000LL);
+    bs->push_back(value_bench("timestamp(second)/validate", VALIDATE, HYPERDATATYPE_TIMESTAMP_SECOND, ts1));
+    bs->push_back(value_bench("timestamp(second)/compare", COMPARE, HYPERDATATYPE_TIMESTAMP_SECOND, ts1, ts2));
+    bs->push_back(value_bench("timestamp(second)/hash", HASH, HYPERDATATYPE_TIMESTAMP_SECOND, ts1));
+
+    // the empty object in treadstone's binary encoding
+    bs->push_back(value_bench("document/validate/empty", VALIDATE, HYPERDATATYPE_DOCUMENT, std::string("\x40\x00", 2)));
+}
+
+void
+container_benches(uint64_t n, std::vector<bench*>* bs)
+{
+    const hyperdatatype elems[] = {HYPERDATATYPE_STRING, HYPERDATATYPE_INT64};
+    const char* elem_names[] = {"string", "int64"};
+
+    for (size_t i = 0; i < sizeof(elems) / sizeof(elems[0]); ++i)
+    {
+        hyperdatatype et = elems[i];
+        std::string en(elem_names[i]);
+        std::string value = container(et, n, 0);
+        std::string others = container(et, n, 1);
+        // present at the very end, absent from the middle
+        std::string last = elem(et, 2 * (n - 1));
+        std::string absent = elem(et, 2 * (n / 2) + 1);
+        std::string middle = elem(et, 2 * (n / 2));
+
+        hyperdatatype lt = CREATE_CONTAINER(HYPERDATATYPE_LIST_GENERIC, et);
+        std::string ln = "list(" + en + ")/";
+        bs->push_back(value_bench(sized(ln + "validate", n), VALIDATE, lt, value));
+        bs->push_back(value_bench(sized(ln + "length", n), LENGTH, lt, value));
+        bs->push_back(value_bench(sized(ln + "contains", n), CONTAINS, lt, value, last));
+        bs->push_back(apply_bench(sized(ln + "apply/set", n), lt, value,
+                                  make_func(hyperdex::FUNC_SET, keep(others), lt)));
+        bs->push_back(apply_bench(sized(ln + "apply/lpush", n), lt, value,
+                                  make_func(hyperdex::FUNC_LIST_LPUSH, keep(absent), et)));
+        bs->push_back(apply_bench(sized(ln + "apply/rpush", n), lt, value,
+                                  make_func(hyperdex::FUNC_LIST_RPUSH, keep(absent), et)));
+
+        hyperdatatype st = CREATE_CONTAINER(HYPERDATATYPE_SET_GENERIC, et);
+        std::string sn = "set(" + en + ")/";
+        bs->push_back(value_bench(sized(sn + "validate", n), VALIDATE, st, value));
+        bs->push_back(value_bench(sized(sn + "length", n), LENGTH, st, value));
+        bs->push_back(value_bench(sized(sn + "contains", n), CONTAINS, st, value, last));
+        bs->push_back(apply_bench(sized(sn + "apply/add", n), st, value,
+                                  make_func(hyperdex::FUNC_SET_ADD, keep(absent), et)));
+        bs->push_back(apply_bench(sized(sn + "apply/remove", n), st, value,
+                                  make_func(hyperdex::FUNC_SET_REMOVE, keep(middle), et)));
+        bs->push_back(apply_bench(sized(sn + "apply/union", n), st, value,
+                                  make_func(hyperdex::FUNC_SET_UNION, keep(others), st)));
+        bs->push_back(apply_bench(sized(sn + "apply/intersect", n), st, value,
+                                  make_func(hyperdex::FUNC_SET_INTERSECT, keep(value), st)));
+    }
+
+    hyperdatatype mt = HYPERDATATYPE_MAP_STRING_INT64;
+    std::string mn = "map(string,int64)/";
+    std::string m = string_int64_map(n);
+    bs->push_back(value_bench(sized(mn + "validate", n), VALIDATE, mt, m));
+    bs->push_back(value_bench(sized(mn + "length", n), LENGTH, mt, m));
+    bs->push_back(value_bench(sized(mn + "contains", n), CONTAINS, mt, m, string_elem(2 * (n - 1))));
+    bs->push_back(apply_bench(sized(mn + "apply/add", n), mt, m,
+                              make_func(hyperdex::FUNC_MAP_ADD,
+                                        keep(pack_int64(7)), HYPERDATATYPE_INT64,
+                                        keep(string_elem(2 * (n / 2) + 1)), HYPERDATATYPE_STRING)));
+    bs->push_back(apply_bench(sized(mn + "apply/remove", n), mt, m,
+                              make_func(hyperdex::FUNC_MAP_REMOVE,
+                                        keep(string_elem(2 * (n / 2))), HYPERDATATYPE_STRING)));
+    bs->push_back(apply_bench(sized(mn + "apply/num_add", n), mt, m,
+                              make_func(hyperdex::FUNC_NUM_ADD,
+                                        keep(pack_int64(7)), HYPERDATATYPE_INT64,
+                                        keep(string_elem(2 * (n / 2))), HYPERDATATYPE_STRING)));
+}
+
+// The schema and object the hashing and attribute check benchmarks share: a
+// string key and a string, an int64 and a float attribute.
+attribute _attrs[] = {attribute("k", HYPERDATATYPE_STRING),
+                      attribute("name", HYPERDATATYPE_STRING),
+                      attribute("age", HYPERDATATYPE_INT64),
+                      attribute("score", HYPERDATATYPE_FLOAT)};
+
+void
+object_benches(std::vector<bench*>* bs)
+{
+    static schema sc;
+    sc.attrs_sz = sizeof(_attrs) / sizeof(_attrs[0]);
+    sc.attrs = _attrs;
+    const std::string& name = keep("alice liddell");
+    const std::string& age = keep(pack_int64(30));
+    const std::string& score = keep(pack_double(0.75));
+    std::vector<e::slice> values;
+    values.push_back(e::slice(name));
+    values.push_back(e::slice(age));
+    values.push_back(e::slice(score));
+
+    bench* h = new bench("object/hash", HASH_OBJECT);
+    h->sc = &sc;
+    h->key = "user:0000000042";
+    h->values = values;
+    bs->push_back(h);
+
+    const std::string& lo = keep(pack_int64(18));
+    const std::string& hi = keep(pack_int64(65));
+    const std::string& re = keep("^al");
+    const std::string& min = keep(pack_double(0.5));
+    attribute_check c;
+    std::vector<attribute_check> checks;
+    c.attr = 2;
+    c.value = e::slice(lo);
+    c.datatype = HYPERDATATYPE_INT64;
+    c.predicate = HYPERPREDICATE_GREATER_EQUAL;
+    checks.push_back(c);
+    c.value = e::slice(hi);
+    c.predicate = HYPERPREDICATE_LESS_THAN;
+    checks.push_back(c);
+    c.attr = 1;
+    c.value = e::slice(re);
+    c.datatype = HYPERDATATYPE_STRING;
+    c.predicate = HYPERPREDICATE_REGEX;
+    checks.push_back(c);
+    c.attr = 3;
+    c.value = e::slice(min);
+    c.datatype = HYPERDATATYPE_FLOAT;
+    c.predicate = HYPERPREDICATE_GREATER_THAN;
+    checks.push_back(c);
+
+    const char* names[] = {"checks/passes", "checks/passes_compiled"};
+    bench_kind kinds[] = {CHECKS, CHECKS_COMPILED};
+
+    for (size_t i = 0; i < 2; ++i)
+    {
+        bench* b = new bench(names[i], kinds[i]);
+        b->sc = &sc;
+        b->checks = checks;
+        b->key = h->key;
+        b->values = values;
+
+        if (kinds[i] == CHECKS_COMPILED)
+        {
+            hyperdex::compile_attribute_checks(sc, b->checks, &b->compiled);
+        }
+
+        bs->push_back(b);
+    }
+}
+
+// Run b in doubling batches until a batch takes at least the minimum time;
+// report that batch
+void
+measure(const bench& b, bool first)
+{
+    const uint64_t min_ns = static_cast<uint64_t>(_min_time_ms) * 1000000ULL;
+    uint64_t iters = 1;
+    uint64_t elapsed = 0;
+
+    // one untimed pass to warm the caches and the allocator
+    _sink += b.run(1);
+
+    while (true)
+    {
+        uint64_t start = po6::monotonic_time();
+        _sink += b.run(iters);
+        elapsed = po6::monotonic_time() - start;
+
+        if (elapsed >= min_ns || iters >= (1ULL << 40))
+        {
+            break;
+        }
+
+        iters *= 2;
+    }
+
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.3f", static_cast<double>(elapsed) / iters);
+    std::cout << (first ? "" : ",\n")
+              << "    {\"name\": \"" << b.name << "\", "
+              << "\"iterations\": " << iters << ", "
+              << "\"ns_per_op\": " << buf << "}";
+}
+
+} // namespace
+
+int
+main(int argc, const char* argv[])
+{
+    e::argparser ap;
+    ap.autohelp();
+    ap.arg().name('t', "min-time")
+            .description("run each benchmark for at least this many milliseconds (default: 200)")
+            .metavar("ms").as_long(&_min_time_ms);
+    ap.arg().name('f', "filter")
+            .description("only run benchmarks whose name contains this string")
+            .metavar("substr").as_string(&_filter);
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() != 0)
+    {
+        std::cerr << "command takes no positional arguments\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (_min_time_ms <= 0)
+    {
+        std::cerr << "the minimum time must be positive" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<bench*> bs;
+    primitive_benches(&bs);
+    const uint64_t sizes[] = {1, 16, 256, 4096};
+
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        container_benches(sizes[i], &bs);
+    }
+
+    bs.push_back(new bench("ordered_encoding/encode_int64", ENCODE_INT64));
+    bs.push_back(new bench("ordered_encoding/decode_int64", DECODE_INT64));
+    bs.push_back(new bench("ordered_encoding/encode_double", ENCODE_DOUBLE));
+    object_benches(&bs);
+
+    std::cout << "{\n  \"benchmarks\": [\n";
+    bool first = true;
+
+    for (size_t i = 0; i < bs.size(); ++i)
+    {
+        if (bs[i]->name.find(_filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        measure(*bs[i], first);
+        first = false;
+        std::cout << std::flush;
+    }
+
+    std::cout << "\n  ]\n}" << std::endl;
+
+    for (size_t i = 0; i < bs.size(); ++i)
+    {
+        delete bs[i];
+    }
+
+    for (size_t i = 0; i < _args.size(); ++i)
+    {
+        delete _args[i];
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+# Copyright (c) 2015, Cornell University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+#     * Redistributions of source code must retain the above copyright notice,
+#       this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the name of HyperDex nor the names of its contributors may be
+#       used to endorse or promote products derived from this software without
+#       specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+'''Check that a daemon refills its replicas of a memory space after a restart.
+
+Loads a space created "with durability memory" onto two daemons, restarts one
+of them, and waits for the cluster to be stable.  It then kills the other
+daemon and reads every object back from the restarted one alone.  A daemon
+that served the empty replica it came back with would return none of them.
+Runs once with a clean shutdown (SIGTERM) and once with a crash (SIGKILL).
+'''
+
+from __future__ import absolute_import
+from __future__ import print_function
+from __future__ import with_statement
+
+
+import os
+import os.path
+import re
+import signal
+import subprocess
+import sys
+import time
+
+sys.path.append(os.path.dirname(os.path.abspath(__file__)))
+
+
+import argparse
+
+import hyperdex.admin
+import hyperdex.client
+import runner
+
+
+SERVER = re.compile(r'^server (\d+) (\S+) (\S+)$', re.MULTILINE)
+
+
+def server_id(adm, port):
+    for sid, bind_to, state in SERVER.findall(adm.dump_config()):
+        if bind_to.endswith(':%d' % port):
+            return sid
+    raise RuntimeError('no server is bound to port %d' % port)
+
+
+def value(i):
+    return 'value-%d' % i
+
+
+def missing(c, objects, timeout):
+    '''The objects not read back before "timeout" seconds pass; reads that
+    race with a new configuration are retried.'''
+    left = set(range(objects))
+    deadline = time.time() + timeout
+    while left and time.time() < deadline:
+        for i in sorted(left):
+            try:
+                if c.get('cache', i) == {'v': value(i)}:
+                    left.remove(i)
+            except hyperdex.client.HyperDexClientException:
+                pass
+        if left:
+            time.sleep(0.5)
+    return sorted(left)
+
+
+def run(args, sig):
+    hdc = runner.HyperDexCluster(1, 2, clean=True)
+    try:
+        hdc.setup()
+        time.sleep(1)
+        adm = hyperdex.admin.Admin('127.0.0.1', 1982)
+        adm.add_space('space cache key int k attributes string v '
+                      'create %d partitions tolerate 1 failures '
+                      'with durability memory' % args.partitions)
+        adm.wait_until_stable()
+        c = hyperdex.client.Client('127.0.0.1', 1982)
+        for i in range(args.objects):
+            assert c.put('cache', i, {'v': value(i)})
+
+        hdc.restart_daemon(1, sig)
+        time.sleep(1)
+        adm.wait_until_stable()
+
+        sid = server_id(adm, 2012)
+        proc = hdc.processes[hdc.coordinators]
+        proc.send_signal(signal.SIGKILL)
+        proc.wait()
+        subprocess.check_call(['hyperdex', 'server-kill', '-h', '127.0.0.1', '-p', '1982', sid])
+
+        lost = missing(c, args.objects, args.timeout)
+        if lost:
+            print('restart with signal %d lost %d of %d objects, e.g. %r' %
+                  (sig, len(lost), args.objects, lost[:10]))
+            hdc.log_output = True
+            return 1
+        print('restart with signal %d kept all %d objects' % (sig, args.objects))
+        return 0
+    except:
+        hdc.log_output = True
+        raise
+    finally:
+        hdc.cleanup()
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--objects', default=1000, type=int,
+                        help='put this many objects before the restart (default: 1000)')
+    parser.add_argument('--partitions', default=4, type=int,
+                        help='create the space with this many partitions (default: 4)')
+    parser.add_argument('--timeout', default=30, type=float,
+                        help='seconds to keep reading back objects (default: 30)')
+    args = parser.parse_args(argv)
+    status = 0
+    for sig in (signal.SIGTERM, signal.SIGKILL):
+        status = run(args, sig) or status
+    return status
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
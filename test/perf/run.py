@@ -0,0 +1,344 @@
+# Copyright (c) 2015, Cornell University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+#     * Redistributions of source code must retain the above copyright notice,
+#       this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the name of HyperDex nor the names of its contributors may be
+#       used to endorse or promote products derived from this software without
+#       specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+'''Run the performance suites and compare them with stored baselines.
+
+Each suite runs --repeat times.  The median of a metric's samples is its
+value and the median absolute deviation, relative to the median, is its
+noise.  A metric has regressed when it moved in its worse direction by more
+than the larger of --threshold and --sigmas times the noise of the baseline
+or of this run, whichever is noisier; so a metric that is noisy on this
+machine needs a bigger change before it counts, and a steady one is held to
+--threshold.  Metrics without a baseline are reported as new.
+
+The suites are:
+
+    datatype     test/datatype-microbench
+    client       test/client-microbench
+    datalayer    test/datalayer-bench on a scratch directory, and its reads
+                 again through an object cache with and without huge pages
+    coordinator  test/coordinator-bench at a small scale
+    cluster      "hyperdex bench" and "hyperdex search-bench" against a one
+                 coordinator, three daemon local cluster
+
+The report is JSON, written to --report (default: stdout), and the exit
+status is 1 when anything regressed.  --update-baselines stores this run's
+values as the new baselines instead; commit the result along with the change
+that justifies it.
+'''
+
+from __future__ import absolute_import
+from __future__ import print_function
+from __future__ import unicode_literals
+from __future__ import with_statement
+
+
+import json
+import os
+import os.path
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.append(os.path.join(HERE, '..'))
+
+
+import argparse
+
+import runner
+
+
+BASELINES = os.path.join(HERE, 'baselines.json')
+LOWER = 'lower'
+HIGHER = 'higher'
+
+
+def environment():
+    env = dict(os.environ)
+    env['PATH'] = runner.BUILDDIR + ':' + (env.get('PATH') or '')
+    if runner.BUILDDIR != runner.DOTDOT:
+        env['HYPERDEX_EXEC_PATH'] = runner.BUILDDIR
+        env['HYPERDEX_COORD_LIB'] = os.path.join(runner.BUILDDIR, '.libs/libhyperdex-coordinator')
+    return env
+
+
+def execute(cmd):
+    return subprocess.check_output(cmd, env=environment()).decode('utf-8')
+
+
+def program(name):
+    return os.path.join(runner.BUILDDIR, 'test', name)
+
+
+def fields(line):
+    '''The key=value pairs of a line, with numeric values as floats.'''
+    out = {}
+    for key, value in re.findall(r'(\S+?)=\s*([-+0-9.eE]+)', line):
+        try:
+            out[key] = float(value)
+        except ValueError:
+            pass
+    return out
+
+
+def datatype_suite(args):
+    report = json.loads(execute([program('datatype-microbench'), '--min-time', '200']))
+    for b in report['benchmarks']:
+        yield 'datatype/' + b['name'], b['ns_per_op'], 'ns/op', LOWER
+
+
+def client_suite(args):
+    report = json.loads(execute([program('client-microbench'), '--min-time', '200']))
+    for b in report['benchmarks']:
+        yield 'client/' + b['name'], b['ns_per_op'], 'ns/op', LOWER
+
+
+def datalayer_suite(args):
+    scratch = tempfile.mkdtemp(prefix='hyperdex-perf-')
+    try:
+        output = execute([program('datalayer-bench'), '-D', os.path.join(scratch, 'data'),
+                          '-n', '20000', '-t', '2', '--searches', '200'])
+    finally:
+        shutil.rmtree(scratch)
+    for line in output.splitlines():
+        words = line.split()
+        if not words or words[0] not in ('put', 'get', 'overput', 'search', 'del'):
+            continue
+        f = fields(line)
+        name = 'datalayer/' + words[0]
+        yield name + '/throughput', f['ops/s'], 'ops/s', HIGHER
+        yield name + '/p99', f['p99'], 'us', LOWER
+        if 'write_amp' in f:
+            yield name + '/write_amp', f['write_amp'], 'ratio', LOWER
+    for mode in ('none', 'transparent'):
+        scratch = tempfile.mkdtemp(prefix='hyperdex-perf-')
+        try:
+            output = execute([program('datalayer-bench'), '-D', os.path.join(scratch, 'data'),
+                              '-n', '20000', '-t', '2', '--searches', '0',
+                              '--object-cache', str(256 * 1024 * 1024),
+                              '--huge-pages', mode])
+        finally:
+            shutil.rmtree(scratch)
+        for line in output.splitlines():
+            words = line.split()
+            if not words or words[0] != 'get':
+                continue
+            f = fields(line)
+            name = 'datalayer/get-cached-huge-pages-' + mode
+            yield name + '/p50', f['p50'], 'us', LOWER
+            yield name + '/p99', f['p99'], 'us', LOWER
+
+
+def coordinator_suite(args):
+    output = execute([program('coordinator-bench'), '-s', '100', '-S', '10', '-P', '100'])
+    for line in output.splitlines():
+        words = line.split()
+        # scale transition count mean max total config
+        if len(words) != 7 or words[0] == 'scale':
+            continue
+        name = 'coordinator/' + words[1]
+        yield name + '/mean', float(words[3]), 'us', LOWER
+        yield name + '/config', float(words[6]), 'bytes', LOWER
+
+
+def cluster_suite(args):
+    hdc = runner.HyperDexCluster(1, 3, clean=True)
+    try:
+        hdc.setup()
+        time.sleep(1)
+        import hyperdex.admin
+        adm = hyperdex.admin.Admin('127.0.0.1', 1982)
+        adm.add_space('space perf key k attributes v, int count '
+                      'create 8 partitions tolerate 1 failures')
+        adm.wait_until_stable()
+        output = execute(['hyperdex', 'bench', '-h', '127.0.0.1', '-p', '1982',
+                          '--load', '-n', '10000', '-d', '5', '-t', '2',
+                          '-m', 'read=50,update=50', 'perf'])
+        op = None
+        for line in output.splitlines():
+            f = fields(line)
+            if line.startswith('ops='):
+                yield 'cluster/bench/throughput', f.get('throughput', 0), 'ops/s', HIGHER
+            elif line[:1].isalpha() and 'count' in f:
+                op = line.split()[0]
+            elif op and line.split()[:1] == ['latency']:
+                yield 'cluster/bench/%s/p50' % op, f['p50'], 'us', LOWER
+                yield 'cluster/bench/%s/p99' % op, f['p99'], 'us', LOWER
+        output = execute(['hyperdex', 'search-bench', '-h', '127.0.0.1', '-p', '1982',
+                          '-n', '10000', '-i', 'sel', '-S', '0.001,0.1', '-q', '20'])
+        selectivity = None
+        for line in output.splitlines():
+            m = re.match(r'^selectivity=(\S+)%', line)
+            if m:
+                selectivity = m.group(1)
+                continue
+            words = line.split()
+            if selectivity and words and words[0] in ('search', 'count', 'sorted_search'):
+                yield ('cluster/search/%s/%s/p50' % (selectivity, words[0]),
+                       fields(line)['p50'], 'us', LOWER)
+    except:
+        hdc.log_output = True
+        raise
+    finally:
+        hdc.cleanup()
+
+
+SUITES = [('datatype', datatype_suite),
+          ('client', client_suite),
+          ('datalayer', datalayer_suite),
+          ('coordinator', coordinator_suite),
+          ('cluster', cluster_suite)]
+
+
+def median(xs):
+    xs = sorted(xs)
+    n = len(xs)
+    if n % 2:
+        return xs[n // 2]
+    return (xs[n // 2 - 1] + xs[n // 2]) / 2.
+
+
+def noise(xs):
+    '''Median absolute deviation relative to the median.'''
+    m = median(xs)
+    if m == 0:
+        return 0.
+    return median([abs(x - m) for x in xs]) / abs(m)
+
+
+def compare(args, name, metric, baselines):
+    samples = metric['samples']
+    value = median(samples)
+    spread = noise(samples)
+    out = {'name': name, 'unit': metric['unit'], 'better': metric['better'],
+           'value': value, 'noise': spread, 'samples': samples}
+    base = baselines.get(name)
+    if base is None:
+        out['status'] = 'new'
+        return out
+    out['baseline'] = base['value']
+    if base['value'] == 0:
+        change = 0. if value == 0 else float('inf')
+    else:
+        change = (value - base['value']) / abs(base['value'])
+    if metric['better'] == HIGHER:
+        change = -change
+    # positive change is worse from here on
+    allowed = max(args.threshold, args.sigmas * max(spread, base.get('noise', 0.)))
+    out['change'] = change
+    out['allowed'] = allowed
+    if change > allowed:
+        out['status'] = 'regressed'
+    elif change < -allowed:
+        out['status'] = 'improved'
+    else:
+        out['status'] = 'ok'
+    return out
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--suites', default=','.join(s for s, _ in SUITES),
+                        help='comma-separated suites to run (default: all)')
+    parser.add_argument('--repeat', default=3, type=int,
+                        help='run each suite this many times (default: 3)')
+    parser.add_argument('--threshold', default=0.10, type=float,
+                        help='smallest relative change that counts (default: 0.10)')
+    parser.add_argument('--sigmas', default=3., type=float,
+                        help='changes within this many times the noise do not count (default: 3)')
+    parser.add_argument('--baselines', default=BASELINES,
+                        help='read baselines from this file (default: test/perf/baselines.json)')
+    parser.add_argument('--report', default=None,
+                        help='write the JSON report to this file (default: stdout)')
+    parser.add_argument('--update-baselines', action='store_true',
+                        help='store this run as the new baselines instead of comparing')
+    args = parser.parse_args(argv)
+    wanted = [s for s in args.suites.split(',') if s]
+    known = dict(SUITES)
+    for s in wanted:
+        if s not in known:
+            parser.error('unknown suite %r' % s)
+    if args.repeat < 1:
+        parser.error('--repeat must be positive')
+
+    with open(args.baselines) as fin:
+        stored = json.load(fin)
+    baselines = stored.get('metrics', {})
+
+    metrics = {}
+    failed = []
+    for suite in wanted:
+        for i in range(args.repeat):
+            try:
+                for name, value, unit, better in known[suite](args):
+                    m = metrics.setdefault(name, {'unit': unit, 'better': better, 'samples': []})
+                    m['samples'].append(value)
+            except (OSError, subprocess.CalledProcessError, KeyError, ValueError) as e:
+                failed.append({'suite': suite, 'run': i, 'error': str(e)})
+                break
+
+    if args.update_baselines:
+        updated = dict(baselines)
+        for name, m in metrics.items():
+            updated[name] = {'value': median(m['samples']), 'noise': noise(m['samples']),
+                             'unit': m['unit'], 'better': m['better']}
+        stored['metrics'] = updated
+        with open(args.baselines, 'w') as fout:
+            json.dump(stored, fout, indent=2, sort_keys=True)
+            fout.write('\n')
+
+    results = [compare(args, name, metrics[name], baselines) for name in sorted(metrics)]
+    missing = sorted(n for n in baselines if n.split('/')[0] in wanted and n not in metrics)
+    counts = {}
+    for r in results:
+        counts[r['status']] = counts.get(r['status'], 0) + 1
+    report = {'suites': wanted, 'repeat': args.repeat,
+              'threshold': args.threshold, 'sigmas': args.sigmas,
+              'summary': counts, 'failed': failed, 'missing': missing,
+              'metrics': results}
+    text = json.dumps(report, indent=2, sort_keys=True) + '\n'
+    if args.report:
+        with open(args.report, 'w') as fout:
+            fout.write(text)
+    else:
+        sys.stdout.write(text)
+    for r in results:
+        if r['status'] in ('regressed', 'improved'):
+            sys.stderr.write('%-9s %s: %s -> %s %s (%+.1f%%, allowed %.1f%%)\n' %
+                             (r['status'], r['name'], r['baseline'], r['value'], r['unit'],
+                              100 * r['change'], 100 * r['allowed']))
+    if args.update_baselines:
+        return 1 if failed else 0
+    return 1 if failed or counts.get('regressed') else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
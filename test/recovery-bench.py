@@ -0,0 +1,280 @@
+# Copyright (c) 2015, Cornell University
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#
+#     * Redistributions of source code must retain the above copyright notice,
+#       this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the name of HyperDex nor the names of its contributors may be
+#       used to endorse or promote products derived from this software without
+#       specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+# AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+# DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE
+# FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+# DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+# SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+# CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+# OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+'''Measure how long a cluster takes to recover from losing a server.
+
+Loads a space with --gigabytes of data, kills one daemon and declares it dead
+with "hyperdex server-kill", then times how long "hyperdex wait-until-stable"
+takes to return, i.e. how long state transfer takes to restore the space's
+fault tolerance.  While it waits it prints, once a second, the bytes state
+transfer acknowledged in that second and the latency a rate-limited
+foreground workload saw, so that the cost of recovery to clients shows up
+alongside its speed.  With --max-recovery it fails when recovery is slower,
+which makes it an acceptance test for changes to state transfer.
+'''
+
+from __future__ import absolute_import
+from __future__ import print_function
+from __future__ import unicode_literals
+from __future__ import with_statement
+
+
+import collections
+import os
+import os.path
+import re
+import signal
+import subprocess
+import sys
+import threading
+import time
+
+sys.path.append(os.path.dirname(os.path.abspath(__file__)))
+
+
+import argparse
+
+import hyperdex.admin
+import runner
+
+
+OP = re.compile(r'^(read|update)\s+count=(\d+) errors=(\d+)')
+LATENCY = re.compile(r'^\s+latency\s+p50=\s*(\S+) p90=\s*\S+ p99=\s*(\S+)')
+SERVER = re.compile(r'^server (\d+) (\S+) (\S+)$', re.MULTILINE)
+
+Interval = collections.namedtuple('Interval', ('start', 'end', 'ops', 'errors', 'p50', 'p99'))
+
+
+def bench_cmd(args, duration, extra):
+    return (['hyperdex', 'bench', '-h', '127.0.0.1', '-p', '1982',
+             '-n', str(args.records), '-d', str(duration),
+             '--value-min', str(args.value_size), '--value-max', str(args.value_size)]
+            + extra + ['recovery'])
+
+
+def parse_bench(output):
+    '''The count, errors and worst p50 and p99 latency (us) across the
+    operations in "hyperdex bench" output.'''
+    ops = errors = 0
+    p50 = p99 = 0.0
+    current = None
+    for line in output.splitlines():
+        m = OP.match(line)
+        if m:
+            ops += int(m.group(2))
+            errors += int(m.group(3))
+            current = m.group(1)
+            continue
+        m = LATENCY.match(line)
+        if m and current is not None:
+            p50 = max(p50, float(m.group(1)))
+            p99 = max(p99, float(m.group(2)))
+            current = None
+    return ops, errors, p50, p99
+
+
+class Foreground(threading.Thread):
+    '''Run back-to-back one-second "hyperdex bench" runs at a fixed rate,
+    keeping the latency each saw.'''
+
+    def __init__(self, args):
+        threading.Thread.__init__(self)
+        self.daemon = True
+        self.args = args
+        self.intervals = []
+        self.stopped = threading.Event()
+
+    def run(self):
+        extra = ['-t', '1', '-w', '64', '-r', str(self.args.foreground_rate),
+                 '-m', 'read=50,update=50']
+        while not self.stopped.is_set():
+            start = time.time()
+            proc = subprocess.Popen(bench_cmd(self.args, 1, extra),
+                                    stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+            output = proc.communicate()[0].decode('utf-8')
+            self.intervals.append(Interval(start, time.time(), *parse_bench(output)))
+
+    def stop(self):
+        self.stopped.set()
+        self.join()
+
+
+class Transfers(threading.Thread):
+    '''Follow the bytes every outgoing state transfer has had acknowledged,
+    through the daemons' performance counters.'''
+
+    def __init__(self):
+        threading.Thread.__init__(self)
+        self.daemon = True
+        self.lock = threading.Lock()
+        self.acked = {}
+
+    def run(self):
+        adm = hyperdex.admin.Admin('127.0.0.1', 1982)
+        for pc in adm.enable_perf_counters():
+            if isinstance(pc, Exception):
+                continue
+            prop = pc['property']
+            if not prop.startswith('xfer_out.') or not prop.endswith('.bytes_acked'):
+                continue
+            with self.lock:
+                self.acked[(pc['server'], prop)] = pc['measurement']
+
+    def total(self):
+        with self.lock:
+            return sum(self.acked.values())
+
+
+def human_bytes(x):
+    for unit in ('B', 'KB', 'MB', 'GB'):
+        if x < 1024:
+            return '%.1f%s' % (x, unit)
+        x /= 1024.
+    return '%.1fTB' % x
+
+
+def summarize(name, intervals):
+    if not intervals:
+        print('%-10s no foreground samples' % name)
+        return
+    ops = sum(i.ops for i in intervals)
+    errors = sum(i.errors for i in intervals)
+    print('%-10s ops=%d errors=%d worst_p50=%.1fus worst_p99=%.1fus' %
+          (name, ops, errors, max(i.p50 for i in intervals), max(i.p99 for i in intervals)))
+
+
+def victim_id(adm, port):
+    for sid, bind_to, state in SERVER.findall(adm.dump_config()):
+        if bind_to.endswith(':%d' % port):
+            return sid
+    raise RuntimeError('no server is bound to port %d' % port)
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--daemons', default=4, type=int,
+                        help='start this many daemons (default: 4)')
+    parser.add_argument('--fault-tolerance', default=1, type=int,
+                        help='failures the space tolerates (default: 1)')
+    parser.add_argument('--partitions', default=16, type=int,
+                        help='create the space with this many partitions (default: 16)')
+    parser.add_argument('--gigabytes', default=1.0, type=float,
+                        help='load this many GB of values (default: 1)')
+    parser.add_argument('--value-size', default=1024, type=int,
+                        help='bytes in each value (default: 1024)')
+    parser.add_argument('--victim', default=0, type=int,
+                        help='kill this daemon, numbered from 0 (default: 0)')
+    parser.add_argument('--foreground-rate', default=1000, type=int,
+                        help='foreground operations per second during recovery; 0 disables them (default: 1000)')
+    parser.add_argument('--baseline', default=5, type=int,
+                        help='seconds of foreground load to measure before the kill (default: 5)')
+    parser.add_argument('--max-recovery', default=0, type=float,
+                        help='fail if recovery takes longer than this many seconds (default: 0, never)')
+    parser.add_argument('--daemon-arg', default=[], action='append',
+                        help='pass this argument to every daemon; repeat for several')
+    args = parser.parse_args(argv)
+    if args.fault_tolerance < 1 or args.fault_tolerance >= args.daemons:
+        parser.error('the space must tolerate between 1 and %d failures' % (args.daemons - 1))
+    if args.victim < 0 or args.victim >= args.daemons:
+        parser.error('there is no daemon %d' % args.victim)
+    args.records = max(1, int(args.gigabytes * 2**30 / max(args.value_size, 1)))
+    hdc = runner.HyperDexCluster(1, args.daemons, clean=True, daemon_args=args.daemon_arg)
+    status = 0
+    try:
+        hdc.setup()
+        time.sleep(1)
+        adm = hyperdex.admin.Admin('127.0.0.1', 1982)
+        adm.add_space('space recovery key int k attributes string v, int count '
+                      'create %d partitions tolerate %d failures' %
+                      (args.partitions, args.fault_tolerance))
+        adm.wait_until_stable()
+
+        start = time.time()
+        subprocess.check_output(bench_cmd(args, 0, ['--load', '-t', '4']))
+        print('loaded %d objects (%s) in %.1fs' %
+              (args.records, human_bytes(args.records * args.value_size), time.time() - start))
+        sys.stdout.flush()
+
+        transfers = Transfers()
+        transfers.start()
+        fg = None
+        if args.foreground_rate > 0:
+            fg = Foreground(args)
+            fg.start()
+            time.sleep(args.baseline)
+
+        sid = victim_id(adm, 2012 + args.victim)
+        proc = hdc.processes[hdc.coordinators + args.victim]
+        proc.send_signal(signal.SIGKILL)
+        proc.wait()
+        hdc.processes.remove(proc)
+        killed = time.time()
+        subprocess.check_call(['hyperdex', 'server-kill', '-h', '127.0.0.1', '-p', '1982', sid])
+        waiter = subprocess.Popen(['hyperdex', 'wait-until-stable', '-h', '127.0.0.1', '-p', '1982'])
+
+        print('killed server %s; %8s %12s %10s %10s' % (sid, 'second', 'transferred', 'fg p50', 'fg p99'))
+        base = transfers.total()
+        last = base
+        second = 0
+        while waiter.poll() is None:
+            time.sleep(1)
+            second += 1
+            now = transfers.total()
+            p50 = p99 = '-'
+            if fg is not None and fg.intervals:
+                p50 = '%.1fus' % fg.intervals[-1].p50
+                p99 = '%.1fus' % fg.intervals[-1].p99
+            print('%24s %8d %12s %10s %10s' % ('', second, human_bytes(now - last) + '/s', p50, p99))
+            sys.stdout.flush()
+            last = now
+        recovered = time.time()
+        if waiter.returncode != 0:
+            raise RuntimeError('wait-until-stable exited %d' % waiter.returncode)
+
+        moved = transfers.total() - base
+        seconds = recovered - killed
+        print('recovery took %.1fs and moved %s (%s/s)' %
+              (seconds, human_bytes(moved), human_bytes(moved / max(seconds, 1e-9))))
+        if fg is not None:
+            time.sleep(args.baseline)
+            fg.stop()
+            summarize('before', [i for i in fg.intervals if i.end <= killed])
+            summarize('during', [i for i in fg.intervals if i.start >= killed and i.end <= recovered])
+            summarize('after', [i for i in fg.intervals if i.start >= recovered])
+        if args.max_recovery > 0 and seconds > args.max_recovery:
+            print('recovery took longer than %.1fs' % args.max_recovery)
+            status = 1
+    except:
+        hdc.log_output = True
+        raise
+    finally:
+        hdc.cleanup()
+    return status
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))
@@ -62,10 +62,11 @@ Daemon = collections.namedtuple('Daemon', ('host', 'port'))
 
 class HyperDexCluster(object):
 
-    def __init__(self, coordinators, daemons, clean=False, base=None):
+    def __init__(self, coordinators, daemons, clean=False, base=None, daemon_args=()):
         self.processes = []
         self.coordinators = coordinators
         self.daemons = daemons
+        self.daemon_args = list(daemon_args)
         self.clean = clean
         self.base = base
         self.log_output = False
@@ -81,6 +82,7 @@ class HyperDexCluster(object):
         if 'HYPERDEX_BUILDDIR' in os.environ and os.environ['HYPERDEX_BUILDDIR'] != '.':
             env['HYPERDEX_EXEC_PATH'] = BUILDDIR
             env['HYPERDEX_COORD_LIB'] = os.path.join(BUILDDIR, '.libs/libhyperdex-coordinator')
+        self.env = env
         for i in range(self.coordinators):
             cmd = ['hyperdex', 'coordinator',
                    '--foreground', '--listen', '127.0.0.1', '--listen-port', str(1982 + i)]
@@ -95,18 +97,29 @@ class HyperDexCluster(object):
             self.processes.append(proc)
         time.sleep(1)
         for i in range(self.daemons):
-            cmd = ['hyperdex', 'daemon', '-t', '1',
-                   '--foreground', '--listen', '127.0.0.1', '--listen-port', str(2012 + i),
-                   '--coordinator', '127.0.0.1', '--coordinator-port', '1982']
             cwd = os.path.join(self.base, 'daemon%i' % i)
             if os.path.exists(cwd):
                 raise RuntimeError('environment already exists (at least partially)')
             os.makedirs(cwd)
-            stdout = open(os.path.join(cwd, 'hyperdex-test-runner.log'), 'w')
-            proc = subprocess.Popen(cmd, stdout=stdout, stderr=subprocess.STDOUT, env=env, cwd=cwd)
-            self.processes.append(proc)
+            self.processes.append(self.start_daemon(i, 'w'))
         time.sleep(0.5)
 
+    def start_daemon(self, i, mode):
+        cmd = ['hyperdex', 'daemon', '-t', '1',
+               '--foreground', '--listen', '127.0.0.1', '--listen-port', str(2012 + i),
+               '--coordinator', '127.0.0.1', '--coordinator-port', '1982']
+        cmd += self.daemon_args
+        cwd = os.path.join(self.base, 'daemon%i' % i)
+        stdout = open(os.path.join(cwd, 'hyperdex-test-runner.log'), mode)
+        return subprocess.Popen(cmd, stdout=stdout, stderr=subprocess.STDOUT, env=self.env, cwd=cwd)
+
+    def restart_daemon(self, i, sig=signal.SIGTERM):
+        '''Stop daemon "i" with "sig" and start it again from what it saved.'''
+        idx = self.coordinators + i
+        self.processes[idx].send_signal(sig)
+        self.processes[idx].wait()
+        self.processes[idx] = self.start_daemon(i, 'a')
+
     def cleanup(self):
         for i in range(self.coordinators):
             core = os.path.join(self.base, 'coord%i' % i, 'core*')
@@ -28,6 +28,9 @@
 // C
 #include <cstdlib>
 
+// STL
+#include <string>
+
 // HyperDex
 #include <hyperdex/admin.hpp>
 #include "tools/common.h"
@@ -35,10 +38,18 @@
 int
 main(int argc, const char* argv[])
 {
+    const char* include = NULL;
+    const char* where = NULL;
     hyperdex::connect_opts conn;
     e::argparser ap;
     ap.autohelp();
     ap.add("Connect to a cluster:", conn.parser());
+    ap.arg().name('i', "include")
+            .description("store these comma-separated attributes in the index")
+            .metavar("attrs").as_string(&include);
+    ap.arg().name('w', "where")
+            .description("only index objects that pass these conditions, e.g., \"archived = 0 and size > 10\"")
+            .metavar("conds").as_string(&where);
 
     if (!ap.parse(argc, argv))
     {
@@ -63,7 +74,21 @@ main(int argc, const char* argv[])
     {
         hyperdex::Admin h(conn.host(), conn.port());
         hyperdex_admin_returncode rrc;
-        int64_t rid = h.add_index(ap.args()[0], ap.args()[1], &rrc);
+        std::string what(ap.args()[1]);
+
+        if (include)
+        {
+            what += " include ";
+            what += include;
+        }
+
+        if (where)
+        {
+            what += " where ";
+            what += where;
+        }
+
+        int64_t rid = h.add_index(ap.args()[0], what.c_str(), &rrc);
 
         if (rid < 0)
         {
@@ -0,0 +1,580 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+// STL
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// e
+#include <e/popt.h>
+
+// HyperDex
+#include <hyperdex/hyperspace_builder.h>
+
+// consider subspaces over at most this many of the most searched attributes,
+// and over pairs of them that are searched together
+#define CANDIDATE_ATTRS 16
+#define CANDIDATE_PAIRS 8
+
+// changes to the given layout under consideration
+struct layout
+{
+    layout() : subspaces(), indices() {}
+    std::vector<std::vector<std::string> > subspaces;
+    std::vector<std::string> indices;
+};
+
+// what the searches and each write cost under a layout
+struct score
+{
+    score() : fanout(0), scanned(0), cost(0), copies(0), index_entries(0) {}
+    double fanout;
+    double scanned;
+    double cost;
+    uint64_t copies;
+    uint64_t index_entries;
+};
+
+static bool
+read_all(const char* path, std::string* out)
+{
+    std::ifstream fin;
+    std::istream* in = &std::cin;
+
+    if (strcmp(path, "-") != 0)
+    {
+        fin.open(path, std::ios::in | std::ios::binary);
+
+        if (!fin)
+        {
+            return false;
+        }
+
+        in = &fin;
+    }
+
+    std::ostringstream ostr;
+    ostr << in->rdbuf();
+    *out = ostr.str();
+    return true;
+}
+
+static std::string
+trim(const std::string& s)
+{
+    size_t start = s.find_first_not_of(" \t\r");
+    size_t end = s.find_last_not_of(" \t\r");
+    return start == std::string::npos ? "" : s.substr(start, end - start + 1);
+}
+
+// the attributes a search places conditions on, and whether each condition
+// is an equality
+static void
+search_attrs(const std::string& search,
+             std::vector<std::pair<std::string, bool> >* attrs)
+{
+    const std::string conj(" and ");
+    size_t start = 0;
+    attrs->clear();
+
+    while (start <= search.size())
+    {
+        size_t end = search.find(conj, start);
+        end = end == std::string::npos ? search.size() : end;
+        const std::string cond(search.substr(start, end - start));
+        start = end + conj.size();
+        size_t op = cond.find_first_of("=<>");
+
+        if (op == std::string::npos)
+        {
+            continue;
+        }
+
+        attrs->push_back(std::make_pair(trim(cond.substr(0, op)), cond[op] == '='));
+    }
+}
+
+// the given description with "l" applied, or NULL if the result is invalid
+static struct hyperspace*
+build(const std::string& desc, const layout& l)
+{
+    struct hyperspace* space = hyperspace_parse(desc.c_str());
+
+    if (hyperspace_error(space))
+    {
+        if (space)
+        {
+            hyperspace_destroy(space);
+        }
+
+        return NULL;
+    }
+
+    for (size_t i = 0; i < l.subspaces.size(); ++i)
+    {
+        hyperspace_add_subspace(space);
+
+        for (size_t j = 0; j < l.subspaces[i].size(); ++j)
+        {
+            if (hyperspace_add_subspace_attribute(space, l.subspaces[i][j].c_str()) != HYPERSPACE_SUCCESS)
+            {
+                hyperspace_destroy(space);
+                return NULL;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < l.indices.size(); ++i)
+    {
+        if (hyperspace_add_index(space, l.indices[i].c_str()) != HYPERSPACE_SUCCESS)
+        {
+            hyperspace_destroy(space);
+            return NULL;
+        }
+    }
+
+    return space;
+}
+
+static bool
+evaluate(const std::string& desc, const layout& l,
+         const std::vector<const char*>& searches,
+         long scan_cost, score* s)
+{
+    struct hyperspace* space = build(desc, l);
+
+    if (!space)
+    {
+        return false;
+    }
+
+    std::vector<uint64_t> regions(searches.size());
+    std::vector<uint64_t> total(searches.size());
+    std::vector<int> indexed(searches.size());
+
+    if (hyperspace_route_searches(space, &searches.front(), searches.size(),
+                                  &regions.front(), &total.front(), &indexed.front()) != HYPERSPACE_SUCCESS ||
+        hyperspace_write_cost(space, &s->copies, &s->index_entries) != HYPERSPACE_SUCCESS)
+    {
+        hyperspace_destroy(space);
+        return false;
+    }
+
+    hyperspace_destroy(space);
+    double fanout = 0;
+    double scanned = 0;
+    double cost = 0;
+
+    for (size_t i = 0; i < searches.size(); ++i)
+    {
+        fanout += regions[i];
+        scanned += indexed[i] ? 0 : 1;
+        cost += regions[i] * (indexed[i] ? 1 : scan_cost);
+    }
+
+    s->fanout = fanout / searches.size();
+    s->scanned = scanned / searches.size();
+    s->cost = cost / searches.size();
+    return true;
+}
+
+static std::string
+describe_change(const layout& l)
+{
+    std::ostringstream ostr;
+
+    if (!l.subspaces.empty())
+    {
+        ostr << "subspace ";
+
+        for (size_t i = 0; i < l.subspaces.back().size(); ++i)
+        {
+            ostr << (i > 0 ? ", " : "") << l.subspaces.back()[i];
+        }
+    }
+    else
+    {
+        ostr << "index " << l.indices.back();
+    }
+
+    return ostr.str();
+}
+
+static void
+print_score(const char* what, const score& s)
+{
+    std::cout << std::left << std::setw(32) << what << std::right
+              << std::fixed << std::setprecision(1)
+              << std::setw(10) << s.fanout
+              << std::setw(9) << s.scanned * 100 << "%"
+              << std::setw(10) << s.cost
+              << std::setw(8) << s.copies
+              << std::setw(9) << s.index_entries << "\n";
+}
+
+int
+main(int argc, const char* argv[])
+{
+    long max_subspaces = 2;
+    long max_indices = 4;
+    long max_writes = 0;
+    long scan_cost = 16;
+    long min_gain = 5;
+    e::argparser ap;
+    ap.autohelp();
+    ap.option_string("[OPTIONS] <description-file> <search-file>");
+    ap.arg().name('s', "max-subspaces")
+            .description("add at most this many subspaces (default: 2)")
+            .metavar("N").as_long(&max_subspaces);
+    ap.arg().name('i', "max-indices")
+            .description("add at most this many indices (default: 4)")
+            .metavar("N").as_long(&max_indices);
+    ap.arg().name('w', "max-writes")
+            .description("store at most this many copies and index entries per write (default: twice the given layout's)")
+            .metavar("N").as_long(&max_writes);
+    ap.arg().long_name("scan-cost")
+            .description("weigh a region scanned without an index as this many regions searched with one (default: 16)")
+            .metavar("N").as_long(&scan_cost);
+    ap.arg().long_name("min-gain")
+            .description("make a change only if it cuts the cost of searches by this many percent (default: 5)")
+            .metavar("PCT").as_long(&min_gain);
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() != 2)
+    {
+        std::cerr << "specify the space description and the file of sampled searches" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (max_subspaces < 0 || max_indices < 0 || max_writes < 0 ||
+        scan_cost <= 0 || min_gain < 0)
+    {
+        std::cerr << "the limits must not be negative, and the scan cost must be positive" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    std::string desc;
+    std::string trace;
+
+    if (strcmp(ap.args()[0], "-") == 0 && strcmp(ap.args()[1], "-") == 0)
+    {
+        std::cerr << "only one of the description and searches may come from stdin" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!read_all(ap.args()[0], &desc))
+    {
+        std::cerr << "could not open " << ap.args()[0] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!read_all(ap.args()[1], &trace))
+    {
+        std::cerr << "could not open " << ap.args()[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    struct hyperspace* base = hyperspace_parse(desc.c_str());
+
+    if (hyperspace_error(base))
+    {
+        std::cerr << "invalid hyperspace: " << hyperspace_error(base) << std::endl;
+
+        if (base)
+        {
+            hyperspace_destroy(base);
+        }
+
+        return EXIT_FAILURE;
+    }
+
+    // one search per line; blank lines and lines starting with '#' are
+    // skipped, as are searches the space cannot route
+    std::vector<std::string> lines;
+    std::istringstream tin(trace);
+    std::string line;
+    uint64_t skipped = 0;
+
+    while (std::getline(tin, line))
+    {
+        line = trim(line);
+
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+
+        const char* search = line.c_str();
+        uint64_t regions;
+        uint64_t total;
+        int indexed;
+
+        if (hyperspace_route_searches(base, &search, 1, &regions, &total, &indexed) != HYPERSPACE_SUCCESS)
+        {
+            if (skipped < 8)
+            {
+                std::cerr << "skipping \"" << line << "\": " << hyperspace_error(base) << std::endl;
+            }
+
+            ++skipped;
+            hyperspace_destroy(base);
+            base = hyperspace_parse(desc.c_str());
+            continue;
+        }
+
+        lines.push_back(line);
+    }
+
+    std::string base_desc(hyperspace_describe(base));
+    hyperspace_destroy(base);
+
+    if (lines.empty())
+    {
+        std::cerr << "there are no searches to advise on" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::vector<const char*> searches;
+    std::map<std::string, uint64_t> attr_counts;
+    std::map<std::pair<std::string, std::string>, uint64_t> pair_counts;
+
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        searches.push_back(lines[i].c_str());
+        std::vector<std::pair<std::string, bool> > attrs;
+        search_attrs(lines[i], &attrs);
+        std::sort(attrs.begin(), attrs.end());
+        attrs.erase(std::unique(attrs.begin(), attrs.end()), attrs.end());
+
+        for (size_t j = 0; j < attrs.size(); ++j)
+        {
+            ++attr_counts[attrs[j].first];
+
+            for (size_t k = j + 1; k < attrs.size(); ++k)
+            {
+                if (attrs[j].first != attrs[k].first)
+                {
+                    ++pair_counts[std::make_pair(attrs[j].first, attrs[k].first)];
+                }
+            }
+        }
+    }
+
+    // the most searched attributes and pairs are the only ones worth trying
+    std::vector<std::pair<uint64_t, std::string> > by_count;
+
+    for (std::map<std::string, uint64_t>::iterator it = attr_counts.begin();
+            it != attr_counts.end(); ++it)
+    {
+        by_count.push_back(std::make_pair(it->second, it->first));
+    }
+
+    std::sort(by_count.rbegin(), by_count.rend());
+    by_count.resize(std::min(by_count.size(), size_t(CANDIDATE_ATTRS)));
+    std::vector<std::pair<uint64_t, std::pair<std::string, std::string> > > pairs_by_count;
+
+    for (std::map<std::pair<std::string, std::string>, uint64_t>::iterator it = pair_counts.begin();
+            it != pair_counts.end(); ++it)
+    {
+        pairs_by_count.push_back(std::make_pair(it->second, it->first));
+    }
+
+    std::sort(pairs_by_count.rbegin(), pairs_by_count.rend());
+    pairs_by_count.resize(std::min(pairs_by_count.size(), size_t(CANDIDATE_PAIRS)));
+    std::vector<layout> changes;
+
+    for (size_t i = 0; i < by_count.size(); ++i)
+    {
+        layout ss;
+        ss.subspaces.push_back(std::vector<std::string>(1, by_count[i].second));
+        changes.push_back(ss);
+        layout idx;
+        idx.indices.push_back(by_count[i].second);
+        changes.push_back(idx);
+    }
+
+    for (size_t i = 0; i < pairs_by_count.size(); ++i)
+    {
+        layout ss;
+        ss.subspaces.push_back(std::vector<std::string>());
+        ss.subspaces.back().push_back(pairs_by_count[i].second.first);
+        ss.subspaces.back().push_back(pairs_by_count[i].second.second);
+        changes.push_back(ss);
+    }
+
+    layout current;
+    score base_score;
+
+    if (!evaluate(base_desc, current, searches, scan_cost, &base_score))
+    {
+        std::cerr << "could not route searches through the given space" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (max_writes == 0)
+    {
+        max_writes = 2 * (base_score.copies + base_score.index_entries);
+    }
+
+    std::cout << lines.size() << " searches";
+
+    if (skipped > 0)
+    {
+        std::cout << " (" << skipped << " skipped)";
+    }
+
+    std::cout << "\n\n";
+    std::cout << std::left << std::setw(32) << "layout" << std::right
+              << std::setw(10) << "fan-out"
+              << std::setw(10) << "scanned"
+              << std::setw(10) << "cost"
+              << std::setw(8) << "copies"
+              << std::setw(9) << "entries" << "\n";
+    print_score("as given", base_score);
+    score current_score = base_score;
+
+    // greedily take whichever change cuts the cost of searches the most for
+    // each added write, until none is worth its writes
+    while (true)
+    {
+        const layout* best = NULL;
+        layout best_layout;
+        score best_score;
+        double best_value = 0;
+
+        for (size_t i = 0; i < changes.size(); ++i)
+        {
+            layout l(current);
+
+            if (!changes[i].subspaces.empty())
+            {
+                if (l.subspaces.size() >= size_t(max_subspaces) ||
+                    std::find(l.subspaces.begin(), l.subspaces.end(), changes[i].subspaces[0]) != l.subspaces.end())
+                {
+                    continue;
+                }
+
+                l.subspaces.push_back(changes[i].subspaces[0]);
+            }
+            else
+            {
+                if (l.indices.size() >= size_t(max_indices) ||
+                    std::find(l.indices.begin(), l.indices.end(), changes[i].indices[0]) != l.indices.end())
+                {
+                    continue;
+                }
+
+                l.indices.push_back(changes[i].indices[0]);
+            }
+
+            score s;
+
+            if (!evaluate(base_desc, l, searches, scan_cost, &s) ||
+                s.copies + s.index_entries > uint64_t(max_writes) ||
+                s.cost * 100 > current_score.cost * (100 - min_gain))
+            {
+                continue;
+            }
+
+            const uint64_t before = current_score.copies + current_score.index_entries;
+            const uint64_t after = s.copies + s.index_entries;
+            const double added = after > before ? after - before : 0;
+            const double value = (current_score.cost - s.cost) / (added + 1);
+
+            if (!best || value > best_value)
+            {
+                best = &changes[i];
+                best_layout = l;
+                best_score = s;
+                best_value = value;
+            }
+        }
+
+        if (!best)
+        {
+            break;
+        }
+
+        // report the change as the one just added to the layout
+        layout last;
+
+        if (!best->subspaces.empty())
+        {
+            last.subspaces.push_back(best->subspaces[0]);
+        }
+        else
+        {
+            last.indices.push_back(best->indices[0]);
+        }
+
+        print_score(("+ " + describe_change(last)).c_str(), best_score);
+        current = best_layout;
+        current_score = best_score;
+    }
+
+    struct hyperspace* recommended = build(base_desc, current);
+
+    if (!recommended)
+    {
+        std::cerr << "could not build the recommended space" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const uint64_t base_writes = base_score.copies + base_score.index_entries;
+    const uint64_t writes = current_score.copies + current_score.index_entries;
+    std::cout << "\n"
+              << std::fixed << std::setprecision(1)
+              << "expected fan-out: " << current_score.fanout << " regions per search"
+              << " (given: " << base_score.fanout << ")\n"
+              << "scanned without an index: " << current_score.scanned * 100 << "% of searches"
+              << " (given: " << base_score.scanned * 100 << "%)\n"
+              << std::setprecision(2)
+              << "write amplification: " << writes << " copies and index entries per write, "
+              << double(writes) / base_writes << "x the given layout's " << base_writes << "\n\n"
+              << hyperspace_describe(recommended);
+    hyperspace_destroy(recommended);
+    return EXIT_SUCCESS;
+}
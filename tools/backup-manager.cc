@@ -26,15 +26,24 @@
 // POSSIBILITY OF SUCH DAMAGE.
 
 // C
+#include <cstdio>
 #include <cstdlib>
+#include <stdint.h>
 
 // POSIX
+#include <dirent.h>
 #include <errno.h>
+#include <ftw.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
 // STL
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <sstream>
 #include <string>
+#include <vector>
 
 // po6
 #include <po6/io/fd.h>
@@ -45,6 +54,9 @@
 
 using hyperdex::connect_opts;
 
+// rsync accepts at most this many --link-dest directories
+#define MAX_LINK_DESTS 20
+
 struct daemon_backup
 {
     daemon_backup() : sid(), addr(), path() {}
@@ -210,27 +222,110 @@ record_latest(const std::string& base, const std::string& now)
     return true;
 }
 
+// every earlier backup under base, newest first; a backup is a directory
+// holding a coordinator.bin, which is moved into place before any daemon's
+// state is copied
 static bool
-fork_exec_wait(const std::vector<std::string>& args)
+list_backups(const std::string& base, const std::string& now,
+             std::vector<std::string>* backups)
 {
-    pid_t child = fork();
+    DIR* dir = opendir(base.c_str());
 
-    if (child > 0)
+    if (!dir)
+    {
+        std::cerr << "could not list earlier backups: "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct dirent* ent = NULL;
+
+    while ((ent = readdir(dir)) != NULL)
     {
-        int status = 0;
+        std::string name(ent->d_name);
+        struct stat stbuf;
 
-        if (waitpid(child, &status, 0) < 0)
+        if (name == "." || name == ".." || name == now)
         {
-            std::cerr << "could not wait for child: " << strerror(errno) << std::endl;
-            return false;
+            continue;
         }
 
-        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        if (stat(po6::path::join(base, name, "coordinator.bin").c_str(), &stbuf) == 0)
         {
-            std::cerr << "child process failed" << std::endl;
-            return false;
+            backups->push_back(po6::path::join(base, name));
         }
+    }
+
+    closedir(dir);
+    std::sort(backups->begin(), backups->end(), std::greater<std::string>());
+    return true;
+}
+
+// what rsync did with one daemon's files:  those with a single link were
+// copied in this backup, the rest are shared with earlier backups
+struct transfer_tally
+{
+    transfer_tally()
+        : copied_files(0), copied_bytes(0), reused_files(0), reused_bytes(0) {}
+    uint64_t copied_files;
+    uint64_t copied_bytes;
+    uint64_t reused_files;
+    uint64_t reused_bytes;
+};
+
+static transfer_tally _tally;
+
+static int
+tally_file(const char*, const struct stat* st, int typeflag, struct FTW*)
+{
+    if (typeflag != FTW_F)
+    {
+        return 0;
+    }
+
+    if (st->st_nlink > 1)
+    {
+        ++_tally.reused_files;
+        _tally.reused_bytes += st->st_size;
+    }
+    else
+    {
+        ++_tally.copied_files;
+        _tally.copied_bytes += st->st_size;
+    }
+
+    return 0;
+}
+
+static void
+print_tally(const char* who, const transfer_tally& t)
+{
+    std::cout << who << ": copied " << t.copied_files << " files ("
+              << t.copied_bytes << " bytes), reused " << t.reused_files
+              << " files (" << t.reused_bytes << " bytes) from earlier backups"
+              << std::endl;
+}
+
+static bool
+child_succeeded(int status)
+{
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        std::cerr << "child process failed" << std::endl;
+        return false;
+    }
+
+    return true;
+}
 
+static bool
+fork_exec(const std::vector<std::string>& args, pid_t* pid)
+{
+    pid_t child = fork();
+
+    if (child > 0)
+    {
+        *pid = child;
         return true;
     }
     else if (child == 0)
@@ -255,10 +350,35 @@ fork_exec_wait(const std::vector<std::string>& args)
     }
 }
 
+static bool
+fork_exec_wait(const std::vector<std::string>& args)
+{
+    pid_t child;
+
+    if (!fork_exec(args, &child))
+    {
+        return false;
+    }
+
+    int status = 0;
+
+    if (waitpid(child, &status, 0) < 0)
+    {
+        std::cerr << "could not wait for child: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    return child_succeeded(status);
+}
+
 int
 main(int argc, const char* argv[])
 {
     bool _cleanup = true;
+    bool _full = false;
+    long _parallel = 8;
+    long _bwlimit = 0;
+    long _total_bwlimit = 0;
     const char* _data = ".";
     const char* _user = NULL;
     connect_opts conn;
@@ -271,6 +391,18 @@ main(int argc, const char* argv[])
     ap.arg().name('u', "user")
             .description("username to use for ssh connections (default: this user)")
             .metavar("user").as_string(&_user);
+    ap.arg().long_name("full")
+            .description("copy every file instead of reusing unchanged files from earlier backups")
+            .set_true(&_full);
+    ap.arg().name('j', "parallel")
+            .description("copy this many daemons' backups at once (default: 8)")
+            .metavar("N").as_long(&_parallel);
+    ap.arg().long_name("bwlimit")
+            .description("limit each daemon's copy to this many KiB/s (default: no limit)")
+            .metavar("KBPS").as_long(&_bwlimit);
+    ap.arg().long_name("total-bwlimit")
+            .description("limit all copies together to this many KiB/s (default: no limit)")
+            .metavar("KBPS").as_long(&_total_bwlimit);
 
     if (!ap.parse(argc, argv))
     {
@@ -284,6 +416,13 @@ main(int argc, const char* argv[])
         return EXIT_FAILURE;
     }
 
+    if (_parallel <= 0 || _bwlimit < 0 || _total_bwlimit < 0)
+    {
+        std::cerr << "the parallelism must be positive and the bandwidth limits non-negative\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
     using po6::path::join;
 
     try
@@ -341,49 +480,88 @@ main(int argc, const char* argv[])
             return EXIT_FAILURE;
         }
 
+        // Table files never change once written, so any earlier backup of a
+        // daemon may hold most of what it has now.  rsync hard links the
+        // files it finds unchanged in a --link-dest directory instead of
+        // copying them; offer it the LATEST backup and then the others,
+        // newest first, so a daemon missing from the last backup still
+        // reuses what an older one has.
+        std::vector<std::string> earlier;
+
+        if (!_full && !list_backups(base, now, &earlier))
+        {
+            return EXIT_FAILURE;
+        }
+
+        if (has_previous)
+        {
+            std::vector<std::string>::iterator it;
+            it = std::find(earlier.begin(), earlier.end(), previous);
+
+            if (it != earlier.end())
+            {
+                earlier.erase(it);
+                earlier.insert(earlier.begin(), previous);
+            }
+        }
+
+        // Copy up to --parallel daemons at once; the total limit is split
+        // evenly between the copies that run together.
+        size_t parallel = std::min(static_cast<size_t>(_parallel), daemons.size());
+        long bwlimit = _bwlimit;
+
+        if (_total_bwlimit > 0 && parallel > 0)
+        {
+            long share = std::max(_total_bwlimit / static_cast<long>(parallel), 1L);
+            bwlimit = bwlimit > 0 ? std::min(bwlimit, share) : share;
+        }
+
+        std::vector<std::vector<std::string> > copies;
+        std::vector<std::string> daemon_dirs;
+
         for (size_t i = 0; i < daemons.size(); ++i)
         {
             char buf[21];
             sprintf(buf, "%lu", daemons[i].sid);
             std::string daemon_dir(join(base, now, buf));
-            bool prev = false;
-            std::string link_dest;
+            std::vector<std::string> link_dests;
 
-            if (has_previous)
+            for (size_t j = 0; j < earlier.size() && link_dests.size() < MAX_LINK_DESTS; ++j)
             {
                 struct stat stbuf;
-                std::string daemon_prev(join(previous, buf));
+                std::string daemon_prev(join(earlier[j], buf));
                 int status = stat(daemon_prev.c_str(), &stbuf);
 
-                if (status < 0 && errno == ENOENT)
+                if (status < 0 && errno != ENOENT)
                 {
-                    prev = false;
-                }
-                else if (status < 0)
-                {
-                    prev = false;
                     std::cerr << "could not stat prev backup for " << daemons[i].sid << ": "
                               << strerror(errno) << std::endl;
                     success = false;
                 }
-                else
+                else if (status == 0)
                 {
-                    prev = true;
-                    link_dest  = "--link-dest=";
-                    link_dest += daemon_prev.c_str();
+                    link_dests.push_back("--link-dest=" + daemon_prev);
                 }
             }
 
+            // rsync checks every file it transfers against a whole-file
+            // checksum and retries it on a mismatch
             std::vector<std::string> args;
             args.push_back("rsync");
             args.push_back("-a");
             args.push_back("--delete");
+            // a storage shard on another disk is linked into the backup
+            args.push_back("--copy-unsafe-links");
 
-            if (prev)
+            if (bwlimit > 0)
             {
-                args.push_back(link_dest);
+                std::ostringstream ostr;
+                ostr << "--bwlimit=" << bwlimit;
+                args.push_back(ostr.str());
             }
 
+            args.insert(args.end(), link_dests.begin(), link_dests.end());
+
             args.push_back("--");
             std::string rsync_url = daemons[i].addr + ":" + daemons[i].path + "/";
 
@@ -397,11 +575,80 @@ main(int argc, const char* argv[])
             }
 
             args.push_back(daemon_dir.c_str());
+            copies.push_back(args);
+            daemon_dirs.push_back(daemon_dir);
+        }
+
+        transfer_tally total;
+        std::map<pid_t, size_t> running;
+        size_t next = 0;
 
-            if (!fork_exec_wait(args))
+        while (next < copies.size() || !running.empty())
+        {
+            while (next < copies.size() && running.size() < parallel)
             {
+                pid_t child;
+
+                if (fork_exec(copies[next], &child))
+                {
+                    running[child] = next;
+                }
+                else
+                {
+                    success = false;
+                }
+
+                ++next;
+            }
+
+            if (running.empty())
+            {
+                continue;
+            }
+
+            int status = 0;
+            pid_t child = waitpid(-1, &status, 0);
+
+            if (child < 0)
+            {
+                std::cerr << "could not wait for child: " << strerror(errno) << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            std::map<pid_t, size_t>::iterator it = running.find(child);
+
+            if (it == running.end())
+            {
+                continue;
+            }
+
+            size_t idx = it->second;
+            running.erase(it);
+
+            if (!child_succeeded(status))
+            {
+                std::cerr << "could not copy the backup of " << daemons[idx].sid << std::endl;
                 success = false;
+                continue;
             }
+
+            _tally = transfer_tally();
+
+            if (nftw(daemon_dirs[idx].c_str(), tally_file, 16, FTW_PHYS) == 0)
+            {
+                char buf[21];
+                sprintf(buf, "%lu", daemons[idx].sid);
+                print_tally(buf, _tally);
+                total.copied_files += _tally.copied_files;
+                total.copied_bytes += _tally.copied_bytes;
+                total.reused_files += _tally.reused_files;
+                total.reused_bytes += _tally.reused_bytes;
+            }
+        }
+
+        if (!daemons.empty())
+        {
+            print_tally("total", total);
         }
 
         if (success && _cleanup)
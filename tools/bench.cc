@@ -0,0 +1,1068 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <time.h>
+
+// STL
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/threads/barrier.h>
+#include <po6/threads/thread.h>
+#include <po6/time.h>
+
+// e
+#include <e/compat.h>
+#include <e/endian.h>
+#include <e/popt.h>
+
+// HyperDex
+#include <hyperdex/client.hpp>
+#include "tools/common.h"
+
+using po6::threads::make_obj_func;
+
+// Latencies land in buckets that are exact below 16ns and then split each
+// power of two into 16 sub-buckets, so every reported value is within 1/16th
+// of the true value.
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_BUCKETS (64 << HISTOGRAM_SUB_BITS)
+// Never block in hyperdex_client_loop for longer than this, so that a thread
+// notices the end of the run even with nothing completing.
+#define LOOP_TIMEOUT_MS 100
+
+namespace
+{
+
+enum op_type
+{
+    OP_READ,
+    OP_UPDATE,
+    OP_INSERT,
+    OP_SCAN,
+    OP_ATOMIC,
+    OP_TYPES
+};
+
+const char* op_names[OP_TYPES] = {"read", "update", "insert", "scan", "atomic"};
+
+class histogram
+{
+    public:
+        histogram() : m_buckets(HISTOGRAM_BUCKETS, 0), m_count(0), m_max(0) {}
+
+    public:
+        void record(uint64_t ns);
+        void merge(const histogram& other);
+        uint64_t count() const { return m_count; }
+        uint64_t max() const { return m_max; }
+        // the smallest value that at least fraction q of samples do not exceed
+        uint64_t quantile(double q) const;
+
+    private:
+        static size_t bucket(uint64_t ns);
+        static uint64_t upper_bound(size_t idx);
+
+    private:
+        std::vector<uint64_t> m_buckets;
+        uint64_t m_count;
+        uint64_t m_max;
+};
+
+void
+histogram :: record(uint64_t ns)
+{
+    ++m_buckets[bucket(ns)];
+    ++m_count;
+    m_max = std::max(m_max, ns);
+}
+
+void
+histogram :: merge(const histogram& other)
+{
+    for (size_t i = 0; i < m_buckets.size(); ++i)
+    {
+        m_buckets[i] += other.m_buckets[i];
+    }
+
+    m_count += other.m_count;
+    m_max = std::max(m_max, other.m_max);
+}
+
+uint64_t
+histogram :: quantile(double q) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(ceil(q * m_count));
+    rank = std::max(rank, uint64_t(1));
+    uint64_t seen = 0;
+
+    for (size_t i = 0; i < m_buckets.size(); ++i)
+    {
+        seen += m_buckets[i];
+
+        if (seen >= rank)
+        {
+            return std::min(upper_bound(i), m_max);
+        }
+    }
+
+    return m_max;
+}
+
+size_t
+histogram :: bucket(uint64_t ns)
+{
+    if (ns < (1ULL << HISTOGRAM_SUB_BITS))
+    {
+        return ns;
+    }
+
+    unsigned exp = 63 - __builtin_clzll(ns);
+    uint64_t sub = (ns >> (exp - HISTOGRAM_SUB_BITS)) & ((1ULL << HISTOGRAM_SUB_BITS) - 1);
+    return ((exp - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) + sub;
+}
+
+uint64_t
+histogram :: upper_bound(size_t idx)
+{
+    if (idx < (1ULL << HISTOGRAM_SUB_BITS))
+    {
+        return idx;
+    }
+
+    unsigned exp = (idx >> HISTOGRAM_SUB_BITS) + HISTOGRAM_SUB_BITS - 1;
+    uint64_t sub = idx & ((1ULL << HISTOGRAM_SUB_BITS) - 1);
+    uint64_t base = (1ULL << exp) + (sub << (exp - HISTOGRAM_SUB_BITS));
+    return base + (1ULL << (exp - HISTOGRAM_SUB_BITS)) - 1;
+}
+
+// xorshift64*; each thread owns one so drawing numbers never synchronizes
+class generator
+{
+    public:
+        generator(uint64_t seed) : m_state(seed ? seed : 0x9e3779b97f4a7c15ULL) {}
+
+    public:
+        uint64_t next()
+        {
+            m_state ^= m_state >> 12;
+            m_state ^= m_state << 25;
+            m_state ^= m_state >> 27;
+            return m_state * 2685821657736338717ULL;
+        }
+        // uniform on [0, 1)
+        double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+        // uniform on [0, n)
+        uint64_t below(uint64_t n) { return n ? next() % n : 0; }
+
+    private:
+        uint64_t m_state;
+};
+
+// Gray et al., "Quickly Generating Billion-Record Synthetic Databases".  Rank
+// 0 is the most popular.  The constants are computed once and shared.
+class zipfian
+{
+    public:
+        zipfian(uint64_t n, double theta);
+
+    public:
+        uint64_t draw(generator* g) const;
+
+    private:
+        uint64_t m_n;
+        double m_theta;
+        double m_zetan;
+        double m_alpha;
+        double m_eta;
+};
+
+zipfian :: zipfian(uint64_t n, double theta)
+    : m_n(n)
+    , m_theta(theta)
+    , m_zetan(0)
+    , m_alpha(1.0 / (1.0 - theta))
+    , m_eta(0)
+{
+    for (uint64_t i = 1; i <= n; ++i)
+    {
+        m_zetan += 1.0 / pow(static_cast<double>(i), theta);
+    }
+
+    double zeta2 = 1.0 + pow(0.5, theta);
+    m_eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / m_zetan);
+}
+
+uint64_t
+zipfian :: draw(generator* g) const
+{
+    double u = g->unit();
+    double uz = u * m_zetan;
+
+    if (uz < 1.0)
+    {
+        return 0;
+    }
+
+    if (uz < 1.0 + pow(0.5, m_theta))
+    {
+        return 1;
+    }
+
+    uint64_t x = static_cast<uint64_t>(m_n * pow(m_eta * u - m_eta + 1.0, m_alpha));
+    return std::min(x, m_n - 1);
+}
+
+// Everything the workers share.  It is filled in before any worker starts and
+// is read-only afterwards, except for next_insert.
+struct workload
+{
+    workload()
+        : host(NULL), port(0), space(NULL), key_attr(NULL), value_attr(NULL)
+        , counter_attr(NULL), records(0), mix(), zipf_keys(NULL)
+        , value_min(0), value_max(0), zipf_values(NULL), scan_max(0)
+        , window(0), threads(0), interval(0), load(false), start(0), end(0)
+        , next_insert(0), value_bytes(), barrier(NULL) {}
+
+    const char* host;
+    uint16_t port;
+    const char* space;
+    const char* key_attr;
+    const char* value_attr;
+    const char* counter_attr;
+    uint64_t records;
+    // cumulative weights, indexed by op_type
+    std::vector<uint64_t> mix;
+    // NULL means uniform
+    const zipfian* zipf_keys;
+    uint64_t value_min;
+    uint64_t value_max;
+    const zipfian* zipf_values;
+    uint64_t scan_max;
+    size_t window;
+    unsigned threads;
+    // nanoseconds between a thread's sends; 0 runs closed-loop
+    uint64_t interval;
+    bool load;
+    uint64_t start;
+    uint64_t end;
+    uint64_t next_insert;
+    std::string value_bytes;
+    po6::threads::barrier* barrier;
+
+    private:
+        workload(const workload&);
+        workload& operator = (const workload&);
+};
+
+// One outstanding operation.  The client points into it until the op
+// completes.
+struct pending
+{
+    pending()
+        : type(OP_READ), intended(0), sent(0), status(), attrs(NULL), attrs_sz(0)
+        , key(), bound(), attr(), check() {}
+
+    op_type type;
+    uint64_t intended;
+    uint64_t sent;
+    hyperdex_client_returncode status;
+    const hyperdex_client_attribute* attrs;
+    size_t attrs_sz;
+    char key[sizeof(int64_t)];
+    char bound[sizeof(int64_t)];
+    hyperdex_client_attribute attr;
+    hyperdex_client_attribute_check check[2];
+};
+
+class worker
+{
+    public:
+        worker(workload* w, unsigned idx);
+        ~worker() throw ();
+
+    public:
+        void run();
+        const std::string& error() const { return m_error; }
+
+    public:
+        histogram latency[OP_TYPES];
+        histogram service[OP_TYPES];
+        uint64_t errors[OP_TYPES];
+        uint64_t load_errors;
+        uint64_t missing;
+        uint64_t scanned;
+        uint64_t late;
+
+    private:
+        bool load();
+        bool issue(pending* p, uint64_t intended);
+        bool loop(int timeout, bool record);
+        void complete(pending* p, bool record);
+        uint64_t draw_key();
+        void set_value(pending* p);
+
+    private:
+        workload* m_w;
+        unsigned m_idx;
+        generator m_gen;
+        hyperdex::Client* m_cl;
+        std::vector<pending> m_slots;
+        std::vector<pending*> m_free;
+        std::map<int64_t, pending*> m_outstanding;
+        std::string m_error;
+
+    private:
+        worker(const worker&);
+        worker& operator = (const worker&);
+};
+
+worker :: worker(workload* w, unsigned idx)
+    : latency()
+    , service()
+    , errors()
+    , load_errors(0)
+    , missing(0)
+    , scanned(0)
+    , late(0)
+    , m_w(w)
+    , m_idx(idx)
+    , m_gen(po6::monotonic_time() * (idx + 1))
+    , m_cl(NULL)
+    , m_slots(w->window)
+    , m_free()
+    , m_outstanding()
+    , m_error()
+{
+    for (size_t i = 0; i < m_slots.size(); ++i)
+    {
+        m_free.push_back(&m_slots[i]);
+    }
+}
+
+worker :: ~worker() throw ()
+{
+    delete m_cl;
+}
+
+void
+worker :: run()
+{
+    try
+    {
+        m_cl = new hyperdex::Client(m_w->host, m_w->port);
+    }
+    catch (std::exception& e)
+    {
+        m_error = std::string("could not create client: ") + e.what();
+    }
+
+    if (m_cl && m_w->load && !load())
+    {
+        delete m_cl;
+        m_cl = NULL;
+    }
+
+    // every worker waits here, even a failed one, so the others are not stuck
+    m_w->barrier->wait();
+
+    if (!m_cl)
+    {
+        return;
+    }
+
+    // Stagger the threads' schedules so their sends interleave.  Each op is
+    // due at a fixed point in the schedule whether or not the cluster kept up,
+    // and its latency is measured from that point rather than from when the
+    // thread got around to sending it.  Otherwise a stall would delay the ops
+    // behind it without any of them being charged for the wait.
+    uint64_t next = m_w->start + m_w->interval * m_idx / m_w->threads;
+
+    while (true)
+    {
+        uint64_t now = po6::monotonic_time();
+
+        if (now >= m_w->end)
+        {
+            break;
+        }
+
+        if (m_w->interval == 0)
+        {
+            next = now;
+        }
+
+        while (now >= next && next < m_w->end && !m_free.empty())
+        {
+            pending* p = m_free.back();
+            m_free.pop_back();
+
+            if (!issue(p, next))
+            {
+                return;
+            }
+
+            next = m_w->interval ? next + m_w->interval : now;
+        }
+
+        uint64_t wait = m_w->end - now;
+
+        if (m_w->interval && next > now)
+        {
+            wait = std::min(wait, next - now);
+        }
+
+        int timeout = std::min(wait / uint64_t(1000000), uint64_t(LOOP_TIMEOUT_MS));
+
+        if (m_outstanding.empty())
+        {
+            timespec ts;
+            ts.tv_sec = wait / 1000000000ULL;
+            ts.tv_nsec = wait % 1000000000ULL;
+            nanosleep(&ts, NULL);
+        }
+        else if (!loop(timeout, true))
+        {
+            return;
+        }
+    }
+
+    // ops still in flight at the end count; nothing new goes out
+    while (!m_outstanding.empty())
+    {
+        if (!loop(LOOP_TIMEOUT_MS, true))
+        {
+            return;
+        }
+    }
+}
+
+bool
+worker :: load()
+{
+    uint64_t key = m_idx;
+
+    while (key < m_w->records || !m_outstanding.empty())
+    {
+        while (key < m_w->records && !m_free.empty())
+        {
+            pending* p = m_free.back();
+            m_free.pop_back();
+            p->type = OP_INSERT;
+            e::pack64le(static_cast<int64_t>(key), p->key);
+            set_value(p);
+            int64_t id = m_cl->put(m_w->space, p->key, sizeof(p->key), &p->attr, 1, &p->status);
+
+            if (id < 0)
+            {
+                m_error = std::string("could not load: ") + m_cl->error_message();
+                return false;
+            }
+
+            m_outstanding[id] = p;
+            key += m_w->threads;
+        }
+
+        if (!m_outstanding.empty() && !loop(LOOP_TIMEOUT_MS, false))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool
+worker :: issue(pending* p, uint64_t intended)
+{
+    uint64_t pick = m_gen.below(m_w->mix.back());
+    size_t type = 0;
+
+    while (pick >= m_w->mix[type])
+    {
+        ++type;
+    }
+
+    p->type = static_cast<op_type>(type);
+    p->intended = intended;
+    p->sent = po6::monotonic_time();
+    p->attrs = NULL;
+
+    // a full window held this op back past its slot in the schedule
+    if (m_w->interval && p->sent > intended + 1000000ULL)
+    {
+        ++late;
+    }
+
+    p->attrs_sz = 0;
+    int64_t id = -1;
+
+    switch (p->type)
+    {
+        case OP_READ:
+            e::pack64le(static_cast<int64_t>(draw_key()), p->key);
+            id = m_cl->get(m_w->space, p->key, sizeof(p->key), &p->status, &p->attrs, &p->attrs_sz);
+            break;
+        case OP_UPDATE:
+            e::pack64le(static_cast<int64_t>(draw_key()), p->key);
+            set_value(p);
+            id = m_cl->put(m_w->space, p->key, sizeof(p->key), &p->attr, 1, &p->status);
+            break;
+        case OP_INSERT:
+            e::pack64le(static_cast<int64_t>(__sync_fetch_and_add(&m_w->next_insert, 1)), p->key);
+            set_value(p);
+            id = m_cl->put(m_w->space, p->key, sizeof(p->key), &p->attr, 1, &p->status);
+            break;
+        case OP_SCAN:
+        {
+            uint64_t first = draw_key();
+            uint64_t length = 1 + m_gen.below(m_w->scan_max);
+            e::pack64le(static_cast<int64_t>(first), p->key);
+            e::pack64le(static_cast<int64_t>(first + length), p->bound);
+            p->check[0].attr = m_w->key_attr;
+            p->check[0].value = p->key;
+            p->check[0].value_sz = sizeof(p->key);
+            p->check[0].datatype = HYPERDATATYPE_INT64;
+            p->check[0].predicate = HYPERPREDICATE_GREATER_EQUAL;
+            p->check[1].attr = m_w->key_attr;
+            p->check[1].value = p->bound;
+            p->check[1].value_sz = sizeof(p->bound);
+            p->check[1].datatype = HYPERDATATYPE_INT64;
+            p->check[1].predicate = HYPERPREDICATE_LESS_THAN;
+            id = m_cl->search(m_w->space, p->check, 2, &p->status, &p->attrs, &p->attrs_sz);
+            break;
+        }
+        case OP_ATOMIC:
+        {
+            static const char one[sizeof(int64_t)] = {1, 0, 0, 0, 0, 0, 0, 0};
+            e::pack64le(static_cast<int64_t>(draw_key()), p->key);
+            p->attr.attr = m_w->counter_attr;
+            p->attr.value = one;
+            p->attr.value_sz = sizeof(one);
+            p->attr.datatype = HYPERDATATYPE_INT64;
+            id = m_cl->atomic_add(m_w->space, p->key, sizeof(p->key), &p->attr, 1, &p->status);
+            break;
+        }
+        case OP_TYPES:
+        default:
+            abort();
+    }
+
+    if (id < 0)
+    {
+        std::ostringstream ostr;
+        ostr << "could not issue " << op_names[p->type] << ": "
+             << p->status << ": " << m_cl->error_message();
+        m_error = ostr.str();
+        return false;
+    }
+
+    m_outstanding[id] = p;
+    return true;
+}
+
+bool
+worker :: loop(int timeout, bool record)
+{
+    hyperdex_client_returncode lrc;
+    int64_t lid = m_cl->loop(timeout, &lrc);
+
+    if (lid < 0)
+    {
+        if (lrc == HYPERDEX_CLIENT_TIMEOUT ||
+            lrc == HYPERDEX_CLIENT_NONEPENDING)
+        {
+            return true;
+        }
+
+        std::ostringstream ostr;
+        ostr << "client loop failed: " << lrc << ": " << m_cl->error_message();
+        m_error = ostr.str();
+        return false;
+    }
+
+    std::map<int64_t, pending*>::iterator it = m_outstanding.find(lid);
+
+    if (it == m_outstanding.end())
+    {
+        return true;
+    }
+
+    pending* p = it->second;
+
+    // a search returns each object on its own and then SEARCHDONE
+    if (p->type == OP_SCAN && p->status == HYPERDEX_CLIENT_SUCCESS)
+    {
+        hyperdex_client_destroy_attrs(p->attrs, p->attrs_sz);
+        p->attrs = NULL;
+        p->attrs_sz = 0;
+        ++scanned;
+        return true;
+    }
+
+    m_outstanding.erase(it);
+    complete(p, record);
+    m_free.push_back(p);
+    return true;
+}
+
+void
+worker :: complete(pending* p, bool record)
+{
+    if (p->attrs)
+    {
+        hyperdex_client_destroy_attrs(p->attrs, p->attrs_sz);
+        p->attrs = NULL;
+        p->attrs_sz = 0;
+    }
+
+    if (!record)
+    {
+        if (p->status != HYPERDEX_CLIENT_SUCCESS)
+        {
+            ++load_errors;
+        }
+
+        return;
+    }
+
+    uint64_t now = po6::monotonic_time();
+    latency[p->type].record(now - p->intended);
+    service[p->type].record(now - p->sent);
+
+    if (p->status == HYPERDEX_CLIENT_NOTFOUND)
+    {
+        ++missing;
+    }
+    else if (p->status != HYPERDEX_CLIENT_SUCCESS &&
+             p->status != HYPERDEX_CLIENT_SEARCHDONE)
+    {
+        ++errors[p->type];
+    }
+}
+
+uint64_t
+worker :: draw_key()
+{
+    if (m_w->zipf_keys)
+    {
+        return m_w->zipf_keys->draw(&m_gen);
+    }
+
+    return m_gen.below(m_w->records);
+}
+
+void
+worker :: set_value(pending* p)
+{
+    uint64_t sz = m_w->value_min;
+
+    if (m_w->zipf_values)
+    {
+        sz += m_w->zipf_values->draw(&m_gen);
+    }
+    else
+    {
+        sz += m_gen.below(m_w->value_max - m_w->value_min + 1);
+    }
+
+    // any window of the pre-generated bytes will do
+    uint64_t off = m_gen.below(m_w->value_bytes.size() - sz + 1);
+    p->attr.attr = m_w->value_attr;
+    p->attr.value = m_w->value_bytes.data() + off;
+    p->attr.value_sz = sz;
+    p->attr.datatype = HYPERDATATYPE_STRING;
+}
+
+// "read=50,update=50" into cumulative weights
+bool
+parse_mix(const char* text, std::vector<uint64_t>* mix)
+{
+    std::vector<uint64_t> weights(OP_TYPES, 0);
+    std::string s(text);
+    size_t pos = 0;
+
+    while (pos <= s.size())
+    {
+        size_t comma = s.find(',', pos);
+        comma = comma == std::string::npos ? s.size() : comma;
+        std::string item = s.substr(pos, comma - pos);
+        size_t eq = item.find('=');
+
+        if (eq == std::string::npos)
+        {
+            return false;
+        }
+
+        std::string name = item.substr(0, eq);
+        char* end = NULL;
+        unsigned long weight = strtoul(item.c_str() + eq + 1, &end, 10);
+
+        if (eq + 1 == item.size() || *end != '\0')
+        {
+            return false;
+        }
+
+        size_t type = 0;
+
+        while (type < OP_TYPES && name != op_names[type])
+        {
+            ++type;
+        }
+
+        if (type == OP_TYPES)
+        {
+            return false;
+        }
+
+        weights[type] = weight;
+        pos = comma + 1;
+    }
+
+    mix->resize(OP_TYPES);
+    uint64_t total = 0;
+
+    for (size_t i = 0; i < OP_TYPES; ++i)
+    {
+        total += weights[i];
+        (*mix)[i] = total;
+    }
+
+    return total > 0;
+}
+
+void
+print_histogram(const char* name, const char* kind, const histogram& h)
+{
+    std::cout << std::setw(8) << std::left << name
+              << std::setw(9) << kind << std::right
+              << " p50=" << std::setw(9) << h.quantile(0.5) / 1000.
+              << " p90=" << std::setw(9) << h.quantile(0.9) / 1000.
+              << " p99=" << std::setw(9) << h.quantile(0.99) / 1000.
+              << " p99.9=" << std::setw(9) << h.quantile(0.999) / 1000.
+              << " max=" << std::setw(9) << h.max() / 1000. << " (us)\n";
+}
+
+} // namespace
+
+int
+main(int argc, const char* argv[])
+{
+    long threads = 1;
+    long window = 64;
+    long records = 100000;
+    long duration = 10;
+    long rate = 0;
+    const char* mix_text = "read=50,update=50";
+    const char* distribution = "zipfian";
+    const char* theta_text = "0.99";
+    long value_min = 100;
+    long value_max = 100;
+    const char* value_distribution = "uniform";
+    long scan_max = 100;
+    const char* key_attr = "k";
+    const char* value_attr = "v";
+    const char* counter_attr = "count";
+    bool load = false;
+    hyperdex::connect_opts conn;
+    e::argparser ap;
+    ap.autohelp();
+    ap.option_string("[OPTIONS] <space>");
+    ap.arg().name('t', "threads")
+            .description("run this many client threads (default: 1)")
+            .metavar("N").as_long(&threads);
+    ap.arg().name('w', "window")
+            .description("keep up to this many operations outstanding per thread (default: 64)")
+            .metavar("N").as_long(&window);
+    ap.arg().name('n', "records")
+            .description("read, update and scan keys 0 through N-1 (default: 100000)")
+            .metavar("N").as_long(&records);
+    ap.arg().name('d', "duration")
+            .description("measure for this many seconds (default: 10)")
+            .metavar("S").as_long(&duration);
+    ap.arg().name('r', "rate")
+            .description("send this many operations per second across all threads; 0 sends as fast as the window allows (default: 0)")
+            .metavar("N").as_long(&rate);
+    ap.arg().name('m', "mix")
+            .description("relative weights of read, update, insert, scan and atomic operations (default: read=50,update=50)")
+            .metavar("MIX").as_string(&mix_text);
+    ap.arg().long_name("distribution")
+            .description("pick keys from a \"zipfian\" or \"uniform\" distribution (default: zipfian)")
+            .metavar("D").as_string(&distribution);
+    ap.arg().long_name("theta")
+            .description("skew of the zipfian distributions, between 0 and 1 (default: 0.99)")
+            .metavar("T").as_string(&theta_text);
+    ap.arg().long_name("value-min")
+            .description("write values of at least this many bytes (default: 100)")
+            .metavar("B").as_long(&value_min);
+    ap.arg().long_name("value-max")
+            .description("write values of at most this many bytes (default: 100)")
+            .metavar("B").as_long(&value_max);
+    ap.arg().long_name("value-distribution")
+            .description("pick value sizes from a \"uniform\" distribution or a \"zipfian\" one favoring small values (default: uniform)")
+            .metavar("D").as_string(&value_distribution);
+    ap.arg().long_name("scan-length")
+            .description("scan up to this many consecutive keys (default: 100)")
+            .metavar("N").as_long(&scan_max);
+    ap.arg().long_name("key")
+            .description("name of the space's int key (default: k)")
+            .metavar("attr").as_string(&key_attr);
+    ap.arg().long_name("value")
+            .description("name of the string attribute to write (default: v)")
+            .metavar("attr").as_string(&value_attr);
+    ap.arg().long_name("counter")
+            .description("name of the int attribute atomic operations increment (default: count)")
+            .metavar("attr").as_string(&counter_attr);
+    ap.arg().name('l', "load")
+            .description("write every record before measuring")
+            .set_true(&load);
+    ap.add("Connect to a cluster:", conn.parser());
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!conn.validate())
+    {
+        std::cerr << "invalid host:port specification\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() != 1)
+    {
+        std::cerr << "specify the space to benchmark" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (threads <= 0 || window <= 0 || records <= 0 || scan_max <= 0)
+    {
+        std::cerr << "the threads, window, records and scan length must be positive" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (duration < 0 || rate < 0)
+    {
+        std::cerr << "the duration and rate cannot be negative" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (value_min < 0 || value_max < value_min)
+    {
+        std::cerr << "the value sizes must satisfy 0 <= min <= max" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    char* end = NULL;
+    double theta = strtod(theta_text, &end);
+
+    if (*end != '\0' || theta <= 0 || theta >= 1)
+    {
+        std::cerr << "theta must be strictly between 0 and 1" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    bool zipf_keys = strcmp(distribution, "zipfian") == 0;
+    bool zipf_values = strcmp(value_distribution, "zipfian") == 0;
+
+    if ((!zipf_keys && strcmp(distribution, "uniform") != 0) ||
+        (!zipf_values && strcmp(value_distribution, "uniform") != 0))
+    {
+        std::cerr << "distributions must be \"zipfian\" or \"uniform\"" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    workload w;
+
+    if (!parse_mix(mix_text, &w.mix))
+    {
+        std::cerr << "the mix must look like read=50,update=50 and have a positive weight" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    std::auto_ptr<zipfian> key_dist;
+    std::auto_ptr<zipfian> value_dist;
+
+    if (zipf_keys)
+    {
+        key_dist.reset(new zipfian(records, theta));
+    }
+
+    if (zipf_values)
+    {
+        value_dist.reset(new zipfian(value_max - value_min + 1, theta));
+    }
+
+    po6::threads::barrier barrier(threads + 1);
+    w.host = conn.host();
+    w.port = conn.port();
+    w.space = ap.args()[0];
+    w.key_attr = key_attr;
+    w.value_attr = value_attr;
+    w.counter_attr = counter_attr;
+    w.records = records;
+    w.zipf_keys = key_dist.get();
+    w.value_min = value_min;
+    w.value_max = value_max;
+    w.zipf_values = value_dist.get();
+    w.scan_max = scan_max;
+    w.window = window;
+    w.threads = threads;
+    w.interval = rate ? 1000000000ULL * threads / rate : 0;
+    w.load = load;
+    w.next_insert = records;
+    w.barrier = &barrier;
+    generator g(po6::monotonic_time());
+
+    for (long i = 0; i < 2 * value_max; ++i)
+    {
+        w.value_bytes.push_back('a' + g.below(26));
+    }
+
+    std::vector<e::compat::shared_ptr<worker> > workers;
+    std::vector<e::compat::shared_ptr<po6::threads::thread> > ts;
+
+    for (long i = 0; i < threads; ++i)
+    {
+        e::compat::shared_ptr<worker> wk(new worker(&w, i));
+        e::compat::shared_ptr<po6::threads::thread> t(new po6::threads::thread(make_obj_func(&worker::run, wk.get())));
+        workers.push_back(wk);
+        ts.push_back(t);
+    }
+
+    for (size_t i = 0; i < ts.size(); ++i)
+    {
+        ts[i]->start();
+    }
+
+    // the workers load (if asked) before the barrier, so the clock starts
+    // once every one of them is ready
+    w.start = po6::monotonic_time() + 1000000ULL;
+    w.end = w.start + duration * 1000000000ULL;
+    barrier.wait();
+
+    for (size_t i = 0; i < ts.size(); ++i)
+    {
+        ts[i]->join();
+    }
+
+    bool failed = false;
+    histogram latency[OP_TYPES];
+    histogram service[OP_TYPES];
+    uint64_t errors[OP_TYPES] = {0};
+    uint64_t load_errors = 0;
+    uint64_t missing = 0;
+    uint64_t scanned = 0;
+    uint64_t late = 0;
+
+    for (size_t i = 0; i < workers.size(); ++i)
+    {
+        if (!workers[i]->error().empty())
+        {
+            std::cerr << "thread " << i << ": " << workers[i]->error() << std::endl;
+            failed = true;
+        }
+
+        for (size_t j = 0; j < OP_TYPES; ++j)
+        {
+            latency[j].merge(workers[i]->latency[j]);
+            service[j].merge(workers[i]->service[j]);
+            errors[j] += workers[i]->errors[j];
+        }
+
+        load_errors += workers[i]->load_errors;
+        missing += workers[i]->missing;
+        scanned += workers[i]->scanned;
+        late += workers[i]->late;
+    }
+
+    uint64_t total = 0;
+
+    for (size_t j = 0; j < OP_TYPES; ++j)
+    {
+        total += latency[j].count();
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+
+    if (load)
+    {
+        std::cout << "loaded=" << records - load_errors << " failed=" << load_errors << "\n";
+    }
+
+    std::cout << "ops=" << total << " seconds=" << duration;
+
+    if (duration > 0)
+    {
+        std::cout << " throughput=" << static_cast<double>(total) / duration << "/s";
+    }
+
+    std::cout << " missing=" << missing << " scanned=" << scanned
+              << " late=" << late << "\n";
+
+    for (size_t j = 0; j < OP_TYPES; ++j)
+    {
+        if (latency[j].count() == 0 && errors[j] == 0)
+        {
+            continue;
+        }
+
+        std::cout << std::setw(8) << std::left << op_names[j] << std::right
+                  << "count=" << latency[j].count() << " errors=" << errors[j] << "\n";
+        print_histogram("", "latency", latency[j]);
+        print_histogram("", "service", service[j]);
+    }
+
+    std::cout << std::flush;
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
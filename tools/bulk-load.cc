@@ -0,0 +1,463 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+// STL
+#include <fstream>
+#include <map>
+#include <memory>
+#include <vector>
+
+// e
+#include <e/endian.h>
+
+// HyperDex
+#include <hyperdex/client.hpp>
+#include "tools/common.h"
+
+// Read one CSV record.  Fields may be quoted with '"', in which case they may
+// contain commas, newlines, and '""' for a literal quote.
+static bool
+read_record(std::istream& in, std::vector<std::string>* fields)
+{
+    fields->clear();
+    int c = in.get();
+
+    if (c == EOF)
+    {
+        return false;
+    }
+
+    std::string field;
+    bool quoted = false;
+
+    while (true)
+    {
+        if (c == EOF)
+        {
+            fields->push_back(field);
+            return true;
+        }
+        else if (quoted && c == '"')
+        {
+            if (in.peek() == '"')
+            {
+                field.push_back('"');
+                in.get();
+            }
+            else
+            {
+                quoted = false;
+            }
+        }
+        else if (quoted)
+        {
+            field.push_back(c);
+        }
+        else if (c == '"')
+        {
+            quoted = true;
+        }
+        else if (c == ',')
+        {
+            fields->push_back(field);
+            field.clear();
+        }
+        else if (c == '\n')
+        {
+            fields->push_back(field);
+            return true;
+        }
+        else if (c != '\r')
+        {
+            field.push_back(c);
+        }
+
+        c = in.get();
+    }
+}
+
+static bool
+supported_type(hyperdatatype t)
+{
+    return t == HYPERDATATYPE_STRING ||
+           t == HYPERDATATYPE_INT64 ||
+           t == HYPERDATATYPE_FLOAT ||
+           t == HYPERDATATYPE_DOCUMENT ||
+           CONTAINER_TYPE(t) == HYPERDATATYPE_TIMESTAMP_GENERIC;
+}
+
+// Turn the text of a field into the bytes HyperDex expects for type t and
+// hand back the type to send it as.
+static bool
+encode_field(hyperdatatype t, const std::string& text, std::string* value, hyperdatatype* as)
+{
+    if (t == HYPERDATATYPE_INT64 ||
+        CONTAINER_TYPE(t) == HYPERDATATYPE_TIMESTAMP_GENERIC)
+    {
+        char* end = NULL;
+        long long x = strtoll(text.c_str(), &end, 0);
+
+        if (text.empty() || *end != '\0')
+        {
+            return false;
+        }
+
+        char buf[sizeof(int64_t)];
+        e::pack64le(static_cast<int64_t>(x), buf);
+        value->assign(buf, sizeof(buf));
+        *as = t;
+        return true;
+    }
+    else if (t == HYPERDATATYPE_FLOAT)
+    {
+        char* end = NULL;
+        double x = strtod(text.c_str(), &end);
+
+        if (text.empty() || *end != '\0')
+        {
+            return false;
+        }
+
+        char buf[sizeof(double)];
+        e::packdoublele(x, buf);
+        value->assign(buf, sizeof(buf));
+        *as = HYPERDATATYPE_FLOAT;
+        return true;
+    }
+
+    *value = text;
+    *as = t;
+    return true;
+}
+
+namespace
+{
+
+// The rows of one put_many call.  Everything the client points into lives
+// here until the call completes.
+struct batch
+{
+    batch() : rows(), keys(), values(), types(), columns(), key_ptrs(), key_szs(),
+              attrs(), attr_ptrs(), attrs_szs(), status(), statuses() {}
+    void prepare(const std::vector<std::string>& names);
+
+    std::vector<uint64_t> rows;
+    std::vector<std::string> keys;
+    // one entry per non-empty field, row by row
+    std::vector<std::string> values;
+    std::vector<hyperdatatype> types;
+    std::vector<size_t> columns;
+    std::vector<const char*> key_ptrs;
+    std::vector<size_t> key_szs;
+    std::vector<hyperdex_client_attribute> attrs;
+    std::vector<const hyperdex_client_attribute*> attr_ptrs;
+    std::vector<size_t> attrs_szs;
+    hyperdex_client_returncode status;
+    std::vector<hyperdex_client_returncode> statuses;
+
+    private:
+        batch(const batch&);
+        batch& operator = (const batch&);
+};
+
+// Point the client-facing arrays at the rows once they have stopped growing.
+void
+batch :: prepare(const std::vector<std::string>& names)
+{
+    key_ptrs.resize(keys.size());
+    key_szs.resize(keys.size());
+    attrs.resize(values.size());
+    attr_ptrs.resize(keys.size());
+    statuses.resize(keys.size());
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        key_ptrs[i] = keys[i].data();
+        key_szs[i] = keys[i].size();
+    }
+
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        attrs[i].attr = names[columns[i]].c_str();
+        attrs[i].value = values[i].data();
+        attrs[i].value_sz = values[i].size();
+        attrs[i].datatype = types[i];
+    }
+
+    size_t off = 0;
+
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        attr_ptrs[i] = attrs.empty() ? NULL : &attrs[0] + off;
+        off += attrs_szs[i];
+    }
+}
+
+} // namespace
+
+int
+main(int argc, const char* argv[])
+{
+    long batch_size = 1024;
+    long window = 4;
+    hyperdex::connect_opts conn;
+    e::argparser ap;
+    ap.autohelp();
+    ap.option_string("[OPTIONS] <space> <csv-file>");
+    ap.arg().name('b', "batch-size")
+            .description("put this many objects with each call (default: 1024)")
+            .metavar("N").as_long(&batch_size);
+    ap.arg().name('w', "window")
+            .description("keep this many calls outstanding at once (default: 4)")
+            .metavar("N").as_long(&window);
+    ap.add("Connect to a cluster:", conn.parser());
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!conn.validate())
+    {
+        std::cerr << "invalid host:port specification\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() != 2)
+    {
+        std::cerr << "specify the space to load and the CSV file to load it from" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (batch_size <= 0 || window <= 0)
+    {
+        std::cerr << "the batch size and window must be positive" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    const char* space = ap.args()[0];
+    std::ifstream fin;
+    std::istream* in = &std::cin;
+
+    if (strcmp(ap.args()[1], "-") != 0)
+    {
+        fin.open(ap.args()[1], std::ios::in | std::ios::binary);
+
+        if (!fin)
+        {
+            std::cerr << "could not open " << ap.args()[1] << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        in = &fin;
+    }
+
+    try
+    {
+        hyperdex::Client h(conn.host(), conn.port());
+        std::vector<std::string> names;
+
+        if (!read_record(*in, &names) || names.empty())
+        {
+            std::cerr << "the CSV file must start with a header naming the key and attributes" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        // the first column is the key; the rest are attributes
+        std::vector<hyperdatatype> types(names.size());
+
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            hyperdex_client_returncode rc;
+            types[i] = h.attribute_type(space, names[i].c_str(), &rc);
+
+            if (types[i] == HYPERDATATYPE_GARBAGE)
+            {
+                std::cerr << "could not load column \"" << names[i] << "\": "
+                          << rc << ": " << h.error_message() << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            if (!supported_type(types[i]))
+            {
+                std::cerr << "column \"" << names[i] << "\" has a type that "
+                          << "cannot be loaded from CSV" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        std::map<int64_t, batch*> outstanding;
+        std::vector<std::string> fields;
+        uint64_t row = 0;
+        uint64_t loaded = 0;
+        uint64_t failed = 0;
+        bool more = true;
+
+        while (more || !outstanding.empty())
+        {
+            while (more && outstanding.size() < static_cast<size_t>(window))
+            {
+                std::auto_ptr<batch> b(new batch());
+
+                while (b->keys.size() < static_cast<size_t>(batch_size) &&
+                       (more = read_record(*in, &fields)))
+                {
+                    ++row;
+
+                    if (fields.size() == 1 && fields[0].empty())
+                    {
+                        continue;
+                    }
+
+                    if (fields.size() != names.size())
+                    {
+                        std::cerr << "row " << row << " has " << fields.size()
+                                  << " fields, but the header has " << names.size() << std::endl;
+                        return EXIT_FAILURE;
+                    }
+
+                    std::string key;
+                    hyperdatatype as;
+
+                    if (!encode_field(types[0], fields[0], &key, &as))
+                    {
+                        std::cerr << "row " << row << " has a malformed key" << std::endl;
+                        return EXIT_FAILURE;
+                    }
+
+                    b->rows.push_back(row);
+                    b->keys.push_back(key);
+                    size_t present = 0;
+
+                    for (size_t i = 1; i < fields.size(); ++i)
+                    {
+                        // leave empty fields at the attribute's default
+                        if (fields[i].empty())
+                        {
+                            continue;
+                        }
+
+                        std::string value;
+
+                        if (!encode_field(types[i], fields[i], &value, &as))
+                        {
+                            std::cerr << "row " << row << " has a malformed value for \""
+                                      << names[i] << "\"" << std::endl;
+                            return EXIT_FAILURE;
+                        }
+
+                        b->values.push_back(value);
+                        b->types.push_back(as);
+                        b->columns.push_back(i);
+                        ++present;
+                    }
+
+                    b->attrs_szs.push_back(present);
+                }
+
+                if (b->keys.empty())
+                {
+                    break;
+                }
+
+                b->prepare(names);
+                int64_t id = h.put_many(space, &b->key_ptrs[0], &b->key_szs[0],
+                                        &b->attr_ptrs[0], &b->attrs_szs[0],
+                                        b->keys.size(), &b->status, &b->statuses[0]);
+
+                if (id < 0)
+                {
+                    std::cerr << "could not load rows starting at " << b->rows[0]
+                              << ": " << b->status << ": " << h.error_message() << std::endl;
+                    return EXIT_FAILURE;
+                }
+
+                outstanding[id] = b.release();
+            }
+
+            if (outstanding.empty())
+            {
+                break;
+            }
+
+            hyperdex_client_returncode lrc;
+            int64_t lid = h.loop(-1, &lrc);
+
+            if (lid < 0)
+            {
+                std::cerr << "could not load rows: " << lrc << ": " << h.error_message() << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            std::map<int64_t, batch*>::iterator it = outstanding.find(lid);
+
+            if (it == outstanding.end())
+            {
+                continue;
+            }
+
+            std::auto_ptr<batch> b(it->second);
+            outstanding.erase(it);
+
+            for (size_t i = 0; i < b->statuses.size(); ++i)
+            {
+                if (b->statuses[i] == HYPERDEX_CLIENT_SUCCESS)
+                {
+                    ++loaded;
+                }
+                else
+                {
+                    ++failed;
+                    std::cerr << "row " << b->rows[i] << " failed: " << b->statuses[i] << std::endl;
+                }
+            }
+        }
+
+        std::cout << "loaded " << loaded << " objects";
+
+        if (failed)
+        {
+            std::cout << "; " << failed << " failed";
+        }
+
+        std::cout << std::endl;
+        return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,289 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <cassert>
+#include <cstdlib>
+#include <stdint.h>
+
+// STL
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/threads/thread.h>
+
+// e
+#include <e/compat.h>
+
+// HyperDex
+#include <hyperdex/admin.hpp>
+#include "tools/common.h"
+
+using po6::threads::make_obj_func;
+
+// one daemon's part of the export, run on a thread of its own so that every
+// daemon exports at once
+class exporter
+{
+    public:
+        exporter(const std::string& h, uint16_t p,
+                 const char* s, const char* n, uint64_t r, bool c)
+            : host(h), port(p), space(s), name(n), rate(r), compress(c)
+            , rc(HYPERDEX_ADMIN_SUCCESS), path(), objects(0), bytes(0) {}
+        ~exporter() throw () {}
+
+    public:
+        void run()
+        {
+            char* dir = NULL;
+
+            if (hyperdex_admin_raw_export(host.c_str(), port, space, name,
+                                          rate, compress ? 1 : 0,
+                                          &rc, &dir, &objects, &bytes) < 0)
+            {
+                return;
+            }
+
+            path = dir;
+            free(dir);
+        }
+
+    public:
+        const std::string host;
+        const uint16_t port;
+        const char* const space;
+        const char* const name;
+        const uint64_t rate;
+        const bool compress;
+        hyperdex_admin_returncode rc;
+        std::string path;
+        uint64_t objects;
+        uint64_t bytes;
+
+    private:
+        exporter(const exporter&);
+        exporter& operator = (const exporter&);
+};
+
+// the address of every available server in the output of dump_config
+static bool
+parse_servers(const char* config, std::vector<std::pair<std::string, uint16_t> >* servers)
+{
+    std::istringstream istr(config);
+    std::string line;
+
+    while (std::getline(istr, line))
+    {
+        std::istringstream ls(line);
+        std::string kind;
+        uint64_t id;
+        std::string addr;
+        std::string state;
+
+        if (!(ls >> kind) || kind != "server")
+        {
+            continue;
+        }
+
+        if (!(ls >> id >> addr >> state))
+        {
+            return false;
+        }
+
+        if (state != "AVAILABLE")
+        {
+            continue;
+        }
+
+        size_t colon = addr.rfind(':');
+
+        if (colon == std::string::npos)
+        {
+            return false;
+        }
+
+        std::string host(addr.substr(0, colon));
+        long port = atol(addr.c_str() + colon + 1);
+
+        if (host.size() >= 2 && host[0] == '[' && host[host.size() - 1] == ']')
+        {
+            host = host.substr(1, host.size() - 2);
+        }
+
+        if (port <= 0 || port >= (1 << 16))
+        {
+            return false;
+        }
+
+        servers->push_back(std::make_pair(host, static_cast<uint16_t>(port)));
+    }
+
+    return true;
+}
+
+int
+main(int argc, const char* argv[])
+{
+    hyperdex::connect_opts conn;
+    const char* space = NULL;
+    long rate = 0;
+    bool no_compress = false;
+    e::argparser ap;
+    ap.autohelp();
+    ap.option_string("[OPTIONS] <name>");
+    ap.arg().name('s', "space")
+            .description("export the objects of this space (required)")
+            .metavar("space").as_string(&space);
+    ap.arg().name('r', "rate")
+            .description("limit each daemon to reading this many MB/s (default: no limit)")
+            .metavar("MB").as_long(&rate);
+    ap.arg().long_name("no-compress")
+            .description("leave the columns uncompressed so they can be mapped in place")
+            .set_true(&no_compress);
+    ap.add("Connect to a cluster:", conn.parser());
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!conn.validate())
+    {
+        std::cerr << "invalid host:port specification\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (!space)
+    {
+        std::cerr << "please specify the space to export\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (rate < 0)
+    {
+        std::cerr << "the rate must not be negative\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() != 1)
+    {
+        std::cerr << "command requires the export's name\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        hyperdex::Admin h(conn.host(), conn.port());
+        hyperdex_admin_returncode rrc;
+        const char* config = NULL;
+        int64_t rid = h.dump_config(&rrc, &config);
+
+        if (rid < 0)
+        {
+            std::cerr << "could not read the config: " << h.error_message() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        hyperdex_admin_returncode lrc;
+        int64_t lid = h.loop(-1, &lrc);
+
+        if (lid < 0 || rrc != HYPERDEX_ADMIN_SUCCESS)
+        {
+            std::cerr << "could not read the config: " << h.error_message() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        assert(rid == lid);
+        std::vector<std::pair<std::string, uint16_t> > servers;
+
+        if (!parse_servers(config, &servers))
+        {
+            std::cerr << "could not make sense of the config" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        const uint64_t bytes_per_sec = static_cast<uint64_t>(rate) * 1024ULL * 1024ULL;
+        std::vector<e::compat::shared_ptr<exporter> > exporters;
+        std::vector<e::compat::shared_ptr<po6::threads::thread> > ts;
+
+        for (size_t i = 0; i < servers.size(); ++i)
+        {
+            e::compat::shared_ptr<exporter> ex(new exporter(servers[i].first, servers[i].second,
+                                                            space, ap.args()[0],
+                                                            bytes_per_sec, !no_compress));
+            e::compat::shared_ptr<po6::threads::thread> t(new po6::threads::thread(make_obj_func(&exporter::run, ex.get())));
+            exporters.push_back(ex);
+            ts.push_back(t);
+            t->start();
+        }
+
+        bool failed = false;
+        uint64_t objects = 0;
+
+        for (size_t i = 0; i < ts.size(); ++i)
+        {
+            ts[i]->join();
+            const exporter& ex(*exporters[i]);
+            std::cout << ex.host << ":" << ex.port << " ";
+
+            if (ex.rc == HYPERDEX_ADMIN_SUCCESS)
+            {
+                std::cout << ex.path << " " << ex.objects << " objects "
+                          << ex.bytes << " bytes" << std::endl;
+                objects += ex.objects;
+            }
+            else
+            {
+                std::cout << "failed: " << ex.rc << std::endl;
+                failed = true;
+            }
+        }
+
+        if (failed)
+        {
+            std::cerr << "the export is incomplete" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::cerr << "exported " << objects << " objects from "
+                  << servers.size() << " servers" << std::endl;
+        return EXIT_SUCCESS;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,255 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// STL
+#include <iomanip>
+#include <iostream>
+
+// e
+#include <e/popt.h>
+
+// HyperDex
+#include <hyperdex/admin.hpp>
+
+class connect_opts
+{
+    public:
+        connect_opts()
+            : m_ap() , m_host("127.0.0.1") , m_port(2012)
+        {
+            m_ap.arg().name('h', "host")
+                      .description("connect to the daemon on an IP address or hostname (default: 127.0.0.1)")
+                      .metavar("addr").as_string(&m_host);
+            m_ap.arg().name('p', "port")
+                      .description("connect to the daemon on an alternative port (default: 2012)")
+                      .metavar("port").as_long(&m_port);
+        }
+        ~connect_opts() throw () {}
+
+    public:
+        const e::argparser& parser() { return m_ap; }
+        const char* host() { return m_host; }
+        uint16_t port() { return m_port; }
+        bool validate()
+        {
+            if (m_port <= 0 || m_port >= (1 << 16))
+            {
+                std::cerr << "port number to connect to is out of range" << std::endl;
+                return false;
+            }
+
+            return true;
+        }
+
+        private:
+            connect_opts(const connect_opts&);
+            connect_opts& operator = (const connect_opts&);
+
+    private:
+        e::argparser m_ap;
+        const char* m_host;
+        long m_port;
+};
+
+// parse "HH:MM-HH:MM", or "always" for a window that never closes
+static bool
+parse_window(const char* window, uint16_t* start, uint16_t* end)
+{
+    if (strcmp(window, "always") == 0)
+    {
+        *start = 0;
+        *end = 0;
+        return true;
+    }
+
+    unsigned sh, sm, eh, em;
+    char trailing;
+
+    if (sscanf(window, "%u:%u-%u:%u%c", &sh, &sm, &eh, &em, &trailing) != 4 ||
+        sh >= 24 || sm >= 60 || eh >= 24 || em >= 60)
+    {
+        return false;
+    }
+
+    *start = sh * 60 + sm;
+    *end = eh * 60 + em;
+    return true;
+}
+
+static void
+print_minute(uint16_t minute)
+{
+    std::cout << std::setw(2) << std::setfill('0') << minute / 60 << ":"
+              << std::setw(2) << std::setfill('0') << minute % 60;
+}
+
+int
+main(int argc, const char* argv[])
+{
+    connect_opts conn;
+    const char* window = NULL;
+    long budget = -1;
+    long region = 0;
+    e::argparser ap;
+    ap.autohelp();
+    ap.option_string("[OPTIONS]");
+    ap.arg().name('w', "window")
+            .description("collect checkpoints and build indices only from HH:MM to HH:MM UTC, or \"always\"")
+            .metavar("HH:MM-HH:MM").as_string(&window);
+    ap.arg().name('b', "budget")
+            .description("spend at most this many MB per second on maintenance and wiping (0 for no limit)")
+            .metavar("MB").as_long(&budget);
+    ap.arg().name('c', "compact")
+            .description("compact the region with this id in the background")
+            .metavar("REGION").as_long(&region);
+    ap.add("Connect to a daemon:", conn.parser());
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!conn.validate())
+    {
+        std::cerr << "invalid host:port specification\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    uint16_t start = 0;
+    uint16_t end = 0;
+
+    if (window && !parse_window(window, &start, &end))
+    {
+        std::cerr << "the window must look like 22:00-04:30, or be \"always\"" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (region < 0)
+    {
+        std::cerr << "region ids are positive" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() != 0)
+    {
+        std::cerr << "command takes no positional arguments" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        hyperdex_admin_returncode rc;
+        uint16_t cur_start = 0;
+        uint16_t cur_end = 0;
+        uint64_t cur_budget = 0;
+
+        // read the settings first, so that one may change without the other
+        if (hyperdex_admin_raw_maintenance(conn.host(), conn.port(), 0, 0, &rc,
+                                           &cur_start, &cur_end, &cur_budget) < 0)
+        {
+            std::cerr << "could not reach the daemon: " << rc << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        if (window)
+        {
+            cur_start = start;
+            cur_end = end;
+        }
+
+        if (budget >= 0)
+        {
+            cur_budget = static_cast<uint64_t>(budget) * 1024ULL * 1024ULL;
+        }
+
+        const int set = window || budget >= 0;
+
+        if ((set || region) &&
+            hyperdex_admin_raw_maintenance(conn.host(), conn.port(), set, region, &rc,
+                                           &cur_start, &cur_end, &cur_budget) < 0)
+        {
+            if (rc == HYPERDEX_ADMIN_NOTFOUND)
+            {
+                std::cerr << "the daemon holds no region " << region << std::endl;
+            }
+            else
+            {
+                std::cerr << "could not change the daemon's maintenance: " << rc << std::endl;
+            }
+
+            return EXIT_FAILURE;
+        }
+
+        std::cout << "window: ";
+
+        if (cur_start == cur_end)
+        {
+            std::cout << "always";
+        }
+        else
+        {
+            print_minute(cur_start);
+            std::cout << "-";
+            print_minute(cur_end);
+            std::cout << " UTC";
+        }
+
+        std::cout << "\nbudget: ";
+
+        if (cur_budget == 0)
+        {
+            std::cout << "unlimited";
+        }
+        else
+        {
+            std::cout << std::setfill(' ') << cur_budget << " bytes/s";
+        }
+
+        std::cout << std::endl;
+
+        if (region)
+        {
+            std::cout << "compacting region " << region << std::endl;
+        }
+
+        return EXIT_SUCCESS;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -27,6 +27,7 @@
 
 // C
 #include <cstdlib>
+#include <cstring>
 
 // e
 #include <e/guard.h>
@@ -39,8 +40,12 @@ int
 main(int argc, const char* argv[])
 {
     hyperdex::connect_opts conn;
+    const char* prefix = "";
     e::argparser ap;
     ap.autohelp();
+    ap.arg().name('p', "prefix")
+            .description("only show counters whose names start with this, e.g. \"space.\" or \"region.\"")
+            .metavar("prefix").as_string(&prefix);
     ap.add("Connect to a cluster:", conn.parser());
 
     if (!ap.parse(argc, argv))
@@ -82,6 +87,12 @@ main(int argc, const char* argv[])
 
             assert(lid==pid);
             assert(prc == HYPERDEX_ADMIN_SUCCESS);
+
+            if (strncmp(pc.property, prefix, strlen(prefix)) != 0)
+            {
+                continue;
+            }
+
             std::cout << pc.id << " " << pc.time << " " << pc.property << " = " << pc.measurement << std::endl;
         }
 
@@ -0,0 +1,609 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <assert.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <time.h>
+
+// STL
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/time.h>
+
+// HyperDex
+#include <hyperdex/client.hpp>
+#include "tools/common.h"
+
+namespace
+{
+
+// One change read from the source, copied out of the client's memory so it
+// can be applied (and re-applied) after the next change is read.
+struct change
+{
+    change() : deleted(false), key(), names(), values(), types(),
+               ts(-1), attrs(), check() {}
+    void prepare();
+
+    bool deleted;
+    std::string key;
+    std::vector<std::string> names;
+    std::vector<std::string> values;
+    std::vector<hyperdatatype> types;
+    // the index of the timestamp attribute, or -1
+    long ts;
+    std::vector<hyperdex_client_attribute> attrs;
+    hyperdex_client_attribute_check check;
+};
+
+// Point the client-facing arrays at the copies once they have stopped
+// growing.
+void
+change :: prepare()
+{
+    attrs.resize(names.size());
+
+    for (size_t i = 0; i < names.size(); ++i)
+    {
+        attrs[i].attr = names[i].c_str();
+        attrs[i].value = values[i].data();
+        attrs[i].value_sz = values[i].size();
+        attrs[i].datatype = types[i];
+    }
+
+    if (ts >= 0)
+    {
+        // the destination's copy must be older for this change to win
+        check.attr = names[ts].c_str();
+        check.value = values[ts].data();
+        check.value_sz = values[ts].size();
+        check.datatype = types[ts];
+        check.predicate = HYPERPREDICATE_LESS_THAN;
+    }
+}
+
+// a change being applied to one key, and the newest change to that key that
+// arrived while it was in flight
+struct applying
+{
+    applying() : status(), current(), next() {}
+    ~applying() throw () {}
+
+    hyperdex_client_returncode status;
+    std::auto_ptr<change> current;
+    std::auto_ptr<change> next;
+
+    private:
+        applying(const applying&);
+        applying& operator = (const applying&);
+};
+
+struct pass_stats
+{
+    pass_stats() : changes(0), puts(0), deletes(0), conflicts(0),
+                   coalesced(0), failed(0) {}
+    uint64_t changes;
+    uint64_t puts;
+    uint64_t deletes;
+    // puts that lost to a newer copy at the destination
+    uint64_t conflicts;
+    // changes overtaken by a newer change to the same key before being sent
+    uint64_t coalesced;
+    uint64_t failed;
+};
+
+class replicator
+{
+    public:
+        replicator(hyperdex::Client* dst, const char* space,
+                   const char* ts_attr, size_t window);
+        ~replicator() throw ();
+
+    public:
+        bool full() const { return m_inflight.size() >= m_window; }
+        bool idle() const { return m_inflight.empty(); }
+        // take a change as the source yields it
+        void add(const hyperdex_client_attribute* attrs, size_t attrs_sz,
+                 bool deleted, pass_stats* stats);
+        // wait for one change to finish at the destination; false if the
+        // destination client itself failed
+        bool reap(pass_stats* stats);
+
+    private:
+        bool send(const std::string& key, applying* a, pass_stats* stats);
+
+    private:
+        hyperdex::Client* m_dst;
+        const char* m_space;
+        const char* m_ts_attr;
+        size_t m_window;
+        std::map<std::string, applying*> m_inflight;
+        std::map<int64_t, std::string> m_ids;
+
+    private:
+        replicator(const replicator&);
+        replicator& operator = (const replicator&);
+};
+
+replicator :: replicator(hyperdex::Client* dst, const char* space,
+                         const char* ts_attr, size_t window)
+    : m_dst(dst)
+    , m_space(space)
+    , m_ts_attr(ts_attr)
+    , m_window(window)
+    , m_inflight()
+    , m_ids()
+{
+}
+
+replicator :: ~replicator() throw ()
+{
+    for (std::map<std::string, applying*>::iterator it = m_inflight.begin();
+            it != m_inflight.end(); ++it)
+    {
+        delete it->second;
+    }
+}
+
+void
+replicator :: add(const hyperdex_client_attribute* attrs, size_t attrs_sz,
+                  bool deleted, pass_stats* stats)
+{
+    assert(attrs_sz > 0);
+    std::auto_ptr<change> c(new change());
+    c->deleted = deleted;
+    // the key always comes first
+    c->key.assign(attrs[0].value, attrs[0].value_sz);
+
+    for (size_t i = 1; !deleted && i < attrs_sz; ++i)
+    {
+        if (m_ts_attr && strcmp(attrs[i].attr, m_ts_attr) == 0)
+        {
+            c->ts = static_cast<long>(c->names.size());
+        }
+
+        c->names.push_back(attrs[i].attr);
+        c->values.push_back(std::string(attrs[i].value, attrs[i].value_sz));
+        c->types.push_back(attrs[i].datatype);
+    }
+
+    c->prepare();
+    ++stats->changes;
+    std::map<std::string, applying*>::iterator it = m_inflight.find(c->key);
+
+    // changes to one key must land in the order the source made them; only
+    // the newest of those that pile up behind the one in flight matters
+    if (it != m_inflight.end())
+    {
+        if (it->second->next.get())
+        {
+            ++stats->coalesced;
+        }
+
+        it->second->next = c;
+        return;
+    }
+
+    std::string key(c->key);
+    std::auto_ptr<applying> a(new applying());
+    a->current = c;
+
+    if (send(key, a.get(), stats))
+    {
+        m_inflight[key] = a.release();
+    }
+}
+
+bool
+replicator :: reap(pass_stats* stats)
+{
+    hyperdex_client_returncode lrc;
+    int64_t lid = m_dst->loop(-1, &lrc);
+
+    if (lid < 0)
+    {
+        std::cerr << "could not apply changes: " << lrc << ": "
+                  << m_dst->error_message() << std::endl;
+        return false;
+    }
+
+    std::map<int64_t, std::string>::iterator id = m_ids.find(lid);
+
+    if (id == m_ids.end())
+    {
+        return true;
+    }
+
+    std::string key(id->second);
+    m_ids.erase(id);
+    std::map<std::string, applying*>::iterator it = m_inflight.find(key);
+    assert(it != m_inflight.end());
+    applying* a = it->second;
+
+    if (a->current->deleted)
+    {
+        if (a->status == HYPERDEX_CLIENT_SUCCESS ||
+            a->status == HYPERDEX_CLIENT_NOTFOUND)
+        {
+            ++stats->deletes;
+        }
+        else
+        {
+            ++stats->failed;
+            std::cerr << "could not delete a replicated object: " << a->status << std::endl;
+        }
+    }
+    else if (a->status == HYPERDEX_CLIENT_SUCCESS)
+    {
+        ++stats->puts;
+    }
+    else if (a->status == HYPERDEX_CLIENT_CMPFAIL && a->current->ts >= 0)
+    {
+        ++stats->conflicts;
+    }
+    else
+    {
+        ++stats->failed;
+        std::cerr << "could not put a replicated object: " << a->status << std::endl;
+    }
+
+    if (a->next.get())
+    {
+        a->current = a->next;
+
+        if (send(key, a, stats))
+        {
+            return true;
+        }
+    }
+
+    delete a;
+    m_inflight.erase(it);
+    return true;
+}
+
+bool
+replicator :: send(const std::string& key, applying* a, pass_stats* stats)
+{
+    change* c = a->current.get();
+    int64_t id;
+
+    if (c->deleted)
+    {
+        id = m_dst->del(m_space, c->key.data(), c->key.size(), &a->status);
+    }
+    else if (c->ts >= 0)
+    {
+        // last writer wins:  a newer copy at the destination stays put
+        id = m_dst->cond_put_or_create(m_space, c->key.data(), c->key.size(),
+                                       &c->check, 1,
+                                       c->attrs.empty() ? NULL : &c->attrs[0],
+                                       c->attrs.size(), &a->status);
+    }
+    else
+    {
+        id = m_dst->put(m_space, c->key.data(), c->key.size(),
+                        c->attrs.empty() ? NULL : &c->attrs[0],
+                        c->attrs.size(), &a->status);
+    }
+
+    if (id < 0)
+    {
+        ++stats->failed;
+        std::cerr << "could not apply a change: " << a->status << ": "
+                  << m_dst->error_message() << std::endl;
+        return false;
+    }
+
+    m_ids[id] = key;
+    return true;
+}
+
+bool
+read_state(const char* path, uint64_t* checkpoint)
+{
+    std::ifstream fin(path);
+
+    if (!fin)
+    {
+        // no state yet:  start from the beginning
+        return true;
+    }
+
+    unsigned long long x;
+
+    if (!(fin >> x))
+    {
+        return false;
+    }
+
+    *checkpoint = x;
+    return true;
+}
+
+bool
+write_state(const char* path, uint64_t checkpoint)
+{
+    // a crash part way through leaves the old state in place
+    std::string tmp(path);
+    tmp += ".tmp";
+
+    {
+        std::ofstream fout(tmp.c_str(), std::ios::out | std::ios::trunc);
+        fout << checkpoint << std::endl;
+
+        if (!fout)
+        {
+            return false;
+        }
+    }
+
+    return rename(tmp.c_str(), path) == 0;
+}
+
+} // namespace
+
+int
+main(int argc, const char* argv[])
+{
+    const char* to_host = NULL;
+    long to_port = 1982;
+    const char* to_space = NULL;
+    const char* ts_attr = NULL;
+    const char* state = NULL;
+    long window = 256;
+    long interval = 1000;
+    bool once = false;
+    hyperdex::connect_opts conn;
+    e::argparser ap;
+    ap.autohelp();
+    ap.option_string("[OPTIONS] <space>");
+    ap.arg().long_name("to-host")
+            .description("replicate to the cluster whose coordinator is at this address (required)")
+            .metavar("addr").as_string(&to_host);
+    ap.arg().long_name("to-port")
+            .description("the destination coordinator's port (default: 1982)")
+            .metavar("port").as_long(&to_port);
+    ap.arg().long_name("to-space")
+            .description("replicate into a differently named space (default: the same name)")
+            .metavar("space").as_string(&to_space);
+    ap.arg().name('t', "timestamp")
+            .description("keep whichever copy of an object has the larger value of this attribute (default: the source always wins)")
+            .metavar("attr").as_string(&ts_attr);
+    ap.arg().name('s', "state")
+            .description("resume from, and record progress in, this file")
+            .metavar("file").as_string(&state);
+    ap.arg().name('w', "window")
+            .description("apply this many changes at once (default: 256)")
+            .metavar("N").as_long(&window);
+    ap.arg().name('i', "interval")
+            .description("wait this many milliseconds between passes (default: 1000)")
+            .metavar("ms").as_long(&interval);
+    ap.arg().long_name("once")
+            .description("make one pass over the changes and exit")
+            .set_true(&once);
+    ap.add("Connect to the source cluster:", conn.parser());
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!conn.validate())
+    {
+        std::cerr << "invalid host:port specification\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (!to_host || to_port <= 0 || to_port >= (1 << 16))
+    {
+        std::cerr << "specify the destination cluster with --to-host and --to-port" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() != 1)
+    {
+        std::cerr << "specify the space to replicate" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (window <= 0 || interval < 0)
+    {
+        std::cerr << "the window must be positive and the interval non-negative" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    const char* space = ap.args()[0];
+
+    if (!to_space)
+    {
+        to_space = space;
+    }
+
+    uint64_t checkpoint = 0;
+
+    if (state && !read_state(state, &checkpoint))
+    {
+        std::cerr << "could not read the checkpoint in " << state << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        hyperdex::Client src(conn.host(), conn.port());
+        hyperdex::Client dst(to_host, static_cast<uint16_t>(to_port));
+
+        if (ts_attr)
+        {
+            hyperdex_client_returncode rc;
+            hyperdatatype t = src.attribute_type(space, ts_attr, &rc);
+
+            if (t != HYPERDATATYPE_INT64 &&
+                CONTAINER_TYPE(t) != HYPERDATATYPE_TIMESTAMP_GENERIC)
+            {
+                std::cerr << "attribute \"" << ts_attr << "\" must be an int64 or a timestamp"
+                          << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        while (true)
+        {
+            // every change made before the pass starts is in the pass
+            uint64_t started = po6::monotonic_time();
+            replicator r(&dst, to_space, ts_attr, window);
+            pass_stats stats;
+            hyperdex_client_returncode status;
+            const hyperdex_client_attribute* attrs = NULL;
+            size_t attrs_sz = 0;
+            uint64_t version = 0;
+            int deleted = 0;
+            uint64_t resume = checkpoint;
+            int64_t id = src.changes(space, checkpoint, &status,
+                                     &attrs, &attrs_sz, &version, &deleted, &resume);
+
+            if (id < 0)
+            {
+                std::cerr << "could not read changes: " << status << ": "
+                          << src.error_message() << std::endl;
+                ++stats.failed;
+            }
+
+            while (id >= 0)
+            {
+                while (r.full())
+                {
+                    if (!r.reap(&stats))
+                    {
+                        return EXIT_FAILURE;
+                    }
+                }
+
+                hyperdex_client_returncode lrc;
+
+                if (src.loop(-1, &lrc) < 0)
+                {
+                    std::cerr << "could not read changes: " << lrc << ": "
+                              << src.error_message() << std::endl;
+                    return EXIT_FAILURE;
+                }
+
+                if (status == HYPERDEX_CLIENT_SEARCHDONE)
+                {
+                    break;
+                }
+                else if (status != HYPERDEX_CLIENT_SUCCESS)
+                {
+                    // the stream goes on to SEARCHDONE after an error
+                    std::cerr << "could not read changes: " << status << ": "
+                              << src.error_message() << std::endl;
+                    ++stats.failed;
+                    continue;
+                }
+
+                // a success with nothing in it is just the stream winding down
+                if (!attrs)
+                {
+                    continue;
+                }
+
+                r.add(attrs, attrs_sz, deleted != 0, &stats);
+                hyperdex_client_destroy_attrs(attrs, attrs_sz);
+                attrs = NULL;
+                attrs_sz = 0;
+            }
+
+            while (!r.idle())
+            {
+                if (!r.reap(&stats))
+                {
+                    return EXIT_FAILURE;
+                }
+            }
+
+            // a pass with any failure is redone from the same checkpoint
+            bool ok = stats.failed == 0;
+
+            if (ok)
+            {
+                checkpoint = resume;
+
+                if (state && !write_state(state, checkpoint))
+                {
+                    std::cerr << "could not record the checkpoint in " << state << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+
+            uint64_t lag = (po6::monotonic_time() - started) / 1000000ULL;
+            std::cout << (ok ? "replicated" : "failed")
+                      << " changes=" << stats.changes
+                      << " puts=" << stats.puts
+                      << " deletes=" << stats.deletes
+                      << " conflicts=" << stats.conflicts
+                      << " coalesced=" << stats.coalesced
+                      << " failed=" << stats.failed
+                      << " checkpoint=" << checkpoint;
+
+            if (ok)
+            {
+                std::cout << " lag_ms=" << lag;
+            }
+
+            std::cout << std::endl;
+
+            if (once)
+            {
+                return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+            }
+
+            timespec ts;
+            ts.tv_sec = interval / 1000;
+            ts.tv_nsec = (interval % 1000) * 1000000L;
+            nanosleep(&ts, NULL);
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
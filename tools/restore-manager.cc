@@ -0,0 +1,496 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <cstdio>
+#include <cstdlib>
+#include <stdint.h>
+
+// POSIX
+#include <dirent.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+// STL
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/io/fd.h>
+
+// HyperDex
+#include "tools/common.h"
+
+// one daemon's directory in the backup and the [user@]host:dir it goes to
+struct daemon_restore
+{
+    daemon_restore() : sid(), host(), path() {}
+    daemon_restore(const std::string& s,
+                   const std::string& h,
+                   const std::string& p)
+        : sid(s), host(h), path(p) {}
+    ~daemon_restore() {}
+    std::string sid;
+    std::string host;
+    std::string path;
+};
+
+static bool
+read_latest(const std::string& base, std::string* latest_name)
+{
+    std::string latest_path = po6::path::join(base, "LATEST");
+    po6::io::fd latest(open(latest_path.c_str(), O_RDONLY));
+
+    if (latest.get() < 0)
+    {
+        std::cerr << "could not read the LATEST backup: "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+
+    std::vector<char> buf(PATH_MAX);
+    ssize_t amt = latest.xread(&buf[0], buf.size());
+
+    if (amt < 0)
+    {
+        std::cerr << "could not read the LATEST backup: "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+
+    buf.resize(amt);
+    *latest_name = std::string(buf.begin(), buf.end());
+    return true;
+}
+
+// every daemon in the backup; backup-manager names each daemon's directory
+// with its server id
+static bool
+list_daemons(const std::string& backup, std::set<std::string>* sids)
+{
+    DIR* dir = opendir(backup.c_str());
+
+    if (!dir)
+    {
+        std::cerr << "could not list the backup's daemons: "
+                  << strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct dirent* ent = NULL;
+
+    while ((ent = readdir(dir)) != NULL)
+    {
+        std::string name(ent->d_name);
+        struct stat stbuf;
+
+        if (name.empty() ||
+            name.find_first_not_of("0123456789") != std::string::npos)
+        {
+            continue;
+        }
+
+        if (stat(po6::path::join(backup, name).c_str(), &stbuf) == 0 &&
+            S_ISDIR(stbuf.st_mode))
+        {
+            sids->insert(name);
+        }
+    }
+
+    closedir(dir);
+    return true;
+}
+
+// "<sid>=[host:]dir"; without a host the daemon is restored locally
+static bool
+parse_target(const char* arg, daemon_restore* dr)
+{
+    std::string s(arg);
+    size_t eq = s.find('=');
+
+    if (eq == std::string::npos || eq == 0 || eq + 1 == s.size())
+    {
+        return false;
+    }
+
+    dr->sid = s.substr(0, eq);
+    std::string dest = s.substr(eq + 1);
+    size_t colon = dest.find(':');
+
+    if (dr->sid.find_first_not_of("0123456789") != std::string::npos)
+    {
+        return false;
+    }
+
+    if (colon == std::string::npos)
+    {
+        dr->host = "";
+        dr->path = dest;
+    }
+    else
+    {
+        dr->host = dest.substr(0, colon);
+        dr->path = dest.substr(colon + 1);
+    }
+
+    return !dr->path.empty();
+}
+
+static std::string
+rsync_dest(const char* user, const std::string& host, const std::string& path)
+{
+    if (host.empty())
+    {
+        return path + "/";
+    }
+    else if (user)
+    {
+        return std::string(user) + "@" + host + ":" + path + "/";
+    }
+    else
+    {
+        return host + ":" + path + "/";
+    }
+}
+
+static bool
+child_succeeded(int status)
+{
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+    {
+        std::cerr << "child process failed" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool
+fork_exec(const std::vector<std::string>& args, pid_t* pid)
+{
+    pid_t child = fork();
+
+    if (child > 0)
+    {
+        *pid = child;
+        return true;
+    }
+    else if (child == 0)
+    {
+        std::vector<const char*> arg_ptrs;
+        arg_ptrs.reserve(args.size() + 1);
+
+        for (size_t i = 0; i < args.size(); ++i)
+        {
+            arg_ptrs.push_back(args[i].c_str());
+        }
+
+        arg_ptrs.push_back(NULL);
+        execvp(arg_ptrs[0], const_cast<char* const*>(&arg_ptrs[0]));
+        std::cerr << "could not exec: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    else
+    {
+        std::cerr << "could not fork: " << strerror(errno) << std::endl;
+        return false;
+    }
+}
+
+int
+main(int argc, const char* argv[])
+{
+    long _parallel = 8;
+    long _bwlimit = 0;
+    long _total_bwlimit = 0;
+    const char* _data = ".";
+    const char* _backup = NULL;
+    const char* _coordinator = NULL;
+    const char* _user = NULL;
+    e::argparser ap;
+    ap.autohelp();
+    ap.option_string("[OPTIONS] <server-id>=[host:]dir ...");
+    ap.arg().name('b', "backup-dir")
+            .description("restore from backups in this directory (default: .)")
+            .metavar("dir").as_string(&_data);
+    ap.arg().name('n', "backup")
+            .description("restore this backup (default: the one named in LATEST)")
+            .metavar("name").as_string(&_backup);
+    ap.arg().name('c', "coordinator")
+            .description("also copy the coordinator's state to [host:]dir")
+            .metavar("[host:]dir").as_string(&_coordinator);
+    ap.arg().name('u', "user")
+            .description("username to use for ssh connections (default: this user)")
+            .metavar("user").as_string(&_user);
+    ap.arg().name('j', "parallel")
+            .description("restore this many daemons at once (default: 8)")
+            .metavar("N").as_long(&_parallel);
+    ap.arg().long_name("bwlimit")
+            .description("limit each daemon's copy to this many KiB/s (default: no limit)")
+            .metavar("KBPS").as_long(&_bwlimit);
+    ap.arg().long_name("total-bwlimit")
+            .description("limit all copies together to this many KiB/s (default: no limit)")
+            .metavar("KBPS").as_long(&_total_bwlimit);
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() == 0)
+    {
+        std::cerr << "name at least one daemon to restore\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (_parallel <= 0 || _bwlimit < 0 || _total_bwlimit < 0)
+    {
+        std::cerr << "the parallelism must be positive and the bandwidth limits non-negative\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    using po6::path::join;
+
+    try
+    {
+        bool success = true;
+        std::string base(_data);
+
+        if (!po6::path::realpath(base, &base))
+        {
+            std::cerr << "error: " << po6::strerror(errno) << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::string name;
+
+        if (_backup)
+        {
+            name = _backup;
+        }
+        else if (!read_latest(base, &name))
+        {
+            return EXIT_FAILURE;
+        }
+
+        std::string backupdir(join(base, name));
+        std::set<std::string> sids;
+
+        if (!list_daemons(backupdir, &sids))
+        {
+            return EXIT_FAILURE;
+        }
+
+        std::vector<daemon_restore> daemons;
+        std::set<std::string> restored;
+
+        for (size_t i = 0; i < ap.args_sz(); ++i)
+        {
+            daemon_restore dr;
+
+            if (!parse_target(ap.args()[i], &dr))
+            {
+                std::cerr << "invalid restore target \"" << ap.args()[i]
+                          << "\"; expected <server-id>=[host:]dir\n" << std::endl;
+                ap.usage();
+                return EXIT_FAILURE;
+            }
+
+            if (sids.find(dr.sid) == sids.end())
+            {
+                std::cerr << "backup " << name << " holds no daemon " << dr.sid << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            if (!restored.insert(dr.sid).second)
+            {
+                std::cerr << "daemon " << dr.sid << " named more than once" << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            daemons.push_back(dr);
+        }
+
+        for (std::set<std::string>::iterator it = sids.begin(); it != sids.end(); ++it)
+        {
+            if (restored.find(*it) == restored.end())
+            {
+                std::cerr << "warning: not restoring daemon " << *it
+                          << "; the restored cluster will wait for it until "
+                          << "it is restored or killed with \"hyperdex server-kill\""
+                          << std::endl;
+            }
+        }
+
+        // Every daemon's directory is a complete --data directory, so the
+        // daemons copy independently of one another.  Copy up to --parallel
+        // at once; the total limit is split evenly between the copies that
+        // run together.  A destination that already holds an older copy of
+        // the daemon (e.g. from an earlier restore) is brought up to date by
+        // rsync, which sends only the table files it lacks.
+        size_t copies_sz = daemons.size() + (_coordinator ? 1 : 0);
+        size_t parallel = std::min(static_cast<size_t>(_parallel), copies_sz);
+        long bwlimit = _bwlimit;
+
+        if (_total_bwlimit > 0 && parallel > 0)
+        {
+            long share = std::max(_total_bwlimit / static_cast<long>(parallel), 1L);
+            bwlimit = bwlimit > 0 ? std::min(bwlimit, share) : share;
+        }
+
+        std::vector<std::vector<std::string> > copies;
+        std::vector<std::string> what;
+
+        for (size_t i = 0; i < daemons.size(); ++i)
+        {
+            std::vector<std::string> args;
+            args.push_back("rsync");
+            args.push_back("-a");
+            args.push_back("--delete");
+
+            if (bwlimit > 0)
+            {
+                std::ostringstream ostr;
+                ostr << "--bwlimit=" << bwlimit;
+                args.push_back(ostr.str());
+            }
+
+            args.push_back("--");
+            args.push_back(join(backupdir, daemons[i].sid) + "/");
+            args.push_back(rsync_dest(_user, daemons[i].host, daemons[i].path));
+            copies.push_back(args);
+            what.push_back("daemon " + daemons[i].sid);
+        }
+
+        if (_coordinator)
+        {
+            daemon_restore coord;
+
+            if (!parse_target((std::string("0=") + _coordinator).c_str(), &coord))
+            {
+                std::cerr << "invalid coordinator target \"" << _coordinator
+                          << "\"; expected [host:]dir\n" << std::endl;
+                ap.usage();
+                return EXIT_FAILURE;
+            }
+
+            std::vector<std::string> args;
+            args.push_back("rsync");
+            args.push_back("-a");
+            args.push_back("--");
+            args.push_back(join(backupdir, "coordinator.bin"));
+            args.push_back(rsync_dest(_user, coord.host, coord.path));
+            copies.push_back(args);
+            what.push_back("the coordinator");
+        }
+
+        std::map<pid_t, size_t> running;
+        size_t next = 0;
+
+        while (next < copies.size() || !running.empty())
+        {
+            while (next < copies.size() && running.size() < parallel)
+            {
+                pid_t child;
+
+                if (fork_exec(copies[next], &child))
+                {
+                    running[child] = next;
+                }
+                else
+                {
+                    success = false;
+                }
+
+                ++next;
+            }
+
+            if (running.empty())
+            {
+                continue;
+            }
+
+            int status = 0;
+            pid_t child = waitpid(-1, &status, 0);
+
+            if (child < 0)
+            {
+                std::cerr << "could not wait for child: " << strerror(errno) << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            std::map<pid_t, size_t>::iterator it = running.find(child);
+
+            if (it == running.end())
+            {
+                continue;
+            }
+
+            size_t idx = it->second;
+            running.erase(it);
+
+            if (!child_succeeded(status))
+            {
+                std::cerr << "could not restore " << what[idx] << std::endl;
+                success = false;
+                continue;
+            }
+
+            std::cout << "restored " << what[idx] << std::endl;
+        }
+
+        if (!success)
+        {
+            return EXIT_FAILURE;
+        }
+
+        std::cout << "\nStart a coordinator with \"hyperdex coordinator --restore coordinator.bin\",\n"
+                  << "then start each daemon on its host with --data set to its directory:\n";
+
+        for (size_t i = 0; i < daemons.size(); ++i)
+        {
+            std::cout << "    " << daemons[i].sid << ": "
+                      << (daemons[i].host.empty() ? "localhost" : daemons[i].host)
+                      << " --data=" << daemons[i].path << "\n";
+        }
+
+        std::cout << "Once every daemon is online, run \"hyperdex set-read-write\"." << std::endl;
+        return EXIT_SUCCESS;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,667 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+
+// C
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+
+// STL
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// po6
+#include <po6/time.h>
+
+// e
+#include <e/endian.h>
+#include <e/popt.h>
+
+// HyperDex
+#include <hyperdex/admin.hpp>
+#include <hyperdex/client.hpp>
+#include "tools/common.h"
+
+// Each object's "sel" is a permutation of its key, so a range of m
+// consecutive sel values matches exactly m objects scattered over the key
+// space.  Selectivity is set by choosing m.
+
+namespace
+{
+
+enum query_type
+{
+    QUERY_SEARCH,
+    QUERY_COUNT,
+    QUERY_SORTED_SEARCH,
+    QUERY_TYPES
+};
+
+const char* query_names[QUERY_TYPES] = {"search", "count", "sorted_search"};
+
+// what the daemons said about one search when asked to describe it
+struct description
+{
+    description() : servers(0), examined(0), fetched(0), covered(0), rejected(0), plans() {}
+
+    uint64_t servers;
+    uint64_t examined;
+    uint64_t fetched;
+    uint64_t covered;
+    uint64_t rejected;
+    std::set<std::string> plans;
+};
+
+uint64_t
+field(const std::string& line, const char* name)
+{
+    size_t pos = line.find(name);
+
+    if (pos == std::string::npos)
+    {
+        return 0;
+    }
+
+    return strtoull(line.c_str() + pos + strlen(name), NULL, 10);
+}
+
+// The client labels every line of each daemon's description with the
+// virtual server that sent it; one "touched by search" line appears for each
+// server the configuration's lookup_search sent the search to.
+void
+parse_description(const char* text, description* d)
+{
+    std::istringstream in(text);
+    std::string line;
+
+    while (std::getline(in, line))
+    {
+        size_t pos;
+
+        if (line.find("touched by search") != std::string::npos)
+        {
+            ++d->servers;
+        }
+        else if ((pos = line.find(" retrieved ")) != std::string::npos)
+        {
+            d->examined += field(line, " retrieved ");
+        }
+        else if ((pos = line.find(" choosing to use ")) != std::string::npos)
+        {
+            d->plans.insert(line.substr(pos + strlen(" choosing to use ")));
+        }
+        else if (line.find("search_iterator fetched=") != std::string::npos)
+        {
+            d->fetched += field(line, "fetched=");
+            d->covered += field(line, "covered=");
+            d->rejected += field(line, "rejected=");
+        }
+    }
+}
+
+uint64_t
+percentile(const std::vector<uint64_t>& sorted, double q)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+
+    size_t idx = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(idx, sorted.size() - 1)];
+}
+
+// Run one query to completion; *results is the number of objects it returned
+// (or counted)
+bool
+run_query(hyperdex::Client* cl, const char* space, query_type qt,
+          const hyperdex_client_attribute_check* checks, size_t checks_sz,
+          const char* sort_by, uint64_t limit, uint64_t* results)
+{
+    hyperdex_client_returncode status;
+    const hyperdex_client_attribute* attrs = NULL;
+    size_t attrs_sz = 0;
+    uint64_t count = 0;
+    int64_t id = -1;
+    *results = 0;
+
+    switch (qt)
+    {
+        case QUERY_SEARCH:
+            id = cl->search(space, checks, checks_sz, &status, &attrs, &attrs_sz);
+            break;
+        case QUERY_COUNT:
+            id = cl->count(space, checks, checks_sz, &status, &count);
+            break;
+        case QUERY_SORTED_SEARCH:
+            id = cl->sorted_search(space, checks, checks_sz, sort_by, limit, 0,
+                                   &status, &attrs, &attrs_sz);
+            break;
+        case QUERY_TYPES:
+        default:
+            abort();
+    }
+
+    if (id < 0)
+    {
+        std::cerr << query_names[qt] << " failed: " << status << ": " << cl->error_message() << std::endl;
+        return false;
+    }
+
+    while (true)
+    {
+        hyperdex_client_returncode lrc;
+        int64_t lid = cl->loop(-1, &lrc);
+
+        if (lid < 0)
+        {
+            std::cerr << query_names[qt] << " failed: " << lrc << ": " << cl->error_message() << std::endl;
+            return false;
+        }
+
+        if (lid != id)
+        {
+            continue;
+        }
+
+        if (qt == QUERY_COUNT)
+        {
+            if (status != HYPERDEX_CLIENT_SUCCESS)
+            {
+                std::cerr << "count failed: " << status << ": " << cl->error_message() << std::endl;
+                return false;
+            }
+
+            *results = count;
+            return true;
+        }
+
+        if (status == HYPERDEX_CLIENT_SEARCHDONE)
+        {
+            return true;
+        }
+
+        if (status != HYPERDEX_CLIENT_SUCCESS)
+        {
+            std::cerr << query_names[qt] << " failed: " << status << ": " << cl->error_message() << std::endl;
+            return false;
+        }
+
+        hyperdex_client_destroy_attrs(attrs, attrs_sz);
+        attrs = NULL;
+        attrs_sz = 0;
+        ++*results;
+    }
+}
+
+bool
+describe(hyperdex::Client* cl, const char* space,
+         const hyperdex_client_attribute_check* checks, size_t checks_sz,
+         description* d)
+{
+    hyperdex_client_returncode status;
+    const char* text = NULL;
+    int64_t id = cl->search_describe(space, checks, checks_sz, &status, &text);
+
+    if (id < 0)
+    {
+        std::cerr << "search_describe failed: " << status << ": " << cl->error_message() << std::endl;
+        return false;
+    }
+
+    hyperdex_client_returncode lrc;
+    int64_t lid = cl->loop(-1, &lrc);
+
+    if (lid < 0 || status != HYPERDEX_CLIENT_SUCCESS)
+    {
+        std::cerr << "search_describe failed: " << (lid < 0 ? lrc : status)
+                  << ": " << cl->error_message() << std::endl;
+        return false;
+    }
+
+    parse_description(text, d);
+    return true;
+}
+
+uint64_t
+gcd(uint64_t a, uint64_t b)
+{
+    while (b)
+    {
+        uint64_t t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+bool
+admin_call(hyperdex::Admin* adm, int64_t id, hyperdex_admin_returncode* status, const char* what)
+{
+    if (id < 0)
+    {
+        std::cerr << "could not " << what << ": " << adm->error_message() << std::endl;
+        return false;
+    }
+
+    hyperdex_admin_returncode lrc;
+    int64_t lid = adm->loop(-1, &lrc);
+
+    if (lid < 0 || *status != HYPERDEX_ADMIN_SUCCESS)
+    {
+        std::cerr << "could not " << what << ": " << adm->error_message() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool
+parse_list(const char* text, std::vector<std::string>* items)
+{
+    std::string s(text);
+    size_t pos = 0;
+
+    while (pos < s.size())
+    {
+        size_t comma = s.find(',', pos);
+        comma = comma == std::string::npos ? s.size() : comma;
+
+        if (comma == pos)
+        {
+            return false;
+        }
+
+        items->push_back(s.substr(pos, comma - pos));
+        pos = comma + 1;
+    }
+
+    return true;
+}
+
+} // namespace
+
+int
+main(int argc, const char* argv[])
+{
+    const char* space = "searchbench";
+    long objects = 100000;
+    long pad = 64;
+    long partitions = 0;
+    long queries = 20;
+    long limit = 10;
+    long window = 256;
+    const char* indexes = "sel";
+    const char* subspace = "";
+    const char* selectivities = "0.00001,0.0001,0.001,0.01,0.1,1";
+    bool no_create = false;
+    bool no_load = false;
+    hyperdex::connect_opts conn;
+    e::argparser ap;
+    ap.autohelp();
+    ap.arg().name('s', "space")
+            .description("benchmark the specified space (default: \"searchbench\")")
+            .metavar("space").as_string(&space);
+    ap.arg().name('n', "objects")
+            .description("load this many objects (default: 100000)")
+            .metavar("N").as_long(&objects);
+    ap.arg().long_name("pad")
+            .description("give each object a string of this many bytes (default: 64)")
+            .metavar("B").as_long(&pad);
+    ap.arg().name('i', "indexes")
+            .description("comma-separated attributes to index, from sel, uniq and pad; empty for none (default: sel)")
+            .metavar("attrs").as_string(&indexes);
+    ap.arg().long_name("subspace")
+            .description("comma-separated attributes of an extra subspace (default: none)")
+            .metavar("attrs").as_string(&subspace);
+    ap.arg().long_name("partitions")
+            .description("create the space with this many partitions (default: the coordinator's)")
+            .metavar("N").as_long(&partitions);
+    ap.arg().name('S', "selectivities")
+            .description("comma-separated fractions of the objects each query matches (default: 0.00001,0.0001,0.001,0.01,0.1,1)")
+            .metavar("list").as_string(&selectivities);
+    ap.arg().name('q', "queries")
+            .description("run each query this many times at each selectivity (default: 20)")
+            .metavar("N").as_long(&queries);
+    ap.arg().long_name("limit")
+            .description("return this many objects from each sorted_search (default: 10)")
+            .metavar("N").as_long(&limit);
+    ap.arg().name('w', "window")
+            .description("keep this many puts outstanding while loading (default: 256)")
+            .metavar("N").as_long(&window);
+    ap.arg().long_name("no-create")
+            .description("use an existing space instead of creating it")
+            .set_true(&no_create);
+    ap.arg().long_name("no-load")
+            .description("query objects loaded by an earlier run")
+            .set_true(&no_load);
+    ap.add("Connect to a cluster:", conn.parser());
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!conn.validate())
+    {
+        std::cerr << "invalid host:port specification\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() != 0)
+    {
+        std::cerr << "command takes no positional arguments" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (objects <= 0 || objects >= (1L << 31) || pad < 0 || partitions < 0 ||
+        queries <= 0 || limit <= 0 || window <= 0)
+    {
+        std::cerr << "the objects, queries, limit and window must be positive "
+                  << "(and the objects below 2^31)" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    std::vector<std::string> index_attrs;
+    std::vector<std::string> subspace_attrs;
+    std::vector<std::string> sel_texts;
+    std::vector<double> sels;
+
+    if (!parse_list(indexes, &index_attrs) ||
+        !parse_list(subspace, &subspace_attrs) ||
+        !parse_list(selectivities, &sel_texts))
+    {
+        std::cerr << "lists must be comma-separated without empty items" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    for (size_t i = 0; i < sel_texts.size(); ++i)
+    {
+        char* end = NULL;
+        double s = strtod(sel_texts[i].c_str(), &end);
+
+        if (*end != '\0' || s <= 0 || s > 1)
+        {
+            std::cerr << "selectivity \"" << sel_texts[i] << "\" is not in (0, 1]" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        sels.push_back(s);
+    }
+
+    try
+    {
+        if (!no_create)
+        {
+            std::ostringstream desc;
+            desc << "space " << space << " key int k attributes int sel, int uniq, string pad";
+
+            if (!subspace_attrs.empty())
+            {
+                desc << " subspace ";
+
+                for (size_t i = 0; i < subspace_attrs.size(); ++i)
+                {
+                    desc << (i ? ", " : "") << subspace_attrs[i];
+                }
+            }
+
+            for (size_t i = 0; i < index_attrs.size(); ++i)
+            {
+                desc << " index " << index_attrs[i];
+            }
+
+            if (partitions > 0)
+            {
+                desc << " create " << partitions << " partitions";
+            }
+
+            hyperdex::Admin adm(conn.host(), conn.port());
+            hyperdex_admin_returncode status;
+
+            if (!admin_call(&adm, adm.add_space(desc.str().c_str(), &status), &status, "add space") ||
+                !admin_call(&adm, adm.wait_until_stable(&status), &status, "wait for the space"))
+            {
+                return EXIT_FAILURE;
+            }
+
+            std::cout << "created: " << desc.str() << std::endl;
+        }
+
+        hyperdex::Client cl(conn.host(), conn.port());
+        // a multiplier coprime with the object count permutes the keys
+        uint64_t mult = objects > 1 ? 2654435761ULL % objects : 1;
+
+        while (gcd(mult, objects) != 1)
+        {
+            ++mult;
+        }
+
+        if (!no_load)
+        {
+            std::string padding(pad, 'p');
+            std::map<int64_t, hyperdex_client_returncode*> outstanding;
+            std::vector<hyperdex_client_returncode> statuses(window);
+            std::vector<hyperdex_client_returncode*> free_statuses;
+
+            for (long i = 0; i < window; ++i)
+            {
+                free_statuses.push_back(&statuses[i]);
+            }
+
+            uint64_t key = 0;
+            uint64_t failed = 0;
+            uint64_t t_start = po6::monotonic_time();
+
+            while (key < static_cast<uint64_t>(objects) || !outstanding.empty())
+            {
+                while (key < static_cast<uint64_t>(objects) && !free_statuses.empty())
+                {
+                    char kbuf[sizeof(int64_t)];
+                    char sbuf[sizeof(int64_t)];
+                    char ubuf[sizeof(int64_t)];
+                    e::pack64le(static_cast<int64_t>(key), kbuf);
+                    e::pack64le(static_cast<int64_t>(key * mult % objects), sbuf);
+                    e::pack64le(static_cast<int64_t>(key), ubuf);
+                    hyperdex_client_attribute attrs[3];
+                    attrs[0].attr = "sel";
+                    attrs[0].value = sbuf;
+                    attrs[0].value_sz = sizeof(sbuf);
+                    attrs[0].datatype = HYPERDATATYPE_INT64;
+                    attrs[1].attr = "uniq";
+                    attrs[1].value = ubuf;
+                    attrs[1].value_sz = sizeof(ubuf);
+                    attrs[1].datatype = HYPERDATATYPE_INT64;
+                    attrs[2].attr = "pad";
+                    attrs[2].value = padding.data();
+                    attrs[2].value_sz = padding.size();
+                    attrs[2].datatype = HYPERDATATYPE_STRING;
+                    hyperdex_client_returncode* status = free_statuses.back();
+                    int64_t id = cl.put(space, kbuf, sizeof(kbuf), attrs, 3, status);
+
+                    if (id < 0)
+                    {
+                        std::cerr << "could not load object " << key << ": " << *status
+                                  << ": " << cl.error_message() << std::endl;
+                        return EXIT_FAILURE;
+                    }
+
+                    free_statuses.pop_back();
+                    outstanding[id] = status;
+                    ++key;
+                }
+
+                hyperdex_client_returncode lrc;
+                int64_t lid = cl.loop(-1, &lrc);
+
+                if (lid < 0)
+                {
+                    std::cerr << "could not load objects: " << lrc << ": " << cl.error_message() << std::endl;
+                    return EXIT_FAILURE;
+                }
+
+                std::map<int64_t, hyperdex_client_returncode*>::iterator it = outstanding.find(lid);
+
+                if (it == outstanding.end())
+                {
+                    continue;
+                }
+
+                if (*it->second != HYPERDEX_CLIENT_SUCCESS)
+                {
+                    ++failed;
+                }
+
+                free_statuses.push_back(it->second);
+                outstanding.erase(it);
+            }
+
+            double secs = (po6::monotonic_time() - t_start) / 1e9;
+            std::cout << "loaded " << objects - failed << " objects in "
+                      << std::fixed << std::setprecision(1) << secs << "s" << std::endl;
+
+            if (failed)
+            {
+                std::cerr << failed << " puts failed" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+
+        std::cout << std::fixed << std::setprecision(1);
+        uint64_t seed = po6::monotonic_time();
+
+        for (size_t s = 0; s < sels.size(); ++s)
+        {
+            uint64_t matches = static_cast<uint64_t>(sels[s] * objects + 0.5);
+            matches = std::max(matches, uint64_t(1));
+            std::cout << "selectivity=" << std::setprecision(5) << sels[s] * 100 << "%"
+                      << std::setprecision(1) << " matches=" << matches << "\n";
+
+            for (size_t qt = 0; qt < QUERY_TYPES; ++qt)
+            {
+                std::vector<uint64_t> latencies;
+                description d;
+                bool wrong = false;
+
+                for (long q = 0; q < queries; ++q)
+                {
+                    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+                    uint64_t lo = (seed >> 33) % (objects - matches + 1);
+                    char lbuf[sizeof(int64_t)];
+                    char hbuf[sizeof(int64_t)];
+                    e::pack64le(static_cast<int64_t>(lo), lbuf);
+                    e::pack64le(static_cast<int64_t>(lo + matches), hbuf);
+                    hyperdex_client_attribute_check checks[2];
+                    checks[0].attr = "sel";
+                    checks[0].value = lbuf;
+                    checks[0].value_sz = sizeof(lbuf);
+                    checks[0].datatype = HYPERDATATYPE_INT64;
+                    checks[0].predicate = HYPERPREDICATE_GREATER_EQUAL;
+                    checks[1].attr = "sel";
+                    checks[1].value = hbuf;
+                    checks[1].value_sz = sizeof(hbuf);
+                    checks[1].datatype = HYPERDATATYPE_INT64;
+                    checks[1].predicate = HYPERPREDICATE_LESS_THAN;
+
+                    // describe the first search at each selectivity;
+                    // describing runs the search too, so it is not timed
+                    if (q == 0 && qt == QUERY_SEARCH && !describe(&cl, space, checks, 2, &d))
+                    {
+                        return EXIT_FAILURE;
+                    }
+
+                    uint64_t results = 0;
+                    uint64_t t_start = po6::monotonic_time();
+
+                    if (!run_query(&cl, space, static_cast<query_type>(qt), checks, 2, "sel", limit, &results))
+                    {
+                        return EXIT_FAILURE;
+                    }
+
+                    latencies.push_back(po6::monotonic_time() - t_start);
+                    uint64_t expected = qt == QUERY_SORTED_SEARCH
+                                      ? std::min(matches, static_cast<uint64_t>(limit))
+                                      : matches;
+                    wrong = wrong || results != expected;
+                }
+
+                std::sort(latencies.begin(), latencies.end());
+                uint64_t sum = 0;
+
+                for (size_t i = 0; i < latencies.size(); ++i)
+                {
+                    sum += latencies[i];
+                }
+
+                std::cout << "  " << std::setw(14) << std::left << query_names[qt] << std::right
+                          << "n=" << latencies.size()
+                          << " mean=" << sum / 1000. / latencies.size()
+                          << " p50=" << percentile(latencies, 0.5) / 1000.
+                          << " p99=" << percentile(latencies, 0.99) / 1000.
+                          << " max=" << latencies.back() / 1000. << " (us)"
+                          << (wrong ? " WRONG RESULT COUNT" : "") << "\n";
+
+                if (qt == QUERY_SEARCH)
+                {
+                    std::cout << "  " << std::setw(14) << std::left << "plan" << std::right
+                              << "servers=" << d.servers
+                              << " examined=" << d.examined
+                              << " fetched=" << d.fetched
+                              << " covered=" << d.covered
+                              << " rejected=" << d.rejected << "\n";
+
+                    for (std::set<std::string>::iterator it = d.plans.begin();
+                            it != d.plans.end(); ++it)
+                    {
+                        std::cout << "                " << *it << "\n";
+                    }
+                }
+            }
+
+            std::cout << std::flush;
+        }
+
+        return EXIT_SUCCESS;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
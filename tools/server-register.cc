@@ -36,9 +36,13 @@ int
 main(int argc, const char* argv[])
 {
     hyperdex::connect_opts conn;
+    const char* zone = NULL;
     e::argparser ap;
     ap.autohelp();
     ap.option_string("[OPTIONS] <server-id> <address:port>");
+    ap.arg().name('z', "zone")
+            .description("place the server in this zone or zone/rack, so replicas spread across them")
+            .metavar("label").as_string(&zone);
     ap.add("Connect to a cluster:", conn.parser());
 
     if (!ap.parse(argc, argv))
@@ -74,7 +78,7 @@ main(int argc, const char* argv[])
     {
         hyperdex::Admin h(conn.host(), conn.port());
         hyperdex_admin_returncode rrc;
-        int64_t rid = h.server_register(token, ap.args()[1], &rrc);
+        int64_t rid = h.server_register(token, ap.args()[1], zone, &rrc);
 
         if (rid < 0)
         {
@@ -0,0 +1,361 @@
+// Copyright (c) 2015, Cornell University
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright notice,
+//       this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//     * Neither the name of HyperDex nor the names of its contributors may be
+//       used to endorse or promote products derived from this software without
+//       specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+// C
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+// STL
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <string>
+
+// HyperDex
+#include <hyperdex/admin.hpp>
+#include "tools/common.h"
+
+// The daemons report each transfer's progress among their performance
+// counters as "xfer_out.<id>.<field>" on the sending side and
+// "xfer_in.<id>.<field>" on the receiving side.  Keep the latest sample of
+// every transfer, and once a second print those that the last complete
+// sample from their server still mentions; the rest have finished.
+
+typedef std::map<std::string, uint64_t> fields_t;
+
+// the fields of a transfer at "time", and of the sample before it, which
+// is whole even while "fields" is still filling in
+struct sample
+{
+    sample() : time(0), fields(), prev_time(0), prev_fields() {}
+    uint64_t time;
+    fields_t fields;
+    uint64_t prev_time;
+    fields_t prev_fields;
+};
+
+typedef std::map<std::pair<uint64_t, uint64_t>, sample> samples_t;
+
+// a server's samples arrive in time order, so all but the newest are complete
+struct server_times
+{
+    server_times() : newest(0), complete(0) {}
+    uint64_t newest;
+    uint64_t complete;
+};
+
+typedef std::map<uint64_t, server_times> servers_t;
+
+// the fields as of the last complete sample from the transfer's server, or
+// NULL if that sample does not mention the transfer; transfers that will
+// never be mentioned again are erased
+static fields_t*
+current(const servers_t& servers, samples_t* samples, samples_t::iterator* it)
+{
+    servers_t::const_iterator st = servers.find((*it)->first.first);
+    sample* s = &(*it)->second;
+
+    if (st == servers.end() || s->time < st->second.complete)
+    {
+        samples->erase((*it)++);
+        return NULL;
+    }
+
+    if (s->time == st->second.complete)
+    {
+        return &s->fields;
+    }
+
+    if (s->prev_time == st->second.complete && s->prev_time > 0)
+    {
+        return &s->prev_fields;
+    }
+
+    ++*it;
+    return NULL;
+}
+
+static void
+record(samples_t* samples, const hyperdex_admin_perf_counter& pc,
+       uint64_t xid, const std::string& field)
+{
+    sample& s((*samples)[std::make_pair(pc.id, xid)]);
+
+    if (s.time != pc.time)
+    {
+        s.prev_time = s.time;
+        s.prev_fields.swap(s.fields);
+        s.time = pc.time;
+        s.fields.clear();
+    }
+
+    s.fields[field] = pc.measurement;
+}
+
+static bool
+parse_property(const char* property, const char* prefix,
+               uint64_t* xid, std::string* field)
+{
+    size_t prefix_sz = strlen(prefix);
+
+    if (strncmp(property, prefix, prefix_sz) != 0)
+    {
+        return false;
+    }
+
+    char* end = NULL;
+    *xid = strtoull(property + prefix_sz, &end, 10);
+
+    if (end == property + prefix_sz || *end != '.')
+    {
+        return false;
+    }
+
+    *field = end + 1;
+    return true;
+}
+
+static std::string
+human_bytes(uint64_t bytes)
+{
+    const char* units[] = {"B", "KB", "MB", "GB", "TB"};
+    double value = bytes;
+    size_t unit = 0;
+
+    while (value >= 1024 && unit + 1 < sizeof(units) / sizeof(units[0]))
+    {
+        value /= 1024;
+        ++unit;
+    }
+
+    std::ostringstream ostr;
+    ostr << std::fixed << std::setprecision(unit ? 1 : 0) << value << units[unit];
+    return ostr.str();
+}
+
+static void
+print_transfers(const servers_t& servers,
+                samples_t* outgoing, samples_t* incoming)
+{
+    std::map<uint64_t, uint64_t> applied;
+
+    for (samples_t::iterator it = incoming->begin(); it != incoming->end(); )
+    {
+        fields_t* f = current(servers, incoming, &it);
+
+        if (!f)
+        {
+            continue;
+        }
+
+        applied[it->first.second] = (*f)["objects_applied"];
+        ++it;
+    }
+
+    std::cout << std::left
+              << std::setw(8) << "xfer"
+              << std::setw(10) << "region"
+              << std::setw(12) << "src"
+              << std::setw(12) << "dst"
+              << std::setw(22) << "objects acked/sent"
+              << std::setw(12) << "applied"
+              << std::setw(22) << "bytes acked/total"
+              << std::setw(8) << "done"
+              << std::setw(12) << "rate"
+              << "eta" << std::endl;
+    size_t shown = 0;
+
+    for (samples_t::iterator it = outgoing->begin(); it != outgoing->end(); )
+    {
+        fields_t* fp = current(servers, outgoing, &it);
+
+        if (!fp)
+        {
+            continue;
+        }
+
+        fields_t& f(*fp);
+        std::ostringstream objects;
+        objects << f["objects_acked"] << "/" << f["objects_sent"];
+        std::ostringstream bytes;
+        bytes << human_bytes(f["bytes_acked"]) << "/" << human_bytes(f["bytes_estimate"]);
+        std::ostringstream done;
+        std::ostringstream eta;
+
+        if (f["bytes_estimate"] > 0)
+        {
+            done << std::min<uint64_t>(f["bytes_acked"] * 100 / f["bytes_estimate"], 100) << "%";
+        }
+        else
+        {
+            done << "-";
+        }
+
+        if (f["rate"] > 0)
+        {
+            eta << f["eta"] << "s";
+        }
+        else
+        {
+            eta << "-";
+        }
+
+        std::map<uint64_t, uint64_t>::iterator a = applied.find(it->first.second);
+        std::ostringstream app;
+
+        if (a != applied.end())
+        {
+            app << a->second;
+        }
+        else
+        {
+            app << "-";
+        }
+
+        std::cout << std::left
+                  << std::setw(8) << it->first.second
+                  << std::setw(10) << f["region"]
+                  << std::setw(12) << it->first.first
+                  << std::setw(12) << f["dst"]
+                  << std::setw(22) << objects.str()
+                  << std::setw(12) << app.str()
+                  << std::setw(22) << bytes.str()
+                  << std::setw(8) << done.str()
+                  << std::setw(12) << (human_bytes(f["rate"]) + "/s")
+                  << eta.str() << std::endl;
+        ++shown;
+        ++it;
+    }
+
+    if (shown == 0)
+    {
+        std::cout << "no transfers in progress" << std::endl;
+    }
+
+    std::cout << std::endl;
+}
+
+int
+main(int argc, const char* argv[])
+{
+    hyperdex::connect_opts conn;
+    e::argparser ap;
+    ap.autohelp();
+    ap.add("Connect to a cluster:", conn.parser());
+
+    if (!ap.parse(argc, argv))
+    {
+        return EXIT_FAILURE;
+    }
+
+    if (!conn.validate())
+    {
+        std::cerr << "invalid host:port specification\n" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    if (ap.args_sz() != 0)
+    {
+        std::cerr << "command takes no arguments" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        hyperdex::Admin h(conn.host(), conn.port());
+        hyperdex_admin_returncode prc;
+        hyperdex_admin_perf_counter pc;
+        int64_t pid = h.enable_perf_counters(&prc, &pc);
+
+        if (pid < 0)
+        {
+            std::cerr << "could not collect performance counters: "
+                      << h.error_message() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        servers_t servers;
+        samples_t outgoing;
+        samples_t incoming;
+        time_t printed = time(NULL);
+
+        while (true)
+        {
+            hyperdex_admin_returncode lrc;
+            int64_t lid = h.loop(-1, &lrc);
+
+            if (lid != pid)
+            {
+                continue;
+            }
+
+            if (prc != HYPERDEX_ADMIN_SUCCESS)
+            {
+                std::cerr << "could not collect performance counters: "
+                          << h.error_message() << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            server_times& st(servers[pc.id]);
+
+            if (pc.time > st.newest)
+            {
+                st.complete = st.newest;
+                st.newest = pc.time;
+            }
+
+            uint64_t xid;
+            std::string field;
+
+            if (parse_property(pc.property, "xfer_out.", &xid, &field))
+            {
+                record(&outgoing, pc, xid, field);
+            }
+            else if (parse_property(pc.property, "xfer_in.", &xid, &field))
+            {
+                record(&incoming, pc, xid, field);
+            }
+
+            if (time(NULL) > printed)
+            {
+                print_transfers(servers, &outgoing, &incoming);
+                printed = time(NULL);
+            }
+        }
+
+        return EXIT_SUCCESS;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
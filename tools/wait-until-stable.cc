@@ -36,8 +36,12 @@ int
 main(int argc, const char* argv[])
 {
     hyperdex::connect_opts conn;
+    long checkpoint = 0;
     e::argparser ap;
     ap.autohelp();
+    ap.arg().name('c', "checkpoint")
+            .description("also wait until this checkpoint is stable on every server")
+            .metavar("N").as_long(&checkpoint);
     ap.add("Connect to a cluster:", conn.parser());
 
     if (!ap.parse(argc, argv))
@@ -59,6 +63,13 @@ main(int argc, const char* argv[])
         return EXIT_FAILURE;
     }
 
+    if (checkpoint < 0)
+    {
+        std::cerr << "checkpoint must be non-negative" << std::endl;
+        ap.usage();
+        return EXIT_FAILURE;
+    }
+
     try
     {
         hyperdex::Admin h(conn.host(), conn.port());
@@ -88,6 +99,35 @@ main(int argc, const char* argv[])
             return EXIT_FAILURE;
         }
 
+        if (checkpoint == 0)
+        {
+            return EXIT_SUCCESS;
+        }
+
+        rid = h.wait_until_checkpoint_stable(checkpoint, &rrc);
+
+        if (rid < 0)
+        {
+            std::cerr << "could not wait for checkpoint: " << h.error_message() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        lid = h.loop(-1, &lrc);
+
+        if (lid < 0)
+        {
+            std::cerr << "could not wait for checkpoint: " << h.error_message() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        assert(rid == lid);
+
+        if (rrc != HYPERDEX_ADMIN_SUCCESS)
+        {
+            std::cerr << "could not wait for checkpoint: " << h.error_message() << std::endl;
+            return EXIT_FAILURE;
+        }
+
         return EXIT_SUCCESS;
     }
     catch (std::exception& e)